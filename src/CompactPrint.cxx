@@ -0,0 +1,176 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CompactPrint.hxx"
+#include "song/LightSong.hxx"
+#include "song/DetachedSong.hxx"
+#include "tag/Tag.hxx"
+#include "tag/Mask.hxx"
+#include "client/Response.hxx"
+#include "fs/Traits.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/StringBuffer.hxx"
+#include "util/UriUtil.hxx"
+
+#include <fmt/format.h>
+
+#include <cassert>
+
+static constexpr const char *compact_key_names[] = {
+	"file",
+	"Last-Modified",
+	"Format",
+	"Range",
+	"duration",
+	"Pos",
+	"Id",
+	"Prio",
+};
+
+static_assert(std::size(compact_key_names) ==
+	      unsigned(CompactKey::MAX) - TAG_NUM_OF_ITEM_TYPES);
+
+[[gnu::const]]
+static const char *
+GetCompactKeyName(unsigned key) noexcept
+{
+	assert(key < unsigned(CompactKey::MAX));
+
+	return key < TAG_NUM_OF_ITEM_TYPES
+		? tag_item_names[key]
+		: compact_key_names[key - TAG_NUM_OF_ITEM_TYPES];
+}
+
+inline void
+CompactSongWriter::Declare(unsigned key) noexcept
+{
+	if (r.DeclareCompactKey(key))
+		r.Fmt(FMT_STRING("keydef: {} {}\n"),
+		      key, GetCompactKeyName(key));
+}
+
+inline void
+CompactSongWriter::AppendVarint(uint_least64_t value) noexcept
+{
+	while (value >= 0x80) {
+		payload.push_back(char((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+
+	payload.push_back(char(value));
+}
+
+void
+CompactSongWriter::String(unsigned key, std::string_view value) noexcept
+{
+	Declare(key);
+
+	payload.push_back(char(key));
+	AppendVarint(value.size());
+	payload.append(value);
+}
+
+void
+CompactSongWriter::Integer(unsigned key, uint_least64_t value) noexcept
+{
+	Declare(key);
+
+	payload.push_back(char(key));
+	AppendVarint(value);
+}
+
+static void
+AddTags(CompactSongWriter &w, const Tag &tag, TagMask mask) noexcept
+{
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i)
+		if (mask.Test(types[i]))
+			w.String(types[i], tag.items[i]->value);
+}
+
+static void
+AddAttributes(CompactSongWriter &w, SongTime start_time, SongTime end_time,
+	      std::chrono::system_clock::time_point mtime,
+	      const AudioFormat &audio_format,
+	      SignedSongTime duration) noexcept
+{
+	if (start_time.ToMS() > 0 || end_time.ToMS() > 0) {
+		/* two integers: start and end in milliseconds; the
+		   end is 0 if the range is open */
+		w.Integer(CompactKey::RANGE, start_time.ToMS());
+		w.Integer(CompactKey::RANGE, end_time.ToMS());
+	}
+
+	if (!IsNegative(mtime))
+		w.Integer(CompactKey::LAST_MODIFIED,
+			  std::chrono::system_clock::to_time_t(mtime));
+
+	if (audio_format.IsDefined())
+		w.String(CompactKey::FORMAT, ToString(audio_format).c_str());
+
+	if (!duration.IsNegative())
+		w.Integer(CompactKey::DURATION, duration.ToMS());
+}
+
+void
+CompactSongWriter::Song(const LightSong &song, bool base) noexcept
+{
+	if (!base && song.directory != nullptr)
+		String(CompactKey::URI,
+		       fmt::format("{}/{}", song.directory, song.uri));
+	else
+		String(CompactKey::URI,
+		       base ? PathTraitsUTF8::GetBase(song.uri) : song.uri);
+
+	AddAttributes(*this, song.start_time, song.end_time, song.mtime,
+		      song.audio_format, song.GetDuration());
+	AddTags(*this, song.tag, r.GetTagMask());
+}
+
+void
+CompactSongWriter::Song(const DetachedSong &song, bool base) noexcept
+{
+	const char *uri = song.GetURI();
+	std::string allocated;
+
+	if (base) {
+		uri = PathTraitsUTF8::GetBase(uri);
+	} else {
+		allocated = uri_remove_auth(uri);
+		if (!allocated.empty())
+			uri = allocated.c_str();
+	}
+
+	String(CompactKey::URI, uri);
+
+	AddAttributes(*this, song.GetStartTime(), song.GetEndTime(),
+		      song.GetLastModified(), song.GetAudioFormat(),
+		      song.GetDuration());
+	AddTags(*this, song.GetTag(), r.GetTagMask());
+}
+
+void
+CompactSongWriter::Finish() noexcept
+{
+	r.Fmt(FMT_STRING("song: {}\n"), payload.size());
+	r.Write(payload);
+	r.Write("\n", 1);
+	payload.clear();
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_COMPACT_PRINT_HXX
+#define MPD_COMPACT_PRINT_HXX
+
+#include "tag/Type.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct LightSong;
+class DetachedSong;
+class Response;
+
+/**
+ * Key identifiers of the "compact" response format.  Values below
+ * #TAG_NUM_OF_ITEM_TYPES are tag types.
+ */
+enum class CompactKey : uint8_t {
+	/** the song URI, sent as "file" */
+	URI = TAG_NUM_OF_ITEM_TYPES,
+	LAST_MODIFIED,
+	FORMAT,
+	RANGE,
+	DURATION,
+	POS,
+	ID,
+	PRIO,
+
+	MAX
+};
+
+static_assert(unsigned(CompactKey::MAX) <= 64,
+	      "Response::compact_keys is too small");
+
+/**
+ * Builds one song record in the "compact" response format (enabled
+ * with the "compact" command).  A record is sent like a binary chunk:
+ *
+ *     song: SIZE\n
+ *     PAYLOAD\n
+ *
+ * The payload is a sequence of fields, each consisting of the key id
+ * (one byte) and a value.  Integer values are LEB128 varints; string
+ * values are a varint length followed by the UTF-8 bytes.  Before a
+ * key is used for the first time in a response, its name is declared
+ * with a text line "keydef: ID NAME".
+ */
+class CompactSongWriter {
+	Response &r;
+
+	std::string payload;
+
+public:
+	explicit CompactSongWriter(Response &_r) noexcept
+		:r(_r) {}
+
+	CompactSongWriter(const CompactSongWriter &) = delete;
+	CompactSongWriter &operator=(const CompactSongWriter &) = delete;
+
+	void String(unsigned key, std::string_view value) noexcept;
+	void Integer(unsigned key, uint_least64_t value) noexcept;
+
+	void String(CompactKey key, std::string_view value) noexcept {
+		String(unsigned(key), value);
+	}
+
+	void Integer(CompactKey key, uint_least64_t value) noexcept {
+		Integer(unsigned(key), value);
+	}
+
+	/**
+	 * Add the URI, attributes and tags of the song.
+	 */
+	void Song(const LightSong &song, bool base=false) noexcept;
+	void Song(const DetachedSong &song, bool base=false) noexcept;
+
+	/**
+	 * Send the record.
+	 */
+	void Finish() noexcept;
+
+private:
+	void Declare(unsigned key) noexcept;
+	void AppendVarint(uint_least64_t value) noexcept;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FingerprintService.hxx"
+#include "lib/chromaprint/Scanner.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#ifdef ENABLE_SQLITE
+#include "sticker/Database.hxx"
+#endif
+
+#include <cassert>
+#include <exception>
+
+static constexpr Domain fingerprint_domain("fingerprint");
+
+static constexpr char CHROMAPRINT_STICKER[] = "chromaprint";
+
+FingerprintService::FingerprintService(EventLoop &event_loop,
+				       StickerDatabase *_sticker_db,
+				       unsigned _n_threads) noexcept
+	:sticker_db(_sticker_db), n_threads(_n_threads),
+	 inject(event_loop, BIND_THIS_METHOD(OnInject))
+{
+	assert(n_threads > 0);
+}
+
+FingerprintService::~FingerprintService() noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		quit = true;
+		queue.clear();
+
+		for (auto *scanner : running)
+			scanner->Cancel();
+
+		cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+
+	WritePending();
+}
+
+std::string
+FingerprintService::Lookup([[maybe_unused]] std::string_view uri) const noexcept
+{
+	std::string value;
+
+#ifdef ENABLE_SQLITE
+	if (sticker_db != nullptr)
+		sticker_db->GetSongCache().GetSongSticker(uri,
+							  CHROMAPRINT_STICKER,
+							  value);
+#endif
+
+	return value;
+}
+
+void
+FingerprintService::Store(std::string_view uri,
+			  std::string &&fingerprint) noexcept
+{
+	if (sticker_db == nullptr)
+		return;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		results.emplace_front(uri, std::move(fingerprint));
+	}
+
+	inject.Schedule();
+}
+
+void
+FingerprintService::Enqueue(std::forward_list<Job> &&jobs)
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		for (auto &job : jobs)
+			queue.emplace_back(std::move(job));
+		cond.notify_all();
+	}
+
+	if (threads.empty())
+		StartThreads();
+}
+
+FingerprintService::Stats
+FingerprintService::GetStats() const noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+	return {queue.size(), n_done, n_failed};
+}
+
+void
+FingerprintService::StartThreads()
+{
+	for (unsigned i = 0; i < n_threads; ++i)
+		threads.emplace_front(BIND_THIS_METHOD(RunWorker)).Start();
+}
+
+void
+FingerprintService::RunWorker() noexcept
+{
+	SetThreadName("fingerprint");
+
+	/* this is a batch job which must not disturb playback */
+	SetThreadIdlePriority();
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		cond.wait(lock, [this]{ return quit || !queue.empty(); });
+		if (quit)
+			break;
+
+		auto job = std::move(queue.front());
+		queue.pop_front();
+
+		std::string fingerprint;
+		std::exception_ptr error;
+
+		{
+			const ScopeUnlock unlock(mutex);
+
+			/* it may have been cached by "getfingerprint"
+			   in the meantime */
+			if (!Lookup(job.uri).empty())
+				continue;
+		}
+
+		ChromaprintScanner scanner(job.location, std::move(job.path));
+		running.push_front(&scanner);
+
+		{
+			const ScopeUnlock unlock(mutex);
+
+			try {
+				fingerprint = scanner.Scan();
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		running.remove(&scanner);
+
+		if (error) {
+			++n_failed;
+			FmtError(fingerprint_domain,
+				 "Failed to fingerprint '{}': {}",
+				 job.uri, error);
+		} else if (!fingerprint.empty()) {
+			++n_done;
+
+			if (sticker_db != nullptr) {
+				results.emplace_front(std::move(job.uri),
+						      std::move(fingerprint));
+				inject.Schedule();
+			}
+		}
+	}
+}
+
+void
+FingerprintService::WritePending() noexcept
+{
+	decltype(results) items;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		items.swap(results);
+	}
+
+#ifdef ENABLE_SQLITE
+	if (sticker_db == nullptr)
+		return;
+
+	for (const auto &[uri, fingerprint] : items) {
+		try {
+			sticker_db->StoreValue("song", uri.c_str(),
+					       CHROMAPRINT_STICKER,
+					       fingerprint.c_str());
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to store fingerprint");
+		}
+	}
+#endif
+}
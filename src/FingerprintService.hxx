@@ -0,0 +1,180 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FINGERPRINT_SERVICE_HXX
+#define MPD_FINGERPRINT_SERVICE_HXX
+
+#include "config.h"
+#include "event/InjectEvent.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <cstddef>
+#include <deque>
+#include <forward_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+class StickerDatabase;
+class ChromaprintScanner;
+
+/**
+ * Calculates Chromaprint fingerprints of database songs in a small
+ * pool of worker threads, and caches them in the song sticker
+ * "chromaprint".  The cache is also used by the "getfingerprint"
+ * command.
+ */
+class FingerprintService final {
+public:
+	struct Job {
+		/**
+		 * The song URI relative to the music directory; this
+		 * is the sticker key.
+		 */
+		std::string uri;
+
+		/**
+		 * The URI passed to the #ChromaprintScanner; differs
+		 * from #uri if the music directory is remote.
+		 */
+		std::string location;
+
+		/**
+		 * The local file system path; nullptr if the song
+		 * shall be opened by #location.
+		 */
+		AllocatedPath path;
+	};
+
+	struct Stats {
+		std::size_t queued, done, failed;
+	};
+
+private:
+	StickerDatabase *const sticker_db;
+
+	const unsigned n_threads;
+
+	/**
+	 * Passes #results to the #StickerDatabase in the
+	 * #EventLoop thread.
+	 */
+	InjectEvent inject;
+
+	mutable Mutex mutex;
+	Cond cond;
+
+	std::deque<Job> queue;
+
+	/**
+	 * Fingerprints waiting to be written to the
+	 * #StickerDatabase.
+	 */
+	std::forward_list<std::pair<std::string, std::string>> results;
+
+	/**
+	 * The scanners currently running in worker threads; they
+	 * are canceled by the destructor.
+	 */
+	std::forward_list<ChromaprintScanner *> running;
+
+	/**
+	 * The worker threads; they are started by the first
+	 * Enqueue() call.
+	 */
+	std::forward_list<Thread> threads;
+
+	std::size_t n_done = 0, n_failed = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * @param _sticker_db the database where fingerprints are
+	 * cached; nullptr disables the cache
+	 * @param _n_threads the maximum number of songs decoded at a
+	 * time
+	 */
+	FingerprintService(EventLoop &event_loop,
+			   StickerDatabase *_sticker_db,
+			   unsigned _n_threads) noexcept;
+
+	/**
+	 * Cancels all scans and writes the pending results.
+	 */
+	~FingerprintService() noexcept;
+
+	FingerprintService(const FingerprintService &) = delete;
+	FingerprintService &operator=(const FingerprintService &) = delete;
+
+	bool HasCache() const noexcept {
+		return sticker_db != nullptr;
+	}
+
+	/**
+	 * Look up a cached fingerprint.  May be called from any
+	 * thread.
+	 *
+	 * @return the fingerprint or an empty string if there is none
+	 */
+	[[gnu::pure]]
+	std::string Lookup(std::string_view uri) const noexcept;
+
+	/**
+	 * Add a fingerprint to the cache.  May be called from any
+	 * thread; the #StickerDatabase is updated asynchronously.
+	 */
+	void Store(std::string_view uri, std::string &&fingerprint) noexcept;
+
+	/**
+	 * Schedule songs for fingerprinting.
+	 *
+	 * Throws if a worker thread could not be started.
+	 */
+	void Enqueue(std::forward_list<Job> &&jobs);
+
+	[[gnu::pure]]
+	Stats GetStats() const noexcept;
+
+	/**
+	 * Has this object ever done anything?  If not, there is
+	 * nothing worth reporting in "stats".
+	 */
+	[[gnu::pure]]
+	bool IsUsed() const noexcept {
+		return !threads.empty();
+	}
+
+private:
+	void StartThreads();
+
+	void RunWorker() noexcept;
+
+	void WritePending() noexcept;
+
+	/* InjectEvent callback */
+	void OnInject() noexcept {
+		WritePending();
+	}
+};
+
+#endif
@@ -24,23 +24,47 @@
 #include "StateFile.hxx"
 #include "Stats.hxx"
 #include "client/List.hxx"
+#include "client/BackgroundCommandPool.hxx"
+#include "client/Thread.hxx"
 #include "input/cache/Manager.hxx"
+#include "metrics/Server.hxx"
+#include "PictureCache.hxx"
+#include "TagScanPool.hxx"
+
+#ifdef ENABLE_SQLITE
+#include "song/StickerSongFilter.hxx"
+#include "decoder/Analysis.hxx"
+#endif
 
 #ifdef ENABLE_CURL
 #include "RemoteTagCache.hxx"
 #include "util/UriExtract.hxx"
 #endif
 
+#ifdef ENABLE_CHROMAPRINT
+#include "FingerprintService.hxx"
+#endif
+
 #ifdef ENABLE_DATABASE
 #include "db/DatabaseError.hxx"
 #include "db/Interface.hxx"
+#include "db/Loader.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
 #include "db/update/Service.hxx"
-#include "storage/StorageInterface.hxx"
+#include "storage/CompositeStorage.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <string>
 
 #ifdef ENABLE_INOTIFY
 #include "db/update/InotifyUpdate.hxx"
 #endif
 
+#ifdef ENABLE_FANOTIFY
+#include "db/update/FanotifyUpdate.hxx"
+#endif
+
 #ifdef ENABLE_NEIGHBOR_PLUGINS
 #include "neighbor/Glue.hxx"
 #endif
@@ -62,7 +86,29 @@ Instance::Instance()
 
 Instance::~Instance() noexcept
 {
+	/* the client threads may be waiting for the main thread,
+	   which doesn't run its EventLoop anymore */
+	for (auto &i : client_threads)
+		i->Stop();
+
+	/* background commands may be accessing the database; wait
+	   for them to finish before closing it */
+	if (background_command_pool)
+		background_command_pool->Stop();
+
+#ifdef ENABLE_SQLITE
+	SetStickerValueSource(nullptr);
+#endif
+
 #ifdef ENABLE_DATABASE
+	if (database_loader != nullptr && IsDatabaseLoading() &&
+	    database_loader->Join())
+		/* shutdown while the database was being loaded, and
+		   loading has failed: don't close it */
+		database.reset();
+
+	database_loader.reset();
+
 	delete update;
 
 	if (database != nullptr) {
@@ -81,6 +127,17 @@ Instance::OnStateModified() noexcept
 		state_file->CheckModified();
 }
 
+ClientThread *
+Instance::GetClientThread() noexcept
+{
+	if (client_threads.empty())
+		return nullptr;
+
+	auto &thread = *client_threads[next_client_thread];
+	next_client_thread = (next_client_thread + 1) % client_threads.size();
+	return &thread;
+}
+
 Partition *
 Instance::FindPartition(const char *name) noexcept
 {
@@ -107,6 +164,8 @@ Instance::DeletePartition(Partition &partition) noexcept
 
 #ifdef ENABLE_DATABASE
 
+static constexpr Domain database_domain("database");
+
 const Database &
 Instance::GetDatabaseOrThrow() const
 {
@@ -114,9 +173,117 @@ Instance::GetDatabaseOrThrow() const
 		throw DatabaseError(DatabaseErrorCode::DISABLED,
 				    "No database");
 
+	if (IsDatabaseLoading())
+		throw DatabaseError(DatabaseErrorCode::LOADING,
+				    "Database is loading");
+
 	return *database;
 }
 
+void
+Instance::StartLoadDatabase()
+{
+	assert(database != nullptr);
+	assert(database_loader == nullptr);
+
+	if (update != nullptr)
+		update->Suspend();
+
+	database_loader = std::make_unique<DatabaseLoader>(event_loop,
+							   *database,
+							   BIND_THIS_METHOD(OnDatabaseLoaded));
+	database_loading = true;
+
+	try {
+		database_loader->Start();
+	} catch (...) {
+		database_loading = false;
+		database_loader.reset();
+		throw;
+	}
+}
+
+void
+Instance::OnDatabaseLoaded(std::exception_ptr error) noexcept
+{
+	assert(IsDatabaseLoading());
+
+	if (error) {
+		LogError(error, "Failed to open database plugin");
+
+		/* continue without a database */
+#ifdef ENABLE_INOTIFY
+		inotify_update.reset();
+#endif
+#ifdef ENABLE_FANOTIFY
+		fanotify_update.reset();
+#endif
+		delete std::exchange(update, nullptr);
+		database.reset();
+		database_loading = false;
+		EmitIdle(IDLE_DATABASE);
+		return;
+	}
+
+	MountDatabases();
+
+	database_loading = false;
+
+	LogDebug(database_domain, "Database loaded");
+
+	/* resolve the queued songs (which were restored from the
+	   state file without the database) */
+	OnDatabaseModified();
+
+	if (update != nullptr) {
+		auto &sdb = static_cast<SimpleDatabase &>(*database);
+		if (!sdb.FileExists()) {
+			/* there is no database file: create it now */
+			try {
+				update->Enqueue("", true);
+			} catch (...) {
+				LogError(std::current_exception());
+			}
+		}
+
+		update->Resume();
+	}
+}
+
+void
+Instance::MountDatabases() noexcept
+{
+	auto *sdb = dynamic_cast<SimpleDatabase *>(database.get());
+	if (sdb == nullptr || storage == nullptr)
+		return;
+
+	/* collect the mounts first, because VisitMounts() holds
+	   the CompositeStorage lock */
+	std::vector<std::pair<std::string, std::string>> mounts;
+	const auto visitor = [&mounts](const char *mount_uri,
+				       const Storage &s){
+		if (*mount_uri == 0)
+			return;
+
+		std::string url = s.MapUTF8("");
+		if (!url.empty())
+			mounts.emplace_back(mount_uri, std::move(url));
+	};
+
+	static_cast<const CompositeStorage *>(storage)->VisitMounts(visitor);
+
+	for (const auto &[uri, url] : mounts) {
+		try {
+			if (!sdb->Mount(uri.c_str(), url.c_str()) &&
+			    update != nullptr)
+				update->Enqueue(uri, false);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to mount database");
+		}
+	}
+}
+
 void
 Instance::OnDatabaseModified() noexcept
 {
@@ -125,6 +292,8 @@ Instance::OnDatabaseModified() noexcept
 	/* propagate the change to all subsystems */
 
 	stats_invalidate();
+	unique_tags_cache.Clear();
+	lsinfo_cache.Clear();
 
 	for (auto &partition : partitions)
 		partition.DatabaseModified(*database);
@@ -177,7 +346,8 @@ Instance::LookupRemoteTag(const char *uri) noexcept
 
 	if (!remote_tag_cache)
 		remote_tag_cache = std::make_unique<RemoteTagCache>(event_loop,
-								    *this);
+								    *this,
+								    RemoteTagCacheConfig{});
 
 	remote_tag_cache->Lookup(uri);
 }
@@ -41,22 +41,38 @@ class NeighborGlue;
 #ifdef ENABLE_DATABASE
 #include "db/DatabaseListener.hxx"
 #include "db/Ptr.hxx"
+#include "db/UniqueTagsCache.hxx"
+#include "db/LsinfoCache.hxx"
 class Storage;
 class UpdateService;
+class DatabaseLoader;
 #ifdef ENABLE_INOTIFY
 class InotifyUpdate;
 #endif
+#ifdef ENABLE_FANOTIFY
+class FanotifyUpdate;
+#endif
 #endif
 
+#include <atomic>
+#include <exception>
 #include <memory>
 #include <list>
+#include <vector>
 
 class ClientList;
+class ClientThread;
 struct Partition;
 class StateFile;
 class RemoteTagCache;
 class StickerDatabase;
+class AnalysisStore;
+class FingerprintService;
 class InputCacheManager;
+class PictureCache;
+class BackgroundCommandPool;
+class TagScanPool;
+class MetricsServer;
 
 /**
  * A utility class which, when used as the first base class, ensures
@@ -103,6 +119,12 @@ struct Instance final
 
 	std::unique_ptr<InputCacheManager> input_cache;
 
+	/**
+	 * Cover art for "albumart" and "readpicture"; nullptr if
+	 * disabled.
+	 */
+	std::unique_ptr<PictureCache> picture_cache;
+
 	/**
 	 * Monitor for global idle events to be broadcasted to all
 	 * partitions.
@@ -124,23 +146,116 @@ struct Instance final
 
 	UpdateService *update = nullptr;
 
+	/**
+	 * Loads the #database in a separate thread if
+	 * "background_database_load" is enabled; see
+	 * StartLoadDatabase().
+	 */
+	std::unique_ptr<DatabaseLoader> database_loader;
+
+	/**
+	 * Is the #database still being loaded by the
+	 * #database_loader?  While this is set, GetDatabase()
+	 * returns nullptr.  This is atomic because it is also read
+	 * by the #background_command_pool.
+	 */
+	std::atomic_bool database_loading = false;
+
+	/**
+	 * Caches the results of the "list" command.  It is flushed
+	 * by OnDatabaseModified().
+	 */
+	UniqueTagsCache unique_tags_cache;
+
+	/**
+	 * Caches the database part of "lsinfo" responses.  It is
+	 * flushed by OnDatabaseModified().
+	 */
+	LsinfoCache lsinfo_cache;
+
+	/**
+	 * The number of database commands currently running in the
+	 * #background_command_pool.  While this is non-zero,
+	 * databases must not be unmounted.
+	 */
+	std::atomic_uint n_background_database_commands = 0;
+
 #ifdef ENABLE_INOTIFY
 	std::unique_ptr<InotifyUpdate> inotify_update;
 #endif
+
+#ifdef ENABLE_FANOTIFY
+	/**
+	 * If this is set, then fanotify watches the music directory
+	 * and #inotify_update is not used.
+	 */
+	std::unique_ptr<FanotifyUpdate> fanotify_update;
+#endif
 #endif
 
 #ifdef ENABLE_CURL
 	std::unique_ptr<RemoteTagCache> remote_tag_cache;
 #endif
 
+	/**
+	 * Executes #ThreadBackgroundCommand instances.  This must be
+	 * declared before #client_list, because the clients cancel
+	 * their commands when they are destroyed.
+	 */
+	std::unique_ptr<BackgroundCommandPool> background_command_pool;
+
+	/**
+	 * Scans song tags for clients and for the database update.
+	 * This must be declared before #client_list, because the
+	 * clients cancel their lookups when they are destroyed.
+	 */
+	std::unique_ptr<TagScanPool> tag_scan_pool;
+
+	/**
+	 * Threads which own client sockets (configured with
+	 * "client_threads").  If this is empty, all clients are
+	 * handled by the main thread.  This must be declared before
+	 * #client_list, because the clients' sockets are registered
+	 * in the #EventLoop instances of these threads.
+	 */
+	std::vector<std::unique_ptr<ClientThread>> client_threads;
+
+	unsigned next_client_thread = 0;
+
+	/**
+	 * The number of "idle" responses which were delayed by
+	 * "idle_coalesce_window".
+	 */
+	std::atomic<uint_least64_t> n_idle_delayed = 0;
+
 	std::unique_ptr<ClientList> client_list;
 
+	/**
+	 * Exports metrics over HTTP; nullptr if "metrics_port" is
+	 * not configured.
+	 */
+	std::unique_ptr<MetricsServer> metrics_server;
+
 	std::list<Partition> partitions;
 
 	std::unique_ptr<StateFile> state_file;
 
 #ifdef ENABLE_SQLITE
 	std::unique_ptr<StickerDatabase> sticker_database;
+
+	/**
+	 * Stores ReplayGain/MixRamp analysis results in
+	 * #sticker_database; nullptr if "song_analysis" is disabled.
+	 */
+	std::unique_ptr<AnalysisStore> analysis_store;
+#endif
+
+#ifdef ENABLE_CHROMAPRINT
+	/**
+	 * Calculates fingerprints for "fingerprintscan" and caches
+	 * them for "getfingerprint".
+	 */
+	std::unique_ptr<FingerprintService> fingerprint_service;
 #endif
 
 	Instance();
@@ -170,6 +285,12 @@ struct Instance final
 	 */
 	void OnStateModified() noexcept;
 
+	/**
+	 * Choose the #ClientThread for a new client (round-robin).
+	 * Returns nullptr if clients are handled by the main thread.
+	 */
+	ClientThread *GetClientThread() noexcept;
+
 	/**
 	 * Find a #Partition with the given name.  Returns nullptr if
 	 * no such partition was found.
@@ -185,18 +306,33 @@ struct Instance final
 	/**
 	 * Returns the global #Database instance.  May return nullptr
 	 * if this MPD configuration has no database (no
-	 * music_directory was configured).
+	 * music_directory was configured) or if it is still being
+	 * loaded.
 	 */
 	Database *GetDatabase() noexcept {
-		return database.get();
+		return IsDatabaseLoading() ? nullptr : database.get();
 	}
 
 	/**
 	 * Returns the global #Database instance.  Throws
 	 * DatabaseError if this MPD configuration has no database (no
-	 * music_directory was configured).
+	 * music_directory was configured) or if it is still being
+	 * loaded.
 	 */
 	const Database &GetDatabaseOrThrow() const;
+
+	bool IsDatabaseLoading() const noexcept {
+		return database_loading.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Open the #database in a separate thread.  Until that has
+	 * finished, GetDatabase() returns nullptr and the #update
+	 * service is suspended.
+	 *
+	 * Throws on error.
+	 */
+	void StartLoadDatabase();
 #endif
 
 #ifdef ENABLE_SQLITE
@@ -219,6 +355,18 @@ struct Instance final
 
 private:
 #ifdef ENABLE_DATABASE
+	/**
+	 * Called by the #database_loader in the main thread.
+	 */
+	void OnDatabaseLoaded(std::exception_ptr error) noexcept;
+
+	/**
+	 * Mount the databases of all mounted storages; this is
+	 * needed after loading the database in the background,
+	 * because storage_state_restore() could not do it.
+	 */
+	void MountDatabases() noexcept;
+
 	/* virtual methods from class DatabaseListener */
 	void OnDatabaseModified() noexcept override;
 	void OnDatabaseSongRemoved(const char *uri) noexcept override;
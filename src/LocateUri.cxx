@@ -39,8 +39,6 @@ LocateFileUri(const char *uri, const Client *client
 #endif
 	      )
 {
-	auto path = AllocatedPath::FromUTF8Throw(uri);
-
 #ifdef ENABLE_DATABASE
 	if (storage != nullptr) {
 		const auto suffix = storage->MapToRelativeUTF8(uri);
@@ -52,6 +50,8 @@ LocateFileUri(const char *uri, const Client *client
 	}
 #endif
 
+	auto path = AllocatedPath::FromUTF8Throw(uri);
+
 	if (client != nullptr)
 		client->AllowFile(path);
 
@@ -25,6 +25,19 @@
 #include "Version.h"
 #include "config.h"
 
+#ifndef ANDROID
+#include "LogQueue.hxx"
+#include "thread/Name.hxx"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#endif
+
 #include <cassert>
 
 #include <stdio.h>
@@ -89,13 +102,29 @@ EnableLogTimestamp() noexcept
 	enable_timestamp = true;
 }
 
+/**
+ * Messages per second and domain; zero means unlimited.
+ */
+static unsigned log_rate_limit;
+
+void
+SetLogRateLimit(unsigned per_second) noexcept
+{
+	log_rate_limit = per_second;
+}
+
+static constexpr size_t LOG_DATE_BUF_SIZE = 16;
+
 static const char *
-log_date() noexcept
+log_date(char *buf, time_t t) noexcept
 {
-	static constexpr size_t LOG_DATE_BUF_SIZE = 16;
-	static char buf[LOG_DATE_BUF_SIZE];
-	time_t t = time(nullptr);
-	strftime(buf, LOG_DATE_BUF_SIZE, "%b %d %H:%M : ", localtime(&t));
+	struct tm tm;
+#ifdef _WIN32
+	localtime_s(&tm, &t);
+#else
+	localtime_r(&t, &tm);
+#endif
+	strftime(buf, LOG_DATE_BUF_SIZE, "%b %d %H:%M : ", &tm);
 	return buf;
 }
 
@@ -161,12 +190,23 @@ LogFinishSysLog() noexcept
 #endif
 
 static void
-FileLog(const Domain &domain, std::string_view message) noexcept
+FormatFileLog(fmt::memory_buffer &buffer, const Domain &domain,
+	      std::string_view message, time_t t) noexcept
+{
+	char date[LOG_DATE_BUF_SIZE];
+	fmt::format_to(std::back_inserter(buffer), "{}{}: {}\n",
+		       enable_timestamp ? log_date(date, t) : "",
+		       domain.GetName(),
+		       message.substr(0, chomp_length(message)));
+}
+
+static void
+WriteFileLog(const fmt::memory_buffer &buffer) noexcept
 {
-	fprintf(stderr, "%s%s: %.*s\n",
-		enable_timestamp ? log_date() : "",
-		domain.GetName(),
-		chomp_length(message), message.data());
+	if (buffer.size() == 0)
+		return;
+
+	fwrite(buffer.data(), 1, buffer.size(), stderr);
 
 #ifdef _WIN32
 	/* force-flush the log file, because setvbuf() does not seem
@@ -175,6 +215,187 @@ FileLog(const Domain &domain, std::string_view message) noexcept
 #endif
 }
 
+static void
+FileLog(const Domain &domain, std::string_view message) noexcept
+{
+	fmt::memory_buffer buffer;
+	FormatFileLog(buffer, domain, message, time(nullptr));
+	WriteFileLog(buffer);
+}
+
+/**
+ * Log messages are copied into this queue by Log() and written by
+ * the logging thread, so a slow log destination does not block the
+ * calling thread (which may be an audio output thread).  It is
+ * allocated by StartLogThread() and never freed.
+ */
+static std::unique_ptr<LogQueue> log_queue;
+
+/**
+ * Is the logging thread running?  If not, Log() writes directly.
+ */
+static std::atomic_bool log_thread_running{false};
+
+/**
+ * Incremented after each push; the logging thread waits on it.
+ */
+static std::atomic_uint log_wake{0};
+
+static std::atomic_bool log_thread_quit{false};
+
+static std::thread log_thread;
+
+static std::atomic<uint_least64_t> log_queue_dropped{0}, log_rate_dropped{0};
+
+/**
+ * Write up to this number of messages at a time.
+ */
+static constexpr std::size_t LOG_BATCH_SIZE = 256;
+
+static constexpr Domain log_backend_domain("log");
+
+/**
+ * State of the per-domain rate limit, owned by the logging thread.
+ */
+struct LogRateState {
+	std::chrono::steady_clock::time_point window_start;
+	unsigned count = 0, suppressed = 0;
+};
+
+/**
+ * Apply the per-domain rate limit.
+ *
+ * @return true if the message shall be written
+ */
+static bool
+CheckLogRateLimit(std::unordered_map<const Domain *, LogRateState> &rates,
+		  fmt::memory_buffer &buffer,
+		  const LogQueue::Message &m) noexcept
+{
+	if (log_rate_limit == 0 || m.level >= LogLevel::ERROR)
+		/* errors are never suppressed */
+		return true;
+
+	const auto now = std::chrono::steady_clock::now();
+	auto &rate = rates[m.domain];
+	if (now - rate.window_start >= std::chrono::seconds{1}) {
+		if (rate.suppressed > 0) {
+			const auto text =
+				fmt::format("{} messages suppressed",
+					    rate.suppressed);
+			FormatFileLog(buffer, m.GetDomain(), text, m.time);
+		}
+
+		rate.window_start = now;
+		rate.count = 0;
+		rate.suppressed = 0;
+	}
+
+	if (rate.count >= log_rate_limit) {
+		++rate.suppressed;
+		log_rate_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	++rate.count;
+	return true;
+}
+
+static void
+LogThreadRun() noexcept
+{
+	SetThreadName("log");
+
+	std::unordered_map<const Domain *, LogRateState> rates;
+	uint_least64_t reported_dropped = 0;
+	fmt::memory_buffer buffer;
+
+	while (true) {
+		const unsigned wake = log_wake.load(std::memory_order_acquire);
+
+		std::size_t n = 0;
+		while (n < LOG_BATCH_SIZE &&
+		       log_queue->Pop([&](const LogQueue::Message &m){
+			       if (!CheckLogRateLimit(rates, buffer, m))
+				       return;
+
+#ifdef HAVE_SYSLOG
+			       if (enable_syslog) {
+				       SysLog(m.GetDomain(), m.level,
+					      m.GetText());
+				       return;
+			       }
+#endif
+
+			       FormatFileLog(buffer, m.GetDomain(),
+					     m.GetText(), m.time);
+		       }))
+			++n;
+
+		if (const auto dropped = log_queue_dropped.load(std::memory_order_relaxed);
+		    dropped != reported_dropped) {
+			const auto text =
+				fmt::format("{} messages dropped because the log queue was full",
+					    dropped - reported_dropped);
+			reported_dropped = dropped;
+
+#ifdef HAVE_SYSLOG
+			if (enable_syslog)
+				SysLog(log_backend_domain, LogLevel::WARNING,
+				       text);
+			else
+#endif
+				FormatFileLog(buffer, log_backend_domain,
+					      text, time(nullptr));
+		}
+
+		WriteFileLog(buffer);
+		buffer.clear();
+
+		if (n == 0) {
+			if (log_thread_quit.load())
+				break;
+
+			log_wake.wait(wake, std::memory_order_acquire);
+		}
+	}
+}
+
+void
+StartLogThread()
+{
+	assert(!log_thread_running);
+
+	if (log_queue == nullptr)
+		log_queue = std::make_unique<LogQueue>(1024);
+
+	log_thread_quit = false;
+	log_thread = std::thread(LogThreadRun);
+	log_thread_running = true;
+}
+
+void
+StopLogThread() noexcept
+{
+	if (!log_thread_running.exchange(false))
+		return;
+
+	log_thread_quit = true;
+	log_wake.fetch_add(1, std::memory_order_release);
+	log_wake.notify_one();
+
+	log_thread.join();
+}
+
+LogStats
+GetLogStats() noexcept
+{
+	return {
+		log_queue_dropped.load(std::memory_order_relaxed),
+		log_rate_dropped.load(std::memory_order_relaxed),
+	};
+}
+
 #endif /* !ANDROID */
 
 void
@@ -197,6 +418,22 @@ Log(LogLevel level, const Domain &domain, std::string_view msg) noexcept
 	if (level < log_threshold)
 		return;
 
+	if (log_thread_running.load(std::memory_order_relaxed)) {
+		if (log_queue->Push(level, domain, msg, time(nullptr))) {
+			log_wake.fetch_add(1, std::memory_order_release);
+			log_wake.notify_one();
+			return;
+		}
+
+		log_queue_dropped.fetch_add(1, std::memory_order_relaxed);
+
+		if (level < LogLevel::ERROR)
+			return;
+
+		/* the queue is full, but errors are never dropped:
+		   write it synchronously */
+	}
+
 #ifdef HAVE_SYSLOG
 	if (enable_syslog) {
 		SysLog(domain, level, msg);
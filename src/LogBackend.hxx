@@ -22,6 +22,8 @@
 
 #include "LogLevel.hxx"
 
+#include <cstdint>
+
 void
 SetLogThreshold(LogLevel _threshold) noexcept;
 
@@ -34,4 +36,43 @@ LogInitSysLog() noexcept;
 void
 LogFinishSysLog() noexcept;
 
+/**
+ * Limit the number of messages per second and domain; excess
+ * messages are dropped (but errors never are).  Zero means
+ * unlimited.  This is only effective while the logging thread runs.
+ */
+void
+SetLogRateLimit(unsigned per_second) noexcept;
+
+/**
+ * Start the logging thread.  From now on, Log() only copies
+ * messages into a queue, and the logging thread writes them in
+ * batches.  This must be called after daemonizing.
+ *
+ * Throws on error.
+ */
+void
+StartLogThread();
+
+/**
+ * Write all pending messages and stop the logging thread.
+ */
+void
+StopLogThread() noexcept;
+
+struct LogStats {
+	/**
+	 * Messages dropped because the queue was full.
+	 */
+	uint_least64_t queue_dropped;
+
+	/**
+	 * Messages dropped by the rate limit.
+	 */
+	uint_least64_t rate_dropped;
+};
+
+LogStats
+GetLogStats() noexcept;
+
 #endif /* LOG_H */
@@ -144,6 +144,8 @@ log_init(const ConfigData &config, bool verbose, bool use_stdout)
 				: LogLevel::NOTICE;
 		}));
 
+	SetLogRateLimit(config.GetUnsigned(ConfigOption::LOG_RATE_LIMIT, 0));
+
 	if (use_stdout) {
 		out_fd = STDOUT_FILENO;
 	} else {
@@ -195,14 +197,17 @@ void
 log_deinit() noexcept
 {
 #ifndef ANDROID
+	StopLogThread();
 	close_log_files();
 	out_path = nullptr;
 #endif
 }
 
-void setup_log_output()
-{
 #ifndef ANDROID
+
+static void
+redirect_log_output()
+{
 	if (out_fd == STDOUT_FILENO)
 		return;
 
@@ -221,6 +226,18 @@ void setup_log_output()
 	redirect_logs(out_fd);
 	close(out_fd);
 	out_fd = -1;
+}
+
+#endif
+
+void setup_log_output()
+{
+#ifndef ANDROID
+	redirect_log_output();
+
+	/* from now on, write log messages in a separate thread, so
+	   a slow log destination does not block the caller */
+	StartLogThread();
 #endif
 }
 
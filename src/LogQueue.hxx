@@ -0,0 +1,181 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_LOG_QUEUE_HXX
+#define MPD_LOG_QUEUE_HXX
+
+#include "LogLevel.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+class Domain;
+
+/**
+ * A bounded lock-free queue of log messages.  Any number of threads
+ * may call Push() concurrently; only one thread (the logging thread)
+ * may call Pop().  Messages are copied into preallocated slots, so
+ * pushing never allocates memory.
+ *
+ * This is a variant of Dmitry Vyukov's bounded MPMC queue: each slot
+ * has a sequence number which tells whether it is free for the
+ * producer at a given position or ready for the consumer.
+ */
+class LogQueue {
+public:
+	/**
+	 * Longer messages are truncated.
+	 */
+	static constexpr std::size_t MAX_MESSAGE = 1000;
+
+	struct Message {
+		const Domain *domain;
+
+		std::time_t time;
+
+		LogLevel level;
+
+		unsigned short length;
+
+		char text[MAX_MESSAGE];
+
+		std::string_view GetText() const noexcept {
+			return {text, length};
+		}
+
+		const Domain &GetDomain() const noexcept {
+			return *domain;
+		}
+	};
+
+private:
+	struct Slot {
+		std::atomic_size_t sequence;
+
+		Message message;
+	};
+
+	const std::size_t mask;
+
+	const std::unique_ptr<Slot[]> slots;
+
+	alignas(64) std::atomic_size_t push_position{0};
+
+	/**
+	 * Only accessed by the consumer.
+	 */
+	alignas(64) std::size_t pop_position = 0;
+
+public:
+	/**
+	 * @param capacity the number of slots; must be a power of two
+	 */
+	explicit LogQueue(std::size_t capacity)
+		:mask(capacity - 1),
+		 slots(std::make_unique<Slot[]>(capacity))
+	{
+		assert(capacity > 0);
+		assert((capacity & mask) == 0);
+
+		for (std::size_t i = 0; i < capacity; ++i)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	LogQueue(const LogQueue &) = delete;
+	LogQueue &operator=(const LogQueue &) = delete;
+
+	/**
+	 * Copy a message into the queue.  This method is thread-safe
+	 * and lock-free.
+	 *
+	 * @return false if the queue is full
+	 */
+	bool Push(LogLevel level, const Domain &domain,
+		  std::string_view text, std::time_t time) noexcept {
+		std::size_t position =
+			push_position.load(std::memory_order_relaxed);
+		Slot *slot;
+
+		while (true) {
+			slot = &slots[position & mask];
+			const std::size_t sequence =
+				slot->sequence.load(std::memory_order_acquire);
+			const auto diff = std::ptrdiff_t(sequence - position);
+
+			if (diff == 0) {
+				/* this slot is free; claim it */
+				if (push_position.compare_exchange_weak(position, position + 1,
+									std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				/* the consumer has not yet freed this
+				   slot: the queue is full */
+				return false;
+			} else
+				/* another producer was faster */
+				position = push_position.load(std::memory_order_relaxed);
+		}
+
+		auto &m = slot->message;
+		m.domain = &domain;
+		m.time = time;
+		m.level = level;
+		m.length = std::min(text.size(), MAX_MESSAGE);
+		std::copy_n(text.data(), m.length, m.text);
+
+		/* publish the message to the consumer */
+		slot->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Pass the oldest message to the given function and remove
+	 * it from the queue.  Must be called only by the consumer
+	 * thread.
+	 *
+	 * @return false if the queue is empty
+	 */
+	template<typename F>
+	bool Pop(F &&f) noexcept {
+		Slot &slot = slots[pop_position & mask];
+		const std::size_t sequence =
+			slot.sequence.load(std::memory_order_acquire);
+		if (sequence != pop_position + 1)
+			/* empty (or the producer has not finished
+			   writing yet) */
+			return false;
+
+		f(std::as_const(slot.message));
+
+		/* free this slot for the producer one round later */
+		slot.sequence.store(pop_position + mask + 1,
+				    std::memory_order_release);
+		++pop_position;
+		return true;
+	}
+};
+
+#endif
@@ -29,15 +29,21 @@
 #include "Listen.hxx"
 #include "client/Config.hxx"
 #include "client/List.hxx"
+#include "client/BackgroundCommandPool.hxx"
+#include "TagScanPool.hxx"
+#include "client/Listener.hxx"
+#include "client/Thread.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "tag/Config.hxx"
 #include "IdleFlags.hxx"
 #include "Log.hxx"
 #include "LogInit.hxx"
+#include "PictureCache.hxx"
 #include "input/Init.hxx"
 #include "input/cache/Config.hxx"
 #include "input/cache/Manager.hxx"
+#include "metrics/Server.hxx"
 #include "event/Loop.hxx"
 #include "event/Call.hxx"
 #include "fs/AllocatedPath.hxx"
@@ -48,8 +54,10 @@
 #include "pcm/Convert.hxx"
 #include "unix/SignalHandlers.hxx"
 #include "thread/Slack.hxx"
+#include "net/AllocatedSocketAddress.hxx"
 #include "net/Init.hxx"
 #include "lib/icu/Init.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "config/Check.hxx"
 #include "config/Data.hxx"
 #include "config/Param.hxx"
@@ -59,7 +67,9 @@
 #include "config/Domain.hxx"
 #include "config/Parser.hxx"
 #include "config/PartitionConfig.hxx"
+#include "config/ThreadConfig.hxx"
 #include "util/ScopeExit.hxx"
+#include "util/StringAPI.hxx"
 
 #ifdef ENABLE_DAEMON
 #include "unix/Daemon.hxx"
@@ -75,6 +85,9 @@
 #ifdef ENABLE_INOTIFY
 #include "db/update/InotifyUpdate.hxx"
 #endif
+#ifdef ENABLE_FANOTIFY
+#include "db/update/FanotifyUpdate.hxx"
+#endif
 #endif
 
 #ifdef ENABLE_NEIGHBOR_PLUGINS
@@ -83,12 +96,22 @@
 
 #ifdef ENABLE_SQLITE
 #include "sticker/Database.hxx"
+#include "sticker/AnalysisStore.hxx"
+#include "song/StickerSongFilter.hxx"
 #endif
 
 #ifdef ENABLE_ARCHIVE
 #include "archive/ArchiveList.hxx"
 #endif
 
+#ifdef ENABLE_CURL
+#include "RemoteTagCache.hxx"
+#endif
+
+#ifdef ENABLE_CHROMAPRINT
+#include "FingerprintService.hxx"
+#endif
+
 #ifdef ANDROID
 #include "java/Global.hxx"
 #include "java/File.hxx"
@@ -182,9 +205,14 @@ InitStorage(Instance &instance, EventLoop &event_loop,
  * Returns the database.  If this function returns false, this has not
  * succeeded, and the caller should create the database after the
  * process has been daemonized.
+ *
+ * @param background if true, then the database is not opened here;
+ * the caller shall call Instance::StartLoadDatabase() after the
+ * process has been daemonized
  */
 static bool
-glue_db_init_and_load(Instance &instance, const ConfigData &config)
+glue_db_init_and_load(Instance &instance, const ConfigData &config,
+		      bool background)
 {
 	auto db = CreateConfiguredDatabase(config, instance.event_loop,
 					   instance.io_thread.GetEventLoop(),
@@ -209,31 +237,47 @@ glue_db_init_and_load(Instance &instance, const ConfigData &config)
 				  "because the database does not need it");
 	}
 
-	try {
-		db->Open();
-	} catch (...) {
-		std::throw_with_nested(std::runtime_error("Failed to open database plugin"));
+	auto *sdb = dynamic_cast<SimpleDatabase *>(db.get());
+
+	/* only the "simple" database plugin supports loading in
+	   the background; the others don't load anything */
+	if (sdb == nullptr)
+		background = false;
+
+	if (!background) {
+		try {
+			db->Open();
+		} catch (...) {
+			std::throw_with_nested(std::runtime_error("Failed to open database plugin"));
+		}
 	}
 
 	instance.database = std::move(db);
 
-	auto *sdb = dynamic_cast<SimpleDatabase *>(instance.database.get());
 	if (sdb == nullptr)
 		return true;
 
 	instance.update = new UpdateService(config,
 					    instance.event_loop, *sdb,
 					    static_cast<CompositeStorage &>(*instance.storage),
-					    instance);
+					    instance,
+					    instance.tag_scan_pool.get());
+
+	if (background)
+		/* Instance::OnDatabaseLoaded() decides whether the
+		   database needs to be created */
+		return true;
 
 	/* run database update after daemonization? */
 	return sdb->FileExists();
 }
 
 static bool
-InitDatabaseAndStorage(Instance &instance, const ConfigData &config)
+InitDatabaseAndStorage(Instance &instance, const ConfigData &config,
+		       bool background)
 {
-	const bool create_db = !glue_db_init_and_load(instance, config);
+	const bool create_db = !glue_db_init_and_load(instance, config,
+						      background);
 	return create_db;
 }
 
@@ -245,17 +289,107 @@ InitDatabaseAndStorage(Instance &instance, const ConfigData &config)
  * Configure and initialize the sticker subsystem.
  */
 static std::unique_ptr<StickerDatabase>
-LoadStickerDatabase(const ConfigData &config)
+LoadStickerDatabase(Instance &instance, const ConfigData &config)
 {
 	auto sticker_file = config.GetPath(ConfigOption::STICKER_FILE);
 	if (sticker_file.IsNull())
 		return nullptr;
 
-	return std::make_unique<StickerDatabase>(std::move(sticker_file));
+	const char *synchronous =
+		config.GetString(ConfigOption::STICKER_SYNCHRONOUS);
+	if (synchronous != nullptr &&
+	    !StringIsEqualIgnoreCase(synchronous, "off") &&
+	    !StringIsEqualIgnoreCase(synchronous, "normal") &&
+	    !StringIsEqualIgnoreCase(synchronous, "full") &&
+	    !StringIsEqualIgnoreCase(synchronous, "extra"))
+		throw FmtRuntimeError("Invalid sticker_synchronous value: {}",
+				      synchronous);
+
+	const auto commit_delay =
+		std::chrono::milliseconds(config.GetUnsigned(ConfigOption::STICKER_COMMIT_DELAY,
+							     0));
+
+	return std::make_unique<StickerDatabase>(instance.event_loop,
+						 std::move(sticker_file),
+						 synchronous, commit_delay);
 }
 
 #endif
 
+/**
+ * Start the HTTP server which exports metrics if "metrics_port" is
+ * configured.
+ *
+ * Throws on error.
+ */
+static void
+glue_metrics_init(Instance &instance, const ConfigData &raw_config)
+{
+	const unsigned port =
+		raw_config.GetPositive(ConfigOption::METRICS_PORT, 0);
+	if (port == 0)
+		return;
+
+	auto server = std::make_unique<MetricsServer>(instance.event_loop,
+						      instance);
+
+	const char *address =
+		raw_config.GetString(ConfigOption::METRICS_BIND_TO_ADDRESS);
+	if (address != nullptr && !StringIsEqual(address, "any"))
+		server->AddHost(address, port);
+	else
+		server->AddPort(port);
+
+	server->Open();
+	instance.metrics_server = std::move(server);
+}
+
+/**
+ * Enable the #EventLoopProfiler on all #EventLoop instances if
+ * "event_loop_profile" is enabled.  Must be called before the
+ * threads are started.
+ */
+static void
+glue_event_loop_profile_init(Instance &instance, const ConfigData &raw_config)
+{
+	if (!raw_config.GetBool(ConfigOption::EVENT_LOOP_PROFILE, false))
+		return;
+
+	const std::chrono::milliseconds slow_threshold{
+		raw_config.GetUnsigned(ConfigOption::EVENT_LOOP_SLOW_THRESHOLD,
+				       100)
+	};
+
+	instance.event_loop.EnableProfiler("main", slow_threshold);
+	instance.io_thread.GetEventLoop().EnableProfiler("io", slow_threshold);
+	instance.rtio_thread.GetEventLoop().EnableProfiler("rtio",
+							   slow_threshold);
+
+	for (auto &i : instance.client_threads)
+		i->GetEventLoop().EnableProfiler("client", slow_threshold);
+}
+
+static void
+glue_listen_init(Instance &instance, const ConfigData &raw_config)
+{
+	auto &partition = instance.partitions.front();
+	auto &listener = *partition.listener;
+
+	/* with "listen_reuseport", each ClientThread gets its own
+	   listener sockets on the TCP ports, and the kernel
+	   distributes new connections among them */
+	const bool reuse_port = !instance.client_threads.empty() &&
+		raw_config.GetBool(ConfigOption::LISTEN_REUSEPORT, false);
+	if (reuse_port)
+		listener.SetReusePort(true);
+
+	listen_global_init(raw_config, listener);
+
+	if (reuse_port)
+		for (auto &i : instance.client_threads)
+			i->Listen(partition, listener.BindReusePortClones());
+}
+
 static void
 glue_state_file_init(Instance &instance, const ConfigData &raw_config)
 {
@@ -293,6 +427,10 @@ inline void
 Instance::BeginShutdownUpdate() noexcept
 {
 #ifdef ENABLE_DATABASE
+#ifdef ENABLE_FANOTIFY
+	fanotify_update.reset();
+#endif
+
 #ifdef ENABLE_INOTIFY
 	inotify_update.reset();
 #endif
@@ -359,16 +497,42 @@ MainConfigured(const CommandLineOptions &options,
 		raw_config.GetPositive(ConfigOption::MAX_CONN, 100);
 	instance.client_list = std::make_unique<ClientList>(max_clients);
 
+	instance.background_command_pool =
+		std::make_unique<BackgroundCommandPool>(raw_config.GetPositive(ConfigOption::MAX_BACKGROUND_THREADS,
+									       4));
+
+	for (unsigned i = raw_config.GetUnsigned(ConfigOption::CLIENT_THREADS, 0);
+	     i > 0; --i)
+		instance.client_threads.emplace_back(std::make_unique<ClientThread>(instance));
+
 	const auto *input_cache_config = raw_config.GetBlock(ConfigBlockOption::INPUT_CACHE);
 	if (input_cache_config != nullptr) {
 		const InputCacheConfig c(*input_cache_config);
 		instance.input_cache = std::make_unique<InputCacheManager>(c);
 	}
 
+	const std::size_t picture_cache_size =
+		raw_config.With(ConfigOption::PICTURE_CACHE_SIZE, [](const char *s){
+			return s != nullptr
+				? ParseSize(s)
+				: std::size_t{16} * 1024 * 1024;
+		});
+	if (picture_cache_size > 0)
+		instance.picture_cache =
+			std::make_unique<PictureCache>(picture_cache_size);
+
+#ifdef ENABLE_CURL
+	instance.remote_tag_cache =
+		std::make_unique<RemoteTagCache>(instance.event_loop, instance,
+						 RemoteTagCacheConfig{raw_config});
+	instance.remote_tag_cache->Load();
+#endif
+
 	initialize_decoder_and_player(instance,
 				      raw_config, partition_config);
 
-	listen_global_init(raw_config, *instance.partitions.front().listener);
+	glue_listen_init(instance, raw_config);
+	glue_metrics_init(instance, raw_config);
 
 #ifdef ENABLE_DAEMON
 	daemonize_set_user();
@@ -376,6 +540,10 @@ MainConfigured(const CommandLineOptions &options,
 	AtScopeExit() { daemonize_finish(); };
 #endif
 
+	/* after daemonize_begin(), because mlockall() is not
+	   inherited by the forked process */
+	ThreadConfigInit(raw_config);
+
 	ConfigureFS(raw_config);
 	AtScopeExit() { DeinitFS(); };
 
@@ -388,15 +556,48 @@ MainConfigured(const CommandLineOptions &options,
 #endif
 
 	pcm_convert_global_init(raw_config);
+	AtScopeExit() { pcm_convert_global_finish(); };
 
 	const ScopeDecoderPluginsInit decoder_plugins_init(raw_config);
 
+	instance.tag_scan_pool =
+		std::make_unique<TagScanPool>(raw_config.GetPositive(ConfigOption::TAG_SCAN_THREADS,
+								     2));
+
 #ifdef ENABLE_DATABASE
-	const bool create_db = InitDatabaseAndStorage(instance, raw_config);
+	const bool background_db_load =
+		raw_config.GetBool(ConfigOption::BACKGROUND_DATABASE_LOAD,
+				   false);
+	const bool create_db = InitDatabaseAndStorage(instance, raw_config,
+						      background_db_load);
+#endif
+
+#ifdef ENABLE_SQLITE
+	instance.sticker_database = LoadStickerDatabase(instance, raw_config);
+	if (instance.sticker_database)
+		SetStickerValueSource(&instance.sticker_database->GetSongCache());
+
+	if (raw_config.GetBool(ConfigOption::SONG_ANALYSIS, false)) {
+		if (!instance.sticker_database)
+			throw std::runtime_error("song_analysis requires sticker_file");
+
+		instance.analysis_store =
+			std::make_unique<StickerAnalysisStore>(instance.event_loop,
+							       *instance.sticker_database);
+		for (auto &partition : instance.partitions)
+			partition.pc.SetAnalysisStore(instance.analysis_store.get());
+	}
 #endif
 
+#ifdef ENABLE_CHROMAPRINT
+	instance.fingerprint_service =
+		std::make_unique<FingerprintService>(instance.event_loop,
 #ifdef ENABLE_SQLITE
-	instance.sticker_database = LoadStickerDatabase(raw_config);
+						     instance.sticker_database.get(),
+#else
+						     nullptr,
+#endif
+						     raw_config.GetPositive(ConfigOption::FINGERPRINT_THREADS, 1));
 #endif
 
 	command_init();
@@ -434,9 +635,14 @@ MainConfigured(const CommandLineOptions &options,
 	const ScopeSignalHandlersInit signal_handlers_init(instance);
 #endif
 
+	glue_event_loop_profile_init(instance, raw_config);
+
 	instance.io_thread.Start();
 	instance.rtio_thread.Start();
 
+	for (auto &i : instance.client_threads)
+		i->Start();
+
 #ifdef ENABLE_NEIGHBOR_PLUGINS
 	if (instance.neighbors != nullptr)
 		instance.neighbors->Open();
@@ -474,6 +680,10 @@ MainConfigured(const CommandLineOptions &options,
 		/* the database failed to load: recreate the
 		   database */
 		instance.update->Enqueue("", true);
+	} else if (background_db_load && instance.update != nullptr) {
+		/* load the database while the state file is restored
+		   and clients are served */
+		instance.StartLoadDatabase();
 	}
 #endif
 
@@ -484,13 +694,33 @@ MainConfigured(const CommandLineOptions &options,
 #ifdef ENABLE_INOTIFY
 		if (instance.storage != nullptr &&
 		    instance.update != nullptr) {
+			const unsigned max_depth =
+				raw_config.GetUnsigned(ConfigOption::AUTO_UPDATE_DEPTH,
+						       INT_MAX);
+
+#ifdef ENABLE_FANOTIFY
+			/* prefer fanotify which needs only one mark
+			   for the whole music directory, but it
+			   requires privileges */
+			try {
+				instance.fanotify_update =
+					mpd_fanotify_init(instance.event_loop,
+							  *instance.storage,
+							  *instance.update,
+							  max_depth);
+			} catch (...) {
+				Log(LogLevel::DEBUG, std::current_exception(),
+				    "fanotify unavailable, falling back to inotify");
+			}
+
+			if (instance.fanotify_update == nullptr)
+#endif
 			try {
 				instance.inotify_update =
 					mpd_inotify_init(instance.event_loop,
 							 *instance.storage,
 							 *instance.update,
-							 raw_config.GetUnsigned(ConfigOption::AUTO_UPDATE_DEPTH,
-										INT_MAX));
+							 max_depth);
 			} catch (...) {
 				LogError(std::current_exception());
 			}
@@ -533,6 +763,12 @@ MainConfigured(const CommandLineOptions &options,
 	if (instance.state_file)
 		instance.state_file->Write();
 
+#ifdef ENABLE_CURL
+	if (instance.remote_tag_cache)
+		instance.remote_tag_cache->Save();
+#endif
+
+	instance.metrics_server.reset();
 	instance.BeginShutdownUpdate();
 	instance.BeginShutdownPartitions();
 }
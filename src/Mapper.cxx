@@ -69,15 +69,7 @@ map_uri_fs(const char *uri) noexcept
 	if (global_instance->storage == nullptr)
 		return nullptr;
 
-	const auto music_dir_fs = global_instance->storage->MapFS("");
-	if (music_dir_fs.IsNull())
-		return nullptr;
-
-	const auto uri_fs = AllocatedPath::FromUTF8(uri);
-	if (uri_fs.IsNull())
-		return nullptr;
-
-	return music_dir_fs / uri_fs;
+	return global_instance->storage->MapFS(uri);
 }
 
 std::string
@@ -19,20 +19,72 @@
 
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
 
 #include <cassert>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks)
+static constexpr Domain music_buffer_domain("music_buffer");
+
+MusicBuffer::MusicBuffer(unsigned num_chunks, std::size_t _chunk_size,
+			 const MusicBufferOptions &options)
+	:chunk_size(_chunk_size),
+	 buffer(num_chunks),
+	 data(buffer.GetCapacity() * chunk_size, options.huge_tlb),
+	 keep_resident(options.KeepResident())
 {
+	assert(chunk_size >= MIN_CHUNK_SIZE);
+	assert(chunk_size <= MAX_CHUNK_SIZE);
+
 	buffer.SetName("MusicBuffer");
+	data.ForkCow(false);
+	data.SetName("MusicBuffer");
+
+	/* all of these are optimizations; failures are logged, but
+	   are not fatal */
+
+	if (options.numa_node >= 0) {
+		/* must be done before the pages get faulted in */
+		try {
+			buffer.BindNode(options.numa_node);
+			data.BindNode(options.numa_node);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to bind the audio buffer to the NUMA node");
+		}
+	}
+
+	if (options.lock) {
+		/* mlock() faults in all pages implicitly */
+		try {
+			buffer.Lock();
+			data.Lock();
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to lock the audio buffer");
+			buffer.Prefault();
+			data.Prefault();
+		}
+	} else if (options.prefault) {
+		buffer.Prefault();
+		data.Prefault();
+	}
+
+	buffer.SetKeepResident(keep_resident);
 }
 
 MusicChunkPtr
 MusicBuffer::Allocate() noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
-	return {buffer.Allocate(), MusicChunkDeleter(*this)};
+
+	MusicChunk *chunk = buffer.Allocate();
+	if (chunk != nullptr) {
+		chunk->data = &data[buffer.IndexOf(chunk) * chunk_size];
+		chunk->capacity = chunk_size;
+	}
+
+	return {chunk, MusicChunkDeleter(*this)};
 }
 
 void
@@ -40,10 +92,9 @@ MusicBuffer::Return(MusicChunk *chunk) noexcept
 {
 	assert(chunk != nullptr);
 
-	/* these attributes need to be cleared before locking the
-	   mutex, because they might recursively call this method,
+	/* this attribute needs to be cleared before locking the
+	   mutex, because it might recursively call this method,
 	   causing a deadlock */
-	chunk->next.reset();
 	chunk->other.reset();
 
 	const std::scoped_lock<Mutex> protect(mutex);
@@ -51,4 +102,10 @@ MusicBuffer::Return(MusicChunk *chunk) noexcept
 	assert(!chunk->other || !chunk->other->other);
 
 	buffer.Free(chunk);
+
+	/* give the data memory back to the kernel when the last
+	   chunk was freed (SliceBuffer does the same with the
+	   headers) */
+	if (buffer.empty() && !keep_resident)
+		data.Discard();
 }
@@ -20,6 +20,7 @@
 #ifndef MPD_MUSIC_BUFFER_HXX
 #define MPD_MUSIC_BUFFER_HXX
 
+#include "MusicBufferOptions.hxx"
 #include "MusicChunk.hxx"
 #include "MusicChunkPtr.hxx"
 #include "util/SliceBuffer.hxx"
@@ -32,16 +33,32 @@ class MusicBuffer {
 	/** a mutex which protects #buffer */
 	mutable Mutex mutex;
 
+	/** the size of the data buffer of each chunk */
+	const std::size_t chunk_size;
+
+	/** the #MusicChunk headers */
 	SliceBuffer<MusicChunk> buffer;
 
+	/**
+	 * The data buffers of all chunks; the chunk at index i in
+	 * #buffer owns the bytes at i*#chunk_size.
+	 */
+	HugeArray<std::byte> data;
+
+	/** see MusicBufferOptions::KeepResident() */
+	const bool keep_resident;
+
 public:
 	/**
 	 * Creates a new #MusicBuffer object.
 	 *
 	 * @param num_chunks the number of #MusicChunk reserved in
 	 * this buffer
+	 * @param chunk_size the size of the data buffer of each chunk
 	 */
-	explicit MusicBuffer(unsigned num_chunks);
+	explicit MusicBuffer(unsigned num_chunks,
+			     std::size_t chunk_size=CHUNK_SIZE,
+			     const MusicBufferOptions &options={});
 
 #ifndef NDEBUG
 	/**
@@ -69,6 +86,13 @@ public:
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the size of the data buffer of each chunk.
+	 */
+	std::size_t GetChunkSize() const noexcept {
+		return chunk_size;
+	}
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_MUSIC_BUFFER_OPTIONS_HXX
+#define MPD_MUSIC_BUFFER_OPTIONS_HXX
+
+/**
+ * Tuning options for the memory allocation of a #MusicBuffer.
+ */
+struct MusicBufferOptions {
+	/**
+	 * Attempt to allocate the chunk data from explicit huge
+	 * pages (MAP_HUGETLB).
+	 */
+	bool huge_tlb = false;
+
+	/**
+	 * Fault in all pages at construction time.
+	 */
+	bool prefault = false;
+
+	/**
+	 * Lock all pages into physical memory.  Implies #prefault.
+	 */
+	bool lock = false;
+
+	/**
+	 * Bind the memory to this NUMA node; -1 means no binding.
+	 */
+	int numa_node = -1;
+
+	/**
+	 * Shall the memory stay resident even when the buffer is
+	 * empty?
+	 */
+	constexpr bool KeepResident() const noexcept {
+		return prefault || lock;
+	}
+};
+
+#endif
@@ -28,23 +28,45 @@
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <span>
 
+/**
+ * The default size of the data buffer of a #MusicChunk.
+ */
 static constexpr size_t CHUNK_SIZE = 4096;
 
+/**
+ * The allowed range for the "audio_buffer_chunk_size" setting.  The
+ * maximum is limited by the 16 bit MusicChunkInfo::length field.
+ */
+static constexpr size_t MIN_CHUNK_SIZE = 1024;
+static constexpr size_t MAX_CHUNK_SIZE = 32768;
+
 struct AudioFormat;
 struct Tag;
 struct MusicChunk;
 
+/**
+ * The link of a #MusicChunk inside a #MusicPipe.  This is a separate
+ * base class because #MusicPipe needs a "stub" link which is not a
+ * #MusicChunk.
+ */
+struct MusicPipeLink {
+	/**
+	 * The next link in the #MusicPipe; the pipe owns the chunks
+	 * it links to.  Use MusicPipe::GetNext() to traverse.
+	 */
+	std::atomic<MusicPipeLink *> next{nullptr};
+};
+
 /**
  * Meta information for #MusicChunk.
  */
-struct MusicChunkInfo {
-	/** the next chunk in a linked list */
-	MusicChunkPtr next;
+struct MusicChunkInfo : MusicPipeLink {
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -54,9 +76,11 @@ struct MusicChunkInfo {
 
 	/**
 	 * An optional tag associated with this chunk (and the
-	 * following chunks); appears at song boundaries.
+	 * following chunks); appears at song boundaries.  It is
+	 * immutable and may be shared with other chunks and with
+	 * the decoder.
 	 */
-	std::unique_ptr<Tag> tag;
+	std::shared_ptr<const Tag> tag;
 
 	/**
 	 * The current mix ratio for cross-fading: 1.0 means play 100%
@@ -64,6 +88,13 @@ struct MusicChunkInfo {
 	 */
 	float mix_ratio;
 
+	/**
+	 * The mix ratio after the last frame of this chunk; the
+	 * ratio changes linearly from #mix_ratio to this value
+	 * within the chunk.  Ignored if #mix_ratio is negative.
+	 */
+	float mix_ratio_end;
+
 	/** number of bytes stored in this chunk */
 	uint16_t length = 0;
 
@@ -115,8 +146,22 @@ struct MusicChunkInfo {
  * MusicPipe::Push() caller.
  */
 struct MusicChunk : MusicChunkInfo {
-	/** the data (probably PCM) */
-	std::byte data[CHUNK_SIZE - sizeof(MusicChunkInfo)];
+	/**
+	 * The data (probably PCM).  This points into an array owned
+	 * by the #MusicBuffer, which keeps the chunk headers compact
+	 * and allows choosing the chunk size at runtime.
+	 */
+	std::byte *data = nullptr;
+
+	/** the size of the #data buffer */
+	std::size_t capacity = 0;
+
+	/**
+	 * Returns the maximum number of bytes this chunk can hold.
+	 */
+	std::size_t GetCapacity() const noexcept {
+		return capacity;
+	}
 
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
@@ -145,6 +190,4 @@ struct MusicChunk : MusicChunkInfo {
 	bool Expand(AudioFormat af, size_t length) noexcept;
 };
 
-static_assert(sizeof(MusicChunk) == CHUNK_SIZE, "Wrong size");
-
 #endif
@@ -21,15 +21,14 @@
 #include "MusicChunk.hxx"
 
 #include <cassert>
+#include <thread>
 
 #ifndef NDEBUG
 
 bool
 MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 {
-	const std::scoped_lock<Mutex> protect(mutex);
-
-	for (const MusicChunk *i = head.get(); i != nullptr; i = i->next.get())
+	for (const MusicChunk *i = Peek(); i != nullptr; i = GetNext(*i))
 		if (i == chunk)
 			return true;
 
@@ -38,35 +37,65 @@ MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 
 #endif
 
+inline void
+MusicPipe::PushLink(MusicPipeLink &link) noexcept
+{
+	link.next.store(nullptr, std::memory_order_relaxed);
+
+	MusicPipeLink *prev = tail.exchange(&link, std::memory_order_acq_rel);
+
+	/* between the exchange() and this store(), the list is
+	   temporarily disconnected; Shift() waits for this store if
+	   it gets there */
+	prev->next.store(&link, std::memory_order_release);
+}
+
 MusicChunkPtr
 MusicPipe::Shift() noexcept
 {
-	const std::scoped_lock<Mutex> protect(mutex);
-
-	auto chunk = std::move(head);
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
+	MusicPipeLink *first = head.load(std::memory_order_relaxed);
+	MusicPipeLink *next = first->next.load(std::memory_order_acquire);
+
+	if (first == &stub) {
+		if (next == nullptr)
+			/* empty */
+			return nullptr;
+
+		/* skip the stub */
+		head.store(next, std::memory_order_release);
+		first = next;
+		next = first->next.load(std::memory_order_acquire);
+	}
 
-		head = std::move(chunk->next);
-		--size;
+	if (next == nullptr) {
+		/* this is the last chunk; insert the stub after it,
+		   so the producer never needs to touch a link that
+		   has already been removed */
+		if (tail.load(std::memory_order_acquire) == first)
+			PushLink(stub);
+
+		/* wait for the store() in PushLink(), which may have
+		   been called by the producer (which then needs to
+		   be scheduled again) or by us */
+		while ((next = first->next.load(std::memory_order_acquire)) == nullptr)
+			std::this_thread::yield();
+	}
 
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+	head.store(next, std::memory_order_release);
 
-			tail_r = &head;
-		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
-		}
+	auto *chunk = static_cast<MusicChunk *>(first);
+	assert(!chunk->IsEmpty());
 
 #ifndef NDEBUG
-		if (size == 0)
-			audio_format.Clear();
-#endif
+	if (size.fetch_sub(1, std::memory_order_release) == 1) {
+		const std::scoped_lock<Mutex> protect(mutex);
+		audio_format.Clear();
 	}
+#else
+	size.fetch_sub(1, std::memory_order_release);
+#endif
 
-	return chunk;
+	return {chunk, deleter};
 }
 
 void
@@ -81,20 +110,26 @@ MusicPipe::Push(MusicChunkPtr chunk) noexcept
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
 
-	const std::scoped_lock<Mutex> protect(mutex);
+#ifndef NDEBUG
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
 
-	assert(size > 0 || !audio_format.IsDefined());
-	assert(!audio_format.IsDefined() ||
-	       chunk->CheckFormat(audio_format));
+		assert(!audio_format.IsDefined() ||
+		       chunk->CheckFormat(audio_format));
 
-#ifndef NDEBUG
-	if (!audio_format.IsDefined() && chunk->length > 0)
-		audio_format = chunk->audio_format;
+		if (!audio_format.IsDefined() && chunk->length > 0)
+			audio_format = chunk->audio_format;
+	}
 #endif
 
-	chunk->next.reset();
-	*tail_r = std::move(chunk);
-	tail_r = &(*tail_r)->next;
+	if (!have_deleter) {
+		deleter = chunk.get_deleter();
+		have_deleter = true;
+	}
+
+	/* increment the counter first, so GetSize() never reports
+	   less than what Peek() can see */
+	size.fetch_add(1, std::memory_order_relaxed);
 
-	++size;
+	PushLink(*chunk.release());
 }
@@ -20,39 +20,79 @@
 #ifndef MPD_PIPE_H
 #define MPD_PIPE_H
 
-#include "MusicChunkPtr.hxx"
-#include "thread/Mutex.hxx"
+#include "MusicChunk.hxx"
 
 #ifndef NDEBUG
+#include "thread/Mutex.hxx"
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 /**
  * A queue of #MusicChunk objects.  One party appends chunks at the
  * tail, and the other consumes them from the head.
+ *
+ * This is a lock-free intrusive linked list (based on Dmitry
+ * Vyukov's MPSC queue): Push() may be called by the producer thread
+ * while Shift() is called by the consumer thread.  A "stub" link
+ * which is not a #MusicChunk keeps the list from ever becoming
+ * empty, so the two never modify the same link.  Other threads may
+ * call Peek() and GetNext() on chunks they know are still in the
+ * pipe.
  */
 class MusicPipe {
-	/** the first chunk */
-	MusicChunkPtr head;
+	/**
+	 * A dummy link which is inserted whenever the consumer would
+	 * remove the last chunk.
+	 */
+	MusicPipeLink stub;
 
-	/** a pointer to the tail of the chunk */
-	MusicChunkPtr *tail_r = &head;
+	/**
+	 * The first link; only modified by the consumer.
+	 */
+	std::atomic<MusicPipeLink *> head{&stub};
+
+	/**
+	 * The last link; modified by Push() (and by Shift() when it
+	 * re-inserts the #stub).
+	 */
+	std::atomic<MusicPipeLink *> tail{&stub};
 
 	/** the current number of chunks */
-	unsigned size = 0;
+	std::atomic_uint size{0};
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * The deleter of the chunks in this pipe, copied from the
+	 * first MusicChunkPtr passed to Push(); all chunks in a pipe
+	 * come from the same #MusicBuffer.
+	 */
+	MusicChunkDeleter deleter;
+
+	/**
+	 * Has #deleter been initialized?  Only accessed by the
+	 * producer; the consumer will see #deleter because it has
+	 * seen a chunk pushed after it was set.
+	 */
+	bool have_deleter = false;
 
 #ifndef NDEBUG
+	/** a mutex which protects #audio_format */
+	mutable Mutex mutex;
+
 	AudioFormat audio_format = AudioFormat::Undefined();
 #endif
 
 public:
+	MusicPipe() = default;
+
 	~MusicPipe() noexcept {
 		Clear();
 	}
 
+	MusicPipe(const MusicPipe &) = delete;
+	MusicPipe &operator=(const MusicPipe &) = delete;
+
 #ifndef NDEBUG
 	/**
 	 * Checks if the audio format if the chunk is equal to the specified
@@ -60,6 +100,7 @@ public:
 	 */
 	[[gnu::pure]]
 	bool CheckFormat(AudioFormat other) const noexcept {
+		const std::scoped_lock<Mutex> protect(mutex);
 		return !audio_format.IsDefined() ||
 			audio_format == other;
 	}
@@ -77,8 +118,16 @@ public:
 	 */
 	[[gnu::pure]]
 	const MusicChunk *Peek() const noexcept {
-		const std::scoped_lock<Mutex> protect(mutex);
-		return head.get();
+		return SkipStub(head.load(std::memory_order_acquire));
+	}
+
+	/**
+	 * Returns the chunk following the given one (which must be
+	 * in this pipe), or nullptr if it is the last one.
+	 */
+	[[gnu::pure]]
+	const MusicChunk *GetNext(const MusicChunk &chunk) const noexcept {
+		return SkipStub(chunk.next.load(std::memory_order_acquire));
 	}
 
 	/**
@@ -101,14 +150,23 @@ public:
 	 */
 	[[gnu::pure]]
 	unsigned GetSize() const noexcept {
-		const std::scoped_lock<Mutex> protect(mutex);
-		return size;
+		return size.load(std::memory_order_acquire);
 	}
 
 	[[gnu::pure]]
 	bool IsEmpty() const noexcept {
 		return GetSize() == 0;
 	}
+
+private:
+	const MusicChunk *SkipStub(const MusicPipeLink *link) const noexcept {
+		if (link == &stub)
+			link = stub.next.load(std::memory_order_acquire);
+
+		return static_cast<const MusicChunk *>(link);
+	}
+
+	void PushLink(MusicPipeLink &link) noexcept;
 };
 
 #endif
@@ -20,17 +20,16 @@
 #include "config.h"
 #include "Partition.hxx"
 #include "Instance.hxx"
-#include "Log.hxx"
 #include "config/PartitionConfig.hxx"
-#include "lib/fmt/ExceptionFormatter.hxx"
 #include "song/DetachedSong.hxx"
 #include "IdleFlags.hxx"
 #include "client/Listener.hxx"
 #include "client/Client.hxx"
 #include "input/cache/Manager.hxx"
-#include "util/Domain.hxx"
+#include "Log.hxx"
 
-static constexpr Domain cache_domain("cache");
+#include <string>
+#include <vector>
 
 Partition::Partition(Instance &_instance,
 		     const char *_name,
@@ -41,12 +40,19 @@ Partition::Partition(Instance &_instance,
 	 listener(new ClientListener(instance.event_loop, *this)),
 	 idle_monitor(instance.event_loop, BIND_THIS_METHOD(OnIdleMonitor)),
 	 global_events(instance.event_loop, BIND_THIS_METHOD(OnGlobalEvent)),
+	 player_idle_timer(instance.event_loop,
+			   BIND_THIS_METHOD(OnPlayerIdleTimer)),
+	 volume_timer(instance.event_loop, BIND_THIS_METHOD(OnVolumeTimer)),
 	 playlist(config.queue.max_length, *this),
 	 outputs(pc, *this),
 	 pc(*this, outputs,
 	    instance.input_cache.get(),
 	    config.player)
 {
+#ifdef ENABLE_SQLITE
+	pc.SetAnalysisStore(instance.analysis_store.get());
+#endif
+
 	UpdateEffectiveReplayGainMode();
 }
 
@@ -55,33 +61,11 @@ Partition::~Partition() noexcept = default;
 void
 Partition::BeginShutdown() noexcept
 {
+	player_idle_timer.Cancel();
 	pc.Kill();
 	listener.reset();
 }
 
-static void
-PrefetchSong(InputCacheManager &cache, const char *uri) noexcept
-{
-	if (cache.Contains(uri))
-		return;
-
-	FmtDebug(cache_domain, "Prefetch '{}'", uri);
-
-	try {
-		cache.Prefetch(uri);
-	} catch (...) {
-		FmtError(cache_domain,
-			 "Prefetch '{}' failed: {}",
-			 uri, std::current_exception());
-	}
-}
-
-static void
-PrefetchSong(InputCacheManager &cache, const DetachedSong &song) noexcept
-{
-	PrefetchSong(cache, song.GetURI());
-}
-
 inline void
 Partition::PrefetchQueue() noexcept
 {
@@ -90,11 +74,31 @@ Partition::PrefetchQueue() noexcept
 
 	auto &cache = *instance.input_cache;
 
-	int next = playlist.GetNextPosition();
-	if (next >= 0)
-		PrefetchSong(cache, playlist.queue.Get(next));
+	const auto &queue = playlist.queue;
+
+	std::vector<std::string> uris;
+
+	/* follow the song order (which respects "random", "repeat"
+	   and priorities) from the next song; stop when wrapping
+	   around to the current or the first prefetched song */
+	if (int next = playlist.GetNextPosition(); next >= 0) {
+		const int first = queue.PositionToOrder(next);
+		int order = first;
+		for (unsigned n = cache.GetPrefetchCount(); n > 0; --n) {
+			/* the real URI is what the decoder will open */
+			uris.emplace_back(queue.GetOrder(order).GetRealURI());
+
+			order = queue.GetNextOrder(order);
+			if (order < 0 || order == first ||
+			    order == playlist.current)
+				break;
+		}
+	}
 
-	// TODO: prefetch more songs
+	/* this replaces the previous list and cancels obsolete
+	   prefetch operations; the files are loaded by the cache's
+	   own thread */
+	cache.SetPrefetch(std::move(uris));
 }
 
 void
@@ -108,7 +112,11 @@ Partition::UpdateEffectiveReplayGainMode() noexcept
 
 	pc.LockSetReplayGainMode(mode);
 
-	outputs.SetReplayGainMode(mode);
+	/* if the decoder applies ReplayGain, the outputs must not
+	   apply it again */
+	outputs.SetReplayGainMode(pc.IsReplayGainInDecoder()
+				  ? ReplayGainMode::OFF
+				  : mode);
 }
 
 #ifdef ENABLE_DATABASE
@@ -153,8 +161,6 @@ Partition::SyncWithPlayer() noexcept
 {
 	playlist.SyncWithPlayer(pc);
 
-	/* TODO: invoke this function in batches, to let the hard disk
-	   spin down in between */
 	PrefetchQueue();
 }
 
@@ -168,12 +174,14 @@ void
 Partition::OnQueueModified() noexcept
 {
 	EmitIdle(IDLE_PLAYLIST);
+	PrefetchQueue();
 }
 
 void
 Partition::OnQueueOptionsChanged() noexcept
 {
 	EmitIdle(IDLE_OPTIONS);
+	PrefetchQueue();
 }
 
 void
@@ -246,8 +254,36 @@ Partition::OnIdleMonitor(unsigned mask) noexcept
 	for (auto &client : clients)
 		client.IdleAdd(mask);
 
+	++status_version;
+	for (unsigned i = 0; i < idle_versions.size(); ++i)
+		if (mask & (1U << i))
+			idle_versions[i] = status_version;
+
 	if (mask & (IDLE_PLAYLIST|IDLE_PLAYER|IDLE_MIXER|IDLE_OUTPUT))
 		instance.OnStateModified();
+
+	/* (re)start the idle timeout after each player state
+	   change; OnPlayerIdleTimer() checks whether the player is
+	   really stopped */
+	if ((mask & IDLE_PLAYER) != 0 &&
+	    config.player.idle_timeout > std::chrono::steady_clock::duration::zero())
+		player_idle_timer.Schedule(config.player.idle_timeout);
+}
+
+unsigned
+Partition::GetIdleSince(unsigned version) const noexcept
+{
+	if (version == 0 || version > status_version)
+		/* the client doesn't know anything, or it has
+		   obtained the version from an earlier MPD process */
+		return ~0U;
+
+	unsigned mask = 0;
+	for (unsigned i = 0; i < idle_versions.size(); ++i)
+		if (idle_versions[i] > version)
+			mask |= 1U << i;
+
+	return mask;
 }
 
 void
@@ -262,3 +298,53 @@ Partition::OnGlobalEvent(unsigned mask) noexcept
 	if ((mask & BORDER_PAUSE) != 0)
 		BorderPause();
 }
+
+void
+Partition::OnPlayerIdleTimer() noexcept
+{
+	if (playlist.playing)
+		/* the playlist may still want to queue songs; wait
+		   for the next state change */
+		return;
+
+	pc.LockSuspend();
+}
+
+void
+Partition::SetVolume(unsigned volume)
+{
+	const auto window = config.volume_coalesce_window;
+
+	if (volume_timer.IsPending()) {
+		/* the volume was changed only recently; postpone
+		   this change until the window ends */
+		mixer_memento.SetPendingVolume(volume);
+		return;
+	}
+
+	mixer_memento.SetVolume(outputs, volume);
+	EmitIdle(IDLE_MIXER);
+
+	if (window > std::chrono::steady_clock::duration::zero())
+		volume_timer.Schedule(window);
+}
+
+void
+Partition::OnVolumeTimer() noexcept
+{
+	if (!mixer_memento.HasPendingVolume())
+		return;
+
+	try {
+		mixer_memento.CommitPendingVolume(outputs);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to set the volume");
+	}
+
+	EmitIdle(IDLE_MIXER);
+
+	/* keep merging changes while the volume is still being
+	   changed */
+	volume_timer.Schedule(config.volume_coalesce_window);
+}
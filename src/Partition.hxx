@@ -21,6 +21,7 @@
 #define MPD_PARTITION_HXX
 
 #include "event/MaskMonitor.hxx"
+#include "event/CoarseTimerEvent.hxx"
 #include "queue/Playlist.hxx"
 #include "queue/Listener.hxx"
 #include "output/MultipleOutputs.hxx"
@@ -29,6 +30,7 @@
 #include "player/Control.hxx"
 #include "player/Listener.hxx"
 #include "protocol/RangeArg.hxx"
+#include "client/Channels.hxx"
 #include "util/IntrusiveList.hxx"
 #include "ReplayGainMode.hxx"
 #include "SingleMode.hxx"
@@ -36,6 +38,7 @@
 #include "Chrono.hxx"
 #include "config.h"
 
+#include <array>
 #include <string>
 #include <memory>
 
@@ -67,6 +70,11 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 
 	IntrusiveList<Client, ClientPerPartitionListHook, false> clients;
 
+	/**
+	 * The channel subscriptions of all #clients.
+	 */
+	ClientChannels channels;
+
 	/**
 	 * Monitor for idle events local to this partition.
 	 */
@@ -74,6 +82,18 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 
 	MaskMonitor global_events;
 
+	/**
+	 * Suspends the player thread after it has been stopped for
+	 * PlayerConfig::idle_timeout.
+	 */
+	CoarseTimerEvent player_idle_timer;
+
+	/**
+	 * Applies volume changes which were postponed during the
+	 * "volume_coalesce_window".
+	 */
+	CoarseTimerEvent volume_timer;
+
 	struct playlist playlist;
 
 	MultipleOutputs outputs;
@@ -84,6 +104,19 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 
 	ReplayGainMode replay_gain_mode = ReplayGainMode::OFF;
 
+	/**
+	 * Incremented by OnIdleMonitor() for each batch of idle
+	 * events.  This is the version number reported by
+	 * "statusdelta".
+	 */
+	unsigned status_version = 1;
+
+	/**
+	 * The #status_version at which each idle flag (indexed by
+	 * its bit number) was last emitted.
+	 */
+	std::array<unsigned, 16> idle_versions{};
+
 	Partition(Instance &_instance,
 		  const char *_name,
 		  const PartitionConfig &_config) noexcept;
@@ -105,6 +138,25 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 		idle_monitor.OrMask(mask);
 	}
 
+	/**
+	 * Returns the mask of idle flags which have been emitted
+	 * after the given #status_version.  If the version is 0 or
+	 * unknown, all flags are returned.
+	 */
+	[[gnu::pure]]
+	unsigned GetIdleSince(unsigned version) const noexcept;
+
+	/**
+	 * Set the volume of all outputs (see
+	 * MixerMemento::SetVolume()) and emit #IDLE_MIXER.  Within
+	 * the "volume_coalesce_window" after a change, the new level
+	 * is only remembered and applied when the window ends, so
+	 * a burst of changes causes only few mixer updates.
+	 *
+	 * Throws on error (unless the change was postponed).
+	 */
+	void SetVolume(unsigned volume);
+
 	/**
 	 * Populate the #InputCacheManager with soon-to-be-played song
 	 * files.
@@ -294,6 +346,12 @@ private:
 
 	/* callback for #global_events */
 	void OnGlobalEvent(unsigned mask) noexcept;
+
+	/* callback for #player_idle_timer */
+	void OnPlayerIdleTimer() noexcept;
+
+	/* callback for #volume_timer */
+	void OnVolumeTimer() noexcept;
 };
 
 #endif
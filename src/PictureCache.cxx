@@ -0,0 +1,83 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PictureCache.hxx"
+#include "util/DeleteDisposer.hxx"
+
+PictureCache::~PictureCache() noexcept
+{
+	lru.clear();
+	map.clear_and_dispose(DeleteDisposer());
+}
+
+inline void
+PictureCache::Remove(Item &item) noexcept
+{
+	total_size -= item.picture->data.size();
+	lru.erase(lru.iterator_to(item));
+	map.erase(map.iterator_to(item));
+	delete &item;
+}
+
+CachedPicturePtr
+PictureCache::Get(std::string_view key,
+		  std::chrono::system_clock::time_point mtime) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	auto i = map.find(key);
+	if (i == map.end())
+		return nullptr;
+
+	auto &item = *i;
+	if (item.mtime != mtime) {
+		/* the source has been modified */
+		Remove(item);
+		return nullptr;
+	}
+
+	/* move to the end of the LRU list */
+	lru.erase(lru.iterator_to(item));
+	lru.push_back(item);
+
+	return item.picture;
+}
+
+void
+PictureCache::Put(std::string_view key,
+		  std::chrono::system_clock::time_point mtime,
+		  CachedPicturePtr picture) noexcept
+{
+	const std::size_t size = picture->data.size();
+	if (!IsEligible(size))
+		return;
+
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	if (auto i = map.find(key); i != map.end())
+		Remove(*i);
+
+	while (total_size + size > max_size && !lru.empty())
+		Remove(lru.front());
+
+	auto *item = new Item(key, mtime, std::move(picture));
+	map.insert(*item);
+	lru.push_back(*item);
+	total_size += size;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PICTURE_CACHE_HXX
+#define MPD_PICTURE_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/IntrusiveHashSet.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * A picture loaded by "albumart" or "readpicture".
+ */
+struct CachedPicture {
+	/**
+	 * The MIME type (may be empty if unknown).
+	 */
+	std::string mime_type;
+
+	AllocatedArray<std::byte> data;
+};
+
+using CachedPicturePtr = std::shared_ptr<const CachedPicture>;
+
+/**
+ * A size-bounded LRU cache for cover art, so clients which fetch many
+ * covers in chunks do not reopen and rescan the source file for
+ * each chunk.  Each item remembers the modification time of its
+ * source; a lookup with a different time is a miss.
+ *
+ * This class is thread-safe.
+ */
+class PictureCache final {
+	const std::size_t max_size;
+
+	Mutex mutex;
+
+	std::size_t total_size = 0;
+
+	struct Item final
+		: IntrusiveHashSetHook<>,
+		  IntrusiveListHook<>
+	{
+		const std::string key;
+
+		const std::chrono::system_clock::time_point mtime;
+
+		const CachedPicturePtr picture;
+
+		Item(std::string_view _key,
+		     std::chrono::system_clock::time_point _mtime,
+		     CachedPicturePtr &&_picture) noexcept
+			:key(_key), mtime(_mtime), picture(std::move(_picture)) {}
+
+		struct Hash : std::hash<std::string_view> {
+			using std::hash<std::string_view>::operator();
+
+			[[gnu::pure]]
+			std::size_t operator()(const Item &item) const noexcept {
+				return std::hash<std::string_view>::operator()(item.key);
+			}
+		};
+
+		struct Equal {
+			[[gnu::pure]]
+			bool operator()(const Item &a,
+					const Item &b) const noexcept {
+				return a.key == b.key;
+			}
+
+			[[gnu::pure]]
+			bool operator()(std::string_view a,
+					const Item &b) const noexcept {
+				return a == b.key;
+			}
+		};
+	};
+
+	/**
+	 * All items; the least recently used one comes first.
+	 */
+	IntrusiveList<Item> lru;
+
+	IntrusiveHashSet<Item, 127, Item::Hash, Item::Equal,
+			 IntrusiveHashSetBaseHookTraits<Item>,
+			 true> map;
+
+public:
+	/**
+	 * @param _max_size the maximum total size of all pictures
+	 * in bytes
+	 */
+	explicit PictureCache(std::size_t _max_size) noexcept
+		:max_size(_max_size) {}
+
+	~PictureCache() noexcept;
+
+	PictureCache(const PictureCache &) = delete;
+	PictureCache &operator=(const PictureCache &) = delete;
+
+	/**
+	 * May a picture of this size be stored?  Large pictures are
+	 * rejected, because they would evict too many others.
+	 */
+	bool IsEligible(std::size_t size) const noexcept {
+		return size <= max_size / 8;
+	}
+
+	/**
+	 * Look up a picture.
+	 *
+	 * @param key the identity of the picture (e.g. a path)
+	 * @param mtime the current modification time of the source;
+	 * if it does not match the cached one, the item is discarded
+	 * @return the picture or nullptr if not cached
+	 */
+	CachedPicturePtr Get(std::string_view key,
+			     std::chrono::system_clock::time_point mtime) noexcept;
+
+	/**
+	 * Add a picture to the cache, replacing an existing one with
+	 * the same key.  It is ignored if not IsEligible().
+	 */
+	void Put(std::string_view key,
+		 std::chrono::system_clock::time_point mtime,
+		 CachedPicturePtr picture) noexcept;
+
+private:
+	void Remove(Item &item) noexcept;
+};
+
+#endif
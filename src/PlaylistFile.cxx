@@ -40,17 +40,84 @@
 #include "fs/FileSystem.hxx"
 #include "fs/FileInfo.hxx"
 #include "fs/DirectoryReader.hxx"
+#include "io/FileReader.hxx"
+#include "thread/Mutex.hxx"
+#include "util/CharUtil.hxx"
 #include "util/StringCompare.hxx"
 #include "util/UriExtract.hxx"
 
 #include <cassert>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
 
 static const char PLAYLIST_COMMENT = '#';
 
 static unsigned playlist_max_length;
 bool playlist_saveAbsolutePaths = DEFAULT_PLAYLIST_SAVE_ABSOLUTE_PATHS;
 
+/**
+ * A parsed stored playlist file in the #spl_cache.
+ */
+struct CachedPlaylistFile {
+	/**
+	 * The file's modification time and size when it was
+	 * parsed; if either differs, this item is stale.
+	 */
+	std::chrono::system_clock::time_point mtime;
+	uint64_t size;
+
+	std::shared_ptr<const PlaylistFileContents> contents;
+
+	/**
+	 * True if every line of the file is a song URI which
+	 * LoadPlaylistFile() accepted as-is, i.e. #contents is
+	 * exactly what the "m3u" playlist plugin would return.
+	 */
+	bool plain;
+
+	/**
+	 * The value of #spl_cache_clock when this item was last
+	 * used; for evicting the least recently used item.
+	 */
+	unsigned long last_used;
+};
+
+/**
+ * Never cache more than this number of stored playlist files.
+ */
+static constexpr std::size_t SPL_CACHE_MAX = 256;
+
+/**
+ * Protects #spl_cache and #spl_list_cache.
+ */
+static Mutex spl_cache_mutex;
+
+/**
+ * Parsed stored playlist files, indexed by file system path.
+ */
+static std::map<PathTraitsFS::string, CachedPlaylistFile,
+		std::less<>> spl_cache;
+
+static unsigned long spl_cache_clock;
+
+/**
+ * The result of the last ListPlaylistFiles() call, valid as long as
+ * the modification time of the playlist directory is still
+ * #spl_list_mtime.
+ */
+static std::optional<PlaylistVector> spl_list_cache;
+static std::chrono::system_clock::time_point spl_list_mtime;
+
+/**
+ * Modification times are only precise to the second.  Something
+ * which was modified within this duration may be modified again
+ * without changing its modification time, so it is not cached.
+ */
+static constexpr std::chrono::system_clock::duration SPL_RACY_DURATION =
+	std::chrono::seconds(2);
+
 void
 spl_global_init(const ConfigData &config)
 {
@@ -156,14 +223,36 @@ LoadPlaylistFileInfo(PlaylistInfo &info,
 	return true;
 }
 
+static PlaylistVector
+CopyPlaylistVector(const PlaylistVector &src) noexcept
+{
+	PlaylistVector dest;
+	for (const auto &i : src)
+		dest.push_back(PlaylistInfo{i.name, i.mtime});
+	return dest;
+}
+
 PlaylistVector
 ListPlaylistFiles()
 {
-	PlaylistVector list;
-
 	const auto &parent_path_fs = spl_map();
 	assert(!parent_path_fs.IsNull());
 
+	/* adding, removing or renaming a playlist file changes the
+	   directory's modification time; if it is unchanged, the
+	   previous result can be reused */
+	FileInfo parent_info;
+	const bool have_parent_info = GetFileInfo(parent_path_fs, parent_info);
+
+	if (have_parent_info) {
+		const std::scoped_lock lock{spl_cache_mutex};
+		if (spl_list_cache &&
+		    spl_list_mtime == parent_info.GetModificationTime())
+			return CopyPlaylistVector(*spl_list_cache);
+	}
+
+	PlaylistVector list;
+
 	DirectoryReader reader(parent_path_fs);
 
 	PlaylistInfo info;
@@ -173,9 +262,92 @@ ListPlaylistFiles()
 			list.push_back(std::move(info));
 	}
 
+	if (have_parent_info &&
+	    std::chrono::system_clock::now() - parent_info.GetModificationTime() >= SPL_RACY_DURATION) {
+		const std::scoped_lock lock{spl_cache_mutex};
+		spl_list_cache = CopyPlaylistVector(list);
+		spl_list_mtime = parent_info.GetModificationTime();
+	}
+
 	return list;
 }
 
+/**
+ * Caller must lock #spl_cache_mutex.
+ */
+static void
+StorePlaylistFileLocked(Path path_fs, const FileInfo &fi,
+			std::shared_ptr<const PlaylistFileContents> contents,
+			bool plain) noexcept
+{
+	if (spl_cache.size() >= SPL_CACHE_MAX &&
+	    spl_cache.find(path_fs.c_str()) == spl_cache.end()) {
+		/* evict the least recently used item */
+		auto oldest = spl_cache.begin();
+		for (auto i = spl_cache.begin(); i != spl_cache.end(); ++i)
+			if (i->second.last_used < oldest->second.last_used)
+				oldest = i;
+
+		spl_cache.erase(oldest);
+	}
+
+	spl_cache.insert_or_assign(PathTraitsFS::string{path_fs.c_str()},
+				   CachedPlaylistFile{
+					   fi.GetModificationTime(),
+					   fi.GetSize(),
+					   std::move(contents),
+					   plain,
+					   ++spl_cache_clock,
+				   });
+}
+
+/**
+ * Add the contents which were just written to the given file to the
+ * #spl_cache, replacing the old item.  If that fails, the old item is
+ * only removed.
+ */
+static void
+StorePlaylistFile(Path path_fs,
+		  std::shared_ptr<const PlaylistFileContents> contents,
+		  bool plain) noexcept
+{
+	FileInfo fi;
+	const bool have_info = GetFileInfo(path_fs, fi);
+
+	const std::scoped_lock lock{spl_cache_mutex};
+
+	/* adding a file changes the directory listing */
+	spl_list_cache.reset();
+
+	if (have_info)
+		StorePlaylistFileLocked(path_fs, fi, std::move(contents),
+					plain);
+	else
+		spl_cache.erase(path_fs.c_str());
+}
+
+void
+spl_invalidate(Path path_fs) noexcept
+{
+	const std::scoped_lock lock{spl_cache_mutex};
+	spl_list_cache.reset();
+
+	if (auto i = spl_cache.find(path_fs.c_str()); i != spl_cache.end())
+		spl_cache.erase(i);
+}
+
+/**
+ * Can this URI be written to a playlist file and read back by
+ * LoadPlaylistFile() without being modified?
+ */
+[[gnu::pure]]
+static bool
+IsCanonicalPlaylistURI(const std::string &uri) noexcept
+{
+	return !PathTraitsUTF8::IsAbsolute(uri.c_str()) &&
+		(uri_has_scheme(uri) || !playlist_saveAbsolutePaths);
+}
+
 static void
 SavePlaylistFile(Path path_fs, const PlaylistFileContents &contents)
 {
@@ -192,10 +364,58 @@ SavePlaylistFile(Path path_fs, const PlaylistFileContents &contents)
 	fos.Commit();
 }
 
+/**
+ * Does the given file end with a newline character (or is it empty)?
+ */
+static bool
+EndsWithNewline(Path path_fs)
+{
+	FileReader reader(path_fs);
+	const auto size = reader.GetSize();
+	if (size == 0)
+		return true;
+
+	reader.Seek(size - 1);
+
+	char ch;
+	return reader.Read(&ch, sizeof(ch)) == sizeof(ch) && ch == '\n';
+}
+
+/**
+ * Append the given URIs to the file, without rewriting the existing
+ * part.
+ */
+static void
+AppendPlaylistFile(Path path_fs, std::span<const std::string> uris)
+{
+	assert(!path_fs.IsNull());
+
+	FileOutputStream fos(path_fs, FileOutputStream::Mode::APPEND_OR_CREATE);
+	BufferedOutputStream bos(fos);
+
+	if (fos.Tell() > 0 && !EndsWithNewline(path_fs))
+		bos.Write('\n');
+
+	for (const auto &uri_utf8 : uris)
+		playlist_print_uri(bos, uri_utf8.c_str());
+
+	bos.Flush();
+
+	fos.Commit();
+}
+
+/**
+ * Parse a stored playlist file.
+ *
+ * @param plain_r set to false if the file contains anything other
+ * than song URIs which were accepted as-is (see
+ * CachedPlaylistFile::plain)
+ */
 static PlaylistFileContents
-LoadPlaylistFile(Path path_fs)
-try {
+ParsePlaylistFile(Path path_fs, bool &plain_r)
+{
 	PlaylistFileContents contents;
+	bool plain = true;
 
 	assert(!path_fs.IsNull());
 
@@ -203,7 +423,14 @@ try {
 
 	char *s;
 	while ((s = file.ReadLine()) != nullptr) {
-		if (*s == 0 || *s == PLAYLIST_COMMENT)
+		if (*s == 0)
+			continue;
+
+		if (*s == PLAYLIST_COMMENT || IsWhitespaceNotNull(*s) ||
+		    IsWhitespaceNotNull(s[std::strlen(s) - 1]))
+			plain = false;
+
+		if (*s == PLAYLIST_COMMENT)
 			continue;
 
 #ifdef _UNICODE
@@ -225,23 +452,88 @@ try {
 			if (uri_utf8.empty()) {
 				if (path.IsAbsolute()) {
 					uri_utf8 = path.ToUTF8();
-					if (uri_utf8.empty())
+					if (uri_utf8.empty()) {
+						plain = false;
 						continue;
-				} else
+					}
+				} else {
+					plain = false;
 					continue;
+				}
 			}
 #else
+			plain = false;
 			continue;
 #endif
 		} else {
 			uri_utf8 = path.ToUTF8();
-			if (uri_utf8.empty())
+			if (uri_utf8.empty()) {
+				plain = false;
 				continue;
+			}
 		}
 
+		if (!IsCanonicalPlaylistURI(uri_utf8) || uri_utf8 != s)
+			/* the "m3u" plugin would return something
+			   different */
+			plain = false;
+
 		contents.emplace_back(std::move(uri_utf8));
-		if (contents.size() >= playlist_max_length)
+		if (contents.size() >= playlist_max_length) {
+			if (file.ReadLine() != nullptr)
+				plain = false;
 			break;
+		}
+	}
+
+	plain_r = plain;
+	return contents;
+}
+
+/**
+ * Look up a stored playlist file in the #spl_cache.  Stale items are
+ * removed.
+ *
+ * @return the cached contents or nullptr
+ */
+static std::shared_ptr<const PlaylistFileContents>
+FindCachedPlaylistFile(Path path_fs, const FileInfo &fi,
+		       bool &plain_r) noexcept
+{
+	const std::scoped_lock lock{spl_cache_mutex};
+
+	auto i = spl_cache.find(path_fs.c_str());
+	if (i == spl_cache.end())
+		return nullptr;
+
+	if (i->second.mtime != fi.GetModificationTime() ||
+	    i->second.size != fi.GetSize()) {
+		spl_cache.erase(i);
+		return nullptr;
+	}
+
+	i->second.last_used = ++spl_cache_clock;
+	plain_r = i->second.plain;
+	return i->second.contents;
+}
+
+/**
+ * Load a stored playlist file from the #spl_cache, or parse it and
+ * add it to the cache.
+ */
+static std::shared_ptr<const PlaylistFileContents>
+LoadPlaylistFile(Path path_fs, bool &plain_r)
+try {
+	FileInfo fi(path_fs);
+
+	if (auto contents = FindCachedPlaylistFile(path_fs, fi, plain_r))
+		return contents;
+
+	auto contents = std::make_shared<const PlaylistFileContents>(ParsePlaylistFile(path_fs, plain_r));
+
+	if (std::chrono::system_clock::now() - fi.GetModificationTime() >= SPL_RACY_DURATION) {
+		const std::scoped_lock lock{spl_cache_mutex};
+		StorePlaylistFileLocked(path_fs, fi, contents, plain_r);
 	}
 
 	return contents;
@@ -251,13 +543,29 @@ try {
 	throw;
 }
 
+std::shared_ptr<const PlaylistFileContents>
+spl_load_plain(Path path_fs) noexcept
+try {
+	bool plain;
+	auto contents = LoadPlaylistFile(path_fs, plain);
+	if (!plain)
+		return nullptr;
+
+	return contents;
+} catch (...) {
+	return nullptr;
+}
+
 static PlaylistFileContents
-MaybeLoadPlaylistFile(Path path_fs, PlaylistFileEditor::LoadMode load_mode)
+MaybeLoadPlaylistFile(Path path_fs, PlaylistFileEditor::LoadMode load_mode,
+		      bool &plain_r)
 try {
+	plain_r = true;
+
 	if (load_mode == PlaylistFileEditor::LoadMode::NO)
 		return {};
 
-	return LoadPlaylistFile(path_fs);
+	return *LoadPlaylistFile(path_fs, plain_r);
 } catch (const PlaylistError &error) {
 	if (error.GetCode() == PlaylistResult::NO_SUCH_LIST &&
 	    load_mode == PlaylistFileEditor::LoadMode::TRY)
@@ -269,7 +577,9 @@ try {
 PlaylistFileEditor::PlaylistFileEditor(const char *name_utf8,
 				       LoadMode load_mode)
 	:path(spl_map_to_fs(name_utf8)),
-	 contents(MaybeLoadPlaylistFile(path, load_mode))
+	 contents(MaybeLoadPlaylistFile(path, load_mode, plain)),
+	 n_loaded(contents.size()), n_unmodified(n_loaded),
+	 may_append(load_mode != LoadMode::NO)
 {
 }
 
@@ -284,6 +594,7 @@ PlaylistFileEditor::Insert(std::size_t i, const char *uri)
 				    "Stored playlist is too large");
 
 	contents.emplace(std::next(contents.begin(), i), uri);
+	n_unmodified = std::min(n_unmodified, i);
 }
 
 void
@@ -308,6 +619,8 @@ PlaylistFileEditor::MoveIndex(unsigned src, unsigned dest)
 
 	const auto dest_i = std::next(contents.begin(), dest);
 	contents.insert(dest_i, std::move(value));
+
+	n_unmodified = std::min<std::size_t>(n_unmodified, std::min(src, dest));
 }
 
 void
@@ -317,6 +630,7 @@ PlaylistFileEditor::RemoveIndex(unsigned i)
 		throw PlaylistError(PlaylistResult::BAD_RANGE, "Bad range");
 
 	contents.erase(std::next(contents.begin(), i));
+	n_unmodified = std::min<std::size_t>(n_unmodified, i);
 }
 
 void
@@ -327,12 +641,38 @@ PlaylistFileEditor::RemoveRange(RangeArg range)
 
 	contents.erase(std::next(contents.begin(), range.start),
 		       std::next(contents.begin(), range.end));
+	n_unmodified = std::min<std::size_t>(n_unmodified, range.start);
 }
 
 void
 PlaylistFileEditor::Save()
 {
-	SavePlaylistFile(path, contents);
+	std::span<const std::string> written{contents};
+
+	if (may_append && n_unmodified == n_loaded) {
+		/* nothing but appended items: no need to rewrite
+		   the whole file */
+		written = written.subspan(n_loaded);
+		if (!written.empty())
+			AppendPlaylistFile(path, written);
+	} else {
+		SavePlaylistFile(path, contents);
+		plain = true;
+	}
+
+	/* if the file would parse to exactly our #contents, keep
+	   them in the cache */
+	if (std::all_of(written.begin(), written.end(),
+			IsCanonicalPlaylistURI))
+		StorePlaylistFile(path,
+				  std::make_shared<const PlaylistFileContents>(contents),
+				  plain);
+	else
+		spl_invalidate(path);
+
+	n_loaded = n_unmodified = contents.size();
+	may_append = true;
+
 	idle_add(IDLE_STORED_PLAYLIST);
 }
 
@@ -352,6 +692,10 @@ spl_clear(const char *utf8path)
 			throw;
 	}
 
+	StorePlaylistFile(path_fs,
+			  std::make_shared<const PlaylistFileContents>(),
+			  true);
+
 	idle_add(IDLE_STORED_PLAYLIST);
 }
 
@@ -361,6 +705,8 @@ spl_delete(const char *name_utf8)
 	const auto path_fs = spl_map_to_fs(name_utf8);
 	assert(!path_fs.IsNull());
 
+	spl_invalidate(path_fs);
+
 	try {
 		RemoveFile(path_fs);
 	} catch (const std::system_error &e) {
@@ -386,13 +732,43 @@ try {
 		throw PlaylistError(PlaylistResult::TOO_LARGE,
 				    "Stored playlist is too large");
 
+	/* look up the cached contents before the file is modified;
+	   if they are known, the cache can be updated instead of
+	   being invalidated */
+	const auto old_size = fos.Tell();
+	std::shared_ptr<const PlaylistFileContents> old_contents;
+	bool plain = true;
+	if (old_size > 0) {
+		FileInfo fi;
+		if (GetFileInfo(path_fs, fi))
+			old_contents = FindCachedPlaylistFile(path_fs, fi,
+							      plain);
+	}
+
 	BufferedOutputStream bos(fos);
 
+	if (old_size > 0 && !EndsWithNewline(path_fs))
+		bos.Write('\n');
+
 	playlist_print_song(bos, song);
 
 	bos.Flush();
 	fos.Commit();
 
+	std::string uri = playlist_saveAbsolutePaths
+		? song.GetRealURI()
+		: song.GetURI();
+	if (IsCanonicalPlaylistURI(uri) &&
+	    (old_size == 0 || old_contents != nullptr) &&
+	    (old_contents == nullptr || old_contents->size() < playlist_max_length)) {
+		auto new_contents = old_contents != nullptr
+			? std::make_shared<PlaylistFileContents>(*old_contents)
+			: std::make_shared<PlaylistFileContents>();
+		new_contents->emplace_back(std::move(uri));
+		StorePlaylistFile(path_fs, std::move(new_contents), plain);
+	} else
+		spl_invalidate(path_fs);
+
 	idle_add(IDLE_STORED_PLAYLIST);
 } catch (const std::system_error &e) {
 	if (IsFileNotFound(e))
@@ -414,6 +790,9 @@ spl_rename_internal(Path from_path_fs, Path to_path_fs)
 		throw PlaylistError(PlaylistResult::LIST_EXISTS,
 				    "Playlist exists already");
 
+	spl_invalidate(from_path_fs);
+	spl_invalidate(to_path_fs);
+
 	try {
 		RenameFile(from_path_fs, to_path_fs);
 	} catch (const std::system_error &e) {
@@ -22,6 +22,7 @@
 
 #include "fs/AllocatedPath.hxx"
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -40,6 +41,31 @@ class PlaylistFileEditor {
 
 	PlaylistFileContents contents;
 
+	/**
+	 * Did the file contain nothing but song URIs?  See
+	 * CachedPlaylistFile::plain.
+	 */
+	bool plain;
+
+	/**
+	 * The number of items which were loaded from the file.
+	 */
+	std::size_t n_loaded;
+
+	/**
+	 * The number of leading items which have not been modified
+	 * since they were loaded.  If this equals #n_loaded, then
+	 * items were only appended, and Save() does not need to
+	 * rewrite the file.
+	 */
+	std::size_t n_unmodified;
+
+	/**
+	 * May Save() append to the existing file?  This is false if
+	 * the file was not loaded (LoadMode::NO).
+	 */
+	bool may_append;
+
 public:
 	enum class LoadMode {
 		NO,
@@ -85,6 +111,26 @@ spl_valid_name(const char *name_utf8);
 AllocatedPath
 spl_map_to_fs(const char *name_utf8);
 
+/**
+ * Remove a stored playlist file from the cache of parsed playlists.
+ * Must be called after the file was modified by something else than
+ * the functions in this library.
+ */
+void
+spl_invalidate(Path path_fs) noexcept;
+
+/**
+ * Load the URIs from a stored playlist file, from the cache of
+ * parsed playlists if possible.  This fails if the file contains
+ * anything else than plain song URIs (e.g. comments or extended M3U
+ * information), because then a playlist plugin is needed to
+ * interpret it.
+ *
+ * @return the URIs or nullptr on error
+ */
+std::shared_ptr<const PlaylistFileContents>
+spl_load_plain(Path path_fs) noexcept;
+
 /**
  * Returns a list of stored_playlist_info struct pointers.
  */
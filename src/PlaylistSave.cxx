@@ -111,6 +111,8 @@ spl_save_queue(const char *name_utf8, PlaylistSaveMode save_mode, const Queue &q
 	bos.Flush();
 	fos.Commit();
 
+	spl_invalidate(path_fs);
+
 	idle_add(IDLE_STORED_PLAYLIST);
 }
 
@@ -19,17 +19,44 @@
 
 #include "RemoteTagCache.hxx"
 #include "RemoteTagCacheHandler.hxx"
+#include "SongSave.hxx"
+#include "song/DetachedSong.hxx"
+#include "config/Data.hxx"
+#include "config/Option.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
+#include "lib/fmt/PathFormatter.hxx"
 #include "input/ScanTags.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/FileSystem.hxx"
 #include "util/DeleteDisposer.hxx"
 #include "util/Domain.hxx"
+#include "util/StringAPI.hxx"
+#include "util/StringCompare.hxx"
 #include "Log.hxx"
 
+#include <cassert>
+#include <stdexcept>
+
 static constexpr Domain remote_tag_cache_domain("remote_tag_cache");
 
+static constexpr char REMOTE_TAG_CACHE_HEADER[] = "mpd_remote_tag_cache 1";
+
+RemoteTagCacheConfig::RemoteTagCacheConfig(const ConfigData &config)
+	:path(config.GetPath(ConfigOption::REMOTE_TAG_CACHE_FILE)),
+	 max_size(config.GetPositive(ConfigOption::REMOTE_TAG_CACHE_SIZE,
+				     4096)),
+	 ttl(std::chrono::seconds(config.GetPositive(ConfigOption::REMOTE_TAG_CACHE_TTL,
+						     24 * 3600)))
+{
+}
+
 RemoteTagCache::RemoteTagCache(EventLoop &event_loop,
-			       RemoteTagCacheHandler &_handler) noexcept
-	:handler(_handler),
+			       RemoteTagCacheHandler &_handler,
+			       RemoteTagCacheConfig &&_config) noexcept
+	:config(std::move(_config)),
+	 handler(_handler),
 	 defer_invoke_handler(event_loop, BIND_THIS_METHOD(InvokeHandlers))
 {
 }
@@ -39,6 +66,81 @@ RemoteTagCache::~RemoteTagCache() noexcept
 	map.clear_and_dispose(DeleteDisposer());
 }
 
+void
+RemoteTagCache::Load() noexcept
+try {
+	if (config.path.IsNull() || !FileExists(config.path))
+		return;
+
+	TextFile file(config.path);
+
+	const char *line = file.ReadLine();
+	if (line == nullptr || !StringIsEqual(line, REMOTE_TAG_CACHE_HEADER)) {
+		FmtWarning(remote_tag_cache_domain,
+			   "Ignoring malformed remote tag cache {}",
+			   config.path);
+		return;
+	}
+
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	char *p;
+	while ((p = file.ReadLine()) != nullptr) {
+		const char *uri = StringAfterPrefix(p, SONG_BEGIN);
+		if (uri == nullptr)
+			throw std::runtime_error("Malformed remote tag cache");
+
+		auto song = song_load(file, uri);
+
+		auto [position, inserted] = map.insert_check(song.GetURI());
+		if (!inserted)
+			continue;
+
+		auto *item = new Item(*this, song.GetURI());
+		item->tag = std::move(song.WritableTag());
+		item->fetch_time = song.GetLastModified();
+		item->state = Item::State::IDLE;
+		map.insert(position, *item);
+		idle_list.push_back(*item);
+	}
+
+	EvictOld();
+} catch (...) {
+	LogError(std::current_exception(), "Failed to load remote tag cache");
+}
+
+void
+RemoteTagCache::Save() noexcept
+try {
+	if (config.path.IsNull())
+		return;
+
+	FileOutputStream fos(config.path);
+	BufferedOutputStream bos(fos);
+
+	bos.Write(REMOTE_TAG_CACHE_HEADER);
+	bos.Write('\n');
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+
+		/* oldest first, so Load() restores the LRU order */
+		for (const auto &item : idle_list) {
+			if (item.tag.IsEmpty())
+				continue;
+
+			DetachedSong song(item.uri, Tag{item.tag});
+			song.SetLastModified(item.fetch_time);
+			song_save(bos, song);
+		}
+	}
+
+	bos.Flush();
+	fos.Commit();
+} catch (...) {
+	LogError(std::current_exception(), "Failed to save remote tag cache");
+}
+
 void
 RemoteTagCache::Lookup(const std::string &uri) noexcept
 {
@@ -48,67 +150,94 @@ RemoteTagCache::Lookup(const std::string &uri) noexcept
 	if (value) {
 		auto item = new Item(*this, uri);
 		map.insert(tag, *item);
-		waiting_list.push_back(*item);
-		lock.unlock();
-
-		try {
-			item->scanner = InputScanTags(uri.c_str(), *item);
-			if (!item->scanner) {
-				/* unsupported */
-				lock.lock();
-				ItemResolved(*item);
-				return;
-			}
-
-			item->scanner->Start();
-		} catch (...) {
-			FmtError(remote_tag_cache_domain,
-				 "Failed to scan tags of '{}': {}",
-				 uri, std::current_exception());
-
-			item->scanner.reset();
-
-			lock.lock();
-			ItemResolved(*item);
-			return;
-		}
-	} else if (tag->scanner) {
-		/* already scanning this one - no-op */
+		pending_list.push_back(*item);
+	} else if (tag->state != Item::State::IDLE) {
+		/* already pending, scanning or about to be
+		   reported - no-op */
+		return;
+	} else if (std::chrono::system_clock::now() - tag->fetch_time >= config.ttl) {
+		/* stale: scan again; the old tag is kept if the new
+		   scan fails */
+		idle_list.erase(idle_list.iterator_to(*tag));
+		tag->state = Item::State::PENDING;
+		pending_list.push_back(*tag);
 	} else {
 		/* already finished: re-invoke the handler */
 
-		idle_list.erase(waiting_list.iterator_to(*tag));
+		idle_list.erase(idle_list.iterator_to(*tag));
+		tag->state = Item::State::INVOKE;
 		invoke_list.push_back(*tag);
 
 		ScheduleInvokeHandlers();
+		return;
+	}
+
+	lock.unlock();
+	StartScans();
+}
+
+inline bool
+RemoteTagCache::Item::StartScan() noexcept
+try {
+	scanner = InputScanTags(uri.c_str(), *this);
+	if (!scanner)
+		/* unsupported */
+		return false;
+
+	scanner->Start();
+	return true;
+} catch (...) {
+	FmtError(remote_tag_cache_domain,
+		 "Failed to scan tags of '{}': {}",
+		 uri, std::current_exception());
+
+	scanner.reset();
+	return false;
+}
+
+void
+RemoteTagCache::StartScans() noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	while (n_scanning < MAX_SCANS && !pending_list.empty()) {
+		auto &item = pending_list.front();
+		pending_list.pop_front();
+		waiting_list.push_back(item);
+		item.state = Item::State::SCANNING;
+		++n_scanning;
+
+		bool success;
+
+		{
+			const ScopeUnlock unlock(mutex);
+			success = item.StartScan();
+		}
+
+		if (!success)
+			ItemResolved(item);
 	}
 }
 
 void
 RemoteTagCache::ItemResolved(Item &item) noexcept
 {
+	assert(n_scanning > 0);
+
 	waiting_list.erase(waiting_list.iterator_to(item));
+	--n_scanning;
+
+	item.fetch_time = std::chrono::system_clock::now();
+	item.state = Item::State::INVOKE;
 	invoke_list.push_back(item);
 
 	ScheduleInvokeHandlers();
 }
 
 void
-RemoteTagCache::InvokeHandlers() noexcept
+RemoteTagCache::EvictOld() noexcept
 {
-	const std::scoped_lock<Mutex> lock(mutex);
-
-	while (!invoke_list.empty()) {
-		auto &item = invoke_list.front();
-		invoke_list.pop_front();
-		idle_list.push_back(item);
-
-		const ScopeUnlock unlock(mutex);
-		handler.OnRemoteTag(item.uri.c_str(), item.tag);
-	}
-
-	/* evict items if there are too many */
-	while (map.size() > MAX_SIZE && !idle_list.empty()) {
+	while (map.size() > config.max_size && !idle_list.empty()) {
 		auto *item = &idle_list.front();
 		idle_list.pop_front();
 		map.erase(map.iterator_to(*item));
@@ -117,13 +246,36 @@ RemoteTagCache::InvokeHandlers() noexcept
 }
 
 void
-RemoteTagCache::Item::OnRemoteTag(Tag &&_tag) noexcept
+RemoteTagCache::InvokeHandlers() noexcept
 {
-	tag = std::move(_tag);
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+
+		while (!invoke_list.empty()) {
+			auto &item = invoke_list.front();
+			invoke_list.pop_front();
+			item.state = Item::State::IDLE;
+			idle_list.push_back(item);
+
+			const ScopeUnlock unlock(mutex);
+			handler.OnRemoteTag(item.uri.c_str(), item.tag);
+		}
 
+		/* evict items if there are too many */
+		EvictOld();
+	}
+
+	/* scanners may have finished; start the next ones */
+	StartScans();
+}
+
+void
+RemoteTagCache::Item::OnRemoteTag(Tag &&_tag) noexcept
+{
 	scanner.reset();
 
 	const std::scoped_lock<Mutex> lock(parent.mutex);
+	tag = std::move(_tag);
 	parent.ItemResolved(*this);
 }
 
@@ -135,6 +287,7 @@ RemoteTagCache::Item::OnRemoteTagError(std::exception_ptr e) noexcept
 
 	scanner.reset();
 
+	/* keep the old tag (if any) */
 	const std::scoped_lock<Mutex> lock(parent.mutex);
 	parent.ItemResolved(*this);
 }
@@ -23,23 +23,62 @@
 #include "input/RemoteTagScanner.hxx"
 #include "tag/Tag.hxx"
 #include "event/InjectEvent.hxx"
+#include "fs/AllocatedPath.hxx"
 #include "thread/Mutex.hxx"
 #include "util/IntrusiveList.hxx"
 #include "util/IntrusiveHashSet.hxx"
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 
+struct ConfigData;
 class RemoteTagCacheHandler;
 
+struct RemoteTagCacheConfig {
+	/**
+	 * The file where the cache is saved at shutdown and loaded
+	 * from at startup; nullptr disables persistence.
+	 */
+	AllocatedPath path = nullptr;
+
+	/**
+	 * The maximum number of items.  If there are more, the least
+	 * recently used ones are evicted.
+	 */
+	std::size_t max_size = 4096;
+
+	/**
+	 * After this duration, a cached tag is considered stale and
+	 * will be scanned again by the next Lookup().
+	 */
+	std::chrono::system_clock::duration ttl = std::chrono::hours(24);
+
+	RemoteTagCacheConfig() = default;
+
+	/**
+	 * Throws on error.
+	 */
+	explicit RemoteTagCacheConfig(const ConfigData &config);
+};
+
 /**
  * A cache for tags received via #RemoteTagScanner.
  */
 class RemoteTagCache final {
-	static constexpr size_t MAX_SIZE = 4096;
+	/**
+	 * The maximum number of #RemoteTagScanner instances running
+	 * at the same time.  Adding a large playlist of remote songs
+	 * queues them in #pending_list instead of flooding the
+	 * servers with requests.
+	 */
+	static constexpr std::size_t MAX_SCANS = 8;
+
+	const RemoteTagCacheConfig config;
 
 	RemoteTagCacheHandler &handler;
 
@@ -60,10 +99,32 @@ class RemoteTagCache final {
 
 		Tag tag;
 
+		/**
+		 * When was #tag obtained?  Only valid if the item is
+		 * not pending or being scanned for the first time.
+		 */
+		std::chrono::system_clock::time_point fetch_time;
+
+		enum class State : uint_least8_t {
+			PENDING,
+			SCANNING,
+			INVOKE,
+			IDLE,
+		} state = State::PENDING;
+
 		template<typename U>
 		Item(RemoteTagCache &_parent, U &&_uri) noexcept
 			:parent(_parent), uri(std::forward<U>(_uri)) {}
 
+		/**
+		 * Create and start the #RemoteTagScanner.
+		 *
+		 * Caller must not lock the mutex.
+		 *
+		 * @return false if the scan could not be started
+		 */
+		bool StartScan() noexcept;
+
 		/* virtual methods from RemoteTagHandler */
 		void OnRemoteTag(Tag &&tag) noexcept override;
 		void OnRemoteTagError(std::exception_ptr e) noexcept override;
@@ -102,6 +163,13 @@ class RemoteTagCache final {
 	 */
 	ItemList idle_list;
 
+	/**
+	 * These items shall be scanned, but the number of running
+	 * scanners has reached #MAX_SCANS.  They will be started by
+	 * StartScans() as soon as a slot becomes free.
+	 */
+	ItemList pending_list;
+
 	/**
 	 * A #RemoteTagScanner instances is currently busy on fetching
 	 * information, and we're waiting for our #RemoteTagHandler
@@ -122,14 +190,45 @@ class RemoteTagCache final {
 
 	KeyMap map;
 
+	/**
+	 * The number of items in #waiting_list.
+	 */
+	std::size_t n_scanning = 0;
+
 public:
 	RemoteTagCache(EventLoop &event_loop,
-		       RemoteTagCacheHandler &_handler) noexcept;
+		       RemoteTagCacheHandler &_handler,
+		       RemoteTagCacheConfig &&_config) noexcept;
 	~RemoteTagCache() noexcept;
 
+	/**
+	 * Load the cache from RemoteTagCacheConfig::path (if
+	 * configured).  Errors are logged.
+	 */
+	void Load() noexcept;
+
+	/**
+	 * Save the cache to RemoteTagCacheConfig::path (if
+	 * configured).  Errors are logged.
+	 */
+	void Save() noexcept;
+
 	void Lookup(const std::string &uri) noexcept;
 
 private:
+	/**
+	 * Start scanners for items in #pending_list until #MAX_SCANS
+	 * is reached.
+	 *
+	 * Caller must not lock the mutex.
+	 */
+	void StartScans() noexcept;
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void EvictOld() noexcept;
+
 	void InvokeHandlers() noexcept;
 
 	void ScheduleInvokeHandlers() noexcept {
@@ -42,6 +42,9 @@ SongLoader::LoadFromDatabase(const char *uri) const
 #ifdef ENABLE_DATABASE
 	if (db != nullptr)
 		return DatabaseDetachSong(*db, storage, uri);
+
+	if (lazy)
+		return DetachedSong(uri);
 #else
 	(void)uri;
 #endif
@@ -43,13 +43,22 @@ class SongLoader {
 #ifdef ENABLE_DATABASE
 	const Database *const db;
 	const Storage *const storage;
+
+	/**
+	 * If set and there is no #db (because it is still being
+	 * loaded), then songs which would be looked up in the
+	 * database are returned without tags instead of failing.
+	 * They are resolved later by playlist::DatabaseModified().
+	 */
+	const bool lazy = false;
 #endif
 
 public:
 #ifdef ENABLE_DATABASE
 	explicit SongLoader(const Client &_client);
-	SongLoader(const Database *_db, const Storage *_storage)
-		:client(nullptr), db(_db), storage(_storage) {}
+	SongLoader(const Database *_db, const Storage *_storage,
+		   bool _lazy=false)
+		:client(nullptr), db(_db), storage(_storage), lazy(_lazy) {}
 	SongLoader(const Client &_client, const Database *_db,
 		   const Storage *_storage)
 		:client(&_client), db(_db), storage(_storage) {}
@@ -22,6 +22,7 @@
 #include "song/DetachedSong.hxx"
 #include "TimePrint.hxx"
 #include "TagPrint.hxx"
+#include "CompactPrint.hxx"
 #include "client/Response.hxx"
 #include "fs/Traits.hxx"
 #include "time/ChronoUtil.hxx"
@@ -85,6 +86,13 @@ PrintRange(Response &r, SongTime start_time, SongTime end_time) noexcept
 void
 song_print_info(Response &r, const LightSong &song, bool base) noexcept
 {
+	if (r.IsCompact()) {
+		CompactSongWriter w(r);
+		w.Song(song, base);
+		w.Finish();
+		return;
+	}
+
 	song_print_uri(r, song, base);
 
 	PrintRange(r, song.start_time, song.end_time);
@@ -108,6 +116,13 @@ song_print_info(Response &r, const LightSong &song, bool base) noexcept
 void
 song_print_info(Response &r, const DetachedSong &song, bool base) noexcept
 {
+	if (r.IsCompact()) {
+		CompactSongWriter w(r);
+		w.Song(song, base);
+		w.Finish();
+		return;
+	}
+
 	song_print_uri(r, song, base);
 
 	PrintRange(r, song.GetStartTime(), song.GetEndTime());
@@ -38,7 +38,6 @@
 #include <stdlib.h>
 
 #define SONG_MTIME "mtime"
-#define SONG_END "song_end"
 
 static void
 range_save(BufferedOutputStream &os, unsigned start_ms, unsigned end_ms)
@@ -50,7 +49,8 @@ range_save(BufferedOutputStream &os, unsigned start_ms, unsigned end_ms)
 }
 
 void
-song_save(BufferedOutputStream &os, const Song &song)
+song_save(BufferedOutputStream &os, const Song &song,
+	  TagMask hidden_types)
 {
 	os.Fmt(FMT_STRING(SONG_BEGIN "{}\n"), song.filename);
 
@@ -61,6 +61,11 @@ song_save(BufferedOutputStream &os, const Song &song)
 
 	tag_save(os, song.tag);
 
+	for (const auto &i : song.hidden_tag)
+		if (hidden_types.Test(i.type))
+			os.Fmt(FMT_STRING("{}: {}\n"),
+			       tag_item_names[i.type], i.value);
+
 	if (song.audio_format.IsDefined())
 		os.Fmt(FMT_STRING("Format: {}\n"), song.audio_format);
 
@@ -87,11 +92,13 @@ song_save(BufferedOutputStream &os, const DetachedSong &song)
 
 DetachedSong
 song_load(LineReader &file, const char *uri,
-	  std::string *target_r)
+	  std::string *target_r, Tag *hidden_r)
 {
 	DetachedSong song(uri);
 
 	TagBuilder tag;
+	if (hidden_r != nullptr)
+		tag.AcceptAllTypes();
 
 	char *line;
 	while ((line = file.ReadLine()) != nullptr &&
@@ -137,6 +144,9 @@ song_load(LineReader &file, const char *uri,
 		}
 	}
 
+	if (hidden_r != nullptr)
+		*hidden_r = tag.ExtractDisabled();
+
 	song.SetTag(tag.Commit());
 	return song;
 }
@@ -20,18 +20,27 @@
 #ifndef MPD_SONG_SAVE_HXX
 #define MPD_SONG_SAVE_HXX
 
+#include "tag/Mask.hxx"
+
 #include <memory>
 
 #define SONG_BEGIN "song_begin: "
+#define SONG_END "song_end"
 
 struct Song;
 struct AudioFormat;
 class DetachedSong;
 class BufferedOutputStream;
 class LineReader;
+struct Tag;
 
+/**
+ * @param hidden_types the types of Song::hidden_tag items which
+ * shall be saved
+ */
 void
-song_save(BufferedOutputStream &os, const Song &song);
+song_save(BufferedOutputStream &os, const Song &song,
+	  TagMask hidden_types=TagMask::None());
 
 void
 song_save(BufferedOutputStream &os, const DetachedSong &song);
@@ -41,9 +50,13 @@ song_save(BufferedOutputStream &os, const DetachedSong &song);
  * "song_end" line.
  *
  * Throws on error.
+ *
+ * @param hidden_r if not nullptr, then items of disabled tag types
+ * are returned here (see Song::hidden_tag) instead of being
+ * discarded
  */
 DetachedSong
 song_load(LineReader &file, const char *uri,
-	  std::string *target_r=nullptr);
+	  std::string *target_r=nullptr, Tag *hidden_r=nullptr);
 
 #endif
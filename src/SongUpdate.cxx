@@ -50,13 +50,14 @@ Song::IsPluginAvailable() const noexcept
 }
 
 SongPtr
-Song::LoadFile(Storage &storage, const char *path_utf8, Directory &parent)
+Song::LoadFile(Storage &storage, const char *path_utf8, Directory &parent,
+	       bool all_tags)
 {
 	assert(!uri_has_scheme(path_utf8));
 	assert(std::strchr(path_utf8, '\n') == nullptr);
 
-	auto song = std::make_unique<Song>(path_utf8, parent);
-	if (!song->UpdateFile(storage))
+	auto song = Song::New(path_utf8, parent);
+	if (!song->UpdateFile(storage, all_tags))
 		return nullptr;
 
 	return song;
@@ -67,7 +68,7 @@ Song::LoadFile(Storage &storage, const char *path_utf8, Directory &parent)
 #ifdef ENABLE_DATABASE
 
 bool
-Song::UpdateFile(Storage &storage)
+Song::UpdateFile(Storage &storage, bool all_tags)
 {
 	const auto &relative_uri = GetURI();
 
@@ -76,6 +77,9 @@ Song::UpdateFile(Storage &storage)
 		return false;
 
 	TagBuilder tag_builder;
+	if (all_tags)
+		tag_builder.AcceptAllTypes();
+
 	auto new_audio_format = AudioFormat::Undefined();
 
 	try {
@@ -98,6 +102,7 @@ Song::UpdateFile(Storage &storage)
 
 	mtime = info.mtime;
 	audio_format = new_audio_format;
+	hidden_tag = tag_builder.ExtractDisabled();
 	tag_builder.Commit(tag);
 	return true;
 }
@@ -106,20 +111,20 @@ Song::UpdateFile(Storage &storage)
 
 SongPtr
 Song::LoadFromArchive(ArchiveFile &archive, const char *name_utf8,
-		      Directory &parent) noexcept
+		      Directory &parent, bool all_tags) noexcept
 {
 	assert(!uri_has_scheme(name_utf8));
 	assert(std::strchr(name_utf8, '\n') == nullptr);
 
-	auto song = std::make_unique<Song>(name_utf8, parent);
-	if (!song->UpdateFileInArchive(archive))
+	auto song = Song::New(name_utf8, parent);
+	if (!song->UpdateFileInArchive(archive, all_tags))
 		return nullptr;
 
 	return song;
 }
 
 bool
-Song::UpdateFileInArchive(ArchiveFile &archive) noexcept
+Song::UpdateFileInArchive(ArchiveFile &archive, bool all_tags) noexcept
 {
 	assert(parent.device == DEVICE_INARCHIVE);
 
@@ -134,9 +139,13 @@ Song::UpdateFileInArchive(ArchiveFile &archive) noexcept
 	}
 
 	TagBuilder tag_builder;
+	if (all_tags)
+		tag_builder.AcceptAllTypes();
+
 	if (!tag_archive_scan(archive, path_utf8.c_str(), tag_builder))
 		return false;
 
+	hidden_tag = tag_builder.ExtractDisabled();
 	tag_builder.Commit(tag);
 	return true;
 }
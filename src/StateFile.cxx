@@ -19,11 +19,15 @@
 
 #include "config.h"
 #include "StateFile.hxx"
+#include "StateJournal.hxx"
 #include "output/State.hxx"
 #include "queue/PlaylistState.hxx"
+#include "fs/FileSystem.hxx"
 #include "fs/io/TextFile.hxx"
 #include "io/FileOutputStream.hxx"
 #include "io/BufferedOutputStream.hxx"
+#include "io/StringOutputStream.hxx"
+#include "thread/Name.hxx"
 #include "storage/StorageState.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -31,18 +35,30 @@
 #include "util/Domain.hxx"
 #include "Log.hxx"
 
+#include <cassert>
 #include <exception>
+#include <memory>
+#include <utility>
 
 static constexpr Domain state_file_domain("state_file");
 
 StateFile::StateFile(StateFileConfig &&_config,
 		     Partition &_partition, EventLoop &_loop)
 	:config(std::move(_config)), path_utf8(config.path.ToUTF8()),
+	 journal_path(AllocatedPath::Concat(config.path.c_str(),
+					    PATH_LITERAL(".journal"))),
 	 timer_event(_loop, BIND_THIS_METHOD(OnTimeout)),
+	 writer_done(_loop, BIND_THIS_METHOD(FinishWriter)),
+	 writer_thread(BIND_THIS_METHOD(RunWriter)),
 	 partition(_partition)
 {
 }
 
+StateFile::~StateFile() noexcept
+{
+	FinishWriter();
+}
+
 void
 StateFile::RememberVersions() noexcept
 {
@@ -81,6 +97,24 @@ StateFile::Write(BufferedOutputStream &os)
 	playlist_state_save(os, partition.playlist, partition.pc);
 }
 
+inline void
+StateFile::WriteJournalRecord(BufferedOutputStream &os)
+{
+	os.Write(STATE_JOURNAL_BEGIN "\n");
+
+	partition.mixer_memento.SaveSoftwareVolumeState(os);
+	audio_output_state_save(os, partition.outputs);
+
+#ifdef ENABLE_DATABASE
+	storage_state_save(os, partition.instance);
+#endif
+
+	playlist_state_save_delta(os, partition.playlist, partition.pc,
+				  saved_queue_version);
+
+	os.Write(STATE_JOURNAL_END "\n");
+}
+
 inline void
 StateFile::Write(OutputStream &os)
 {
@@ -89,15 +123,141 @@ StateFile::Write(OutputStream &os)
 	bos.Flush();
 }
 
+void
+StateFile::Serialize()
+{
+	assert(!writer_thread.IsDefined());
+
+	writer_buffer.clear();
+	StringOutputStream sos(writer_buffer);
+
+	writer_append = !need_compaction &&
+		n_journal_records < MAX_JOURNAL_RECORDS &&
+		journal_size < base_size;
+
+	if (writer_append) {
+		BufferedOutputStream bos(sos);
+		WriteJournalRecord(bos);
+		bos.Flush();
+
+		if (writer_buffer.size() > base_size / 2) {
+			/* most of the queue has changed; writing the
+			   whole state file is cheaper in the long
+			   run */
+			writer_buffer.clear();
+			writer_append = false;
+		}
+	}
+
+	if (!writer_append)
+		Write(sos);
+
+	saved_queue_version = partition.playlist.queue.version;
+	RememberVersions();
+
+	if (writer_append) {
+		++n_journal_records;
+		journal_size += writer_buffer.size();
+	} else {
+		n_journal_records = 0;
+		journal_size = 0;
+		base_size = writer_buffer.size();
+		need_compaction = false;
+	}
+}
+
+void
+StateFile::WriteBuffer()
+{
+	if (writer_append) {
+		FileOutputStream fos(journal_path,
+				     FileOutputStream::Mode::APPEND_OR_CREATE);
+		fos.Write(writer_buffer.data(), writer_buffer.size());
+		fos.Commit();
+		return;
+	}
+
+	FileOutputStream fos(config.path);
+	fos.Write(writer_buffer.data(), writer_buffer.size());
+
+	/* the journal refers to the old state file; delete it before
+	   the new one becomes visible - after a crash in between,
+	   the old state file is used without its journal, which is
+	   older, but consistent */
+	if (FileExists(journal_path))
+		RemoveFile(journal_path);
+
+	fos.Commit();
+}
+
+void
+StateFile::RunWriter() noexcept
+{
+	SetThreadName("state_file");
+
+	try {
+		WriteBuffer();
+	} catch (...) {
+		writer_error = std::current_exception();
+	}
+
+	writer_done.Schedule();
+}
+
+void
+StateFile::FinishWriter() noexcept
+{
+	writer_done.Cancel();
+
+	if (!writer_thread.IsDefined())
+		return;
+
+	writer_thread.Join();
+
+	if (writer_error) {
+		LogError(std::exchange(writer_error, {}));
+
+		/* we don't know what was written; start over */
+		need_compaction = true;
+	}
+
+	/* free the memory */
+	writer_buffer = {};
+}
+
 void
 StateFile::Write()
 {
 	FmtDebug(state_file_domain,
 		 "Saving state file {}", path_utf8);
 
+	if (config.journal) {
+		FinishWriter();
+		Serialize();
+
+		try {
+			WriteBuffer();
+		} catch (...) {
+			LogError(std::current_exception());
+			need_compaction = true;
+		}
+
+		writer_buffer = {};
+		return;
+	}
+
 	try {
 		FileOutputStream fos(config.path);
 		Write(fos);
+
+		if (have_journal) {
+			/* the journal is disabled now, and the
+			   obsolete file was merged by Read() */
+			if (FileExists(journal_path))
+				RemoveFile(journal_path);
+			have_journal = false;
+		}
+
 		fos.Commit();
 	} catch (...) {
 		LogError(std::current_exception());
@@ -113,11 +273,31 @@ try {
 
 	FmtDebug(state_file_domain, "Loading state file {}", path_utf8);
 
-	TextFile file(config.path);
+	TextFile base_file(config.path);
+
+	/* if there is a journal, apply its records to the state
+	   file before parsing it */
+	std::unique_ptr<MergedStateFile> merged;
+	if (FileExists(journal_path)) {
+		FmtDebug(state_file_domain, "Applying state file journal");
+
+		TextFile journal_file(journal_path);
+		merged = std::make_unique<MergedStateFile>(base_file,
+							   &journal_file);
+		have_journal = true;
+	}
+
+	LineReader &file = merged
+		? static_cast<LineReader &>(*merged)
+		: static_cast<LineReader &>(base_file);
 
 #ifdef ENABLE_DATABASE
+	/* while the database is being loaded in the background,
+	   queued songs are restored without tags, and are resolved
+	   after loading has finished */
 	const SongLoader song_loader(partition.instance.GetDatabase(),
-				     partition.instance.storage);
+				     partition.instance.storage,
+				     partition.instance.IsDatabaseLoading());
 #else
 	const SongLoader song_loader(nullptr, nullptr);
 #endif
@@ -154,5 +334,31 @@ StateFile::CheckModified() noexcept
 void
 StateFile::OnTimeout() noexcept
 {
-	Write();
+	if (!config.journal) {
+		Write();
+		return;
+	}
+
+	if (writer_thread.IsDefined()) {
+		/* the previous write is still running; try again
+		   later */
+		timer_event.Schedule(std::chrono::seconds(1));
+		return;
+	}
+
+	FmtDebug(state_file_domain,
+		 "Saving state file {}", path_utf8);
+
+	/* serialize in the main thread (this is cheap, because
+	   usually only a small journal record is generated), but
+	   leave the file I/O to a separate thread */
+	Serialize();
+
+	try {
+		writer_thread.Start();
+	} catch (...) {
+		LogError(std::current_exception());
+		need_compaction = true;
+		writer_buffer = {};
+	}
 }
@@ -17,13 +17,19 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #ifndef MPD_STATE_FILE_HXX
 #define MPD_STATE_FILE_HXX
 
 #include "StateFileConfig.hxx"
 #include "event/FarTimerEvent.hxx"
+#include "event/InjectEvent.hxx"
+#include "thread/Thread.hxx"
 #include "config.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <string>
 
 struct Partition;
@@ -35,8 +41,43 @@ class StateFile final {
 
 	const std::string path_utf8;
 
+	/**
+	 * The journal file, which contains the changes since the
+	 * state file was written (see "state_file_journal").
+	 */
+	const AllocatedPath journal_path;
+
 	FarTimerEvent timer_event;
 
+	/**
+	 * Notifies the main thread that the #writer_thread has
+	 * finished.
+	 */
+	InjectEvent writer_done;
+
+	/**
+	 * Writes #writer_buffer to disk if the journal is enabled, so
+	 * the main thread does not block on file I/O.
+	 */
+	Thread writer_thread;
+
+	/**
+	 * The serialized state to be written by the #writer_thread.
+	 * The main thread must not touch it while the thread runs.
+	 */
+	std::string writer_buffer;
+
+	/**
+	 * Shall #writer_buffer be appended to the journal?  If not,
+	 * it replaces the state file.
+	 */
+	bool writer_append;
+
+	/**
+	 * The error thrown by the #writer_thread.
+	 */
+	std::exception_ptr writer_error;
+
 	Partition &partition;
 
 	/**
@@ -50,11 +91,50 @@ class StateFile final {
 	unsigned prev_storage_version = 0;
 #endif
 
+	/**
+	 * The queue version when the state was last serialized.  The
+	 * next journal record contains only the songs which were
+	 * modified since then.
+	 */
+	uint32_t saved_queue_version = 0;
+
+	/**
+	 * The size of the state file written last, and the total
+	 * size of the journal records appended since then.
+	 */
+	std::size_t base_size = 0, journal_size = 0;
+
+	unsigned n_journal_records = 0;
+
+	/**
+	 * Must the whole state file be written next time?  This is
+	 * set initially (because the queue versions have nothing to
+	 * do with the file contents) and after a write error.
+	 */
+	bool need_compaction = true;
+
+	/**
+	 * Was a journal file found by Read()?  It is deleted by the
+	 * next Write() even if the journal is disabled.
+	 */
+	bool have_journal = false;
+
+	/**
+	 * Compact the journal (i.e. write the whole state file)
+	 * after this number of records.
+	 */
+	static constexpr unsigned MAX_JOURNAL_RECORDS = 64;
+
 public:
 	StateFile(StateFileConfig &&_config,
 		  Partition &partition, EventLoop &loop);
+	~StateFile() noexcept;
 
 	void Read();
+
+	/**
+	 * Write the state synchronously (e.g. during shutdown).
+	 */
 	void Write();
 
 	/**
@@ -66,6 +146,34 @@ private:
 	void Write(OutputStream &os);
 	void Write(BufferedOutputStream &os);
 
+	/**
+	 * Write a journal record containing all state lines, but
+	 * only the queue songs modified since #saved_queue_version.
+	 */
+	void WriteJournalRecord(BufferedOutputStream &os);
+
+	/**
+	 * Serialize the current state into #writer_buffer: a journal
+	 * record if possible, or else the whole state file.  Sets
+	 * #writer_append.
+	 */
+	void Serialize();
+
+	/**
+	 * Write #writer_buffer to the journal or to the state file.
+	 * This runs in the #writer_thread, or in the main thread
+	 * during shutdown.
+	 *
+	 * Throws on error.
+	 */
+	void WriteBuffer();
+
+	/**
+	 * Wait for the #writer_thread (if it was started) and
+	 * evaluate its result.
+	 */
+	void FinishWriter() noexcept;
+
 	/**
 	 * Save the current state versions for use with IsModified().
 	 */
@@ -80,6 +188,9 @@ private:
 
 	/* callback for #timer_event */
 	void OnTimeout() noexcept;
+
+	/* the #writer_thread */
+	void RunWriter() noexcept;
 };
 
 #endif /* STATE_FILE_H */
@@ -28,7 +28,8 @@ StateFileConfig::StateFileConfig(const ConfigData &config)
 	:path(config.GetPath(ConfigOption::STATE_FILE)),
 	 interval(config.GetUnsigned(ConfigOption::STATE_FILE_INTERVAL,
 				     DEFAULT_INTERVAL)),
-	 restore_paused(config.GetBool(ConfigOption::RESTORE_PAUSED, false))
+	 restore_paused(config.GetBool(ConfigOption::RESTORE_PAUSED, false)),
+	 journal(config.GetBool(ConfigOption::STATE_FILE_JOURNAL, false))
 {
 #ifdef ANDROID
 	if (path.IsNull()) {
@@ -34,6 +34,12 @@ struct StateFileConfig {
 
 	bool restore_paused;
 
+	/**
+	 * Append changes to a journal file instead of rewriting the
+	 * whole state file each time?
+	 */
+	bool journal;
+
 	explicit StateFileConfig(const ConfigData &config);
 
 	bool IsEnabled() const noexcept {
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "StateJournal.hxx"
+#include "SongSave.hxx"
+#include "queue/PlaylistState.hxx"
+#include "queue/Save.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringAPI.hxx"
+#include "util/StringCompare.hxx"
+
+#include <utility>
+
+using Entry = std::vector<std::string>;
+
+/**
+ * Read the rest of one queue entry (as written by queue_save()): an
+ * optional priority line followed by either a single line or a
+ * "song_begin" block.
+ *
+ * @return false if the file ended prematurely
+ */
+static bool
+ReadEntry(LineReader &file, const char *line, Entry &entry)
+{
+	entry.emplace_back(line);
+
+	if (StringStartsWith(line, PRIO_LABEL)) {
+		line = file.ReadLine();
+		if (line == nullptr)
+			return false;
+
+		entry.emplace_back(line);
+	}
+
+	if (StringStartsWith(line, SONG_BEGIN)) {
+		do {
+			line = file.ReadLine();
+			if (line == nullptr)
+				return false;
+
+			entry.emplace_back(line);
+		} while (!StringIsEqual(line, SONG_END));
+	}
+
+	return true;
+}
+
+/**
+ * Read the state file, splitting it into the lines before the
+ * queue and the queue entries.
+ *
+ * @return true if the state file contains a queue
+ */
+static bool
+ReadBase(LineReader &file, std::vector<std::string> &header,
+	 std::vector<Entry> &entries)
+{
+	bool found = false;
+
+	const char *line;
+	while ((line = file.ReadLine()) != nullptr) {
+		if (!StringStartsWith(line, PLAYLIST_STATE_FILE_PLAYLIST_BEGIN)) {
+			header.emplace_back(line);
+			continue;
+		}
+
+		found = true;
+
+		while ((line = file.ReadLine()) != nullptr &&
+		       !StringStartsWith(line, PLAYLIST_STATE_FILE_PLAYLIST_END)) {
+			entries.emplace_back();
+			if (!ReadEntry(file, line, entries.back()))
+				return found;
+		}
+	}
+
+	return found;
+}
+
+/**
+ * One record of the journal.
+ */
+struct JournalRecord {
+	std::vector<std::string> header;
+
+	unsigned length = 0;
+
+	std::vector<std::pair<unsigned, Entry>> changes;
+
+	void ApplyTo(std::vector<std::string> &base_header,
+		     std::vector<Entry> &entries) && noexcept {
+		base_header = std::move(header);
+
+		entries.resize(length);
+		for (auto &[position, entry] : changes)
+			if (position < length)
+				entries[position] = std::move(entry);
+	}
+};
+
+/**
+ * Apply all complete records of the journal.
+ *
+ * @return true if at least one record was applied
+ */
+static bool
+ApplyJournal(LineReader &file, std::vector<std::string> &header,
+	     std::vector<Entry> &entries)
+{
+	bool applied = false;
+
+	enum class State {
+		OUTSIDE,
+		HEADER,
+		QUEUE,
+		COMPLETE,
+	} state = State::OUTSIDE;
+
+	JournalRecord record;
+
+	const char *line;
+	while ((line = file.ReadLine()) != nullptr) {
+		if (StringIsEqual(line, STATE_JOURNAL_BEGIN)) {
+			record = {};
+			state = State::HEADER;
+			continue;
+		}
+
+		const char *p;
+
+		switch (state) {
+		case State::OUTSIDE:
+			/* garbage, e.g. after an incomplete record */
+			break;
+
+		case State::HEADER:
+			if ((p = StringAfterPrefix(line, PLAYLIST_STATE_FILE_PLAYLIST_DELTA))) {
+				record.length = ParseUnsigned(p);
+				state = State::QUEUE;
+			} else
+				record.header.emplace_back(line);
+			break;
+
+		case State::QUEUE:
+			if (StringStartsWith(line, PLAYLIST_STATE_FILE_PLAYLIST_END)) {
+				state = State::COMPLETE;
+			} else if ((p = StringAfterPrefix(line, QUEUE_POSITION_LABEL))) {
+				const unsigned position = ParseUnsigned(p);
+
+				line = file.ReadLine();
+				if (line == nullptr)
+					return applied;
+
+				Entry entry;
+				if (!ReadEntry(file, line, entry))
+					return applied;
+
+				record.changes.emplace_back(position,
+							    std::move(entry));
+			} else
+				/* malformed */
+				state = State::OUTSIDE;
+			break;
+
+		case State::COMPLETE:
+			if (StringIsEqual(line, STATE_JOURNAL_END)) {
+				std::move(record).ApplyTo(header, entries);
+				applied = true;
+			}
+
+			state = State::OUTSIDE;
+			break;
+		}
+	}
+
+	return applied;
+}
+
+MergedStateFile::MergedStateFile(LineReader &base, LineReader *journal)
+{
+	std::vector<Entry> entries;
+	bool has_queue = ReadBase(base, lines, entries);
+
+	if (journal != nullptr && ApplyJournal(*journal, lines, entries))
+		has_queue = true;
+
+	if (!has_queue)
+		return;
+
+	lines.emplace_back(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN);
+	for (auto &entry : entries)
+		for (auto &line : entry)
+			lines.emplace_back(std::move(line));
+	lines.emplace_back(PLAYLIST_STATE_FILE_PLAYLIST_END);
+}
+
+char *
+MergedStateFile::ReadLine()
+{
+	if (next >= lines.size())
+		return nullptr;
+
+	return lines[next++].data();
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_STATE_JOURNAL_HXX
+#define MPD_STATE_JOURNAL_HXX
+
+#include "io/LineReader.hxx"
+
+#include <string>
+#include <vector>
+
+#define STATE_JOURNAL_BEGIN "journal_begin"
+#define STATE_JOURNAL_END "journal_end"
+
+/**
+ * Combines a state file with the records of its journal (which were
+ * appended by #StateFile after the state file was written) and
+ * provides the result as one complete state file.
+ *
+ * Each journal record contains all state lines (which replace those
+ * of the state file), but only the changed part of the queue: its
+ * new length and the songs which were modified (see
+ * playlist_state_save_delta()).  Incomplete records (e.g. after a
+ * crash while appending) are ignored.
+ */
+class MergedStateFile final : public LineReader {
+	std::vector<std::string> lines;
+
+	std::size_t next = 0;
+
+public:
+	/**
+	 * Throws on I/O error.
+	 */
+	MergedStateFile(LineReader &base, LineReader *journal);
+
+	/* virtual methods from class LineReader */
+	char *ReadLine() override;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "Stats.hxx"
 #include "player/Control.hxx"
+#include "client/Config.hxx"
 #include "client/Response.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -34,6 +35,10 @@
 #include "system/Clock.hxx"
 #endif
 
+#ifdef ENABLE_CHROMAPRINT
+#include "FingerprintService.hxx"
+#endif
+
 #include <fmt/format.h>
 
 #include <chrono>
@@ -126,9 +131,26 @@ stats_print(Response &r, const Partition &partition)
 #endif
 
 	r.Fmt(FMT_STRING("uptime: {}\n"
-			 "playtime: {}\n"),
+			 "playtime: {}\n"
+			 "queue_memory: {}\n"),
 	      std::chrono::duration_cast<std::chrono::seconds>(uptime).count(),
-	      lround(partition.pc.GetTotalPlayTime().count()));
+	      lround(partition.pc.GetTotalPlayTime().count()),
+	      partition.playlist.queue.GetMemoryUsage());
+
+	if (client_idle_coalesce_window > Event::Duration::zero())
+		r.Fmt(FMT_STRING("idle_delayed: {}\n"),
+		      partition.instance.n_idle_delayed.load());
+
+#ifdef ENABLE_CHROMAPRINT
+	if (const auto *fingerprint = partition.instance.fingerprint_service.get();
+	    fingerprint != nullptr && fingerprint->IsUsed()) {
+		const auto s = fingerprint->GetStats();
+		r.Fmt(FMT_STRING("fingerprint_queue: {}\n"
+				 "fingerprint_done: {}\n"
+				 "fingerprint_failed: {}\n"),
+		      s.queued, s.done, s.failed);
+	}
+#endif
 
 #ifdef ENABLE_DATABASE
 	const Database *db = partition.instance.GetDatabase();
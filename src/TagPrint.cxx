@@ -36,22 +36,28 @@ tag_print_types(Response &r) noexcept
 void
 tag_print(Response &r, TagType type, std::string_view value) noexcept
 {
-	r.Fmt(FMT_STRING("{}: {}\n"), tag_item_names[type], value);
+	/* this is called for every tag of every song; bypass the
+	   format string parser */
+	r.Write(tag_item_names[type]);
+	r.Write(": ", 2);
+	r.Write(value);
+	r.Write("\n", 1);
 }
 
 void
 tag_print(Response &r, TagType type, const char *value) noexcept
 {
-	r.Fmt(FMT_STRING("{}: {}\n"), tag_item_names[type], value);
+	tag_print(r, type, std::string_view{value});
 }
 
 void
 tag_print_values(Response &r, const Tag &tag) noexcept
 {
 	const auto tag_mask = r.GetTagMask();
-	for (const auto &i : tag)
-		if (tag_mask.Test(i.type))
-			tag_print(r, i.type, i.value);
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i)
+		if (tag_mask.Test(types[i]))
+			tag_print(r, types[i], tag.items[i]->value);
 }
 
 void
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagScanPool.hxx"
+#include "TagStream.hxx"
+#include "tag/Builder.hxx"
+#include "thread/Name.hxx"
+
+#include <cassert>
+
+void
+TagScanPool::UriTask::Run() noexcept
+{
+	try {
+		TagBuilder builder;
+		result.found = tag_stream_scan(uri.c_str(), builder,
+					       &result.audio_format);
+		if (result.found)
+			builder.Commit(result.tag);
+	} catch (...) {
+		result.error = std::current_exception();
+	}
+}
+
+void
+TagScanPool::UriTask::OnTagScanDone() noexcept
+{
+	pool.uri_tasks.erase(pool.uri_tasks.iterator_to(*this));
+
+	requests.clear_and_dispose([this](TagScanRequest *request){
+		request->task = nullptr;
+		request->OnTagScanResult(result);
+	});
+
+	delete this;
+}
+
+TagScanPool::TagScanPool(unsigned _max_threads) noexcept
+	:max_threads(_max_threads)
+{
+	assert(max_threads > 0);
+}
+
+TagScanPool::~TagScanPool() noexcept
+{
+	Stop();
+
+	/* all tasks must have been cancelled by their owners */
+	assert(interactive.empty());
+	assert(bulk.empty());
+	assert(uri_tasks.empty());
+}
+
+void
+TagScanPool::SetMinThreads(unsigned n) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	if (n > max_threads)
+		max_threads = n;
+}
+
+void
+TagScanPool::Stop() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		pending_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+
+	threads.clear();
+	n_threads = 0;
+}
+
+void
+TagScanPool::Enqueue(TagScanTask &task, TagScanPriority priority)
+{
+	assert(task.state == TagScanTask::State::IDLE);
+	assert(!quit);
+
+	if (n_idle == 0 && n_threads < max_threads) {
+		auto &thread = threads.emplace_front(BIND_THIS_METHOD(RunThread));
+
+		try {
+			thread.Start();
+			++n_threads;
+		} catch (...) {
+			threads.pop_front();
+
+			/* if there is no thread at all, the task would
+			   never be executed */
+			if (n_threads == 0)
+				throw;
+		}
+	}
+
+	task.state = TagScanTask::State::PENDING;
+	task.priority = priority;
+	GetQueue(priority).push_back(task);
+	pending_cond.notify_one();
+}
+
+void
+TagScanPool::Submit(TagScanTask &task, TagScanPriority priority)
+{
+	const std::scoped_lock lock{mutex};
+	Enqueue(task, priority);
+}
+
+bool
+TagScanPool::Cancel(TagScanTask &task) noexcept
+{
+	std::unique_lock lock{mutex};
+
+	switch (task.state) {
+	case TagScanTask::State::IDLE:
+	case TagScanTask::State::DONE:
+		break;
+
+	case TagScanTask::State::PENDING:
+		GetQueue(task.priority).erase(TaskList::iterator_to(task));
+		task.state = TagScanTask::State::IDLE;
+		return true;
+
+	case TagScanTask::State::RUNNING:
+		finished_cond.wait(lock, [&task]{
+			return task.state == TagScanTask::State::DONE;
+		});
+		break;
+	}
+
+	return false;
+}
+
+void
+TagScanPool::Lookup(std::string_view uri, TagScanPriority priority,
+		    TagScanRequest &request)
+{
+	const std::scoped_lock lock{mutex};
+
+	assert(request.task == nullptr);
+
+	auto [position, inserted] = uri_tasks.insert_check(uri);
+	if (inserted) {
+		auto *task = new UriTask(*this, uri);
+
+		try {
+			Enqueue(*task, priority);
+		} catch (...) {
+			delete task;
+			throw;
+		}
+
+		uri_tasks.insert(position, *task);
+		position = uri_tasks.iterator_to(*task);
+	} else if (position->state == TagScanTask::State::PENDING &&
+		   priority > position->priority) {
+		/* somebody is waiting for it now: move it to the
+		   front queue */
+		GetQueue(position->priority).erase(TaskList::iterator_to(*position));
+		position->priority = priority;
+		GetQueue(priority).push_back(*position);
+	}
+
+	position->requests.push_back(request);
+	request.task = &*position;
+}
+
+void
+TagScanPool::CancelLookup(TagScanRequest &request) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	if (request.task == nullptr)
+		/* not active or already finished */
+		return;
+
+	auto &task = static_cast<UriTask &>(*request.task);
+	task.requests.erase(task.requests.iterator_to(request));
+	request.task = nullptr;
+
+	if (task.requests.empty() &&
+	    task.state == TagScanTask::State::PENDING) {
+		/* nobody is interested in this task anymore, and it
+		   has not been started yet: discard it */
+		GetQueue(task.priority).erase(TaskList::iterator_to(task));
+		uri_tasks.erase(uri_tasks.iterator_to(task));
+		delete &task;
+	}
+}
+
+void
+TagScanPool::RunThread() noexcept
+{
+	SetThreadName("tag_scan");
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		++n_idle;
+		pending_cond.wait(lock, [this]{
+			return quit || !interactive.empty() || !bulk.empty();
+		});
+		--n_idle;
+
+		if (quit)
+			break;
+
+		auto &queue = interactive.empty() ? bulk : interactive;
+		auto &task = queue.front();
+		queue.pop_front();
+		task.state = TagScanTask::State::RUNNING;
+
+		lock.unlock();
+		task.Run();
+		lock.lock();
+
+		task.state = TagScanTask::State::DONE;
+		finished_cond.notify_all();
+
+		/* this may delete the task, so this is the last
+		   access */
+		task.OnTagScanDone();
+	}
+}
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_TAG_SCAN_POOL_HXX
+#define MPD_TAG_SCAN_POOL_HXX
+
+#include "tag/Tag.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/IntrusiveHashSet.hxx"
+
+#include <cstdint>
+#include <exception>
+#include <forward_list>
+#include <functional>
+#include <string>
+#include <string_view>
+
+class TagScanPool;
+
+enum class TagScanPriority : uint8_t {
+	/**
+	 * Background work such as a database update.
+	 */
+	BULK,
+
+	/**
+	 * A client is waiting for the result; this is executed
+	 * before all #BULK tasks.
+	 */
+	INTERACTIVE,
+};
+
+/**
+ * A unit of work for the #TagScanPool.
+ */
+class TagScanTask {
+	friend class TagScanPool;
+
+	IntrusiveListHook<> tag_scan_siblings;
+
+	enum class State : uint8_t {
+		IDLE,
+		PENDING,
+		RUNNING,
+		DONE,
+	};
+
+	/**
+	 * Protected by the #TagScanPool's mutex.
+	 */
+	State state = State::IDLE;
+
+	TagScanPriority priority = TagScanPriority::BULK;
+
+public:
+	TagScanTask() noexcept = default;
+	virtual ~TagScanTask() noexcept = default;
+
+	TagScanTask(const TagScanTask &) = delete;
+	TagScanTask &operator=(const TagScanTask &) = delete;
+
+protected:
+	/**
+	 * Do the work.  This runs in a pool thread, without holding
+	 * the pool's mutex.
+	 */
+	virtual void Run() noexcept = 0;
+
+	/**
+	 * Called in the pool thread after Run(), while the pool's
+	 * mutex is locked.  This is the pool's last access to this
+	 * object; the implementation may delete it.  It must not
+	 * block and must not call #TagScanPool methods.
+	 */
+	virtual void OnTagScanDone() noexcept {}
+};
+
+/**
+ * The result of TagScanPool::Lookup().
+ */
+struct TagScanResult {
+	Tag tag;
+
+	AudioFormat audio_format = AudioFormat::Undefined();
+
+	/**
+	 * False if no plugin was able to scan the resource.
+	 */
+	bool found = false;
+
+	/**
+	 * Set if scanning has failed with an exception.
+	 */
+	std::exception_ptr error;
+};
+
+/**
+ * A listener waiting for the result of TagScanPool::Lookup().
+ */
+class TagScanRequest : public IntrusiveListHook<> {
+	friend class TagScanPool;
+
+	/**
+	 * The task this request is attached to; nullptr if the
+	 * request is not active.  Protected by the #TagScanPool's
+	 * mutex.
+	 */
+	TagScanTask *task = nullptr;
+
+public:
+	/**
+	 * The scan has finished.  This is called in a pool thread
+	 * while the pool's mutex is locked; it must not block and
+	 * must not call #TagScanPool methods.  Usually, the
+	 * implementation copies the result and schedules an
+	 * #InjectEvent.
+	 */
+	virtual void OnTagScanResult(const TagScanResult &result) noexcept = 0;
+};
+
+/**
+ * A pool of threads which scan tags of song files and streams, shared
+ * by the whole daemon.  Interactive requests (from clients waiting
+ * for a response) are executed before bulk work (database updates),
+ * and concurrent lookups of the same URI are coalesced into one
+ * scan.
+ *
+ * Threads are launched on demand (up to the configured maximum) and
+ * are kept until the pool is stopped.
+ */
+class TagScanPool {
+	/**
+	 * A task created by Lookup().  It deletes itself after all
+	 * of its requests have been invoked.
+	 */
+	class UriTask final
+		: public TagScanTask, public IntrusiveHashSetHook<>
+	{
+		TagScanPool &pool;
+
+	public:
+		const std::string uri;
+
+		/**
+		 * The #TagScanRequest instances waiting for this
+		 * task.  Protected by the pool's mutex.
+		 */
+		IntrusiveList<TagScanRequest> requests;
+
+	private:
+		TagScanResult result;
+
+	public:
+		UriTask(TagScanPool &_pool, std::string_view _uri) noexcept
+			:pool(_pool), uri(_uri) {}
+
+		struct Hash : std::hash<std::string_view> {
+			using std::hash<std::string_view>::operator();
+
+			[[gnu::pure]]
+			std::size_t operator()(const UriTask &task) const noexcept {
+				return std::hash<std::string_view>::operator()(task.uri);
+			}
+		};
+
+		struct Equal {
+			[[gnu::pure]]
+			bool operator()(const UriTask &a,
+					const UriTask &b) const noexcept {
+				return a.uri == b.uri;
+			}
+
+			[[gnu::pure]]
+			bool operator()(std::string_view a,
+					const UriTask &b) const noexcept {
+				return a == b.uri;
+			}
+		};
+
+	protected:
+		/* virtual methods from class TagScanTask */
+		void Run() noexcept override;
+		void OnTagScanDone() noexcept override;
+	};
+
+	unsigned max_threads;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a task was added to a queue or when #quit
+	 * was set.
+	 */
+	Cond pending_cond;
+
+	/**
+	 * Signalled when a task has finished running.
+	 */
+	Cond finished_cond;
+
+	using TaskList =
+		IntrusiveList<TagScanTask,
+			      IntrusiveListMemberHookTraits<&TagScanTask::tag_scan_siblings>>;
+
+	/**
+	 * Pending tasks, one queue per #TagScanPriority.
+	 */
+	TaskList interactive, bulk;
+
+	/**
+	 * All #UriTask instances which are pending or running,
+	 * indexed by their URI.
+	 */
+	IntrusiveHashSet<UriTask, 61> uri_tasks;
+
+	std::forward_list<Thread> threads;
+
+	unsigned n_threads = 0;
+
+	/**
+	 * The number of threads waiting for a new task.
+	 */
+	unsigned n_idle = 0;
+
+	bool quit = false;
+
+public:
+	explicit TagScanPool(unsigned _max_threads) noexcept;
+	~TagScanPool() noexcept;
+
+	TagScanPool(const TagScanPool &) = delete;
+	TagScanPool &operator=(const TagScanPool &) = delete;
+
+	/**
+	 * Allow at least this number of threads.
+	 */
+	void SetMinThreads(unsigned n) noexcept;
+
+	/**
+	 * Enqueue a task.  It will be executed by one of the threads
+	 * as soon as one is available, and after all pending tasks
+	 * with a higher priority.
+	 *
+	 * Throws if no thread could be launched.
+	 */
+	void Submit(TagScanTask &task, TagScanPriority priority);
+
+	/**
+	 * Remove the task from the queue if it has not been started
+	 * yet, or wait until it has finished running.  After this
+	 * method returns, the pool does not reference the task
+	 * anymore.
+	 *
+	 * @return true if the task was removed from the queue before
+	 * it was started
+	 */
+	bool Cancel(TagScanTask &task) noexcept;
+
+	/**
+	 * Scan the tags of the given (remote) URI with
+	 * tag_stream_scan() and pass the result to the request.  If
+	 * the same URI is already being scanned, the request is
+	 * attached to the existing task, which gets promoted to the
+	 * given priority.
+	 *
+	 * Throws if no thread could be launched.
+	 */
+	void Lookup(std::string_view uri, TagScanPriority priority,
+		    TagScanRequest &request);
+
+	/**
+	 * Detach the request from its task; after this method
+	 * returns, the request will not be invoked.  If it was the
+	 * last request of a task which has not been started yet, the
+	 * task is discarded.
+	 */
+	void CancelLookup(TagScanRequest &request) noexcept;
+
+	/**
+	 * Wait for all running tasks to finish and stop all threads.
+	 * Pending tasks are not executed.
+	 */
+	void Stop() noexcept;
+
+private:
+	/**
+	 * Caller must lock the mutex.
+	 */
+	void Enqueue(TagScanTask &task, TagScanPriority priority);
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	TaskList &GetQueue(TagScanPriority priority) noexcept {
+		return priority == TagScanPriority::INTERACTIVE
+			? interactive
+			: bulk;
+	}
+
+	void RunThread() noexcept;
+};
+
+#endif
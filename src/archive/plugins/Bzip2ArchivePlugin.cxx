@@ -22,26 +22,52 @@
   */
 
 #include "Bzip2ArchivePlugin.hxx"
+#include "Bzip2Index.hxx"
 #include "../ArchivePlugin.hxx"
 #include "../ArchiveFile.hxx"
 #include "../ArchiveVisitor.hxx"
 #include "input/InputStream.hxx"
 #include "input/LocalOpen.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
 #include "fs/Path.hxx"
 
 #include <bzlib.h>
 
+#include <array>
+#include <chrono>
+#include <list>
 #include <stdexcept>
 #include <utility>
 
+#include <string.h>
+
+/**
+ * The block indexes of recently opened bzip2 files, to allow fast
+ * seeking after reopening a file.
+ */
+struct Bzip2IndexCacheItem {
+	AllocatedPath path;
+	uint_least64_t size;
+	std::chrono::system_clock::time_point mtime;
+	std::shared_ptr<Bzip2Index> index;
+};
+
+static constexpr std::size_t BZ2_INDEX_CACHE_SIZE = 16;
+
+static Mutex bz2_index_cache_mutex;
+static std::list<Bzip2IndexCacheItem> bz2_index_cache;
+
 class Bzip2ArchiveFile final : public ArchiveFile {
+	const AllocatedPath path;
 	std::string name;
-	std::shared_ptr<InputStream> istream;
+	const std::shared_ptr<Bzip2Index> index;
 
 public:
-	Bzip2ArchiveFile(Path path, InputStreamPtr &&_is)
-		:name(path.GetBase().c_str()),
-		 istream(std::move(_is)) {
+	Bzip2ArchiveFile(Path _path, std::shared_ptr<Bzip2Index> &&_index)
+		:path(_path),
+		 name(_path.GetBase().c_str()),
+		 index(std::move(_index)) {
 		// remove .bz2 suffix
 		const size_t len = name.length();
 		if (len > 4)
@@ -56,17 +82,52 @@ public:
 				  Mutex &mutex) override;
 };
 
+/**
+ * Decompresses one block at a time (see #Bzip2Index), which makes
+ * this stream seekable: a seek decompresses at most the block
+ * containing the new offset, unless the #Bzip2Index does not know
+ * the block yet.
+ */
 class Bzip2InputStream final : public InputStream {
-	std::shared_ptr<InputStream> input;
+	const InputStreamPtr input;
+
+	const std::shared_ptr<Bzip2Index> index;
+
+	/**
+	 * The current block number (or the next one if #decoding is
+	 * false).
+	 */
+	std::size_t block = 0;
+
+	/**
+	 * The uncompressed offset of the current block.
+	 */
+	offset_type block_offset = 0;
+
+	/**
+	 * The number of bytes decompressed from the current block.
+	 */
+	offset_type block_position = 0;
+
+	/**
+	 * The current block wrapped in a bzip2 stream, see
+	 * Bzip2MakeBlockStream().
+	 */
+	std::vector<std::byte> block_stream;
 
 	bz_stream bzstream{};
 
+	/**
+	 * Has #bzstream been initialized for the current block?
+	 */
+	bool decoding = false;
+
 	bool eof = false;
 
-	char buffer[5000];
+	std::array<std::byte, 65536> scan_buffer;
 
 public:
-	Bzip2InputStream(std::shared_ptr<InputStream> _input,
+	Bzip2InputStream(Path path, std::shared_ptr<Bzip2Index> _index,
 			 const char *uri,
 			 Mutex &mutex);
 	~Bzip2InputStream() noexcept override;
@@ -78,104 +139,343 @@ public:
 	[[nodiscard]] bool IsEOF() const noexcept override;
 	size_t Read(std::unique_lock<Mutex> &lock,
 		    void *ptr, size_t size) override;
+	void Seek(std::unique_lock<Mutex> &lock,
+		  offset_type offset) override;
 
 private:
-	void Open();
-	bool FillBuffer();
+	void UpdateSize() noexcept;
+
+	/**
+	 * Scan more compressed data for block boundaries.  Caller must
+	 * lock the #index mutex.
+	 */
+	void ScanMore();
+
+	/**
+	 * Prepare decompressing the current #block.
+	 *
+	 * @return false if the end of the file was reached
+	 */
+	bool OpenBlock();
+
+	void CloseBlock() noexcept;
+
+	/**
+	 * Decompress data, opening the next block if necessary.  The
+	 * #mutex must not be locked.
+	 *
+	 * @return the number of bytes (0 at the end of the file)
+	 */
+	size_t Decompress(void *ptr, size_t length);
+
+	/**
+	 * Implementation of Seek() without the #mutex locked.
+	 *
+	 * @return the new offset, which is smaller than the requested
+	 * one if the end of the file was reached
+	 */
+	offset_type SeekUnlocked(offset_type new_offset);
 };
 
 /* archive open && listing routine */
 
+static void
+bz2_finish() noexcept
+{
+	const std::scoped_lock lock{bz2_index_cache_mutex};
+	bz2_index_cache.clear();
+}
+
+/**
+ * Check the magic number at the beginning of a bzip2 file.
+ */
+static void
+bz2_check_header(Path path)
+{
+	Mutex mutex;
+	auto is = OpenLocalInputStream(path, mutex);
+
+	char header[4];
+	is->LockReadFull(header, sizeof(header));
+
+	if (memcmp(header, "BZh", 3) != 0 ||
+	    header[3] < '1' || header[3] > '9')
+		throw std::runtime_error("Not a bzip2 file");
+}
+
+static std::shared_ptr<Bzip2Index>
+bz2_get_index(Path path)
+{
+	const AllocatedPath key{path};
+	const FileInfo info(path);
+
+	const std::scoped_lock lock{bz2_index_cache_mutex};
+
+	for (auto i = bz2_index_cache.begin(); i != bz2_index_cache.end(); ++i) {
+		if (i->path != key)
+			continue;
+
+		if (i->size == info.GetSize() &&
+		    i->mtime == info.GetModificationTime()) {
+			/* move to the front (most recently used) */
+			bz2_index_cache.splice(bz2_index_cache.begin(),
+					       bz2_index_cache, i);
+			return i->index;
+		}
+
+		/* the file was modified */
+		bz2_index_cache.erase(i);
+		break;
+	}
+
+	bz2_check_header(path);
+
+	auto index = std::make_shared<Bzip2Index>();
+	bz2_index_cache.push_front({
+			key,
+			info.GetSize(),
+			info.GetModificationTime(),
+			index,
+		});
+
+	if (bz2_index_cache.size() > BZ2_INDEX_CACHE_SIZE)
+		bz2_index_cache.pop_back();
+
+	return index;
+}
+
 static std::unique_ptr<ArchiveFile>
 bz2_open(Path pathname)
 {
-	static Mutex mutex;
-	auto is = OpenLocalInputStream(pathname, mutex);
-	return std::make_unique<Bzip2ArchiveFile>(pathname, std::move(is));
+	return std::make_unique<Bzip2ArchiveFile>(pathname,
+						  bz2_get_index(pathname));
 }
 
 /* single archive handling */
 
-Bzip2InputStream::Bzip2InputStream(std::shared_ptr<InputStream> _input,
+Bzip2InputStream::Bzip2InputStream(Path path,
+				   std::shared_ptr<Bzip2Index> _index,
 				   const char *_uri,
 				   Mutex &_mutex)
 	:InputStream(_uri, _mutex),
-	 input(std::move(_input))
+	 input(OpenLocalInputStream(path, _mutex)),
+	 index(std::move(_index))
 {
-	bzstream.next_in = (char *)buffer;
-
-	int ret = BZ2_bzDecompressInit(&bzstream, 0, 0);
-	if (ret != BZ_OK)
-		throw std::runtime_error("BZ2_bzDecompressInit() has failed");
-
+	seekable = true;
+	UpdateSize();
 	SetReady();
 }
 
 Bzip2InputStream::~Bzip2InputStream() noexcept
 {
-	BZ2_bzDecompressEnd(&bzstream);
+	CloseBlock();
 }
 
 InputStreamPtr
-Bzip2ArchiveFile::OpenStream(const char *path,
+Bzip2ArchiveFile::OpenStream(const char *_path,
 			     Mutex &mutex)
 {
-	return std::make_unique<Bzip2InputStream>(istream, path, mutex);
+	return std::make_unique<Bzip2InputStream>(path, index, _path, mutex);
+}
+
+void
+Bzip2InputStream::UpdateSize() noexcept
+{
+	const std::scoped_lock lock{index->mutex};
+
+	if (const auto total = index->GetSize();
+	    total != Bzip2Index::UNKNOWN_SIZE)
+		size = total;
 }
 
-inline bool
-Bzip2InputStream::FillBuffer()
+void
+Bzip2InputStream::ScanMore()
+{
+	assert(!index->IsComplete());
+
+	input->LockSeek(index->GetScanPosition());
+
+	const size_t nbytes = input->LockRead(scan_buffer.data(),
+					      scan_buffer.size());
+	if (nbytes == 0)
+		index->ScanEnd();
+	else
+		index->Scan(std::span{scan_buffer}.first(nbytes));
+}
+
+bool
+Bzip2InputStream::OpenBlock()
 {
-	if (bzstream.avail_in > 0)
-		return true;
+	assert(!decoding);
 
-	size_t count = input->LockRead(buffer, sizeof(buffer));
-	if (count == 0)
-		return false;
+	Bzip2Index::Block b;
 
-	bzstream.next_in = buffer;
-	bzstream.avail_in = count;
+	{
+		const std::scoped_lock lock{index->mutex};
+
+		while (block >= index->GetBlockCount()) {
+			if (index->IsTruncated())
+				throw std::runtime_error("Unexpected end of bzip2 file");
+
+			if (index->IsComplete())
+				return false;
+
+			ScanMore();
+		}
+
+		b = index->GetBlock(block);
+	}
+
+	/* read the compressed block */
+
+	const offset_type first = b.begin / 8;
+	const offset_type last = (b.end + 7) / 8;
+
+	std::vector<std::byte> src(last - first);
+	input->LockSeek(first);
+	input->LockReadFull(src.data(), src.size());
+
+	block_stream = Bzip2MakeBlockStream(src, b.begin % 8,
+					    b.end - b.begin);
+
+	bzstream = {};
+	if (BZ2_bzDecompressInit(&bzstream, 0, 0) != BZ_OK)
+		throw std::runtime_error("BZ2_bzDecompressInit() has failed");
+
+	bzstream.next_in = (char *)block_stream.data();
+	bzstream.avail_in = block_stream.size();
+	block_position = 0;
+	decoding = true;
 	return true;
 }
 
+void
+Bzip2InputStream::CloseBlock() noexcept
+{
+	if (!decoding)
+		return;
+
+	BZ2_bzDecompressEnd(&bzstream);
+	decoding = false;
+}
+
+size_t
+Bzip2InputStream::Decompress(void *ptr, size_t length)
+{
+	while (true) {
+		if (!decoding && !OpenBlock())
+			return 0;
+
+		bzstream.next_out = (char *)ptr;
+		bzstream.avail_out = length;
+
+		const int bz_result = BZ2_bzDecompress(&bzstream);
+		const size_t nbytes = length - bzstream.avail_out;
+		block_position += nbytes;
+
+		if (bz_result == BZ_STREAM_END) {
+			{
+				const std::scoped_lock lock{index->mutex};
+				index->SetBlockSize(block, block_position);
+			}
+
+			CloseBlock();
+			block_offset += block_position;
+			block_position = 0;
+			++block;
+		} else if (bz_result != BZ_OK)
+			throw std::runtime_error("BZ2_bzDecompress() has failed");
+		else if (nbytes == 0 && bzstream.avail_in == 0)
+			/* the whole block was passed to libbz2, but
+			   it wants more */
+			throw std::runtime_error("Corrupt bzip2 block");
+
+		if (nbytes > 0)
+			return nbytes;
+	}
+}
+
 size_t
 Bzip2InputStream::Read(std::unique_lock<Mutex> &, void *ptr, size_t length)
 {
 	if (eof)
 		return 0;
 
-	const ScopeUnlock unlock(mutex);
+	size_t nbytes;
 
-	bzstream.next_out = (char *)ptr;
-	bzstream.avail_out = length;
+	{
+		const ScopeUnlock unlock(mutex);
+		nbytes = Decompress(ptr, length);
+	}
 
-	do {
-		const bool had_input = FillBuffer();
+	if (nbytes == 0) {
+		eof = true;
+		UpdateSize();
+	}
 
-		const int bz_result = BZ2_bzDecompress(&bzstream);
+	offset += nbytes;
+	return nbytes;
+}
 
-		if (bz_result == BZ_STREAM_END) {
-			eof = true;
+InputStream::offset_type
+Bzip2InputStream::SeekUnlocked(offset_type new_offset)
+{
+	offset_type position = block_offset + block_position;
+
+	const auto [i, i_offset] = [this, new_offset]{
+		const std::scoped_lock lock{index->mutex};
+		return index->FindBlock(new_offset);
+	}();
+
+	if (new_offset < position || i_offset > position) {
+		/* jump to the block which contains the new offset
+		   (or the last block known to be before it) */
+		CloseBlock();
+		block = i;
+		block_offset = position = i_offset;
+		block_position = 0;
+	}
+
+	/* decompress up to the new offset */
+	std::array<std::byte, 16384> discard;
+	while (position < new_offset) {
+		const size_t nbytes =
+			Decompress(discard.data(),
+				   std::min<offset_type>(discard.size(),
+							 new_offset - position));
+		if (nbytes == 0)
 			break;
-		}
 
-		if (bz_result != BZ_OK)
-			throw std::runtime_error("BZ2_bzDecompress() has failed");
+		position += nbytes;
+	}
 
-		if (!had_input && bzstream.avail_out == length)
-			throw std::runtime_error("Unexpected end of bzip2 file");
-	} while (bzstream.avail_out == length);
+	return position;
+}
 
-	const size_t nbytes = length - bzstream.avail_out;
-	offset += nbytes;
+void
+Bzip2InputStream::Seek(std::unique_lock<Mutex> &, offset_type new_offset)
+{
+	offset_type position;
 
-	return nbytes;
+	{
+		const ScopeUnlock unlock(mutex);
+		position = SeekUnlocked(new_offset);
+	}
+
+	offset = position;
+	eof = false;
+
+	if (position < new_offset) {
+		eof = true;
+		UpdateSize();
+		throw std::runtime_error("Invalid seek offset");
+	}
 }
 
 bool
 Bzip2InputStream::IsEOF() const noexcept
 {
-	return eof;
+	return eof || (KnownSize() && offset == size);
 }
 
 /* exported structures */
@@ -188,7 +488,7 @@ static constexpr const char *bz2_extensions[] = {
 const ArchivePlugin bz2_archive_plugin = {
 	"bz2",
 	nullptr,
-	nullptr,
+	bz2_finish,
 	bz2_open,
 	bz2_extensions,
 };
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Bzip2Index.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+/**
+ * The 48 bit magic number which starts each block (BCD of pi).
+ */
+static constexpr uint_least64_t BZIP2_BLOCK_MAGIC = 0x314159265359;
+
+/**
+ * The 48 bit magic number which ends each stream (BCD of sqrt(pi)).
+ */
+static constexpr uint_least64_t BZIP2_EOS_MAGIC = 0x177245385090;
+
+static constexpr uint_least64_t BZIP2_MAGIC_MASK = 0xffffffffffff;
+
+static constexpr unsigned BZIP2_MAGIC_BITS = 48;
+
+inline void
+Bzip2Index::OnMagic(uint_least64_t bit_offset, bool end_of_stream) noexcept
+{
+	if (open_block != NO_BLOCK)
+		blocks.push_back({open_block, bit_offset});
+
+	open_block = end_of_stream ? NO_BLOCK : bit_offset;
+}
+
+void
+Bzip2Index::Scan(std::span<const std::byte> src) noexcept
+{
+	assert(!complete);
+
+	for (const std::byte b : src) {
+		shift_register = (shift_register << 8) | uint_least64_t(b);
+		++scan_position;
+
+		/* check all 8 bit positions at which a magic number
+		   may end in this byte, earliest first */
+		for (unsigned s = 8; s-- > 0;) {
+			if (BZIP2_MAGIC_BITS + s > scan_position * 8)
+				continue;
+
+			const uint_least64_t value =
+				(shift_register >> s) & BZIP2_MAGIC_MASK;
+			if (value == BZIP2_BLOCK_MAGIC ||
+			    value == BZIP2_EOS_MAGIC) [[unlikely]]
+				OnMagic(scan_position * 8 - s - BZIP2_MAGIC_BITS,
+					value == BZIP2_EOS_MAGIC);
+		}
+	}
+}
+
+std::pair<std::size_t, uint_least64_t>
+Bzip2Index::FindBlock(uint_least64_t offset) const noexcept
+{
+	assert(!offsets.empty());
+
+	/* the first element larger than the offset; never the first
+	   one, which is zero */
+	const auto i = std::upper_bound(offsets.begin(), offsets.end(),
+					offset);
+	assert(i != offsets.begin());
+
+	const auto j = std::prev(i);
+	return {std::size_t(std::distance(offsets.begin(), j)), *j};
+}
+
+void
+Bzip2Index::SetBlockSize(std::size_t i, uint_least64_t size) noexcept
+{
+	assert(i < blocks.size());
+	assert(i < offsets.size());
+
+	if (i + 1 == offsets.size())
+		offsets.push_back(offsets[i] + size);
+	else
+		assert(offsets[i + 1] == offsets[i] + size);
+}
+
+uint_least64_t
+Bzip2Index::GetSize() const noexcept
+{
+	if (!complete || open_block != NO_BLOCK ||
+	    offsets.size() <= blocks.size())
+		return UNKNOWN_SIZE;
+
+	return offsets.back();
+}
+
+namespace {
+
+/**
+ * Writes bits (most significant first) to a byte vector.
+ */
+class BitWriter {
+	std::vector<std::byte> &dest;
+
+	uint_least32_t bits = 0;
+	unsigned n_bits = 0;
+
+public:
+	explicit BitWriter(std::vector<std::byte> &_dest) noexcept
+		:dest(_dest) {}
+
+	void Write(uint_least32_t value, unsigned n) noexcept {
+		assert(n <= 24);
+
+		bits = (bits << n) | (value & ((uint_least32_t(1) << n) - 1));
+		n_bits += n;
+
+		while (n_bits >= 8) {
+			n_bits -= 8;
+			dest.push_back(std::byte(bits >> n_bits));
+		}
+	}
+
+	/**
+	 * Pad the last byte with zero bits.
+	 */
+	void Flush() noexcept {
+		if (n_bits > 0)
+			Write(0, 8 - n_bits);
+	}
+};
+
+}
+
+/**
+ * Read up to 8 bits at the given bit offset.
+ */
+[[gnu::pure]]
+static unsigned
+ReadBits(std::span<const std::byte> src, uint_least64_t bit_offset,
+	 unsigned n) noexcept
+{
+	assert(n <= 8);
+
+	const std::size_t i = bit_offset / 8;
+	const unsigned shift = bit_offset % 8;
+
+	unsigned value = unsigned(src[i]) << 8;
+	if (shift + n > 8)
+		value |= unsigned(src[i + 1]);
+
+	return (value >> (16 - shift - n)) & ((1U << n) - 1);
+}
+
+std::vector<std::byte>
+Bzip2MakeBlockStream(std::span<const std::byte> src,
+		     unsigned shift, uint_least64_t n_bits) noexcept
+{
+	assert(shift < 8);
+	assert(n_bits >= 80);
+	assert(src.size() * 8 >= shift + n_bits);
+
+	std::vector<std::byte> dest;
+	dest.reserve(4 + n_bits / 8 + 12);
+
+	/* the stream header; always declare the maximum block size,
+	   because the block may be from a stream with another
+	   one */
+	for (const char ch : {'B', 'Z', 'h', '9'})
+		dest.push_back(std::byte(ch));
+
+	/* copy the block; the destination is byte-aligned now */
+	const std::size_t n_bytes = n_bits / 8;
+	if (shift == 0) {
+		dest.insert(dest.end(), src.begin(),
+			    std::next(src.begin(), n_bytes));
+	} else {
+		for (std::size_t i = 0; i < n_bytes; ++i)
+			dest.push_back((src[i] << shift) |
+				       (src[i + 1] >> (8 - shift)));
+	}
+
+	BitWriter w(dest);
+
+	if (const unsigned rest = n_bits % 8; rest > 0)
+		w.Write(ReadBits(src, shift + n_bytes * 8, rest), rest);
+
+	/* the end-of-stream magic */
+	w.Write(uint_least32_t(BZIP2_EOS_MAGIC >> 24), 24);
+	w.Write(uint_least32_t(BZIP2_EOS_MAGIC & 0xffffff), 24);
+
+	/* the combined checksum of a stream with only one block is
+	   the checksum of that block, which follows its magic */
+	for (unsigned i = 0; i < 4; ++i)
+		w.Write(ReadBits(src, shift + BZIP2_MAGIC_BITS + i * 8, 8), 8);
+
+	w.Flush();
+	return dest;
+}
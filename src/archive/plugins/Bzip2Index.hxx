@@ -0,0 +1,191 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_ARCHIVE_BZIP2_INDEX_HXX
+#define MPD_ARCHIVE_BZIP2_INDEX_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * An index of the blocks in a bzip2 file.  bzip2 compresses each
+ * block (up to 900 kB of input) independently, so a block can be
+ * decompressed without decompressing the blocks before it, if only
+ * its position in the compressed file is known.  This allows seeking
+ * in bounded time.
+ *
+ * Block boundaries are found by scanning the compressed data for the
+ * (not byte-aligned) block and end-of-stream magic numbers.  The
+ * uncompressed offset of a block is only learned by decompressing
+ * all blocks before it; this is done by Bzip2InputStream, which
+ * reports the block sizes with SetBlockSize().
+ */
+class Bzip2Index {
+public:
+	struct Block {
+		/**
+		 * The bit offset of the block magic in the compressed
+		 * file.
+		 */
+		uint_least64_t begin;
+
+		/**
+		 * The bit offset of the following block or
+		 * end-of-stream magic.
+		 */
+		uint_least64_t end;
+	};
+
+	static constexpr uint_least64_t UNKNOWN_SIZE = ~uint_least64_t(0);
+
+	/**
+	 * Protects all attributes.  An index may be shared by several
+	 * streams.
+	 */
+	mutable Mutex mutex;
+
+private:
+	std::vector<Block> blocks;
+
+	/**
+	 * The uncompressed offset of each block.  It contains only the
+	 * offsets which are already known; the offset of the next block
+	 * becomes known when a block has been decompressed completely.
+	 * This may have one element more than #blocks.
+	 */
+	std::vector<uint_least64_t> offsets{0};
+
+	static constexpr uint_least64_t NO_BLOCK = ~uint_least64_t(0);
+
+	/**
+	 * The last 64 bits of compressed data scanned by Scan().
+	 */
+	uint_least64_t shift_register = 0;
+
+	/**
+	 * The number of compressed bytes scanned by Scan().
+	 */
+	uint_least64_t scan_position = 0;
+
+	/**
+	 * The bit offset of the last block magic whose end has not yet
+	 * been found, or #NO_BLOCK.
+	 */
+	uint_least64_t open_block = NO_BLOCK;
+
+	/**
+	 * Has ScanEnd() been called?
+	 */
+	bool complete = false;
+
+public:
+	/**
+	 * Returns the number of compressed bytes which have been
+	 * scanned, i.e. the file offset where scanning shall continue.
+	 */
+	uint_least64_t GetScanPosition() const noexcept {
+		return scan_position;
+	}
+
+	/**
+	 * Has the whole file been scanned?
+	 */
+	bool IsComplete() const noexcept {
+		return complete;
+	}
+
+	/**
+	 * Was the end of the file reached in the middle of a block?
+	 */
+	bool IsTruncated() const noexcept {
+		return complete && open_block != NO_BLOCK;
+	}
+
+	/**
+	 * Returns the number of blocks found so far.
+	 */
+	std::size_t GetBlockCount() const noexcept {
+		return blocks.size();
+	}
+
+	const Block &GetBlock(std::size_t i) const noexcept {
+		return blocks[i];
+	}
+
+	/**
+	 * Scan more compressed data, starting at GetScanPosition().
+	 */
+	void Scan(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * The end of the compressed file has been reached.
+	 */
+	void ScanEnd() noexcept {
+		complete = true;
+	}
+
+	/**
+	 * Find the block which shall be decompressed to reach the given
+	 * uncompressed offset: the last block whose uncompressed
+	 * offset is known and not larger than the given one.  The
+	 * returned block number may be equal to GetBlockCount() if the
+	 * block has not yet been scanned.
+	 *
+	 * @return the block number and its uncompressed offset
+	 */
+	[[gnu::pure]]
+	std::pair<std::size_t, uint_least64_t> FindBlock(uint_least64_t offset) const noexcept;
+
+	/**
+	 * Report the uncompressed size of a block whose uncompressed
+	 * offset is already known.
+	 */
+	void SetBlockSize(std::size_t i, uint_least64_t size) noexcept;
+
+	/**
+	 * Returns the total uncompressed size, or #UNKNOWN_SIZE if not
+	 * all blocks have been decompressed yet.
+	 */
+	[[gnu::pure]]
+	uint_least64_t GetSize() const noexcept;
+
+private:
+	void OnMagic(uint_least64_t bit_offset, bool end_of_stream) noexcept;
+};
+
+/**
+ * Build a bzip2 stream which contains only the given block, which
+ * can be passed to BZ2_bzDecompress().  The block checksum is reused
+ * as the stream checksum.
+ *
+ * @param src the compressed data beginning with the block magic
+ * @param shift the bit position of the block magic within the first
+ * byte of #src (0 = most significant bit)
+ * @param n_bits the block size in bits
+ */
+std::vector<std::byte>
+Bzip2MakeBlockStream(std::span<const std::byte> src,
+		     unsigned shift, uint_least64_t n_bits) noexcept;
+
+#endif
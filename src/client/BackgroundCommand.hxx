@@ -42,6 +42,12 @@ public:
 	 * #Client's #EventLoop thread.
 	 */
 	virtual void Cancel() noexcept = 0;
+
+	/**
+	 * The #Client has sent all of its buffered output.  It will
+	 * be called from the #Client's #EventLoop thread.
+	 */
+	virtual void OnClientDrained() noexcept {}
 };
 
 #endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BackgroundCommandPool.hxx"
+#include "ThreadBackgroundCommand.hxx"
+#include "thread/Name.hxx"
+
+#include <cassert>
+
+BackgroundCommandPool::BackgroundCommandPool(unsigned _max_threads) noexcept
+	:max_threads(_max_threads)
+{
+	assert(max_threads > 0);
+}
+
+BackgroundCommandPool::~BackgroundCommandPool() noexcept
+{
+	Stop();
+
+	/* all commands must have been cancelled by their clients */
+	assert(pending.empty());
+}
+
+void
+BackgroundCommandPool::Stop() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		pending_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		thread.Join();
+
+	threads.clear();
+	n_threads = 0;
+}
+
+void
+BackgroundCommandPool::Submit(ThreadBackgroundCommand &cmd)
+{
+	const std::scoped_lock lock{mutex};
+
+	assert(cmd.state == ThreadBackgroundCommand::State::IDLE);
+
+	assert(!quit);
+
+	if (n_idle == 0 && n_threads < max_threads) {
+		auto &thread = threads.emplace_front(BIND_THIS_METHOD(RunThread));
+
+		try {
+			thread.Start();
+			++n_threads;
+		} catch (...) {
+			threads.pop_front();
+
+			/* if there is no thread at all, the command
+			   would never be executed */
+			if (n_threads == 0)
+				throw;
+		}
+	}
+
+	cmd.state = ThreadBackgroundCommand::State::PENDING;
+	pending.push_back(cmd);
+	pending_cond.notify_one();
+}
+
+void
+BackgroundCommandPool::Cancel(ThreadBackgroundCommand &cmd) noexcept
+{
+	std::unique_lock lock{mutex};
+
+	switch (cmd.state) {
+	case ThreadBackgroundCommand::State::IDLE:
+	case ThreadBackgroundCommand::State::DONE:
+		break;
+
+	case ThreadBackgroundCommand::State::PENDING:
+		pending.erase(pending.iterator_to(cmd));
+		cmd.state = ThreadBackgroundCommand::State::IDLE;
+		break;
+
+	case ThreadBackgroundCommand::State::RUNNING:
+		finished_cond.wait(lock, [&cmd]{
+			return cmd.state == ThreadBackgroundCommand::State::DONE;
+		});
+		break;
+	}
+}
+
+void
+BackgroundCommandPool::RunThread() noexcept
+{
+	SetThreadName("background");
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		++n_idle;
+		pending_cond.wait(lock, [this]{
+			return quit || !pending.empty();
+		});
+		--n_idle;
+
+		if (quit)
+			break;
+
+		auto &cmd = pending.front();
+		pending.pop_front();
+		cmd.state = ThreadBackgroundCommand::State::RUNNING;
+
+		lock.unlock();
+		cmd.RunInThread();
+		lock.lock();
+
+		/* once the mutex is released, the command may be
+		   deleted at any time, so this is the last access */
+		cmd.state = ThreadBackgroundCommand::State::DONE;
+		cmd.ScheduleFinish();
+		finished_cond.notify_all();
+	}
+}
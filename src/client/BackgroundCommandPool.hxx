@@ -0,0 +1,101 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_BACKGROUND_COMMAND_POOL_HXX
+#define MPD_BACKGROUND_COMMAND_POOL_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <forward_list>
+
+class ThreadBackgroundCommand;
+
+/**
+ * A bounded pool of threads which execute #ThreadBackgroundCommand
+ * instances.  Threads are launched on demand (up to the configured
+ * maximum) and are kept until the pool is destroyed.  Commands which
+ * are submitted while all threads are busy are queued.
+ */
+class BackgroundCommandPool {
+	const unsigned max_threads;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a command was added to #pending or when
+	 * #quit was set.
+	 */
+	Cond pending_cond;
+
+	/**
+	 * Signalled when a command has finished running.
+	 */
+	Cond finished_cond;
+
+	IntrusiveList<ThreadBackgroundCommand> pending;
+
+	std::forward_list<Thread> threads;
+
+	unsigned n_threads = 0;
+
+	/**
+	 * The number of threads waiting for a new command.
+	 */
+	unsigned n_idle = 0;
+
+	bool quit = false;
+
+public:
+	explicit BackgroundCommandPool(unsigned _max_threads) noexcept;
+	~BackgroundCommandPool() noexcept;
+
+	BackgroundCommandPool(const BackgroundCommandPool &) = delete;
+	BackgroundCommandPool &operator=(const BackgroundCommandPool &) = delete;
+
+	/**
+	 * Enqueue a command.  It will be executed by one of the
+	 * threads as soon as one is available.
+	 *
+	 * Throws if no thread could be launched.
+	 */
+	void Submit(ThreadBackgroundCommand &cmd);
+
+	/**
+	 * Remove the command from the queue if it has not been
+	 * started yet, or wait until it has finished running.  After
+	 * this method returns, the pool does not reference the
+	 * command anymore.
+	 */
+	void Cancel(ThreadBackgroundCommand &cmd) noexcept;
+
+	/**
+	 * Wait for all running commands to finish and stop all
+	 * threads.  Pending commands are not executed; they remain
+	 * in the queue until they get cancelled.
+	 */
+	void Stop() noexcept;
+
+private:
+	void RunThread() noexcept;
+};
+
+#endif
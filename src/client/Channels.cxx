@@ -0,0 +1,62 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Channels.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+void
+ClientChannels::Add(std::string_view channel, Client &client) noexcept
+{
+	auto i = channels.find(channel);
+	if (i == channels.end())
+		i = channels.emplace(channel, std::vector<Client *>{}).first;
+
+	assert(std::find(i->second.begin(), i->second.end(), &client) == i->second.end());
+
+	i->second.push_back(&client);
+}
+
+void
+ClientChannels::Remove(std::string_view channel, Client &client) noexcept
+{
+	const auto i = channels.find(channel);
+	if (i == channels.end())
+		return;
+
+	auto &v = i->second;
+	const auto j = std::find(v.begin(), v.end(), &client);
+	if (j == v.end())
+		return;
+
+	v.erase(j);
+	if (v.empty())
+		channels.erase(i);
+}
+
+std::span<Client *const>
+ClientChannels::Find(std::string_view channel) const noexcept
+{
+	const auto i = channels.find(channel);
+	if (i == channels.end())
+		return {};
+
+	return i->second;
+}
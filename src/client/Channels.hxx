@@ -0,0 +1,63 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CLIENT_CHANNELS_HXX
+#define MPD_CLIENT_CHANNELS_HXX
+
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Client;
+
+/**
+ * An index of the clients subscribed to each channel (of one
+ * partition), which allows "sendmessage" to address the
+ * subscribers directly instead of checking all clients.
+ */
+class ClientChannels {
+	std::map<std::string, std::vector<Client *>, std::less<>> channels;
+
+public:
+	void Add(std::string_view channel, Client &client) noexcept;
+	void Remove(std::string_view channel, Client &client) noexcept;
+
+	/**
+	 * Returns the clients subscribed to the given channel.  The
+	 * result is invalidated by the next Add() or Remove() call.
+	 */
+	[[gnu::pure]]
+	std::span<Client *const> Find(std::string_view channel) const noexcept;
+
+	/**
+	 * Iterate over all channels with at least one subscriber;
+	 * each item is a std::pair with the channel name as "first".
+	 */
+	auto begin() const noexcept {
+		return channels.begin();
+	}
+
+	auto end() const noexcept {
+		return channels.end();
+	}
+};
+
+#endif
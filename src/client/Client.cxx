@@ -22,9 +22,12 @@
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "BackgroundCommand.hxx"
+#include "Thread.hxx"
 #include "IdleFlags.hxx"
 #include "config.h"
 
+#include <stdexcept>
+
 Client::~Client() noexcept
 {
 	if (FullyBufferedSocket::IsDefined())
@@ -45,7 +48,7 @@ Client::SetBackgroundCommand(std::unique_ptr<BackgroundCommand> _bc) noexcept
 	background_command = std::move(_bc);
 
 	/* disable timeouts while in "idle" */
-	timeout_event.Cancel();
+	CancelTimeout();
 }
 
 void
@@ -62,15 +65,107 @@ Client::OnBackgroundCommandFinished() noexcept
 	timeout_event.Schedule(client_timeout);
 }
 
+bool
+Client::CallInMainLoop(const std::function<void()> &f) noexcept
+{
+	if (thread == nullptr) {
+		f();
+		return true;
+	}
+
+	std::string captured;
+	output_capture = &captured;
+	const bool called = thread->CallInMainLoop(f);
+	output_capture = nullptr;
+
+	switch (std::exchange(pending_timeout, TimeoutAction::NONE)) {
+	case TimeoutAction::NONE:
+		break;
+
+	case TimeoutAction::SCHEDULE:
+		timeout_event.Schedule(client_timeout);
+		break;
+
+	case TimeoutAction::CANCEL:
+		timeout_event.Cancel();
+		break;
+	}
+
+	if (std::exchange(output_capture_overflow, false))
+		OnSocketError(std::make_exception_ptr(std::runtime_error("Output buffer is full")));
+	else if (!captured.empty() && !IsExpired())
+		FullyBufferedSocket::Write(captured.data(), captured.size());
+
+	return called;
+}
+
+void
+Client::ScheduleTimeout() noexcept
+{
+	if (GetEventLoop().IsInside())
+		timeout_event.Schedule(client_timeout);
+	else
+		/* called by the main thread on behalf of a
+		   ClientThread */
+		pending_timeout = TimeoutAction::SCHEDULE;
+}
+
+void
+Client::CancelTimeout() noexcept
+{
+	if (GetEventLoop().IsInside())
+		timeout_event.Cancel();
+	else
+		pending_timeout = TimeoutAction::CANCEL;
+}
+
+void
+Client::UpdateBufferMemory(bool input_released) noexcept
+{
+	if (idle_waiting && !HasPendingOutput())
+		/* this client is going to be idle for a while: give
+		   the output buffer back */
+		ShrinkOutput();
+
+	std::size_t size = GetBufferMemory();
+	if (input_released)
+		size -= GetInputMemory();
+
+	buffer_memory.store(size, std::memory_order_relaxed);
+}
+
+std::size_t
+Client::GetMemoryUsage() const noexcept
+{
+	std::size_t size = sizeof(*this) +
+		buffer_memory.load(std::memory_order_relaxed) +
+		cmd_list.GetMemoryUsage();
+
+	for (const auto &i : subscriptions)
+		size += sizeof(i) + i.capacity();
+
+	/* shared messages are accounted to their recipients in
+	   equal parts */
+	for (const auto &i : messages)
+		size += sizeof(i) + i->GetMemoryUsage() / i.use_count();
+
+	return size;
+}
+
 void
 Client::SetPartition(Partition &new_partition) noexcept
 {
 	if (partition == &new_partition)
 		return;
 
+	for (const auto &i : subscriptions)
+		partition->channels.Remove(i, *this);
 	partition->clients.erase(partition->clients.iterator_to(*this));
+
 	partition = &new_partition;
 	partition->clients.push_back(*this);
+	for (const auto &i : subscriptions)
+		partition->channels.Add(i, *this);
 
 	/* set idle flags for those subsystems which are specific to
 	   the current partition to force the client to reload its
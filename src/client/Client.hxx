@@ -27,9 +27,12 @@
 #include "tag/Mask.hxx"
 #include "event/FullyBufferedSocket.hxx"
 #include "event/CoarseTimerEvent.hxx"
+#include "event/InjectEvent.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <atomic>
 #include <cstddef>
+#include <functional>
 #include <list>
 #include <memory>
 #include <set>
@@ -46,6 +49,7 @@ struct playlist;
 class Database;
 class Storage;
 class BackgroundCommand;
+class ClientThread;
 
 class Client final
 	: FullyBufferedSocket
@@ -57,6 +61,53 @@ class Client final
 
 	CoarseTimerEvent timeout_event;
 
+	/**
+	 * The #ClientThread which owns this client's socket, or
+	 * nullptr if the socket is handled by the main thread.
+	 */
+	ClientThread *const thread;
+
+	/**
+	 * Wakes up this client's #ClientThread to send an "idle"
+	 * response which was triggered by the main thread.
+	 */
+	InjectEvent idle_event;
+
+	/**
+	 * Sends a delayed "idle" response after the
+	 * "idle_coalesce_window" has elapsed.
+	 */
+	CoarseTimerEvent idle_timer;
+
+	/**
+	 * When was the last "idle" response sent?  Only maintained if
+	 * "idle_coalesce_window" is enabled.
+	 */
+	Event::TimePoint idle_notify_time{};
+
+	/**
+	 * While a command runs in the main thread on behalf of a
+	 * #ClientThread, this points to a buffer which collects the
+	 * response; the socket is flushed by the #ClientThread
+	 * afterwards.
+	 */
+	std::atomic<std::string *> output_capture = nullptr;
+
+	/**
+	 * The response collected in #output_capture has exceeded
+	 * the maximum output buffer size.
+	 */
+	bool output_capture_overflow = false;
+
+	/**
+	 * A change of #timeout_event requested from the main thread
+	 * while the command was running; it is applied by the
+	 * #ClientThread.
+	 */
+	enum class TimeoutAction : unsigned char {
+		NONE, SCHEDULE, CANCEL,
+	} pending_timeout = TimeoutAction::NONE;
+
 	Partition *partition;
 
 	unsigned permission;
@@ -71,6 +122,9 @@ class Client final
 	/** is this client waiting for an "idle" response? */
 	bool idle_waiting = false;
 
+	/** is a command list being executed right now? */
+	bool in_command_list = false;
+
 	/** idle flags pending on this client, to be sent as soon as
 	    the client enters "idle" */
 	unsigned idle_flags = 0;
@@ -91,6 +145,12 @@ public:
 	 */
 	size_t binary_limit = 8192;
 
+	/**
+	 * Send song metadata in the "compact" format?  Can be
+	 * changed with the "compact" command.
+	 */
+	bool compact = false;
+
 	/**
 	 * This caches the last "albumart" InputStream instance, to
 	 * avoid repeating the search for each chunk requested by this
@@ -115,9 +175,18 @@ private:
 	static constexpr size_t MAX_MESSAGES = 64;
 
 	/**
-	 * A list of messages this client has received.
+	 * A list of messages this client has received.  A message
+	 * sent to several subscribers is shared by them.
 	 */
-	std::list<ClientMessage> messages;
+	std::list<std::shared_ptr<const ClientMessage>> messages;
+
+	/**
+	 * The number of bytes allocated for socket buffers, as
+	 * determined by UpdateBufferMemory().  This is updated by
+	 * the thread which owns the socket and may be read by the
+	 * main thread.
+	 */
+	std::atomic_size_t buffer_memory{0};
 
 	/**
 	 * The command currently running in background.  If this is
@@ -131,18 +200,25 @@ public:
 	Client(EventLoop &loop, Partition &partition,
 	       UniqueSocketDescriptor fd, int uid,
 	       unsigned _permission,
-	       int num) noexcept;
+	       int num, ClientThread *_thread=nullptr) noexcept;
 
 	~Client() noexcept;
 
 	using FullyBufferedSocket::GetEventLoop;
 	using FullyBufferedSocket::GetOutputMaxSize;
+	using FullyBufferedSocket::HasPendingOutput;
 
 	[[gnu::pure]]
 	bool IsExpired() const noexcept {
 		return !FullyBufferedSocket::IsDefined();
 	}
 
+	/**
+	 * Add this client to the #ClientList and to the given
+	 * partition.  Must be called in the main thread.
+	 */
+	void Register(Partition &_partition) noexcept;
+
 	void Close() noexcept;
 	void SetExpired() noexcept;
 
@@ -183,6 +259,15 @@ public:
 		permission = _permission;
 	}
 
+	/**
+	 * Estimate the amount of memory occupied by this client:
+	 * the object itself, its socket buffers, subscriptions,
+	 * pending messages and the command list being built.  Must
+	 * be called in the main thread.
+	 */
+	[[gnu::pure]]
+	std::size_t GetMemoryUsage() const noexcept;
+
 	/**
 	 * Send "idle" response to this client.
 	 */
@@ -190,6 +275,15 @@ public:
 	void IdleAdd(unsigned flags) noexcept;
 	bool IdleWait(unsigned flags) noexcept;
 
+	/**
+	 * Is the current command part of a command list?  Commands
+	 * in a command list cannot be deferred to a
+	 * #BackgroundCommand.
+	 */
+	bool IsInCommandList() const noexcept {
+		return in_command_list;
+	}
+
 	/**
 	 * Called by a command handler to defer execution to a
 	 * #BackgroundCommand.
@@ -229,12 +323,12 @@ public:
 	SubscribeResult Subscribe(const char *channel) noexcept;
 	bool Unsubscribe(const char *channel) noexcept;
 	void UnsubscribeAll() noexcept;
-	bool PushMessage(const ClientMessage &msg) noexcept;
+	bool PushMessage(const std::shared_ptr<const ClientMessage> &msg) noexcept;
 
 	template<typename F>
 	void ConsumeMessages(F &&f) {
 		while (!messages.empty()) {
-			f(messages.front());
+			f(*messages.front());
 			messages.pop_front();
 		}
 	}
@@ -252,6 +346,13 @@ public:
 	 */
 	void AllowFile(Path path_fs) const;
 
+	/**
+	 * The client number, as used in log messages.
+	 */
+	unsigned GetNum() const noexcept {
+		return num;
+	}
+
 	Partition &GetPartition() const noexcept {
 		return *partition;
 	}
@@ -282,26 +383,81 @@ public:
 	const Storage *GetStorage() const noexcept;
 
 private:
+	/**
+	 * Remove this client from all lists owned by the main
+	 * thread.  Must be called in the main thread.
+	 */
+	void Unlink() noexcept;
+
+	/**
+	 * Run the function in the main thread.  If this client is
+	 * owned by a #ClientThread, the response is collected and
+	 * sent afterwards.
+	 *
+	 * @return false if MPD is shutting down and the function was
+	 * not called
+	 */
+	bool CallInMainLoop(const std::function<void()> &f) noexcept;
+
+	void ScheduleTimeout() noexcept;
+	void CancelTimeout() noexcept;
+
+	/**
+	 * Shall the "idle" response be delayed because the last one
+	 * was sent less than "idle_coalesce_window" ago?  If yes,
+	 * this method arranges for it to be sent later.
+	 */
+	bool DelayIdleNotify() noexcept;
+
 	CommandResult ProcessCommandList(bool list_ok,
 					 std::list<std::string> &&list) noexcept;
 
+	/**
+	 * Execute one command of a streaming command list (see
+	 * "stream_command_lists").
+	 */
+	CommandResult ProcessStreamingListCommand(char *cmd) noexcept;
+
 	CommandResult ProcessLine(char *line) noexcept;
 
+	/**
+	 * Free the output buffer if the client is waiting in "idle"
+	 * and there is nothing left to send, and update
+	 * #buffer_memory.
+	 *
+	 * @param input_released true if the input buffer is empty
+	 * and is about to be released by BufferedSocket
+	 */
+	void UpdateBufferMemory(bool input_released=false) noexcept;
+
 	/* virtual methods from class BufferedSocket */
 	InputResult OnSocketInput(void *data, size_t length) noexcept override;
 	void OnSocketError(std::exception_ptr ep) noexcept override;
 	void OnSocketClosed() noexcept override;
 
+	/* virtual methods from class FullyBufferedSocket */
+	void OnSocketDrained() noexcept override;
+
 	/* callback for TimerEvent */
 	void OnTimeout() noexcept;
+
+	/* callback for #idle_event */
+	void OnIdleEvent() noexcept;
 };
 
 struct ClientPerPartitionListHook
 	: IntrusiveListMemberHookTraits<&Client::partition_siblings> {};
 
+/**
+ * Register a new client connection.  Must be called from the main
+ * thread.
+ *
+ * @param thread the #ClientThread which shall own the connection;
+ * nullptr picks one (if "client_threads" is enabled)
+ */
 void
 client_new(EventLoop &loop, Partition &partition,
 	   UniqueSocketDescriptor fd, SocketAddress address, int uid,
-	   unsigned permission) noexcept;
+	   unsigned permission, ClientThread *thread=nullptr) noexcept;
 
 #endif
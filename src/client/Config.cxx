@@ -25,8 +25,11 @@
 #define CLIENT_MAX_OUTPUT_BUFFER_SIZE_DEFAULT	(8192*1024)
 
 Event::Duration client_timeout;
+Event::Duration client_idle_coalesce_window;
+Event::Duration client_slow_command_threshold;
 size_t client_max_command_list_size;
 size_t client_max_output_buffer_size;
+bool client_stream_command_lists;
 
 void
 client_manager_init(const ConfigData &config)
@@ -44,4 +47,15 @@ client_manager_init(const ConfigData &config)
 		config.GetPositive(ConfigOption::MAX_OUTPUT_BUFFER_SIZE,
 				   CLIENT_MAX_OUTPUT_BUFFER_SIZE_DEFAULT / 1024)
 		* 1024;
+
+	client_idle_coalesce_window =
+		std::chrono::milliseconds(config.GetUnsigned(ConfigOption::IDLE_COALESCE_WINDOW,
+							     0));
+
+	client_slow_command_threshold =
+		std::chrono::milliseconds(config.GetUnsigned(ConfigOption::SLOW_COMMAND_THRESHOLD,
+							     0));
+
+	client_stream_command_lists =
+		config.GetBool(ConfigOption::STREAM_COMMAND_LISTS, false);
 }
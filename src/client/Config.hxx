@@ -25,8 +25,22 @@
 struct ConfigData;
 
 extern Event::Duration client_timeout;
+
+/**
+ * Minimum interval between two "idle" responses to one client; zero
+ * disables coalescing.
+ */
+extern Event::Duration client_idle_coalesce_window;
+
+/**
+ * Commands which take longer than this are logged; zero disables
+ * this.
+ */
+extern Event::Duration client_slow_command_threshold;
+
 extern size_t client_max_command_list_size;
 extern size_t client_max_output_buffer_size;
+extern bool client_stream_command_lists;
 
 void
 client_manager_init(const ConfigData &config);
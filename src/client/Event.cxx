@@ -18,6 +18,7 @@
  */
 
 #include "Client.hxx"
+#include "BackgroundCommand.hxx"
 #include "Domain.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
 #include "Log.hxx"
@@ -35,3 +36,12 @@ Client::OnSocketClosed() noexcept
 {
 	SetExpired();
 }
+
+void
+Client::OnSocketDrained() noexcept
+{
+	if (background_command)
+		background_command->OnClientDrained();
+
+	UpdateBufferMemory();
+}
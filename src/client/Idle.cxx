@@ -21,6 +21,8 @@
 #include "Config.hxx"
 #include "Response.hxx"
 #include "Idle.hxx"
+#include "Partition.hxx"
+#include "Instance.hxx"
 
 #include <fmt/format.h>
 
@@ -47,20 +49,34 @@ Client::IdleNotify() noexcept
 	unsigned flags = std::exchange(idle_flags, 0) & idle_subscriptions;
 	idle_waiting = false;
 
+	if (client_idle_coalesce_window > Event::Duration::zero())
+		idle_notify_time = Event::Clock::now();
+
 	Response r(*this, 0);
 	WriteIdleResponse(r, flags);
 
-	timeout_event.Schedule(client_timeout);
+	ScheduleTimeout();
 }
 
 void
 Client::IdleAdd(unsigned flags) noexcept
 {
+	if (thread != nullptr && output_capture.load() == nullptr) {
+		/* the socket is owned by the ClientThread: only
+		   record the flags here and let the ClientThread
+		   send the response */
+		idle_flags |= flags;
+		if (idle_waiting && (idle_flags & idle_subscriptions))
+			idle_event.Schedule();
+		return;
+	}
+
 	if (IsExpired())
 		return;
 
 	idle_flags |= flags;
-	if (idle_waiting && (idle_flags & idle_subscriptions))
+	if (idle_waiting && (idle_flags & idle_subscriptions) &&
+	    !DelayIdleNotify())
 		IdleNotify();
 }
 
@@ -72,12 +88,54 @@ Client::IdleWait(unsigned flags) noexcept
 	idle_waiting = true;
 	idle_subscriptions = flags;
 
-	if (idle_flags & idle_subscriptions) {
+	if ((idle_flags & idle_subscriptions) && !DelayIdleNotify()) {
 		IdleNotify();
 		return true;
 	} else {
 		/* disable timeouts while in "idle" */
-		timeout_event.Cancel();
+		CancelTimeout();
 		return false;
 	}
 }
+
+void
+Client::OnIdleEvent() noexcept
+{
+	if (IsExpired())
+		return;
+
+	if (thread != nullptr && DelayIdleNotify())
+		/* the timer has been scheduled */
+		return;
+
+	CallInMainLoop([this]{
+		if (idle_waiting && (idle_flags & idle_subscriptions) &&
+		    !DelayIdleNotify())
+			IdleNotify();
+	});
+}
+
+bool
+Client::DelayIdleNotify() noexcept
+{
+	if (client_idle_coalesce_window <= Event::Duration::zero())
+		return false;
+
+	const auto now = Event::Clock::now();
+	const auto due = idle_notify_time + client_idle_coalesce_window;
+	if (now >= due)
+		return false;
+
+	if (GetEventLoop().IsInside()) {
+		if (!idle_timer.IsPending())
+			++partition->instance.n_idle_delayed;
+
+		idle_timer.ScheduleEarlier(due - now);
+	} else
+		/* called by the main thread on behalf of a
+		   ClientThread; let the ClientThread schedule the
+		   timer */
+		idle_event.Schedule();
+
+	return true;
+}
@@ -45,6 +45,10 @@ public:
 		return list.end();
 	}
 
+	auto size() const noexcept {
+		return list.size();
+	}
+
 	bool IsFull() const noexcept {
 		return list.size() >= max_size;
 	}
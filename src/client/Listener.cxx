@@ -19,6 +19,8 @@
 
 #include "Listener.hxx"
 #include "Client.hxx"
+#include "Thread.hxx"
+#include "Instance.hxx"
 #include "Permission.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
@@ -47,6 +49,18 @@ void
 ClientListener::OnAccept(UniqueSocketDescriptor fd,
 			 SocketAddress address, int uid) noexcept
 {
+	if (thread != nullptr) {
+		/* accepted inside a ClientThread: the registration
+		   must still happen in the main thread */
+		thread->CallInMainLoop([&]{
+			client_new(thread->GetInstance().event_loop,
+				   partition,
+				   std::move(fd), address, uid,
+				   GetPermissions(address, uid),
+				   thread);
+		});
+		return;
+	}
 
 	client_new(GetEventLoop(), partition,
 		   std::move(fd), address, uid,
@@ -23,13 +23,22 @@
 #include "event/ServerSocket.hxx"
 
 struct Partition;
+class ClientThread;
 
 class ClientListener final : public ServerSocket {
 	Partition &partition;
 
+	/**
+	 * If not nullptr, then this listener runs inside the given
+	 * #ClientThread (see "listen_reuseport"), and accepted
+	 * connections are owned by it.
+	 */
+	ClientThread *const thread;
+
 public:
-	ClientListener(EventLoop &_loop, Partition &_partition) noexcept
-		:ServerSocket(_loop), partition(_partition) {}
+	ClientListener(EventLoop &_loop, Partition &_partition,
+		       ClientThread *_thread=nullptr) noexcept
+		:ServerSocket(_loop), partition(_partition), thread(_thread) {}
 
 private:
 	void OnAccept(UniqueSocketDescriptor fd,
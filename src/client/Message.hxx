@@ -20,6 +20,7 @@
 #ifndef MPD_CLIENT_MESSAGE_HXX
 #define MPD_CLIENT_MESSAGE_HXX
 
+#include <cstddef>
 #include <string>
 
 #ifdef _WIN32
@@ -47,6 +48,13 @@ public:
 	const char *GetMessage() const {
 		return message.c_str();
 	}
+
+	/**
+	 * Returns the number of bytes occupied by this object.
+	 */
+	std::size_t GetMemoryUsage() const noexcept {
+		return sizeof(*this) + channel.capacity() + message.capacity();
+	}
 };
 
 [[gnu::pure]]
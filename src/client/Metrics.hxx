@@ -0,0 +1,53 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_CLIENT_METRICS_HXX
+#define MPD_CLIENT_METRICS_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counters about client output buffers, updated by Client::Write().
+ */
+struct ClientOutputMetrics {
+	/**
+	 * The number of responses which did not fit into
+	 * "max_output_buffer_size".
+	 */
+	std::atomic<uint_least64_t> overflows{0};
+
+	/**
+	 * The largest output buffer fill level seen so far (bytes).
+	 */
+	std::atomic_size_t peak{0};
+
+	void UpdatePeak(std::size_t size) noexcept {
+		auto old = peak.load(std::memory_order_relaxed);
+		while (size > old &&
+		       !peak.compare_exchange_weak(old, size,
+						   std::memory_order_relaxed)) {}
+	}
+};
+
+extern ClientOutputMetrics client_output_metrics;
+
+#endif
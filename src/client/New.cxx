@@ -22,6 +22,7 @@
 #include "Domain.hxx"
 #include "List.hxx"
 #include "BackgroundCommand.hxx"
+#include "Thread.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
@@ -37,15 +38,21 @@ static constexpr char GREETING[] = "OK MPD " PROTOCOL_VERSION "\n";
 Client::Client(EventLoop &_loop, Partition &_partition,
 	       UniqueSocketDescriptor _fd,
 	       int _uid, unsigned _permission,
-	       int _num) noexcept
+	       int _num, ClientThread *_thread) noexcept
 	:FullyBufferedSocket(_fd.Release(), _loop,
 			     16384, client_max_output_buffer_size),
 	 timeout_event(_loop, BIND_THIS_METHOD(OnTimeout)),
+	 thread(_thread),
+	 idle_event(_loop, BIND_THIS_METHOD(OnIdleEvent)),
+	 idle_timer(_loop, BIND_THIS_METHOD(OnIdleEvent)),
 	 partition(&_partition),
 	 permission(_permission),
 	 uid(_uid),
 	 num(_num),
-	 last_album_art(_loop)
+	 /* the "albumart" command runs in the main thread */
+	 last_album_art(_thread != nullptr
+			? _thread->GetInstance().event_loop
+			: _loop)
 {
 	timeout_event.Schedule(client_timeout);
 }
@@ -53,7 +60,7 @@ Client::Client(EventLoop &_loop, Partition &_partition,
 void
 client_new(EventLoop &loop, Partition &partition,
 	   UniqueSocketDescriptor fd, SocketAddress address, int uid,
-	   unsigned permission) noexcept
+	   unsigned permission, ClientThread *thread) noexcept
 {
 	static unsigned int next_client_num;
 	const auto remote = ToString(address);
@@ -69,23 +76,62 @@ client_new(EventLoop &loop, Partition &partition,
 	(void)fd.Write(GREETING, sizeof(GREETING) - 1);
 
 	const unsigned num = next_client_num++;
+
+	FmtInfo(client_domain, "[{}] opened from {}",
+		num, remote);
+
+	if (thread == nullptr)
+		thread = partition.instance.GetClientThread();
+
+	if (thread != nullptr) {
+		/* the Client object will be constructed inside the
+		   ClientThread */
+		thread->AddClient(partition, std::move(fd), uid,
+				  permission, num);
+		return;
+	}
+
 	auto *client = new Client(loop, partition, std::move(fd), uid,
 				    permission,
 				    num);
+	client->Register(partition);
+}
 
-	client_list.Add(*client);
-	partition.clients.push_back(*client);
-
-	FmtInfo(client_domain, "[{}] opened from {}",
-		num, remote);
+void
+Client::Register(Partition &_partition) noexcept
+{
+	partition = &_partition;
+	partition->instance.client_list->Add(*this);
+	partition->clients.push_back(*this);
 }
 
 void
-Client::Close() noexcept
+Client::Unlink() noexcept
 {
 	partition->instance.client_list->Remove(*this);
+	for (const auto &i : subscriptions)
+		partition->channels.Remove(i, *this);
 	partition->clients.erase(partition->clients.iterator_to(*this));
 
+	if (thread != nullptr) {
+		/* these are owned by the main thread, too */
+		if (background_command) {
+			background_command->Cancel();
+			background_command.reset();
+		}
+
+		last_album_art.Close();
+	}
+}
+
+void
+Client::Close() noexcept
+{
+	if (!CallInMainLoop([this]{ Unlink(); }))
+		/* shutting down: the ClientList will delete this
+		   object after the ClientThread has been stopped */
+		return;
+
 	if (FullyBufferedSocket::IsDefined())
 		FullyBufferedSocket::Close();
 
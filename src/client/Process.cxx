@@ -22,6 +22,7 @@
 #include "Domain.hxx"
 #include "command/AllCommands.hxx"
 #include "Log.hxx"
+#include "util/ScopeExit.hxx"
 #include "util/StringAPI.hxx"
 #include "util/CharUtil.hxx"
 
@@ -35,6 +36,9 @@ Client::ProcessCommandList(bool list_ok,
 {
 	unsigned n = 0;
 
+	in_command_list = true;
+	AtScopeExit(this) { in_command_list = false; };
+
 	for (auto &&i : list) {
 		char *cmd = &*i.begin();
 
@@ -52,6 +56,41 @@ Client::ProcessCommandList(bool list_ok,
 	return CommandResult::OK;
 }
 
+inline CommandResult
+Client::ProcessStreamingListCommand(char *cmd) noexcept
+{
+	if (cmd_list.HasFailed())
+		/* discard the rest of the list after an error */
+		return CommandResult::OK;
+
+	in_command_list = true;
+	AtScopeExit(this) { in_command_list = false; };
+
+	FmtDebug(client_domain, "process command \"{}\"", cmd);
+	auto ret = command_process(*this, cmd_list.NextIndex(), cmd);
+	FmtDebug(client_domain, "command returned {}", unsigned(ret));
+
+	if (IsExpired())
+		return CommandResult::CLOSE;
+
+	switch (ret) {
+	case CommandResult::OK:
+		if (cmd_list.IsOKMode())
+			Write("list_OK\n");
+		return CommandResult::OK;
+
+	case CommandResult::ERROR:
+		/* the error has been sent already; ignore the
+		   remaining commands until "command_list_end" */
+		cmd_list.SetFailed();
+		return CommandResult::ERROR;
+
+	default:
+		cmd_list.Reset();
+		return ret;
+	}
+}
+
 CommandResult
 Client::ProcessLine(char *line) noexcept
 {
@@ -89,7 +128,19 @@ Client::ProcessLine(char *line) noexcept
 	}
 
 	if (cmd_list.IsActive()) {
-		if (StringIsEqual(line, CLIENT_LIST_MODE_END)) {
+		if (StringIsEqual(line, CLIENT_LIST_MODE_END) &&
+		    cmd_list.IsStreaming()) {
+			const bool failed = cmd_list.HasFailed();
+			cmd_list.Reset();
+
+			if (failed)
+				return CommandResult::ERROR;
+
+			WriteOK();
+			return CommandResult::OK;
+		} else if (cmd_list.IsStreaming()) {
+			return ProcessStreamingListCommand(line);
+		} else if (StringIsEqual(line, CLIENT_LIST_MODE_END)) {
 			const unsigned id = num;
 
 			FmtDebug(client_domain,
@@ -123,10 +174,10 @@ Client::ProcessLine(char *line) noexcept
 		}
 	} else {
 		if (StringIsEqual(line, CLIENT_LIST_MODE_BEGIN)) {
-			cmd_list.Begin(false);
+			cmd_list.Begin(false, client_stream_command_lists);
 			return CommandResult::OK;
 		} else if (StringIsEqual(line, CLIENT_LIST_OK_MODE_BEGIN)) {
-			cmd_list.Begin(true);
+			cmd_list.Begin(true, client_stream_command_lists);
 			return CommandResult::OK;
 		} else {
 			const unsigned id = num;
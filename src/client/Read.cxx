@@ -32,21 +32,45 @@ Client::OnSocketInput(void *data, size_t length) noexcept
 		return InputResult::PAUSE;
 
 	char *p = (char *)data;
-	char *newline = (char *)std::memchr(p, '\n', length);
-	if (newline == nullptr)
+	char *const end = p + length;
+
+	if (std::memchr(p, '\n', length) == nullptr)
 		return InputResult::MORE;
 
 	timeout_event.Schedule(client_timeout);
 
-	BufferedSocket::ConsumeInput(newline + 1 - p);
+	/* process all complete lines which are already in the input
+	   buffer (i.e. pipelined commands) at once; their responses
+	   are coalesced in the output buffer */
+	CommandResult result = CommandResult::OK;
+	if (!CallInMainLoop([this, &p, end, &result]{
+		char *newline;
+		while ((newline = (char *)std::memchr(p, '\n', end - p)) != nullptr) {
+			char *line = p;
+			p = newline + 1;
+
+			/* skip whitespace at the end of the line */
+			char *line_end = StripRight(line, newline);
+
+			/* terminate the string at the end of the line */
+			*line_end = 0;
 
-	/* skip whitespace at the end of the line */
-	char *end = StripRight(p, newline);
+			result = ProcessLine(line);
+			if (result == CommandResult::KILL)
+				partition->instance.Break();
 
-	/* terminate the string at the end of the line */
-	*end = 0;
+			if ((result != CommandResult::OK &&
+			     result != CommandResult::IDLE &&
+			     result != CommandResult::ERROR) ||
+			    background_command || IsExpired())
+				break;
+		}
+	}))
+		/* shutting down */
+		return InputResult::CLOSED;
+
+	BufferedSocket::ConsumeInput(p - (char *)data);
 
-	CommandResult result = ProcessLine(p);
 	switch (result) {
 	case CommandResult::OK:
 	case CommandResult::IDLE:
@@ -55,7 +79,6 @@ Client::OnSocketInput(void *data, size_t length) noexcept
 		break;
 
 	case CommandResult::KILL:
-		partition->instance.Break();
 		Close();
 		return InputResult::CLOSED;
 
@@ -74,5 +97,7 @@ Client::OnSocketInput(void *data, size_t length) noexcept
 		return InputResult::CLOSED;
 	}
 
+	UpdateBufferMemory(p == end);
+
 	return InputResult::AGAIN;
 }
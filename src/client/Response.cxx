@@ -22,34 +22,81 @@
 
 #include <fmt/format.h>
 
+#include <cstring>
+
 TagMask
 Response::GetTagMask() const noexcept
 {
 	return GetClient().tag_mask;
 }
 
+inline bool
+Response::WriteDirect(const void *data, size_t length) noexcept
+{
+	n_written += length;
+
+	if (sink != nullptr)
+		return sink->WriteResponse(data, length);
+
+	return client.Write(data, length);
+}
+
+bool
+Response::Flush() noexcept
+{
+	if (buffer.empty())
+		return true;
+
+	const bool success = WriteDirect(buffer.data(), buffer.size());
+	buffer.clear();
+	return success;
+}
+
+bool
+Response::IsCompact() const noexcept
+{
+	return GetClient().compact;
+}
+
+bool
+Response::Throttle() noexcept
+{
+	if (!Flush())
+		return false;
+
+	return sink == nullptr || sink->Throttle();
+}
+
 bool
 Response::Write(const void *data, size_t length) noexcept
 {
-	return client.Write(data, length);
+	if (length >= FLUSH_THRESHOLD)
+		/* large chunks (e.g. binary payloads) don't need to
+		   be copied into the buffer */
+		return Flush() && WriteDirect(data, length);
+
+	buffer.append((const char *)data, length);
+	return buffer.size() < FLUSH_THRESHOLD || Flush();
 }
 
 bool
 Response::Write(const char *data) noexcept
 {
-	return client.Write(data);
+	return Write(data, strlen(data));
 }
 
 bool
 Response::VFmt(fmt::string_view format_str, fmt::format_args args) noexcept
 {
-	fmt::memory_buffer buffer;
 #if FMT_VERSION >= 80000
+	/* format directly into the buffer */
 	fmt::vformat_to(std::back_inserter(buffer), format_str, args);
+	return buffer.size() < FLUSH_THRESHOLD || Flush();
 #else
-	fmt::vformat_to(buffer, format_str, args);
+	fmt::memory_buffer tmp;
+	fmt::vformat_to(tmp, format_str, args);
+	return Write(tmp.data(), tmp.size());
 #endif
-	return Write(buffer.data(), buffer.size());
 }
 
 bool
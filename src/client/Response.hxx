@@ -28,14 +28,47 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
 #include <span>
+#include <string>
+#include <string_view>
 
 class Client;
 class TagMask;
 
+/**
+ * An alternative destination for the output of a #Response.  This
+ * is used by commands running in a different thread, which must not
+ * write to the #Client directly.
+ */
+class ResponseSink {
+public:
+	/**
+	 * @return true on success
+	 */
+	virtual bool WriteResponse(const void *data,
+				   std::size_t length) noexcept = 0;
+
+	/**
+	 * Wait until the receiver is ready for more output.
+	 *
+	 * @return false if no more output is wanted (e.g. because
+	 * the command was cancelled)
+	 */
+	virtual bool Throttle() noexcept {
+		return true;
+	}
+};
+
 class Response {
 	Client &client;
 
+	/**
+	 * If not nullptr, then all output goes here instead of to
+	 * #client.
+	 */
+	ResponseSink *const sink = nullptr;
+
 	/**
 	 * This command's index in the command list.  Used to generate
 	 * error messages.
@@ -47,10 +80,50 @@ class Response {
 	 */
 	const char *command = "";
 
+	/**
+	 * Output is collected here and passed to the #Client (or the
+	 * #ResponseSink) in large chunks, to reduce the overhead of
+	 * many small writes.
+	 */
+	std::string buffer;
+
+	/**
+	 * Flush #buffer as soon as it has grown to this size.  Writes
+	 * larger than this bypass the buffer.
+	 */
+	static constexpr std::size_t FLUSH_THRESHOLD = 16384;
+
+	/**
+	 * A bit mask of key ids which have already been declared in
+	 * this response (see #CompactSongWriter).
+	 */
+	uint_least64_t compact_keys = 0;
+
+	/**
+	 * The number of bytes which have been passed from #buffer to
+	 * the #Client (or the #ResponseSink).
+	 */
+	std::size_t n_written = 0;
+
 public:
 	Response(Client &_client, unsigned _list_index) noexcept
 		:client(_client), list_index(_list_index) {}
 
+	/**
+	 * Construct a #Response which writes to a #ResponseSink.  The
+	 * #Client is only used to look up its settings.
+	 */
+	Response(Client &_client, unsigned _list_index,
+		 ResponseSink &_sink) noexcept
+		:client(_client), sink(&_sink), list_index(_list_index) {}
+
+	/**
+	 * Flushes the remaining output.
+	 */
+	~Response() noexcept {
+		Flush();
+	}
+
 	Response(const Response &) = delete;
 	Response &operator=(const Response &) = delete;
 
@@ -71,13 +144,88 @@ public:
 	[[gnu::pure]]
 	TagMask GetTagMask() const noexcept;
 
+	/**
+	 * Accessor for Client::compact.
+	 */
+	[[gnu::pure]]
+	bool IsCompact() const noexcept;
+
+	/**
+	 * Mark the key id of the "compact" format as declared.
+	 *
+	 * @return true if it had not been declared yet in this
+	 * response
+	 */
+	bool DeclareCompactKey(unsigned id) noexcept {
+		const uint_least64_t bit = uint_least64_t(1) << id;
+		if (compact_keys & bit)
+			return false;
+
+		compact_keys |= bit;
+		return true;
+	}
+
+	/**
+	 * Returns the bit mask of "compact" key ids which have been
+	 * declared in this response.
+	 */
+	uint_least64_t GetCompactKeys() const noexcept {
+		return compact_keys;
+	}
+
+	/**
+	 * Mark several key ids as declared, e.g. after copying a
+	 * pre-rendered response which declared them.
+	 */
+	void DeclareCompactKeys(uint_least64_t keys) noexcept {
+		compact_keys |= keys;
+	}
+
 	void SetCommand(const char *_command) noexcept {
 		command = _command;
 	}
 
+	const char *GetCommand() const noexcept {
+		return command;
+	}
+
+	/**
+	 * Returns the size of the response generated so far.
+	 */
+	std::size_t GetSize() const noexcept {
+		return n_written + buffer.size();
+	}
+
+	/**
+	 * Append data to the response.  Returns false if the client
+	 * has failed; since output is buffered, this may be detected
+	 * only at a later call.
+	 */
 	bool Write(const void *data, size_t length) noexcept;
 	bool Write(const char *data) noexcept;
 
+	bool Write(std::string_view s) noexcept {
+		return Write(s.data(), s.size());
+	}
+
+	/**
+	 * Pass all buffered output to the #Client (or the
+	 * #ResponseSink).
+	 *
+	 * @return true on success
+	 */
+	bool Flush() noexcept;
+
+	/**
+	 * Flush the buffer and, if this response goes to a
+	 * #ResponseSink, wait until it is ready for more output.
+	 * This must not be called while holding a lock which other
+	 * threads may need (e.g. the database lock).
+	 *
+	 * @return false if no more output is wanted
+	 */
+	bool Throttle() noexcept;
+
 	bool VFmt(fmt::string_view format_str, fmt::format_args args) noexcept;
 
 	template<typename S, typename... Args>
@@ -102,6 +250,10 @@ public:
 
 	void Error(enum ack code, const char *msg) noexcept;
 
+private:
+	bool WriteDirect(const void *data, size_t length) noexcept;
+
+public:
 	void VFmtError(enum ack code,
 		       fmt::string_view format_str, fmt::format_args args) noexcept;
 
@@ -38,6 +38,7 @@ Client::Subscribe(const char *channel) noexcept
 		return Client::SubscribeResult::ALREADY;
 
 	++num_subscriptions;
+	partition->channels.Add(channel, *this);
 
 	partition->EmitIdle(IDLE_SUBSCRIPTION);
 
@@ -53,6 +54,7 @@ Client::Unsubscribe(const char *channel) noexcept
 
 	assert(num_subscriptions > 0);
 
+	partition->channels.Remove(*i, *this);
 	subscriptions.erase(i);
 	--num_subscriptions;
 
@@ -67,15 +69,19 @@ Client::Unsubscribe(const char *channel) noexcept
 void
 Client::UnsubscribeAll() noexcept
 {
+	for (const auto &i : subscriptions)
+		partition->channels.Remove(i, *this);
+
 	subscriptions.clear();
 	num_subscriptions = 0;
 }
 
 bool
-Client::PushMessage(const ClientMessage &msg) noexcept
+Client::PushMessage(const std::shared_ptr<const ClientMessage> &msg) noexcept
 {
-	if (messages.size() >= MAX_MESSAGES ||
-	    !IsSubscribed(msg.GetChannel()))
+	assert(IsSubscribed(msg->GetChannel()));
+
+	if (messages.size() >= MAX_MESSAGES)
 		return false;
 
 	if (messages.empty())
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Thread.hxx"
+#include "Client.hxx"
+#include "Listener.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+#include "Instance.hxx"
+#include "Partition.hxx"
+
+#include <cassert>
+
+ClientThread::ClientThread(Instance &_instance) noexcept
+	:instance(_instance),
+	 new_client_event(thread.GetEventLoop(),
+			  BIND_THIS_METHOD(OnNewClient)),
+	 main_event(instance.event_loop, BIND_THIS_METHOD(OnMainCall))
+{
+}
+
+ClientThread::~ClientThread() noexcept
+{
+	Stop();
+}
+
+void
+ClientThread::Stop() noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		stopping = true;
+		main_cond.notify_one();
+	}
+
+	main_event.Cancel();
+	thread.Stop();
+
+	new_client_event.Cancel();
+	pending_clients.clear();
+
+	/* the EventLoop is not alive anymore, so the listener
+	   sockets may be closed from this thread */
+	listener.reset();
+}
+
+void
+ClientThread::Listen(Partition &partition,
+		     std::vector<std::pair<UniqueSocketDescriptor,
+					   AllocatedSocketAddress>> &&sockets) noexcept
+{
+	assert(!GetEventLoop().IsAlive());
+
+	if (listener == nullptr)
+		listener = std::make_unique<ClientListener>(GetEventLoop(),
+							    partition, this);
+
+	for (auto &[fd, address] : sockets)
+		listener->AddFD(std::move(fd), std::move(address));
+}
+
+void
+ClientThread::AddClient(Partition &partition, UniqueSocketDescriptor fd,
+			int uid, unsigned permission, unsigned num) noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		pending_clients.push_back({&partition, std::move(fd),
+					   uid, permission, num});
+	}
+
+	new_client_event.Schedule();
+}
+
+bool
+ClientThread::CallInMainLoop(const std::function<void()> &f) noexcept
+{
+	assert(GetEventLoop().IsInside());
+
+	std::unique_lock<Mutex> lock(mutex);
+	assert(main_call == nullptr);
+
+	if (stopping)
+		return false;
+
+	main_call = &f;
+	main_call_done = false;
+	main_event.Schedule();
+
+	main_cond.wait(lock, [this]{ return main_call_done || stopping; });
+	main_call = nullptr;
+	return main_call_done;
+}
+
+void
+ClientThread::OnMainCall() noexcept
+{
+	const std::function<void()> *f;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		f = main_call;
+	}
+
+	if (f == nullptr)
+		return;
+
+	/* the calling thread is blocked until we set
+	   "main_call_done", so the function may safely access its
+	   data without holding the mutex */
+	(*f)();
+
+	const std::scoped_lock<Mutex> lock(mutex);
+	main_call_done = true;
+	main_cond.notify_one();
+}
+
+/**
+ * Look up the partition in the main thread; it may have been deleted
+ * while the connection was waiting to be picked up by the
+ * #ClientThread.
+ */
+[[gnu::pure]]
+static Partition &
+FindPartitionOrDefault(Instance &instance, const Partition *p) noexcept
+{
+	for (auto &partition : instance.partitions)
+		if (&partition == p)
+			return partition;
+
+	return instance.partitions.front();
+}
+
+void
+ClientThread::OnNewClient() noexcept
+{
+	std::vector<PendingClient> clients;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		clients.swap(pending_clients);
+	}
+
+	for (auto &i : clients) {
+		auto *client = new Client(GetEventLoop(), *i.partition,
+					  std::move(i.fd), i.uid,
+					  i.permission, i.num, this);
+
+		if (!CallInMainLoop([this, client, p = i.partition]{
+			client->Register(FindPartitionOrDefault(instance, p));
+		})) {
+			delete client;
+			return;
+		}
+	}
+}
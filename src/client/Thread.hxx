@@ -0,0 +1,161 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CLIENT_THREAD_HXX
+#define MPD_CLIENT_THREAD_HXX
+
+#include "event/Thread.hxx"
+#include "event/InjectEvent.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct Instance;
+struct Partition;
+class ClientListener;
+class AllocatedSocketAddress;
+
+/**
+ * An I/O thread which owns the sockets of a subset of all clients.
+ * Reading, parsing and writing is done inside this thread's
+ * #EventLoop, but all commands are executed inside the main thread,
+ * which owns all the other state (partitions, player, database).
+ * This thread blocks while its command is running in the main
+ * thread.
+ */
+class ClientThread final {
+	Instance &instance;
+
+	EventThread thread;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled by the main thread when #main_call has finished,
+	 * or when #stopping was set.
+	 */
+	Cond main_cond;
+
+	struct PendingClient {
+		Partition *partition;
+		UniqueSocketDescriptor fd;
+		int uid;
+		unsigned permission;
+		unsigned num;
+	};
+
+	/**
+	 * Accepted connections which have not yet been turned into a
+	 * #Client inside this thread.  Protected by #mutex.
+	 */
+	std::vector<PendingClient> pending_clients;
+
+	/**
+	 * Wakes up this thread to handle #pending_clients.
+	 */
+	InjectEvent new_client_event;
+
+	/**
+	 * Wakes up the main thread to run #main_call.
+	 */
+	InjectEvent main_event;
+
+	/**
+	 * Accepts connections inside this thread (optional, see
+	 * "listen_reuseport").
+	 */
+	std::unique_ptr<ClientListener> listener;
+
+	/**
+	 * The function submitted by CallInMainLoop().  Protected by
+	 * #mutex.
+	 */
+	const std::function<void()> *main_call = nullptr;
+
+	bool main_call_done;
+
+	/**
+	 * Set by Stop(); the main thread will not run any more
+	 * functions.  Protected by #mutex.
+	 */
+	bool stopping = false;
+
+public:
+	explicit ClientThread(Instance &_instance) noexcept;
+	~ClientThread() noexcept;
+
+	ClientThread(const ClientThread &) = delete;
+	ClientThread &operator=(const ClientThread &) = delete;
+
+	Instance &GetInstance() noexcept {
+		return instance;
+	}
+
+	EventLoop &GetEventLoop() noexcept {
+		return thread.GetEventLoop();
+	}
+
+	/**
+	 * Accept connections on the given (SO_REUSEPORT) sockets
+	 * inside this thread.  Must be called from the main thread
+	 * before Start().
+	 */
+	void Listen(Partition &partition,
+		    std::vector<std::pair<UniqueSocketDescriptor,
+					  AllocatedSocketAddress>> &&sockets) noexcept;
+
+	void Start() {
+		thread.Start();
+	}
+
+	/**
+	 * Stop the thread.  Must be called from the main thread
+	 * after the main #EventLoop has finished.  A pending
+	 * CallInMainLoop() returns false.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Hand over an accepted connection to this thread, which
+	 * will construct a #Client for it.  Must be called from the
+	 * main thread.
+	 */
+	void AddClient(Partition &partition, UniqueSocketDescriptor fd,
+		       int uid, unsigned permission, unsigned num) noexcept;
+
+	/**
+	 * Run the given function inside the main thread and wait for
+	 * it to finish.  Must be called from this thread.
+	 *
+	 * @return false if the main thread is shutting down and the
+	 * function was not called
+	 */
+	bool CallInMainLoop(const std::function<void()> &f) noexcept;
+
+private:
+	void OnNewClient() noexcept;
+	void OnMainCall() noexcept;
+};
+
+#endif
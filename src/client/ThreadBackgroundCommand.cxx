@@ -18,19 +18,31 @@
  */
 
 #include "ThreadBackgroundCommand.hxx"
+#include "BackgroundCommandPool.hxx"
 #include "Client.hxx"
-#include "Response.hxx"
+#include "Instance.hxx"
 #include "command/CommandError.hxx"
 
-ThreadBackgroundCommand::ThreadBackgroundCommand(Client &_client) noexcept
-	:thread(BIND_THIS_METHOD(_Run)),
+#include <cassert>
+
+ThreadBackgroundCommand::ThreadBackgroundCommand(Client &_client,
+						 const char *_command_name) noexcept
+	:pool(*_client.GetInstance().background_command_pool),
+	 defer_flush(_client.GetEventLoop(), BIND_THIS_METHOD(FlushOutput)),
 	 defer_finish(_client.GetEventLoop(), BIND_THIS_METHOD(DeferredFinish)),
-	 client(_client)
+	 client(_client),
+	 command_name(_command_name)
+{
+}
+
+void
+ThreadBackgroundCommand::Start()
 {
+	pool.Submit(*this);
 }
 
 void
-ThreadBackgroundCommand::_Run() noexcept
+ThreadBackgroundCommand::RunInThread() noexcept
 {
 	assert(!error);
 
@@ -39,24 +51,87 @@ ThreadBackgroundCommand::_Run() noexcept
 	} catch (...) {
 		error = std::current_exception();
 	}
+}
+
+bool
+ThreadBackgroundCommand::WriteResponse(const void *data,
+				       std::size_t length) noexcept
+{
+	const std::scoped_lock lock{output_mutex};
+
+	if (cancelled)
+		return false;
 
-	defer_finish.Schedule();
+	output.append(static_cast<const char *>(data), length);
+
+	if (output.size() >= FLUSH_THRESHOLD)
+		defer_flush.Schedule();
+
+	return true;
+}
+
+bool
+ThreadBackgroundCommand::Throttle() noexcept
+{
+	std::unique_lock lock{output_mutex};
+	output_cond.wait(lock, [this]{
+		return cancelled || output.size() < MAX_PENDING;
+	});
+
+	return !cancelled;
+}
+
+void
+ThreadBackgroundCommand::TransferOutput() noexcept
+{
+	std::string data;
+
+	{
+		const std::scoped_lock lock{output_mutex};
+		data.swap(output);
+		output_cond.notify_one();
+	}
+
+	if (!data.empty())
+		client.Write(data);
+}
+
+void
+ThreadBackgroundCommand::FlushOutput() noexcept
+{
+	if (client.HasPendingOutput())
+		/* the client is slow; wait for OnClientDrained() */
+		return;
+
+	TransferOutput();
+}
+
+void
+ThreadBackgroundCommand::OnClientDrained() noexcept
+{
+	FlushOutput();
 }
 
 void
 ThreadBackgroundCommand::DeferredFinish() noexcept
 {
-	/* free the Thread */
-	thread.Join();
+	/* wait until the pool has released this object */
+	pool.Cancel(*this);
+	defer_flush.Cancel();
+
+	TransferOutput();
 
 	/* send the response */
-	Response response(client, 0);
+	{
+		Response response(client, 0);
+		response.SetCommand(command_name);
 
-	if (error) {
-		PrintError(response, error);
-	} else {
-		SendResponse(response);
-		client.WriteOK();
+		if (error) {
+			PrintError(response, error);
+		} else {
+			if (SendResponse(response))
+				response.Write("OK\n");
+		}
 	}
 
 	/* delete this object */
@@ -67,9 +142,19 @@ void
 ThreadBackgroundCommand::Cancel() noexcept
 {
 	CancelThread();
-	thread.Join();
 
-	/* cancel the InjectEvent, just in case the Thread has
+	{
+		/* wake up the worker thread if it is blocked in
+		   Throttle() */
+		const std::scoped_lock lock{output_mutex};
+		cancelled = true;
+		output_cond.notify_one();
+	}
+
+	pool.Cancel(*this);
+
+	/* cancel the InjectEvents, just in case the command has
 	   meanwhile finished execution */
+	defer_flush.Cancel();
 	defer_finish.Cancel();
 }
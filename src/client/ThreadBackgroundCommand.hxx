@@ -21,42 +21,147 @@
 #define MPD_THREAD_BACKGROUND_COMMAND_HXX
 
 #include "BackgroundCommand.hxx"
+#include "Response.hxx"
 #include "event/InjectEvent.hxx"
-#include "thread/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/IntrusiveList.hxx"
 
+#include <cstdint>
 #include <exception>
+#include <string>
 
 class Client;
-class Response;
+class BackgroundCommandPool;
 
 /**
- * A #BackgroundCommand which defers execution into a new thread.
+ * A #BackgroundCommand which runs in a #BackgroundCommandPool
+ * thread.  Output generated in that thread with #ResponseSink is
+ * passed to the #Client in the #EventLoop thread.
  */
-class ThreadBackgroundCommand : public BackgroundCommand {
-	Thread thread;
-	InjectEvent defer_finish;
+class ThreadBackgroundCommand
+	: public BackgroundCommand, public IntrusiveListHook<>,
+	  protected ResponseSink
+{
+	friend class BackgroundCommandPool;
+
+	/**
+	 * If more than this number of bytes is pending in #output,
+	 * it gets flushed to the #Client.
+	 */
+	static constexpr std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+	/**
+	 * Throttle() blocks the worker thread while more than this
+	 * number of bytes is pending in #output.  This limits the
+	 * memory used for responses to slow clients.
+	 */
+	static constexpr std::size_t MAX_PENDING = 4 * FLUSH_THRESHOLD;
+
+	enum class State : uint8_t {
+		IDLE,
+		PENDING,
+		RUNNING,
+		DONE,
+	};
+
+	/**
+	 * Protected by the #BackgroundCommandPool's mutex.
+	 */
+	State state = State::IDLE;
+
+	BackgroundCommandPool &pool;
+
+	InjectEvent defer_flush, defer_finish;
+
 	Client &client;
 
+	/**
+	 * The name of the command, used for error messages.
+	 */
+	const char *const command_name;
+
+	/**
+	 * Protects #output and #cancelled.
+	 */
+	Mutex output_mutex;
+
+	/**
+	 * Signalled when #output was passed to the #Client or when
+	 * #cancelled was set.
+	 */
+	Cond output_cond;
+
+	/**
+	 * Set by Cancel(); the worker thread shall stop generating
+	 * output.
+	 */
+	bool cancelled = false;
+
+	/**
+	 * Output generated by the worker thread which has not yet
+	 * been passed to the #Client.
+	 */
+	std::string output;
+
 	/**
 	 * The error thrown by Run().
 	 */
 	std::exception_ptr error;
 
 public:
-	explicit ThreadBackgroundCommand(Client &_client) noexcept;
+	explicit ThreadBackgroundCommand(Client &_client,
+					 const char *_command_name="") noexcept;
 
 	auto &GetEventLoop() const noexcept {
 		return defer_finish.GetEventLoop();
 	}
 
-	void Start() {
-		thread.Start();
-	}
+	/**
+	 * Throws if the command could not be submitted to the
+	 * #BackgroundCommandPool.
+	 */
+	void Start();
 
 	void Cancel() noexcept final;
+	void OnClientDrained() noexcept final;
+
+protected:
+	/**
+	 * Returns the #Client.  Run() may only use it to construct a
+	 * #Response with this object as #ResponseSink.
+	 */
+	Client &GetClient() const noexcept {
+		return client;
+	}
+
+	const char *GetCommandName() const noexcept {
+		return command_name;
+	}
+
+	/* virtual methods from class ResponseSink */
+	bool WriteResponse(const void *data, std::size_t length) noexcept override;
+	bool Throttle() noexcept override;
 
 private:
-	void _Run() noexcept;
+	void RunInThread() noexcept;
+
+	void ScheduleFinish() noexcept {
+		defer_finish.Schedule();
+	}
+
+	/**
+	 * Pass pending #output to the #Client.
+	 */
+	void TransferOutput() noexcept;
+
+	/**
+	 * Like TransferOutput(), but only if the #Client has sent
+	 * everything it had before; otherwise OnClientDrained() will
+	 * do it later.
+	 */
+	void FlushOutput() noexcept;
+
 	void DeferredFinish() noexcept;
 
 protected:
@@ -70,8 +175,11 @@ protected:
 	 * Send the response after Run() has finished.  Note that you
 	 * must not send errors here; if an error occurs, Run() should
 	 * throw an exception instead.
+	 *
+	 * @return false if the command has failed and "OK" shall not
+	 * be sent
 	 */
-	virtual void SendResponse(Response &response) noexcept = 0;
+	virtual bool SendResponse(Response &response) noexcept = 0;
 
 	virtual void CancelThread() noexcept = 0;
 };
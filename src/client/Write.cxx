@@ -18,12 +18,38 @@
  */
 
 #include "Client.hxx"
+#include "Metrics.hxx"
 
 #include <string.h>
 
+ClientOutputMetrics client_output_metrics;
+
 bool
 Client::Write(const void *data, size_t length) noexcept
 {
 	/* if the client is going to be closed, do nothing */
-	return !IsExpired() && FullyBufferedSocket::Write(data, length);
+	if (IsExpired())
+		return false;
+
+	if (auto *capture = output_capture.load()) {
+		/* running in the main thread on behalf of the
+		   ClientThread; it will send the response */
+		if (capture->size() + length > GetOutputMaxSize()) {
+			output_capture_overflow = true;
+			client_output_metrics.overflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		capture->append((const char *)data, length);
+		client_output_metrics.UpdatePeak(capture->size());
+		return true;
+	}
+
+	const std::size_t new_size = GetOutputSize() + length;
+	if (new_size > GetOutputMaxSize())
+		client_output_metrics.overflows.fetch_add(1, std::memory_order_relaxed);
+	else
+		client_output_metrics.UpdatePeak(new_size);
+
+	return FullyBufferedSocket::Write(data, length);
 }
@@ -35,15 +35,24 @@
 #include "PartitionCommands.hxx"
 #include "FingerprintCommands.hxx"
 #include "OtherCommands.hxx"
+#ifdef ENABLE_SAMPLING_PROFILER
+#include "ProfileCommands.hxx"
+#endif
 #include "Permission.hxx"
 #include "tag/Type.h"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "client/Client.hxx"
+#include "client/Config.hxx"
 #include "client/Response.hxx"
+#include "metrics/Histogram.hxx"
+#include "metrics/Writer.hxx"
+#include "util/Domain.hxx"
+#include "util/ScopeExit.hxx"
 #include "util/Tokenizer.hxx"
 #include "util/StaticVector.hxx"
 #include "util/StringAPI.hxx"
+#include "Log.hxx"
 
 #ifdef ENABLE_SQLITE
 #include "StickerCommands.hxx"
@@ -51,6 +60,7 @@
 
 #include <fmt/format.h>
 
+#include <array>
 #include <cassert>
 #include <iterator>
 
@@ -97,6 +107,7 @@ static constexpr struct command commands[] = {
 	{ "cleartagid", PERMISSION_ADD, 1, 2, handle_cleartagid },
 	{ "close", PERMISSION_NONE, -1, -1, handle_close },
 	{ "commands", PERMISSION_NONE, 0, 0, handle_commands },
+	{ "compact", PERMISSION_NONE, 1, 1, handle_compact },
 	{ "config", PERMISSION_ADMIN, 0, 0, handle_config },
 	{ "consume", PERMISSION_PLAYER, 1, 1, handle_consume },
 #ifdef ENABLE_DATABASE
@@ -114,6 +125,9 @@ static constexpr struct command commands[] = {
 	{ "find", PERMISSION_READ, 1, -1, handle_find },
 	{ "findadd", PERMISSION_ADD, 1, -1, handle_findadd},
 #endif
+#if defined(ENABLE_CHROMAPRINT) && defined(ENABLE_DATABASE)
+	{ "fingerprintscan", PERMISSION_CONTROL, 0, 1, handle_fingerprintscan },
+#endif
 #ifdef ENABLE_CHROMAPRINT
 	{ "getfingerprint", PERMISSION_READ, 1, 1, handle_getfingerprint },
 #endif
@@ -151,6 +165,7 @@ static constexpr struct command commands[] = {
 	{ "notcommands", PERMISSION_NONE, 0, 0, handle_not_commands },
 	{ "outputs", PERMISSION_READ, 0, 0, handle_devices },
 	{ "outputset", PERMISSION_ADMIN, 3, 3, handle_outputset },
+	{ "outputstats", PERMISSION_READ, 0, 0, handle_outputstats },
 	{ "partition", PERMISSION_READ, 1, 1, handle_partition },
 	{ "password", PERMISSION_NONE, 1, 1, handle_password },
 	{ "pause", PERMISSION_PLAYER, 0, 1, handle_pause },
@@ -171,6 +186,9 @@ static constexpr struct command commands[] = {
 	{ "previous", PERMISSION_PLAYER, 0, 0, handle_previous },
 	{ "prio", PERMISSION_PLAYER, 2, -1, handle_prio },
 	{ "prioid", PERMISSION_PLAYER, 2, -1, handle_prioid },
+#ifdef ENABLE_SAMPLING_PROFILER
+	{ "profile", PERMISSION_ADMIN, 1, 2, handle_profile },
+#endif
 	{ "random", PERMISSION_PLAYER, 1, 1, handle_random },
 	{ "rangeid", PERMISSION_ADD, 2, 2, handle_rangeid },
 	{ "readcomments", PERMISSION_READ, 1, 1, handle_read_comments },
@@ -200,6 +218,7 @@ static constexpr struct command commands[] = {
 	{ "single", PERMISSION_PLAYER, 1, 1, handle_single },
 	{ "stats", PERMISSION_READ, 0, 0, handle_stats },
 	{ "status", PERMISSION_READ, 0, 0, handle_status },
+	{ "statusdelta", PERMISSION_READ, 1, 1, handle_statusdelta },
 #ifdef ENABLE_SQLITE
 	{ "sticker", PERMISSION_ADMIN, 3, -1, handle_sticker },
 #endif
@@ -220,6 +239,11 @@ static constexpr struct command commands[] = {
 
 static constexpr unsigned num_commands = std::size(commands);
 
+/**
+ * The execution times of all commands, indexed like #commands.
+ */
+static std::array<DurationMetric, num_commands> command_metrics;
+
 gcc_pure
 static bool
 command_available([[maybe_unused]] const Partition &partition,
@@ -383,6 +407,54 @@ command_checked_lookup(Response &r, unsigned permission,
 	return cmd;
 }
 
+static constexpr Domain slow_command_domain("slow_command");
+
+/**
+ * Arguments of slow commands are truncated to this length in the
+ * log.
+ */
+static constexpr std::size_t SLOW_COMMAND_MAX_ARGS = 256;
+
+static void
+LogSlowCommand(const struct command &cmd, const Client &client,
+	       Request args, const Response &r,
+	       std::chrono::steady_clock::duration elapsed) noexcept
+{
+	std::string s;
+	for (const char *arg : args) {
+		fmt::format_to(std::back_inserter(s), " \"{}\"", arg);
+		if (s.size() > SLOW_COMMAND_MAX_ARGS) {
+			s.resize(SLOW_COMMAND_MAX_ARGS);
+			s += "...";
+			break;
+		}
+	}
+
+	FmtWarning(slow_command_domain,
+		   "[{}] command {}{} in partition \"{}\" took {} ms, response {} bytes",
+		   client.GetNum(), cmd.cmd, s, client.GetPartition().name,
+		   std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+		   r.GetSize());
+}
+
+static CommandResult
+InvokeCommand(const struct command &cmd, Client &client,
+	      Request args, Response &r)
+{
+	auto &metric = command_metrics[&cmd - commands];
+	const auto start = std::chrono::steady_clock::now();
+	AtScopeExit(&metric, start, &cmd, &client, args, &r) {
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		metric.Add(elapsed);
+
+		if (client_slow_command_threshold > client_slow_command_threshold.zero() &&
+		    elapsed >= client_slow_command_threshold) [[unlikely]]
+			LogSlowCommand(cmd, client, args, r, elapsed);
+	};
+
+	return cmd.handler(client, args, r);
+}
+
 CommandResult
 command_process(Client &client, unsigned num, char *line) noexcept
 {
@@ -438,9 +510,23 @@ command_process(Client &client, unsigned num, char *line) noexcept
 		if (cmd == nullptr)
 			return CommandResult::ERROR;
 
-		return cmd->handler(client, args, r);
+		return InvokeCommand(*cmd, client, args, r);
 	} catch (...) {
 		PrintError(r, std::current_exception());
 		return CommandResult::ERROR;
 	}
 }
+
+void
+command_write_metrics(MetricsWriter &w) noexcept
+{
+	w.Family("command_duration_seconds", "histogram",
+		 "Time spent in protocol command handlers");
+
+	for (unsigned i = 0; i < num_commands; ++i)
+		if (command_metrics[i].count.load(std::memory_order_relaxed) > 0)
+			w.Histogram("command_duration_seconds",
+				    MetricsWriter::Label("command",
+							 commands[i].cmd),
+				    command_metrics[i]);
+}
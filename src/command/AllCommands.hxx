@@ -23,6 +23,7 @@
 #include "CommandResult.hxx"
 
 class Client;
+class MetricsWriter;
 
 void
 command_init() noexcept;
@@ -30,4 +31,11 @@ command_init() noexcept;
 CommandResult
 command_process(Client &client, unsigned num, char *line) noexcept;
 
+/**
+ * Write the execution time histograms of all commands which have
+ * been used at least once.
+ */
+void
+command_write_metrics(MetricsWriter &w) noexcept;
+
 #endif
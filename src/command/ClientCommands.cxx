@@ -55,6 +55,13 @@ handle_binary_limit(Client &client, Request args,
 	return CommandResult::OK;
 }
 
+CommandResult
+handle_compact(Client &client, Request args, [[maybe_unused]] Response &r)
+{
+	client.compact = args.ParseBool(0);
+	return CommandResult::OK;
+}
+
 CommandResult
 handle_password(Client &client, Request args, Response &r)
 {
@@ -73,6 +73,9 @@ ToAck(DatabaseErrorCode code) noexcept
 
 	case DatabaseErrorCode::CONFLICT:
 		return ACK_ERROR_ARG;
+
+	case DatabaseErrorCode::LOADING:
+		return ACK_ERROR_SYSTEM;
 	}
 
 	return ACK_ERROR_UNKNOWN;
@@ -21,6 +21,7 @@
 #define MPD_COMMAND_LIST_BUILDER_HXX
 
 #include <cassert>
+#include <cstddef>
 #include <list>
 #include <string>
 
@@ -55,6 +56,23 @@ class CommandListBuilder {
 	 */
 	size_t size;
 
+	/**
+	 * Execute each command as soon as it arrives instead of
+	 * collecting the list?  See "stream_command_lists".
+	 */
+	bool streaming;
+
+	/**
+	 * Has a command in this streaming list failed?  The
+	 * remaining commands are then discarded.
+	 */
+	bool failed;
+
+	/**
+	 * The number of commands executed in this streaming list.
+	 */
+	unsigned n_executed;
+
 public:
 	/**
 	 * Is a command list currently being built?
@@ -77,15 +95,57 @@ public:
 	 */
 	void Reset();
 
+	/**
+	 * Is the list executed while it is being received?
+	 */
+	bool IsStreaming() const {
+		assert(IsActive());
+
+		return streaming;
+	}
+
+	bool HasFailed() const {
+		assert(IsStreaming());
+
+		return failed;
+	}
+
+	void SetFailed() {
+		assert(IsStreaming());
+
+		failed = true;
+	}
+
+	/**
+	 * Returns the list index for the next command of this
+	 * streaming list.
+	 */
+	unsigned NextIndex() {
+		assert(IsStreaming());
+
+		return n_executed++;
+	}
+
+	/**
+	 * Returns the number of bytes occupied by the commands
+	 * collected so far.
+	 */
+	std::size_t GetMemoryUsage() const noexcept {
+		return IsActive() && !streaming ? size : 0;
+	}
+
 	/**
 	 * Begin building a command list.
 	 */
-	void Begin(bool ok) {
+	void Begin(bool ok, bool _streaming=false) {
 		assert(list.empty());
 		assert(mode == Mode::DISABLED);
 
 		mode = (Mode)ok;
 		size = 0;
+		streaming = _streaming;
+		failed = false;
+		n_executed = 0;
 	}
 
 	/**
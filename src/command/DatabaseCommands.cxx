@@ -21,6 +21,7 @@
 #include "PositionArg.hxx"
 #include "Request.hxx"
 #include "Partition.hxx"
+#include "BulkEdit.hxx"
 #include "db/DatabaseQueue.hxx"
 #include "db/DatabasePlaylist.hxx"
 #include "db/DatabasePrint.hxx"
@@ -29,15 +30,22 @@
 #include "protocol/RangeArg.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/ThreadBackgroundCommand.hxx"
+#include "db/Interface.hxx"
+#include "db/DatabasePlugin.hxx"
+#include "Instance.hxx"
 #include "tag/ParseName.hxx"
 #include "util/Exception.hxx"
 #include "util/StringAPI.hxx"
+#include "util/StringCompare.hxx"
 #include "util/ASCII.hxx"
 #include "song/Filter.hxx"
+#include "song/StickerSongFilter.hxx"
 
 #include <fmt/format.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <limits.h> // for UINT_MAX
@@ -54,9 +62,7 @@ handle_listfiles_db(Client &client, Response &r, const char *uri)
 CommandResult
 handle_lsinfo2(Client &client, const char *uri, Response &r)
 {
-	const DatabaseSelection selection(uri, false);
-	db_selection_print(r, client.GetPartition(),
-			   selection, true, false);
+	PrintDirectoryInfo(client, r, uri);
 	return CommandResult::OK;
 }
 
@@ -119,6 +125,7 @@ ParseDatabaseSelection(Request args, bool fold_case, SongFilter &filter)
 	}
 
 	TagType sort = TAG_NUM_OF_ITEM_TYPES;
+	const char *sort_sticker = nullptr;
 	bool descending = false;
 	if (args.size() >= 2 && StringIsEqual(args[args.size() - 2], "sort")) {
 		const char *s = args.back();
@@ -127,7 +134,15 @@ ParseDatabaseSelection(Request args, bool fold_case, SongFilter &filter)
 			++s;
 		}
 
-		sort = ParseSortTag(s);
+		if (const char *name = StringAfterPrefix(s, "sticker:")) {
+			if (GetStickerValueSource() == nullptr)
+				throw ProtocolError(ACK_ERROR_ARG,
+						    "Sticker database is disabled");
+
+			sort = TagType(SORT_TAG_STICKER);
+			sort_sticker = name;
+		} else
+			sort = ParseSortTag(s);
 
 		args.pop_back();
 		args.pop_back();
@@ -144,10 +159,105 @@ ParseDatabaseSelection(Request args, bool fold_case, SongFilter &filter)
 	DatabaseSelection selection("", true, &filter);
 	selection.window = window;
 	selection.sort = sort;
+	if (sort_sticker != nullptr)
+		selection.sort_sticker = sort_sticker;
 	selection.descending = descending;
 	return selection;
 }
 
+using DatabaseCommandHandler = CommandResult (*)(Client &client, Request args,
+						 Response &r);
+
+/**
+ * Executes a read-only database command in a
+ * #BackgroundCommandPool thread, so walking a large database does not
+ * block the main thread.  The output is streamed to the client.
+ */
+class DatabaseBackgroundCommand final : public ThreadBackgroundCommand {
+	Instance &instance;
+
+	const DatabaseCommandHandler handler;
+
+	/**
+	 * Copies of the arguments, because the input buffer they
+	 * point to will be reused.
+	 */
+	const std::vector<std::string> args;
+
+	CommandResult result = CommandResult::OK;
+
+public:
+	DatabaseBackgroundCommand(Client &_client, const char *_command_name,
+				  DatabaseCommandHandler _handler,
+				  Request _args) noexcept
+		:ThreadBackgroundCommand(_client, _command_name),
+		 instance(_client.GetInstance()),
+		 handler(_handler),
+		 args(_args.begin(), _args.end())
+	{
+		++instance.n_background_database_commands;
+	}
+
+	~DatabaseBackgroundCommand() noexcept override {
+		--instance.n_background_database_commands;
+	}
+
+protected:
+	void Run() override {
+		std::vector<const char *> argv;
+		argv.reserve(args.size());
+		for (const auto &i : args)
+			argv.push_back(i.c_str());
+
+		Response r(GetClient(), 0, *this);
+		r.SetCommand(GetCommandName());
+		result = handler(GetClient(), Request{argv}, r);
+	}
+
+	bool SendResponse(Response &) noexcept override {
+		return result == CommandResult::OK;
+	}
+
+	void CancelThread() noexcept override {
+		/* no way to interrupt a database visitor; Cancel()
+		   waits for it to finish (but PrintDirectoryTree()
+		   stops at the next directory) */
+	}
+};
+
+[[gnu::pure]]
+static bool
+CanRunInBackground(const Client &client) noexcept
+{
+	if (client.IsInCommandList())
+		return false;
+
+	if (!client.GetInstance().background_command_pool)
+		return false;
+
+	const auto *db = client.GetDatabase();
+	return db != nullptr && db->GetPlugin().IsThreadSafe();
+}
+
+/**
+ * Run the given command handler in a #DatabaseBackgroundCommand if
+ * possible, or else synchronously.
+ */
+static CommandResult
+RunDatabaseCommand(Client &client, Request args, Response &r,
+		   DatabaseCommandHandler handler)
+{
+	if (!CanRunInBackground(client))
+		return handler(client, args, r);
+
+	auto cmd = std::make_unique<DatabaseBackgroundCommand>(client,
+								r.GetCommand(),
+								handler, args);
+	cmd->Start();
+	client.SetBackgroundCommand(std::move(cmd));
+	return CommandResult::BACKGROUND;
+}
+
 static CommandResult
 handle_match(Client &client, Request args, Response &r, bool fold_case)
 {
@@ -159,16 +269,28 @@ handle_match(Client &client, Request args, Response &r, bool fold_case)
 	return CommandResult::OK;
 }
 
+static CommandResult
+handle_find_internal(Client &client, Request args, Response &r)
+{
+	return handle_match(client, args, r, false);
+}
+
+static CommandResult
+handle_search_internal(Client &client, Request args, Response &r)
+{
+	return handle_match(client, args, r, true);
+}
+
 CommandResult
 handle_find(Client &client, Request args, Response &r)
 {
-	return handle_match(client, args, r, false);
+	return RunDatabaseCommand(client, args, r, handle_find_internal);
 }
 
 CommandResult
 handle_search(Client &client, Request args, Response &r)
 {
-	return handle_match(client, args, r, true);
+	return RunDatabaseCommand(client, args, r, handle_search_internal);
 }
 
 static CommandResult
@@ -182,7 +304,10 @@ handle_match_add(Client &client, Request args, bool fold_case)
 	SongFilter filter;
 	const auto selection = ParseDatabaseSelection(args, fold_case, filter);
 
-	AddFromDatabase(partition, selection);
+	{
+		const ScopeBulkEdit bulk_edit(partition);
+		AddFromDatabase(partition, selection);
+	}
 
 	if (position < queue_length) {
 		const auto new_queue_length =
@@ -267,30 +392,46 @@ handle_count_internal(Client &client, Request args, Response &r, bool fold_case)
 	return CommandResult::OK;
 }
 
+static CommandResult
+handle_count_exact(Client &client, Request args, Response &r)
+{
+	return handle_count_internal(client, args, r, false);
+}
+
+static CommandResult
+handle_count_fold_case(Client &client, Request args, Response &r)
+{
+	return handle_count_internal(client, args, r, true);
+}
+
 CommandResult
 handle_count(Client &client, Request args, Response &r)
 {
-	return handle_count_internal(client, args, r, false);
+	return RunDatabaseCommand(client, args, r, handle_count_exact);
 }
 
 CommandResult
 handle_searchcount(Client &client, Request args, Response &r)
 {
-	return handle_count_internal(client, args, r, true);
+	return RunDatabaseCommand(client, args, r, handle_count_fold_case);
 }
 
-CommandResult
-handle_listall(Client &client, Request args, Response &r)
+static CommandResult
+handle_listall_internal(Client &client, Request args, Response &r)
 {
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   false, false);
+	PrintDirectoryTree(r, client.GetPartition(), uri, false);
 	return CommandResult::OK;
 }
 
+CommandResult
+handle_listall(Client &client, Request args, Response &r)
+{
+	return RunDatabaseCommand(client, args, r, handle_listall_internal);
+}
+
 static CommandResult
 handle_list_file(Client &client, Request args, Response &r)
 {
@@ -389,14 +530,18 @@ handle_list(Client &client, Request args, Response &r)
 	return CommandResult::OK;
 }
 
-CommandResult
-handle_listallinfo(Client &client, Request args, Response &r)
+static CommandResult
+handle_listallinfo_internal(Client &client, Request args, Response &r)
 {
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   true, false);
+	PrintDirectoryTree(r, client.GetPartition(), uri, true);
 	return CommandResult::OK;
 }
+
+CommandResult
+handle_listallinfo(Client &client, Request args, Response &r)
+{
+	return RunDatabaseCommand(client, args, r, handle_listallinfo_internal);
+}
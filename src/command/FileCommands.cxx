@@ -41,6 +41,9 @@
 #include "input/Error.hxx"
 #include "LocateUri.hxx"
 #include "TimePrint.hxx"
+#include "PictureCache.hxx"
+#include "Instance.hxx"
+#include "io/FileReader.hxx"
 #include "thread/Mutex.hxx"
 #include "Log.hxx"
 
@@ -176,6 +179,83 @@ find_stream_art(std::string_view directory, Mutex &mutex)
 	return nullptr;
 }
 
+/**
+ * Load a whole local file into a #CachedPicture.
+ *
+ * Throws on error.
+ */
+static CachedPicturePtr
+LoadPictureFile(Path path, std::size_t size)
+{
+	auto picture = std::make_shared<CachedPicture>();
+	picture->data.ResizeDiscard(size);
+
+	FileReader reader(path);
+
+	std::size_t position = 0;
+	while (position < size) {
+		std::size_t nbytes = reader.Read(picture->data.data() + position,
+						 size - position);
+		if (nbytes == 0)
+			throw std::runtime_error("Unexpected end of file");
+
+		position += nbytes;
+	}
+
+	return picture;
+}
+
+/**
+ * Like find_stream_art(), but only for local directories, and the
+ * file is loaded into the #PictureCache (or taken from it).
+ *
+ * @return the picture or nullptr if there is none or if it is not
+ * eligible for caching (the caller shall then fall back to
+ * find_stream_art())
+ */
+static CachedPicturePtr
+find_cached_art(PictureCache &cache, std::string_view directory) noexcept
+{
+	static constexpr auto art_names = std::array {
+		"cover.png",
+		"cover.jpg",
+		"cover.webp",
+	};
+
+	for (const auto name : art_names) {
+		std::string art_file = PathTraitsUTF8::Build(directory, name);
+		if (!PathTraitsUTF8::IsAbsolute(art_file.c_str()))
+			/* not a local file */
+			return nullptr;
+
+		const auto path_fs = AllocatedPath::FromUTF8(art_file);
+		if (path_fs.IsNull())
+			return nullptr;
+
+		FileInfo info;
+		if (!GetFileInfo(path_fs, info) || !info.IsRegular())
+			continue;
+
+		const auto mtime = info.GetModificationTime();
+		if (auto picture = cache.Get(art_file, mtime))
+			return picture;
+
+		if (!cache.IsEligible(info.GetSize()))
+			return nullptr;
+
+		try {
+			auto picture = LoadPictureFile(path_fs, info.GetSize());
+			cache.Put(art_file, mtime, picture);
+			return picture;
+		} catch (...) {
+			LogError(std::current_exception());
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
 static CommandResult
 read_stream_art(Response &r, const std::string_view art_directory,
 		size_t offset)
@@ -183,6 +263,24 @@ read_stream_art(Response &r, const std::string_view art_directory,
 	// TODO: eliminate this const_cast
 	auto &client = const_cast<Client &>(r.GetClient());
 
+	if (auto *cache = client.GetInstance().picture_cache.get()) {
+		if (const auto picture = find_cached_art(*cache, art_directory)) {
+			std::span<const std::byte> data = picture->data;
+			if (offset > data.size()) {
+				r.Error(ACK_ERROR_ARG, "Offset too large");
+				return CommandResult::ERROR;
+			}
+
+			data = data.subspan(offset);
+			if (data.size() > client.binary_limit)
+				data = data.first(client.binary_limit);
+
+			r.Fmt(FMT_STRING("size: {}\n"), picture->data.size());
+			r.WriteBinary(data);
+			return CommandResult::OK;
+		}
+	}
+
 	/* to avoid repeating the search for each chunk request by the
 	   same client, use the #LastInputStream class to cache the
 	   #InputStream instance */
@@ -318,52 +416,84 @@ handle_album_art(Client &client, Request args, Response &r)
 	return CommandResult::ERROR;
 }
 
-class PrintPictureHandler final : public NullTagHandler {
-	Response &response;
-
-	const size_t offset;
-
-	bool found = false;
-
-	bool bad_offset = false;
+/**
+ * Collects the first picture of a song into a #CachedPicture.
+ */
+class CollectPictureHandler final : public NullTagHandler {
+	std::shared_ptr<CachedPicture> picture;
 
 public:
-	PrintPictureHandler(Response &_response, size_t _offset) noexcept
-		:NullTagHandler(WANT_PICTURE), response(_response),
-		 offset(_offset) {}
+	CollectPictureHandler() noexcept
+		:NullTagHandler(WANT_PICTURE) {}
 
-	void RethrowError() const {
-		if (bad_offset)
-			throw ProtocolError(ACK_ERROR_ARG, "Bad file offset");
+	CachedPicturePtr GetPicture() && noexcept {
+		return std::move(picture);
 	}
 
 	void OnPicture(const char *mime_type,
 		       std::span<const std::byte> buffer) noexcept override {
-		if (found)
+		if (picture)
 			/* only use the first picture */
 			return;
 
-		found = true;
-
-		if (offset > buffer.size()) {
-			bad_offset = true;
-			return;
-		}
+		picture = std::make_shared<CachedPicture>();
+		if (mime_type != nullptr)
+			picture->mime_type = mime_type;
+		picture->data = buffer;
+	}
+};
 
-		response.Fmt(FMT_STRING("size: {}\n"), buffer.size());
+/**
+ * Determine the modification time of the file containing the
+ * specified song, for validating #PictureCache items.
+ *
+ * @return false if the time could not be determined; the picture
+ * shall then not be cached
+ */
+static bool
+GetPictureSourceTime(Client &client, const char *uri,
+		     std::chrono::system_clock::time_point &mtime) noexcept
+try {
+	const auto located_uri = LocateUri(UriPluginKind::INPUT, uri, &client
+#ifdef ENABLE_DATABASE
+					   , nullptr
+#endif
+					   );
 
-		if (mime_type != nullptr)
-			response.Fmt(FMT_STRING("type: {}\n"), mime_type);
+	switch (located_uri.type) {
+	case LocatedUri::Type::ABSOLUTE:
+		/* remote files are not cached */
+		return false;
 
-		buffer = buffer.subspan(offset);
+	case LocatedUri::Type::RELATIVE:
+#ifdef ENABLE_DATABASE
+		if (const auto *db = client.GetDatabase()) {
+			const auto *song = db->GetSong(located_uri.canonical_uri);
+			if (song == nullptr)
+				return false;
+
+			AtScopeExit(db, song) { db->ReturnSong(song); };
+			mtime = song->mtime;
+			return true;
+		}
+#endif
+		return false;
 
-		const std::size_t binary_limit = response.GetClient().binary_limit;
-		if (buffer.size() > binary_limit)
-			buffer = buffer.first(binary_limit);
+	case LocatedUri::Type::PATH:
+		{
+			FileInfo info;
+			if (!GetFileInfo(located_uri.path, info))
+				return false;
 
-		response.WriteBinary(buffer);
+			mtime = info.GetModificationTime();
+			return true;
+		}
 	}
-};
+
+	return false;
+} catch (...) {
+	return false;
+}
 
 CommandResult
 handle_read_picture(Client &client, Request args, Response &r)
@@ -373,8 +503,43 @@ handle_read_picture(Client &client, Request args, Response &r)
 	const char *const uri = args.front();
 	const size_t offset = args.ParseUnsigned(1);
 
-	PrintPictureHandler handler(r, offset);
-	TagScanAny(client, uri, handler);
-	handler.RethrowError();
+	auto *const cache = client.GetInstance().picture_cache.get();
+
+	std::string cache_key;
+	std::chrono::system_clock::time_point mtime;
+	const bool cacheable = cache != nullptr &&
+		GetPictureSourceTime(client, uri, mtime);
+
+	CachedPicturePtr picture;
+	if (cacheable) {
+		cache_key = std::string{"picture:"} + uri;
+		picture = cache->Get(cache_key, mtime);
+	}
+
+	if (!picture) {
+		CollectPictureHandler handler;
+		TagScanAny(client, uri, handler);
+		picture = std::move(handler).GetPicture();
+		if (!picture)
+			return CommandResult::OK;
+
+		if (cacheable)
+			cache->Put(cache_key, mtime, picture);
+	}
+
+	std::span<const std::byte> buffer = picture->data;
+	if (offset > buffer.size())
+		throw ProtocolError(ACK_ERROR_ARG, "Bad file offset");
+
+	r.Fmt(FMT_STRING("size: {}\n"), buffer.size());
+
+	if (!picture->mime_type.empty())
+		r.Fmt(FMT_STRING("type: {}\n"), picture->mime_type);
+
+	buffer = buffer.subspan(offset);
+	if (buffer.size() > client.binary_limit)
+		buffer = buffer.first(client.binary_limit);
+
+	r.WriteBinary(buffer);
 	return CommandResult::OK;
 }
@@ -21,6 +21,7 @@
 #define MPD_FINGERPRINT_COMMANDS_HXX
 
 #include "CommandResult.hxx"
+#include "config.h"
 
 class Client;
 class Request;
@@ -29,4 +30,11 @@ class Response;
 CommandResult
 handle_getfingerprint(Client &client, Request request, Response &response);
 
+#ifdef ENABLE_DATABASE
+
+CommandResult
+handle_fingerprintscan(Client &client, Request request, Response &response);
+
+#endif
+
 #endif
@@ -27,8 +27,7 @@
 #include <fmt/format.h>
 
 #include <cassert>
-#include <set>
-#include <string>
+#include <memory>
 
 CommandResult
 handle_subscribe(Client &client, Request args, Response &r)
@@ -77,15 +76,7 @@ handle_channels(Client &client, [[maybe_unused]] Request args, Response &r)
 {
 	assert(args.empty());
 
-	std::set<std::string> channels;
-
-	for (const auto &c : client.GetPartition().clients) {
-		const auto &subscriptions = c.GetSubscriptions();
-		channels.insert(subscriptions.begin(),
-				subscriptions.end());
-	}
-
-	for (const auto &channel : channels)
+	for (const auto &[channel, subscribers] : client.GetPartition().channels)
 		r.Fmt(FMT_STRING("channel: {}\n"), channel);
 
 	return CommandResult::OK;
@@ -119,11 +110,19 @@ handle_send_message(Client &client, Request args, Response &r)
 	}
 
 	bool sent = false;
-	const ClientMessage msg(channel_name, message_text);
 
-	for (auto &c : client.GetPartition().clients)
-		if (c.PushMessage(msg))
-			sent = true;
+	if (const auto subscribers =
+	    client.GetPartition().channels.Find(channel_name);
+	    !subscribers.empty()) {
+		/* one copy shared by all subscribers */
+		const auto msg =
+			std::make_shared<const ClientMessage>(channel_name,
+							      message_text);
+
+		for (auto *c : subscribers)
+			if (c->PushMessage(msg))
+				sent = true;
+	}
 
 	if (sent)
 		return CommandResult::OK;
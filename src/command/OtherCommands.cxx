@@ -29,6 +29,7 @@
 #include "SongPrint.hxx"
 #include "TagPrint.hxx"
 #include "TagStream.hxx"
+#include "TagScanPool.hxx"
 #include "tag/Handler.hxx"
 #include "TimePrint.hxx"
 #include "decoder/DecoderPrint.hxx"
@@ -42,6 +43,9 @@
 #include "db/PlaylistVector.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/BackgroundCommand.hxx"
+#include "CommandError.hxx"
+#include "event/InjectEvent.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "IdleFlags.hxx"
@@ -153,9 +157,86 @@ public:
 	}
 };
 
+/**
+ * Scans the tags of a remote URI for "lsinfo" in the #TagScanPool,
+ * without blocking the main thread.
+ */
+class RemoteLsInfoCommand final
+	: public BackgroundCommand, TagScanRequest
+{
+	Client &client;
+
+	TagScanPool &pool;
+
+	InjectEvent defer_finish;
+
+	/**
+	 * The result, copied by OnTagScanResult().
+	 */
+	Tag tag;
+	bool found = false;
+	std::exception_ptr error;
+
+public:
+	RemoteLsInfoCommand(Client &_client, TagScanPool &_pool) noexcept
+		:client(_client), pool(_pool),
+		 defer_finish(client.GetEventLoop(),
+			      BIND_THIS_METHOD(OnDeferredFinish)) {}
+
+	/**
+	 * Throws on error.
+	 */
+	void Start(const char *uri) {
+		pool.Lookup(uri, TagScanPriority::INTERACTIVE, *this);
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	void Cancel() noexcept override {
+		pool.CancelLookup(*this);
+		defer_finish.Cancel();
+	}
+
+private:
+	void OnDeferredFinish() noexcept {
+		{
+			Response r(client, 0);
+			r.SetCommand("lsinfo");
+
+			if (error)
+				PrintError(r, error);
+			else if (!found)
+				r.Error(ACK_ERROR_NO_EXIST, "No such file");
+			else {
+				tag_print_values(r, tag);
+				r.Write("OK\n");
+			}
+		}
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+
+	/* virtual methods from class TagScanRequest */
+	void OnTagScanResult(const TagScanResult &result) noexcept override {
+		tag = Tag(result.tag);
+		found = result.found;
+		error = result.error;
+		defer_finish.Schedule();
+	}
+};
+
 static CommandResult
-handle_lsinfo_absolute(Response &r, const char *uri)
+handle_lsinfo_absolute(Client &client, Response &r, const char *uri)
 {
+	auto *pool = client.GetInstance().tag_scan_pool.get();
+	if (pool != nullptr && !client.IsInCommandList()) {
+		auto cmd = std::make_unique<RemoteLsInfoCommand>(client,
+								 *pool);
+		cmd->Start(uri);
+		client.SetBackgroundCommand(std::move(cmd));
+		return CommandResult::BACKGROUND;
+	}
+
 	PrintTagHandler h(r);
 	if (!tag_stream_scan(uri, h)) {
 		r.Error(ACK_ERROR_NO_EXIST, "No such file");
@@ -227,7 +308,8 @@ handle_lsinfo(Client &client, Request args, Response &r)
 
 	switch (located_uri.type) {
 	case LocatedUri::Type::ABSOLUTE:
-		return handle_lsinfo_absolute(r, located_uri.canonical_uri);
+		return handle_lsinfo_absolute(client, r,
+					      located_uri.canonical_uri);
 
 	case LocatedUri::Type::RELATIVE:
 		return handle_lsinfo_relative(client, r,
@@ -334,9 +416,7 @@ handle_setvol(Client &client, Request args, Response &)
 {
 	unsigned level = args.ParseUnsigned(0, 100);
 
-	auto &partition = client.GetPartition();
-	partition.mixer_memento.SetVolume(partition.outputs, level);
-	partition.EmitIdle(IDLE_MIXER);
+	client.GetPartition().SetVolume(level);
 	return CommandResult::OK;
 }
 
@@ -361,10 +441,8 @@ handle_volume(Client &client, Request args, Response &r)
 	else if (new_volume > 100)
 		new_volume = 100;
 
-	if (new_volume != old_volume) {
-		mixer_memento.SetVolume(outputs, new_volume);
-		partition.EmitIdle(IDLE_MIXER);
-	}
+	if (new_volume != old_volume)
+		partition.SetVolume(new_volume);
 
 	return CommandResult::OK;
 }
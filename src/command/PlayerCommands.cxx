@@ -106,17 +106,25 @@ handle_pause(Client &client, Request args, [[maybe_unused]] Response &r)
 	return CommandResult::OK;
 }
 
-CommandResult
-handle_status(Client &client, [[maybe_unused]] Request args, Response &r)
+/**
+ * Write the "status" response lines which depend on the given idle
+ * flags.
+ *
+ * @param changed a mask of idle flags; ~0 writes everything
+ */
+static void
+WriteStatus(Response &r, Partition &partition, unsigned changed)
 {
-	auto &partition = client.GetPartition();
 	auto &pc = partition.pc;
+	const bool full = changed == ~0U;
+
+	/* don't wait for the player thread; the published status is
+	   fresh enough for status polling */
+	const auto player_status = pc.GetStatus();
 
 	const char *state = nullptr;
 	int song;
 
-	const auto player_status = pc.LockGetStatus();
-
 	switch (player_status.state) {
 	case PlayerState::STOP:
 		state = "stop";
@@ -131,44 +139,59 @@ handle_status(Client &client, [[maybe_unused]] Request args, Response &r)
 
 	const auto &playlist = partition.playlist;
 
-	const auto volume = partition.mixer_memento.GetVolume(partition.outputs);
-	if (volume >= 0)
-		r.Fmt(FMT_STRING("volume: {}\n"), volume);
-
-	r.Fmt(FMT_STRING(COMMAND_STATUS_REPEAT ": {}\n"
-			 COMMAND_STATUS_RANDOM ": {}\n"
-			 COMMAND_STATUS_SINGLE ": {}\n"
-			 COMMAND_STATUS_CONSUME ": {}\n"
-			 "partition: {}\n"
-			 COMMAND_STATUS_PLAYLIST ": {}\n"
-			 COMMAND_STATUS_PLAYLIST_LENGTH ": {}\n"
-			 COMMAND_STATUS_MIXRAMPDB ": {}\n"
-			 COMMAND_STATUS_STATE ": {}\n"),
-	      (unsigned)playlist.GetRepeat(),
-	      (unsigned)playlist.GetRandom(),
-	      SingleToString(playlist.GetSingle()),
-	      ConsumeToString(playlist.GetConsume()),
-	      partition.name.c_str(),
-	      playlist.GetVersion(),
-	      playlist.GetLength(),
-	      pc.GetMixRampDb(),
-	      state);
-
-	if (pc.GetCrossFade() > FloatDuration::zero())
-		r.Fmt(FMT_STRING(COMMAND_STATUS_CROSSFADE ": {}\n"),
-		      lround(pc.GetCrossFade().count()));
-
-	if (pc.GetMixRampDelay() > FloatDuration::zero())
-		r.Fmt(FMT_STRING(COMMAND_STATUS_MIXRAMPDELAY ": {}\n"),
-		      pc.GetMixRampDelay().count());
-
-	song = playlist.GetCurrentPosition();
-	if (song >= 0) {
-		r.Fmt(FMT_STRING(COMMAND_STATUS_SONG ": {}\n"
-				 COMMAND_STATUS_SONGID ": {}\n"),
-		      song, playlist.PositionToId(song));
+	if (changed & (IDLE_MIXER|IDLE_OUTPUT)) {
+		const auto volume = partition.mixer_memento.GetVolume(partition.outputs);
+		if (volume >= 0)
+			r.Fmt(FMT_STRING("volume: {}\n"), volume);
+	}
+
+	if (changed & IDLE_OPTIONS)
+		r.Fmt(FMT_STRING(COMMAND_STATUS_REPEAT ": {}\n"
+				 COMMAND_STATUS_RANDOM ": {}\n"
+				 COMMAND_STATUS_SINGLE ": {}\n"
+				 COMMAND_STATUS_CONSUME ": {}\n"),
+		      (unsigned)playlist.GetRepeat(),
+		      (unsigned)playlist.GetRandom(),
+		      SingleToString(playlist.GetSingle()),
+		      ConsumeToString(playlist.GetConsume()));
+
+	if (full)
+		r.Fmt(FMT_STRING("partition: {}\n"), partition.name);
+
+	if (changed & IDLE_PLAYLIST)
+		r.Fmt(FMT_STRING(COMMAND_STATUS_PLAYLIST ": {}\n"
+				 COMMAND_STATUS_PLAYLIST_LENGTH ": {}\n"),
+		      playlist.GetVersion(),
+		      playlist.GetLength());
+
+	if (changed & IDLE_OPTIONS)
+		r.Fmt(FMT_STRING(COMMAND_STATUS_MIXRAMPDB ": {}\n"),
+		      pc.GetMixRampDb());
+
+	if (changed & IDLE_PLAYER)
+		r.Fmt(FMT_STRING(COMMAND_STATUS_STATE ": {}\n"), state);
+
+	if (changed & IDLE_OPTIONS) {
+		if (pc.GetCrossFade() > FloatDuration::zero())
+			r.Fmt(FMT_STRING(COMMAND_STATUS_CROSSFADE ": {}\n"),
+			      lround(pc.GetCrossFade().count()));
+
+		if (pc.GetMixRampDelay() > FloatDuration::zero())
+			r.Fmt(FMT_STRING(COMMAND_STATUS_MIXRAMPDELAY ": {}\n"),
+			      pc.GetMixRampDelay().count());
 	}
 
+	if (changed & (IDLE_PLAYLIST|IDLE_PLAYER)) {
+		song = playlist.GetCurrentPosition();
+		if (song >= 0) {
+			r.Fmt(FMT_STRING(COMMAND_STATUS_SONG ": {}\n"
+					 COMMAND_STATUS_SONGID ": {}\n"),
+			      song, playlist.PositionToId(song));
+		}
+	}
+
+	/* the elapsed time and the bit rate change all the time
+	   without an idle event, so they are always written */
 	if (player_status.state != PlayerState::STOP) {
 		r.Fmt(FMT_STRING(COMMAND_STATUS_TIME ": {}:{}\n"
 				 "elapsed: {:1.3f}\n"
@@ -180,39 +203,64 @@ handle_status(Client &client, [[maybe_unused]] Request args, Response &r)
 		      player_status.elapsed_time.ToDoubleS(),
 		      player_status.bit_rate);
 
-		if (!player_status.total_time.IsNegative())
-			r.Fmt(FMT_STRING("duration: {:1.3f}\n"),
-				 player_status.total_time.ToDoubleS());
+		if (changed & IDLE_PLAYER) {
+			if (!player_status.total_time.IsNegative())
+				r.Fmt(FMT_STRING("duration: {:1.3f}\n"),
+				      player_status.total_time.ToDoubleS());
 
-		if (player_status.audio_format.IsDefined())
-			r.Fmt(FMT_STRING(COMMAND_STATUS_AUDIO ": {}\n"),
-			      ToString(player_status.audio_format));
+			if (player_status.audio_format.IsDefined())
+				r.Fmt(FMT_STRING(COMMAND_STATUS_AUDIO ": {}\n"),
+				      ToString(player_status.audio_format));
+		}
 	}
 
 #ifdef ENABLE_DATABASE
-	const UpdateService *update_service = partition.instance.update;
-	unsigned updateJobId = update_service != nullptr
-		? update_service->GetId()
-		: 0;
-	if (updateJobId != 0) {
-		r.Fmt(FMT_STRING(COMMAND_STATUS_UPDATING_DB ": {}\n"),
-		      updateJobId);
+	if (changed & IDLE_UPDATE) {
+		const UpdateService *update_service = partition.instance.update;
+		unsigned updateJobId = update_service != nullptr
+			? update_service->GetId()
+			: 0;
+		if (updateJobId != 0) {
+			r.Fmt(FMT_STRING(COMMAND_STATUS_UPDATING_DB ": {}\n"),
+			      updateJobId);
+		}
 	}
 #endif
 
-	try {
-		pc.LockCheckRethrowError();
-	} catch (...) {
-		r.Fmt(FMT_STRING(COMMAND_STATUS_ERROR ": {}\n"),
-		      GetFullMessage(std::current_exception()));
+	if (changed & IDLE_PLAYER) {
+		try {
+			pc.LockCheckRethrowError();
+		} catch (...) {
+			r.Fmt(FMT_STRING(COMMAND_STATUS_ERROR ": {}\n"),
+			      GetFullMessage(std::current_exception()));
+		}
 	}
 
-	song = playlist.GetNextPosition();
-	if (song >= 0)
-		r.Fmt(FMT_STRING(COMMAND_STATUS_NEXTSONG ": {}\n"
-				 COMMAND_STATUS_NEXTSONGID ": {}\n"),
-		      song, playlist.PositionToId(song));
+	/* the next song depends on the queue options, too */
+	if (changed & (IDLE_PLAYLIST|IDLE_PLAYER|IDLE_OPTIONS)) {
+		song = playlist.GetNextPosition();
+		if (song >= 0)
+			r.Fmt(FMT_STRING(COMMAND_STATUS_NEXTSONG ": {}\n"
+					 COMMAND_STATUS_NEXTSONGID ": {}\n"),
+			      song, playlist.PositionToId(song));
+	}
+}
+
+CommandResult
+handle_status(Client &client, [[maybe_unused]] Request args, Response &r)
+{
+	WriteStatus(r, client.GetPartition(), ~0U);
+	return CommandResult::OK;
+}
+
+CommandResult
+handle_statusdelta(Client &client, Request args, Response &r)
+{
+	auto &partition = client.GetPartition();
+	const unsigned since = args.ParseUnsigned(0);
 
+	r.Fmt(FMT_STRING("status_version: {}\n"), partition.status_version);
+	WriteStatus(r, partition, partition.GetIdleSince(since));
 	return CommandResult::OK;
 }
 
@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "PlaylistCommands.hxx"
+#include "CommandError.hxx"
 #include "PositionArg.hxx"
 #include "Request.hxx"
 #include "Instance.hxx"
@@ -33,11 +34,16 @@
 #include "SongLoader.hxx"
 #include "song/DetachedSong.hxx"
 #include "BulkEdit.hxx"
+#include "playlist/PlaylistAny.hxx"
 #include "playlist/PlaylistQueue.hxx"
+#include "playlist/SongEnumerator.hxx"
 #include "playlist/Print.hxx"
 #include "TimePrint.hxx"
 #include "client/Client.hxx"
+#include "client/BackgroundCommand.hxx"
 #include "client/Response.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "thread/Mutex.hxx"
 #include "Mapper.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "time/ChronoUtil.hxx"
@@ -46,6 +52,8 @@
 
 #include <fmt/format.h>
 
+#include <optional>
+
 bool
 playlist_commands_available() noexcept
 {
@@ -85,6 +93,118 @@ handle_save(Client &client, Request args, [[maybe_unused]] Response &r)
 	return CommandResult::OK;
 }
 
+/**
+ * Loads a playlist into the queue in batches of #BATCH_SIZE songs,
+ * returning to the #EventLoop after each batch, so other clients are
+ * served meanwhile and playback of the first songs can start while
+ * the rest is still being loaded.  The "load" command finishes when
+ * the whole playlist has been loaded.
+ */
+class LoadPlaylistCommand final : public BackgroundCommand {
+	static constexpr unsigned BATCH_SIZE = 256;
+
+	Client &client;
+
+	/**
+	 * Passed to playlist_open_any(); must outlive the
+	 * #enumerator.
+	 */
+	Mutex mutex;
+
+	std::unique_ptr<SongEnumerator> enumerator;
+
+	std::optional<PlaylistQueueLoader> queue_loader;
+
+	const SongLoader loader;
+
+	/**
+	 * Schedules the next batch.  A zero-duration timer is used
+	 * (and not a #DeferEvent) because the #EventLoop polls its
+	 * sockets before running it again.
+	 */
+	FineTimerEvent next_batch;
+
+public:
+	explicit LoadPlaylistCommand(Client &_client) noexcept
+		:client(_client),
+		 loader(client),
+		 next_batch(client.GetEventLoop(), BIND_THIS_METHOD(OnBatch)) {}
+
+	/**
+	 * Open the playlist and schedule the first batch.
+	 *
+	 * Throws on error.
+	 */
+	void Start(const LocatedUri &uri,
+		   unsigned start_index, unsigned end_index) {
+		enumerator = playlist_open_any(uri,
+#ifdef ENABLE_DATABASE
+					       loader.GetStorage(),
+#endif
+					       mutex);
+		if (enumerator == nullptr)
+			throw PlaylistError::NoSuchList();
+
+		queue_loader.emplace(uri.canonical_uri, *enumerator,
+				     start_index, end_index);
+		next_batch.Schedule(Event::Duration::zero());
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	void Cancel() noexcept override {
+		next_batch.Cancel();
+	}
+
+private:
+	void Finish(std::exception_ptr error) noexcept {
+		{
+			Response r(client, 0);
+			r.SetCommand("load");
+
+			if (error)
+				PrintError(r, error);
+			else
+				r.Write("OK\n");
+		}
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+
+	void OnBatch() noexcept {
+		bool more;
+
+		try {
+			auto &partition = client.GetPartition();
+			auto &playlist = partition.playlist;
+			const unsigned old_size = playlist.GetLength();
+
+			{
+				const ScopeBulkEdit bulk_edit(partition);
+				more = queue_loader->LoadBatch(BATCH_SIZE,
+							       playlist,
+							       partition.pc,
+							       loader);
+			}
+
+			/* invoke the RemoteTagScanner on all newly
+			   added songs */
+			auto &instance = client.GetInstance();
+			const unsigned new_size = playlist.GetLength();
+			for (unsigned i = old_size; i < new_size; ++i)
+				instance.LookupRemoteTag(playlist.queue.Get(i).GetRealURI());
+		} catch (...) {
+			Finish(std::current_exception());
+			return;
+		}
+
+		if (more)
+			next_batch.Schedule(Event::Duration::zero());
+		else
+			Finish({});
+	}
+};
+
 CommandResult
 handle_load(Client &client, Request args, [[maybe_unused]] Response &r)
 {
@@ -106,6 +226,18 @@ handle_load(Client &client, Request args, [[maybe_unused]] Response &r)
 		? ParseInsertPosition(args[2], partition.playlist)
 		: old_size;
 
+	if (position >= old_size && !client.IsInCommandList() &&
+	    &client.GetEventLoop() == &client.GetInstance().event_loop) {
+		/* appending to the queue outside of a command list:
+		   load in batches, without blocking the EventLoop;
+		   (this is not possible if the client lives in a
+		   separate I/O thread) */
+		auto cmd = std::make_unique<LoadPlaylistCommand>(client);
+		cmd->Start(uri, range.start, range.end);
+		client.SetBackgroundCommand(std::move(cmd));
+		return CommandResult::BACKGROUND;
+	}
+
 	const SongLoader loader(client);
 	playlist_open_into_queue(uri,
 				 range.start, range.end,
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "ProfileCommands.hxx"
+#include "Request.hxx"
+#include "client/BackgroundCommand.hxx"
+#include "client/Client.hxx"
+#include "client/Response.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "system/SamplingProfiler.hxx"
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+
+/**
+ * The maximum duration of a "profile" command.
+ */
+static constexpr unsigned PROFILE_MAX_SECONDS = 60;
+
+static constexpr unsigned PROFILE_DEFAULT_FREQUENCY = 99;
+static constexpr unsigned PROFILE_MAX_FREQUENCY = 1000;
+
+/**
+ * Limits the memory used by the samples.
+ */
+static constexpr std::size_t PROFILE_MAX_SAMPLES = 32768;
+
+/**
+ * Runs a #SamplingProfiler for a while, without blocking the
+ * #EventLoop, and sends the folded stacks to the client.
+ */
+class ProfileCommand final : public BackgroundCommand {
+	Client &client;
+
+	SamplingProfiler profiler;
+
+	CoarseTimerEvent timer;
+
+public:
+	/**
+	 * Throws if the profiler cannot be started.
+	 */
+	ProfileCommand(Client &_client, std::chrono::seconds duration,
+		       unsigned frequency)
+		:client(_client),
+		 /* allow samples from 4 busy CPUs */
+		 profiler(frequency,
+			  std::min<std::size_t>(duration.count() * frequency * 4,
+						PROFILE_MAX_SAMPLES)),
+		 timer(client.GetEventLoop(), BIND_THIS_METHOD(OnTimer))
+	{
+		timer.Schedule(duration);
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	void Cancel() noexcept override {
+		timer.Cancel();
+	}
+
+private:
+	void OnTimer() noexcept {
+		const auto result = profiler.Stop();
+
+		{
+			Response r(client, 0);
+			r.SetCommand("profile");
+			r.Fmt("samples: {}\n"
+			      "dropped: {}\n",
+			      result.n_samples, result.n_dropped);
+
+			std::string_view folded = result.folded;
+			while (!folded.empty()) {
+				const auto eol = folded.find('\n');
+				r.Fmt("stack: {}\n", folded.substr(0, eol));
+				if (eol == folded.npos)
+					break;
+				folded.remove_prefix(eol + 1);
+			}
+
+			r.Write("OK\n");
+		}
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+};
+
+CommandResult
+handle_profile(Client &client, Request args, Response &r)
+{
+	const std::chrono::seconds duration{args.ParseUnsigned(0, PROFILE_MAX_SECONDS)};
+	if (duration.count() == 0) {
+		r.Error(ACK_ERROR_ARG, "Duration must be positive");
+		return CommandResult::ERROR;
+	}
+
+	const unsigned frequency = args.size() > 1
+		? args.ParseUnsigned(1, PROFILE_MAX_FREQUENCY)
+		: PROFILE_DEFAULT_FREQUENCY;
+	if (frequency == 0) {
+		r.Error(ACK_ERROR_ARG, "Frequency must be positive");
+		return CommandResult::ERROR;
+	}
+
+	if (client.IsInCommandList()) {
+		r.Error(ACK_ERROR_ARG, "Not possible in a command list");
+		return CommandResult::ERROR;
+	}
+
+	client.SetBackgroundCommand(std::make_unique<ProfileCommand>(client,
+								     duration,
+								     frequency));
+	return CommandResult::BACKGROUND;
+}
@@ -219,6 +219,8 @@ handle_mount(Client &client, Request args, Response &r)
 
 		// TODO: call Instance::OnDatabaseModified()?
 		// TODO: trigger database update?
+		instance.unique_tags_cache.Clear();
+		instance.lsinfo_cache.Clear();
 		instance.EmitIdle(IDLE_DATABASE);
 
 		if (need_update) {
@@ -253,6 +255,13 @@ handle_unmount(Client &client, Request args, Response &r)
 	}
 
 #ifdef ENABLE_DATABASE
+	if (instance.n_background_database_commands > 0) {
+		/* a database command running in another thread may
+		   be walking the mounted database */
+		r.Error(ACK_ERROR_SYSTEM, "Database is busy");
+		return CommandResult::ERROR;
+	}
+
 	if (instance.update != nullptr)
 		/* ensure that no database update will attempt to work
 		   with the database/storage instances we're about to
@@ -260,9 +269,12 @@ handle_unmount(Client &client, Request args, Response &r)
 		instance.update->CancelMount(local_uri);
 
 	if (auto *db = dynamic_cast<SimpleDatabase *>(instance.GetDatabase())) {
-		if (db->Unmount(local_uri))
+		if (db->Unmount(local_uri)) {
 			// TODO: call Instance::OnDatabaseModified()?
+			instance.unique_tags_cache.Clear();
+			instance.lsinfo_cache.Clear();
 			instance.EmitIdle(IDLE_DATABASE);
+		}
 	}
 #endif
 
@@ -35,41 +35,74 @@ enum class ConfigOption {
 	FOLLOW_OUTSIDE_SYMLINKS,
 	DB_FILE,
 	STICKER_FILE,
+	STICKER_SYNCHRONOUS,
+	STICKER_COMMIT_DELAY,
+	SONG_ANALYSIS,
+	PICTURE_CACHE_SIZE,
+	REMOTE_TAG_CACHE_FILE,
+	REMOTE_TAG_CACHE_SIZE,
+	REMOTE_TAG_CACHE_TTL,
 	LOG_FILE,
 	PID_FILE,
 	STATE_FILE,
 	STATE_FILE_INTERVAL,
+	STATE_FILE_JOURNAL,
 	RESTORE_PAUSED,
 	USER,
 	GROUP,
 	BIND_TO_ADDRESS,
 	PORT,
 	LOG_LEVEL,
+	LOG_RATE_LIMIT,
 	ZEROCONF_NAME,
 	ZEROCONF_ENABLED,
+	METRICS_PORT,
+	METRICS_BIND_TO_ADDRESS,
+	EVENT_LOOP_PROFILE,
+	EVENT_LOOP_SLOW_THRESHOLD,
 	PASSWORD,
 	HOST_PERMISSIONS,
 	LOCAL_PERMISSIONS,
 	DEFAULT_PERMS,
 	AUDIO_OUTPUT_FORMAT,
+	AUDIO_OUTPUT_WAKEUP_THRESHOLD,
 	MIXER_TYPE,
+	VOLUME_COALESCE_WINDOW,
 	REPLAYGAIN,
 	REPLAYGAIN_PREAMP,
 	REPLAYGAIN_MISSING_PREAMP,
 	REPLAYGAIN_LIMIT,
+	REPLAYGAIN_STAGE,
 	VOLUME_NORMALIZATION,
 	SAMPLERATE_CONVERTER,
+	DSD2PCM_DECIMATION,
+	DSD2PCM_QUALITY,
+	CONVERSION_THREADS,
 	AUDIO_BUFFER_SIZE,
+	AUDIO_BUFFER_CHUNK_SIZE,
+	AUDIO_BUFFER_HUGETLB,
+	AUDIO_BUFFER_PREFAULT,
+	AUDIO_BUFFER_LOCK,
+	AUDIO_BUFFER_NUMA_NODE,
 	BUFFER_BEFORE_PLAY,
+	MAX_INPUT_BUFFER_SIZE,
 	HTTP_PROXY_HOST,
 	HTTP_PROXY_PORT,
 	HTTP_PROXY_USER,
 	HTTP_PROXY_PASSWORD,
 	CONN_TIMEOUT,
+	IDLE_COALESCE_WINDOW,
+	SLOW_COMMAND_THRESHOLD,
 	MAX_CONN,
 	MAX_PLAYLIST_LENGTH,
 	MAX_COMMAND_LIST_SIZE,
+	STREAM_COMMAND_LISTS,
 	MAX_OUTPUT_BUFFER_SIZE,
+	MAX_BACKGROUND_THREADS,
+	CLIENT_THREADS,
+	LISTEN_REUSEPORT,
+	TAG_SCAN_THREADS,
+	FINGERPRINT_THREADS,
 	FS_CHARSET,
 	ID3V1_ENCODING,
 	METADATA_TO_USE,
@@ -77,11 +110,24 @@ enum class ConfigOption {
 	GAPLESS_MP3_PLAYBACK,
 	AUTO_UPDATE,
 	AUTO_UPDATE_DEPTH,
+	UPDATE_THREADS,
+	UPDATE_BATCH_SIZE,
+	UPDATE_SKIP_CACHE,
+	UPDATE_ALL_TAGS,
+	BACKGROUND_DATABASE_LOAD,
 	DESPOTIFY_USER,
 	DESPOTIFY_PASSWORD,
 	DESPOTIFY_HIGH_BITRATE,
 
 	MIXRAMP_ANALYZER,
+	SEEK_INDEX_CACHE,
+	SEEK_HISTORY,
+	PLAYER_IDLE_TIMEOUT,
+	PLAYER_LOW_LATENCY,
+
+	LOCK_MEMORY,
+	POWER_PROFILE,
+	FLOAT_PIPELINE,
 
 	MAX
 };
@@ -98,6 +144,7 @@ enum class ConfigBlockOption {
 	DATABASE,
 	NEIGHBORS,
 	PARTITION,
+	THREAD,
 	MAX
 };
 
@@ -21,7 +21,9 @@
 #include "Data.hxx"
 
 PartitionConfig::PartitionConfig(const ConfigData &config)
-	:player(config)
+	:player(config),
+	 volume_coalesce_window(std::chrono::milliseconds(config.GetUnsigned(ConfigOption::VOLUME_COALESCE_WINDOW,
+									     0)))
 {
 	queue.max_length =
 		config.GetPositive(ConfigOption::MAX_PLAYLIST_LENGTH,
@@ -22,10 +22,19 @@
 #include "QueueConfig.hxx"
 #include "PlayerConfig.hxx"
 
+#include <chrono>
+
 struct PartitionConfig {
 	QueueConfig queue;
 	PlayerConfig player;
 
+	/**
+	 * The "volume_coalesce_window" setting: after a volume
+	 * change, further changes within this duration are merged
+	 * into one.  Zero disables this.
+	 */
+	std::chrono::steady_clock::duration volume_coalesce_window{};
+
 	PartitionConfig() = default;
 
 	explicit PartitionConfig(const ConfigData &config);
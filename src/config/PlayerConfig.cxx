@@ -21,6 +21,7 @@
 #include "Data.hxx"
 #include "Domain.hxx"
 #include "Parser.hxx"
+#include "ThreadConfig.hxx"
 #include "pcm/AudioParser.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "Log.hxx"
@@ -30,28 +31,46 @@ static constexpr
 size_t MIN_BUFFER_SIZE = std::max(CHUNK_SIZE * 32,
 				  64 * KILOBYTE);
 
+static size_t
+GetChunkSize(const ConfigData &config)
+{
+	return config.With(ConfigOption::AUDIO_BUFFER_CHUNK_SIZE, [](const char *s){
+		if (s == nullptr)
+			return CHUNK_SIZE;
+
+		size_t result = ParseSize(s);
+		if (result < MIN_CHUNK_SIZE || result > MAX_CHUNK_SIZE)
+			throw FmtRuntimeError("chunk size \"{}\" is not between {} and {}",
+					      s, MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+
+		return result;
+	});
+}
+
 static unsigned
-GetBufferChunks(const ConfigData &config)
+GetBufferChunks(const ConfigData &config, size_t chunk_size)
 {
 	size_t buffer_size = PlayerConfig::DEFAULT_BUFFER_SIZE;
 	if (auto *param = config.GetParam(ConfigOption::AUDIO_BUFFER_SIZE)) {
-		buffer_size = param->With([](const char *s){
+		buffer_size = param->With([chunk_size](const char *s){
 			size_t result = ParseSize(s, KILOBYTE);
 			if (result <= 0)
 				throw FmtRuntimeError("buffer size \"{}\" is not a "
 						      "positive integer", s);
 
-			if (result < MIN_BUFFER_SIZE) {
+			const size_t min_size = std::max(MIN_BUFFER_SIZE,
+							 chunk_size * 32);
+			if (result < min_size) {
 				FmtWarning(config_domain, "buffer size {} is too small, using {} bytes instead",
-					   result, MIN_BUFFER_SIZE);
-				result = MIN_BUFFER_SIZE;
+					   result, min_size);
+				result = min_size;
 			}
 
 			return result;
 		});
 	}
 
-	unsigned buffer_chunks = buffer_size / CHUNK_SIZE;
+	unsigned buffer_chunks = buffer_size / chunk_size;
 	if (buffer_chunks >= 1 << 15)
 		throw FmtRuntimeError("buffer size \"{}\" is too big",
 				      buffer_size);
@@ -59,15 +78,55 @@ GetBufferChunks(const ConfigData &config)
 	return buffer_chunks;
 }
 
+static MusicBufferOptions
+GetBufferOptions(const ConfigData &config)
+{
+	MusicBufferOptions options;
+	options.huge_tlb = config.GetBool(ConfigOption::AUDIO_BUFFER_HUGETLB,
+					  false);
+	options.prefault = config.GetBool(ConfigOption::AUDIO_BUFFER_PREFAULT,
+					  false);
+	options.lock = config.GetBool(ConfigOption::AUDIO_BUFFER_LOCK, false);
+
+	if (config.GetParam(ConfigOption::AUDIO_BUFFER_NUMA_NODE) != nullptr)
+		options.numa_node = config.GetUnsigned(ConfigOption::AUDIO_BUFFER_NUMA_NODE,
+						       0);
+
+	return options;
+}
+
+static std::chrono::steady_clock::duration
+GetOutputWakeupThreshold(const ConfigData &config)
+{
+	/* the "efficiency" power profile coalesces output wakeups
+	   by default */
+	const unsigned default_ms =
+		ParsePowerProfile(config) == PowerProfile::EFFICIENCY
+		? 500 : 0;
+
+	return std::chrono::milliseconds(config.GetUnsigned(ConfigOption::AUDIO_OUTPUT_WAKEUP_THRESHOLD,
+							    default_ms));
+}
+
 PlayerConfig::PlayerConfig(const ConfigData &config)
-	:buffer_chunks(GetBufferChunks(config)),
+	:chunk_size(GetChunkSize(config)),
+	 buffer_chunks(GetBufferChunks(config, chunk_size)),
+	 buffer_options(GetBufferOptions(config)),
 	 audio_format(config.With(ConfigOption::AUDIO_OUTPUT_FORMAT, [](const char *s){
 		 if (s == nullptr)
 			 return AudioFormat::Undefined();
 
 		 return ParseAudioFormat(s, true);
 	 })),
+	 output_wakeup_threshold(GetOutputWakeupThreshold(config)),
 	 replay_gain(config),
-	 mixramp_analyzer(config.GetBool(ConfigOption::MIXRAMP_ANALYZER, false))
+	 mixramp_analyzer(config.GetBool(ConfigOption::MIXRAMP_ANALYZER, false)),
+	 seek_history(SongTime::Cast(config.GetUnsigned(ConfigOption::SEEK_HISTORY,
+							 std::chrono::steady_clock::duration{}))),
+	 idle_timeout(config.GetUnsigned(ConfigOption::PLAYER_IDLE_TIMEOUT,
+					 std::chrono::steady_clock::duration{})),
+	 low_latency(config.GetBool(ConfigOption::PLAYER_LOW_LATENCY, false)),
+	 float_pipeline(config.GetBool(ConfigOption::FLOAT_PIPELINE, false)),
+	 power_profile(ParsePowerProfile(config))
 {
 }
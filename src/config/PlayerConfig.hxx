@@ -21,6 +21,9 @@
 
 #include "pcm/AudioFormat.hxx"
 #include "ReplayGainConfig.hxx"
+#include "MusicBufferOptions.hxx"
+#include "thread/Profile.hxx"
+#include "Chrono.hxx"
 
 struct ConfigData;
 
@@ -30,17 +33,74 @@ static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
 struct PlayerConfig {
 	static constexpr size_t DEFAULT_BUFFER_SIZE = 8 * MEGABYTE;
 
+	/**
+	 * The "audio_buffer_chunk_size" setting: the size of the
+	 * data buffer of each #MusicChunk.
+	 */
+	size_t chunk_size = 4096; // CHUNK_SIZE
+
 	unsigned buffer_chunks = DEFAULT_BUFFER_SIZE;
 
+	/**
+	 * The "audio_buffer_hugetlb", "audio_buffer_prefault",
+	 * "audio_buffer_lock" and "audio_buffer_numa_node" settings.
+	 */
+	MusicBufferOptions buffer_options;
+
 	/**
 	 * The "audio_output_format" setting.
 	 */
 	AudioFormat audio_format = AudioFormat::Undefined();
 
+	/**
+	 * The "audio_output_wakeup_threshold" setting: wake up audio
+	 * outputs only after this much new audio data has been
+	 * queued for them.  Zero wakes them for every chunk.
+	 */
+	std::chrono::steady_clock::duration output_wakeup_threshold{};
+
 	ReplayGainConfig replay_gain;
 
 	bool mixramp_analyzer = false;
 
+	/**
+	 * The "seek_history" setting: keep chunks which have been
+	 * played during this duration, to be able to seek back
+	 * without decoding again.  Zero disables this.
+	 */
+	SongTime seek_history = SongTime::zero();
+
+	/**
+	 * The "player_idle_timeout" setting: exit the player thread
+	 * (and with it the decoder thread and the #MusicBuffer)
+	 * after playback has been stopped for this duration.  Zero
+	 * disables this.
+	 */
+	std::chrono::steady_clock::duration idle_timeout{};
+
+	/**
+	 * The "player_low_latency" setting: start the outputs as
+	 * soon as the first chunk has been decoded instead of
+	 * buffering one second first.
+	 */
+	bool low_latency = false;
+
+	/**
+	 * The "float_pipeline" setting: convert all PCM data to
+	 * floating point in the decoder thread, so cross-fading,
+	 * ReplayGain and software volume operate on float and each
+	 * output converts only once, to its own format.
+	 */
+	bool float_pipeline = false;
+
+	/**
+	 * The "power_profile" setting.  With
+	 * PowerProfile::EFFICIENCY, the decoder is woken up only
+	 * after most of the buffer has been played, and then
+	 * refills it in one burst.
+	 */
+	PowerProfile power_profile = PowerProfile::DEFAULT;
+
 	PlayerConfig() = default;
 
 	explicit PlayerConfig(const ConfigData &config);
@@ -20,6 +20,8 @@
 #include "ReplayGainConfig.hxx"
 #include "Data.hxx"
 
+#include "util/StringAPI.hxx"
+
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
@@ -41,6 +43,17 @@ ParsePreamp(const char *s)
 	return std::pow(10.0f, f / 20.0f);
 }
 
+static bool
+ParseStage(const char *s)
+{
+	if (s == nullptr || StringIsEqual(s, "output"))
+		return false;
+	else if (StringIsEqual(s, "decoder"))
+		return true;
+	else
+		throw std::invalid_argument("Must be \"output\" or \"decoder\"");
+}
+
 ReplayGainConfig::ReplayGainConfig(const ConfigData &config)
 	:preamp(config.With(ConfigOption::REPLAYGAIN_PREAMP, [](const char *s){
 		return s != nullptr
@@ -53,6 +66,7 @@ ReplayGainConfig::ReplayGainConfig(const ConfigData &config)
 			 : 1.0f;
 	 })),
 	 limit(config.GetBool(ConfigOption::REPLAYGAIN_LIMIT,
-			      ReplayGainConfig::DEFAULT_LIMIT))
+			      ReplayGainConfig::DEFAULT_LIMIT)),
+	 in_decoder(config.With(ConfigOption::REPLAYGAIN_STAGE, ParseStage))
 {
 }
@@ -30,6 +30,12 @@ struct ReplayGainConfig {
 
 	bool limit = DEFAULT_LIMIT;
 
+	/**
+	 * Apply ReplayGain once in the decoder thread instead of in
+	 * each audio output's filter chain?
+	 */
+	bool in_decoder = false;
+
 	ReplayGainConfig() = default;
 
 	explicit ReplayGainConfig(const ConfigData &config);
@@ -31,41 +31,74 @@ const ConfigTemplate config_param_templates[] = {
 	{ "follow_outside_symlinks" },
 	{ "db_file" },
 	{ "sticker_file" },
+	{ "sticker_synchronous" },
+	{ "sticker_commit_delay" },
+	{ "song_analysis" },
+	{ "picture_cache_size" },
+	{ "remote_tag_cache_file" },
+	{ "remote_tag_cache_size" },
+	{ "remote_tag_cache_ttl" },
 	{ "log_file" },
 	{ "pid_file" },
 	{ "state_file" },
 	{ "state_file_interval" },
+	{ "state_file_journal" },
 	{ "restore_paused" },
 	{ "user" },
 	{ "group" },
 	{ "bind_to_address", true },
 	{ "port" },
 	{ "log_level" },
+	{ "log_rate_limit" },
 	{ "zeroconf_name" },
 	{ "zeroconf_enabled" },
+	{ "metrics_port" },
+	{ "metrics_bind_to_address" },
+	{ "event_loop_profile" },
+	{ "event_loop_slow_threshold" },
 	{ "password", true },
 	{ "host_permissions", true },
 	{ "local_permissions" },
 	{ "default_permissions" },
 	{ "audio_output_format" },
+	{ "audio_output_wakeup_threshold" },
 	{ "mixer_type" },
+	{ "volume_coalesce_window" },
 	{ "replaygain" },
 	{ "replaygain_preamp" },
 	{ "replaygain_missing_preamp" },
 	{ "replaygain_limit" },
+	{ "replaygain_stage" },
 	{ "volume_normalization" },
 	{ "samplerate_converter" },
+	{ "dsd2pcm_decimation" },
+	{ "dsd2pcm_quality" },
+	{ "conversion_threads" },
 	{ "audio_buffer_size" },
+	{ "audio_buffer_chunk_size" },
+	{ "audio_buffer_hugetlb" },
+	{ "audio_buffer_prefault" },
+	{ "audio_buffer_lock" },
+	{ "audio_buffer_numa_node" },
 	{ "buffer_before_play", false, true },
+	{ "max_input_buffer_size" },
 	{ "http_proxy_host", false, true },
 	{ "http_proxy_port", false, true },
 	{ "http_proxy_user", false, true },
 	{ "http_proxy_password", false, true },
 	{ "connection_timeout" },
+	{ "idle_coalesce_window" },
+	{ "slow_command_threshold" },
 	{ "max_connections" },
 	{ "max_playlist_length" },
 	{ "max_command_list_size" },
+	{ "stream_command_lists" },
 	{ "max_output_buffer_size" },
+	{ "max_background_threads" },
+	{ "client_threads" },
+	{ "listen_reuseport" },
+	{ "tag_scan_threads" },
+	{ "fingerprint_threads" },
 	{ "filesystem_charset" },
 	{ "id3v1_encoding", false, true },
 	{ "metadata_to_use" },
@@ -73,10 +106,22 @@ const ConfigTemplate config_param_templates[] = {
 	{ "gapless_mp3_playback", false, true },
 	{ "auto_update" },
 	{ "auto_update_depth" },
+	{ "update_threads" },
+	{ "update_batch_size" },
+	{ "update_skip_cache" },
+	{ "update_all_tags" },
+	{ "background_database_load" },
 	{ "despotify_user", false, true },
 	{ "despotify_password", false, true },
 	{ "despotify_high_bitrate", false, true },
 	{ "mixramp_analyzer" },
+	{ "seek_index_cache" },
+	{ "seek_history" },
+	{ "player_idle_timeout" },
+	{ "player_low_latency" },
+	{ "lock_memory" },
+	{ "power_profile" },
+	{ "float_pipeline" },
 };
 
 static constexpr unsigned n_config_param_templates =
@@ -97,6 +142,7 @@ const ConfigTemplate config_block_templates[] = {
 	{ "database" },
 	{ "neighbors", true },
 	{ "partition", true },
+	{ "thread", true },
 };
 
 static constexpr unsigned n_config_block_templates =
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ThreadConfig.hxx"
+#include "Data.hxx"
+#include "Block.hxx"
+#include "Domain.hxx"
+#include "thread/Profile.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringAPI.hxx"
+#include "Log.hxx"
+
+#include <array>
+#include <cerrno>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * The highest CPU number accepted by "cpu_affinity" (plus one); this
+ * is the size of glibc's cpu_set_t.
+ */
+static constexpr unsigned MAX_CPUS = 1024;
+
+static constexpr std::array thread_profile_names{
+	"decoder"sv,
+	"player"sv,
+	"output"sv,
+	"update"sv,
+};
+
+static_assert(thread_profile_names.size() == std::size_t(ThreadProfileType::MAX));
+
+static ThreadProfileType
+ParseThreadProfileType(const char *s)
+{
+	for (std::size_t i = 0; i < thread_profile_names.size(); ++i)
+		if (s == thread_profile_names[i])
+			return ThreadProfileType(i);
+
+	throw FmtRuntimeError("Unknown thread name: \"{}\"", s);
+}
+
+static unsigned
+ParseCpuNumber(const char *s, char **endptr)
+{
+	const unsigned cpu = ParseUnsigned(s, endptr);
+	if (*endptr == s || cpu >= MAX_CPUS)
+		throw FmtRuntimeError("Invalid CPU number: \"{}\"", s);
+
+	return cpu;
+}
+
+/**
+ * Parse a CPU list such as "0,2-3".
+ */
+static std::vector<unsigned>
+ParseCpuList(const char *s)
+{
+	std::vector<unsigned> cpus;
+
+	while (true) {
+		char *endptr;
+		const unsigned first = ParseCpuNumber(s, &endptr);
+		unsigned last = first;
+
+		if (*endptr == '-') {
+			last = ParseCpuNumber(endptr + 1, &endptr);
+			if (last < first)
+				throw FmtRuntimeError("Invalid CPU range: \"{}\"",
+						      s);
+		}
+
+		for (unsigned i = first; i <= last; ++i)
+			cpus.push_back(i);
+
+		if (*endptr == 0)
+			break;
+
+		if (*endptr != ',')
+			throw FmtRuntimeError("Malformed CPU list: \"{}\"", s);
+
+		s = endptr + 1;
+	}
+
+	return cpus;
+}
+
+static ThreadProfile
+ParseThreadProfile(const ConfigBlock &block)
+{
+	ThreadProfile profile;
+
+	if (const auto *p = block.GetBlockParam("cpu_affinity"))
+		profile.cpus = p->With(ParseCpuList);
+
+	if (const auto *p = block.GetBlockParam("realtime_priority")) {
+		const unsigned priority = p->GetUnsignedValue();
+		if (priority > 99)
+			throw FmtRuntimeError("realtime_priority {} is out of range (0..99)",
+					      priority);
+
+		profile.realtime_priority = priority;
+	}
+
+	if (const auto *p = block.GetBlockParam("timer_slack"))
+		profile.timer_slack = std::chrono::microseconds(p->GetUnsignedValue());
+
+	return profile;
+}
+
+PowerProfile
+ParsePowerProfile(const ConfigData &config)
+{
+	return config.With(ConfigOption::POWER_PROFILE, [](const char *s){
+		if (s == nullptr || StringIsEqual(s, "default"))
+			return PowerProfile::DEFAULT;
+
+		if (StringIsEqual(s, "efficiency"))
+			return PowerProfile::EFFICIENCY;
+
+		throw FmtRuntimeError("Unknown power profile: \"{}\"", s);
+	});
+}
+
+static void
+LockMemory()
+{
+#ifdef _WIN32
+	LogWarning(config_domain, "lock_memory is not supported on this platform");
+#else
+	if (mlockall(MCL_CURRENT|MCL_FUTURE) < 0)
+		FmtError(config_domain, "mlockall() failed: {}",
+			 std::error_code{errno, std::system_category()}.message());
+#endif
+}
+
+void
+ThreadConfigInit(const ConfigData &config)
+{
+	config.WithEach(ConfigBlockOption::THREAD, [](const auto &block){
+		const char *name = block.GetBlockValue("name");
+		if (name == nullptr)
+			throw std::runtime_error("Missing \"name\" configuration");
+
+		const auto type = ParseThreadProfileType(name);
+		SetThreadProfile(type, ParseThreadProfile(block));
+	});
+
+	SetPowerProfile(ParsePowerProfile(config));
+
+	if (config.GetBool(ConfigOption::LOCK_MEMORY, false))
+		LockMemory();
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CONFIG_THREAD_HXX
+#define MPD_CONFIG_THREAD_HXX
+
+#include <cstdint>
+
+struct ConfigData;
+enum class PowerProfile : uint8_t;
+
+/**
+ * Parse the "power_profile" setting.
+ *
+ * Throws on error.
+ */
+PowerProfile
+ParsePowerProfile(const ConfigData &config);
+
+/**
+ * Parse the "thread" blocks and install them with
+ * SetThreadProfile(), install the "power_profile" setting and apply
+ * the "lock_memory" setting.
+ *
+ * Throws on error.
+ */
+void
+ThreadConfigInit(const ConfigData &config);
+
+#endif
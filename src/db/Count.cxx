@@ -18,30 +18,16 @@
  */
 
 #include "Count.hxx"
+#include "GroupCount.hxx"
 #include "Selection.hxx"
 #include "Interface.hxx"
 #include "Partition.hxx"
 #include "client/Response.hxx"
-#include "song/LightSong.hxx"
-#include "tag/Tag.hxx"
-#include "tag/VisitFallback.hxx"
 #include "TagPrint.hxx"
 
 #include <fmt/format.h>
 
-#include <functional>
-#include <map>
-
-struct SearchStats {
-	unsigned n_songs{0};
-	std::chrono::duration<std::uint64_t, SongTime::period> total_duration;
-
-	constexpr SearchStats()
-		: total_duration(0) {}
-};
-
-class TagCountMap : public std::map<std::string, SearchStats> {
-};
+#include <cassert>
 
 static void
 PrintSearchStats(Response &r, const SearchStats &stats) noexcept
@@ -65,34 +51,6 @@ Print(Response &r, TagType group, const TagCountMap &m) noexcept
 	}
 }
 
-static void
-stats_visitor_song(SearchStats &stats, const LightSong &song) noexcept
-{
-	stats.n_songs++;
-
-	if (const auto duration = song.GetDuration(); !duration.IsNegative())
-		stats.total_duration += duration;
-}
-
-static void
-CollectGroupCounts(TagCountMap &map, const Tag &tag,
-		   const char *value) noexcept
-{
-	auto &s = map.emplace(value, SearchStats()).first->second;
-	++s.n_songs;
-	if (!tag.duration.IsNegative())
-		s.total_duration += tag.duration;
-}
-
-static void
-GroupCountVisitor(TagCountMap &map, TagType group,
-		  const LightSong &song) noexcept
-{
-	const Tag &tag = song.tag;
-	VisitTagWithFallbackOrEmpty(tag, group, [&](const auto &val)
-		{ return CollectGroupCounts(map, tag, val);  });
-}
-
 void
 PrintSongCount(Response &r, const Partition &partition, const char *name,
 	       const SongFilter *filter,
@@ -102,28 +60,12 @@ PrintSongCount(Response &r, const Partition &partition, const char *name,
 
 	const DatabaseSelection selection(name, true, filter);
 
+	const auto map = db.CountSongs(selection, group);
+
 	if (group == TAG_NUM_OF_ITEM_TYPES) {
 		/* no grouping */
-
-		SearchStats stats;
-
-		const auto f = [&](const auto &song)
-			{ return stats_visitor_song(stats, song); };
-
-		db.Visit(selection, f);
-
-		PrintSearchStats(r, stats);
-	} else {
-		/* group by the specified tag: store counts in a
-		   std::map */
-
-		TagCountMap map;
-
-		const auto f = [&map,group](const auto &song)
-			{ return GroupCountVisitor(map, group, song); };
-
-		db.Visit(selection, f);
-
+		assert(map.size() == 1);
+		PrintSearchStats(r, map.begin()->second);
+	} else
 		Print(r, group, map);
-	}
 }
@@ -32,6 +32,12 @@ enum class DatabaseErrorCode {
 	NOT_FOUND,
 
 	CONFLICT,
+
+	/**
+	 * The database is still being loaded (see
+	 * "background_database_load").
+	 */
+	LOADING,
 };
 
 class DatabaseError final : public std::runtime_error {
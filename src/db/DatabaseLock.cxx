@@ -21,6 +21,8 @@
 
 Mutex db_mutex;
 
+DurationMetric db_lock_wait;
+
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
 #endif
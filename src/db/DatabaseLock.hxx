@@ -27,11 +27,18 @@
 #define MPD_DB_LOCK_HXX
 
 #include "thread/Mutex.hxx"
+#include "metrics/Histogram.hxx"
 
 #include <cassert>
 
 extern Mutex db_mutex;
 
+/**
+ * How long threads had to wait for #db_mutex (only contended
+ * attempts are counted).
+ */
+extern DurationMetric db_lock_wait;
+
 #ifndef NDEBUG
 
 #include "thread/Id.hxx"
@@ -59,7 +66,12 @@ db_lock(void)
 {
 	assert(!holding_db_lock());
 
-	db_mutex.lock();
+	if (!db_mutex.try_lock()) {
+		/* contended: measure how long we have to wait */
+		const auto start = std::chrono::steady_clock::now();
+		db_mutex.lock();
+		db_lock_wait.Add(std::chrono::steady_clock::now() - start);
+	}
 
 	assert(db_mutex_holder.IsNull());
 #ifndef NDEBUG
@@ -21,13 +21,17 @@
 #include "Selection.hxx"
 #include "SongPrint.hxx"
 #include "TimePrint.hxx"
+#include "client/Client.hxx"
 #include "client/Response.hxx"
 #include "Partition.hxx"
+#include "Instance.hxx"
+#include "song/Filter.hxx"
 #include "song/LightSong.hxx"
 #include "tag/Tag.hxx"
 #include "LightDirectory.hxx"
 #include "PlaylistInfo.hxx"
 #include "Interface.hxx"
+#include "DatabaseError.hxx"
 #include "fs/Traits.hxx"
 #include "time/ChronoUtil.hxx"
 #include "util/RecursiveMap.hxx"
@@ -35,6 +39,8 @@
 #include <fmt/format.h>
 
 #include <functional>
+#include <string>
+#include <vector>
 
 gcc_pure
 static const char *
@@ -170,6 +176,173 @@ db_selection_print(Response &r, Partition &partition,
 	db.Visit(selection, d, s, p);
 }
 
+namespace {
+
+/**
+ * Collects the output of a #Response in a string.
+ */
+class StringResponseSink final : public ResponseSink {
+public:
+	std::string value;
+
+	bool WriteResponse(const void *data,
+			   std::size_t length) noexcept override {
+		value.append((const char *)data, length);
+		return true;
+	}
+};
+
+}
+
+void
+PrintDirectoryInfo(Client &client, Response &r, const char *uri)
+{
+	auto &partition = client.GetPartition();
+	auto &cache = partition.instance.lsinfo_cache;
+
+	auto key = LsinfoCache::MakeKey(uri, r.GetTagMask(), r.IsCompact());
+	if (const auto *item = cache.Get(key)) {
+		r.DeclareCompactKeys(item->compact_keys);
+		r.Write(item->data);
+		return;
+	}
+
+	const DatabaseSelection selection(uri, false);
+
+	StringResponseSink sink;
+	uint_least64_t compact_keys;
+
+	{
+		Response r2(client, 0, sink);
+		r2.SetCommand(r.GetCommand());
+		db_selection_print(r2, partition, selection, true, false);
+		compact_keys = r2.GetCompactKeys();
+	}
+
+	r.DeclareCompactKeys(compact_keys);
+	r.Write(sink.value);
+
+	cache.Put(std::move(key), {std::move(sink.value), compact_keys});
+}
+
+namespace {
+
+/**
+ * A directory which was found by PrintDirectoryTree() but not yet
+ * visited.  Unlike #LightDirectory, this owns a copy of the URI, which
+ * remains valid after the database lock has been released.
+ */
+struct PendingDirectory {
+	std::string uri;
+	std::chrono::system_clock::time_point mtime;
+
+	LightDirectory Export() const noexcept {
+		return {uri.c_str(), mtime};
+	}
+};
+
+}
+
+/**
+ * Find the #LightDirectory attributes of the given directory by
+ * visiting its parent.
+ */
+static bool
+FindDirectory(const Database &db, PendingDirectory &d)
+{
+	const auto slash = d.uri.rfind('/');
+	const std::string parent = slash == std::string::npos
+		? std::string{}
+		: d.uri.substr(0, slash);
+
+	bool found = false;
+	const auto f = [&d, &found](const LightDirectory &directory){
+		if (d.uri == directory.GetPath()) {
+			d.mtime = directory.mtime;
+			found = true;
+		}
+	};
+
+	db.Visit(DatabaseSelection(parent.c_str(), false), f,
+		 VisitSong(), VisitPlaylist());
+	return found;
+}
+
+void
+PrintDirectoryTree(Response &r, Partition &partition,
+		   const char *uri, bool full)
+{
+	const Database &db = partition.GetDatabaseOrThrow();
+
+	const auto print_directory = [&r, full](const LightDirectory &dir){
+		if (full)
+			PrintDirectoryFull(r, false, dir);
+		else
+			PrintDirectoryBrief(r, false, dir);
+	};
+
+	/* the directories which still need to be visited; the last
+	   one is next */
+	std::vector<PendingDirectory> stack;
+
+	/* the children of the current directory, in the order
+	   reported by the database */
+	std::vector<PendingDirectory> children;
+
+	const auto d = [&children](const LightDirectory &dir){
+		children.push_back({dir.GetPath(), dir.mtime});
+	};
+
+	const auto s = [&r, full](const LightSong &song){
+		if (full)
+			PrintSongFull(r, false, song);
+		else
+			PrintSongBrief(r, false, song);
+	};
+
+	const auto p = [&r, full](const PlaylistInfo &playlist,
+				  const LightDirectory &dir){
+		if (full)
+			PrintPlaylistFull(r, false, playlist, dir);
+		else
+			PrintPlaylistBrief(r, false, playlist, dir);
+	};
+
+	PendingDirectory top{uri, {}};
+	if (!top.uri.empty() && FindDirectory(db, top))
+		print_directory(top.Export());
+
+	/* this may be a song; then this throws if it doesn't exist */
+	db.Visit(DatabaseSelection(uri, false), d, s, p);
+
+	while (true) {
+		stack.insert(stack.end(),
+			     std::make_move_iterator(children.rbegin()),
+			     std::make_move_iterator(children.rend()));
+		children.clear();
+
+		if (stack.empty() || !r.Throttle())
+			break;
+
+		const auto current = std::move(stack.back());
+		stack.pop_back();
+
+		print_directory(current.Export());
+
+		try {
+			db.Visit(DatabaseSelection(current.uri.c_str(), false),
+				 d, s, p);
+		} catch (const DatabaseError &e) {
+			if (e.GetCode() != DatabaseErrorCode::NOT_FOUND)
+				throw;
+
+			/* the directory was deleted by a concurrent
+			   database update */
+			children.clear();
+		}
+	}
+}
+
 static void
 PrintSongURIVisitor(Response &r, const LightSong &song) noexcept
 {
@@ -214,6 +387,22 @@ PrintUniqueTags(Response &r, Partition &partition,
 
 	const DatabaseSelection selection("", true, filter);
 
-	PrintUniqueTags(r, tag_types,
-			db.CollectUniqueTags(selection, tag_types));
+	if (filter != nullptr && filter->HasSticker()) {
+		/* the cache is only invalidated when the song
+		   database changes, not when a sticker is
+		   modified */
+		PrintUniqueTags(r, tag_types,
+				db.CollectUniqueTags(selection, tag_types));
+		return;
+	}
+
+	auto &cache = partition.instance.unique_tags_cache;
+	auto key = UniqueTagsCache::MakeKey(selection, tag_types);
+	const auto *result = cache.Get(key);
+	if (result == nullptr)
+		result = &cache.Put(std::move(key),
+				    db.CollectUniqueTags(selection,
+							 tag_types));
+
+	PrintUniqueTags(r, tag_types, *result);
 }
@@ -25,6 +25,7 @@
 
 enum TagType : uint8_t;
 class SongFilter;
+class Client;
 struct DatabaseSelection;
 struct Partition;
 class Response;
@@ -38,6 +39,29 @@ db_selection_print(Response &r, Partition &partition,
 		   const DatabaseSelection &selection,
 		   bool full, bool base);
 
+/**
+ * Print the contents of one directory for the "lsinfo" command, like
+ * db_selection_print() with a non-recursive selection, full
+ * attributes and no filter.  The output is served from (or stored
+ * in) Instance::lsinfo_cache.
+ */
+void
+PrintDirectoryInfo(Client &client, Response &r, const char *uri);
+
+/**
+ * Like db_selection_print() with a recursive selection without
+ * filter, but visit the database one directory at a time.  The
+ * database lock is released between directories, and
+ * Response::Throttle() is called to wait for slow clients; this keeps
+ * the memory usage of huge listings bounded.  If the database is
+ * modified meanwhile, the listing is a mix of old and new state.
+ *
+ * @param full print attributes/tags
+ */
+void
+PrintDirectoryTree(Response &r, Partition &partition,
+		   const char *uri, bool full);
+
 void
 PrintSongUris(Response &r, Partition &partition,
 	      const SongFilter *filter);
@@ -25,22 +25,36 @@
 #include "song/DetachedSong.hxx"
 
 #include <functional>
+#include <vector>
+
+/**
+ * Songs are collected in batches of this size and then appended to
+ * the queue with playlist::AppendSongs().
+ */
+static constexpr std::size_t ADD_BATCH_SIZE = 1024;
 
 static void
-AddToQueue(Partition &partition, const LightSong &song)
+FlushToQueue(Partition &partition, std::vector<DetachedSong> &songs)
 {
-	const auto *storage = partition.instance.storage;
-	partition.playlist.AppendSong(partition.pc,
-				      DatabaseDetachSong(storage,
-							 song));
+	partition.playlist.AppendSongs(partition.pc, songs);
+	songs.clear();
 }
 
 void
 AddFromDatabase(Partition &partition, const DatabaseSelection &selection)
 {
 	const Database &db = partition.instance.GetDatabaseOrThrow();
+	const auto *storage = partition.instance.storage;
+
+	std::vector<DetachedSong> songs;
+	songs.reserve(ADD_BATCH_SIZE);
 
-	const auto f = [&](const auto &song)
-		{ return AddToQueue(partition, song); };
+	const auto f = [&](const auto &song){
+		songs.emplace_back(DatabaseDetachSong(storage, song));
+		if (songs.size() >= ADD_BATCH_SIZE)
+			FlushToQueue(partition, songs);
+	};
 	db.Visit(selection, f);
+
+	FlushToQueue(partition, songs);
 }
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "GroupCount.hxx"
+#include "Interface.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Item.hxx"
+#include "tag/Pool.hxx"
+#include "tag/Tag.hxx"
+#include "tag/VisitFallback.hxx"
+
+#include <unordered_map>
+
+namespace {
+
+/**
+ * Counts songs by #TagItem pointer.  Each key holds a reference on
+ * the pooled item, so the pointer cannot be reused for a different
+ * value while counting, even if the song it came from was transient
+ * (e.g. from a mounted database).
+ */
+class TagItemCounter {
+	std::unordered_map<TagItem *, SearchStats> items;
+
+	/** songs without the tag */
+	SearchStats empty;
+
+public:
+	TagItemCounter() = default;
+
+	~TagItemCounter() noexcept {
+		for (const auto &i : items)
+			tag_pool_put_item(i.first);
+	}
+
+	TagItemCounter(const TagItemCounter &) = delete;
+	TagItemCounter &operator=(const TagItemCounter &) = delete;
+
+	void Add(TagItem *item, const Tag &tag) noexcept {
+		SearchStats *s = &empty;
+		if (item != nullptr) {
+			auto i = items.find(item);
+			if (i == items.end())
+				i = items.emplace(tag_pool_dup_item(item),
+						  SearchStats{}).first;
+			s = &i->second;
+		}
+
+		++s->n_songs;
+		if (!tag.duration.IsNegative())
+			s->total_duration += tag.duration;
+	}
+
+	/**
+	 * Convert to a #TagCountMap.  Items of different tag types
+	 * (due to fallbacks) with the same value are merged.
+	 */
+	TagCountMap Commit() const {
+		TagCountMap result;
+
+		if (empty.n_songs > 0)
+			result[std::string{}] += empty;
+
+		for (const auto &[item, stats] : items) {
+			const std::string_view value{item->value};
+			auto i = result.find(value);
+			if (i == result.end())
+				result.emplace(value, stats);
+			else
+				i->second += stats;
+		}
+
+		return result;
+	}
+};
+
+} // anonymous namespace
+
+static void
+CountSong(SearchStats &stats, const LightSong &song) noexcept
+{
+	stats.n_songs++;
+
+	if (const auto duration = song.GetDuration(); !duration.IsNegative())
+		stats.total_duration += duration;
+}
+
+TagCountMap
+CountSongs(const Database &db, const DatabaseSelection &selection,
+	   TagType group)
+{
+	if (group == TAG_NUM_OF_ITEM_TYPES) {
+		/* no grouping */
+
+		SearchStats stats;
+		db.Visit(selection, [&stats](const LightSong &song){
+			CountSong(stats, song);
+		});
+
+		TagCountMap result;
+		result.emplace(std::string{}, stats);
+		return result;
+	}
+
+	TagItemCounter counter;
+
+	db.Visit(selection, [&counter, group](const LightSong &song){
+		const Tag &tag = song.tag;
+		VisitTagItemWithFallbackOrEmpty(tag, group, [&](TagItem *item){
+			counter.Add(item, tag);
+		});
+	});
+
+	return counter.Commit();
+}
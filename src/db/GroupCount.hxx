@@ -0,0 +1,70 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DB_GROUP_COUNT_HXX
+#define MPD_DB_GROUP_COUNT_HXX
+
+#include "Chrono.hxx"
+#include "tag/Type.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+class Database;
+struct DatabaseSelection;
+
+struct SearchStats {
+	unsigned n_songs{0};
+	std::chrono::duration<std::uint64_t, SongTime::period> total_duration;
+
+	constexpr SearchStats()
+		: total_duration(0) {}
+
+	constexpr SearchStats &operator+=(const SearchStats &other) noexcept {
+		n_songs += other.n_songs;
+		total_duration += other.total_duration;
+		return *this;
+	}
+};
+
+/**
+ * The result of Database::CountSongs(): tag value to statistics,
+ * sorted by tag value.
+ */
+class TagCountMap : public std::map<std::string, SearchStats, std::less<>> {
+};
+
+/**
+ * Walk the database and count the matching songs, grouped by the
+ * given tag (or not grouped at all if #TAG_NUM_OF_ITEM_TYPES is
+ * given; the result then has exactly one item with an empty key).
+ *
+ * During the walk, groups are keyed by the interned #TagItem pointer
+ * from the tag pool, which avoids hashing or copying the value string
+ * for each song; the strings are only copied once per group at the
+ * end.
+ */
+TagCountMap
+CountSongs(const Database &db, const DatabaseSelection &selection,
+	   TagType group);
+
+#endif
@@ -23,34 +23,33 @@
 #include "song/LightSong.hxx"
 #include "tag/Tag.hxx"
 
-#include <set>
-
-#include <string.h>
+static void
+AddString(std::set<std::string, std::less<>> &set, const char *value) noexcept
+{
+	/* look up first to avoid allocating a std::string for
+	   values which are already known (the common case) */
+	if (set.find(value) == set.end())
+		set.emplace(value);
+}
 
-struct StringLess {
-	gcc_pure
-	bool operator()(const char *a, const char *b) const noexcept {
-		return strcmp(a, b) < 0;
-	}
-};
+void
+DatabaseStatsCollector::Add(const LightSong &song) noexcept
+{
+	++stats.song_count;
 
-using StringSet = std::set<const char *, StringLess>;
+	const Tag &tag = song.tag;
 
-static void
-StatsVisitTag(DatabaseStats &stats, StringSet &artists, StringSet &albums,
-	      const Tag &tag) noexcept
-{
 	if (!tag.duration.IsNegative())
 		stats.total_duration += tag.duration;
 
 	for (const auto &item : tag) {
 		switch (item.type) {
 		case TAG_ARTIST:
-			artists.emplace(item.value);
+			AddString(artists, item.value);
 			break;
 
 		case TAG_ALBUM:
-			albums.emplace(item.value);
+			AddString(albums, item.value);
 			break;
 
 		default:
@@ -59,28 +58,22 @@ StatsVisitTag(DatabaseStats &stats, StringSet &artists, StringSet &albums,
 	}
 }
 
-static void
-StatsVisitSong(DatabaseStats &stats, StringSet &artists, StringSet &albums,
-	       const LightSong &song) noexcept
+void
+DatabaseStatsCollector::Merge(const DatabaseStatsCollector &other) noexcept
 {
-	++stats.song_count;
-
-	StatsVisitTag(stats, artists, albums, song.tag);
+	stats.song_count += other.stats.song_count;
+	stats.total_duration += other.stats.total_duration;
+	artists.insert(other.artists.begin(), other.artists.end());
+	albums.insert(other.albums.begin(), other.albums.end());
 }
 
 DatabaseStats
 GetStats(const Database &db, const DatabaseSelection &selection)
 {
-	DatabaseStats stats;
-	stats.Clear();
-
-	StringSet artists, albums;
-	const auto f = [&](const auto &song)
-		{ return StatsVisitSong(stats, artists, albums, song); };
-
-	db.Visit(selection, f);
+	DatabaseStatsCollector collector;
+	db.Visit(selection, [&collector](const auto &song){
+		collector.Add(song);
+	});
 
-	stats.artist_count = artists.size();
-	stats.album_count = albums.size();
-	return stats;
+	return collector.Commit();
 }
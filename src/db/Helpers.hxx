@@ -20,9 +20,50 @@
 #ifndef MPD_DATABASE_HELPERS_HXX
 #define MPD_DATABASE_HELPERS_HXX
 
+#include "Stats.hxx"
+
+#include <set>
+#include <string>
+
 class Database;
 struct DatabaseSelection;
-struct DatabaseStats;
+struct LightSong;
+
+/**
+ * Accumulates #DatabaseStats from a sequence of songs.
+ */
+class DatabaseStatsCollector {
+	/**
+	 * The strings are copied (and not pointers into the
+	 * #LightSong), so a collector may outlive the songs it was
+	 * fed with.
+	 */
+	using StringSet = std::set<std::string, std::less<>>;
+
+	DatabaseStats stats;
+
+	StringSet artists, albums;
+
+public:
+	DatabaseStatsCollector() noexcept {
+		stats.Clear();
+	}
+
+	void Add(const LightSong &song) noexcept;
+
+	/**
+	 * Add all songs which were added to the other collector
+	 * (e.g. the one of a mounted database).
+	 */
+	void Merge(const DatabaseStatsCollector &other) noexcept;
+
+	DatabaseStats Commit() const noexcept {
+		DatabaseStats result = stats;
+		result.artist_count = artists.size();
+		result.album_count = albums.size();
+		return result;
+	}
+};
 
 DatabaseStats
 GetStats(const Database &db, const DatabaseSelection &selection);
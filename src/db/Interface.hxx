@@ -31,6 +31,7 @@ struct DatabasePlugin;
 struct DatabaseStats;
 struct DatabaseSelection;
 struct LightSong;
+class TagCountMap;
 template<typename Key> class RecursiveMap;
 
 class Database {
@@ -113,6 +114,17 @@ public:
 	virtual RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &selection,
 							    std::span<const TagType> tag_types) const = 0;
 
+	/**
+	 * Count the selected songs and their total duration, grouped
+	 * by the given tag type (or #TAG_NUM_OF_ITEM_TYPES for no
+	 * grouping; the result then has exactly one item with an
+	 * empty key).
+	 *
+	 * Throws on error.
+	 */
+	virtual TagCountMap CountSongs(const DatabaseSelection &selection,
+				       TagType group) const = 0;
+
 	/**
 	 * Throws on error.
 	 */
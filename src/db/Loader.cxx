@@ -0,0 +1,77 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Loader.hxx"
+#include "Interface.hxx"
+#include "thread/Name.hxx"
+
+#include <utility>
+
+DatabaseLoader::DatabaseLoader(EventLoop &_loop, Database &_db,
+			       Callback _callback) noexcept
+	:db(_db),
+	 inject(_loop, BIND_THIS_METHOD(OnFinished)),
+	 thread(BIND_THIS_METHOD(RunThread)),
+	 callback(_callback)
+{
+}
+
+DatabaseLoader::~DatabaseLoader() noexcept
+{
+	Join();
+}
+
+void
+DatabaseLoader::Start()
+{
+	thread.Start();
+}
+
+std::exception_ptr
+DatabaseLoader::Join() noexcept
+{
+	inject.Cancel();
+
+	if (thread.IsDefined())
+		thread.Join();
+
+	return error;
+}
+
+void
+DatabaseLoader::RunThread() noexcept
+{
+	SetThreadName("db_load");
+
+	try {
+		db.Open();
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	inject.Schedule();
+}
+
+void
+DatabaseLoader::OnFinished() noexcept
+{
+	thread.Join();
+	callback(std::exchange(error, {}));
+}
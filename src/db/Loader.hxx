@@ -0,0 +1,96 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_DB_LOADER_HXX
+#define MPD_DB_LOADER_HXX
+
+#include "event/InjectEvent.hxx"
+#include "thread/Thread.hxx"
+#include "util/BindMethod.hxx"
+
+#include <exception>
+
+class Database;
+
+/**
+ * Opens a #Database (i.e. loads the database file) in a separate
+ * thread, so MPD can serve clients and resume playback meanwhile.
+ * The database must not be accessed until the callback has been
+ * invoked.
+ */
+class DatabaseLoader final {
+	using Callback = BoundMethod<void(std::exception_ptr error) noexcept>;
+
+	Database &db;
+
+	InjectEvent inject;
+
+	Thread thread;
+
+	const Callback callback;
+
+	/**
+	 * The error thrown by Database::Open().  Written by the
+	 * thread, read in the main thread after joining it.
+	 */
+	std::exception_ptr error;
+
+public:
+	DatabaseLoader(EventLoop &_loop, Database &_db,
+		       Callback _callback) noexcept;
+
+	~DatabaseLoader() noexcept;
+
+	DatabaseLoader(const DatabaseLoader &) = delete;
+	DatabaseLoader &operator=(const DatabaseLoader &) = delete;
+
+	/**
+	 * Start the thread.  Must be called after daemonization.
+	 *
+	 * Throws on error.
+	 */
+	void Start();
+
+	/**
+	 * Is the thread still running (or has it finished, but the
+	 * callback has not yet been invoked)?
+	 */
+	bool IsRunning() const noexcept {
+		return thread.IsDefined();
+	}
+
+	/**
+	 * Wait for the thread to finish without invoking the
+	 * callback.  This is used during shutdown, when the
+	 * #EventLoop does not run anymore.
+	 *
+	 * @return the error thrown by Database::Open() (or nullptr
+	 * on success)
+	 */
+	std::exception_ptr Join() noexcept;
+
+private:
+	void RunThread() noexcept;
+
+	/* InjectEvent callback */
+	void OnFinished() noexcept;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "LsinfoCache.hxx"
+#include "tag/Mask.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+static constexpr Domain lsinfo_cache_domain("lsinfo_cache");
+
+std::string
+LsinfoCache::MakeKey(std::string_view uri, TagMask tag_mask,
+		     bool compact) noexcept
+{
+	std::string key;
+	key.reserve(TAG_NUM_OF_ITEM_TYPES + 2 + uri.size());
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		key.push_back(tag_mask.Test(TagType(i)) ? '1' : '0');
+
+	key.push_back(compact ? 'c' : '-');
+	key.push_back('\0');
+	key += uri;
+
+	return key;
+}
+
+const LsinfoCache::Item *
+LsinfoCache::Get(const std::string &key) noexcept
+{
+	const auto i = items.find(key);
+	if (i == items.end()) {
+		++misses;
+		return nullptr;
+	}
+
+	++hits;
+	return &i->second;
+}
+
+void
+LsinfoCache::Put(std::string &&key, Item &&item)
+{
+	if (item.data.size() > MAX_ITEM_SIZE)
+		return;
+
+	if (items.size() >= MAX_ITEMS ||
+	    size + item.data.size() > MAX_SIZE) {
+		items.clear();
+		size = 0;
+	}
+
+	size += item.data.size();
+
+	auto [i, inserted] = items.try_emplace(std::move(key),
+					       std::move(item));
+	if (!inserted) {
+		size -= i->second.data.size();
+		i->second = std::move(item);
+	}
+}
+
+void
+LsinfoCache::Clear() noexcept
+{
+	if (hits > 0 || misses > 0)
+		FmtDebug(lsinfo_cache_domain,
+			 "flushing {} entries ({} bytes); {} hits, {} misses",
+			 items.size(), size, hits, misses);
+
+	items.clear();
+	size = 0;
+	hits = misses = 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DB_LSINFO_CACHE_HXX
+#define MPD_DB_LSINFO_CACHE_HXX
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class TagMask;
+
+/**
+ * A cache for the serialized database part of "lsinfo" responses.
+ * File browsers send "lsinfo" for the same directories over and
+ * over, and each time, all songs need to be exported and all tag
+ * lines need to be formatted.
+ *
+ * The response depends on the client's tag mask and on whether the
+ * "compact" format is enabled; both are part of the key.
+ *
+ * The cache must be cleared whenever the database is modified (see
+ * DatabaseListener::OnDatabaseModified()).
+ */
+class LsinfoCache {
+	/**
+	 * The maximum number of responses kept in the cache.  If it
+	 * is full, the whole cache is flushed.
+	 */
+	static constexpr std::size_t MAX_ITEMS = 256;
+
+	/**
+	 * The maximum total size of all cached responses.  If it is
+	 * exceeded, the whole cache is flushed.
+	 */
+	static constexpr std::size_t MAX_SIZE = 16 * 1024 * 1024;
+
+	/**
+	 * Responses larger than this are not cached.
+	 */
+	static constexpr std::size_t MAX_ITEM_SIZE = MAX_SIZE / 8;
+
+public:
+	struct Item {
+		std::string data;
+
+		/**
+		 * The "compact" keys declared by #data (see
+		 * Response::DeclareCompactKey()).
+		 */
+		uint_least64_t compact_keys;
+	};
+
+private:
+	std::unordered_map<std::string, Item> items;
+
+	std::size_t size = 0;
+
+	unsigned hits = 0, misses = 0;
+
+public:
+	/**
+	 * Build a key which describes the given query.
+	 */
+	[[gnu::pure]]
+	static std::string MakeKey(std::string_view uri, TagMask tag_mask,
+				   bool compact) noexcept;
+
+	/**
+	 * Look up a cached response.
+	 *
+	 * @return the cached response or nullptr on cache miss
+	 */
+	const Item *Get(const std::string &key) noexcept;
+
+	/**
+	 * Add a new response to the cache (unless it is too large).
+	 */
+	void Put(std::string &&key, Item &&item);
+
+	/**
+	 * Discard all cached responses (and log the statistics).
+	 */
+	void Clear() noexcept;
+};
+
+#endif
@@ -43,9 +43,15 @@ struct DatabaseSelection {
 	 * Sort the result by the given tag.  #TAG_NUM_OF_ITEM_TYPES
 	 * means don't sort.  #SORT_TAG_LAST_MODIFIED sorts by
 	 * "Last-Modified" (not technically a tag).
+	 * #SORT_TAG_STICKER sorts by the sticker #sort_sticker.
 	 */
 	TagType sort = TAG_NUM_OF_ITEM_TYPES;
 
+	/**
+	 * The sticker name if #sort is #SORT_TAG_STICKER.
+	 */
+	std::string sort_sticker;
+
 	/**
 	 * If #sort is set, this flag can reverse the sort order.
 	 */
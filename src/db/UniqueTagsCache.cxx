@@ -0,0 +1,81 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "UniqueTagsCache.hxx"
+#include "Selection.hxx"
+#include "song/Filter.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+static constexpr Domain unique_tags_cache_domain("unique_tags_cache");
+
+std::string
+UniqueTagsCache::MakeKey(const DatabaseSelection &selection,
+			 std::span<const TagType> tag_types)
+{
+	std::string key;
+
+	for (const auto i : tag_types) {
+		key += tag_item_names[i];
+		key.push_back(' ');
+	}
+
+	key.push_back('\0');
+	key += selection.uri;
+	key.push_back('\0');
+	key.push_back(selection.recursive ? 'r' : '-');
+
+	if (selection.filter != nullptr)
+		key += selection.filter->ToExpression();
+
+	return key;
+}
+
+const RecursiveMap<std::string> *
+UniqueTagsCache::Get(const std::string &key) noexcept
+{
+	const auto i = items.find(key);
+	if (i == items.end()) {
+		++n_misses;
+		return nullptr;
+	}
+
+	++n_hits;
+	return &i->second;
+}
+
+const RecursiveMap<std::string> &
+UniqueTagsCache::Put(std::string &&key, RecursiveMap<std::string> &&value)
+{
+	if (items.size() >= MAX_ITEMS)
+		items.clear();
+
+	return items.insert_or_assign(std::move(key),
+				      std::move(value)).first->second;
+}
+
+void
+UniqueTagsCache::Clear() noexcept
+{
+	if (!items.empty())
+		FmtDebug(unique_tags_cache_domain,
+			 "flushing {} entries", items.size());
+
+	items.clear();
+}
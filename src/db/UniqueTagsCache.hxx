@@ -0,0 +1,97 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DB_UNIQUE_TAGS_CACHE_HXX
+#define MPD_DB_UNIQUE_TAGS_CACHE_HXX
+
+#include "tag/Type.h"
+#include "util/RecursiveMap.hxx"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+struct DatabaseSelection;
+
+/**
+ * A cache for the results of Database::CollectUniqueTags(), which
+ * is used by the "list" command.  Library browsers send the same
+ * "list" commands over and over, and each of them walks the whole
+ * database.
+ *
+ * The cache must be cleared whenever the database is modified (see
+ * DatabaseListener::OnDatabaseModified()).
+ */
+class UniqueTagsCache {
+	/**
+	 * The maximum number of results kept in the cache.  If it is
+	 * full, the whole cache is flushed.
+	 */
+	static constexpr std::size_t MAX_ITEMS = 64;
+
+	std::unordered_map<std::string, RecursiveMap<std::string>> items;
+
+	/**
+	 * Statistics for the metrics endpoint.  They are not reset by
+	 * Clear().
+	 */
+	uint_least64_t n_hits = 0, n_misses = 0;
+
+public:
+	/**
+	 * Build a key which describes the given query.
+	 */
+	static std::string MakeKey(const DatabaseSelection &selection,
+				   std::span<const TagType> tag_types);
+
+	std::size_t GetSize() const noexcept {
+		return items.size();
+	}
+
+	uint_least64_t GetHits() const noexcept {
+		return n_hits;
+	}
+
+	uint_least64_t GetMisses() const noexcept {
+		return n_misses;
+	}
+
+	/**
+	 * Look up a cached result.
+	 *
+	 * @return the cached result or nullptr on cache miss
+	 */
+	const RecursiveMap<std::string> *Get(const std::string &key) noexcept;
+
+	/**
+	 * Add a new result to the cache.
+	 *
+	 * @return a reference to the cached copy
+	 */
+	const RecursiveMap<std::string> &Put(std::string &&key,
+					     RecursiveMap<std::string> &&value);
+
+	/**
+	 * Discard all cached results.
+	 */
+	void Clear() noexcept;
+};
+
+#endif
@@ -21,12 +21,39 @@
 #include "song/DetachedSong.hxx"
 #include "song/LightSong.hxx"
 #include "song/Filter.hxx"
+#include "song/StickerSongFilter.hxx"
 #include "tag/Sort.hxx"
 
 #include <algorithm>
 #include <cassert>
+#include <string>
+#include <string_view>
 #include <utility>
 
+static const Tag &
+GetTag(const LightSong &song) noexcept
+{
+	return song.tag;
+}
+
+static const Tag &
+GetTag(const DetachedSong &song) noexcept
+{
+	return song.GetTag();
+}
+
+static auto
+GetLastModified(const LightSong &song) noexcept
+{
+	return song.mtime;
+}
+
+static auto
+GetLastModified(const DetachedSong &song) noexcept
+{
+	return song.GetLastModified();
+}
+
 DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 					     VisitSong &visit_song) noexcept
 	:selection(std::move(_selection))
@@ -41,9 +68,16 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 		   result to the client, we need to copy it all into
 		   this std::vector, and then sort it */
 
+		if (!selection.window.IsOpenEnded())
+			/* we need only the first "end" songs of the
+			   sorted result; this allows us to discard all
+			   others early, which saves memory and CPU
+			   time for paginated queries */
+			sort_limit = selection.window.end;
+
 		original_visit_song = std::move(visit_song);
 		visit_song = [this](const auto &song){
-			songs.emplace_back(song);
+			CollectSorted(song);
 		};
 	} else if (selection.window != RangeArg::All()) {
 		original_visit_song = std::move(visit_song);
@@ -56,6 +90,132 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 
 DatabaseVisitorHelper::~DatabaseVisitorHelper() noexcept = default;
 
+/**
+ * The sort key of one song when sorting by sticker.
+ */
+struct StickerSortKey {
+	std::string value;
+	bool found = false;
+
+	StickerSortKey(const StickerValueSource *source,
+		       std::string_view uri,
+		       std::string_view name) noexcept {
+		if (source != nullptr)
+			found = source->GetSongSticker(uri, name, value);
+	}
+};
+
+/**
+ * Songs without the sticker are sorted after all others, regardless
+ * of the sort direction.
+ */
+[[gnu::pure]]
+static bool
+CompareStickerKeys(bool descending,
+		   const StickerSortKey &a, const StickerSortKey &b) noexcept
+{
+	if (!a.found || !b.found)
+		return a.found && !b.found;
+
+	const int cmp = CompareStickerValues(a.value.c_str(),
+					     b.value.c_str());
+	return descending ? cmp > 0 : cmp < 0;
+}
+
+template<typename A, typename B>
+[[gnu::pure]]
+static bool
+CompareSongs(const DatabaseSelection &selection,
+	     const A &a, const B &b) noexcept
+{
+	const auto sort = selection.sort;
+	const bool descending = selection.descending;
+
+	if (sort == TagType(SORT_TAG_STICKER)) {
+		const auto *source = GetStickerValueSource();
+		return CompareStickerKeys(descending,
+					  {source, a.GetURI(), selection.sort_sticker},
+					  {source, b.GetURI(), selection.sort_sticker});
+	} else if (sort == TagType(SORT_TAG_LAST_MODIFIED))
+		return descending
+			? GetLastModified(a) > GetLastModified(b)
+			: GetLastModified(a) < GetLastModified(b);
+	else
+		return CompareTags(sort, descending, GetTag(a), GetTag(b));
+}
+
+/**
+ * Sort by sticker.  The values are looked up only once per song and
+ * not in each comparison.
+ */
+static void
+SortSongsBySticker(std::vector<DetachedSong> &songs,
+		   const std::string &name, bool descending) noexcept
+{
+	const auto *source = GetStickerValueSource();
+
+	std::vector<std::pair<StickerSortKey, std::size_t>> keys;
+	keys.reserve(songs.size());
+	for (std::size_t i = 0; i < songs.size(); ++i)
+		keys.emplace_back(StickerSortKey{source, songs[i].GetURI(), name},
+				  i);
+
+	std::stable_sort(keys.begin(), keys.end(),
+			 [descending](const auto &a, const auto &b){
+				 return CompareStickerKeys(descending,
+							   a.first, b.first);
+			 });
+
+	std::vector<DetachedSong> sorted;
+	sorted.reserve(songs.size());
+	for (const auto &i : keys)
+		sorted.emplace_back(std::move(songs[i.second]));
+
+	songs = std::move(sorted);
+}
+
+inline void
+DatabaseVisitorHelper::SortSongs() noexcept
+{
+	if (selection.sort == TagType(SORT_TAG_STICKER)) {
+		SortSongsBySticker(songs, selection.sort_sticker,
+				   selection.descending);
+		return;
+	}
+
+	std::stable_sort(songs.begin(), songs.end(),
+			 [this](const DetachedSong &a,
+				const DetachedSong &b){
+				 return CompareSongs(selection, a, b);
+			 });
+}
+
+inline void
+DatabaseVisitorHelper::CollectSorted(const LightSong &song)
+{
+	if (sort_limit == 0)
+		return;
+
+	if (truncated &&
+	    !CompareSongs(selection, song, songs[sort_limit - 1]))
+		/* this song cannot make it into the window (on
+		   equality, the previous song wins, just like with
+		   std::stable_sort()) */
+		return;
+
+	songs.emplace_back(song);
+
+	if (songs.size() / 2 >= sort_limit) {
+		/* sorting is stable, and all new songs were appended
+		   after the surviving ones, so the relative order of
+		   equal songs is preserved */
+		SortSongs();
+		songs.erase(std::next(songs.begin(), sort_limit),
+			    songs.end());
+		truncated = true;
+	}
+}
+
 void
 DatabaseVisitorHelper::Commit()
 {
@@ -66,24 +226,7 @@ DatabaseVisitorHelper::Commit()
 	assert(original_visit_song);
 
 	/* sort the song collection */
-	const auto sort = selection.sort;
-	const auto descending = selection.descending;
-
-	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
-		std::stable_sort(songs.begin(), songs.end(),
-				 [descending](const DetachedSong &a, const DetachedSong &b){
-					 return descending
-						 ? a.GetLastModified() > b.GetLastModified()
-						 : a.GetLastModified() < b.GetLastModified();
-				 });
-	else
-		std::stable_sort(songs.begin(), songs.end(),
-				 [sort, descending](const DetachedSong &a,
-						    const DetachedSong &b){
-					 return CompareTags(sort, descending,
-							    a.GetTag(),
-							    b.GetTag());
-				 });
+	SortSongs();
 
 	/* apply the "window" */
 	if (selection.window.end < songs.size())
@@ -23,9 +23,11 @@
 #include "Visitor.hxx"
 #include "Selection.hxx"
 
+#include <cstdint>
 #include <vector>
 
 class DetachedSong;
+struct LightSong;
 
 /**
  * This class helps implementing Database::Visit() by emulating
@@ -43,9 +45,27 @@ class DatabaseVisitorHelper {
 	 * If the plugin can't sort, then this container will collect
 	 * all songs, sort them and report them to the visitor in
 	 * Commit().
+	 *
+	 * If the "window" has an end, only the best candidates are
+	 * kept; see #sort_limit.
 	 */
 	std::vector<DetachedSong> songs;
 
+	/**
+	 * The maximum number of songs in the sorted result which can
+	 * be part of the "window", i.e. #RangeArg::end.  Once
+	 * #songs has grown beyond twice this size, it gets sorted
+	 * and truncated.
+	 */
+	std::size_t sort_limit = SIZE_MAX;
+
+	/**
+	 * Has #songs been truncated to #sort_limit at least once?
+	 * If yes, then new songs which are not better than the
+	 * element at index sort_limit-1 can be discarded right away.
+	 */
+	bool truncated = false;
+
 	VisitSong original_visit_song;
 
 	/**
@@ -65,6 +85,11 @@ public:
 	~DatabaseVisitorHelper() noexcept;
 
 	void Commit();
+
+private:
+	void CollectSorted(const LightSong &song);
+
+	void SortSongs() noexcept;
 };
 
 #endif
@@ -26,8 +26,13 @@
 #include "db/DatabaseError.hxx"
 #include "db/PlaylistInfo.hxx"
 #include "db/LightDirectory.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
 #include "song/LightSong.hxx"
 #include "db/Stats.hxx"
+#include "db/GroupCount.hxx"
 #include "song/Filter.hxx"
 #include "song/UriSongFilter.hxx"
 #include "song/BaseSongFilter.hxx"
@@ -40,18 +45,32 @@
 #include "lib/fmt/RuntimeError.hxx"
 #include "util/RecursiveMap.hxx"
 #include "util/ScopeExit.hxx"
+#include "util/StringAPI.hxx"
 #include "protocol/Ack.hxx"
 #include "event/SocketEvent.hxx"
 #include "event/IdleEvent.hxx"
+#include "event/InjectEvent.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Name.hxx"
+#include "thread/Mutex.hxx"
+#include "util/Domain.hxx"
 #include "Log.hxx"
 
 #include <mpd/client.h>
 #include <mpd/async.h>
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 #include <list>
 #include <string>
 #include <utility>
+#include <vector>
+
+static constexpr Domain proxy_db_domain("proxy_db");
 
 class LibmpdclientError final : public std::runtime_error {
 	enum mpd_error code;
@@ -87,21 +106,139 @@ public:
 	AllocatedProxySong &operator=(const AllocatedProxySong &) = delete;
 };
 
+/**
+ * A pool of connections to the remote MPD which are used for
+ * queries.  This allows running queries from multiple threads
+ * concurrently, without touching ProxyDatabase::connection (which is
+ * owned by the #EventLoop).
+ */
+class ProxyConnectionPool {
+	const std::string host;
+	const std::string password;
+	const unsigned port;
+	const bool keepalive;
+
+	/**
+	 * Connections which have been idle for longer than this are
+	 * not reused, because the remote MPD may have closed them
+	 * already (its "connection_timeout" defaults to 60 seconds).
+	 */
+	static constexpr std::chrono::steady_clock::duration MAX_IDLE_TIME =
+		std::chrono::seconds(30);
+
+	/**
+	 * Never keep more than this number of idle connections.
+	 */
+	static constexpr std::size_t MAX_IDLE = 4;
+
+	struct IdleConnection {
+		struct mpd_connection *connection;
+		std::chrono::steady_clock::time_point since;
+	};
+
+	Mutex mutex;
+
+	/**
+	 * Protected by #mutex.
+	 */
+	std::vector<IdleConnection> idle;
+
+public:
+	ProxyConnectionPool(const ConfigBlock &block);
+	~ProxyConnectionPool() noexcept;
+
+	ProxyConnectionPool(const ProxyConnectionPool &) = delete;
+	ProxyConnectionPool &operator=(const ProxyConnectionPool &) = delete;
+
+	const char *GetHost() const noexcept {
+		return host.c_str();
+	}
+
+	/**
+	 * Open a new connection.  This blocks until the connection
+	 * has been established and the password has been sent.
+	 *
+	 * Throws on error.
+	 */
+	struct mpd_connection *Open() const;
+
+	/**
+	 * Borrows a connection from a #ProxyConnectionPool and
+	 * returns it in the destructor.
+	 */
+	class Lease {
+		ProxyConnectionPool &pool;
+		struct mpd_connection *const connection;
+
+		/**
+		 * The std::uncaught_exceptions() value at
+		 * construction.  If it is larger in the destructor,
+		 * the query was aborted by an exception, and the
+		 * connection may still have a pending response.
+		 */
+		const int uncaught_exceptions = std::uncaught_exceptions();
+
+	public:
+		explicit Lease(ProxyConnectionPool &_pool)
+			:pool(_pool), connection(pool.Get()) {}
+
+		~Lease() noexcept {
+			if (std::uncaught_exceptions() > uncaught_exceptions)
+				mpd_connection_free(connection);
+			else
+				pool.Put(connection);
+		}
+
+		Lease(const Lease &) = delete;
+		Lease &operator=(const Lease &) = delete;
+
+		operator struct mpd_connection *() const noexcept {
+			return connection;
+		}
+	};
+
+	/**
+	 * Close all idle connections.
+	 */
+	void Clear() noexcept;
+
+private:
+	/**
+	 * Obtain an idle connection or open a new one.
+	 *
+	 * Throws on error.
+	 */
+	struct mpd_connection *Get();
+
+	/**
+	 * Return a connection obtained by Get().  It is closed if
+	 * it is in an unrecoverable error state.
+	 */
+	void Put(struct mpd_connection *c) noexcept;
+};
+
 class ProxyDatabase final : public Database {
 	SocketEvent socket_event;
 	IdleEvent idle_event;
 
 	DatabaseListener &listener;
 
-	const std::string host;
-	const std::string password;
-	const unsigned port;
-	const bool keepalive;
+	/**
+	 * Connections for queries, which may be called from any
+	 * thread.  This is mutable because the query methods must be
+	 * "const".
+	 */
+	mutable ProxyConnectionPool pool;
 
+	/**
+	 * The connection which waits for "idle" events and handles
+	 * Update().  It is only used in the #EventLoop thread.
+	 */
 	struct mpd_connection *connection;
 
-	/* this is mutable because GetStats() must be "const" */
-	mutable std::chrono::system_clock::time_point update_stamp;
+	/* this is mutable because GetStats() must be "const"; it is
+	   atomic because GetStats() may be called from any thread */
+	mutable std::atomic<std::chrono::system_clock::time_point> update_stamp;
 
 	/**
 	 * The libmpdclient idle mask that was removed from the other
@@ -115,6 +252,60 @@ class ProxyDatabase final : public Database {
 	 */
 	bool is_idle;
 
+	/**
+	 * If the "mirror" setting is configured: a local copy of the
+	 * remote database, which serves all queries.  It is
+	 * synchronized by #sync_thread whenever the remote database
+	 * has been modified.
+	 */
+	std::unique_ptr<SimpleDatabase> mirror;
+
+	/**
+	 * Downloads the remote database into a new #mirror tree.  It
+	 * uses its own connection, so neither the #EventLoop nor
+	 * #connection is blocked meanwhile.
+	 */
+	Thread sync_thread{BIND_THIS_METHOD(SyncThread)};
+
+	/**
+	 * Notifies the main thread that #sync_thread has finished.
+	 */
+	InjectEvent sync_done;
+
+	/**
+	 * Reconnects to the remote MPD in "mirror" mode, where no
+	 * query would do that.
+	 */
+	CoarseTimerEvent reconnect_timer;
+
+	/**
+	 * The error which occurred in #sync_thread.
+	 */
+	std::exception_ptr sync_error;
+
+	/**
+	 * Shall #sync_thread download the database even if the
+	 * remote update stamp is older than the #mirror?
+	 */
+	bool sync_force;
+
+	/**
+	 * Has #sync_thread replaced the #mirror tree?
+	 */
+	bool sync_modified;
+
+	/**
+	 * Was another synchronization requested while #sync_thread
+	 * was running?  This is a bit mask: bit 0 means "requested",
+	 * bit 1 means "forced".
+	 */
+	unsigned sync_pending = 0;
+
+	/**
+	 * Set by Close() to make #sync_thread finish early.
+	 */
+	std::atomic_bool sync_cancel{false};
+
 public:
 	ProxyDatabase(EventLoop &_loop, DatabaseListener &_listener,
 		      const ConfigBlock &block);
@@ -137,12 +328,17 @@ public:
 	RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &selection,
 						    std::span<const TagType> tag_types) const override;
 
+	TagCountMap CountSongs(const DatabaseSelection &selection,
+			       TagType group) const override;
+
 	DatabaseStats GetStats(const DatabaseSelection &selection) const override;
 
 	unsigned Update(const char *uri_utf8, bool discard) override;
 
 	std::chrono::system_clock::time_point GetUpdateStamp() const noexcept override {
-		return update_stamp;
+		return mirror != nullptr
+			? mirror->GetUpdateStamp()
+			: update_stamp.load(std::memory_order_relaxed);
 	}
 
 private:
@@ -154,6 +350,41 @@ private:
 
 	void OnSocketReady(unsigned flags) noexcept;
 	void OnIdle() noexcept;
+
+	/**
+	 * Connection to the remote MPD has failed or was lost: if
+	 * there is a #mirror, schedule a reconnect, because no query
+	 * will do that.
+	 */
+	void ScheduleReconnect() noexcept;
+
+	/* CoarseTimerEvent callback */
+	void OnReconnectTimer() noexcept;
+
+	/**
+	 * Start #sync_thread (or postpone this until it has
+	 * finished).
+	 *
+	 * @param force download the database even if the remote
+	 * update stamp says the #mirror is up to date
+	 */
+	void StartSync(bool force) noexcept;
+
+	/* the #sync_thread function */
+	void SyncThread() noexcept;
+
+	/**
+	 * Download the remote database into a new tree and install
+	 * it in the #mirror.  Runs in #sync_thread.
+	 *
+	 * Throws on error.
+	 *
+	 * @return false if the #mirror was up to date
+	 */
+	bool Sync(bool force);
+
+	/* InjectEvent callback */
+	void OnSyncDone() noexcept;
 };
 
 static constexpr struct {
@@ -457,11 +688,15 @@ ProxyDatabase::ProxyDatabase(EventLoop &_loop, DatabaseListener &_listener,
 	 socket_event(_loop, BIND_THIS_METHOD(OnSocketReady)),
 	 idle_event(_loop, BIND_THIS_METHOD(OnIdle)),
 	 listener(_listener),
-	 host(block.GetBlockValue("host", "")),
-	 password(block.GetBlockValue("password", "")),
-	 port(block.GetBlockValue("port", 0U)),
-	 keepalive(block.GetBlockValue("keepalive", false))
+	 pool(block),
+	 sync_done(_loop, BIND_THIS_METHOD(OnSyncDone)),
+	 reconnect_timer(_loop, BIND_THIS_METHOD(OnReconnectTimer))
 {
+	if (auto mirror_path = block.GetPath("mirror");
+	    !mirror_path.IsNull())
+		mirror = std::make_unique<SimpleDatabase>(std::move(mirror_path),
+							  SimpleDatabase::Format::TEXT,
+							  false);
 }
 
 DatabasePtr
@@ -476,6 +711,13 @@ void
 ProxyDatabase::Open()
 {
 	update_stamp = std::chrono::system_clock::time_point::min();
+	connection = nullptr;
+
+	if (mirror != nullptr)
+		/* load the copy saved by the previous run, which
+		   serves queries until the first synchronization has
+		   finished */
+		mirror->Open();
 
 	try {
 		Connect();
@@ -483,41 +725,70 @@ ProxyDatabase::Open()
 		/* this error is non-fatal, because this plugin will
 		   attempt to reconnect again automatically */
 		LogError(std::current_exception());
+		ScheduleReconnect();
 	}
 }
 
 void
 ProxyDatabase::Close() noexcept
 {
+	reconnect_timer.Cancel();
+
+	if (sync_thread.IsDefined()) {
+		sync_cancel = true;
+		sync_thread.Join();
+		sync_cancel = false;
+	}
+
+	sync_done.Cancel();
+	sync_pending = 0;
+
 	if (connection != nullptr)
 		Disconnect();
+
+	pool.Clear();
+
+	if (mirror != nullptr)
+		mirror->Close();
 }
 
-void
-ProxyDatabase::Connect()
+ProxyConnectionPool::ProxyConnectionPool(const ConfigBlock &block)
+	:host(block.GetBlockValue("host", "")),
+	 password(block.GetBlockValue("password", "")),
+	 port(block.GetBlockValue("port", 0U)),
+	 keepalive(block.GetBlockValue("keepalive", false))
+{
+}
+
+ProxyConnectionPool::~ProxyConnectionPool() noexcept
+{
+	Clear();
+}
+
+struct mpd_connection *
+ProxyConnectionPool::Open() const
 {
 	const char *_host = host.empty() ? nullptr : host.c_str();
-	connection = mpd_connection_new(_host, port, 0);
-	if (connection == nullptr)
+	auto *c = mpd_connection_new(_host, port, 0);
+	if (c == nullptr)
 		throw LibmpdclientError(MPD_ERROR_OOM, "Out of memory");
 
 	try {
-		CheckError(connection);
+		CheckError(c);
 
-		if (mpd_connection_cmp_server_version(connection, 0, 20, 0) < 0) {
+		if (mpd_connection_cmp_server_version(c, 0, 20, 0) < 0) {
 			const unsigned *version =
-				mpd_connection_get_server_version(connection);
+				mpd_connection_get_server_version(c);
 			throw FmtRuntimeError("Connect to MPD {}.{}.{}, but this "
 					      "plugin requires at least version 0.20",
 					      version[0], version[1], version[2]);
 		}
 
 		if (!password.empty() &&
-		    !mpd_run_password(connection, password.c_str()))
-			ThrowError(connection);
+		    !mpd_run_password(c, password.c_str()))
+			ThrowError(c);
 	} catch (...) {
-		mpd_connection_free(connection);
-		connection = nullptr;
+		mpd_connection_free(c);
 
 		std::throw_with_nested(host.empty()
 				       ? std::runtime_error("Failed to connect to remote MPD")
@@ -525,7 +796,74 @@ ProxyDatabase::Connect()
 							 host));
 	}
 
-	mpd_connection_set_keepalive(connection, keepalive);
+	mpd_connection_set_keepalive(c, keepalive);
+	return c;
+}
+
+struct mpd_connection *
+ProxyConnectionPool::Get()
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	{
+		const std::scoped_lock lock{mutex};
+
+		while (!idle.empty()) {
+			const auto i = idle.back();
+			idle.pop_back();
+
+			if (now - i.since < MAX_IDLE_TIME)
+				return i.connection;
+
+			/* too old; the remote MPD may have closed it
+			   already */
+			mpd_connection_free(i.connection);
+		}
+	}
+
+	return Open();
+}
+
+void
+ProxyConnectionPool::Put(struct mpd_connection *c) noexcept
+{
+	assert(c != nullptr);
+
+	if (!mpd_connection_clear_error(c)) {
+		/* the connection is broken */
+		mpd_connection_free(c);
+		return;
+	}
+
+	{
+		const std::scoped_lock lock{mutex};
+		if (idle.size() < MAX_IDLE) {
+			idle.push_back({c, std::chrono::steady_clock::now()});
+			return;
+		}
+	}
+
+	mpd_connection_free(c);
+}
+
+void
+ProxyConnectionPool::Clear() noexcept
+{
+	std::vector<IdleConnection> old;
+
+	{
+		const std::scoped_lock lock{mutex};
+		old.swap(idle);
+	}
+
+	for (const auto &i : old)
+		mpd_connection_free(i.connection);
+}
+
+void
+ProxyDatabase::Connect()
+{
+	connection = pool.Open();
 
 	idle_received = ~0U;
 	is_idle = false;
@@ -602,6 +940,7 @@ ProxyDatabase::OnSocketReady([[maybe_unused]] unsigned flags) noexcept
 		} catch (...) {
 			LogError(std::current_exception());
 			Disconnect();
+			ScheduleReconnect();
 			return;
 		}
 	}
@@ -620,8 +959,17 @@ ProxyDatabase::OnIdle() noexcept
 
 	/* handle previous idle events */
 
-	if (idle_received & MPD_IDLE_DATABASE)
-		listener.OnDatabaseModified();
+	if (idle_received & MPD_IDLE_DATABASE) {
+		if (mirror != nullptr)
+			/* the listener will be notified after the
+			   mirror has been synchronized; after
+			   (re)connecting, all bits are set, and we
+			   don't know yet whether anything has
+			   changed */
+			StartSync(idle_received != ~0U);
+		else
+			listener.OnDatabaseModified();
+	}
 
 	idle_received = 0;
 
@@ -641,6 +989,7 @@ ProxyDatabase::OnIdle() noexcept
 		socket_event.ReleaseSocket();
 		mpd_connection_free(connection);
 		connection = nullptr;
+		ScheduleReconnect();
 		return;
 	}
 
@@ -648,20 +997,320 @@ ProxyDatabase::OnIdle() noexcept
 	socket_event.ScheduleRead();
 }
 
+/**
+ * Helper for ProxyDatabase::Sync() which builds a new #Directory tree
+ * from the entities received from the remote MPD.  Nobody else can
+ * see the tree yet, but #Directory requires the #db_mutex for all
+ * modifications; it is locked only briefly for each entity, not
+ * while converting the tags.
+ */
+class ProxyMirrorBuilder {
+	Directory *root = Directory::NewRoot();
+
+	/**
+	 * A cache for MakeDirectory(), because all entities of a
+	 * directory are received in a row.
+	 */
+	std::string last_path;
+	Directory *last_directory = root;
+
+public:
+	ProxyMirrorBuilder() noexcept = default;
+
+	~ProxyMirrorBuilder() noexcept {
+		delete root;
+	}
+
+	ProxyMirrorBuilder(const ProxyMirrorBuilder &) = delete;
+	ProxyMirrorBuilder &operator=(const ProxyMirrorBuilder &) = delete;
+
+	/**
+	 * Returns the new tree and passes its ownership to the
+	 * caller.
+	 */
+	Directory *Steal() noexcept {
+		last_directory = nullptr;
+		return std::exchange(root, nullptr);
+	}
+
+	void Add(const struct mpd_entity &entity) noexcept;
+
+private:
+	/**
+	 * Look up a directory by its URI, and create it if it does
+	 * not exist.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	Directory &MakeDirectory(std::string_view path) noexcept;
+
+	void Add(const struct mpd_directory &directory) noexcept;
+	void Add(const struct mpd_song &song) noexcept;
+	void Add(const struct mpd_playlist &playlist) noexcept;
+};
+
+/**
+ * Split a URI into the parent directory and the base name.
+ */
+static std::pair<std::string_view, std::string_view>
+SplitParent(std::string_view uri) noexcept
+{
+	const auto slash = uri.rfind('/');
+	if (slash == uri.npos)
+		return {std::string_view{}, uri};
+
+	return {uri.substr(0, slash), uri.substr(slash + 1)};
+}
+
+static std::chrono::system_clock::time_point
+ImportTime(time_t t) noexcept
+{
+	return t > 0
+		? std::chrono::system_clock::from_time_t(t)
+		: std::chrono::system_clock::time_point::min();
+}
+
+Directory &
+ProxyMirrorBuilder::MakeDirectory(std::string_view path) noexcept
+{
+	assert(holding_db_lock());
+
+	if (path.empty())
+		return *root;
+
+	if (path == last_path)
+		return *last_directory;
+
+	Directory *directory = root;
+
+	std::string_view rest = path;
+	while (!rest.empty()) {
+		std::string_view name = rest;
+		const auto slash = rest.find('/');
+		if (slash != rest.npos) {
+			name = rest.substr(0, slash);
+			rest = rest.substr(slash + 1);
+		} else
+			rest = {};
+
+		directory = directory->MakeChild(name);
+	}
+
+	last_path = path;
+	last_directory = directory;
+	return *directory;
+}
+
+inline void
+ProxyMirrorBuilder::Add(const struct mpd_directory &src) noexcept
+{
+	const ScopeDatabaseLock protect;
+
+	auto &directory = MakeDirectory(mpd_directory_get_path(&src));
+	directory.mtime = ImportTime(mpd_directory_get_last_modified(&src));
+}
+
+inline void
+ProxyMirrorBuilder::Add(const struct mpd_song &src) noexcept
+{
+	const auto [parent_path, name] = SplitParent(mpd_song_get_uri(&src));
+	if (name.empty())
+		return;
+
+	/* convert outside of the critical section */
+	const ProxySong light(&src);
+	Tag tag(light.tag);
+
+	const ScopeDatabaseLock protect;
+
+	auto &parent = MakeDirectory(parent_path);
+	auto song = Song::New(name, parent);
+	song->tag = std::move(tag);
+	song->mtime = light.mtime;
+	song->start_time = light.start_time;
+	song->end_time = light.end_time;
+	song->audio_format = light.audio_format;
+	parent.AddSong(std::move(song));
+}
+
+inline void
+ProxyMirrorBuilder::Add(const struct mpd_playlist &src) noexcept
+{
+	const auto [parent_path, name] = SplitParent(mpd_playlist_get_path(&src));
+	if (name.empty())
+		return;
+
+	const ScopeDatabaseLock protect;
+
+	auto &parent = MakeDirectory(parent_path);
+	parent.playlists.UpdateOrInsert(PlaylistInfo(name,
+						     ImportTime(mpd_playlist_get_last_modified(&src))));
+}
+
+void
+ProxyMirrorBuilder::Add(const struct mpd_entity &entity) noexcept
+{
+	switch (mpd_entity_get_type(&entity)) {
+	case MPD_ENTITY_TYPE_UNKNOWN:
+		break;
+
+	case MPD_ENTITY_TYPE_DIRECTORY:
+		Add(*mpd_entity_get_directory(&entity));
+		break;
+
+	case MPD_ENTITY_TYPE_SONG:
+		Add(*mpd_entity_get_song(&entity));
+		break;
+
+	case MPD_ENTITY_TYPE_PLAYLIST:
+		Add(*mpd_entity_get_playlist(&entity));
+		break;
+	}
+}
+
+bool
+ProxyDatabase::Sync(bool force)
+{
+	assert(mirror != nullptr);
+
+	auto *c = pool.Open();
+	AtScopeExit(c) { mpd_connection_free(c); };
+
+	struct mpd_stats *stats = mpd_run_stats(c);
+	if (stats == nullptr)
+		ThrowError(c);
+
+	const auto remote_stamp =
+		ImportTime(mpd_stats_get_db_update_time(stats));
+	mpd_stats_free(stats);
+
+	if (!force && mirror->FileExists() &&
+	    remote_stamp <= mirror->GetUpdateStamp())
+		/* the remote database has not been modified since
+		   we saved the mirror */
+		return false;
+
+	LogInfo(proxy_db_domain, "Downloading remote database");
+
+	ProxyMirrorBuilder builder;
+
+	if (!mpd_send_list_all_meta(c, ""))
+		ThrowError(c);
+
+	while (auto *entity = mpd_recv_entity(c)) {
+		AtScopeExit(entity) { mpd_entity_free(entity); };
+
+		if (sync_cancel)
+			/* Close() was called; the connection will be
+			   closed without reading the rest of the
+			   response */
+			return false;
+
+		builder.Add(*entity);
+	}
+
+	if (!mpd_response_finish(c))
+		ThrowError(c);
+
+	mirror->ReplaceRoot(builder.Steal());
+
+	LogInfo(proxy_db_domain, "Remote database mirrored");
+	return true;
+}
+
+void
+ProxyDatabase::ScheduleReconnect() noexcept
+{
+	if (mirror != nullptr)
+		reconnect_timer.Schedule(std::chrono::seconds(10));
+}
+
+void
+ProxyDatabase::OnReconnectTimer() noexcept
+{
+	assert(mirror != nullptr);
+
+	if (connection != nullptr)
+		return;
+
+	try {
+		Connect();
+	} catch (...) {
+		LogError(std::current_exception());
+		ScheduleReconnect();
+	}
+}
+
+void
+ProxyDatabase::StartSync(bool force) noexcept
+{
+	assert(mirror != nullptr);
+
+	if (sync_thread.IsDefined()) {
+		/* already running; repeat after it has finished */
+		sync_pending |= 0x1 | (force ? 0x2 : 0);
+		return;
+	}
+
+	sync_force = force;
+	sync_modified = false;
+	sync_error = {};
+
+	try {
+		sync_thread.Start();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to start database mirror thread");
+	}
+}
+
+void
+ProxyDatabase::SyncThread() noexcept
+{
+	SetThreadName("proxy_mirror");
+
+	try {
+		sync_modified = Sync(sync_force);
+	} catch (...) {
+		sync_error = std::current_exception();
+	}
+
+	sync_done.Schedule();
+}
+
+void
+ProxyDatabase::OnSyncDone() noexcept
+{
+	sync_thread.Join();
+
+	if (sync_error)
+		LogError(sync_error, "Failed to mirror remote database");
+	else if (sync_modified)
+		listener.OnDatabaseModified();
+
+	if (sync_pending != 0) {
+		const bool force = (sync_pending & 0x2) != 0;
+		sync_pending = 0;
+		StartSync(force);
+	}
+}
+
 const LightSong *
 ProxyDatabase::GetSong(std::string_view uri) const
 {
-	// TODO: eliminate the const_cast
-	const_cast<ProxyDatabase *>(this)->EnsureConnected();
+	if (mirror != nullptr)
+		return mirror->GetSong(uri);
 
-	if (!mpd_send_list_meta(connection, std::string(uri).c_str()))
-		ThrowError(connection);
+	const ProxyConnectionPool::Lease c{pool};
+
+	if (!mpd_send_list_meta(c, std::string(uri).c_str()))
+		ThrowError(c);
 
-	struct mpd_song *song = mpd_recv_song(connection);
-	if (!mpd_response_finish(connection)) {
+	struct mpd_song *song = mpd_recv_song(c);
+	if (!mpd_response_finish(c)) {
 		if (song != nullptr)
 			mpd_song_free(song);
-		ThrowError(connection);
+		ThrowError(c);
 	}
 
 	if (song == nullptr)
@@ -676,6 +1325,11 @@ ProxyDatabase::ReturnSong(const LightSong *_song) const noexcept
 {
 	assert(_song != nullptr);
 
+	if (mirror != nullptr) {
+		mirror->ReturnSong(_song);
+		return;
+	}
+
 	auto *song = (AllocatedProxySong *)
 		const_cast<LightSong *>(_song);
 	delete song;
@@ -984,40 +1638,41 @@ ProxyDatabase::Visit(const DatabaseSelection &selection,
 		     VisitSong visit_song,
 		     VisitPlaylist visit_playlist) const
 {
-	// TODO: eliminate the const_cast
-	const_cast<ProxyDatabase *>(this)->EnsureConnected();
+	if (mirror != nullptr) {
+		mirror->Visit(selection, std::move(visit_directory),
+			      std::move(visit_song),
+			      std::move(visit_playlist));
+		return;
+	}
+
+	const ProxyConnectionPool::Lease c{pool};
 
-	DatabaseVisitorHelper helper(CheckSelection(selection, connection),
+	DatabaseVisitorHelper helper(CheckSelection(selection, c),
 				     visit_song);
 
 	if (!visit_directory && !visit_playlist && selection.recursive &&
 	    selection.IsFiltered()) {
 		/* this optimized code path can only be used under
 		   certain conditions */
-		::SearchSongs(connection, selection, visit_song);
+		::SearchSongs(c, selection, visit_song);
 		helper.Commit();
 		return;
 	}
 
 	/* fall back to recursive walk (slow!) */
-	::Visit(connection, selection.uri.c_str(),
+	::Visit(c, selection.uri.c_str(),
 		selection.recursive, selection.filter,
 		visit_directory, visit_song, visit_playlist);
 
 	helper.Commit();
 }
 
-RecursiveMap<std::string>
-ProxyDatabase::CollectUniqueTags(const DatabaseSelection &selection,
-				 std::span<const TagType> tag_types) const
-try {
-	// TODO: eliminate the const_cast
-	const_cast<ProxyDatabase *>(this)->EnsureConnected();
-
-	enum mpd_tag_type tag_type2 = Convert(tag_types.back());
-	if (tag_type2 == MPD_TAG_COUNT)
-		throw std::runtime_error("Unsupported tag");
-
+static RecursiveMap<std::string>
+CollectUniqueTags(struct mpd_connection *connection,
+		  const DatabaseSelection &selection,
+		  std::span<const TagType> tag_types,
+		  enum mpd_tag_type tag_type2)
+{
 	const auto group = tag_types.first(tag_types.size() - 1);
 
 	if (!mpd_search_db_tags(connection, tag_type2) ||
@@ -1033,7 +1688,7 @@ try {
 	position.emplace_back(&result);
 
 	while (auto *pair = mpd_recv_pair(connection)) {
-		AtScopeExit(this, pair) {
+		AtScopeExit(connection, pair) {
 			mpd_return_pair(connection, pair);
 		};
 
@@ -1061,28 +1716,129 @@ try {
 		ThrowError(connection);
 
 	return result;
-} catch (...) {
-	if (connection != nullptr)
-		mpd_search_cancel(connection);
+}
 
-	throw;
+RecursiveMap<std::string>
+ProxyDatabase::CollectUniqueTags(const DatabaseSelection &selection,
+				 std::span<const TagType> tag_types) const
+{
+	if (mirror != nullptr)
+		return mirror->CollectUniqueTags(selection, tag_types);
+
+	enum mpd_tag_type tag_type2 = Convert(tag_types.back());
+	if (tag_type2 == MPD_TAG_COUNT)
+		throw std::runtime_error("Unsupported tag");
+
+	const ProxyConnectionPool::Lease c{pool};
+
+	try {
+		return ::CollectUniqueTags(c, selection, tag_types,
+					   tag_type2);
+	} catch (...) {
+		mpd_search_cancel(c);
+		throw;
+	}
+}
+
+static TagCountMap
+CountSongs(struct mpd_connection *connection,
+	   const DatabaseSelection &selection, TagType group)
+{
+	if (!mpd_count_db_songs(connection) ||
+	    !SendConstraints(connection, selection, RangeArg::All()) ||
+	    (group != TAG_NUM_OF_ITEM_TYPES &&
+	     !SendGroup(connection, group)))
+		ThrowError(connection);
+
+	if (!mpd_search_commit(connection))
+		ThrowError(connection);
+
+	TagCountMap result;
+
+	/* without grouping, the response has no tag line; with
+	   grouping, each group starts with its tag value */
+	SearchStats *current = group == TAG_NUM_OF_ITEM_TYPES
+		? &result[std::string{}]
+		: nullptr;
+
+	while (auto *pair = mpd_recv_pair(connection)) {
+		AtScopeExit(connection, pair) {
+			mpd_return_pair(connection, pair);
+		};
+
+		if (group != TAG_NUM_OF_ITEM_TYPES &&
+		    tag_name_parse_i(pair->name) == group)
+			current = &result[pair->value];
+		else if (current == nullptr)
+			continue;
+		else if (StringIsEqual(pair->name, "songs"))
+			current->n_songs = strtoul(pair->value, nullptr, 10);
+		else if (StringIsEqual(pair->name, "playtime"))
+			current->total_duration +=
+				std::chrono::seconds(strtoul(pair->value, nullptr, 10));
+	}
+
+	if (!mpd_response_finish(connection))
+		ThrowError(connection);
+
+	return result;
+}
+
+TagCountMap
+ProxyDatabase::CountSongs(const DatabaseSelection &selection,
+			  TagType group) const
+{
+	if (mirror != nullptr)
+		return mirror->CountSongs(selection, group);
+
+	if (group == TAG_NUM_OF_ITEM_TYPES && !selection.IsFiltered()) {
+		/* "count" needs at least one constraint; the global
+		   statistics have the same numbers */
+		const auto stats = GetStats(selection);
+		TagCountMap result;
+		auto &s = result[std::string{}];
+		s.n_songs = stats.song_count;
+		s.total_duration = stats.total_duration;
+		return result;
+	}
+
+	{
+		const ProxyConnectionPool::Lease c{pool};
+
+		if (mpd_connection_cmp_server_version(c, 0, 21, 0) >= 0 &&
+		    IsFilterFullySupported(selection.filter, c)) {
+			try {
+				return ::CountSongs(c, selection, group);
+			} catch (...) {
+				mpd_search_cancel(c);
+				throw;
+			}
+		}
+	}
+
+	/* the remote MPD cannot evaluate this selection; fall back
+	   to counting the songs it sends us */
+	return ::CountSongs(*this, selection, group);
 }
 
 DatabaseStats
 ProxyDatabase::GetStats(const DatabaseSelection &selection) const
 {
+	if (mirror != nullptr)
+		return mirror->GetStats(selection);
+
 	// TODO: match
 	(void)selection;
 
-	// TODO: eliminate the const_cast
-	const_cast<ProxyDatabase *>(this)->EnsureConnected();
+	const ProxyConnectionPool::Lease c{pool};
 
 	struct mpd_stats *stats2 =
-		mpd_run_stats(connection);
+		mpd_run_stats(c);
 	if (stats2 == nullptr)
-		ThrowError(connection);
+		ThrowError(c);
 
-	update_stamp = std::chrono::system_clock::from_time_t(mpd_stats_get_db_update_time(stats2));
+	update_stamp.store(std::chrono::system_clock::from_time_t(mpd_stats_get_db_update_time(stats2)),
+			   std::memory_order_relaxed);
 
 	DatabaseStats stats;
 	stats.song_count = mpd_stats_get_number_of_songs(stats2);
@@ -1109,6 +1865,6 @@ ProxyDatabase::Update(const char *uri_utf8, bool discard)
 
 const DatabasePlugin proxy_db_plugin = {
 	"proxy",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE|DatabasePlugin::FLAG_THREAD_SAFE,
 	ProxyDatabase::Create,
 };
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Arena.hxx"
+
+void *
+DatabaseArena::Upstream::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	void *p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	size += bytes;
+	return p;
+}
+
+void
+DatabaseArena::Upstream::do_deallocate(void *p, std::size_t bytes,
+				       std::size_t alignment) noexcept
+{
+	size -= bytes;
+	std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+DatabaseArena::DatabaseArena() noexcept
+	:pool(&upstream)
+{
+}
+
+void *
+DatabaseArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	const std::scoped_lock lock{mutex};
+	void *p = pool.allocate(bytes, alignment);
+	++n_allocations;
+	used += bytes;
+	if (used > peak)
+		peak = used;
+	return p;
+}
+
+void
+DatabaseArena::do_deallocate(void *p, std::size_t bytes,
+			     std::size_t alignment) noexcept
+{
+	/* the std::pmr::unsynchronized_pool_resource puts the block
+	   into a free list to be reused by the next allocation of
+	   this size class (or returns large blocks to the heap) */
+	const std::scoped_lock lock{mutex};
+	pool.deallocate(p, bytes, alignment);
+	--n_allocations;
+	used -= bytes;
+}
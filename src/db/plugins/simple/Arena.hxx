@@ -0,0 +1,115 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_DATABASE_ARENA_HXX
+#define MPD_DATABASE_ARENA_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <cstddef>
+#include <memory_resource>
+
+/**
+ * A memory arena for one #Directory tree of the #SimpleDatabase.
+ * All #Directory and #Song objects of the tree and their strings are
+ * allocated from it, saving the overhead of millions of small heap
+ * allocations.  Freed memory is kept in free lists (one per size
+ * class) and reused by later allocations, therefore an update which
+ * replaces songs does not grow the arena beyond its #Stats::peak;
+ * the rest is returned all at once when the tree (and with it the
+ * arena) is freed.
+ *
+ * This class is thread-safe because the #UpdateScanPool threads
+ * create #Song objects concurrently.
+ */
+class DatabaseArena final : public std::pmr::memory_resource {
+	/**
+	 * Counts the memory obtained from the heap.
+	 */
+	class Upstream final : public std::pmr::memory_resource {
+	public:
+		std::size_t size = 0;
+
+	protected:
+		void *do_allocate(std::size_t bytes,
+				  std::size_t alignment) override;
+		void do_deallocate(void *p, std::size_t bytes,
+				   std::size_t alignment) noexcept override;
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+			return this == &other;
+		}
+	} upstream;
+
+	/**
+	 * Protects all other attributes.
+	 */
+	mutable Mutex mutex;
+
+	std::pmr::unsynchronized_pool_resource pool;
+
+	std::size_t n_allocations = 0, used = 0, peak = 0;
+
+public:
+	DatabaseArena() noexcept;
+
+	DatabaseArena(const DatabaseArena &) = delete;
+	DatabaseArena &operator=(const DatabaseArena &) = delete;
+
+	struct Stats {
+		/**
+		 * The number of live allocations.
+		 */
+		std::size_t n_allocations;
+
+		/**
+		 * The number of bytes obtained from the heap.
+		 */
+		std::size_t size;
+
+		/**
+		 * The number of bytes currently handed out by the
+		 * arena.
+		 */
+		std::size_t used;
+
+		/**
+		 * The highest value of #used so far.  Because freed
+		 * memory is reused, #size does not grow much beyond
+		 * this (only by rounding up to size classes).
+		 */
+		std::size_t peak;
+	};
+
+	[[gnu::pure]]
+	Stats GetStats() const noexcept {
+		const std::scoped_lock lock{mutex};
+		return {n_allocations, upstream.size, used, peak};
+	}
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void *p, std::size_t bytes,
+			   std::size_t alignment) noexcept override;
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+};
+
+#endif
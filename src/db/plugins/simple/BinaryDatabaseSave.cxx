@@ -0,0 +1,741 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The binary database format:
+ *
+ * - a #BinaryHeader
+ * - an array of #BinaryDirectory records in pre-order (the root
+ *   directory comes first, and each parent precedes its children)
+ * - an array of #BinarySong records, grouped by directory
+ * - an array of #BinaryTagItem records, grouped by song
+ * - an array of #BinaryPlaylist records, grouped by directory
+ * - an array of string offsets naming the tag types referenced by
+ *   #BinaryTagItem::type; this is also the list of tag types which
+ *   were scanned for all songs
+ * - the string table: null-terminated UTF-8 strings referenced by
+ *   their offset within the table
+ *
+ * All integers are stored in host byte order; a file written by a
+ * host with a different byte order is rejected.
+ */
+
+#include "BinaryDatabaseSave.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/PlaylistInfo.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "io/FileReader.hxx"
+#include "fs/Charset.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/Path.hxx"
+#include "tag/Builder.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/Settings.hxx"
+#include "time/ChronoUtil.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/ScopeExit.hxx"
+#include "util/StringAPI.hxx"
+#include "Version.h"
+
+#ifdef _WIN32
+#include "util/AllocatedArray.hxx"
+#else
+#include <sys/mman.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static constexpr char BINARY_DB_MAGIC[8] = {
+	'M', 'P', 'D', 'B', 'I', 'N', 'D', 'B',
+};
+
+static constexpr uint32_t BINARY_DB_FORMAT = 1;
+
+/**
+ * Written in host byte order; used to detect files written on a
+ * host with a different byte order.
+ */
+static constexpr uint32_t BINARY_DB_BYTE_ORDER = 0x01020304;
+
+/**
+ * A "string offset" which means "no string".
+ */
+static constexpr uint32_t NO_STRING = std::numeric_limits<uint32_t>::max();
+
+/**
+ * An "mtime" which means "unknown".
+ */
+static constexpr int64_t NO_MTIME = std::numeric_limits<int64_t>::min();
+
+struct BinaryHeader {
+	char magic[sizeof(BINARY_DB_MAGIC)];
+	uint32_t format;
+	uint32_t byte_order;
+
+	uint32_t fs_charset;
+	uint32_t mpd_version;
+
+	uint32_t n_directories, n_songs, n_items, n_playlists;
+	uint32_t n_tag_names, reserved;
+
+	uint64_t strings_size;
+};
+
+struct BinaryDirectory {
+	/**
+	 * The base name (string offset); #NO_STRING for the root
+	 * directory.
+	 */
+	uint32_t name;
+
+	/**
+	 * The index of the parent directory; must be smaller than the
+	 * index of this directory.
+	 */
+	uint32_t parent;
+
+	/**
+	 * One of the special DEVICE_* values or zero.
+	 */
+	uint32_t device;
+
+	uint32_t first_song, n_songs;
+	uint32_t first_playlist, n_playlists;
+	uint32_t reserved;
+
+	int64_t mtime;
+};
+
+struct BinarySong {
+	uint32_t filename, target;
+
+	int64_t mtime;
+
+	uint32_t start_ms, end_ms;
+	int32_t duration_ms;
+
+	uint32_t sample_rate;
+	uint8_t format, channels;
+	uint8_t has_playlist, reserved;
+
+	uint32_t first_item, n_items;
+};
+
+struct BinaryTagItem {
+	/**
+	 * An index into the tag name table.
+	 */
+	uint32_t type;
+
+	uint32_t value;
+};
+
+struct BinaryPlaylist {
+	uint32_t name, reserved;
+	int64_t mtime;
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0);
+static_assert(sizeof(BinaryDirectory) % 8 == 0);
+static_assert(sizeof(BinarySong) % 8 == 0);
+static_assert(sizeof(BinaryTagItem) % 8 == 0);
+static_assert(sizeof(BinaryPlaylist) % 8 == 0);
+
+static constexpr int64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return IsNegative(t)
+		? NO_MTIME
+		: int64_t(std::chrono::system_clock::to_time_t(t));
+}
+
+/**
+ * The largest time stamp (in seconds) which can be converted to
+ * std::chrono::system_clock without overflowing.
+ */
+static constexpr int64_t MAX_TIME =
+	std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::duration::max()).count();
+
+/**
+ * Throws on error.
+ */
+static std::chrono::system_clock::time_point
+ImportTime(int64_t t)
+{
+	if (t == NO_MTIME)
+		return std::chrono::system_clock::time_point::min();
+
+	if (t < -MAX_TIME || t > MAX_TIME)
+		throw std::runtime_error("Database corrupted");
+
+	return std::chrono::system_clock::from_time_t(t);
+}
+
+namespace {
+
+class BinaryDatabaseWriter {
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> string_map;
+
+	std::vector<BinaryDirectory> directories;
+	std::vector<BinarySong> songs;
+	std::vector<BinaryTagItem> items;
+	std::vector<BinaryPlaylist> playlists;
+
+	/**
+	 * Maps #TagType to the index in #tag_names.
+	 */
+	uint32_t tag_indexes[TAG_NUM_OF_ITEM_TYPES];
+	std::vector<uint32_t> tag_names;
+
+	/**
+	 * The tag types which were scanned for all songs.  Items in
+	 * Song::hidden_tag of other types are not saved.
+	 */
+	const TagMask stored_tags;
+
+public:
+	explicit BinaryDatabaseWriter(TagMask _stored_tags) noexcept
+		:stored_tags(_stored_tags | global_tag_mask) {
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+			if (stored_tags.Test(TagType(i))) {
+				tag_indexes[i] = tag_names.size();
+				tag_names.push_back(AddString(tag_item_names[i]));
+			} else
+				tag_indexes[i] = NO_STRING;
+		}
+	}
+
+	void AddDirectory(const Directory &directory, uint32_t parent);
+
+	void Write(BufferedOutputStream &os) const;
+
+private:
+	uint32_t AddString(std::string_view s) noexcept;
+
+	uint32_t AddOptionalString(std::string_view s) noexcept {
+		return s.empty() ? NO_STRING : AddString(s);
+	}
+
+	void AddSong(const Song &song) noexcept;
+
+	uint32_t GetTagIndex(TagType type) noexcept {
+		if (tag_indexes[type] == NO_STRING) {
+			/* this tag type has been disabled after the
+			   song was loaded; save it anyway, just like
+			   the text format does */
+			tag_indexes[type] = tag_names.size();
+			tag_names.push_back(AddString(tag_item_names[type]));
+		}
+
+		return tag_indexes[type];
+	}
+};
+
+}
+
+uint32_t
+BinaryDatabaseWriter::AddString(std::string_view s) noexcept
+{
+	auto [i, inserted] = string_map.try_emplace(std::string{s},
+						    uint32_t(strings.size()));
+	if (inserted) {
+		strings.append(s);
+		strings.push_back('\0');
+	}
+
+	return i->second;
+}
+
+inline void
+BinaryDatabaseWriter::AddSong(const Song &song) noexcept
+{
+	BinarySong &s = songs.emplace_back();
+	s.filename = AddString(song.filename);
+	s.target = AddOptionalString(song.target);
+	s.mtime = ExportTime(song.mtime);
+	s.start_ms = song.start_time.ToMS();
+	s.end_ms = song.end_time.ToMS();
+	s.duration_ms = song.tag.duration.IsNegative()
+		? -1
+		: song.tag.duration.ToMS();
+	s.sample_rate = song.audio_format.sample_rate;
+	s.format = uint8_t(song.audio_format.format);
+	s.channels = song.audio_format.channels;
+	s.has_playlist = song.tag.has_playlist;
+	s.reserved = 0;
+	s.first_item = items.size();
+
+	for (const auto &i : song.tag) {
+		BinaryTagItem &item = items.emplace_back();
+		item.type = GetTagIndex(i.type);
+		item.value = AddString(i.value);
+	}
+
+	for (const auto &i : song.hidden_tag) {
+		if (!stored_tags.Test(i.type))
+			continue;
+
+		BinaryTagItem &item = items.emplace_back();
+		item.type = GetTagIndex(i.type);
+		item.value = AddString(i.value);
+	}
+
+	s.n_items = items.size() - s.first_item;
+}
+
+void
+BinaryDatabaseWriter::AddDirectory(const Directory &directory,
+				   uint32_t parent)
+{
+	const uint32_t index = directories.size();
+
+	{
+		BinaryDirectory &d = directories.emplace_back();
+		d.name = directory.IsRoot()
+			? NO_STRING
+			: AddString(directory.GetName());
+		d.parent = parent;
+		d.device = directory.IsReallyAFile()
+			? uint32_t(directory.device)
+			: 0;
+		d.first_song = songs.size();
+		d.first_playlist = playlists.size();
+		d.reserved = 0;
+		d.mtime = ExportTime(directory.mtime);
+	}
+
+	uint32_t n_songs = 0;
+	for (const auto &song : directory.songs) {
+		AddSong(song);
+		++n_songs;
+	}
+
+	uint32_t n_playlists = 0;
+	for (const auto &pi : directory.playlists) {
+		BinaryPlaylist &p = playlists.emplace_back();
+		p.name = AddString(pi.name);
+		p.reserved = 0;
+		p.mtime = ExportTime(pi.mtime);
+		++n_playlists;
+	}
+
+	/* don't keep the reference across AddSong() calls, because
+	   they may reallocate the vector */
+	directories[index].n_songs = n_songs;
+	directories[index].n_playlists = n_playlists;
+
+	for (const auto &child : directory.children) {
+		if (child.IsMount())
+			continue;
+
+		AddDirectory(child, index);
+	}
+}
+
+template<typename T>
+static void
+WriteArray(BufferedOutputStream &os, const std::vector<T> &v)
+{
+	os.Write(v.data(), v.size() * sizeof(T));
+}
+
+void
+BinaryDatabaseWriter::Write(BufferedOutputStream &os) const
+{
+	BinaryHeader header{};
+	memcpy(header.magic, BINARY_DB_MAGIC, sizeof(header.magic));
+	header.format = BINARY_DB_FORMAT;
+	header.byte_order = BINARY_DB_BYTE_ORDER;
+	header.n_directories = directories.size();
+	header.n_songs = songs.size();
+	header.n_items = items.size();
+	header.n_playlists = playlists.size();
+	header.n_tag_names = tag_names.size();
+
+	/* the header strings are appended to a copy of the string
+	   table, because this method is const */
+	std::string s = strings;
+	const auto append = [&s](const char *value){
+		const uint32_t offset = s.size();
+		s.append(value);
+		s.push_back('\0');
+		return offset;
+	};
+
+	header.fs_charset = append(GetFSCharset());
+	header.mpd_version = append(VERSION);
+
+	/* pad the string table, so the next file (if any) would be
+	   aligned */
+	s.resize((s.size() + 7) & ~std::size_t(7), '\0');
+	header.strings_size = s.size();
+
+	os.WriteT(header);
+	WriteArray(os, directories);
+	WriteArray(os, songs);
+	WriteArray(os, items);
+	WriteArray(os, playlists);
+	WriteArray(os, tag_names);
+	if (tag_names.size() % 2 != 0) {
+		/* align the string table */
+		static constexpr uint32_t padding = 0;
+		os.WriteT(padding);
+	}
+
+	os.Write(s.data(), s.size());
+}
+
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root,
+	       TagMask stored_tags)
+{
+	BinaryDatabaseWriter writer(stored_tags);
+	writer.AddDirectory(root, 0);
+	writer.Write(os);
+}
+
+namespace {
+
+/**
+ * A read-only view of a database file in the binary format.  All
+ * accessors validate their parameters, because the file comes from
+ * an untrusted source.
+ */
+class BinaryDatabaseReader {
+	std::span<const BinaryDirectory> directories;
+	std::span<const BinarySong> songs;
+	std::span<const BinaryTagItem> items;
+	std::span<const BinaryPlaylist> playlists;
+	std::span<const uint32_t> tag_names;
+	std::span<const char> strings;
+
+	/**
+	 * Maps the indexes of #tag_names to #TagType.
+	 */
+	std::vector<TagType> tag_types;
+
+public:
+	/**
+	 * The tag types which were scanned for all songs.
+	 */
+	TagMask stored_tags = TagMask::None();
+
+	explicit BinaryDatabaseReader(std::span<const std::byte> src);
+
+	void Load(Directory &root) const;
+
+private:
+	const char *GetString(uint32_t offset) const {
+		if (offset >= strings.size())
+			throw std::runtime_error("Database corrupted");
+
+		return strings.data() + offset;
+	}
+
+	const char *GetOptionalString(uint32_t offset) const {
+		return offset == NO_STRING ? "" : GetString(offset);
+	}
+
+	void LoadSong(Directory &directory, const BinarySong &src) const;
+	void LoadDirectory(Directory &directory,
+			   const BinaryDirectory &src) const;
+};
+
+}
+
+template<typename T>
+static std::span<const T>
+ConsumeArray(std::span<const std::byte> &src, std::size_t n)
+{
+	const std::size_t size = n * sizeof(T);
+	if (n > src.size() / sizeof(T))
+		throw std::runtime_error("Database corrupted");
+
+	const auto *p = reinterpret_cast<const T *>(src.data());
+	src = src.subspan(size);
+	return {p, n};
+}
+
+BinaryDatabaseReader::BinaryDatabaseReader(std::span<const std::byte> src)
+{
+	if (src.size() < sizeof(BinaryHeader))
+		throw std::runtime_error("Database corrupted");
+
+	const auto &header = *reinterpret_cast<const BinaryHeader *>(src.data());
+	src = src.subspan(sizeof(header));
+
+	if (memcmp(header.magic, BINARY_DB_MAGIC, sizeof(header.magic)) != 0)
+		throw std::runtime_error("Database corrupted");
+
+	if (header.byte_order != BINARY_DB_BYTE_ORDER)
+		throw std::runtime_error("Database byte order mismatch, "
+					 "discarding database file");
+
+	if (header.format != BINARY_DB_FORMAT)
+		throw std::runtime_error("Database format mismatch, "
+					 "discarding database file");
+
+	if (header.n_directories == 0)
+		throw std::runtime_error("Database corrupted");
+
+	directories = ConsumeArray<BinaryDirectory>(src, header.n_directories);
+	songs = ConsumeArray<BinarySong>(src, header.n_songs);
+	items = ConsumeArray<BinaryTagItem>(src, header.n_items);
+	playlists = ConsumeArray<BinaryPlaylist>(src, header.n_playlists);
+	tag_names = ConsumeArray<uint32_t>(src, header.n_tag_names);
+	if (header.n_tag_names % 2 != 0)
+		ConsumeArray<uint32_t>(src, 1);
+
+	strings = ConsumeArray<char>(src, header.strings_size);
+	if (strings.empty() || strings.back() != '\0')
+		throw std::runtime_error("Database corrupted");
+
+	const char *new_charset = GetString(header.fs_charset);
+	const char *const old_charset = GetFSCharset();
+	if (*old_charset != 0 && !StringIsEqual(new_charset, old_charset))
+		throw FmtRuntimeError("Existing database has charset "
+				      "\"{}\" instead of \"{}\"; "
+				      "discarding database file",
+				      new_charset, old_charset);
+
+	bool tags[TAG_NUM_OF_ITEM_TYPES]{};
+
+	tag_types.reserve(tag_names.size());
+	for (const uint32_t i : tag_names) {
+		const char *name = GetString(i);
+		const TagType tag = tag_name_parse(name);
+		if (tag == TAG_NUM_OF_ITEM_TYPES)
+			throw FmtRuntimeError("Unrecognized tag '{}', "
+					      "discarding database file",
+					      name);
+
+		tags[tag] = true;
+		stored_tags |= tag;
+		tag_types.push_back(tag);
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i) && !tags[i])
+			throw std::runtime_error("Tag list mismatch, "
+						 "discarding database file");
+}
+
+inline void
+BinaryDatabaseReader::LoadSong(Directory &directory,
+			       const BinarySong &src) const
+{
+	if (src.first_item > items.size() ||
+	    src.n_items > items.size() - src.first_item)
+		throw std::runtime_error("Database corrupted");
+
+	const char *filename = GetString(src.filename);
+	if (directory.FindSong(filename) != nullptr)
+		throw FmtRuntimeError("Duplicate song '{}'", filename);
+
+	auto song = Song::New(filename, directory);
+	song->target = GetOptionalString(src.target);
+	song->mtime = ImportTime(src.mtime);
+	song->start_time = SongTime::FromMS(src.start_ms);
+	song->end_time = SongTime::FromMS(src.end_ms);
+
+	const AudioFormat audio_format(src.sample_rate,
+				       SampleFormat(src.format),
+				       src.channels);
+	if (audio_format.IsValid())
+		song->audio_format = audio_format;
+
+	TagBuilder tag;
+	if (src.duration_ms >= 0)
+		tag.SetDuration(SignedSongTime::FromMS(src.duration_ms));
+	tag.SetHasPlaylist(src.has_playlist);
+
+	for (const auto &item : items.subspan(src.first_item, src.n_items)) {
+		if (item.type >= tag_types.size())
+			throw std::runtime_error("Database corrupted");
+
+		/* disabled tag types are added, too, and will be
+		   moved to Song::hidden_tag */
+		tag.AddItemUnchecked(tag_types[item.type],
+				     GetString(item.value));
+	}
+
+	song->hidden_tag = tag.ExtractDisabled();
+	tag.Commit(song->tag);
+
+	directory.AddSong(std::move(song));
+}
+
+inline void
+BinaryDatabaseReader::LoadDirectory(Directory &directory,
+				    const BinaryDirectory &src) const
+{
+	directory.mtime = ImportTime(src.mtime);
+
+	switch (src.device) {
+	case uint32_t(DEVICE_INARCHIVE):
+	case uint32_t(DEVICE_CONTAINER):
+	case uint32_t(DEVICE_PLAYLIST):
+		directory.device = src.device;
+		break;
+	}
+
+	if (src.first_song > songs.size() ||
+	    src.n_songs > songs.size() - src.first_song ||
+	    src.first_playlist > playlists.size() ||
+	    src.n_playlists > playlists.size() - src.first_playlist)
+		throw std::runtime_error("Database corrupted");
+
+	for (const auto &song : songs.subspan(src.first_song, src.n_songs))
+		LoadSong(directory, song);
+
+	for (const auto &p : playlists.subspan(src.first_playlist,
+					       src.n_playlists))
+		directory.playlists.UpdateOrInsert(PlaylistInfo{GetString(p.name),
+								ImportTime(p.mtime)});
+}
+
+void
+BinaryDatabaseReader::Load(Directory &root) const
+{
+	/* maps record index to the materialized #Directory */
+	std::vector<Directory *> map;
+	map.reserve(directories.size());
+
+	for (const auto &src : directories) {
+		Directory *directory;
+
+		if (map.empty()) {
+			directory = &root;
+		} else {
+			if (src.parent >= map.size())
+				throw std::runtime_error("Database corrupted");
+
+			Directory &parent = *map[src.parent];
+			const char *name = GetString(src.name);
+			if (*name == 0 || std::strchr(name, '/') != nullptr)
+				throw std::runtime_error("Database corrupted");
+
+			if (parent.FindChild(name) != nullptr)
+				throw FmtRuntimeError("Duplicate subdirectory '{}'",
+						      name);
+
+			directory = parent.CreateChild(name);
+		}
+
+		LoadDirectory(*directory, src);
+		map.push_back(directory);
+	}
+}
+
+namespace {
+
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedDatabaseFile {
+	std::span<const std::byte> data;
+
+#ifdef _WIN32
+	AllocatedArray<std::byte> buffer;
+#endif
+
+public:
+	explicit MappedDatabaseFile(Path path) {
+		FileReader reader(path);
+		const uint64_t size = reader.GetSize();
+		if (size > std::numeric_limits<std::size_t>::max())
+			throw std::runtime_error("Database file is too large");
+
+#ifdef _WIN32
+		buffer.ResizeDiscard(size);
+		std::size_t position = 0;
+		while (position < size) {
+			const std::size_t nbytes =
+				reader.Read(buffer.data() + position,
+					    size - position);
+			if (nbytes == 0)
+				throw std::runtime_error("Unexpected end of file");
+			position += nbytes;
+		}
+
+		data = {buffer.data(), buffer.size()};
+#else
+		if (size == 0)
+			throw std::runtime_error("Database file is empty");
+
+		void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+			       reader.GetFD().Get(), 0);
+		if (p == MAP_FAILED)
+			throw FmtErrno("Failed to map '{}'", path.ToUTF8());
+
+		/* we're going to read the whole file sequentially */
+		madvise(p, size, MADV_SEQUENTIAL|MADV_WILLNEED);
+
+		data = {(const std::byte *)p, std::size_t(size)};
+#endif
+	}
+
+#ifndef _WIN32
+	~MappedDatabaseFile() noexcept {
+		munmap(const_cast<std::byte *>(data.data()), data.size());
+	}
+#endif
+
+	MappedDatabaseFile(const MappedDatabaseFile &) = delete;
+	MappedDatabaseFile &operator=(const MappedDatabaseFile &) = delete;
+
+	std::span<const std::byte> GetData() const noexcept {
+		return data;
+	}
+};
+
+}
+
+bool
+db_is_binary(Path path) noexcept
+try {
+	FileReader reader(path);
+
+	char magic[sizeof(BINARY_DB_MAGIC)];
+	return reader.Read(magic, sizeof(magic)) == sizeof(magic) &&
+		memcmp(magic, BINARY_DB_MAGIC, sizeof(magic)) == 0;
+} catch (...) {
+	return false;
+}
+
+TagMask
+db_load_binary(Path path, Directory &root)
+{
+	const MappedDatabaseFile file(path);
+	const BinaryDatabaseReader reader(file.GetData());
+
+	const ScopeDatabaseLock protect;
+	reader.Load(root);
+	return reader.stored_tags;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_BINARY_DATABASE_SAVE_HXX
+#define MPD_BINARY_DATABASE_SAVE_HXX
+
+#include "tag/Mask.hxx"
+
+struct Directory;
+class Path;
+class BufferedOutputStream;
+
+/**
+ * Does the given file contain a database in the binary format?
+ * Returns false if the file cannot be read.
+ */
+[[gnu::pure]]
+bool
+db_is_binary(Path path) noexcept;
+
+/**
+ * Serialize the database tree in the binary format.  Unlike the
+ * text format, everything is stored in fixed-size records which
+ * refer to a shared string table, so the file can be mapped into
+ * memory and be loaded without parsing.
+ *
+ * @param stored_tags the tag types which were scanned for all
+ * songs (in addition to the enabled ones); hidden tag items of
+ * other types are omitted
+ */
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root,
+	       TagMask stored_tags);
+
+/**
+ * Map a database file in the binary format into memory and
+ * materialize its contents into the given #Directory.
+ *
+ * Throws #std::runtime_error on error.
+ *
+ * @return the tag types which were scanned for all songs
+ */
+TagMask
+db_load_binary(Path path, Directory &root);
+
+#endif
@@ -49,24 +49,27 @@ static constexpr unsigned DB_FORMAT = 2;
 static constexpr unsigned OLDEST_DB_FORMAT = 1;
 
 void
-db_save_internal(BufferedOutputStream &os, const Directory &music_root)
+db_save_internal(BufferedOutputStream &os, const Directory &music_root,
+		 TagMask stored_tags)
 {
+	stored_tags |= global_tag_mask;
+
 	os.Write(DIRECTORY_INFO_BEGIN "\n");
 	os.Fmt(FMT_STRING(DB_FORMAT_PREFIX "{}\n"), DB_FORMAT);
 	os.Write(DIRECTORY_MPD_VERSION VERSION "\n");
 	os.Fmt(FMT_STRING(DIRECTORY_FS_CHARSET "{}\n"), GetFSCharset());
 
 	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
-		if (IsTagEnabled(i))
+		if (stored_tags.Test(TagType(i)))
 			os.Fmt(FMT_STRING(DB_TAG_PREFIX "{}\n"),
 			       tag_item_names[i]);
 
 	os.Write(DIRECTORY_INFO_END "\n");
 
-	directory_save(os, music_root);
+	directory_save(os, music_root, stored_tags);
 }
 
-void
+TagMask
 db_load_internal(LineReader &file, Directory &music_root)
 {
 	char *line;
@@ -124,11 +127,17 @@ db_load_internal(LineReader &file, Directory &music_root)
 		throw std::runtime_error("Database format mismatch, "
 					 "discarding database file");
 
-	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+	TagMask stored_tags = TagMask::None();
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
 		if (IsTagEnabled(i) && !tags[i])
 			throw std::runtime_error("Tag list mismatch, "
 						 "discarding database file");
 
+		if (tags[i])
+			stored_tags |= TagType(i);
+	}
+
 	const ScopeDatabaseLock protect;
 	directory_load(file, music_root);
+	return stored_tags;
 }
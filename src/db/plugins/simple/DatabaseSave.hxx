@@ -20,17 +20,27 @@
 #ifndef MPD_DATABASE_SAVE_HXX
 #define MPD_DATABASE_SAVE_HXX
 
+#include "tag/Mask.hxx"
+
 struct Directory;
 class BufferedOutputStream;
 class LineReader;
 
+/**
+ * @param stored_tags the tag types which were scanned for all
+ * songs (in addition to the enabled ones); hidden tag items of
+ * other types are omitted
+ */
 void
-db_save_internal(BufferedOutputStream &os, const Directory &root);
+db_save_internal(BufferedOutputStream &os, const Directory &root,
+		 TagMask stored_tags);
 
 /**
  * Throws #std::runtime_error on error.
+ *
+ * @return the tag types which were scanned for all songs
  */
-void
+TagMask
 db_load_internal(LineReader &file, Directory &root);
 
 #endif
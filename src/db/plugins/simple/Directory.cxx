@@ -18,6 +18,7 @@
  */
 
 #include "Directory.hxx"
+#include "Arena.hxx"
 #include "ExportedSong.hxx"
 #include "SongSort.hxx"
 #include "Song.hxx"
@@ -42,9 +43,68 @@
 
 using std::string_view_literals::operator""sv;
 
-Directory::Directory(std::string &&_path_utf8, Directory *_parent) noexcept
+/**
+ * Build a hash index for a #Directory's children or songs once a
+ * linear search has visited this many items.
+ */
+static constexpr std::size_t DIRECTORY_INDEX_THRESHOLD = 256;
+
+static constexpr std::size_t DIRECTORY_INDEX_BUCKETS = 4093;
+
+struct ChildNameHash {
+	[[gnu::pure]]
+	std::size_t operator()(std::string_view name) const noexcept {
+		return std::hash<std::string_view>{}(name);
+	}
+
+	[[gnu::pure]]
+	std::size_t operator()(const Directory &directory) const noexcept {
+		return (*this)(directory.GetName());
+	}
+};
+
+struct ChildNameEqual {
+	[[gnu::pure]]
+	bool operator()(std::string_view name,
+			const Directory &directory) const noexcept {
+		return name == directory.GetName();
+	}
+};
+
+struct Directory::ChildIndex
+	: IntrusiveHashSet<Directory, DIRECTORY_INDEX_BUCKETS,
+			   ChildNameHash, ChildNameEqual,
+			   IntrusiveHashSetMemberHookTraits<&Directory::name_hook>> {};
+
+struct SongNameHash {
+	[[gnu::pure]]
+	std::size_t operator()(std::string_view name) const noexcept {
+		return std::hash<std::string_view>{}(name);
+	}
+
+	[[gnu::pure]]
+	std::size_t operator()(const Song &song) const noexcept {
+		return (*this)(song.filename);
+	}
+};
+
+struct SongNameEqual {
+	[[gnu::pure]]
+	bool operator()(std::string_view name,
+			const Song &song) const noexcept {
+		return name == song.filename;
+	}
+};
+
+struct Directory::SongIndex
+	: IntrusiveHashSet<Song, DIRECTORY_INDEX_BUCKETS,
+			   SongNameHash, SongNameEqual,
+			   IntrusiveHashSetMemberHookTraits<&Song::name_hook>> {};
+
+Directory::Directory(std::string_view _path_utf8, Directory *_parent,
+		     std::pmr::memory_resource &r) noexcept
 	:parent(_parent),
-	 path(std::move(_path_utf8))
+	 path(_path_utf8, &r)
 {
 }
 
@@ -59,6 +119,27 @@ Directory::~Directory() noexcept
 	children.clear_and_dispose(DeleteDisposer());
 }
 
+void
+Directory::operator delete(Directory *directory,
+			   std::destroying_delete_t) noexcept
+{
+	/* keep the arena alive until the root has been destroyed */
+	const auto arena = std::move(directory->arena);
+
+	auto &r = directory->GetMemoryResource();
+	directory->~Directory();
+	r.deallocate(directory, sizeof(*directory), alignof(Directory));
+}
+
+Directory *
+Directory::NewRoot()
+{
+	auto arena = std::make_unique<DatabaseArena>();
+	auto *root = new(*arena) Directory(std::string_view{}, nullptr, *arena);
+	root->arena = std::move(arena);
+	return root;
+}
+
 void
 Directory::Delete() noexcept
 {
@@ -91,25 +172,53 @@ Directory::CreateChild(std::string_view name_utf8) noexcept
 	assert(holding_db_lock());
 	assert(!name_utf8.empty());
 
-	std::string path_utf8 = IsRoot()
-		? std::string(name_utf8)
-		: PathTraitsUTF8::Build(GetPath(), name_utf8);
-
-	auto *child = new Directory(std::move(path_utf8), this);
+	auto &r = GetMemoryResource();
+	auto *child = IsRoot()
+		? new(r) Directory(name_utf8, this, r)
+		: new(r) Directory(PathTraitsUTF8::Build(GetPath(), name_utf8),
+				   this, r);
 	children.push_back(*child);
+
+	if (child_index != nullptr)
+		child_index->insert(*child);
+
 	return child;
 }
 
+void
+Directory::BuildChildIndex() const noexcept
+{
+	assert(child_index == nullptr);
+
+	child_index = std::make_unique<ChildIndex>();
+	for (auto &child : children)
+		child_index->insert(const_cast<Directory &>(child));
+}
+
 const Directory *
 Directory::FindChild(std::string_view name) const noexcept
 {
 	assert(holding_db_lock());
 
-	for (const auto &child : children)
-		if (name.compare(child.GetName()) == 0)
-			return &child;
+	if (child_index != nullptr) {
+		const auto i = child_index->find(name);
+		return i != child_index->end() ? &*i : nullptr;
+	}
+
+	std::size_t n = 0;
+	const Directory *result = nullptr;
+	for (const auto &child : children) {
+		++n;
+		if (name.compare(child.GetName()) == 0) {
+			result = &child;
+			break;
+		}
+	}
 
-	return nullptr;
+	if (n >= DIRECTORY_INDEX_THRESHOLD)
+		BuildChildIndex();
+
+	return result;
 }
 
 Song *
@@ -180,7 +289,12 @@ Directory::AddSong(SongPtr song) noexcept
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
-	songs.push_back(*song.release());
+	songs.push_back(*song);
+
+	if (song_index != nullptr)
+		song_index->insert(*song);
+
+	song.release();
 }
 
 SongPtr
@@ -191,29 +305,58 @@ Directory::RemoveSong(Song *song) noexcept
 	assert(&song->parent == this);
 
 	songs.erase(songs.iterator_to(*song));
+
+	if (song->name_hook.is_linked())
+		song->name_hook.unlink();
+
 	return SongPtr(song);
 }
 
+void
+Directory::BuildSongIndex() const noexcept
+{
+	assert(song_index == nullptr);
+
+	song_index = std::make_unique<SongIndex>();
+	for (auto &song : songs)
+		song_index->insert(const_cast<Song &>(song));
+}
+
 const Song *
 Directory::FindSong(std::string_view name_utf8) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (song_index != nullptr) {
+		const auto i = song_index->find(name_utf8);
+		return i != song_index->end() ? &*i : nullptr;
+	}
+
+	std::size_t n = 0;
+	const Song *result = nullptr;
 	for (auto &song : songs) {
 		assert(&song.parent == this);
 
-		if (song.filename == name_utf8)
-			return &song;
+		++n;
+		if (song.filename == name_utf8) {
+			result = &song;
+			break;
+		}
 	}
 
-	return nullptr;
+	if (n >= DIRECTORY_INDEX_THRESHOLD)
+		BuildSongIndex();
+
+	return result;
 }
 
 gcc_pure
 static bool
 directory_cmp(const Directory &a, const Directory &b) noexcept
 {
-	return IcuCollate(a.path, b.path) < 0;
+	/* all children share the parent's path as prefix, so
+	   comparing the names is enough */
+	return strcmp(a.sort_key.c_str(), b.sort_key.c_str()) < 0;
 }
 
 void
@@ -221,6 +364,12 @@ Directory::Sort() noexcept
 {
 	assert(holding_db_lock());
 
+	/* generate the sort keys only once, not for each
+	   comparison */
+	for (auto &child : children)
+		if (child.sort_key == nullptr)
+			child.sort_key = IcuCollateKey(child.GetName());
+
 	SortList(children, directory_cmp);
 	song_list_sort(songs);
 
@@ -253,9 +402,10 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 			if (hide_playlist_targets && song.in_playlist)
 				continue;
 
-			const auto song2 = song.Export();
-			if (filter == nullptr || filter->Match(song2))
-				visit_song(song2);
+			song.WithExport([filter, &visit_song](const LightSong &song2){
+				if (filter == nullptr || filter->Match(song2))
+					visit_song(song2);
+			});
 		}
 	}
 
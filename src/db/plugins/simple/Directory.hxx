@@ -25,8 +25,13 @@
 #include "db/Visitor.hxx"
 #include "db/PlaylistVector.hxx"
 #include "db/Ptr.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/AllocatedString.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <string_view>
 
@@ -50,7 +55,15 @@ static constexpr unsigned DEVICE_CONTAINER = -2;
 static constexpr unsigned DEVICE_PLAYLIST = -3;
 
 class SongFilter;
+class DatabaseArena;
 
+/**
+ * A directory inside the configured music directory.  Internal
+ * #SimpleDatabase class.
+ *
+ * All objects of a tree (including the root) are allocated from one
+ * #DatabaseArena which is owned by the root.
+ */
 struct Directory : IntrusiveListHook<> {
 	/* Note: the #IntrusiveListHook is protected with the global
 	   #db_mutex.  Read access in the update thread does not need
@@ -58,6 +71,12 @@ struct Directory : IntrusiveListHook<> {
 
 	using List = IntrusiveList<Directory>;
 
+	/**
+	 * A hook for the parent's #child_index (if one exists).  It
+	 * is protected with the global #db_mutex.
+	 */
+	IntrusiveHashSetHook<IntrusiveHookMode::AUTO_UNLINK> name_hook;
+
 	/**
 	 * A doubly linked list of child directories.
 	 *
@@ -83,7 +102,16 @@ struct Directory : IntrusiveListHook<> {
 
 	uint64_t inode = 0, device = 0;
 
-	const std::string path;
+	const std::pmr::string path;
+
+	/**
+	 * The collation sort key of this directory's name (see
+	 * IcuCollateKey()).  It is generated by the parent's Sort()
+	 * on first use.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 */
+	AllocatedString sort_key;
 
 	/**
 	 * If this is not nullptr, then this directory does not really
@@ -91,16 +119,70 @@ struct Directory : IntrusiveListHook<> {
 	 */
 	DatabasePtr mounted_database;
 
+private:
+	/**
+	 * The arena all objects of this tree are allocated from.
+	 * Only the root owns it; it is freed after the root has been
+	 * destroyed.
+	 */
+	std::unique_ptr<DatabaseArena> arena;
+
+	struct ChildIndex;
+	struct SongIndex;
+
+	/**
+	 * Hash indexes of #children and #songs by their names.  They
+	 * are built on demand by FindChild() and FindSong() when the
+	 * respective list has grown large, and are then kept up to
+	 * date by all methods which add or remove items.
+	 *
+	 * These attributes are protected with the global #db_mutex.
+	 */
+	mutable std::unique_ptr<ChildIndex> child_index;
+	mutable std::unique_ptr<SongIndex> song_index;
+
+	Directory(std::string_view _path_utf8, Directory *_parent,
+		  std::pmr::memory_resource &r) noexcept;
+
+	static void *operator new(std::size_t size,
+				  std::pmr::memory_resource &r) {
+		return r.allocate(size, alignof(Directory));
+	}
+
 public:
-	Directory(std::string &&_path_utf8, Directory *_parent) noexcept;
 	~Directory() noexcept;
 
 	/**
-	 * Create a new root #Directory object.
+	 * Destroy the object and return its memory to the memory
+	 * resource it was allocated from.  If this is the root, the
+	 * whole #DatabaseArena is freed.
 	 */
-	[[gnu::malloc]] [[gnu::returns_nonnull]]
-	static Directory *NewRoot() noexcept {
-		return new Directory(std::string(), nullptr);
+	static void operator delete(Directory *directory,
+				    std::destroying_delete_t) noexcept;
+
+	/**
+	 * Create a new root #Directory object with a new
+	 * #DatabaseArena.
+	 */
+	[[gnu::returns_nonnull]]
+	static Directory *NewRoot();
+
+	/**
+	 * Returns the memory resource all objects of this tree are
+	 * allocated from.
+	 */
+	[[gnu::pure]]
+	std::pmr::memory_resource &GetMemoryResource() const noexcept {
+		return *path.get_allocator().resource();
+	}
+
+	/**
+	 * Returns the #DatabaseArena of this tree.  May only be called
+	 * on the root.
+	 */
+	[[gnu::pure]]
+	const DatabaseArena &GetArena() const noexcept {
+		return *arena;
 	}
 
 	bool IsPlaylist() const noexcept {
@@ -295,6 +377,10 @@ public:
 
 	[[gnu::pure]]
 	LightDirectory Export() const noexcept;
+
+private:
+	void BuildChildIndex() const noexcept;
+	void BuildSongIndex() const noexcept;
 };
 
 #endif
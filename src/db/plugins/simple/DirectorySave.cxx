@@ -75,7 +75,8 @@ ParseTypeString(const char *type) noexcept
 }
 
 void
-directory_save(BufferedOutputStream &os, const Directory &directory)
+directory_save(BufferedOutputStream &os, const Directory &directory,
+	       TagMask hidden_types)
 {
 	if (!directory.IsRoot()) {
 		const char *type = DeviceToTypeString(directory.device);
@@ -94,11 +95,11 @@ directory_save(BufferedOutputStream &os, const Directory &directory)
 			continue;
 
 		os.Fmt(FMT_STRING(DIRECTORY_DIR "{}\n"), child.GetName());
-		directory_save(os, child);
+		directory_save(os, child, hidden_types);
 	}
 
 	for (const auto &song : directory.songs)
-		song_save(os, song);
+		song_save(os, song, hidden_types);
 
 	playlist_vector_save(os, directory.playlists);
 
@@ -170,12 +171,14 @@ directory_load(LineReader &file, Directory &directory)
 						      name);
 
 			std::string target;
+			Tag hidden_tag;
 			auto detached_song = song_load(file, name,
-						       &target);
+						       &target, &hidden_tag);
 
-			auto song = std::make_unique<Song>(std::move(detached_song),
-							   directory);
-			song->target = std::move(target);
+			auto song = Song::New(std::move(detached_song),
+					      directory);
+			song->target = target;
+			song->hidden_tag = std::move(hidden_tag);
 
 			directory.AddSong(std::move(song));
 		} else if ((p = StringAfterPrefix(line, PLAYLIST_META_BEGIN))) {
@@ -20,12 +20,19 @@
 #ifndef MPD_DIRECTORY_SAVE_HXX
 #define MPD_DIRECTORY_SAVE_HXX
 
+#include "tag/Mask.hxx"
+
 struct Directory;
 class LineReader;
 class BufferedOutputStream;
 
+/**
+ * @param hidden_types the types of Song::hidden_tag items which
+ * shall be saved
+ */
 void
-directory_save(BufferedOutputStream &os, const Directory &directory);
+directory_save(BufferedOutputStream &os, const Directory &directory,
+	       TagMask hidden_types);
 
 /**
  * Throws #std::runtime_error on error.
@@ -26,42 +26,109 @@
 #include "db/Helpers.hxx"
 #include "db/Stats.hxx"
 #include "db/UniqueTags.hxx"
+#include "db/GroupCount.hxx"
 #include "db/VHelper.hxx"
 #include "db/LightDirectory.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DatabaseSave.hxx"
+#include "BinaryDatabaseSave.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
+#include "song/Filter.hxx"
+#include "tag/Pool.hxx"
 #include "lib/fmt/PathFormatter.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "fs/io/TextFile.hxx"
 #include "io/BufferedOutputStream.hxx"
 #include "io/FileOutputStream.hxx"
 #include "fs/FileInfo.hxx"
 #include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "fs/FileSystem.hxx"
 #include "lib/fmt/SystemError.hxx"
 #include "util/CharUtil.hxx"
+#include "util/StringAPI.hxx"
 #include "util/Domain.hxx"
 #include "util/RecursiveMap.hxx"
+#include "util/ScopeExit.hxx"
 #include "Log.hxx"
 
 #ifdef ENABLE_ZLIB
 #include "lib/zlib/GzipOutputStream.hxx"
 #endif
 
+#ifdef ENABLE_ZSTD
+#include "lib/zstd/ZstdOutputStream.hxx"
+
+#include <algorithm> // for std::min()
+#include <thread> // for std::thread::hardware_concurrency()
+#endif
+
 #include <cerrno>
 #include <memory>
+#include <utility>
 
 static constexpr Domain simple_db_domain("simple_db");
 
+static SimpleDatabase::Format
+ParseFormat(const char *s)
+{
+	if (StringIsEqual(s, "text"))
+		return SimpleDatabase::Format::TEXT;
+	else if (StringIsEqual(s, "binary"))
+		return SimpleDatabase::Format::BINARY;
+	else
+		throw FmtRuntimeError("Unrecognized database format: {}", s);
+}
+
+static constexpr SimpleDatabase::Compression DEFAULT_COMPRESSION =
+#ifdef ENABLE_ZLIB
+	SimpleDatabase::Compression::GZIP;
+#else
+	SimpleDatabase::Compression::NONE;
+#endif
+
+static SimpleDatabase::Compression
+ParseCompression(const char *s)
+{
+	if (StringIsEqual(s, "gzip")) {
+#ifdef ENABLE_ZLIB
+		return SimpleDatabase::Compression::GZIP;
+#else
+		throw std::runtime_error("gzip support is not enabled");
+#endif
+	} else if (StringIsEqual(s, "zstd")) {
+#ifdef ENABLE_ZSTD
+		return SimpleDatabase::Compression::ZSTD;
+#else
+		throw std::runtime_error("zstd support is not enabled");
+#endif
+	} else
+		/* "yes" or "no"; "yes" is ignored if built without
+		   zlib */
+		return ParseBool(s)
+			? DEFAULT_COMPRESSION
+			: SimpleDatabase::Compression::NONE;
+}
+
+static SimpleDatabase::Compression
+GetCompression(const ConfigBlock &block)
+{
+	const auto *param = block.GetBlockParam("compress");
+	if (param == nullptr)
+		return DEFAULT_COMPRESSION;
+
+	return param->With(ParseCompression);
+}
+
 inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 	:Database(simple_db_plugin),
 	 path(block.GetPath("path")),
-#ifdef ENABLE_ZLIB
-	 compress(block.GetBlockValue("compress", true)),
-#endif
+	 format(ParseFormat(block.GetBlockValue("format", "text"))),
+	 compression(GetCompression(block)),
 	 hide_playlist_targets(block.GetBlockValue("hide_playlist_targets", true)),
+	 use_tag_index(block.GetBlockValue("tag_index", false)),
 	 cache_path(block.GetPath("cache_directory"))
 {
 	if (path.IsNull())
@@ -71,16 +138,13 @@ inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 }
 
 inline SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
-#ifndef ENABLE_ZLIB
-				      [[maybe_unused]]
-#endif
-				      bool _compress) noexcept
+				      Format _format,
+				      Compression _compression) noexcept
 	:Database(simple_db_plugin),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
-#ifdef ENABLE_ZLIB
-	 compress(_compress),
-#endif
+	 format(_format),
+	 compression(_compression),
 	 cache_path(nullptr)
 {
 }
@@ -142,17 +206,41 @@ SimpleDatabase::Check() const
 #endif
 }
 
+static void
+LogArenaStats(const DatabaseArena &arena) noexcept
+{
+	const auto stats = arena.GetStats();
+	FmtDebug(simple_db_domain,
+		 "arena: {} allocations, {} of {} bytes used, peak {}",
+		 stats.n_allocations, stats.used, stats.size, stats.peak);
+}
+
 void
 SimpleDatabase::Load()
 {
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	TextFile file(path);
+	if (db_is_binary(path)) {
+		LogDebug(simple_db_domain, "reading binary DB");
 
-	LogDebug(simple_db_domain, "reading DB");
+		stored_tags = db_load_binary(path, *root);
+	} else {
+		TextFile file(path);
 
-	db_load_internal(file, *root);
+		LogDebug(simple_db_domain, "reading DB");
+
+		stored_tags = db_load_internal(file, *root);
+	}
+
+	const auto pool_stats = tag_pool_get_stats();
+	FmtDebug(simple_db_domain,
+		 "tag pool: {} items in {} buckets, longest chain {}, {} of {} lookups hit",
+		 pool_stats.n_slots, pool_stats.n_buckets,
+		 pool_stats.max_chain,
+		 pool_stats.hits, pool_stats.lookups);
+
+	LogArenaStats(root->GetArena());
 
 	FileInfo fi;
 	if (GetFileInfo(path, fi))
@@ -167,6 +255,9 @@ SimpleDatabase::Open()
 	root = Directory::NewRoot();
 	mtime = std::chrono::system_clock::time_point::min();
 
+	/* all tag types of an empty database are complete */
+	stored_tags = TagMask::All();
+
 #ifndef NDEBUG
 	borrowed_song_count = 0;
 #endif
@@ -181,7 +272,14 @@ SimpleDatabase::Open()
 		Check();
 
 		root = Directory::NewRoot();
+		stored_tags = TagMask::All();
 	}
+
+	RefreshStats();
+
+	const ScopeDatabaseLock protect;
+	RebuildTagIndex();
+	RebuildUriIndex();
 }
 
 void
@@ -191,9 +289,192 @@ SimpleDatabase::Close() noexcept
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
+	stats_valid = false;
+	stats = {};
+	n_mounts = 0;
+	tag_index.Clear();
+	uri_index.Clear();
 	delete root;
 }
 
+DatabaseArena::Stats
+SimpleDatabase::GetArenaStats() const noexcept
+{
+	const ScopeDatabaseLock protect;
+	return root->GetArena().GetStats();
+}
+
+void
+SimpleDatabase::RebuildTagIndex() noexcept
+{
+	assert(holding_db_lock());
+
+	try {
+		tag_index.Build(*root, use_tag_index);
+	} catch (...) {
+		tag_index.Clear();
+		LogError(std::current_exception(),
+			 "Failed to build tag index");
+	}
+}
+
+void
+SimpleDatabase::RebuildUriIndex() noexcept
+{
+	assert(holding_db_lock());
+
+	try {
+		uri_index.Build(*root);
+	} catch (...) {
+		uri_index.Clear();
+		LogError(std::current_exception(),
+			 "Failed to build URI index");
+	}
+}
+
+/**
+ * @return the number of mount points found
+ */
+static unsigned
+CollectStats(DatabaseStatsCollector &collector, const Directory &directory,
+	     bool hide_playlist_targets) noexcept
+{
+	unsigned n_mounts = 0;
+
+	for (const auto &song : directory.songs) {
+		if (hide_playlist_targets && song.in_playlist)
+			continue;
+
+		song.WithExport([&collector](const LightSong &song2){
+			collector.Add(song2);
+		});
+	}
+
+	for (const auto &child : directory.children) {
+		if (child.IsMount())
+			/* mounted databases maintain their own
+			   statistics; they are merged by
+			   MergeStats() */
+			++n_mounts;
+		else
+			n_mounts += CollectStats(collector, child,
+						 hide_playlist_targets);
+	}
+
+	return n_mounts;
+}
+
+unsigned
+SimpleDatabase::CalculateStats(DatabaseStatsCollector &dest) const noexcept
+{
+	assert(holding_db_lock());
+
+	return CollectStats(dest, *root, hide_playlist_targets);
+}
+
+static bool
+MergeMountedStats(DatabaseStatsCollector &dest,
+		  const Directory &directory) noexcept
+{
+	for (const auto &child : directory.children) {
+		if (child.IsMount()) {
+			const auto *db = dynamic_cast<const SimpleDatabase *>(child.mounted_database.get());
+			if (db == nullptr || !db->MergeStats(dest))
+				return false;
+		} else if (!MergeMountedStats(dest, child))
+			return false;
+	}
+
+	return true;
+}
+
+bool
+SimpleDatabase::MergeStats(DatabaseStatsCollector &dest) const noexcept
+{
+	assert(holding_db_lock());
+
+	if (!stats_valid)
+		return false;
+
+	dest.Merge(stats);
+	return MergeMountedStats(dest, *root);
+}
+
+void
+SimpleDatabase::RefreshStats() noexcept
+{
+	DatabaseStatsCollector new_stats;
+
+	/* Mount() and Unmount() modify Directory::children while
+	   holding the lock, so the tree must be walked inside the
+	   critical section */
+	const ScopeDatabaseLock protect;
+	n_mounts = CalculateStats(new_stats);
+	committed_stats = new_stats.Commit();
+	stats = std::move(new_stats);
+	stats_valid = true;
+}
+
+void
+SimpleDatabase::BeginUpdate() noexcept
+{
+	/* free the old indexes outside of the critical section */
+	UriIndex old_uri_index;
+	TagIndex old;
+
+	const ScopeDatabaseLock protect;
+	updating = true;
+
+	std::swap(old_uri_index, uri_index);
+	std::swap(old, tag_index);
+}
+
+void
+SimpleDatabase::EndUpdate() noexcept
+{
+	RefreshStats();
+
+	/* Mount() and Unmount() modify Directory::children while
+	   holding the lock, so the indexes must be built inside the
+	   critical section */
+	const ScopeDatabaseLock protect;
+	updating = false;
+
+	RebuildUriIndex();
+	RebuildTagIndex();
+
+	LogArenaStats(root->GetArena());
+}
+
+void
+SimpleDatabase::ReplaceRoot(Directory *new_root)
+{
+	assert(new_root != nullptr);
+
+	BeginUpdate();
+
+	Directory *old_root;
+
+	{
+		const ScopeDatabaseLock protect;
+		old_root = std::exchange(root, new_root);
+
+		/* the mount points were in the old tree */
+		n_mounts = 0;
+	}
+
+	/* the new tree has only the enabled tag types */
+	stored_tags = TagMask::None();
+
+	/* free the old tree outside of the critical section; nobody
+	   can see it anymore */
+	delete old_root;
+
+	AtScopeExit(this) { EndUpdate(); };
+
+	Save();
+}
+
 const LightSong *
 SimpleDatabase::GetSong(std::string_view uri) const
 {
@@ -203,6 +484,18 @@ SimpleDatabase::GetSong(std::string_view uri) const
 
 	ScopeDatabaseLock protect;
 
+	/* fast path: look up the whole URI in the hash table */
+	if (const Song *song = uri_index.Find(uri)) {
+		exported_song.Construct(song->Export());
+		protect.unlock();
+
+#ifndef NDEBUG
+		++borrowed_song_count;
+#endif
+
+		return &exported_song.Get();
+	}
+
 	auto r = root->LookupDirectory(uri);
 
 	if (r.directory->IsMount()) {
@@ -295,6 +588,18 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		return;
 	}
 
+	if (r.rest.data() == nullptr &&
+	    selection.sort == TagType(SORT_TAG_LAST_MODIFIED) &&
+	    visit_song && !visit_directory && !visit_playlist &&
+	    tag_index.VisitByModified(*r.directory, selection.recursive,
+				      selection.filter,
+				      selection.descending, selection.window,
+				      hide_playlist_targets, visit_song))
+		/* the index has already sorted the songs and applied
+		   the window, therefore DatabaseVisitorHelper is not
+		   needed */
+		return;
+
 	DatabaseVisitorHelper helper(CheckSelection(selection), visit_song);
 
 	if (r.rest.data() == nullptr) {
@@ -303,6 +608,15 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		if (selection.recursive && visit_directory)
 			visit_directory(r.directory->Export());
 
+		if (selection.filter != nullptr && visit_song &&
+		    !visit_directory && !visit_playlist &&
+		    tag_index.Visit(*r.directory, selection.recursive,
+				    *selection.filter,
+				    hide_playlist_targets, visit_song)) {
+			helper.Commit();
+			return;
+		}
+
 		r.directory->Walk(selection.recursive, selection.filter,
 				  hide_playlist_targets,
 				  visit_directory, visit_song,
@@ -336,51 +650,107 @@ SimpleDatabase::CollectUniqueTags(const DatabaseSelection &selection,
 	return ::CollectUniqueTags(*this, selection, tag_types);
 }
 
-DatabaseStats
-SimpleDatabase::GetStats(const DatabaseSelection &selection) const
+TagCountMap
+SimpleDatabase::CountSongs(const DatabaseSelection &selection,
+			   TagType group) const
 {
-	return ::GetStats(*this, selection);
+	return ::CountSongs(*this, selection, group);
 }
 
-void
-SimpleDatabase::Save()
+DatabaseStats
+SimpleDatabase::GetStats(const DatabaseSelection &selection) const
 {
-	{
+	if (selection.uri.empty() && selection.recursive &&
+	    selection.filter == nullptr) {
 		const ScopeDatabaseLock protect;
 
-		LogDebug(simple_db_domain, "removing empty directories from DB");
-		root->PruneEmpty();
-
-		LogDebug(simple_db_domain, "sorting DB");
-		root->Sort();
+		/* without mounted databases, the precomputed counts
+		   are the answer */
+		if (stats_valid && n_mounts == 0)
+			return committed_stats;
+
+		/* merge the precomputed statistics of this database
+		   and all mounted databases instead of walking all of
+		   their songs */
+		DatabaseStatsCollector collector;
+		if (MergeStats(collector))
+			return collector.Commit();
 	}
 
-	LogDebug(simple_db_domain, "writing DB");
-
-	FileOutputStream fos(path);
+	return ::GetStats(*this, selection);
+}
 
-	OutputStream *os = &fos;
+inline void
+SimpleDatabase::SaveText(OutputStream &_os)
+{
+	OutputStream *os = &_os;
 
 #ifdef ENABLE_ZLIB
 	std::unique_ptr<GzipOutputStream> gzip;
-	if (compress) {
+	if (compression == Compression::GZIP) {
 		gzip = std::make_unique<GzipOutputStream>(*os);
 		os = gzip.get();
 	}
 #endif
 
+#ifdef ENABLE_ZSTD
+	std::unique_ptr<ZstdOutputStream> zstd;
+	if (compression == Compression::ZSTD) {
+		/* compress in worker threads while this thread
+		   serializes the tree */
+		const unsigned n_threads =
+			std::min(std::thread::hardware_concurrency(), 4U);
+		zstd = std::make_unique<ZstdOutputStream>(*os,
+							  ZSTD_CLEVEL_DEFAULT,
+							  n_threads);
+		os = zstd.get();
+	}
+#endif
+
 	BufferedOutputStream bos(*os);
 
-	db_save_internal(bos, *root);
+	db_save_internal(bos, *root, stored_tags);
 
 	bos.Flush();
 
+#ifdef ENABLE_ZSTD
+	if (zstd != nullptr) {
+		zstd->Finish();
+		zstd.reset();
+	}
+#endif
+
 #ifdef ENABLE_ZLIB
 	if (gzip != nullptr) {
 		gzip->Finish();
 		gzip.reset();
 	}
 #endif
+}
+
+void
+SimpleDatabase::Save()
+{
+	{
+		const ScopeDatabaseLock protect;
+
+		LogDebug(simple_db_domain, "removing empty directories from DB");
+		root->PruneEmpty();
+
+		LogDebug(simple_db_domain, "sorting DB");
+		root->Sort();
+	}
+
+	LogDebug(simple_db_domain, "writing DB");
+
+	FileOutputStream fos(path);
+
+	if (format == Format::BINARY) {
+		BufferedOutputStream bos(fos);
+		db_save_binary(bos, *root, stored_tags);
+		bos.Flush();
+	} else
+		SaveText(fos);
 
 	fos.Commit();
 
@@ -412,6 +782,12 @@ SimpleDatabase::Mount(const char *uri, DatabasePtr db)
 
 	Directory *mnt = r.directory->CreateChild(r.rest);
 	mnt->mounted_database = std::move(db);
+	++n_mounts;
+
+	/* the index needs to know where the mount points are; during
+	   an update, EndUpdate() will rebuild it */
+	if (!updating)
+		RebuildTagIndex();
 }
 
 static constexpr bool
@@ -438,11 +814,8 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri)
 
 	const auto name_fs = AllocatedPath::FromUTF8Throw(name);
 
-#ifndef ENABLE_ZLIB
-	constexpr bool compress = false;
-#endif
 	auto db = std::make_unique<SimpleDatabase>(cache_path / name_fs,
-						   compress);
+						   format, compression);
 	db->Open();
 
 	bool exists = db->FileExists();
@@ -464,6 +837,12 @@ SimpleDatabase::LockUmountSteal(const char *uri) noexcept
 	auto db = std::move(r.directory->mounted_database);
 	r.directory->Delete();
 
+	assert(n_mounts > 0);
+	--n_mounts;
+
+	if (!updating)
+		RebuildTagIndex();
+
 	return db;
 }
 
@@ -480,6 +859,6 @@ SimpleDatabase::Unmount(const char *uri) noexcept
 
 constexpr DatabasePlugin simple_db_plugin = {
 	"simple",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE|DatabasePlugin::FLAG_THREAD_SAFE,
 	SimpleDatabase::Create,
 };
@@ -21,9 +21,15 @@
 #define MPD_SIMPLE_DATABASE_PLUGIN_HXX
 
 #include "ExportedSong.hxx"
+#include "TagIndex.hxx"
+#include "UriIndex.hxx"
+#include "Arena.hxx"
 #include "db/Interface.hxx"
 #include "db/Ptr.hxx"
+#include "db/Stats.hxx"
+#include "db/Helpers.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "tag/Mask.hxx"
 #include "util/Manual.hxx"
 #include "config.h"
 
@@ -35,17 +41,55 @@ struct DatabasePlugin;
 class EventLoop;
 class DatabaseListener;
 class PrefixedLightSong;
+class OutputStream;
 
 class SimpleDatabase : public Database {
+public:
+	/**
+	 * The on-disk format used by Save().  Load() detects the
+	 * format automatically.
+	 */
+	enum class Format {
+		/**
+		 * The traditional line-based text format (optionally
+		 * compressed, see #Compression).
+		 */
+		TEXT,
+
+		/**
+		 * An uncompressed binary format which can be mapped
+		 * into memory and loaded without parsing.
+		 */
+		BINARY,
+	};
+
+	/**
+	 * How Save() compresses the #Format::TEXT format.  Load()
+	 * detects the compression automatically.
+	 */
+	enum class Compression {
+		NONE,
+		GZIP,
+		ZSTD,
+	};
+
+private:
 	AllocatedPath path;
 	std::string path_utf8;
 
-#ifdef ENABLE_ZLIB
-	bool compress;
-#endif
+	Format format;
+
+	Compression compression;
 
 	bool hide_playlist_targets;
 
+	/**
+	 * Add the tag values to the #TagIndex?  This speeds up
+	 * filtered searches at the expense of memory.  The
+	 * modification time index is always built.
+	 */
+	bool use_tag_index = false;
+
 	/**
 	 * The path where cache files for Mount() are located.
 	 */
@@ -53,6 +97,79 @@ class SimpleDatabase : public Database {
 
 	Directory *root;
 
+	/**
+	 * The tag types which were scanned for all songs: the enabled
+	 * ones plus those which are stored in Song::hidden_tag (see
+	 * UpdateConfig::all_tags).  This is the tag list written to
+	 * the database file; it allows enabling one of these types
+	 * later without rescanning all files.
+	 *
+	 * Only accessed by the update thread and by Open().
+	 */
+	TagMask stored_tags = TagMask::All();
+
+	/**
+	 * Set between BeginUpdate() and EndUpdate().  While it is
+	 * set, the indexes are empty and must not be rebuilt, because
+	 * the update thread may free songs at any time.
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	bool updating = false;
+
+	/**
+	 * Contains tag values only if #use_tag_index is set.  It is
+	 * cleared while the update thread modifies the tree.
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	TagIndex tag_index;
+
+	/**
+	 * Speeds up GetSong().  It is cleared while the update thread
+	 * modifies the tree.
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	UriIndex uri_index;
+
+	/**
+	 * Statistics of the whole tree (excluding mounted databases,
+	 * which are updated independently and have their own),
+	 * precomputed by Open() and EndUpdate() so GetStats() does
+	 * not need to walk all songs.  Only valid if #stats_valid is
+	 * set.
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	DatabaseStatsCollector stats;
+
+	/**
+	 * The result of DatabaseStatsCollector::Commit() on #stats,
+	 * returned by GetStats() as-is if there are no mounted
+	 * databases.  Only valid if #stats_valid is set.
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	DatabaseStats committed_stats;
+
+	/**
+	 * The number of mounted databases in this tree; if it is
+	 * zero, GetStats() does not need to merge the string sets
+	 * of #stats.  Updated by Mount() and Unmount(), and
+	 * recounted by RefreshStats().
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	unsigned n_mounts = 0;
+
+	/**
+	 * Are #stats and #committed_stats valid?
+	 *
+	 * Protected with the global #db_mutex.
+	 */
+	bool stats_valid = false;
+
 	std::chrono::system_clock::time_point mtime;
 
 	/**
@@ -72,7 +189,8 @@ class SimpleDatabase : public Database {
 
 public:
 	SimpleDatabase(const ConfigBlock &block);
-	SimpleDatabase(AllocatedPath &&_path, bool _compress) noexcept;
+	SimpleDatabase(AllocatedPath &&_path, Format _format,
+		       Compression _compression) noexcept;
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -86,6 +204,30 @@ public:
 		return *root;
 	}
 
+	/**
+	 * Returns the memory usage of the #DatabaseArena of the
+	 * current tree.
+	 */
+	[[gnu::pure]]
+	DatabaseArena::Stats GetArenaStats() const noexcept;
+
+	/**
+	 * Merge the precomputed #stats of this database and of all
+	 * mounted databases into the given collector.  Caller must
+	 * lock the #db_mutex.
+	 *
+	 * @return false if the statistics of one of the databases
+	 * are not available
+	 */
+	bool MergeStats(DatabaseStatsCollector &dest) const noexcept;
+
+	/**
+	 * Returns the path of the database file.
+	 */
+	const AllocatedPath &GetPath() const noexcept {
+		return path;
+	}
+
 	bool HasCache() const noexcept {
 		return !cache_path.IsNull();
 	}
@@ -117,6 +259,47 @@ public:
 	[[gnu::nonnull]]
 	bool Unmount(const char *uri) noexcept;
 
+	/**
+	 * Called by the update thread before it starts modifying the
+	 * tree.
+	 */
+	void BeginUpdate() noexcept;
+
+	/**
+	 * Called by the update thread after it has modified the tree
+	 * (and before Save()).
+	 *
+	 * @param scanned_tags the tag types which were scanned
+	 * @param full true if all songs have been scanned again
+	 */
+	void UpdateStoredTags(TagMask scanned_tags, bool full) noexcept {
+		if (full)
+			stored_tags = scanned_tags;
+		else
+			stored_tags &= scanned_tags;
+	}
+
+	/**
+	 * Called by the update thread after it has finished
+	 * modifying the tree (and after Save()).
+	 */
+	void EndUpdate() noexcept;
+
+	/**
+	 * Replace the whole tree with a new one which was built by
+	 * the caller (e.g. a mirror of a remote database), and save
+	 * it.  This may be called from any thread, but only one
+	 * thread may modify the database at a time.  There must not
+	 * be any mounted databases.
+	 *
+	 * Throws on error (from Save()); the new tree has been
+	 * installed nonetheless.
+	 *
+	 * @param new_root a root #Directory allocated with
+	 * Directory::NewRoot(); this object takes ownership
+	 */
+	void ReplaceRoot(Directory *new_root);
+
 	/* virtual methods from class Database */
 	void Open() override;
 	void Close() noexcept override;
@@ -132,6 +315,9 @@ public:
 	RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &selection,
 						    std::span<const TagType> tag_types) const override;
 
+	TagCountMap CountSongs(const DatabaseSelection &selection,
+			       TagType group) const override;
+
 	DatabaseStats GetStats(const DatabaseSelection &selection) const override;
 
 	std::chrono::system_clock::time_point GetUpdateStamp() const noexcept override {
@@ -143,11 +329,37 @@ private:
 
 	void Check() const;
 
+	void SaveText(OutputStream &os);
+
 	/**
 	 * Throws #std::runtime_error on error.
 	 */
 	void Load();
 
+	/**
+	 * Rebuild the #TagIndex.  Caller must lock the
+	 * #db_mutex.
+	 */
+	void RebuildTagIndex() noexcept;
+
+	/**
+	 * Rebuild the #UriIndex.  Caller must lock the #db_mutex.
+	 */
+	void RebuildUriIndex() noexcept;
+
+	/**
+	 * Walk the whole tree (but not mounted databases) and
+	 * calculate #stats.  Caller must lock the #db_mutex.
+	 *
+	 * @return the number of mount points found in the tree
+	 */
+	unsigned CalculateStats(DatabaseStatsCollector &dest) const noexcept;
+
+	/**
+	 * Recalculate #stats and publish the result.
+	 */
+	void RefreshStats() noexcept;
+
 	DatabasePtr LockUmountSteal(const char *uri) noexcept;
 };
 
@@ -28,11 +28,21 @@
 #include "time/ChronoUtil.hxx"
 #include "util/IterableSplitString.hxx"
 
+#include <cassert>
+
 using std::string_view_literals::operator""sv;
 
+Song::Song(std::string_view _filename, Directory &_parent) noexcept
+	:parent(_parent),
+	 filename(_filename, &_parent.GetMemoryResource()),
+	 target(&_parent.GetMemoryResource())
+{
+}
+
 Song::Song(DetachedSong &&other, Directory &_parent) noexcept
 	:parent(_parent),
-	 filename(other.GetURI()),
+	 filename(other.GetURI(), &_parent.GetMemoryResource()),
+	 target(&_parent.GetMemoryResource()),
 	 tag(std::move(other.WritableTag())),
 	 mtime(other.GetLastModified()),
 	 start_time(other.GetStartTime()),
@@ -41,6 +51,27 @@ Song::Song(DetachedSong &&other, Directory &_parent) noexcept
 {
 }
 
+void
+Song::operator delete(Song *song, std::destroying_delete_t) noexcept
+{
+	auto &r = song->GetMemoryResource();
+	song->~Song();
+	r.deallocate(song, sizeof(*song), alignof(Song));
+}
+
+SongPtr
+Song::New(std::string_view filename, Directory &parent)
+{
+	return SongPtr(new(parent.GetMemoryResource()) Song(filename, parent));
+}
+
+SongPtr
+Song::New(DetachedSong &&other, Directory &parent)
+{
+	return SongPtr(new(parent.GetMemoryResource())
+		       Song(std::move(other), parent));
+}
+
 const char *
 Song::GetFilenameSuffix() const noexcept
 {
@@ -53,7 +84,7 @@ std::string
 Song::GetURI() const noexcept
 {
 	if (parent.IsRoot())
-		return filename;
+		return std::string{filename};
 	else {
 		const char *path = parent.GetPath();
 		return PathTraitsUTF8::Build(path, filename);
@@ -105,12 +136,42 @@ FindTargetSong(const Directory &_directory, std::string_view target) noexcept
 	return directory->FindSong(last);
 }
 
-ExportedSong
-Song::Export() const noexcept
+void
+Song::MoveScannedFrom(Song &&src) noexcept
 {
-	const auto *target_song = !target.empty()
+	tag = std::move(src.tag);
+	hidden_tag = std::move(src.hidden_tag);
+	mtime = src.mtime;
+	audio_format = src.audio_format;
+}
+
+const Song *
+Song::FindTarget() const noexcept
+{
+	return !target.empty()
 		? FindTargetSong(parent, target)
 		: nullptr;
+}
+
+LightSong
+Song::ExportLight() const noexcept
+{
+	assert(target.empty());
+
+	LightSong dest(filename.c_str(), tag);
+	if (!parent.IsRoot())
+		dest.directory = parent.GetPath();
+	dest.mtime = mtime;
+	dest.start_time = start_time;
+	dest.end_time = end_time;
+	dest.audio_format = audio_format;
+	return dest;
+}
+
+ExportedSong
+Song::Export() const noexcept
+{
+	const auto *target_song = FindTarget();
 
 	Tag merged_tag;
 	if (target_song != nullptr) {
@@ -21,16 +21,20 @@
 #define MPD_SONG_HXX
 
 #include "Ptr.hxx"
+#include "ExportedSong.hxx"
 #include "Chrono.hxx"
 #include "tag/Tag.hxx"
 #include "pcm/AudioFormat.hxx"
+#include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
 #include "config.h"
 
+#include <memory_resource>
+#include <new>
 #include <string>
+#include <string_view>
 
 struct Directory;
-class ExportedSong;
 class DetachedSong;
 class Storage;
 class ArchiveFile;
@@ -38,12 +42,21 @@ class ArchiveFile;
 /**
  * A song file inside the configured music directory.  Internal
  * #SimpleDatabase class.
+ *
+ * Instances are allocated from the memory resource of their parent
+ * #Directory (see #DatabaseArena) and must be created with New().
  */
 struct Song : IntrusiveListHook<> {
 	/* Note: the #IntrusiveListHook is protected with the global
 	   #db_mutex.  Read access in the update thread does not need
 	   protection. */
 
+	/**
+	 * A hook for the parent's #Directory::song_index (if one
+	 * exists).  It is protected with the global #db_mutex.
+	 */
+	IntrusiveHashSetHook<IntrusiveHookMode::AUTO_UNLINK> name_hook;
+
 	/**
 	 * The #Directory that contains this song.
 	 */
@@ -52,7 +65,7 @@ struct Song : IntrusiveListHook<> {
 	/**
 	 * The file name.
 	 */
-	std::string filename;
+	std::pmr::string filename;
 
 	/**
 	 * If non-empty, then this object does not describe a file
@@ -61,10 +74,20 @@ struct Song : IntrusiveListHook<> {
 	 * (i.e. with URI scheme) or a URI relative to this object
 	 * (which may begin with one or more "../").
 	 */
-	std::string target;
+	std::pmr::string target;
 
 	Tag tag;
 
+	/**
+	 * Tag items of types which are disabled by "metadata_to_use".
+	 * They are not visible to clients, but they are saved in the
+	 * database file, so enabling those types later does not
+	 * require rescanning all files.  This is only filled if
+	 * "update_all_tags" is enabled; it has neither duration nor
+	 * the "has_playlist" flag.
+	 */
+	Tag hidden_tag;
+
 	/**
 	 * The time stamp of the last file modification.  A negative
 	 * value means that this is unknown/unavailable.
@@ -95,12 +118,36 @@ struct Song : IntrusiveListHook<> {
 	 */
 	bool in_playlist = false;
 
-	template<typename F>
-	Song(F &&_filename, Directory &_parent) noexcept
-		:parent(_parent), filename(std::forward<F>(_filename)) {}
-
+private:
+	Song(std::string_view _filename, Directory &_parent) noexcept;
 	Song(DetachedSong &&other, Directory &_parent) noexcept;
 
+	static void *operator new(std::size_t size,
+				  std::pmr::memory_resource &r) {
+		return r.allocate(size, alignof(Song));
+	}
+
+public:
+	/**
+	 * Destroy the object and return its memory to the memory
+	 * resource it was allocated from.
+	 */
+	static void operator delete(Song *song,
+				    std::destroying_delete_t) noexcept;
+
+	/**
+	 * Allocate a new #Song object from the parent's memory
+	 * resource.  It still needs to be added to the parent with
+	 * Directory::AddSong().
+	 */
+	static SongPtr New(std::string_view filename, Directory &parent);
+	static SongPtr New(DetachedSong &&other, Directory &parent);
+
+	[[gnu::pure]]
+	std::pmr::memory_resource &GetMemoryResource() const noexcept {
+		return *filename.get_allocator().resource();
+	}
+
 	[[gnu::pure]]
 	const char *GetFilenameSuffix() const noexcept;
 
@@ -118,24 +165,35 @@ struct Song : IntrusiveListHook<> {
 	 *
 	 * Throws on error.
 	 *
+	 * @param all_tags scan all tag types, and store the disabled
+	 * ones in #hidden_tag
 	 * @return the song on success, nullptr if the file was not
 	 * recognized
 	 */
 	static SongPtr LoadFile(Storage &storage, const char *name_utf8,
-				Directory &parent);
+				Directory &parent, bool all_tags=false);
 
 	/**
 	 * Throws on error.
 	 *
 	 * @return true on success, false if the file was not recognized
 	 */
-	bool UpdateFile(Storage &storage);
+	bool UpdateFile(Storage &storage, bool all_tags=false);
+
+	/**
+	 * Replace the attributes which UpdateFile() reads from the
+	 * file with those of another #Song which was loaded (e.g. by
+	 * another thread) with LoadFile().
+	 */
+	void MoveScannedFrom(Song &&src) noexcept;
 
 #ifdef ENABLE_ARCHIVE
 	static SongPtr LoadFromArchive(ArchiveFile &archive,
 				       const char *name_utf8,
-				       Directory &parent) noexcept;
-	bool UpdateFileInArchive(ArchiveFile &archive) noexcept;
+				       Directory &parent,
+				       bool all_tags=false) noexcept;
+	bool UpdateFileInArchive(ArchiveFile &archive,
+				 bool all_tags=false) noexcept;
 #endif
 
 	/**
@@ -145,8 +203,38 @@ struct Song : IntrusiveListHook<> {
 	[[gnu::pure]]
 	std::string GetURI() const noexcept;
 
+	/**
+	 * Look up the song referred to by #target, whose attributes
+	 * are merged by Export().  Returns nullptr if #target is
+	 * empty or if the song does not exist.
+	 */
+	[[gnu::pure]]
+	const Song *FindTarget() const noexcept;
+
 	[[gnu::pure]]
 	ExportedSong Export() const noexcept;
+
+	/**
+	 * Export this song as a #LightSong which refers to this
+	 * object's attributes.  This is only possible if #target is
+	 * empty; otherwise, the tags of the target song need to be
+	 * merged by Export().
+	 */
+	[[gnu::pure]]
+	LightSong ExportLight() const noexcept;
+
+	/**
+	 * Invoke the given function with a #LightSong representation
+	 * of this song.  This avoids constructing an #ExportedSong
+	 * (and looking up the target song) unless necessary.
+	 */
+	template<typename F>
+	decltype(auto) WithExport(F &&f) const {
+		if (target.empty())
+			return f(ExportLight());
+
+		return f(Export());
+	}
 };
 
 #endif
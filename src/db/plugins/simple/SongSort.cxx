@@ -20,22 +20,28 @@
 #include "SongSort.hxx"
 #include "Song.hxx"
 #include "tag/Tag.hxx"
+#include "tag/Pool.hxx"
 #include "lib/icu/Collate.hxx"
+#include "util/AllocatedString.hxx"
 #include "util/IntrusiveList.hxx"
 #include "util/SortList.hxx"
 
 #include <stdlib.h>
+#include <string.h>
 
-static int
-compare_utf8_string(const char *a, const char *b) noexcept
+/**
+ * Returns the collation sort key of the given tag value, or nullptr
+ * if the tag has no such value.  The key is cached by the tag pool,
+ * so it is generated only once for each distinct value.
+ */
+[[gnu::pure]]
+static const char *
+GetSortKey(const Tag &tag, TagType type) noexcept
 {
-	if (a == nullptr)
-		return b == nullptr ? 0 : -1;
-
-	if (b == nullptr)
-		return 1;
-
-	return IcuCollate(a, b);
+	const auto *item = tag.FindItem(type);
+	return item != nullptr
+		? tag_pool_get_sort_key(*item, IcuCollateKey)
+		: nullptr;
 }
 
 /**
@@ -45,8 +51,16 @@ compare_utf8_string(const char *a, const char *b) noexcept
 static int
 compare_string_tag_item(const Tag &a, const Tag &b, TagType type) noexcept
 {
-	return compare_utf8_string(a.GetValue(type),
-				   b.GetValue(type));
+	const char *a_key = GetSortKey(a, type);
+	const char *b_key = GetSortKey(b, type);
+
+	if (a_key == nullptr)
+		return b_key == nullptr ? 0 : -1;
+
+	if (b_key == nullptr)
+		return 1;
+
+	return strcmp(a_key, b_key);
 }
 
 /**
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "ExportedSong.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "song/ModifiedSinceSongFilter.hxx"
+#include "song/TagSongFilter.hxx"
+#include "tag/Fallback.hxx"
+#include "tag/Tag.hxx"
+#include "time/ChronoUtil.hxx"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+void
+TagIndex::Clear() noexcept
+{
+	songs.clear();
+	songs.shrink_to_fit();
+	directories.clear();
+
+	for (auto &i : tags)
+		i.clear();
+
+	mtimes.clear();
+	mtimes.shrink_to_fit();
+	by_mtime.clear();
+	by_mtime.shrink_to_fit();
+
+	defined = false;
+}
+
+inline void
+TagIndex::AddItem(TagType type, std::string_view value, uint32_t n)
+{
+	auto &list = tags[type][value];
+
+	/* a song may have the same value multiple times */
+	if (list.empty() || list.back() != n)
+		list.push_back(n);
+}
+
+inline void
+TagIndex::AddSong(const Song &song)
+{
+	const uint32_t n = songs.size();
+	songs.push_back(&song);
+
+	const Song *target = song.FindTarget();
+
+	/* the modification time is inherited from the target song,
+	   just like Song::Export() does */
+	mtimes.push_back(target != nullptr && IsNegative(song.mtime)
+			 ? target->mtime
+			 : song.mtime);
+
+	if (!with_tags)
+		return;
+
+	for (const auto &item : song.tag)
+		AddItem(item.type, item.value, n);
+
+	if (target == nullptr)
+		return;
+
+	/* a song with a target (e.g. a CUE track) exports the tags
+	   of the target song which it doesn't have itself, see
+	   Song::Export(); index them, too, referring to the target
+	   song's values (which live as long as the tree) instead of
+	   a temporary merged #Tag */
+	std::array<bool, TAG_NUM_OF_ITEM_TYPES> present{};
+	for (const auto &item : song.tag)
+		present[item.type] = true;
+
+	for (const auto &item : target->tag)
+		if (!present[item.type])
+			AddItem(item.type, item.value, n);
+}
+
+bool
+TagIndex::Add(const Directory &directory)
+{
+	if (directory.IsMount())
+		return true;
+
+	const uint32_t begin = songs.size();
+
+	for (const auto &song : directory.songs)
+		AddSong(song);
+
+	bool has_mounts = false;
+	for (const auto &child : directory.children)
+		if (Add(child))
+			has_mounts = true;
+
+	directories.emplace(&directory,
+			    Range{begin, uint32_t(songs.size()), has_mounts});
+	return has_mounts;
+}
+
+void
+TagIndex::Build(const Directory &root, bool _with_tags)
+{
+	Clear();
+	with_tags = _with_tags;
+	Add(root);
+
+	by_mtime.resize(songs.size());
+	for (uint32_t i = 0; i < by_mtime.size(); ++i)
+		by_mtime[i] = i;
+
+	std::stable_sort(by_mtime.begin(), by_mtime.end(),
+			 [this](uint32_t a, uint32_t b){
+				 return mtimes[a] < mtimes[b];
+			 });
+
+	defined = true;
+}
+
+const TagIndex::Range *
+TagIndex::FindRange(const Directory &directory,
+		    bool recursive) const noexcept
+{
+	if (!defined)
+		return nullptr;
+
+	const auto d = directories.find(&directory);
+	if (d == directories.end() ||
+	    /* songs of mounted databases need to be visited with
+	       Directory::Walk() */
+	    (recursive && d->second.has_mounts))
+		return nullptr;
+
+	return &d->second;
+}
+
+TagIndex::PostingList::const_iterator
+TagIndex::LowerBoundModified(TimePoint t) const noexcept
+{
+	return std::partition_point(by_mtime.begin(), by_mtime.end(),
+				    [this, t](uint32_t i){
+					    return mtimes[i] < t;
+				    });
+}
+
+inline bool
+TagIndex::IsSelected(uint32_t i, const Directory &directory,
+		     const Range &range, bool recursive,
+		     bool hide_playlist_targets) const noexcept
+{
+	if (i < range.begin || i >= range.end)
+		return false;
+
+	const Song &song = *songs[i];
+	return (recursive || &song.parent == &directory) &&
+		(!hide_playlist_targets || !song.in_playlist);
+}
+
+/**
+ * Can this filter be evaluated with the index, i.e. does it compare
+ * a specific tag with a literal (case-sensitive) string?
+ */
+[[gnu::pure]]
+static bool
+IsIndexable(const TagSongFilter &f) noexcept
+{
+	return f.IsIndexable() && !f.GetFoldCase();
+}
+
+/**
+ * Invoke the given function for each posting list which may contain
+ * songs matching the given filter.
+ */
+template<typename M, typename F>
+static void
+ForEachPostingList(const M &tags, const TagSongFilter &f, F &&func)
+{
+	const std::string_view value = f.GetValue();
+	const bool prefix = f.GetPosition() == StringFilter::Position::PREFIX;
+
+	/* the filter falls back to other tags if the requested one
+	   is missing, so all of them need to be considered */
+	ApplyTagWithFallback(f.GetTagType(), [&](TagType type){
+		const auto &map = tags[type];
+
+		if (prefix) {
+			for (auto i = map.lower_bound(value);
+			     i != map.end() && i->first.starts_with(value);
+			     ++i)
+				func(i->second);
+		} else {
+			auto i = map.find(value);
+			if (i != map.end())
+				func(i->second);
+		}
+
+		return false;
+	});
+}
+
+bool
+TagIndex::Visit(const Directory &directory, bool recursive,
+		const SongFilter &filter,
+		bool hide_playlist_targets,
+		const VisitSong &visit_song) const
+{
+	const Range *range = FindRange(directory, recursive);
+	if (range == nullptr)
+		return false;
+
+	/* find the most selective indexable filter item */
+	const TagSongFilter *best = nullptr;
+	std::size_t best_size = std::numeric_limits<std::size_t>::max();
+
+	/* the songs modified after the "modified-since" time */
+	auto since = by_mtime.begin();
+	bool have_since = false;
+
+	for (const auto &i : filter.GetItems()) {
+		if (const auto *m = dynamic_cast<const ModifiedSinceSongFilter *>(i.get())) {
+			since = std::max(since,
+					 LowerBoundModified(m->GetValue()));
+			have_since = true;
+			continue;
+		}
+
+		const auto *f = dynamic_cast<const TagSongFilter *>(i.get());
+		if (f == nullptr || !with_tags || !IsIndexable(*f))
+			continue;
+
+		std::size_t size = 0;
+		ForEachPostingList(tags, *f, [&size](const PostingList &list){
+			size += list.size();
+		});
+
+		if (size < best_size) {
+			best = f;
+			best_size = size;
+		}
+	}
+
+	if (have_since &&
+	    std::size_t(std::distance(since, by_mtime.end())) < best_size) {
+		/* "modified-since" is more selective than all tag
+		   filters */
+		best = nullptr;
+		best_size = std::distance(since, by_mtime.end());
+	} else if (best == nullptr)
+		return false;
+
+	PostingList candidates;
+	candidates.reserve(best_size);
+
+	unsigned n_lists = 0;
+	if (best != nullptr)
+		ForEachPostingList(tags, *best, [&](const PostingList &list){
+			candidates.insert(candidates.end(),
+					  list.begin(), list.end());
+			++n_lists;
+		});
+	else {
+		candidates.insert(candidates.end(), since, by_mtime.end());
+		std::sort(candidates.begin(), candidates.end());
+	}
+
+	if (n_lists > 1) {
+		/* restore the Directory::Walk() order */
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(),
+					     candidates.end()),
+				 candidates.end());
+	}
+
+	const auto begin = std::lower_bound(candidates.begin(),
+					    candidates.end(),
+					    range->begin);
+	const auto end = std::lower_bound(begin, candidates.end(),
+					  range->end);
+
+	for (auto i = begin; i != end; ++i) {
+		if (!IsSelected(*i, directory, *range, recursive,
+				hide_playlist_targets))
+			continue;
+
+		songs[*i]->WithExport([&filter, &visit_song](const LightSong &song2){
+			if (filter.Match(song2))
+				visit_song(song2);
+		});
+	}
+
+	return true;
+}
+
+bool
+TagIndex::VisitByModified(const Directory &directory, bool recursive,
+			  const SongFilter *filter,
+			  bool descending, RangeArg window,
+			  bool hide_playlist_targets,
+			  const VisitSong &visit_song) const
+{
+	const Range *range = FindRange(directory, recursive);
+	if (range == nullptr)
+		return false;
+
+	if (window.IsEmpty())
+		return true;
+
+	/* skip all songs older than the "modified-since" time */
+	auto first = by_mtime.begin();
+	if (filter != nullptr)
+		for (const auto &i : filter->GetItems())
+			if (const auto *m = dynamic_cast<const ModifiedSinceSongFilter *>(i.get()))
+				first = std::max(first,
+						 LowerBoundModified(m->GetValue()));
+
+	unsigned position = 0;
+
+	/* returns false after the end of the window has been
+	   reached */
+	const auto visit = [&](uint32_t i){
+		if (!IsSelected(i, directory, *range, recursive,
+				hide_playlist_targets))
+			return true;
+
+		songs[i]->WithExport([&](const LightSong &song){
+			if (filter != nullptr && !filter->Match(song))
+				return;
+
+			if (window.Contains(position))
+				visit_song(song);
+			++position;
+		});
+
+		return position < window.end;
+	};
+
+	if (!descending) {
+		for (auto i = first; i != by_mtime.end(); ++i)
+			if (!visit(*i))
+				break;
+		return true;
+	}
+
+	/* descending: walk the runs of equal modification times
+	   backwards, but each run forwards, because this is how
+	   std::stable_sort() would order them */
+	for (auto run_end = by_mtime.end(); run_end != first;) {
+		const auto t = mtimes[*std::prev(run_end)];
+		const auto run_begin =
+			std::partition_point(first, run_end,
+					     [this, t](uint32_t i){
+						     return mtimes[i] < t;
+					     });
+
+		for (auto i = run_begin; i != run_end; ++i)
+			if (!visit(*i))
+				return true;
+
+		run_end = run_begin;
+	}
+
+	return true;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SIMPLE_TAG_INDEX_HXX
+#define MPD_SIMPLE_TAG_INDEX_HXX
+
+#include "db/Visitor.hxx"
+#include "protocol/RangeArg.hxx"
+#include "tag/Type.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Directory;
+struct Song;
+class SongFilter;
+class ModifiedSinceSongFilter;
+
+/**
+ * An inverted index mapping tag values to the songs which contain
+ * them.  It is used by #SimpleDatabase to narrow down the set of
+ * candidates for filters which compare a tag with a literal string,
+ * instead of matching the filter against every song in the
+ * database.  Additionally, it orders all songs by modification time;
+ * this part is cheap and may be built without the tag values.
+ *
+ * The index refers to #Song objects and their tag values without
+ * owning them; it must be cleared before the tree is modified and
+ * rebuilt afterwards.
+ */
+class TagIndex {
+	/**
+	 * All songs in the order of Directory::Walk().
+	 */
+	std::vector<const Song *> songs;
+
+	struct Range {
+		uint32_t begin, end;
+
+		/**
+		 * Is there a mount point somewhere below this
+		 * directory?  Its songs are not in the index.
+		 */
+		bool has_mounts;
+	};
+
+	/**
+	 * Maps each directory to the range of #songs containing all
+	 * of its songs, including those in sub directories.
+	 */
+	std::unordered_map<const Directory *, Range> directories;
+
+	/**
+	 * A sorted list of indexes into #songs.
+	 */
+	using PostingList = std::vector<uint32_t>;
+
+	using ValueMap = std::map<std::string_view, PostingList, std::less<>>;
+
+	std::array<ValueMap, TAG_NUM_OF_ITEM_TYPES> tags;
+
+	using TimePoint = std::chrono::system_clock::time_point;
+
+	/**
+	 * The (exported) modification time of each song in #songs.
+	 */
+	std::vector<TimePoint> mtimes;
+
+	/**
+	 * Indexes into #songs, ordered by #mtimes; songs with the
+	 * same time are in Directory::Walk() order.  This answers
+	 * "modified-since" filters and sorting by "Last-Modified"
+	 * without looking at all songs.
+	 */
+	PostingList by_mtime;
+
+	/**
+	 * Were the tag values added to #tags?  If not, only the
+	 * modification time index is available.
+	 */
+	bool with_tags = false;
+
+	bool defined = false;
+
+public:
+	bool IsDefined() const noexcept {
+		return defined;
+	}
+
+	void Clear() noexcept;
+
+	/**
+	 * Build the index for the given tree.  The caller must hold
+	 * the #db_mutex, because Mount() may modify the tree at any
+	 * time.
+	 *
+	 * @param _with_tags index the tag values?  If false, only
+	 * the (much smaller) modification time index is built
+	 */
+	void Build(const Directory &root, bool _with_tags=true);
+
+	/**
+	 * Visit all songs in the given directory which match the
+	 * filter, in the same order as Directory::Walk() would.
+	 * Caller must lock the #db_mutex.
+	 *
+	 * @return false if the index cannot be used for this filter
+	 * (the caller shall then fall back to Directory::Walk())
+	 */
+	bool Visit(const Directory &directory, bool recursive,
+		   const SongFilter &filter,
+		   bool hide_playlist_targets,
+		   const VisitSong &visit_song) const;
+
+	/**
+	 * Visit the songs in the given directory which match the
+	 * (optional) filter, ordered by "Last-Modified", in the same
+	 * order as DatabaseVisitorHelper would sort them, and only
+	 * those in the given window.  Caller must lock the
+	 * #db_mutex.
+	 *
+	 * @return false if the index cannot be used (the caller
+	 * shall then fall back to Directory::Walk())
+	 */
+	bool VisitByModified(const Directory &directory, bool recursive,
+			     const SongFilter *filter,
+			     bool descending, RangeArg window,
+			     bool hide_playlist_targets,
+			     const VisitSong &visit_song) const;
+
+private:
+	void AddItem(TagType type, std::string_view value, uint32_t n);
+
+	/**
+	 * Append a song to #songs and add its exported tags to the
+	 * posting lists (if #with_tags is set).
+	 */
+	void AddSong(const Song &song);
+
+	/**
+	 * @return true if there is a mount point in this subtree
+	 */
+	bool Add(const Directory &directory);
+
+	/**
+	 * Look up the #Range of the given directory, or nullptr if
+	 * the index cannot be used for it.
+	 */
+	[[gnu::pure]]
+	const Range *FindRange(const Directory &directory,
+			       bool recursive) const noexcept;
+
+	/**
+	 * Returns the position of the first #by_mtime item which
+	 * was modified at or after the given time.
+	 */
+	[[gnu::pure]]
+	PostingList::const_iterator
+	LowerBoundModified(TimePoint t) const noexcept;
+
+	/**
+	 * Does the song (an index into #songs) belong to the
+	 * selection?  Does not check the filter.
+	 */
+	[[gnu::pure]]
+	bool IsSelected(uint32_t i, const Directory &directory,
+			const Range &range, bool recursive,
+			bool hide_playlist_targets) const noexcept;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "UriIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+
+#include <bit>
+#include <functional>
+
+[[gnu::pure]]
+static std::size_t
+Hash(std::string_view uri) noexcept
+{
+	return std::hash<std::string_view>{}(uri);
+}
+
+/**
+ * Does the song have the given URI?  This compares the file name
+ * first and does not need to construct the URI.
+ */
+[[gnu::pure]]
+static bool
+HasURI(const Song &song, std::string_view uri) noexcept
+{
+	const std::string_view filename = song.filename;
+	if (!uri.ends_with(filename))
+		return false;
+
+	uri.remove_suffix(filename.size());
+
+	if (song.parent.IsRoot())
+		return uri.empty();
+
+	if (!uri.ends_with('/'))
+		return false;
+
+	uri.remove_suffix(1);
+	return uri == song.parent.GetPath();
+}
+
+void
+UriIndex::Clear() noexcept
+{
+	table.clear();
+	table.shrink_to_fit();
+}
+
+std::size_t
+UriIndex::CountSongs(const Directory &directory) noexcept
+{
+	if (directory.IsMount())
+		return 0;
+
+	std::size_t n = directory.songs.size();
+	for (const auto &child : directory.children)
+		n += CountSongs(child);
+
+	return n;
+}
+
+inline void
+UriIndex::Insert(std::string_view uri, const Song &song) noexcept
+{
+	const std::size_t mask = table.size() - 1;
+
+	for (std::size_t i = Hash(uri) & mask;; i = (i + 1) & mask) {
+		if (table[i] == nullptr) {
+			table[i] = &song;
+			return;
+		}
+	}
+}
+
+void
+UriIndex::Add(const Directory &directory, std::string &buffer)
+{
+	if (directory.IsMount())
+		return;
+
+	buffer.clear();
+	if (!directory.IsRoot()) {
+		buffer = directory.GetPath();
+		buffer.push_back('/');
+	}
+
+	const std::size_t prefix_length = buffer.length();
+
+	for (const auto &song : directory.songs) {
+		buffer.resize(prefix_length);
+		buffer.append(song.filename);
+		Insert(buffer, song);
+	}
+
+	for (const auto &child : directory.children)
+		Add(child, buffer);
+}
+
+void
+UriIndex::Build(const Directory &root)
+{
+	Clear();
+
+	const std::size_t n = CountSongs(root);
+	if (n == 0)
+		return;
+
+	/* keep the load factor below 3/4 */
+	table.resize(std::bit_ceil(n + n / 3 + 1));
+
+	std::string buffer;
+	Add(root, buffer);
+}
+
+const Song *
+UriIndex::Find(std::string_view uri) const noexcept
+{
+	if (table.empty())
+		return nullptr;
+
+	const std::size_t mask = table.size() - 1;
+
+	for (std::size_t i = Hash(uri) & mask;; i = (i + 1) & mask) {
+		const Song *song = table[i];
+		if (song == nullptr)
+			return nullptr;
+
+		if (HasURI(*song, uri))
+			return song;
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SIMPLE_URI_INDEX_HXX
+#define MPD_SIMPLE_URI_INDEX_HXX
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Directory;
+struct Song;
+
+/**
+ * A hash table mapping the URI of each song to its #Song object.  It
+ * is used by SimpleDatabase::GetSong() to find a song with a single
+ * lookup instead of walking the tree one path component at a time.
+ *
+ * Only the songs of this database are indexed, not those of mounted
+ * databases.  The index refers to #Song objects without owning them;
+ * it must be cleared before the tree is modified and rebuilt
+ * afterwards.
+ */
+class UriIndex {
+	/**
+	 * An open addressing hash table with linear probing; its
+	 * size is a power of two (or zero).  Empty slots are
+	 * nullptr.  The hash values are not stored; colliding slots
+	 * are told apart by comparing the URI, which is cheap
+	 * because it is mostly the file name.
+	 */
+	std::vector<const Song *> table;
+
+public:
+	void Clear() noexcept;
+
+	/**
+	 * Rebuild the index from the given tree.  Caller must lock
+	 * the #db_mutex.
+	 *
+	 * Throws on out-of-memory.
+	 */
+	void Build(const Directory &root);
+
+	/**
+	 * Look up a song by its URI.  Caller must lock the
+	 * #db_mutex.
+	 *
+	 * @return the song or nullptr if it is not in the index (it
+	 * may still exist, e.g. in a mounted database or while the
+	 * index is being rebuilt)
+	 */
+	[[gnu::pure]]
+	const Song *Find(std::string_view uri) const noexcept;
+
+private:
+	[[gnu::pure]]
+	static std::size_t CountSongs(const Directory &directory) noexcept;
+
+	void Add(const Directory &directory, std::string &buffer);
+	void Insert(std::string_view uri, const Song &song) noexcept;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Cache.hxx"
+#include "Directory.hxx"
+#include "lib/upnp/ContentDirectoryService.hxx"
+
+#include <utility>
+
+UpnpBrowseCache::~UpnpBrowseCache() noexcept = default;
+
+void
+UpnpBrowseCache::Clear() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	servers.clear();
+}
+
+void
+UpnpBrowseCache::Validate(const ContentDirectoryService &server,
+			  UpnpClient_Handle handle, const std::string &uri,
+			  std::chrono::steady_clock::time_point now) noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		auto &s = servers[uri];
+		if (!s.have_system_update_id ||
+		    (s.known_system_update_id && now - s.checked < CHECK_INTERVAL))
+			return;
+
+		/* mark as checked now so concurrent callers don't
+		   send the same request */
+		s.checked = now;
+	}
+
+	unsigned id;
+	try {
+		id = server.getSystemUpdateID(handle);
+	} catch (...) {
+		/* not implemented by this server; rely on the TTL
+		   only */
+		const std::scoped_lock lock{mutex};
+		servers[uri].have_system_update_id = false;
+		return;
+	}
+
+	const std::scoped_lock lock{mutex};
+	auto &s = servers[uri];
+	if (s.known_system_update_id && id != s.system_update_id)
+		/* the server's content has changed */
+		s.items.clear();
+
+	s.system_update_id = id;
+	s.known_system_update_id = true;
+}
+
+template<typename F>
+UpnpBrowseCache::Content
+UpnpBrowseCache::Get(const ContentDirectoryService &server,
+		     UpnpClient_Handle handle,
+		     std::string &&key, F &&f)
+{
+	if (ttl <= std::chrono::steady_clock::duration::zero())
+		return std::make_shared<const UPnPDirContent>(f());
+
+	const auto uri = server.GetURI();
+	const auto now = std::chrono::steady_clock::now();
+
+	Validate(server, handle, uri, now);
+
+	{
+		const std::scoped_lock lock{mutex};
+		auto &items = servers[uri].items;
+		if (auto i = items.find(key); i != items.end()) {
+			if (now < i->second.expires)
+				return i->second.content;
+
+			items.erase(i);
+		}
+	}
+
+	/* not cached: send the request without holding the lock */
+	auto content = std::make_shared<const UPnPDirContent>(f());
+
+	const std::scoped_lock lock{mutex};
+	auto &items = servers[uri].items;
+
+	if (items.size() >= MAX_ITEMS) {
+		/* make room: discard expired items first, and if
+		   that wasn't enough, start over */
+		std::erase_if(items, [now](const auto &i){
+			return now >= i.second.expires;
+		});
+
+		if (items.size() >= MAX_ITEMS)
+			items.clear();
+	}
+
+	items.insert_or_assign(std::move(key), Item{content, now + ttl});
+	return content;
+}
+
+UpnpBrowseCache::Content
+UpnpBrowseCache::ReadDir(const ContentDirectoryService &server,
+			 UpnpClient_Handle handle,
+			 const char *object_id)
+{
+	std::string key{"C"};
+	key += object_id;
+
+	return Get(server, handle, std::move(key), [&]{
+		return server.readDir(handle, object_id);
+	});
+}
+
+UpnpBrowseCache::Content
+UpnpBrowseCache::GetMetadata(const ContentDirectoryService &server,
+			     UpnpClient_Handle handle,
+			     const char *object_id)
+{
+	std::string key{"M"};
+	key += object_id;
+
+	return Get(server, handle, std::move(key), [&]{
+		return server.getMetadata(handle, object_id);
+	});
+}
+
+UpnpBrowseCache::Content
+UpnpBrowseCache::Search(const ContentDirectoryService &server,
+			UpnpClient_Handle handle,
+			const char *object_id, const char *criteria)
+{
+	std::string key{"S"};
+	key += object_id;
+	key.push_back('\0');
+	key += criteria;
+
+	return Get(server, handle, std::move(key), [&]{
+		return server.search(handle, object_id, criteria);
+	});
+}
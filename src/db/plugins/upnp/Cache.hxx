@@ -0,0 +1,166 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPNP_CACHE_HXX
+#define MPD_UPNP_CACHE_HXX
+
+#include "lib/upnp/Compat.hxx"
+#include "thread/Mutex.hxx"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class ContentDirectoryService;
+class UPnPDirContent;
+
+/**
+ * A cache for the results of "Browse" and "Search" requests to UPnP
+ * media servers.  Items expire after a configurable time; in
+ * addition, all items of a server are discarded as soon as its
+ * "SystemUpdateID" changes.
+ *
+ * This class is thread-safe.
+ */
+class UpnpBrowseCache {
+	/**
+	 * Check the "SystemUpdateID" of a server at most this
+	 * often.
+	 */
+	static constexpr std::chrono::steady_clock::duration CHECK_INTERVAL =
+		std::chrono::seconds(10);
+
+	/**
+	 * The maximum number of items per server.
+	 */
+	static constexpr std::size_t MAX_ITEMS = 1024;
+
+	using Content = std::shared_ptr<const UPnPDirContent>;
+
+	struct Item {
+		Content content;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	struct Server {
+		/**
+		 * Cached results; the key is a one-letter request
+		 * type followed by the object id (and the search
+		 * criteria).
+		 */
+		std::map<std::string, Item, std::less<>> items;
+
+		/**
+		 * The last time the "SystemUpdateID" was checked.
+		 */
+		std::chrono::steady_clock::time_point checked;
+
+		unsigned system_update_id;
+
+		/**
+		 * Does the server implement "GetSystemUpdateID"?
+		 * Initially assumed; if it fails once, only the TTL
+		 * applies.
+		 */
+		bool have_system_update_id = true;
+
+		/**
+		 * Has #system_update_id been initialized?
+		 */
+		bool known_system_update_id = false;
+	};
+
+	/**
+	 * Zero disables the cache.
+	 */
+	const std::chrono::steady_clock::duration ttl;
+
+	Mutex mutex;
+
+	/**
+	 * The key is ContentDirectoryService::GetURI().  Protected by
+	 * #mutex.
+	 */
+	std::map<std::string, Server, std::less<>> servers;
+
+public:
+	explicit UpnpBrowseCache(std::chrono::steady_clock::duration _ttl) noexcept
+		:ttl(_ttl) {}
+
+	~UpnpBrowseCache() noexcept;
+
+	UpnpBrowseCache(const UpnpBrowseCache &) = delete;
+	UpnpBrowseCache &operator=(const UpnpBrowseCache &) = delete;
+
+	/**
+	 * Cached version of ContentDirectoryService::readDir().
+	 *
+	 * Throws on error.
+	 */
+	Content ReadDir(const ContentDirectoryService &server,
+			UpnpClient_Handle handle,
+			const char *object_id);
+
+	/**
+	 * Cached version of ContentDirectoryService::getMetadata().
+	 *
+	 * Throws on error.
+	 */
+	Content GetMetadata(const ContentDirectoryService &server,
+			    UpnpClient_Handle handle,
+			    const char *object_id);
+
+	/**
+	 * Cached version of ContentDirectoryService::search().
+	 *
+	 * Throws on error.
+	 */
+	Content Search(const ContentDirectoryService &server,
+		       UpnpClient_Handle handle,
+		       const char *object_id, const char *criteria);
+
+	/**
+	 * Discard all cached items.
+	 */
+	void Clear() noexcept;
+
+private:
+	/**
+	 * Look up an item, or call the given function and add its
+	 * result to the cache.
+	 */
+	template<typename F>
+	Content Get(const ContentDirectoryService &server,
+		    UpnpClient_Handle handle,
+		    std::string &&key, F &&f);
+
+	/**
+	 * Query the server's "SystemUpdateID" if #CHECK_INTERVAL
+	 * has passed, and discard its items if it has changed.
+	 *
+	 * Caller must not lock the #mutex.
+	 */
+	void Validate(const ContentDirectoryService &server,
+		      UpnpClient_Handle handle, const std::string &uri,
+		      std::chrono::steady_clock::time_point now) noexcept;
+};
+
+#endif
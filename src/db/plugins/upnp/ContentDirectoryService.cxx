@@ -26,11 +26,19 @@
 #include "lib/upnp/Action.hxx"
 #include "lib/upnp/Error.hxx"
 #include "Directory.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Name.hxx"
+#include "util/BindMethod.hxx"
 #include "util/NumberParser.hxx"
 #include "util/ScopeExit.hxx"
 #include "util/StringFormat.hxx"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <list>
+#include <vector>
 
 #ifdef USING_PUPNP
 static void
@@ -117,6 +125,132 @@ ContentDirectoryService::readDirSlice(UpnpClient_Handle hdl,
 #endif
 }
 
+/**
+ * The maximum number of Browse requests which readDir() sends to one
+ * server concurrently.  Servers (e.g. MiniDLNA) are usually
+ * single-process and small, so this is deliberately modest.
+ */
+static constexpr unsigned MAX_PARALLEL_BROWSE = 4;
+
+namespace {
+
+/**
+ * Reads the remaining slices of a large container with up to
+ * #MAX_PARALLEL_BROWSE concurrent requests.  Each thread claims the
+ * next slice index; the results are merged in order afterwards.
+ */
+class ParallelSliceReader {
+	const ContentDirectoryService &service;
+	const UpnpClient_Handle handle;
+	const char *const object_id;
+
+	const unsigned begin, end, step;
+
+	std::vector<UPnPDirContent> slices;
+
+	std::atomic_uint next{0};
+
+	Mutex mutex;
+
+	/**
+	 * The first error which occurred in any thread.  Protected
+	 * by #mutex.
+	 */
+	std::exception_ptr error;
+
+public:
+	ParallelSliceReader(const ContentDirectoryService &_service,
+			    UpnpClient_Handle _handle,
+			    const char *_object_id,
+			    unsigned _begin, unsigned _end,
+			    unsigned _step) noexcept
+		:service(_service), handle(_handle), object_id(_object_id),
+		 begin(_begin), end(_end), step(_step),
+		 slices((end - begin + step - 1) / step) {}
+
+	/**
+	 * Read all slices and append them to the given object.
+	 *
+	 * Throws on error.
+	 */
+	void ReadInto(UPnPDirContent &dest) {
+		std::list<Thread> threads;
+		const unsigned n_threads = std::min<std::size_t>(MAX_PARALLEL_BROWSE,
+								 slices.size());
+
+		for (unsigned i = 1; i < n_threads; ++i) {
+			auto &thread = threads.emplace_back(BIND_THIS_METHOD(ThreadFunc));
+			try {
+				thread.Start();
+			} catch (...) {
+				/* continue with fewer threads */
+				threads.pop_back();
+				break;
+			}
+		}
+
+		/* this thread helps, too */
+		Run();
+
+		for (auto &thread : threads)
+			thread.Join();
+
+		if (error)
+			std::rethrow_exception(error);
+
+		for (auto &slice : slices)
+			std::move(slice.objects.begin(), slice.objects.end(),
+				  std::back_inserter(dest.objects));
+	}
+
+private:
+	/**
+	 * Read the slice with the given index.  If the server
+	 * returns fewer entries than requested, the rest of the
+	 * slice is requested until it is complete.
+	 */
+	void ReadSlice(unsigned i) {
+		unsigned offset = begin + i * step;
+		const unsigned slice_end = std::min(offset + step, end);
+		unsigned total = end;
+
+		while (offset < slice_end) {
+			unsigned count;
+			service.readDirSlice(handle, object_id,
+					     offset, slice_end - offset,
+					     slices[i], count, total);
+			if (count == 0)
+				break;
+
+			offset += count;
+		}
+	}
+
+	void ThreadFunc() noexcept {
+		SetThreadName("upnp_browse");
+		Run();
+	}
+
+	void Run() noexcept {
+		unsigned i;
+		while ((i = next.fetch_add(1, std::memory_order_relaxed)) < slices.size()) {
+			try {
+				ReadSlice(i);
+			} catch (...) {
+				const std::scoped_lock lock{mutex};
+				if (!error)
+					error = std::current_exception();
+
+				/* stop all threads */
+				next.store(slices.size(), std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+};
+
+} // anonymous namespace
+
 UPnPDirContent
 ContentDirectoryService::readDir(UpnpClient_Handle handle,
 				 const char *objectId) const
@@ -124,12 +258,28 @@ ContentDirectoryService::readDir(UpnpClient_Handle handle,
 	UPnPDirContent dirbuf;
 	unsigned offset = 0, total = -1, count;
 
-	do {
+	/* the first slice tells us how large the container is and
+	   how many entries the server returns per request */
+	readDirSlice(handle, objectId, offset, m_rdreqcnt, dirbuf,
+		     count, total);
+	offset += count;
+
+	if (count > 0 && offset < total && total != unsigned(-1) &&
+	    total - offset > count) {
+		/* there are at least two more slices: read them in
+		   parallel */
+		ParallelSliceReader reader(*this, handle, objectId,
+					   offset, total, count);
+		reader.ReadInto(dirbuf);
+		return dirbuf;
+	}
+
+	while (count > 0 && offset < total) {
 		readDirSlice(handle, objectId, offset, m_rdreqcnt, dirbuf,
 			     count, total);
 
 		offset += count;
-	} while (count > 0 && offset < total);
+	}
 
 	return dirbuf;
 }
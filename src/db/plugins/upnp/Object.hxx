@@ -74,6 +74,7 @@ public:
 
 	UPnPDirObject() = default;
 	UPnPDirObject(UPnPDirObject &&) = default;
+	UPnPDirObject(const UPnPDirObject &) = default;
 
 	~UPnPDirObject() noexcept;
 
@@ -18,6 +18,7 @@
  */
 
 #include "UpnpDatabasePlugin.hxx"
+#include "Cache.hxx"
 #include "Directory.hxx"
 #include "Tags.hxx"
 #include "lib/upnp/ClientInit.hxx"
@@ -28,6 +29,7 @@
 #include "db/Selection.hxx"
 #include "db/VHelper.hxx"
 #include "db/UniqueTags.hxx"
+#include "db/GroupCount.hxx"
 #include "db/DatabaseError.hxx"
 #include "db/LightDirectory.hxx"
 #include "song/LightSong.hxx"
@@ -41,6 +43,7 @@
 #include "config/Block.hxx"
 
 #include <cassert>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -78,11 +81,18 @@ class UpnpDatabase : public Database {
 
 	const char* interface;
 
+	/**
+	 * Caches "Browse" and "Search" results.  This is mutable
+	 * because it gets filled by the "const" query methods.
+	 */
+	mutable UpnpBrowseCache cache;
+
 public:
 	explicit UpnpDatabase(EventLoop &_event_loop, const ConfigBlock &block) noexcept
 		:Database(upnp_db_plugin),
 		 event_loop(_event_loop),
-		 interface(block.GetBlockValue("interface", nullptr)) {}
+		 interface(block.GetBlockValue("interface", nullptr)),
+		 cache(std::chrono::seconds(block.GetBlockValue("cache_ttl", 60U))) {}
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -102,6 +112,9 @@ public:
 	[[nodiscard]] RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &selection,
 								  std::span<const TagType> tag_types) const override;
 
+	[[nodiscard]] TagCountMap CountSongs(const DatabaseSelection &selection,
+					     TagType group) const override;
+
 	[[nodiscard]] DatabaseStats GetStats(const DatabaseSelection &selection) const override;
 
 	[[nodiscard]] std::chrono::system_clock::time_point GetUpdateStamp() const noexcept override {
@@ -125,9 +138,9 @@ private:
 			 const DatabaseSelection &selection,
 			 const VisitSong& visit_song) const;
 
-	UPnPDirContent SearchSongs(const ContentDirectoryService &server,
-				   const char *objid,
-				   const DatabaseSelection &selection) const;
+	std::shared_ptr<const UPnPDirContent> SearchSongs(const ContentDirectoryService &server,
+							  const char *objid,
+							  const DatabaseSelection &selection) const;
 
 	UPnPDirObject Namei(const ContentDirectoryService &server,
 			    std::forward_list<std::string_view> &&vpath) const;
@@ -173,6 +186,7 @@ UpnpDatabase::Open()
 void
 UpnpDatabase::Close() noexcept
 {
+	cache.Clear();
 	delete discovery;
 	UpnpClientGlobalFinish();
 }
@@ -242,18 +256,18 @@ dquote(std::string &out, const char *in) noexcept
 
 // Run an UPnP search, according to MPD parameters. Return results as
 // UPnP items
-UPnPDirContent
+std::shared_ptr<const UPnPDirContent>
 UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 			  const char *objid,
 			  const DatabaseSelection &selection) const
 {
 	const SongFilter *filter = selection.filter;
 	if (selection.filter == nullptr)
-		return {};
+		return nullptr;
 
 	const auto searchcaps = server.getSearchCapabilities(handle);
 	if (searchcaps.empty())
-		return {};
+		return nullptr;
 
 	std::string cond;
 	for (const auto &item : filter->GetItems()) {
@@ -310,7 +324,7 @@ UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 		// TODO: support other ISongFilter implementations
 	}
 
-	return server.search(handle, objid, cond.c_str());
+	return cache.Search(server, handle, objid, cond.c_str());
 }
 
 static void
@@ -350,7 +364,10 @@ UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 		return;
 
 	const auto content = SearchSongs(server, objid, selection);
-	for (auto &dirent : content.objects) {
+	if (content == nullptr)
+		return;
+
+	for (const auto &dirent : content->objects) {
 		if (dirent.type != UPnPDirObject::Type::ITEM ||
 		    dirent.item_class != UPnPDirObject::ItemClass::MUSIC)
 			continue;
@@ -382,11 +399,11 @@ UPnPDirObject
 UpnpDatabase::ReadNode(const ContentDirectoryService &server,
 		       const char *objid) const
 {
-	auto dirbuf = server.getMetadata(handle, objid);
-	if (dirbuf.objects.size() != 1)
+	const auto dirbuf = cache.GetMetadata(server, handle, objid);
+	if (dirbuf->objects.size() != 1)
 		throw std::runtime_error("Bad resource");
 
-	return std::move(dirbuf.objects.front());
+	return dirbuf->objects.front();
 }
 
 std::string
@@ -422,23 +439,23 @@ UpnpDatabase::Namei(const ContentDirectoryService &server,
 
 	// Walk the path elements, read each directory and try to find the next one
 	while (true) {
-		auto dirbuf = server.readDir(handle, objid.c_str());
+		const auto dirbuf = cache.ReadDir(server, handle, objid.c_str());
 
 		// Look for the name in the sub-container list
-		UPnPDirObject *child = dirbuf.FindObject(vpath.front());
+		const UPnPDirObject *child = dirbuf->FindObject(vpath.front());
 		if (child == nullptr)
 			throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
 					    "No such object");
 
 		vpath.pop_front();
 		if (vpath.empty())
-			return std::move(*child);
+			return *child;
 
 		if (child->type != UPnPDirObject::Type::CONTAINER)
 			throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
 					    "Not a container");
 
-		objid = std::move(child->id);
+		objid = child->id;
 	}
 }
 
@@ -568,8 +585,9 @@ UpnpDatabase::VisitServer(const ContentDirectoryService &server,
 	/* Target was a a container. Visit it. We could read slices
 	   and loop here, but it's not useful as mpd will only return
 	   data to the client when we're done anyway. */
-	const auto contents = server.readDir(handle, tdirent.id.c_str());
-	for (const auto &dirent : contents.objects) {
+	const auto contents = cache.ReadDir(server, handle,
+					    tdirent.id.c_str());
+	for (const auto &dirent : contents->objects) {
 		const std::string uri = PathTraitsUTF8::Build(base_uri,
 							      dirent.name.c_str());
 		VisitObject(dirent, uri.c_str(),
@@ -633,6 +651,13 @@ UpnpDatabase::CollectUniqueTags(const DatabaseSelection &selection,
 	return ::CollectUniqueTags(*this, selection, tag_types);
 }
 
+TagCountMap
+UpnpDatabase::CountSongs(const DatabaseSelection &selection,
+			 TagType group) const
+{
+	return ::CountSongs(*this, selection, group);
+}
+
 DatabaseStats
 UpnpDatabase::GetStats(const DatabaseSelection &) const
 {
@@ -74,23 +74,23 @@ UpdateWalk::UpdateArchiveTree(ArchiveFile &archive, Directory &directory,
 		//add file
 		Song *song = LockFindSong(directory, name);
 		if (song == nullptr) {
-			auto new_song = Song::LoadFromArchive(archive, name, directory);
+			auto new_song = Song::LoadFromArchive(archive, name,
+							      directory,
+							      config.all_tags);
 			if (new_song) {
-				{
-					const ScopeDatabaseLock protect;
-					directory.AddSong(std::move(new_song));
-				}
+				AddNewSong(std::move(new_song));
 
 				modified = true;
 				FmtNotice(update_domain, "added {}/{}",
 					  directory.GetPath(), name);
 			}
 		} else {
-			if (!song->UpdateFileInArchive(archive)) {
+			if (!song->UpdateFileInArchive(archive,
+							config.all_tags)) {
 				FmtDebug(update_domain,
 					 "deleting unrecognized file {}/{}",
 					 directory.GetPath(), name);
-				editor.LockDeleteSong(directory, song);
+				LockDeleteSong(directory, song);
 			}
 		}
 	}
@@ -132,6 +132,11 @@ UpdateWalk::UpdateArchiveFile(Directory &parent, std::string_view name,
 		   supports only local files */
 		return;
 
+	if (CheckVirtualSkipCache(parent, name, info, DEVICE_INARCHIVE))
+		/* touched, but the contents are unchanged: don't
+		   reopen the archive and rescan all members */
+		return;
+
 	Directory *directory =
 		LockMakeVirtualDirectoryIfModified(parent, name, info,
 						   DEVICE_INARCHIVE);
@@ -145,7 +150,7 @@ UpdateWalk::UpdateArchiveFile(Directory &parent, std::string_view name,
 		file = archive_file_open(&plugin, path_fs);
 	} catch (...) {
 		LogError(std::current_exception());
-		editor.LockDeleteDirectory(directory);
+		LockDeleteDirectory(directory);
 		return;
 	}
 
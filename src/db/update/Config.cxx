@@ -20,6 +20,7 @@
 #include "Config.hxx"
 #include "config/Data.hxx"
 #include "config/Option.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 
 UpdateConfig::UpdateConfig(const ConfigData &config)
 {
@@ -31,7 +32,17 @@ UpdateConfig::UpdateConfig(const ConfigData &config)
 	follow_outside_symlinks =
 		config.GetBool(ConfigOption::FOLLOW_OUTSIDE_SYMLINKS,
 			       DEFAULT_FOLLOW_OUTSIDE_SYMLINKS);
-#else
-	(void)config;
 #endif
+
+	threads = config.GetPositive(ConfigOption::UPDATE_THREADS,
+				     DEFAULT_THREADS);
+	if (threads > MAX_THREADS)
+		throw FmtRuntimeError("update_threads must not be larger than {}",
+				      MAX_THREADS);
+
+	batch_size = config.GetPositive(ConfigOption::UPDATE_BATCH_SIZE,
+					DEFAULT_BATCH_SIZE);
+
+	skip_cache = config.GetBool(ConfigOption::UPDATE_SKIP_CACHE, false);
+	all_tags = config.GetBool(ConfigOption::UPDATE_ALL_TAGS, false);
 }
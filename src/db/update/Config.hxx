@@ -31,6 +31,38 @@ struct UpdateConfig {
 	bool follow_outside_symlinks = DEFAULT_FOLLOW_OUTSIDE_SYMLINKS;
 #endif
 
+	static constexpr unsigned DEFAULT_THREADS = 1;
+	static constexpr unsigned MAX_THREADS = 64;
+
+	/**
+	 * The number of threads scanning song tags.  If this is 1,
+	 * the update thread does it all by itself.
+	 */
+	unsigned threads = DEFAULT_THREADS;
+
+	static constexpr unsigned DEFAULT_BATCH_SIZE = 32;
+
+	/**
+	 * The maximum number of new songs which are collected before
+	 * they are added to the tree in one critical section.
+	 */
+	unsigned batch_size = DEFAULT_BATCH_SIZE;
+
+	/**
+	 * Maintain an #UpdateSkipCache next to the database file?
+	 */
+	bool skip_cache = false;
+
+	/**
+	 * Scan all tag types, even those disabled by
+	 * "metadata_to_use", and store the disabled ones in
+	 * Song::hidden_tag?
+	 */
+	bool all_tags = false;
+
+	/**
+	 * Throws on error.
+	 */
 	explicit UpdateConfig(const ConfigData &config);
 };
 
@@ -30,6 +30,8 @@
 #include "storage/FileInfo.hxx"
 #include "Log.hxx"
 
+#include <vector>
+
 bool
 UpdateWalk::UpdateContainerFile(Directory &directory,
 				std::string_view name, std::string_view suffix,
@@ -42,9 +44,12 @@ UpdateWalk::UpdateContainerFile(Directory &directory,
 		return false;
 	const DecoderPlugin &plugin = *_plugin;
 
+	if (CheckVirtualSkipCache(directory, name, info, DEVICE_CONTAINER))
+		return true;
+
 	Directory *contdir;
 	{
-		const ScopeDatabaseLock protect;
+		const UpdateLockStats::ScopeLock protect{lock_stats};
 		contdir = MakeVirtualDirectoryIfModified(directory, name,
 							 info,
 							 DEVICE_CONTAINER);
@@ -57,20 +62,21 @@ UpdateWalk::UpdateContainerFile(Directory &directory,
 	if (pathname.IsNull()) {
 		/* not a local file: skip, because the container API
 		   supports only local files */
-		editor.LockDeleteDirectory(contdir);
+		LockDeleteDirectory(contdir);
 		return false;
 	}
 
 	try {
 		auto v = plugin.container_scan(pathname);
 		if (v.empty()) {
-			editor.LockDeleteDirectory(contdir);
+			LockDeleteDirectory(contdir);
 			return false;
 		}
 
+		std::vector<SongPtr> songs;
+
 		for (auto &vtrack : v) {
-			auto song = std::make_unique<Song>(std::move(vtrack),
-							   *contdir);
+			auto song = Song::New(std::move(vtrack), *contdir);
 
 			// shouldn't be necessary but it's there..
 			song->mtime = info.mtime;
@@ -79,16 +85,19 @@ UpdateWalk::UpdateContainerFile(Directory &directory,
 				  contdir->GetPath(),
 				  song->filename);
 
-			{
-				const ScopeDatabaseLock protect;
-				contdir->AddSong(std::move(song));
-			}
+			songs.emplace_back(std::move(song));
+		}
 
-			modified = true;
+		{
+			const UpdateLockStats::ScopeLock protect{lock_stats};
+			for (auto &song : songs)
+				contdir->AddSong(std::move(song));
 		}
+
+		modified = true;
 	} catch (...) {
 		LogError(std::current_exception());
-		editor.LockDeleteDirectory(contdir);
+		LockDeleteDirectory(contdir);
 		return false;
 	}
 
@@ -29,16 +29,84 @@
 #include "util/StringStrip.hxx"
 #include "config.h"
 
+#include <algorithm>
 #include <cassert>
 
 #ifdef HAVE_CLASS_GLOB
 
+#ifdef HAVE_FNMATCH
+
+/**
+ * Does the given string contain no fnmatch() wildcards?
+ */
+[[gnu::pure]]
+static bool
+IsLiteral(std::string_view s) noexcept
+{
+	return s.find_first_of("*?[\\") == s.npos;
+}
+
+#endif
+
+inline void
+ExcludeList::AddPattern(const char *_pattern) noexcept
+{
+#ifdef HAVE_FNMATCH
+	const std::string_view pattern{_pattern};
+
+	/* the most common kinds of patterns are compiled into hash
+	   sets; this is not done on Windows, because
+	   PathMatchSpec() is case-insensitive */
+
+	if (IsLiteral(pattern)) {
+		literals.emplace(pattern);
+		return;
+	}
+
+	if (pattern.front() == '*' && IsLiteral(pattern.substr(1))) {
+		const auto suffix = pattern.substr(1);
+		if (suffixes.emplace(suffix).second &&
+		    std::find(suffix_lengths.begin(), suffix_lengths.end(),
+			      suffix.size()) == suffix_lengths.end())
+			suffix_lengths.push_back(suffix.size());
+		return;
+	}
+#endif
+
+	patterns.emplace_front(_pattern);
+}
+
 inline void
 ExcludeList::ParseLine(char *line) noexcept
 {
 	char *p = Strip(line);
 	if (*p != 0 && *p != '#')
-		patterns.emplace_front(p);
+		AddPattern(p);
+}
+
+inline bool
+ExcludeList::Check(std::string_view name) const noexcept
+{
+	if (parent != nullptr && parent->Check(name))
+		return true;
+
+	if (literals.contains(name))
+		return true;
+
+	for (const std::size_t length : suffix_lengths)
+		if (length <= name.size() &&
+		    suffixes.contains(name.substr(name.size() - length)))
+			return true;
+
+	if (!patterns.empty()) {
+		/* fnmatch() needs a null-terminated string */
+		const std::string name_s{name};
+		for (const auto &i : patterns)
+			if (i.Check(name_s.c_str()))
+				return true;
+	}
+
+	return false;
 }
 
 #endif
@@ -68,18 +136,11 @@ ExcludeList::Check(Path name_fs) const noexcept
 	/* XXX include full path name in check */
 
 #ifdef HAVE_CLASS_GLOB
-	if (parent != nullptr) {
-		if (parent->Check(name_fs)) {
-			return true;
-		}
-	}
-
-	for (const auto &i : patterns) {
-		try {
-			if (i.Check(NarrowPath(name_fs).c_str()))
-				return true;
-		} catch (...) {
-		}
+	try {
+		/* convert only once for all patterns */
+		const NarrowPath name(name_fs);
+		return Check(std::string_view{name.c_str()});
+	} catch (...) {
 	}
 #else
 	/* not implemented */
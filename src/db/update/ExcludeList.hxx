@@ -31,6 +31,10 @@
 
 #ifdef HAVE_CLASS_GLOB
 #include <forward_list>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 #endif
 
 class Path;
@@ -39,6 +43,44 @@ class ExcludeList {
 	const ExcludeList *const parent;
 
 #ifdef HAVE_CLASS_GLOB
+	/**
+	 * A hash function which allows looking up std::string_view
+	 * keys without allocating a std::string.
+	 */
+	struct StringHash {
+		using is_transparent = void;
+
+		[[gnu::pure]]
+		std::size_t operator()(std::string_view s) const noexcept {
+			return std::hash<std::string_view>{}(s);
+		}
+	};
+
+	using StringSet = std::unordered_set<std::string, StringHash,
+					     std::equal_to<>>;
+
+	/**
+	 * Patterns without wildcards; they are compared with the
+	 * whole file name.
+	 */
+	StringSet literals;
+
+	/**
+	 * Patterns of the form "*SUFFIX" (e.g. "*.jpg") without
+	 * the asterisk.
+	 */
+	StringSet suffixes;
+
+	/**
+	 * The distinct lengths of all #suffixes, so Check() needs
+	 * only one hash lookup per length.
+	 */
+	std::vector<std::size_t> suffix_lengths;
+
+	/**
+	 * All other patterns, which need to be evaluated with
+	 * fnmatch().
+	 */
 	std::forward_list<Glob> patterns;
 #endif
 
@@ -52,7 +94,8 @@ public:
 	[[gnu::pure]]
 	bool IsEmpty() const noexcept {
 #ifdef HAVE_CLASS_GLOB
-		return ((parent == nullptr) || parent->IsEmpty()) && patterns.empty();
+		return ((parent == nullptr) || parent->IsEmpty()) &&
+			!HasPatterns();
 #else
 		/* not implemented */
 		return true;
@@ -73,6 +116,18 @@ public:
 	bool Check(Path name_fs) const noexcept;
 
 private:
+#ifdef HAVE_CLASS_GLOB
+	bool HasPatterns() const noexcept {
+		return !literals.empty() || !suffixes.empty() ||
+			!patterns.empty();
+	}
+
+	[[gnu::pure]]
+	bool Check(std::string_view name) const noexcept;
+
+	void AddPattern(const char *pattern) noexcept;
+#endif
+
 	void ParseLine(char *line) noexcept;
 };
 
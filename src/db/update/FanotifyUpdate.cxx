@@ -0,0 +1,181 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "FanotifyUpdate.hxx"
+#include "InotifyDomain.hxx"
+#include "storage/StorageInterface.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Path.hxx"
+#include "io/Open.hxx"
+#include "util/StringFormat.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/fanotify.h>
+
+static constexpr uint64_t FAN_MASK =
+	FAN_CLOSE_WRITE|FAN_CREATE|FAN_DELETE|FAN_MOVED_FROM|FAN_MOVED_TO
+	|FAN_ONDIR;
+
+/**
+ * Obtain the path of the given file descriptor from the kernel.
+ */
+static AllocatedPath
+GetFileDescriptorPath(FileDescriptor fd) noexcept
+{
+	return ReadLink(Path::FromFS(StringFormat<64>("/proc/self/fd/%d",
+						      fd.Get())));
+}
+
+[[gnu::pure]]
+static unsigned
+GetDepth(std::string_view relative_path) noexcept
+{
+	if (relative_path.empty())
+		return 0;
+
+	return 1 + std::count(relative_path.begin(), relative_path.end(), '/');
+}
+
+FanotifyUpdate::FanotifyUpdate(EventLoop &loop, UpdateService &update,
+			       unsigned _max_depth)
+	:fanotify_event(loop, *this),
+	 queue(loop, update),
+	 max_depth(_max_depth)
+{
+}
+
+FanotifyUpdate::~FanotifyUpdate() noexcept = default;
+
+inline void
+FanotifyUpdate::Start(Path path)
+{
+	root_fd = OpenPath(path.c_str(), O_DIRECTORY);
+
+	root_path = GetFileDescriptorPath(root_fd);
+	if (root_path.IsNull())
+		root_path = AllocatedPath{path};
+
+	fanotify_event.AddFilesystemMark(path.c_str(), FAN_MASK);
+}
+
+AllocatedPath
+FanotifyUpdate::ResolveDirectory(const struct file_handle &handle) const noexcept
+{
+	/* open_by_handle_at() wants a non-const pointer, but
+	   doesn't modify the handle */
+	UniqueFileDescriptor fd{open_by_handle_at(root_fd.Get(),
+						  const_cast<struct file_handle *>(&handle),
+						  O_PATH|O_CLOEXEC)};
+	if (!fd.IsDefined())
+		/* the directory has been deleted meanwhile
+		   (ESTALE); its parent receives its own event */
+		return nullptr;
+
+	const auto path = GetFileDescriptorPath(fd);
+	if (path.IsNull())
+		return nullptr;
+
+	const char *relative = root_path.Relative(path);
+	if (relative == nullptr)
+		/* somewhere else on the same filesystem */
+		return nullptr;
+
+	return AllocatedPath::FromFS(relative);
+}
+
+void
+FanotifyUpdate::OnFanotify(uint64_t mask,
+			   const struct file_handle *directory,
+			   std::string_view name)
+{
+	if (mask & FAN_Q_OVERFLOW) {
+		LogWarning(inotify_domain,
+			   "fanotify queue overflow, updating everything");
+		queue.Enqueue("");
+		return;
+	}
+
+	if (directory == nullptr || name == ".")
+		return;
+
+	const auto uri_fs = ResolveDirectory(*directory);
+	if (uri_fs.IsNull())
+		return;
+
+	/* ignore events beyond "auto_update_depth", just like
+	   InotifyUpdate which doesn't watch those directories */
+	const unsigned depth = GetDepth(uri_fs.c_str());
+	if (depth > max_depth)
+		return;
+
+	if ((mask & (FAN_CLOSE_WRITE|FAN_MOVED_FROM|FAN_MOVED_TO|FAN_DELETE)) != 0 ||
+	    /* at the maximum depth, we watch out for newly created
+	       directories */
+	    (depth == max_depth &&
+	     (mask & (FAN_CREATE|FAN_ONDIR)) == (FAN_CREATE|FAN_ONDIR))) {
+		/* a file was changed, or a directory was
+		   moved/deleted: queue a database update */
+
+		std::string uri_utf8;
+		if (depth > 0) {
+			uri_utf8 = uri_fs.ToUTF8();
+			if (uri_utf8.empty())
+				return;
+		}
+
+		const std::string name_utf8 =
+			Path::FromFS(std::string{name}.c_str()).ToUTF8();
+		if (!name_utf8.empty())
+			/* update only this entry */
+			queue.Enqueue(uri_utf8.c_str(), name_utf8.c_str());
+		else
+			queue.Enqueue(uri_utf8.c_str());
+	}
+}
+
+void
+FanotifyUpdate::OnFanotifyError(std::exception_ptr error) noexcept
+{
+	LogError(error, "fanotify error");
+}
+
+std::unique_ptr<FanotifyUpdate>
+mpd_fanotify_init(EventLoop &loop, Storage &storage, UpdateService &update,
+		  unsigned max_depth)
+{
+	LogDebug(inotify_domain, "initializing fanotify");
+
+	const auto path = storage.MapFS("");
+	if (path.IsNull()) {
+		LogDebug(inotify_domain, "no music directory configured");
+		return {};
+	}
+
+	auto fu = std::make_unique<FanotifyUpdate>(loop, update, max_depth);
+	fu->Start(path);
+
+	LogDebug(inotify_domain, "watching music directory with fanotify");
+
+	return fu;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_FANOTIFY_UPDATE_HXX
+#define MPD_FANOTIFY_UPDATE_HXX
+
+#include "InotifyQueue.hxx"
+#include "event/FanotifyEvent.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <memory>
+
+class Path;
+class Storage;
+
+/**
+ * Glue code between #FanotifyEvent and #InotifyQueue.  Unlike
+ * #InotifyUpdate, this watches the whole filesystem containing the
+ * music directory with one fanotify mark instead of adding one watch
+ * per directory, and filters out events outside of the music
+ * directory.  This requires CAP_SYS_ADMIN (for the mark) and
+ * CAP_DAC_READ_SEARCH (for resolving directory handles).
+ */
+class FanotifyUpdate final : FanotifyHandler {
+	FanotifyEvent fanotify_event;
+	InotifyQueue queue;
+
+	const unsigned max_depth;
+
+	/**
+	 * An O_PATH descriptor of the music directory, used to
+	 * resolve directory handles with open_by_handle_at().
+	 */
+	UniqueFileDescriptor root_fd;
+
+	/**
+	 * The canonical path of the music directory, i.e. the way
+	 * the kernel reports it in /proc/self/fd.
+	 */
+	AllocatedPath root_path = nullptr;
+
+public:
+	FanotifyUpdate(EventLoop &loop, UpdateService &update,
+		       unsigned _max_depth);
+	~FanotifyUpdate() noexcept;
+
+	/**
+	 * Throws on error.
+	 */
+	void Start(Path path);
+
+private:
+	/**
+	 * Determine the path of the given directory relative to the
+	 * music directory.  Returns nullptr if the directory does not
+	 * exist anymore or if it is outside of the music directory.
+	 */
+	AllocatedPath ResolveDirectory(const struct file_handle &handle) const noexcept;
+
+	/* virtual methods from class FanotifyHandler */
+	void OnFanotify(uint64_t mask,
+			const struct file_handle *directory,
+			std::string_view name) override;
+	void OnFanotifyError(std::exception_ptr error) noexcept override;
+};
+
+/**
+ * Throws on error, e.g. if fanotify is not available or if MPD
+ * lacks the required capabilities.  The caller may then fall back to
+ * mpd_inotify_init().
+ */
+std::unique_ptr<FanotifyUpdate>
+mpd_fanotify_init(EventLoop &loop, Storage &storage, UpdateService &update,
+		  unsigned max_depth);
+
+#endif
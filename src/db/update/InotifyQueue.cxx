@@ -34,17 +34,27 @@
 static constexpr Event::Duration INOTIFY_UPDATE_DELAY =
 	std::chrono::seconds(5);
 
+/**
+ * If more entries of one directory have changed, then the whole
+ * directory is updated instead.
+ */
+static constexpr std::size_t INOTIFY_MAX_NAMES = 64;
+
 void
 InotifyQueue::OnDelay() noexcept
 {
 	unsigned id;
 
 	while (!queue.empty()) {
-		const char *uri_utf8 = queue.front().c_str();
+		const auto &item = queue.front();
+		const char *uri_utf8 = item.uri.c_str();
 
 		try {
 			try {
-				id = update.Enqueue(uri_utf8, false);
+				id = update.Enqueue(uri_utf8,
+						    {item.names.begin(),
+						     item.names.end()},
+						    false);
 			} catch (const ProtocolError &e) {
 				if (e.GetCode() == ACK_ERROR_UPDATE_ALREADY) {
 					/* retry later */
@@ -62,8 +72,8 @@ InotifyQueue::OnDelay() noexcept
 			continue;
 		}
 
-		FmtDebug(inotify_domain, "updating '{}' job={}",
-			 uri_utf8, id);
+		FmtDebug(inotify_domain, "updating '{}' ({} entries) job={}",
+			 uri_utf8, item.names.size(), id);
 
 		queue.pop_front();
 	}
@@ -87,9 +97,9 @@ InotifyQueue::Enqueue(const char *uri_utf8) noexcept
 	delay_event.Schedule(INOTIFY_UPDATE_DELAY);
 
 	for (auto i = queue.begin(), end = queue.end(); i != end;) {
-		const char *current_uri = i->c_str();
+		const char *current_uri = i->uri.c_str();
 
-		if (path_in(uri_utf8, current_uri))
+		if (i->IsFull() && path_in(uri_utf8, current_uri))
 			/* already enqueued */
 			return;
 
@@ -104,3 +114,37 @@ InotifyQueue::Enqueue(const char *uri_utf8) noexcept
 
 	queue.emplace_back(uri_utf8);
 }
+
+void
+InotifyQueue::Enqueue(const char *directory_utf8, const char *name) noexcept
+{
+	for (auto i = queue.begin(), end = queue.end(); i != end; ++i) {
+		const char *current_uri = i->uri.c_str();
+
+		if (i->IsFull()) {
+			if (StringIsEmpty(directory_utf8)
+			    ? StringIsEmpty(current_uri)
+			    : path_in(directory_utf8, current_uri)) {
+				/* already enqueued */
+				delay_event.Schedule(INOTIFY_UPDATE_DELAY);
+				return;
+			}
+		} else if (i->uri == directory_utf8) {
+			i->names.emplace(name);
+
+			if (i->names.size() > INOTIFY_MAX_NAMES) {
+				/* too many: update the whole
+				   directory */
+				queue.erase(i);
+				Enqueue(directory_utf8);
+			} else
+				delay_event.Schedule(INOTIFY_UPDATE_DELAY);
+
+			return;
+		}
+	}
+
+	delay_event.Schedule(INOTIFY_UPDATE_DELAY);
+
+	queue.emplace_back(directory_utf8).names.emplace(name);
+}
@@ -23,6 +23,7 @@
 #include "event/CoarseTimerEvent.hxx"
 
 #include <list>
+#include <set>
 #include <string>
 
 class UpdateService;
@@ -30,7 +31,25 @@ class UpdateService;
 class InotifyQueue final {
 	UpdateService &update;
 
-	std::list<std::string> queue;
+	struct Item {
+		std::string uri;
+
+		/**
+		 * The entries of the directory #uri which have
+		 * changed.  If this is empty, then the whole directory
+		 * is updated.
+		 */
+		std::set<std::string, std::less<>> names;
+
+		explicit Item(const char *_uri) noexcept
+			:uri(_uri) {}
+
+		bool IsFull() const noexcept {
+			return names.empty();
+		}
+	};
+
+	std::list<Item> queue;
 
 	CoarseTimerEvent delay_event;
 
@@ -39,8 +58,18 @@ public:
 		:update(_update),
 		 delay_event(_loop, BIND_THIS_METHOD(OnDelay)) {}
 
+	/**
+	 * Update the whole directory (recursively).
+	 */
 	void Enqueue(const char *uri_utf8) noexcept;
 
+	/**
+	 * Update only one entry of the given directory.  If there are
+	 * too many of them, this falls back to updating the whole
+	 * directory.
+	 */
+	void Enqueue(const char *directory_utf8, const char *name) noexcept;
+
 private:
 	void OnDelay() noexcept;
 };
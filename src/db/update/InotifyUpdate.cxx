@@ -263,8 +263,16 @@ InotifyUpdate::Start(Path path)
 }
 
 void
-InotifyUpdate::OnInotify(int wd, unsigned mask, const char *)
+InotifyUpdate::OnInotify(int wd, unsigned mask, const char *name)
 {
+	if (mask & IN_Q_OVERFLOW) {
+		/* events were lost; we don't know what has changed */
+		LogWarning(inotify_domain,
+			   "inotify queue overflow, updating everything");
+		queue.Enqueue("");
+		return;
+	}
+
 	auto i = directories.find(wd);
 	if (i == directories.end())
 		return;
@@ -300,13 +308,22 @@ InotifyUpdate::OnInotify(int wd, unsigned mask, const char *)
 		/* a file was changed, or a directory was
 		   moved/deleted: queue a database update */
 
+		std::string uri_utf8;
 		if (!uri_fs.IsNull()) {
-			const std::string uri_utf8 = uri_fs.ToUTF8();
-			if (!uri_utf8.empty())
-				queue.Enqueue(uri_utf8.c_str());
+			uri_utf8 = uri_fs.ToUTF8();
+			if (uri_utf8.empty())
+				return;
 		}
+
+		const std::string name_utf8 = name != nullptr
+			? Path::FromFS(name).ToUTF8()
+			: std::string{};
+
+		if (!name_utf8.empty())
+			/* update only this entry */
+			queue.Enqueue(uri_utf8.c_str(), name_utf8.c_str());
 		else
-			queue.Enqueue("");
+			queue.Enqueue(uri_utf8.c_str());
 	}
 }
 
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_LOCK_STATS_HXX
+#define MPD_UPDATE_LOCK_STATS_HXX
+
+#include "db/DatabaseLock.hxx"
+
+#include <chrono>
+
+/**
+ * Statistics about the #db_mutex critical sections of one database
+ * update.
+ */
+class UpdateLockStats {
+	using Clock = std::chrono::steady_clock;
+
+	unsigned count = 0;
+
+	Clock::duration total = Clock::duration::zero();
+	Clock::duration longest = Clock::duration::zero();
+
+public:
+	class ScopeLock;
+
+	void Clear() noexcept {
+		*this = {};
+	}
+
+	void Add(Clock::duration d) noexcept {
+		++count;
+		total += d;
+		if (d > longest)
+			longest = d;
+	}
+
+	/**
+	 * Write the statistics to the log.
+	 */
+	void Log() const noexcept;
+};
+
+/**
+ * Like #ScopeDatabaseLock, but accounts the duration of the critical
+ * section in an #UpdateLockStats instance.
+ */
+class UpdateLockStats::ScopeLock : ScopeDatabaseLock {
+	UpdateLockStats &stats;
+
+	const Clock::time_point start = Clock::now();
+
+public:
+	explicit ScopeLock(UpdateLockStats &_stats) noexcept
+		:stats(_stats) {}
+
+	~ScopeLock() noexcept {
+		stats.Add(Clock::now() - start);
+	}
+
+	ScopeLock(const ScopeLock &) = delete;
+	ScopeLock &operator=(const ScopeLock &) = delete;
+};
+
+#endif
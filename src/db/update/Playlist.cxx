@@ -47,8 +47,7 @@ UpdateWalk::UpdatePlaylistFile(Directory &directory,
 		if (!song)
 			break;
 
-		auto db_song = std::make_unique<Song>(std::move(*song),
-						      directory);
+		auto db_song = Song::New(std::move(*song), directory);
 		const bool is_absolute =
 			PathTraitsUTF8::IsAbsoluteOrHasScheme(db_song->filename.c_str());
 		db_song->target = is_absolute
@@ -60,10 +59,7 @@ UpdateWalk::UpdatePlaylistFile(Directory &directory,
 		db_song->filename = StringFormat<64>("track%04u",
 						     ++track);
 
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(db_song));
-		}
+		AddNewSong(std::move(db_song));
 	}
 }
 
@@ -74,6 +70,9 @@ UpdateWalk::UpdatePlaylistFile(Directory &parent, std::string_view name,
 {
 	assert(plugin.open_stream);
 
+	if (CheckVirtualSkipCache(parent, name, info, DEVICE_PLAYLIST))
+		return;
+
 	Directory *directory =
 		LockMakeVirtualDirectoryIfModified(parent, name, info,
 						   DEVICE_PLAYLIST);
@@ -91,19 +90,23 @@ UpdateWalk::UpdatePlaylistFile(Directory &parent, std::string_view name,
 								   mutex));
 		if (!e) {
 			/* unsupported URI? roll back.. */
-			editor.LockDeleteDirectory(directory);
+			LockDeleteDirectory(directory);
 			return;
 		}
 
 		UpdatePlaylistFile(*directory, *e);
 
+		/* the songs may still be pending in #new_songs;
+		   add them now, or IsEmpty() would be wrong */
+		FlushNewSongs();
+
 		if (directory->IsEmpty())
-			editor.LockDeleteDirectory(directory);
+			LockDeleteDirectory(directory);
 	} catch (...) {
 		FmtError(update_domain,
 			 "Failed to scan playlist '{}': {}",
 			 uri_utf8, std::current_exception());
-		editor.LockDeleteDirectory(directory);
+		LockDeleteDirectory(directory);
 	}
 }
 
@@ -121,7 +124,7 @@ UpdateWalk::UpdatePlaylistFile(Directory &directory,
 
 	PlaylistInfo pi(name, info.mtime);
 
-	const ScopeDatabaseLock protect;
+	const UpdateLockStats::ScopeLock protect{lock_stats};
 	if (directory.playlists.UpdateOrInsert(std::move(pi)))
 		modified = true;
 
@@ -21,12 +21,14 @@
 
 bool
 UpdateQueue::Push(SimpleDatabase &db, Storage &storage,
-		  std::string_view path, bool discard, unsigned id) noexcept
+		  std::string_view path, std::vector<std::string> &&names,
+		  bool discard, unsigned id) noexcept
 {
 	if (update_queue.size() >= MAX_UPDATE_QUEUE_SIZE)
 		return false;
 
-	update_queue.emplace_back(db, storage, path, discard, id);
+	update_queue.emplace_back(db, storage, path, std::move(names),
+				  discard, id);
 	return true;
 }
 
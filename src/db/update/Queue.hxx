@@ -23,6 +23,7 @@
 #include <string>
 #include <string_view>
 #include <list>
+#include <vector>
 
 class SimpleDatabase;
 class Storage;
@@ -32,6 +33,13 @@ struct UpdateQueueItem {
 	Storage *storage;
 
 	std::string path_utf8;
+
+	/**
+	 * If not empty, then only these entries of the directory
+	 * #path_utf8 are updated instead of the whole directory.
+	 */
+	std::vector<std::string> names;
+
 	unsigned id;
 	bool discard;
 
@@ -39,9 +47,12 @@ struct UpdateQueueItem {
 
 	UpdateQueueItem(SimpleDatabase &_db,
 			Storage &_storage,
-			std::string_view _path, bool _discard,
+			std::string_view _path,
+			std::vector<std::string> &&_names,
+			bool _discard,
 			unsigned _id) noexcept
 		:db(&_db), storage(&_storage), path_utf8(_path),
+		 names(std::move(_names)),
 		 id(_id), discard(_discard) {}
 
 	bool IsDefined() const noexcept {
@@ -60,7 +71,8 @@ class UpdateQueue {
 
 public:
 	bool Push(SimpleDatabase &db, Storage &storage,
-		  std::string_view path, bool discard, unsigned id) noexcept;
+		  std::string_view path, std::vector<std::string> &&names,
+		  bool discard, unsigned id) noexcept;
 
 	UpdateQueueItem Pop() noexcept;
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ScanPool.hxx"
+#include "db/plugins/simple/Song.hxx"
+
+#include <cassert>
+
+void
+UpdateScanJob::Scan(Storage &storage, bool all_tags) noexcept
+{
+	try {
+		result = Song::LoadFile(storage, name.c_str(), directory,
+					all_tags);
+	} catch (...) {
+		error = std::current_exception();
+	}
+}
+
+void
+UpdateScanJob::Run() noexcept
+{
+	Scan(pool->storage, pool->all_tags);
+}
+
+void
+UpdateScanJob::OnTagScanDone() noexcept
+{
+	pool->OnJobDone(*this);
+}
+
+UpdateScanPool::UpdateScanPool(TagScanPool &_tag_scan_pool,
+			       Storage &_storage,
+			       unsigned n_threads, bool _all_tags) noexcept
+	:tag_scan_pool(_tag_scan_pool), storage(_storage),
+	 all_tags(_all_tags)
+{
+	tag_scan_pool.SetMinThreads(n_threads);
+}
+
+UpdateScanPool::~UpdateScanPool() noexcept
+{
+	/* withdraw all jobs from the TagScanPool; those which are
+	   already running are waited for, and will then be moved to
+	   "finished" by OnJobDone() */
+	std::unique_lock lock{mutex};
+	while (!submitted.empty()) {
+		auto &job = submitted.front();
+
+		lock.unlock();
+		const bool cancelled = tag_scan_pool.Cancel(job);
+		lock.lock();
+
+		if (cancelled)
+			submitted.erase(submitted.iterator_to(job));
+	}
+
+	finished.clear_and_dispose(std::default_delete<UpdateScanJob>{});
+}
+
+void
+UpdateScanPool::Submit(std::unique_ptr<UpdateScanJob> job) noexcept
+{
+	job->pool = this;
+
+	{
+		const std::scoped_lock lock{mutex};
+		submitted.push_back(*job);
+	}
+
+	try {
+		tag_scan_pool.Submit(*job, TagScanPriority::BULK);
+		job.release();
+		return;
+	} catch (...) {
+		/* no thread could be launched; do it right here */
+	}
+
+	job->Scan(storage, all_tags);
+
+	const std::scoped_lock lock{mutex};
+	submitted.erase(submitted.iterator_to(*job));
+	finished.push_back(*job.release());
+}
+
+UpdateScanJobList
+UpdateScanPool::Collect() noexcept
+{
+	std::unique_lock lock{mutex};
+	finished_cond.wait(lock, [this]{
+		return submitted.empty();
+	});
+
+	UpdateScanJobList result;
+	swap(result, finished);
+	return result;
+}
+
+void
+UpdateScanPool::OnJobDone(UpdateScanJob &job) noexcept
+{
+	/* note: the jobs may complete out of order; Collect()
+	   doesn't care, because the update thread merges them only
+	   after all have been finished */
+
+	const std::scoped_lock lock{mutex};
+	submitted.erase(submitted.iterator_to(job));
+	finished.push_back(job);
+
+	if (submitted.empty())
+		finished_cond.notify_one();
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SCAN_POOL_HXX
+#define MPD_UPDATE_SCAN_POOL_HXX
+
+#include "db/plugins/simple/Ptr.hxx"
+#include "TagScanPool.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <exception>
+#include <memory>
+#include <string>
+
+struct Directory;
+struct Song;
+class Storage;
+class UpdateScanPool;
+
+/**
+ * A request to scan the tags of one song file, submitted to an
+ * #UpdateScanPool.
+ */
+struct UpdateScanJob : IntrusiveListHook<>, TagScanTask {
+	Directory &directory;
+
+	/**
+	 * The name of the file within #directory.
+	 */
+	const std::string name;
+
+	/**
+	 * The existing #Song object which shall be updated, or
+	 * nullptr if this is a new file.  It must not be removed
+	 * from the tree until the job has been collected.
+	 */
+	Song *const song;
+
+	/**
+	 * The result; nullptr if the file was not recognized.
+	 */
+	SongPtr result;
+
+	/**
+	 * Set if scanning has failed with an exception.
+	 */
+	std::exception_ptr error;
+
+	/**
+	 * The pool this job was submitted to.
+	 */
+	UpdateScanPool *pool = nullptr;
+
+	UpdateScanJob(Directory &_directory, std::string_view _name,
+		      Song *_song) noexcept
+		:directory(_directory), name(_name), song(_song) {}
+
+	/**
+	 * Scan the file and store the result in this object.
+	 *
+	 * @param all_tags see UpdateConfig::all_tags
+	 */
+	void Scan(Storage &storage, bool all_tags) noexcept;
+
+protected:
+	/* virtual methods from class TagScanTask */
+	void Run() noexcept override;
+	void OnTagScanDone() noexcept override;
+};
+
+using UpdateScanJobList = IntrusiveList<UpdateScanJob>;
+
+/**
+ * Submits the tag scanning of song files to the daemon's shared
+ * #TagScanPool on behalf of the update thread.  This hides the
+ * latency of remote or slow storages.  The jobs have
+ * TagScanPriority::BULK, i.e. client requests are preferred.  The
+ * pool never touches the database tree; the update thread merges the
+ * results after calling Collect().
+ */
+class UpdateScanPool {
+	friend struct UpdateScanJob;
+
+	TagScanPool &tag_scan_pool;
+
+	Storage &storage;
+
+	/**
+	 * Copy of UpdateConfig::all_tags.
+	 */
+	const bool all_tags;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled by OnJobDone() when the last submitted job has
+	 * been finished.
+	 */
+	Cond finished_cond;
+
+	/**
+	 * Jobs which were submitted to the #TagScanPool and are not
+	 * yet finished.
+	 */
+	UpdateScanJobList submitted;
+
+	UpdateScanJobList finished;
+
+public:
+	/**
+	 * @param n_threads the minimum number of #TagScanPool
+	 * threads
+	 * @param _all_tags see UpdateConfig::all_tags
+	 */
+	UpdateScanPool(TagScanPool &_tag_scan_pool, Storage &_storage,
+		       unsigned n_threads, bool _all_tags) noexcept;
+
+	~UpdateScanPool() noexcept;
+
+	UpdateScanPool(const UpdateScanPool &) = delete;
+	UpdateScanPool &operator=(const UpdateScanPool &) = delete;
+
+	/**
+	 * Submit a new job.  The pool takes ownership until
+	 * Collect() returns it.
+	 */
+	void Submit(std::unique_ptr<UpdateScanJob> job) noexcept;
+
+	/**
+	 * Wait until all submitted jobs have been finished and
+	 * return them (in no particular order).  The caller takes
+	 * ownership of all list items.
+	 */
+	UpdateScanJobList Collect() noexcept;
+
+private:
+	/**
+	 * Called by UpdateScanJob::OnTagScanDone().
+	 */
+	void OnJobDone(UpdateScanJob &job) noexcept;
+};
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "Service.hxx"
 #include "Walk.hxx"
+#include "SkipCache.hxx"
 #include "UpdateDomain.hxx"
 #include "db/DatabaseListener.hxx"
 #include "db/DatabaseLock.hxx"
@@ -26,11 +27,13 @@
 #include "db/plugins/simple/Directory.hxx"
 #include "storage/CompositeStorage.hxx"
 #include "protocol/Ack.hxx"
+#include "tag/Settings.hxx"
 #include "Idle.hxx"
 #include "Log.hxx"
 #include "thread/Thread.hxx"
 #include "thread/Name.hxx"
 #include "thread/Util.hxx"
+#include "thread/Profile.hxx"
 
 #ifndef NDEBUG
 #include "event/Loop.hxx"
@@ -41,11 +44,13 @@
 UpdateService::UpdateService(const ConfigData &_config,
 			     EventLoop &_loop, SimpleDatabase &_db,
 			     CompositeStorage &_storage,
-			     DatabaseListener &_listener) noexcept
+			     DatabaseListener &_listener,
+			     TagScanPool *_tag_scan_pool) noexcept
 	:config(_config),
 	 defer(_loop, BIND_THIS_METHOD(RunDeferred)),
 	 db(_db), storage(_storage),
 	 listener(_listener),
+	 tag_scan_pool(_tag_scan_pool),
 	 update_thread(BIND_THIS_METHOD(Task))
 {
 }
@@ -72,6 +77,12 @@ UpdateService::CancelAllAsync() noexcept
 void
 UpdateService::CancelMount(const char *uri) noexcept
 {
+	if (suspended)
+		/* the database has not been loaded yet, so there
+		   are no mounted databases (they are mounted after
+		   loading), and all queued jobs refer to the root */
+		return;
+
 	/* determine which (mounted) database will be updated and what
 	   storage will be scanned */
 
@@ -105,6 +116,25 @@ UpdateService::CancelMount(const char *uri) noexcept
 	}
 }
 
+UpdateSkipCache *
+UpdateService::GetSkipCache() noexcept
+{
+	if (!config.skip_cache || next.db != &db)
+		return nullptr;
+
+	if (skip_cache == nullptr) {
+		const auto db_path = db.GetPath();
+		if (db_path.IsNull())
+			return nullptr;
+
+		skip_cache = std::make_unique<UpdateSkipCache>(AllocatedPath::Concat(db_path.c_str(),
+										     PATH_LITERAL(".skip")));
+		skip_cache->Load();
+	}
+
+	return skip_cache.get();
+}
+
 inline void
 UpdateService::Task() noexcept
 {
@@ -117,10 +147,39 @@ UpdateService::Task() noexcept
 	else
 		LogDebug(update_domain, "starting");
 
-	SetThreadIdlePriority();
+	try {
+		if (!ApplyThreadProfile(ThreadProfileType::UPDATE))
+			SetThreadIdlePriority();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to apply the update thread profile");
+	}
+
+	next.db->BeginUpdate();
+
+	auto *const skip = GetSkipCache();
 
 	modified = walk->Walk(next.db->GetRoot(), next.path_utf8.c_str(),
-			      next.discard);
+			      next.names, next.discard, skip);
+
+	if (modified)
+		next.db->UpdateStoredTags(config.all_tags
+					  ? TagMask::All()
+					  : global_tag_mask,
+					  next.discard &&
+					  next.path_utf8.empty() &&
+					  next.names.empty() &&
+					  !walk->IsCancelled());
+
+	if (skip != nullptr) {
+		if (next.path_utf8.empty() && next.names.empty() &&
+		    !walk->IsCancelled())
+			/* after a full update, forget all files which
+			   have disappeared */
+			skip->Prune();
+
+		skip->Save();
+	}
 
 	if (modified || !next.db->FileExists()) {
 		try {
@@ -131,6 +190,8 @@ UpdateService::Task() noexcept
 		}
 	}
 
+	next.db->EndUpdate();
+
 	if (!next.path_utf8.empty())
 		FmtDebug(update_domain, "finished: {}", next.path_utf8);
 	else
@@ -149,7 +210,7 @@ UpdateService::StartThread(UpdateQueueItem &&i)
 
 	next = std::move(i);
 	walk = std::make_unique<UpdateWalk>(config, GetEventLoop(), listener,
-					    *next.storage);
+					    *next.storage, tag_scan_pool);
 
 	update_thread.Start();
 
@@ -167,7 +228,8 @@ UpdateService::GenerateId() noexcept
 }
 
 unsigned
-UpdateService::Enqueue(std::string_view path, bool discard)
+UpdateService::Enqueue(std::string_view path,
+		       std::vector<std::string> &&names, bool discard)
 {
 	assert(GetEventLoop().IsInside());
 
@@ -177,12 +239,16 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 	Storage *storage2;
 
 	Directory::LookupResult lr;
-	{
+	if (suspended) {
+		/* the database is being loaded and must not be
+		   accessed; there are no mounted databases yet */
+		lr.directory = nullptr;
+	} else {
 		const ScopeDatabaseLock protect;
 		lr = db.GetRoot().LookupDirectory(path);
 	}
 
-	if (lr.directory->IsMount()) {
+	if (lr.directory != nullptr && lr.directory->IsMount()) {
 		/* follow the mountpoint, update the mounted
 		   database */
 
@@ -209,9 +275,10 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 		   happen */
 		throw std::runtime_error("No storage at this path");
 
-	if (walk != nullptr) {
+	if (walk != nullptr || suspended) {
 		const unsigned id = GenerateId();
-		if (!queue.Push(*db2, *storage2, path, discard, id))
+		if (!queue.Push(*db2, *storage2, path, std::move(names),
+				discard, id))
 			throw ProtocolError(ACK_ERROR_UPDATE_ALREADY,
 					    "Update queue is full");
 
@@ -220,13 +287,30 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 	}
 
 	const unsigned id = update_task_id = GenerateId();
-	StartThread(UpdateQueueItem(*db2, *storage2, path, discard, id));
+	StartThread(UpdateQueueItem(*db2, *storage2, path, std::move(names),
+				    discard, id));
 
 	idle_add(IDLE_UPDATE);
 
 	return id;
 }
 
+void
+UpdateService::Resume() noexcept
+{
+	assert(GetEventLoop().IsInside());
+	assert(suspended);
+	assert(walk == nullptr);
+
+	suspended = false;
+
+	auto i = queue.Pop();
+	if (i.IsDefined()) {
+		StartThread(std::move(i));
+		idle_add(IDLE_UPDATE);
+	}
+}
+
 /**
  * Called in the main thread after the database update is finished.
  */
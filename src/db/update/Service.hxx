@@ -26,12 +26,16 @@
 #include "thread/Thread.hxx"
 
 #include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 
 class SimpleDatabase;
 class DatabaseListener;
 class UpdateWalk;
+class UpdateSkipCache;
 class CompositeStorage;
+class TagScanPool;
 
 /**
  * This class manages the update queue and runs the update thread.
@@ -46,8 +50,21 @@ class UpdateService final {
 
 	DatabaseListener &listener;
 
+	/**
+	 * The shared pool which scans song files if "update_threads"
+	 * is larger than 1; may be nullptr.
+	 */
+	TagScanPool *const tag_scan_pool;
+
 	bool modified;
 
+	/**
+	 * If set, then the database is still being loaded (see
+	 * #DatabaseLoader) and must not be accessed.  New jobs are
+	 * queued, but not started before Resume() is called.
+	 */
+	bool suspended = false;
+
 	Thread update_thread;
 
 	static constexpr unsigned update_task_id_max = 1 << 15;
@@ -60,11 +77,19 @@ class UpdateService final {
 
 	std::unique_ptr<UpdateWalk> walk;
 
+	/**
+	 * The #UpdateSkipCache for the main database (if enabled).
+	 * It is created and loaded by the update thread on first use
+	 * and only accessed from there.
+	 */
+	std::unique_ptr<UpdateSkipCache> skip_cache;
+
 public:
 	UpdateService(const ConfigData &_config,
 		      EventLoop &_loop, SimpleDatabase &_db,
 		      CompositeStorage &_storage,
-		      DatabaseListener &_listener) noexcept;
+		      DatabaseListener &_listener,
+		      TagScanPool *_tag_scan_pool) noexcept;
 
 	~UpdateService() noexcept;
 
@@ -89,7 +114,36 @@ public:
 	 * the whole music directory is updated
 	 * @return the job id
 	 */
-	unsigned Enqueue(std::string_view path, bool discard);
+	unsigned Enqueue(std::string_view path, bool discard) {
+		return Enqueue(path, {}, discard);
+	}
+
+	/**
+	 * Like Enqueue(std::string_view, bool), but update only the
+	 * specified entries of the directory #path (e.g. files
+	 * reported by inotify) instead of walking all of it.  An
+	 * empty list updates the whole directory.
+	 *
+	 * Throws on error
+	 */
+	unsigned Enqueue(std::string_view path,
+			 std::vector<std::string> &&names, bool discard);
+
+	/**
+	 * Do not start update jobs until Resume() is called.  Must
+	 * be called before the first Enqueue() call.
+	 */
+	void Suspend() noexcept {
+		assert(next.id == 0);
+
+		suspended = true;
+	}
+
+	/**
+	 * The database has been loaded: start the first queued job
+	 * (if any).
+	 */
+	void Resume() noexcept;
 
 	/**
 	 * Clear the queue and cancel the current update.  Does not
@@ -111,6 +165,13 @@ private:
 	/* the update thread */
 	void Task() noexcept;
 
+	/**
+	 * Returns the #UpdateSkipCache to be used for the current
+	 * update (#next), or nullptr if there is none.  Must be
+	 * called in the update thread.
+	 */
+	UpdateSkipCache *GetSkipCache() noexcept;
+
 	void StartThread(UpdateQueueItem &&i);
 
 	unsigned GenerateId() noexcept;
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SkipCache.hxx"
+#include "UpdateDomain.hxx"
+#include "storage/FileInfo.hxx"
+#include "io/FileReader.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+#include "fs/FileSystem.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringAPI.hxx"
+#include "Log.hxx"
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+/* version 1 hashed only the beginning and the end of each file */
+static constexpr char SKIP_CACHE_HEADER[] = "mpd_skip_cache 2";
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static constexpr uint64_t
+FnvUpdate(uint64_t hash, std::span<const std::byte> src) noexcept
+{
+	for (std::byte b : src)
+		hash = (hash ^ static_cast<uint64_t>(b)) * FNV_PRIME;
+	return hash;
+}
+
+static uint64_t
+HashFile(FileReader &reader)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	std::array<std::byte, 65536> buffer;
+	std::size_t n;
+	while ((n = reader.Read(buffer.data(), buffer.size())) > 0)
+		hash = FnvUpdate(hash, std::span{buffer}.first(n));
+
+	return hash;
+}
+
+UpdateSkipCache::Fingerprint
+UpdateSkipCache::Calculate(Path path_fs, const StorageFileInfo &info)
+{
+	FileReader reader(path_fs);
+
+	const uint64_t size = reader.GetSize();
+
+	/* tags may be stored anywhere in the file (e.g. the "moov"
+	   atom of MP4 files, or a large ID3v2 tag with embedded
+	   pictures), so hashing only some regions would miss
+	   edits */
+	return {size, info.inode, HashFile(reader)};
+}
+
+bool
+UpdateSkipCache::Check(std::string_view uri,
+		       const Fingerprint &fingerprint) noexcept
+{
+	auto i = entries.find(uri);
+	if (i == entries.end())
+		return false;
+
+	i->second.seen = true;
+	return i->second.fingerprint == fingerprint;
+}
+
+void
+UpdateSkipCache::Touch(std::string_view uri) noexcept
+{
+	auto i = entries.find(uri);
+	if (i != entries.end())
+		i->second.seen = true;
+}
+
+void
+UpdateSkipCache::Put(std::string_view uri,
+		     const Fingerprint &fingerprint) noexcept
+{
+	auto [i, inserted] = entries.try_emplace(std::string{uri});
+	if (!inserted && i->second.fingerprint == fingerprint) {
+		i->second.seen = true;
+		return;
+	}
+
+	i->second = {fingerprint, true};
+	dirty = true;
+}
+
+void
+UpdateSkipCache::Prune() noexcept
+{
+	for (auto i = entries.begin(); i != entries.end();) {
+		if (!i->second.seen) {
+			i = entries.erase(i);
+			dirty = true;
+		} else {
+			i->second.seen = false;
+			++i;
+		}
+	}
+}
+
+/**
+ * Parse one line in the form "SIZE INODE HASH URI" (all numbers
+ * hexadecimal).
+ */
+static bool
+ParseLine(char *line, UpdateSkipCache::Fingerprint &fingerprint,
+	  const char *&uri) noexcept
+{
+	char *endptr;
+
+	fingerprint.size = ParseUint64(line, &endptr, 16);
+	if (endptr == line || *endptr != ' ')
+		return false;
+
+	line = endptr + 1;
+	fingerprint.inode = ParseUint64(line, &endptr, 16);
+	if (endptr == line || *endptr != ' ')
+		return false;
+
+	line = endptr + 1;
+	fingerprint.hash = ParseUint64(line, &endptr, 16);
+	if (endptr == line || *endptr != ' ' || endptr[1] == 0)
+		return false;
+
+	uri = endptr + 1;
+	return true;
+}
+
+void
+UpdateSkipCache::Load() noexcept
+try {
+	if (!FileExists(path))
+		return;
+
+	TextFile file(path);
+
+	const char *line = file.ReadLine();
+	if (line == nullptr || !StringIsEqual(line, SKIP_CACHE_HEADER)) {
+		FmtWarning(update_domain, "Ignoring malformed skip cache {}",
+			   path);
+		return;
+	}
+
+	char *p;
+	while ((p = file.ReadLine()) != nullptr) {
+		Fingerprint fingerprint;
+		const char *uri;
+		if (!ParseLine(p, fingerprint, uri)) {
+			FmtWarning(update_domain,
+				   "Malformed line in skip cache {}", path);
+			entries.clear();
+			return;
+		}
+
+		entries.insert_or_assign(uri, Entry{fingerprint, false});
+	}
+
+	dirty = false;
+} catch (...) {
+	LogError(std::current_exception(), "Failed to load skip cache");
+	entries.clear();
+}
+
+void
+UpdateSkipCache::Save() noexcept
+try {
+	if (!dirty)
+		return;
+
+	FileOutputStream fos(path);
+	BufferedOutputStream bos(fos);
+
+	bos.Write(SKIP_CACHE_HEADER);
+	bos.Write('\n');
+
+	for (const auto &[uri, entry] : entries)
+		bos.Fmt("{:x} {:x} {:x} {}\n",
+			entry.fingerprint.size, entry.fingerprint.inode,
+			entry.fingerprint.hash, uri);
+
+	bos.Flush();
+	fos.Commit();
+
+	dirty = false;
+} catch (...) {
+	LogError(std::current_exception(), "Failed to save skip cache");
+}
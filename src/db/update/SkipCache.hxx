@@ -0,0 +1,115 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SKIP_CACHE_HXX
+#define MPD_UPDATE_SKIP_CACHE_HXX
+
+#include "fs/AllocatedPath.hxx"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+class Path;
+struct StorageFileInfo;
+
+/**
+ * A persistent table of file fingerprints.  It allows the update
+ * thread to skip the tag scan of a file whose modification time has
+ * changed, but whose contents have not.
+ */
+class UpdateSkipCache {
+public:
+	struct Fingerprint {
+		uint64_t size, inode;
+
+		/**
+		 * A (non-cryptographic) hash of the whole file.
+		 */
+		uint64_t hash;
+
+		constexpr bool operator==(const Fingerprint &) const noexcept = default;
+	};
+
+private:
+	struct Entry {
+		Fingerprint fingerprint;
+
+		/**
+		 * Was this file seen by the current update?  Entries
+		 * which were not seen by a full update are removed by
+		 * Prune().
+		 */
+		bool seen;
+	};
+
+	const AllocatedPath path;
+
+	std::map<std::string, Entry, std::less<>> entries;
+
+	bool dirty = false;
+
+public:
+	explicit UpdateSkipCache(AllocatedPath &&_path) noexcept
+		:path(std::move(_path)) {}
+
+	/**
+	 * Load the table from the file.  Errors are logged.
+	 */
+	void Load() noexcept;
+
+	/**
+	 * Save the table to the file if it was modified.  Errors are
+	 * logged.
+	 */
+	void Save() noexcept;
+
+	/**
+	 * Calculate the fingerprint of a local file.  This reads
+	 * the whole file.
+	 *
+	 * Throws on error.
+	 */
+	static Fingerprint Calculate(Path path_fs,
+				     const StorageFileInfo &info);
+
+	/**
+	 * Mark the entry for the given URI as "seen" and check
+	 * whether it matches the given fingerprint.
+	 */
+	bool Check(std::string_view uri,
+		   const Fingerprint &fingerprint) noexcept;
+
+	/**
+	 * Mark the entry for the given URI as "seen" (if one exists).
+	 */
+	void Touch(std::string_view uri) noexcept;
+
+	void Put(std::string_view uri,
+		 const Fingerprint &fingerprint) noexcept;
+
+	/**
+	 * Remove all entries which have not been seen since the last
+	 * Prune() call.  Call this after a full update.
+	 */
+	void Prune() noexcept;
+};
+
+#endif
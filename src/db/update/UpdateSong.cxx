@@ -18,6 +18,8 @@
  */
 
 #include "Walk.hxx"
+#include "ScanPool.hxx"
+#include "SkipCache.hxx"
 #include "UpdateIO.hxx"
 #include "UpdateDomain.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
@@ -25,11 +27,57 @@
 #include "db/plugins/simple/Directory.hxx"
 #include "db/plugins/simple/Song.hxx"
 #include "decoder/DecoderList.hxx"
+#include "storage/StorageInterface.hxx"
 #include "storage/FileInfo.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Traits.hxx"
 #include "Log.hxx"
 
+#include <cassert>
+
 #include <unistd.h>
 
+inline bool
+UpdateWalk::CheckSkipCache(Directory &directory, const char *name,
+			   const StorageFileInfo &info, Song *song) noexcept
+{
+	assert(skip_cache != nullptr);
+
+	const auto uri = PathTraitsUTF8::Build(directory.GetPath(), name);
+
+	if (song != nullptr && info.mtime == song->mtime && !walk_discard) {
+		/* not modified; only mark it as "seen" */
+		skip_cache->Touch(uri);
+		return false;
+	}
+
+	const auto path_fs = storage.MapFS(uri.c_str());
+	if (path_fs.IsNull())
+		/* not a local file */
+		return false;
+
+	UpdateSkipCache::Fingerprint fingerprint;
+	try {
+		fingerprint = UpdateSkipCache::Calculate(path_fs, info);
+	} catch (...) {
+		LogError(std::current_exception());
+		return false;
+	}
+
+	if (song != nullptr && !walk_discard &&
+	    skip_cache->Check(uri, fingerprint)) {
+		FmtDebug(update_domain, "skipping unchanged file {}", uri);
+
+		const UpdateLockStats::ScopeLock protect{lock_stats};
+		song->mtime = info.mtime;
+		modified = true;
+		return true;
+	}
+
+	skip_cache->Put(uri, fingerprint);
+	return false;
+}
+
 inline void
 UpdateWalk::UpdateSongFile2(Directory &directory,
 			    const char *name, std::string_view suffix,
@@ -37,7 +85,7 @@ UpdateWalk::UpdateSongFile2(Directory &directory,
 try {
 	Song *song;
 	{
-		const ScopeDatabaseLock protect;
+		const UpdateLockStats::ScopeLock protect{lock_stats};
 		song = directory.FindSong(name);
 	}
 
@@ -46,7 +94,7 @@ try {
 			 "no read permissions on {}/{}",
 			 directory.GetPath(), name);
 		if (song != nullptr)
-			editor.LockDeleteSong(directory, song);
+			LockDeleteSong(directory, song);
 
 		return;
 	}
@@ -54,8 +102,23 @@ try {
 	if (!(song != nullptr && info.mtime == song->mtime && !walk_discard) &&
 	    UpdateContainerFile(directory, name, suffix, info)) {
 		if (song != nullptr)
-			editor.LockDeleteSong(directory, song);
+			LockDeleteSong(directory, song);
+
+		return;
+	}
 
+	if (skip_cache != nullptr &&
+	    CheckSkipCache(directory, name, info, song))
+		return;
+
+	if (scan_pool != nullptr) {
+		/* let the thread pool do the (slow) tag scanning; the
+		   result will be merged by CollectScanJobs() */
+		if (song == nullptr || info.mtime != song->mtime ||
+		    walk_discard)
+			scan_pool->Submit(std::make_unique<UpdateScanJob>(directory,
+									  name,
+									  song));
 		return;
 	}
 
@@ -63,7 +126,8 @@ try {
 		FmtDebug(update_domain, "reading {}/{}",
 			 directory.GetPath(), name);
 
-		auto new_song = Song::LoadFile(storage, name, directory);
+		auto new_song = Song::LoadFile(storage, name, directory,
+					       config.all_tags);
 		if (!new_song) {
 			FmtDebug(update_domain,
 				 "ignoring unrecognized file {}/{}",
@@ -71,10 +135,7 @@ try {
 			return;
 		}
 
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(new_song));
-		}
+		AddNewSong(std::move(new_song));
 
 		modified = true;
 		FmtNotice(update_domain, "added {}/{}",
@@ -82,11 +143,11 @@ try {
 	} else if (info.mtime != song->mtime || walk_discard) {
 		FmtNotice(update_domain, "updating {}/{}",
 			  directory.GetPath(), name);
-		if (!song->UpdateFile(storage)) {
+		if (!song->UpdateFile(storage, config.all_tags)) {
 			FmtDebug(update_domain,
 				 "deleting unrecognized file {}/{}",
 				 directory.GetPath(), name);
-			editor.LockDeleteSong(directory, song);
+			LockDeleteSong(directory, song);
 		}
 
 		modified = true;
@@ -97,6 +158,66 @@ try {
 		 directory.GetPath(), name, std::current_exception());
 }
 
+inline void
+UpdateWalk::MergeScanJob(UpdateScanJob &job) noexcept
+{
+	Directory &directory = job.directory;
+
+	if (job.error) {
+		FmtError(update_domain,
+			 "error reading file {}/{}: {}",
+			 directory.GetPath(), job.name, job.error);
+		return;
+	}
+
+	if (job.song == nullptr) {
+		if (!job.result) {
+			FmtDebug(update_domain,
+				 "ignoring unrecognized file {}/{}",
+				 directory.GetPath(), job.name);
+			return;
+		}
+
+		directory.AddSong(std::move(job.result));
+
+		modified = true;
+		FmtNotice(update_domain, "added {}/{}",
+			  directory.GetPath(), job.name);
+	} else {
+		FmtNotice(update_domain, "updating {}/{}",
+			  directory.GetPath(), job.name);
+
+		Song &song = *job.song;
+		if (job.result)
+			song.MoveScannedFrom(std::move(*job.result));
+		else {
+			FmtDebug(update_domain,
+				 "deleting unrecognized file {}/{}",
+				 directory.GetPath(), job.name);
+			editor.DeleteSong(directory, &song);
+		}
+
+		modified = true;
+	}
+}
+
+void
+UpdateWalk::CollectScanJobs() noexcept
+{
+	if (scan_pool == nullptr)
+		return;
+
+	auto jobs = scan_pool->Collect();
+	if (jobs.empty())
+		return;
+
+	const UpdateLockStats::ScopeLock protect{lock_stats};
+	jobs.clear_and_dispose([this](UpdateScanJob *job){
+		MergeScanJob(*job);
+		delete job;
+	});
+}
+
 bool
 UpdateWalk::UpdateSongFile(Directory &directory,
 			   const char *name, std::string_view suffix,
@@ -18,9 +18,16 @@
  */
 
 #include "Walk.hxx"
+#include "SkipCache.hxx"
+#include "UpdateDomain.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "storage/StorageInterface.hxx"
 #include "storage/FileInfo.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Traits.hxx"
+#include "Log.hxx"
 
 Directory *
 UpdateWalk::MakeVirtualDirectoryIfModified(Directory &parent, std::string_view name,
@@ -57,7 +64,68 @@ UpdateWalk::LockMakeVirtualDirectoryIfModified(Directory &parent,
 					       const StorageFileInfo &info,
 					       unsigned virtual_device) noexcept
 {
-	const ScopeDatabaseLock protect;
+	const UpdateLockStats::ScopeLock protect{lock_stats};
 	return MakeVirtualDirectoryIfModified(parent, name,
 					      info, virtual_device);
 }
+
+bool
+UpdateWalk::CheckVirtualSkipCache(Directory &parent, std::string_view name,
+				  const StorageFileInfo &info,
+				  unsigned virtual_device) noexcept
+{
+	if (skip_cache == nullptr)
+		return false;
+
+	Directory *directory;
+	{
+		const UpdateLockStats::ScopeLock protect{lock_stats};
+		directory = parent.FindChild(name);
+		if (directory != nullptr &&
+		    (directory->IsMount() ||
+		     directory->device != virtual_device))
+			directory = nullptr;
+	}
+
+	const auto uri = PathTraitsUTF8::Build(parent.GetPath(), name);
+
+	if (directory != nullptr && directory->mtime == info.mtime &&
+	    !walk_discard) {
+		/* not modified; only mark it as "seen" */
+		skip_cache->Touch(uri);
+		return false;
+	}
+
+	const auto path_fs = storage.MapFS(uri.c_str());
+	if (path_fs.IsNull())
+		/* not a local file */
+		return false;
+
+	UpdateSkipCache::Fingerprint fingerprint;
+	try {
+		fingerprint = UpdateSkipCache::Calculate(path_fs, info);
+	} catch (...) {
+		LogError(std::current_exception());
+		return false;
+	}
+
+	if (directory != nullptr && !walk_discard &&
+	    skip_cache->Check(uri, fingerprint)) {
+		FmtDebug(update_domain, "skipping unchanged file {}", uri);
+
+		const UpdateLockStats::ScopeLock protect{lock_stats};
+
+		/* container songs carry the modification time of
+		   the container file */
+		for (Song &song : directory->songs)
+			if (song.mtime == directory->mtime)
+				song.mtime = info.mtime;
+
+		directory->mtime = info.mtime;
+		modified = true;
+		return true;
+	}
+
+	skip_cache->Put(uri, fingerprint);
+	return false;
+}
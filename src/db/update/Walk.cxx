@@ -20,6 +20,7 @@
 #include "Walk.hxx"
 #include "UpdateIO.hxx"
 #include "Editor.hxx"
+#include "ScanPool.hxx"
 #include "UpdateDomain.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/Uri.hxx"
@@ -38,6 +39,7 @@
 #include "util/UriExtract.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <exception>
@@ -48,13 +50,21 @@
 
 UpdateWalk::UpdateWalk(const UpdateConfig &_config,
 		       EventLoop &_loop, DatabaseListener &_listener,
-		       Storage &_storage) noexcept
+		       Storage &_storage,
+		       TagScanPool *tag_scan_pool) noexcept
 	:config(_config), cancel(false),
 	 storage(_storage),
 	 editor(_loop, _listener)
 {
+	if (config.threads > 1 && tag_scan_pool != nullptr)
+		scan_pool = std::make_unique<UpdateScanPool>(*tag_scan_pool,
+							     storage,
+							     config.threads,
+							     config.all_tags);
 }
 
+UpdateWalk::~UpdateWalk() noexcept = default;
+
 static void
 directory_set_stat(Directory &dir, const StorageFileInfo &info)
 {
@@ -66,7 +76,7 @@ inline void
 UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 					const ExcludeList &exclude_list) noexcept
 {
-	const ScopeDatabaseLock protect;
+	const UpdateLockStats::ScopeLock protect{lock_stats};
 
 	directory.ForEachChildSafe([&](Directory &child){
 		const auto name_fs =
@@ -92,6 +102,11 @@ UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 inline void
 UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 {
+	/* first collect all obsolete items (doing I/O without holding
+	   the lock; the update thread is the only writer), then
+	   remove them all in one critical section */
+
+	std::vector<Directory *> deleted_children;
 	directory.ForEachChildSafe([&](Directory &child){
 		if (child.IsMount())
 			/* mount points are always preserved */
@@ -104,11 +119,10 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 		/* the directory was deleted (or the plugin which
 		   handles this "virtual" directory is unavailable) */
 
-		editor.LockDeleteDirectory(&child);
-
-		modified = true;
+		deleted_children.push_back(&child);
 	});
 
+	std::vector<Song *> deleted_songs;
 	directory.ForEachSongSafe([&](Song &song){
 		if (!directory_child_is_regular(storage, directory,
 						song.filename) ||
@@ -116,23 +130,95 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory) noexcept
 			/* the song file was deleted (or the decoder
 			   plugin is unavailable) */
 
-			editor.LockDeleteSong(directory, &song);
-
-			modified = true;
+			deleted_songs.push_back(&song);
 		}
 	});
 
+	if (!deleted_children.empty() || !deleted_songs.empty()) {
+		/* new songs may be inside a deleted child */
+		FlushNewSongs();
+
+		const UpdateLockStats::ScopeLock protect{lock_stats};
+
+		for (Directory *child : deleted_children)
+			editor.DeleteDirectory(child);
+
+		for (Song *song : deleted_songs)
+			editor.DeleteSong(directory, song);
+
+		modified = true;
+	}
+
 	for (auto i = directory.playlists.begin(),
 		     end = directory.playlists.end();
 	     i != end;) {
 		if (!directory_child_is_regular(storage, directory, i->name)) {
-			const ScopeDatabaseLock protect;
+			const UpdateLockStats::ScopeLock protect{lock_stats};
 			i = directory.playlists.erase(i);
 		} else
 			++i;
 	}
 }
 
+void
+UpdateWalk::LockDeleteSong(Directory &parent, Song *song) noexcept
+{
+	const UpdateLockStats::ScopeLock protect{lock_stats};
+	editor.DeleteSong(parent, song);
+}
+
+[[gnu::pure]]
+static bool
+IsInside(const Directory &directory, const Directory &ancestor) noexcept
+{
+	for (const Directory *i = &directory; i != nullptr; i = i->parent)
+		if (i == &ancestor)
+			return true;
+
+	return false;
+}
+
+void
+UpdateWalk::LockDeleteDirectory(Directory *directory) noexcept
+{
+	/* if there are new songs inside this directory, add them
+	   now, to let DeleteDirectory() dispose them properly */
+	if (std::any_of(new_songs.begin(), new_songs.end(),
+			[directory](const SongPtr &song){
+				return IsInside(song->parent, *directory);
+			}))
+		FlushNewSongs();
+
+	const UpdateLockStats::ScopeLock protect{lock_stats};
+	editor.DeleteDirectory(directory);
+}
+
+void
+UpdateWalk::AddNewSong(SongPtr song) noexcept
+{
+	new_songs.emplace_back(std::move(song));
+
+	if (new_songs.size() >= config.batch_size)
+		FlushNewSongs();
+}
+
+void
+UpdateWalk::FlushNewSongs() noexcept
+{
+	if (new_songs.empty())
+		return;
+
+	{
+		const UpdateLockStats::ScopeLock protect{lock_stats};
+		for (auto &song : new_songs) {
+			Directory &parent = song->parent;
+			parent.AddSong(std::move(song));
+		}
+	}
+
+	new_songs.clear();
+}
+
 #ifndef _WIN32
 static bool
 update_directory_stat(Storage &storage, Directory &directory) noexcept
@@ -214,14 +300,14 @@ try {
 
 		Directory *subdir;
 		{
-			const ScopeDatabaseLock protect;
+			const UpdateLockStats::ScopeLock protect{lock_stats};
 			subdir = directory.MakeChild(name);
 		}
 
 		assert(&directory == subdir->parent);
 
 		if (!UpdateDirectory(*subdir, exclude_list, info))
-			editor.LockDeleteDirectory(subdir);
+			LockDeleteDirectory(subdir);
 	} else {
 		FmtDebug(update_domain,
 			 "{} is not a directory, archive or music", name);
@@ -372,7 +458,8 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 				continue;
 		}
 
-		if (SkipSymlink(&directory, name_utf8)) {
+		if (reader->MaybeSymlink() &&
+		    SkipSymlink(&directory, name_utf8)) {
 			modified |= editor.DeleteNameIn(directory, name_utf8);
 			continue;
 		}
@@ -386,6 +473,9 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 		UpdateDirectoryChild(directory, child_exclude_list, name_utf8, info2);
 	}
 
+	FlushNewSongs();
+	CollectScanJobs();
+
 	directory.mtime = info.mtime;
 
 	return true;
@@ -398,7 +488,7 @@ UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 {
 	Directory *directory;
 	{
-		const ScopeDatabaseLock protect;
+		const UpdateLockStats::ScopeLock protect{lock_stats};
 		directory = parent.FindChild(name_utf8);
 	}
 
@@ -420,7 +510,7 @@ UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 	/* if we're adding directory paths, make sure to delete filenames
 	   with potentially the same name */
 	{
-		const ScopeDatabaseLock protect;
+		const UpdateLockStats::ScopeLock protect{lock_stats};
 		Song *conflicting = parent.FindSong(name_utf8);
 		if (conflicting)
 			editor.DeleteSong(parent, conflicting);
@@ -505,13 +595,85 @@ try {
 	LogError(std::current_exception());
 }
 
+inline void
+UpdateWalk::UpdateNames(Directory &root, const char *uri,
+			std::span<const std::string> names) noexcept
+try {
+	Directory *directory = &root;
+	if (!isRootDirectory(uri)) {
+		Directory *parent = DirectoryMakeUriParentChecked(root, uri);
+		if (parent == nullptr)
+			return;
+
+		directory = DirectoryMakeChildChecked(*parent, uri,
+						      PathTraitsUTF8::GetBase(uri));
+		if (directory == nullptr)
+			return;
+	}
+
+	const auto exclude_lists = LoadExcludeLists(storage, *directory);
+	const auto &exclude_list = exclude_lists.front();
+
+	for (const auto &name : names) {
+		if (cancel)
+			break;
+
+		if (skip_path(name.c_str()))
+			continue;
+
+		{
+			const auto name_fs = AllocatedPath::FromUTF8(name);
+			if (name_fs.IsNull() || exclude_list.Check(name_fs))
+				continue;
+		}
+
+		{
+			const UpdateLockStats::ScopeLock protect{lock_stats};
+			const Directory *child = directory->FindChild(name);
+			if (child != nullptr && child->IsMount())
+				continue;
+		}
+
+		if (SkipSymlink(directory, name)) {
+			modified |= editor.DeleteNameIn(*directory, name);
+			continue;
+		}
+
+		const auto child_uri = PathTraitsUTF8::Build(directory->GetPath(),
+							     name);
+
+		StorageFileInfo info;
+		try {
+			info = storage.GetInfo(child_uri.c_str(), true);
+		} catch (...) {
+			if (!IsFileNotFound(std::current_exception()))
+				LogError(std::current_exception());
+
+			/* the file has been deleted */
+			modified |= editor.DeleteNameIn(*directory, name);
+			continue;
+		}
+
+		UpdateDirectoryChild(*directory, exclude_list,
+				     name.c_str(), info);
+	}
+} catch (...) {
+	LogError(std::current_exception());
+}
+
 bool
-UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
+UpdateWalk::Walk(Directory &root, const char *path,
+		 std::span<const std::string> names, bool discard,
+		 UpdateSkipCache *_skip_cache) noexcept
 {
 	walk_discard = discard;
+	skip_cache = _skip_cache;
 	modified = false;
+	lock_stats.Clear();
 
-	if (path != nullptr && !isRootDirectory(path)) {
+	if (!names.empty()) {
+		UpdateNames(root, path != nullptr ? path : "", names);
+	} else if (path != nullptr && !isRootDirectory(path)) {
 		UpdateUri(root, path);
 	} else {
 		StorageFileInfo info;
@@ -529,10 +691,15 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 		UpdateDirectory(root, exclude_list, info);
 	}
 
+	FlushNewSongs();
+	CollectScanJobs();
+
 	{
-		const ScopeDatabaseLock protect;
+		const UpdateLockStats::ScopeLock protect{lock_stats};
 		PurgeDanglingFromPlaylists(root);
 	}
 
+	lock_stats.Log();
+
 	return modified;
 }
@@ -22,10 +22,16 @@
 
 #include "Config.hxx"
 #include "Editor.hxx"
+#include "LockStats.hxx"
+#include "db/plugins/simple/Ptr.hxx"
 #include "config.h"
 
 #include <atomic>
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 struct StorageFileInfo;
 struct Directory;
@@ -35,6 +41,10 @@ class SongEnumerator;
 class ArchiveFile;
 class Storage;
 class ExcludeList;
+class UpdateScanPool;
+class TagScanPool;
+class UpdateSkipCache;
+struct UpdateScanJob;
 
 class UpdateWalk final {
 #ifdef ENABLE_ARCHIVE
@@ -57,10 +67,32 @@ class UpdateWalk final {
 
 	DatabaseEditor editor;
 
+	/**
+	 * If configured, song files are scanned by the shared
+	 * #TagScanPool; the results are merged by CollectScanJobs().
+	 */
+	std::unique_ptr<UpdateScanPool> scan_pool;
+
+	/**
+	 * New songs which have not yet been added to the tree.  They
+	 * are added by FlushNewSongs() in one critical section.
+	 */
+	std::vector<SongPtr> new_songs;
+
+	UpdateLockStats lock_stats;
+
+	/**
+	 * If not nullptr, then this table is used to skip the tag
+	 * scan of files whose contents have not changed.
+	 */
+	UpdateSkipCache *skip_cache;
+
 public:
 	UpdateWalk(const UpdateConfig &_config,
 		   EventLoop &_loop, DatabaseListener &_listener,
-		   Storage &_storage) noexcept;
+		   Storage &_storage,
+		   TagScanPool *tag_scan_pool) noexcept;
+	~UpdateWalk() noexcept;
 
 	/**
 	 * Cancel the current update and quit the Walk() method as
@@ -70,10 +102,20 @@ public:
 		cancel = true;
 	}
 
+	bool IsCancelled() const noexcept {
+		return cancel;
+	}
+
 	/**
 	 * Returns true if the database was modified.
+	 *
+	 * @param names if not empty, then only these entries of the
+	 * directory #path are updated
+	 * @param skip_cache an optional #UpdateSkipCache instance
 	 */
-	bool Walk(Directory &root, const char *path, bool discard) noexcept;
+	bool Walk(Directory &root, const char *path,
+		  std::span<const std::string> names, bool discard,
+		  UpdateSkipCache *skip_cache=nullptr) noexcept;
 
 private:
 	[[gnu::pure]]
@@ -85,6 +127,30 @@ private:
 
 	void PurgeDeletedFromDirectory(Directory &directory) noexcept;
 
+	/**
+	 * Like DatabaseEditor::LockDeleteSong(), but account the
+	 * critical section in #lock_stats.
+	 */
+	void LockDeleteSong(Directory &parent, Song *song) noexcept;
+
+	/**
+	 * Like DatabaseEditor::LockDeleteDirectory(), but flush
+	 * #new_songs first (which may be inside the directory) and
+	 * account the critical section in #lock_stats.
+	 */
+	void LockDeleteDirectory(Directory *directory) noexcept;
+
+	/**
+	 * Schedule adding a new song to the tree; see
+	 * FlushNewSongs().
+	 */
+	void AddNewSong(SongPtr song) noexcept;
+
+	/**
+	 * Add all songs in #new_songs to the tree.
+	 */
+	void FlushNewSongs() noexcept;
+
 	/**
 	 * Remove all virtual songs inside playlists whose "target"
 	 * field points to a non-existing song file.
@@ -94,10 +160,32 @@ private:
 	 */
 	void PurgeDanglingFromPlaylists(Directory &directory) noexcept;
 
+	/**
+	 * Look up the file in the #skip_cache and update its entry.
+	 *
+	 * @return true if the file's contents are unchanged and its
+	 * tags do not need to be scanned again
+	 */
+	bool CheckSkipCache(Directory &directory, const char *name,
+			    const StorageFileInfo &info,
+			    Song *song) noexcept;
+
 	void UpdateSongFile2(Directory &directory,
 			     const char *name, std::string_view suffix,
 			     const StorageFileInfo &info) noexcept;
 
+	/**
+	 * Merge a finished #UpdateScanJob into the tree.  Caller must
+	 * lock the #db_mutex.
+	 */
+	void MergeScanJob(UpdateScanJob &job) noexcept;
+
+	/**
+	 * Wait for all pending #UpdateScanJob instances and merge
+	 * them into the tree, all in one critical section.
+	 */
+	void CollectScanJobs() noexcept;
+
 	bool UpdateSongFile(Directory &directory,
 			    const char *name, std::string_view suffix,
 			    const StorageFileInfo &info) noexcept;
@@ -152,6 +240,13 @@ private:
 			     const ExcludeList &exclude_list,
 			     const StorageFileInfo &info) noexcept;
 
+	/**
+	 * Update only the specified entries of a directory, without
+	 * listing it.
+	 */
+	void UpdateNames(Directory &root, const char *uri,
+			 std::span<const std::string> names) noexcept;
+
 	/**
 	 * Create the specified directory object if it does not exist
 	 * already or if the #StorageFileInfo object indicates that it has been
@@ -173,6 +268,20 @@ private:
 						      const StorageFileInfo &info,
 						      unsigned virtual_device) noexcept;
 
+	/**
+	 * Look up the file which is represented by a virtual
+	 * directory (container, playlist or archive) in the
+	 * #skip_cache and update its entry.  If the file's
+	 * modification time has changed, but its contents have not,
+	 * the existing virtual directory is kept and only its
+	 * modification time is updated.
+	 *
+	 * @return true if the file does not need to be parsed again
+	 */
+	bool CheckVirtualSkipCache(Directory &parent, std::string_view name,
+				   const StorageFileInfo &info,
+				   unsigned virtual_device) noexcept;
+
 	Directory *DirectoryMakeChildChecked(Directory &parent,
 					     const char *uri_utf8,
 					     std::string_view name_utf8) noexcept;
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_ANALYSIS_HXX
+#define MPD_DECODER_ANALYSIS_HXX
+
+#include "tag/ReplayGainInfo.hxx"
+#include "tag/MixRampInfo.hxx"
+
+#include <optional>
+#include <string_view>
+
+/**
+ * ReplayGain and MixRamp data calculated by decoding a song (see
+ * #SongAnalyzer).
+ */
+struct SongAnalysis {
+	ReplayGainTuple track = ReplayGainTuple::Undefined();
+
+	MixRampInfo mix_ramp;
+};
+
+/**
+ * Persistent storage for #SongAnalysis results, used for songs whose
+ * tags lack ReplayGain or MixRamp information.
+ *
+ * All methods are thread-safe; they are called by the decoder
+ * thread.
+ */
+class AnalysisStore {
+public:
+	virtual ~AnalysisStore() noexcept = default;
+
+	/**
+	 * Look up the stored analysis of the song with the given
+	 * (database) URI.
+	 */
+	[[gnu::pure]]
+	virtual std::optional<SongAnalysis> Load(std::string_view uri) const noexcept = 0;
+
+	/**
+	 * Store a new analysis.  This may be asynchronous.
+	 */
+	virtual void Store(std::string_view uri,
+			   SongAnalysis &&analysis) noexcept = 0;
+};
+
+#endif
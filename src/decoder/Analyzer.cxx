@@ -0,0 +1,106 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Analyzer.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/Convert.hxx"
+#include "util/SpanCast.hxx"
+
+#include <fmt/format.h>
+
+static constexpr AudioFormat analyzer_audio_format{
+	ReplayGainAnalyzer::SAMPLE_RATE,
+	SampleFormat::FLOAT,
+	ReplayGainAnalyzer::CHANNELS,
+};
+
+SongAnalyzer::SongAnalyzer(const AudioFormat audio_format)
+{
+	if (audio_format != analyzer_audio_format)
+		convert = std::make_unique<PcmConvert>(audio_format,
+						       analyzer_audio_format);
+}
+
+SongAnalyzer::~SongAnalyzer() noexcept = default;
+
+inline void
+SongAnalyzer::ProcessConverted(std::span<const std::byte> src) noexcept
+{
+	const auto frames = FromBytesStrict<const ReplayGainAnalyzer::Frame>(src);
+	replay_gain.Process(frames);
+	mix_ramp.Process(frames);
+}
+
+void
+SongAnalyzer::Process(std::span<const std::byte> src)
+{
+	if (convert)
+		src = convert->Convert(src);
+
+	ProcessConverted(src);
+}
+
+/**
+ * Format MixRamp items the way they are stored in tags, e.g.
+ * "-90.00 0.10;-60.00 0.20;".
+ *
+ * @param total_time if positive, then the times are counted
+ * backwards from this time (for "MIXRAMP_END")
+ */
+static std::string
+FormatMixRamp(const MixRampArray &items,
+	      FloatDuration total_time=FloatDuration{-1})
+{
+	std::string result;
+	MixRampItem last{};
+
+	for (const auto &i : items) {
+		if (i.time < FloatDuration{} || i == last)
+			continue;
+
+		const auto time = total_time >= FloatDuration{}
+			? total_time - i.time
+			: i.time;
+
+		result += fmt::format("{:.2f} {:.2f};",
+				      i.volume, time.count());
+		last = i;
+	}
+
+	return result;
+}
+
+SongAnalysis
+SongAnalyzer::Finish()
+{
+	if (convert)
+		ProcessConverted(convert->Flush());
+
+	replay_gain.Flush();
+
+	SongAnalysis result;
+	result.track.gain = replay_gain.GetGain();
+	result.track.peak = replay_gain.GetPeak();
+
+	const auto &data = mix_ramp.GetResult();
+	result.mix_ramp.SetStart(FormatMixRamp(data.start));
+	result.mix_ramp.SetEnd(FormatMixRamp(data.end, mix_ramp.GetTime()));
+
+	return result;
+}
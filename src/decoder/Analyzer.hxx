@@ -0,0 +1,73 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_ANALYZER_HXX
+#define MPD_DECODER_ANALYZER_HXX
+
+#include "Analysis.hxx"
+#include "pcm/MixRampAnalyzer.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+struct AudioFormat;
+class PcmConvert;
+
+/**
+ * Calculates ReplayGain and MixRamp data of a song from its decoded
+ * PCM data.  The data is converted to the format required by
+ * #ReplayGainAnalyzer first.
+ */
+class SongAnalyzer {
+	std::unique_ptr<PcmConvert> convert;
+
+	WindowReplayGainAnalyzer replay_gain;
+
+	MixRampAnalyzer mix_ramp;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit SongAnalyzer(AudioFormat audio_format);
+
+	~SongAnalyzer() noexcept;
+
+	SongAnalyzer(const SongAnalyzer &) = delete;
+	SongAnalyzer &operator=(const SongAnalyzer &) = delete;
+
+	/**
+	 * Throws on error.
+	 */
+	void Process(std::span<const std::byte> src);
+
+	/**
+	 * Call this after all data of the song has been passed to
+	 * Process().
+	 *
+	 * Throws on error.
+	 */
+	SongAnalysis Finish();
+
+private:
+	void ProcessConverted(std::span<const std::byte> src) noexcept;
+};
+
+#endif
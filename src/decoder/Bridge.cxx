@@ -21,9 +21,12 @@
 #include "DecoderAPI.hxx"
 #include "Domain.hxx"
 #include "Control.hxx"
+#include "Analyzer.hxx"
 #include "lib/fmt/AudioFormatFormatter.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
 #include "song/DetachedSong.hxx"
 #include "pcm/Convert.hxx"
+#include "pcm/Volume.hxx"
 #include "MusicPipe.hxx"
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
@@ -39,6 +42,7 @@
 #include <cassert>
 #include <cmath>
 #include <stdexcept>
+#include <utility>
 
 #include <string.h>
 
@@ -57,6 +61,103 @@ DecoderBridge::~DecoderBridge() noexcept
 	assert(current_chunk == nullptr);
 }
 
+void
+DecoderBridge::LoadAnalysis() noexcept
+{
+	if (dc.analysis_store == nullptr || !dc.song->IsInDatabase())
+		return;
+
+	const char *uri = dc.song->GetURI();
+	const auto analysis = dc.analysis_store->Load(uri);
+	if (analysis) {
+		/* these are only defaults; tags found by the decoder
+		   plugin override them */
+
+		if (analysis->track.IsDefined()) {
+			auto info = ReplayGainInfo::Undefined();
+			info.track = analysis->track;
+			SubmitReplayGain(&info);
+		}
+
+		if (analysis->mix_ramp.IsDefined()) {
+			const std::scoped_lock<Mutex> protect(dc.mutex);
+			dc.SetMixRamp(MixRampInfo{analysis->mix_ramp});
+		}
+
+		return;
+	}
+
+	/* analyze only if the song is decoded from its very
+	   beginning */
+	analysis_pending = dc.start_time == dc.song->GetStartTime();
+}
+
+void
+DecoderBridge::StartAnalysis() noexcept
+{
+	assert(analysis_pending);
+	assert(analyzer == nullptr);
+
+	analysis_pending = false;
+
+	if (replay_gain_serial != 0) {
+		const std::scoped_lock<Mutex> protect(dc.mutex);
+		if (dc.GetMixRampStart() != nullptr &&
+		    dc.GetMixRampEnd() != nullptr)
+			/* the tags have all we need */
+			return;
+	}
+
+	try {
+		analyzer = std::make_unique<SongAnalyzer>(dc.in_audio_format);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to start song analysis");
+	}
+}
+
+inline void
+DecoderBridge::Analyze(std::span<const std::byte> audio) noexcept
+{
+	if (analysis_pending)
+		StartAnalysis();
+
+	if (analyzer == nullptr)
+		return;
+
+	try {
+		analyzer->Process(audio);
+	} catch (...) {
+		LogError(std::current_exception(), "Song analysis failed");
+		analyzer.reset();
+	}
+}
+
+void
+DecoderBridge::FinishAnalysis() noexcept
+{
+	if (analyzer == nullptr)
+		return;
+
+	auto a = std::move(analyzer);
+
+	if (error)
+		return;
+
+	{
+		const std::scoped_lock<Mutex> protect(dc.mutex);
+		if (dc.command != DecoderCommand::NONE)
+			/* interrupted by the player */
+			return;
+	}
+
+	try {
+		dc.analysis_store->Store(dc.song->GetURI(), a->Finish());
+	} catch (...) {
+		LogError(std::current_exception(), "Song analysis failed");
+	}
+}
+
 InputStreamPtr
 DecoderBridge::OpenLocal(Path path_fs, const char *uri_utf8)
 {
@@ -148,6 +249,11 @@ DecoderBridge::FlushChunk() noexcept
 	assert(current_chunk != nullptr);
 
 	auto chunk = std::move(current_chunk);
+
+	if (replay_gain_volume && chunk->length > 0 &&
+	    replay_gain_volume->CanApplyInPlace())
+		replay_gain_volume->ApplyInPlace({chunk->data, chunk->length});
+
 	if (!chunk->IsEmpty())
 		dc.pipe->Push(std::move(chunk));
 
@@ -218,7 +324,7 @@ DecoderBridge::LockGetVirtualCommand() noexcept
 }
 
 DecoderCommand
-DecoderBridge::DoSendTag(const Tag &tag) noexcept
+DecoderBridge::DoSendTag(std::shared_ptr<const Tag> tag) noexcept
 {
 	if (current_chunk != nullptr) {
 		/* there is a partial chunk - flush it, we want the
@@ -234,7 +340,7 @@ DecoderBridge::DoSendTag(const Tag &tag) noexcept
 		return dc.command;
 	}
 
-	chunk->tag = std::make_unique<Tag>(tag);
+	chunk->tag = std::move(tag);
 	return DecoderCommand::NONE;
 }
 
@@ -259,6 +365,33 @@ DecoderBridge::UpdateStreamTag(InputStream *is) noexcept
 	return true;
 }
 
+DecoderCommand
+DecoderBridge::SendStreamTag(InputStream *is) noexcept
+{
+	if (!UpdateStreamTag(is))
+		return DecoderCommand::NONE;
+
+	if (decoder_tag != nullptr)
+		/* merge with tag from decoder plugin */
+		return DoSendTag(Tag::Merge(decoder_tag, stream_tag));
+	else
+		/* send only the stream tag */
+		return DoSendTag(stream_tag);
+}
+
+uint64_t
+DecoderBridge::GetRemainingFrames() const noexcept
+{
+	if (!dc.end_time.IsPositive())
+		return UINT64_MAX;
+
+	const auto end_frame =
+		dc.end_time.ToScale<uint64_t>(dc.in_audio_format.sample_rate);
+	return absolute_frame < end_frame
+		? end_frame - absolute_frame
+		: 0;
+}
+
 void
 DecoderBridge::Ready(const AudioFormat audio_format,
 		     bool seekable, SignedSongTime duration) noexcept
@@ -288,6 +421,71 @@ DecoderBridge::Ready(const AudioFormat audio_format,
 			error = std::current_exception();
 		}
 	}
+
+	if (dc.replay_gain_config.in_decoder &&
+	    dc.replay_gain_mode != ReplayGainMode::OFF) {
+		try {
+			auto pv = std::make_unique<PcmVolume>();
+			pv->Open(dc.out_audio_format.format, false);
+			replay_gain_volume = std::move(pv);
+			UpdateReplayGainVolume();
+		} catch (...) {
+			/* not supported for this sample format (DSD) */
+			FmtDebug(decoder_domain, "No ReplayGain: {}",
+				 std::current_exception());
+		}
+	}
+}
+
+void
+DecoderBridge::UpdateReplayGainVolume() noexcept
+{
+	if (!replay_gain_volume)
+		return;
+
+	const auto info = replay_gain_serial != 0
+		? replay_gain_info
+		: ReplayGainInfo::Undefined();
+
+	const float scale = info.Get(dc.replay_gain_mode)
+		.CalculateScale(dc.replay_gain_config);
+	replay_gain_volume->SetVolume(pcm_float_to_volume(scale));
+}
+
+bool
+DecoderBridge::ContinueNextSong() noexcept
+{
+	/* the current song is complete */
+	CheckFlushChunk();
+	FinishAnalysis();
+
+	{
+		const std::scoped_lock<Mutex> protect(dc.mutex);
+		if (!dc.HasContinuation())
+			return false;
+
+		auto previous_song = std::exchange(dc.song,
+						   std::move(dc.next_song));
+		if (original_song == nullptr)
+			original_song = std::move(previous_song);
+
+		dc.start_time = dc.end_time;
+		dc.end_time = dc.song->GetEndTime();
+		dc.pipe = std::move(dc.next_pipe);
+		dc.CycleMixRamp();
+
+		/* wake up the player, which now sees the new pipe */
+		dc.client_cond.notify_one();
+	}
+
+	FmtDebug(decoder_domain, "continuing with \"{}\"", dc.song->GetURI());
+
+	/* the next SubmitAudio() call emits the new song's tag
+	   (merged with the tag from the decoder plugin) */
+	song_tag = std::make_unique<Tag>(dc.song->GetTag());
+
+	LoadAnalysis();
+	return true;
 }
 
 DecoderCommand
@@ -330,6 +528,10 @@ DecoderBridge::CommandFinished() noexcept
 		if (convert != nullptr)
 			convert->Reset();
 
+		/* the analysis needs the whole song */
+		analysis_pending = false;
+		analyzer.reset();
+
 		timestamp = std::chrono::duration_cast<FloatDuration>(dc.seek_time);
 		absolute_frame = dc.seek_time.ToScale<uint64_t>(dc.in_audio_format.sample_rate);
 	}
@@ -468,44 +670,51 @@ DecoderBridge::SubmitAudio(InputStream *is,
 	assert(!initial_seek_pending);
 	assert(!initial_seek_running);
 
-	/* send stream tags */
+	/* enforce the given end time */
 
-	if (UpdateStreamTag(is)) {
-		if (decoder_tag != nullptr)
-			/* merge with tag from decoder plugin */
-			cmd = DoSendTag(Tag::Merge(*decoder_tag,
-						   *stream_tag));
-		else
-			/* send only the stream tag */
-			cmd = DoSendTag(*stream_tag);
-
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
-	}
+	if (GetRemainingFrames() == 0 && !ContinueNextSong())
+		return DecoderCommand::STOP;
 
-	cmd = DecoderCommand::NONE;
+	/* send stream tags */
+
+	cmd = SendStreamTag(is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
 
 	const size_t frame_size = dc.in_audio_format.GetFrameSize();
 	size_t data_frames = audio.size() / frame_size;
 
-	if (dc.end_time.IsPositive()) {
-		/* enforce the given end time */
-
-		const auto end_frame =
-			dc.end_time.ToScale<uint64_t>(dc.in_audio_format.sample_rate);
-		if (absolute_frame >= end_frame)
-			return DecoderCommand::STOP;
+	const uint64_t remaining_frames = GetRemainingFrames();
+	if (data_frames >= remaining_frames &&
+	    remaining_frames != UINT64_MAX) {
+		bool has_continuation;
+		{
+			const std::scoped_lock<Mutex> protect(dc.mutex);
+			has_continuation = dc.HasContinuation();
+		}
 
-		const uint64_t remaining_frames = end_frame - absolute_frame;
-		if (data_frames >= remaining_frames) {
+		if (!has_continuation) {
 			/* past the end of the range: truncate this
 			   data submission and stop the decoder */
 			data_frames = remaining_frames;
 			audio = audio.first(data_frames * frame_size);
 			cmd = DecoderCommand::STOP;
+		} else if (data_frames > remaining_frames) {
+			/* the range ends inside this data submission,
+			   and the next song continues right there:
+			   split it; the second call switches to the
+			   next song */
+			const auto split = remaining_frames * frame_size;
+			cmd = SubmitAudio(is, audio.first(split), kbit_rate);
+			if (cmd != DecoderCommand::NONE)
+				return cmd;
+
+			return SubmitAudio(is, audio.subspan(split), kbit_rate);
 		}
 	}
 
+	Analyze(audio);
+
 	if (convert != nullptr) {
 		assert(dc.in_audio_format != dc.out_audio_format);
 
@@ -566,6 +775,86 @@ DecoderBridge::SubmitAudio(InputStream *is,
 	return cmd;
 }
 
+std::span<std::byte>
+DecoderBridge::WriteAudio(InputStream *is, uint16_t kbit_rate) noexcept
+{
+	assert(dc.state == DecoderState::DECODE);
+	assert(dc.pipe != nullptr);
+
+	if (convert != nullptr)
+		/* the data needs to be converted; SubmitAudio() does
+		   that */
+		return {};
+
+	/* if there is a command, let SubmitAudio() deal with it */
+	if (LockGetVirtualCommand() != DecoderCommand::NONE ||
+	    SendStreamTag(is) != DecoderCommand::NONE)
+		return {};
+
+	assert(!initial_seek_pending);
+	assert(!initial_seek_running);
+
+	const uint64_t remaining_frames = GetRemainingFrames();
+	if (remaining_frames == 0)
+		return {};
+
+	std::span<std::byte> dest;
+	while (true) {
+		auto *chunk = GetChunk();
+		if (chunk == nullptr)
+			return {};
+
+		dest = chunk->Write(dc.out_audio_format,
+				    SongTime::Cast(timestamp) -
+				    dc.song->GetStartTime(),
+				    kbit_rate);
+		if (!dest.empty())
+			break;
+
+		/* the chunk is full, flush it */
+		FlushChunk();
+	}
+
+	const size_t frame_size = dc.out_audio_format.GetFrameSize();
+	if (dest.size() / frame_size > remaining_frames)
+		dest = dest.first(remaining_frames * frame_size);
+
+	return dest;
+}
+
+DecoderCommand
+DecoderBridge::CommitAudio(std::size_t nbytes) noexcept
+{
+	assert(convert == nullptr);
+	assert(current_chunk != nullptr);
+	assert(nbytes % dc.out_audio_format.GetFrameSize() == 0);
+
+	auto &chunk = *current_chunk;
+	assert(chunk.length + nbytes <= chunk.GetCapacity());
+
+	if (nbytes > 0) {
+		Analyze({chunk.data + chunk.length, nbytes});
+
+		if (chunk.Expand(dc.out_audio_format, nbytes))
+			/* the chunk is full, flush it */
+			FlushChunk();
+
+		timestamp += dc.out_audio_format.SizeToTime<FloatDuration>(nbytes);
+		absolute_frame += nbytes / dc.out_audio_format.GetFrameSize();
+
+		if (GetRemainingFrames() == 0) {
+			/* the end of the range has been reached; stop
+			   unless there is a continuation, which the
+			   next SubmitAudio() call switches to */
+			const std::scoped_lock<Mutex> protect(dc.mutex);
+			if (!dc.HasContinuation())
+				return DecoderCommand::STOP;
+		}
+	}
+
+	return LockGetVirtualCommand();
+}
+
 DecoderCommand
 DecoderBridge::SubmitTag(InputStream *is, Tag &&tag) noexcept
 {
@@ -576,7 +865,7 @@ DecoderBridge::SubmitTag(InputStream *is, Tag &&tag) noexcept
 
 	/* save the tag */
 
-	decoder_tag = std::make_unique<Tag>(std::move(tag));
+	decoder_tag = std::make_shared<const Tag>(std::move(tag));
 
 	/* check if we're seeking */
 
@@ -594,10 +883,10 @@ DecoderBridge::SubmitTag(InputStream *is, Tag &&tag) noexcept
 
 	if (stream_tag != nullptr)
 		/* merge with tag from input stream */
-		cmd = DoSendTag(Tag::Merge(*stream_tag, *decoder_tag));
+		cmd = DoSendTag(Tag::Merge(stream_tag, decoder_tag));
 	else
 		/* send only the decoder tag */
-		cmd = DoSendTag(*decoder_tag);
+		cmd = DoSendTag(decoder_tag);
 
 	return cmd;
 }
@@ -630,8 +919,14 @@ DecoderBridge::SubmitReplayGain(const ReplayGainInfo *new_replay_gain_info) noex
 			   samples */
 			FlushChunk();
 		}
-	} else
+	} else {
 		replay_gain_serial = 0;
+
+		if (replay_gain_volume && current_chunk != nullptr)
+			FlushChunk();
+	}
+
+	UpdateReplayGainVolume();
 }
 
 void
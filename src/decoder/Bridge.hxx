@@ -28,8 +28,11 @@
 #include <memory>
 
 class PcmConvert;
+class PcmVolume;
+class SongAnalyzer;
 struct MusicChunk;
 class DecoderControl;
+class DetachedSong;
 class Path;
 struct Tag;
 
@@ -90,12 +93,19 @@ private:
 	 */
 	std::unique_ptr<Tag> song_tag;
 
+	/**
+	 * The song this decoder was started with, after it has
+	 * switched to DecoderControl::next_song.  It is kept because
+	 * the decoder plugin is still using its URI.
+	 */
+	std::unique_ptr<DetachedSong> original_song;
+
 public:
 	/** the last tag received from the stream */
-	std::unique_ptr<Tag> stream_tag;
+	std::shared_ptr<const Tag> stream_tag;
 
 	/** the last tag received from the decoder plugin */
-	std::unique_ptr<Tag> decoder_tag;
+	std::shared_ptr<const Tag> decoder_tag;
 
 private:
 	/** the chunk currently being written to */
@@ -109,6 +119,26 @@ private:
 	 */
 	unsigned replay_gain_serial = 0;
 
+	/**
+	 * Applies ReplayGain to each chunk in FlushChunk() if
+	 * ReplayGainConfig::in_decoder is set; nullptr if ReplayGain
+	 * is applied by the audio outputs.
+	 */
+	std::unique_ptr<PcmVolume> replay_gain_volume;
+
+	/**
+	 * Shall the song be analyzed as soon as the first audio data
+	 * is submitted?  This is set by LoadAnalysis() if the
+	 * #AnalysisStore knows nothing about the song.
+	 */
+	bool analysis_pending = false;
+
+	/**
+	 * Calculates ReplayGain and MixRamp data while the song is
+	 * being decoded; nullptr if the song is not being analyzed.
+	 */
+	std::unique_ptr<SongAnalyzer> analyzer;
+
 	/**
 	 * An error has occurred (in DecoderAPI.cxx), and the plugin
 	 * will be asked to stop.
@@ -160,6 +190,22 @@ public:
 			std::rethrow_exception(error);
 	}
 
+	/**
+	 * Submit stored analysis results of the current song (see
+	 * #AnalysisStore), or prepare analyzing it if there are none.
+	 *
+	 * Caller must not lock the #DecoderControl object.
+	 */
+	void LoadAnalysis() noexcept;
+
+	/**
+	 * The whole song has been decoded successfully: pass the
+	 * analysis results (if any) to the #AnalysisStore.
+	 *
+	 * Caller must not lock the #DecoderControl object.
+	 */
+	void FinishAnalysis() noexcept;
+
 	/**
 	 * Open a local file.
 	 */
@@ -180,6 +226,9 @@ public:
 	DecoderCommand SubmitAudio(InputStream *is,
 				   std::span<const std::byte> audio,
 				   uint16_t kbit_rate) noexcept override;
+	std::span<std::byte> WriteAudio(InputStream *is,
+					uint16_t kbit_rate) noexcept override;
+	DecoderCommand CommitAudio(std::size_t nbytes) noexcept override;
 	DecoderCommand SubmitTag(InputStream *is, Tag &&tag) noexcept override;
 	void SubmitReplayGain(const ReplayGainInfo *replay_gain_info) noexcept override;
 	void SubmitMixRamp(MixRampInfo &&mix_ramp) noexcept override;
@@ -203,9 +252,48 @@ private:
 	 * Sends a #Tag as-is to the #MusicPipe.  Flushes the current
 	 * chunk (DecoderBridge::chunk) if there is one.
 	 */
-	DecoderCommand DoSendTag(const Tag &tag) noexcept;
+	DecoderCommand DoSendTag(std::shared_ptr<const Tag> tag) noexcept;
 
 	bool UpdateStreamTag(InputStream *is) noexcept;
+
+	/**
+	 * Send a new stream tag (if there is one), merged with the
+	 * #decoder_tag.
+	 */
+	DecoderCommand SendStreamTag(InputStream *is) noexcept;
+
+	/**
+	 * Returns the number of frames which may still be submitted
+	 * before DecoderControl::end_time is reached, or UINT64_MAX
+	 * if there is no end time.
+	 */
+	[[gnu::pure]]
+	uint64_t GetRemainingFrames() const noexcept;
+
+	/**
+	 * The end of the current song has been reached: if the
+	 * client has queued a continuation (see
+	 * DecoderControl::next_song), switch to it.
+	 *
+	 * Caller must not lock the #DecoderControl object.
+	 *
+	 * @return true if decoding continues with the next song,
+	 * false if the decoder shall stop
+	 */
+	bool ContinueNextSong() noexcept;
+
+	/**
+	 * Calculate the #replay_gain_volume level from the current
+	 * #ReplayGainInfo and mode.
+	 */
+	void UpdateReplayGainVolume() noexcept;
+
+	/**
+	 * Called by SubmitAudio() for the first data of the song.
+	 */
+	void StartAnalysis() noexcept;
+
+	void Analyze(std::span<const std::byte> audio) noexcept;
 };
 
 #endif
@@ -158,6 +158,51 @@ public:
 		return SubmitAudio(is, audio_bytes, kbit_rate);
 	}
 
+	/**
+	 * Lend the decoder plugin a writable buffer inside the
+	 * current #MusicChunk, allowing it to decode directly into
+	 * it instead of passing its own buffer to SubmitAudio(),
+	 * which would copy it.  After writing, the plugin must call
+	 * CommitAudio() before calling any other method.
+	 *
+	 * The buffer contains only whole frames in the audio format
+	 * passed to Ready(), and it may be smaller than the amount of
+	 * data the plugin has; the plugin may call this method again
+	 * after CommitAudio() for the rest.
+	 *
+	 * An empty span is returned if this is not possible right now
+	 * (e.g. because the data needs to be converted, or because a
+	 * command is pending); in that case, the plugin shall fall
+	 * back to SubmitAudio(), which deals with all of these
+	 * situations.  CommitAudio() must not be called then.
+	 *
+	 * @param is an input stream which is buffering while we are waiting
+	 * for the player
+	 * @param kbit_rate the current bit rate
+	 */
+	virtual std::span<std::byte> WriteAudio([[maybe_unused]] InputStream *is,
+						[[maybe_unused]] uint16_t kbit_rate) noexcept {
+		return {};
+	}
+
+	std::span<std::byte> WriteAudio(InputStream &is,
+					uint16_t kbit_rate) noexcept {
+		return WriteAudio(&is, kbit_rate);
+	}
+
+	/**
+	 * Finish writing to the buffer returned by WriteAudio().
+	 *
+	 * @param nbytes the number of bytes which were written to
+	 * the beginning of the buffer; must be a multiple of the
+	 * frame size (may be 0)
+	 * @return the current command, or DecoderCommand::NONE if there is no
+	 * command pending
+	 */
+	virtual DecoderCommand CommitAudio([[maybe_unused]] std::size_t nbytes) noexcept {
+		return GetCommand();
+	}
+
 	/**
 	 * This function is called by the decoder plugin when it has
 	 * successfully decoded a tag.
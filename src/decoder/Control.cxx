@@ -20,18 +20,23 @@
 #include "Control.hxx"
 #include "MusicPipe.hxx"
 #include "song/DetachedSong.hxx"
+#include "util/StringAPI.hxx"
 
 #include <cassert>
 #include <stdexcept>
 
 DecoderControl::DecoderControl(Mutex &_mutex, Cond &_client_cond,
 			       InputCacheManager *_input_cache,
+			       AnalysisStore *_analysis_store,
 			       const AudioFormat _configured_audio_format,
+			       bool _float_pipeline,
 			       const ReplayGainConfig &_replay_gain_config) noexcept
 	:thread(BIND_THIS_METHOD(RunThread)),
 	 input_cache(_input_cache),
+	 analysis_store(_analysis_store),
 	 mutex(_mutex), client_cond(_client_cond),
 	 configured_audio_format(_configured_audio_format),
+	 float_pipeline(_float_pipeline),
 	 replay_gain_config(_replay_gain_config) {}
 
 DecoderControl::~DecoderControl() noexcept
@@ -52,6 +57,14 @@ DecoderControl::SetReady(const AudioFormat audio_format,
 	in_audio_format = audio_format;
 	out_audio_format = audio_format.WithMask(configured_audio_format);
 
+	if (float_pipeline &&
+	    configured_audio_format.format == SampleFormat::UNDEFINED &&
+	    audio_format.format != SampleFormat::DSD)
+		/* convert to float right here; all following steps
+		   operate on float, and only the outputs convert it
+		   to their own formats */
+		out_audio_format.format = SampleFormat::FLOAT;
+
 	seekable = _seekable;
 	total_time = _duration;
 
@@ -76,6 +89,24 @@ DecoderControl::IsCurrentSong(const DetachedSong &_song) const noexcept
 	gcc_unreachable();
 }
 
+bool
+DecoderControl::IsContinuation(const DetachedSong &_song) const noexcept
+{
+	switch (state) {
+	case DecoderState::STOP:
+	case DecoderState::ERROR:
+		return false;
+
+	case DecoderState::START:
+	case DecoderState::DECODE:
+		break;
+	}
+
+	return next_song == nullptr && command == DecoderCommand::NONE &&
+		end_time.IsPositive() && _song.GetStartTime() == end_time &&
+		StringIsEqual(song->GetRealURI(), _song.GetRealURI());
+}
+
 void
 DecoderControl::Start(std::unique_lock<Mutex> &lock,
 		      std::unique_ptr<DetachedSong> _song,
@@ -86,6 +117,7 @@ DecoderControl::Start(std::unique_lock<Mutex> &lock,
 {
 	assert(_song != nullptr);
 	assert(_pipe->IsEmpty());
+	assert(next_song == nullptr);
 
 	song = std::move(_song);
 	start_time = _start_time;
@@ -98,6 +130,25 @@ DecoderControl::Start(std::unique_lock<Mutex> &lock,
 	SynchronousCommandLocked(lock, DecoderCommand::START);
 }
 
+void
+DecoderControl::Continue(std::unique_ptr<DetachedSong> _song,
+			 std::shared_ptr<MusicPipe> _pipe) noexcept
+{
+	assert(_song != nullptr);
+	assert(_pipe->IsEmpty());
+	assert(IsContinuation(*_song));
+
+	next_song = std::move(_song);
+	next_pipe = std::move(_pipe);
+}
+
+void
+DecoderControl::CancelContinuation() noexcept
+{
+	next_song.reset();
+	next_pipe.reset();
+}
+
 void
 DecoderControl::Stop(std::unique_lock<Mutex> &lock) noexcept
 {
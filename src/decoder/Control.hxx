@@ -27,6 +27,7 @@
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
+#include "thread/Profile.hxx"
 #include "Chrono.hxx"
 #include "config/ReplayGainConfig.hxx"
 #include "ReplayGainMode.hxx"
@@ -46,6 +47,7 @@ class DetachedSong;
 class MusicBuffer;
 class MusicPipe;
 class InputCacheManager;
+class AnalysisStore;
 
 enum class DecoderState : uint8_t {
 	STOP = 0,
@@ -70,6 +72,12 @@ class DecoderControl final : public InputStreamHandler {
 public:
 	InputCacheManager *const input_cache;
 
+	/**
+	 * Where ReplayGain/MixRamp analysis results are loaded from
+	 * and stored to; nullptr if song analysis is disabled.
+	 */
+	AnalysisStore *const analysis_store;
+
 	/**
 	 * This lock protects #state and #command.
 	 *
@@ -126,6 +134,11 @@ private:
 	 */
 	const AudioFormat configured_audio_format;
 
+	/**
+	 * The "float_pipeline" setting.
+	 */
+	const bool float_pipeline;
+
 public:
 	/** the format of the song file */
 	AudioFormat in_audio_format;
@@ -167,6 +180,22 @@ public:
 	 */
 	std::shared_ptr<MusicPipe> pipe;
 
+	/**
+	 * The song which shall be decoded after #song without
+	 * restarting the decoder, because it continues in the same
+	 * file exactly at #end_time (e.g. the next track of a CUE
+	 * sheet).  When the decoder reaches #end_time, it moves this
+	 * song to #song and #next_pipe to #pipe instead of stopping.
+	 *
+	 * This attribute is set by Continue().
+	 */
+	std::unique_ptr<DetachedSong> next_song;
+
+	/**
+	 * The destination pipe for decoded chunks of #next_song.
+	 */
+	std::shared_ptr<MusicPipe> next_pipe;
+
 	const ReplayGainConfig replay_gain_config;
 	ReplayGainMode replay_gain_mode = ReplayGainMode::OFF;
 
@@ -183,7 +212,9 @@ public:
 	 */
 	DecoderControl(Mutex &_mutex, Cond &_client_cond,
 		       InputCacheManager *_input_cache,
+		       AnalysisStore *_analysis_store,
 		       const AudioFormat _configured_audio_format,
+		       bool _float_pipeline,
 		       const ReplayGainConfig &_replay_gain_config) noexcept;
 	~DecoderControl() noexcept;
 
@@ -211,6 +242,7 @@ public:
 	 */
 	void Wait(std::unique_lock<Mutex> &lock) noexcept {
 		cond.wait(lock);
+		CountThreadWakeup(ThreadProfileType::DECODER);
 	}
 
 	/**
@@ -222,6 +254,7 @@ public:
 	 */
 	void WaitForDecoder(std::unique_lock<Mutex> &lock) noexcept {
 		client_cond.wait(lock);
+		CountThreadWakeup(ThreadProfileType::PLAYER);
 	}
 
 	bool IsIdle() const noexcept {
@@ -326,6 +359,20 @@ public:
 		return seekable && IsCurrentSong(_song);
 	}
 
+	/**
+	 * Can the specified song be decoded as a continuation of the
+	 * current one, i.e. does it start in the same file exactly
+	 * where the current one ends?  See #next_song.
+	 *
+	 * Caller must lock the object.
+	 */
+	[[gnu::pure]]
+	bool IsContinuation(const DetachedSong &_song) const noexcept;
+
+	bool HasContinuation() const noexcept {
+		return next_song != nullptr;
+	}
+
 private:
 	/**
 	 * Wait for the command to be finished by the decoder thread.
@@ -407,6 +454,29 @@ public:
 		   MusicBuffer &buffer,
 		   std::shared_ptr<MusicPipe> pipe) noexcept;
 
+	/**
+	 * Let the decoder continue with the specified song after it
+	 * has reached the end of the current one, instead of
+	 * stopping.  Check IsContinuation() before calling this
+	 * method.  This is asynchronous; the client notices the
+	 * switch when #pipe changes.
+	 *
+	 * Caller must lock the object.
+	 *
+	 * @param pipe the pipe which receives the decoded chunks of
+	 * the new song (owned by the caller)
+	 */
+	void Continue(std::unique_ptr<DetachedSong> song,
+		      std::shared_ptr<MusicPipe> pipe) noexcept;
+
+	/**
+	 * Undo Continue(), unless the decoder has already switched
+	 * to the new song.
+	 *
+	 * Caller must lock the object.
+	 */
+	void CancelContinuation() noexcept;
+
 	/**
 	 * Caller must lock the object.
 	 */
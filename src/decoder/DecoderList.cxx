@@ -48,6 +48,7 @@
 #include "plugins/MpcdecDecoderPlugin.hxx"
 #include "plugins/FluidsynthDecoderPlugin.hxx"
 #include "plugins/SidplayDecoderPlugin.hxx"
+#include "SeekIndex.hxx"
 #include "Log.hxx"
 #include "PluginUnavailable.hxx"
 
@@ -139,6 +140,8 @@ decoder_plugin_from_name(const char *name) noexcept
 void
 decoder_plugin_init_all(const ConfigData &config)
 {
+	InitSeekIndexCache(config);
+
 	ConfigBlock empty;
 
 	for (unsigned i = 0; decoder_plugins[i] != nullptr; ++i) {
@@ -176,6 +179,8 @@ decoder_plugin_deinit_all() noexcept
 	decoder_plugins_for_each_enabled([=](const DecoderPlugin &plugin){
 			plugin.Finish();
 		});
+
+	DeinitSeekIndexCache();
 }
 
 bool
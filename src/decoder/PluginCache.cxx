@@ -0,0 +1,84 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PluginCache.hxx"
+#include "util/DeleteDisposer.hxx"
+
+DecoderPluginCache::~DecoderPluginCache() noexcept
+{
+	lru.clear();
+	map.clear_and_dispose(DeleteDisposer());
+}
+
+inline void
+DecoderPluginCache::Remove(Item &item) noexcept
+{
+	lru.erase(lru.iterator_to(item));
+	map.erase(map.iterator_to(item));
+	delete &item;
+}
+
+const DecoderPlugin *
+DecoderPluginCache::Get(std::string_view uri) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	auto i = map.find(uri);
+	if (i == map.end())
+		return nullptr;
+
+	auto &item = *i;
+
+	/* move to the end of the LRU list */
+	lru.erase(lru.iterator_to(item));
+	lru.push_back(item);
+
+	return item.plugin;
+}
+
+void
+DecoderPluginCache::Put(std::string_view uri,
+			const DecoderPlugin &plugin) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	if (auto i = map.find(uri); i != map.end()) {
+		auto &item = *i;
+		item.plugin = &plugin;
+		lru.erase(lru.iterator_to(item));
+		lru.push_back(item);
+		return;
+	}
+
+	while (map.size() >= max_items && !lru.empty())
+		Remove(lru.front());
+
+	auto *item = new Item(uri, plugin);
+	map.insert(*item);
+	lru.push_back(*item);
+}
+
+void
+DecoderPluginCache::Remove(std::string_view uri) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	if (auto i = map.find(uri); i != map.end())
+		Remove(*i);
+}
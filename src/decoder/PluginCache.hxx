@@ -0,0 +1,124 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_PLUGIN_CACHE_HXX
+#define MPD_DECODER_PLUGIN_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/IntrusiveHashSet.hxx"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+struct DecoderPlugin;
+
+/**
+ * Remembers which decoder plugin has successfully decoded a URI, so
+ * the next time this URI is played, that plugin can be tried first
+ * instead of probing all plugins which match the MIME type or
+ * suffix (each probe may read and rewind the stream).  This is a
+ * count-bounded LRU cache.
+ *
+ * This class is thread-safe.
+ */
+class DecoderPluginCache final {
+	const std::size_t max_items;
+
+	Mutex mutex;
+
+	struct Item final
+		: IntrusiveHashSetHook<>,
+		  IntrusiveListHook<>
+	{
+		const std::string uri;
+
+		const DecoderPlugin *plugin;
+
+		Item(std::string_view _uri,
+		     const DecoderPlugin &_plugin) noexcept
+			:uri(_uri), plugin(&_plugin) {}
+
+		struct Hash : std::hash<std::string_view> {
+			using std::hash<std::string_view>::operator();
+
+			[[gnu::pure]]
+			std::size_t operator()(const Item &item) const noexcept {
+				return std::hash<std::string_view>::operator()(item.uri);
+			}
+		};
+
+		struct Equal {
+			[[gnu::pure]]
+			bool operator()(const Item &a,
+					const Item &b) const noexcept {
+				return a.uri == b.uri;
+			}
+
+			[[gnu::pure]]
+			bool operator()(std::string_view a,
+					const Item &b) const noexcept {
+				return a == b.uri;
+			}
+		};
+	};
+
+	/**
+	 * All items; the least recently used one comes first.
+	 */
+	IntrusiveList<Item> lru;
+
+	IntrusiveHashSet<Item, 127, Item::Hash, Item::Equal,
+			 IntrusiveHashSetBaseHookTraits<Item>,
+			 true> map;
+
+public:
+	explicit DecoderPluginCache(std::size_t _max_items) noexcept
+		:max_items(_max_items) {}
+
+	~DecoderPluginCache() noexcept;
+
+	DecoderPluginCache(const DecoderPluginCache &) = delete;
+	DecoderPluginCache &operator=(const DecoderPluginCache &) = delete;
+
+	/**
+	 * @return the plugin which has decoded this URI last time,
+	 * or nullptr if unknown
+	 */
+	const DecoderPlugin *Get(std::string_view uri) noexcept;
+
+	/**
+	 * Remember the plugin which has successfully decoded this
+	 * URI.
+	 */
+	void Put(std::string_view uri, const DecoderPlugin &plugin) noexcept;
+
+	/**
+	 * Forget the plugin for this URI, e.g. because it has
+	 * rejected the URI this time.
+	 */
+	void Remove(std::string_view uri) noexcept;
+
+private:
+	void Remove(Item &item) noexcept;
+};
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SeekIndex.hxx"
+#include "config/Data.hxx"
+#include "config/Option.hxx"
+#include "input/InputStream.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/FileReader.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Path.hxx"
+#include "fs/Traits.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+#include <string.h>
+
+static constexpr Domain seek_index_domain("seek_index");
+
+static constexpr uint32_t SEEK_INDEX_MAGIC = 0x4d505349;
+
+/**
+ * Older files are deleted at startup when there are more than this.
+ */
+static constexpr std::size_t MAX_FILES = 4096;
+
+/**
+ * Cache files larger than this are considered malformed.
+ */
+static constexpr uint64_t MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+/**
+ * The header of each cache file.  It is followed by the plugin name
+ * and the URI (both without null terminator) and then by #count
+ * offset deltas, each encoded as LEB128.
+ */
+struct SeekIndexHeader {
+	uint32_t magic;
+	uint16_t plugin_length;
+	uint16_t reserved;
+	uint32_t uri_length;
+	uint32_t reserved2;
+
+	/**
+	 * The size of the song file.
+	 */
+	uint64_t size;
+
+	/**
+	 * The modification time of the song file in nanoseconds
+	 * since the epoch; 0 if unknown.
+	 */
+	int64_t mtime;
+
+	uint64_t step;
+
+	uint64_t count;
+};
+
+static void
+AppendVarint(std::string &dest, uint64_t value) noexcept
+{
+	do {
+		uint8_t b = value & 0x7f;
+		value >>= 7;
+		if (value != 0)
+			b |= 0x80;
+		dest.push_back(static_cast<char>(b));
+	} while (value != 0);
+}
+
+/**
+ * @return false on malformed input
+ */
+static bool
+ReadVarint(std::span<const std::byte> &src, uint64_t &value_r) noexcept
+{
+	uint64_t value = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		if (src.empty())
+			return false;
+
+		const auto b = static_cast<uint8_t>(src.front());
+		src = src.subspan(1);
+
+		value |= uint64_t(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) {
+			value_r = value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string
+SerializeSeekIndex(std::string_view plugin, const SeekIndexKey &key,
+		   const SeekIndex &index) noexcept
+{
+	SeekIndexHeader header{};
+	header.magic = SEEK_INDEX_MAGIC;
+	header.plugin_length = plugin.size();
+	header.uri_length = key.uri.size();
+	header.size = key.size;
+	header.mtime = key.mtime;
+	header.step = index.step;
+	header.count = index.offsets.size();
+
+	std::string result;
+	result.reserve(sizeof(header) + plugin.size() + key.uri.size() +
+		       index.offsets.size() * 2);
+	result.append(reinterpret_cast<const char *>(&header), sizeof(header));
+	result.append(plugin);
+	result.append(key.uri);
+
+	uint64_t previous = 0;
+	for (const uint64_t offset : index.offsets) {
+		assert(offset >= previous);
+		AppendVarint(result, offset - previous);
+		previous = offset;
+	}
+
+	return result;
+}
+
+std::optional<SeekIndex>
+ParseSeekIndex(std::span<const std::byte> src,
+	       std::string_view plugin, const SeekIndexKey &key) noexcept
+{
+	SeekIndexHeader header;
+	if (src.size() < sizeof(header))
+		return std::nullopt;
+
+	memcpy(&header, src.data(), sizeof(header));
+	src = src.subspan(sizeof(header));
+
+	if (header.magic != SEEK_INDEX_MAGIC ||
+	    header.plugin_length != plugin.size() ||
+	    header.uri_length != key.uri.size() ||
+	    header.size != key.size || header.mtime != key.mtime ||
+	    header.step == 0 ||
+	    src.size() < plugin.size() + key.uri.size() ||
+	    memcmp(src.data(), plugin.data(), plugin.size()) != 0 ||
+	    memcmp(src.data() + plugin.size(), key.uri.data(),
+		   key.uri.size()) != 0)
+		return std::nullopt;
+
+	src = src.subspan(plugin.size() + key.uri.size());
+
+	/* each delta occupies at least one byte */
+	if (header.count > src.size())
+		return std::nullopt;
+
+	SeekIndex index;
+	index.step = header.step;
+	index.offsets.reserve(header.count);
+
+	uint64_t offset = 0;
+	for (uint64_t i = 0; i < header.count; ++i) {
+		uint64_t delta;
+		if (!ReadVarint(src, delta))
+			return std::nullopt;
+
+		offset += delta;
+		if (offset >= key.size)
+			return std::nullopt;
+
+		index.offsets.push_back(offset);
+	}
+
+	if (!src.empty())
+		return std::nullopt;
+
+	return index;
+}
+
+/**
+ * Calculate the 64 bit FNV-1a hash.  Unlike std::hash, this is
+ * guaranteed to be stable across builds, which is important because
+ * it is used for file names.
+ */
+static constexpr uint64_t
+FNV1aHash64(std::string_view s, uint64_t hash=0xcbf29ce484222325ULL) noexcept
+{
+	for (const char ch : s) {
+		hash ^= static_cast<unsigned char>(ch);
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+[[gnu::pure]]
+static bool
+IsCacheFileName(std::string_view name) noexcept
+{
+	return name.size() == 16 + 5 && name.ends_with(".seek");
+}
+
+/**
+ * A directory with one file per song.
+ */
+class SeekIndexCache {
+	const AllocatedPath directory;
+
+public:
+	explicit SeekIndexCache(AllocatedPath &&_directory)
+		:directory(std::move(_directory))
+	{
+		CreateDirectoryNoThrow(directory);
+
+		try {
+			Prune();
+		} catch (...) {
+			LogError(std::current_exception());
+		}
+	}
+
+	std::optional<SeekIndex> Load(std::string_view plugin,
+				      const SeekIndexKey &key);
+	void Store(std::string_view plugin, const SeekIndexKey &key,
+		   const SeekIndex &index);
+
+private:
+	AllocatedPath MakePath(std::string_view plugin,
+			       std::string_view uri) const noexcept {
+		/* the null byte separates the plugin name from the
+		   URI */
+		const uint64_t hash =
+			FNV1aHash64(uri, FNV1aHash64({plugin.data(),
+						      plugin.size() + 1}));
+		return directory /
+			AllocatedPath::FromUTF8(fmt::format("{:016x}.seek",
+							    hash));
+	}
+
+	/**
+	 * Delete the least recently stored files if there are more
+	 * than #MAX_FILES.
+	 */
+	void Prune();
+};
+
+void
+SeekIndexCache::Prune()
+{
+	struct Found {
+		AllocatedPath path;
+		std::chrono::system_clock::time_point mtime;
+	};
+
+	std::vector<Found> found;
+
+	DirectoryReader reader(directory);
+	while (reader.ReadEntry()) {
+		if (!IsCacheFileName(reader.GetEntry().ToUTF8()))
+			continue;
+
+		auto path = directory / reader.GetEntry();
+		FileInfo info;
+		if (!GetFileInfo(path, info, false) || !info.IsRegular())
+			continue;
+
+		found.push_back({std::move(path), info.GetModificationTime()});
+	}
+
+	if (found.size() <= MAX_FILES)
+		return;
+
+	/* the newest ones first */
+	std::sort(found.begin(), found.end(), [](const auto &a, const auto &b){
+		return a.mtime > b.mtime;
+	});
+
+	for (auto i = std::next(found.begin(), MAX_FILES);
+	     i != found.end(); ++i)
+		RemoveFile(i->path);
+
+	FmtDebug(seek_index_domain, "Deleted {} old files from {}",
+		 found.size() - MAX_FILES, directory);
+}
+
+inline std::optional<SeekIndex>
+SeekIndexCache::Load(std::string_view plugin, const SeekIndexKey &key)
+{
+	const auto path = MakePath(plugin, key.uri);
+	if (!FileExists(path))
+		return std::nullopt;
+
+	FileReader reader(path);
+	const uint64_t size = reader.GetSize();
+	if (size > MAX_FILE_SIZE)
+		throw FmtRuntimeError("Malformed seek index {}", path);
+
+	auto buffer = std::make_unique<std::byte[]>(size);
+	std::size_t position = 0;
+	while (position < size) {
+		const std::size_t nbytes =
+			reader.Read(buffer.get() + position, size - position);
+		if (nbytes == 0)
+			throw FmtRuntimeError("Unexpected end of file: {}",
+					      path);
+		position += nbytes;
+	}
+
+	auto index = ParseSeekIndex({buffer.get(), std::size_t(size)},
+				    plugin, key);
+	if (!index)
+		/* the song file has been modified (or this is a hash
+		   collision) */
+		RemoveFile(path);
+
+	return index;
+}
+
+inline void
+SeekIndexCache::Store(std::string_view plugin, const SeekIndexKey &key,
+		      const SeekIndex &index)
+{
+	const auto data = SerializeSeekIndex(plugin, key, index);
+
+	FileOutputStream fos(MakePath(plugin, key.uri));
+	fos.Write(data.data(), data.size());
+	fos.Commit();
+}
+
+static SeekIndexCache *seek_index_cache;
+
+void
+InitSeekIndexCache(const ConfigData &config)
+{
+	assert(seek_index_cache == nullptr);
+
+	auto directory = config.GetPath(ConfigOption::SEEK_INDEX_CACHE);
+	if (directory.IsNull())
+		return;
+
+	seek_index_cache = new SeekIndexCache(std::move(directory));
+}
+
+void
+DeinitSeekIndexCache() noexcept
+{
+	delete seek_index_cache;
+	seek_index_cache = nullptr;
+}
+
+/**
+ * Determine size and modification time of a local file.
+ */
+static std::optional<SeekIndexKey>
+GetLocalSeekIndexKey(Path path, std::string &&uri) noexcept
+{
+	FileInfo info;
+	if (!GetFileInfo(path, info) || !info.IsRegular())
+		return std::nullopt;
+
+	return SeekIndexKey{
+		std::move(uri),
+		info.GetSize(),
+		std::chrono::duration_cast<std::chrono::nanoseconds>(info.GetModificationTime().time_since_epoch()).count(),
+	};
+}
+
+std::optional<SeekIndexKey>
+GetSeekIndexKey(const InputStream &is) noexcept
+{
+	if (seek_index_cache == nullptr ||
+	    !is.IsSeekable() || !is.KnownSize())
+		return std::nullopt;
+
+	const char *uri = is.GetURI();
+	if (PathTraitsUTF8::IsAbsolute(uri)) {
+		const auto path = AllocatedPath::FromUTF8(uri);
+		if (path.IsNull())
+			return std::nullopt;
+
+		auto key = GetLocalSeekIndexKey(path, uri);
+		if (key && key->size != is.GetSize())
+			/* not the whole file, e.g. a CUE track or a
+			   member of a container */
+			return std::nullopt;
+
+		return key;
+	}
+
+	/* remote file: only the size can be verified */
+	return SeekIndexKey{uri, is.GetSize()};
+}
+
+std::optional<SeekIndexKey>
+GetSeekIndexKey(Path path) noexcept
+{
+	if (seek_index_cache == nullptr)
+		return std::nullopt;
+
+	return GetLocalSeekIndexKey(path, path.ToUTF8());
+}
+
+std::optional<SeekIndex>
+LoadSeekIndex(std::string_view plugin, const SeekIndexKey &key) noexcept
+try {
+	if (seek_index_cache == nullptr)
+		return std::nullopt;
+
+	auto index = seek_index_cache->Load(plugin, key);
+	if (index)
+		FmtDebug(seek_index_domain, "Loaded {} offsets for {}",
+			 index->size(), key.uri);
+	return index;
+} catch (...) {
+	LogError(std::current_exception(), "Failed to load seek index");
+	return std::nullopt;
+}
+
+void
+StoreSeekIndex(std::string_view plugin, const SeekIndexKey &key,
+	       const SeekIndex &index) noexcept
+try {
+	if (seek_index_cache == nullptr || index.empty())
+		return;
+
+	seek_index_cache->Store(plugin, key, index);
+	FmtDebug(seek_index_domain, "Stored {} offsets for {}",
+		 index.size(), key.uri);
+} catch (...) {
+	LogError(std::current_exception(), "Failed to store seek index");
+}
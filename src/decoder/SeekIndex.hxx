@@ -0,0 +1,146 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_SEEK_INDEX_HXX
+#define MPD_DECODER_SEEK_INDEX_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ConfigData;
+class InputStream;
+class Path;
+
+/**
+ * A table of byte offsets within a song file which allows a decoder
+ * plugin to seek without scanning the file.  The meaning of a
+ * "frame" is defined by the plugin (e.g. MPEG frames for "mad").
+ */
+struct SeekIndex {
+	/**
+	 * The number of frames between two #offsets.
+	 */
+	uint64_t step = 1;
+
+	/**
+	 * The byte offset of every #step-th frame; the first element
+	 * refers to frame 0.  The values are monotonically
+	 * increasing.
+	 */
+	std::vector<uint64_t> offsets;
+
+	bool empty() const noexcept {
+		return offsets.empty();
+	}
+
+	std::size_t size() const noexcept {
+		return offsets.size();
+	}
+};
+
+/**
+ * The identity of a song file in the seek index cache.  An index is
+ * only used if the file still has the same size and modification
+ * time.
+ */
+struct SeekIndexKey {
+	std::string uri;
+
+	uint64_t size;
+
+	/**
+	 * The modification time in nanoseconds since the epoch; 0 if
+	 * unknown (e.g. for remote files, where only the size is
+	 * checked).
+	 */
+	int64_t mtime = 0;
+};
+
+/**
+ * Serialize a #SeekIndex (including the #SeekIndexKey and the plugin
+ * name) to the cache file format.
+ */
+std::string
+SerializeSeekIndex(std::string_view plugin, const SeekIndexKey &key,
+		   const SeekIndex &index) noexcept;
+
+/**
+ * Parse the contents of a cache file created by
+ * SerializeSeekIndex().  Returns std::nullopt if it is malformed or
+ * if it does not match the given plugin and key.
+ */
+[[gnu::pure]]
+std::optional<SeekIndex>
+ParseSeekIndex(std::span<const std::byte> src,
+	       std::string_view plugin, const SeekIndexKey &key) noexcept;
+
+/**
+ * Set up the persistent seek index cache according to the
+ * "seek_index_cache" setting.  Does nothing if it is not set.
+ *
+ * Throws on error.
+ */
+void
+InitSeekIndexCache(const ConfigData &config);
+
+void
+DeinitSeekIndexCache() noexcept;
+
+/**
+ * Determine the #SeekIndexKey of the file behind this stream.
+ * Returns std::nullopt if the cache is disabled or if the stream is
+ * not suitable (e.g. not seekable or unknown size).
+ */
+std::optional<SeekIndexKey>
+GetSeekIndexKey(const InputStream &is) noexcept;
+
+/**
+ * Determine the #SeekIndexKey of a local file.  Returns std::nullopt
+ * if the cache is disabled or if the file is not accessible.
+ */
+std::optional<SeekIndexKey>
+GetSeekIndexKey(Path path) noexcept;
+
+/**
+ * Look up a stored index.  All errors are logged.
+ *
+ * This function is thread-safe.
+ *
+ * @param plugin the name of the decoder plugin which has created
+ * the index
+ */
+std::optional<SeekIndex>
+LoadSeekIndex(std::string_view plugin, const SeekIndexKey &key) noexcept;
+
+/**
+ * Store an index, replacing the previous one.  All errors are
+ * logged.
+ *
+ * This function is thread-safe.
+ */
+void
+StoreSeekIndex(std::string_view plugin, const SeekIndexKey &key,
+	       const SeekIndex &index) noexcept;
+
+#endif
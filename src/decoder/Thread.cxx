@@ -21,6 +21,7 @@
 #include "Control.hxx"
 #include "Bridge.hxx"
 #include "DecoderPlugin.hxx"
+#include "PluginCache.hxx"
 #include "song/DetachedSong.hxx"
 #include "MusicPipe.hxx"
 #include "fs/Traits.hxx"
@@ -38,6 +39,7 @@
 #include "util/ScopeExit.hxx"
 #include "util/StringCompare.hxx"
 #include "thread/Name.hxx"
+#include "thread/Profile.hxx"
 #include "tag/ApeReplayGain.hxx"
 #include "Log.hxx"
 
@@ -47,6 +49,13 @@
 
 static constexpr Domain decoder_thread_domain("decoder_thread");
 
+/**
+ * Remembers which plugin has decoded a URI, for a faster start the
+ * next time (e.g. repeated radio streams which need the fallback
+ * plugin).
+ */
+static DecoderPluginCache decoder_plugin_cache{256};
+
 /**
  * Decode a URI with the given decoder plugin.
  *
@@ -212,15 +221,27 @@ decoder_run_stream_plugin(DecoderBridge &bridge, InputStream &is,
 	return decoder_stream_decode(plugin, bridge, is, lock);
 }
 
+/**
+ * @param skip a plugin which has already been tried (or nullptr)
+ * @param plugin_r receives the plugin which has decoded the stream
+ */
 static bool
 decoder_run_stream_locked(DecoderBridge &bridge, InputStream &is,
 			  std::unique_lock<Mutex> &lock,
-			  const char *uri, bool &tried_r)
+			  const char *uri, const DecoderPlugin *skip,
+			  const DecoderPlugin *&plugin_r, bool &tried_r)
 {
 	const auto suffix = uri_get_suffix(uri);
 
-	const auto f = [&,suffix](const auto &plugin)
-		{ return decoder_run_stream_plugin(bridge, is, lock, suffix, plugin, tried_r); };
+	const auto f = [&,suffix](const auto &plugin) {
+		if (&plugin == skip ||
+		    !decoder_run_stream_plugin(bridge, is, lock, suffix,
+					       plugin, tried_r))
+			return false;
+
+		plugin_r = &plugin;
+		return true;
+	};
 
 	return decoder_plugins_try(f);
 }
@@ -230,7 +251,8 @@ decoder_run_stream_locked(DecoderBridge &bridge, InputStream &is,
  */
 static bool
 decoder_run_stream_fallback(DecoderBridge &bridge, InputStream &is,
-			    std::unique_lock<Mutex> &lock)
+			    std::unique_lock<Mutex> &lock,
+			    const DecoderPlugin *&plugin_r)
 {
 	const struct DecoderPlugin *plugin;
 
@@ -239,8 +261,40 @@ decoder_run_stream_fallback(DecoderBridge &bridge, InputStream &is,
 #else
 	plugin = decoder_plugin_from_name("mad");
 #endif
-	return plugin != nullptr && plugin->stream_decode != nullptr &&
-		decoder_stream_decode(*plugin, bridge, is, lock);
+	if (plugin == nullptr || plugin->stream_decode == nullptr ||
+	    !decoder_stream_decode(*plugin, bridge, is, lock))
+		return false;
+
+	plugin_r = plugin;
+	return true;
+}
+
+/**
+ * Try the plugin which has decoded this URI last time (see
+ * #decoder_plugin_cache), skipping the MIME type and suffix checks.
+ *
+ * Caller holds DecoderControl::mutex.
+ *
+ * @return the plugin which was tried (or nullptr if there is no
+ * cached plugin) and whether it was successful
+ */
+static std::pair<const DecoderPlugin *, bool>
+TryCachedStreamPlugin(DecoderBridge &bridge, InputStream &is,
+		      std::unique_lock<Mutex> &lock, const char *uri)
+{
+	const auto *plugin = decoder_plugin_cache.Get(uri);
+	if (plugin == nullptr || plugin->stream_decode == nullptr)
+		return {nullptr, false};
+
+	bridge.Reset();
+
+	if (decoder_stream_decode(*plugin, bridge, is, lock))
+		return {plugin, true};
+
+	/* this plugin doesn't like the stream anymore; forget it
+	   and probe all plugins */
+	decoder_plugin_cache.Remove(uri);
+	return {plugin, false};
 }
 
 /**
@@ -314,14 +368,29 @@ decoder_run_stream(DecoderBridge &bridge, const char *uri)
 
 	std::unique_lock<Mutex> lock(dc.mutex);
 
+	if (dc.command == DecoderCommand::STOP)
+		return true;
+
+	const auto [cached, cached_success] =
+		TryCachedStreamPlugin(bridge, *input_stream, lock, uri);
+	if (cached_success)
+		return true;
+
+	const DecoderPlugin *plugin = nullptr;
 	bool tried = false;
-	return dc.command == DecoderCommand::STOP ||
-		decoder_run_stream_locked(bridge, *input_stream, lock, uri,
-					  tried) ||
-		/* fallback to mp3: this is needed for bastard streams
-		   that don't have a suffix or set the mimeType */
-		(!tried &&
-		 decoder_run_stream_fallback(bridge, *input_stream, lock));
+	if (decoder_run_stream_locked(bridge, *input_stream, lock, uri,
+				      cached, plugin, tried) ||
+	    /* fallback to mp3: this is needed for bastard streams
+	       that don't have a suffix or set the mimeType */
+	    (!tried && cached == nullptr &&
+	     decoder_run_stream_fallback(bridge, *input_stream, lock,
+					 plugin))) {
+		if (plugin != nullptr)
+			decoder_plugin_cache.Put(uri, *plugin);
+		return true;
+	}
+
+	return false;
 }
 
 /**
@@ -425,13 +494,28 @@ decoder_run_file(DecoderBridge &bridge, const char *uri_utf8, Path path_fs)
 	MaybeLoadReplayGain(bridge, *input_stream);
 
 	auto &is = *input_stream;
-	return decoder_plugins_try([&bridge, path_fs, suffix,
-				    &is](const DecoderPlugin &plugin){
-					   return TryDecoderFile(bridge,
-								 path_fs,
-								 suffix,
-								 is,
-								 plugin);
+
+	const auto *cached = decoder_plugin_cache.Get(uri_utf8);
+	if (cached != nullptr) {
+		if (TryDecoderFile(bridge, path_fs, suffix, is, *cached))
+			return true;
+
+		decoder_plugin_cache.Remove(uri_utf8);
+	}
+
+	return decoder_plugins_try([&bridge, path_fs, suffix, &is, cached,
+				    uri_utf8](const DecoderPlugin &plugin){
+					   if (&plugin == cached ||
+					       !TryDecoderFile(bridge,
+							       path_fs,
+							       suffix,
+							       is,
+							       plugin))
+						   return false;
+
+					   decoder_plugin_cache.Put(uri_utf8,
+								    plugin);
+					   return true;
 				   });
 }
 
@@ -507,8 +591,12 @@ decoder_run_song(DecoderControl &dc,
 			bridge.CheckFlushChunk();
 		};
 
+		bridge.LoadAnalysis();
+
 		success = DecoderUnlockedRunUri(bridge, uri, path_fs);
 
+		if (success)
+			bridge.FinishAnalysis();
 	}
 
 	bridge.CheckRethrowError();
@@ -561,6 +649,13 @@ DecoderControl::RunThread() noexcept
 {
 	SetThreadName("decoder");
 
+	try {
+		ApplyThreadProfile(ThreadProfileType::DECODER);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to apply the decoder thread profile");
+	}
+
 	std::unique_lock<Mutex> lock(mutex);
 
 	do {
@@ -574,6 +669,7 @@ DecoderControl::RunThread() noexcept
 			replay_gain_db = 0;
 
 			decoder_run(*this);
+			CancelContinuation();
 
 			if (state == DecoderState::ERROR) {
 				try {
@@ -595,6 +691,7 @@ DecoderControl::RunThread() noexcept
 			pipe->Clear();
 
 			decoder_run(*this);
+			CancelContinuation();
 			break;
 
 		case DecoderCommand::STOP:
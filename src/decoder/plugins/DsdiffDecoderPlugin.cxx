@@ -350,13 +350,6 @@ dsdiff_read_metadata(DecoderClient *client, InputStream &is,
 	}
 }
 
-static void
-bit_reverse_buffer(uint8_t *p, uint8_t *end)
-{
-	for (; p < end; ++p)
-		*p = bit_reverse(*p);
-}
-
 static offset_type
 FrameToOffset(uint64_t frame, unsigned channels)
 {
@@ -415,7 +408,7 @@ dsdiff_decode_chunk(DecoderClient &client, InputStream &is,
 		remaining_bytes -= nbytes;
 
 		if (lsbitfirst)
-			bit_reverse_buffer(buffer, buffer + nbytes);
+			BitReverse(buffer, nbytes);
 
 		cmd = client.SubmitAudio(is, std::span{buffer, nbytes},
 					 kbit_rate);
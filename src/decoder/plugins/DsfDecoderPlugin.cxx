@@ -32,6 +32,7 @@
 #include "../DecoderAPI.hxx"
 #include "input/InputStream.hxx"
 #include "pcm/CheckAudioFormat.hxx"
+#include "pcm/Interleave.hxx"
 #include "util/BitReverse.hxx"
 #include "util/ByteOrder.hxx"
 #include "DsdLib.hxx"
@@ -180,64 +181,25 @@ dsf_read_metadata(DecoderClient *client, InputStream &is,
 	return true;
 }
 
-static void
-bit_reverse_buffer(uint8_t *p, uint8_t *end)
-{
-	for (; p < end; ++p)
-		*p = bit_reverse(*p);
-}
-
-static void
-InterleaveDsfBlockMono(uint8_t *gcc_restrict dest,
-		       const uint8_t *gcc_restrict src)
-{
-	memcpy(dest, src, DSF_BLOCK_SIZE);
-}
-
 /**
- * DSF data is build up of alternating 4096 blocks of DSD samples for left and
- * right. Convert the buffer holding 1 block of 4096 DSD left samples and 1
- * block of 4096 DSD right samples to 8k of samples in normal PCM left/right
- * order.
+ * DSF data is build up of alternating 4096 byte blocks of DSD
+ * samples for each channel.  Convert the buffer holding one block of
+ * each channel to samples in normal PCM order.
  */
 static void
-InterleaveDsfBlockStereo(uint8_t *gcc_restrict dest,
-			 const uint8_t *gcc_restrict src)
+InterleaveDsfBlock(uint8_t *gcc_restrict dest, const uint8_t *gcc_restrict src,
+		   unsigned channels)
 {
-	for (size_t i = 0; i < DSF_BLOCK_SIZE; ++i) {
-		dest[2 * i] = src[i];
-		dest[2 * i + 1] = src[DSF_BLOCK_SIZE + i];
+	if (channels == 1) {
+		memcpy(dest, src, DSF_BLOCK_SIZE);
+		return;
 	}
-}
 
-static void
-InterleaveDsfBlockChannel(uint8_t *gcc_restrict dest,
-			  const uint8_t *gcc_restrict src,
-			  unsigned channels)
-{
-	for (size_t i = 0; i < DSF_BLOCK_SIZE; ++i, dest += channels, ++src)
-		*dest = *src;
-}
+	const void *planes[MAX_CHANNELS];
+	for (unsigned c = 0; c < channels; ++c)
+		planes[c] = src + c * DSF_BLOCK_SIZE;
 
-static void
-InterleaveDsfBlockGeneric(uint8_t *gcc_restrict dest,
-			  const uint8_t *gcc_restrict src,
-			  unsigned channels)
-{
-	for (unsigned c = 0; c < channels; ++c, ++dest, src += DSF_BLOCK_SIZE)
-		InterleaveDsfBlockChannel(dest, src, channels);
-}
-
-static void
-InterleaveDsfBlock(uint8_t *gcc_restrict dest, const uint8_t *gcc_restrict src,
-		   unsigned channels)
-{
-	if (channels == 1)
-		InterleaveDsfBlockMono(dest, src);
-	else if (channels == 2)
-		InterleaveDsfBlockStereo(dest, src);
-	else
-		InterleaveDsfBlockGeneric(dest, src, channels);
+	PcmInterleave(dest, {planes, channels}, DSF_BLOCK_SIZE, 1);
 }
 
 static offset_type
@@ -284,7 +246,7 @@ dsf_decode_chunk(DecoderClient &client, InputStream &is,
 			return false;
 
 		if (bitreverse)
-			bit_reverse_buffer(buffer, buffer + block_size);
+			BitReverse(buffer, block_size);
 
 		uint8_t interleaved_buffer[MAX_CHANNELS * DSF_BLOCK_SIZE];
 		InterleaveDsfBlock(interleaved_buffer, buffer, channels);
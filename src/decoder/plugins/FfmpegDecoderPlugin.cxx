@@ -28,6 +28,7 @@
 #include "lib/ffmpeg/Interleave.hxx"
 #include "lib/ffmpeg/Buffer.hxx"
 #include "lib/ffmpeg/Frame.hxx"
+#include "lib/ffmpeg/Packet.hxx"
 #include "lib/ffmpeg/Format.hxx"
 #include "lib/ffmpeg/Codec.hxx"
 #include "lib/ffmpeg/SampleFormat.hxx"
@@ -38,6 +39,7 @@
 #include "pcm/Interleave.hxx"
 #include "tag/Builder.hxx"
 #include "tag/Handler.hxx"
+#include "tag/Mp4.hxx"
 #include "tag/ReplayGainParser.hxx"
 #include "tag/MixRampParser.hxx"
 #include "input/InputStream.hxx"
@@ -63,6 +65,12 @@ extern "C" {
  */
 static AVDictionary *avformat_options = nullptr;
 
+/**
+ * The "threads" setting: the number of decoder threads for codecs
+ * which support multi-threading; 0 lets FFmpeg choose.
+ */
+static unsigned ffmpeg_threads;
+
 static Ffmpeg::FormatContext
 FfmpegOpenInput(AVIOContext *pb,
 		const char *filename,
@@ -79,6 +87,27 @@ FfmpegOpenInput(AVIOContext *pb,
 	return context;
 }
 
+/**
+ * Enable multi-threaded decoding if the codec supports it.
+ */
+static void
+FfmpegSetupThreads(AVCodecContext &codec_context,
+		   const AVCodec &codec) noexcept
+{
+	int thread_type = 0;
+	if (codec.capabilities & AV_CODEC_CAP_FRAME_THREADS)
+		thread_type |= FF_THREAD_FRAME;
+	if (codec.capabilities & AV_CODEC_CAP_SLICE_THREADS)
+		thread_type |= FF_THREAD_SLICE;
+
+	if (thread_type == 0 || ffmpeg_threads == 1)
+		/* single-threaded */
+		return;
+
+	codec_context.thread_count = ffmpeg_threads;
+	codec_context.thread_type = thread_type;
+}
+
 static bool
 ffmpeg_init(const ConfigBlock &block)
 {
@@ -95,6 +124,8 @@ ffmpeg_init(const ConfigBlock &block)
 			av_dict_set(&avformat_options, name, value, 0);
 	}
 
+	ffmpeg_threads = block.GetBlockValue("threads", 0U);
+
 	return true;
 }
 
@@ -178,14 +209,15 @@ start_time_fallback(const AVStream &stream)
 }
 
 /**
- * Convert AVPacket::pts to a stream-relative time stamp (still in
- * AVStream::time_base units).  Returns a negative value on error.
+ * Convert AVFrame::best_effort_timestamp to a stream-relative time
+ * stamp (still in AVStream::time_base units).  Returns a negative
+ * value on error.
  */
 gcc_pure
 static int64_t
-StreamRelativePts(const AVPacket &packet, const AVStream &stream) noexcept
+StreamRelativePts(const AVFrame &frame, const AVStream &stream) noexcept
 {
-	auto pts = packet.pts;
+	auto pts = frame.best_effort_timestamp;
 	if (pts < 0 || pts == int64_t(AV_NOPTS_VALUE))
 		return -1;
 
@@ -205,6 +237,29 @@ PtsToPcmFrame(uint64_t pts, const AVStream &stream,
 	return av_rescale_q(pts, stream.time_base, codec_context.time_base);
 }
 
+/**
+ * The state of the exact seek: after seeking, all data before the
+ * destination is skipped.
+ */
+struct FfmpegSkip {
+	/**
+	 * Skip all data before this PCM frame number; this is used
+	 * after seeking to skip data until the exact desired time
+	 * stamp has been reached.  It is evaluated with the time
+	 * stamp of the first #AVFrame after seeking, which (with
+	 * frame threading) may be received only after several more
+	 * packets have been sent.
+	 */
+	uint64_t min_frame = 0;
+
+	/**
+	 * The number of bytes still to be skipped.
+	 */
+	size_t bytes = 0;
+
+	size_t pcm_frame_size;
+};
+
 /**
  * Invoke DecoderClient::SubmitAudio() with the contents of an
  * #AVFrame.
@@ -212,10 +267,28 @@ PtsToPcmFrame(uint64_t pts, const AVStream &stream,
 static DecoderCommand
 FfmpegSendFrame(DecoderClient &client, InputStream *is,
 		AVCodecContext &codec_context,
+		const AVStream &stream,
 		const AVFrame &frame,
-		size_t &skip_bytes,
+		FfmpegSkip &skip,
 		FfmpegBuffer &buffer)
 {
+	const auto pts = StreamRelativePts(frame, stream);
+	if (skip.min_frame > 0) {
+		if (pts >= 0) {
+			auto cur_frame = PtsToPcmFrame(pts, stream,
+						       codec_context);
+			if (cur_frame < skip.min_frame)
+				skip.bytes = skip.pcm_frame_size
+					* (skip.min_frame - cur_frame);
+		}
+
+		skip.min_frame = 0;
+	} else if (pts >= 0)
+		client.SubmitTimestamp(FfmpegTimeToDouble(pts,
+							  stream.time_base));
+
+	size_t &skip_bytes = skip.bytes;
+
 	auto output_buffer = Ffmpeg::InterleaveFrame(frame, buffer);
 
 	if (skip_bytes > 0) {
@@ -235,8 +308,9 @@ FfmpegSendFrame(DecoderClient &client, InputStream *is,
 static DecoderCommand
 FfmpegReceiveFrames(DecoderClient &client, InputStream *is,
 		    AVCodecContext &codec_context,
+		    const AVStream &stream,
 		    AVFrame &frame,
-		    size_t &skip_bytes,
+		    FfmpegSkip &skip,
 		    FfmpegBuffer &buffer,
 		    bool &eof)
 {
@@ -247,7 +321,7 @@ FfmpegReceiveFrames(DecoderClient &client, InputStream *is,
 		switch (err) {
 		case 0:
 			cmd = FfmpegSendFrame(client, is, codec_context,
-					      frame, skip_bytes,
+					      stream, frame, skip,
 					      buffer);
 			if (cmd != DecoderCommand::NONE)
 				return cmd;
@@ -279,10 +353,6 @@ FfmpegReceiveFrames(DecoderClient &client, InputStream *is,
 /**
  * Decode an #AVPacket and send the resulting PCM data to the decoder
  * API.
- *
- * @param min_frame skip all data before this PCM frame number; this
- * is used after seeking to skip data in an AVPacket until the exact
- * desired time stamp has been reached
  */
 static DecoderCommand
 ffmpeg_send_packet(DecoderClient &client, InputStream *is,
@@ -290,23 +360,9 @@ ffmpeg_send_packet(DecoderClient &client, InputStream *is,
 		   AVCodecContext &codec_context,
 		   const AVStream &stream,
 		   AVFrame &frame,
-		   uint64_t min_frame, size_t pcm_frame_size,
+		   FfmpegSkip &skip,
 		   FfmpegBuffer &buffer)
 {
-	size_t skip_bytes = 0;
-
-	const auto pts = StreamRelativePts(packet, stream);
-	if (pts >= 0) {
-		if (min_frame > 0) {
-			auto cur_frame = PtsToPcmFrame(pts, stream,
-						       codec_context);
-			if (cur_frame < min_frame)
-				skip_bytes = pcm_frame_size * (min_frame - cur_frame);
-		} else
-			client.SubmitTimestamp(FfmpegTimeToDouble(pts,
-								  stream.time_base));
-	}
-
 	bool eof = false;
 
 	int err = avcodec_send_packet(&codec_context, &packet);
@@ -330,8 +386,8 @@ ffmpeg_send_packet(DecoderClient &client, InputStream *is,
 	}
 
 	auto cmd = FfmpegReceiveFrames(client, is, codec_context,
-				       frame,
-				       skip_bytes, buffer, eof);
+				       stream, frame,
+				       skip, buffer, eof);
 
 	if (eof)
 		cmd = DecoderCommand::STOP;
@@ -512,6 +568,7 @@ FfmpegDecode(DecoderClient &client, InputStream *input,
 
 	Ffmpeg::CodecContext codec_context(*codec);
 	codec_context.FillFromParameters(*av_stream.codecpar);
+	FfmpegSetupThreads(*codec_context, *codec);
 	codec_context.Open(*codec, nullptr);
 
 	const SampleFormat sample_format =
@@ -543,11 +600,14 @@ FfmpegDecode(DecoderClient &client, InputStream *input,
 
 	FfmpegParseMetaData(client, format_context, audio_stream);
 
+	/* these are reused for all packets */
+	Ffmpeg::Packet packet;
 	Ffmpeg::Frame frame;
 
 	FfmpegBuffer interleaved_buffer;
 
-	uint64_t min_frame = 0;
+	FfmpegSkip skip;
+	skip.pcm_frame_size = audio_format.GetFrameSize();
 
 	DecoderCommand cmd = client.GetCommand();
 	while (cmd != DecoderCommand::STOP) {
@@ -565,31 +625,41 @@ FfmpegDecode(DecoderClient &client, InputStream *input,
 				client.SeekError();
 			else {
 				codec_context.FlushBuffers();
-				min_frame = client.GetSeekFrame();
+				skip.min_frame = client.GetSeekFrame();
+				skip.bytes = 0;
 				client.CommandFinished();
 			}
 		}
 
-		AVPacket packet;
-		if (av_read_frame(&format_context, &packet) < 0)
-			/* end of file */
+		if (av_read_frame(&format_context, packet.get()) < 0) {
+			/* end of file: drain the frames which are
+			   still buffered inside the decoder (e.g. by
+			   frame threading) */
+			if (avcodec_send_packet(&*codec_context, nullptr) == 0) {
+				bool eof = false;
+				FfmpegReceiveFrames(client, input,
+						    *codec_context,
+						    av_stream,
+						    *frame, skip,
+						    interleaved_buffer, eof);
+			}
+
 			break;
+		}
 
 		AtScopeExit(&packet) {
-			av_packet_unref(&packet);
+			packet.Unref();
 		};
 
 		FfmpegCheckTag(client, input, format_context, audio_stream);
 
-		if (packet.size > 0 && packet.stream_index == audio_stream) {
+		if (packet->size > 0 && packet->stream_index == audio_stream) {
 			cmd = ffmpeg_send_packet(client, input,
-						 packet,
+						 *packet,
 						 *codec_context,
 						 av_stream,
-						 *frame,
-						 min_frame, audio_format.GetFrameSize(),
+						 *frame, skip,
 						 interleaved_buffer);
-			min_frame = 0;
 		} else
 			cmd = client.GetCommand();
 	}
@@ -668,6 +738,19 @@ FfmpegScanStream(AVFormatContext &format_context, TagHandler &handler)
 static bool
 ffmpeg_scan_stream(InputStream &is, TagHandler &handler)
 {
+	if (is.IsSeekable()) {
+		/* try the lightweight MP4 parser first, which only
+		   reads the "moov" box; if that fails, rewind and let
+		   libavformat do it */
+		try {
+			if (ScanMp4(is, handler))
+				return true;
+		} catch (...) {
+		}
+
+		is.LockRewind();
+	}
+
 	AvioStream stream(nullptr, is);
 	if (!stream.Open())
 		return false;
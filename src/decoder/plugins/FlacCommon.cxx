@@ -26,6 +26,7 @@
 #include "Log.hxx"
 #include "input/InputStream.hxx"
 
+#include <algorithm>
 #include <exception>
 
 bool
@@ -144,10 +145,48 @@ FlacDecoder::OnWrite(const FLAC__Frame &frame,
 	if (!initialized && !OnFirstFrame(frame.header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	chunk = pcm_import.Import(buf, frame.header.blocksize);
-
 	kbit_rate = nbytes * 8 * frame.header.sample_rate /
 		(1000 * frame.header.blocksize);
 
+	const size_t n_frames = frame.header.blocksize;
+	size_t offset = 0;
+
+	if (tag.IsEmpty())
+		/* no tag needs to be submitted first: deinterleave
+		   directly into the MusicChunk */
+		offset = WriteDirect(buf, n_frames);
+
+	if (offset < n_frames)
+		/* the rest goes into our own buffer, to be submitted
+		   by SubmitAudio() */
+		chunk = pcm_import.Import(buf, offset, n_frames - offset);
+
 	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
+
+inline size_t
+FlacDecoder::WriteDirect(const FLAC__int32 *const buf[],
+			 size_t n_frames) noexcept
+{
+	auto &decoder_client = *GetClient();
+	auto &is = GetInputStream();
+	const size_t frame_size = pcm_import.GetAudioFormat().GetFrameSize();
+
+	size_t offset = 0;
+	while (offset < n_frames) {
+		const auto dest = decoder_client.WriteAudio(is, kbit_rate);
+		if (dest.empty())
+			break;
+
+		const size_t n = std::min(dest.size() / frame_size,
+					  n_frames - offset);
+		pcm_import.Import(dest.data(), buf, offset, n);
+		offset += n;
+
+		if (decoder_client.CommitAudio(n * frame_size) != DecoderCommand::NONE)
+			/* let SubmitAudio() handle the command */
+			break;
+	}
+
+	return offset;
+}
@@ -61,9 +61,10 @@ struct FlacDecoder : public FlacInput {
 	Tag tag;
 
 	/**
-	 * Decoded PCM data obtained by our libFLAC write callback.
-	 * If this is non-empty, then DecoderBridge::SubmitAudio()
-	 * should be called.
+	 * Decoded PCM data obtained by our libFLAC write callback
+	 * which could not be written directly to the MusicChunk.  If
+	 * this is non-empty, then DecoderBridge::SubmitAudio() should
+	 * be called.
 	 */
 	std::span<const std::byte> chunk = {};
 
@@ -101,6 +102,15 @@ private:
 	 * (e.g. when seeking with SqueezeBox Server).
 	 */
 	bool OnFirstFrame(const FLAC__FrameHeader &header) noexcept;
+
+	/**
+	 * Deinterleave as many frames as possible directly into
+	 * buffers obtained from DecoderClient::WriteAudio().
+	 *
+	 * @return the number of frames which were written
+	 */
+	size_t WriteDirect(const FLAC__int32 *const buf[],
+			   size_t n_frames) noexcept;
 };
 
 #endif /* _FLAC_COMMON_H */
@@ -22,8 +22,11 @@
 #include "FlacDomain.hxx"
 #include "FlacCommon.hxx"
 #include "lib/xiph/FlacMetadataChain.hxx"
+#include "lib/xiph/FlacHeader.hxx"
 #include "OggCodec.hxx"
 #include "input/InputStream.hxx"
+#include "input/LocalOpen.hxx"
+#include "thread/Mutex.hxx"
 #include "fs/Path.hxx"
 #include "fs/NarrowPath.hxx"
 #include "Log.hxx"
@@ -73,6 +76,16 @@ flac_write_cb(const FLAC__StreamDecoder *dec, const FLAC__Frame *frame,
 static bool
 flac_scan_file(Path path_fs, TagHandler &handler) noexcept
 {
+	/* try the lightweight parser first, which reads only the
+	   metadata blocks we need; libFLAC loads all of them */
+	try {
+		Mutex mutex;
+		auto is = OpenLocalInputStream(path_fs, mutex);
+		if (ScanFlacHeader(*is, handler))
+			return true;
+	} catch (...) {
+	}
+
 	FlacMetadataChain chain;
 	if (!chain.Read(NarrowPath(path_fs))) {
 		FmtDebug(flac_domain,
@@ -88,6 +101,20 @@ flac_scan_file(Path path_fs, TagHandler &handler) noexcept
 static bool
 flac_scan_stream(InputStream &is, TagHandler &handler) noexcept
 {
+	if (is.IsSeekable()) {
+		try {
+			if (ScanFlacHeader(is, handler))
+				return true;
+		} catch (...) {
+		}
+
+		try {
+			is.LockRewind();
+		} catch (...) {
+			return false;
+		}
+	}
+
 	FlacMetadataChain chain;
 	if (!chain.Read(is)) {
 		FmtDebug(flac_domain,
@@ -19,10 +19,15 @@
 
 #include "FlacPcm.hxx"
 #include "pcm/CheckAudioFormat.hxx"
+#include "pcm/Interleave.hxx"
 #include "lib/xiph/FlacAudioFormat.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 
+#include <FLAC/format.h>
+
+#include <array>
 #include <cassert>
+#include <type_traits>
 
 void
 FlacPcmImport::Open(unsigned sample_rate, unsigned bits_per_sample,
@@ -39,9 +44,9 @@ FlacPcmImport::Open(unsigned sample_rate, unsigned bits_per_sample,
 template<typename T>
 static void
 FlacImportStereo(T *dest, const FLAC__int32 *const src[],
-		 size_t n_frames) noexcept
+		 size_t offset, size_t n_frames) noexcept
 {
-	for (size_t i = 0; i != n_frames; ++i) {
+	for (size_t i = offset, end = offset + n_frames; i != end; ++i) {
 		*dest++ = (T)src[0][i];
 		*dest++ = (T)src[1][i];
 	}
@@ -49,53 +54,58 @@ FlacImportStereo(T *dest, const FLAC__int32 *const src[],
 
 template<typename T>
 static void
-FlacImportAny(T *dest, const FLAC__int32 *const src[], size_t n_frames,
+FlacImportAny(T *dest, const FLAC__int32 *const src[],
+	      size_t offset, size_t n_frames,
 	      unsigned n_channels) noexcept
 {
-	for (size_t i = 0; i != n_frames; ++i)
+	for (size_t i = offset, end = offset + n_frames; i != end; ++i)
 		for (unsigned c = 0; c != n_channels; ++c)
 			*dest++ = src[c][i];
 }
 
 template<typename T>
 static void
-FlacImport(T *dest, const FLAC__int32 *const src[], size_t n_frames,
+FlacImport(T *dest, const FLAC__int32 *const src[],
+	   size_t offset, size_t n_frames,
 	   unsigned n_channels) noexcept
 {
 	if (n_channels == 2)
-		FlacImportStereo(dest, src, n_frames);
+		FlacImportStereo(dest, src, offset, n_frames);
 	else
-		FlacImportAny(dest, src, n_frames, n_channels);
+		FlacImportAny(dest, src, offset, n_frames, n_channels);
 }
 
-template<typename T>
-static std::span<const std::byte>
-FlacImport(PcmBuffer &buffer, const FLAC__int32 *const src[], size_t n_frames,
-	   unsigned n_channels) noexcept
+void
+FlacPcmImport::Import(std::byte *dest, const FLAC__int32 *const src[],
+		      size_t offset, size_t n_frames) const noexcept
 {
-	size_t n_samples = n_frames * n_channels;
-	size_t dest_size = n_samples * sizeof(T);
-	T *dest = (T *)buffer.Get(dest_size);
-	FlacImport(dest, src, n_frames, n_channels);
-	return std::as_bytes(std::span{dest, n_samples});
-}
+	static_assert(std::is_same_v<FLAC__int32, int32_t>);
+
+	/* the PcmInterleave32*() functions don't know about the
+	   offset */
+	std::array<const int32_t *, FLAC__MAX_CHANNELS> planes_buffer;
+	for (unsigned c = 0; c < audio_format.channels; ++c)
+		planes_buffer[c] = src[c] + offset;
+
+	const std::span<const int32_t *const> planes{
+		planes_buffer.data(),
+		audio_format.channels,
+	};
 
-std::span<const std::byte>
-FlacPcmImport::Import(const FLAC__int32 *const src[], size_t n_frames) noexcept
-{
 	switch (audio_format.format) {
 	case SampleFormat::S16:
-		return FlacImport<int16_t>(buffer, src, n_frames,
-					   audio_format.channels);
+		PcmInterleave32To16((int16_t *)dest, planes, n_frames);
+		return;
 
 	case SampleFormat::S24_P32:
 	case SampleFormat::S32:
-		return FlacImport<int32_t>(buffer, src, n_frames,
-					   audio_format.channels);
+		PcmInterleave32((int32_t *)dest, planes, n_frames);
+		return;
 
 	case SampleFormat::S8:
-		return FlacImport<int8_t>(buffer, src, n_frames,
-					  audio_format.channels);
+		FlacImport((int8_t *)dest, src, offset, n_frames,
+			   audio_format.channels);
+		return;
 
 	case SampleFormat::FLOAT:
 	case SampleFormat::DSD:
@@ -106,3 +116,13 @@ FlacPcmImport::Import(const FLAC__int32 *const src[], size_t n_frames) noexcept
 	assert(false);
 	gcc_unreachable();
 }
+
+std::span<const std::byte>
+FlacPcmImport::Import(const FLAC__int32 *const src[],
+		      size_t offset, size_t n_frames) noexcept
+{
+	const size_t dest_size = n_frames * audio_format.GetFrameSize();
+	auto *dest = (std::byte *)buffer.Get(dest_size);
+	Import(dest, src, offset, n_frames);
+	return {dest, dest_size};
+}
@@ -48,8 +48,23 @@ public:
 		return audio_format;
 	}
 
+	/**
+	 * Import the given frames into the internal buffer.
+	 *
+	 * @param offset the index of the first source frame
+	 */
 	std::span<const std::byte> Import(const FLAC__int32 *const src[],
+					  size_t offset,
 					  size_t n_frames) noexcept;
+
+	/**
+	 * Import the given frames into a caller-provided buffer,
+	 * which must be large enough.
+	 *
+	 * @param offset the index of the first source frame
+	 */
+	void Import(std::byte *dest, const FLAC__int32 *const src[],
+		    size_t offset, size_t n_frames) const noexcept;
 };
 
 #endif
@@ -22,11 +22,14 @@
 #include "pcm/CheckAudioFormat.hxx"
 #include "fs/Path.hxx"
 #include "lib/fmt/RuntimeError.hxx"
+#include "thread/Mutex.hxx"
 #include "util/Domain.hxx"
 #include "Log.hxx"
 
 #include <fluidsynth.h>
 
+#include <memory>
+
 static constexpr Domain fluidsynth_domain("fluidsynth");
 
 static unsigned sample_rate;
@@ -34,6 +37,43 @@ static double gain = 0.0;
 static bool gain_set = false;
 static const char *soundfont_path;
 
+namespace {
+
+/**
+ * A synthesizer with the soundfont loaded.  Loading a soundfont can
+ * take a long time, so this object is kept after a song has
+ * finished, to be reused by the next one.
+ */
+struct FluidsynthInstance {
+	fluid_settings_t *const settings;
+	fluid_synth_t *const synth;
+
+	FluidsynthInstance(fluid_settings_t *_settings,
+			   fluid_synth_t *_synth) noexcept
+		:settings(_settings), synth(_synth) {}
+
+	~FluidsynthInstance() noexcept {
+		delete_fluid_synth(synth);
+		delete_fluid_settings(settings);
+	}
+
+	FluidsynthInstance(const FluidsynthInstance &) = delete;
+	FluidsynthInstance &operator=(const FluidsynthInstance &) = delete;
+};
+
+} // anonymous namespace
+
+/**
+ * Protects #idle_instance.
+ */
+static Mutex instance_mutex;
+
+/**
+ * An instance which is not currently being used by a decoder
+ * thread.
+ */
+static std::unique_ptr<FluidsynthInstance> idle_instance;
+
 /**
  * Convert a fluidsynth log level to a MPD log level.
  */
@@ -104,7 +144,18 @@ fluidsynth_init(const ConfigBlock &block)
 }
 
 static void
-fluidsynth_file_decode(DecoderClient &client, Path path_fs)
+fluidsynth_finish() noexcept
+{
+	idle_instance.reset();
+}
+
+/**
+ * Create a new #FluidsynthInstance and load the soundfont.
+ *
+ * @return the new instance or nullptr on error
+ */
+static std::unique_ptr<FluidsynthInstance>
+CreateInstance() noexcept
 {
 	char setting_sample_rate[] = "synth.sample-rate";
 	char setting_gain[] = "synth.gain";
@@ -114,14 +165,13 @@ fluidsynth_file_decode(DecoderClient &client, Path path_fs)
 	*/
 	fluid_settings_t *settings;
 	fluid_synth_t *synth;
-	fluid_player_t *player;
 	int ret;
 
 	/* set up fluid settings */
 
 	settings = new_fluid_settings();
 	if (settings == nullptr)
-		return;
+		return nullptr;
 
 	fluid_settings_setnum(settings, setting_sample_rate, sample_rate);
 	if (gain_set) {
@@ -137,7 +187,7 @@ fluidsynth_file_decode(DecoderClient &client, Path path_fs)
 	synth = new_fluid_synth(settings);
 	if (synth == nullptr) {
 		delete_fluid_settings(settings);
-		return;
+		return nullptr;
 	}
 
 	ret = fluid_synth_sfload(synth, soundfont_path, true);
@@ -145,24 +195,70 @@ fluidsynth_file_decode(DecoderClient &client, Path path_fs)
 		LogWarning(fluidsynth_domain, "fluid_synth_sfload() failed");
 		delete_fluid_synth(synth);
 		delete_fluid_settings(settings);
-		return;
+		return nullptr;
 	}
 
+	return std::make_unique<FluidsynthInstance>(settings, synth);
+}
+
+/**
+ * Obtain exclusive ownership of a #FluidsynthInstance: take the idle
+ * one or create a new one.
+ *
+ * @return the instance or nullptr on error
+ */
+static std::unique_ptr<FluidsynthInstance>
+ObtainInstance() noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(instance_mutex);
+		if (idle_instance)
+			return std::move(idle_instance);
+	}
+
+	return CreateInstance();
+}
+
+/**
+ * Give back an instance obtained by ObtainInstance(), to be reused
+ * by the next song.  If there is already an idle instance (because
+ * two decoder threads have been playing MIDI files concurrently),
+ * this one is deleted.
+ */
+static void
+ReleaseInstance(std::unique_ptr<FluidsynthInstance> instance) noexcept
+{
+	/* stop all voices and restore the initial MIDI state */
+	fluid_synth_system_reset(instance->synth);
+
+	const std::scoped_lock<Mutex> lock(instance_mutex);
+	if (!idle_instance)
+		idle_instance = std::move(instance);
+}
+
+static void
+fluidsynth_file_decode(DecoderClient &client, Path path_fs)
+{
+	fluid_player_t *player;
+	int ret;
+
+	auto instance = ObtainInstance();
+	if (!instance)
+		return;
+
+	fluid_synth_t *const synth = instance->synth;
+
 	/* create the fluid player */
 
 	player = new_fluid_player(synth);
-	if (player == nullptr) {
-		delete_fluid_synth(synth);
-		delete_fluid_settings(settings);
+	if (player == nullptr)
 		return;
-	}
 
 	ret = fluid_player_add(player, path_fs.c_str());
 	if (ret != 0) {
 		LogWarning(fluidsynth_domain, "fluid_player_add() failed");
 		delete_fluid_player(player);
-		delete_fluid_synth(synth);
-		delete_fluid_settings(settings);
+		ReleaseInstance(std::move(instance));
 		return;
 	}
 
@@ -172,8 +268,7 @@ fluidsynth_file_decode(DecoderClient &client, Path path_fs)
 	if (ret != 0) {
 		LogWarning(fluidsynth_domain, "fluid_player_play() failed");
 		delete_fluid_player(player);
-		delete_fluid_synth(synth);
-		delete_fluid_settings(settings);
+		ReleaseInstance(std::move(instance));
 		return;
 	}
 
@@ -208,8 +303,7 @@ fluidsynth_file_decode(DecoderClient &client, Path path_fs)
 	fluid_player_join(player);
 
 	delete_fluid_player(player);
-	delete_fluid_synth(synth);
-	delete_fluid_settings(settings);
+	ReleaseInstance(std::move(instance));
 }
 
 static bool
@@ -227,5 +321,5 @@ static const char *const fluidsynth_suffixes[] = {
 constexpr DecoderPlugin fluidsynth_decoder_plugin =
 	DecoderPlugin("fluidsynth",
 		      fluidsynth_file_decode, fluidsynth_scan_file)
-	.WithInit(fluidsynth_init)
+	.WithInit(fluidsynth_init, fluidsynth_finish)
 	.WithSuffixes(fluidsynth_suffixes);
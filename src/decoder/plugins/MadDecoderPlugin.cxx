@@ -20,6 +20,7 @@
 #include "config.h"
 #include "MadDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekIndex.hxx"
 #include "input/InputStream.hxx"
 #include "tag/Id3Scan.hxx"
 #include "tag/Id3ReplayGain.hxx"
@@ -40,7 +41,9 @@
 #include <id3tag.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <optional>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -116,6 +119,18 @@ class MadDecoder {
 	size_t highest_frame = 0;
 	size_t max_frames = 0;
 	size_t current_frame = 0;
+
+	/**
+	 * The number of #frame_offsets which were loaded from the
+	 * persistent seek index cache.
+	 */
+	size_t loaded_frames = 0;
+
+	/**
+	 * The key of this file in the seek index cache; std::nullopt
+	 * if the cache is disabled or not applicable.
+	 */
+	std::optional<SeekIndexKey> seek_index_key;
 	unsigned int drop_start_frames;
 	unsigned int drop_end_frames;
 	unsigned int drop_start_samples = 0;
@@ -173,6 +188,17 @@ private:
 		times = new mad_timer_t[max_frames];
 	}
 
+	/**
+	 * Fill #frame_offsets and #times from the seek index cache.
+	 */
+	void LoadSeekIndex() noexcept;
+
+	/**
+	 * Store #frame_offsets in the seek index cache if we have
+	 * learned more than what was loaded.
+	 */
+	void StoreSeekIndex() noexcept;
+
 	[[nodiscard]] gcc_pure
 	size_t TimeToFrame(SongTime t) const noexcept;
 
@@ -756,18 +782,60 @@ MadDecoder::~MadDecoder() noexcept
 	delete[] times;
 }
 
-size_t
-MadDecoder::TimeToFrame(SongTime t) const noexcept
+inline void
+MadDecoder::LoadSeekIndex() noexcept
 {
-	size_t i;
+	assert(highest_frame == 0);
 
-	for (i = 0; i < highest_frame; ++i) {
-		auto frame_time = ToSongTime(times[i]);
-		if (frame_time >= t)
-			break;
+	seek_index_key = GetSeekIndexKey(input_stream);
+	if (!seek_index_key)
+		return;
+
+	const auto index = ::LoadSeekIndex("mad", *seek_index_key);
+	if (!index || index->step != 1)
+		return;
+
+	/* the last element may have been capped in the previous
+	   run, see UpdateTimerNextFrame() */
+	const size_t n = std::min(index->size(), max_frames - 1);
+
+	/* all frames of a MPEG stream have the same duration */
+	mad_timer_t t = mad_timer_zero;
+	for (size_t i = 0; i < n; ++i) {
+		frame_offsets[i] = index->offsets[i];
+		mad_timer_add(&t, frame.header.duration);
+		times[i] = t;
 	}
 
-	return i;
+	highest_frame = loaded_frames = n;
+}
+
+inline void
+MadDecoder::StoreSeekIndex() noexcept
+{
+	if (!seek_index_key)
+		return;
+
+	/* don't store the last element if it has been capped */
+	const size_t n = std::min(highest_frame, max_frames - 1);
+	if (n <= loaded_frames)
+		return;
+
+	SeekIndex index;
+	index.offsets.assign(frame_offsets, frame_offsets + n);
+	::StoreSeekIndex("mad", *seek_index_key, index);
+}
+
+size_t
+MadDecoder::TimeToFrame(SongTime t) const noexcept
+{
+	/* binary search; the #times array is sorted */
+	const mad_timer_t *begin = times, *end = times + highest_frame;
+	const auto *i = std::partition_point(begin, end,
+					     [t](const mad_timer_t &frame_time){
+						     return ToSongTime(frame_time) < t;
+					     });
+	return i - begin;
 }
 
 void
@@ -952,6 +1020,9 @@ MadDecoder::RunDecoder() noexcept
 
 	AllocateBuffers();
 
+	if (input_stream.IsSeekable())
+		LoadSeekIndex();
+
 	client->Ready(CheckAudioFormat(frame.header.samplerate,
 				       SampleFormat::S24_P32,
 				       MAD_NCHANNELS(&frame.header)),
@@ -962,6 +1033,8 @@ MadDecoder::RunDecoder() noexcept
 		client->SubmitTag(input_stream, std::move(tag));
 
 	while (Read()) {}
+
+	StoreSeekIndex();
 }
 
 static void
@@ -19,6 +19,7 @@
 
 #include "Mpg123DecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekIndex.hxx"
 #include "pcm/CheckAudioFormat.hxx"
 #include "tag/Handler.hxx"
 #include "tag/Builder.hxx"
@@ -31,6 +32,8 @@
 
 #include <mpg123.h>
 
+#include <vector>
+
 #include <stdio.h>
 
 static constexpr Domain mpg123_domain("mpg123");
@@ -178,6 +181,48 @@ mpd_mpg123_meta(DecoderClient &client, mpg123_handle *const handle)
 		mpd_mpg123_id3v2(client, *v2);
 }
 
+/**
+ * Pass the frame index from the seek index cache to libmpg123.
+ *
+ * @return the number of index entries
+ */
+static std::size_t
+LoadSeekIndex(mpg123_handle *handle, const SeekIndexKey &key) noexcept
+{
+	const auto index = LoadSeekIndex("mpg123", key);
+	if (!index)
+		return 0;
+
+	/* libmpg123 copies the array */
+	std::vector<off_t> offsets(index->offsets.begin(),
+				   index->offsets.end());
+	if (mpg123_set_index(handle, offsets.data(), index->step,
+			     offsets.size()) != MPG123_OK)
+		return 0;
+
+	return offsets.size();
+}
+
+/**
+ * Store libmpg123's frame index in the seek index cache if it has
+ * grown.
+ */
+static void
+StoreSeekIndex(mpg123_handle *handle, const SeekIndexKey &key,
+	       std::size_t loaded) noexcept
+{
+	off_t *offsets, step;
+	std::size_t fill;
+	if (mpg123_index(handle, &offsets, &step, &fill) != MPG123_OK ||
+	    fill <= loaded || step <= 0)
+		return;
+
+	SeekIndex index;
+	index.step = step;
+	index.offsets.assign(offsets, offsets + fill);
+	StoreSeekIndex("mpg123", key, index);
+}
+
 static void
 mpd_mpg123_file_decode(DecoderClient &client, Path path_fs)
 {
@@ -198,6 +243,11 @@ mpd_mpg123_file_decode(DecoderClient &client, Path path_fs)
 	if (!mpd_mpg123_open(handle, path_fs.c_str(), audio_format))
 		return;
 
+	const auto seek_index_key = GetSeekIndexKey(path_fs);
+	const std::size_t loaded_seek_index = seek_index_key
+		? LoadSeekIndex(handle, *seek_index_key)
+		: 0;
+
 	const off_t num_samples = mpg123_length(handle);
 
 	/* tell MPD core we're ready */
@@ -269,6 +319,9 @@ mpd_mpg123_file_decode(DecoderClient &client, Path path_fs)
 			cmd = DecoderCommand::NONE;
 		}
 	} while (cmd == DecoderCommand::NONE);
+
+	if (seek_index_key)
+		StoreSeekIndex(handle, *seek_index_key, loaded_seek_index);
 }
 
 static bool
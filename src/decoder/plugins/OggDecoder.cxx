@@ -28,10 +28,8 @@
 bool
 OggDecoder::LoadEndPacket(ogg_packet &packet) const
 {
-	if (!input_stream.CheapSeeking())
-		/* we do this for local files only, because seeking
-		   around remote files is expensive and not worth the
-		   trouble */
+	if (!input_stream.IsSeekable() || !input_stream.KnownSize())
+		/* this is a live stream; there is no end */
 		return false;
 
 	const auto old_offset = input_stream.GetOffset();
@@ -50,7 +48,7 @@ OggDecoder::LoadEndPacket(ogg_packet &packet) const
 		   OggVisitor callback, and our InputStream may be in
 		   the middle of an Ogg packet */
 		result = OggSeekFindEOS(sync2, stream2, packet,
-					input_stream, false);
+					input_stream, false, true);
 	}
 
 	/* restore the previous file position */
@@ -79,28 +77,76 @@ OggDecoder::SeekByte(offset_type offset)
 	PostSeek(offset);
 }
 
+inline void
+OggDecoder::AddPageIndex(ogg_int64_t granulepos, offset_type offset) noexcept
+{
+	/* the index is sparse by nature (only pages visited by
+	   seeking); this limit only protects against pathological
+	   usage */
+	static constexpr std::size_t MAX_PAGE_INDEX = 1024;
+
+	if (page_index.size() < MAX_PAGE_INDEX)
+		page_index.emplace(granulepos, offset);
+}
+
 void
 OggDecoder::SeekGranulePos(ogg_int64_t where_granulepos)
 {
 	assert(IsSeekable());
 
-	/* binary search: interpolate the file offset where we expect
-	   to find the given granule position, and repeat until we're
-	   close enough */
+	static constexpr ogg_int64_t MARGIN_BEFORE = 44100 / 3;
+	static constexpr ogg_int64_t MARGIN_AFTER = 44100 / 10;
 
-	static const ogg_int64_t MARGIN_BEFORE = 44100 / 3;
-	static const ogg_int64_t MARGIN_AFTER = 44100 / 10;
+	/* below this range, another probe would not find a better
+	   page than the lower bound */
+	static constexpr offset_type MIN_RANGE = 16384;
 
 	offset_type min_offset = 0, max_offset = input_stream.GetSize();
 	ogg_int64_t min_granule = 0, max_granule = end_granulepos;
 
-	while (true) {
+	/* narrow the range with pages found by previous seeks */
+	if (auto i = page_index.lower_bound(where_granulepos - MARGIN_BEFORE);
+	    i != page_index.end() &&
+	    i->first <= where_granulepos + MARGIN_AFTER) {
+		/* we've been here before */
+		SeekByte(i->second);
+		return;
+	}
+
+	if (auto i = page_index.upper_bound(where_granulepos);
+	    i != page_index.end()) {
+		max_granule = i->first;
+		max_offset = i->second;
+	}
+
+	if (auto i = page_index.lower_bound(where_granulepos);
+	    i != page_index.begin()) {
+		--i;
+		min_granule = i->first;
+		min_offset = i->second;
+	}
+
+	/* interpolate the file offset where we expect to find the
+	   given granule position; if the same bound moves twice in a
+	   row (which happens with uneven bit rates), bisect instead,
+	   so the number of probes is logarithmic */
+
+	bool last_was_max = false, last_was_min = false;
+	bool bisect = false;
+
+	offset_type result_offset = min_offset;
+
+	while (max_offset - min_offset > MIN_RANGE) {
 		const offset_type delta_offset = max_offset - min_offset;
 		const ogg_int64_t delta_granule = max_granule - min_granule;
-		const ogg_int64_t relative_granule = where_granulepos - min_granule;
 
-		const offset_type offset = min_offset + relative_granule * delta_offset
-			/ delta_granule;
+		offset_type offset;
+		if (bisect || delta_granule <= 0)
+			offset = min_offset + delta_offset / 2;
+		else
+			offset = min_offset +
+				offset_type(double(where_granulepos - min_granule)
+					    * delta_offset / delta_granule);
 
 		SeekByte(offset);
 
@@ -110,6 +156,10 @@ OggDecoder::SeekGranulePos(ogg_int64_t where_granulepos)
 			   - we can't improve, so stop */
 			return;
 
+		const offset_type page_offset = GetStartOffset();
+		AddPageIndex(new_granule, page_offset);
+		result_offset = page_offset;
+
 		if (new_granule > where_granulepos + MARGIN_AFTER) {
 			if (new_granule > max_granule)
 				/* something went wrong */
@@ -121,8 +171,12 @@ OggDecoder::SeekGranulePos(ogg_int64_t where_granulepos)
 				break;
 
 			/* reduce the max bounds and interpolate again */
+			bisect = last_was_max;
+			last_was_max = true;
+			last_was_min = false;
+
 			max_granule = new_granule;
-			max_offset = GetStartOffset();
+			max_offset = page_offset;
 		} else if (new_granule + MARGIN_BEFORE < where_granulepos) {
 			if (new_granule < min_granule)
 				/* something went wrong */
@@ -135,15 +189,24 @@ OggDecoder::SeekGranulePos(ogg_int64_t where_granulepos)
 
 			/* increase the min bounds and interpolate
 			   again */
+			bisect = last_was_min;
+			last_was_min = true;
+			last_was_max = false;
+
 			min_granule = new_granule;
-			min_offset = GetStartOffset();
+			min_offset = page_offset;
 		} else {
 			break;
 		}
+
+		/* the range is now small enough: play from the
+		   lower bound, which is before the desired
+		   position */
+		result_offset = min_offset;
 	}
 
-	/* go back to the last page start so OggVisitor can start
+	/* go back to the selected page start so OggVisitor can start
 	   visiting from here (we have consumed a few pages
 	   already) */
-	SeekByte(GetStartOffset());
+	SeekByte(result_offset);
 }
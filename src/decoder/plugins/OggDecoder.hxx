@@ -24,9 +24,19 @@
 #include "decoder/Reader.hxx"
 #include "input/Offset.hxx"
 
+#include <map>
+
 class OggDecoder : public OggVisitor {
 	ogg_int64_t end_granulepos;
 
+	/**
+	 * A sparse index of page start offsets by granule position,
+	 * collected by SeekGranulePos().  It narrows the search
+	 * range of subsequent seeks in the same stream, which saves
+	 * expensive reads (e.g. HTTP range requests).
+	 */
+	std::map<ogg_int64_t, offset_type> page_index;
+
 protected:
 	DecoderClient &client;
 	InputStream &input_stream;
@@ -61,6 +71,19 @@ protected:
 	 */
 	void SeekByte(offset_type offset);
 
+private:
+	void AddPageIndex(ogg_int64_t granulepos,
+			  offset_type offset) noexcept;
+
+protected:
+	/**
+	 * Seek to a page near the given granule position: bisect the
+	 * file with interpolated (and, if that converges slowly,
+	 * halved) offsets, starting with the bounds from the
+	 * #page_index.
+	 *
+	 * Throws on error.
+	 */
 	void SeekGranulePos(ogg_int64_t where_granulepos);
 };
 
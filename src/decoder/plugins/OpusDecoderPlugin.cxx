@@ -24,6 +24,7 @@
 #include "OpusTags.hxx"
 #include "lib/xiph/OggPacket.hxx"
 #include "lib/xiph/OggFind.hxx"
+#include "lib/xiph/OggPacketReader.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "../DecoderAPI.hxx"
 #include "decoder/Reader.hxx"
@@ -457,13 +458,10 @@ bool
 ReadAndVisitOpusTags(OggSyncState &sync, OggStreamState &stream,
 		     TagHandler &handler)
 {
-	ogg_packet packet;
-
-	return OggReadPacket(sync, stream, packet) &&
-		IsOpusTags(packet) &&
-		ScanOpusTags(packet.packet, packet.bytes,
-			     nullptr,
-			     handler);
+	/* read the packet incrementally, which allows skipping
+	   embedded pictures without loading them */
+	OggPacketReader reader(sync, stream.GetSerialNo());
+	return ScanOpusTags(reader, nullptr, handler);
 }
 
 void
@@ -19,6 +19,7 @@
 
 #include "OpusTags.hxx"
 #include "OpusReader.hxx"
+#include "lib/xiph/VorbisCommentReader.hxx"
 #include "lib/xiph/VorbisPicture.hxx"
 #include "lib/xiph/XiphTags.hxx"
 #include "tag/Handler.hxx"
@@ -120,3 +121,27 @@ ScanOpusTags(const void *data, size_t size,
 
 	return true;
 }
+
+bool
+ScanOpusTags(OggPacketReader &reader,
+	     ReplayGainInfo *rgi,
+	     TagHandler &handler)
+{
+	char magic[8];
+	if (!reader.ReadFull(magic, sizeof(magic)) ||
+	    memcmp(magic, "OpusTags", 8) != 0)
+		return false;
+
+	if (!handler.WantPair() && !handler.WantTag() &&
+	    !handler.WantPicture())
+		return true;
+
+	return ReadVorbisComments(reader, handler.WantPicture(),
+				  [rgi, &handler](std::string_view comment){
+		const auto split = Split(comment, '=');
+		if (split.first.empty() || split.second.data() == nullptr)
+			return;
+
+		ScanOneOpusTag(split.first, split.second, rgi, handler);
+	});
+}
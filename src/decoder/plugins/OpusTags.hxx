@@ -24,10 +24,21 @@
 
 struct ReplayGainInfo;
 class TagHandler;
+class OggPacketReader;
 
 bool
 ScanOpusTags(const void *data, size_t size,
 	     ReplayGainInfo *rgi,
 	     TagHandler &handler) noexcept;
 
+/**
+ * Like ScanOpusTags(const void *, size_t, ...), but read the
+ * "OpusTags" packet incrementally.  Unless TagHandler::WantPicture()
+ * is set, embedded pictures are skipped without copying them.
+ */
+bool
+ScanOpusTags(OggPacketReader &reader,
+	     ReplayGainInfo *rgi,
+	     TagHandler &handler);
+
 #endif
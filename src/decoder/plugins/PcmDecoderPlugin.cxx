@@ -36,6 +36,7 @@
 #include "pcm/AudioParser.hxx"
 #endif
 
+#include <cassert>
 #include <exception>
 
 #include <string.h>
@@ -59,6 +60,52 @@ FillBuffer(DecoderClient &client, InputStream &is, B &buffer)
 	return true;
 }
 
+/**
+ * Read from the #InputStream directly into a buffer obtained from
+ * DecoderClient::WriteAudio() and commit all whole frames.  A
+ * partial frame left over from the previous call (in #buffer) is
+ * moved to the beginning of #dest first, and a new partial frame
+ * at the end is moved back to #buffer.
+ *
+ * @return false on end of file
+ */
+template<typename B>
+static bool
+ReadDirect(DecoderClient &client, InputStream &is, B &buffer,
+	   std::span<std::byte> dest, std::size_t frame_size,
+	   bool reverse_endian, DecoderCommand &cmd)
+{
+	auto r = buffer.Read();
+	assert(r.size() < dest.size());
+	memcpy(dest.data(), r.data(), r.size());
+	std::size_t fill = r.size();
+	buffer.Clear();
+
+	const size_t nbytes = decoder_read(client, is, dest.data() + fill,
+					   dest.size() - fill);
+	const bool eof = nbytes == 0 && is.LockIsEOF();
+	fill += nbytes;
+
+	const std::size_t rest = fill % frame_size;
+	fill -= rest;
+
+	if (rest > 0) {
+		auto w = buffer.Write();
+		assert(w.size() >= rest);
+		memcpy(w.data(), dest.data() + fill, rest);
+		buffer.Append(rest);
+	}
+
+	if (reverse_endian)
+		/* make sure we deliver samples in host byte order */
+		reverse_bytes_16((uint16_t *)dest.data(),
+				 (uint16_t *)dest.data(),
+				 (uint16_t *)(dest.data() + fill));
+
+	cmd = client.CommitAudio(fill);
+	return !eof;
+}
+
 static void
 pcm_stream_decode(DecoderClient &client, InputStream &is)
 {
@@ -181,36 +228,50 @@ pcm_stream_decode(DecoderClient &client, InputStream &is)
 
 	DecoderCommand cmd;
 	do {
-		if (!FillBuffer(client, is, buffer))
-			break;
-
-		auto r = buffer.Read();
-		/* round down to the nearest frame size, because we
-		   must not pass partial frames to
-		   DecoderClient::SubmitAudio() */
-		r = r.first(r.size() - r.size() % in_frame_size);
-		buffer.Consume(r.size());
-
-		if (reverse_endian)
-			/* make sure we deliver samples in host byte order */
-			reverse_bytes_16((uint16_t *)r.data(),
-					 (uint16_t *)r.data(),
-					 (uint16_t *)(r.data() + r.size()));
-		else if (l24) {
-			/* convert big-endian packed 24 bit
-			   (audio/L24) to native-endian 24 bit (in 32
-			   bit integers) */
-			pcm_unpack_24be(unpack_buffer,
-					r.data(), r.data() + r.size());
-			r = {
-				(uint8_t *)&unpack_buffer[0],
-				(r.size() / 3) * 4,
-			};
+		/* read directly into the MusicChunk if possible;
+		   audio/L24 needs to be unpacked into a larger
+		   buffer */
+		const auto dest = !l24
+			? client.WriteAudio(is, 0)
+			: std::span<std::byte>{};
+		if (!dest.empty()) {
+			if (!ReadDirect(client, is, buffer, dest,
+					in_frame_size, reverse_endian, cmd))
+				break;
+		} else {
+			if (!FillBuffer(client, is, buffer))
+				break;
+
+			auto r = buffer.Read();
+			/* round down to the nearest frame size,
+			   because we must not pass partial frames to
+			   DecoderClient::SubmitAudio() */
+			r = r.first(r.size() - r.size() % in_frame_size);
+			buffer.Consume(r.size());
+
+			if (reverse_endian)
+				/* make sure we deliver samples in host
+				   byte order */
+				reverse_bytes_16((uint16_t *)r.data(),
+						 (uint16_t *)r.data(),
+						 (uint16_t *)(r.data() + r.size()));
+			else if (l24) {
+				/* convert big-endian packed 24 bit
+				   (audio/L24) to native-endian 24 bit
+				   (in 32 bit integers) */
+				pcm_unpack_24be(unpack_buffer,
+						r.data(), r.data() + r.size());
+				r = {
+					(uint8_t *)&unpack_buffer[0],
+					(r.size() / 3) * 4,
+				};
+			}
+
+			cmd = !r.empty()
+				? client.SubmitAudio(is, r, 0)
+				: client.GetCommand();
 		}
 
-		cmd = !r.empty()
-			? client.SubmitAudio(is, r, 0)
-			: client.GetCommand();
 		if (cmd == DecoderCommand::SEEK) {
 			uint64_t frame = client.GetSeekFrame();
 			offset_type offset = frame * in_frame_size;
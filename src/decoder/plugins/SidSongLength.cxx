@@ -0,0 +1,169 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SidSongLength.hxx"
+#include "io/BufferedReader.hxx"
+#include "io/FileReader.hxx"
+#include "util/CharUtil.hxx"
+
+#include <cstring>
+
+static constexpr std::size_t MD5_LENGTH = 32;
+
+/**
+ * Parse a digest, converting it to lower case.
+ *
+ * @return false if this is not a valid MD5 digest
+ */
+static bool
+ParseDigest(std::string_view src, char *dest) noexcept
+{
+	if (src.size() != MD5_LENGTH)
+		return false;
+
+	for (const char ch : src) {
+		if (!IsDigitASCII(ch) &&
+		    (ToLowerASCII(ch) < 'a' || ToLowerASCII(ch) > 'f'))
+			return false;
+
+		*dest++ = ToLowerASCII(ch);
+	}
+
+	return true;
+}
+
+static unsigned
+ParseDecimal(std::string_view &s) noexcept
+{
+	unsigned value = 0;
+	while (!s.empty() && IsDigitASCII(s.front())) {
+		value = value * 10 + unsigned(s.front() - '0');
+		s.remove_prefix(1);
+	}
+
+	return value;
+}
+
+/**
+ * Parse a length in the form "M:SS" or "M:SS.mmm", optionally
+ * followed by attributes in parentheses (e.g. "(G)"), which are
+ * ignored.
+ *
+ * @return the length in milliseconds or -1 on error
+ */
+static int_least64_t
+ParseLength(std::string_view s) noexcept
+{
+	if (s.empty() || !IsDigitASCII(s.front()))
+		return -1;
+
+	const unsigned minutes = ParseDecimal(s);
+	if (s.empty() || s.front() != ':')
+		return -1;
+
+	s.remove_prefix(1);
+	if (s.empty() || !IsDigitASCII(s.front()))
+		return -1;
+
+	const unsigned seconds = ParseDecimal(s);
+
+	unsigned ms = 0;
+	if (!s.empty() && s.front() == '.') {
+		s.remove_prefix(1);
+
+		/* scale "5" to 500 and "05" to 50 */
+		unsigned factor = 100;
+		while (!s.empty() && IsDigitASCII(s.front())) {
+			ms += unsigned(s.front() - '0') * factor;
+			factor /= 10;
+			s.remove_prefix(1);
+		}
+	}
+
+	if (!s.empty() && s.front() != '(')
+		return -1;
+
+	return (int_least64_t(minutes) * 60 + seconds) * 1000 + ms;
+}
+
+bool
+SidSongLengthDatabase::ParseLine(std::string_view line) noexcept
+{
+	const auto eq = line.find('=');
+	if (eq == line.npos)
+		return false;
+
+	char md5[MD5_LENGTH];
+	if (!ParseDigest(line.substr(0, eq), md5))
+		return false;
+
+	Lengths lengths;
+
+	std::string_view rest = line.substr(eq + 1);
+	while (true) {
+		while (!rest.empty() && IsWhitespaceOrNull(rest.front()))
+			rest.remove_prefix(1);
+
+		if (rest.empty())
+			break;
+
+		auto end = rest.find(' ');
+		if (end == rest.npos)
+			end = rest.size();
+
+		const auto length = ParseLength(rest.substr(0, end));
+		if (length < 0 || length > int_least64_t(UINT_LEAST32_MAX))
+			return false;
+
+		lengths.push_back(uint_least32_t(length));
+		rest.remove_prefix(end);
+	}
+
+	if (lengths.empty())
+		return false;
+
+	map.insert_or_assign(std::string{md5, MD5_LENGTH},
+			     std::move(lengths));
+	return true;
+}
+
+void
+SidSongLengthDatabase::Load(Path path)
+{
+	FileReader file(path);
+	BufferedReader reader(file);
+
+	const char *line;
+	while ((line = reader.ReadLine()) != nullptr)
+		ParseLine(line);
+}
+
+const SidSongLengthDatabase::Lengths *
+SidSongLengthDatabase::Find(std::string_view md5) const noexcept
+{
+	char key[MD5_LENGTH];
+	if (!ParseDigest(md5, key))
+		return nullptr;
+
+	const auto i = map.find(std::string_view{key, MD5_LENGTH});
+	if (i == map.end())
+		return nullptr;
+
+	return &i->second;
+}
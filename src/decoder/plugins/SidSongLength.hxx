@@ -0,0 +1,86 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SID_SONG_LENGTH_HXX
+#define MPD_SID_SONG_LENGTH_HXX
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Path;
+
+/**
+ * An in-memory index of the HVSC "Songlengths.md5" (or the older
+ * "Songlengths.txt") database, which maps the MD5 digest of a SID
+ * tune to the lengths of its sub-tunes.  Unlike libsidplay's
+ * SidDatabase, the whole file is parsed once into a hash table,
+ * which makes each lookup a single hash probe.
+ */
+class SidSongLengthDatabase {
+public:
+	/**
+	 * The lengths of all sub-tunes of one tune in milliseconds.
+	 */
+	using Lengths = std::vector<uint_least32_t>;
+
+private:
+	struct Hash : std::hash<std::string_view> {
+		using is_transparent = void;
+	};
+
+	std::unordered_map<std::string, Lengths, Hash, std::equal_to<>> map;
+
+public:
+	/**
+	 * Load a database file.
+	 *
+	 * Throws on error.
+	 */
+	void Load(Path path);
+
+	/**
+	 * Parse one line of a database file and add its entry to
+	 * the index.  Section headers, comments and malformed lines
+	 * are ignored.
+	 *
+	 * @return true if an entry was added
+	 */
+	bool ParseLine(std::string_view line) noexcept;
+
+	[[gnu::pure]]
+	std::size_t size() const noexcept {
+		return map.size();
+	}
+
+	/**
+	 * Look up a tune.
+	 *
+	 * @param md5 the digest as 32 hex digits (case-insensitive)
+	 * @return the sub-tune lengths or nullptr if the tune is not
+	 * known; the pointer remains valid as long as this object
+	 */
+	[[gnu::pure]]
+	const Lengths *Find(std::string_view md5) const noexcept;
+};
+
+#endif
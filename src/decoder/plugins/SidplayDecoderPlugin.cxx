@@ -18,6 +18,7 @@
  */
 
 #include "SidplayDecoderPlugin.hxx"
+#include "SidSongLength.hxx"
 #include "decoder/Features.h"
 #include "../DecoderAPI.hxx"
 #include "tag/Handler.hxx"
@@ -25,9 +26,11 @@
 #include "song/DetachedSong.hxx"
 #include "fs/Path.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
 #include "lib/fmt/PathFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "lib/icu/Converter.hxx"
+#include "thread/Mutex.hxx"
 #ifdef HAVE_SIDPLAYFP
 #include "io/FileReader.hxx"
 #endif
@@ -46,15 +49,16 @@
 #include <sidplayfp/SidTuneInfo.h>
 #include <sidplayfp/builders/resid.h>
 #include <sidplayfp/builders/residfp.h>
-#include <sidplayfp/SidDatabase.h>
 #else
 #include <sidplay/sidplay2.h>
 #include <sidplay/builders/resid.h>
 #include <sidplay/utils/SidTuneMod.h>
-#include <sidplay/utils/SidDatabase.h>
 #endif
 
+#include <chrono>
+#include <exception>
 #include <iterator>
+#include <list>
 #include <memory>
 
 #include <string.h>
@@ -63,8 +67,79 @@
 
 static constexpr Domain sidplay_domain("sidplay");
 
+/**
+ * Remembers the songlength database entries of recently looked up
+ * files, so scanning or playing the sub-tunes of one file computes
+ * its MD5 digest only once.
+ */
+class SidSongLengthCache {
+	static constexpr std::size_t MAX_ITEMS = 16;
+
+	struct Item {
+		std::string path;
+		std::chrono::system_clock::time_point mtime;
+		uint64_t size;
+
+		/**
+		 * The database entry; nullptr if the tune is not in
+		 * the database.
+		 */
+		const SidSongLengthDatabase::Lengths *lengths;
+	};
+
+	Mutex mutex;
+
+	/**
+	 * The most recently used item comes first.
+	 */
+	std::list<Item> items;
+
+public:
+	/**
+	 * @return true if the file was found in the cache
+	 */
+	bool Get(const std::string &path, const FileInfo &info,
+		 const SidSongLengthDatabase::Lengths *&lengths) noexcept {
+		const std::scoped_lock<Mutex> lock(mutex);
+
+		for (auto i = items.begin(); i != items.end(); ++i) {
+			if (i->path != path)
+				continue;
+
+			if (i->mtime != info.GetModificationTime() ||
+			    i->size != info.GetSize()) {
+				/* the file was modified */
+				items.erase(i);
+				return false;
+			}
+
+			items.splice(items.begin(), items, i);
+			lengths = i->lengths;
+			return true;
+		}
+
+		return false;
+	}
+
+	void Put(std::string &&path, const FileInfo &info,
+		 const SidSongLengthDatabase::Lengths *lengths) noexcept
+	try {
+		const std::scoped_lock<Mutex> lock(mutex);
+
+		items.push_front({std::move(path),
+				  info.GetModificationTime(), info.GetSize(),
+				  lengths});
+		if (items.size() > MAX_ITEMS)
+			items.pop_back();
+	} catch (...) {
+		/* out of memory; just don't cache */
+	}
+};
+
 struct SidplayGlobal {
-	std::unique_ptr<SidDatabase> songlength_database;
+	std::unique_ptr<SidSongLengthDatabase> songlength_database;
+
+	SidSongLengthCache songlength_cache;
 
 	bool all_files_are_containers;
 	unsigned default_songlength;
@@ -95,18 +170,24 @@ static void loadRom(const Path rom_path, uint8_t *dump)
 /**
  * Throws on error.
  */
-static std::unique_ptr<SidDatabase>
+static std::unique_ptr<SidSongLengthDatabase>
 sidplay_load_songlength_db(const Path path)
 {
-	auto db = std::make_unique<SidDatabase>();
-#ifdef HAVE_SIDPLAYFP
-	bool error = !db->open(path.c_str());
-#else
-	bool error = db->open(path.c_str()) < 0;
-#endif
-	if (error)
-		throw FmtRuntimeError("unable to read songlengths file {}: {}",
-				      path, db->error());
+	auto db = std::make_unique<SidSongLengthDatabase>();
+
+	try {
+		db->Load(path);
+	} catch (...) {
+		std::throw_with_nested(FmtRuntimeError("unable to read songlengths file {}",
+						       path));
+	}
+
+	if (db->size() == 0)
+		throw FmtRuntimeError("no entries in songlengths file {}",
+				      path);
+
+	FmtDebug(sidplay_domain, "loaded {} entries from {}",
+		 db->size(), path);
 
 	return db;
 }
@@ -199,36 +280,84 @@ ParseContainerPath(Path path_fs) noexcept
 }
 
 /**
+ * Look up a tune in the songlength database by its MD5 digest.
+ *
  * This is a template, because libsidplay requires SidTuneMod while
  * libsidplayfp requires just a plain Sidtune.
  */
 template<typename T>
-static SignedSongTime
-get_song_length(T &tune) noexcept
+static const SidSongLengthDatabase::Lengths *
+FindSongLengths(T &tune) noexcept
 {
 	assert(tune.getStatus());
 
-	if (sidplay_global->songlength_database == nullptr)
-		return SignedSongTime::Negative();
+	const auto &db = *sidplay_global->songlength_database;
 
-#if LIBSIDPLAYFP_VERSION_MAJ >= 2
-	const auto lengthms =
-		sidplay_global->songlength_database->lengthMs(tune);
-	/* check for new song length format since HVSC#68 or later */
-	if (lengthms < 0)
-	{
-#endif
-		/* old song lenghth format */
-		const auto length =
-			sidplay_global->songlength_database->length(tune);
-		if (length >= 0)
-			return SignedSongTime::FromS(length);
-		return SignedSongTime::Negative();
+	/* 32 hex digits plus null terminator */
+	char md5[33];
 
 #if LIBSIDPLAYFP_VERSION_MAJ >= 2
+	/* the MD5 of the whole file, used by the songlength format
+	   since HVSC#68 */
+	if (const char *digest = tune.createMD5New(md5);
+	    digest != nullptr) {
+		if (const auto *lengths = db.Find(digest))
+			return lengths;
 	}
-	return SignedSongTime::FromMS(lengthms);
 #endif
+
+	/* old songlength format */
+	if (const char *digest = tune.createMD5(md5); digest != nullptr)
+		return db.Find(digest);
+
+	return nullptr;
+}
+
+/**
+ * Like FindSongLengths(), but consult the #SidSongLengthCache
+ * first.  This is used when looking at one sub-tune at a time.
+ */
+template<typename T>
+static const SidSongLengthDatabase::Lengths *
+FindSongLengths(T &tune, Path path_fs) noexcept
+{
+	FileInfo info;
+	if (!GetFileInfo(path_fs, info))
+		return FindSongLengths(tune);
+
+	std::string path = path_fs.c_str();
+
+	auto &cache = sidplay_global->songlength_cache;
+	const SidSongLengthDatabase::Lengths *lengths;
+	if (cache.Get(path, info, lengths))
+		return lengths;
+
+	lengths = FindSongLengths(tune);
+	cache.Put(std::move(path), info, lengths);
+	return lengths;
+}
+
+/**
+ * @param song the sub-tune number (1-based)
+ */
+static SignedSongTime
+GetSongLength(const SidSongLengthDatabase::Lengths *lengths,
+	      unsigned song) noexcept
+{
+	if (lengths == nullptr || song < 1 || song > lengths->size())
+		return SignedSongTime::Negative();
+
+	return SignedSongTime::FromMS((*lengths)[song - 1]);
+}
+
+template<typename T>
+static SignedSongTime
+get_song_length(T &tune, Path path_fs, unsigned song) noexcept
+{
+	if (sidplay_global->songlength_database == nullptr)
+		return SignedSongTime::Negative();
+
+	return GetSongLength(FindSongLengths(tune, path_fs), song);
 }
 
 static void
@@ -257,7 +386,7 @@ sidplay_file_decode(DecoderClient &client, Path path_fs)
 	const int song_num = container.track;
 	tune.selectSong(song_num);
 
-	auto duration = get_song_length(tune);
+	auto duration = get_song_length(tune, container.path, song_num);
 	if (duration.IsNegative() && sidplay_global->default_songlength > 0)
 		duration = SongTime::FromS(sidplay_global->default_songlength);
 
@@ -578,7 +707,7 @@ sidplay_scan_file(Path path_fs, TagHandler &handler) noexcept
 	ScanSidTuneInfo(info, song_num, n_tracks, handler);
 
 	/* time */
-	const auto duration = get_song_length(tune);
+	const auto duration = get_song_length(tune, container.path, song_num);
 	if (!duration.IsNegative())
 		handler.OnDuration(SongTime(duration));
 
@@ -611,6 +740,12 @@ sidplay_container_scan(Path path_fs)
 	if (!sidplay_global->all_files_are_containers && n_tracks < 2)
 		return list;
 
+	/* compute the MD5 digest only once for all sub-tunes */
+	const SidSongLengthDatabase::Lengths *lengths =
+		sidplay_global->songlength_database != nullptr
+		? FindSongLengths(tune, path_fs)
+		: nullptr;
+
 	TagBuilder tag_builder;
 
 	auto tail = list.before_begin();
@@ -620,7 +755,7 @@ sidplay_container_scan(Path path_fs)
 		AddTagHandler h(tag_builder);
 		ScanSidTuneInfo(info, i, n_tracks, h);
 
-		const SignedSongTime duration = get_song_length(tune);
+		const SignedSongTime duration = GetSongLength(lengths, i);
 		if (!duration.IsNegative())
 			h.OnDuration(SongTime(duration));
 
@@ -20,6 +20,9 @@
 #include "VorbisDecoderPlugin.h"
 #include "OggDecoder.hxx"
 #include "lib/xiph/VorbisComments.hxx"
+#include "lib/xiph/ScanVorbisComment.hxx"
+#include "lib/xiph/VorbisCommentReader.hxx"
+#include "lib/xiph/VorbisPicture.hxx"
 #include "lib/xiph/OggPacket.hxx"
 #include "lib/xiph/OggFind.hxx"
 #include "VorbisDomain.hxx"
@@ -30,8 +33,9 @@
 #include "OggCodec.hxx"
 #include "pcm/CheckAudioFormat.hxx"
 #include "pcm/Interleave.hxx"
-#include "util/ScopeExit.hxx"
+#include "util/ByteOrder.hxx"
 #include "tag/Handler.hxx"
+#include "tag/VorbisComment.hxx"
 #include "Log.hxx"
 
 #ifndef HAVE_TREMOR
@@ -43,6 +47,8 @@
 #include <iterator>
 #include <stdexcept>
 
+#include <string.h>
+
 class VorbisDecoder final : public OggDecoder {
 #ifdef HAVE_TREMOR
 	static constexpr SampleFormat sample_format = SampleFormat::S16;
@@ -85,8 +91,12 @@ public:
 
 	bool Seek(uint64_t where_frame);
 
+	static AudioFormat CheckAudioFormat(unsigned rate, unsigned channels) {
+		return ::CheckAudioFormat(rate, sample_format, channels);
+	}
+
 	static AudioFormat CheckAudioFormat(const vorbis_info &vi) {
-		return ::CheckAudioFormat(vi.rate, sample_format, vi.channels);
+		return CheckAudioFormat(vi.rate, vi.channels);
 	}
 
 	[[nodiscard]] AudioFormat CheckAudioFormat() const {
@@ -210,9 +220,19 @@ VorbisDecoder::SubmitSomePcm()
 	if (result <= 0)
 		return false;
 
-	out_sample_t buffer[4096];
 	const unsigned channels = audio_format.channels;
-	size_t max_frames = std::size(buffer) / channels;
+
+	/* interleave directly into the MusicChunk if possible */
+	const auto lent = client.WriteAudio(input_stream, 0);
+
+	out_sample_t local_buffer[4096];
+	out_sample_t *buffer = local_buffer;
+	size_t max_frames = std::size(local_buffer) / channels;
+	if (!lent.empty()) {
+		buffer = (out_sample_t *)(void *)lent.data();
+		max_frames = lent.size() / (sizeof(*buffer) * channels);
+	}
+
 	size_t n_frames = std::min(size_t(result), max_frames);
 
 #ifdef HAVE_TREMOR
@@ -234,9 +254,11 @@ VorbisDecoder::SubmitSomePcm()
 	vorbis_synthesis_read(&dsp, n_frames);
 
 	const std::size_t n_samples = n_frames * channels;
-	auto cmd = client.SubmitAudio(input_stream,
-				      std::span{buffer, n_samples},
-				      0);
+	auto cmd = !lent.empty()
+		? client.CommitAudio(n_samples * sizeof(*buffer))
+		: client.SubmitAudio(input_stream,
+				     std::span{buffer, n_samples},
+				     0);
 	if (cmd != DecoderCommand::NONE)
 		throw cmd;
 
@@ -371,6 +393,58 @@ VisitVorbisDuration(InputStream &is,
 	handler.OnDuration(duration);
 }
 
+/**
+ * Parse the Vorbis identification header packet.
+ *
+ * @return false if the packet is malformed
+ */
+static bool
+ParseVorbisIdentification(const ogg_packet &packet,
+			  unsigned &sample_rate, unsigned &channels) noexcept
+{
+	/* packet type, "vorbis", 32 bit version, 8 bit channels,
+	   32 bit sample rate, three 32 bit bit rates, block sizes,
+	   framing bit */
+	if (packet.bytes < 30 ||
+	    memcmp(packet.packet, "\x01vorbis", 7) != 0)
+		return false;
+
+	const std::byte *p = (const std::byte *)packet.packet;
+	if (*(const PackedLE32 *)(const void *)(p + 7) != 0)
+		/* unsupported version */
+		return false;
+
+	channels = uint8_t(p[11]);
+	sample_rate = *(const PackedLE32 *)(const void *)(p + 12);
+	return channels > 0 && sample_rate > 0;
+}
+
+/**
+ * Parse the Vorbis comment header packet.  It is read incrementally,
+ * which allows skipping embedded pictures without loading them.
+ *
+ * @return false if the packet is malformed
+ */
+static bool
+ScanVorbisCommentPacket(OggPacketReader &reader, TagHandler &handler)
+{
+	char magic[7];
+	if (!reader.ReadFull(magic, sizeof(magic)) ||
+	    memcmp(magic, "\x03vorbis", 7) != 0)
+		return false;
+
+	return ReadVorbisComments(reader, handler.WantPicture(),
+				  [&handler](std::string_view comment){
+		const auto picture_b64 = handler.WantPicture()
+			? GetVorbisCommentValue(comment, "METADATA_BLOCK_PICTURE")
+			: std::string_view{};
+		if (picture_b64.data() != nullptr)
+			ScanVorbisPicture(picture_b64, handler);
+		else
+			ScanVorbisComment(comment, handler);
+	});
+}
+
 static bool
 vorbis_scan_stream(InputStream &is, TagHandler &handler)
 {
@@ -385,35 +459,27 @@ vorbis_scan_stream(InputStream &is, TagHandler &handler)
 
 	OggStreamState stream(first_page);
 
-	/* initialize libvorbis */
-
-	vorbis_info vi;
-	vorbis_info_init(&vi);
-	AtScopeExit(&) { vorbis_info_clear(&vi); };
+	/* parse the first 2 packets; unlike vorbis_synthesis_headerin(),
+	   this doesn't need the (large) setup header packet and
+	   doesn't decode its codebooks */
 
-	vorbis_comment vc;
-	vorbis_comment_init(&vc);
-	AtScopeExit(&) { vorbis_comment_clear(&vc); };
-
-	/* feed the first 3 packets to libvorbis */
-
-	for (unsigned i = 0; i < 3; ++i) {
-		ogg_packet packet;
-		if (!OggReadPacket(sync, stream, packet) ||
-		    vorbis_synthesis_headerin(&vi, &vc, &packet) != 0)
-			return false;
-	}
-
-	/* visit the Vorbis comments we just read */
+	ogg_packet packet;
+	unsigned sample_rate, channels;
+	if (!OggReadPacket(sync, stream, packet) ||
+	    !ParseVorbisIdentification(packet, sample_rate, channels))
+		return false;
 
-	VorbisCommentScan(vc, handler);
+	OggPacketReader comment_reader(sync, stream.GetSerialNo());
+	if (!ScanVorbisCommentPacket(comment_reader, handler))
+		return false;
 
 	/* check the song duration by locating the e_o_s packet */
 
-	VisitVorbisDuration(is, sync, stream, vi.rate, handler);
+	VisitVorbisDuration(is, sync, stream, sample_rate, handler);
 
 	try {
-		handler.OnAudioFormat(VorbisDecoder::CheckAudioFormat(vi));
+		handler.OnAudioFormat(VorbisDecoder::CheckAudioFormat(sample_rate,
+								      channels));
 	} catch (...) {
 	}
 
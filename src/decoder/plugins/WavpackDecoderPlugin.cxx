@@ -21,12 +21,15 @@
 #include "WavpackDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
 #include "input/InputStream.hxx"
+#include "input/LocalOpen.hxx"
 #include "pcm/CheckAudioFormat.hxx"
 #include "tag/Handler.hxx"
 #include "fs/Path.hxx"
 #include "lib/fmt/PathFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
+#include "thread/Mutex.hxx"
 #include "util/AllocatedString.hxx"
+#include "util/ByteOrder.hxx"
 #include "util/Math.hxx"
 #include "util/ScopeExit.hxx"
 
@@ -37,6 +40,7 @@
 #include <cstdlib>
 #include <iterator>
 #include <memory>
+#include <string_view>
 
 using std::string_view_literals::operator""sv;
 
@@ -494,12 +498,103 @@ Scan(WavpackContext *wpc,TagHandler &handler) noexcept
 		handler.OnDuration(SongTime(duration));
 }
 
+/**
+ * Parse the header of the first WavPack block without libwavpack.
+ * That is enough for plain mono/stereo PCM files with a standard
+ * sample rate and a known length, i.e. the vast majority; everything
+ * else is left to libwavpack.
+ *
+ * Throws on I/O error.
+ *
+ * @return false if libwavpack is needed to scan this stream; in that
+ * case, nothing has been passed to the #TagHandler
+ */
+static bool
+ScanWavpackHeader(InputStream &is, TagHandler &handler)
+{
+	static constexpr unsigned sample_rates[] = {
+		6000, 8000, 9600, 11025, 12000, 16000, 22050, 24000,
+		32000, 44100, 48000, 64000, 88200, 96000, 192000,
+	};
+
+	/* the 32 byte "WavpackHeader" */
+	std::byte header[32];
+	is.LockReadFull(header, sizeof(header));
+
+	if (std::string_view{(const char *)header, 4} != "wvpk"sv)
+		return false;
+
+	const unsigned version = *(const PackedLE16 *)(const void *)(header + 8);
+	if (version < 0x402 || version > 0x410)
+		return false;
+
+	const uint32_t total_samples_lo =
+		*(const PackedLE32 *)(const void *)(header + 12);
+	const uint32_t block_samples =
+		*(const PackedLE32 *)(const void *)(header + 20);
+	const uint32_t flags =
+		*(const PackedLE32 *)(const void *)(header + 24);
+
+	if (total_samples_lo == uint32_t(-1))
+		/* unknown length; libwavpack may find it at the end
+		   of the file */
+		return false;
+
+	if (block_samples == 0 ||
+	    (flags & (INITIAL_BLOCK|FINAL_BLOCK)) != (INITIAL_BLOCK|FINAL_BLOCK) ||
+	    (flags & DSD_FLAG) != 0)
+		/* no audio in this block (libwavpack would look at
+		   the next one), more than two channels (which need
+		   the ID_CHANNEL_INFO metadata) or DSD */
+		return false;
+
+	const unsigned srate_index = (flags & SRATE_MASK) >> SRATE_LSB;
+	if (srate_index >= std::size(sample_rates))
+		/* non-standard sample rate in ID_SAMPLE_RATE */
+		return false;
+
+	/* the high 8 bits of the 40 bit sample count are stored
+	   separately; see GET_TOTAL_SAMPLES() in libwavpack */
+	const unsigned total_samples_hi = uint8_t(header[11]);
+	const uint64_t total_samples = total_samples_lo +
+		(uint64_t(total_samples_hi) << 32) - total_samples_hi;
+
+	const unsigned sample_rate = sample_rates[srate_index];
+	const unsigned channels = (flags & MONO_FLAG) != 0 ? 1 : 2;
+	const bool is_float = (flags & FLOAT_DATA) != 0;
+	const SampleFormat sample_format =
+		wavpack_bits_to_sample_format(is_float,
+#ifdef ENABLE_DSD
+					      false,
+#endif
+					      (flags & BYTES_STORED) + 1);
+
+	try {
+		handler.OnAudioFormat(CheckAudioFormat(sample_rate,
+						       sample_format,
+						       channels));
+	} catch (...) {
+	}
+
+	handler.OnDuration(SongTime::FromScale<uint64_t>(total_samples,
+							 sample_rate));
+	return true;
+}
+
 /*
  * Reads metainfo from the specified file.
  */
 static bool
 wavpack_scan_file(Path path_fs, TagHandler &handler) noexcept
 {
+	try {
+		Mutex mutex;
+		auto is = OpenLocalInputStream(path_fs, mutex);
+		if (ScanWavpackHeader(*is, handler))
+			return true;
+	} catch (...) {
+	}
+
 	WavpackContext *wpc;
 
 	try {
@@ -519,6 +614,16 @@ wavpack_scan_file(Path path_fs, TagHandler &handler) noexcept
 static bool
 wavpack_scan_stream(InputStream &is, TagHandler &handler)
 {
+	if (is.IsSeekable()) {
+		try {
+			if (ScanWavpackHeader(is, handler))
+				return true;
+		} catch (...) {
+		}
+
+		is.LockRewind();
+	}
+
 	WavpackInput isp(nullptr, is);
 
 	WavpackContext *wpc;
@@ -20,6 +20,7 @@
 #include "Configured.hxx"
 #include "EncoderList.hxx"
 #include "EncoderPlugin.hxx"
+#include "ThreadedEncoder.hxx"
 #include "config/Block.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "util/StringAPI.hxx"
@@ -51,6 +52,11 @@ GetConfiguredEncoderPlugin(const ConfigBlock &block, bool shout_legacy)
 PreparedEncoder *
 CreateConfiguredEncoder(const ConfigBlock &block, bool shout_legacy)
 {
-	return encoder_init(GetConfiguredEncoderPlugin(block, shout_legacy),
-			    block);
+	auto *encoder = encoder_init(GetConfiguredEncoderPlugin(block, shout_legacy),
+				     block);
+
+	if (block.GetBlockValue("encoder_thread", false))
+		encoder = new PreparedThreadedEncoder(std::unique_ptr<PreparedEncoder>(encoder));
+
+	return encoder;
 }
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EncoderBuffer.hxx"
+
+EncoderBufferPtr
+EncoderBuffer::New(std::span<const std::byte> src) noexcept
+{
+	return EncoderBufferPtr{new EncoderBuffer(src)};
+}
+
+void
+EncoderBuffer::Dispose(EncoderBuffer *b) noexcept
+{
+	if (auto pool = std::move(b->pool))
+		/* our local "pool" reference keeps the pool alive
+		   until Put() has returned */
+		pool->Put(b);
+	else
+		delete b;
+}
+
+EncoderBufferPool::~EncoderBufferPool() noexcept
+{
+	for (auto *b : unused)
+		delete b;
+}
+
+EncoderBufferPtr
+EncoderBufferPool::Get() noexcept
+{
+	EncoderBuffer *b = nullptr;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		if (!unused.empty()) {
+			b = unused.back();
+			unused.pop_back();
+		}
+	}
+
+	if (b == nullptr)
+		b = new EncoderBuffer(buffer_size);
+
+	b->pool = shared_from_this();
+	b->fill = 0;
+	return EncoderBufferPtr{b};
+}
+
+void
+EncoderBufferPool::Put(EncoderBuffer *b) noexcept
+{
+	assert(b->ref == 0);
+	assert(b->pool == nullptr);
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		if (unused.size() < max_unused) {
+			unused.push_back(b);
+			return;
+		}
+	}
+
+	delete b;
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_ENCODER_BUFFER_HXX
+#define MPD_ENCODER_BUFFER_HXX
+
+#include "util/AllocatedArray.hxx"
+#include "thread/Mutex.hxx"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+class EncoderBufferPool;
+class EncoderBufferPtr;
+
+/**
+ * A reference-counted buffer containing encoded data, see
+ * Encoder::ReadBuffer().  It can be shared by many consumers
+ * (e.g. queued to many sockets) and passed to other threads without
+ * copying.  When the last #EncoderBufferPtr is released, it is
+ * returned to its #EncoderBufferPool for reuse.
+ */
+class EncoderBuffer {
+	friend class EncoderBufferPool;
+	friend class EncoderBufferPtr;
+
+	std::atomic_uint ref{0};
+
+	/**
+	 * The pool this buffer will be returned to.  If this is
+	 * nullptr, the buffer is deleted instead.
+	 */
+	std::shared_ptr<EncoderBufferPool> pool;
+
+	AllocatedArray<std::byte> buffer;
+
+	/**
+	 * The number of bytes in #buffer which contain data.
+	 */
+	std::size_t fill = 0;
+
+public:
+	explicit EncoderBuffer(std::size_t capacity) noexcept
+		:buffer(capacity) {}
+
+	explicit EncoderBuffer(std::span<const std::byte> src) noexcept
+		:buffer(src), fill(src.size()) {}
+
+	EncoderBuffer(const EncoderBuffer &) = delete;
+	EncoderBuffer &operator=(const EncoderBuffer &) = delete;
+
+	/**
+	 * Allocate a new buffer (without a pool) containing a copy of
+	 * the given data.
+	 */
+	static EncoderBufferPtr New(std::span<const std::byte> src) noexcept;
+
+	std::size_t capacity() const noexcept {
+		return buffer.size();
+	}
+
+	const std::byte *data() const noexcept {
+		return buffer.data();
+	}
+
+	std::size_t size() const noexcept {
+		return fill;
+	}
+
+	bool empty() const noexcept {
+		return fill == 0;
+	}
+
+	const std::byte *begin() const noexcept {
+		return data();
+	}
+
+	const std::byte *end() const noexcept {
+		return data() + fill;
+	}
+
+	/**
+	 * Returns the whole allocation for writing.  Call
+	 * SetSize() afterwards.  Must not be called while the buffer
+	 * is shared.
+	 */
+	std::span<std::byte> Write() noexcept {
+		return buffer;
+	}
+
+	void SetSize(std::size_t _fill) noexcept {
+		assert(_fill <= capacity());
+
+		fill = _fill;
+	}
+
+private:
+	/**
+	 * The last reference was released: return it to the pool or
+	 * delete it.
+	 */
+	static void Dispose(EncoderBuffer *b) noexcept;
+};
+
+/**
+ * An intrusive reference to an #EncoderBuffer, similar to
+ * std::shared_ptr, but without an extra control block allocation.
+ */
+class EncoderBufferPtr {
+	EncoderBuffer *p = nullptr;
+
+public:
+	EncoderBufferPtr() noexcept = default;
+	EncoderBufferPtr(std::nullptr_t) noexcept {}
+
+	explicit EncoderBufferPtr(EncoderBuffer *_p) noexcept
+		:p(_p) {
+		if (p != nullptr)
+			p->ref.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	EncoderBufferPtr(const EncoderBufferPtr &src) noexcept
+		:EncoderBufferPtr(src.p) {}
+
+	EncoderBufferPtr(EncoderBufferPtr &&src) noexcept
+		:p(std::exchange(src.p, nullptr)) {}
+
+	~EncoderBufferPtr() noexcept {
+		reset();
+	}
+
+	EncoderBufferPtr &operator=(const EncoderBufferPtr &src) noexcept {
+		EncoderBufferPtr copy(src);
+		std::swap(p, copy.p);
+		return *this;
+	}
+
+	EncoderBufferPtr &operator=(EncoderBufferPtr &&src) noexcept {
+		EncoderBufferPtr tmp(std::move(src));
+		std::swap(p, tmp.p);
+		return *this;
+	}
+
+	EncoderBufferPtr &operator=(std::nullptr_t) noexcept {
+		reset();
+		return *this;
+	}
+
+	void reset() noexcept {
+		if (auto *b = std::exchange(p, nullptr);
+		    b != nullptr &&
+		    b->ref.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			EncoderBuffer::Dispose(b);
+	}
+
+	EncoderBuffer *get() const noexcept {
+		return p;
+	}
+
+	EncoderBuffer &operator*() const noexcept {
+		return *p;
+	}
+
+	EncoderBuffer *operator->() const noexcept {
+		return p;
+	}
+
+	explicit operator bool() const noexcept {
+		return p != nullptr;
+	}
+
+	bool operator==(const EncoderBufferPtr &other) const noexcept {
+		return p == other.p;
+	}
+
+	bool operator==(std::nullptr_t) const noexcept {
+		return p == nullptr;
+	}
+};
+
+/**
+ * A pool of #EncoderBuffer objects of a fixed capacity.  Released
+ * buffers are kept for reuse, so a steady stream of encoder output
+ * does not allocate memory.  This class is thread-safe; it must be
+ * managed by std::shared_ptr, because each buffer in use holds a
+ * reference to its pool.
+ */
+class EncoderBufferPool final
+	: public std::enable_shared_from_this<EncoderBufferPool>
+{
+	const std::size_t buffer_size;
+
+	/**
+	 * Keep at most this number of unused buffers.
+	 */
+	const std::size_t max_unused;
+
+	Mutex mutex;
+
+	std::vector<EncoderBuffer *> unused;
+
+public:
+	explicit EncoderBufferPool(std::size_t _buffer_size=32768,
+				   std::size_t _max_unused=64)
+		:buffer_size(_buffer_size), max_unused(_max_unused) {
+		unused.reserve(max_unused);
+	}
+
+	~EncoderBufferPool() noexcept;
+
+	EncoderBufferPool(const EncoderBufferPool &) = delete;
+	EncoderBufferPool &operator=(const EncoderBufferPool &) = delete;
+
+	std::size_t GetBufferSize() const noexcept {
+		return buffer_size;
+	}
+
+	/**
+	 * Obtain an empty buffer, either a recycled one or a new
+	 * allocation.
+	 */
+	EncoderBufferPtr Get() noexcept;
+
+private:
+	friend class EncoderBuffer;
+	void Put(EncoderBuffer *b) noexcept;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EncoderInterface.hxx"
+#include "EncoderBuffer.hxx"
+
+#include <algorithm>
+
+EncoderBufferPtr
+Encoder::ReadBuffer(EncoderBufferPool &pool) noexcept
+{
+	auto buffer = pool.Get();
+	const auto w = buffer->Write();
+
+	std::size_t size = 0;
+	do {
+		const auto b = w.subspan(size);
+		const auto r = Read(b);
+		if (r.empty())
+			break;
+
+		if (r.data() != b.data()) {
+			/* the encoder returned its own buffer; copy it
+			   to ours */
+
+			if (r.size() > b.size()) {
+				/* doesn't fit: allocate a larger
+				   (unpooled) buffer for this one */
+				EncoderBufferPtr large{new EncoderBuffer(size + r.size())};
+				const auto l = large->Write();
+				std::copy_n(w.data(), size, l.data());
+				std::copy(r.begin(), r.end(), l.data() + size);
+				large->SetSize(l.size());
+				return large;
+			}
+
+			std::copy(r.begin(), r.end(), b.begin());
+		}
+
+		size += r.size();
+	} while (size < w.size());
+
+	if (size == 0)
+		return nullptr;
+
+	buffer->SetSize(size);
+	return buffer;
+}
@@ -25,6 +25,8 @@
 
 struct AudioFormat;
 struct Tag;
+class EncoderBufferPool;
+class EncoderBufferPtr;
 
 class Encoder {
 	const bool implements_tag;
@@ -105,6 +107,19 @@ public:
 	 * also point to a different buffer, e.g. one owned by this object)
 	 */
 	virtual std::span<const std::byte> Read(std::span<std::byte> buffer) noexcept = 0;
+
+	/**
+	 * Like Read(), but reads into a reference-counted buffer
+	 * obtained from the given pool, which can be shared by many
+	 * consumers and queued to sockets directly.  Encoders which
+	 * write into the buffer passed to Read() fill the pooled
+	 * buffer directly; the output of the others is copied once.
+	 *
+	 * This reads as much as fits into one pooled buffer.
+	 *
+	 * @return the buffer or nullptr if there was no data
+	 */
+	EncoderBufferPtr ReadBuffer(EncoderBufferPool &pool) noexcept;
 };
 
 class PreparedEncoder {
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ThreadedEncoder.hxx"
+#include "thread/Name.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * The capacity of the PCM queue.  This is about 1.5 seconds of
+ * 44.1 kHz 16 bit stereo.
+ */
+static constexpr std::size_t INPUT_QUEUE_SIZE = 256 * 1024;
+
+/**
+ * How much PCM data is passed to the wrapped encoder at a time.
+ */
+static constexpr std::size_t WRITE_CHUNK_SIZE = 16384;
+
+ThreadedEncoder::ThreadedEncoder(std::unique_ptr<Encoder> _encoder)
+	:Encoder(_encoder->ImplementsTag()),
+	 encoder(std::move(_encoder)),
+	 thread(BIND_THIS_METHOD(Run)),
+	 input(INPUT_QUEUE_SIZE), output(65536)
+{
+	/* move the header to the output queue right away, so it is
+	   available to the caller's first Read() call */
+	std::byte buffer[4096];
+	while (true) {
+		const auto r = encoder->Read(buffer);
+		if (r.empty())
+			break;
+
+		output.Append(r);
+	}
+
+	thread.Start();
+}
+
+ThreadedEncoder::~ThreadedEncoder() noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		quit = true;
+		cond.notify_one();
+	}
+
+	thread.Join();
+}
+
+void
+ThreadedEncoder::Write(std::span<const std::byte> src)
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (!src.empty()) {
+		client_cond.wait(lock, [this]{
+			return !input.IsFull() || error;
+		});
+
+		CheckError();
+
+		const auto w = input.Write();
+		const std::size_t n = std::min(w.size(), src.size());
+		std::copy_n(src.begin(), n, w.begin());
+		input.Append(n);
+		src = src.subspan(n);
+
+		cond.notify_one();
+	}
+}
+
+std::span<const std::byte>
+ThreadedEncoder::Read(std::span<std::byte> buffer) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+	return buffer.first(output.Read(buffer.data(), buffer.size()));
+}
+
+void
+ThreadedEncoder::RunCommand(Command cmd, const Tag *tag)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	assert(command == Command::NONE);
+	command = cmd;
+	command_tag = tag;
+	cond.notify_one();
+
+	client_cond.wait(lock, [this]{ return command == Command::NONE; });
+	CheckError();
+}
+
+void
+ThreadedEncoder::ExecuteCommand(Command cmd, const Tag *tag)
+{
+	switch (cmd) {
+	case Command::NONE:
+		break;
+
+	case Command::END:
+		encoder->End();
+		break;
+
+	case Command::FLUSH:
+		encoder->Flush();
+		break;
+
+	case Command::PRE_TAG:
+		encoder->PreTag();
+		break;
+
+	case Command::SEND_TAG:
+		encoder->SendTag(*tag);
+		break;
+	}
+}
+
+void
+ThreadedEncoder::ReadOutput(std::unique_lock<Mutex> &lock) noexcept
+{
+	std::byte buffer[16384];
+
+	while (true) {
+		lock.unlock();
+		const auto r = encoder->Read(buffer);
+		lock.lock();
+
+		if (r.empty())
+			break;
+
+		output.Append(r);
+	}
+}
+
+void
+ThreadedEncoder::Run() noexcept
+{
+	SetThreadName("encoder");
+
+	std::byte buffer[WRITE_CHUNK_SIZE];
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (!quit) {
+		if (!input.empty()) {
+			/* copy a chunk from the queue, so the lock can
+			   be released while encoding */
+			const std::size_t n = input.Read(buffer, sizeof(buffer));
+			client_cond.notify_one();
+
+			lock.unlock();
+
+			std::exception_ptr e;
+			try {
+				encoder->Write({buffer, n});
+			} catch (...) {
+				e = std::current_exception();
+			}
+
+			lock.lock();
+
+			if (e) {
+				/* discard the queue; the error is
+				   reported by the next call */
+				error = std::move(e);
+				input.Clear();
+				client_cond.notify_one();
+			}
+
+			ReadOutput(lock);
+		} else if (command != Command::NONE) {
+			const auto cmd = command;
+			const auto *tag = command_tag;
+
+			lock.unlock();
+
+			std::exception_ptr e;
+			try {
+				ExecuteCommand(cmd, tag);
+			} catch (...) {
+				e = std::current_exception();
+			}
+
+			lock.lock();
+
+			if (e)
+				error = std::move(e);
+
+			ReadOutput(lock);
+
+			command = Command::NONE;
+			client_cond.notify_one();
+		} else
+			cond.wait(lock);
+	}
+}
+
+Encoder *
+PreparedThreadedEncoder::Open(AudioFormat &audio_format)
+{
+	return new ThreadedEncoder(std::unique_ptr<Encoder>(encoder->Open(audio_format)));
+}
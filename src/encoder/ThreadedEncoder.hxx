@@ -0,0 +1,178 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREADED_ENCODER_HXX
+#define MPD_THREADED_ENCODER_HXX
+
+#include "EncoderInterface.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/DynamicFifoBuffer.hxx"
+
+#include <exception>
+#include <memory>
+#include <mutex>
+
+/**
+ * An #Encoder which runs another #Encoder in a separate thread.
+ * Write() only copies the PCM data into a bounded queue (and blocks
+ * only if it is full), and Read() returns what the worker thread has
+ * encoded so far.  This way, a CPU spike in the encoder does not
+ * delay the output thread.
+ *
+ * End(), Flush(), PreTag() and SendTag() wait until the worker has
+ * encoded all queued data and then execute the call in the worker
+ * thread; after they return, all resulting data is available to
+ * Read(), just like with the wrapped encoder.
+ */
+class ThreadedEncoder final : public Encoder {
+	enum class Command {
+		NONE,
+		END,
+		FLUSH,
+		PRE_TAG,
+		SEND_TAG,
+	};
+
+	const std::unique_ptr<Encoder> encoder;
+
+	Thread thread;
+
+	/**
+	 * Protects all of the following attributes.
+	 */
+	mutable Mutex mutex;
+
+	/**
+	 * Wakes up the worker thread.
+	 */
+	Cond cond;
+
+	/**
+	 * Signals the caller that the #command has been executed or
+	 * that there is space in the #input queue.
+	 */
+	Cond client_cond;
+
+	/**
+	 * PCM data submitted by Write() which was not yet passed to
+	 * the wrapped encoder.  Its capacity is fixed.
+	 */
+	DynamicFifoBuffer<std::byte> input;
+
+	/**
+	 * Encoded data which was not yet returned by Read().
+	 */
+	DynamicFifoBuffer<std::byte> output;
+
+	/**
+	 * The pending command, to be executed by the worker thread
+	 * after the #input queue has become empty.
+	 */
+	Command command = Command::NONE;
+
+	/**
+	 * The parameter of #Command::SEND_TAG; owned by the caller,
+	 * who waits for the command to finish.
+	 */
+	const Tag *command_tag;
+
+	/**
+	 * An error thrown by the wrapped encoder.  It is rethrown by
+	 * the next Write() or command call.
+	 */
+	std::exception_ptr error;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param _encoder the wrapped encoder; its header must not
+	 * have been read yet
+	 */
+	explicit ThreadedEncoder(std::unique_ptr<Encoder> _encoder);
+	~ThreadedEncoder() noexcept override;
+
+	/* virtual methods from class Encoder */
+	void End() override {
+		RunCommand(Command::END);
+	}
+
+	void Flush() override {
+		RunCommand(Command::FLUSH);
+	}
+
+	void PreTag() override {
+		RunCommand(Command::PRE_TAG);
+	}
+
+	void SendTag(const Tag &tag) override {
+		RunCommand(Command::SEND_TAG, &tag);
+	}
+
+	void Write(std::span<const std::byte> src) override;
+	std::span<const std::byte> Read(std::span<std::byte> buffer) noexcept override;
+
+private:
+	void CheckError() const {
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void RunCommand(Command cmd, const Tag *tag=nullptr);
+
+	/**
+	 * Execute the given command on the wrapped encoder.  Called
+	 * in the worker thread without holding the mutex.
+	 */
+	void ExecuteCommand(Command cmd, const Tag *tag);
+
+	/**
+	 * Move all data available from the wrapped encoder to the
+	 * #output queue.  The caller holds the lock, which gets
+	 * released while reading from the encoder.
+	 */
+	void ReadOutput(std::unique_lock<Mutex> &lock) noexcept;
+
+	void Run() noexcept;
+};
+
+/**
+ * A #PreparedEncoder which wraps all #Encoder instances in a
+ * #ThreadedEncoder.
+ */
+class PreparedThreadedEncoder final : public PreparedEncoder {
+	const std::unique_ptr<PreparedEncoder> encoder;
+
+public:
+	explicit PreparedThreadedEncoder(std::unique_ptr<PreparedEncoder> _encoder) noexcept
+		:encoder(std::move(_encoder)) {}
+
+	/* virtual methods from class PreparedEncoder */
+	Encoder *Open(AudioFormat &audio_format) override;
+
+	const char *GetMimeType() const noexcept override {
+		return encoder->GetMimeType();
+	}
+};
+
+#endif
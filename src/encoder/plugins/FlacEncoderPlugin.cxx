@@ -41,6 +41,7 @@ class FlacEncoder final : public Encoder {
 
 	FLAC__StreamEncoder *const fse;
 	const unsigned compression;
+	const unsigned threads;
 	const bool oggflac;
 
 	PcmBuffer expand_buffer;
@@ -52,7 +53,7 @@ class FlacEncoder final : public Encoder {
 	DynamicFifoBuffer<std::byte> output_buffer{8192};
 
 public:
-	FlacEncoder(AudioFormat _audio_format, FLAC__StreamEncoder *_fse, unsigned _compression, bool _oggflac, bool _oggchaining);
+	FlacEncoder(AudioFormat _audio_format, FLAC__StreamEncoder *_fse, unsigned _compression, unsigned _threads, bool _oggflac, bool _oggchaining);
 
 	~FlacEncoder() noexcept override {
 		FLAC__stream_encoder_delete(fse);
@@ -98,6 +99,13 @@ private:
 
 class PreparedFlacEncoder final : public PreparedEncoder {
 	const unsigned compression;
+
+	/**
+	 * The number of threads libFLAC may use for encoding frames
+	 * in parallel (requires libFLAC 1.5).
+	 */
+	const unsigned threads;
+
 	const bool oggchaining;
 	const bool oggflac;
 
@@ -116,6 +124,7 @@ public:
 
 PreparedFlacEncoder::PreparedFlacEncoder(const ConfigBlock &block)
 	:compression(block.GetBlockValue("compression", 5U)),
+	threads(block.GetPositiveValue("threads", 1U)),
 	oggchaining(block.GetBlockValue("oggchaining",false)),
 	oggflac(block.GetBlockValue("oggflac",false) || oggchaining)
 {
@@ -128,7 +137,8 @@ flac_encoder_init(const ConfigBlock &block)
 }
 
 static void
-flac_encoder_setup(FLAC__StreamEncoder *fse, unsigned compression, bool oggflac,
+flac_encoder_setup(FLAC__StreamEncoder *fse, unsigned compression,
+		   unsigned threads, bool oggflac,
 		   const AudioFormat &audio_format)
 {
 	unsigned bits_per_sample;
@@ -163,15 +173,26 @@ flac_encoder_setup(FLAC__StreamEncoder *fse, unsigned compression, bool oggflac,
 		throw FmtRuntimeError("error setting flac sample rate to {}",
 				      audio_format.sample_rate);
 
+	if (threads > 1) {
+#if FLAC_API_VERSION_CURRENT >= 14
+		if (FLAC__stream_encoder_set_num_threads(fse, threads) !=
+		    FLAC__STREAM_ENCODER_SET_NUM_THREADS_OK)
+			throw FmtRuntimeError("error setting flac threads to {}",
+					      threads);
+#else
+		throw std::runtime_error{"libFLAC is too old for the \"threads\" setting"};
+#endif
+	}
+
 	if (oggflac && !FLAC__stream_encoder_set_ogg_serial_number(fse,
 						  GenerateSerial()))
 		throw std::runtime_error{"error setting ogg serial number"};
 }
 
-FlacEncoder::FlacEncoder(AudioFormat _audio_format, FLAC__StreamEncoder *_fse, unsigned _compression, bool _oggflac, bool _oggchaining)
+FlacEncoder::FlacEncoder(AudioFormat _audio_format, FLAC__StreamEncoder *_fse, unsigned _compression, unsigned _threads, bool _oggflac, bool _oggchaining)
 	:Encoder(_oggchaining),
 	 audio_format(_audio_format), fse(_fse),
-	 compression(_compression),
+	 compression(_compression), threads(_threads),
 	 oggflac(_oggflac)
 {
 	/* this immediately outputs data through callback */
@@ -215,20 +236,22 @@ PreparedFlacEncoder::Open(AudioFormat &audio_format)
 		throw std::runtime_error("FLAC__stream_encoder_new() failed");
 
 	try {
-		flac_encoder_setup(fse, compression, oggflac, audio_format);
+		flac_encoder_setup(fse, compression, threads, oggflac,
+				   audio_format);
 	} catch (...) {
 		FLAC__stream_encoder_delete(fse);
 		throw;
 	}
 
-	return new FlacEncoder(audio_format, fse, compression, oggflac, oggchaining);
+	return new FlacEncoder(audio_format, fse, compression, threads,
+			       oggflac, oggchaining);
 }
 
 void
 FlacEncoder::SendTag(const Tag &tag)
 {
 	/* re-initialize encoder since flac_encoder_finish resets everything */
-	flac_encoder_setup(fse, compression, oggflac, audio_format);
+	flac_encoder_setup(fse, compression, threads, oggflac, audio_format);
 
 	FLAC__StreamMetadata *metadata = FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT);
 	FLAC__StreamMetadata_VorbisComment_Entry entry;
@@ -22,6 +22,69 @@
 #include "util/Compiler.h"
 
 #include <stdexcept>
+#include <vector>
+
+namespace {
+
+/**
+ * A per-thread cache of unused #BufferedSocket input buffers.  Most
+ * connections are idle most of the time, and this allows them to
+ * share a small number of buffers instead of each keeping its own.
+ */
+class InputBufferPool {
+	/**
+	 * Never keep more than this number of unused buffers.
+	 */
+	static constexpr std::size_t MAX_UNUSED = 64;
+
+	std::vector<std::unique_ptr<BufferedSocket::InputBuffer>> unused;
+
+public:
+	std::unique_ptr<BufferedSocket::InputBuffer> Get() noexcept {
+		if (unused.empty())
+			return std::make_unique<BufferedSocket::InputBuffer>();
+
+		auto buffer = std::move(unused.back());
+		unused.pop_back();
+		return buffer;
+	}
+
+	void Put(std::unique_ptr<BufferedSocket::InputBuffer> &&buffer) noexcept {
+		if (unused.size() >= MAX_UNUSED)
+			return;
+
+		buffer->Clear();
+		unused.emplace_back(std::move(buffer));
+	}
+};
+
+thread_local InputBufferPool input_buffer_pool;
+
+} // anonymous namespace
+
+BufferedSocket::~BufferedSocket() noexcept
+{
+	if (input != nullptr)
+		ReleaseInput();
+}
+
+BufferedSocket::InputBuffer &
+BufferedSocket::AcquireInput() noexcept
+{
+	if (input == nullptr)
+		input = input_buffer_pool.Get();
+
+	return *input;
+}
+
+void
+BufferedSocket::ReleaseInput() noexcept
+{
+	assert(input != nullptr);
+
+	input_buffer_pool.Put(std::move(input));
+	input.reset();
+}
 
 BufferedSocket::ssize_t
 BufferedSocket::DirectRead(void *data, size_t length) noexcept
@@ -51,12 +114,14 @@ BufferedSocket::ReadToBuffer() noexcept
 {
 	assert(IsDefined());
 
-	const auto buffer = input.Write();
+	const auto buffer = AcquireInput().Write();
 	assert(!buffer.empty());
 
 	const auto nbytes = DirectRead(buffer.data(), buffer.size());
 	if (nbytes > 0)
-		input.Append(nbytes);
+		input->Append(nbytes);
+	else if (nbytes == 0)
+		ReleaseInputIfEmpty();
 
 	return nbytes >= 0;
 }
@@ -67,24 +132,30 @@ BufferedSocket::ResumeInput() noexcept
 	assert(IsDefined());
 
 	while (true) {
-		const auto buffer = input.Read();
-		if (buffer.empty()) {
+		if (input == nullptr || input->empty()) {
+			if (input != nullptr)
+				ReleaseInput();
+
 			event.ScheduleRead();
 			return true;
 		}
 
+		const auto buffer = input->Read();
+
 		const auto result = OnSocketInput(buffer.data(), buffer.size());
 		switch (result) {
 		case InputResult::MORE:
-			if (input.IsFull()) {
+			if (input->IsFull()) {
 				OnSocketError(std::make_exception_ptr(std::runtime_error("Input buffer is full")));
 				return false;
 			}
 
+			ReleaseInputIfEmpty();
 			event.ScheduleRead();
 			return true;
 
 		case InputResult::PAUSE:
+			ReleaseInputIfEmpty();
 			event.CancelRead();
 			return true;
 
@@ -108,12 +179,12 @@ BufferedSocket::OnSocketReady(unsigned flags) noexcept
 	}
 
 	if (flags & SocketEvent::READ) {
-		assert(!input.IsFull());
+		assert(input == nullptr || !input->IsFull());
 
 		if (!ReadToBuffer() || !ResumeInput())
 			return;
 
-		if (!input.IsFull())
+		if (input == nullptr || !input->IsFull())
 			event.ScheduleRead();
 	}
 }
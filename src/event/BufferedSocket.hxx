@@ -26,6 +26,7 @@
 #include <cassert>
 #include <cstdint>
 #include <exception>
+#include <memory>
 #include <type_traits>
 
 class EventLoop;
@@ -34,7 +35,17 @@ class EventLoop;
  * A #SocketEvent specialization that adds an input buffer.
  */
 class BufferedSocket {
-	StaticFifoBuffer<uint8_t, 8192> input;
+public:
+	using InputBuffer = StaticFifoBuffer<uint8_t, 8192>;
+
+private:
+	/**
+	 * The input buffer.  It is only allocated while it contains
+	 * data; as soon as it has been consumed completely, it is
+	 * returned to a per-thread pool (see AcquireInput()), so idle
+	 * connections do not occupy memory for it.
+	 */
+	std::unique_ptr<InputBuffer> input;
 
 protected:
 	SocketEvent event;
@@ -47,6 +58,11 @@ public:
 		event.ScheduleRead();
 	}
 
+	~BufferedSocket() noexcept;
+
+	BufferedSocket(const BufferedSocket &) = delete;
+	BufferedSocket &operator=(const BufferedSocket &) = delete;
+
 	auto &GetEventLoop() const noexcept {
 		return event.GetEventLoop();
 	}
@@ -63,7 +79,32 @@ public:
 		event.Close();
 	}
 
+	/**
+	 * Returns the number of bytes currently allocated for the
+	 * input buffer.
+	 */
+	[[gnu::pure]]
+	std::size_t GetInputMemory() const noexcept {
+		return input != nullptr ? sizeof(*input) : 0;
+	}
+
 private:
+	/**
+	 * Make sure #input is allocated, preferably by taking a
+	 * buffer from the per-thread pool.
+	 */
+	InputBuffer &AcquireInput() noexcept;
+
+	/**
+	 * Return #input to the per-thread pool.
+	 */
+	void ReleaseInput() noexcept;
+
+	void ReleaseInputIfEmpty() noexcept {
+		if (input != nullptr && input->empty())
+			ReleaseInput();
+	}
+
 	/**
 	 * @return the number of bytes read from the socket, 0 if the
 	 * socket isn't ready for reading, -1 on error (the socket has
@@ -92,8 +133,9 @@ protected:
 	 */
 	void ConsumeInput(size_t nbytes) noexcept {
 		assert(IsDefined());
+		assert(input != nullptr);
 
-		input.Consume(nbytes);
+		input->Consume(nbytes);
 	}
 
 	enum class InputResult {
@@ -36,9 +36,21 @@
 void
 CoarseTimerEvent::Schedule(Event::Duration d) noexcept
 {
-	Cancel();
+	const auto new_due = loop.SteadyNow() + d;
+
+	if (IsPending()) {
+		if (new_due >= due) {
+			/* lazy rescheduling: leave the timer where
+			   it is and let the #TimerWheel move it when
+			   the old due time is reached */
+			loop.Postpone(*this, new_due);
+			return;
+		}
 
-	due = loop.SteadyNow() + d;
+		Cancel();
+	}
+
+	due = new_due;
 	loop.Insert(*this);
 }
 
@@ -44,8 +44,12 @@ class EventLoop;
  *
  * Unlike #FineTimerEvent, this class has a granularity of about 1
  * second, and is optimized for timeouts between 1 and 60 seconds
- * which are often canceled before they expire (i.e. optimized for
- * fast insertion and deletion, at the cost of granularity).
+ * which are often canceled or rescheduled before they expire
+ * (i.e. optimized for fast insertion and deletion, at the cost of
+ * granularity).  Moving a pending timer to a later time only
+ * updates its due time; it is moved inside the #TimerWheel when the
+ * old due time is reached.  Longer timeouts are supported, but
+ * they are handled by a coarser second level of the wheel.
  *
  * This class is not thread-safe, all methods must be called from the
  * thread that runs the #EventLoop, except where explicitly documented
@@ -100,4 +104,11 @@ private:
 	void Run() noexcept {
 		callback();
 	}
+
+	/**
+	 * Identifies the callback for #EventLoopProfiler.
+	 */
+	const void *GetCallbackAddress() const noexcept {
+		return callback.GetFunctionAddress();
+	}
 };
@@ -75,6 +75,13 @@ private:
 	void Run() noexcept {
 		callback();
 	}
+
+	/**
+	 * Identifies the callback for #EventLoopProfiler.
+	 */
+	const void *GetCallbackAddress() const noexcept {
+		return callback.GetFunctionAddress();
+	}
 };
 
 #endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2022 CM4all GmbH
+ * All rights reserved.
+ *
+ * author: Max Kellermann <mk@cm4all.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FanotifyEvent.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <array>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/fanotify.h>
+
+static UniqueFileDescriptor
+CreateFanotify()
+{
+	int fd = fanotify_init(FAN_CLASS_NOTIF|FAN_CLOEXEC|FAN_NONBLOCK|
+			       FAN_REPORT_DFID_NAME,
+			       O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		throw MakeErrno("fanotify_init() failed");
+
+	return UniqueFileDescriptor(fd);
+}
+
+FanotifyEvent::FanotifyEvent(EventLoop &event_loop, FanotifyHandler &_handler)
+	:event(event_loop, BIND_THIS_METHOD(OnFanotifyReady),
+	       CreateFanotify().Release()),
+	 handler(_handler)
+{
+	event.ScheduleRead();
+}
+
+FanotifyEvent::~FanotifyEvent() noexcept
+{
+	Close();
+}
+
+void
+FanotifyEvent::AddFilesystemMark(const char *pathname, uint64_t mask)
+{
+	if (fanotify_mark(event.GetFileDescriptor().Get(),
+			  FAN_MARK_ADD|FAN_MARK_FILESYSTEM, mask,
+			  AT_FDCWD, pathname) < 0)
+		throw FmtErrno("fanotify_mark('{}') failed", pathname);
+}
+
+/**
+ * Find the FAN_EVENT_INFO_TYPE_DFID_NAME (or FAN_EVENT_INFO_TYPE_DFID)
+ * record following the event metadata and pass it to the handler.
+ */
+static void
+InvokeHandler(FanotifyHandler &handler,
+	      const struct fanotify_event_metadata &m)
+{
+	const std::byte *p = (const std::byte *)&m + m.metadata_len;
+	const std::byte *const end = (const std::byte *)&m + m.event_len;
+
+	while (true) {
+		const size_t remaining = end - p;
+		const auto &info = *(const struct fanotify_event_info_fid *)(const void *)p;
+		if (remaining < sizeof(info) ||
+		    info.hdr.len < sizeof(info) ||
+		    remaining < info.hdr.len)
+			break;
+
+		if (info.hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME ||
+		    info.hdr.info_type == FAN_EVENT_INFO_TYPE_DFID) {
+			const auto &handle = *(const struct file_handle *)(const void *)info.handle;
+			const std::byte *const record_end = p + info.hdr.len;
+			const auto *name = (const std::byte *)handle.f_handle
+				+ handle.handle_bytes;
+			if (name > record_end)
+				break;
+
+			std::string_view name_sv{"."};
+			if (info.hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+				/* the name is null-terminated and padded */
+				std::string_view padded{(const char *)name,
+					std::size_t(record_end - name)};
+				name_sv = padded.substr(0, padded.find('\0'));
+			}
+
+			handler.OnFanotify(m.mask, &handle, name_sv);
+			return;
+		}
+
+		p += info.hdr.len;
+	}
+}
+
+inline void
+FanotifyEvent::OnFanotifyReady(unsigned) noexcept
+try {
+	alignas(struct fanotify_event_metadata)
+		std::array<std::byte, 16384> buffer;
+
+	ssize_t nbytes = event.GetFileDescriptor().Read(buffer.data(),
+							buffer.size());
+	if (nbytes <= 0) [[unlikely]] {
+		if (nbytes == 0)
+			throw std::runtime_error{"EOF from fanotify"};
+
+		const int e = errno;
+		if (e == EAGAIN)
+			return;
+
+		throw MakeErrno(e, "Reading fanotify failed");
+	}
+
+	auto len = nbytes;
+	for (const auto *m = (const struct fanotify_event_metadata *)(const void *)buffer.data();
+	     FAN_EVENT_OK(m, len); m = FAN_EVENT_NEXT(m, len)) {
+		if (m->vers != FANOTIFY_METADATA_VERSION)
+			throw std::runtime_error{"Wrong fanotify metadata version"};
+
+		if (m->fd >= 0)
+			/* shouldn't happen in FAN_REPORT_DFID_NAME
+			   mode, but don't leak it */
+			close(m->fd);
+
+		if (m->mask & FAN_Q_OVERFLOW)
+			handler.OnFanotify(m->mask, nullptr, {});
+		else
+			InvokeHandler(handler, *m);
+	}
+} catch (...) {
+	Close();
+	handler.OnFanotifyError(std::current_exception());
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2022 CM4all GmbH
+ * All rights reserved.
+ *
+ * author: Max Kellermann <mk@cm4all.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "PipeEvent.hxx"
+
+#include <cstdint>
+#include <exception>
+#include <string_view>
+
+struct file_handle;
+
+/**
+ * Handler for #FanotifyEvent.
+ */
+class FanotifyHandler {
+public:
+	/**
+	 * A fanotify event was received.
+	 *
+	 * @param mask the event mask (FAN_*)
+	 * @param directory the handle of the directory containing the
+	 * object; nullptr on FAN_Q_OVERFLOW
+	 * @param name the name of the object inside the directory;
+	 * "." if the event is about the directory itself
+	 */
+	virtual void OnFanotify(uint64_t mask,
+				const struct file_handle *directory,
+				std::string_view name) = 0;
+
+	/**
+	 * An (permanent) fanotify error has occurred, and the
+	 * #FanotifyEvent has been closed.
+	 */
+	virtual void OnFanotifyError(std::exception_ptr error) noexcept = 0;
+};
+
+/**
+ * #EventLoop integration for Linux fanotify in the
+ * FAN_REPORT_DFID_NAME mode, i.e. events carry the handle of the
+ * parent directory and the name of the affected object instead of a
+ * file descriptor.
+ */
+class FanotifyEvent final {
+	PipeEvent event;
+
+	FanotifyHandler &handler;
+
+public:
+	/**
+	 * Create a fanotify file descriptor add register it in the
+	 * #EventLoop.
+	 *
+	 * Throws on error (e.g. if the kernel is too old or if the
+	 * process lacks CAP_SYS_ADMIN).
+	 */
+	FanotifyEvent(EventLoop &event_loop, FanotifyHandler &_handler);
+
+	~FanotifyEvent() noexcept;
+
+	EventLoop &GetEventLoop() const noexcept {
+		return event.GetEventLoop();
+	}
+
+	/**
+	 * Permanently close the fanotify file descriptor.  Further
+	 * method calls not allowed after that.
+	 */
+	void Close() noexcept {
+		event.Close();
+	}
+
+	/**
+	 * Watch the whole filesystem containing the given path with
+	 * one mark.
+	 *
+	 * Throws on error.
+	 */
+	void AddFilesystemMark(const char *pathname, uint64_t mask);
+
+private:
+	void OnFanotifyReady(unsigned) noexcept;
+};
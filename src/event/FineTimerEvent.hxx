@@ -113,4 +113,11 @@ private:
 	void Run() noexcept {
 		callback();
 	}
+
+	/**
+	 * Identifies the callback for #EventLoopProfiler.
+	 */
+	const void *GetCallbackAddress() const noexcept {
+		return callback.GetFunctionAddress();
+	}
 };
@@ -101,6 +101,9 @@ FullyBufferedSocket::OnSocketReady(unsigned flags) noexcept
 
 		if (!Flush())
 			return;
+
+		if (output.empty())
+			OnSocketDrained();
 	}
 
 	BufferedSocket::OnSocketReady(flags);
@@ -109,6 +112,11 @@ FullyBufferedSocket::OnSocketReady(unsigned flags) noexcept
 void
 FullyBufferedSocket::OnIdle() noexcept
 {
-	if (Flush() && !output.empty())
+	if (!Flush())
+		return;
+
+	if (!output.empty())
 		event.ScheduleWrite();
+	else
+		OnSocketDrained();
 }
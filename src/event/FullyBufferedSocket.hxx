@@ -52,6 +52,36 @@ public:
 		return output.max_size();
 	}
 
+	[[gnu::pure]]
+	bool HasPendingOutput() const noexcept {
+		return !output.empty();
+	}
+
+	/**
+	 * Returns the number of bytes in the output buffer.
+	 */
+	[[gnu::pure]]
+	std::size_t GetOutputSize() const noexcept {
+		return output.size();
+	}
+
+	/**
+	 * Returns the number of bytes currently allocated for the
+	 * input and output buffers.
+	 */
+	[[gnu::pure]]
+	std::size_t GetBufferMemory() const noexcept {
+		return GetInputMemory() + output.GetAllocatedSize();
+	}
+
+	/**
+	 * Free the output buffer if it is empty, e.g. because the
+	 * connection is expected to be idle for a while.
+	 */
+	void ShrinkOutput() noexcept {
+		output.Shrink();
+	}
+
 private:
 	/**
 	 * @return the number of bytes written to the socket, 0 if the
@@ -75,6 +105,12 @@ protected:
 
 	void OnIdle() noexcept;
 
+	/**
+	 * The output buffer has been sent completely.  The method
+	 * may call Write() to refill it.
+	 */
+	virtual void OnSocketDrained() noexcept {}
+
 	/* virtual methods from class BufferedSocket */
 	void OnSocketReady(unsigned flags) noexcept override;
 };
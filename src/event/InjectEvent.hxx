@@ -23,6 +23,8 @@
 #include "util/BindMethod.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <atomic>
+
 class EventLoop;
 
 /**
@@ -39,6 +41,16 @@ class InjectEvent final : public SafeLinkIntrusiveListHook
 	using Callback = BoundMethod<void() noexcept>;
 	const Callback callback;
 
+	/**
+	 * Set by Schedule() before taking the #EventLoop mutex, and
+	 * cleared right before the callback is invoked (or by
+	 * Cancel()).  This allows Schedule() to return early,
+	 * without touching the mutex, if the event is already
+	 * pending; a state change notification fired repeatedly
+	 * from another thread thus costs only one atomic operation.
+	 */
+	std::atomic_bool scheduled{false};
+
 public:
 	InjectEvent(EventLoop &_loop, Callback _callback) noexcept
 		:loop(_loop), callback(_callback) {}
@@ -62,6 +74,13 @@ private:
 	void Run() noexcept {
 		callback();
 	}
+
+	/**
+	 * Identifies the callback for #EventLoopProfiler.
+	 */
+	const void *GetCallbackAddress() const noexcept {
+		return callback.GetFunctionAddress();
+	}
 };
 
 #endif
@@ -20,6 +20,7 @@
 #include "Loop.hxx"
 #include "DeferEvent.hxx"
 #include "SocketEvent.hxx"
+#include "Profiler.hxx"
 #include "util/ScopeExit.hxx"
 
 #ifdef HAVE_THREADED_EVENT_LOOP
@@ -67,6 +68,13 @@ EventLoop::~EventLoop() noexcept
 	assert(ready_sockets.empty());
 }
 
+void
+EventLoop::EnableProfiler(const char *name,
+			  Event::Duration slow_threshold) noexcept
+{
+	profiler = std::make_unique<EventLoopProfiler>(name, slow_threshold);
+}
+
 #ifdef HAVE_URING
 
 Uring::Queue *
@@ -177,11 +185,11 @@ EventLoop::HandleTimers() noexcept
 	const auto now = SteadyNow();
 
 #ifndef NO_FINE_TIMER_EVENT
-	auto fine_timeout = timers.Run(now);
+	auto fine_timeout = timers.Run(now, profiler.get());
 #else
 	const Event::Duration fine_timeout{-1};
 #endif // NO_FINE_TIMER_EVENT
-	auto coarse_timeout = coarse_timers.Run(now);
+	auto coarse_timeout = coarse_timers.Run(now, profiler.get());
 
 	return GetEarlierTimeout(coarse_timeout, fine_timeout);
 }
@@ -220,7 +228,9 @@ void
 EventLoop::RunDeferred() noexcept
 {
 	while (!defer.empty() && !quit) {
-		defer.pop_front_and_dispose([](DeferEvent *e){
+		defer.pop_front_and_dispose([this](DeferEvent *e){
+			const EventLoopProfiler::Scope scope(profiler.get(),
+							     e->GetCallbackAddress());
 			e->Run();
 		});
 	}
@@ -232,7 +242,9 @@ EventLoop::RunOneIdle() noexcept
 	if (idle.empty())
 		return false;
 
-	idle.pop_front_and_dispose([](DeferEvent *e){
+	idle.pop_front_and_dispose([this](DeferEvent *e){
+		const EventLoopProfiler::Scope scope(profiler.get(),
+						     e->GetCallbackAddress());
 		e->Run();
 	});
 
@@ -319,6 +331,12 @@ EventLoop::Run() noexcept
 
 	FlushClockCaches();
 
+	/* the time when this loop iteration woke up; only used by
+	   the #profiler */
+	Event::TimePoint wakeup_time;
+	if (profiler)
+		wakeup_time = Event::Clock::now();
+
 	do {
 		again = false;
 
@@ -360,15 +378,18 @@ EventLoop::Run() noexcept
 
 		/* wait for new event */
 
+		if (profiler)
+			profiler->AddIteration(Event::Clock::now() - wakeup_time);
+
 		Wait(timeout);
 
 		FlushClockCaches();
 
+		if (profiler)
+			wakeup_time = Event::Clock::now();
+
 #ifdef HAVE_THREADED_EVENT_LOOP
-		{
-			const std::scoped_lock<Mutex> lock(mutex);
-			busy = true;
-		}
+		busy.store(true, std::memory_order_relaxed);
 #endif
 
 		/* invoke sockets */
@@ -379,6 +400,8 @@ EventLoop::Run() noexcept
 			socket_event.unlink();
 			sockets.push_back(socket_event);
 
+			const EventLoopProfiler::Scope scope(profiler.get(),
+							     socket_event.GetCallbackAddress());
 			socket_event.Dispatch();
 		}
 	} while (!quit);
@@ -397,9 +420,16 @@ EventLoop::AddInject(InjectEvent &d) noexcept
 {
 	bool must_wake;
 
+	if (d.scheduled.exchange(true, std::memory_order_acquire))
+		/* already pending; no need to lock the mutex */
+		return;
+
 	{
 		const std::scoped_lock<Mutex> lock(mutex);
 		if (d.IsPending())
+			/* a concurrent RemoveInject() has cleared
+			   "scheduled" while we were waiting for the
+			   mutex */
 			return;
 
 		/* we don't need to wake up the EventLoop if another
@@ -421,6 +451,8 @@ EventLoop::RemoveInject(InjectEvent &d) noexcept
 
 	if (d.IsPending())
 		inject.erase(inject.iterator_to(d));
+
+	d.scheduled.store(false, std::memory_order_relaxed);
 }
 
 void
@@ -432,7 +464,15 @@ EventLoop::HandleInject() noexcept
 
 		inject.pop_front();
 
+		/* clear the flag before invoking the callback, so a
+		   Schedule() call from within the callback (or from
+		   another thread while it runs) gets it invoked
+		   again */
+		m.scheduled.store(false, std::memory_order_release);
+
 		const ScopeUnlock unlock(mutex);
+		const EventLoopProfiler::Scope scope(profiler.get(),
+						     m.GetCallbackAddress());
 		m.Run();
 	}
 }
@@ -38,16 +38,18 @@
 #include "thread/Mutex.hxx"
 #endif
 
+#include <atomic>
 #include <cassert>
+#include <memory>
 
 #include "io/uring/Features.h"
 #ifdef HAVE_URING
-#include <memory>
 namespace Uring { class Queue; class Manager; }
 #endif
 
 class DeferEvent;
 class InjectEvent;
+class EventLoopProfiler;
 
 /**
  * An event loop that polls for events on file/socket descriptors.
@@ -135,9 +137,12 @@ class EventLoop final
 	 * True when handling callbacks, false when waiting for I/O or
 	 * timeout.
 	 *
-	 * Protected with #mutex.
+	 * Set to false only while holding #mutex (together with the
+	 * check for pending #InjectEvents), but may be set to true
+	 * without it: a thread which sees a stale "false" merely
+	 * writes to #wake_fd once too often.
 	 */
-	bool busy = true;
+	std::atomic_bool busy = true;
 #endif
 
 #ifdef HAVE_URING
@@ -148,6 +153,11 @@ class EventLoop final
 
 	ClockCache<std::chrono::steady_clock> steady_clock_cache;
 
+	/**
+	 * Optional instrumentation, see EnableProfiler().
+	 */
+	std::unique_ptr<EventLoopProfiler> profiler;
+
 public:
 	/**
 	 * Throws on error.
@@ -193,6 +203,26 @@ public:
 	Uring::Queue *GetUring() noexcept;
 #endif
 
+	/**
+	 * Measure the duration of loop iterations and of all event
+	 * handlers, see #EventLoopProfiler.  Must be called before
+	 * Run().
+	 *
+	 * @param name a name for log messages, e.g. "main"
+	 * @param slow_threshold log handlers which take longer than
+	 * this; zero disables logging
+	 */
+	void EnableProfiler(const char *name,
+			    Event::Duration slow_threshold) noexcept;
+
+	/**
+	 * Returns the profiler enabled with EnableProfiler() or
+	 * nullptr.  It may be accessed from any thread.
+	 */
+	const EventLoopProfiler *GetProfiler() const noexcept {
+		return profiler.get();
+	}
+
 	/**
 	 * Stop execution of this #EventLoop at the next chance.
 	 *
@@ -232,6 +262,22 @@ public:
 
 	void Insert(CoarseTimerEvent &t) noexcept;
 
+	/**
+	 * Move the due time of a pending #CoarseTimerEvent to a
+	 * later time, see TimerWheel::Postpone().
+	 */
+	void Postpone(CoarseTimerEvent &t, Event::TimePoint due) noexcept {
+		coarse_timers.Postpone(t, due);
+	}
+
+	/**
+	 * Returns the #CoarseTimerEvent counters.  This method is
+	 * thread-safe.
+	 */
+	const TimerWheel::Stats &GetCoarseTimerStats() const noexcept {
+		return coarse_timers.GetStats();
+	}
+
 #ifndef NO_FINE_TIMER_EVENT
 	void Insert(FineTimerEvent &t) noexcept;
 #endif // NO_FINE_TIMER_EVENT
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Profiler.hxx"
+#include "system/Symbol.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+
+static constexpr Domain event_profiler_domain("event_profiler");
+
+void
+EventLoopProfiler::AddHandler(const void *handler, Event::Duration d) noexcept
+{
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		auto &stats = handlers[handler];
+		++stats.count;
+		stats.total += d;
+		if (d > stats.max)
+			stats.max = d;
+	}
+
+	if (slow_threshold > slow_threshold.zero() && d >= slow_threshold) [[unlikely]]
+		FmtWarning(event_profiler_domain,
+			   "Handler {} blocked the {} event loop for {} ms",
+			   GetEventHandlerName(handler), name,
+			   std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+}
+
+std::vector<std::pair<const void *, EventLoopProfiler::HandlerStats>>
+EventLoopProfiler::GetSlowest(std::size_t n) const noexcept
+{
+	std::vector<std::pair<const void *, HandlerStats>> result;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		result.assign(handlers.begin(), handlers.end());
+	}
+
+	const auto by_total = [](const auto &a, const auto &b){
+		return a.second.total > b.second.total;
+	};
+
+	if (result.size() > n) {
+		std::partial_sort(result.begin(), result.begin() + n,
+				  result.end(), by_total);
+		result.resize(n);
+	} else
+		std::sort(result.begin(), result.end(), by_total);
+
+	return result;
+}
+
+/**
+ * Extract the method name from the demangled name of a
+ * BindMethodDetail::WrapperGenerator::Invoke() instance, which looks
+ * like "BindMethodDetail::WrapperGenerator<void (Foo::*)() noexcept,
+ * &Foo::Bar>::Invoke(void*)".
+ */
+static std::string_view
+ExtractBoundMethod(std::string_view s) noexcept
+{
+	const auto end = s.rfind(">::Invoke(");
+	if (end == s.npos)
+		return s;
+
+	s = s.substr(0, end);
+
+	const auto begin = s.rfind(", &");
+	if (begin == s.npos)
+		return s;
+
+	return s.substr(begin + 3);
+}
+
+std::string
+GetEventHandlerName(const void *handler) noexcept
+{
+	const auto name = LookupSymbolName(handler);
+	return std::string{ExtractBoundMethod(name)};
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_EVENT_PROFILER_HXX
+#define MPD_EVENT_PROFILER_HXX
+
+#include "Chrono.hxx"
+#include "metrics/Histogram.hxx"
+#include "thread/Mutex.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Optional instrumentation for an #EventLoop: measures how long each
+ * loop iteration and each event handler takes, and logs handlers
+ * which block the loop for longer than a threshold.
+ *
+ * Handlers are identified by the address of their callback function
+ * (see BoundMethod::GetFunctionAddress()), which can be converted to
+ * a name with GetEventHandlerName().
+ */
+class EventLoopProfiler {
+public:
+	struct HandlerStats {
+		uint_least64_t count = 0;
+		Event::Duration total{}, max{};
+	};
+
+	/**
+	 * Measure the duration of one handler invocation.  The
+	 * constructor and destructor are no-ops if no profiler is
+	 * given.
+	 */
+	class Scope {
+		EventLoopProfiler *const profiler;
+		const void *const handler;
+		Event::TimePoint start;
+
+	public:
+		Scope(EventLoopProfiler *_profiler,
+		      const void *_handler) noexcept
+			:profiler(_profiler), handler(_handler)
+		{
+			if (profiler != nullptr) [[unlikely]]
+				start = Event::Clock::now();
+		}
+
+		~Scope() noexcept {
+			if (profiler != nullptr) [[unlikely]]
+				profiler->AddHandler(handler,
+						     Event::Clock::now() - start);
+		}
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+private:
+	/**
+	 * A name for log messages, e.g. "main" or "io".
+	 */
+	const char *const name;
+
+	/**
+	 * Handlers which take longer than this are logged.  Zero
+	 * disables logging.
+	 */
+	const Event::Duration slow_threshold;
+
+	/**
+	 * The busy time of each loop iteration, i.e. from waking up
+	 * until going to sleep again.
+	 */
+	DurationMetric iterations;
+
+	/**
+	 * Protects #handlers, which is written by the #EventLoop
+	 * thread and read by GetSlowest().
+	 */
+	mutable Mutex mutex;
+
+	std::unordered_map<const void *, HandlerStats> handlers;
+
+public:
+	EventLoopProfiler(const char *_name,
+			  Event::Duration _slow_threshold) noexcept
+		:name(_name), slow_threshold(_slow_threshold) {}
+
+	EventLoopProfiler(const EventLoopProfiler &) = delete;
+	EventLoopProfiler &operator=(const EventLoopProfiler &) = delete;
+
+	const char *GetName() const noexcept {
+		return name;
+	}
+
+	const DurationMetric &GetIterations() const noexcept {
+		return iterations;
+	}
+
+	void AddIteration(Event::Duration d) noexcept {
+		iterations.Add(d);
+	}
+
+	void AddHandler(const void *handler, Event::Duration d) noexcept;
+
+	/**
+	 * Returns the (at most) @n handlers with the largest total
+	 * duration, sorted by total duration in descending order.
+	 *
+	 * This method is thread-safe.
+	 */
+	std::vector<std::pair<const void *, HandlerStats>> GetSlowest(std::size_t n) const noexcept;
+};
+
+/**
+ * Convert a handler address (from #EventLoopProfiler) to a human
+ * readable name, e.g. "Client::OnSocketReady".  See
+ * LookupSymbolName().
+ */
+std::string
+GetEventHandlerName(const void *handler) noexcept;
+
+#endif
@@ -55,6 +55,12 @@ class ServerSocket::OneServerSocket final {
 
 	const AllocatedSocketAddress address;
 
+	/**
+	 * Was this socket bound successfully by Open()?  (As
+	 * opposed to sockets passed to AddFD().)
+	 */
+	bool bound = false;
+
 public:
 	template<typename A>
 	OneServerSocket(EventLoop &_loop, ServerSocket &_parent,
@@ -81,6 +87,14 @@ public:
 		return serial;
 	}
 
+	[[nodiscard]] const AllocatedSocketAddress &GetAddress() const noexcept {
+		return address;
+	}
+
+	[[nodiscard]] bool IsBound() const noexcept {
+		return bound;
+	}
+
 #ifdef HAVE_UN
 	void SetPath(AllocatedPath &&_path) noexcept {
 		assert(path.IsNull());
@@ -109,7 +123,13 @@ public:
 		event.ScheduleRead();
 	}
 
-	void Accept() noexcept;
+	/**
+	 * Accept one connection.
+	 *
+	 * @return false if there was no pending connection (or on
+	 * error)
+	 */
+	bool Accept() noexcept;
 
 private:
 	void OnSocketReady(unsigned flags) noexcept;
@@ -117,6 +137,20 @@ private:
 
 static constexpr Domain server_socket_domain("server_socket");
 
+static constexpr bool
+IsTcp([[maybe_unused]] int family) noexcept
+{
+#ifdef HAVE_TCP
+	return family == AF_INET
+#ifdef HAVE_IPV6
+		|| family == AF_INET6
+#endif
+		;
+#else
+	return false;
+#endif
+}
+
 static int
 get_remote_uid(int fd)
 {
@@ -142,16 +176,20 @@ get_remote_uid(int fd)
 #endif
 }
 
-inline void
+inline bool
 ServerSocket::OneServerSocket::Accept() noexcept
 {
 	StaticSocketAddress peer_address;
 	UniqueSocketDescriptor peer_fd(event.GetSocket().AcceptNonBlock(peer_address));
 	if (!peer_fd.IsDefined()) {
-		const SocketErrorMessage msg;
-		FmtError(server_socket_domain,
-			 "accept() failed: {}", (const char *)msg);
-		return;
+		const auto e = GetSocketError();
+		if (!IsSocketErrorWouldBlock(e)) {
+			const SocketErrorMessage msg(e);
+			FmtError(server_socket_domain,
+				 "accept() failed: {}", (const char *)msg);
+		}
+
+		return false;
 	}
 
 	if (!peer_fd.SetKeepAlive()) {
@@ -164,31 +202,45 @@ ServerSocket::OneServerSocket::Accept() noexcept
 	const auto uid = get_remote_uid(peer_fd.Get());
 
 	parent.OnAccept(std::move(peer_fd), peer_address, uid);
+	return true;
 }
 
+/**
+ * The maximum number of connections accepted per readiness
+ * notification.  Accepting more than one saves a round trip through
+ * the #EventLoop per connection when many clients connect at the
+ * same time (e.g. after a network outage), but the limit keeps other
+ * events from starving.
+ */
+static constexpr unsigned MAX_ACCEPTS_PER_EVENT = 32;
+
 void
 ServerSocket::OneServerSocket::OnSocketReady([[maybe_unused]] unsigned flags) noexcept
 {
-	Accept();
+	for (unsigned i = 0; i < MAX_ACCEPTS_PER_EVENT; ++i)
+		if (!Accept() || !IsDefined())
+			/* no more pending connections (or the
+			   OnAccept() handler has closed the
+			   listener) */
+			break;
 }
 
-inline void
-ServerSocket::OneServerSocket::Open()
+UniqueSocketDescriptor
+ServerSocket::Bind(SocketAddress address) const
 {
-	assert(!IsDefined());
-
-	auto _fd = socket_bind_listen(address.GetFamily(),
-				      SOCK_STREAM, 0,
-				      address, 5);
+	auto fd = socket_bind_listen(address.GetFamily(),
+				     SOCK_STREAM, 0,
+				     address, backlog,
+				     reuse_port && IsTcp(address.GetFamily()));
 
 #ifdef HAVE_TCP
-	if (parent.dscp_class >= 0) {
+	if (dscp_class >= 0) {
 		const int family = address.GetFamily();
 		if ((family == AF_INET &&
-		     !_fd.SetIntOption(IPPROTO_IP, IP_TOS, parent.dscp_class)) ||
+		     !fd.SetIntOption(IPPROTO_IP, IP_TOS, dscp_class)) ||
 		    (family == AF_INET6 &&
-		     !_fd.SetIntOption(IPPROTO_IPV6, IPV6_TCLASS,
-				       parent.dscp_class))) {
+		     !fd.SetIntOption(IPPROTO_IPV6, IPV6_TCLASS,
+				      dscp_class))) {
 			const SocketErrorMessage msg;
 			FmtError(server_socket_domain,
 				 "Could not set DSCP class: {}",
@@ -197,6 +249,16 @@ ServerSocket::OneServerSocket::Open()
 	}
 #endif
 
+	return fd;
+}
+
+inline void
+ServerSocket::OneServerSocket::Open()
+{
+	assert(!IsDefined());
+
+	auto _fd = parent.Bind(address);
+
 #ifdef HAVE_UN
 	/* allow everybody to connect */
 
@@ -207,6 +269,7 @@ ServerSocket::OneServerSocket::Open()
 	/* register in the EventLoop */	
 
 	SetFD(std::move(_fd));
+	bound = true;
 }
 
 ServerSocket::ServerSocket(EventLoop &_loop) noexcept
@@ -325,6 +388,29 @@ ServerSocket::AddFD(UniqueSocketDescriptor fd,
 	s.SetFD(std::move(fd));
 }
 
+std::vector<std::pair<UniqueSocketDescriptor, AllocatedSocketAddress>>
+ServerSocket::BindReusePortClones() const
+{
+	assert(reuse_port);
+
+	std::vector<std::pair<UniqueSocketDescriptor, AllocatedSocketAddress>> result;
+
+	for (const auto &i : sockets) {
+		if (!i.IsBound() || !IsTcp(i.GetAddress().GetFamily()))
+			continue;
+
+		try {
+			result.emplace_back(Bind(i.GetAddress()),
+					    i.GetAddress());
+		} catch (...) {
+			std::throw_with_nested(FmtRuntimeError("Failed to bind to '{}'",
+							       i.ToString()));
+		}
+	}
+
+	return result;
+}
+
 #ifdef HAVE_TCP
 
 inline void
@@ -24,6 +24,8 @@
 
 #include <cassert>
 #include <list>
+#include <utility>
+#include <vector>
 
 class SocketAddress;
 class AllocatedSocketAddress;
@@ -49,8 +51,19 @@ class ServerSocket {
 	int dscp_class = -1;
 #endif
 
+	/**
+	 * The maximum length of the queue of pending connections,
+	 * see listen().
+	 */
+	int backlog = 5;
+
 	unsigned next_serial = 1;
 
+	/**
+	 * Set SO_REUSEPORT on all sockets bound by Open()?
+	 */
+	bool reuse_port = false;
+
 public:
 	ServerSocket(EventLoop &_loop) noexcept;
 	~ServerSocket() noexcept;
@@ -67,10 +80,39 @@ public:
 	}
 #endif
 
+	/**
+	 * Raise the listen() backlog for servers which expect many
+	 * clients to connect at the same time.
+	 */
+	void SetBacklog(int _backlog) noexcept {
+		assert(sockets.empty());
+
+		backlog = _backlog;
+	}
+
+	/**
+	 * Bind all TCP sockets with SO_REUSEPORT, allowing other
+	 * #ServerSocket instances (e.g. in other threads, see
+	 * BindReusePortClones()) to listen on the same addresses.
+	 */
+	void SetReusePort(bool _reuse_port) noexcept {
+		assert(sockets.empty());
+
+		reuse_port = _reuse_port;
+	}
+
 private:
 	template<typename A>
 	OneServerSocket &AddAddress(A &&address) noexcept;
 
+	/**
+	 * Create a socket listening on the given address, with all
+	 * options applied.
+	 *
+	 * Throws on error.
+	 */
+	UniqueSocketDescriptor Bind(SocketAddress address) const;
+
 	/**
 	 * Add a listener on a port on all IPv4 interfaces.
 	 *
@@ -137,6 +179,18 @@ public:
 	void AddFD(UniqueSocketDescriptor fd,
 		   AllocatedSocketAddress &&address) noexcept;
 
+	/**
+	 * Bind one more socket to each TCP address which was bound
+	 * successfully by Open() (requires SetReusePort()).  Local
+	 * sockets and sockets passed to AddFD() are skipped.  The
+	 * new sockets can be passed to AddFD() of another
+	 * #ServerSocket, e.g. one running in another thread; the
+	 * kernel distributes incoming connections among all of them.
+	 *
+	 * Throws on error.
+	 */
+	std::vector<std::pair<UniqueSocketDescriptor, AllocatedSocketAddress>> BindReusePortClones() const;
+
 	bool IsEmpty() const noexcept {
 		return sockets.empty();
 	}
@@ -177,6 +177,13 @@ private:
 	 * Dispatch the events that were passed to SetReadyFlags().
 	 */
 	void Dispatch() noexcept;
+
+	/**
+	 * Identifies the callback for #EventLoopProfiler.
+	 */
+	const void *GetCallbackAddress() const noexcept {
+		return callback.GetFunctionAddress();
+	}
 };
 
 #endif
@@ -32,6 +32,7 @@
 
 #include "Loop.hxx"
 #include "FineTimerEvent.hxx"
+#include "Profiler.hxx"
 
 #ifdef NO_BOOST
 #include <algorithm>
@@ -58,7 +59,8 @@ TimerList::Insert(FineTimerEvent &t) noexcept
 }
 
 Event::Duration
-TimerList::Run(const Event::TimePoint now) noexcept
+TimerList::Run(const Event::TimePoint now,
+	       EventLoopProfiler *profiler) noexcept
 {
 	while (true) {
 		auto i = timers.begin();
@@ -76,6 +78,8 @@ TimerList::Run(const Event::TimePoint now) noexcept
 		timers.erase(i);
 #endif
 
+		const EventLoopProfiler::Scope scope(profiler,
+						     t.GetCallbackAddress());
 		t.Run();
 	}
 
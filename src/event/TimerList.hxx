@@ -42,6 +42,7 @@
 #endif
 
 class FineTimerEvent;
+class EventLoopProfiler;
 
 /**
  * A list of #FineTimerEvent instances sorted by due time point.
@@ -81,6 +82,10 @@ public:
 	 * Invoke all expired #FineTimerEvent instances and return the
 	 * duration until the next timer expires.  Returns a negative
 	 * duration if there is no timeout.
+	 *
+	 * @param profiler an optional profiler which measures each
+	 * timer callback
 	 */
-	Event::Duration Run(Event::TimePoint now) noexcept;
+	Event::Duration Run(Event::TimePoint now,
+			    EventLoopProfiler *profiler=nullptr) noexcept;
 };
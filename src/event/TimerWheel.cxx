@@ -32,6 +32,7 @@
 
 #include "TimerWheel.hxx"
 #include "CoarseTimerEvent.hxx"
+#include "Profiler.hxx"
 
 #include <cassert>
 
@@ -45,25 +46,57 @@ TimerWheel::TimerWheel() noexcept
 
 TimerWheel::~TimerWheel() noexcept = default;
 
-void
-TimerWheel::Insert(CoarseTimerEvent &t,
-		   Event::TimePoint now) noexcept
+inline void
+TimerWheel::Link(CoarseTimerEvent &t, Event::TimePoint now) noexcept
 {
 	assert(now >= last_time);
 
-	auto &list = t.GetDue() > now
-		? buckets[BucketIndexAt(t.GetDue())]
+	if (t.GetDue() <= now) {
 		/* if this timer is already due, insert it into the
 		   "ready" list to be invoked without delay */
-		: ready;
+		ready.push_back(t);
+	} else if (t.GetDue() - now >= SPAN) {
+		/* too far in the future for the fine-grained wheel;
+		   it will be cascaded when its far bucket starts */
+		far_buckets[FarBucketIndexAt(t.GetDue())].push_back(t);
+		far_empty = false;
+	} else {
+		buckets[BucketIndexAt(t.GetDue())].push_back(t);
+		empty = false;
+	}
+}
 
-	list.push_back(t);
+void
+TimerWheel::Insert(CoarseTimerEvent &t,
+		   Event::TimePoint now) noexcept
+{
+	Stats::Increment(stats.inserted);
+	Link(t, now);
+}
 
-	empty = false;
+void
+TimerWheel::Postpone(CoarseTimerEvent &t, Event::TimePoint due) noexcept
+{
+	assert(t.IsPending());
+	assert(due >= t.GetDue());
+
+	Stats::Increment(stats.postponed);
+	t.due = due;
+}
+
+inline void
+TimerWheel::Expire(CoarseTimerEvent &t, EventLoopProfiler *profiler) noexcept
+{
+	Stats::Increment(stats.expired);
+
+	const EventLoopProfiler::Scope scope(profiler,
+					     t.GetCallbackAddress());
+	t.Run();
 }
 
 void
-TimerWheel::Run(List &list, Event::TimePoint now) noexcept
+TimerWheel::Run(List &list, Event::TimePoint now,
+		EventLoopProfiler *profiler) noexcept
 {
 	/* move all timers to a temporary list to avoid problems with
 	   canceled timers while we traverse the list */
@@ -72,15 +105,51 @@ TimerWheel::Run(List &list, Event::TimePoint now) noexcept
 	tmp.clear_and_dispose([&](auto *t){
 		if (t->GetDue() <= now) {
 			/* this timer is due: run it */
-			t->Run();
+			Expire(*t, profiler);
 		} else {
-			/* not yet due: move it back to the given
-			   list */
-			list.push_back(*t);
+			/* not yet due (postponed or wrapped around):
+			   move it to the bucket of its due time */
+			Link(*t, now);
 		}
 	});
 }
 
+void
+TimerWheel::Cascade(Event::TimePoint now) noexcept
+{
+	const auto far_start_time = GetFarBucketStartTime(now);
+	if (far_start_time == last_far_time)
+		/* still in the same far bucket */
+		return;
+
+	/* cascade all buckets which have started since the last
+	   call, up to (and including) the current one */
+	std::size_t i = far_empty
+		/* nothing to do, skip the loop */
+		? FarBucketIndexAt(now)
+		: now < last_far_time || now >= last_far_time + FAR_SPAN
+		/* too much time has passed (or time warp): cascade
+		   all buckets */
+		? NextFarBucketIndex(FarBucketIndexAt(now))
+		: NextFarBucketIndex(FarBucketIndexAt(last_far_time));
+	const std::size_t end = FarBucketIndexAt(now);
+
+	last_far_time = far_start_time;
+
+	while (true) {
+		auto tmp = std::move(far_buckets[i]);
+		tmp.clear_and_dispose([&](auto *t){
+			Stats::Increment(stats.cascaded);
+			Link(*t, now);
+		});
+
+		if (i == end)
+			break;
+
+		i = NextFarBucketIndex(i);
+	}
+}
+
 inline Event::TimePoint
 TimerWheel::GetNextDue(const std::size_t bucket_index,
 		       const Event::TimePoint bucket_start_time) const noexcept
@@ -102,6 +171,29 @@ TimerWheel::GetNextDue(const std::size_t bucket_index,
 	}
 }
 
+inline Event::TimePoint
+TimerWheel::GetNextFarDue(const std::size_t bucket_index,
+			  const Event::TimePoint bucket_start_time) const noexcept
+{
+	Event::TimePoint t = bucket_start_time;
+
+	/* the current bucket has already been cascaded; anything
+	   in it has wrapped around and will be cascaded in the next
+	   round */
+	for (std::size_t i = bucket_index;;) {
+		i = NextFarBucketIndex(i);
+		t += FAR_RESOLUTION;
+
+		if (!far_buckets[i].empty())
+			/* found a non-empty bucket; return this
+			   bucket's start time */
+			return t;
+
+		if (i == bucket_index)
+			return Event::TimePoint::max();
+	}
+}
+
 inline Event::Duration
 TimerWheel::GetSleep(Event::TimePoint now) const noexcept
 {
@@ -109,25 +201,46 @@ TimerWheel::GetSleep(Event::TimePoint now) const noexcept
 	   method gets called only from Run() after the "ready" list
 	   has been processed already */
 
-	if (empty)
-		return Event::Duration(-1);
+	auto t = Event::TimePoint::max();
 
-	auto t = GetNextDue(BucketIndexAt(now), GetBucketStartTime(now));
-	assert(t > now);
-	if (t == Event::TimePoint::max()) {
-		empty = true;
-		return Event::Duration(-1);
+	if (!empty) {
+		t = GetNextDue(BucketIndexAt(now), GetBucketStartTime(now));
+		assert(t > now);
+		if (t == Event::TimePoint::max())
+			empty = true;
+	}
+
+	if (!far_empty) {
+		const auto far_t = GetNextFarDue(FarBucketIndexAt(now),
+						 GetFarBucketStartTime(now));
+		assert(far_t > now);
+		if (far_t == Event::TimePoint::max())
+			far_empty = true;
+		else
+			t = std::min(t, far_t);
 	}
 
+	if (t == Event::TimePoint::max())
+		return Event::Duration(-1);
+
 	return t - now;
 }
 
 Event::Duration
-TimerWheel::Run(const Event::TimePoint now) noexcept
+TimerWheel::Run(const Event::TimePoint now,
+		EventLoopProfiler *profiler) noexcept
 {
-	/* invoke the "ready" list unconditionally */
+	/* move far timers to the fine-grained wheel (or to the
+	   "ready" list) first, so they get checked below */
+	Cascade(now);
+
+	/* invoke the "ready" list unconditionally (except for
+	   timers which have been postponed in the meantime) */
 	ready.clear_and_dispose([&](auto *t){
-		t->Run();
+		if (t->GetDue() <= now)
+			Expire(*t, profiler);
+		else
+			Link(*t, now);
 	});
 
 	/* check all buckets between the last time we were invoked and
@@ -161,7 +274,7 @@ TimerWheel::Run(const Event::TimePoint now) noexcept
 	/* run those buckets */
 
 	for (std::size_t i = start_bucket;;) {
-		Run(buckets[i], now);
+		Run(buckets[i], now, profiler);
 
 		i = NextBucketIndex(i);
 		if (i == end_bucket)
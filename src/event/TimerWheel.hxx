@@ -37,12 +37,19 @@
 
 #include <array>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 
 class CoarseTimerEvent;
+class EventLoopProfiler;
 
 /**
- * A list of #CoarseTimerEvent instances managed in a circular timer
- * wheel.
+ * A list of #CoarseTimerEvent instances managed in a hierarchical
+ * circular timer wheel: timers due within #SPAN are kept in
+ * #buckets with a resolution of one second, and timers due later
+ * are kept in #far_buckets with a resolution of #SPAN, from where
+ * they are moved ("cascaded") to #buckets when their time comes
+ * near.
  */
 class TimerWheel final {
 	static constexpr Event::Duration RESOLUTION = std::chrono::seconds(1);
@@ -52,18 +59,30 @@ class TimerWheel final {
 
 	static constexpr std::size_t N_BUCKETS = SPAN / RESOLUTION;
 
+	static constexpr Event::Duration FAR_RESOLUTION = SPAN;
+	static constexpr std::size_t N_FAR_BUCKETS = 64;
+	static constexpr Event::Duration FAR_SPAN = FAR_RESOLUTION * N_FAR_BUCKETS;
+
 	using List = IntrusiveList<CoarseTimerEvent>;
 
 	/**
 	 * Each bucket contains a doubly linked list of
 	 * #CoarseTimerEvent instances scheduled for one #RESOLUTION.
 	 *
-	 * Timers scheduled far into the future (more than #SPAN) may
-	 * also sit in between, so anybody walking those lists should
-	 * check the due time.
+	 * Timers which have been postponed (see Postpone()) stay in
+	 * the bucket of their old due time, so anybody walking those
+	 * lists should check the due time.
 	 */
 	std::array<List, N_BUCKETS> buckets;
 
+	/**
+	 * Timers which are due more than #SPAN in the future, one
+	 * bucket per #FAR_RESOLUTION.  Timers scheduled more than
+	 * #FAR_SPAN in the future wrap around and are cascaded more
+	 * than once.
+	 */
+	std::array<List, N_FAR_BUCKETS> far_buckets;
+
 	/**
 	 * A list of timers which are already ready.  This can happen
 	 * if they are scheduled with a zero duration or scheduled in
@@ -79,6 +98,12 @@ class TimerWheel final {
 	 */
 	Event::TimePoint last_time{};
 
+	/**
+	 * The start time of the #far_buckets bucket which was
+	 * cascaded last.
+	 */
+	Event::TimePoint last_far_time{};
+
 	/**
 	 * If this flag is true, then all buckets are guaranteed to be
 	 * empty.  If it is false, the buckets may or may not be
@@ -89,27 +114,93 @@ class TimerWheel final {
 	 */
 	mutable bool empty = true;
 
+	/**
+	 * Like #empty, but for #far_buckets.
+	 */
+	mutable bool far_empty = true;
+
+public:
+	/**
+	 * Counters for diagnostics.  They are only modified by the
+	 * #EventLoop thread, but may be read by any thread.
+	 */
+	struct Stats {
+		/**
+		 * Calls to Insert(), i.e. timers which were
+		 * (re)linked into the wheel.
+		 */
+		std::atomic<uint_least64_t> inserted{0};
+
+		/**
+		 * Calls to Postpone(), i.e. reschedules which only
+		 * updated the due time.
+		 */
+		std::atomic<uint_least64_t> postponed{0};
+
+		/**
+		 * Timers whose callback was invoked.
+		 */
+		std::atomic<uint_least64_t> expired{0};
+
+		/**
+		 * Timers which were moved from #far_buckets to
+		 * #buckets.
+		 */
+		std::atomic<uint_least64_t> cascaded{0};
+
+		static void Increment(std::atomic<uint_least64_t> &c) noexcept {
+			/* there is only one writer, so this doesn't
+			   need an (expensive) atomic
+			   read-modify-write operation */
+			c.store(c.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+		}
+	};
+
+private:
+	Stats stats;
+
 public:
 	TimerWheel() noexcept;
 	~TimerWheel() noexcept;
 
 	bool IsEmpty() const noexcept {
+		const auto is_empty = [](const auto &list){
+			return list.empty();
+		};
+
 		return ready.empty() &&
-			std::all_of(buckets.begin(), buckets.end(),
-				    [](const auto &list){
-					    return list.empty();
-				    });
+			std::all_of(buckets.begin(), buckets.end(), is_empty) &&
+			std::all_of(far_buckets.begin(), far_buckets.end(),
+				    is_empty);
+	}
+
+	const Stats &GetStats() const noexcept {
+		return stats;
 	}
 
 	void Insert(CoarseTimerEvent &t,
 		    Event::TimePoint now) noexcept;
 
+	/**
+	 * Move the due time of a pending timer to a later time
+	 * without moving it inside the wheel.  When the old due time
+	 * is reached, the timer is linked into the bucket of the new
+	 * due time.  This is cheap for timeouts which are reset
+	 * often (e.g. on each request), but expire rarely.
+	 */
+	void Postpone(CoarseTimerEvent &t, Event::TimePoint due) noexcept;
+
 	/**
 	 * Invoke all expired #CoarseTimerEvent instances and return
 	 * the duration until the next timer expires.  Returns a
 	 * negative duration if there is no timeout.
+	 *
+	 * @param profiler an optional profiler which measures each
+	 * timer callback
 	 */
-	Event::Duration Run(Event::TimePoint now) noexcept;
+	Event::Duration Run(Event::TimePoint now,
+			    EventLoopProfiler *profiler=nullptr) noexcept;
 
 private:
 	static constexpr std::size_t NextBucketIndex(std::size_t i) noexcept {
@@ -125,6 +216,24 @@ private:
 		return t - t.time_since_epoch() % RESOLUTION;
 	}
 
+	static constexpr std::size_t NextFarBucketIndex(std::size_t i) noexcept {
+		return (i + 1) % N_FAR_BUCKETS;
+	}
+
+	static constexpr std::size_t FarBucketIndexAt(Event::TimePoint t) noexcept {
+		return std::size_t(t.time_since_epoch() / FAR_RESOLUTION)
+			% N_FAR_BUCKETS;
+	}
+
+	static constexpr Event::TimePoint GetFarBucketStartTime(Event::TimePoint t) noexcept {
+		return t - t.time_since_epoch() % FAR_RESOLUTION;
+	}
+
+	/**
+	 * Link the timer into the list matching its due time.
+	 */
+	void Link(CoarseTimerEvent &t, Event::TimePoint now) noexcept;
+
 	/**
 	 * What is the end time of the next non-empty bucket?
 	 *
@@ -135,11 +244,31 @@ private:
 	Event::TimePoint GetNextDue(std::size_t bucket_index,
 				    Event::TimePoint bucket_start_time) const noexcept;
 
+	/**
+	 * When is the next non-empty #far_buckets bucket going to be
+	 * cascaded?
+	 *
+	 * @return the bucket start time or max() if there is none
+	 */
+	[[gnu::pure]]
+	Event::TimePoint GetNextFarDue(std::size_t bucket_index,
+				       Event::TimePoint bucket_start_time) const noexcept;
+
 	[[gnu::pure]]
 	Event::Duration GetSleep(Event::TimePoint now) const noexcept;
 
 	/**
-	 * Run all due timers in this bucket.
+	 * Move all timers from #far_buckets whose bucket has
+	 * started since the last call to #buckets.
 	 */
-	static void Run(List &list, Event::TimePoint now) noexcept;
+	void Cascade(Event::TimePoint now) noexcept;
+
+	/**
+	 * Run all due timers in this bucket, and re-link the others.
+	 */
+	void Run(List &list, Event::TimePoint now,
+		 EventLoopProfiler *profiler) noexcept;
+
+	void Expire(CoarseTimerEvent &t,
+		    EventLoopProfiler *profiler) noexcept;
 };
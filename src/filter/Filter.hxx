@@ -63,6 +63,43 @@ public:
 	 */
 	virtual std::span<const std::byte> FilterPCM(std::span<const std::byte> src) = 0;
 
+	/**
+	 * Can this filter (in its current state) modify a buffer in
+	 * place, see FilterInPlace()?  Such a filter produces exactly
+	 * as many bytes as it consumes.
+	 */
+	[[gnu::pure]]
+	virtual bool IsInPlace() const noexcept {
+		return false;
+	}
+
+	/**
+	 * Filters a block of PCM data in place.  This may only be
+	 * called if IsInPlace() returns true.
+	 *
+	 * Throws on error.
+	 */
+	virtual void FilterInPlace([[maybe_unused]] std::span<std::byte> data) {
+		assert(false);
+	}
+
+	/**
+	 * Like FilterPCM(), but the caller allows the filter to
+	 * modify the contents of the source buffer, which saves a
+	 * copy in filters implementing FilterInPlace().  The
+	 * returned buffer may point into the source buffer.
+	 *
+	 * Throws on error.
+	 */
+	virtual std::span<const std::byte> FilterWritable(std::span<std::byte> src) {
+		if (IsInPlace()) {
+			FilterInPlace(src);
+			return src;
+		}
+
+		return FilterPCM(src);
+	}
+
 	/**
 	 * Flush pending data and return it.  This should be called
 	 * repeatedly until it returns nullptr.
@@ -84,6 +84,18 @@ public:
 		return filter->FilterPCM(src);
 	}
 
+	bool IsInPlace() const noexcept override {
+		return filter->IsInPlace();
+	}
+
+	void FilterInPlace(std::span<std::byte> data) override {
+		filter->FilterInPlace(data);
+	}
+
+	std::span<const std::byte> FilterWritable(std::span<std::byte> src) override {
+		return filter->FilterWritable(src);
+	}
+
 	std::span<const std::byte> Flush() override {
 		return filter->Flush();
 	}
@@ -18,6 +18,7 @@
  */
 
 #include "FfmpegFilter.hxx"
+#include "FfmpegFilterCache.hxx"
 #include "lib/ffmpeg/Interleave.hxx"
 #include "lib/ffmpeg/SampleFormat.hxx"
 
@@ -28,21 +29,26 @@ extern "C" {
 
 #include <string.h>
 
-FfmpegFilter::FfmpegFilter(const AudioFormat &in_audio_format,
+FfmpegFilter::FfmpegFilter(const AudioFormat &_in_audio_format,
 			   const AudioFormat &_out_audio_format,
 			   Ffmpeg::FilterGraph &&_graph,
 			   AVFilterContext &_buffer_src,
-			   AVFilterContext &_buffer_sink) noexcept
+			   AVFilterContext &_buffer_sink,
+			   std::shared_ptr<FfmpegFilterCache> _cache,
+			   const AudioFormat &_requested_audio_format) noexcept
 	:Filter(_out_audio_format),
+	 cache(std::move(_cache)),
+	 requested_audio_format(_requested_audio_format),
 	 graph(std::move(_graph)),
 	 buffer_src(_buffer_src),
 	 buffer_sink(_buffer_sink),
-	 in_format(Ffmpeg::ToFfmpegSampleFormat(in_audio_format.format)),
-	 in_sample_rate(in_audio_format.sample_rate),
+	 in_format(Ffmpeg::ToFfmpegSampleFormat(_in_audio_format.format)),
+	 in_sample_rate(_in_audio_format.sample_rate),
 #if LIBAVUTIL_VERSION_INT < AV_VERSION_INT(57, 25, 100)
-	 in_channels(in_audio_format.channels),
+	 in_channels(_in_audio_format.channels),
 #endif
-	 in_audio_frame_size(in_audio_format.GetFrameSize()),
+	 in_audio_format(_in_audio_format),
+	 in_audio_frame_size(_in_audio_format.GetFrameSize()),
 	 out_audio_frame_size(_out_audio_format.GetFrameSize())
 {
 #if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 25, 100)
@@ -50,6 +56,19 @@ FfmpegFilter::FfmpegFilter(const AudioFormat &in_audio_format,
 #endif
 }
 
+FfmpegFilter::~FfmpegFilter() noexcept
+{
+	if (cache)
+		cache->Put({
+				requested_audio_format,
+				in_audio_format,
+				out_audio_format,
+				std::move(graph),
+				&buffer_src,
+				&buffer_sink,
+			});
+}
+
 std::span<const std::byte>
 FfmpegFilter::FilterPCM(std::span<const std::byte> src)
 {
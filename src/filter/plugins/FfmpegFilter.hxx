@@ -25,10 +25,26 @@
 #include "lib/ffmpeg/Filter.hxx"
 #include "lib/ffmpeg/Frame.hxx"
 
+#include <memory>
+
+class FfmpegFilterCache;
+
 /**
  * A #Filter implementation using FFmpeg's libavfilter.
  */
 class FfmpegFilter final : public Filter {
+	/**
+	 * If not nullptr, then the destructor returns the #graph to
+	 * this cache.
+	 */
+	const std::shared_ptr<FfmpegFilterCache> cache;
+
+	/**
+	 * The #AudioFormat which was passed to
+	 * PreparedFilter::Open(), used as the #cache key.
+	 */
+	const AudioFormat requested_audio_format;
+
 	Ffmpeg::FilterGraph graph;
 	AVFilterContext &buffer_src, &buffer_sink;
 	Ffmpeg::Frame frame;
@@ -43,6 +59,7 @@ class FfmpegFilter final : public Filter {
 	const int in_channels;
 #endif
 
+	const AudioFormat in_audio_format;
 	const size_t in_audio_frame_size;
 	const size_t out_audio_frame_size;
 
@@ -53,12 +70,20 @@ public:
 	 * input
 	 * @param _buffer_sink an "abuffersink" filter which serves as
 	 * output
+	 * @param _cache if not nullptr, then the graph is returned
+	 * to this cache when the filter is destroyed
+	 * @param _requested_audio_format the cache key; only used
+	 * if there is a cache
 	 */
-	FfmpegFilter(const AudioFormat &in_audio_format,
+	FfmpegFilter(const AudioFormat &_in_audio_format,
 		     const AudioFormat &_out_audio_format,
 		     Ffmpeg::FilterGraph &&_graph,
 		     AVFilterContext &_buffer_src,
-		     AVFilterContext &_buffer_sink) noexcept;
+		     AVFilterContext &_buffer_sink,
+		     std::shared_ptr<FfmpegFilterCache> _cache={},
+		     const AudioFormat &_requested_audio_format=AudioFormat::Undefined()) noexcept;
+
+	~FfmpegFilter() noexcept override;
 
 	/* virtual methods from class Filter */
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FfmpegFilterCache.hxx"
+#include "lib/ffmpeg/Frame.hxx"
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+}
+
+std::optional<FfmpegFilterCache::Item>
+FfmpegFilterCache::Get(const AudioFormat &audio_format) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	for (auto i = items.begin(); i != items.end(); ++i) {
+		if (i->requested_audio_format == audio_format) {
+			std::optional<Item> result{std::move(*i)};
+			items.erase(i);
+			return result;
+		}
+	}
+
+	return std::nullopt;
+}
+
+void
+FfmpegFilterCache::Put(Item &&item) noexcept
+try {
+	/* drop output which was not collected by FilterPCM(), so it
+	   does not leak into the next song */
+	Ffmpeg::Frame frame;
+	while (av_buffersink_get_frame(item.buffer_sink, frame.get()) >= 0)
+		frame.Unref();
+
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	/* replace an older graph with the same input format */
+	items.remove_if([&item](const Item &i){
+		return i.requested_audio_format == item.requested_audio_format;
+	});
+
+	items.emplace_front(std::move(item));
+
+	if (items.size() > MAX_ITEMS)
+		items.pop_back();
+} catch (...) {
+	/* Ffmpeg::Frame allocation failed; just free the graph */
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FFMPEG_FILTER_CACHE_HXX
+#define MPD_FFMPEG_FILTER_CACHE_HXX
+
+#include "lib/ffmpeg/Filter.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+
+#include <list>
+#include <optional>
+
+/**
+ * Configured FFmpeg filter graphs which are not currently in use,
+ * keyed by input format.  A #FfmpegFilter returns its graph here
+ * when it is closed, and the next Open() call with the same input
+ * format picks it up instead of building and probing a new graph.
+ * This avoids rebuilding graphs at each sample rate change in a
+ * library which mixes rates.
+ */
+class FfmpegFilterCache {
+	/**
+	 * The maximum number of idle graphs.
+	 */
+	static constexpr std::size_t MAX_ITEMS = 4;
+
+public:
+	struct Item {
+		/**
+		 * The #AudioFormat passed to Open(), i.e. the lookup
+		 * key.
+		 */
+		AudioFormat requested_audio_format;
+
+		/**
+		 * The input format of the graph; may differ from
+		 * #requested_audio_format if FFmpeg does not support
+		 * it.
+		 */
+		AudioFormat in_audio_format;
+
+		AudioFormat out_audio_format;
+
+		Ffmpeg::FilterGraph graph;
+		AVFilterContext *buffer_src, *buffer_sink;
+	};
+
+private:
+	Mutex mutex;
+
+	/**
+	 * The most recently returned item comes first.
+	 */
+	std::list<Item> items;
+
+public:
+	/**
+	 * Remove a graph with the given input format from the cache.
+	 */
+	std::optional<Item> Get(const AudioFormat &audio_format) noexcept;
+
+	/**
+	 * Give a graph back to the cache.  Frames still queued in
+	 * the sink are discarded.
+	 */
+	void Put(Item &&item) noexcept;
+};
+
+#endif
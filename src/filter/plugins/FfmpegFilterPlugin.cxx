@@ -19,6 +19,7 @@
 
 #include "FfmpegFilterPlugin.hxx"
 #include "FfmpegFilter.hxx"
+#include "FfmpegFilterCache.hxx"
 #include "filter/FilterPlugin.hxx"
 #include "filter/Filter.hxx"
 #include "filter/Prepared.hxx"
@@ -29,6 +30,12 @@
 class PreparedFfmpegFilter final : public PreparedFilter {
 	const char *const graph_string;
 
+	/**
+	 * Graphs of closed filters, to be reused by Open().
+	 */
+	const std::shared_ptr<FfmpegFilterCache> cache =
+		std::make_shared<FfmpegFilterCache>();
+
 public:
 	explicit PreparedFfmpegFilter(const char *_graph) noexcept
 		:graph_string(_graph) {}
@@ -45,7 +52,9 @@ public:
  * format later, and eliminate this kludge
  */
 static auto
-OpenWithAformat(const char *graph_string, AudioFormat &in_audio_format)
+OpenWithAformat(const char *graph_string, AudioFormat &in_audio_format,
+		std::shared_ptr<FfmpegFilterCache> cache,
+		const AudioFormat &requested_audio_format)
 {
 	Ffmpeg::FilterGraph graph;
 
@@ -68,12 +77,30 @@ OpenWithAformat(const char *graph_string, AudioFormat &in_audio_format)
 					      out_audio_format,
 					      std::move(graph),
 					      buffer_src,
-					      buffer_sink);
+					      buffer_sink,
+					      std::move(cache),
+					      requested_audio_format);
 }
 
 std::unique_ptr<Filter>
 PreparedFfmpegFilter::Open(AudioFormat &in_audio_format)
 {
+	const AudioFormat requested_audio_format = in_audio_format;
+
+	if (auto item = cache->Get(requested_audio_format)) {
+		/* reuse the graph of a previously closed filter;
+		   its output format is already known, no need to
+		   probe it again */
+		in_audio_format = item->in_audio_format;
+		return std::make_unique<FfmpegFilter>(in_audio_format,
+						      item->out_audio_format,
+						      std::move(item->graph),
+						      *item->buffer_src,
+						      *item->buffer_sink,
+						      cache,
+						      requested_audio_format);
+	}
+
 	Ffmpeg::FilterGraph graph;
 
 	auto &buffer_src =
@@ -103,13 +130,16 @@ PreparedFfmpegFilter::Open(AudioFormat &in_audio_format)
 		   workaround for this MPD API deficiency, try again
 		   with an "aformat" filter which forces a specific
 		   output format */
-		return OpenWithAformat(graph_string, in_audio_format);
+		return OpenWithAformat(graph_string, in_audio_format,
+				       cache, requested_audio_format);
 
 	return std::make_unique<FfmpegFilter>(in_audio_format,
 					      out_audio_format,
 					      std::move(graph),
 					      buffer_src,
-					      buffer_sink);
+					      buffer_sink,
+					      cache,
+					      requested_audio_format);
 }
 
 static std::unique_ptr<PreparedFilter>
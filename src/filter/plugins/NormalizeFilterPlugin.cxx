@@ -23,30 +23,30 @@
 #include "filter/Prepared.hxx"
 #include "pcm/Buffer.hxx"
 #include "pcm/AudioFormat.hxx"
-#include "pcm/AudioCompress/compress.h"
+#include "pcm/Normalizer.hxx"
 
 #include <string.h>
 
 class NormalizeFilter final : public Filter {
-	Compressor *const compressor;
+	PcmNormalizer normalizer;
 
 	PcmBuffer buffer;
 
 public:
 	explicit NormalizeFilter(const AudioFormat &audio_format)
-		:Filter(audio_format), compressor(Compressor_new(0)) {
+		:Filter(audio_format), normalizer(audio_format.format) {
 	}
 
-	~NormalizeFilter() override {
-		Compressor_delete(compressor);
-	}
-
-
-	NormalizeFilter(const NormalizeFilter &) = delete;
-	NormalizeFilter &operator=(const NormalizeFilter &) = delete;
-
 	/* virtual methods from class Filter */
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
+
+	bool IsInPlace() const noexcept override {
+		return true;
+	}
+
+	void FilterInPlace(std::span<std::byte> data) noexcept override {
+		normalizer.Process(data);
+	}
 };
 
 class PreparedNormalizeFilter final : public PreparedFilter {
@@ -64,7 +64,10 @@ normalize_filter_init([[maybe_unused]] const ConfigBlock &block)
 std::unique_ptr<Filter>
 PreparedNormalizeFilter::Open(AudioFormat &audio_format)
 {
-	audio_format.format = SampleFormat::S16;
+	/* 16, 24 and 32 bit and floating point samples are processed
+	   natively; everything else is converted to floating point */
+	if (!PcmNormalizer::IsSupported(audio_format.format))
+		audio_format.format = SampleFormat::FLOAT;
 
 	return std::make_unique<NormalizeFilter>(audio_format);
 }
@@ -72,11 +75,11 @@ PreparedNormalizeFilter::Open(AudioFormat &audio_format)
 std::span<const std::byte>
 NormalizeFilter::FilterPCM(std::span<const std::byte> src)
 {
-	auto *dest = (int16_t *)buffer.Get(src.size());
+	auto *dest = (std::byte *)buffer.Get(src.size());
 	memcpy(dest, src.data(), src.size());
 
-	Compressor_Process_int16(compressor, dest, src.size() / 2);
-	return { (const std::byte *)dest, src.size() };
+	FilterInPlace({dest, src.size()});
+	return { dest, src.size() };
 }
 
 const FilterPlugin normalize_filter_plugin = {
@@ -111,6 +111,14 @@ public:
 
 	/* virtual methods from class Filter */
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
+
+	bool IsInPlace() const noexcept override {
+		return mixer == nullptr && pv.CanApplyInPlace();
+	}
+
+	void FilterInPlace(std::span<std::byte> data) noexcept override {
+		pv.ApplyInPlace(data);
+	}
 };
 
 class PreparedReplayGainFilter final : public PreparedFilter {
@@ -37,6 +37,11 @@
  *
  * If multiple sources are copied to the same destination channel, only
  * one of them takes effect.
+ *
+ * A route may have a linear gain factor: \\
+ * routes "0>0, 1>1, 0>2*0.5, 1>2*0.5" \\
+ * If at least one route has a gain, the filter works on floating
+ * point samples and all sources of a destination channel are mixed.
  */
 
 #include "RouteFilterPlugin.hxx"
@@ -48,23 +53,174 @@
 #include "pcm/Buffer.hxx"
 #include "pcm/Silence.hxx"
 #include "lib/fmt/RuntimeError.hxx"
+#include "util/Compiler.h"
 #include "util/StringStrip.hxx"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdint>
 #include <stdexcept>
 
-#include <string.h>
 #include <stdlib.h>
 
+/**
+ * A matrix of gain factors; the first index is the output channel,
+ * the second one the input channel.
+ */
+using RouteGains = std::array<std::array<float, MAX_CHANNELS>, MAX_CHANNELS>;
+
+/**
+ * The precompiled copy operations of a #RouteFilter.
+ */
+struct RoutePlan {
+	unsigned in_channels, out_channels;
+
+	/**
+	 * The input channel for each output channel.  Silent output
+	 * channels refer to input channel 0 and are masked out by
+	 * #silent.
+	 */
+	std::array<uint8_t, MAX_CHANNELS> sources;
+
+	/**
+	 * Which output channels are silent (because they have no
+	 * source or the source is not available in the input)?
+	 */
+	std::array<bool, MAX_CHANNELS> silent;
+
+	/**
+	 * Is the output equal to the input?
+	 */
+	bool identity;
+
+	RoutePlan(unsigned _in_channels, unsigned _out_channels,
+		  const std::array<int8_t, MAX_CHANNELS> &_sources) noexcept
+		:in_channels(_in_channels), out_channels(_out_channels),
+		 identity(in_channels == out_channels)
+	{
+		for (unsigned c = 0; c < out_channels; ++c) {
+			const int source = _sources[c];
+			silent[c] = source < 0 || unsigned(source) >= in_channels;
+			sources[c] = silent[c] ? 0 : source;
+
+			if (silent[c] || unsigned(source) != c)
+				identity = false;
+		}
+	}
+};
+
+/**
+ * Copy samples according to the #RoutePlan.  The number of output
+ * channels is a compile-time constant, which allows the compiler to
+ * keep the whole plan in registers and to unroll the inner loop; a
+ * mask instead of a branch selects silence.
+ */
+template<unsigned OUT, typename T>
+static void
+RouteGather(T *dest, const T *src, std::size_t n_frames,
+	    const RoutePlan &plan, T silence) noexcept
+{
+	const unsigned in_channels = plan.in_channels;
+
+	std::array<uint8_t, OUT> sources;
+	std::array<T, OUT> mask, fill;
+	for (unsigned c = 0; c < OUT; ++c) {
+		sources[c] = plan.sources[c];
+		mask[c] = plan.silent[c] ? T(0) : T(~T(0));
+		fill[c] = plan.silent[c] ? silence : T(0);
+	}
+
+	for (std::size_t i = 0; i < n_frames; ++i, src += in_channels, dest += OUT)
+#pragma GCC unroll 8
+		for (unsigned c = 0; c < OUT; ++c)
+			dest[c] = (src[sources[c]] & mask[c]) | fill[c];
+}
+
+template<typename T>
+static void
+Route(std::byte *_dest, const std::byte *_src, std::size_t n_frames,
+      const RoutePlan &plan, SampleFormat format) noexcept
+{
+	T silence;
+	PcmSilence(std::as_writable_bytes(std::span{&silence, 1}), format);
+
+	auto *dest = (T *)_dest;
+	const auto *src = (const T *)_src;
+
+	static_assert(MAX_CHANNELS == 8);
+
+	switch (plan.out_channels) {
+	case 1:
+		RouteGather<1>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 2:
+		RouteGather<2>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 3:
+		RouteGather<3>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 4:
+		RouteGather<4>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 5:
+		RouteGather<5>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 6:
+		RouteGather<6>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 7:
+		RouteGather<7>(dest, src, n_frames, plan, silence);
+		break;
+
+	case 8:
+		RouteGather<8>(dest, src, n_frames, plan, silence);
+		break;
+
+	default:
+		assert(false);
+		gcc_unreachable();
+	}
+}
+
+/**
+ * Apply a gain matrix: each output channel is the weighted sum of
+ * all input channels.
+ */
+static void
+RouteMix(float *dest, const float *src, std::size_t n_frames,
+	 unsigned in_channels, unsigned out_channels,
+	 const RouteGains &gains) noexcept
+{
+	for (std::size_t i = 0; i < n_frames; ++i, src += in_channels) {
+		for (unsigned c = 0; c < out_channels; ++c) {
+			const auto &g = gains[c];
+			float sum = 0;
+			for (unsigned s = 0; s < in_channels; ++s)
+				sum += g[s] * src[s];
+			*dest++ = sum;
+		}
+	}
+}
+
 class RouteFilter final : public Filter {
+	const RoutePlan plan;
+
 	/**
-	 * The set of copy operations to perform on each sample
-	 * The index is an output channel to use, the value is
-	 * a corresponding input channel from which to take the
-	 * data. A -1 means "no source"
+	 * The gain matrix; only used if #mix is set.
 	 */
-	const std::array<int8_t, MAX_CHANNELS> sources;
+	const RouteGains gains;
+
+	/**
+	 * Apply #gains instead of copying according to #plan?
+	 */
+	const bool mix;
 
 	/**
 	 * The actual input format of our signal, once opened
@@ -90,7 +246,8 @@ class RouteFilter final : public Filter {
 
 public:
 	RouteFilter(const AudioFormat &audio_format, unsigned out_channels,
-		    const std::array<int8_t, MAX_CHANNELS> &_sources);
+		    const std::array<int8_t, MAX_CHANNELS> &_sources,
+		    const RouteGains &_gains, bool _mix);
 
 	/* virtual methods from class Filter */
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
@@ -119,12 +276,23 @@ class PreparedRouteFilter final : public PreparedFilter {
 	 */
 	std::array<int8_t, MAX_CHANNELS> sources;
 
+	/**
+	 * The gain of each route, see #RouteGains.
+	 */
+	RouteGains gains{};
+
+	/**
+	 * Was a gain specified for at least one route?
+	 */
+	bool mix = false;
+
 public:
 	/**
 	 * Parse the "routes" section, a string on the form
 	 *  a>b, c>d, e>f, ...
 	 * where a... are non-unique, non-negative integers
 	 * and input channel a gets copied to output channel b, etc.
+	 * Each route may be followed by "*GAIN".
 	 * @param block the configuration block to read
 	 * @param filter a route_filter whose min_channels and sources[] to set
 	 */
@@ -181,6 +349,19 @@ PreparedRouteFilter::PreparedRouteFilter(const ConfigBlock &block)
 
 		sources[dest] = source;
 
+		float gain = 1;
+		if (*endptr == '*') {
+			routes = StripLeft(endptr + 1);
+			gain = strtof(routes, &endptr);
+			if (endptr == routes)
+				throw std::runtime_error("Malformed 'routes' gain");
+
+			endptr = StripLeft(endptr);
+			mix = true;
+		}
+
+		gains[dest][source] = gain;
+
 		routes = endptr;
 
 		if (*routes == 0)
@@ -201,8 +382,12 @@ route_filter_init(const ConfigBlock &block)
 
 RouteFilter::RouteFilter(const AudioFormat &audio_format,
 			 unsigned out_channels,
-			 const std::array<int8_t, MAX_CHANNELS> &_sources)
-	:Filter(audio_format), sources(_sources), input_format(audio_format),
+			 const std::array<int8_t, MAX_CHANNELS> &_sources,
+			 const RouteGains &_gains, bool _mix)
+	:Filter(audio_format),
+	 plan(audio_format.channels, out_channels, _sources),
+	 gains(_gains), mix(_mix),
+	 input_format(audio_format),
 	 input_frame_size(input_format.GetFrameSize())
 {
 	// Decide on an output format which has enough channels,
@@ -216,58 +401,58 @@ RouteFilter::RouteFilter(const AudioFormat &audio_format,
 std::unique_ptr<Filter>
 PreparedRouteFilter::Open(AudioFormat &audio_format)
 {
+	if (mix)
+		/* the gain matrix is only implemented for floating
+		   point samples; the AutoConvert filter will take
+		   care for the conversion */
+		audio_format.format = SampleFormat::FLOAT;
+
 	return std::make_unique<RouteFilter>(audio_format, min_output_channels,
-					     sources);
+					     sources, gains, mix);
 }
 
 std::span<const std::byte>
 RouteFilter::FilterPCM(std::span<const std::byte> src)
 {
-	size_t number_of_frames = src.size() / input_frame_size;
-
-	const size_t bytes_per_frame_per_channel = input_format.GetSampleSize();
+	if (!mix && plan.identity)
+		/* nothing to do */
+		return src;
 
-	// A moving pointer that always refers to channel 0 in the input, at the currently handled frame
-	const auto *base_source = (const uint8_t *)src.data();
+	const size_t number_of_frames = src.size() / input_frame_size;
 
-	// Grow our reusable buffer, if needed, and set the moving pointer
+	// Grow our reusable buffer, if needed
 	const size_t result_size = number_of_frames * output_frame_size;
-	void *const result = output_buffer.Get(result_size);
-
-	// A moving pointer that always refers to the currently filled channel of the currently handled frame, in the output
-	auto *chan_destination = (std::byte *)result;
-
-	// Perform our copy operations, with N input channels and M output channels
-	for (unsigned int s=0; s<number_of_frames; ++s) {
-
-		// Need to perform one copy per output channel
-		for (unsigned c = 0; c < out_audio_format.channels; ++c) {
-			if (sources[c] == -1 ||
-			    (unsigned)sources[c] >= input_format.channels) {
-				// No source for this destination output,
-				// give it zeroes as input
-				PcmSilence({chan_destination, bytes_per_frame_per_channel},
-					   input_format.format);
-			} else {
-				// Get the data from channel sources[c]
-				// and copy it to the output
-				const uint8_t *data = base_source +
-					(sources[c] * bytes_per_frame_per_channel);
-				memcpy(chan_destination,
-					  data,
-					  bytes_per_frame_per_channel);
-			}
-			// Move on to the next output channel
-			chan_destination += bytes_per_frame_per_channel;
-		}
+	auto *const result = (std::byte *)output_buffer.Get(result_size);
+
+	if (mix) {
+		RouteMix((float *)result, (const float *)src.data(),
+			 number_of_frames,
+			 plan.in_channels, plan.out_channels, gains);
+	} else {
+		switch (input_format.GetSampleSize()) {
+		case 1:
+			Route<uint8_t>(result, src.data(), number_of_frames,
+				       plan, input_format.format);
+			break;
 
+		case 2:
+			Route<uint16_t>(result, src.data(), number_of_frames,
+					plan, input_format.format);
+			break;
+
+		case 4:
+			Route<uint32_t>(result, src.data(), number_of_frames,
+					plan, input_format.format);
+			break;
 
-		// Go on to the next N input samples
-		base_source += input_frame_size;
+		default:
+			assert(false);
+			gcc_unreachable();
+		}
 	}
 
 	// Here it is, ladies and gentlemen! Rerouted data!
-	return { (const std::byte *)result, result_size };
+	return { result, result_size };
 }
 
 const FilterPlugin route_filter_plugin = {
@@ -29,6 +29,24 @@ TwoFilters::FilterPCM(std::span<const std::byte> src)
 	return second->FilterPCM(first->FilterPCM(src));
 }
 
+std::span<const std::byte>
+TwoFilters::FilterWritable(std::span<std::byte> src)
+{
+	const auto result = first->FilterWritable(src);
+
+	if (result.data() >= src.data() &&
+	    result.data() + result.size() <= src.data() + src.size())
+		/* the first filter has worked in place (or passed
+		   the buffer through), so the second one may
+		   modify it as well */
+		return second->FilterWritable({
+				const_cast<std::byte *>(result.data()),
+				result.size(),
+			});
+
+	return second->FilterPCM(result);
+}
+
 std::span<const std::byte>
 TwoFilters::Flush()
 {
@@ -45,6 +45,17 @@ public:
 	}
 
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
+
+	bool IsInPlace() const noexcept override {
+		return first->IsInPlace() && second->IsInPlace();
+	}
+
+	void FilterInPlace(std::span<std::byte> data) override {
+		first->FilterInPlace(data);
+		second->FilterInPlace(data);
+	}
+
+	std::span<const std::byte> FilterWritable(std::span<std::byte> src) override;
 	std::span<const std::byte> Flush() override;
 };
 
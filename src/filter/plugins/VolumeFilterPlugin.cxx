@@ -27,10 +27,11 @@ class VolumeFilter final : public Filter {
 	PcmVolume pv;
 
 public:
-	explicit VolumeFilter(const AudioFormat &audio_format)
+	VolumeFilter(const AudioFormat &audio_format, bool ramp)
 		:Filter(audio_format) {
 		out_audio_format.format = pv.Open(out_audio_format.format,
 						  true);
+		pv.SetRamp(ramp);
 	}
 
 	[[nodiscard]] unsigned GetVolume() const noexcept {
@@ -43,10 +44,23 @@ public:
 
 	/* virtual methods from class Filter */
 	std::span<const std::byte> FilterPCM(std::span<const std::byte> src) override;
+
+	bool IsInPlace() const noexcept override {
+		return pv.CanApplyInPlace();
+	}
+
+	void FilterInPlace(std::span<std::byte> data) noexcept override {
+		pv.ApplyInPlace(data);
+	}
 };
 
 class PreparedVolumeFilter final : public PreparedFilter {
+	const bool ramp;
+
 public:
+	explicit PreparedVolumeFilter(bool _ramp) noexcept
+		:ramp(_ramp) {}
+
 	/* virtual methods from class Filter */
 	std::unique_ptr<Filter> Open(AudioFormat &af) override;
 };
@@ -54,7 +68,7 @@ public:
 std::unique_ptr<Filter>
 PreparedVolumeFilter::Open(AudioFormat &audio_format)
 {
-	return std::make_unique<VolumeFilter>(audio_format);
+	return std::make_unique<VolumeFilter>(audio_format, ramp);
 }
 
 std::span<const std::byte>
@@ -64,9 +78,9 @@ VolumeFilter::FilterPCM(std::span<const std::byte> src)
 }
 
 std::unique_ptr<PreparedFilter>
-volume_filter_prepare() noexcept
+volume_filter_prepare(bool ramp) noexcept
 {
-	return std::make_unique<PreparedVolumeFilter>();
+	return std::make_unique<PreparedVolumeFilter>(ramp);
 }
 
 unsigned
@@ -25,8 +25,12 @@
 class PreparedFilter;
 class Filter;
 
+/**
+ * @param ramp fade volume changes over one buffer instead of
+ * applying them at once (see PcmVolume::SetRamp())
+ */
 std::unique_ptr<PreparedFilter>
-volume_filter_prepare() noexcept;
+volume_filter_prepare(bool ramp) noexcept;
 
 unsigned
 volume_filter_get(const Filter *filter) noexcept;
@@ -48,6 +48,21 @@ AllocatedPath::FromUTF8Throw(std::string_view path_utf8)
 #endif
 }
 
+AllocatedPath
+AllocatedPath::BuildUTF8Throw(Path base, std::string_view child_utf8)
+{
+#ifdef FS_CHARSET_ALWAYS_UTF8
+	return Build(base, child_utf8);
+#else
+#ifndef _WIN32
+	if (IsFSCompatibleUTF8(child_utf8))
+		return Build(base, child_utf8);
+#endif
+
+	return Build(base, ::PathFromUTF8(child_utf8));
+#endif
+}
+
 void
 AllocatedPath::SetSuffix(const_pointer new_suffix) noexcept
 {
@@ -197,6 +197,17 @@ public:
 	 */
 	static AllocatedPath FromUTF8Throw(std::string_view path_utf8);
 
+	/**
+	 * Convert a relative UTF-8 path to the file system charset
+	 * and join it with the given base path.  Unlike
+	 * Build(base, FromUTF8Throw(child)), this allocates only once
+	 * unless a charset conversion is necessary.
+	 *
+	 * Throws on error.
+	 */
+	static AllocatedPath BuildUTF8Throw(Path base,
+					    std::string_view child_utf8);
+
 	/**
 	 * Copy an #AllocatedPath object.
 	 */
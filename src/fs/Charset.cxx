@@ -30,6 +30,14 @@
 #include <windows.h>
 #endif
 
+#ifdef HAVE_FS_CHARSET
+#include "thread/Mutex.hxx"
+#include "util/CharUtil.hxx"
+#include "util/StringAPI.hxx"
+
+#include <vector>
+#endif
+
 #include <algorithm>
 #include <cassert>
 
@@ -37,28 +45,126 @@
 
 static std::string fs_charset;
 
-static std::unique_ptr<IcuConverter> fs_converter;
+/**
+ * Does #fs_charset need to be converted at all?  This is false if
+ * it was configured as UTF-8.
+ */
+static bool fs_charset_convert = false;
+
+/**
+ * Is #fs_charset a superset of ASCII, i.e. can pure ASCII strings
+ * be passed without conversion?
+ */
+static bool fs_charset_ascii = false;
+
+/**
+ * Idle #IcuConverter instances for #fs_charset.  Each conversion
+ * takes one from here (or creates a new one), so threads converting
+ * at the same time do not serialize on the mutex inside a single
+ * #IcuConverter.
+ */
+static Mutex fs_converters_mutex;
+static std::vector<std::unique_ptr<IcuConverter>> fs_converters;
+
+class FSConverterLease {
+	std::unique_ptr<IcuConverter> converter;
+
+public:
+	FSConverterLease() {
+		{
+			const std::scoped_lock<Mutex> lock(fs_converters_mutex);
+			if (!fs_converters.empty()) {
+				converter = std::move(fs_converters.back());
+				fs_converters.pop_back();
+				return;
+			}
+		}
+
+		converter = IcuConverter::Create(fs_charset.c_str());
+	}
+
+	~FSConverterLease() noexcept {
+		const std::scoped_lock<Mutex> lock(fs_converters_mutex);
+		fs_converters.emplace_back(std::move(converter));
+	}
+
+	FSConverterLease(const FSConverterLease &) = delete;
+	FSConverterLease &operator=(const FSConverterLease &) = delete;
+
+	const IcuConverter *operator->() const noexcept {
+		return converter.get();
+	}
+};
+
+[[gnu::pure]]
+static bool
+IsASCII(std::string_view s) noexcept
+{
+	return std::all_of(s.begin(), s.end(),
+			   [](char ch){ return IsASCII(ch); });
+}
+
+/**
+ * Check whether all printable ASCII characters survive a round trip
+ * through the converter unmodified.
+ */
+static bool
+IsASCIICompatible(const IcuConverter &converter) noexcept
+try {
+	char buffer[0x7f - 0x20];
+	for (std::size_t i = 0; i < std::size(buffer); ++i)
+		buffer[i] = char(0x20 + i);
+
+	const std::string_view ascii{buffer, std::size(buffer)};
+	return std::string_view{converter.ToUTF8(ascii)} == ascii &&
+		std::string_view{converter.FromUTF8(ascii)} == ascii;
+} catch (...) {
+	return false;
+}
 
 void
 SetFSCharset(const char *charset)
 {
 	assert(charset != nullptr);
-	assert(fs_converter == nullptr);
+	assert(fs_converters.empty());
+
+	fs_charset = charset;
 
-	fs_converter = IcuConverter::Create(charset);
-	assert(fs_converter != nullptr);
+	if (StringIsEqualIgnoreCase(charset, "UTF-8") ||
+	    StringIsEqualIgnoreCase(charset, "UTF8")) {
+		fs_charset_convert = false;
+	} else {
+		auto converter = IcuConverter::Create(charset);
+		assert(converter != nullptr);
+
+		fs_charset_ascii = IsASCIICompatible(*converter);
+		fs_converters.emplace_back(std::move(converter));
+		fs_charset_convert = true;
+	}
 
 	FmtDebug(path_domain,
 		 "SetFSCharset: fs charset is {}", fs_charset);
 }
 
+/**
+ * Can this path be passed as-is, without converting it?
+ */
+[[gnu::pure]]
+static bool
+CanSkipConversion(std::string_view s) noexcept
+{
+	return !fs_charset_convert || (fs_charset_ascii && IsASCII(s));
+}
+
 #endif
 
 void
 DeinitFSCharset() noexcept
 {
-#ifdef HAVE_ICU_CONVERTER
-	fs_converter.reset();
+#ifdef HAVE_FS_CHARSET
+	const std::scoped_lock<Mutex> lock(fs_converters_mutex);
+	fs_converters.clear();
+	fs_charset_convert = false;
 #endif
 }
 
@@ -99,17 +205,31 @@ PathToUTF8(PathTraitsFS::string_view path_fs)
 	return FixSeparators(buffer);
 #else
 #ifdef HAVE_FS_CHARSET
-	if (fs_converter == nullptr)
+	if (CanSkipConversion(path_fs))
 #endif
 		return FixSeparators(path_fs);
 #ifdef HAVE_FS_CHARSET
 
-	const auto buffer = fs_converter->ToUTF8(path_fs);
+	const auto buffer = FSConverterLease()->ToUTF8(path_fs);
 	return FixSeparators(buffer);
 #endif
 #endif
 }
 
+#ifndef _WIN32
+
+bool
+IsFSCompatibleUTF8([[maybe_unused]] PathTraitsUTF8::string_view path_utf8) noexcept
+{
+#ifdef HAVE_FS_CHARSET
+	return CanSkipConversion(path_utf8);
+#else
+	return true;
+#endif
+}
+
+#endif
+
 #if defined(HAVE_FS_CHARSET) || defined(_WIN32)
 
 PathTraitsFS::string
@@ -119,10 +239,10 @@ PathFromUTF8(PathTraitsUTF8::string_view path_utf8)
 	const auto buffer = MultiByteToWideChar(CP_UTF8, path_utf8);
 	return PathTraitsFS::string(buffer);
 #else
-	if (fs_converter == nullptr)
+	if (CanSkipConversion(path_utf8))
 		return PathTraitsFS::string(path_utf8);
 
-	const auto buffer = fs_converter->FromUTF8(path_utf8);
+	const auto buffer = FSConverterLease()->FromUTF8(path_utf8);
 	return PathTraitsFS::string(buffer);
 #endif
 }
@@ -54,4 +54,16 @@ PathToUTF8(PathTraitsFS::string_view path_fs);
 PathTraitsFS::string
 PathFromUTF8(PathTraitsUTF8::string_view path_utf8);
 
+#ifndef _WIN32
+
+/**
+ * Can this UTF-8 path be used as a file system path without
+ * conversion, i.e. would PathFromUTF8() return it unmodified?
+ */
+[[gnu::pure]]
+bool
+IsFSCompatibleUTF8(PathTraitsUTF8::string_view path_utf8) noexcept;
+
+#endif
+
 #endif
@@ -146,6 +146,28 @@ public:
 		assert(HasEntry());
 		return Path::FromFS(ent->d_name);
 	}
+
+	/**
+	 * Returns the file type (DT_*) of the directory entry that
+	 * was previously read by #ReadEntry, or DT_UNKNOWN if the
+	 * file system does not provide it.
+	 */
+	unsigned char GetType() const noexcept {
+		assert(HasEntry());
+#ifdef _DIRENT_HAVE_D_TYPE
+		return ent->d_type;
+#else
+		return DT_UNKNOWN;
+#endif
+	}
+
+	/**
+	 * Returns the file descriptor of the directory, e.g. for
+	 * fstatat().
+	 */
+	int GetFileDescriptor() const noexcept {
+		return dirfd(dirp);
+	}
 };
 
 #endif
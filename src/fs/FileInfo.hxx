@@ -27,6 +27,7 @@
 #ifdef _WIN32
 #include "time/FileTime.hxx"
 #else
+#include <fcntl.h> // for AT_SYMLINK_NOFOLLOW
 #include <sys/stat.h>
 #endif
 
@@ -36,6 +37,10 @@
 class FileInfo {
 	friend bool GetFileInfo(Path path, FileInfo &info,
 				bool follow_symlinks);
+#ifndef _WIN32
+	friend bool GetFileInfoAt(int directory_fd, Path name, FileInfo &info,
+				  bool follow_symlinks);
+#endif
 	friend class FileReader;
 
 #ifdef _WIN32
@@ -124,4 +129,21 @@ GetFileInfo(Path path, FileInfo &info, bool follow_symlinks=true)
 #endif
 }
 
+#ifndef _WIN32
+
+/**
+ * Like GetFileInfo(), but the name is relative to the given
+ * directory file descriptor, which avoids resolving the whole path
+ * again for each entry of a directory.
+ */
+inline bool
+GetFileInfoAt(int directory_fd, Path name, FileInfo &info,
+	      bool follow_symlinks=true)
+{
+	return fstatat(directory_fd, name.c_str(), &info.st,
+		       follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+#endif
+
 #endif
@@ -21,23 +21,27 @@
 #include "io/FileReader.hxx"
 #include "io/BufferedReader.hxx"
 #include "lib/zlib/AutoGunzipReader.hxx"
+#include "lib/zstd/AutoZstdReader.hxx"
 #include "fs/Path.hxx"
 
 #include <cassert>
 
 TextFile::TextFile(Path path_fs)
-	:file_reader(std::make_unique<FileReader>(path_fs)),
-#ifdef ENABLE_ZLIB
-	 gunzip_reader(std::make_unique<AutoGunzipReader>(*file_reader)),
+	:file_reader(std::make_unique<FileReader>(path_fs))
+{
+	Reader *reader = file_reader.get();
+
+#ifdef ENABLE_ZSTD
+	zstd_reader = std::make_unique<AutoZstdReader>(*reader);
+	reader = zstd_reader.get();
 #endif
-	 buffered_reader(std::make_unique<BufferedReader>(*
+
 #ifdef ENABLE_ZLIB
-							  gunzip_reader
-#else
-							  file_reader
+	gunzip_reader = std::make_unique<AutoGunzipReader>(*reader);
+	reader = gunzip_reader.get();
 #endif
-							  ))
-{
+
+	buffered_reader = std::make_unique<BufferedReader>(*reader);
 }
 
 TextFile::~TextFile() noexcept = default;
@@ -27,17 +27,22 @@
 
 class Path;
 class FileReader;
+class AutoZstdReader;
 class AutoGunzipReader;
 class BufferedReader;
 
 class TextFile final : public LineReader {
 	const std::unique_ptr<FileReader> file_reader;
 
+#ifdef ENABLE_ZSTD
+	std::unique_ptr<AutoZstdReader> zstd_reader;
+#endif
+
 #ifdef ENABLE_ZLIB
-	const std::unique_ptr<AutoGunzipReader> gunzip_reader;
+	std::unique_ptr<AutoGunzipReader> gunzip_reader;
 #endif
 
-	const std::unique_ptr<BufferedReader> buffered_reader;
+	std::unique_ptr<BufferedReader> buffered_reader;
 
 public:
 	explicit TextFile(Path path_fs);
@@ -23,29 +23,108 @@
 #include "thread/Cond.hxx"
 #include "event/Loop.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 #include <string.h>
 
+/**
+ * An adaptive buffer never shrinks below this size.
+ */
+static constexpr size_t MIN_CAPACITY = 64 * 1024;
+
+/**
+ * The consumption rate is measured over periods of this duration.
+ */
+static constexpr std::chrono::steady_clock::duration MEASURE_PERIOD =
+	std::chrono::seconds(2);
+
+/**
+ * An adaptive buffer holds this much data, based on the consumption
+ * rate.  It is doubled if the throughput is less than twice the
+ * consumption rate, because then the buffer refills slowly after a
+ * network hiccup.
+ */
+static constexpr double BUFFER_SECONDS = 4;
+
+/**
+ * Parts of the allocation beyond the capacity are given back to the
+ * kernel in multiples of this size (a multiple of all common page
+ * sizes).
+ */
+static constexpr size_t DISCARD_ALIGNMENT = 64 * 1024;
+
+std::atomic_size_t AsyncInputStream::total_capacity{0};
+size_t AsyncInputStream::memory_limit = 0;
+
+/**
+ * Change the amount charged to
+ * AsyncInputStream::total_capacity from @a old to (up to) @a want,
+ * respecting the memory limit when growing.
+ *
+ * @return the new amount
+ */
+static size_t
+Charge(std::atomic_size_t &total, size_t limit,
+       size_t old, size_t want) noexcept
+{
+	size_t current = total.load(std::memory_order_relaxed);
+	size_t granted;
+
+	do {
+		granted = want;
+
+		if (limit > 0 && want > old) {
+			const size_t available = limit > current
+				? limit - current
+				: 0;
+			granted = std::max(std::min(want, old + available),
+					   std::min(want, MIN_CAPACITY));
+		}
+	} while (!total.compare_exchange_weak(current,
+					      current - old + granted,
+					      std::memory_order_relaxed));
+
+	return granted;
+}
+
 AsyncInputStream::AsyncInputStream(EventLoop &event_loop, const char *_url,
 				   Mutex &_mutex,
 				   size_t _buffer_size,
-				   size_t _resume_at) noexcept
+				   size_t _resume_at,
+				   bool _adaptive) noexcept
 	:InputStream(_url, _mutex),
 	 deferred_resume(event_loop, BIND_THIS_METHOD(DeferredResume)),
 	 deferred_seek(event_loop, BIND_THIS_METHOD(DeferredSeek)),
-	 allocation(_buffer_size),
-	 buffer(&allocation.front(), allocation.size()),
-	 resume_at(_resume_at)
+	 allocation(_adaptive ? _buffer_size * MAX_GROWTH : _buffer_size),
+	 buffer(&allocation.front(),
+		_adaptive ? _buffer_size : allocation.size()),
+	 initial_capacity(_buffer_size), initial_resume_at(_resume_at),
+	 resume_at(_resume_at),
+	 adaptive(_adaptive),
+	 measure_start(std::chrono::steady_clock::now())
 {
 	allocation.SetName("InputStream");
 	allocation.ForkCow(false);
+
+	if (adaptive) {
+		charged_capacity = Charge(total_capacity, memory_limit,
+					  0, _buffer_size);
+		if (charged_capacity < _buffer_size) {
+			/* the memory limit has been reached */
+			buffer.SetCapacity(charged_capacity);
+			resume_at = (uint_least64_t)charged_capacity
+				* initial_resume_at / initial_capacity;
+		}
+	}
 }
 
 AsyncInputStream::~AsyncInputStream() noexcept
 {
 	buffer.Clear();
+
+	total_capacity -= charged_capacity;
 }
 
 void
@@ -65,6 +144,9 @@ AsyncInputStream::Pause() noexcept
 {
 	assert(GetEventLoop().IsInside());
 
+	if (!paused)
+		paused_since = std::chrono::steady_clock::now();
+
 	paused = true;
 }
 
@@ -75,6 +157,7 @@ AsyncInputStream::Resume()
 
 	if (paused) {
 		paused = false;
+		paused_duration += std::chrono::steady_clock::now() - paused_since;
 
 		DoResume();
 	}
@@ -206,6 +289,7 @@ AsyncInputStream::Read(std::unique_lock<Mutex> &lock,
 	buffer.Consume(nbytes);
 
 	offset += (offset_type)nbytes;
+	consumed_bytes += nbytes;
 
 	if (paused && buffer.GetSize() < resume_at)
 		deferred_resume.Schedule();
@@ -218,6 +302,9 @@ AsyncInputStream::CommitWriteBuffer(size_t nbytes) noexcept
 {
 	buffer.Append(nbytes);
 
+	received_bytes += nbytes;
+	Adapt();
+
 	if (!IsReady())
 		SetReady();
 	else
@@ -249,12 +336,102 @@ AsyncInputStream::AppendToBuffer(std::span<const std::byte> src) noexcept
 		buffer.Append(second.size());
 	}
 
+	received_bytes += src.size() + second.size();
+	Adapt();
+
 	if (!IsReady())
 		SetReady();
 	else
 		InvokeOnAvailable();
 }
 
+void
+AsyncInputStream::Adapt() noexcept
+{
+	if (!adaptive)
+		return;
+
+	ApplyCapacity();
+
+	const auto now = std::chrono::steady_clock::now();
+	const auto elapsed = now - measure_start;
+	if (elapsed < MEASURE_PERIOD)
+		return;
+
+	const double seconds = std::chrono::duration<double>(elapsed).count();
+	const double rate = consumed_bytes / seconds;
+	consume_rate = consume_rate > 0
+		? (consume_rate + rate) / 2
+		: rate;
+
+	/* the throughput is measured only while the stream was not
+	   paused */
+	auto active = elapsed - paused_duration;
+	if (paused)
+		active -= now - paused_since;
+	const double active_seconds = std::chrono::duration<double>(active).count();
+	const double throughput = active_seconds > 0.1
+		? received_bytes / active_seconds
+		: 0;
+
+	measure_start = now;
+	consumed_bytes = received_bytes = 0;
+	paused_duration = {};
+	if (paused)
+		paused_since = now;
+
+	double buffer_seconds = BUFFER_SECONDS;
+	if (throughput > 0 && throughput < 2 * consume_rate)
+		buffer_seconds *= 2;
+
+	size_t target = std::clamp(size_t(consume_rate * buffer_seconds),
+				   std::min(MIN_CAPACITY, initial_capacity),
+				   allocation.size());
+
+	/* shrink slowly, because the consumer may have been idle
+	   for a while */
+	target = std::max(target, charged_capacity / 2);
+
+	if (target != charged_capacity)
+		RequestCapacity(target);
+}
+
+void
+AsyncInputStream::RequestCapacity(size_t new_capacity) noexcept
+{
+	charged_capacity = Charge(total_capacity, memory_limit,
+				  charged_capacity, new_capacity);
+	pending_capacity = charged_capacity;
+	ApplyCapacity();
+}
+
+void
+AsyncInputStream::ApplyCapacity() noexcept
+{
+	if (pending_capacity == 0)
+		return;
+
+	const size_t old_capacity = buffer.GetCapacity();
+	if (pending_capacity != old_capacity &&
+	    !buffer.SetCapacity(pending_capacity))
+		/* try again later */
+		return;
+
+	if (pending_capacity < old_capacity) {
+		/* give the memory beyond the new capacity back to
+		   the kernel */
+		const size_t start = (pending_capacity + DISCARD_ALIGNMENT - 1)
+			/ DISCARD_ALIGNMENT * DISCARD_ALIGNMENT;
+		if (start < old_capacity)
+			HugeDiscard(&allocation.front() + start,
+				    allocation.size() - start);
+	}
+
+	resume_at = (uint_least64_t)pending_capacity
+		* initial_resume_at / initial_capacity;
+	pending_capacity = 0;
+}
+
 void
 AsyncInputStream::DeferredResume() noexcept
 {
@@ -25,6 +25,8 @@
 #include "util/HugeAllocator.hxx"
 #include "util/CircularBuffer.hxx"
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <exception>
 
@@ -45,7 +47,74 @@ class AsyncInputStream : public InputStream {
 	HugeArray<std::byte> allocation;
 
 	CircularBuffer<std::byte> buffer;
-	const size_t resume_at;
+
+	/**
+	 * The initial buffer capacity and resume threshold passed to
+	 * the constructor; their ratio is applied to every new
+	 * capacity.
+	 */
+	const size_t initial_capacity, initial_resume_at;
+
+	/**
+	 * Resume the stream when the buffer contains less than this
+	 * number of bytes.
+	 */
+	size_t resume_at;
+
+	/**
+	 * If true, then the buffer capacity adapts to the measured
+	 * consumption rate, see Adapt().
+	 */
+	const bool adaptive;
+
+	/**
+	 * The capacity chosen by Adapt() which has not yet been
+	 * applied, because the buffer contents wrap around; 0 if
+	 * there is none.
+	 */
+	size_t pending_capacity = 0;
+
+	/**
+	 * The number of bytes accounted in #total_capacity for this
+	 * stream.
+	 */
+	size_t charged_capacity = 0;
+
+	/**
+	 * The number of bytes consumed by Read() and received from
+	 * the implementation since #measure_start.
+	 */
+	size_t consumed_bytes = 0, received_bytes = 0;
+
+	/**
+	 * The start of the current measurement period.
+	 */
+	std::chrono::steady_clock::time_point measure_start;
+
+	/**
+	 * The time since #paused has been set, and the total pause
+	 * duration within the current measurement period.
+	 */
+	std::chrono::steady_clock::time_point paused_since;
+	std::chrono::steady_clock::duration paused_duration{};
+
+	/**
+	 * The smoothed consumption rate in bytes per second; 0 if
+	 * it has not been measured yet.
+	 */
+	double consume_rate = 0;
+
+	/**
+	 * The sum of the buffer capacities of all adaptive streams.
+	 */
+	static std::atomic_size_t total_capacity;
+
+	/**
+	 * An adaptive buffer does not grow if that would make
+	 * #total_capacity exceed this value; 0 means no limit.  See
+	 * SetMemoryLimit().
+	 */
+	static size_t memory_limit;
 
 	bool open = true;
 
@@ -70,13 +139,31 @@ protected:
 	std::exception_ptr postponed_exception;
 
 public:
+	/**
+	 * @param _buffer_size the (initial) buffer capacity
+	 * @param _resume_at resume the stream when the buffer
+	 * contains less than this number of bytes
+	 * @param _adaptive if true, then the buffer capacity is
+	 * adjusted to the measured consumption rate; it may grow up
+	 * to #MAX_GROWTH times the initial capacity
+	 */
 	AsyncInputStream(EventLoop &event_loop, const char *_url,
 			 Mutex &_mutex,
 			 size_t _buffer_size,
-			 size_t _resume_at) noexcept;
+			 size_t _resume_at,
+			 bool _adaptive=true) noexcept;
 
 	~AsyncInputStream() noexcept override;
 
+	/**
+	 * Set the maximum total capacity of all adaptive buffers.
+	 * This is not a hard limit: each stream gets at least a
+	 * minimal buffer.
+	 */
+	static void SetMemoryLimit(size_t limit) noexcept {
+		memory_limit = limit;
+	}
+
 	auto &GetEventLoop() const noexcept {
 		return deferred_resume.GetEventLoop();
 	}
@@ -100,6 +187,12 @@ protected:
 
 	void Pause() noexcept;
 
+	/**
+	 * The maximum factor by which an adaptive buffer may grow
+	 * beyond the size passed to the constructor.
+	 */
+	static constexpr size_t MAX_GROWTH = 4;
+
 	bool IsPaused() const noexcept {
 		return paused;
 	}
@@ -167,6 +260,27 @@ protected:
 private:
 	void Resume();
 
+	/**
+	 * Measure the consumption rate and the throughput, and
+	 * choose a new buffer capacity.  Called by the I/O thread
+	 * after data has been added to the buffer.
+	 */
+	void Adapt() noexcept;
+
+	/**
+	 * Choose a new capacity, charging it to #total_capacity.  It
+	 * will be applied by ApplyCapacity().
+	 */
+	void RequestCapacity(size_t new_capacity) noexcept;
+
+	/**
+	 * Attempt to apply #pending_capacity.  This is only done
+	 * after data has been added to the buffer, because the
+	 * implementation may rely on the space it has obtained
+	 * earlier.
+	 */
+	void ApplyCapacity() noexcept;
+
 	/* for InjectEvent */
 	void DeferredResume() noexcept;
 	void DeferredSeek() noexcept;
@@ -171,6 +171,11 @@ BufferingInputStream::RunThreadLocked(std::unique_lock<Mutex> &lock)
 
 			client_cond.notify_all();
 			OnBufferAvailable();
+
+			if (const auto delay = GetThrottleDelay(nbytes);
+			    delay > std::chrono::steady_clock::duration::zero() &&
+			    want_offset == INVALID_OFFSET && !stop)
+				wake_cond.wait_for(lock, delay);
 		} else
 			wake_cond.wait(lock);
 	}
@@ -191,6 +196,9 @@ BufferingInputStream::RunThread() noexcept
 		OnBufferAvailable();
 	}
 
+	const bool complete = !error && FindFirstHole() == INVALID_OFFSET;
+	finished = true;
+
 	/* clear the "input" attribute while holding the mutex */
 	auto _input = std::move(input);
 
@@ -198,6 +206,11 @@ BufferingInputStream::RunThread() noexcept
 	   destructed */
 	lock.unlock();
 
+	if (complete)
+		/* the buffer will not be modified anymore, so it can
+		   be accessed without holding the mutex */
+		OnBufferComplete(std::as_bytes(buffer.Read(0).defined_buffer));
+
 	/* and now actually destruct the InputStream */
 	_input.reset();
 }
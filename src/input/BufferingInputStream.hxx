@@ -27,7 +27,10 @@
 #include "thread/Cond.hxx"
 #include "util/SparseBuffer.hxx"
 
+#include <chrono>
+#include <cstddef>
 #include <exception>
+#include <span>
 
 /**
  * A "huge" buffer which remembers the (partial) contents of an
@@ -65,6 +68,12 @@ private:
 
 	std::exception_ptr error, seek_error;
 
+	/**
+	 * Has the thread finished, i.e. the file has been read
+	 * completely or an error has occurred?
+	 */
+	bool finished = false;
+
 	static constexpr size_t INVALID_OFFSET = ~size_t(0);
 
 public:
@@ -106,6 +115,15 @@ public:
 	 */
 	bool IsAvailable(size_t offset) const noexcept;
 
+	/**
+	 * Has reading the file finished (successfully or not)?
+	 *
+	 * Caller must lock the mutex.
+	 */
+	bool IsFinished() const noexcept {
+		return finished;
+	}
+
 	/**
 	 * Copy data from the buffer into the given pointer.
 	 *
@@ -122,6 +140,23 @@ protected:
 	 */
 	virtual void OnBufferAvailable() noexcept {}
 
+	/**
+	 * This virtual method gets called after the whole file has
+	 * been read into the buffer.  It is called from the buffering
+	 * thread, without holding the mutex.
+	 */
+	virtual void OnBufferComplete([[maybe_unused]] std::span<const std::byte> data) noexcept {}
+
+	/**
+	 * This virtual method gets called after each read from the
+	 * input, with the mutex locked.  It may return a duration to
+	 * wait before reading more, to limit the bandwidth.  The
+	 * wait is cut short if a client needs data.
+	 */
+	virtual std::chrono::steady_clock::duration GetThrottleDelay([[maybe_unused]] std::size_t nbytes) noexcept {
+		return {};
+	}
+
 private:
 	size_t FindFirstHole() const noexcept;
 
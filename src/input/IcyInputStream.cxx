@@ -23,6 +23,7 @@
 #include "util/UriExtract.hxx"
 #include "util/UriQueryParser.hxx"
 
+#include <algorithm>
 #include <string>
 
 IcyInputStream::IcyInputStream(InputStreamPtr _input,
@@ -90,18 +91,42 @@ IcyInputStream::Read(std::unique_lock<Mutex> &lock,
 		return ProxyInputStream::Read(lock, ptr, read_size);
 
 	while (true) {
-		size_t nbytes = ProxyInputStream::Read(lock, ptr, read_size);
+		if (const size_t data_rest = parser->GetDataRest();
+		    data_rest > 0) {
+			/* fast path: read no more than the remaining
+			   audio data directly into the caller's
+			   buffer; there is no metadata in it, so
+			   nothing needs to be parsed or moved */
+			size_t nbytes = ProxyInputStream::Read(lock, ptr,
+							       std::min(read_size, data_rest));
+			if (nbytes == 0) {
+				assert(IsEOF());
+				offset = override_offset;
+				return 0;
+			}
+
+			[[maybe_unused]] const size_t data = parser->Data(nbytes);
+			assert(data == nbytes);
+
+			override_offset += nbytes;
+			offset = override_offset;
+			return nbytes;
+		}
+
+		/* read only the metadata block into a small buffer
+		   and pass it to the parser */
+		std::byte meta[1 + 255 * 16];
+		size_t nbytes = ProxyInputStream::Read(lock, meta,
+						       std::min(sizeof(meta),
+								parser->GetMetaRest()));
 		if (nbytes == 0) {
 			assert(IsEOF());
 			offset = override_offset;
 			return 0;
 		}
 
-		size_t result = parser->ParseInPlace(ptr, nbytes);
-		if (result > 0) {
-			override_offset += result;
-			offset = override_offset;
-			return result;
-		}
+		[[maybe_unused]] const size_t consumed =
+			parser->Meta(meta, nbytes);
+		assert(consumed == nbytes);
 	}
 }
@@ -20,9 +20,11 @@
 #include "Init.hxx"
 #include "Registry.hxx"
 #include "InputPlugin.hxx"
+#include "AsyncInputStream.hxx"
 #include "config/Data.hxx"
 #include "config/Option.hxx"
 #include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "Log.hxx"
 #include "PluginUnavailable.hxx"
 #include "lib/fmt/RuntimeError.hxx"
@@ -38,9 +40,20 @@
 
 static constexpr Domain input_domain("input");
 
+/**
+ * The default for "max_input_buffer_size".
+ */
+static constexpr size_t DEFAULT_MAX_INPUT_BUFFER_SIZE = 64 * 1024 * 1024;
+
 void
 input_stream_global_init(const ConfigData &config, EventLoop &event_loop)
 {
+	AsyncInputStream::SetMemoryLimit(config.With(ConfigOption::MAX_INPUT_BUFFER_SIZE, [](const char *s){
+		return s != nullptr
+			? ParseSize(s)
+			: DEFAULT_MAX_INPUT_BUFFER_SIZE;
+	}));
+
 #ifdef HAVE_URING
 	InitUringInputPlugin(event_loop);
 #endif
@@ -21,6 +21,7 @@
 #include "CondHandler.hxx"
 #include "thread/Name.hxx"
 
+#include <algorithm>
 #include <cassert>
 
 #include <string.h>
@@ -85,8 +86,30 @@ ThreadInputStream::ThreadFunc() noexcept
 	while (!close) {
 		assert(!postponed_exception);
 
+		if (seek_pending) {
+			try {
+				const ScopeUnlock unlock(mutex);
+				ThreadSeek(seek_offset);
+			} catch (...) {
+				postponed_exception = std::current_exception();
+			}
+
+			buffer.Clear();
+			eof = false;
+			seek_pending = false;
+			InvokeOnAvailable();
+
+			if (postponed_exception)
+				break;
+
+			continue;
+		}
+
 		auto w = buffer.Write();
-		if (w.empty()) {
+		if (w.empty() || eof) {
+			/* buffer is full, or the end of a seekable
+			   stream was reached: wait for the client to
+			   consume data or to seek */
 			wake_cond.wait(lock);
 		} else {
 			size_t nbytes;
@@ -100,11 +123,18 @@ ThreadInputStream::ThreadFunc() noexcept
 				break;
 			}
 
+			if (seek_pending)
+				/* the client has requested a seek while
+				   we were reading; discard the data */
+				continue;
+
 			InvokeOnAvailable();
 
 			if (nbytes == 0) {
 				eof = true;
-				break;
+				if (!IsSeekable())
+					break;
+				continue;
 			}
 
 			buffer.Append(nbytes);
@@ -161,10 +191,53 @@ ThreadInputStream::Read(std::unique_lock<Mutex> &lock,
 	}
 }
 
+void
+ThreadInputStream::Seek(std::unique_lock<Mutex> &lock, offset_type new_offset)
+{
+	assert(!thread.IsInside());
+
+	if (!IsSeekable())
+		return InputStream::Seek(lock, new_offset);
+
+	if (postponed_exception)
+		std::rethrow_exception(postponed_exception);
+
+	if (new_offset >= offset &&
+	    new_offset - offset <= buffer.GetSize()) {
+		/* skip forward within the buffer */
+		size_t skip = new_offset - offset;
+		while (skip > 0) {
+			const size_t nbytes = std::min(skip,
+						       buffer.Read().size());
+			buffer.Consume(nbytes);
+			skip -= nbytes;
+		}
+
+		offset = new_offset;
+		wake_cond.notify_all();
+		return;
+	}
+
+	seek_offset = new_offset;
+	seek_pending = true;
+	wake_cond.notify_all();
+
+	CondInputStreamHandler cond_handler;
+	const ScopeExchangeInputStreamHandler h(*this, &cond_handler);
+	cond_handler.cond.wait(lock, [this]{ return !seek_pending; });
+
+	if (postponed_exception)
+		std::rethrow_exception(postponed_exception);
+
+	offset = new_offset;
+}
+
 bool
 ThreadInputStream::IsEOF() const noexcept
 {
 	assert(!thread.IsInside());
 
-	return eof;
+	/* the thread may have seen the end of the stream while
+	   the client has not yet consumed the buffer */
+	return eof && buffer.empty();
 }
@@ -29,6 +29,7 @@
 #include <cassert>
 #include <cstdint>
 #include <exception>
+#include <stdexcept>
 
 /**
  * Helper class for moving InputStream implementations with blocking
@@ -37,7 +38,9 @@
  * another thread using the regular #InputStream API.  This class
  * manages the thread and the buffer.
  *
- * This works only for "streams": unknown length, no seeking, no tags.
+ * This works best for "streams": unknown length, no tags.  Seeking
+ * is supported if the implementation sets the "seekable" flag and
+ * implements ThreadSeek().
  *
  * The implementation must call Stop() before its destruction
  * completes.  This cannot be done in ~ThreadInputStream() because at
@@ -72,6 +75,14 @@ class ThreadInputStream : public InputStream {
 	 */
 	bool eof = false;
 
+	/**
+	 * Shall the thread call ThreadSeek()?  The target offset is
+	 * #seek_offset.
+	 */
+	bool seek_pending = false;
+
+	offset_type seek_offset;
+
 public:
 	ThreadInputStream(const char *_plugin,
 			  const char *_uri, Mutex &_mutex,
@@ -95,6 +106,8 @@ public:
 	bool IsAvailable() const noexcept final;
 	size_t Read(std::unique_lock<Mutex> &lock,
 		    void *ptr, size_t size) override final;
+	void Seek(std::unique_lock<Mutex> &lock,
+		  offset_type new_offset) override final;
 
 protected:
 	/**
@@ -135,6 +148,18 @@ protected:
 	 */
 	virtual size_t ThreadRead(void *ptr, size_t size) = 0;
 
+	/**
+	 * Seek to the given offset.  This is only called if the
+	 * "seekable" flag is set.
+	 *
+	 * The #InputStream is not locked.
+	 *
+	 * Throws std::runtime_error on error.
+	 */
+	virtual void ThreadSeek([[maybe_unused]] offset_type new_offset) {
+		throw std::runtime_error("Seeking is not implemented");
+	}
+
 	/**
 	 * Optional deinitialization before leaving the thread.
 	 *
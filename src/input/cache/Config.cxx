@@ -32,4 +32,22 @@ InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 		size = size_param->With([](const char *s){
 			return ParseSize(s);
 		});
+
+	prefetch = block.GetPositiveValue("prefetch", 1U);
+
+	disk_directory = block.GetPath("disk_directory");
+
+	disk_size = 4096 * uint64_t{MEGABYTE};
+	const auto *disk_size_param = block.GetBlockParam("disk_size");
+	if (disk_size_param != nullptr)
+		disk_size = disk_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	prefetch_rate = 0;
+	const auto *prefetch_rate_param = block.GetBlockParam("prefetch_rate");
+	if (prefetch_rate_param != nullptr)
+		prefetch_rate = prefetch_rate_param->With([](const char *s){
+			return ParseSize(s);
+		});
 }
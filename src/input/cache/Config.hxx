@@ -20,13 +20,37 @@
 #ifndef MPD_INPUT_CACHE_CONFIG_HXX
 #define MPD_INPUT_CACHE_CONFIG_HXX
 
+#include "fs/AllocatedPath.hxx"
+
 #include <cstddef>
+#include <cstdint>
 
 struct ConfigBlock;
 
 struct InputCacheConfig {
 	size_t size;
 
+	/**
+	 * The number of upcoming queue entries to be prefetched.
+	 */
+	unsigned prefetch;
+
+	/**
+	 * The directory of the disk cache tier; nullptr if disabled.
+	 */
+	AllocatedPath disk_directory = nullptr;
+
+	/**
+	 * The maximum total size of the disk cache.
+	 */
+	uint64_t disk_size;
+
+	/**
+	 * The maximum prefetch rate in bytes per second; 0 means
+	 * unlimited.
+	 */
+	size_t prefetch_rate;
+
 	explicit InputCacheConfig(const ConfigBlock &block);
 };
 
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Disk.hxx"
+#include "input/InputStream.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/FileReader.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Path.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#ifdef _WIN32
+#include "util/AllocatedArray.hxx"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <string.h>
+
+static constexpr Domain input_cache_domain("input_cache");
+
+static constexpr uint32_t DISK_CACHE_MAGIC = 0x4d504443;
+
+/**
+ * The header of each cache file.  It is followed by the URI (without
+ * null terminator) and then by the contents of the original file.
+ */
+struct DiskCacheHeader {
+	uint32_t magic;
+	uint32_t uri_length;
+
+	/**
+	 * The size of the original file.
+	 */
+	uint64_t size;
+
+	/**
+	 * The modification time of the original file in nanoseconds
+	 * since the epoch.
+	 */
+	int64_t mtime;
+};
+
+/**
+ * Determine size and modification time of the original file.
+ *
+ * @return false if the file is not accessible
+ */
+static bool
+GetSourceInfo(std::string_view uri, uint64_t &size, int64_t &mtime) noexcept
+{
+	const auto path = AllocatedPath::FromUTF8(uri);
+	FileInfo info;
+	if (path.IsNull() || !GetFileInfo(path, info) || !info.IsRegular())
+		return false;
+
+	size = info.GetSize();
+	mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(info.GetModificationTime().time_since_epoch()).count();
+	return true;
+}
+
+/**
+ * Calculate the 64 bit FNV-1a hash.  Unlike std::hash, this is
+ * guaranteed to be stable across builds, which is important because
+ * it is used for file names.
+ */
+static constexpr uint64_t
+FNV1aHash64(std::string_view s) noexcept
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const char ch : s) {
+		hash ^= static_cast<unsigned char>(ch);
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static std::string
+MakeFileName(std::string_view uri) noexcept
+{
+	return fmt::format("{:016x}.cache", FNV1aHash64(uri));
+}
+
+[[gnu::pure]]
+static bool
+IsCacheFileName(std::string_view name) noexcept
+{
+	return name.size() == 16 + 6 && name.ends_with(".cache");
+}
+
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedCacheFile {
+	std::span<const std::byte> data;
+
+#ifdef _WIN32
+	AllocatedArray<std::byte> buffer;
+#endif
+
+public:
+	explicit MappedCacheFile(Path path) {
+		FileReader reader(path);
+		const uint64_t size = reader.GetSize();
+		if (size < sizeof(DiskCacheHeader) ||
+		    size > std::numeric_limits<std::size_t>::max())
+			throw FmtRuntimeError("Malformed cache file {}", path);
+
+#ifdef _WIN32
+		buffer.ResizeDiscard(size);
+		std::size_t position = 0;
+		while (position < size) {
+			const std::size_t nbytes =
+				reader.Read(buffer.data() + position,
+					    size - position);
+			if (nbytes == 0)
+				throw std::runtime_error("Unexpected end of file");
+			position += nbytes;
+		}
+
+		data = {buffer.data(), buffer.size()};
+#else
+		void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED,
+			       reader.GetFD().Get(), 0);
+		if (p == MAP_FAILED)
+			throw FmtErrno("Failed to map {}", path);
+
+		/* decoders read the file sequentially */
+		madvise(p, size, MADV_SEQUENTIAL|MADV_WILLNEED);
+
+		data = {(const std::byte *)p, std::size_t(size)};
+#endif
+	}
+
+#ifndef _WIN32
+	~MappedCacheFile() noexcept {
+		munmap(const_cast<std::byte *>(data.data()), data.size());
+	}
+#endif
+
+	MappedCacheFile(const MappedCacheFile &) = delete;
+	MappedCacheFile &operator=(const MappedCacheFile &) = delete;
+
+	std::span<const std::byte> GetData() const noexcept {
+		return data;
+	}
+
+	/**
+	 * Check the header of the cache file and return the cached
+	 * contents, or an empty span if the file is not a valid copy
+	 * of the given file.
+	 */
+	[[gnu::pure]]
+	std::span<const std::byte> GetContents(std::string_view uri,
+					       uint64_t size,
+					       int64_t mtime) const noexcept {
+		DiskCacheHeader header;
+		memcpy(&header, data.data(), sizeof(header));
+
+		if (header.magic != DISK_CACHE_MAGIC ||
+		    header.uri_length != uri.size() ||
+		    header.size != size || header.mtime != mtime ||
+		    data.size() != sizeof(header) + uri.size() + size ||
+		    memcmp(data.data() + sizeof(header), uri.data(),
+			   uri.size()) != 0)
+			return {};
+
+		return data.subspan(sizeof(header) + uri.size());
+	}
+};
+
+/**
+ * An #InputStream which reads from a #MappedCacheFile.
+ */
+class MappedCacheInputStream final : public InputStream {
+	const std::unique_ptr<MappedCacheFile> file;
+
+	const std::span<const std::byte> contents;
+
+public:
+	MappedCacheInputStream(const char *_uri, Mutex &_mutex,
+			       std::unique_ptr<MappedCacheFile> &&_file,
+			       std::span<const std::byte> _contents) noexcept
+		:InputStream(_uri, _mutex),
+		 file(std::move(_file)), contents(_contents)
+	{
+		size = contents.size();
+		seekable = true;
+		SetReady();
+	}
+
+	/* virtual methods from InputStream */
+
+	[[nodiscard]] bool IsEOF() const noexcept override {
+		return GetOffset() >= GetSize();
+	}
+
+	size_t Read(std::unique_lock<Mutex> &,
+		    void *ptr, size_t read_size) override {
+		const std::size_t nbytes =
+			std::min<offset_type>(read_size, GetRest());
+		memcpy(ptr, contents.data() + offset, nbytes);
+		offset += nbytes;
+		return nbytes;
+	}
+
+	void Seek(std::unique_lock<Mutex> &, offset_type new_offset) override {
+		offset = new_offset;
+	}
+};
+
+InputCacheDisk::InputCacheDisk(AllocatedPath &&_directory, uint64_t _max_size)
+	:directory(std::move(_directory)), max_size(_max_size)
+{
+	CreateDirectoryNoThrow(directory);
+
+	Load();
+}
+
+InputCacheDisk::~InputCacheDisk() noexcept = default;
+
+inline void
+InputCacheDisk::Load()
+{
+	struct Found {
+		std::string name;
+		uint64_t size;
+		std::chrono::system_clock::time_point mtime;
+	};
+
+	std::vector<Found> found;
+
+	DirectoryReader reader(directory);
+	while (reader.ReadEntry()) {
+		const auto name = reader.GetEntry().ToUTF8();
+		if (!IsCacheFileName(name))
+			continue;
+
+		FileInfo info;
+		if (!GetFileInfo(directory / reader.GetEntry(), info, false) ||
+		    !info.IsRegular())
+			continue;
+
+		found.push_back({name, info.GetSize(),
+				 info.GetModificationTime()});
+	}
+
+	/* the modification time is updated on each hit; the oldest
+	   one is the least recently used file */
+	std::sort(found.begin(), found.end(), [](const auto &a, const auto &b){
+		return a.mtime < b.mtime;
+	});
+
+	for (auto &i : found)
+		Add(std::move(i.name), i.size);
+
+	Evict(0);
+
+	FmtDebug(input_cache_domain, "Loaded {} files ({} bytes) from {}",
+		 entries.size(), total_size, directory);
+}
+
+void
+InputCacheDisk::Add(std::string &&name, uint64_t size) noexcept
+{
+	auto &e = entries.emplace_back(std::move(name), size);
+	by_name.emplace(e.name, std::prev(entries.end()));
+	total_size += size;
+}
+
+void
+InputCacheDisk::Remove(std::string_view name) noexcept
+{
+	if (auto i = by_name.find(name); i != by_name.end()) {
+		total_size -= i->second->size;
+		entries.erase(i->second);
+		by_name.erase(i);
+	}
+
+	try {
+		RemoveFile(directory / AllocatedPath::FromUTF8(name));
+	} catch (...) {
+		LogError(std::current_exception());
+	}
+}
+
+void
+InputCacheDisk::MarkUsed(std::string_view name) noexcept
+{
+	if (auto i = by_name.find(name); i != by_name.end())
+		entries.splice(entries.end(), entries, i->second);
+
+#ifndef _WIN32
+	/* update the modification time, which is the LRU order
+	   after a restart */
+	const auto path = directory / AllocatedPath::FromUTF8(name);
+	utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+#endif
+}
+
+void
+InputCacheDisk::Evict(uint64_t reserve) noexcept
+{
+	while (!entries.empty() && total_size + reserve > max_size) {
+		/* copy the name because Remove() frees it */
+		const std::string name = entries.front().name;
+		Remove(name);
+	}
+}
+
+InputStreamPtr
+InputCacheDisk::Open(std::string_view uri, Mutex &stream_mutex) noexcept
+try {
+	uint64_t size;
+	int64_t mtime;
+	if (!GetSourceInfo(uri, size, mtime))
+		return nullptr;
+
+	const auto name = MakeFileName(uri);
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		if (!by_name.contains(name))
+			return nullptr;
+	}
+
+	auto file = std::make_unique<MappedCacheFile>(directory / AllocatedPath::FromUTF8(name));
+	const auto contents = file->GetContents(uri, size, mtime);
+
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	if (contents.empty()) {
+		/* the original file has been modified (or this is a
+		   hash collision) */
+		Remove(name);
+		return nullptr;
+	}
+
+	MarkUsed(name);
+
+	return std::make_unique<MappedCacheInputStream>(std::string{uri}.c_str(),
+							stream_mutex,
+							std::move(file),
+							contents);
+} catch (...) {
+	LogError(std::current_exception());
+	return nullptr;
+}
+
+void
+InputCacheDisk::Store(std::string_view uri,
+		      std::span<const std::byte> data) noexcept
+try {
+	if (!IsEligible(data.size()))
+		return;
+
+	uint64_t size;
+	int64_t mtime;
+	if (!GetSourceInfo(uri, size, mtime) || size != data.size())
+		/* the file has been modified meanwhile */
+		return;
+
+	auto name = MakeFileName(uri);
+	const uint64_t file_size = sizeof(DiskCacheHeader) + uri.size() + size;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		if (by_name.contains(name))
+			return;
+
+		Evict(file_size);
+	}
+
+	const DiskCacheHeader header{
+		DISK_CACHE_MAGIC, uint32_t(uri.size()),
+		size, mtime,
+	};
+
+	FileOutputStream file(directory / AllocatedPath::FromUTF8(name));
+	file.Write(&header, sizeof(header));
+	file.Write(uri.data(), uri.size());
+	file.Write(data.data(), data.size());
+	file.Commit();
+
+	const std::scoped_lock<Mutex> lock(mutex);
+	if (!by_name.contains(name))
+		Add(std::move(name), file_size);
+} catch (...) {
+	FmtError(input_cache_domain, "Failed to store '{}' in the cache: {}",
+		 uri, std::current_exception());
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_INPUT_CACHE_DISK_HXX
+#define MPD_INPUT_CACHE_DISK_HXX
+
+#include "input/Ptr.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+
+/**
+ * The second tier of the #InputCacheManager: a directory with copies
+ * of recently cached files, which survives restarts.  Hits are served
+ * from a memory mapping of the cache file.
+ *
+ * All methods are thread-safe.
+ */
+class InputCacheDisk {
+	const AllocatedPath directory;
+
+	const uint64_t max_size;
+
+	Mutex mutex;
+
+	struct Entry {
+		std::string name;
+		uint64_t size;
+	};
+
+	/**
+	 * All cache files, the least recently used first.
+	 */
+	std::list<Entry> entries;
+
+	/**
+	 * Maps the file name to its item in #entries.
+	 */
+	std::map<std::string, std::list<Entry>::iterator, std::less<>> by_name;
+
+	uint64_t total_size = 0;
+
+public:
+	/**
+	 * Throws if the directory cannot be created or read.
+	 */
+	InputCacheDisk(AllocatedPath &&_directory, uint64_t _max_size);
+	~InputCacheDisk() noexcept;
+
+	InputCacheDisk(const InputCacheDisk &) = delete;
+	InputCacheDisk &operator=(const InputCacheDisk &) = delete;
+
+	/**
+	 * Can a file of this size be stored?
+	 */
+	bool IsEligible(uint64_t size) const noexcept {
+		return size > 0 && size <= max_size / 2;
+	}
+
+	/**
+	 * Open a stream reading the cached copy of the given file.
+	 * Returns nullptr if there is no valid copy (e.g. because the
+	 * original file has been modified since).
+	 */
+	InputStreamPtr Open(std::string_view uri, Mutex &stream_mutex) noexcept;
+
+	/**
+	 * Store a copy of the given file, evicting the least recently
+	 * used files if the cache grows too large.  Errors are
+	 * logged.
+	 *
+	 * @param data the complete contents of the file
+	 */
+	void Store(std::string_view uri,
+		   std::span<const std::byte> data) noexcept;
+
+private:
+	void Load();
+
+	void Add(std::string &&name, uint64_t size) noexcept;
+	void Remove(std::string_view name) noexcept;
+	void MarkUsed(std::string_view name) noexcept;
+
+	/**
+	 * Delete the least recently used files until there is room
+	 * for this many more bytes.
+	 */
+	void Evict(uint64_t reserve) noexcept;
+};
+
+#endif
@@ -19,13 +19,18 @@
 
 #include "Item.hxx"
 #include "Lease.hxx"
+#include "Disk.hxx"
+#include "RateLimit.hxx"
 #include "input/InputStream.hxx"
 
 #include <cassert>
 
-InputCacheItem::InputCacheItem(InputStreamPtr _input) noexcept
+InputCacheItem::InputCacheItem(InputStreamPtr _input,
+			       InputCacheDisk *_disk,
+			       InputCacheRateLimit *_rate_limit) noexcept
 	:BufferingInputStream(std::move(_input)),
-	 uri(GetInput().GetURI())
+	 uri(GetInput().GetURI()),
+	 disk(_disk), rate_limit(_rate_limit)
 {
 }
 
@@ -61,3 +66,20 @@ InputCacheItem::OnBufferAvailable() noexcept
 		i->OnInputCacheAvailable();
 	}
 }
+
+void
+InputCacheItem::OnBufferComplete(std::span<const std::byte> data) noexcept
+{
+	if (disk != nullptr)
+		disk->Store(uri, data);
+}
+
+std::chrono::steady_clock::duration
+InputCacheItem::GetThrottleDelay(std::size_t nbytes) noexcept
+{
+	if (rate_limit == nullptr || !leases.empty())
+		/* somebody is waiting for this file: full speed */
+		return {};
+
+	return rate_limit->Consume(nbytes);
+}
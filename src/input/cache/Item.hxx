@@ -28,6 +28,8 @@
 #include <string>
 
 class InputCacheLease;
+class InputCacheDisk;
+class InputCacheRateLimit;
 
 /**
  * An item in the #InputCacheManager.  It caches the contents of a
@@ -43,13 +45,33 @@ class InputCacheItem final
 {
 	const std::string uri;
 
+	/**
+	 * If not nullptr, then the file is stored in this disk cache
+	 * after it has been read completely.
+	 */
+	InputCacheDisk *const disk;
+
+	/**
+	 * If not nullptr, then reading is throttled to this rate
+	 * while nobody holds a lease, i.e. while the file is being
+	 * prefetched.
+	 */
+	InputCacheRateLimit *const rate_limit;
+
 	using LeaseList = IntrusiveList<InputCacheLease>;
 
 	LeaseList leases;
 	LeaseList::iterator next_lease = leases.end();
 
 public:
-	explicit InputCacheItem(InputStreamPtr _input) noexcept;
+	/**
+	 * @param _disk store the file in this disk cache after it has
+	 * been read completely (nullptr to disable)
+	 * @param _rate_limit throttle prefetching (nullptr to
+	 * disable)
+	 */
+	InputCacheItem(InputStreamPtr _input, InputCacheDisk *_disk,
+		       InputCacheRateLimit *_rate_limit) noexcept;
 	~InputCacheItem() noexcept;
 
 	const std::string &GetUri() const noexcept {
@@ -69,6 +91,8 @@ public:
 private:
 	/* virtual methods from class BufferingInputStream */
 	void OnBufferAvailable() noexcept override;
+	void OnBufferComplete(std::span<const std::byte> data) noexcept override;
+	std::chrono::steady_clock::duration GetThrottleDelay(std::size_t nbytes) noexcept override;
 };
 
 #endif
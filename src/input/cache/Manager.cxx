@@ -20,13 +20,23 @@
 #include "Manager.hxx"
 #include "Config.hxx"
 #include "Item.hxx"
+#include "Disk.hxx"
 #include "Lease.hxx"
+#include "RateLimit.hxx"
 #include "input/InputStream.hxx"
 #include "fs/Traits.hxx"
+#include "thread/Name.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
 #include "util/DeleteDisposer.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
 
 #include <string.h>
 
+static constexpr Domain cache_domain("cache");
+
 inline std::size_t
 InputCacheManager::ItemHash::operator()(std::string_view uri) const noexcept
 {
@@ -60,19 +70,39 @@ InputCacheManager::ItemEqual::operator()(const InputCacheItem &a,
 	return a.GetUri() == b.GetUri();
 }
 
-InputCacheManager::InputCacheManager(const InputCacheConfig &config) noexcept
-	:max_total_size(config.size)
+InputCacheManager::InputCacheManager(const InputCacheConfig &config)
+	:max_total_size(config.size),
+	 prefetch_count(config.prefetch),
+	 prefetch_thread(BIND_THIS_METHOD(PrefetchRun))
 {
+	if (!config.disk_directory.IsNull())
+		disk = std::make_unique<InputCacheDisk>(AllocatedPath{config.disk_directory},
+							config.disk_size);
+
+	if (config.prefetch_rate > 0)
+		rate_limit = std::make_unique<InputCacheRateLimit>(config.prefetch_rate);
+
+	prefetch_thread.Start();
 }
 
 InputCacheManager::~InputCacheManager() noexcept
 {
+	{
+		const std::scoped_lock<Mutex> lock(prefetch_mutex);
+		prefetch_quit = true;
+		prefetch_cond.notify_one();
+	}
+
+	prefetch_thread.Join();
+
 	items_by_time.clear_and_dispose(DeleteDisposer());
 }
 
 void
 InputCacheManager::Flush() noexcept
 {
+	const std::scoped_lock<Mutex> lock(items_mutex);
+
 	items_by_time.remove_and_dispose_if([](const InputCacheItem &item){
 		return !item.IsInUse();
 	}, [this](InputCacheItem *item){
@@ -96,6 +126,13 @@ InputCacheManager::IsEligible(const InputStream &input) const noexcept
 		input.GetSize() <= max_total_size / 2;
 }
 
+std::size_t
+InputCacheManager::GetTotalSize() noexcept
+{
+	const std::scoped_lock<Mutex> lock(items_mutex);
+	return total_size;
+}
+
 bool
 InputCacheManager::Contains(const char *uri) noexcept
 {
@@ -109,34 +146,73 @@ InputCacheManager::Get(const char *uri, bool create)
 	if (!PathTraitsUTF8::IsAbsolute(uri))
 		return {};
 
-	if (auto iter = items_by_uri.find(uri); iter != items_by_uri.end()) {
-		auto &item = *iter;
+	{
+		const std::scoped_lock<Mutex> lock(items_mutex);
+
+		if (auto iter = items_by_uri.find(uri); iter != items_by_uri.end()) {
+			auto &item = *iter;
+
+			/* refresh */
+			items_by_time.erase(items_by_time.iterator_to(item));
+			items_by_time.push_back(item);
 
-		/* refresh */
-		items_by_time.erase(items_by_time.iterator_to(item));
-		items_by_time.push_back(item);
+			// TODO revalidate the cache item using the file's mtime?
+			// TODO if cache item contains error, retry now?
 
-		// TODO revalidate the cache item using the file's mtime?
-		// TODO if cache item contains error, retry now?
+			if (create)
+				n_hits.fetch_add(1, std::memory_order_relaxed);
 
-		return InputCacheLease(item);
+			return InputCacheLease(item);
+		}
 	}
 
 	if (!create)
 		return {};
 
-	// TODO: wait for "ready" without blocking here
-	auto is = InputStream::OpenReady(uri, mutex);
+	n_misses.fetch_add(1, std::memory_order_relaxed);
+
+	/* open the file without holding items_mutex, because this
+	   may block for a while */
+
+	InputStreamPtr is;
+	InputCacheDisk *store_disk = nullptr;
+
+	if (disk)
+		is = disk->Open(uri, mutex);
+
+	if (!is) {
+		// TODO: wait for "ready" without blocking here
+		is = InputStream::OpenReady(uri, mutex);
+
+		if (disk && disk->IsEligible(is->GetSize()))
+			store_disk = disk.get();
+	}
 
 	if (!IsEligible(*is))
 		return {};
 
+	const std::scoped_lock<Mutex> lock(items_mutex);
+
+	if (auto iter = items_by_uri.find(uri); iter != items_by_uri.end())
+		/* another thread has been faster */
+		return InputCacheLease(*iter);
+
 	const size_t size = is->GetSize();
 	total_size += size;
 
 	while (total_size > max_total_size && EvictOldestUnused()) {}
 
-	auto *item = new InputCacheItem(std::move(is));
+	InputCacheItem *item;
+
+	{
+		/* hold the mutex while constructing the item, so its
+		   buffering thread does not invoke virtual methods
+		   before the object is complete */
+		const std::scoped_lock<Mutex> item_lock(mutex);
+		item = new InputCacheItem(std::move(is), store_disk,
+					  rate_limit.get());
+	}
+
 	items_by_uri.insert(*item);
 	items_by_time.push_back(*item);
 
@@ -149,6 +225,137 @@ InputCacheManager::Prefetch(const char *uri)
 	Get(uri, true);
 }
 
+void
+InputCacheManager::SetPrefetch(std::vector<std::string> &&uris) noexcept
+{
+	const std::scoped_lock<Mutex> lock(prefetch_mutex);
+	if (uris == prefetch_uris)
+		return;
+
+	prefetch_uris = std::move(uris);
+	++prefetch_generation;
+	prefetch_cond.notify_one();
+}
+
+bool
+InputCacheManager::IsLoaded(const char *uri) noexcept
+{
+	const std::scoped_lock<Mutex> lock(items_mutex);
+
+	auto iter = items_by_uri.find(uri);
+	if (iter == items_by_uri.end())
+		/* evicted or cancelled */
+		return true;
+
+	const std::scoped_lock<Mutex> item_lock(mutex);
+	return iter->IsFinished();
+}
+
+void
+InputCacheManager::CancelUnwanted(const std::vector<std::string> &wanted) noexcept
+{
+	const std::scoped_lock<Mutex> lock(items_mutex);
+
+	items_by_time.remove_and_dispose_if([this, &wanted](const InputCacheItem &item){
+		if (item.IsInUse())
+			return false;
+
+		{
+			const std::scoped_lock<Mutex> item_lock(mutex);
+			if (item.IsFinished())
+				return false;
+		}
+
+		return std::find(wanted.begin(), wanted.end(),
+				 item.GetUri()) == wanted.end();
+	}, [this](InputCacheItem *item){
+		FmtDebug(cache_domain, "Cancel prefetch '{}'",
+			 item->GetUri());
+
+		assert(total_size >= item->size());
+		total_size -= item->size();
+		items_by_uri.erase(items_by_uri.iterator_to(*item));
+		delete item;
+	});
+}
+
+inline void
+InputCacheManager::PrefetchOne(std::unique_lock<Mutex> &lock,
+			       const std::string &uri) noexcept
+{
+	const unsigned generation = prefetch_generation;
+
+	lock.unlock();
+
+	if (Contains(uri.c_str())) {
+		lock.lock();
+		return;
+	}
+
+	FmtDebug(cache_domain, "Prefetch '{}'", uri);
+
+	try {
+		Prefetch(uri.c_str());
+	} catch (...) {
+		FmtError(cache_domain,
+			 "Prefetch '{}' failed: {}",
+			 uri, std::current_exception());
+		lock.lock();
+		return;
+	}
+
+	lock.lock();
+
+	/* load only one file at a time; poll the item's state
+	   periodically, because the buffering thread does not
+	   notify us */
+	while (!prefetch_quit && generation == prefetch_generation) {
+		lock.unlock();
+		const bool loaded = IsLoaded(uri.c_str());
+		lock.lock();
+
+		if (loaded)
+			break;
+
+		prefetch_cond.wait_for(lock, std::chrono::milliseconds(500));
+	}
+}
+
+void
+InputCacheManager::PrefetchRun() noexcept
+{
+	SetThreadName("prefetch");
+
+	std::unique_lock<Mutex> lock(prefetch_mutex);
+
+	unsigned generation = 0;
+	std::vector<std::string> uris;
+	std::size_t next = 0;
+
+	while (!prefetch_quit) {
+		if (generation != prefetch_generation) {
+			/* the list has changed: start over, and stop
+			   loading files which are not wanted
+			   anymore */
+			generation = prefetch_generation;
+			uris = prefetch_uris;
+			next = 0;
+
+			lock.unlock();
+			CancelUnwanted(uris);
+			lock.lock();
+			continue;
+		}
+
+		if (next >= uris.size()) {
+			prefetch_cond.wait(lock);
+			continue;
+		}
+
+		PrefetchOne(lock, uris[next++]);
+	}
+}
+
 void
 InputCacheManager::Remove(InputCacheItem &item) noexcept
 {
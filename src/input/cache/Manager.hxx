@@ -21,25 +21,62 @@
 #define MPD_INPUT_CACHE_MANAGER_HXX
 
 #include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
 #include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 class InputStream;
 class InputCacheItem;
 class InputCacheLease;
+class InputCacheDisk;
+class InputCacheRateLimit;
 struct InputCacheConfig;
 
 /**
  * A class which caches files in RAM.  It is supposed to prefetch
  * files before they are played.
+ *
+ * Optionally, files are also stored in an #InputCacheDisk, which
+ * survives restarts and is consulted before reading the original
+ * file.
  */
 class InputCacheManager {
 	const size_t max_total_size;
 
+	const unsigned prefetch_count;
+
+	/**
+	 * This mutex is shared with all #InputCacheItem instances
+	 * (i.e. their #InputStream objects).
+	 */
 	mutable Mutex mutex;
 
+	/**
+	 * Protects #items_by_time, #items_by_uri and #total_size.
+	 * Lock this before #mutex, never the other way round.
+	 */
+	Mutex items_mutex;
+
 	size_t total_size = 0;
 
+	/**
+	 * The optional disk tier.  Declared before the item lists,
+	 * because the items refer to it.
+	 */
+	std::unique_ptr<InputCacheDisk> disk;
+
+	/**
+	 * Throttles prefetching; nullptr if unlimited.
+	 */
+	std::unique_ptr<InputCacheRateLimit> rate_limit;
+
 	struct ItemHash {
 		[[gnu::pure]]
 		std::size_t operator()(std::string_view uri) const noexcept;
@@ -69,12 +106,67 @@ class InputCacheManager {
 
 	UriMap items_by_uri;
 
+	/**
+	 * Loads the files listed in #prefetch_uris into the cache,
+	 * one at a time.
+	 */
+	Thread prefetch_thread;
+
+	/**
+	 * Protects #prefetch_uris, #prefetch_generation and
+	 * #prefetch_quit.
+	 */
+	Mutex prefetch_mutex;
+	Cond prefetch_cond;
+
+	/**
+	 * The URIs which shall be prefetched, most urgent first.
+	 */
+	std::vector<std::string> prefetch_uris;
+
+	/**
+	 * Incremented each time #prefetch_uris is replaced, to
+	 * cancel the current prefetch operation.
+	 */
+	unsigned prefetch_generation = 0;
+
+	bool prefetch_quit = false;
+
+	/**
+	 * Counters for Get() calls with create=true.
+	 */
+	std::atomic<uint_least64_t> n_hits{0}, n_misses{0};
+
 public:
-	explicit InputCacheManager(const InputCacheConfig &config) noexcept;
+	/**
+	 * Throws if the disk cache directory cannot be used.
+	 */
+	explicit InputCacheManager(const InputCacheConfig &config);
 	~InputCacheManager() noexcept;
 
 	void Flush() noexcept;
 
+	/**
+	 * Returns the number of upcoming queue entries which shall
+	 * be prefetched.
+	 */
+	unsigned GetPrefetchCount() const noexcept {
+		return prefetch_count;
+	}
+
+	uint_least64_t GetHits() const noexcept {
+		return n_hits.load(std::memory_order_relaxed);
+	}
+
+	uint_least64_t GetMisses() const noexcept {
+		return n_misses.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns the total size of all items in bytes.
+	 */
+	std::size_t GetTotalSize() noexcept;
+
 	[[gnu::pure]]
 	bool Contains(const char *uri) noexcept;
 
@@ -94,7 +186,38 @@ public:
 	 */
 	void Prefetch(const char *uri);
 
+	/**
+	 * Replace the list of files to be prefetched in the
+	 * background, most urgent first.  Incomplete cache items
+	 * which are not in use and are no longer listed are
+	 * cancelled.  This method does not block.
+	 */
+	void SetPrefetch(std::vector<std::string> &&uris) noexcept;
+
 private:
+	void PrefetchRun() noexcept;
+
+	/**
+	 * Prefetch one file (if it is not already cached) and wait
+	 * until it has been read completely, or until
+	 * #prefetch_generation changes.
+	 */
+	void PrefetchOne(std::unique_lock<Mutex> &lock,
+			 const std::string &uri) noexcept;
+
+	/**
+	 * Has the given item finished loading (or is it not in the
+	 * cache)?
+	 */
+	[[gnu::pure]]
+	bool IsLoaded(const char *uri) noexcept;
+
+	/**
+	 * Delete all unused incomplete items whose URI is not in the
+	 * given list.
+	 */
+	void CancelUnwanted(const std::vector<std::string> &wanted) noexcept;
+
 	/**
 	 * Check whether the given #InputStream can be stored in this
 	 * cache.
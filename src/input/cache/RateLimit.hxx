@@ -0,0 +1,69 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_INPUT_CACHE_RATE_LIMIT_HXX
+#define MPD_INPUT_CACHE_RATE_LIMIT_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * Limits the bandwidth used by all prefetch operations of the
+ * #InputCacheManager.  This class is thread-safe.
+ */
+class InputCacheRateLimit {
+	/**
+	 * The maximum rate in bytes per second.
+	 */
+	const std::size_t rate;
+
+	Mutex mutex;
+
+	/**
+	 * The time when the budget consumed so far has been earned.
+	 */
+	std::chrono::steady_clock::time_point next{};
+
+public:
+	explicit InputCacheRateLimit(std::size_t _rate) noexcept
+		:rate(_rate) {}
+
+	/**
+	 * Account for data which has just been read.
+	 *
+	 * @return the duration the caller shall wait before reading
+	 * more
+	 */
+	std::chrono::steady_clock::duration Consume(std::size_t nbytes) noexcept {
+		const auto now = std::chrono::steady_clock::now();
+
+		const std::scoped_lock<Mutex> lock(mutex);
+
+		if (next < now)
+			/* no credit for idle time */
+			next = now;
+
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(double(nbytes) / rate));
+		return next - now;
+	}
+};
+
+#endif
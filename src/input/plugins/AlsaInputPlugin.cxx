@@ -189,7 +189,9 @@ AlsaInputStream::AlsaInputStream(EventLoop &_loop,
 		const SourceSpec &spec)
 	:AsyncInputStream(_loop, spec.GetURI(), _mutex,
 		 spec.GetAudioFormat().TimeToSize(DEFAULT_BUFFER_TIME),
-		 spec.GetAudioFormat().TimeToSize(DEFAULT_RESUME_TIME)),
+		 spec.GetAudioFormat().TimeToSize(DEFAULT_RESUME_TIME),
+		 /* the buffer size is chosen by time, not adaptive */
+		 false),
 	 MultiSocketMonitor(_loop),
 	 device(spec.GetDeviceName()),
 	 frame_size(spec.GetAudioFormat().GetFrameSize()),
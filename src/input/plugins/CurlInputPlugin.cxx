@@ -30,9 +30,11 @@
 #include "tag/IcyMetaDataParser.hxx"
 #include "../InputPlugin.hxx"
 #include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "tag/Builder.hxx"
 #include "tag/Tag.hxx"
 #include "event/Call.hxx"
+#include "event/DeferEvent.hxx"
 #include "event/Loop.hxx"
 #include "util/ASCII.hxx"
 #include "util/StringFormat.hxx"
@@ -49,32 +51,73 @@
 #include "util/UriQueryParser.hxx"
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
+#include <list>
+#include <stdexcept>
+#include <vector>
 
 #include <string.h>
 
 #include <curl/curl.h>
 
 /**
- * Do not buffer more than this number of bytes.  It should be a
- * reasonable limit that doesn't make low-end machines suffer too
- * much, but doesn't cause stuttering on high-latency lines.
+ * Do not buffer more than this number of bytes by default.  It
+ * should be a reasonable limit that doesn't make low-end machines
+ * suffer too much, but doesn't cause stuttering on high-latency
+ * lines.
  */
-static const size_t CURL_MAX_BUFFERED = 512 * 1024;
+static constexpr size_t CURL_MAX_BUFFERED = 512 * 1024;
 
 /**
- * Resume the stream at this number of bytes after it has been paused.
+ * The default size of each range fetched by a parallel request.
  */
-static const size_t CURL_RESUME_AT = 384 * 1024;
+static constexpr size_t CURL_RANGE_SIZE = 1024 * 1024;
 
 class CurlInputStream final : public AsyncInputStream, CurlResponseHandler {
+	class Range;
+
+	static constexpr offset_type UNLIMITED = ~offset_type{};
+
 	/* some buffers which were passed to libcurl, which we have
 	   too free */
 	CurlSlist request_headers;
 
 	CurlRequest *request = nullptr;
 
+	/**
+	 * Requests for the byte ranges following the one of
+	 * #request, fetched in parallel (see "parallel_requests").
+	 * Their data is moved to the buffer in order, after #request
+	 * has delivered its range.  Only accessed in the I/O thread.
+	 */
+	std::list<Range> ranges;
+
+	/**
+	 * Moves data from #ranges to the buffer and starts new
+	 * range requests.  This cannot be done from inside libcurl
+	 * callbacks.
+	 */
+	DeferEvent defer_ranges;
+
+	/**
+	 * The number of bytes #request may still deliver before it
+	 * is stopped, because #ranges take over from there;
+	 * #UNLIMITED if parallel fetching is not active.
+	 */
+	offset_type request_remaining = UNLIMITED;
+
+	/**
+	 * The start offset of the next range to be requested.
+	 */
+	offset_type next_range;
+
+	/**
+	 * Has #request delivered its whole range?
+	 */
+	bool request_done = false;
+
 	/** parser for icy-metadata */
 	std::shared_ptr<IcyMetaDataParser> icy;
 
@@ -129,6 +172,23 @@ private:
 	 */
 	void SeekInternal(offset_type new_offset);
 
+	/**
+	 * Called after the response headers have been received:
+	 * enable parallel fetching if the resource is eligible.
+	 */
+	void MaybeStartParallel() noexcept;
+
+	/**
+	 * Submit requests for more ranges, up to the configured
+	 * number of parallel requests.
+	 *
+	 * Throws on error.
+	 */
+	void StartRanges();
+
+	/* DeferEvent callback */
+	void OnDeferredRanges() noexcept;
+
 	/* virtual methods from CurlResponseHandler */
 	void OnHeaders(unsigned status, Curl::Headers &&headers) override;
 	void OnData(std::span<const std::byte> data) override;
@@ -151,6 +211,18 @@ static const char *cacert;
 
 static bool verify_peer, verify_host;
 
+/** the size of the buffer of each stream */
+static size_t buffer_size = CURL_MAX_BUFFERED;
+
+/**
+ * The number of requests for one (seekable) resource which may be
+ * running at the same time; 1 disables parallel range fetching.
+ */
+static unsigned parallel_requests = 1;
+
+/** the size of each range fetched by a parallel request */
+static size_t range_size = CURL_RANGE_SIZE;
+
 /** Connection settings */
 static long connect_timeout;
 
@@ -200,20 +272,286 @@ static CurlInit *curl_init;
 
 static constexpr Domain curl_domain("curl");
 
+/**
+ * Apply the configured options to a new request.
+ */
+static void
+SetupRequest(CurlRequest &request, CurlSlist &request_headers)
+{
+	request.SetOption(CURLOPT_HTTP200ALIASES, http_200_aliases);
+	request.SetOption(CURLOPT_FOLLOWLOCATION, 1L);
+	request.SetOption(CURLOPT_MAXREDIRS, 5L);
+	request.SetOption(CURLOPT_FAILONERROR, 1L);
+
+	/* this option eliminates the probe request when
+	   username/password are specified */
+	request.SetOption(CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+
+	if (proxy != nullptr)
+		request.SetOption(CURLOPT_PROXY, proxy);
+
+	if (proxy_port > 0)
+		request.SetOption(CURLOPT_PROXYPORT, (long)proxy_port);
+
+	if (proxy_user != nullptr && proxy_password != nullptr)
+		request.SetOption(CURLOPT_PROXYUSERPWD,
+				  StringFormat<1024>("%s:%s", proxy_user,
+						     proxy_password).c_str());
+
+	if (cacert != nullptr)
+		request.SetOption(CURLOPT_CAINFO, cacert);
+	request.SetVerifyPeer(verify_peer);
+	request.SetVerifyHost(verify_host);
+	request.SetOption(CURLOPT_HTTPHEADER, request_headers.Get());
+
+	try {
+		request.SetProxyVerifyPeer(verify_peer);
+		request.SetProxyVerifyHost(verify_host);
+	} catch (...) {
+		/* these methods fail if libCURL was compiled with
+		   CURL_DISABLE_PROXY; ignore silently */
+	}
+
+	request.SetConnectTimeout(connect_timeout);
+
+	request.SetOption(CURLOPT_VERBOSE, verbose ? 1 : 0);
+
+	request.SetOption(CURLOPT_LOW_SPEED_LIMIT, low_speed_limit);
+	request.SetOption(CURLOPT_LOW_SPEED_TIME, low_speed_time);
+
+	request.SetOption(CURLOPT_TCP_KEEPALIVE, tcp_keepalive ? 1 : 0);
+	request.SetOption(CURLOPT_TCP_KEEPIDLE, tcp_keepidle);
+	request.SetOption(CURLOPT_TCP_KEEPINTVL, tcp_keepintvl);
+}
+
+/**
+ * Thrown by CurlInputStream::OnData() to stop the main request after
+ * it has delivered its range.
+ */
+struct CurlStopRequest {};
+
+/**
+ * A request for one byte range of a #CurlInputStream, running in
+ * parallel to other requests for the same resource.  The whole range
+ * is kept in memory until the stream's buffer can take it.
+ */
+class CurlInputStream::Range final : CurlResponseHandler {
+	CurlInputStream &parent;
+
+	CurlRequest request;
+
+	/**
+	 * The number of bytes in this range.
+	 */
+	const std::size_t expected;
+
+public:
+	/**
+	 * The data received so far.
+	 */
+	std::vector<std::byte> data;
+
+	/**
+	 * The number of bytes of #data which have already been moved
+	 * to the stream's buffer.
+	 */
+	std::size_t consumed = 0;
+
+	std::exception_ptr error;
+
+	/**
+	 * Has this request finished (successfully or not)?
+	 */
+	bool done = false;
+
+	Range(CurlInputStream &_parent, offset_type start, offset_type end)
+		:parent(_parent),
+		 request(**curl_init, parent.GetURI(), *this),
+		 expected(end - start)
+	{
+		SetupRequest(request, parent.request_headers);
+
+		request.SetOption(CURLOPT_RANGE,
+				  StringFormat<64>("%" PRIoffset "-%" PRIoffset,
+						   start, end - 1).c_str());
+
+		/* prefer multiplexing on an existing HTTP/2
+		   connection over opening a new one */
+		request.SetOption(CURLOPT_PIPEWAIT, 1L);
+
+		data.reserve(expected);
+	}
+
+	Range(const Range &) = delete;
+	Range &operator=(const Range &) = delete;
+
+	void Start() {
+		request.Start();
+	}
+
+	bool IsConsumed() const noexcept {
+		return consumed == data.size();
+	}
+
+private:
+	/* virtual methods from CurlResponseHandler */
+	void OnHeaders(unsigned status, Curl::Headers &&) override {
+		if (status < 200 || status >= 300)
+			throw HttpStatusError(status,
+					      StringFormat<40>("got HTTP status %u",
+							       status).c_str());
+
+		if (status != 206)
+			throw std::runtime_error("Server does not support range requests");
+	}
+
+	void OnData(std::span<const std::byte> src) override {
+		if (src.size() > expected - data.size())
+			throw std::runtime_error("Range response is too large");
+
+		data.insert(data.end(), src.begin(), src.end());
+		parent.defer_ranges.Schedule();
+	}
+
+	void OnEnd() override {
+		if (data.size() < expected)
+			throw std::runtime_error("Range response is truncated");
+
+		done = true;
+		parent.defer_ranges.Schedule();
+	}
+
+	void OnError(std::exception_ptr e) noexcept override {
+		error = std::move(e);
+		done = true;
+		parent.defer_ranges.Schedule();
+	}
+};
+
 void
 CurlInputStream::DoResume()
 {
 	assert(GetEventLoop().IsInside());
 
+	if (request_done) {
+		/* the rest comes from the parallel ranges */
+		defer_ranges.Schedule();
+		return;
+	}
+
 	const ScopeUnlock unlock(mutex);
 	request->Resume();
 }
 
+inline void
+CurlInputStream::MaybeStartParallel() noexcept
+{
+	if (parallel_requests < 2 || !seekable || !KnownSize() ||
+	    (icy && icy->IsDefined()) ||
+	    size - offset <= (offset_type)range_size)
+		return;
+
+	/* this request fetches the first range, and the following
+	   ones are requested in parallel */
+	request_remaining = range_size;
+	next_range = offset + range_size;
+	defer_ranges.Schedule();
+}
+
+void
+CurlInputStream::StartRanges()
+{
+	while (ranges.size() + 1 < parallel_requests && next_range < size) {
+		const offset_type end = std::min<offset_type>(next_range + range_size,
+							      size);
+		auto &range = ranges.emplace_back(*this, next_range, end);
+
+		try {
+			range.Start();
+		} catch (...) {
+			ranges.pop_back();
+			throw;
+		}
+
+		next_range = end;
+	}
+}
+
+void
+CurlInputStream::OnDeferredRanges() noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (IsSeekPending())
+		return;
+
+	try {
+		StartRanges();
+	} catch (...) {
+		postponed_exception = std::current_exception();
+		InvokeOnAvailable();
+		return;
+	}
+
+	if (!request_done)
+		return;
+
+	while (!ranges.empty()) {
+		auto &range = ranges.front();
+
+		if (!range.IsConsumed()) {
+			const size_t space = GetBufferSpace();
+			if (space == 0) {
+				/* DoResume() will reschedule */
+				AsyncInputStream::Pause();
+				return;
+			}
+
+			const auto src = std::span{range.data}.subspan(range.consumed);
+			const size_t nbytes = std::min(space, src.size());
+			AppendToBuffer(src.first(nbytes));
+			range.consumed += nbytes;
+			continue;
+		}
+
+		if (!range.done)
+			/* wait for more data */
+			return;
+
+		if (range.error) {
+			postponed_exception = std::move(range.error);
+			ranges.clear();
+			InvokeOnAvailable();
+			AsyncInputStream::SetClosed();
+			return;
+		}
+
+		ranges.pop_front();
+
+		try {
+			StartRanges();
+		} catch (...) {
+			postponed_exception = std::current_exception();
+			InvokeOnAvailable();
+			return;
+		}
+	}
+
+	/* all ranges have been delivered */
+	InvokeOnAvailable();
+	AsyncInputStream::SetClosed();
+}
+
 void
 CurlInputStream::FreeEasy() noexcept
 {
 	assert(GetEventLoop().IsInside());
 
+	ranges.clear();
+	defer_ranges.Cancel();
+	request_remaining = UNLIMITED;
+	request_done = false;
+
 	if (request == nullptr)
 		return;
 
@@ -285,6 +623,7 @@ CurlInputStream::OnHeaders(unsigned status,
 	if (IsSeekPending()) {
 		/* don't update metadata while seeking */
 		SeekDone();
+		MaybeStartParallel();
 		return;
 	}
 
@@ -336,6 +675,8 @@ CurlInputStream::OnHeaders(unsigned status,
 	}
 
 	SetReady();
+
+	MaybeStartParallel();
 }
 
 void
@@ -348,18 +689,37 @@ CurlInputStream::OnData(std::span<const std::byte> data)
 	if (IsSeekPending())
 		SeekDone();
 
+	if (data.size() > request_remaining)
+		data = data.first(request_remaining);
+
 	if (data.size() > GetBufferSpace()) {
 		AsyncInputStream::Pause();
 		throw CurlResponseHandler::Pause{};
 	}
 
 	AppendToBuffer(data);
+
+	if (request_remaining != UNLIMITED) {
+		request_remaining -= data.size();
+		if (request_remaining == 0) {
+			/* the rest is being fetched by the parallel
+			   range requests */
+			request_done = true;
+			defer_ranges.Schedule();
+			throw CurlStopRequest{};
+		}
+	}
 }
 
 void
 CurlInputStream::OnEnd()
 {
 	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (request_remaining != UNLIMITED)
+		/* shorter than announced by "Content-Length" */
+		postponed_exception = std::make_exception_ptr(std::runtime_error("Premature end of response"));
+
 	InvokeOnAvailable();
 
 	AsyncInputStream::SetClosed();
@@ -369,6 +729,12 @@ void
 CurlInputStream::OnError(std::exception_ptr e) noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (request_done)
+		/* stopped by OnData() after its range was complete,
+		   see CurlStopRequest */
+		return;
+
 	postponed_exception = std::move(e);
 
 	if (IsSeekPending())
@@ -436,6 +802,24 @@ input_curl_init(EventLoop &event_loop, const ConfigBlock &block)
 	tcp_keepidle  = block.GetBlockValue("tcp_keepidle",default_tcp_keepidle);
 
 	tcp_keepintvl = block.GetBlockValue("tcp_keepintvl",default_tcp_keepintvl);
+
+	if (const auto *param = block.GetBlockParam("buffer_size"))
+		buffer_size = param->With([](const char *s){
+			const size_t value = ParseSize(s);
+			if (value < 64 * 1024)
+				throw std::invalid_argument("buffer_size is too small");
+			return value;
+		});
+
+	parallel_requests = block.GetPositiveValue("parallel_requests", 1U);
+
+	if (const auto *param = block.GetBlockParam("range_size"))
+		range_size = param->With([](const char *s){
+			const size_t value = ParseSize(s);
+			if (value < 64 * 1024)
+				throw std::invalid_argument("range_size is too small");
+			return value;
+		});
 }
 
 static void
@@ -454,8 +838,10 @@ CurlInputStream::CurlInputStream(EventLoop &event_loop, const char *_url,
 				 I &&_icy,
 				 Mutex &_mutex)
 	:AsyncInputStream(event_loop, _url, _mutex,
-			  CURL_MAX_BUFFERED,
-			  CURL_RESUME_AT),
+			  buffer_size,
+			  /* resume when the buffer is 3/4 empty */
+			  buffer_size / 4 * 3),
+	 defer_ranges(event_loop, BIND_THIS_METHOD(OnDeferredRanges)),
 	 icy(std::forward<I>(_icy))
 {
 	request_headers.Append("Icy-Metadata: 1");
@@ -473,51 +859,7 @@ void
 CurlInputStream::InitEasy()
 {
 	request = new CurlRequest(**curl_init, GetURI(), *this);
-
-	request->SetOption(CURLOPT_HTTP200ALIASES, http_200_aliases);
-	request->SetOption(CURLOPT_FOLLOWLOCATION, 1L);
-	request->SetOption(CURLOPT_MAXREDIRS, 5L);
-	request->SetOption(CURLOPT_FAILONERROR, 1L);
-
-	/* this option eliminates the probe request when
-	   username/password are specified */
-	request->SetOption(CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-
-	if (proxy != nullptr)
-		request->SetOption(CURLOPT_PROXY, proxy);
-
-	if (proxy_port > 0)
-		request->SetOption(CURLOPT_PROXYPORT, (long)proxy_port);
-
-	if (proxy_user != nullptr && proxy_password != nullptr)
-		request->SetOption(CURLOPT_PROXYUSERPWD,
-				   StringFormat<1024>("%s:%s", proxy_user,
-						      proxy_password).c_str());
-
-	if (cacert != nullptr)
-		request->SetOption(CURLOPT_CAINFO, cacert);
-	request->SetVerifyPeer(verify_peer);
-	request->SetVerifyHost(verify_host);
-	request->SetOption(CURLOPT_HTTPHEADER, request_headers.Get());
-
-	try {
-		request->SetProxyVerifyPeer(verify_peer);
-		request->SetProxyVerifyHost(verify_host);
-	} catch (...) {
-		/* these methods fail if libCURL was compiled with
-		   CURL_DISABLE_PROXY; ignore silently */
-	}
-
-	request->SetConnectTimeout(connect_timeout);
-
-	request->SetOption(CURLOPT_VERBOSE, verbose ? 1 : 0);
-
-	request->SetOption(CURLOPT_LOW_SPEED_LIMIT, low_speed_limit);
-	request->SetOption(CURLOPT_LOW_SPEED_TIME, low_speed_time);
-
-	request->SetOption(CURLOPT_TCP_KEEPALIVE, tcp_keepalive ? 1 : 0);
-	request->SetOption(CURLOPT_TCP_KEEPIDLE, tcp_keepidle);
-	request->SetOption(CURLOPT_TCP_KEEPINTVL, tcp_keepintvl);
+	SetupRequest(*request, request_headers);
 }
 
 void
@@ -22,20 +22,43 @@
 #include "../InputPlugin.hxx"
 #include "lib/nfs/Glue.hxx"
 #include "lib/nfs/FileReader.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
+
+#include <algorithm>
+#include <stdexcept>
 
 /**
  * Do not buffer more than this number of bytes.  It should be a
  * reasonable limit that doesn't make low-end machines suffer too
- * much, but doesn't cause stuttering on high-latency lines.
+ * much, but doesn't cause stuttering on high-latency lines.  The
+ * buffer is enlarged if the read-ahead window doesn't fit twice.
  */
 static const size_t NFS_MAX_BUFFERED = 512 * 1024;
 
 /**
- * Resume the stream at this number of bytes after it has been paused.
+ * The maximum number of READ calls in flight per file.
  */
-static const size_t NFS_RESUME_AT = 384 * 1024;
+static unsigned nfs_read_ahead = 4;
+
+/**
+ * The size of each READ call.
+ */
+static size_t nfs_read_size = 32768;
+
+static size_t
+GetNfsBufferSize() noexcept
+{
+	return std::max(NFS_MAX_BUFFERED,
+			2 * nfs_read_ahead * nfs_read_size);
+}
 
 class NfsInputStream final : NfsFileReader, public AsyncInputStream {
+	/**
+	 * The offset of the next byte to be delivered by
+	 * OnNfsFileRead().  Pending READ calls cover the range
+	 * after this offset.
+	 */
 	uint64_t next_offset;
 
 	bool reconnect_on_resume = false, reconnecting = false;
@@ -44,8 +67,13 @@ public:
 	NfsInputStream(const char *_uri, Mutex &_mutex)
 		:AsyncInputStream(NfsFileReader::GetEventLoop(),
 				  _uri, _mutex,
-				  NFS_MAX_BUFFERED,
-				  NFS_RESUME_AT) {}
+				  GetNfsBufferSize(),
+				  GetNfsBufferSize() / 4 * 3,
+				  /* the read-ahead window is sized
+				     for the buffer space; it must not
+				     shrink while READ calls are
+				     pending */
+				  false) {}
 
 	~NfsInputStream() override {
 		DeferClose();
@@ -78,27 +106,35 @@ private:
 void
 NfsInputStream::DoRead()
 {
-	assert(NfsFileReader::IsIdle());
-
-	int64_t remaining = size - next_offset;
-	if (remaining <= 0)
-		return;
-
-	const size_t buffer_space = GetBufferSpace();
-	if (buffer_space == 0) {
-		Pause();
-		return;
-	}
-
-	size_t nbytes = std::min<size_t>(std::min<uint64_t>(remaining, 32768),
-					 buffer_space);
-
-	try {
-		const ScopeUnlock unlock(mutex);
-		NfsFileReader::Read(next_offset, nbytes);
-	} catch (...) {
-		postponed_exception = std::current_exception();
-		InvokeOnAvailable();
+	while (NfsFileReader::GetPendingReads() < nfs_read_ahead) {
+		const size_t pending = NfsFileReader::GetPendingBytes();
+		const uint64_t read_offset = next_offset + pending;
+
+		int64_t remaining = size - read_offset;
+		if (remaining <= 0)
+			return;
+
+		/* don't request more than the buffer can hold after
+		   all pending READ calls have been delivered */
+		const size_t buffer_space = GetBufferSpace();
+		if (buffer_space <= pending) {
+			if (pending == 0)
+				Pause();
+			return;
+		}
+
+		size_t nbytes = std::min<size_t>(std::min<uint64_t>(remaining,
+								    nfs_read_size),
+						 buffer_space - pending);
+
+		try {
+			const ScopeUnlock unlock(mutex);
+			NfsFileReader::Read(read_offset, nbytes);
+		} catch (...) {
+			postponed_exception = std::current_exception();
+			InvokeOnAvailable();
+			return;
+		}
 	}
 }
 
@@ -120,8 +156,6 @@ NfsInputStream::DoResume()
 		return;
 	}
 
-	assert(NfsFileReader::IsIdle());
-
 	DoRead();
 }
 
@@ -204,8 +238,20 @@ NfsInputStream::OnNfsFileError(std::exception_ptr &&e) noexcept
  */
 
 static void
-input_nfs_init(EventLoop &event_loop, const ConfigBlock &)
+input_nfs_init(EventLoop &event_loop, const ConfigBlock &block)
 {
+	nfs_read_ahead = block.GetPositiveValue("read_ahead", 4U);
+
+	if (const auto *param = block.GetBlockParam("read_size"))
+		nfs_read_size = param->With([](const char *s){
+			const size_t value = ParseSize(s);
+			if (value < 4096)
+				throw std::invalid_argument("read_size is too small");
+			if (value > 1024 * 1024)
+				throw std::invalid_argument("read_size is too large");
+			return value;
+		});
+
 	nfs_init(event_loop);
 }
 
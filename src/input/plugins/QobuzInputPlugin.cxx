@@ -20,7 +20,7 @@
 #include "QobuzInputPlugin.hxx"
 #include "QobuzClient.hxx"
 #include "QobuzTrackRequest.hxx"
-#include "QobuzTagScanner.hxx"
+#include "QobuzTrackCache.hxx"
 #include "CurlInputPlugin.hxx"
 #include "PluginUnavailable.hxx"
 #include "input/ProxyInputStream.hxx"
@@ -31,17 +31,17 @@
 #include "thread/Mutex.hxx"
 #include "util/StringCompare.hxx"
 
+#include <chrono>
 #include <memory>
 
 static QobuzClient *qobuz_client;
+static QobuzTrackCache *qobuz_cache;
 
 class QobuzInputStream final
 	: public ProxyInputStream, QobuzSessionHandler, QobuzTrackHandler {
 
 	const std::string track_id;
 
-	std::unique_ptr<QobuzTrackRequest> track_request;
-
 	std::exception_ptr error;
 
 public:
@@ -55,6 +55,7 @@ public:
 
 	~QobuzInputStream() override {
 		qobuz_client->RemoveLoginHandler(*this);
+		qobuz_cache->CancelUrl(*this);
 	}
 
 	QobuzInputStream(const QobuzInputStream &) = delete;
@@ -90,11 +91,7 @@ QobuzInputStream::OnQobuzSession() noexcept
 		const auto session = qobuz_client->GetSession();
 
 		QobuzTrackHandler &h = *this;
-		track_request = std::make_unique<QobuzTrackRequest>(*qobuz_client,
-								    session,
-								    track_id.c_str(),
-								    h);
-		track_request->Start();
+		qobuz_cache->LookupUrl(session, track_id, h);
 	} catch (...) {
 		Failed(std::current_exception());
 	}
@@ -104,7 +101,6 @@ void
 QobuzInputStream::OnQobuzTrackSuccess(std::string url) noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
-	track_request.reset();
 
 	try {
 		SetInput(OpenCurlInputStream(url.c_str(), {},
@@ -118,11 +114,33 @@ void
 QobuzInputStream::OnQobuzTrackError(std::exception_ptr e) noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
-	track_request.reset();
 
 	Failed(e);
 }
 
+/**
+ * A #RemoteTagScanner which obtains the tags from the
+ * #QobuzTrackCache.
+ */
+class QobuzCachedTagScanner final : public RemoteTagScanner {
+	const std::string track_id;
+
+	RemoteTagHandler &handler;
+
+public:
+	QobuzCachedTagScanner(const char *_track_id,
+			      RemoteTagHandler &_handler) noexcept
+		:track_id(_track_id), handler(_handler) {}
+
+	~QobuzCachedTagScanner() noexcept override {
+		qobuz_cache->CancelTag(handler);
+	}
+
+	void Start() noexcept override {
+		qobuz_cache->LookupTag(track_id, handler);
+	}
+};
+
 static void
 InitQobuzInput(EventLoop &event_loop, const ConfigBlock &block)
 {
@@ -153,16 +171,23 @@ InitQobuzInput(EventLoop &event_loop, const ConfigBlock &block)
 
 	const char *format_id = block.GetBlockValue("format_id", "5");
 
+	const std::chrono::seconds url_cache_time{block.GetBlockValue("url_cache_time", 300U)};
+	const std::chrono::seconds tag_cache_time{block.GetBlockValue("tag_cache_time", 3600U)};
+
 	qobuz_client = new QobuzClient(event_loop, base_url,
 				       app_id, app_secret,
 				       device_manufacturer_id,
 				       username, email, password,
 				       format_id);
+
+	qobuz_cache = new QobuzTrackCache(event_loop, *qobuz_client,
+					  url_cache_time, tag_cache_time);
 }
 
 static void
 FinishQobuzInput() noexcept
 {
+	delete qobuz_cache;
 	delete qobuz_client;
 }
 
@@ -204,8 +229,7 @@ ScanQobuzTags(const char *uri, RemoteTagHandler &handler)
 	if (track_id == nullptr)
 		return nullptr;
 
-	return std::make_unique<QobuzTagScanner>(*qobuz_client, track_id,
-						 handler);
+	return std::make_unique<QobuzCachedTagScanner>(track_id, handler);
 }
 
 static constexpr const char *qobuz_prefixes[] = {
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "QobuzTrackCache.hxx"
+#include "event/Loop.hxx"
+#include "util/BindMethod.hxx"
+
+#include <algorithm>
+
+QobuzTrackCache::QobuzTrackCache(EventLoop &event_loop, QobuzClient &_client,
+				 Clock::duration _url_ttl,
+				 Clock::duration _tag_ttl) noexcept
+	:client(_client), url_ttl(_url_ttl), tag_ttl(_tag_ttl),
+	 inject_invoke(event_loop, BIND_THIS_METHOD(InvokeResults))
+{
+}
+
+QobuzTrackCache::~QobuzTrackCache() noexcept = default;
+
+template<typename M>
+inline void
+QobuzTrackCache::Evict(M &map) noexcept
+{
+	if (map.size() < MAX_ITEMS)
+		return;
+
+	const auto now = Clock::now();
+	std::erase_if(map, [now](const auto &i){
+		return !i.second.IsBusy() && i.second.waiters.empty() &&
+			i.second.expires <= now;
+	});
+
+	if (map.size() < MAX_ITEMS)
+		return;
+
+	/* still full: remove all idle items */
+	std::erase_if(map, [](const auto &i){
+		return !i.second.IsBusy() && i.second.waiters.empty();
+	});
+}
+
+void
+QobuzTrackCache::WaitNotInvoking(std::unique_lock<Mutex> &lock,
+				 const void *handler) noexcept
+{
+	if (GetEventLoop().IsInside())
+		/* InvokeResults() runs in this thread, i.e. it is
+		   either not running or it is our caller */
+		return;
+
+	cond.wait(lock, [this, handler]{ return invoking != handler; });
+}
+
+void
+QobuzTrackCache::LookupUrl(const QobuzSession &session,
+			   std::string_view track_id,
+			   QobuzTrackHandler &handler)
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	auto i = urls.find(track_id);
+	if (i == urls.end()) {
+		Evict(urls);
+		i = urls.try_emplace(std::string{track_id},
+				     *this, track_id).first;
+	}
+
+	auto &item = i->second;
+
+	if (!item.IsBusy() && !item.url.empty() &&
+	    Clock::now() < item.expires) {
+		/* cache hit */
+		url_results.push_back({&handler, item.url, {}});
+		inject_invoke.Schedule();
+		return;
+	}
+
+	if (!item.IsBusy()) {
+		QobuzTrackHandler &h = item;
+		item.request = std::make_unique<QobuzTrackRequest>(client,
+								   session,
+								   item.track_id.c_str(),
+								   h);
+		item.request->Start();
+	}
+
+	/* if another lookup for this track is already running, wait
+	   for its result */
+	item.waiters.push_back(&handler);
+}
+
+void
+QobuzTrackCache::CancelUrl(QobuzTrackHandler &handler) noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	/* pending requests are not canceled; their result will be
+	   cached */
+	for (auto &[track_id, item] : urls)
+		std::erase(item.waiters, &handler);
+
+	url_results.remove_if([&handler](const UrlResult &r){
+		return r.handler == &handler;
+	});
+
+	WaitNotInvoking(lock, &handler);
+}
+
+void
+QobuzTrackCache::UrlItem::OnQobuzTrackSuccess(std::string _url) noexcept
+{
+	const std::scoped_lock<Mutex> lock(parent.mutex);
+
+	request.reset();
+
+	url = std::move(_url);
+	expires = Clock::now() + parent.url_ttl;
+
+	for (auto *handler : waiters)
+		parent.url_results.push_back({handler, url, {}});
+	waiters.clear();
+
+	parent.inject_invoke.Schedule();
+}
+
+void
+QobuzTrackCache::UrlItem::OnQobuzTrackError(std::exception_ptr error) noexcept
+{
+	const std::scoped_lock<Mutex> lock(parent.mutex);
+
+	request.reset();
+	url.clear();
+
+	for (auto *handler : waiters)
+		parent.url_results.push_back({handler, {}, error});
+	waiters.clear();
+
+	parent.inject_invoke.Schedule();
+}
+
+void
+QobuzTrackCache::LookupTag(std::string_view track_id,
+			   RemoteTagHandler &handler) noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+
+	auto i = tags.find(track_id);
+	if (i == tags.end()) {
+		Evict(tags);
+		i = tags.try_emplace(std::string{track_id},
+				     *this, track_id).first;
+	}
+
+	auto &item = i->second;
+
+	if (!item.IsBusy() && Clock::now() < item.expires) {
+		/* cache hit */
+		tag_results.push_back({&handler, item.tag, {}});
+		inject_invoke.Schedule();
+		return;
+	}
+
+	item.waiters.push_back(&handler);
+
+	if (!item.IsBusy()) {
+		/* the request will be started by InvokeResults() in
+		   the EventLoop thread */
+		item.queued = true;
+		tag_queue.push_back(&item);
+		inject_invoke.Schedule();
+	}
+}
+
+void
+QobuzTrackCache::CancelTag(RemoteTagHandler &handler) noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	/* pending requests are not canceled; their result will be
+	   cached */
+	for (auto &[track_id, item] : tags)
+		std::erase(item.waiters, &handler);
+
+	tag_results.remove_if([&handler](const TagResult &r){
+		return r.handler == &handler;
+	});
+
+	WaitNotInvoking(lock, &handler);
+}
+
+void
+QobuzTrackCache::StartQueuedTagRequests() noexcept
+{
+	while (n_tag_requests < MAX_TAG_REQUESTS && !tag_queue.empty()) {
+		auto &item = *tag_queue.front();
+		tag_queue.pop_front();
+		item.queued = false;
+
+		try {
+			RemoteTagHandler &h = item;
+			item.scanner = std::make_unique<QobuzTagScanner>(client,
+									 item.track_id.c_str(),
+									 h);
+			item.scanner->Start();
+			++n_tag_requests;
+		} catch (...) {
+			item.scanner.reset();
+
+			for (auto *handler : item.waiters)
+				tag_results.push_back({handler, {},
+						std::current_exception()});
+			item.waiters.clear();
+
+			inject_invoke.Schedule();
+		}
+	}
+}
+
+void
+QobuzTrackCache::TagItem::OnRemoteTag(Tag &&_tag) noexcept
+{
+	const std::scoped_lock<Mutex> lock(parent.mutex);
+
+	scanner.reset();
+	--parent.n_tag_requests;
+
+	tag = std::move(_tag);
+	expires = Clock::now() + parent.tag_ttl;
+
+	for (auto *handler : waiters)
+		parent.tag_results.push_back({handler, tag, {}});
+	waiters.clear();
+
+	parent.StartQueuedTagRequests();
+	parent.inject_invoke.Schedule();
+}
+
+void
+QobuzTrackCache::TagItem::OnRemoteTagError(std::exception_ptr error) noexcept
+{
+	const std::scoped_lock<Mutex> lock(parent.mutex);
+
+	scanner.reset();
+	--parent.n_tag_requests;
+
+	tag.Clear();
+	expires = {};
+
+	for (auto *handler : waiters)
+		parent.tag_results.push_back({handler, {}, error});
+	waiters.clear();
+
+	parent.StartQueuedTagRequests();
+	parent.inject_invoke.Schedule();
+}
+
+void
+QobuzTrackCache::InvokeResults() noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	StartQueuedTagRequests();
+
+	while (!url_results.empty()) {
+		auto r = std::move(url_results.front());
+		url_results.pop_front();
+
+		invoking = r.handler;
+
+		{
+			const ScopeUnlock unlock(mutex);
+
+			if (r.error)
+				r.handler->OnQobuzTrackError(std::move(r.error));
+			else
+				r.handler->OnQobuzTrackSuccess(std::move(r.url));
+		}
+
+		invoking = nullptr;
+		cond.notify_all();
+	}
+
+	while (!tag_results.empty()) {
+		auto r = std::move(tag_results.front());
+		tag_results.pop_front();
+
+		invoking = r.handler;
+
+		{
+			const ScopeUnlock unlock(mutex);
+
+			if (r.error)
+				r.handler->OnRemoteTagError(std::move(r.error));
+			else
+				r.handler->OnRemoteTag(std::move(r.tag));
+		}
+
+		invoking = nullptr;
+		cond.notify_all();
+	}
+}
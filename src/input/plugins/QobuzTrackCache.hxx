@@ -0,0 +1,269 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef QOBUZ_TRACK_CACHE_HXX
+#define QOBUZ_TRACK_CACHE_HXX
+
+#include "QobuzTrackRequest.hxx"
+#include "QobuzTagScanner.hxx"
+#include "input/RemoteTagScanner.hxx"
+#include "tag/Tag.hxx"
+#include "event/InjectEvent.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <chrono>
+#include <exception>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class QobuzClient;
+struct QobuzSession;
+
+/**
+ * Caches Qobuz track file URLs and track tags for a limited time.
+ * Concurrent lookups of the same track share one request, and the
+ * number of concurrent tag requests is limited, so loading a large
+ * queue of Qobuz tracks does not flood the server.
+ *
+ * Handlers are always invoked asynchronously in the #EventLoop
+ * thread, never from inside a lookup method.
+ */
+class QobuzTrackCache final {
+	/**
+	 * Never cache more than this number of items (per kind).
+	 */
+	static constexpr std::size_t MAX_ITEMS = 4096;
+
+	/**
+	 * The maximum number of concurrent tag requests.  More tag
+	 * lookups are queued.
+	 */
+	static constexpr unsigned MAX_TAG_REQUESTS = 4;
+
+	using Clock = std::chrono::steady_clock;
+
+	QobuzClient &client;
+
+	const Clock::duration url_ttl, tag_ttl;
+
+	/**
+	 * Starts queued tag requests and invokes the handlers in
+	 * #url_results and #tag_results.
+	 */
+	InjectEvent inject_invoke;
+
+	/**
+	 * Protects all attributes except for the constant ones.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Signalled after a handler has been invoked.
+	 */
+	Cond cond;
+
+	/**
+	 * The handler which is currently being invoked (with #mutex
+	 * unlocked) by InvokeResults(), or nullptr.
+	 */
+	const void *invoking = nullptr;
+
+	struct UrlItem final : QobuzTrackHandler {
+		QobuzTrackCache &parent;
+
+		const std::string track_id;
+
+		/**
+		 * The pending request; nullptr if the #url is
+		 * already known or if the previous request has
+		 * failed.
+		 */
+		std::unique_ptr<QobuzTrackRequest> request;
+
+		std::vector<QobuzTrackHandler *> waiters;
+
+		std::string url;
+
+		/**
+		 * The #url may be used until this time.
+		 */
+		Clock::time_point expires;
+
+		UrlItem(QobuzTrackCache &_parent,
+			std::string_view _track_id) noexcept
+			:parent(_parent), track_id(_track_id) {}
+
+		bool IsBusy() const noexcept {
+			return request != nullptr;
+		}
+
+		/* virtual methods from QobuzTrackHandler */
+		void OnQobuzTrackSuccess(std::string _url) noexcept override;
+		void OnQobuzTrackError(std::exception_ptr error) noexcept override;
+	};
+
+	struct TagItem final : RemoteTagHandler {
+		QobuzTrackCache &parent;
+
+		const std::string track_id;
+
+		/**
+		 * The pending request; nullptr if the #tag is already
+		 * known, if the previous request has failed or if
+		 * this item is in #tag_queue.
+		 */
+		std::unique_ptr<QobuzTagScanner> scanner;
+
+		std::vector<RemoteTagHandler *> waiters;
+
+		Tag tag;
+
+		/**
+		 * The #tag may be used until this time.
+		 */
+		Clock::time_point expires;
+
+		/**
+		 * Has this item been added to #tag_queue?
+		 */
+		bool queued = false;
+
+		TagItem(QobuzTrackCache &_parent,
+			std::string_view _track_id) noexcept
+			:parent(_parent), track_id(_track_id) {}
+
+		bool IsBusy() const noexcept {
+			return scanner || queued;
+		}
+
+		/* virtual methods from RemoteTagHandler */
+		void OnRemoteTag(Tag &&_tag) noexcept override;
+		void OnRemoteTagError(std::exception_ptr error) noexcept override;
+	};
+
+	std::map<std::string, UrlItem, std::less<>> urls;
+	std::map<std::string, TagItem, std::less<>> tags;
+
+	/**
+	 * Tag lookups which wait for a free request slot.
+	 */
+	std::list<TagItem *> tag_queue;
+
+	/**
+	 * The number of running #QobuzTagScanner instances.
+	 */
+	unsigned n_tag_requests = 0;
+
+	struct UrlResult {
+		QobuzTrackHandler *handler;
+		std::string url;
+		std::exception_ptr error;
+	};
+
+	struct TagResult {
+		RemoteTagHandler *handler;
+		Tag tag;
+		std::exception_ptr error;
+	};
+
+	/**
+	 * Results which shall be passed to their handlers by
+	 * InvokeResults().
+	 */
+	std::list<UrlResult> url_results;
+	std::list<TagResult> tag_results;
+
+public:
+	/**
+	 * @param url_ttl how long are file URLs cached?
+	 * @param tag_ttl how long are tags cached?
+	 */
+	QobuzTrackCache(EventLoop &event_loop, QobuzClient &_client,
+			Clock::duration _url_ttl,
+			Clock::duration _tag_ttl) noexcept;
+
+	~QobuzTrackCache() noexcept;
+
+	QobuzTrackCache(const QobuzTrackCache &) = delete;
+	QobuzTrackCache &operator=(const QobuzTrackCache &) = delete;
+
+	/**
+	 * Look up the file URL of a track.  Throws on error (the
+	 * handler will not be invoked then).
+	 *
+	 * Must be called in the #EventLoop thread.
+	 */
+	void LookupUrl(const QobuzSession &session, std::string_view track_id,
+		       QobuzTrackHandler &handler);
+
+	/**
+	 * Cancel all URL lookups for this handler.  After returning,
+	 * the handler will not be invoked.
+	 */
+	void CancelUrl(QobuzTrackHandler &handler) noexcept;
+
+	/**
+	 * Look up the tags of a track.  Errors are reported to the
+	 * handler.
+	 */
+	void LookupTag(std::string_view track_id,
+		       RemoteTagHandler &handler) noexcept;
+
+	/**
+	 * Cancel all tag lookups for this handler.  After returning,
+	 * the handler will not be invoked.
+	 */
+	void CancelTag(RemoteTagHandler &handler) noexcept;
+
+private:
+	EventLoop &GetEventLoop() const noexcept {
+		return inject_invoke.GetEventLoop();
+	}
+
+	/**
+	 * Wait until InvokeResults() has finished invoking the given
+	 * handler.  Caller must lock the #mutex.
+	 */
+	void WaitNotInvoking(std::unique_lock<Mutex> &lock,
+			     const void *handler) noexcept;
+
+	/**
+	 * Start the next queued tag requests if there are free slots.
+	 * Caller must lock the #mutex.  Must be called in the
+	 * #EventLoop thread.
+	 */
+	void StartQueuedTagRequests() noexcept;
+
+	/**
+	 * Remove expired idle items if the given map is full.  Caller
+	 * must lock the #mutex.
+	 */
+	template<typename M>
+	static void Evict(M &map) noexcept;
+
+	/* InjectEvent callback */
+	void InvokeResults() noexcept;
+};
+
+#endif
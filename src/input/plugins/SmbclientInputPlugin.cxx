@@ -19,45 +19,53 @@
 
 #include "SmbclientInputPlugin.hxx"
 #include "lib/smbclient/Init.hxx"
-#include "lib/smbclient/Context.hxx"
-#include "../InputStream.hxx"
+#include "lib/smbclient/Pool.hxx"
+#include "../ThreadInputStream.hxx"
 #include "../InputPlugin.hxx"
-#include "../MaybeBufferedInputStream.hxx"
 #include "PluginUnavailable.hxx"
 #include "system/Error.hxx"
 
 #include <libsmbclient.h>
 
-class SmbclientInputStream final : public InputStream {
-	SmbclientContext ctx;
+#include <memory>
+
+/**
+ * The size of the read-ahead buffer of each stream.
+ */
+static constexpr size_t SMBCLIENT_BUFFER_SIZE = 2 * 1024 * 1024;
+
+static std::unique_ptr<SmbclientContextPool> smbclient_pool;
+
+/**
+ * Reads from the file in a separate thread, while the client
+ * consumes data which has been read ahead.
+ */
+class SmbclientInputStream final : public ThreadInputStream {
+	SmbclientContextPool::Lease ctx;
 	SMBCFILE *const handle;
 
 public:
 	SmbclientInputStream(const char *_uri,
 			     Mutex &_mutex,
-			     SmbclientContext &&_ctx,
+			     SmbclientContextPool::Lease &&_ctx,
 			     SMBCFILE *_handle, const struct stat &st)
-		:InputStream(_uri, _mutex),
+		:ThreadInputStream(input_plugin_smbclient.name, _uri, _mutex,
+				   SMBCLIENT_BUFFER_SIZE),
 		 ctx(std::move(_ctx)), handle(_handle)
 	{
 		seekable = true;
 		size = st.st_size;
-		SetReady();
 	}
 
 	~SmbclientInputStream() override {
-		ctx.Close(handle);
+		Stop();
+		ctx->Close(handle);
 	}
 
-	/* virtual methods from InputStream */
-
-	[[nodiscard]] bool IsEOF() const noexcept override {
-		return offset >= size;
-	}
-
-	size_t Read(std::unique_lock<Mutex> &lock,
-		    void *ptr, size_t size) override;
-	void Seek(std::unique_lock<Mutex> &lock, offset_type offset) override;
+protected:
+	/* virtual methods from ThreadInputStream */
+	size_t ThreadRead(void *ptr, size_t size) override;
+	void ThreadSeek(offset_type offset) override;
 };
 
 /*
@@ -74,67 +82,56 @@ input_smbclient_init(EventLoop &, const ConfigBlock &)
 		std::throw_with_nested(PluginUnavailable("libsmbclient initialization failed"));
 	}
 
-	// TODO: create one global SMBCCTX here?
+	smbclient_pool = std::make_unique<SmbclientContextPool>();
 
 	// TODO: evaluate ConfigBlock, call smbc_setOption*()
 }
 
+static void
+input_smbclient_finish() noexcept
+{
+	smbclient_pool.reset();
+}
+
 static InputStreamPtr
 input_smbclient_open(const char *uri,
 		     Mutex &mutex)
 {
-	auto ctx = SmbclientContext::New();
+	auto ctx = smbclient_pool->Get();
 
-	SMBCFILE *handle = ctx.OpenReadOnly(uri);
+	SMBCFILE *handle = ctx->OpenReadOnly(uri);
 	if (handle == nullptr)
 		throw MakeErrno("smbc_open() failed");
 
 	struct stat st;
-	if (ctx.Stat(handle, st) < 0) {
+	if (ctx->Stat(handle, st) < 0) {
 		const int e = errno;
-		ctx.Close(handle);
+		ctx->Close(handle);
 		throw MakeErrno(e, "smbc_fstat() failed");
 	}
 
-	return std::make_unique<MaybeBufferedInputStream>
-		(std::make_unique<SmbclientInputStream>(uri, mutex,
-							std::move(ctx),
-							handle, st));
+	auto is = std::make_unique<SmbclientInputStream>(uri, mutex,
+							 std::move(ctx),
+							 handle, st);
+	is->Start();
+	return is;
 }
 
 size_t
-SmbclientInputStream::Read(std::unique_lock<Mutex> &,
-			   void *ptr, size_t read_size)
+SmbclientInputStream::ThreadRead(void *ptr, size_t read_size)
 {
-	ssize_t nbytes;
-
-	{
-		const ScopeUnlock unlock(mutex);
-		nbytes = ctx.Read(handle, ptr, read_size);
-	}
-
+	ssize_t nbytes = ctx->Read(handle, ptr, read_size);
 	if (nbytes < 0)
 		throw MakeErrno("smbc_read() failed");
 
-	offset += nbytes;
 	return nbytes;
 }
 
 void
-SmbclientInputStream::Seek(std::unique_lock<Mutex> &,
-			   offset_type new_offset)
+SmbclientInputStream::ThreadSeek(offset_type new_offset)
 {
-	off_t result;
-
-	{
-		const ScopeUnlock unlock(mutex);
-		result = ctx.Seek(handle, new_offset);
-	}
-
-	if (result < 0)
+	if (ctx->Seek(handle, new_offset) < 0)
 		throw MakeErrno("smbc_lseek() failed");
-
-	offset = result;
 }
 
 static constexpr const char *smbclient_prefixes[] = {
@@ -146,7 +143,7 @@ const InputPlugin input_plugin_smbclient = {
 	"smbclient",
 	smbclient_prefixes,
 	input_smbclient_init,
-	nullptr,
+	input_smbclient_finish,
 	input_smbclient_open,
 	nullptr
 };
@@ -163,6 +163,11 @@ FileOutputStream::Sync()
 		throw FmtLastError("Failed to sync {}", GetPath());
 }
 
+void
+FileOutputStream::Preallocate([[maybe_unused]] uint64_t size) noexcept
+{
+}
+
 void
 FileOutputStream::Commit()
 try {
@@ -297,11 +302,30 @@ FileOutputStream::Sync()
 		throw FmtErrno("Failed to sync {}", GetPath());
 }
 
+void
+FileOutputStream::Preallocate([[maybe_unused]] uint64_t size) noexcept
+{
+	assert(IsDefined());
+
+#ifdef __linux__
+	/* errors are ignored; this is only an optimization */
+	if (fallocate(fd.Get(), FALLOC_FL_KEEP_SIZE, Tell(), size) == 0)
+		preallocated = true;
+#endif
+}
+
 void
 FileOutputStream::Commit()
 try {
 	assert(IsDefined());
 
+#ifdef __linux__
+	if (preallocated)
+		/* release the reserved disk space which was not
+		   used */
+		(void)ftruncate(fd.Get(), Tell());
+#endif
+
 #ifdef HAVE_O_TMPFILE
 	if (is_tmpfile) {
 		unlinkat(directory_fd.Get(), GetPath().c_str(), 0);
@@ -93,6 +93,14 @@ class FileOutputStream final : public OutputStream {
 	bool is_tmpfile = false;
 #endif
 
+#ifdef __linux__
+	/**
+	 * Has disk space been reserved with Preallocate()?  If yes,
+	 * then Commit() releases the unused rest.
+	 */
+	bool preallocated = false;
+#endif
+
 public:
 	enum class Mode : uint8_t {
 		/**
@@ -164,6 +172,15 @@ public:
 	 */
 	void Sync();
 
+	/**
+	 * Reserve disk space for the given number of bytes after the
+	 * current offset, without changing the file size.  This is
+	 * only a hint to reduce fragmentation and allocation latency;
+	 * it is a no-op if the operating system or the filesystem
+	 * does not support it.
+	 */
+	void Preallocate(uint64_t size) noexcept;
+
 	/**
 	 * Commit all data written to the file and make the file
 	 * visible on the specified path.
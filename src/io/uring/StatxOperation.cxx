@@ -0,0 +1,48 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StatxOperation.hxx"
+#include "Queue.hxx"
+#include "io/FileDescriptor.hxx"
+
+namespace Uring {
+
+void
+StatxOperation::Start(Queue &queue, FileDescriptor directory_fd,
+		      const char *path, int flags, unsigned mask,
+		      StatxHandler &_handler) noexcept
+{
+	handler = &_handler;
+
+	auto &s = queue.RequireSubmitEntry();
+
+	io_uring_prep_statx(&s, directory_fd.Get(), path, flags, mask, &st);
+	queue.Push(s, *this);
+}
+
+void
+StatxOperation::OnUringCompletion(int res) noexcept
+{
+	if (res >= 0)
+		handler->OnStatx(st);
+	else
+		handler->OnStatxError(-res);
+}
+
+} // namespace Uring
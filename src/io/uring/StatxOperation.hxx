@@ -0,0 +1,63 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "Operation.hxx"
+
+#include <sys/stat.h> // for struct statx
+
+class FileDescriptor;
+
+namespace Uring {
+
+class Queue;
+
+class StatxHandler {
+public:
+	virtual void OnStatx(const struct statx &st) noexcept = 0;
+
+	/**
+	 * @param error an errno value
+	 */
+	virtual void OnStatxError(int error) noexcept = 0;
+};
+
+/**
+ * Call statx() asynchronously.
+ *
+ * The caller must keep this object and the path string alive until
+ * the operation has completed.
+ */
+class StatxOperation final : Operation {
+	StatxHandler *handler;
+
+	struct statx st;
+
+public:
+	void Start(Queue &queue, FileDescriptor directory_fd,
+		   const char *path, int flags, unsigned mask,
+		   StatxHandler &_handler) noexcept;
+
+private:
+	/* virtual methods from class Operation */
+	void OnUringCompletion(int res) noexcept override;
+};
+
+} // namespace Uring
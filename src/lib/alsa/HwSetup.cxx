@@ -177,7 +177,8 @@ SetupSampleFormat(snd_pcm_t *pcm, snd_pcm_hw_params_t *hwparams,
 HwResult
 SetupHw(snd_pcm_t *pcm,
 	unsigned buffer_time, unsigned period_time,
-	AudioFormat &audio_format, PcmExport::Params &params)
+	AudioFormat &audio_format, PcmExport::Params &params,
+	bool mmap)
 {
 	snd_pcm_hw_params_t *hwparams;
 	snd_pcm_hw_params_alloca(&hwparams);
@@ -191,7 +192,9 @@ SetupHw(snd_pcm_t *pcm,
 		throw Alsa::MakeError(err, "snd_pcm_hw_params_any() failed");
 
 	err = snd_pcm_hw_params_set_access(pcm, hwparams,
-					   SND_PCM_ACCESS_RW_INTERLEAVED);
+					   mmap
+					   ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+					   : SND_PCM_ACCESS_RW_INTERLEAVED);
 	if (err < 0)
 		throw Alsa::MakeError(err, "snd_pcm_hw_params_set_access() failed");
 
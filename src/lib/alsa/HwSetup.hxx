@@ -41,11 +41,14 @@ struct HwResult {
  * @param audio_format an #AudioFormat to be configured (or modified)
  * by this function
  * @param params to be modified by this function
+ * @param mmap use #SND_PCM_ACCESS_MMAP_INTERLEAVED instead of
+ * #SND_PCM_ACCESS_RW_INTERLEAVED
  */
 HwResult
 SetupHw(snd_pcm_t *pcm,
 	unsigned buffer_time, unsigned period_time,
-	AudioFormat &audio_format, PcmExport::Params &params);
+	AudioFormat &audio_format, PcmExport::Params &params,
+	bool mmap=false);
 
 } // namespace Alsa
 
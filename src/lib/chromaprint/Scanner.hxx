@@ -0,0 +1,106 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CHROMAPRINT_SCANNER_HXX
+#define CHROMAPRINT_SCANNER_HXX
+
+#include "DecoderClient.hxx"
+#include "input/Handler.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <string>
+#include <string_view>
+
+struct DecoderPlugin;
+
+/**
+ * Decodes a song and calculates its Chromaprint fingerprint.  This
+ * is a blocking operation which is meant to be run in a worker
+ * thread; it can be aborted from another thread with Cancel().
+ */
+class ChromaprintScanner final
+	: public ChromaprintDecoderClient, InputStreamHandler
+{
+	Mutex mutex;
+	Cond cond;
+
+	const std::string uri;
+	const AllocatedPath path;
+
+	bool cancel = false;
+
+public:
+	/**
+	 * @param _uri the URI of the song (a remote URI or a local
+	 * path in UTF-8)
+	 * @param _path the local file system path; nullptr if the
+	 * song shall be opened by its URI
+	 */
+	ChromaprintScanner(std::string_view _uri,
+			   AllocatedPath &&_path) noexcept
+		:uri(_uri), path(std::move(_path)) {}
+
+	/**
+	 * Decode the song and calculate its fingerprint.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the fingerprint or an empty string if the scan was
+	 * canceled
+	 */
+	std::string Scan();
+
+	/**
+	 * Abort a Scan() running in another thread.
+	 */
+	void Cancel() noexcept {
+		const std::scoped_lock<Mutex> lock(mutex);
+		cancel = true;
+		cond.notify_one();
+	}
+
+private:
+	void DecodeStream(InputStream &is, const DecoderPlugin &plugin);
+	bool DecodeStream(InputStream &is, std::string_view suffix,
+			  const DecoderPlugin &plugin);
+	void DecodeStream(InputStream &is);
+	bool DecodeContainer(std::string_view suffix, const DecoderPlugin &plugin);
+	bool DecodeContainer(std::string_view suffix);
+	bool DecodeFile(std::string_view suffix, InputStream &is,
+			const DecoderPlugin &plugin);
+	void DecodeFile();
+
+	/* virtual methods from class DecoderClient */
+	InputStreamPtr OpenUri(const char *uri) override;
+	size_t Read(InputStream &is,
+		    void *buffer, size_t length) noexcept override;
+
+	/* virtual methods from class InputStreamHandler */
+	void OnInputStreamReady() noexcept override {
+		cond.notify_one();
+	}
+
+	void OnInputStreamAvailable() noexcept override {
+		cond.notify_one();
+	}
+};
+
+#endif
@@ -28,6 +28,7 @@
  */
 
 #include "Global.hxx"
+#include "Metrics.hxx"
 #include "Request.hxx"
 #include "event/Loop.hxx"
 #include "event/SocketEvent.hxx"
@@ -35,6 +36,8 @@
 
 #include <cassert>
 
+CurlMetrics curl_metrics;
+
 /**
  * Monitor for one socket created by CURL.
  */
@@ -115,6 +118,19 @@ CurlGlobal::CurlGlobal(EventLoop &_loop)
 
 	multi.SetOption(CURLMOPT_TIMERFUNCTION, TimerFunction);
 	multi.SetOption(CURLMOPT_TIMERDATA, this);
+
+	/* allow multiple requests to the same server to share one
+	   HTTP/2 connection */
+	multi.SetOption(CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+	/* by default, the connection cache shrinks with the number
+	   of active requests, which closes the connection to a
+	   streaming server right before the next song is requested;
+	   keep a few idle connections around */
+	multi.SetOption(CURLMOPT_MAXCONNECTS, 16L);
+
+	share.Share(CURL_LOCK_DATA_DNS);
+	share.Share(CURL_LOCK_DATA_SSL_SESSION);
 }
 
 int
@@ -185,6 +201,20 @@ ToRequest(CURL *easy) noexcept
 	return (CurlRequest *)p;
 }
 
+static void
+UpdateMetrics(CURL *easy) noexcept
+{
+	long connects;
+	if (curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS,
+			      &connects) != CURLE_OK)
+		return;
+
+	curl_metrics.transfers.fetch_add(1, std::memory_order_relaxed);
+	curl_metrics.connects.fetch_add(connects, std::memory_order_relaxed);
+	if (connects == 0)
+		curl_metrics.reused.fetch_add(1, std::memory_order_relaxed);
+}
+
 inline void
 CurlGlobal::ReadInfo() noexcept
 {
@@ -194,6 +224,8 @@ CurlGlobal::ReadInfo() noexcept
 
 	while ((msg = multi.InfoRead()) != nullptr) {
 		if (msg->msg == CURLMSG_DONE) {
+			UpdateMetrics(msg->easy_handle);
+
 			auto *request = ToRequest(msg->easy_handle);
 			if (request != nullptr)
 				request->Done(msg->data.result);
@@ -31,6 +31,7 @@
 #define CURL_GLOBAL_HXX
 
 #include "Multi.hxx"
+#include "Share.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "event/DeferEvent.hxx"
 
@@ -41,6 +42,15 @@ class CurlRequest;
  * Manager for the global CURLM object.
  */
 class CurlGlobal final {
+	/**
+	 * Shares the DNS cache and TLS sessions among all requests,
+	 * so a new request to a known HTTPS server can resume the
+	 * TLS session instead of doing a full handshake.  All
+	 * requests run in the I/O thread, so no locking callbacks
+	 * are needed.
+	 */
+	CurlShare share;
+
 	CurlMulti multi;
 
 	DeferEvent defer_read_info;
@@ -54,6 +64,10 @@ public:
 		return timeout_event.GetEventLoop();
 	}
 
+	CURLSH *GetShare() noexcept {
+		return share.Get();
+	}
+
 	void Add(CurlRequest &r);
 	void Remove(CurlRequest &r) noexcept;
 
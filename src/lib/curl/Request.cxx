@@ -59,6 +59,7 @@ void
 CurlRequest::SetupEasy()
 {
 	easy.SetPrivate((void *)this);
+	easy.SetOption(CURLOPT_SHARE, global.GetShare());
 
 	handler.Install(easy);
 
@@ -43,6 +43,10 @@ Setup(CurlEasy &easy)
 	easy.SetNoProgress();
 	easy.SetNoSignal();
 	easy.SetConnectTimeout(10);
+
+	/* keep idle connections in the cache alive, so they can be
+	   reused for the next request */
+	easy.SetOption(CURLOPT_TCP_KEEPALIVE, 1L);
 	easy.SetOption(CURLOPT_HTTPAUTH, (long) CURLAUTH_ANY);
 }
 
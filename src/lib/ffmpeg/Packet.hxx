@@ -0,0 +1,71 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FFMPEG_PACKET_HXX
+#define MPD_FFMPEG_PACKET_HXX
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <new>
+
+namespace Ffmpeg {
+
+/**
+ * A reusable #AVPacket.  Call Unref() after each use to release the
+ * payload; the #AVPacket structure itself is only freed by the
+ * destructor.
+ */
+class Packet {
+	AVPacket *packet;
+
+public:
+	Packet():packet(av_packet_alloc()) {
+		if (packet == nullptr)
+			throw std::bad_alloc();
+	}
+
+	~Packet() noexcept {
+		av_packet_free(&packet);
+	}
+
+	Packet(const Packet &) = delete;
+	Packet &operator=(const Packet &) = delete;
+
+	AVPacket &operator*() noexcept {
+		return *packet;
+	}
+
+	AVPacket *operator->() noexcept {
+		return packet;
+	}
+
+	AVPacket *get() noexcept {
+		return packet;
+	}
+
+	void Unref() noexcept {
+		av_packet_unref(packet);
+	}
+};
+
+} // namespace Ffmpeg
+
+#endif
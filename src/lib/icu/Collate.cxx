@@ -24,6 +24,7 @@
 #ifdef HAVE_ICU
 #include "Error.hxx"
 #include "Util.hxx"
+#include "util/AllocatedArray.hxx"
 
 #include <unicode/ucol.h>
 #include <unicode/ustring.h>
@@ -125,3 +126,71 @@ IcuCollate(std::string_view a, std::string_view b) noexcept
 	return strcoll(std::string(a).c_str(), std::string(b).c_str());
 #endif
 }
+
+AllocatedString
+IcuCollateKey(std::string_view src) noexcept
+{
+#ifdef HAVE_ICU
+	assert(collator != nullptr);
+
+	try {
+		const auto u = UCharFromUTF8(src);
+
+		/* most sort keys are not much larger than the UTF-16
+		   string; if this guess is too small, try again with
+		   the size returned by ucol_getSortKey() */
+		int32_t capacity = u.size() * 2 + 16;
+		while (true) {
+			auto key = std::make_unique<char[]>(capacity);
+			const int32_t length =
+				ucol_getSortKey(collator, u.data(), u.size(),
+						(uint8_t *)key.get(), capacity);
+			if (length <= 0)
+				break;
+
+			if (length <= capacity)
+				/* the key is null-terminated, and it
+				   does not contain other null bytes */
+				return AllocatedString::Donate(key.release());
+
+			capacity = length;
+		}
+	} catch (...) {
+	}
+
+	/* fall back to the original string; that's not correct,
+	   but it's something */
+	return AllocatedString{src};
+
+#elif defined(_WIN32)
+	try {
+		const auto w = MultiByteToWideChar(CP_UTF8, src);
+		const int length = LCMapStringEx(LOCALE_NAME_INVARIANT,
+						 LCMAP_SORTKEY|NORM_IGNORECASE,
+						 w.c_str(), -1,
+						 nullptr, 0,
+						 nullptr, nullptr, 0);
+		if (length > 0) {
+			auto key = std::make_unique<char[]>(length);
+
+			/* with LCMAP_SORTKEY, the destination is a
+			   byte array despite the LPWSTR type */
+			if (LCMapStringEx(LOCALE_NAME_INVARIANT,
+					  LCMAP_SORTKEY|NORM_IGNORECASE,
+					  w.c_str(), -1,
+					  (LPWSTR)key.get(), length,
+					  nullptr, nullptr, 0) > 0)
+				return AllocatedString::Donate(key.release());
+		}
+	} catch (...) {
+	}
+
+	return AllocatedString{src};
+#else
+	const std::string s(src);
+	const std::size_t length = strxfrm(nullptr, s.c_str(), 0);
+	auto key = std::make_unique<char[]>(length + 1);
+	strxfrm(key.get(), s.c_str(), length + 1);
+	return AllocatedString::Donate(key.release());
+#endif
+}
@@ -22,6 +22,8 @@
 
 #include <string_view>
 
+class AllocatedString;
+
 /**
  * Throws #std::runtime_error on error.
  */
@@ -35,4 +37,13 @@ IcuCollateFinish() noexcept;
 int
 IcuCollate(std::string_view a, std::string_view b) noexcept;
 
+/**
+ * Generate a sort key for the given string: comparing two sort keys
+ * with strcmp() yields the same order as IcuCollate() on the
+ * original strings, but is much cheaper.  This is useful for strings
+ * which get compared many times.
+ */
+AllocatedString
+IcuCollateKey(std::string_view src) noexcept;
+
 #endif
@@ -55,7 +55,7 @@ bool
 IcuCompare::operator==(const char *haystack) const noexcept
 {
 #ifdef HAVE_ICU_CANONICALIZE
-	return StringIsEqual(IcuCanonicalize(haystack, true).c_str(), needle.c_str());
+	return EqualsFolded(IcuCanonicalize(haystack, true).c_str());
 #elif defined(_WIN32)
 	if (needle == nullptr)
 		/* the MultiByteToWideChar() call in the constructor
@@ -81,8 +81,7 @@ bool
 IcuCompare::IsIn(const char *haystack) const noexcept
 {
 #ifdef HAVE_ICU_CANONICALIZE
-	return StringFind(IcuCanonicalize(haystack, true).c_str(),
-			  needle.c_str()) != nullptr;
+	return IsInFolded(IcuCanonicalize(haystack, true).c_str());
 #elif defined(_WIN32)
 	if (needle == nullptr)
 		/* the MultiByteToWideChar() call in the constructor
@@ -118,8 +117,7 @@ bool
 IcuCompare::StartsWith(const char *haystack) const noexcept
 {
 #ifdef HAVE_ICU_CANONICALIZE
-	return StringStartsWith(IcuCanonicalize(haystack, true).c_str(),
-				needle);
+	return StartsWithFolded(IcuCanonicalize(haystack, true).c_str());
 #elif defined(_WIN32)
 	if (needle == nullptr)
 		/* the MultiByteToWideChar() call in the constructor
@@ -142,3 +140,25 @@ IcuCompare::StartsWith(const char *haystack) const noexcept
 	return StringStartsWith(haystack, needle);
 #endif
 }
+
+#ifdef HAVE_ICU_CANONICALIZE
+
+bool
+IcuCompare::EqualsFolded(const char *folded_haystack) const noexcept
+{
+	return StringIsEqual(folded_haystack, needle.c_str());
+}
+
+bool
+IcuCompare::IsInFolded(const char *folded_haystack) const noexcept
+{
+	return StringFind(folded_haystack, needle.c_str()) != nullptr;
+}
+
+bool
+IcuCompare::StartsWithFolded(const char *folded_haystack) const noexcept
+{
+	return StringStartsWith(folded_haystack, needle);
+}
+
+#endif
@@ -20,6 +20,7 @@
 #ifndef MPD_ICU_COMPARE_HXX
 #define MPD_ICU_COMPARE_HXX
 
+#include "Canonicalize.hxx"
 #include "util/AllocatedString.hxx"
 
 #include <string_view>
@@ -75,6 +76,24 @@ public:
 
 	[[gnu::pure]]
 	bool StartsWith(const char *haystack) const noexcept;
+
+#ifdef HAVE_ICU_CANONICALIZE
+	/*
+	 * The following methods are like the ones above, but the
+	 * haystack has already been transformed with
+	 * IcuCanonicalize(haystack, true), e.g. by the caller's
+	 * cache.
+	 */
+
+	[[gnu::pure]]
+	bool EqualsFolded(const char *folded_haystack) const noexcept;
+
+	[[gnu::pure]]
+	bool IsInFolded(const char *folded_haystack) const noexcept;
+
+	[[gnu::pure]]
+	bool StartsWithFolded(const char *folded_haystack) const noexcept;
+#endif
 };
 
 #endif
@@ -73,30 +73,6 @@ static jack_port_name_t _jack_port_name;
 using jack_port_get_buffer_t = std::add_pointer_t<decltype(jack_port_get_buffer)>;
 static jack_port_get_buffer_t _jack_port_get_buffer;
 
-using jack_ringbuffer_create_t = std::add_pointer_t<decltype(jack_ringbuffer_create)>;
-static jack_ringbuffer_create_t _jack_ringbuffer_create;
-
-using jack_ringbuffer_free_t = std::add_pointer_t<decltype(jack_ringbuffer_free)>;
-static jack_ringbuffer_free_t _jack_ringbuffer_free;
-
-using jack_ringbuffer_get_write_vector_t = std::add_pointer_t<decltype(jack_ringbuffer_get_write_vector)>;
-static jack_ringbuffer_get_write_vector_t _jack_ringbuffer_get_write_vector;
-
-using jack_ringbuffer_write_advance_t = std::add_pointer_t<decltype(jack_ringbuffer_write_advance)>;
-static jack_ringbuffer_write_advance_t _jack_ringbuffer_write_advance;
-
-using jack_ringbuffer_read_space_t = std::add_pointer_t<decltype(jack_ringbuffer_read_space)>;
-static jack_ringbuffer_read_space_t _jack_ringbuffer_read_space;
-
-using jack_ringbuffer_read_t = std::add_pointer_t<decltype(jack_ringbuffer_read)>;
-static jack_ringbuffer_read_t _jack_ringbuffer_read;
-
-using jack_ringbuffer_read_advance_t = std::add_pointer_t<decltype(jack_ringbuffer_read_advance)>;
-static jack_ringbuffer_read_advance_t _jack_ringbuffer_read_advance;
-
-using jack_ringbuffer_reset_t = std::add_pointer_t<decltype(jack_ringbuffer_reset)>;
-static jack_ringbuffer_reset_t _jack_ringbuffer_reset;
-
 template<typename T>
 static void
 GetFunction(HMODULE h, const char *name, T &result)
@@ -140,14 +116,6 @@ LoadJackLibrary()
 	GetFunction(libjack, "jack_port_name", _jack_port_name);
 	GetFunction(libjack, "jack_port_get_buffer", _jack_port_get_buffer);
 
-	GetFunction(libjack, "jack_ringbuffer_create", _jack_ringbuffer_create);
-	GetFunction(libjack, "jack_ringbuffer_free", _jack_ringbuffer_free);
-	GetFunction(libjack, "jack_ringbuffer_get_write_vector", _jack_ringbuffer_get_write_vector);
-	GetFunction(libjack, "jack_ringbuffer_write_advance", _jack_ringbuffer_write_advance);
-	GetFunction(libjack, "jack_ringbuffer_read_space", _jack_ringbuffer_read_space);
-	GetFunction(libjack, "jack_ringbuffer_read", _jack_ringbuffer_read);
-	GetFunction(libjack, "jack_ringbuffer_read_advance", _jack_ringbuffer_read_advance);
-	GetFunction(libjack, "jack_ringbuffer_reset", _jack_ringbuffer_reset);
 }
 
 #define jack_set_error_function _jack_set_error_function
@@ -169,14 +137,6 @@ LoadJackLibrary()
 #define jack_port_name _jack_port_name
 #define jack_port_get_buffer _jack_port_get_buffer
 
-#define jack_ringbuffer_create _jack_ringbuffer_create
-#define jack_ringbuffer_free _jack_ringbuffer_free
-#define jack_ringbuffer_get_write_vector _jack_ringbuffer_get_write_vector
-#define jack_ringbuffer_write_advance _jack_ringbuffer_write_advance
-#define jack_ringbuffer_read_space _jack_ringbuffer_read_space
-#define jack_ringbuffer_read _jack_ringbuffer_read
-#define jack_ringbuffer_read_advance _jack_ringbuffer_read_advance
-#define jack_ringbuffer_reset _jack_ringbuffer_reset
 
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
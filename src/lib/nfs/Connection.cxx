@@ -124,8 +124,14 @@ NfsConnection::CancellableCallback::PrepareDestroyContext() noexcept
 	assert(IsCancelled());
 
 	if (close_fh != nullptr) {
+		/* several cancelled operations may refer to the
+		   same file handle; close it only once */
+		const auto *fh = close_fh;
 		connection.InternalClose(close_fh);
-		close_fh = nullptr;
+		connection.callbacks.ForEach([fh](CancellableCallback &c){
+			if (c.IsClosing(fh))
+				c.ForgetClose();
+		});
 	}
 }
 
@@ -156,7 +162,11 @@ NfsConnection::CancellableCallback::Callback(int err, void *data) noexcept
 				auto *fh = (struct nfsfh *)data;
 				connection.Close(fh);
 			}
-		} else if (close_fh != nullptr)
+		} else if (close_fh != nullptr &&
+			   /* if there are more pending operations
+			      on this file handle, the last one
+			      closes it */
+			   !connection.IsCloseScheduled(*this, close_fh))
 			connection.DeferClose(close_fh);
 
 		connection.callbacks.Remove(*this);
@@ -406,6 +416,19 @@ NfsConnection::DestroyContext() noexcept
 	context = nullptr;
 }
 
+bool
+NfsConnection::IsCloseScheduled(const CancellableCallback &except,
+				const struct nfsfh *fh) noexcept
+{
+	bool result = false;
+	callbacks.ForEach([&except, fh, &result](const CancellableCallback &c){
+		if (&c != &except && c.IsClosing(fh))
+			result = true;
+	});
+
+	return result;
+}
+
 inline void
 NfsConnection::DeferClose(struct nfsfh *fh) noexcept
 {
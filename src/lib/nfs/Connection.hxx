@@ -79,6 +79,14 @@ class NfsConnection {
 		 */
 		void CancelAndScheduleClose(struct nfsfh *fh) noexcept;
 
+		bool IsClosing(const struct nfsfh *fh) const noexcept {
+			return close_fh == fh;
+		}
+
+		void ForgetClose() noexcept {
+			close_fh = nullptr;
+		}
+
 		/**
 		 * Called by NfsConnection::DestroyContext() right
 		 * before nfs_destroy_context().  This object is given
@@ -199,6 +207,13 @@ public:
 	void Cancel(NfsCallback &callback) noexcept;
 
 	void Close(struct nfsfh *fh) noexcept;
+
+	/**
+	 * Cancel the operation and close the file handle after it
+	 * has finished.  This may be called for several pending
+	 * operations on the same file handle; it is closed after the
+	 * last one has finished.
+	 */
 	void CancelAndClose(struct nfsfh *fh, NfsCallback &callback) noexcept;
 
 protected:
@@ -217,6 +232,14 @@ private:
 	 */
 	void DeferClose(struct nfsfh *fh) noexcept;
 
+	/**
+	 * Is another cancelled operation (other than the given one)
+	 * still pending which will close the given file handle?
+	 */
+	[[gnu::pure]]
+	bool IsCloseScheduled(const CancellableCallback &except,
+			      const struct nfsfh *fh) noexcept;
+
 	void MountInternal();
 	void BroadcastMountSuccess() noexcept;
 	void BroadcastMountError(std::exception_ptr &&e) noexcept;
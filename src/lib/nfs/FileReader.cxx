@@ -24,6 +24,7 @@
 #include "event/Call.hxx"
 #include "util/ASCII.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
@@ -69,7 +70,23 @@ NfsFileReader::CancelOrClose() noexcept
 		/* no async operation in progress: can close
 		   immediately */
 		connection->Close(fh);
-	else if (state > State::OPEN)
+	else if (state == State::READ) {
+		/* cancel all pending reads; the last one to finish
+		   closes the file handle */
+		bool close_scheduled = false;
+		for (auto &i : reads) {
+			if (!i.done) {
+				connection->CancelAndClose(fh, i);
+				close_scheduled = true;
+			}
+		}
+
+		if (!close_scheduled)
+			connection->Close(fh);
+
+		reads.clear();
+		pending_bytes = 0;
+	} else if (state > State::OPEN)
 		/* one async operation in progress: cancel it and
 		   defer the nfs_close_async() call */
 		connection->CancelAndClose(fh, *this);
@@ -127,21 +144,135 @@ NfsFileReader::Open(const char *uri)
 void
 NfsFileReader::Read(uint64_t offset, size_t size)
 {
-	assert(state == State::IDLE);
+	assert(state == State::IDLE || state == State::READ);
 
-	connection->Read(fh, offset, size, *this);
+	auto &request = reads.emplace_back(*this, offset, size);
+
+	try {
+		connection->Read(fh, offset, size, request);
+	} catch (...) {
+		reads.pop_back();
+		throw;
+	}
+
+	pending_bytes += size;
 	state = State::READ;
 }
 
+void
+NfsFileReader::CancelReads() noexcept
+{
+	for (auto &i : reads)
+		if (!i.done)
+			connection->Cancel(i);
+
+	reads.clear();
+	pending_bytes = 0;
+}
+
 void
 NfsFileReader::CancelRead() noexcept
 {
 	if (state == State::READ) {
-		connection->Cancel(*this);
+		CancelReads();
 		state = State::IDLE;
 	}
 }
 
+void
+NfsFileReader::FlushReads() noexcept
+{
+	while (state == State::READ && !reads.empty() &&
+	       reads.front().done) {
+		auto &front = reads.front();
+		const auto buffer = std::move(front.buffer);
+		const std::size_t length = front.length;
+		const bool short_read = length < front.size;
+
+		pending_bytes -= front.size;
+		reads.pop_front();
+
+		if (short_read)
+			/* the following requests would leave a gap;
+			   the caller has to resubmit them */
+			CancelReads();
+
+		if (reads.empty())
+			state = State::IDLE;
+
+		/* this may call Read(), CancelRead() or Close() */
+		OnNfsFileRead({buffer.get(), length});
+	}
+}
+
+inline void
+NfsFileReader::OnReadDone(ReadRequest &request, unsigned status,
+			  const void *data) noexcept
+{
+	assert(state == State::READ);
+	assert(!reads.empty());
+	assert(!request.done);
+
+	request.done = true;
+	request.length = std::min<std::size_t>(status, request.size);
+
+	if (&request != &reads.front()) {
+		/* completed before its predecessors: copy the data
+		   (it is owned by libnfs) and deliver it later */
+		request.buffer = std::make_unique<std::byte[]>(request.length);
+		std::copy_n(static_cast<const std::byte *>(data),
+			    request.length, request.buffer.get());
+		return;
+	}
+
+	const std::size_t length = request.length;
+	const bool short_read = length < request.size;
+
+	pending_bytes -= request.size;
+	reads.pop_front();
+
+	if (short_read)
+		CancelReads();
+
+	if (reads.empty())
+		state = State::IDLE;
+
+	OnNfsFileRead({static_cast<const std::byte *>(data), length});
+
+	/* deliver the following requests which have already
+	   completed */
+	FlushReads();
+}
+
+inline void
+NfsFileReader::OnReadError(ReadRequest &request,
+			   std::exception_ptr &&e) noexcept
+{
+	assert(state == State::READ);
+
+	/* this request has been removed from the NfsConnection
+	   already; don't cancel it */
+	request.done = true;
+
+	CancelReads();
+	state = State::IDLE;
+
+	OnNfsFileError(std::move(e));
+}
+
+void
+NfsFileReader::ReadRequest::OnNfsCallback(unsigned status,
+					  void *data) noexcept
+{
+	reader.OnReadDone(*this, status, data);
+}
+
+void
+NfsFileReader::ReadRequest::OnNfsError(std::exception_ptr &&e) noexcept
+{
+	reader.OnReadError(*this, std::move(e));
+}
+
 void
 NfsFileReader::OnNfsConnectionReady() noexcept
 {
@@ -220,13 +351,16 @@ NfsFileReader::StatCallback(const struct stat *_st) noexcept
 }
 
 void
-NfsFileReader::OnNfsCallback(unsigned status, void *data) noexcept
+NfsFileReader::OnNfsCallback([[maybe_unused]] unsigned status,
+			     void *data) noexcept
 {
 	switch (std::exchange(state, State::IDLE)) {
 	case State::INITIAL:
 	case State::DEFER:
 	case State::MOUNT:
+	case State::READ:
 	case State::IDLE:
+		/* READ is handled by class ReadRequest */
 		assert(false);
 		gcc_unreachable();
 
@@ -237,13 +371,6 @@ NfsFileReader::OnNfsCallback(unsigned status, void *data) noexcept
 	case State::STAT:
 		StatCallback((const struct stat *)data);
 		break;
-
-	case State::READ:
-		OnNfsFileRead({
-				static_cast<const std::byte *>(data),
-				static_cast<std::size_t>(status),
-			});
-		break;
 	}
 }
 
@@ -254,6 +381,7 @@ NfsFileReader::OnNfsError(std::exception_ptr &&e) noexcept
 	case State::INITIAL:
 	case State::DEFER:
 	case State::MOUNT:
+	case State::READ:
 	case State::IDLE:
 		assert(false);
 		gcc_unreachable();
@@ -268,10 +396,6 @@ NfsFileReader::OnNfsError(std::exception_ptr &&e) noexcept
 		connection->Close(fh);
 		state = State::INITIAL;
 		break;
-
-	case State::READ:
-		state = State::IDLE;
-		break;
 	}
 
 	OnNfsFileError(std::move(e));
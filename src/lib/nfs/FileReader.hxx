@@ -28,6 +28,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <list>
+#include <memory>
 #include <span>
 #include <string>
 
@@ -64,6 +66,55 @@ class NfsFileReader : NfsLease, NfsCallback {
 
 	nfsfh *fh;
 
+	/**
+	 * One READ call which has been submitted to the server.
+	 */
+	class ReadRequest final : public NfsCallback {
+		NfsFileReader &reader;
+
+	public:
+		const uint64_t offset;
+		const size_t size;
+
+		/**
+		 * The number of bytes received (only valid if #done).
+		 */
+		size_t length = 0;
+
+		/**
+		 * Has this request completed?  If it completed before
+		 * its predecessors, then the data has been copied to
+		 * #buffer.
+		 */
+		bool done = false;
+
+		/**
+		 * A copy of the data if this request completed
+		 * before its predecessors.
+		 */
+		std::unique_ptr<std::byte[]> buffer;
+
+		ReadRequest(NfsFileReader &_reader,
+			    uint64_t _offset, size_t _size) noexcept
+			:reader(_reader), offset(_offset), size(_size) {}
+
+		/* virtual methods from NfsCallback */
+		void OnNfsCallback(unsigned status, void *data) noexcept override;
+		void OnNfsError(std::exception_ptr &&e) noexcept override;
+	};
+
+	/**
+	 * All pending READ calls in the order they were submitted.
+	 * The results are delivered to OnNfsFileRead() in this
+	 * order.
+	 */
+	std::list<ReadRequest> reads;
+
+	/**
+	 * The sum of all #ReadRequest::size values in #reads.
+	 */
+	size_t pending_bytes = 0;
+
 	/**
 	 * To inject the Open() call into the I/O thread.
 	 */
@@ -89,8 +140,10 @@ public:
 
 	/**
 	 * Attempt to read from the file.  This may only be done after
-	 * OnNfsFileOpen() has been called.  Only one read operation
-	 * may be performed at a time.
+	 * OnNfsFileOpen() has been called.  More read operations
+	 * may be submitted before the previous ones have completed;
+	 * their results are delivered to OnNfsFileRead() in the
+	 * order of the Read() calls.
 	 *
 	 * This method is not thread-safe and must be called from
 	 * within the I/O thread.
@@ -100,7 +153,7 @@ public:
 	void Read(uint64_t offset, size_t size);
 
 	/**
-	 * Cancel the most recent Read() call.
+	 * Cancel all pending Read() calls.
 	 *
 	 * This method is not thread-safe and must be called from
 	 * within the I/O thread.
@@ -111,6 +164,21 @@ public:
 		return state == State::IDLE;
 	}
 
+	/**
+	 * Returns the number of pending Read() calls.
+	 */
+	std::size_t GetPendingReads() const noexcept {
+		return reads.size();
+	}
+
+	/**
+	 * Returns the number of bytes requested by all pending
+	 * Read() calls.
+	 */
+	std::size_t GetPendingBytes() const noexcept {
+		return pending_bytes;
+	}
+
 protected:
 	/**
 	 * The file has been opened successfully.  It is a regular
@@ -145,6 +213,22 @@ private:
 	void OpenCallback(nfsfh *_fh) noexcept;
 	void StatCallback(const struct stat *st) noexcept;
 
+	/**
+	 * Cancel all #reads and remove them from the list.
+	 */
+	void CancelReads() noexcept;
+
+	/**
+	 * Deliver the completed requests at the front of #reads to
+	 * OnNfsFileRead().
+	 */
+	void FlushReads() noexcept;
+
+	void OnReadDone(ReadRequest &request, unsigned status,
+			const void *data) noexcept;
+	void OnReadError(ReadRequest &request,
+			 std::exception_ptr &&e) noexcept;
+
 	/* virtual methods from NfsLease */
 	void OnNfsConnectionReady() noexcept final;
 	void OnNfsConnectionFailed(std::exception_ptr e) noexcept final;
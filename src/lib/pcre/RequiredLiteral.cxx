@@ -0,0 +1,179 @@
+/*
+ * Copyright 2007-2022 CM4all GmbH
+ * All rights reserved.
+ *
+ * author: Max Kellermann <mk@cm4all.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "RequiredLiteral.hxx"
+#include "util/CharUtil.hxx"
+
+namespace Pcre {
+
+/**
+ * Does the escape sequence starting with this character take
+ * arguments (e.g. "\x41" or "\p{L}") which this parser doesn't
+ * understand?
+ */
+static constexpr bool
+IsComplexEscape(char ch) noexcept
+{
+	switch (ch) {
+	case 'x':
+	case 'o':
+	case 'c':
+	case 'p':
+	case 'P':
+	case 'g':
+	case 'k':
+	case 'N':
+	case 'Q':
+	case 'E':
+		return true;
+
+	default:
+		return IsDigitASCII(ch);
+	}
+}
+
+std::string
+FindRequiredLiteral(std::string_view pattern) noexcept
+{
+	/* alternatives, inline options (e.g. "(?i)" or "(?x)") and
+	   quoted sequences are too complicated for this parser */
+	if (pattern.find('|') != pattern.npos ||
+	    pattern.find("(?") != pattern.npos ||
+	    pattern.find("\\Q") != pattern.npos)
+		return {};
+
+	std::string best, current;
+
+	/* the group nesting level; literals inside groups are
+	   ignored, because the group may be optional */
+	unsigned depth = 0;
+
+	const auto end_run = [&best, &current](){
+		if (current.size() > best.size())
+			best = current;
+		current.clear();
+	};
+
+	const std::size_t size = pattern.size();
+	for (std::size_t i = 0; i < size;) {
+		char ch = pattern[i++];
+
+		switch (ch) {
+		case '(':
+			end_run();
+			++depth;
+			continue;
+
+		case ')':
+			if (depth > 0)
+				--depth;
+			continue;
+
+		case '[':
+			/* skip the character class */
+			end_run();
+
+			if (i < size && pattern[i] == '^')
+				++i;
+			if (i < size && pattern[i] == ']')
+				++i;
+
+			while (i < size && pattern[i] != ']') {
+				if (pattern[i] == '\\')
+					++i;
+				++i;
+			}
+
+			++i;
+			continue;
+
+		case '.':
+		case '^':
+		case '$':
+			end_run();
+			continue;
+
+		case '*':
+		case '?':
+		case '{':
+			/* the previous character may be omitted */
+			if (!current.empty())
+				current.pop_back();
+			end_run();
+
+			if (ch == '{') {
+				/* skip the repetition count */
+				while (i < size && pattern[i] != '}')
+					++i;
+				++i;
+			}
+
+			continue;
+
+		case '+':
+			/* the previous character is required, but
+			   it may be repeated */
+			end_run();
+			continue;
+
+		case '\\':
+			if (i >= size)
+				return {};
+
+			ch = pattern[i++];
+			if (IsComplexEscape(ch)) {
+				/* stop parsing here; what we found so
+				   far is still valid */
+				end_run();
+				return best;
+			}
+
+			if (IsAlphaNumericASCII(ch)) {
+				/* a character type (e.g. "\d") or an
+				   assertion (e.g. "\b") */
+				end_run();
+				continue;
+			}
+
+			/* an escaped special character */
+			break;
+		}
+
+		if (depth == 0)
+			current.push_back(ch);
+	}
+
+	end_run();
+	return best;
+}
+
+} // namespace Pcre
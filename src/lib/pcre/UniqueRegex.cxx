@@ -31,10 +31,42 @@
  */
 
 #include "UniqueRegex.hxx"
+#include "RequiredLiteral.hxx"
 #include "Error.hxx"
 
 #include <stdio.h>
 
+namespace {
+
+/**
+ * A #pcre2_match_data_8 with room for just the whole match (no
+ * captures), to be shared by all UniqueRegex::Test() calls in one
+ * thread.
+ */
+class ThreadMatchData {
+	pcre2_match_data_8 *const match_data =
+		pcre2_match_data_create_8(1, nullptr);
+
+public:
+	ThreadMatchData() noexcept = default;
+
+	~ThreadMatchData() noexcept {
+		if (match_data != nullptr)
+			pcre2_match_data_free_8(match_data);
+	}
+
+	ThreadMatchData(const ThreadMatchData &) = delete;
+	ThreadMatchData &operator=(const ThreadMatchData &) = delete;
+
+	pcre2_match_data_8 *Get() const noexcept {
+		return match_data;
+	}
+};
+
+thread_local ThreadMatchData thread_match_data;
+
+} // anonymous namespace
+
 void
 UniqueRegex::Compile(const char *pattern, bool anchored, bool capture,
 		     bool caseless)
@@ -62,9 +94,38 @@ UniqueRegex::Compile(const char *pattern, bool anchored, bool capture,
 		throw Pcre::MakeError(error_number, msg);
 	}
 
-	pcre2_jit_compile_8(re, PCRE2_JIT_COMPLETE);
+	jit = pcre2_jit_compile_8(re, PCRE2_JIT_COMPLETE) == 0;
+
+	/* case-insensitive matching would need a case-insensitive
+	   substring search, so don't bother */
+	if (!caseless)
+		required_literal = Pcre::FindRequiredLiteral(pattern);
+	else
+		required_literal.clear();
 
 	if (int n; capture &&
 	    pcre2_pattern_info_8(re, PCRE2_INFO_CAPTURECOUNT, &n) == 0)
 		n_capture = n;
 }
+
+bool
+UniqueRegex::Test(std::string_view s) const noexcept
+{
+	if (!required_literal.empty() &&
+	    s.find(required_literal) == s.npos)
+		return false;
+
+	auto *match_data = thread_match_data.Get();
+	if (match_data == nullptr)
+		/* out of memory: fall back to the slow path */
+		return Match(s);
+
+	/* if the match data is too small for the captures, PCRE2
+	   returns 0; this is still a successful match */
+	const int n = jit
+		? pcre2_jit_match_8(re, (PCRE2_SPTR8)s.data(), s.size(),
+				    0, 0, match_data, nullptr)
+		: pcre2_match_8(re, (PCRE2_SPTR8)s.data(), s.size(),
+				0, 0, match_data, nullptr);
+	return n >= 0;
+}
@@ -34,9 +34,23 @@
 
 #include "RegexPointer.hxx"
 
+#include <string>
 #include <utility>
 
 class UniqueRegex : public RegexPointer {
+	/**
+	 * A string which occurs in all matching subjects (see
+	 * Pcre::FindRequiredLiteral()); used by Test() to skip the
+	 * regex engine for most non-matching subjects.  Empty if
+	 * there is none.
+	 */
+	std::string required_literal;
+
+	/**
+	 * Was the JIT compiler successful?
+	 */
+	bool jit = false;
+
 public:
 	UniqueRegex() = default;
 
@@ -45,7 +59,10 @@ public:
 		Compile(pattern, anchored, capture, caseless);
 	}
 
-	UniqueRegex(UniqueRegex &&src) noexcept:RegexPointer(src) {
+	UniqueRegex(UniqueRegex &&src) noexcept
+		:RegexPointer(src),
+		 required_literal(std::move(src.required_literal)),
+		 jit(src.jit) {
 		src.re = nullptr;
 	}
 
@@ -57,6 +74,8 @@ public:
 	UniqueRegex &operator=(UniqueRegex &&src) noexcept {
 		using std::swap;
 		swap<RegexPointer>(*this, src);
+		swap(required_literal, src.required_literal);
+		swap(jit, src.jit);
 		return *this;
 	}
 
@@ -65,4 +84,13 @@ public:
 	 */
 	void Compile(const char *pattern, bool anchored, bool capture,
 		     bool caseless);
+
+	/**
+	 * Check whether the given string matches, without obtaining
+	 * captures.  Unlike Match(), this does not allocate memory;
+	 * it uses a #pcre2_match_data_8 instance shared by all
+	 * regexes of the calling thread.
+	 */
+	[[gnu::pure]]
+	bool Test(std::string_view s) const noexcept;
 };
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Pool.hxx"
+
+SmbclientContextPool::Lease
+SmbclientContextPool::Get()
+{
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		if (!idle.empty()) {
+			Lease lease(*this, std::move(idle.front()));
+			idle.pop_front();
+			--n_idle;
+			return lease;
+		}
+	}
+
+	/* create the new context without holding the mutex, to
+	   allow other threads to use the pool meanwhile */
+	return {*this, SmbclientContext::New()};
+}
+
+void
+SmbclientContextPool::Put(SmbclientContext &&ctx) noexcept
+{
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		if (n_idle < max_idle) {
+			idle.emplace_front(std::move(ctx));
+			++n_idle;
+			return;
+		}
+	}
+
+	/* the pool is full: ctx is freed by its destructor */
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SMBCLIENT_POOL_HXX
+#define MPD_SMBCLIENT_POOL_HXX
+
+#include "Context.hxx"
+#include "thread/Mutex.hxx"
+
+#include <cstddef>
+#include <forward_list>
+
+/**
+ * A pool of #SmbclientContext instances.  A #SmbclientContext is not
+ * thread-safe, but different contexts may be used concurrently by
+ * different threads; this class allows reusing them instead of
+ * creating a new one (and a new connection to the server) for each
+ * operation.
+ */
+class SmbclientContextPool {
+	Mutex mutex;
+
+	/**
+	 * Contexts which are not currently in use.  Protected by
+	 * #mutex.
+	 */
+	std::forward_list<SmbclientContext> idle;
+
+	std::size_t n_idle = 0;
+
+	/**
+	 * Contexts returned to the pool are freed if there are
+	 * already this many idle ones.
+	 */
+	const std::size_t max_idle;
+
+public:
+	/**
+	 * Exclusive access to one #SmbclientContext; it is returned
+	 * to the pool by the destructor.
+	 */
+	class Lease {
+		SmbclientContextPool *pool;
+		SmbclientContext ctx;
+
+	public:
+		Lease(SmbclientContextPool &_pool,
+		      SmbclientContext &&_ctx) noexcept
+			:pool(&_pool), ctx(std::move(_ctx)) {}
+
+		Lease(Lease &&src) noexcept
+			:pool(std::exchange(src.pool, nullptr)),
+			 ctx(std::move(src.ctx)) {}
+
+		~Lease() noexcept {
+			if (pool != nullptr)
+				pool->Put(std::move(ctx));
+		}
+
+		Lease &operator=(Lease &&) = delete;
+
+		SmbclientContext &operator*() noexcept {
+			return ctx;
+		}
+
+		SmbclientContext *operator->() noexcept {
+			return &ctx;
+		}
+	};
+
+	explicit SmbclientContextPool(std::size_t _max_idle=8) noexcept
+		:max_idle(_max_idle) {}
+
+	SmbclientContextPool(const SmbclientContextPool &) = delete;
+	SmbclientContextPool &operator=(const SmbclientContextPool &) = delete;
+
+	/**
+	 * Obtain an idle context or create a new one.
+	 *
+	 * Throws on error.
+	 */
+	Lease Get();
+
+private:
+	void Put(SmbclientContext &&ctx) noexcept;
+};
+
+#endif
@@ -28,6 +28,7 @@
 #endif
 #include "Action.hxx"
 #include "util/IterableSplitString.hxx"
+#include "util/NumberParser.hxx"
 #include "util/UriRelative.hxx"
 #include "util/UriUtil.hxx"
 
@@ -101,3 +102,47 @@ ContentDirectoryService::getSearchCapabilities(UpnpClient_Handle hdl) const
 		result.emplace_front(i);
 	return result;
 }
+
+unsigned
+ContentDirectoryService::getSystemUpdateID(UpnpClient_Handle hdl) const
+{
+#ifdef USING_PUPNP
+	UniqueIxmlDocument request(UpnpMakeAction("GetSystemUpdateID", m_serviceType.c_str(),
+						  0,
+						  nullptr, nullptr));
+	if (!request)
+		throw std::runtime_error("UpnpMakeAction() failed");
+
+	IXML_Document *_response;
+	auto code = UpnpSendAction(hdl, m_actionURL.c_str(),
+				   m_serviceType.c_str(),
+				   nullptr /*devUDN*/, request.get(), &_response);
+	if (code != UPNP_E_SUCCESS)
+		throw Upnp::MakeError(code, "UpnpSendAction() failed");
+
+	UniqueIxmlDocument response(_response);
+
+	const char *s = ixmlwrap::getFirstElementValue(response.get(),
+						       "Id");
+#else
+	std::vector<std::pair<std::string, std::string>> responseData;
+	int errcode;
+	std::string errdesc;
+	auto code = UpnpSendAction(hdl, "", m_actionURL, m_serviceType,
+				   "GetSystemUpdateID", {}, responseData, &errcode,
+				   errdesc);
+	if (code != UPNP_E_SUCCESS)
+		throw Upnp::MakeError(code, "UpnpSendAction() failed");
+
+	const char *s{nullptr};
+	for (auto &entry : responseData) {
+		if (entry.first == "Id") {
+			s = entry.second.c_str();
+		}
+	}
+#endif
+	if (s == nullptr || *s == 0)
+		throw std::runtime_error("No SystemUpdateID in response");
+
+	return ParseUnsigned(s);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FlacHeader.hxx"
+#include "FlacAudioFormat.hxx"
+#include "ScanVorbisComment.hxx"
+#include "input/InputStream.hxx"
+#include "pcm/CheckAudioFormat.hxx"
+#include "tag/Handler.hxx"
+#include "tag/Id3Picture.hxx"
+#include "util/ByteOrder.hxx"
+#include "Chrono.hxx"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+/* the metadata block types defined by the FLAC format
+   specification */
+static constexpr unsigned FLAC_STREAMINFO = 0;
+static constexpr unsigned FLAC_VORBIS_COMMENT = 4;
+static constexpr unsigned FLAC_PICTURE = 6;
+
+static constexpr std::size_t FLAC_STREAMINFO_SIZE = 34;
+
+namespace {
+
+struct FlacMetadataBlock {
+	unsigned type;
+	std::vector<std::byte> data;
+
+	FlacMetadataBlock(unsigned _type, std::size_t size) noexcept
+		:type(_type), data(size) {}
+};
+
+} // anonymous namespace
+
+/**
+ * Skip an ID3v2 tag (if there is one) and check the "fLaC" marker.
+ */
+static bool
+ExpectFlacMarker(InputStream &is, std::unique_lock<Mutex> &lock)
+{
+	std::byte header[10];
+	is.ReadFull(lock, header, 4);
+
+	if (std::string_view{(const char *)header, 3} == "ID3"sv) {
+		is.ReadFull(lock, header + 4, sizeof(header) - 4);
+
+		/* the tag size is a 28 bit "syncsafe" integer */
+		std::size_t size = 0;
+		for (unsigned i = 6; i < 10; ++i) {
+			if ((header[i] & std::byte{0x80}) != std::byte{})
+				return false;
+
+			size = (size << 7) | std::size_t(header[i]);
+		}
+
+		if ((header[5] & std::byte{0x10}) != std::byte{})
+			/* footer present */
+			size += 10;
+
+		is.Skip(lock, size);
+		is.ReadFull(lock, header, 4);
+	}
+
+	return std::string_view{(const char *)header, 4} == "fLaC"sv;
+}
+
+static void
+ScanStreamInfo(std::span<const std::byte> src, TagHandler &handler) noexcept
+{
+	const auto *p = (const uint8_t *)src.data();
+
+	const unsigned sample_rate = (p[10] << 12) | (p[11] << 4) | (p[12] >> 4);
+	const unsigned channels = ((p[12] >> 1) & 0x7) + 1;
+	const unsigned bits_per_sample = (((p[12] & 0x1) << 4) | (p[13] >> 4)) + 1;
+	const uint64_t total_samples = (uint64_t(p[13] & 0xf) << 32) |
+		uint32_t(*(const PackedBE32 *)(const void *)(p + 14));
+
+	if (sample_rate > 0)
+		handler.OnDuration(SongTime::FromScale<uint64_t>(total_samples,
+								 sample_rate));
+
+	try {
+		handler.OnAudioFormat(CheckAudioFormat(sample_rate,
+						       FlacSampleFormat(bits_per_sample),
+						       channels));
+	} catch (...) {
+	}
+}
+
+static void
+ScanPicture(std::span<const std::byte> src, TagHandler &handler) noexcept
+{
+	/* the PICTURE block has the same layout as the ID3 "APIC"
+	   frame; only check for a URL (MIME type "-->") which
+	   ScanId3Apic() doesn't know */
+	if (src.size() >= 11 &&
+	    *(const PackedBE32 *)(const void *)(src.data() + 4) == 3 &&
+	    std::string_view{(const char *)src.data() + 8, 3} == "-->"sv)
+		return;
+
+	ScanId3Apic(src, handler);
+}
+
+bool
+ScanFlacHeader(InputStream &is, TagHandler &handler)
+{
+	std::vector<FlacMetadataBlock> blocks;
+	std::vector<std::byte> comment;
+	bool have_comment = false;
+
+	{
+		std::unique_lock lock{is.mutex};
+
+		if (!ExpectFlacMarker(is, lock))
+			return false;
+
+		bool last = false;
+		while (!last) {
+			std::byte header[4];
+			is.ReadFull(lock, header, sizeof(header));
+
+			last = (header[0] & std::byte{0x80}) != std::byte{};
+			const unsigned type = unsigned(header[0] & std::byte{0x7f});
+			const std::size_t size =
+				(std::size_t(header[1]) << 16) |
+				(std::size_t(header[2]) << 8) |
+				std::size_t(header[3]);
+
+			if (blocks.empty() != (type == FLAC_STREAMINFO) ||
+			    (type == FLAC_STREAMINFO &&
+			     size != FLAC_STREAMINFO_SIZE))
+				/* STREAMINFO must be the first block, and
+				   there must be only one */
+				return false;
+
+			if (type == 127)
+				/* invalid */
+				return false;
+
+			if (type == FLAC_VORBIS_COMMENT &&
+			    (handler.WantTag() || handler.WantPair() ||
+			     handler.WantPicture())) {
+				if (have_comment)
+					/* there must not be more than
+					   one */
+					return false;
+
+				have_comment = true;
+				comment.resize(size);
+				is.ReadFull(lock, comment.data(), size);
+			} else if (type == FLAC_STREAMINFO ||
+				   (type == FLAC_PICTURE &&
+				    handler.WantPicture())) {
+				auto &block = blocks.emplace_back(type, size);
+				is.ReadFull(lock, block.data.data(), size);
+			} else
+				is.Skip(lock, size);
+		}
+	}
+
+	/* the VORBIS_COMMENT block is the only one which may be
+	   malformed; ScanVorbisCommentBlock() doesn't invoke the
+	   handler in that case, so scan it first */
+	if (have_comment && !ScanVorbisCommentBlock(comment, handler))
+		return false;
+
+	for (const auto &block : blocks) {
+		switch (block.type) {
+		case FLAC_STREAMINFO:
+			ScanStreamInfo(block.data, handler);
+			break;
+
+		case FLAC_PICTURE:
+			ScanPicture(block.data, handler);
+			break;
+		}
+	}
+
+	return true;
+}
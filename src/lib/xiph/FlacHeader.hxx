@@ -0,0 +1,45 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FLAC_HEADER_HXX
+#define MPD_FLAC_HEADER_HXX
+
+class InputStream;
+class TagHandler;
+
+/**
+ * Scan the metadata blocks at the beginning of a native FLAC file
+ * without libFLAC.  Only the blocks which are interesting to the
+ * #TagHandler are loaded into memory (STREAMINFO, VORBIS_COMMENT and
+ * PICTURE); all others are skipped (if the stream is seekable).  An
+ * ID3v2 tag in front of the "fLaC" marker is skipped.
+ *
+ * Nothing is passed to the #TagHandler unless all metadata blocks
+ * have been parsed successfully, so the caller may fall back to
+ * libFLAC if this function returns false.
+ *
+ * Throws on I/O error.
+ *
+ * @return true on success, false if this is not a (supported) FLAC
+ * file
+ */
+bool
+ScanFlacHeader(InputStream &is, TagHandler &handler);
+
+#endif
@@ -57,7 +57,7 @@ OggSeekPageAtOffset(OggSyncState &oy, ogg_stream_state &os, InputStream &is,
 
 bool
 OggSeekFindEOS(OggSyncState &oy, ogg_stream_state &os, ogg_packet &packet,
-	       InputStream &is, bool synced)
+	       InputStream &is, bool synced, bool expensive_seek)
 {
 	if (!is.KnownSize())
 		return false;
@@ -66,7 +66,7 @@ OggSeekFindEOS(OggSyncState &oy, ogg_stream_state &os, ogg_packet &packet,
 		return (synced || oy.ExpectPageSeekIn(os)) &&
 			OggFindEOS(oy, os, packet);
 
-	if (!is.CheapSeeking())
+	if (expensive_seek ? !is.IsSeekable() : !is.CheapSeeking())
 		return false;
 
 	return OggSeekPageAtOffset(oy, os, is, is.GetSize() - 65536) &&
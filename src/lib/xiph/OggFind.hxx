@@ -50,10 +50,13 @@ OggSeekPageAtOffset(OggSyncState &oy, ogg_stream_state &os, InputStream &is,
  * @param synced is the #OggSyncState currently synced?  If not, then
  * we need to use ogg_sync_pageseek() instead of ogg_sync_pageout(),
  * which is more expensive
+ * @param expensive_seek seek to the end even if the stream does
+ * not support cheap seeking (e.g. with a HTTP range request)
  * @return true if the EOS packet was found
  */
 bool
 OggSeekFindEOS(OggSyncState &oy, ogg_stream_state &os, ogg_packet &packet,
-	       InputStream &is, bool synced=true);
+	       InputStream &is, bool synced=true,
+	       bool expensive_seek=false);
 
 #endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "OggPacketReader.hxx"
+#include "OggSyncState.hxx"
+
+#include <algorithm>
+
+#include <string.h>
+
+bool
+OggPacketReader::NextPage()
+{
+	do {
+		if (!sync.ExpectPage(page))
+			return false;
+	} while (ogg_page_serialno(&page) != serialno);
+
+	/* the first page must begin with this packet, and all
+	   following ones must continue it */
+	if ((ogg_page_continued(&page) != 0) == first_page)
+		return false;
+
+	first_page = false;
+	segment = 0;
+	n_segments = page.header[26];
+	body = page.body;
+	return true;
+}
+
+bool
+OggPacketReader::Fill()
+{
+	while (remaining == 0) {
+		if (last)
+			return false;
+
+		while (segment >= n_segments)
+			if (!NextPage())
+				return false;
+
+		const unsigned lacing = page.header[27 + segment++];
+		data = body;
+		remaining = lacing;
+		body += lacing;
+
+		/* a segment shorter than 255 bytes terminates the
+		   packet */
+		last = lacing < 255;
+	}
+
+	return true;
+}
+
+std::size_t
+OggPacketReader::Read(void *dest, std::size_t size)
+{
+	if (!Fill())
+		return 0;
+
+	const std::size_t nbytes = std::min(size, remaining);
+	memcpy(dest, data, nbytes);
+	data += nbytes;
+	remaining -= nbytes;
+	return nbytes;
+}
+
+bool
+OggPacketReader::ReadFull(void *dest, std::size_t size)
+{
+	auto *p = (unsigned char *)dest;
+
+	while (size > 0) {
+		const std::size_t nbytes = Read(p, size);
+		if (nbytes == 0)
+			return false;
+
+		p += nbytes;
+		size -= nbytes;
+	}
+
+	return true;
+}
+
+bool
+OggPacketReader::ReadLE32(uint32_t &value)
+{
+	unsigned char buffer[4];
+	if (!ReadFull(buffer, sizeof(buffer)))
+		return false;
+
+	value = buffer[0] | (buffer[1] << 8) |
+		(buffer[2] << 16) | (uint32_t(buffer[3]) << 24);
+	return true;
+}
+
+bool
+OggPacketReader::Skip(std::size_t size)
+{
+	while (size > 0) {
+		if (!Fill())
+			return false;
+
+		const std::size_t nbytes = std::min(size, remaining);
+		data += nbytes;
+		remaining -= nbytes;
+		size -= nbytes;
+	}
+
+	return true;
+}
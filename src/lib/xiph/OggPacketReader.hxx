@@ -0,0 +1,112 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OGG_PACKET_READER_HXX
+#define MPD_OGG_PACKET_READER_HXX
+
+#include "io/Reader.hxx"
+
+#include <ogg/ogg.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class OggSyncState;
+
+/**
+ * Reads one packet of an Ogg stream incrementally, page by page.
+ * Unlike ogg_stream_packetout(), this does not assemble the whole
+ * packet in memory, and skipped parts are never copied.  This is
+ * useful for large header packets (e.g. Vorbis comments with
+ * embedded pictures) of which only small parts are interesting.
+ *
+ * The packet must begin at the start of the next page of the given
+ * logical stream (which is the case for the comment headers of
+ * Vorbis and Opus).  These pages are not passed to the stream's
+ * #ogg_stream_state.
+ */
+class OggPacketReader final : public Reader {
+	OggSyncState &sync;
+
+	const long serialno;
+
+	ogg_page page;
+
+	/**
+	 * The index of the next segment in the lacing table of
+	 * #page and the number of segments.
+	 */
+	unsigned segment = 0, n_segments = 0;
+
+	/**
+	 * The start of the next segment in the body of #page.
+	 */
+	const unsigned char *body;
+
+	/**
+	 * The unread part of the current segment.
+	 */
+	const unsigned char *data;
+	std::size_t remaining = 0;
+
+	/**
+	 * Is the current segment the last one of the packet?
+	 */
+	bool last = false;
+
+	bool first_page = true;
+
+public:
+	OggPacketReader(OggSyncState &_sync, long _serialno) noexcept
+		:sync(_sync), serialno(_serialno) {}
+
+	/**
+	 * Read exactly the given number of bytes.
+	 *
+	 * @return false if the packet ends prematurely
+	 */
+	bool ReadFull(void *dest, std::size_t size);
+
+	/**
+	 * Read a 32 bit little-endian integer.
+	 */
+	bool ReadLE32(uint32_t &value);
+
+	/**
+	 * Skip the given number of bytes without copying them.
+	 *
+	 * @return false if the packet ends prematurely
+	 */
+	bool Skip(std::size_t size);
+
+	/* virtual methods from class Reader */
+	std::size_t Read(void *dest, std::size_t size) override;
+
+private:
+	/**
+	 * Make sure that #remaining is non-zero.
+	 *
+	 * @return false if the end of the packet has been reached
+	 */
+	bool Fill();
+
+	bool NextPage();
+};
+
+#endif
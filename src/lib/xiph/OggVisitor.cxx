@@ -112,10 +112,17 @@ OggVisitor::PostSeek(uint64_t offset)
 ogg_int64_t
 OggVisitor::ReadGranulepos() noexcept
 {
-	ogg_packet packet;
-	while (stream.PacketOut(packet) == 1)
-		if (packet.granulepos >= 0)
-			return packet.granulepos;
-
-	return -1;
+	/* a page may contain only a fragment of a large packet
+	   without a granulepos; give up after a few pages */
+	static constexpr unsigned MAX_PAGES = 4;
+
+	for (unsigned i = 0;; ++i) {
+		ogg_packet packet;
+		while (stream.PacketOut(packet) == 1)
+			if (packet.granulepos >= 0)
+				return packet.granulepos;
+
+		if (i >= MAX_PAGES || !sync.ExpectPageIn(stream))
+			return -1;
+	}
 }
@@ -69,7 +69,9 @@ public:
 	/**
 	 * Skip packets (#ogg_packet) from the #OggStreamState until a
 	 * packet with a valid granulepos is found or until the stream
-	 * has run dry.
+	 * has run dry.  If the current page has no such packet, a few
+	 * more pages are read; GetStartOffset() then refers to the
+	 * page which completed the packet.
 	 *
 	 * Since this will discard pending packets and will disturb
 	 * this object, this should only be used while seeking.
@@ -18,12 +18,17 @@
  */
 
 #include "ScanVorbisComment.hxx"
+#include "VorbisPicture.hxx"
 #include "XiphTags.hxx"
 #include "tag/Table.hxx"
 #include "tag/Handler.hxx"
 #include "tag/VorbisComment.hxx"
+#include "util/ByteOrder.hxx"
 #include "util/StringSplit.hxx"
 
+#include <cstdint>
+#include <vector>
+
 /**
  * Check if the comment's name equals the passed name, and if so, copy
  * the comment value into the tag.
@@ -62,3 +67,64 @@ ScanVorbisComment(std::string_view comment, TagHandler &handler) noexcept
 					handler))
 			return;
 }
+
+/**
+ * Read a length-prefixed string and advance the #src pointer.
+ *
+ * @return the string or a nullptr string_view on error
+ */
+static std::string_view
+ReadVorbisString(std::span<const std::byte> &src) noexcept
+{
+	if (src.size() < 4)
+		return {};
+
+	const std::size_t length = *(const PackedLE32 *)(const void *)src.data();
+	src = src.subspan(4);
+	if (src.size() < length)
+		return {};
+
+	const std::string_view result{(const char *)src.data(), length};
+	src = src.subspan(length);
+	return result;
+}
+
+bool
+ScanVorbisCommentBlock(std::span<const std::byte> src,
+		       TagHandler &handler) noexcept
+{
+	/* vendor string */
+	if (ReadVorbisString(src).data() == nullptr || src.size() < 4)
+		return false;
+
+	uint32_t n = *(const PackedLE32 *)(const void *)src.data();
+	src = src.subspan(4);
+
+	/* each comment needs at least 4 bytes, which limits the
+	   allocation below */
+	if (n > src.size() / 4)
+		return false;
+
+	std::vector<std::string_view> comments;
+	comments.reserve(n);
+
+	while (n-- > 0) {
+		const auto comment = ReadVorbisString(src);
+		if (comment.data() == nullptr)
+			return false;
+
+		comments.push_back(comment);
+	}
+
+	for (const auto comment : comments) {
+		const auto picture_b64 = handler.WantPicture()
+			? GetVorbisCommentValue(comment, "METADATA_BLOCK_PICTURE")
+			: std::string_view{};
+		if (picture_b64.data() != nullptr)
+			ScanVorbisPicture(picture_b64, handler);
+		else
+			ScanVorbisComment(comment, handler);
+	}
+
+	return true;
+}
@@ -20,6 +20,8 @@
 #ifndef MPD_SCAN_VORBIS_COMMENT_HXX
 #define MPD_SCAN_VORBIS_COMMENT_HXX
 
+#include <cstddef>
+#include <span>
 #include <string_view>
 
 class TagHandler;
@@ -27,4 +29,18 @@ class TagHandler;
 void
 ScanVorbisComment(std::string_view comment, TagHandler &handler) noexcept;
 
+/**
+ * Parse a raw Vorbis comment block (vendor string, followed by a
+ * list of length-prefixed comments, all little-endian) as found in
+ * the Vorbis comment header packet and in the FLAC VORBIS_COMMENT
+ * metadata block, and pass all comments (including
+ * "METADATA_BLOCK_PICTURE") to the #TagHandler.
+ *
+ * @return false if the block is malformed; in that case, nothing
+ * has been passed to the #TagHandler
+ */
+bool
+ScanVorbisCommentBlock(std::span<const std::byte> src,
+		       TagHandler &handler) noexcept;
+
 #endif
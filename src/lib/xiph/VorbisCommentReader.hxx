@@ -0,0 +1,112 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_VORBIS_COMMENT_READER_HXX
+#define MPD_VORBIS_COMMENT_READER_HXX
+
+#include "OggPacketReader.hxx"
+#include "tag/VorbisComment.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Append the given number of bytes from the packet to the string.
+ * The string grows in small steps, so a bogus length does not
+ * allocate more memory than the packet really contains.
+ *
+ * @return false if the packet ends prematurely
+ */
+inline bool
+ReadAppend(OggPacketReader &reader, std::string &dest, std::size_t size)
+{
+	while (size > 0) {
+		const std::size_t old_size = dest.size();
+		const std::size_t nbytes = std::min<std::size_t>(size, 65536);
+		dest.resize(old_size + nbytes);
+		if (!reader.ReadFull(dest.data() + old_size, nbytes))
+			return false;
+
+		size -= nbytes;
+	}
+
+	return true;
+}
+
+/**
+ * Read a Vorbis comment block (after the codec specific magic
+ * prefix) incrementally from an Ogg packet and invoke the given
+ * function for each comment.
+ *
+ * Unless #want_pictures is set, "METADATA_BLOCK_PICTURE" comments
+ * are skipped without copying them, which saves a lot of work for
+ * files with large embedded cover art.
+ *
+ * @return false if the block is malformed
+ */
+template<typename F>
+bool
+ReadVorbisComments(OggPacketReader &reader, bool want_pictures, F &&f)
+{
+	static constexpr std::string_view picture_prefix =
+		"METADATA_BLOCK_PICTURE=";
+
+	/* vendor string */
+	uint32_t length, n;
+	if (!reader.ReadLE32(length) || !reader.Skip(length) ||
+	    !reader.ReadLE32(n))
+		return false;
+
+	std::string comment;
+
+	while (n-- > 0) {
+		if (!reader.ReadLE32(length))
+			return false;
+
+		/* read the beginning first to check the name */
+		std::size_t head = length;
+		if (!want_pictures && head > picture_prefix.size())
+			head = picture_prefix.size();
+
+		comment.clear();
+		if (!ReadAppend(reader, comment, head))
+			return false;
+
+		if (head < length) {
+			if (GetVorbisCommentValue(comment,
+						  "METADATA_BLOCK_PICTURE").data() != nullptr) {
+				if (!reader.Skip(length - head))
+					return false;
+
+				continue;
+			}
+
+			if (!ReadAppend(reader, comment, length - head))
+				return false;
+		}
+
+		f(std::string_view{comment});
+	}
+
+	return true;
+}
+
+#endif
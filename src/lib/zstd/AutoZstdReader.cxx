@@ -0,0 +1,64 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "AutoZstdReader.hxx"
+#include "ZstdReader.hxx"
+
+#include <cassert>
+#include <cstdint>
+
+AutoZstdReader::AutoZstdReader(Reader &_next) noexcept
+	:peek(_next) {}
+
+AutoZstdReader::~AutoZstdReader() noexcept = default;
+
+[[gnu::pure]]
+static bool
+IsZstd(const uint8_t data[4]) noexcept
+{
+	/* ZSTD_MAGICNUMBER in little-endian byte order */
+	return data[0] == 0x28 && data[1] == 0xb5 &&
+		data[2] == 0x2f && data[3] == 0xfd;
+}
+
+inline void
+AutoZstdReader::Detect()
+{
+	const auto *data = (const uint8_t *)peek.Peek(4);
+	if (data == nullptr) {
+		next = &peek;
+		return;
+	}
+
+	if (IsZstd(data))
+		next = (zstd = std::make_unique<ZstdReader>(peek)).get();
+	else
+		next = &peek;
+}
+
+size_t
+AutoZstdReader::Read(void *data, size_t size)
+{
+	if (next == nullptr)
+		Detect();
+
+	assert(next != nullptr);
+	return next->Read(data, size);
+}
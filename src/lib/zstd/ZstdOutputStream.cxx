@@ -0,0 +1,92 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "ZstdOutputStream.hxx"
+#include "Error.hxx"
+
+#include <new>
+
+ZstdOutputStream::ZstdOutputStream(OutputStream &_next, int level,
+				   unsigned n_threads)
+	:next(_next), cctx(ZSTD_createCCtx())
+{
+	if (cctx == nullptr)
+		throw std::bad_alloc{};
+
+	std::size_t result = ZSTD_CCtx_setParameter(cctx,
+						     ZSTD_c_compressionLevel,
+						     level);
+	if (ZSTD_isError(result)) {
+		ZSTD_freeCCtx(cctx);
+		throw ZstdError(result);
+	}
+
+	if (n_threads > 0)
+		/* this fails if libzstd was built without
+		   ZSTD_MULTITHREAD; compress in this thread then */
+		ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, n_threads);
+}
+
+ZstdOutputStream::~ZstdOutputStream() noexcept
+{
+	ZSTD_freeCCtx(cctx);
+}
+
+void
+ZstdOutputStream::Finish()
+{
+	ZSTD_inBuffer in{nullptr, 0, 0};
+
+	while (true) {
+		std::byte output[65536];
+		ZSTD_outBuffer out{output, sizeof(output), 0};
+
+		const std::size_t remaining =
+			ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_end);
+		if (ZSTD_isError(remaining))
+			throw ZstdError(remaining);
+
+		if (out.pos > 0)
+			next.Write(output, out.pos);
+
+		if (remaining == 0)
+			break;
+	}
+}
+
+void
+ZstdOutputStream::Write(const void *data, std::size_t size)
+{
+	ZSTD_inBuffer in{data, size, 0};
+
+	while (in.pos < in.size) {
+		std::byte output[65536];
+		ZSTD_outBuffer out{output, sizeof(output), 0};
+
+		const std::size_t result =
+			ZSTD_compressStream2(cctx, &out, &in,
+					     ZSTD_e_continue);
+		if (ZSTD_isError(result))
+			throw ZstdError(result);
+
+		if (out.pos > 0)
+			next.Write(output, out.pos);
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "ZstdReader.hxx"
+#include "Error.hxx"
+
+#include <cassert>
+#include <new>
+#include <stdexcept>
+
+ZstdReader::ZstdReader(Reader &_next)
+	:next(_next), dctx(ZSTD_createDCtx())
+{
+	if (dctx == nullptr)
+		throw std::bad_alloc{};
+}
+
+ZstdReader::~ZstdReader() noexcept
+{
+	ZSTD_freeDCtx(dctx);
+}
+
+inline bool
+ZstdReader::FillBuffer()
+{
+	auto w = buffer.Write();
+	assert(!w.empty());
+
+	std::size_t nbytes = next.Read(w.data(), w.size());
+	if (nbytes == 0)
+		return false;
+
+	buffer.Append(nbytes);
+	return true;
+}
+
+std::size_t
+ZstdReader::Read(void *data, std::size_t size)
+{
+	ZSTD_outBuffer out{data, size, 0};
+
+	while (true) {
+		auto r = buffer.Read();
+		if (r.empty()) {
+			if (!FillBuffer()) {
+				if (pending != 0)
+					throw std::runtime_error("Truncated zstd stream");
+
+				return 0;
+			}
+
+			r = buffer.Read();
+		}
+
+		ZSTD_inBuffer in{r.data(), r.size(), 0};
+		pending = ZSTD_decompressStream(dctx, &out, &in);
+		if (ZSTD_isError(pending))
+			throw ZstdError(pending);
+
+		buffer.Consume(in.pos);
+
+		if (out.pos > 0)
+			return out.pos;
+	}
+}
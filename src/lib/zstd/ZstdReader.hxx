@@ -0,0 +1,66 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ZSTD_READER_HXX
+#define ZSTD_READER_HXX
+
+#include "io/Reader.hxx"
+#include "util/StaticFifoBuffer.hxx"
+
+#include <zstd.h>
+
+#include <cstddef>
+
+/**
+ * A filter that decompresses data using zstd.
+ */
+class ZstdReader final : public Reader {
+	Reader &next;
+
+	ZSTD_DCtx *const dctx;
+
+	/**
+	 * The return value of the last ZSTD_decompressStream() call;
+	 * zero means a frame has been completed.
+	 */
+	std::size_t pending = 0;
+
+	StaticFifoBuffer<std::byte, 65536> buffer;
+
+public:
+	/**
+	 * Construct the filter.
+	 *
+	 * Throws on error.
+	 */
+	explicit ZstdReader(Reader &_next);
+	~ZstdReader() noexcept;
+
+	ZstdReader(const ZstdReader &) = delete;
+	ZstdReader &operator=(const ZstdReader &) = delete;
+
+	/* virtual methods from class Reader */
+	std::size_t Read(void *data, std::size_t size) override;
+
+private:
+	bool FillBuffer();
+};
+
+#endif
@@ -0,0 +1,448 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Collect.hxx"
+#include "Writer.hxx"
+#include "Histogram.hxx"
+#include "Instance.hxx"
+#include "LogBackend.hxx"
+#include "Partition.hxx"
+#include "client/Config.hxx"
+#include "client/List.hxx"
+#include "client/Metrics.hxx"
+#include "command/AllCommands.hxx"
+#include "client/Thread.hxx"
+#include "db/DatabaseLock.hxx"
+#include "event/Profiler.hxx"
+#include "input/cache/Manager.hxx"
+#include "output/MultipleOutputs.hxx"
+#include "tag/Pool.hxx"
+#include "thread/Profile.hxx"
+#include "config.h"
+
+#ifdef ENABLE_DATABASE
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#endif
+
+#ifdef ENABLE_CURL
+#include "lib/curl/Metrics.hxx"
+#endif
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+static void
+WriteClientMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	w.Family("clients", "gauge", "Number of connected clients");
+	w.Sample("clients", {}, uint_least64_t(instance.client_list->size()));
+
+	w.Family("client_output_buffer_limit_bytes", "gauge",
+		 "The configured max_output_buffer_size");
+	w.Sample("client_output_buffer_limit_bytes", {},
+		 uint_least64_t(client_max_output_buffer_size));
+
+	w.Family("client_output_buffer_peak_bytes", "gauge",
+		 "The largest client output buffer fill level");
+	w.Sample("client_output_buffer_peak_bytes", {},
+		 uint_least64_t(client_output_metrics.peak.load(std::memory_order_relaxed)));
+
+	w.Family("client_output_buffer_overflows", "counter",
+		 "Responses which exceeded max_output_buffer_size");
+	w.Sample("client_output_buffer_overflows_total", {},
+		 client_output_metrics.overflows.load(std::memory_order_relaxed));
+
+	std::size_t memory_total = 0, memory_max = 0;
+	for (const auto &client : *instance.client_list) {
+		const std::size_t memory = client.GetMemoryUsage();
+		memory_total += memory;
+		memory_max = std::max(memory_max, memory);
+	}
+
+	w.Family("client_memory_bytes", "gauge",
+		 "Estimated memory occupied by all client connections");
+	w.Sample("client_memory_bytes", {}, uint_least64_t(memory_total));
+
+	w.Family("client_memory_max_bytes", "gauge",
+		 "Estimated memory occupied by the largest client connection");
+	w.Sample("client_memory_max_bytes", {}, uint_least64_t(memory_max));
+}
+
+static void
+WritePlayerMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	w.Family("player_pipe_chunks", "gauge",
+		 "Decoded chunks waiting to be played");
+	for (const auto &partition : instance.partitions)
+		w.Sample("player_pipe_chunks",
+			 MetricsWriter::Label("partition", partition.name),
+			 uint_least64_t(partition.pc.GetPipeChunks()));
+
+	w.Family("player_buffer_chunks", "gauge",
+		 "Capacity of the audio buffer in chunks");
+	for (const auto &partition : instance.partitions)
+		w.Sample("player_buffer_chunks",
+			 MetricsWriter::Label("partition", partition.name),
+			 uint_least64_t(partition.pc.GetBufferChunks()));
+
+	w.Family("player_start_latency_seconds", "histogram",
+		 "Time from starting or seeking until the first chunk is played");
+	for (const auto &partition : instance.partitions)
+		w.Histogram("player_start_latency_seconds",
+			    MetricsWriter::Label("partition", partition.name),
+			    partition.pc.GetStartLatency());
+}
+
+static void
+WriteOutputMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	struct Item {
+		std::string labels;
+		AudioOutputStats stats;
+	};
+
+	/* samples of one family must be contiguous, so obtain all
+	   stats first */
+	std::vector<Item> items;
+
+	for (const auto &partition : instance.partitions) {
+		const auto &outputs = partition.outputs;
+		for (unsigned i = 0, n = outputs.Size(); i != n; ++i) {
+			const auto &ao = outputs.Get(i);
+			items.push_back({
+				MetricsWriter::Label("partition", partition.name,
+						     "output", ao.GetName()),
+				ao.LockGetStats(),
+			});
+		}
+	}
+
+	w.Family("output_backlog_chunks", "gauge",
+		 "Chunks in the pipe which the output has not played yet");
+	for (const auto &i : items)
+		w.Sample("output_backlog_chunks", i.labels,
+			 uint_least64_t(i.stats.backlog));
+
+	w.Family("output_underruns", "counter",
+		 "Buffer underruns reported by the output");
+	for (const auto &i : items)
+		w.Sample("output_underruns_total", i.labels,
+			 uint_least64_t(i.stats.underruns));
+
+	w.Family("output_lag_skips", "counter",
+		 "How often the output skipped ahead because of \"max_lag\"");
+	for (const auto &i : items)
+		w.Sample("output_lag_skips_total", i.labels,
+			 uint_least64_t(i.stats.lag_skips));
+
+	w.Family("output_play_bytes", "counter",
+		 "Bytes played by the output");
+	for (const auto &i : items)
+		w.Sample("output_play_bytes_total", i.labels,
+			 i.stats.play_bytes);
+}
+
+static void
+WriteThreadWakeupMetrics(MetricsWriter &w) noexcept
+{
+	static constexpr std::pair<ThreadProfileType, const char *> threads[] = {
+		{ ThreadProfileType::DECODER, "decoder" },
+		{ ThreadProfileType::PLAYER, "player" },
+		{ ThreadProfileType::OUTPUT, "output" },
+	};
+
+	w.Family("thread_wakeups", "counter",
+		 "How often the playback threads were woken up");
+	for (const auto &[type, name] : threads)
+		w.Sample("thread_wakeups_total",
+			 MetricsWriter::Label("thread", name),
+			 GetThreadWakeups(type));
+}
+
+static void
+WriteTagPoolMetrics(MetricsWriter &w) noexcept
+{
+	const auto stats = tag_pool_get_stats(false);
+
+	w.Family("tag_pool_items", "gauge",
+		 "Distinct tag values in the tag pool");
+	w.Sample("tag_pool_items", {}, uint_least64_t(stats.n_slots));
+
+	w.Family("tag_pool_lookups", "counter", "Tag pool lookups");
+	w.Sample("tag_pool_lookups_total", {}, uint_least64_t(stats.lookups));
+
+	w.Family("tag_pool_hits", "counter",
+		 "Tag pool lookups which found an existing item");
+	w.Sample("tag_pool_hits_total", {}, uint_least64_t(stats.hits));
+}
+
+static void
+WriteDatabaseMetrics([[maybe_unused]] MetricsWriter &w,
+		     [[maybe_unused]] Instance &instance) noexcept
+{
+#ifdef ENABLE_DATABASE
+	const auto *db = dynamic_cast<const SimpleDatabase *>(instance.GetDatabase());
+	if (db == nullptr)
+		return;
+
+	const auto stats = db->GetArenaStats();
+
+	w.Family("db_arena_bytes", "gauge",
+		 "Memory of the database arena");
+	w.Sample("db_arena_bytes", MetricsWriter::Label("state", "allocated"),
+		 uint_least64_t(stats.size));
+	w.Sample("db_arena_bytes", MetricsWriter::Label("state", "used"),
+		 uint_least64_t(stats.used));
+
+	w.Family("db_arena_peak_bytes", "gauge",
+		 "Highest memory usage of the database arena");
+	w.Sample("db_arena_peak_bytes", {}, uint_least64_t(stats.peak));
+#endif
+}
+
+static void
+WriteUniqueTagsCacheMetrics([[maybe_unused]] MetricsWriter &w,
+			    [[maybe_unused]] Instance &instance) noexcept
+{
+#ifdef ENABLE_DATABASE
+	const auto &cache = instance.unique_tags_cache;
+
+	w.Family("list_cache_hits", "counter",
+		 "\"list\" commands which were answered from the cache");
+	w.Sample("list_cache_hits_total", {}, cache.GetHits());
+
+	w.Family("list_cache_misses", "counter",
+		 "\"list\" commands which had to walk the database");
+	w.Sample("list_cache_misses_total", {}, cache.GetMisses());
+
+	w.Family("list_cache_items", "gauge",
+		 "Results in the \"list\" cache");
+	w.Sample("list_cache_items", {}, uint_least64_t(cache.GetSize()));
+#endif
+}
+
+static void
+WriteInputCacheMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	auto *cache = instance.input_cache.get();
+	if (cache == nullptr)
+		return;
+
+	w.Family("input_cache_hits", "counter",
+		 "Songs which were found in the input cache");
+	w.Sample("input_cache_hits_total", {}, cache->GetHits());
+
+	w.Family("input_cache_misses", "counter",
+		 "Songs which were not found in the input cache");
+	w.Sample("input_cache_misses_total", {}, cache->GetMisses());
+
+	w.Family("input_cache_bytes", "gauge",
+		 "Total size of the input cache items");
+	w.Sample("input_cache_bytes", {},
+		 uint_least64_t(cache->GetTotalSize()));
+}
+
+static void
+WriteCurlMetrics([[maybe_unused]] MetricsWriter &w) noexcept
+{
+#ifdef ENABLE_CURL
+	w.Family("curl_transfers", "counter",
+		 "Finished CURL transfers");
+	w.Sample("curl_transfers_total", {},
+		 curl_metrics.transfers.load(std::memory_order_relaxed));
+
+	w.Family("curl_connects", "counter",
+		 "New connections established by CURL transfers");
+	w.Sample("curl_connects_total", {},
+		 curl_metrics.connects.load(std::memory_order_relaxed));
+
+	w.Family("curl_reused_connections", "counter",
+		 "CURL transfers which reused a cached connection");
+	w.Sample("curl_reused_connections_total", {},
+		 curl_metrics.reused.load(std::memory_order_relaxed));
+#endif
+}
+
+/**
+ * How many of the slowest handlers of each #EventLoop are exported?
+ */
+static constexpr std::size_t METRICS_EVENT_HANDLERS = 20;
+
+static void
+WriteEventLoopMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	struct Item {
+		std::string loop;
+		const EventLoopProfiler &profiler;
+		std::vector<std::pair<const void *, EventLoopProfiler::HandlerStats>> handlers;
+	};
+
+	std::vector<Item> items;
+
+	const auto add = [&items](std::string loop, const EventLoop &event_loop){
+		if (const auto *profiler = event_loop.GetProfiler())
+			items.push_back({
+				std::move(loop), *profiler,
+				profiler->GetSlowest(METRICS_EVENT_HANDLERS),
+			});
+	};
+
+	add("main", instance.event_loop);
+	add("io", instance.io_thread.GetEventLoop());
+	add("rtio", instance.rtio_thread.GetEventLoop());
+
+	unsigned i = 0;
+	for (auto &thread : instance.client_threads)
+		add(fmt::format("client/{}", i++), thread->GetEventLoop());
+
+	if (items.empty())
+		/* "event_loop_profile" is disabled */
+		return;
+
+	w.Family("event_loop_iteration_seconds", "histogram",
+		 "Busy time of each event loop iteration");
+	for (const auto &item : items)
+		w.Histogram("event_loop_iteration_seconds",
+			    MetricsWriter::Label("loop", item.loop),
+			    item.profiler.GetIterations());
+
+	using std::chrono::duration;
+
+	w.Family("event_loop_handler_seconds", "counter",
+		 "Time spent in the slowest event handlers");
+	for (const auto &item : items)
+		for (const auto &[handler, stats] : item.handlers)
+			w.Sample("event_loop_handler_seconds_total",
+				 MetricsWriter::Label("loop", item.loop,
+						      "handler",
+						      GetEventHandlerName(handler)),
+				 duration<double>(stats.total).count());
+
+	w.Family("event_loop_handler_calls", "counter",
+		 "Invocations of the slowest event handlers");
+	for (const auto &item : items)
+		for (const auto &[handler, stats] : item.handlers)
+			w.Sample("event_loop_handler_calls_total",
+				 MetricsWriter::Label("loop", item.loop,
+						      "handler",
+						      GetEventHandlerName(handler)),
+				 stats.count);
+
+	w.Family("event_loop_handler_max_seconds", "gauge",
+		 "The longest single invocation of the slowest event handlers");
+	for (const auto &item : items)
+		for (const auto &[handler, stats] : item.handlers)
+			w.Sample("event_loop_handler_max_seconds",
+				 MetricsWriter::Label("loop", item.loop,
+						      "handler",
+						      GetEventHandlerName(handler)),
+				 duration<double>(stats.max).count());
+}
+
+static void
+WriteCoarseTimerMetrics(MetricsWriter &w, Instance &instance) noexcept
+{
+	std::vector<std::pair<std::string, const TimerWheel::Stats *>> items;
+
+	const auto add = [&items](std::string loop, const EventLoop &event_loop){
+		items.emplace_back(std::move(loop),
+				   &event_loop.GetCoarseTimerStats());
+	};
+
+	add("main", instance.event_loop);
+	add("io", instance.io_thread.GetEventLoop());
+	add("rtio", instance.rtio_thread.GetEventLoop());
+
+	unsigned i = 0;
+	for (auto &thread : instance.client_threads)
+		add(fmt::format("client/{}", i++), thread->GetEventLoop());
+
+	const auto write = [&w, &items](const char *name, const char *help,
+					std::atomic<uint_least64_t> TimerWheel::Stats::*counter){
+		w.Family(name, "counter", help);
+
+		const auto sample_name = fmt::format("{}_total", name);
+		for (const auto &[loop, stats] : items)
+			w.Sample(sample_name,
+				 MetricsWriter::Label("loop", loop),
+				 (stats->*counter).load(std::memory_order_relaxed));
+	};
+
+	write("event_loop_timer_inserts",
+	      "Coarse timers linked into the timer wheel",
+	      &TimerWheel::Stats::inserted);
+	write("event_loop_timer_postponed",
+	      "Coarse timers rescheduled to a later time without relinking",
+	      &TimerWheel::Stats::postponed);
+	write("event_loop_timer_expired",
+	      "Coarse timers whose callback was invoked",
+	      &TimerWheel::Stats::expired);
+	write("event_loop_timer_cascaded",
+	      "Long coarse timers moved to the fine-grained timer wheel",
+	      &TimerWheel::Stats::cascaded);
+}
+
+std::string
+CollectMetrics(Instance &instance,
+	       const DurationMetric *event_loop_lag) noexcept
+{
+	MetricsWriter w;
+
+	WriteClientMetrics(w, instance);
+	command_write_metrics(w);
+
+	if (event_loop_lag != nullptr) {
+		w.Family("event_loop_lag_seconds", "histogram",
+			 "How late the main event loop runs timers");
+		w.Histogram("event_loop_lag_seconds", {}, *event_loop_lag);
+	}
+
+	WriteEventLoopMetrics(w, instance);
+	WriteCoarseTimerMetrics(w, instance);
+
+	w.Family("db_lock_wait_seconds", "histogram",
+		 "Time spent waiting for the contended database lock");
+	w.Histogram("db_lock_wait_seconds", {}, db_lock_wait);
+
+	WritePlayerMetrics(w, instance);
+	WriteOutputMetrics(w, instance);
+	WriteThreadWakeupMetrics(w);
+	WriteTagPoolMetrics(w);
+	WriteDatabaseMetrics(w, instance);
+	WriteUniqueTagsCacheMetrics(w, instance);
+	WriteInputCacheMetrics(w, instance);
+	WriteCurlMetrics(w);
+
+	const auto log_stats = GetLogStats();
+	w.Family("log_dropped_messages", "counter",
+		 "Log messages which were dropped");
+	w.Sample("log_dropped_messages_total",
+		 MetricsWriter::Label("reason", "queue_full"),
+		 log_stats.queue_dropped);
+	w.Sample("log_dropped_messages_total",
+		 MetricsWriter::Label("reason", "rate_limit"),
+		 log_stats.rate_dropped);
+
+	return w.Finish();
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_METRICS_HISTOGRAM_HXX
+#define MPD_METRICS_HISTOGRAM_HXX
+
+#include "output/Stats.hxx" // for Log2Histogram
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Like #Log2Histogram, but the buckets are atomic counters, so
+ * several threads may add values concurrently without locking.
+ */
+template<std::size_t N>
+class AtomicLog2Histogram {
+	std::array<std::atomic<uint_least64_t>, N> buckets{};
+
+public:
+	using Base = Log2Histogram<N>;
+
+	static constexpr std::size_t size() noexcept {
+		return N;
+	}
+
+	void Add(uint_least64_t value) noexcept {
+		buckets[Base::BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint_least64_t operator[](std::size_t i) const noexcept {
+		return buckets[i].load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * Counts durations (e.g. of a protocol command) with microsecond
+ * resolution, cheap enough for hot paths.
+ */
+struct DurationMetric {
+	std::atomic<uint_least64_t> count{0};
+
+	/**
+	 * The sum of all durations in microseconds.
+	 */
+	std::atomic<uint_least64_t> sum_us{0};
+
+	AtomicLog2Histogram<28> histogram;
+
+	void Add(std::chrono::steady_clock::duration d) noexcept {
+		const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+		const uint_least64_t value = us > 0 ? us : 0;
+
+		count.fetch_add(1, std::memory_order_relaxed);
+		sum_us.fetch_add(value, std::memory_order_relaxed);
+		histogram.Add(value);
+	}
+};
+
+#endif
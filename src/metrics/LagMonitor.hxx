@@ -0,0 +1,55 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_METRICS_LAG_MONITOR_HXX
+#define MPD_METRICS_LAG_MONITOR_HXX
+
+#include "Histogram.hxx"
+#include "event/FineTimerEvent.hxx"
+
+/**
+ * Measures how late the #EventLoop runs a periodic timer, which
+ * indicates how long other events are blocking it.
+ */
+class EventLoopLagMonitor final {
+	static constexpr Event::Duration INTERVAL = std::chrono::seconds(1);
+
+	FineTimerEvent timer;
+
+	DurationMetric lag;
+
+public:
+	explicit EventLoopLagMonitor(EventLoop &loop) noexcept
+		:timer(loop, BIND_THIS_METHOD(OnTimer)) {
+		timer.Schedule(INTERVAL);
+	}
+
+	const DurationMetric &GetLag() const noexcept {
+		return lag;
+	}
+
+private:
+	void OnTimer() noexcept {
+		lag.Add(Event::Clock::now() - timer.GetDue());
+		timer.Schedule(INTERVAL);
+	}
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Server.hxx"
+#include "Collect.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/SocketEvent.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/SocketError.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/DeleteDisposer.hxx"
+#include "util/StringCompare.hxx"
+
+#include <fmt/format.h>
+
+#include <string>
+
+/**
+ * Connections which have not completed within this duration are
+ * closed.
+ */
+static constexpr Event::Duration METRICS_TIMEOUT = std::chrono::seconds(30);
+
+/**
+ * Requests headers larger than this are rejected.
+ */
+static constexpr std::size_t METRICS_MAX_REQUEST = 8192;
+
+class MetricsServer::Connection final : public AutoUnlinkIntrusiveListHook {
+	MetricsServer &server;
+
+	SocketEvent event;
+
+	CoarseTimerEvent timeout_event;
+
+	/**
+	 * The request headers received so far, and later the
+	 * response being sent.
+	 */
+	std::string buffer;
+
+	/**
+	 * The number of response bytes which have already been sent.
+	 */
+	std::size_t position = 0;
+
+	bool responding = false;
+
+public:
+	Connection(MetricsServer &_server, UniqueSocketDescriptor fd) noexcept
+		:server(_server),
+		 event(_server.GetEventLoop(), BIND_THIS_METHOD(OnSocketReady),
+		       fd.Release()),
+		 timeout_event(_server.GetEventLoop(),
+			       BIND_THIS_METHOD(OnTimeout)) {
+		event.ScheduleRead();
+		timeout_event.Schedule(METRICS_TIMEOUT);
+	}
+
+	~Connection() noexcept {
+		event.Close();
+	}
+
+private:
+	void Destroy() noexcept {
+		delete this;
+	}
+
+	/**
+	 * @return false if the connection has been destroyed
+	 */
+	bool OnRead() noexcept;
+
+	/**
+	 * @return false if the connection has been destroyed
+	 */
+	bool OnWrite() noexcept;
+
+	void Respond(std::string_view request_line) noexcept;
+
+	void OnSocketReady(unsigned flags) noexcept;
+
+	void OnTimeout() noexcept {
+		Destroy();
+	}
+};
+
+inline void
+MetricsServer::Connection::Respond(std::string_view request_line) noexcept
+{
+	const char *status = "200 OK";
+	const char *content_type =
+		"application/openmetrics-text; version=1.0.0; charset=utf-8";
+	std::string body;
+
+	if (!request_line.starts_with("GET ")) {
+		status = "405 Method Not Allowed";
+		content_type = "text/plain";
+		body = "Method not allowed\n";
+	} else if (const auto path = request_line.substr(4);
+		   !path.starts_with("/metrics ") &&
+		   !path.starts_with("/metrics?")) {
+		status = "404 Not Found";
+		content_type = "text/plain";
+		body = "Not found\n";
+	} else
+		body = CollectMetrics(server.instance,
+				      &server.lag_monitor.GetLag());
+
+	buffer = fmt::format(FMT_STRING("HTTP/1.0 {}\r\n"
+					"Content-Type: {}\r\n"
+					"Content-Length: {}\r\n"
+					"Connection: close\r\n"
+					"\r\n"),
+			     status, content_type, body.size());
+	buffer += body;
+	position = 0;
+	responding = true;
+
+	event.CancelRead();
+	event.ScheduleWrite();
+}
+
+inline bool
+MetricsServer::Connection::OnRead() noexcept
+{
+	char data[2048];
+	const auto nbytes = event.GetSocket().Read(data, sizeof(data));
+	if (nbytes < 0) {
+		if (IsSocketErrorReceiveWouldBlock(GetSocketError()))
+			return true;
+
+		Destroy();
+		return false;
+	}
+
+	if (nbytes == 0) {
+		Destroy();
+		return false;
+	}
+
+	buffer.append(data, nbytes);
+
+	auto end = buffer.find("\r\n\r\n");
+	if (end == buffer.npos)
+		end = buffer.find("\n\n");
+
+	if (end == buffer.npos) {
+		if (buffer.size() > METRICS_MAX_REQUEST) {
+			Destroy();
+			return false;
+		}
+
+		/* wait for more */
+		return true;
+	}
+
+	const std::string_view headers{buffer};
+	const auto request_line = headers.substr(0, headers.find('\n'));
+	Respond(std::string{request_line});
+	return true;
+}
+
+inline bool
+MetricsServer::Connection::OnWrite() noexcept
+{
+	const auto nbytes = event.GetSocket().Write(buffer.data() + position,
+						    buffer.size() - position);
+	if (nbytes < 0) {
+		if (IsSocketErrorSendWouldBlock(GetSocketError()))
+			return true;
+
+		Destroy();
+		return false;
+	}
+
+	position += nbytes;
+	if (position >= buffer.size()) {
+		/* done */
+		Destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void
+MetricsServer::Connection::OnSocketReady(unsigned flags) noexcept
+{
+	if (flags & (SocketEvent::ERROR|SocketEvent::HANGUP)) {
+		Destroy();
+		return;
+	}
+
+	if (responding) {
+		if (flags & SocketEvent::WRITE)
+			OnWrite();
+	} else if (flags & SocketEvent::READ)
+		OnRead();
+}
+
+MetricsServer::MetricsServer(EventLoop &_loop, Instance &_instance) noexcept
+	:ServerSocket(_loop), instance(_instance),
+	 lag_monitor(_loop)
+{
+}
+
+MetricsServer::~MetricsServer() noexcept
+{
+	connections.clear_and_dispose(DeleteDisposer{});
+}
+
+void
+MetricsServer::OnAccept(UniqueSocketDescriptor fd,
+			[[maybe_unused]] SocketAddress address,
+			[[maybe_unused]] int uid) noexcept
+{
+	auto *c = new Connection(*this, std::move(fd));
+	connections.push_back(*c);
+}
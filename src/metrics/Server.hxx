@@ -0,0 +1,54 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_METRICS_SERVER_HXX
+#define MPD_METRICS_SERVER_HXX
+
+#include "LagMonitor.hxx"
+#include "event/ServerSocket.hxx"
+#include "util/IntrusiveList.hxx"
+
+struct Instance;
+
+/**
+ * A minimal HTTP server which answers "GET /metrics" with all
+ * metrics in the OpenMetrics text format, to be scraped by
+ * Prometheus.
+ */
+class MetricsServer final : public ServerSocket {
+	class Connection;
+
+	Instance &instance;
+
+	EventLoopLagMonitor lag_monitor;
+
+	IntrusiveList<Connection> connections;
+
+public:
+	MetricsServer(EventLoop &_loop, Instance &_instance) noexcept;
+	~MetricsServer() noexcept;
+
+private:
+	/* virtual methods from class ServerSocket */
+	void OnAccept(UniqueSocketDescriptor fd,
+		      SocketAddress address, int uid) noexcept override;
+};
+
+#endif
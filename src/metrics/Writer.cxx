@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Writer.hxx"
+#include "Histogram.hxx"
+
+#include <iterator>
+
+void
+MetricsWriter::Family(std::string_view name, std::string_view type,
+		      std::string_view help) noexcept
+{
+	fmt::format_to(std::back_inserter(buffer),
+		       FMT_STRING("# TYPE mpd_{} {}\n# HELP mpd_{} {}\n"),
+		       name, type, name, help);
+}
+
+static void
+WriteLabels(fmt::memory_buffer &buffer, std::string_view labels) noexcept
+{
+	if (!labels.empty())
+		fmt::format_to(std::back_inserter(buffer),
+			       FMT_STRING("{{{}}}"), labels);
+}
+
+void
+MetricsWriter::Sample(std::string_view name, std::string_view labels,
+		      uint_least64_t value) noexcept
+{
+	fmt::format_to(std::back_inserter(buffer), FMT_STRING("mpd_{}"), name);
+	WriteLabels(buffer, labels);
+	fmt::format_to(std::back_inserter(buffer), FMT_STRING(" {}\n"), value);
+}
+
+void
+MetricsWriter::Sample(std::string_view name, std::string_view labels,
+		      double value) noexcept
+{
+	fmt::format_to(std::back_inserter(buffer), FMT_STRING("mpd_{}"), name);
+	WriteLabels(buffer, labels);
+	fmt::format_to(std::back_inserter(buffer), FMT_STRING(" {}\n"), value);
+}
+
+void
+MetricsWriter::Histogram(std::string_view name, std::string_view labels,
+			 const DurationMetric &metric) noexcept
+{
+	const auto &h = metric.histogram;
+	using Base = std::remove_cvref_t<decltype(h)>::Base;
+	const std::string_view separator = labels.empty() ? "" : ",";
+
+	uint_least64_t cumulative = 0;
+	for (std::size_t i = 0; i < h.size() - 1; ++i) {
+		cumulative += h[i];
+
+		/* bucket i counts values up to LowerBound(i+1)-1
+		   microseconds */
+		const double le = double(Base::LowerBound(i + 1) - 1) / 1e6;
+		fmt::format_to(std::back_inserter(buffer),
+			       FMT_STRING("mpd_{}_bucket{{{}{}le=\"{}\"}} {}\n"),
+			       name, labels, separator, le, cumulative);
+	}
+
+	/* read the count after the buckets, so the +Inf bucket is
+	   never smaller than the others */
+	cumulative += h[h.size() - 1];
+	fmt::format_to(std::back_inserter(buffer),
+		       FMT_STRING("mpd_{}_bucket{{{}{}le=\"+Inf\"}} {}\n"),
+		       name, labels, separator, cumulative);
+
+	Sample(std::string{name} + "_sum", labels,
+	       double(metric.sum_us.load(std::memory_order_relaxed)) / 1e6);
+	Sample(std::string{name} + "_count", labels, cumulative);
+}
+
+std::string
+MetricsWriter::Finish() noexcept
+{
+	fmt::format_to(std::back_inserter(buffer), FMT_STRING("# EOF\n"));
+	return fmt::to_string(buffer);
+}
+
+std::string
+MetricsWriter::Label(std::string_view name, std::string_view value) noexcept
+{
+	std::string result{name};
+	result += "=\"";
+
+	for (const char ch : value) {
+		switch (ch) {
+		case '\\':
+			result += "\\\\";
+			break;
+
+		case '"':
+			result += "\\\"";
+			break;
+
+		case '\n':
+			result += "\\n";
+			break;
+
+		default:
+			result += ch;
+		}
+	}
+
+	result += '"';
+	return result;
+}
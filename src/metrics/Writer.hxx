@@ -0,0 +1,89 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_METRICS_WRITER_HXX
+#define MPD_METRICS_WRITER_HXX
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct DurationMetric;
+
+/**
+ * Generates the OpenMetrics text format (which is also understood by
+ * Prometheus).  All metric names get the "mpd_" prefix.
+ */
+class MetricsWriter {
+	fmt::memory_buffer buffer;
+
+public:
+	/**
+	 * Begin a new metric family.
+	 *
+	 * @param type "counter", "gauge" or "histogram"
+	 */
+	void Family(std::string_view name, std::string_view type,
+		    std::string_view help) noexcept;
+
+	/**
+	 * Emit one sample.
+	 *
+	 * @param labels a label set (without braces) built with
+	 * Label(); may be empty
+	 */
+	void Sample(std::string_view name, std::string_view labels,
+		    uint_least64_t value) noexcept;
+
+	void Sample(std::string_view name, std::string_view labels,
+		    double value) noexcept;
+
+	/**
+	 * Emit the samples of a histogram family, converting the
+	 * microsecond buckets to seconds.
+	 */
+	void Histogram(std::string_view name, std::string_view labels,
+		       const DurationMetric &metric) noexcept;
+
+	/**
+	 * Finish the exposition and return it.
+	 */
+	std::string Finish() noexcept;
+
+	/**
+	 * Build a label string like name="value", escaping the
+	 * value.
+	 */
+	[[gnu::pure]]
+	static std::string Label(std::string_view name,
+				 std::string_view value) noexcept;
+
+	[[gnu::pure]]
+	static std::string Label(std::string_view name,
+				 std::string_view value,
+				 std::string_view name2,
+				 std::string_view value2) noexcept {
+		return Label(name, value) + ',' + Label(name2, value2);
+	}
+};
+
+#endif
@@ -34,6 +34,10 @@
 int
 MixerMemento::GetVolume(const MultipleOutputs &outputs) noexcept
 {
+	if (pending_volume >= 0)
+		/* this will be applied soon */
+		return pending_volume;
+
 	if (last_hardware_volume >= 0 &&
 	    !hardware_volume_clock.CheckUpdate(std::chrono::seconds(1)))
 		/* throttle access to hardware mixers */
@@ -68,11 +72,28 @@ MixerMemento::SetVolume(MultipleOutputs &outputs, unsigned volume)
 {
 	assert(volume <= 100);
 
+	pending_volume = -1;
 	volume_software_set = volume;
 
 	SetHardwareVolume(outputs, volume);
 }
 
+void
+MixerMemento::SetPendingVolume(unsigned volume) noexcept
+{
+	assert(volume <= 100);
+
+	pending_volume = volume;
+}
+
+void
+MixerMemento::CommitPendingVolume(MultipleOutputs &outputs)
+{
+	assert(pending_volume >= 0);
+
+	SetVolume(outputs, pending_volume);
+}
+
 bool
 MixerMemento::LoadSoftwareVolumeState(const char *line, MultipleOutputs &outputs)
 {
@@ -36,6 +36,12 @@ class MixerMemento {
 	/** the age of #last_hardware_volume */
 	PeriodClock hardware_volume_clock;
 
+	/**
+	 * A volume level which was passed to SetPendingVolume() but
+	 * has not been applied yet; negative if there is none.
+	 */
+	int pending_volume = -1;
+
 public:
 	/**
 	 * Flush the hardware volume cache.
@@ -54,6 +60,26 @@ public:
 	 */
 	void SetVolume(MultipleOutputs &outputs, unsigned volume);
 
+	bool HasPendingVolume() const noexcept {
+		return pending_volume >= 0;
+	}
+
+	/**
+	 * Remember a volume level, to be applied later by
+	 * CommitPendingVolume().  Until then, GetVolume() returns
+	 * this value.
+	 */
+	void SetPendingVolume(unsigned volume) noexcept;
+
+	/**
+	 * Apply the level passed to SetPendingVolume().
+	 *
+	 * Throws on error.
+	 *
+	 * Note: the caller is responsible for emitting #IDLE_MIXER.
+	 */
+	void CommitPendingVolume(MultipleOutputs &outputs);
+
 	bool LoadSoftwareVolumeState(const char *line, MultipleOutputs &outputs);
 
 	void SaveSoftwareVolumeState(BufferedOutputStream &os) const;
@@ -25,8 +25,12 @@
 #include "neighbor/Explorer.hxx"
 #include "neighbor/Listener.hxx"
 #include "neighbor/Info.hxx"
+#include "event/InjectEvent.hxx"
+#include "thread/Mutex.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 class UpnpNeighborExplorer final
 	: public NeighborExplorer, UPnPDiscoveryListener {
 	struct Server {
@@ -55,10 +59,28 @@ class UpnpNeighborExplorer final
 
 	UPnPDeviceDirectory *discovery;
 
+	/**
+	 * Refreshes #list (expiring stale devices and searching for
+	 * new ones) in the I/O thread.  It is scheduled by GetList(),
+	 * which itself only returns the cached #list, so a client
+	 * never waits for the #UPnPDeviceDirectory.
+	 */
+	mutable InjectEvent refresh_event;
+
+	mutable Mutex mutex;
+
+	/**
+	 * The known neighbors.  It is updated by FoundUPnP() and
+	 * LostUPnP() as soon as the discovery reports a change, and
+	 * by OnRefresh().  Protected by #mutex.
+	 */
+	List list;
+
 public:
 	UpnpNeighborExplorer(EventLoop &_event_loop,
 			     NeighborListener &_listener)
-		:NeighborExplorer(_listener), event_loop(_event_loop) {}
+		:NeighborExplorer(_listener), event_loop(_event_loop),
+		 refresh_event(_event_loop, BIND_THIS_METHOD(OnRefresh)) {}
 
 	/* virtual methods from class NeighborExplorer */
 	void Open() override;
@@ -66,6 +88,9 @@ public:
 	[[nodiscard]] List GetList() const noexcept override;
 
 private:
+	/* InjectEvent callback */
+	void OnRefresh() noexcept;
+
 	/* virtual methods from class UPnPDiscoveryListener */
 	void FoundUPnP(const ContentDirectoryService &service) override;
 	void LostUPnP(const ContentDirectoryService &service) override;
@@ -90,12 +115,24 @@ UpnpNeighborExplorer::Open()
 void
 UpnpNeighborExplorer::Close() noexcept
 {
+	refresh_event.Cancel();
 	delete discovery;
 	UpnpClientGlobalFinish();
 }
 
 NeighborExplorer::List
 UpnpNeighborExplorer::GetList() const noexcept
+{
+	/* expire stale devices in the background; the result will
+	   be visible to the next caller */
+	refresh_event.Schedule();
+
+	const std::scoped_lock<Mutex> protect(mutex);
+	return list;
+}
+
+void
+UpnpNeighborExplorer::OnRefresh() noexcept
 {
 	std::vector<ContentDirectoryService> tmp;
 
@@ -103,18 +140,45 @@ UpnpNeighborExplorer::GetList() const noexcept
 		tmp = discovery->GetDirectories();
 	} catch (...) {
 		LogError(std::current_exception());
+		return;
 	}
 
-	List result;
+	List new_list;
 	for (const auto &i : tmp)
-		result.emplace_front(i.GetURI(), i.getFriendlyName());
-	return result;
+		new_list.emplace_front(i.GetURI(), i.getFriendlyName());
+
+	List lost;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+
+		for (auto &i : list)
+			if (std::none_of(new_list.begin(), new_list.end(),
+					 [&i](const NeighborInfo &n){
+						 return n.uri == i.uri;
+					 }))
+				lost.emplace_front(std::move(i));
+
+		list = std::move(new_list);
+	}
+
+	for (const auto &i : lost)
+		listener.LostNeighbor(i);
 }
 
 void
 UpnpNeighborExplorer::FoundUPnP(const ContentDirectoryService &service)
 {
 	const NeighborInfo n(service.GetURI(), service.getFriendlyName());
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		list.remove_if([&n](const NeighborInfo &i){
+			return i.uri == n.uri;
+		});
+		list.emplace_front(n);
+	}
+
 	listener.FoundNeighbor(n);
 }
 
@@ -122,6 +186,14 @@ void
 UpnpNeighborExplorer::LostUPnP(const ContentDirectoryService &service)
 {
 	const NeighborInfo n(service.GetURI(), service.getFriendlyName());
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		list.remove_if([&n](const NeighborInfo &i){
+			return i.uri == n.uri;
+		});
+	}
+
 	listener.LostNeighbor(n);
 }
 
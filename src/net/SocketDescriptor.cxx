@@ -40,10 +40,12 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #endif
 
 #include <cassert>
 #include <cerrno>
+#include <iterator>
 
 #include <string.h>
 
@@ -452,6 +454,37 @@ SocketDescriptor::Write(const void *buffer, std::size_t length) const noexcept
 	return ::send(Get(), (const char *)buffer, length, flags);
 }
 
+ssize_t
+SocketDescriptor::WriteV(std::span<const std::span<const std::byte>> v) const noexcept
+{
+	if (v.empty())
+		return 0;
+
+#ifdef _WIN32
+	return Write(v.front().data(), v.front().size());
+#else
+	struct iovec iov[64];
+	if (v.size() > std::size(iov))
+		v = v.first(std::size(iov));
+
+	for (std::size_t i = 0; i < v.size(); ++i) {
+		iov[i].iov_base = const_cast<std::byte *>(v[i].data());
+		iov[i].iov_len = v[i].size();
+	}
+
+	struct msghdr msg{};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = v.size();
+
+	int flags = 0;
+#ifdef __linux__
+	flags |= MSG_NOSIGNAL;
+#endif
+
+	return ::sendmsg(Get(), &msg, flags);
+#endif
+}
+
 #ifdef _WIN32
 
 int
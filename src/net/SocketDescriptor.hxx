@@ -33,6 +33,8 @@
 #include "Features.hxx"
 #include "io/FileDescriptor.hxx"
 
+#include <cstddef>
+#include <span>
 #include <type_traits>
 
 class SocketAddress;
@@ -240,6 +242,12 @@ public:
 	ssize_t Read(void *buffer, std::size_t length) const noexcept;
 	ssize_t Write(const void *buffer, std::size_t length) const noexcept;
 
+	/**
+	 * Send data from several buffers with one system call (like
+	 * writev()).  On Windows, only the first buffer is sent.
+	 */
+	ssize_t WriteV(std::span<const std::span<const std::byte>> v) const noexcept;
+
 #ifdef _WIN32
 	int WaitReadable(int timeout_ms) const noexcept;
 	int WaitWritable(int timeout_ms) const noexcept;
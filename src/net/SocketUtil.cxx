@@ -23,12 +23,14 @@
 #include "SocketError.hxx"
 #include "UniqueSocketDescriptor.hxx"
 
+#include <stdexcept>
+
 #include <sys/stat.h>
 
 UniqueSocketDescriptor
 socket_bind_listen(int domain, int type, int protocol,
 		   SocketAddress address,
-		   int backlog)
+		   int backlog, bool reuse_port)
 {
 	UniqueSocketDescriptor fd;
 	if (!fd.CreateNonBlock(domain, type, protocol))
@@ -44,6 +46,15 @@ socket_bind_listen(int domain, int type, int protocol,
 	if (!fd.SetReuseAddress())
 		throw MakeSocketError("setsockopt() failed");
 
+	if (reuse_port) {
+#ifdef __linux__
+		if (!fd.SetReusePort())
+			throw MakeSocketError("Failed to set SO_REUSEPORT");
+#else
+		throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+	}
+
 	if (!fd.Bind(address))
 		throw MakeSocketError("Failed to bind socket");
 
@@ -44,11 +44,14 @@ class SocketAddress;
  * @param protocol the protocol, usually 0 to let the kernel choose
  * @param address the address to listen on
  * @param backlog the backlog parameter for the listen() system call
+ * @param reuse_port set the SO_REUSEPORT option, which allows
+ * several sockets to listen on the same address, with the kernel
+ * distributing incoming connections among them (Linux only)
  * @return the socket file descriptor
  */
 UniqueSocketDescriptor
 socket_bind_listen(int domain, int type, int protocol,
 		   SocketAddress address,
-		   int backlog);
+		   int backlog, bool reuse_port=false);
 
 #endif
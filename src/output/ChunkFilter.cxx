@@ -0,0 +1,234 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ChunkFilter.hxx"
+#include "MusicChunk.hxx"
+#include "filter/Filter.hxx"
+#include "filter/Prepared.hxx"
+#include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "pcm/Mix.hxx"
+#include "lib/fmt/AudioFormatFormatter.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+#include <string.h>
+
+/**
+ * Cast away the "const" of a buffer which is known to be owned by
+ * the #ChunkFilter.
+ */
+static std::span<std::byte>
+MakeWritable(std::span<const std::byte> src) noexcept
+{
+	return {const_cast<std::byte *>(src.data()), src.size()};
+}
+
+ChunkFilter::ChunkFilter() noexcept = default;
+ChunkFilter::~ChunkFilter() noexcept = default;
+
+AudioFormat
+ChunkFilter::Open(AudioFormat audio_format,
+		  PreparedFilter *prepared_replay_gain_filter,
+		  PreparedFilter *prepared_other_replay_gain_filter,
+		  PreparedFilter &prepared_filter)
+try {
+	assert(audio_format.IsValid());
+
+	/* the replay_gain filter cannot fail here */
+	if (prepared_other_replay_gain_filter) {
+		other_replay_gain_serial = 0;
+		other_replay_gain_filter =
+			prepared_other_replay_gain_filter->Open(audio_format);
+	}
+
+	if (prepared_replay_gain_filter) {
+		replay_gain_serial = 0;
+		replay_gain_filter =
+			prepared_replay_gain_filter->Open(audio_format);
+
+		audio_format = replay_gain_filter->GetOutAudioFormat();
+
+		assert(replay_gain_filter->GetOutAudioFormat() ==
+		       other_replay_gain_filter->GetOutAudioFormat());
+	}
+
+	filter = prepared_filter.Open(audio_format);
+	return filter->GetOutAudioFormat();
+} catch (...) {
+	Close();
+	throw;
+}
+
+void
+ChunkFilter::Close() noexcept
+{
+	replay_gain_filter.reset();
+	other_replay_gain_filter.reset();
+	filter.reset();
+}
+
+void
+ChunkFilter::Reset() noexcept
+{
+	if (replay_gain_filter)
+		replay_gain_filter->Reset();
+
+	if (other_replay_gain_filter)
+		other_replay_gain_filter->Reset();
+
+	if (filter)
+		filter->Reset();
+}
+
+std::span<const std::byte>
+ChunkFilter::GetChunkData(const MusicChunk &chunk,
+			  const AudioFormat in_audio_format,
+			  const ReplayGainMode replay_gain_mode,
+			  Filter *current_replay_gain_filter,
+			  unsigned *replay_gain_serial_p,
+			  PcmBuffer &buffer, bool &writable_r)
+{
+	assert(!chunk.IsEmpty());
+	assert(chunk.CheckFormat(in_audio_format));
+
+	std::span<const std::byte> data(chunk.data, chunk.length);
+
+	assert(data.size() % in_audio_format.GetFrameSize() == 0);
+
+	if (!data.empty() && current_replay_gain_filter != nullptr) {
+		replay_gain_filter_set_mode(*current_replay_gain_filter,
+					    replay_gain_mode);
+
+		if (chunk.replay_gain_serial != *replay_gain_serial_p) {
+			replay_gain_filter_set_info(*current_replay_gain_filter,
+						    chunk.replay_gain_serial != 0
+						    ? &chunk.replay_gain_info
+						    : nullptr);
+			*replay_gain_serial_p = chunk.replay_gain_serial;
+		}
+
+		if (current_replay_gain_filter->IsInPlace()) {
+			/* this is the only copy of the chunk data;
+			   from here on, in-place filters work on
+			   it */
+			auto *dest = buffer.GetT<std::byte>(data.size());
+			std::copy(data.begin(), data.end(), dest);
+
+			const std::span<std::byte> w{dest, data.size()};
+			current_replay_gain_filter->FilterInPlace(w);
+			writable_r = true;
+			return w;
+		}
+
+		data = current_replay_gain_filter->FilterPCM(data);
+	}
+
+	writable_r = false;
+	return data;
+}
+
+std::span<const std::byte>
+ChunkFilter::FilterChunk(const MusicChunk &chunk,
+			 const AudioFormat in_audio_format,
+			 const ReplayGainMode replay_gain_mode)
+{
+	bool writable;
+	auto data = GetChunkData(chunk, in_audio_format, replay_gain_mode,
+				 replay_gain_filter.get(),
+				 &replay_gain_serial,
+				 scratch_buffer, writable);
+	if (data.empty())
+		return data;
+
+	/* cross-fade */
+
+	if (chunk.other != nullptr) {
+		bool other_writable;
+		auto other_data = GetChunkData(*chunk.other,
+					       in_audio_format,
+					       replay_gain_mode,
+					       other_replay_gain_filter.get(),
+					       &other_replay_gain_serial,
+					       cross_fade_buffer,
+					       other_writable);
+		if (other_data.empty())
+			return data;
+
+		/* if the "other" chunk is longer, then that trailer
+		   is used as-is, without mixing; it is part of the
+		   "next" song being faded in, and if there's a rest,
+		   it means cross-fading ends here */
+
+		if (data.size() > other_data.size())
+			data = data.first(other_data.size());
+
+		float mix_ratio = chunk.mix_ratio;
+		float mix_ratio_end = chunk.mix_ratio_end;
+		if (mix_ratio >= 0) {
+			/* reverse the mix ratio (because the
+			   arguments to pcm_mix_ramp() are reversed),
+			   but only if the mix ratio is non-negative;
+			   a negative mix ratio is a MixRamp special
+			   case */
+			mix_ratio = 1.0f - mix_ratio;
+			mix_ratio_end = 1.0f - mix_ratio_end;
+
+			if (data.size() < chunk.length)
+				/* the ramp is defined over the whole
+				   chunk; adjust its end to the part
+				   which gets mixed */
+				mix_ratio_end = mix_ratio
+					+ (mix_ratio_end - mix_ratio)
+					* float(data.size()) / float(chunk.length);
+		}
+
+		void *dest = other_writable
+			/* already in #cross_fade_buffer */
+			? const_cast<std::byte *>(other_data.data())
+			: cross_fade_buffer.Get(other_data.size());
+		if (!other_writable)
+			memcpy(dest, other_data.data(), other_data.size());
+		if (!pcm_mix_ramp(cross_fade_dither, dest,
+				  data.data(), data.size(),
+				  in_audio_format.format,
+				  in_audio_format.GetFrameSize(),
+				  mix_ratio, mix_ratio_end))
+			throw FmtRuntimeError("Cannot cross-fade format {}",
+					      in_audio_format.format);
+
+		data = {(const std::byte *)dest, other_data.size()};
+		writable = true;
+	}
+
+	/* apply filter chain */
+
+	return writable
+		? filter->FilterWritable(MakeWritable(data))
+		: filter->FilterPCM(data);
+}
+
+std::span<const std::byte>
+ChunkFilter::Flush()
+{
+	return filter
+		? filter->Flush()
+		: std::span<const std::byte>{};
+}
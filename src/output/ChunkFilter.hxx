@@ -0,0 +1,153 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_CHUNK_FILTER_HXX
+#define MPD_OUTPUT_CHUNK_FILTER_HXX
+
+#include "ReplayGainMode.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/Buffer.hxx"
+#include "pcm/Dither.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+struct MusicChunk;
+class Filter;
+class PreparedFilter;
+
+/**
+ * The filters which are applied to each #MusicChunk on its way to an
+ * audio output: ReplayGain, cross-fading and the filter chain.
+ */
+class ChunkFilter {
+	/**
+	 * The serial number of the last replay gain info.  0 means no
+	 * replay gain info was available.
+	 */
+	unsigned replay_gain_serial;
+
+	/**
+	 * The serial number of the last replay gain info by the
+	 * "other" chunk during cross-fading.
+	 */
+	unsigned other_replay_gain_serial;
+
+	/**
+	 * The replay_gain_filter_plugin instance of this audio
+	 * output.
+	 */
+	std::unique_ptr<Filter> replay_gain_filter;
+
+	/**
+	 * The replay_gain_filter_plugin instance of this audio
+	 * output, to be applied to the second chunk during
+	 * cross-fading.
+	 */
+	std::unique_ptr<Filter> other_replay_gain_filter;
+
+	/**
+	 * A copy of the chunk data which is modified in place by all
+	 * filters which support it (see Filter::IsInPlace()).
+	 */
+	PcmBuffer scratch_buffer;
+
+	/**
+	 * The buffer used to allocate the cross-fading result.
+	 */
+	PcmBuffer cross_fade_buffer;
+
+	/**
+	 * The dithering state for cross-fading two streams.
+	 */
+	PcmDither cross_fade_dither;
+
+	/**
+	 * The filter object of this audio output.  This is an
+	 * instance of chain_filter_plugin.
+	 */
+	std::unique_ptr<Filter> filter;
+
+public:
+	ChunkFilter() noexcept;
+	~ChunkFilter() noexcept;
+
+	ChunkFilter(const ChunkFilter &) = delete;
+	ChunkFilter &operator=(const ChunkFilter &) = delete;
+
+	bool IsOpen() const noexcept {
+		return filter != nullptr;
+	}
+
+	/**
+	 * Throws on error.
+	 *
+	 * @return the output format of the filter chain
+	 */
+	AudioFormat Open(AudioFormat audio_format,
+			 PreparedFilter *prepared_replay_gain_filter,
+			 PreparedFilter *prepared_other_replay_gain_filter,
+			 PreparedFilter &prepared_filter);
+
+	void Close() noexcept;
+
+	void Reset() noexcept;
+
+	/**
+	 * Returns the last filter of the chain (which is usually the
+	 * "convert" filter).
+	 */
+	Filter &GetFilter() noexcept {
+		return *filter;
+	}
+
+	/**
+	 * Throws on error.
+	 *
+	 * @param in_audio_format the format of the #MusicChunk
+	 */
+	std::span<const std::byte> FilterChunk(const MusicChunk &chunk,
+					       AudioFormat in_audio_format,
+					       ReplayGainMode replay_gain_mode);
+
+	/**
+	 * Wrapper for Filter::Flush().
+	 */
+	std::span<const std::byte> Flush();
+
+private:
+	/**
+	 * Apply ReplayGain to the chunk data.
+	 *
+	 * @param buffer if the ReplayGain filter works in place, the
+	 * chunk data is copied to this buffer
+	 * @param writable_r set to true if the returned data is in
+	 * the given buffer and may be modified by subsequent filters
+	 */
+	std::span<const std::byte> GetChunkData(const MusicChunk &chunk,
+						AudioFormat in_audio_format,
+						ReplayGainMode replay_gain_mode,
+						Filter *replay_gain_filter,
+						unsigned *replay_gain_serial_p,
+						PcmBuffer &buffer,
+						bool &writable_r);
+};
+
+#endif
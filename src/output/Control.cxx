@@ -41,6 +41,8 @@ AudioOutputControl::AudioOutputControl(std::unique_ptr<FilteredAudioOutput> _out
 	 thread(BIND_THIS_METHOD(Task)),
 	 tags(block.GetBlockValue("tags", true)),
 	 always_on(block.GetBlockValue("always_on", false)),
+	 standby(block.GetBlockValue("standby", false)),
+	 max_lag(block.GetBlockValue("max_lag", 0U)),
 	 enabled(block.GetBlockValue("enabled", true))
 {
 }
@@ -52,7 +54,9 @@ AudioOutputControl::AudioOutputControl(AudioOutputControl &&src,
 	 client(_client),
 	 thread(BIND_THIS_METHOD(Task)),
 	 tags(src.tags),
-	 always_on(src.always_on)
+	 always_on(src.always_on),
+	 standby(src.standby),
+	 max_lag(src.max_lag)
 {
 }
 
@@ -127,6 +131,22 @@ AudioOutputControl::GetAttributes() const noexcept
 		: std::map<std::string, std::string>{};
 }
 
+AudioOutputStats
+AudioOutputControl::LockGetStats() const noexcept
+{
+	AudioOutputStats result;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		result = stats;
+	}
+
+	if (output)
+		result.underruns = output->GetUnderruns();
+
+	return result;
+}
+
 void
 AudioOutputControl::SetAttribute(std::string &&attribute_name,
 				 std::string &&value)
@@ -233,6 +253,10 @@ AudioOutputControl::EnableDisableAsync()
 	if (enabled == really_enabled)
 		return;
 
+	if (!enabled && in_standby)
+		/* already disabled and in warm standby */
+		return;
+
 	if (enabled)
 		EnableAsync();
 	else
@@ -318,8 +342,14 @@ AudioOutputControl::LockUpdate(const AudioFormat audio_format,
 		    fail_timer.Check(REOPEN_AFTER * 1000)) {
 			return Open(lock, audio_format, mp);
 		}
-	} else if (IsOpen())
-		CloseWait(lock);
+	} else if (IsOpen()) {
+		if (standby && really_enabled) {
+			/* keep the device open, but paused */
+			if (!in_standby)
+				CommandWait(lock, Command::DISABLE);
+		} else
+			CloseWait(lock);
+	}
 
 	return false;
 }
@@ -327,7 +357,7 @@ AudioOutputControl::LockUpdate(const AudioFormat audio_format,
 bool
 AudioOutputControl::IsChunkConsumed(const MusicChunk &chunk) const noexcept
 {
-	if (!open)
+	if (!open || in_standby)
 		return true;
 
 	return source.IsChunkConsumed(chunk);
@@ -347,7 +377,8 @@ AudioOutputControl::LockPlay() noexcept
 
 	assert(allow_play);
 
-	if (IsOpen() && !in_playback_loop && !woken_for_play) {
+	if (IsOpen() && !in_standby &&
+	    !in_playback_loop && !woken_for_play) {
 		woken_for_play = true;
 		wake_cond.notify_one();
 	}
@@ -396,6 +427,39 @@ AudioOutputControl::LockCancelAsync() noexcept
 	}
 }
 
+bool
+AudioOutputControl::LockSkipIfLagging() noexcept
+{
+	if (max_lag <= std::chrono::milliseconds::zero() || !output)
+		return false;
+
+	std::chrono::milliseconds lag;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+
+		if (!open || in_standby || !IsCommandFinished())
+			return false;
+
+		lag = request.audio_format.SizeToTime<std::chrono::milliseconds>(source.GetBacklogSize());
+		if (lag <= max_lag)
+			return false;
+	}
+
+	FmtWarning(output_domain, "{} lags behind by {} ms, skipping",
+		   GetLogName(), lag.count());
+
+	/* the output thread may be blocked inside the plugin */
+	output->Interrupt();
+
+	const std::scoped_lock<Mutex> protect(mutex);
+	if (!open || !IsCommandFinished())
+		return false;
+
+	CommandAsync(Command::SKIP);
+	return true;
+}
+
 void
 AudioOutputControl::LockAllowPlay() noexcept
 {
@@ -21,6 +21,7 @@
 #define MPD_OUTPUT_CONTROL_HXX
 
 #include "Source.hxx"
+#include "Stats.hxx"
 #include "pcm/AudioFormat.hxx"
 #include "thread/Thread.hxx"
 #include "thread/Mutex.hxx"
@@ -40,6 +41,7 @@ struct ConfigBlock;
 class MusicPipe;
 class Mixer;
 class AudioOutputClient;
+class SharedConversionCache;
 
 /**
  * Controller for an #AudioOutput and its output thread.
@@ -65,6 +67,14 @@ class AudioOutputControl {
 	 */
 	AudioOutputSource source;
 
+	/**
+	 * Conversion results shared with other outputs of the same
+	 * #MultipleOutputs instance (see
+	 * FilteredAudioOutput::shareable_conversion).  May be
+	 * nullptr.
+	 */
+	SharedConversionCache *conversion_cache = nullptr;
+
 	/**
 	 * The error that occurred in the output thread.  It is
 	 * cleared whenever the output is opened successfully.
@@ -119,6 +129,10 @@ class AudioOutputControl {
 	enum class Command {
 		NONE,
 		ENABLE,
+		/**
+		 * Disable the device; if #standby is set and the
+		 * device is open, pause it instead.
+		 */
 		DISABLE,
 
 		/**
@@ -143,6 +157,13 @@ class AudioOutputControl {
 		DRAIN,
 
 		CANCEL,
+
+		/**
+		 * Skip all chunks in the pipe because this output
+		 * lags behind too much (see #max_lag).
+		 */
+		SKIP,
+
 		KILL
 	} command = Command::NONE;
 
@@ -159,6 +180,20 @@ class AudioOutputControl {
 	 */
 	const bool always_on;
 
+	/**
+	 * Keep the device (and its filters and encoder) open in
+	 * paused state while the user has disabled it, so it can be
+	 * re-enabled without reopening everything?
+	 */
+	const bool standby;
+
+	/**
+	 * If this output lags behind by more than this duration, it
+	 * skips ahead instead of holding chunks (and thus stalling the
+	 * decoder and all other outputs).  Zero disables this.
+	 */
+	const std::chrono::milliseconds max_lag;
+
 	/**
 	 * Has the user enabled this device?
 	 */
@@ -194,6 +229,13 @@ class AudioOutputControl {
 	 */
 	bool pause = false;
 
+	/**
+	 * Has this output been disabled by the user, but is kept open
+	 * and paused because #standby is set?  It does not consume
+	 * chunks while in this state.
+	 */
+	bool in_standby = false;
+
 	/**
 	 * When this flag is set, the output thread will not do any
 	 * playback.  It will wait until the flag is cleared.
@@ -234,6 +276,13 @@ class AudioOutputControl {
 	 */
 	bool skip_delay;
 
+	/**
+	 * Health counters for the "outputstats" command.
+	 *
+	 * Protected by #mutex.
+	 */
+	AudioOutputStats stats;
+
 	/**
 	 * Has Command::KILL already been sent?  This field is only
 	 * defined if `thread` is defined.  It shall avoid sending the
@@ -390,6 +439,13 @@ public:
 	std::map<std::string, std::string> GetAttributes() const noexcept;
 	void SetAttribute(std::string &&name, std::string &&value);
 
+	/**
+	 * Returns a copy of the health counters, including the
+	 * plugin's underrun counter.
+	 */
+	[[gnu::pure]]
+	AudioOutputStats LockGetStats() const noexcept;
+
 	/**
 	 * Enables the device, but don't wait for completion.
 	 *
@@ -433,6 +489,14 @@ public:
 		source.SetReplayGainMode(_mode);
 	}
 
+	/**
+	 * Must be called before the output is opened, i.e. right
+	 * after construction.
+	 */
+	void SetConversionCache(SharedConversionCache *cache) noexcept {
+		conversion_cache = cache;
+	}
+
 	/**
 	 * Caller must lock the mutex.
 	 *
@@ -503,6 +567,16 @@ public:
 	 */
 	void LockCancelAsync() noexcept;
 
+	/**
+	 * Check whether this output lags behind by more than
+	 * #max_lag, and if so, make it skip all chunks which are
+	 * currently in the pipe.  Called by the player thread when
+	 * the oldest chunk is stuck.
+	 *
+	 * @return true if the output is going to skip
+	 */
+	bool LockSkipIfLagging() noexcept;
+
 	/**
 	 * Set the "allow_play" and signal the thread.
 	 */
@@ -535,6 +609,13 @@ private:
 	 */
 	void InternalDisable() noexcept;
 
+	/**
+	 * Runs inside the OutputThread.  Flush the source and pause
+	 * the device until the next command arrives (see #standby).
+	 * Caller must lock the mutex.
+	 */
+	void InternalStandby(std::unique_lock<Mutex> &lock) noexcept;
+
 	/**
 	 * Runs inside the OutputThread.
 	 * Caller must lock the mutex.
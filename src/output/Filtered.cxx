@@ -47,6 +47,12 @@ FilteredAudioOutput::GetAttributes() const noexcept
 	return output->GetAttributes();
 }
 
+unsigned
+FilteredAudioOutput::GetUnderruns() const noexcept
+{
+	return output->GetUnderruns();
+}
+
 void
 FilteredAudioOutput::SetAttribute(std::string &&_name, std::string &&_value)
 {
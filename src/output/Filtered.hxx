@@ -123,6 +123,14 @@ public:
 	 */
 	FilterObserver convert_filter;
 
+	/**
+	 * Does #prepared_filter consist of nothing but the "convert"
+	 * filter, and is ReplayGain not applied via the mixer?  Then
+	 * the filter result depends only on the input and output
+	 * formats, and a #SharedConversion may be used.
+	 */
+	bool shareable_conversion = false;
+
 	/**
 	 * Throws on error.
 	 */
@@ -174,6 +182,12 @@ public:
 	std::map<std::string, std::string> GetAttributes() const noexcept;
 	void SetAttribute(std::string &&name, std::string &&value);
 
+	/**
+	 * See AudioOutput::GetUnderruns().
+	 */
+	gcc_pure
+	unsigned GetUnderruns() const noexcept;
+
 	/**
 	 * Throws on error.
 	 */
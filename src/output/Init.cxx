@@ -115,6 +115,9 @@ audio_output_load_mixer(EventLoop &event_loop, FilteredAudioOutput &ao,
 {
 	Mixer *mixer;
 
+	/* fade software volume changes? */
+	const bool ramp = block.GetBlockValue("volume_ramp", false);
+
 	switch (mixer_type) {
 	case MixerType::NONE:
 		return nullptr;
@@ -139,7 +142,7 @@ audio_output_load_mixer(EventLoop &event_loop, FilteredAudioOutput &ao,
 		assert(mixer != nullptr);
 
 		filter_chain = ChainFilters(std::move(filter_chain),
-					    ao.volume_filter.Set(volume_filter_prepare()),
+					    ao.volume_filter.Set(volume_filter_prepare(ramp)),
 					    "software_mixer");
 		return mixer;
 	}
@@ -256,6 +259,9 @@ FilteredAudioOutput::Setup(EventLoop &event_loop,
 		throw std::runtime_error("Invalid \"replay_gain_handler\" value");
 	}
 
+	shareable_conversion = prepared_filter == nullptr &&
+		!StringIsEqual(replay_gain_handler, "mixer");
+
 	/* the "convert" filter must be the last one in the chain */
 
 	prepared_filter = ChainFilters(std::move(prepared_filter),
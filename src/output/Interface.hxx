@@ -20,6 +20,7 @@
 #ifndef MPD_AUDIO_OUTPUT_INTERFACE_HXX
 #define MPD_AUDIO_OUTPUT_INTERFACE_HXX
 
+#include <atomic>
 #include <map>
 #include <chrono>
 #include <span>
@@ -31,6 +32,11 @@ struct Tag;
 class AudioOutput {
 	const unsigned flags;
 
+	/**
+	 * The number of buffer underruns, see CountUnderrun().
+	 */
+	std::atomic_uint underruns{0};
+
 protected:
 	static constexpr unsigned FLAG_ENABLE_DISABLE = 0x1;
 	static constexpr unsigned FLAG_PAUSE = 0x2;
@@ -60,6 +66,26 @@ public:
 		return flags & FLAG_NEED_FULLY_DEFINED_AUDIO_FORMAT;
 	}
 
+	/**
+	 * Returns the number of buffer underruns (xruns) counted by
+	 * the plugin.  This method is thread-safe.
+	 */
+	unsigned GetUnderruns() const noexcept {
+		return underruns.load(std::memory_order_relaxed);
+	}
+
+protected:
+	/**
+	 * The plugin calls this after the device has run out of data
+	 * (or would have, if the plugin had not played silence).  It
+	 * may be called from any thread.
+	 */
+	void CountUnderrun() noexcept {
+		underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+public:
+
 	/**
 	 * Returns a map of runtime attributes.
 	 *
@@ -103,6 +103,7 @@ MultipleOutputs::Configure(EventLoop &event_loop, EventLoop &rt_event_loop,
 					      "names: {}",
 					      output->GetName());
 
+		output->SetConversionCache(&conversion_cache);
 		outputs.emplace_back(std::move(output));
 	});
 
@@ -115,6 +116,7 @@ MultipleOutputs::Configure(EventLoop &event_loop, EventLoop &rt_event_loop,
 						       mixer_listener,
 						       client, empty, defaults,
 						       nullptr));
+		outputs.back()->SetConversionCache(&conversion_cache);
 	}
 }
 
@@ -136,6 +138,7 @@ MultipleOutputs::AddMoveFrom(AudioOutputControl &&src,
 	outputs.push_back(std::make_unique<AudioOutputControl>(std::move(src),
 							       client));
 
+	outputs.back()->SetConversionCache(&conversion_cache);
 	outputs.back()->LockSetEnabled(enable);
 
 	client.ApplyEnabled();
@@ -199,8 +202,21 @@ MultipleOutputs::Play(MusicChunkPtr chunk)
 		/* TODO: obtain real error */
 		throw std::runtime_error("Failed to open audio output");
 
+	pending_wakeup_size += chunk->length;
 	pipe->Push(std::move(chunk));
 
+	if (pending_wakeup_size >= wakeup_size)
+		WakeUp();
+}
+
+void
+MultipleOutputs::WakeUp() noexcept
+{
+	if (pending_wakeup_size == 0)
+		return;
+
+	pending_wakeup_size = 0;
+
 	for (const auto &ao : outputs)
 		ao->LockPlay();
 }
@@ -222,6 +238,7 @@ MultipleOutputs::Open(const AudioFormat audio_format)
 		assert(pipe->IsEmpty() || audio_format == input_audio_format);
 
 	input_audio_format = audio_format;
+	wakeup_size = input_audio_format.TimeToSize(wakeup_threshold);
 
 	EnableDisable();
 	Update(true);
@@ -263,6 +280,14 @@ MultipleOutputs::IsChunkConsumed(const MusicChunk *chunk) const noexcept
 		return ao->LockIsChunkConsumed(*chunk); });
 }
 
+void
+MultipleOutputs::SkipLaggingOutputs(const MusicChunk &chunk) noexcept
+{
+	for (const auto &ao : outputs)
+		if (!ao->LockIsChunkConsumed(chunk))
+			ao->LockSkipIfLagging();
+}
+
 unsigned
 MultipleOutputs::CheckPipe() noexcept
 {
@@ -273,25 +298,31 @@ MultipleOutputs::CheckPipe() noexcept
 	while ((chunk = pipe->Peek()) != nullptr) {
 		assert(!pipe->IsEmpty());
 
-		if (!IsChunkConsumed(chunk))
+		if (!IsChunkConsumed(chunk)) {
 			/* at least one output is not finished playing
 			   this chunk */
+			SkipLaggingOutputs(*chunk);
 			return pipe->GetSize();
+		}
 
 		if (chunk->length > 0 && !chunk->time.IsNegative())
 			/* only update elapsed_time if the chunk
 			   provides a defined value */
 			elapsed_time = chunk->time;
 
-		const bool is_tail = chunk->next == nullptr;
+		const bool is_tail = pipe->GetNext(*chunk) == nullptr;
 		if (is_tail)
 			/* this is the tail of the pipe - clear the
 			   chunk reference in all outputs */
 			for (const auto &ao : outputs)
 				ao->LockClearTailChunk(*chunk);
 
+		/* free the conversion results of this chunk, nobody
+		   is going to need them anymore */
+		conversion_cache.Drop(*chunk);
+
 		/* remove the chunk from the pipe */
-		const auto shifted = pipe->Shift();
+		auto shifted = pipe->Shift();
 		assert(shifted.get() == chunk);
 
 		if (is_tail)
@@ -300,16 +331,53 @@ MultipleOutputs::CheckPipe() noexcept
 			for (const auto &ao : outputs)
 				ao->LockAllowPlay();
 
-		/* chunk is automatically returned to the buffer by
-		   ~MusicChunkPtr() */
+		/* keep the chunk for seeking backwards; if not,
+		   it is returned to the buffer by ~MusicChunkPtr() */
+		AddHistory(std::move(shifted), true);
 	}
 
 	return 0;
 }
 
+void
+MultipleOutputs::AddHistory(MusicChunkPtr chunk, bool trim) noexcept
+{
+	if (history_skip > 0) {
+		/* this chunk belongs to the previous song */
+		--history_skip;
+		return;
+	}
+
+	if (trim && history_duration <= SongTime::zero())
+		return;
+
+	if (chunk->length == 0 || chunk->time.IsNegative() ||
+	    chunk->other != nullptr) {
+		/* can't replay this one (and the chunks before it
+		   would leave a gap) */
+		history.clear();
+		return;
+	}
+
+	const SongTime time(chunk->time);
+
+	if (!history.empty() && time < SongTime(history.back()->time))
+		/* discontinuity */
+		history.clear();
+
+	if (trim)
+		while (!history.empty() &&
+		       SongTime(history.front()->time) + history_duration < time)
+			history.pop_front();
+
+	history.emplace_back(std::move(chunk));
+}
+
 void
 MultipleOutputs::Pause() noexcept
 {
+	pending_wakeup_size = 0;
+
 	Update(false);
 
 	for (const auto &ao : outputs)
@@ -321,6 +389,8 @@ MultipleOutputs::Pause() noexcept
 void
 MultipleOutputs::Drain() noexcept
 {
+	pending_wakeup_size = 0;
+
 	for (const auto &ao : outputs)
 		ao->LockDrainAsync();
 
@@ -330,6 +400,8 @@ MultipleOutputs::Drain() noexcept
 void
 MultipleOutputs::Cancel() noexcept
 {
+	pending_wakeup_size = 0;
+
 	/* send the cancel() command to all audio outputs */
 
 	for (const auto &ao : outputs)
@@ -337,11 +409,18 @@ MultipleOutputs::Cancel() noexcept
 
 	WaitAll();
 
+	/* the conversion results refer to the chunks which are
+	   about to be freed */
+
+	conversion_cache.Clear();
+
 	/* clear the music pipe and return all chunks to the buffer */
 
 	if (pipe != nullptr)
 		pipe->Clear();
 
+	ClearHistory();
+
 	/* the audio outputs are now waiting for a signal, to
 	   synchronize the cleared music pipe */
 
@@ -352,12 +431,60 @@ MultipleOutputs::Cancel() noexcept
 	elapsed_time = SignedSongTime::Negative();
 }
 
+void
+MultipleOutputs::SetSeekHistory(SongTime duration) noexcept
+{
+	history_duration = duration;
+	ClearHistory();
+}
+
+void
+MultipleOutputs::SetWakeupThreshold(std::chrono::steady_clock::duration threshold) noexcept
+{
+	wakeup_threshold = threshold;
+	if (input_audio_format.IsDefined())
+		wakeup_size = input_audio_format.TimeToSize(wakeup_threshold);
+}
+
+std::deque<MusicChunkPtr>
+MultipleOutputs::CancelForSeek() noexcept
+{
+	pending_wakeup_size = 0;
+
+	for (const auto &ao : outputs)
+		ao->LockCancelAsync();
+
+	WaitAll();
+
+	conversion_cache.Clear();
+
+	/* the cancelled chunks follow the ones which have already
+	   been played */
+
+	if (pipe != nullptr)
+		while (auto chunk = pipe->Shift())
+			AddHistory(std::move(chunk), false);
+
+	auto result = std::move(history);
+	ClearHistory();
+
+	AllowPlay();
+
+	elapsed_time = SignedSongTime::Negative();
+
+	return result;
+}
+
 void
 MultipleOutputs::Close() noexcept
 {
+	pending_wakeup_size = 0;
+
 	for (const auto &ao : outputs)
 		ao->LockCloseWait();
 
+	conversion_cache.Clear();
+	ClearHistory();
 	pipe.reset();
 
 	input_audio_format.Clear();
@@ -368,9 +495,13 @@ MultipleOutputs::Close() noexcept
 void
 MultipleOutputs::Release() noexcept
 {
+	pending_wakeup_size = 0;
+
 	for (const auto &ao : outputs)
 		ao->LockRelease();
 
+	conversion_cache.Clear();
+	ClearHistory();
 	pipe.reset();
 
 	input_audio_format.Clear();
@@ -384,4 +515,9 @@ MultipleOutputs::SongBorder() noexcept
 	/* clear the elapsed_time pointer at the beginning of a new
 	   song */
 	elapsed_time = SignedSongTime::zero();
+
+	/* the chunks which are still in the pipe belong to the
+	   previous song */
+	history.clear();
+	history_skip = pipe != nullptr ? pipe->GetSize() : 0;
 }
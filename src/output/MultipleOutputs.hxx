@@ -21,6 +21,7 @@
 #define OUTPUT_ALL_H
 
 #include "Control.hxx"
+#include "SharedConversion.hxx"
 #include "MusicChunkPtr.hxx"
 #include "player/Outputs.hxx"
 #include "pcm/AudioFormat.hxx"
@@ -29,6 +30,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -48,6 +50,13 @@ class MultipleOutputs final : public PlayerOutputs {
 
 	MixerListener &mixer_listener;
 
+	/**
+	 * Conversion results shared by outputs which need the same
+	 * format conversion.  This must be declared before #outputs
+	 * because their #AudioOutputSource instances refer to it.
+	 */
+	SharedConversionCache conversion_cache;
+
 	std::vector<std::unique_ptr<AudioOutputControl>> outputs;
 
 	AudioFormat input_audio_format = AudioFormat::Undefined();
@@ -64,6 +73,42 @@ class MultipleOutputs final : public PlayerOutputs {
 	 */
 	SignedSongTime elapsed_time = SignedSongTime::Negative();
 
+	/**
+	 * Chunks of the current song which have been played
+	 * recently, oldest first.  See SetSeekHistory() and
+	 * CancelForSeek().
+	 */
+	std::deque<MusicChunkPtr> history;
+
+	/**
+	 * The duration of #history; zero disables it.
+	 */
+	SongTime history_duration = SongTime::zero();
+
+	/**
+	 * The number of chunks at the head of #pipe which belong to
+	 * the previous song (see SongBorder()); they must not be
+	 * added to #history.
+	 */
+	unsigned history_skip = 0;
+
+	/**
+	 * See SetWakeupThreshold().
+	 */
+	std::chrono::steady_clock::duration wakeup_threshold{};
+
+	/**
+	 * #wakeup_threshold converted to bytes of
+	 * #input_audio_format.
+	 */
+	std::size_t wakeup_size = 0;
+
+	/**
+	 * The number of bytes added by Play() since the outputs
+	 * were woken up the last time.
+	 */
+	std::size_t pending_wakeup_size = 0;
+
 public:
 	/**
 	 * Load audio outputs from the configuration file and
@@ -196,6 +241,26 @@ private:
 	 */
 	bool IsChunkConsumed(const MusicChunk *chunk) const noexcept;
 
+	/**
+	 * The given chunk has not been consumed yet; let all outputs
+	 * which hold it and lag behind too much skip ahead.
+	 */
+	void SkipLaggingOutputs(const MusicChunk &chunk) noexcept;
+
+	/**
+	 * Append a chunk which has been shifted from #pipe to
+	 * #history (or free it).
+	 *
+	 * @param trim remove chunks which are older than
+	 * #history_duration?
+	 */
+	void AddHistory(MusicChunkPtr chunk, bool trim) noexcept;
+
+	void ClearHistory() noexcept {
+		history.clear();
+		history_skip = 0;
+	}
+
 	/* virtual methods from class PlayerOutputs */
 	void EnableDisable() override;
 	void Open(const AudioFormat audio_format) override;
@@ -206,6 +271,10 @@ private:
 	void Pause() noexcept override;
 	void Drain() noexcept override;
 	void Cancel() noexcept override;
+	void SetSeekHistory(SongTime duration) noexcept override;
+	void SetWakeupThreshold(std::chrono::steady_clock::duration threshold) noexcept override;
+	void WakeUp() noexcept override;
+	std::deque<MusicChunkPtr> CancelForSeek() noexcept override;
 	void SongBorder() noexcept override;
 	SignedSongTime GetElapsedTime() const noexcept override {
 		return elapsed_time;
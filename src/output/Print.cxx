@@ -28,6 +28,8 @@
 
 #include <fmt/format.h>
 
+#include <chrono>
+
 void
 printAudioDevices(Response &r, const MultipleOutputs &outputs)
 {
@@ -47,3 +49,57 @@ printAudioDevices(Response &r, const MultipleOutputs &outputs)
 			      attribute, value);
 	}
 }
+
+template<std::size_t N>
+static void
+PrintHistogram(Response &r, const char *name,
+	       const Log2Histogram<N> &histogram) noexcept
+{
+	r.Fmt(FMT_STRING("{}:"), name);
+
+	for (std::size_t i = 0; i < histogram.size(); ++i)
+		if (histogram[i] > 0)
+			r.Fmt(FMT_STRING(" {}:{}"),
+			      histogram.LowerBound(i), histogram[i]);
+
+	r.Write("\n");
+}
+
+static constexpr uint_least64_t
+ToMicroseconds(std::chrono::steady_clock::duration d) noexcept
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void
+printAudioOutputStats(Response &r, const MultipleOutputs &outputs)
+{
+	for (unsigned i = 0, n = outputs.Size(); i != n; ++i) {
+		const auto &ao = outputs.Get(i);
+		const auto stats = ao.LockGetStats();
+
+		r.Fmt(FMT_STRING("outputid: {}\n"
+				 "outputname: {}\n"
+				 "play_calls: {}\n"
+				 "play_bytes: {}\n"
+				 "play_time_us: {}\n"
+				 "play_time_max_us: {}\n"),
+		      i, ao.GetName(),
+		      stats.play_calls, stats.play_bytes,
+		      ToMicroseconds(stats.play_time),
+		      ToMicroseconds(stats.max_play_time));
+
+		PrintHistogram(r, "play_time_histogram",
+			       stats.play_time_histogram);
+
+		r.Fmt(FMT_STRING("backlog: {}\n"), stats.backlog);
+		PrintHistogram(r, "backlog_histogram",
+			       stats.backlog_histogram);
+
+		r.Fmt(FMT_STRING("delay_us: {}\n"
+				 "underruns: {}\n"
+				 "lag_skips: {}\n"),
+		      ToMicroseconds(stats.delay), stats.underruns,
+		      stats.lag_skips);
+	}
+}
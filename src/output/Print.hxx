@@ -31,4 +31,7 @@ class MultipleOutputs;
 void
 printAudioDevices(Response &r, const MultipleOutputs &outputs);
 
+void
+printAudioOutputStats(Response &r, const MultipleOutputs &outputs);
+
 #endif
@@ -36,6 +36,7 @@
 #include "plugins/PipeWireOutputPlugin.hxx"
 #include "plugins/PulseOutputPlugin.hxx"
 #include "plugins/RecorderOutputPlugin.hxx"
+#include "plugins/ShmOutputPlugin.hxx"
 #include "plugins/ShoutOutputPlugin.hxx"
 #include "plugins/sles/SlesOutputPlugin.hxx"
 #include "plugins/SolarisOutputPlugin.hxx"
@@ -64,6 +65,9 @@ constexpr const AudioOutputPlugin *audio_output_plugins[] = {
 #ifdef ENABLE_PIPE_OUTPUT
 	&pipe_output_plugin,
 #endif
+#ifdef ENABLE_SHM_OUTPUT
+	&shm_output_plugin,
+#endif
 #ifdef ENABLE_ALSA
 	&alsa_output_plugin,
 #endif
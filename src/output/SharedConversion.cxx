@@ -0,0 +1,182 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SharedConversion.hxx"
+#include "MusicPipe.hxx"
+#include "filter/Filter.hxx"
+#include "filter/Prepared.hxx"
+#include "filter/plugins/ConvertFilterPlugin.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+
+SharedConversion::SharedConversion(const AudioFormat _in_audio_format,
+				   const AudioFormat _out_audio_format,
+				   PreparedFilter *prepared_replay_gain_filter,
+				   PreparedFilter *prepared_other_replay_gain_filter)
+	:in_audio_format(_in_audio_format),
+	 out_audio_format(_out_audio_format),
+	 replay_gain(prepared_replay_gain_filter != nullptr),
+	 prepared_convert_filter(convert_filter_prepare())
+{
+	filter.Open(in_audio_format,
+		    prepared_replay_gain_filter,
+		    prepared_other_replay_gain_filter,
+		    *prepared_convert_filter);
+	convert_filter_set(&filter.GetFilter(), out_audio_format);
+}
+
+SharedConversion::~SharedConversion() noexcept
+{
+	assert(ref == 0);
+}
+
+std::span<const std::byte>
+SharedConversion::FilterChunk(const MusicPipe &pipe, const MusicChunk &chunk,
+			      ReplayGainMode replay_gain_mode)
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	/* search from the end, because the most recently converted
+	   chunk is the one most likely to be requested */
+	for (auto i = entries.rbegin(); i != entries.rend(); ++i)
+		if (i->chunk == &chunk)
+			return i->data;
+
+	if (last != nullptr && pipe.GetNext(*last) != &chunk)
+		/* this is not a continuation of the previous chunk;
+		   don't let stale filter state leak into it */
+		filter.Reset();
+
+	flushed = false;
+
+	const auto data = filter.FilterChunk(chunk, in_audio_format,
+					     replay_gain_mode);
+	entries.emplace_back(chunk, data);
+	last = &chunk;
+	return entries.back().data;
+}
+
+std::span<const std::byte>
+SharedConversion::Flush()
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (!flushed) {
+		std::vector<std::byte> buffer;
+
+		while (true) {
+			const auto data = filter.Flush();
+			if (data.data() == nullptr)
+				break;
+
+			buffer.insert(buffer.end(), data.begin(), data.end());
+		}
+
+		tail = std::span<const std::byte>{buffer};
+		flushed = true;
+	}
+
+	return tail;
+}
+
+inline void
+SharedConversion::Drop(const MusicChunk &chunk) noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	std::erase_if(entries, [&chunk](const auto &i){
+		return i.chunk == &chunk;
+	});
+
+	if (last == &chunk)
+		/* the chunk is going to be freed; the next one will
+		   be the new head of the pipe, which is its
+		   successor */
+		last = nullptr;
+}
+
+inline void
+SharedConversion::Clear() noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	entries.clear();
+	last = nullptr;
+	tail = nullptr;
+	flushed = false;
+	filter.Reset();
+}
+
+SharedConversion &
+SharedConversionCache::Acquire(const AudioFormat in_audio_format,
+			       const AudioFormat out_audio_format,
+			       PreparedFilter *prepared_replay_gain_filter,
+			       PreparedFilter *prepared_other_replay_gain_filter)
+{
+	const bool replay_gain = prepared_replay_gain_filter != nullptr;
+
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	for (auto &i : items) {
+		if (i.IsKey(in_audio_format, out_audio_format, replay_gain)) {
+			++i.ref;
+			return i;
+		}
+	}
+
+	auto &item = items.emplace_front(in_audio_format, out_audio_format,
+					 prepared_replay_gain_filter,
+					 prepared_other_replay_gain_filter);
+	++item.ref;
+	return item;
+}
+
+void
+SharedConversionCache::Release(SharedConversion &item) noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	assert(item.ref > 0);
+
+	if (--item.ref == 0)
+		items.remove_if([&item](const auto &i){
+			return &i == &item;
+		});
+}
+
+void
+SharedConversionCache::Drop(const MusicChunk &chunk) noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	for (auto &i : items)
+		i.Drop(chunk);
+}
+
+void
+SharedConversionCache::Clear() noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	for (auto &i : items)
+		i.Clear();
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_SHARED_CONVERSION_HXX
+#define MPD_OUTPUT_SHARED_CONVERSION_HXX
+
+#include "ChunkFilter.hxx"
+#include "ReplayGainMode.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+#include "util/AllocatedArray.hxx"
+
+#include <cstddef>
+#include <deque>
+#include <forward_list>
+#include <memory>
+#include <span>
+
+struct MusicChunk;
+class MusicPipe;
+class PreparedFilter;
+
+/**
+ * Converts the #MusicChunk instances of a #MusicPipe to one
+ * specific output format, on behalf of all audio outputs which need
+ * exactly this conversion.  Each chunk gets converted only once, by
+ * the first output which asks for it, and the result is kept until
+ * the chunk has been consumed by all outputs.
+ *
+ * This is only used for audio outputs without a private filter
+ * chain (no "filters" setting, no software volume, no
+ * normalization), because then the result depends only on the input
+ * and output formats and on the (global) ReplayGain settings.
+ */
+class SharedConversion {
+	friend class SharedConversionCache;
+
+	const AudioFormat in_audio_format, out_audio_format;
+
+	/**
+	 * Does this instance apply ReplayGain?
+	 */
+	const bool replay_gain;
+
+	/**
+	 * The number of #AudioOutputSource instances using this
+	 * object.  Protected by SharedConversionCache::mutex.
+	 */
+	unsigned ref = 0;
+
+	/**
+	 * Protects all attributes below.
+	 */
+	Mutex mutex;
+
+	std::unique_ptr<PreparedFilter> prepared_convert_filter;
+
+	ChunkFilter filter;
+
+	struct Entry {
+		const MusicChunk *chunk;
+
+		AllocatedArray<std::byte> data;
+
+		Entry(const MusicChunk &_chunk,
+		      std::span<const std::byte> _data) noexcept
+			:chunk(&_chunk), data(_data) {}
+	};
+
+	/**
+	 * Converted chunks which have not yet been consumed by all
+	 * outputs, in pipe order.
+	 */
+	std::deque<Entry> entries;
+
+	/**
+	 * The most recently converted chunk.  If the next chunk is
+	 * not its successor, then the filter state is reset.
+	 */
+	const MusicChunk *last = nullptr;
+
+	/**
+	 * The concatenated result of #filter.Flush().
+	 */
+	AllocatedArray<std::byte> tail;
+
+	/**
+	 * Has #filter been flushed since the last chunk was
+	 * converted?
+	 */
+	bool flushed = false;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	SharedConversion(AudioFormat _in_audio_format,
+			 AudioFormat _out_audio_format,
+			 PreparedFilter *prepared_replay_gain_filter,
+			 PreparedFilter *prepared_other_replay_gain_filter);
+	~SharedConversion() noexcept;
+
+	SharedConversion(const SharedConversion &) = delete;
+	SharedConversion &operator=(const SharedConversion &) = delete;
+
+	/**
+	 * Returns the converted data of the specified chunk,
+	 * converting it if this hasn't been done yet.  The returned
+	 * buffer remains valid until the chunk is removed from the
+	 * pipe.
+	 *
+	 * Throws on error.
+	 */
+	std::span<const std::byte> FilterChunk(const MusicPipe &pipe,
+					       const MusicChunk &chunk,
+					       ReplayGainMode replay_gain_mode);
+
+	/**
+	 * Returns all the data which was still buffered in the
+	 * filter.  It remains valid until the next chunk gets
+	 * converted.
+	 *
+	 * Throws on error.
+	 */
+	std::span<const std::byte> Flush();
+
+private:
+	bool IsKey(AudioFormat _in_audio_format,
+		   AudioFormat _out_audio_format,
+		   bool _replay_gain) const noexcept {
+		return _in_audio_format == in_audio_format &&
+			_out_audio_format == out_audio_format &&
+			_replay_gain == replay_gain;
+	}
+
+	void Drop(const MusicChunk &chunk) noexcept;
+	void Clear() noexcept;
+};
+
+/**
+ * A registry of #SharedConversion instances, one for each distinct
+ * format conversion currently performed by the audio outputs of a
+ * #MultipleOutputs object.
+ */
+class SharedConversionCache {
+	Mutex mutex;
+
+	std::forward_list<SharedConversion> items;
+
+public:
+	/**
+	 * Find or create a #SharedConversion instance.  Call
+	 * Release() when it is not needed anymore.
+	 *
+	 * Throws on error.
+	 */
+	SharedConversion &Acquire(AudioFormat in_audio_format,
+				  AudioFormat out_audio_format,
+				  PreparedFilter *prepared_replay_gain_filter,
+				  PreparedFilter *prepared_other_replay_gain_filter);
+
+	void Release(SharedConversion &item) noexcept;
+
+	/**
+	 * The specified chunk has been consumed by all outputs and
+	 * is about to be removed from the pipe; free its converted
+	 * data.
+	 */
+	void Drop(const MusicChunk &chunk) noexcept;
+
+	/**
+	 * The pipe has been cleared: free all converted data and
+	 * reset all filters.  No output may be using data returned
+	 * by SharedConversion::FilterChunk() at this point.
+	 */
+	void Clear() noexcept;
+};
+
+#endif
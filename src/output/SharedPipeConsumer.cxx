@@ -28,11 +28,12 @@ SharedPipeConsumer::Get() noexcept
 		if (!consumed)
 			return chunk;
 
-		if (chunk->next == nullptr)
+		const MusicChunk *next = pipe->GetNext(*chunk);
+		if (next == nullptr)
 			return nullptr;
 
 		consumed = false;
-		return chunk = chunk->next.get();
+		return chunk = next;
 	} else {
 		/* get the first chunk from the pipe */
 		consumed = false;
@@ -49,9 +50,74 @@ SharedPipeConsumer::IsConsumed(const MusicChunk &_chunk) const noexcept
 	assert(&_chunk == chunk || pipe->Contains(chunk));
 
 	if (&_chunk != chunk) {
-		assert(_chunk.next != nullptr);
+		assert(pipe->GetNext(_chunk) != nullptr);
 		return true;
 	}
 
-	return consumed && _chunk.next == nullptr;
+	return consumed && pipe->GetNext(_chunk) == nullptr;
+}
+
+unsigned
+SharedPipeConsumer::GetBacklog() const noexcept
+{
+	if (pipe == nullptr)
+		return 0;
+
+	const MusicChunk *i;
+	unsigned n = 0;
+
+	if (chunk == nullptr) {
+		i = pipe->Peek();
+	} else {
+		i = pipe->GetNext(*chunk);
+		if (!consumed)
+			++n;
+	}
+
+	for (; i != nullptr; i = pipe->GetNext(*i))
+		++n;
+
+	return n;
+}
+
+std::size_t
+SharedPipeConsumer::GetBacklogSize() const noexcept
+{
+	if (pipe == nullptr)
+		return 0;
+
+	const MusicChunk *i;
+	std::size_t size = 0;
+
+	if (chunk == nullptr) {
+		i = pipe->Peek();
+	} else {
+		i = pipe->GetNext(*chunk);
+		if (!consumed)
+			size += chunk->length;
+	}
+
+	for (; i != nullptr; i = pipe->GetNext(*i))
+		size += i->length;
+
+	return size;
+}
+
+void
+SharedPipeConsumer::SkipAll() noexcept
+{
+	assert(pipe != nullptr);
+
+	const MusicChunk *i = chunk != nullptr
+		? chunk
+		: pipe->Peek();
+	if (i == nullptr)
+		/* the pipe is empty */
+		return;
+
+	for (const MusicChunk *next; (next = pipe->GetNext(*i)) != nullptr;)
+		i = next;
+
+	chunk = i;
+	consumed = true;
 }
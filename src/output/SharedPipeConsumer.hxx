@@ -23,6 +23,7 @@
 #include "util/Compiler.h"
 
 #include <cassert>
+#include <cstddef>
 
 struct MusicChunk;
 class MusicPipe;
@@ -76,6 +77,28 @@ public:
 
 	const MusicChunk *Get() noexcept;
 
+	/**
+	 * Count the chunks in the pipe which have not yet been
+	 * consumed.  This walks the chunk list, so it should not be
+	 * called for every chunk.
+	 */
+	gcc_pure
+	unsigned GetBacklog() const noexcept;
+
+	/**
+	 * Like GetBacklog(), but returns the number of PCM bytes in
+	 * these chunks.
+	 */
+	gcc_pure
+	std::size_t GetBacklogSize() const noexcept;
+
+	/**
+	 * Mark all chunks currently in the pipe as consumed, i.e.
+	 * skip to the tail.  The caller must not use the current
+	 * chunk anymore.
+	 */
+	void SkipAll() noexcept;
+
 	void Consume([[maybe_unused]] const MusicChunk &_chunk) {
 		assert(chunk != nullptr);
 		assert(chunk == &_chunk);
@@ -18,19 +18,17 @@
  */
 
 #include "Source.hxx"
+#include "SharedConversion.hxx"
 #include "MusicChunk.hxx"
 #include "filter/Filter.hxx"
-#include "filter/Prepared.hxx"
-#include "filter/plugins/ReplayGainFilterPlugin.hxx"
-#include "pcm/Mix.hxx"
-#include "lib/fmt/AudioFormatFormatter.hxx"
-#include "lib/fmt/RuntimeError.hxx"
 #include "thread/Mutex.hxx"
 
-#include <string.h>
-
 AudioOutputSource::AudioOutputSource() noexcept = default;
-AudioOutputSource::~AudioOutputSource() noexcept = default;
+
+AudioOutputSource::~AudioOutputSource() noexcept
+{
+	UnshareConversion();
+}
 
 AudioFormat
 AudioOutputSource::Open(const AudioFormat audio_format, const MusicPipe &_pipe,
@@ -47,20 +45,22 @@ AudioOutputSource::Open(const AudioFormat audio_format, const MusicPipe &_pipe,
 
 	/* (re)open the filter */
 
-	if (filter && audio_format != in_audio_format)
+	if (filter.IsOpen() && audio_format != in_audio_format) {
 		/* the filter must be reopened on all input format
 		   changes */
-		CloseFilter();
+		UnshareConversion();
+		filter.Close();
+	}
 
-	if (filter == nullptr)
+	if (!filter.IsOpen())
 		/* open the filter */
-		OpenFilter(audio_format,
-			   prepared_replay_gain_filter,
-			   prepared_other_replay_gain_filter,
-			   prepared_filter);
+		filter.Open(audio_format,
+			    prepared_replay_gain_filter,
+			    prepared_other_replay_gain_filter,
+			    prepared_filter);
 
 	in_audio_format = audio_format;
-	return filter->GetOutAudioFormat();
+	return filter.GetFilter().GetOutAudioFormat();
 }
 
 void
@@ -71,7 +71,16 @@ AudioOutputSource::Close() noexcept
 
 	Cancel();
 
-	CloseFilter();
+	UnshareConversion();
+	filter.Close();
+}
+
+void
+AudioOutputSource::Skip() noexcept
+{
+	current_chunk = nullptr;
+	pipe.SkipAll();
+	filter.Reset();
 }
 
 void
@@ -80,134 +89,60 @@ AudioOutputSource::Cancel() noexcept
 	current_chunk = nullptr;
 	pipe.Cancel();
 
-	if (replay_gain_filter)
-		replay_gain_filter->Reset();
-
-	if (other_replay_gain_filter)
-		other_replay_gain_filter->Reset();
-
-	if (filter)
-		filter->Reset();
+	/* the #SharedConversion is reset by
+	   MultipleOutputs::Cancel() */
+	filter.Reset();
 }
 
 void
-AudioOutputSource::OpenFilter(AudioFormat audio_format,
-			      PreparedFilter *prepared_replay_gain_filter,
-			      PreparedFilter *prepared_other_replay_gain_filter,
-			      PreparedFilter &prepared_filter)
-try {
-	assert(audio_format.IsValid());
-
-	/* the replay_gain filter cannot fail here */
-	if (prepared_other_replay_gain_filter) {
-		other_replay_gain_serial = 0;
-		other_replay_gain_filter =
-			prepared_other_replay_gain_filter->Open(audio_format);
+AudioOutputSource::ShareConversion(SharedConversionCache &cache,
+				   const AudioFormat out_audio_format,
+				   PreparedFilter *prepared_replay_gain_filter,
+				   PreparedFilter *prepared_other_replay_gain_filter)
+{
+	assert(IsOpen());
+
+	auto &c = cache.Acquire(in_audio_format, out_audio_format,
+				prepared_replay_gain_filter,
+				prepared_other_replay_gain_filter);
+	if (&c == shared_conversion) {
+		/* no change */
+		cache.Release(c);
+		return;
 	}
 
-	if (prepared_replay_gain_filter) {
-		replay_gain_serial = 0;
-		replay_gain_filter =
-			prepared_replay_gain_filter->Open(audio_format);
-
-		audio_format = replay_gain_filter->GetOutAudioFormat();
-
-		assert(replay_gain_filter->GetOutAudioFormat() ==
-		       other_replay_gain_filter->GetOutAudioFormat());
-	}
+	UnshareConversion();
 
-	filter = prepared_filter.Open(audio_format);
-} catch (...) {
-	CloseFilter();
-	throw;
+	shared_conversion = &c;
+	shared_conversion_cache = &cache;
+	shared_flushed = false;
 }
 
 void
-AudioOutputSource::CloseFilter() noexcept
+AudioOutputSource::UnshareConversion() noexcept
 {
-	replay_gain_filter.reset();
-	other_replay_gain_filter.reset();
-	filter.reset();
-}
-
-std::span<const std::byte>
-AudioOutputSource::GetChunkData(const MusicChunk &chunk,
-				Filter *current_replay_gain_filter,
-				unsigned *replay_gain_serial_p)
-{
-	assert(!chunk.IsEmpty());
-	assert(chunk.CheckFormat(in_audio_format));
-
-	std::span<const std::byte> data(chunk.data, chunk.length);
+	if (shared_conversion == nullptr)
+		return;
 
-	assert(data.size() % in_audio_format.GetFrameSize() == 0);
-
-	if (!data.empty() && current_replay_gain_filter != nullptr) {
-		replay_gain_filter_set_mode(*current_replay_gain_filter,
-					    replay_gain_mode);
-
-		if (chunk.replay_gain_serial != *replay_gain_serial_p) {
-			replay_gain_filter_set_info(*current_replay_gain_filter,
-						    chunk.replay_gain_serial != 0
-						    ? &chunk.replay_gain_info
-						    : nullptr);
-			*replay_gain_serial_p = chunk.replay_gain_serial;
-		}
-
-		data = current_replay_gain_filter->FilterPCM(data);
-	}
+	if (current_chunk != nullptr)
+		/* the pending data is owned by the
+		   #SharedConversion which may be freed now */
+		DropCurrentChunk();
 
-	return data;
+	shared_conversion_cache->Release(*std::exchange(shared_conversion,
+							nullptr));
 }
 
-std::span<const std::byte>
+inline std::span<const std::byte>
 AudioOutputSource::FilterChunk(const MusicChunk &chunk)
 {
-	auto data = GetChunkData(chunk, replay_gain_filter.get(),
-				 &replay_gain_serial);
-	if (data.empty())
-		return data;
-
-	/* cross-fade */
-
-	if (chunk.other != nullptr) {
-		auto other_data = GetChunkData(*chunk.other,
-					       other_replay_gain_filter.get(),
-					       &other_replay_gain_serial);
-		if (other_data.empty())
-			return data;
-
-		/* if the "other" chunk is longer, then that trailer
-		   is used as-is, without mixing; it is part of the
-		   "next" song being faded in, and if there's a rest,
-		   it means cross-fading ends here */
-
-		if (data.size() > other_data.size())
-			data = data.first(other_data.size());
-
-		float mix_ratio = chunk.mix_ratio;
-		if (mix_ratio >= 0)
-			/* reverse the mix ratio (because the
-			   arguments to pcm_mix() are reversed), but
-			   only if the mix ratio is non-negative; a
-			   negative mix ratio is a MixRamp special
-			   case */
-			mix_ratio = 1.0f - mix_ratio;
-
-		void *dest = cross_fade_buffer.Get(other_data.size());
-		memcpy(dest, other_data.data(), other_data.size());
-		if (!pcm_mix(cross_fade_dither, dest, data.data(), data.size(),
-			     in_audio_format.format,
-			     mix_ratio))
-			throw FmtRuntimeError("Cannot cross-fade format {}",
-					      in_audio_format.format);
-
-		data = {(const std::byte *)dest, other_data.size()};
+	if (shared_conversion != nullptr) {
+		shared_flushed = false;
+		return shared_conversion->FilterChunk(pipe.GetPipe(), chunk,
+						      replay_gain_mode);
 	}
 
-	/* apply filter chain */
-
-	return filter->FilterPCM(data);
+	return filter.FilterChunk(chunk, in_audio_format, replay_gain_mode);
 }
 
 bool
@@ -252,7 +187,16 @@ AudioOutputSource::ConsumeData(size_t nbytes) noexcept
 std::span<const std::byte>
 AudioOutputSource::Flush()
 {
-	return filter
-		? filter->Flush()
-		: std::span<const std::byte>{};
+	if (shared_conversion != nullptr) {
+		if (std::exchange(shared_flushed, true))
+			return {};
+
+		const auto tail = shared_conversion->Flush();
+		if (tail.empty())
+			return {};
+
+		return tail;
+	}
+
+	return filter.Flush();
 }
@@ -21,22 +21,21 @@
 #define AUDIO_OUTPUT_SOURCE_HXX
 
 #include "SharedPipeConsumer.hxx"
+#include "ChunkFilter.hxx"
 #include "ReplayGainMode.hxx"
 #include "pcm/AudioFormat.hxx"
-#include "pcm/Buffer.hxx"
-#include "pcm/Dither.hxx"
 #include "thread/Mutex.hxx"
 
 #include <cassert>
 #include <cstdint>
-#include <memory>
 #include <span>
 #include <utility>
 
 struct MusicChunk;
 struct Tag;
-class Filter;
 class PreparedFilter;
+class SharedConversion;
+class SharedConversionCache;
 
 /**
  * Source of audio data to be played by an #AudioOutput.  It receives
@@ -59,45 +58,27 @@ class AudioOutputSource {
 	SharedPipeConsumer pipe;
 
 	/**
-	 * The serial number of the last replay gain info.  0 means no
-	 * replay gain info was available.
-	 */
-	unsigned replay_gain_serial;
-
-	/**
-	 * The serial number of the last replay gain info by the
-	 * "other" chunk during cross-fading.
-	 */
-	unsigned other_replay_gain_serial;
-
-	/**
-	 * The replay_gain_filter_plugin instance of this audio
+	 * ReplayGain, cross-fading and the filter chain of this audio
 	 * output.
 	 */
-	std::unique_ptr<Filter> replay_gain_filter;
-
-	/**
-	 * The replay_gain_filter_plugin instance of this audio
-	 * output, to be applied to the second chunk during
-	 * cross-fading.
-	 */
-	std::unique_ptr<Filter> other_replay_gain_filter;
+	ChunkFilter filter;
 
 	/**
-	 * The buffer used to allocate the cross-fading result.
+	 * If not nullptr, then this output uses the conversion
+	 * results of a #SharedConversion instead of #filter.
 	 */
-	PcmBuffer cross_fade_buffer;
+	SharedConversion *shared_conversion = nullptr;
 
 	/**
-	 * The dithering state for cross-fading two streams.
+	 * The owner of #shared_conversion.
 	 */
-	PcmDither cross_fade_dither;
+	SharedConversionCache *shared_conversion_cache;
 
 	/**
-	 * The filter object of this audio output.  This is an
-	 * instance of chain_filter_plugin.
+	 * Has SharedConversion::Flush() already been returned by
+	 * Flush()?
 	 */
-	std::unique_ptr<Filter> filter;
+	bool shared_flushed;
 
 	/**
 	 * The #MusicChunk currently being processed (see
@@ -143,6 +124,20 @@ public:
 	void Close() noexcept;
 	void Cancel() noexcept;
 
+	/**
+	 * Use the conversion results of a #SharedConversion instead
+	 * of converting privately.  This may only be used if the
+	 * filter chain passed to Open() consists only of the
+	 * "convert" filter, and after it has been configured for
+	 * the given output format.
+	 *
+	 * Throws on error.
+	 */
+	void ShareConversion(SharedConversionCache &cache,
+			     AudioFormat out_audio_format,
+			     PreparedFilter *prepared_replay_gain_filter,
+			     PreparedFilter *prepared_other_replay_gain_filter);
+
 	/**
 	 * Ensure that ReadTag() or PeekData() return any input.
 	 *
@@ -193,22 +188,38 @@ public:
 		pipe.ClearTail(chunk);
 	}
 
+	/**
+	 * See SharedPipeConsumer::GetBacklog().
+	 */
+	[[gnu::pure]]
+	unsigned GetBacklog() const noexcept {
+		return pipe.GetBacklog();
+	}
+
+	/**
+	 * See SharedPipeConsumer::GetBacklogSize().
+	 */
+	[[gnu::pure]]
+	std::size_t GetBacklogSize() const noexcept {
+		return pipe.GetBacklogSize();
+	}
+
+	/**
+	 * Drop all pending data and skip all chunks which are
+	 * currently in the pipe.
+	 */
+	void Skip() noexcept;
+
 	/**
 	 * Wrapper for Filter::Flush().
 	 */
 	std::span<const std::byte> Flush();
 
 private:
-	void OpenFilter(AudioFormat audio_format,
-			PreparedFilter *prepared_replay_gain_filter,
-			PreparedFilter *prepared_other_replay_gain_filter,
-			PreparedFilter &prepared_filter);
-
-	void CloseFilter() noexcept;
-
-	std::span<const std::byte> GetChunkData(const MusicChunk &chunk,
-				       Filter *replay_gain_filter,
-				       unsigned *replay_gain_serial_p);
+	/**
+	 * Stop using #shared_conversion (if any).
+	 */
+	void UnshareConversion() noexcept;
 
 	std::span<const std::byte> FilterChunk(const MusicChunk &chunk);
 
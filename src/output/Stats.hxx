@@ -0,0 +1,134 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_STATS_HXX
+#define MPD_OUTPUT_STATS_HXX
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A histogram with power-of-two buckets: bucket 0 counts the value
+ * 0, and bucket i counts values from 2^(i-1) to 2^i-1.  The last
+ * bucket also counts all larger values.
+ */
+template<std::size_t N>
+class Log2Histogram {
+	std::array<uint_least64_t, N> buckets{};
+
+public:
+	static constexpr std::size_t size() noexcept {
+		return N;
+	}
+
+	static constexpr std::size_t BucketOf(uint_least64_t value) noexcept {
+		return std::min<std::size_t>(std::bit_width(value), N - 1);
+	}
+
+	/**
+	 * Returns the smallest value counted by the given bucket.
+	 */
+	static constexpr uint_least64_t LowerBound(std::size_t i) noexcept {
+		return i == 0 ? 0 : uint_least64_t(1) << (i - 1);
+	}
+
+	void Add(uint_least64_t value) noexcept {
+		++buckets[BucketOf(value)];
+	}
+
+	constexpr uint_least64_t operator[](std::size_t i) const noexcept {
+		return buckets[i];
+	}
+};
+
+/**
+ * Health counters of one audio output, to be shown by the
+ * "outputstats" command.
+ */
+struct AudioOutputStats {
+	/**
+	 * The number of AudioOutput::Play() calls.
+	 */
+	uint_least64_t play_calls = 0;
+
+	/**
+	 * The number of bytes consumed by AudioOutput::Play().
+	 */
+	uint_least64_t play_bytes = 0;
+
+	/**
+	 * The total and the maximum time spent in AudioOutput::Play().
+	 */
+	std::chrono::steady_clock::duration play_time{}, max_play_time{};
+
+	/**
+	 * The duration of AudioOutput::Play() calls in microseconds.
+	 */
+	Log2Histogram<24> play_time_histogram;
+
+	/**
+	 * The number of chunks in the #MusicPipe which this output
+	 * has not played yet, as sampled most recently.
+	 */
+	unsigned backlog = 0;
+
+	/**
+	 * All #backlog samples.
+	 */
+	Log2Histogram<16> backlog_histogram;
+
+	/**
+	 * The most recent value returned by AudioOutput::Delay().
+	 */
+	std::chrono::steady_clock::duration delay{};
+
+	/**
+	 * The number of buffer underruns reported by the plugin (see
+	 * AudioOutput::CountUnderrun()).
+	 */
+	unsigned underruns = 0;
+
+	/**
+	 * How often was this output skipped ahead because it
+	 * exceeded its "max_lag" setting?
+	 */
+	unsigned lag_skips = 0;
+
+	void AddPlay(std::chrono::steady_clock::duration duration,
+		     std::size_t nbytes) noexcept {
+		++play_calls;
+		play_bytes += nbytes;
+		play_time += duration;
+		max_play_time = std::max(max_play_time, duration);
+
+		const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		play_time_histogram.Add(std::max<decltype(us)>(us, 0));
+	}
+
+	void AddBacklog(unsigned n) noexcept {
+		backlog = n;
+		backlog_histogram.Add(n);
+	}
+};
+
+#endif
@@ -26,7 +26,7 @@
 #include "lib/fmt/ExceptionFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "thread/Util.hxx"
-#include "thread/Slack.hxx"
+#include "thread/Profile.hxx"
 #include "thread/Name.hxx"
 #include "util/StringBuffer.hxx"
 #include "util/ScopeExit.hxx"
@@ -123,6 +123,23 @@ AudioOutputControl::InternalDisable() noexcept
 	output->Disable();
 }
 
+inline void
+AudioOutputControl::InternalStandby(std::unique_lock<Mutex> &lock) noexcept
+{
+	assert(IsOpen());
+
+	FmtDebug(output_domain, "standby {}", GetLogName());
+
+	/* the chunks in the source will not be played; playback
+	   resumes with whatever is current when the output is
+	   enabled again */
+	source.Cancel();
+
+	in_standby = true;
+	InternalPause(lock);
+	in_standby = false;
+}
+
 inline void
 AudioOutputControl::InternalOpen(const AudioFormat in_audio_format,
 				 const MusicPipe &pipe) noexcept
@@ -161,6 +178,21 @@ AudioOutputControl::InternalOpen(const AudioFormat in_audio_format,
 		return;
 	}
 
+	if (conversion_cache != nullptr && output->shareable_conversion) {
+		try {
+			source.ShareConversion(*conversion_cache,
+					       output->out_audio_format,
+					       output->prepared_replay_gain_filter.get(),
+					       output->prepared_other_replay_gain_filter.get());
+		} catch (...) {
+			/* not fatal, this output will keep using its
+			   own filter */
+			FmtError(output_domain,
+				 "Failed to share conversion for {}: {}",
+				 GetLogName(), std::current_exception());
+		}
+	}
+
 	if (f != in_audio_format || f != output->out_audio_format)
 		FmtDebug(output_domain, "converting in={} -> f={} -> out={}",
 			 in_audio_format, f, output->out_audio_format);
@@ -210,10 +242,12 @@ AudioOutputControl::WaitForDelay(std::unique_lock<Mutex> &lock) noexcept
 {
 	while (true) {
 		const auto delay = output->Delay();
+		stats.delay = delay;
 		if (delay <= std::chrono::steady_clock::duration::zero())
 			return true;
 
 		(void)wake_cond.wait_for(lock, delay);
+		CountThreadWakeup(ThreadProfileType::OUTPUT);
 
 		if (command != Command::NONE)
 			return false;
@@ -262,10 +296,13 @@ AudioOutputControl::PlayChunk(std::unique_lock<Mutex> &lock) noexcept
 			break;
 
 		size_t nbytes;
+		std::chrono::steady_clock::duration play_duration;
 
 		try {
 			const ScopeUnlock unlock(mutex);
+			const auto start = std::chrono::steady_clock::now();
 			nbytes = output->Play(data);
+			play_duration = std::chrono::steady_clock::now() - start;
 			assert(nbytes > 0);
 			assert(nbytes <= data.size());
 		} catch (AudioOutputInterrupted) {
@@ -281,6 +318,7 @@ AudioOutputControl::PlayChunk(std::unique_lock<Mutex> &lock) noexcept
 
 		assert(nbytes % output->out_audio_format.GetFrameSize() == 0);
 
+		stats.AddPlay(play_duration, nbytes);
 		source.ConsumeData(nbytes);
 
 		/* there's data to be drained from now on */
@@ -307,11 +345,15 @@ AudioOutputControl::InternalPlay(std::unique_lock<Mutex> &lock) noexcept
 
 	unsigned n = 0;
 
+	stats.AddBacklog(source.GetBacklog());
+
 	do {
 		if (command != Command::NONE)
 			return true;
 
 		if (++n >= 64) {
+			stats.AddBacklog(source.GetBacklog());
+
 			/* wake up the player every now and then to
 			   give it a chance to refill the pipe before
 			   it runs empty */
@@ -424,15 +466,14 @@ AudioOutputControl::Task() noexcept
 	FormatThreadName("output:%s", GetName().c_str());
 
 	try {
-		SetThreadRealtime();
+		if (!ApplyThreadProfile(ThreadProfileType::OUTPUT))
+			SetThreadRealtime();
 	} catch (...) {
 		FmtInfo(output_domain,
 			"OutputThread could not get realtime scheduling, continuing anyway: {}",
 			std::current_exception());
 	}
 
-	SetThreadTimerSlack(std::chrono::microseconds(100));
-
 	std::unique_lock<Mutex> lock(mutex);
 
 	while (true) {
@@ -449,6 +490,7 @@ AudioOutputControl::Task() noexcept
 
 			woken_for_play = false;
 			wake_cond.wait(lock);
+			CountThreadWakeup(ThreadProfileType::OUTPUT);
 			break;
 
 		case Command::ENABLE:
@@ -457,6 +499,12 @@ AudioOutputControl::Task() noexcept
 			break;
 
 		case Command::DISABLE:
+			if (standby && open) {
+				caught_interrupted = false;
+				InternalStandby(lock);
+				break;
+			}
+
 			InternalDisable();
 			CommandFinished();
 			break;
@@ -533,6 +581,23 @@ AudioOutputControl::Task() noexcept
 			CommandFinished();
 			break;
 
+		case Command::SKIP:
+			caught_interrupted = false;
+
+			if (open) {
+				source.Skip();
+				++stats.lag_skips;
+
+				/* this also resets the plugin's
+				   "interrupted" flag */
+				playing = false;
+				const ScopeUnlock unlock(mutex);
+				output->Cancel();
+			}
+
+			CommandFinished();
+			break;
+
 		case Command::KILL:
 			InternalDisable();
 			source.Cancel();
@@ -22,15 +22,17 @@
 
 #include <cassert>
 
-Timer::Timer(const AudioFormat af) noexcept
-	:rate(af.sample_rate * af.GetFrameSize())
+Timer::Timer(const AudioFormat af, Clock::duration _granularity) noexcept
+	:rate(af.sample_rate * af.GetFrameSize()),
+	 granularity(_granularity)
 {
 }
 
 void
-Timer::Start() noexcept
+Timer::Start(Clock::time_point now) noexcept
 {
-	time = Now();
+	start_time = now;
+	position = 0;
 	started = true;
 }
 
@@ -45,19 +47,32 @@ Timer::Add(size_t size) noexcept
 {
 	assert(started);
 
-	// (size samples) / (rate samples per second) = duration seconds
-	// duration seconds * 1000000 = duration us
-	time += Time(((uint64_t)size * Time::period::den) / (Time::period::num * rate));
+	position += size;
 }
 
-std::chrono::steady_clock::duration
-Timer::GetDelay() const noexcept
+Timer::Clock::time_point
+Timer::GetTargetTime() const noexcept
 {
 	assert(started);
 
-	const auto delay = time - Now();
-	if (delay < Time::zero())
-		return Time::zero();
+	using Period = Clock::duration::period;
 
-	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+	/* split into whole seconds and the remainder to avoid
+	   integer overflows */
+	const uint_least64_t seconds = position / rate;
+	const uint_least64_t remainder = position % rate;
+
+	return start_time + std::chrono::seconds(seconds) +
+		Clock::duration((remainder * Period::den) /
+				(Period::num * rate));
+}
+
+Timer::Clock::duration
+Timer::GetDelay(Clock::time_point now) const noexcept
+{
+	const auto delay = GetTargetTime() - now;
+	if (delay <= granularity)
+		return Clock::duration::zero();
+
+	return delay;
 }
@@ -21,36 +21,74 @@
 #define MPD_TIMER_HXX
 
 #include <chrono>
+#include <cstdint>
 
 struct AudioFormat;
 
+/**
+ * Paces playback for outputs which do not block on their own (e.g.
+ * network streams).  The target time is always calculated from the
+ * total number of bytes since Start(), so rounding errors do not
+ * accumulate.
+ */
 class Timer {
-	typedef std::chrono::microseconds Time;
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	Clock::time_point start_time;
+
+	/**
+	 * The number of bytes added since Start().
+	 */
+	uint_least64_t position;
+
+	/**
+	 * The number of bytes per second.
+	 */
+	const uint_least64_t rate;
+
+	/**
+	 * Delays shorter than this are not waited for, which lets
+	 * the output submit data in larger batches.
+	 */
+	const Clock::duration granularity;
 
-	Time time;
 	bool started = false;
-	const int rate;
+
 public:
-	explicit Timer(AudioFormat af) noexcept;
+	explicit Timer(AudioFormat af,
+		       Clock::duration _granularity=Clock::duration::zero()) noexcept;
 
 	bool IsStarted() const noexcept { return started; }
 
-	void Start() noexcept;
+	void Start() noexcept {
+		Start(Clock::now());
+	}
+
+	void Start(Clock::time_point now) noexcept;
+
 	void Reset() noexcept;
 
 	void Add(size_t size) noexcept;
 
 	/**
-	 * Returns the duration to sleep to get back to sync.
+	 * Returns the time when all data added so far will have
+	 * been played.
 	 */
 	[[gnu::pure]]
-	std::chrono::steady_clock::duration GetDelay() const noexcept;
+	Clock::time_point GetTargetTime() const noexcept;
 
-private:
+	/**
+	 * Returns the duration to sleep to get back to sync.
+	 */
 	[[gnu::pure]]
-	static Time Now() noexcept {
-		return std::chrono::duration_cast<Time>(std::chrono::steady_clock::now().time_since_epoch());
+	Clock::duration GetDelay() const noexcept {
+		return GetDelay(Clock::now());
 	}
+
+	[[gnu::pure]]
+	Clock::duration GetDelay(Clock::time_point now) const noexcept;
 };
 
 #endif
@@ -34,6 +34,7 @@
 #include "system/PeriodClock.hxx"
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
+#include "thread/Profile.hxx"
 #include "util/Manual.hxx"
 #include "util/Domain.hxx"
 #include "event/MultiSocketMonitor.hxx"
@@ -56,6 +57,12 @@ static const char default_device[] = "default";
 
 static constexpr unsigned MPD_ALSA_BUFFER_TIME_US = 500000;
 
+/**
+ * The default buffer_time for the "efficiency" power profile: a
+ * large buffer which needs to be refilled only rarely.
+ */
+static constexpr unsigned MPD_ALSA_EFFICIENCY_BUFFER_TIME_US = 2000000;
+
 class AlsaOutput final
 	: AudioOutput, MultiSocketMonitor {
 
@@ -125,6 +132,13 @@ class AlsaOutput final
 	/** the mode flags passed to snd_pcm_open */
 	const int mode;
 
+	/**
+	 * Use the mmap transfer mode?  If enabled, data is copied
+	 * from the #ring_buffer right into the device's DMA buffer,
+	 * bypassing the #period_buffer.
+	 */
+	const bool use_mmap;
+
 	std::forward_list<Alsa::AllowedFormat> allowed_formats;
 
 	/**
@@ -379,6 +393,15 @@ private:
 
 	snd_pcm_sframes_t WriteFromPeriodBuffer() noexcept;
 
+	/**
+	 * Copy as much data as possible from the #ring_buffer into
+	 * the mmap area and commit it.  Only used with #use_mmap.
+	 *
+	 * @return the number of frames written (0 if the
+	 * #ring_buffer is empty) or a negative error code
+	 */
+	snd_pcm_sframes_t CopyRingToMmap() noexcept;
+
 	void LockCaughtError() noexcept {
 		period_buffer.Clear();
 
@@ -450,9 +473,15 @@ AlsaOutput::AlsaOutput(EventLoop &_loop, const ConfigBlock &block)
 						     false)),
 #endif
 	 buffer_time(block.GetPositiveValue("buffer_time",
-					    MPD_ALSA_BUFFER_TIME_US)),
-	 period_time(block.GetPositiveValue("period_time", 0U)),
-	 mode(GetAlsaOpenMode(block))
+					    GetPowerProfile() == PowerProfile::EFFICIENCY
+					    ? MPD_ALSA_EFFICIENCY_BUFFER_TIME_US
+					    : MPD_ALSA_BUFFER_TIME_US)),
+	 period_time(block.GetPositiveValue("period_time",
+					    GetPowerProfile() == PowerProfile::EFFICIENCY
+					    ? buffer_time / 4
+					    : 0U)),
+	 mode(GetAlsaOpenMode(block)),
+	 use_mmap(block.GetBlockValue("mmap", false))
 {
 	const char *allowed_formats_string =
 		block.GetBlockValue("allowed_formats", nullptr);
@@ -557,7 +586,8 @@ AlsaOutput::Setup(AudioFormat &audio_format,
 {
 	const auto hw_result = Alsa::SetupHw(pcm,
 					     buffer_time, period_time,
-					     audio_format, params);
+					     audio_format, params,
+					     use_mmap);
 
 	FmtDebug(alsa_output_domain, "format={} ({})",
 		 snd_pcm_format_name(hw_result.format),
@@ -906,6 +936,7 @@ inline int
 AlsaOutput::Recover(int err) noexcept
 {
 	if (err == -EPIPE) {
+		CountUnderrun();
 		FmtDebug(alsa_output_domain,
 			 "Underrun on ALSA device \"{}\"",
 			 GetDevice());
@@ -982,8 +1013,11 @@ AlsaOutput::WriteFromPeriodBuffer() noexcept
 	assert(period_buffer.IsFull());
 	assert(period_buffer.GetFrames(out_frame_size) > 0);
 
-	auto frames_written = snd_pcm_writei(pcm, period_buffer.GetHead(),
-					     period_buffer.GetFrames(out_frame_size));
+	auto frames_written = use_mmap
+		? snd_pcm_mmap_writei(pcm, period_buffer.GetHead(),
+				      period_buffer.GetFrames(out_frame_size))
+		: snd_pcm_writei(pcm, period_buffer.GetHead(),
+				 period_buffer.GetFrames(out_frame_size));
 	if (frames_written > 0) {
 		written = true;
 		period_buffer.ConsumeFrames(frames_written,
@@ -993,6 +1027,47 @@ AlsaOutput::WriteFromPeriodBuffer() noexcept
 	return frames_written;
 }
 
+snd_pcm_sframes_t
+AlsaOutput::CopyRingToMmap() noexcept
+{
+	assert(use_mmap);
+	assert(period_buffer.IsCleared());
+
+	snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+	if (avail <= 0)
+		return avail;
+
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames = avail;
+	int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+	if (err < 0)
+		return err;
+
+	/* with interleaved access, all channels share one area */
+	assert(areas[0].first % 8 == 0);
+	assert(areas[0].step == out_frame_size * 8);
+
+	auto *dest = (std::byte *)areas[0].addr + areas[0].first / 8 +
+		offset * out_frame_size;
+	const size_t nbytes =
+		ring_buffer.ReadFramesTo({dest, frames * out_frame_size},
+					 out_frame_size);
+
+	const auto committed =
+		snd_pcm_mmap_commit(pcm, offset, nbytes / out_frame_size);
+	if (committed <= 0)
+		return committed;
+
+	written = true;
+
+	const std::scoped_lock<Mutex> lock(mutex);
+	/* notify the OutputThread that there is now
+	   room in ring_buffer */
+	cond.notify_one();
+
+	return committed;
+}
+
 inline bool
 AlsaOutput::DrainInternal()
 {
@@ -1296,6 +1371,27 @@ try {
 		}
 	}
 
+	if (use_mmap && period_buffer.IsCleared()) {
+		/* fast path: copy from the ring_buffer right into
+		   the DMA buffer; if it is empty, fall back to the
+		   period_buffer code below, which decides whether to
+		   wait or to generate silence */
+		const auto frames_written = CopyRingToMmap();
+		if (frames_written > 0)
+			return;
+
+		if (frames_written < 0) {
+			if (frames_written == -EAGAIN || frames_written == -EINTR)
+				return;
+
+			if (Recover(frames_written) < 0)
+				throw Alsa::MakeError(frames_written,
+						      "snd_pcm_mmap_commit() failed");
+
+			return;
+		}
+	}
+
 	CopyRingToPeriodBuffer();
 
 	if (!period_buffer.IsFull()) {
@@ -1345,6 +1441,8 @@ try {
 			return;
 		}
 
+		CountUnderrun();
+
 		if (throttle_silence_log.CheckUpdate(std::chrono::seconds(5)))
 			LogWarning(alsa_output_domain, "Decoder is too slow; playing silence to avoid xrun");
 
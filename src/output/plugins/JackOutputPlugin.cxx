@@ -26,17 +26,20 @@
 #include "thread/Mutex.hxx"
 #include "util/ScopeExit.hxx"
 #include "util/IterableSplitString.hxx"
+#include "util/RingBuffer.hxx"
 #include "util/SpanCast.hxx"
 #include "util/Domain.hxx"
 #include "Log.hxx"
 
+#include <fmt/format.h>
+
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <span>
 
 #include <jack/jack.h>
 #include <jack/types.h>
-#include <jack/ringbuffer.h>
 
 #include <unistd.h> /* for usleep() */
 #include <stdlib.h>
@@ -69,6 +72,9 @@ class JackOutput final : public AudioOutput {
 	/* overrides num_destination_ports*/
 	bool auto_destination_ports;
 
+	/**
+	 * The configured ring buffer size per channel in bytes.
+	 */
 	size_t ringbuffer_size;
 
 	/* the current audio format */
@@ -77,7 +83,27 @@ class JackOutput final : public AudioOutput {
 	/* jack library stuff */
 	jack_port_t *ports[MAX_PORTS];
 	jack_client_t *client;
-	jack_ringbuffer_t *ringbuffer[MAX_PORTS];
+
+	/**
+	 * Interleaved samples from Play() to the "process" callback,
+	 * which deinterleaves them directly into the port buffers.
+	 * Its capacity is a multiple of the channel count, so a
+	 * contiguous read never splits a frame.
+	 */
+	RingBuffer<jack_default_audio_sample_t> ring;
+
+	/**
+	 * The number of channels #ring was allocated for.
+	 */
+	unsigned ring_channels = 0;
+
+	/**
+	 * Statistics of the "process" callback for GetAttributes():
+	 * the JACK period and the time spent in the callback.
+	 */
+	std::atomic<jack_nframes_t> period_frames{0};
+	std::atomic_uint_least64_t process_count{0};
+	std::atomic_uint_least64_t process_ns_total{0}, process_ns_max{0};
 
 	/**
 	 * While this flag is set, the "process" callback generates
@@ -141,16 +167,16 @@ private:
 	void Stop() noexcept;
 
 	/**
-	 * Determine the number of frames guaranteed to be available
-	 * on all channels.
+	 * Determine the number of frames available in the #ring.
 	 */
 	gcc_pure
 	jack_nframes_t GetAvailable() const noexcept;
 
-	void Process(jack_nframes_t nframes);
+	void Process(jack_nframes_t nframes) noexcept;
+	void MeasureProcess(jack_nframes_t nframes) noexcept;
 	static int Process(jack_nframes_t nframes, void *arg) noexcept {
 		auto &j = *(JackOutput *)arg;
-		j.Process(nframes);
+		j.MeasureProcess(nframes);
 		return 0;
 	}
 
@@ -165,6 +191,8 @@ public:
 	void Enable() override;
 	void Disable() noexcept override;
 
+	std::map<std::string, std::string> GetAttributes() const noexcept override;
+
 	void Open(AudioFormat &new_audio_format) override;
 
 	void Close() noexcept override {
@@ -271,28 +299,10 @@ JackOutput::JackOutput(const ConfigBlock &block)
 inline jack_nframes_t
 JackOutput::GetAvailable() const noexcept
 {
-	size_t min = jack_ringbuffer_read_space(ringbuffer[0]);
-
-	for (unsigned i = 1; i < audio_format.channels; ++i) {
-		size_t current = jack_ringbuffer_read_space(ringbuffer[i]);
-		if (current < min)
-			min = current;
-	}
-
-	assert(min % jack_sample_size == 0);
+	const std::size_t available = ring.ReadAvailable();
+	assert(available % audio_format.channels == 0);
 
-	return min / jack_sample_size;
-}
-
-/**
- * Call jack_ringbuffer_read_advance() on all buffers in the list.
- */
-static void
-MultiReadAdvance(std::span<jack_ringbuffer_t *const> buffers,
-		 size_t size)
-{
-	for (auto *i : buffers)
-		jack_ringbuffer_read_advance(i, size);
+	return available / audio_format.channels;
 }
 
 /**
@@ -324,46 +334,71 @@ MultiWriteSilence(std::span<jack_port_t *const> ports, jack_nframes_t nframes)
 }
 
 /**
- * Copy data from the buffer to the port.  If the buffer underruns,
- * fill with silence.
+ * Copy interleaved samples to one buffer per channel.  The channel
+ * count is a template parameter for the common layouts, which lets
+ * the compiler unroll and vectorize the inner loop.
  */
+template<unsigned CHANNELS>
 static void
-Copy(jack_port_t &dest, jack_nframes_t nframes,
-     jack_ringbuffer_t &src, jack_nframes_t available)
+Deinterleave(jack_default_audio_sample_t *const*dest, std::size_t offset,
+	     const jack_default_audio_sample_t *src,
+	     std::size_t n_frames) noexcept
 {
-	auto *out =
-		(jack_default_audio_sample_t *)
-		jack_port_get_buffer(&dest, nframes);
-	if (out == nullptr)
-		/* workaround for libjack1 bug: if the server
-		   connection fails, the process callback is
-		   invoked anyway, but unable to get a
-		   buffer */
+	for (unsigned c = 0; c < CHANNELS; ++c) {
+		auto *d = dest[c] + offset;
+		const auto *s = src + c;
+		for (std::size_t i = 0; i < n_frames; ++i)
+			d[i] = s[i * CHANNELS];
+	}
+}
+
+static void
+Deinterleave(jack_default_audio_sample_t *const*dest, std::size_t offset,
+	     const jack_default_audio_sample_t *src,
+	     std::size_t n_frames, unsigned channels) noexcept
+{
+	switch (channels) {
+	case 1:
+		std::copy_n(src, n_frames, dest[0] + offset);
 		return;
 
-	/* copy from buffer to port */
-	jack_ringbuffer_read(&src, (char *)out,
-			     available * jack_sample_size);
+	case 2:
+		Deinterleave<2>(dest, offset, src, n_frames);
+		return;
 
-	/* ringbuffer underrun, fill with silence */
-	std::fill(out + available, out + nframes, 0.0);
+	case 4:
+		Deinterleave<4>(dest, offset, src, n_frames);
+		return;
+
+	case 6:
+		Deinterleave<6>(dest, offset, src, n_frames);
+		return;
+
+	case 8:
+		Deinterleave<8>(dest, offset, src, n_frames);
+		return;
+	}
+
+	for (unsigned c = 0; c < channels; ++c) {
+		auto *d = dest[c] + offset;
+		const auto *s = src + c;
+		for (std::size_t i = 0; i < n_frames; ++i)
+			d[i] = s[i * channels];
+	}
 }
 
 inline void
-JackOutput::Process(jack_nframes_t nframes)
+JackOutput::Process(jack_nframes_t nframes) noexcept
 {
 	if (nframes <= 0)
 		return;
 
-	jack_nframes_t available = GetAvailable();
-
 	const unsigned n_channels = audio_format.channels;
 
 	if (pause) {
-		/* empty the ring buffers */
+		/* empty the ring buffer */
 
-		MultiReadAdvance({ringbuffer, n_channels},
-				 available * jack_sample_size);
+		ring.Discard();
 
 		/* generate silence while MPD is paused */
 
@@ -372,11 +407,40 @@ JackOutput::Process(jack_nframes_t nframes)
 		return;
 	}
 
-	if (available > nframes)
-		available = nframes;
+	jack_default_audio_sample_t *out[MAX_PORTS];
+	for (unsigned i = 0; i < n_channels; ++i) {
+		out[i] = (jack_default_audio_sample_t *)
+			jack_port_get_buffer(ports[i], nframes);
+		if (out[i] == nullptr)
+			/* workaround for libjack1 bug: if the server
+			   connection fails, the process callback is
+			   invoked anyway, but unable to get a
+			   buffer */
+			return;
+	}
+
+	jack_nframes_t available = std::min(GetAvailable(), nframes);
+
+	/* deinterleave from the ring buffer into the port buffers
+	   (in two steps if the readable area wraps around) */
+
+	std::size_t position = 0;
+	while (position < available) {
+		const auto r = ring.Read();
+		assert(r.size() % n_channels == 0);
+
+		const std::size_t n = std::min<std::size_t>(r.size() / n_channels,
+							    available - position);
+		assert(n > 0);
 
+		Deinterleave(out, position, r.data(), n, n_channels);
+		ring.Consume(n * n_channels);
+		position += n;
+	}
+
+	/* ring buffer underrun, fill with silence */
 	for (unsigned i = 0; i < n_channels; ++i)
-		Copy(*ports[i], nframes, *ringbuffer[i], available);
+		std::fill(out[i] + available, out[i] + nframes, 0.0);
 
 	/* generate silence for the unused source ports */
 
@@ -384,6 +448,49 @@ JackOutput::Process(jack_nframes_t nframes)
 			  nframes);
 }
 
+inline void
+JackOutput::MeasureProcess(jack_nframes_t nframes) noexcept
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	Process(nframes);
+
+	const uint_least64_t ns =
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	period_frames.store(nframes, std::memory_order_relaxed);
+	process_count.fetch_add(1, std::memory_order_relaxed);
+	process_ns_total.fetch_add(ns, std::memory_order_relaxed);
+
+	/* only this thread writes the maximum */
+	if (ns > process_ns_max.load(std::memory_order_relaxed))
+		process_ns_max.store(ns, std::memory_order_relaxed);
+}
+
+std::map<std::string, std::string>
+JackOutput::GetAttributes() const noexcept
+{
+	std::map<std::string, std::string> result;
+
+	const auto period = period_frames.load(std::memory_order_relaxed);
+	const auto count = process_count.load(std::memory_order_relaxed);
+	if (period == 0 || count == 0 || audio_format.sample_rate == 0)
+		return result;
+
+	const double period_ns = 1e9 * period / audio_format.sample_rate;
+	const double avg_ns =
+		double(process_ns_total.load(std::memory_order_relaxed)) / count;
+	const double max_ns =
+		process_ns_max.load(std::memory_order_relaxed);
+
+	result.emplace("period_frames", fmt::format("{}", period));
+	result.emplace("process_load_avg",
+		       fmt::format("{:.1f}%", 100 * avg_ns / period_ns));
+	result.emplace("process_load_max",
+		       fmt::format("{:.1f}%", 100 * max_ns / period_ns));
+	return result;
+}
+
 static void
 mpd_jack_error(const char *msg)
 {
@@ -445,9 +552,6 @@ mpd_jack_test_default_device()
 inline void
 JackOutput::Enable()
 {
-	for (unsigned i = 0; i < num_source_ports; ++i)
-		ringbuffer[i] = nullptr;
-
 	Connect();
 }
 
@@ -457,12 +561,8 @@ JackOutput::Disable() noexcept
 	if (client != nullptr)
 		Disconnect();
 
-	for (unsigned i = 0; i < num_source_ports; ++i) {
-		if (ringbuffer[i] != nullptr) {
-			jack_ringbuffer_free(ringbuffer[i]);
-			ringbuffer[i] = nullptr;
-		}
-	}
+	ring = {};
+	ring_channels = 0;
 }
 
 static AudioOutput *
@@ -504,19 +604,29 @@ JackOutput::Start()
 	assert(client != nullptr);
 	assert(audio_format.channels <= num_source_ports);
 
-	/* allocate the ring buffers on the first open(); these
-	   persist until MPD exits.  It's too unsafe to delete them
-	   because we can never know when mpd_jack_process() gets
-	   called */
-	for (unsigned i = 0; i < num_source_ports; ++i) {
-		if (ringbuffer[i] == nullptr)
-			ringbuffer[i] =
-				jack_ringbuffer_create(ringbuffer_size);
-
+	/* (re)allocate the ring buffer if the channel count has
+	   changed; this is safe because the client is not active
+	   (Stop() has called jack_deactivate()), so the "process"
+	   callback cannot run */
+	const unsigned n_channels = audio_format.channels;
+	if (ring_channels != n_channels) {
+		const std::size_t frames =
+			std::max<std::size_t>(ringbuffer_size / jack_sample_size,
+					      2);
+
+		/* RingBuffer allocates one more item than requested;
+		   make the allocation a multiple of the channel count */
+		ring = RingBuffer<jack_default_audio_sample_t>(frames * n_channels - 1);
+		ring_channels = n_channels;
+	} else
 		/* clear the ring buffer to be sure that data from
 		   previous playbacks are gone */
-		jack_ringbuffer_reset(ringbuffer[i]);
-	}
+		ring.Clear();
+
+	period_frames.store(0, std::memory_order_relaxed);
+	process_count.store(0, std::memory_order_relaxed);
+	process_ns_total.store(0, std::memory_order_relaxed);
+	process_ns_max.store(0, std::memory_order_relaxed);
 
 	if ( jack_activate(client) ) {
 		Stop();
@@ -656,38 +766,9 @@ JackOutput::WriteSamples(const float *src, size_t n_frames)
 
 	const unsigned n_channels = audio_format.channels;
 
-	float *dest[MAX_CHANNELS];
-	size_t space = SIZE_MAX;
-	for (unsigned i = 0; i < n_channels; ++i) {
-		jack_ringbuffer_data_t d[2];
-		jack_ringbuffer_get_write_vector(ringbuffer[i], d);
-
-		/* choose the first non-empty writable area */
-		const jack_ringbuffer_data_t &e = d[d[0].len == 0];
-
-		if (e.len < space)
-			/* send data symmetrically */
-			space = e.len;
-
-		dest[i] = (float *)e.buf;
-	}
-
-	space /= jack_sample_size;
-	if (space == 0)
-		return 0;
-
-	const size_t result = n_frames = std::min(space, n_frames);
-
-	while (n_frames-- > 0)
-		for (unsigned i = 0; i < n_channels; ++i)
-			*dest[i]++ = *src++;
-
-	const size_t per_channel_advance = result * jack_sample_size;
-	for (unsigned i = 0; i < n_channels; ++i)
-		jack_ringbuffer_write_advance(ringbuffer[i],
-					      per_channel_advance);
-
-	return result;
+	/* copy interleaved; the "process" callback deinterleaves */
+	return ring.WriteFramesFrom({src, n_frames * n_channels},
+				    n_channels) / n_channels;
 }
 
 std::size_t
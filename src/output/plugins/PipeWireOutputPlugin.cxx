@@ -35,6 +35,8 @@
 #include "tag/Format.hxx"
 #include "config.h" // for ENABLE_DSD
 
+#include <fmt/core.h>
+
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 /* oh no, libspa likes to cast away "const"! */
@@ -55,6 +57,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <numeric>
 #include <stdexcept>
 #include <string>
@@ -155,6 +158,20 @@ class PipeWireOutput final : AudioOutput {
 
 	bool drained;
 
+	/**
+	 * The number of frames PipeWire requested in the most recent
+	 * Process() call, i.e. the graph's quantum.  Zero if
+	 * unknown.  Written by the PipeWire thread, read by
+	 * GetAttributes().
+	 */
+	std::atomic_uint_least32_t quantum{0};
+
+	/**
+	 * The most recent delay reported by pw_stream_get_time_n()
+	 * in microseconds.  -1 if unknown.
+	 */
+	std::atomic_int_least64_t latency_us{-1};
+
 	explicit PipeWireOutput(const ConfigBlock &block);
 
 public:
@@ -209,6 +226,11 @@ private:
 
 	void Process() noexcept;
 
+	/**
+	 * Update #latency_us.  Called by Process().
+	 */
+	void UpdateTime() noexcept;
+
 	static void Process(void *data) noexcept {
 		auto &o = *(PipeWireOutput *)data;
 		o.Process();
@@ -296,6 +318,8 @@ private:
 	bool Pause() noexcept override;
 
 	void SendTag(const Tag &tag) override;
+
+	std::map<std::string, std::string> GetAttributes() const noexcept override;
 };
 
 static constexpr auto stream_events = PipeWireOutput::MakeStreamEvents();
@@ -569,6 +593,8 @@ PipeWireOutput::Open(AudioFormat &audio_format)
 	sample_format = audio_format.format;
 	channels = audio_format.channels;
 	interrupted = false;
+	quantum.store(0, std::memory_order_relaxed);
+	latency_us.store(-1, std::memory_order_relaxed);
 
 	/* allocate a ring buffer of 0.5 seconds */
 	ring_buffer = RingBuffer{frame_size * (audio_format.sample_rate / 2)};
@@ -723,13 +749,6 @@ Interleave(std::byte *data, std::byte *end,
 	}
 }
 
-static void
-BitReverse(uint8_t *data, std::size_t n) noexcept
-{
-	while (n-- > 0)
-		*data = bit_reverse(*data);
-}
-
 static void
 BitReverse(std::byte *data, std::size_t n) noexcept
 {
@@ -780,7 +799,20 @@ PipeWireOutput::Process() noexcept
 	}
 #endif
 
-	size_t nbytes = ring_buffer.ReadFramesTo({dest, d.maxsize}, chunk_size);
+	std::size_t max_size = d.maxsize;
+
+#if PW_CHECK_VERSION(0, 3, 49)
+	if (b->requested > 0) {
+		/* fill only what PipeWire asks for (one quantum)
+		   instead of the whole buffer; everything more would
+		   only add latency */
+		max_size = std::min<std::size_t>(max_size,
+						 b->requested * chunk_size);
+		quantum.store(b->requested, std::memory_order_relaxed);
+	}
+#endif
+
+	size_t nbytes = ring_buffer.ReadFramesTo({dest, max_size}, chunk_size);
 	assert(nbytes % chunk_size == 0);
 	if (nbytes == 0) {
 		if (drain_requested) {
@@ -789,10 +821,11 @@ PipeWireOutput::Process() noexcept
 		}
 
 		/* buffer underrun: generate some silence */
-		std::size_t max_chunks = d.maxsize / chunk_size;
+		std::size_t max_chunks = max_size / chunk_size;
 		nbytes = max_chunks * chunk_size;
 		PcmSilence({dest, nbytes}, sample_format);
 
+		CountUnderrun();
 		LogWarning(pipewire_output_domain, "Decoder is too slow; playing silence to avoid xrun");
 	}
 
@@ -809,9 +842,27 @@ PipeWireOutput::Process() noexcept
 
 	pw_stream_queue_buffer(stream, b);
 
+	UpdateTime();
+
 	pw_thread_loop_signal(thread_loop, false);
 }
 
+inline void
+PipeWireOutput::UpdateTime() noexcept
+{
+#if PW_CHECK_VERSION(0, 3, 50)
+	struct pw_time t;
+	if (pw_stream_get_time_n(stream, &t, sizeof(t)) < 0 ||
+	    t.rate.denom == 0)
+		return;
+
+	/* the delay is measured in ticks of the graph clock */
+	const int64_t delay = t.delay * 1000000 * t.rate.num / t.rate.denom;
+	latency_us.store(std::max<int64_t>(delay, 0),
+			 std::memory_order_relaxed);
+#endif
+}
+
 std::chrono::steady_clock::duration
 PipeWireOutput::Delay() const noexcept
 {
@@ -967,6 +1018,20 @@ PipeWireOutput::SendTag(const Tag &tag)
 		LogWarning(pipewire_output_domain, "Error updating properties");
 }
 
+std::map<std::string, std::string>
+PipeWireOutput::GetAttributes() const noexcept
+{
+	std::map<std::string, std::string> result;
+
+	if (const auto q = quantum.load(std::memory_order_relaxed); q > 0)
+		result.emplace("quantum", fmt::format("{}", q));
+
+	if (const auto l = latency_us.load(std::memory_order_relaxed); l >= 0)
+		result.emplace("latency_ms", fmt::format("{:.1f}", l / 1000.));
+
+	return result;
+}
+
 void
 pipewire_output_set_mixer(PipeWireOutput &po, PipeWireMixer &pm) noexcept
 {
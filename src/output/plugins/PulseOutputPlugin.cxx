@@ -89,6 +89,10 @@ public:
 				  pa_stream_state_t new_state);
 	void OnStreamWrite(size_t nbytes);
 
+	void OnStreamUnderflow() noexcept {
+		CountUnderrun();
+	}
+
 	void OnStreamSuccess() {
 		Signal();
 	}
@@ -381,6 +385,7 @@ PulseOutput::DeleteStream()
 
 	pa_stream_set_state_callback(stream, nullptr, nullptr);
 	pa_stream_set_write_callback(stream, nullptr, nullptr);
+	pa_stream_set_underflow_callback(stream, nullptr, nullptr);
 
 	pa_stream_disconnect(stream);
 	pa_stream_unref(stream);
@@ -592,6 +597,15 @@ pulse_output_stream_write_cb([[maybe_unused]] pa_stream *stream, size_t nbytes,
 	return po.OnStreamWrite(nbytes);
 }
 
+static void
+pulse_output_stream_underflow_cb([[maybe_unused]] pa_stream *stream,
+				 void *userdata)
+{
+	PulseOutput &po = *(PulseOutput *)userdata;
+
+	po.OnStreamUnderflow();
+}
+
 inline void
 PulseOutput::SetupStream(const pa_sample_spec &ss)
 {
@@ -614,6 +628,9 @@ PulseOutput::SetupStream(const pa_sample_spec &ss)
 				     pulse_output_stream_state_cb, this);
 	pa_stream_set_write_callback(stream,
 				     pulse_output_stream_write_cb, this);
+	pa_stream_set_underflow_callback(stream,
+					 pulse_output_stream_underflow_cb,
+					 this);
 }
 
 void
@@ -18,6 +18,7 @@
  */
 
 #include "RecorderOutputPlugin.hxx"
+#include "RecorderWriter.hxx"
 #include "../OutputAPI.hxx"
 #include "lib/fmt/PathFormatter.hxx"
 #include "tag/Format.hxx"
@@ -25,9 +26,12 @@
 #include "encoder/EncoderInterface.hxx"
 #include "encoder/Configured.hxx"
 #include "config/Path.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
 #include "Log.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "io/FileOutputStream.hxx"
+#include "tag/Tag.hxx"
 #include "util/Domain.hxx"
 #include "util/ScopeExit.hxx"
 
@@ -64,9 +68,37 @@ class RecorderOutput final : AudioOutput {
 	AudioFormat effective_audio_format;
 
 	/**
-	 * The destination file.
+	 * Start a new file after this many bytes of PCM data; 0
+	 * disables segmenting.  Derived from the "segment_time"
+	 * setting and #effective_audio_format.
 	 */
-	FileOutputStream *file;
+	std::size_t segment_size = 0;
+
+	/**
+	 * The configured "segment_time" in seconds.
+	 */
+	unsigned segment_time = 0;
+
+	/**
+	 * The number of PCM bytes written to the current file.
+	 */
+	std::size_t segment_position = 0;
+
+	/**
+	 * The most recent tag, used to build the path of the next
+	 * segment.
+	 */
+	std::unique_ptr<Tag> last_tag;
+
+	/**
+	 * Writes to the destination file in a separate thread.
+	 */
+	RecorderWriter writer;
+
+	/**
+	 * Is there a destination file?
+	 */
+	bool has_file;
 
 	explicit RecorderOutput(const ConfigBlock &block);
 
@@ -102,11 +134,37 @@ private:
 
 	void FinishFormat();
 	void ReopenFormat(AllocatedPath &&new_path);
+
+	/**
+	 * Build the path from #format_path and the given tag.
+	 *
+	 * @return the path or nullptr if no path could be composed
+	 * with this tag
+	 */
+	AllocatedPath FormatPath(const Tag &tag) noexcept;
+
+	/**
+	 * Finish the current segment and start a new file.
+	 */
+	void NextSegment();
 };
 
+static uint64_t
+GetPreallocate(const ConfigBlock &block)
+{
+	const auto *param = block.GetBlockParam("preallocate");
+	if (param == nullptr)
+		return 0;
+
+	return param->With([](const char *s){
+		return ParseSize(s);
+	});
+}
+
 RecorderOutput::RecorderOutput(const ConfigBlock &block)
 	:AudioOutput(0),
-	 prepared_encoder(CreateConfiguredEncoder(block))
+	 prepared_encoder(CreateConfiguredEncoder(block)),
+	 writer(GetPreallocate(block))
 {
 	/* read configuration */
 
@@ -121,52 +179,63 @@ RecorderOutput::RecorderOutput(const ConfigBlock &block)
 
 	if (!path.IsNull() && fmt != nullptr)
 		throw std::runtime_error("Cannot have both 'path' and 'format_path'");
+
+	segment_time = block.GetBlockValue("segment_time", 0U);
+	if (segment_time > 0 && fmt == nullptr)
+		throw std::runtime_error("'segment_time' requires 'format_path'");
 }
 
 inline void
 RecorderOutput::EncoderToFile()
 {
-	assert(file != nullptr);
+	assert(has_file);
 
-	EncoderToOutputStream(*file, *encoder);
+	EncoderToOutputStream(writer, *encoder);
 }
 
 void
 RecorderOutput::Open(AudioFormat &audio_format)
 {
+	/* wait for the file of the previous session to be
+	   committed */
+	writer.Drain();
+
 	/* create the output file */
 
+	std::unique_ptr<FileOutputStream> file;
+
 	if (!HasDynamicPath()) {
 		assert(!path.IsNull());
 
-		file = new FileOutputStream(path);
+		file = std::make_unique<FileOutputStream>(path);
 	} else {
 		/* don't open the file just yet; wait until we have
 		   a tag that we can use to build the path */
 		assert(path.IsNull());
-
-		file = nullptr;
 	}
 
 	/* open the encoder */
 
-	try {
-		encoder = prepared_encoder->Open(audio_format);
-	} catch (...) {
-		delete file;
-		throw;
-	}
+	encoder = prepared_encoder->Open(audio_format);
 
 	if (!HasDynamicPath()) {
 		try {
+			writer.Open(std::move(file));
+			has_file = true;
 			EncoderToFile();
 		} catch (...) {
+			writer.Cancel();
+			has_file = false;
 			delete encoder;
 			throw;
 		}
 	} else {
+		has_file = false;
+
 		/* remember the AudioFormat for ReopenFormat() */
 		effective_audio_format = audio_format;
+		segment_size = segment_time *
+			audio_format.TimeToSize(std::chrono::seconds(1));
 
 		/* close the encoder for now; it will be opened as
 		   soon as we have received a tag */
@@ -181,32 +250,29 @@ RecorderOutput::Commit()
 
 	/* flush the encoder and write the rest to the file */
 
+	has_file = false;
+
 	try {
 		encoder->End();
 		EncoderToFile();
 	} catch (...) {
 		delete encoder;
+		writer.Cancel();
 		throw;
 	}
 
-	/* now really close everything */
+	/* now really close everything; the writer thread commits
+	   the file after all data has been written */
 
 	delete encoder;
 
-	try {
-		file->Commit();
-	} catch (...) {
-		delete file;
-		throw;
-	}
-
-	delete file;
+	writer.Commit();
 }
 
 void
 RecorderOutput::Close() noexcept
 {
-	if (file == nullptr) {
+	if (!has_file) {
 		/* not currently encoding to a file; nothing needs to
 		   be done now */
 		assert(HasDynamicPath());
@@ -224,6 +290,8 @@ RecorderOutput::Close() noexcept
 		assert(!path.IsNull());
 		path.SetNull();
 	}
+
+	last_tag.reset();
 }
 
 void
@@ -231,7 +299,7 @@ RecorderOutput::FinishFormat()
 {
 	assert(HasDynamicPath());
 
-	if (file == nullptr)
+	if (!has_file)
 		return;
 
 	try {
@@ -240,7 +308,6 @@ RecorderOutput::FinishFormat()
 		LogError(std::current_exception());
 	}
 
-	file = nullptr;
 	path.SetNull();
 }
 
@@ -249,58 +316,94 @@ RecorderOutput::ReopenFormat(AllocatedPath &&new_path)
 {
 	assert(HasDynamicPath());
 	assert(path.IsNull());
-	assert(file == nullptr);
+	assert(!has_file);
 
-	auto *new_file = new FileOutputStream(new_path);
+	auto new_file = std::make_unique<FileOutputStream>(new_path);
 
 	AudioFormat new_audio_format = effective_audio_format;
 
-	try {
-		encoder = prepared_encoder->Open(new_audio_format);
-	} catch (...) {
-		delete new_file;
-		throw;
-	}
+	encoder = prepared_encoder->Open(new_audio_format);
 
 	/* reopening the encoder must always result in the same
 	   AudioFormat as before */
 	assert(new_audio_format == effective_audio_format);
 
+	writer.Open(std::move(new_file));
+	has_file = true;
+
 	try {
-		EncoderToOutputStream(*new_file, *encoder);
+		EncoderToFile();
 	} catch (...) {
+		has_file = false;
+		writer.Cancel();
 		delete encoder;
-		delete new_file;
 		throw;
 	}
 
 	path = std::move(new_path);
-	file = new_file;
+	segment_position = 0;
 
 	FmtDebug(recorder_domain, "Recording to \"{}\"", path);
 }
 
+AllocatedPath
+RecorderOutput::FormatPath(const Tag &tag) noexcept
+{
+	char *p = FormatTag(tag, format_path.c_str());
+	if (p == nullptr || *p == 0) {
+		free(p);
+		return nullptr;
+	}
+
+	AtScopeExit(p) { free(p); };
+
+	try {
+		return ParsePath(p);
+	} catch (...) {
+		LogError(std::current_exception());
+		return nullptr;
+	}
+}
+
+void
+RecorderOutput::NextSegment()
+{
+	assert(last_tag);
+
+	segment_position = 0;
+
+	auto new_path = FormatPath(*last_tag);
+	if (new_path.IsNull() || new_path == path)
+		/* the path does not change (e.g. because
+		   "format_path" does not contain "%iso8601%");
+		   continue writing to the current file */
+		return;
+
+	FinishFormat();
+
+	try {
+		ReopenFormat(std::move(new_path));
+	} catch (...) {
+		LogError(std::current_exception());
+		return;
+	}
+
+	encoder->PreTag();
+	EncoderToFile();
+	encoder->SendTag(*last_tag);
+}
+
 void
 RecorderOutput::SendTag(const Tag &tag)
 {
 	if (HasDynamicPath()) {
-		char *p = FormatTag(tag, format_path.c_str());
-		if (p == nullptr || *p == 0) {
+		if (segment_size > 0)
+			last_tag = std::make_unique<Tag>(tag);
+
+		AllocatedPath new_path = FormatPath(tag);
+		if (new_path.IsNull()) {
 			/* no path could be composed with this tag:
 			   don't write a file */
-			free(p);
-			FinishFormat();
-			return;
-		}
-
-		AtScopeExit(p) { free(p); };
-
-		AllocatedPath new_path = nullptr;
-
-		try {
-			new_path = ParsePath(p);
-		} catch (...) {
-			LogError(std::current_exception());
 			FinishFormat();
 			return;
 		}
@@ -325,7 +428,7 @@ RecorderOutput::SendTag(const Tag &tag)
 std::size_t
 RecorderOutput::Play(std::span<const std::byte> src)
 {
-	if (file == nullptr) {
+	if (!has_file) {
 		/* not currently encoding to a file; discard incoming
 		   data */
 		assert(HasDynamicPath());
@@ -337,6 +440,12 @@ RecorderOutput::Play(std::span<const std::byte> src)
 
 	EncoderToFile();
 
+	if (segment_size > 0) {
+		segment_position += src.size();
+		if (segment_position >= segment_size)
+			NextSegment();
+	}
+
 	return src.size();
 }
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "RecorderWriter.hxx"
+#include "io/FileOutputStream.hxx"
+#include "thread/Name.hxx"
+#include "Log.hxx"
+#include "util/Domain.hxx"
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+static constexpr Domain recorder_domain("recorder");
+
+RecorderWriter::RecorderWriter(uint64_t _preallocate) noexcept
+	:preallocate(_preallocate),
+	 thread(BIND_THIS_METHOD(Run))
+{
+}
+
+RecorderWriter::~RecorderWriter() noexcept
+{
+	if (!thread.IsDefined())
+		return;
+
+	{
+		const std::scoped_lock<Mutex> lock(mutex);
+		quit = true;
+		cond.notify_one();
+	}
+
+	thread.Join();
+}
+
+void
+RecorderWriter::Push(Operation &&operation) noexcept
+{
+	queue.emplace_back(std::move(operation));
+	cond.notify_one();
+}
+
+void
+RecorderWriter::Open(std::unique_ptr<FileOutputStream> new_file)
+{
+	if (!thread.IsDefined())
+		thread.Start();
+
+	const std::scoped_lock<Mutex> lock(mutex);
+	Push({Operation::Type::OPEN, std::move(new_file), {}});
+}
+
+void
+RecorderWriter::Commit()
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+	Push({Operation::Type::COMMIT, nullptr, {}});
+	CheckError();
+}
+
+void
+RecorderWriter::Cancel() noexcept
+{
+	const std::scoped_lock<Mutex> lock(mutex);
+	Push({Operation::Type::CANCEL, nullptr, {}});
+}
+
+void
+RecorderWriter::Drain() noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+	client_cond.wait(lock, [this]{ return queue.empty() && !busy; });
+}
+
+void
+RecorderWriter::Write(const void *data, std::size_t size)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	if (queue_size >= MAX_QUEUE_SIZE) {
+		/* the disk is very slow; we have to throttle the
+		   caller, or else we run out of memory */
+		LogWarning(recorder_domain, "Disk too slow, waiting");
+		client_cond.wait(lock, [this]{
+			return queue_size < MAX_QUEUE_SIZE;
+		});
+	}
+
+	const auto *p = static_cast<const std::byte *>(data);
+
+	if (!queue.empty() &&
+	    queue.back().type == Operation::Type::WRITE &&
+	    queue.back().data.size() + size <= MAX_OPERATION_SIZE) {
+		/* merge with the previous operation */
+		auto &v = queue.back().data;
+		v.insert(v.end(), p, p + size);
+	} else
+		Push({Operation::Type::WRITE, nullptr, {p, p + size}});
+
+	queue_size += size;
+}
+
+inline void
+RecorderWriter::WriteToFile(std::span<const std::byte> src)
+{
+	if (preallocate > 0) {
+		const uint64_t end = file->Tell() + src.size();
+		if (end > allocated) {
+			file->Preallocate(preallocate);
+			allocated = file->Tell() + preallocate;
+		}
+	}
+
+	file->Write(src.data(), src.size());
+}
+
+inline void
+RecorderWriter::Execute(Operation &operation)
+{
+	switch (operation.type) {
+	case Operation::Type::OPEN:
+		assert(!file);
+		file = std::move(operation.file);
+		allocated = 0;
+		break;
+
+	case Operation::Type::WRITE:
+		if (file)
+			WriteToFile(operation.data);
+		break;
+
+	case Operation::Type::COMMIT:
+		if (file) {
+			auto f = std::move(file);
+			f->Commit();
+		}
+
+		break;
+
+	case Operation::Type::CANCEL:
+		file.reset();
+		break;
+	}
+}
+
+void
+RecorderWriter::Run() noexcept
+{
+	SetThreadName("recorder");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		if (queue.empty()) {
+			if (quit)
+				break;
+
+			cond.wait(lock);
+			continue;
+		}
+
+		auto operation = std::move(queue.front());
+		queue.pop_front();
+		busy = true;
+
+		lock.unlock();
+
+		std::exception_ptr e;
+
+		try {
+			Execute(operation);
+		} catch (...) {
+			e = std::current_exception();
+
+			/* discard the rest of this file */
+			file.reset();
+		}
+
+		lock.lock();
+
+		busy = false;
+		queue_size -= operation.data.size();
+		client_cond.notify_all();
+
+		if (e) {
+			if (operation.type == Operation::Type::COMMIT)
+				/* nobody is waiting for this */
+				LogError(e);
+			else if (!error)
+				error = std::move(e);
+		}
+	}
+
+	/* discard the file which was not committed */
+	file.reset();
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_RECORDER_WRITER_HXX
+#define MPD_RECORDER_WRITER_HXX
+
+#include "io/OutputStream.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+class FileOutputStream;
+
+/**
+ * Writes encoded data to files in a separate thread, so disk latency
+ * does not block the output thread.  Data written to this
+ * #OutputStream is copied into a queue and goes to the file passed
+ * to the most recent Open() call.  Committing a file is
+ * asynchronous, too.
+ */
+class RecorderWriter final : public OutputStream {
+	/**
+	 * If the queue grows larger than this, Write() blocks until
+	 * the disk has caught up.
+	 */
+	static constexpr std::size_t MAX_QUEUE_SIZE = 8 * 1024 * 1024;
+
+	/**
+	 * Small writes are merged into one #Operation up to this
+	 * size.
+	 */
+	static constexpr std::size_t MAX_OPERATION_SIZE = 64 * 1024;
+
+	struct Operation {
+		enum class Type {
+			OPEN,
+			WRITE,
+			COMMIT,
+			CANCEL,
+		} type;
+
+		/**
+		 * The new file for #Type::OPEN.
+		 */
+		std::unique_ptr<FileOutputStream> file;
+
+		/**
+		 * The data for #Type::WRITE.
+		 */
+		std::vector<std::byte> data;
+	};
+
+	/**
+	 * Reserve disk space in chunks of this size; 0 disables
+	 * preallocation.
+	 */
+	const uint64_t preallocate;
+
+	Thread thread;
+
+	/**
+	 * Protects all attributes below.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Wakes up the writer thread.
+	 */
+	Cond cond;
+
+	/**
+	 * Signals that the #queue has become smaller.
+	 */
+	Cond client_cond;
+
+	std::deque<Operation> queue;
+
+	/**
+	 * The sum of all #Operation::data sizes in #queue.
+	 */
+	std::size_t queue_size = 0;
+
+	/**
+	 * Is the writer thread currently executing an operation which
+	 * has already been removed from the #queue?
+	 */
+	bool busy = false;
+
+	bool quit = false;
+
+	/**
+	 * The first error which occurred while writing the current
+	 * file.  It is rethrown by the next Write() or Commit() call;
+	 * further data for this file is discarded.
+	 */
+	std::exception_ptr error;
+
+	/**
+	 * The file the writer thread is currently writing to.  Only
+	 * accessed by the writer thread.
+	 */
+	std::unique_ptr<FileOutputStream> file;
+
+	/**
+	 * The end of the disk space which has been reserved in
+	 * #file.  Only accessed by the writer thread.
+	 */
+	uint64_t allocated;
+
+public:
+	explicit RecorderWriter(uint64_t _preallocate) noexcept;
+	~RecorderWriter() noexcept;
+
+	RecorderWriter(const RecorderWriter &) = delete;
+	RecorderWriter &operator=(const RecorderWriter &) = delete;
+
+	/**
+	 * Start writing to a new file.  The previous file must have
+	 * been committed or canceled.
+	 *
+	 * Throws if the thread cannot be started.
+	 */
+	void Open(std::unique_ptr<FileOutputStream> new_file);
+
+	/**
+	 * Commit the current file after all of its data has been
+	 * written.  This does not wait; errors which occur later are
+	 * logged.
+	 *
+	 * Throws if an error has occurred while writing the file.
+	 */
+	void Commit();
+
+	/**
+	 * Discard the current file.
+	 */
+	void Cancel() noexcept;
+
+	/**
+	 * Wait until all pending operations have finished.
+	 */
+	void Drain() noexcept;
+
+	/* virtual methods from class OutputStream */
+	void Write(const void *data, std::size_t size) override;
+
+private:
+	void CheckError() {
+		if (error)
+			std::rethrow_exception(std::exchange(error, {}));
+	}
+
+	void Push(Operation &&operation) noexcept;
+
+	/**
+	 * Execute one operation.  Called in the writer thread
+	 * without holding the mutex.
+	 */
+	void Execute(Operation &operation);
+
+	void WriteToFile(std::span<const std::byte> src);
+
+	void Run() noexcept;
+};
+
+#endif
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ShmOutputPlugin.hxx"
+#include "ShmProtocol.hxx"
+#include "../OutputAPI.hxx"
+#include "../Timer.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class ShmOutput final : AudioOutput {
+	/**
+	 * The name of the POSIX shared memory object, including the
+	 * leading slash.
+	 */
+	const std::string name;
+
+	/**
+	 * The size of the whole mapping (header and ring buffer).
+	 */
+	std::size_t mapping_size;
+
+	ShmOutputHeader *header;
+	std::byte *data;
+
+	/**
+	 * A copy of ShmOutputHeader::write_position; this is the only
+	 * writer.
+	 */
+	uint64_t write_position = 0;
+
+	std::unique_ptr<Timer> timer;
+
+public:
+	explicit ShmOutput(const ConfigBlock &block);
+	~ShmOutput() noexcept override;
+
+	ShmOutput(const ShmOutput &) = delete;
+	ShmOutput &operator=(const ShmOutput &) = delete;
+
+	static AudioOutput *Create(EventLoop &,
+				   const ConfigBlock &block) {
+		return new ShmOutput(block);
+	}
+
+private:
+	/**
+	 * Increment ShmOutputHeader::futex and wake up all readers.
+	 */
+	void Notify() noexcept;
+
+	void Open(AudioFormat &audio_format) override;
+	void Close() noexcept override;
+
+	[[nodiscard]] std::chrono::steady_clock::duration Delay() const noexcept override;
+	std::size_t Play(std::span<const std::byte> src) override;
+	void Cancel() noexcept override;
+};
+
+static constexpr Domain shm_output_domain("shm_output");
+
+/**
+ * The ring buffer begins at this offset, aligned to a cache line.
+ */
+static constexpr std::size_t SHM_DATA_OFFSET = 64;
+static_assert(sizeof(ShmOutputHeader) <= SHM_DATA_OFFSET);
+
+template<typename T>
+static auto
+Atomic(T &value) noexcept
+{
+	return std::atomic_ref<T>(value);
+}
+
+ShmOutput::ShmOutput(const ConfigBlock &block)
+	:AudioOutput(0),
+	 name(std::string("/") + block.GetBlockValue("name", "mpd"))
+{
+	if (name.find('/', 1) != name.npos)
+		throw FmtRuntimeError("Invalid shared memory name: \"{}\"",
+				      name);
+
+	const std::size_t data_size =
+		std::size_t(block.GetPositiveValue("buffer_size", 1024U)) * 1024;
+	mapping_size = SHM_DATA_OFFSET + data_size;
+
+	const int fd = shm_open(name.c_str(), O_CREAT|O_RDWR|O_CLOEXEC,
+				0644);
+	if (fd < 0)
+		throw FmtErrno("Failed to create shared memory \"{}\"",
+			       name);
+
+	if (ftruncate(fd, mapping_size) < 0) {
+		const int e = errno;
+		close(fd);
+		shm_unlink(name.c_str());
+		throw FmtErrno(e, "Failed to resize shared memory \"{}\"",
+			       name);
+	}
+
+	void *p = mmap(nullptr, mapping_size, PROT_READ|PROT_WRITE,
+		       MAP_SHARED, fd, 0);
+	const int e = errno;
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		throw FmtErrno(e, "Failed to map shared memory \"{}\"",
+			       name);
+	}
+
+	header = static_cast<ShmOutputHeader *>(p);
+	data = static_cast<std::byte *>(p) + SHM_DATA_OFFSET;
+
+	/* the object may be left over from a previous MPD process
+	   which has crashed; start from scratch */
+	*header = {};
+	header->version = ShmOutputHeader::PROTOCOL_VERSION;
+	header->data_offset = SHM_DATA_OFFSET;
+	header->data_size = data_size;
+
+	/* the magic is written last; readers must not look at the
+	   rest before they see it */
+	Atomic(header->magic).store(ShmOutputHeader::MAGIC,
+				    std::memory_order_release);
+}
+
+ShmOutput::~ShmOutput() noexcept
+{
+	/* tell readers that this object is obsolete */
+	Atomic(header->magic).store(0, std::memory_order_release);
+	Atomic(header->playing).store(0, std::memory_order_release);
+	Notify();
+
+	munmap(header, mapping_size);
+
+	if (shm_unlink(name.c_str()) < 0)
+		FmtError(shm_output_domain,
+			 "Failed to remove shared memory \"{}\": {}",
+			 name, strerror(errno));
+}
+
+inline void
+ShmOutput::Notify() noexcept
+{
+	Atomic(header->futex).fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX,
+		nullptr, nullptr, 0);
+}
+
+void
+ShmOutput::Open(AudioFormat &audio_format)
+{
+	timer = std::make_unique<Timer>(audio_format);
+
+	auto serial = Atomic(header->format_serial);
+	serial.fetch_add(1, std::memory_order_acq_rel);
+
+	Atomic(header->sample_rate).store(audio_format.sample_rate,
+					  std::memory_order_relaxed);
+	Atomic(header->sample_format).store(uint8_t(audio_format.format),
+					    std::memory_order_relaxed);
+	Atomic(header->channels).store(audio_format.channels,
+				       std::memory_order_relaxed);
+	Atomic(header->format_position).store(write_position,
+					      std::memory_order_relaxed);
+
+	serial.fetch_add(1, std::memory_order_release);
+
+	Atomic(header->playing).store(1, std::memory_order_release);
+	Notify();
+}
+
+void
+ShmOutput::Close() noexcept
+{
+	Atomic(header->playing).store(0, std::memory_order_release);
+	Notify();
+
+	timer.reset();
+}
+
+void
+ShmOutput::Cancel() noexcept
+{
+	timer->Reset();
+}
+
+std::chrono::steady_clock::duration
+ShmOutput::Delay() const noexcept
+{
+	return timer->IsStarted()
+		? timer->GetDelay()
+		: std::chrono::steady_clock::duration::zero();
+}
+
+std::size_t
+ShmOutput::Play(std::span<const std::byte> src)
+{
+	const std::size_t data_size = header->data_size;
+	if (src.size() > data_size)
+		src = src.first(data_size);
+
+	if (!timer->IsStarted())
+		timer->Start();
+	timer->Add(src.size());
+
+	/* copy into the ring buffer, which may wrap around; readers
+	   which are too slow lose data, but never block us */
+	const std::size_t offset = write_position % data_size;
+	const std::size_t first = std::min(src.size(), data_size - offset);
+	std::copy_n(src.begin(), first, data + offset);
+	std::copy(src.begin() + first, src.end(), data);
+
+	write_position += src.size();
+	Atomic(header->write_position).store(write_position,
+					     std::memory_order_release);
+	Notify();
+
+	return src.size();
+}
+
+const struct AudioOutputPlugin shm_output_plugin = {
+	"shm",
+	nullptr,
+	&ShmOutput::Create,
+	nullptr,
+};
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Layout of the shared memory object created by the "shm" output
+ * plugin.  This header does not depend on other MPD headers, so
+ * readers may copy it.
+ *
+ * The object begins with a #ShmOutputHeader, followed by a ring
+ * buffer of ShmOutputHeader::data_size bytes at offset
+ * ShmOutputHeader::data_offset.  The byte at stream position "p" is
+ * stored at data_offset + (p % data_size).
+ *
+ * MPD never waits for readers.  A reader keeps its own read
+ * position; after copying data from the ring buffer, it must check
+ * that #write_position has not advanced by more than #data_size
+ * beyond the start of what it has copied, or else the data has been
+ * overwritten in the meantime and the reader must skip ahead.
+ *
+ * After each write, MPD increments #futex and wakes all waiters;
+ * readers may block with FUTEX_WAIT (without FUTEX_PRIVATE_FLAG) on
+ * this word.
+ *
+ * All fields which may change are accessed atomically; readers shall
+ * load them with acquire semantics.
+ */
+
+#ifndef MPD_SHM_PROTOCOL_HXX
+#define MPD_SHM_PROTOCOL_HXX
+
+#include <cstdint>
+
+struct ShmOutputHeader {
+	static constexpr uint32_t MAGIC = 0x5344504d; // "MPDS"
+	static constexpr uint32_t PROTOCOL_VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+
+	/**
+	 * The offset of the ring buffer from the beginning of the
+	 * object.
+	 */
+	uint32_t data_offset;
+
+	/**
+	 * The size of the ring buffer in bytes.
+	 */
+	uint32_t data_size;
+
+	/**
+	 * Incremented before and after the audio format is changed,
+	 * i.e. the audio format fields may be inconsistent while
+	 * this number is odd.
+	 */
+	uint32_t format_serial;
+
+	uint32_t sample_rate;
+
+	/**
+	 * The sample format: 1=S8, 2=S16, 3=S24_P32 (24 bit in
+	 * 32 bit integers), 4=S32, 5=FLOAT, 6=DSD; samples are in
+	 * host byte order and interleaved.
+	 */
+	uint8_t sample_format;
+
+	uint8_t channels;
+
+	uint8_t reserved[6];
+
+	/**
+	 * The stream position where the current audio format
+	 * begins.
+	 */
+	uint64_t format_position;
+
+	/**
+	 * The total number of bytes written so far.
+	 */
+	uint64_t write_position;
+
+	/**
+	 * Incremented after each write.
+	 */
+	uint32_t futex;
+
+	/**
+	 * 1 while MPD is playing, 0 while the output is closed.
+	 */
+	uint32_t playing;
+};
+
+static_assert(sizeof(ShmOutputHeader) == 56);
+
+#endif
@@ -23,12 +23,17 @@
 #include "util/AllocatedString.hxx"
 #include "Page.hxx"
 #include "IcyMetaDataServer.hxx"
+#include "event/Loop.hxx"
 #include "net/SocketError.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <cassert>
 #include <cstring>
+#include <span>
 
 #include <stdio.h>
 
@@ -59,8 +64,13 @@ HttpdClient::BeginResponse() noexcept
 	state = State::RESPONSE;
 	current_page = nullptr;
 
+	/* start with the next page from the encoder, or with the
+	   recent pages kept for "burst_time" */
+	next_page = stream->GetBurstBegin(GetEventLoop().SteadyNow());
+
 	if (!head_method)
-		httpd.SendHeader(*this);
+		if (auto header = stream->GetHeader())
+			PushPage(std::move(header));
 }
 
 /**
@@ -84,6 +94,9 @@ HttpdClient::HandleLine(const char *line) noexcept
 			return false;
 		}
 
+		stream = &httpd.FindStream(std::string_view{line, strcspn(line, " ?")});
+		metadata_supported = !stream->ImplementsTag();
+
 		/* blacklist some well-known request paths */
 		if ((strncmp(line, "favicon.ico", 11) == 0 &&
 		     (line[11] == '\0' || line[11] == ' ')) ||
@@ -152,7 +165,7 @@ HttpdClient::SendResponse() noexcept
 		allocated =
 			icy_server_metadata_header(httpd.name, httpd.genre,
 						   httpd.website,
-						   httpd.content_type,
+						   stream->content_type,
 						   metaint);
 		response = allocated.c_str();
 	} else { /* revert to a normal HTTP request */
@@ -164,7 +177,7 @@ HttpdClient::SendResponse() noexcept
 			 "Cache-Control: no-cache, no-store\r\n"
 			 "Access-Control-Allow-Origin: *\r\n"
 			 "\r\n",
-			 httpd.content_type);
+			 stream->content_type);
 		response = buffer;
 	}
 
@@ -182,31 +195,53 @@ HttpdClient::SendResponse() noexcept
 }
 
 HttpdClient::HttpdClient(HttpdOutput &_httpd, UniqueSocketDescriptor _fd,
-			 EventLoop &_loop,
-			 bool _metadata_supported)
+			 EventLoop &_loop)
 	:BufferedSocket(_fd.Release(), _loop),
-	 httpd(_httpd),
-	 metadata_supported(_metadata_supported)
+	 httpd(_httpd)
 {
 }
 
-void
-HttpdClient::ClearQueue() noexcept
-{
-	assert(state == State::RESPONSE);
+/**
+ * A list of buffers to be sent with one WriteV() call.
+ */
+struct HttpdClient::WriteBatch {
+	static constexpr std::size_t MAX = 32;
+
+	std::array<std::span<const std::byte>, MAX> buffers;
+
+	/**
+	 * Which of the #buffers are ICY metadata blocks (and not
+	 * audio data)?
+	 */
+	std::bitset<MAX> is_metadata;
 
-	while (!pages.empty()) {
-#ifndef NDEBUG
-		auto &page = pages.front();
-		assert(queue_size >= page->size());
-		queue_size -= page->size();
-#endif
+	std::size_t n = 0;
 
-		pages.pop();
+	bool empty() const noexcept {
+		return n == 0;
 	}
 
-	assert(queue_size == 0);
-}
+	bool full() const noexcept {
+		return n == MAX;
+	}
+
+	void Append(std::span<const std::byte> b, bool metadata) noexcept {
+		assert(!full());
+
+		buffers[n] = b;
+		is_metadata[n] = metadata;
+		++n;
+	}
+
+	std::span<const std::span<const std::byte>> GetBuffers() const noexcept {
+		return {buffers.data(), n};
+	}
+};
+
+/**
+ * An empty ICY metadata block, i.e. a length byte of zero.
+ */
+static constexpr std::byte empty_metadata[1]{};
 
 void
 HttpdClient::CancelQueue() noexcept
@@ -214,171 +249,219 @@ HttpdClient::CancelQueue() noexcept
 	if (state != State::RESPONSE)
 		return;
 
-	ClearQueue();
+	next_page = stream->GetRingEnd();
 
 	if (current_page == nullptr)
 		event.CancelWrite();
 }
 
-ssize_t
-HttpdClient::TryWritePage(const Page &page, size_t position) noexcept
+inline bool
+HttpdClient::HasPendingData() const noexcept
 {
-	assert(position < page.size());
-
-	return GetSocket().Write(page.data() + position,
-				 page.size() - position);
+	return current_page != nullptr || next_page < stream->GetRingEnd();
 }
 
-ssize_t
-HttpdClient::TryWritePageN(const Page &page,
-			   size_t position, ssize_t n) noexcept
+void
+HttpdClient::Gather(WriteBatch &batch) const noexcept
 {
-	return n >= 0
-		? GetSocket().Write(page.data() + position, n)
-		: TryWritePage(page, position);
-}
+	auto seq = next_page;
+	const Page *page = current_page.get();
+	std::size_t position = current_position;
+	if (page == nullptr) {
+		page = stream->GetRingPage(seq++);
+		position = 0;
+	}
 
-ssize_t
-HttpdClient::GetBytesTillMetaData() const noexcept
-{
-	if (metadata_requested &&
-	    current_page->size() - current_position > metaint - metadata_fill)
-		return metaint - metadata_fill;
+	unsigned fill = metadata_fill;
+	bool send_metadata = !metadata_sent;
+
+	while (page != nullptr && !batch.full()) {
+		std::span<const std::byte> data{*page};
+		data = data.subspan(position);
+
+		if (metadata_requested) {
+			if (fill >= metaint) {
+				/* a metadata block is due before the
+				   next audio byte; only the first one
+				   carries the (new) metadata, all
+				   others are empty */
+				if (send_metadata) {
+					std::span<const std::byte> m{*metadata};
+					batch.Append(m.subspan(metadata_current_position),
+						     true);
+					send_metadata = false;
+				} else
+					batch.Append(empty_metadata, true);
+
+				fill = 0;
+				continue;
+			}
+
+			if (data.size() > metaint - fill)
+				data = data.first(metaint - fill);
+			fill += data.size();
+		}
+
+		batch.Append(data, false);
 
-	return -1;
+		position += data.size();
+		if (position >= page->size()) {
+			page = stream->GetRingPage(seq++);
+			position = 0;
+		}
+	}
 }
 
-inline bool
-HttpdClient::TryWrite() noexcept
+void
+HttpdClient::ConsumePages(std::size_t nbytes) noexcept
 {
-	const std::scoped_lock<Mutex> protect(httpd.mutex);
-
-	assert(state == State::RESPONSE);
+	while (nbytes > 0) {
+		if (current_page == nullptr) {
+			const Page *page = stream->GetRingPage(next_page);
+			assert(page != nullptr);
+
+			if (nbytes >= page->size()) {
+				/* skip complete pages without
+				   referencing them */
+				nbytes -= page->size();
+				++next_page;
+				continue;
+			}
 
-	if (current_page == nullptr) {
-		if (pages.empty()) {
-			/* another thread has removed the event source
-			   while this thread was waiting for
-			   httpd.mutex */
-			event.CancelWrite();
-			return true;
+			current_page = stream->GetRingPagePtr(next_page++);
+			current_position = 0;
 		}
 
-		current_page = pages.front();
-		pages.pop();
-		current_position = 0;
+		const std::size_t n = std::min(nbytes,
+					       current_page->size() - current_position);
+		current_position += n;
+		nbytes -= n;
 
-		assert(queue_size >= current_page->size());
-		queue_size -= current_page->size();
+		if (current_position >= current_page->size())
+			current_page.reset();
 	}
+}
 
-	const ssize_t bytes_to_write = GetBytesTillMetaData();
-	if (bytes_to_write == 0) {
-		if (!metadata_sent) {
-			ssize_t nbytes = TryWritePage(*metadata,
-						      metadata_current_position);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorSendWouldBlock(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FmtWarning(httpd_output_domain,
-						   "failed to write to client: {}",
-						   (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+void
+HttpdClient::Consume(const WriteBatch &batch, std::size_t nbytes) noexcept
+{
+	/* like in Gather(), only the first metadata block carries
+	   the metadata */
+	bool send_metadata = !metadata_sent;
+
+	for (std::size_t i = 0; i < batch.n && nbytes > 0; ++i) {
+		const std::size_t size = batch.buffers[i].size();
+		const std::size_t n = std::min(nbytes, size);
+		nbytes -= n;
+
+		if (!batch.is_metadata[i]) {
+			ConsumePages(n);
+			if (metadata_requested)
+				metadata_fill += n;
+			continue;
+		}
 
-			metadata_current_position += nbytes;
+		if (send_metadata) {
+			send_metadata = false;
 
-			if (metadata->size() - metadata_current_position == 0) {
-				metadata_fill = 0;
-				metadata_current_position = 0;
-				metadata_sent = true;
-			}
-		} else {
-			char empty_data = 0;
-
-			ssize_t nbytes = GetSocket().Write(&empty_data, 1);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorSendWouldBlock(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FmtWarning(httpd_output_domain,
-						   "failed to write to client: {}",
-						   (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+			metadata_current_position += n;
+			if (n < size)
+				/* partially sent; continue next time */
+				break;
 
-			metadata_fill = 0;
 			metadata_current_position = 0;
-		}
-	} else {
-		ssize_t nbytes =
-			TryWritePageN(*current_page, current_position,
-				      bytes_to_write);
-		if (nbytes < 0) {
-			auto e = GetSocketError();
-			if (IsSocketErrorSendWouldBlock(e))
-				return true;
-
-			if (!IsSocketErrorClosed(e)) {
-				SocketErrorMessage msg(e);
-				FmtWarning(httpd_output_domain,
-					   "failed to write to client: {}",
-					   (const char *)msg);
-			}
+			metadata_sent = true;
 
-			Close();
-			return false;
+			if (next_metadata != nullptr) {
+				metadata = std::move(next_metadata);
+				metadata_sent = false;
+			}
 		}
 
-		current_position += nbytes;
-		assert(current_position <= current_page->size());
+		metadata_fill = 0;
+	}
+}
+
+bool
+HttpdClient::TryWrite() noexcept
+{
+	assert(state == State::RESPONSE);
+
+	if (next_page < stream->GetRingBegin()) {
+		/* the pages this client was going to send have
+		   already been removed from the ring */
+		LogDebug(httpd_output_domain,
+			 "client is too slow, skipping data");
 
-		if (metadata_requested)
-			metadata_fill += nbytes;
+		const auto end = stream->GetRingEnd();
+		next_page = end > stream->GetRingBegin() ? end - 1 : end;
+	}
 
-		if (current_position >= current_page->size()) {
-			current_page.reset();
+	WriteBatch batch;
+	Gather(batch);
 
-			if (pages.empty())
-				/* all pages are sent: remove the
-				   event source */
-				event.CancelWrite();
+	if (batch.empty()) {
+		event.CancelWrite();
+		return true;
+	}
+
+	const ssize_t nbytes = GetSocket().WriteV(batch.GetBuffers());
+	if (nbytes < 0) {
+		auto e = GetSocketError();
+		if (IsSocketErrorSendWouldBlock(e)) {
+			event.ScheduleWrite();
+			return true;
 		}
+
+		if (!IsSocketErrorClosed(e)) {
+			SocketErrorMessage msg(e);
+			FmtWarning(httpd_output_domain,
+				   "failed to write to client: {}",
+				   (const char *)msg);
+		}
+
+		LockClose();
+		return false;
 	}
 
+	Consume(batch, nbytes);
+
+	if (HasPendingData())
+		event.ScheduleWrite();
+	else
+		/* all pages are sent: remove the event source */
+		event.CancelWrite();
+
 	return true;
 }
 
 void
 HttpdClient::PushPage(PagePtr page) noexcept
+{
+	assert(state == State::RESPONSE);
+	assert(current_page == nullptr);
+
+	current_page = std::move(page);
+	current_position = 0;
+
+	event.ScheduleWrite();
+}
+
+void
+HttpdClient::OnPagesAvailable() noexcept
 {
 	if (state != State::RESPONSE)
 		/* the client is still writing the HTTP request */
 		return;
 
-	if (queue_size > 256 * 1024) {
-		LogDebug(httpd_output_domain,
-			 "client is too slow, flushing its queue");
-		ClearQueue();
-	}
-
-	queue_size += page->size();
-	pages.emplace(std::move(page));
+	if (event.GetScheduledFlags() & SocketEvent::WRITE)
+		/* already waiting for the socket to become
+		   writable */
+		return;
 
-	event.ScheduleWrite();
+	/* the socket is usually writable; send right away instead
+	   of registering it in the EventLoop first */
+	TryWrite();
 }
 
 void
@@ -386,6 +469,12 @@ HttpdClient::PushMetaData(PagePtr page) noexcept
 {
 	assert(page != nullptr);
 
+	if (metadata_current_position > 0) {
+		/* don't interrupt the block being sent */
+		next_metadata = std::move(page);
+		return;
+	}
+
 	metadata = std::move(page);
 	metadata_sent = false;
 }
@@ -26,11 +26,11 @@
 #include "util/IntrusiveList.hxx"
 
 #include <cstddef>
-#include <list>
-#include <queue>
+#include <cstdint>
 
 class UniqueSocketDescriptor;
 class HttpdOutput;
+class HttpdStream;
 
 class HttpdClient final
 	: BufferedSocket,
@@ -41,6 +41,12 @@ class HttpdClient final
 	 */
 	HttpdOutput &httpd;
 
+	/**
+	 * The stream requested by this client; nullptr while the
+	 * request line has not been received yet.
+	 */
+	HttpdStream *stream = nullptr;
+
 	/**
 	 * The current state of the client.
 	 */
@@ -55,18 +61,11 @@ class HttpdClient final
 		RESPONSE,
 	} state = State::REQUEST;
 
-	/**
-	 * A queue of #Page objects to be sent to the client.
-	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
-
-	/**
-	 * The sum of all page sizes in #pages.
-	 */
-	size_t queue_size = 0;
-
 	/**
 	 * The #page which is currently being sent to the client.
+	 * This is either the encoder header or a ring page which was
+	 * only partially sent; completely sent ring pages are never
+	 * referenced here.
 	 */
 	PagePtr current_page;
 
@@ -74,7 +73,13 @@ class HttpdClient final
 	 * The amount of bytes which were already sent from
 	 * #current_page.
 	 */
-	size_t current_position;
+	size_t current_position = 0;
+
+	/**
+	 * The sequence number of the next page in the
+	 * #HttpdStream's ring to be sent after #current_page.
+	 */
+	uint_least64_t next_page = 0;
 
 	/**
 	 * Is this a HEAD request?
@@ -90,9 +95,9 @@ class HttpdClient final
 
 	/**
 	 * Do we support sending Icy-Metadata to the client?  This is
-	 * disabled if the httpd audio output uses encoder tags.
+	 * disabled if the requested stream uses encoder tags.
 	 */
-	bool metadata_supported;
+	bool metadata_supported = false;
 
 	/**
 	 * If we should sent icy metadata.
@@ -117,6 +122,12 @@ class HttpdClient final
 	 */
 	PagePtr metadata;
 
+	/**
+	 * New metadata which was received while #metadata was being
+	 * sent; it replaces #metadata after that.
+	 */
+	PagePtr next_metadata;
+
 	/*
 	 * The amount of bytes which were already sent from the metadata.
 	 */
@@ -134,8 +145,7 @@ public:
 	 * @param _fd the socket file descriptor
 	 */
 	HttpdClient(HttpdOutput &httpd, UniqueSocketDescriptor _fd,
-		    EventLoop &_loop,
-		    bool _metadata_supported);
+		    EventLoop &_loop);
 
 	/**
 	 * Note: this does not remove the client from the
@@ -153,7 +163,7 @@ public:
 	void LockClose() noexcept;
 
 	/**
-	 * Clears the page queue.
+	 * Skip all pages in the ring.
 	 */
 	void CancelQueue() noexcept;
 
@@ -172,27 +182,54 @@ public:
 	 */
 	bool SendResponse() noexcept;
 
-	gcc_pure
-	ssize_t GetBytesTillMetaData() const noexcept;
-
-	ssize_t TryWritePage(const Page &page, size_t position) noexcept;
-	ssize_t TryWritePageN(const Page &page,
-			      size_t position, ssize_t n) noexcept;
-
+	/**
+	 * Send as much pending data as possible with one system
+	 * call.
+	 *
+	 * @return false if the client has been closed
+	 */
 	bool TryWrite() noexcept;
 
 	/**
-	 * Appends a page to the client's queue.
+	 * Sends the given page before the pages from the ring.  This
+	 * is used for the encoder header.
 	 */
 	void PushPage(PagePtr page) noexcept;
 
+	/**
+	 * New pages have been appended to the rings of the
+	 * #HttpdOutput's streams.  This may close (and delete) the
+	 * client.
+	 */
+	void OnPagesAvailable() noexcept;
+
 	/**
 	 * Sends the passed metadata.
 	 */
 	void PushMetaData(PagePtr page) noexcept;
 
 private:
-	void ClearQueue() noexcept;
+	struct WriteBatch;
+
+	[[gnu::pure]]
+	bool HasPendingData() const noexcept;
+
+	/**
+	 * Collect pending pages and interleaved ICY metadata blocks
+	 * without modifying the client's state.
+	 */
+	void Gather(WriteBatch &batch) const noexcept;
+
+	/**
+	 * Advance the client's state after the first @nbytes of
+	 * the #WriteBatch have been sent.
+	 */
+	void Consume(const WriteBatch &batch, std::size_t nbytes) noexcept;
+
+	/**
+	 * Advance the page cursor by the given number of bytes.
+	 */
+	void ConsumePages(std::size_t nbytes) noexcept;
 
 protected:
 	/* virtual methods from class BufferedSocket */
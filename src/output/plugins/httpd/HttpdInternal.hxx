@@ -26,6 +26,7 @@
 #define MPD_OUTPUT_HTTPD_INTERNAL_H
 
 #include "HttpdClient.hxx"
+#include "HttpdStream.hxx"
 #include "output/Interface.hxx"
 #include "output/Timer.hxx"
 #include "thread/Mutex.hxx"
@@ -36,17 +37,16 @@
 #include "util/Compiler.h"
 #include "util/IntrusiveList.hxx"
 
-#include <queue>
 #include <list>
 #include <memory>
 #include <span>
+#include <string_view>
 
 struct ConfigBlock;
 class EventLoop;
 class ServerSocket;
 class HttpdClient;
-class PreparedEncoder;
-class Encoder;
+class PcmWorkerPool;
 struct Tag;
 
 class HttpdOutput final : AudioOutput, ServerSocket {
@@ -59,34 +59,29 @@ class HttpdOutput final : AudioOutput, ServerSocket {
 	bool pause;
 
 	/**
-	 * The configured encoder plugin.
+	 * The configured encoder profiles.  The first one is
+	 * configured with the "encoder" setting and determines the
+	 * audio format of this output; the others are configured
+	 * with "profile_NAME" settings.
 	 */
-	std::unique_ptr<PreparedEncoder> prepared_encoder;
-	Encoder *encoder = nullptr;
+	std::list<HttpdStream> streams;
 
 	/**
-	 * Number of bytes which were fed into the encoder, without
-	 * ever receiving new output.  This is used to estimate
-	 * whether MPD should manually flush the encoder, to avoid
-	 * buffer underruns in the client.
+	 * Runs the encoders of all #streams in parallel; nullptr if
+	 * there is only one stream.
 	 */
-	size_t unflushed_input = 0;
+	std::unique_ptr<PcmWorkerPool> encoder_pool;
 
 public:
 	/**
-	 * The MIME type produced by the #encoder.
-	 */
-	const char *content_type;
-
-	/**
-	 * This mutex protects the listener socket and the client
-	 * list.
+	 * This mutex protects the listener socket, the client list
+	 * and HttpdStream::pages.
 	 */
 	mutable Mutex mutex;
 
 	/**
-	 * This condition gets signalled when an item is removed from
-	 * #pages.
+	 * This condition gets signalled when items are removed from
+	 * HttpdStream::pages.
 	 */
 	Cond cond;
 
@@ -98,22 +93,17 @@ private:
 	Timer *timer;
 
 	/**
-	 * The header page, which is sent to every client on connect.
-	 */
-	PagePtr header;
-
-	/**
-	 * The metadata, which is sent to every client.
+	 * The metadata, which is sent to every client.  Protected by
+	 * #mutex; OnDeferredBroadcast() passes new metadata to all
+	 * clients.
 	 */
 	PagePtr metadata;
 
 	/**
-	 * The page queue, i.e. pages from the encoder to be
-	 * broadcasted to all clients.  This container is necessary to
-	 * pass pages from the OutputThread to the IOThread.  It is
-	 * protected by #mutex, and removing signals #cond.
+	 * The metadata which was last passed to all clients.  Only
+	 * accessed in the IOThread.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
+	PagePtr client_metadata;
 
 	InjectEvent defer_broadcast;
 
@@ -146,8 +136,15 @@ private:
 	 */
 	const unsigned clients_max;
 
+	/**
+	 * Delays shorter than this are not waited for, see
+	 * Timer::granularity.
+	 */
+	const std::chrono::steady_clock::duration pacing_granularity;
+
 public:
 	HttpdOutput(EventLoop &_loop, const ConfigBlock &block);
+	~HttpdOutput() noexcept override;
 
 	static AudioOutput *Create(EventLoop &event_loop,
 				   const ConfigBlock &block) {
@@ -172,7 +169,7 @@ public:
 	 *
 	 * Throws on error.
 	 */
-	void OpenEncoder(AudioFormat &audio_format);
+	void OpenEncoders(AudioFormat &audio_format);
 
 	/**
 	 * Caller must lock the mutex.
@@ -216,33 +213,31 @@ public:
 	void RemoveClient(HttpdClient &client) noexcept;
 
 	/**
-	 * Sends the encoder header to the client.  This is called
-	 * right after the response headers have been sent.
+	 * Find the stream for the given request path (without the
+	 * leading slash).  Paths which are not claimed by an encoder
+	 * profile are mapped to the default stream.
 	 */
-	void SendHeader(HttpdClient &client) const noexcept;
+	[[gnu::pure]]
+	HttpdStream &FindStream(std::string_view path) noexcept;
 
 	gcc_pure
 	std::chrono::steady_clock::duration Delay() const noexcept override;
 
 	/**
-	 * Reads data from the encoder (as much as available) and
-	 * returns it as a new #page object.
-	 */
-	PagePtr ReadPage() noexcept;
-
-	/**
-	 * Broadcasts a page struct to all clients.
+	 * Wait until the IOThread has taken all pages from the
+	 * streams (to throttle the OutputThread).
 	 *
 	 * Mutext must not be locked.
 	 */
-	void BroadcastPage(PagePtr page) noexcept;
+	void WaitBroadcast() noexcept;
 
 	/**
-	 * Broadcasts data from the encoder to all clients.
+	 * Broadcasts HttpdStream::encoded of all streams to all
+	 * clients.
 	 *
 	 * Mutext must not be locked.
 	 */
-	void BroadcastFromEncoder() noexcept;
+	void BroadcastEncoded() noexcept;
 
 	/**
 	 * Mutext must not be locked.
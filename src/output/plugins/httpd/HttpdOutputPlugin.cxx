@@ -25,32 +25,121 @@
 #include "encoder/Configured.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
+#include "pcm/WorkerPool.hxx"
 #include "Page.hxx"
 #include "IcyMetaDataServer.hxx"
 #include "event/Call.hxx"
+#include "event/Loop.hxx"
 #include "net/DscpParser.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "util/Domain.hxx"
 #include "util/DeleteDisposer.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/StringCompare.hxx"
+#include "util/StringSplit.hxx"
+#include "config/Block.hxx"
 #include "config/Net.hxx"
 
 #include <cassert>
+#include <iterator>
 #include <stdexcept>
 
 #include <string.h>
 
 const Domain httpd_output_domain("httpd_output");
 
+/**
+ * Add an encoder profile from a "profile_NAME" setting.  Its value
+ * is a space-separated list of "KEY=VALUE" pairs: "path" is the
+ * request path (default "/NAME"), all others are encoder settings
+ * like in the "audio_output" block.
+ */
+static void
+AddProfile(std::list<HttpdStream> &streams,
+	   std::string_view name, const BlockParam &param,
+	   std::chrono::steady_clock::duration burst_time)
+{
+	ConfigBlock block(param.line);
+	std::string_view path = name;
+
+	for (const std::string_view i : IterableSplitString(param.value, ' ')) {
+		if (i.empty())
+			continue;
+
+		const auto [key, value] = Split(i, '=');
+		if (key.empty() || value.data() == nullptr)
+			throw FmtRuntimeError("Malformed profile setting: \"{}\"",
+					      i);
+
+		if (key == "path") {
+			if (!value.starts_with('/'))
+				throw FmtRuntimeError("Profile path must start with a slash: \"{}\"",
+						      value);
+
+			path = value.substr(1);
+		} else
+			block.AddBlockParam(std::string{key},
+					    std::string{value},
+					    param.line);
+	}
+
+	if (path.empty())
+		throw std::runtime_error("Profile path must not be empty");
+
+	for (const auto &i : streams)
+		if (i.MatchPath(path))
+			throw FmtRuntimeError("Duplicate profile path: /{}",
+					      path);
+
+	streams.emplace_back(path,
+			     std::unique_ptr<PreparedEncoder>(CreateConfiguredEncoder(block)),
+			     burst_time);
+
+	for (const auto &i : block.block_params)
+		if (!i.used)
+			throw FmtRuntimeError("Unknown profile setting: \"{}\"",
+					      i.name);
+}
+
 inline
 HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 	:AudioOutput(FLAG_ENABLE_DISABLE|FLAG_PAUSE),
 	 ServerSocket(_loop),
-	 prepared_encoder(CreateConfiguredEncoder(block)),
 	 defer_broadcast(_loop, BIND_THIS_METHOD(OnDeferredBroadcast)),
 	 name(block.GetBlockValue("name", "Set name in config")),
 	 genre(block.GetBlockValue("genre", "Set genre in config")),
 	 website(block.GetBlockValue("website", "Set website in config")),
-	 clients_max(block.GetBlockValue("max_clients", 0U))
+	 clients_max(block.GetBlockValue("max_clients", 0U)),
+	 pacing_granularity(std::chrono::milliseconds(block.GetBlockValue("pacing_granularity", 0U)))
 {
+	const std::chrono::steady_clock::duration burst_time =
+		std::chrono::milliseconds(block.GetBlockValue("burst_time", 0U));
+
+	/* the default stream */
+	streams.emplace_back(std::string_view{},
+			     std::unique_ptr<PreparedEncoder>(CreateConfiguredEncoder(block)),
+			     burst_time);
+
+	for (const auto &i : block.block_params) {
+		const char *profile_name =
+			StringAfterPrefix(i.name.c_str(), "profile_");
+		if (profile_name == nullptr)
+			continue;
+
+		i.used = true;
+
+		try {
+			AddProfile(streams, profile_name, i, burst_time);
+		} catch (...) {
+			i.ThrowWithNested();
+		}
+	}
+
+	if (streams.size() > 1)
+		/* the OutputThread encodes one stream, the pool
+		   threads encode the others */
+		encoder_pool = std::make_unique<PcmWorkerPool>(streams.size() - 1);
+
 	if (const auto *p = block.GetBlockParam("dscp_class"))
 		p->With([this](const char *s){
 			const int value = ParseDscpClass(s);
@@ -64,12 +153,13 @@ HttpdOutput::HttpdOutput(EventLoop &_loop, const ConfigBlock &block)
 
 	ServerSocketAddGeneric(*this, block.GetBlockValue("bind_to_address"), block.GetBlockValue("port", 8000U));
 
-	/* determine content type */
-	content_type = prepared_encoder->GetMimeType();
-	if (content_type == nullptr)
-		content_type = "application/octet-stream";
+	/* many listeners may reconnect at the same time, e.g. after
+	   a network outage */
+	ServerSocket::SetBacklog(128);
 }
 
+HttpdOutput::~HttpdOutput() noexcept = default;
+
 inline void
 HttpdOutput::Bind()
 {
@@ -97,34 +187,66 @@ HttpdOutput::Unbind() noexcept
 inline void
 HttpdOutput::AddClient(UniqueSocketDescriptor fd) noexcept
 {
-	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop(),
-				       !encoder->ImplementsTag());
+	auto *client = new HttpdClient(*this, std::move(fd), GetEventLoop());
 	clients.push_front(*client);
 
 	/* pass metadata to client */
-	if (metadata != nullptr)
-		clients.front().PushMetaData(metadata);
+	if (client_metadata != nullptr)
+		clients.front().PushMetaData(client_metadata);
+}
+
+HttpdStream &
+HttpdOutput::FindStream(std::string_view path) noexcept
+{
+	for (auto &i : streams)
+		if (i.MatchPath(path))
+			return i;
+
+	return streams.front();
 }
 
 void
 HttpdOutput::OnDeferredBroadcast() noexcept
 {
-	/* this method runs in the IOThread; it broadcasts pages from
-	   our own queue to all clients */
+	/* this method runs in the IOThread; it moves pages from our
+	   own queues to the rings and lets all clients send them */
 
-	const std::scoped_lock<Mutex> protect(mutex);
+	bool new_pages = false, new_metadata;
+	const auto now = GetEventLoop().SteadyNow();
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+
+		for (auto &stream : streams) {
+			if (!stream.pages.empty())
+				new_pages = true;
+
+			for (auto &page : stream.pages)
+				stream.AppendToRing(std::move(page), now);
+			stream.pages.clear();
+		}
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
+		new_metadata = metadata != client_metadata;
+		client_metadata = metadata;
 
-		for (auto &client : clients)
-			client.PushPage(page);
+		/* wake up the client that may be waiting for the
+		   queue to be flushed */
+		cond.notify_all();
 	}
 
-	/* wake up the client that may be waiting for the queue to be
-	   flushed */
-	cond.notify_all();
+	/* the client list is only modified in this thread, so it
+	   can be traversed without holding the mutex; this avoids
+	   blocking the OutputThread while sending to all clients */
+
+	for (auto i = clients.begin(); i != clients.end();) {
+		auto &client = *i++;
+
+		if (new_metadata && client_metadata != nullptr)
+			client.PushMetaData(client_metadata);
+
+		if (new_pages)
+			client.OnPagesAvailable();
+	}
 }
 
 void
@@ -141,70 +263,24 @@ HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
 		AddClient(std::move(fd));
 }
 
-PagePtr
-HttpdOutput::ReadPage() noexcept
-{
-	if (unflushed_input >= 65536) {
-		/* we have fed a lot of input into the encoder, but it
-		   didn't give anything back yet - flush now to avoid
-		   buffer underruns */
-		try {
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
-
-		unflushed_input = 0;
-	}
-
-	std::byte buffer[32768];
-
-	size_t size = 0;
-	do {
-		const auto b = std::span{buffer}.subspan(size);
-		const auto r = encoder->Read(b);
-		if (r.empty())
-			break;
-
-		unflushed_input = 0;
-
-		if (r.data() != b.data()) {
-			if (size == 0 && r.size() >= sizeof(buffer) / 2)
-				/* if the returned memory area is
-				   large (and nothing has been written
-				   to the stack buffer yet), copy
-				   right from the returned memory
-				   area, avoiding the copy into the
-				   buffer*/
-				return std::make_shared<Page>(r);
-
-			/* if the encoder did not write to the given
-			   buffer but instead returned its own buffer,
-			   we need to copy it so we have a contiguous
-			   buffer */
-			std::copy(r.begin(), r.end(), b.begin());
-		}
-
-		size += r.size();
-	} while (size < sizeof(buffer));
-
-	if (size == 0)
-		return nullptr;
-
-	return std::make_shared<Page>(std::span{buffer, size});
-}
-
 inline void
-HttpdOutput::OpenEncoder(AudioFormat &audio_format)
+HttpdOutput::OpenEncoders(AudioFormat &audio_format)
 {
-	encoder = prepared_encoder->Open(audio_format);
-
-	/* we have to remember the encoder header, i.e. the first
-	   bytes of encoder output after opening it, because it has to
-	   be sent to every new client */
-	header = ReadPage();
-
-	unflushed_input = 0;
+	auto i = streams.begin();
+
+	/* the first encoder may choose the output's audio format;
+	   the others convert from it if they need something
+	   else */
+	i->Open(audio_format, true);
+
+	try {
+		for (++i; i != streams.end(); ++i)
+			i->Open(audio_format, false);
+	} catch (...) {
+		for (auto j = streams.begin(); j != i; ++j)
+			j->Close();
+		throw;
+	}
 }
 
 void
@@ -215,11 +291,11 @@ HttpdOutput::Open(AudioFormat &audio_format)
 
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	OpenEncoder(audio_format);
+	OpenEncoders(audio_format);
 
 	/* initialize other attributes */
 
-	timer = new Timer(audio_format);
+	timer = new Timer(audio_format, pacing_granularity);
 
 	open = true;
 	pause = false;
@@ -238,11 +314,17 @@ HttpdOutput::Close() noexcept
 			const std::scoped_lock<Mutex> protect(mutex);
 			open = false;
 			clients.clear_and_dispose(DeleteDisposer());
-		});
 
-	header.reset();
+			for (auto &stream : streams) {
+				stream.pages.clear();
+				stream.ClearRing();
+			}
+
+			client_metadata.reset();
+		});
 
-	delete encoder;
+	for (auto &stream : streams)
+		stream.Close();
 }
 
 void
@@ -254,13 +336,6 @@ HttpdOutput::RemoveClient(HttpdClient &client) noexcept
 				  DeleteDisposer());
 }
 
-void
-HttpdOutput::SendHeader(HttpdClient &client) const noexcept
-{
-	if (header != nullptr)
-		client.PushPage(header);
-}
-
 std::chrono::steady_clock::duration
 HttpdOutput::Delay() const noexcept
 {
@@ -283,34 +358,34 @@ HttpdOutput::Delay() const noexcept
 }
 
 void
-HttpdOutput::BroadcastPage(PagePtr page) noexcept
+HttpdOutput::WaitBroadcast() noexcept
 {
-	assert(page != nullptr);
-
-	{
-		const std::scoped_lock<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
-	}
-
-	defer_broadcast.Schedule();
+	/* synchronize with the IOThread */
+	std::unique_lock<Mutex> lock(mutex);
+	cond.wait(lock, [this]{
+		for (const auto &stream : streams)
+			if (!stream.pages.empty())
+				return false;
+		return true;
+	});
 }
 
 void
-HttpdOutput::BroadcastFromEncoder() noexcept
+HttpdOutput::BroadcastEncoded() noexcept
 {
-	/* synchronize with the IOThread */
-	{
-		std::unique_lock<Mutex> lock(mutex);
-		cond.wait(lock, [this]{ return pages.empty(); });
-	}
-
 	bool empty = true;
 
-	PagePtr page;
-	while ((page = ReadPage()) != nullptr) {
+	{
 		const std::scoped_lock<Mutex> lock(mutex);
-		pages.emplace(std::move(page));
-		empty = false;
+
+		for (auto &stream : streams) {
+			if (stream.encoded.empty())
+				continue;
+
+			stream.pages.splice(stream.pages.end(),
+					    stream.encoded);
+			empty = false;
+		}
 	}
 
 	if (!empty)
@@ -320,11 +395,32 @@ HttpdOutput::BroadcastFromEncoder() noexcept
 inline void
 HttpdOutput::EncodeAndPlay(std::span<const std::byte> src)
 {
-	encoder->Write(src);
+	WaitBroadcast();
+
+	if (encoder_pool) {
+		auto f = [this, src](unsigned i) noexcept {
+			std::next(streams.begin(), i)->EncodeCatch(src);
+		};
 
-	unflushed_input += src.size();
+		encoder_pool->Run(streams.size(), f);
+
+		for (auto &stream : streams) {
+			if (stream.error) {
+				BroadcastEncoded();
+				std::rethrow_exception(std::exchange(stream.error,
+								     nullptr));
+			}
+		}
+	} else {
+		try {
+			streams.front().Encode(src);
+		} catch (...) {
+			BroadcastEncoded();
+			throw;
+		}
+	}
 
-	BroadcastFromEncoder();
+	BroadcastEncoded();
 }
 
 std::size_t
@@ -358,39 +454,21 @@ HttpdOutput::Pause()
 void
 HttpdOutput::SendTag(const Tag &tag)
 {
-	if (encoder->ImplementsTag()) {
-		/* embed encoder tags */
-
-		/* flush the current stream, and end it */
-
-		try {
-			encoder->PreTag();
-		} catch (...) {
-			/* ignore */
-		}
+	bool icy = false;
 
-		BroadcastFromEncoder();
+	WaitBroadcast();
 
-		/* send the tag to the encoder - which starts a new
-		   stream now */
-
-		try {
-			encoder->SendTag(tag);
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
+	for (auto &stream : streams) {
+		if (stream.ImplementsTag())
+			/* embed encoder tags */
+			stream.SendTag(tag);
+		else
+			icy = true;
+	}
 
-		/* the first page generated by the encoder will now be
-		   used as the new "header" page, which is sent to all
-		   new clients */
+	BroadcastEncoded();
 
-		auto page = ReadPage();
-		if (page != nullptr) {
-			header = page;
-			BroadcastPage(page);
-		}
-	} else {
+	if (icy) {
 		/* use Icy-Metadata */
 
 		static constexpr TagType types[] = {
@@ -398,12 +476,17 @@ HttpdOutput::SendTag(const Tag &tag)
 			TAG_NUM_OF_ITEM_TYPES
 		};
 
-		metadata = icy_server_metadata_page(tag, &types[0]);
-		if (metadata != nullptr) {
+		auto page = icy_server_metadata_page(tag, &types[0]);
+		const bool valid = page != nullptr;
+
+		{
 			const std::scoped_lock<Mutex> protect(mutex);
-			for (auto &client : clients)
-				client.PushMetaData(metadata);
+			metadata = std::move(page);
 		}
+
+		/* OnDeferredBroadcast() passes it to all clients */
+		if (valid)
+			defer_broadcast.Schedule();
 	}
 }
 
@@ -412,9 +495,9 @@ HttpdOutput::CancelAllClients() noexcept
 {
 	const std::scoped_lock<Mutex> protect(mutex);
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
+	for (auto &stream : streams) {
+		stream.pages.clear();
+		stream.ClearRing();
 	}
 
 	for (auto &client : clients)
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HttpdStream.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/Convert.hxx"
+
+static const char *
+GetMimeType(const PreparedEncoder &encoder) noexcept
+{
+	const char *mime_type = encoder.GetMimeType();
+	if (mime_type == nullptr)
+		mime_type = "application/octet-stream";
+	return mime_type;
+}
+
+HttpdStream::HttpdStream(std::string_view _path,
+			 std::unique_ptr<PreparedEncoder> _prepared_encoder,
+			 std::chrono::steady_clock::duration _burst_time) noexcept
+	:path(_path),
+	 prepared_encoder(std::move(_prepared_encoder)),
+	 page_pool(std::make_shared<EncoderBufferPool>()),
+	 burst_time(_burst_time),
+	 content_type(GetMimeType(*prepared_encoder))
+{
+}
+
+HttpdStream::~HttpdStream() noexcept = default;
+
+bool
+HttpdStream::ImplementsTag() const noexcept
+{
+	return encoder->ImplementsTag();
+}
+
+void
+HttpdStream::Open(AudioFormat &audio_format, bool adjust)
+{
+	AudioFormat encoder_format = audio_format;
+	encoder = prepared_encoder->Open(encoder_format);
+
+	if (encoder_format != audio_format) {
+		if (adjust) {
+			audio_format = encoder_format;
+		} else {
+			try {
+				convert = std::make_unique<PcmConvert>(audio_format,
+								       encoder_format);
+			} catch (...) {
+				delete encoder;
+				encoder = nullptr;
+				throw;
+			}
+		}
+	}
+
+	/* we have to remember the encoder header, i.e. the first
+	   bytes of encoder output after opening it, because it has to
+	   be sent to every new client */
+	header = ReadPage();
+
+	unflushed_input = 0;
+}
+
+void
+HttpdStream::Close() noexcept
+{
+	header.reset();
+	encoded.clear();
+	convert.reset();
+
+	delete encoder;
+	encoder = nullptr;
+}
+
+PagePtr
+HttpdStream::ReadPage() noexcept
+{
+	if (unflushed_input >= 65536) {
+		/* we have fed a lot of input into the encoder, but it
+		   didn't give anything back yet - flush now to avoid
+		   buffer underruns */
+		try {
+			encoder->Flush();
+		} catch (...) {
+			/* ignore */
+		}
+
+		unflushed_input = 0;
+	}
+
+	auto page = encoder->ReadBuffer(*page_pool);
+	if (page != nullptr)
+		unflushed_input = 0;
+
+	return page;
+}
+
+void
+HttpdStream::ReadEncoded() noexcept
+{
+	PagePtr page;
+	while ((page = ReadPage()) != nullptr)
+		encoded.emplace_back(std::move(page));
+}
+
+void
+HttpdStream::Encode(std::span<const std::byte> src)
+{
+	if (convert)
+		src = convert->Convert(src);
+
+	encoder->Write(src);
+
+	unflushed_input += src.size();
+
+	ReadEncoded();
+}
+
+void
+HttpdStream::EncodeCatch(std::span<const std::byte> src) noexcept
+try {
+	Encode(src);
+} catch (...) {
+	error = std::current_exception();
+}
+
+void
+HttpdStream::SendTag(const Tag &tag) noexcept
+{
+	/* flush the current stream, and end it */
+
+	try {
+		encoder->PreTag();
+	} catch (...) {
+		/* ignore */
+	}
+
+	ReadEncoded();
+
+	/* send the tag to the encoder - which starts a new stream
+	   now */
+
+	try {
+		encoder->SendTag(tag);
+		encoder->Flush();
+	} catch (...) {
+		/* ignore */
+	}
+
+	/* the first page generated by the encoder will now be used
+	   as the new "header" page, which is sent to all new
+	   clients */
+
+	auto page = ReadPage();
+	if (page != nullptr) {
+		header = page;
+		encoded.emplace_back(std::move(page));
+	}
+}
+
+uint_least64_t
+HttpdStream::GetBurstBegin(std::chrono::steady_clock::time_point now) const noexcept
+{
+	uint_least64_t seq = GetRingEnd();
+	if (burst_time <= std::chrono::steady_clock::duration::zero())
+		return seq;
+
+	const auto min_time = now - burst_time;
+
+	for (auto i = ring.rbegin(); i != ring.rend(); ++i) {
+		if (i->time < min_time || i->page == header)
+			/* too old, or the header of the current
+			   stream which has already been sent */
+			break;
+
+		--seq;
+	}
+
+	return seq;
+}
+
+void
+HttpdStream::AppendToRing(PagePtr page,
+			  std::chrono::steady_clock::time_point now) noexcept
+{
+	ring_size += page->size();
+	ring.push_back({std::move(page), now});
+
+	const auto min_time = now - burst_time;
+
+	while (ring.size() > 1 &&
+	       ((ring_size > MAX_RING_SIZE && ring.front().time < min_time) ||
+		ring_size > MAX_BURST_SIZE)) {
+		ring_size -= ring.front().page->size();
+		ring.pop_front();
+		++ring_begin;
+	}
+}
+
+void
+HttpdStream::ClearRing() noexcept
+{
+	ring_begin += ring.size();
+	ring.clear();
+	ring_size = 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_HTTPD_STREAM_HXX
+#define MPD_OUTPUT_HTTPD_STREAM_HXX
+
+#include "Page.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+struct AudioFormat;
+class PreparedEncoder;
+class Encoder;
+class PcmConvert;
+struct Tag;
+
+/**
+ * One encoder profile of the "httpd" audio output, i.e. one stream
+ * which clients can request.  All streams of an output are fed with
+ * the same PCM data.
+ */
+class HttpdStream {
+	/**
+	 * The request path (without the leading slash).  The first
+	 * stream of an output has an empty path; it gets all
+	 * requests which do not match another stream.
+	 */
+	const std::string path;
+
+	std::unique_ptr<PreparedEncoder> prepared_encoder;
+	Encoder *encoder = nullptr;
+
+	/**
+	 * Converts the output's PCM data to the format requested by
+	 * the #encoder; nullptr if no conversion is needed.
+	 */
+	std::unique_ptr<PcmConvert> convert;
+
+	/**
+	 * Number of bytes which were fed into the encoder, without
+	 * ever receiving new output.  This is used to estimate
+	 * whether MPD should manually flush the encoder, to avoid
+	 * buffer underruns in the client.
+	 */
+	size_t unflushed_input = 0;
+
+	/**
+	 * Provides the buffers for pages read from the #encoder.
+	 */
+	const std::shared_ptr<EncoderBufferPool> page_pool;
+
+	/**
+	 * The header page, which is sent to every client on connect.
+	 */
+	PagePtr header;
+
+	struct RingItem {
+		PagePtr page;
+
+		/**
+		 * The time this page was appended to the ring.
+		 */
+		std::chrono::steady_clock::time_point time;
+	};
+
+	/**
+	 * The most recent pages, shared by all clients.  Each client
+	 * has its own read cursor (a page sequence number) into this
+	 * ring, so broadcasting a page does not touch per-client
+	 * queues.  Only accessed in the IOThread.
+	 */
+	std::deque<RingItem> ring;
+
+	/**
+	 * The sequence number of the first page in #ring.
+	 */
+	uint_least64_t ring_begin = 0;
+
+	/**
+	 * The sum of all page sizes in #ring.
+	 */
+	std::size_t ring_size = 0;
+
+	/**
+	 * Older pages are removed from #ring when it grows larger
+	 * than this.  Clients which are still behind are too slow,
+	 * and skip ahead.
+	 */
+	static constexpr std::size_t MAX_RING_SIZE = 256 * 1024;
+
+	/**
+	 * The #ring is never larger than this, even if #burst_time
+	 * asks for more.
+	 */
+	static constexpr std::size_t MAX_BURST_SIZE = 16 * 1024 * 1024;
+
+	/**
+	 * Pages younger than this are kept in the #ring, to be sent
+	 * to new clients right after the #header ("burst on
+	 * connect").  Zero disables this.
+	 */
+	const std::chrono::steady_clock::duration burst_time;
+
+public:
+	/**
+	 * The MIME type produced by the #encoder.
+	 */
+	const char *const content_type;
+
+	/**
+	 * The page queue, i.e. pages from the encoder to be
+	 * broadcasted to all clients.  This container is necessary to
+	 * pass pages from the OutputThread to the IOThread.  It is
+	 * protected by HttpdOutput::mutex.
+	 */
+	std::list<PagePtr> pages;
+
+	/**
+	 * Pages which were read from the encoder by Encode(), to be
+	 * moved to #pages.  Only accessed in the OutputThread.
+	 */
+	std::list<PagePtr> encoded;
+
+	/**
+	 * An error which occurred in Encode() while it was running
+	 * in a worker thread.
+	 */
+	std::exception_ptr error;
+
+	HttpdStream(std::string_view _path,
+		    std::unique_ptr<PreparedEncoder> _prepared_encoder,
+		    std::chrono::steady_clock::duration _burst_time) noexcept;
+	~HttpdStream() noexcept;
+
+	HttpdStream(const HttpdStream &) = delete;
+	HttpdStream &operator=(const HttpdStream &) = delete;
+
+	/**
+	 * Does this stream accept a request for the given path
+	 * (without the leading slash)?  The default stream is not
+	 * considered.
+	 */
+	[[gnu::pure]]
+	bool MatchPath(std::string_view _path) const noexcept {
+		return !path.empty() && _path == path;
+	}
+
+	/**
+	 * Does the encoder embed tags into the stream?  If not, ICY
+	 * metadata can be sent to clients.
+	 */
+	[[gnu::pure]]
+	bool ImplementsTag() const noexcept;
+
+	/**
+	 * Throws on error.
+	 *
+	 * @param audio_format the format of the PCM data which will
+	 * be passed to Encode()
+	 * @param adjust if true, then the encoder may modify
+	 * @audio_format; if false, a different format requested by
+	 * the encoder is converted to
+	 */
+	void Open(AudioFormat &audio_format, bool adjust);
+
+	void Close() noexcept;
+
+	PagePtr GetHeader() const noexcept {
+		return header;
+	}
+
+	/**
+	 * Reads data from the encoder (as much as available) and
+	 * returns it as a new #page object.
+	 */
+	PagePtr ReadPage() noexcept;
+
+	/**
+	 * Read all available pages from the encoder and append them
+	 * to #encoded.
+	 */
+	void ReadEncoded() noexcept;
+
+	/**
+	 * Pass PCM data to the encoder and read the resulting pages
+	 * into #encoded.
+	 *
+	 * Throws on error.
+	 */
+	void Encode(std::span<const std::byte> src);
+
+	/**
+	 * Like Encode(), but store the exception in #error.
+	 */
+	void EncodeCatch(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Let the encoder end the current stream and start a new one
+	 * with the given tag.  All pages are appended to #encoded;
+	 * the first page of the new stream becomes the new header
+	 * page, which is sent to all new clients.
+	 */
+	void SendTag(const Tag &tag) noexcept;
+
+	/**
+	 * Returns the sequence number of the oldest page in the
+	 * ring.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	uint_least64_t GetRingBegin() const noexcept {
+		return ring_begin;
+	}
+
+	/**
+	 * Returns the sequence number of the next page which will be
+	 * appended to the ring.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	uint_least64_t GetRingEnd() const noexcept {
+		return ring_begin + ring.size();
+	}
+
+	/**
+	 * Returns the ring page with the given sequence number, or
+	 * nullptr if it is not (or no longer) in the ring.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	[[gnu::pure]]
+	const Page *GetRingPage(uint_least64_t seq) const noexcept {
+		if (seq < ring_begin || seq >= GetRingEnd())
+			return nullptr;
+
+		return ring[seq - ring_begin].page.get();
+	}
+
+	/**
+	 * Like GetRingPage(), but return a new reference.
+	 */
+	[[gnu::pure]]
+	PagePtr GetRingPagePtr(uint_least64_t seq) const noexcept {
+		if (seq < ring_begin || seq >= GetRingEnd())
+			return nullptr;
+
+		return ring[seq - ring_begin].page;
+	}
+
+	/**
+	 * Returns the sequence number of the first page a new client
+	 * shall receive after the #header: the oldest ring page
+	 * within #burst_time, but never one which belongs to the
+	 * stream before the current #header.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	[[gnu::pure]]
+	uint_least64_t GetBurstBegin(std::chrono::steady_clock::time_point now) const noexcept;
+
+	/**
+	 * Append a page to the ring, removing old pages if it grows
+	 * too large and they are older than #burst_time.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	void AppendToRing(PagePtr page,
+			  std::chrono::steady_clock::time_point now) noexcept;
+
+	/**
+	 * Remove all pages from the ring.
+	 *
+	 * Must be called in the IOThread.
+	 */
+	void ClearRing() noexcept;
+};
+
+#endif
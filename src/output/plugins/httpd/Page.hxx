@@ -20,18 +20,15 @@
 #ifndef MPD_PAGE_HXX
 #define MPD_PAGE_HXX
 
-#include "util/AllocatedArray.hxx"
-
-#include <cstddef>
-#include <memory>
+#include "encoder/EncoderBuffer.hxx"
 
 /**
- * A dynamically allocated buffer.  It is used to pass
- * reference-counted buffers around (using std::shared_ptr), when
- * several instances hold references to one buffer.
+ * A reference-counted buffer, shared by all clients which send it.
+ * Pages produced by the encoder come from the stream's
+ * #EncoderBufferPool and are queued to the sockets without copying.
  */
-using Page = AllocatedArray<std::byte>;
+using Page = EncoderBuffer;
 
-typedef std::shared_ptr<Page> PagePtr;
+using PagePtr = EncoderBufferPtr;
 
 #endif
@@ -20,7 +20,7 @@
 #ifndef MPD_SNAPCAST_CHUNK_HXX
 #define MPD_SNAPCAST_CHUNK_HXX
 
-#include "util/AllocatedArray.hxx"
+#include "encoder/EncoderBuffer.hxx"
 
 #include <chrono>
 #include <cstddef>
@@ -33,10 +33,15 @@
  */
 struct SnapcastChunk {
 	std::chrono::steady_clock::time_point time;
-	AllocatedArray<std::byte> payload;
+
+	/**
+	 * The encoder output, which is shared by all clients without
+	 * copying it.
+	 */
+	EncoderBufferPtr payload;
 
 	SnapcastChunk(std::chrono::steady_clock::time_point _time,
-		      AllocatedArray<std::byte> &&_payload) noexcept
+		      EncoderBufferPtr &&_payload) noexcept
 		:time(_time), payload(std::move(_payload)) {}
 };
 
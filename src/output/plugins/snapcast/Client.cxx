@@ -28,6 +28,8 @@
 #include "util/SpanCast.hxx"
 #include "Log.hxx"
 
+#include <fmt/format.h>
+
 #include <cassert>
 #include <cstring>
 #include <string_view>
@@ -64,7 +66,17 @@ SnapcastClient::Push(SnapcastChunkPtr chunk) noexcept
 	if (!active)
 		return;
 
+	const auto min_time = chunk->time - output.GetMaxChunkAge();
+
 	chunks.emplace(std::move(chunk));
+
+	/* if this client is falling behind, drop chunks it could not
+	   play in time anyway, instead of letting the queue grow */
+	while (chunks.front()->time < min_time) {
+		chunks.pop();
+		++dropped_chunks;
+	}
+
 	event.ScheduleWrite();
 }
 
@@ -88,15 +100,18 @@ void
 SnapcastClient::OnSocketReady(unsigned flags) noexcept
 {
 	if (flags & SocketEvent::WRITE) {
-		constexpr auto max_age = std::chrono::milliseconds(500);
-		const auto min_time = GetEventLoop().SteadyNow() - max_age;
+		const auto min_time = GetEventLoop().SteadyNow() -
+			output.GetMaxChunkAge();
 
 		while (auto chunk = LockPopQueue()) {
-			if (chunk->time < min_time)
+			if (chunk->time < min_time) {
 				/* discard old chunks */
+				const std::scoped_lock<Mutex> protect(output.mutex);
+				++dropped_chunks;
 				continue;
+			}
 
-			const std::span payload = chunk->payload;
+			const std::span<const std::byte> payload{*chunk->payload};
 			if (!SendWireChunk(payload, chunk->time)) {
 				// TODO: handle EAGAIN
 				LockClose();
@@ -150,9 +165,9 @@ SendServerSettings(SocketDescriptor s, const PackedBE16 id,
 bool
 SnapcastClient::SendServerSettings(const SnapcastBase &request) noexcept
 {
-	// TODO: make settings configurable
-	return ::SendServerSettings(GetSocket(), next_id++, request,
-				    R"({"bufferMs": 1000})");
+	const auto json = fmt::format(R"({{"bufferMs": {}}})",
+				      output.GetBufferTime().count());
+	return ::SendServerSettings(GetSocket(), next_id++, request, json);
 }
 
 static bool
@@ -282,6 +297,12 @@ SnapcastClient::OnSocketInput(void *data, size_t length) noexcept
 		}
 
 		active = true;
+
+		{
+			const std::scoped_lock<Mutex> protect(output.mutex);
+			output.PushBurst(*this);
+		}
+
 		break;
 
 	case SnapcastMessageType::TIME:
@@ -42,6 +42,12 @@ class SnapcastClient final : BufferedSocket, public IntrusiveListHook<>
 	 */
 	SnapcastChunkQueue chunks;
 
+	/**
+	 * The number of chunks which were dropped because this
+	 * client was too slow.  Protected by SnapcastOutput::mutex.
+	 */
+	uint_least64_t dropped_chunks = 0;
+
 	uint16_t next_id = 1;
 
 	bool active = false;
@@ -64,10 +70,34 @@ public:
 	void SendStreamTags(std::span<const std::byte> payload) noexcept;
 
 	/**
+	 * Append a chunk to the queue and drop old chunks from the
+	 * front which could not be played in time anymore (see
+	 * SnapcastOutput::GetMaxChunkAge()).
+	 *
 	 * Caller must lock the mutex.
 	 */
 	void Push(SnapcastChunkPtr chunk) noexcept;
 
+	/**
+	 * Returns the time span of the queued chunks.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	std::chrono::steady_clock::duration GetBacklog() const noexcept {
+		if (chunks.empty())
+			return {};
+
+		return chunks.back()->time - chunks.front()->time;
+	}
+
+	/**
+	 * Caller must lock the mutex.
+	 */
+	uint_least64_t GetDroppedChunks() const noexcept {
+		return dropped_chunks;
+	}
+
 	/**
 	 * Caller must lock the mutex.
 	 */
@@ -32,6 +32,8 @@
 
 #include "config.h" // for HAVE_ZEROCONF
 
+#include <chrono>
+#include <deque>
 #include <memory>
 
 struct ConfigBlock;
@@ -69,6 +71,11 @@ class SnapcastOutput final : AudioOutput, ServerSocket {
 	std::unique_ptr<PreparedEncoder> prepared_encoder;
 	Encoder *encoder = nullptr;
 
+	/**
+	 * Provides the buffers for chunks read from the #encoder.
+	 */
+	const std::shared_ptr<EncoderBufferPool> chunk_pool;
+
 	AllocatedArray<std::byte> codec_header;
 
 	/**
@@ -93,6 +100,32 @@ class SnapcastOutput final : AudioOutput, ServerSocket {
 
 	SnapcastChunkQueue chunks;
 
+	/**
+	 * The buffer time announced to clients ("bufferMs"), i.e. the
+	 * target latency between a chunk's timestamp and its
+	 * playback.
+	 */
+	const std::chrono::milliseconds buffer_time;
+
+	/**
+	 * Chunks younger than this are kept in #burst, to be sent to
+	 * new clients right after the codec header.  Zero disables
+	 * this.
+	 */
+	const std::chrono::steady_clock::duration burst_time;
+
+	/**
+	 * Delays shorter than this are not waited for, see
+	 * Timer::granularity.
+	 */
+	const std::chrono::steady_clock::duration pacing_granularity;
+
+	/**
+	 * The most recent chunks which were passed to all clients,
+	 * see #burst_time.  Protected by #mutex.
+	 */
+	std::deque<SnapcastChunkPtr> burst;
+
 public:
 	/**
 	 * This mutex protects the listener socket, the #clients list
@@ -150,6 +183,14 @@ public:
 	 */
 	void RemoveClient(SnapcastClient &client) noexcept;
 
+	/**
+	 * Pass the recent chunks (see #burst_time) to a client which
+	 * has just become active.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void PushBurst(SnapcastClient &client) noexcept;
+
 	/**
 	 * Caller must lock the mutex.
 	 *
@@ -165,7 +206,21 @@ public:
 		return codec_header;
 	}
 
+	std::chrono::milliseconds GetBufferTime() const noexcept {
+		return buffer_time;
+	}
+
+	/**
+	 * Chunks older than this are dropped from client queues,
+	 * because the client could not play them in time anymore.
+	 */
+	std::chrono::steady_clock::duration GetMaxChunkAge() const noexcept {
+		return buffer_time / 2;
+	}
+
 	/* virtual methods from class AudioOutput */
+	std::map<std::string, std::string> GetAttributes() const noexcept override;
+
 	void Enable() override {
 		Bind();
 	}
@@ -23,12 +23,14 @@
 #include "output/OutputAPI.hxx"
 #include "output/Features.h"
 #include "encoder/EncoderInterface.hxx"
+#include "encoder/EncoderBuffer.hxx"
 #include "encoder/EncoderPlugin.hxx"
 #include "encoder/Configured.hxx"
 #include "encoder/plugins/WaveEncoderPlugin.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
 #include "event/Call.hxx"
+#include "event/Loop.hxx"
 #include "util/Domain.hxx"
 #include "util/DeleteDisposer.hxx"
 #include "util/SpanCast.hxx"
@@ -42,6 +44,8 @@
 #include "lib/yajl/Gen.hxx"
 #endif
 
+#include <fmt/format.h>
+
 #include <cassert>
 
 #include <string.h>
@@ -53,7 +57,11 @@ SnapcastOutput::SnapcastOutput(EventLoop &_loop, const ConfigBlock &block)
 	 ServerSocket(_loop),
 	 inject_event(_loop, BIND_THIS_METHOD(OnInject)),
 	 // TODO: support other encoder plugins?
-	 prepared_encoder(encoder_init(wave_encoder_plugin, block))
+	 prepared_encoder(encoder_init(wave_encoder_plugin, block)),
+	 chunk_pool(std::make_shared<EncoderBufferPool>()),
+	 buffer_time(block.GetPositiveValue("buffer_time", 1000U)),
+	 burst_time(std::chrono::milliseconds(block.GetBlockValue("burst_time", 0U))),
+	 pacing_granularity(std::chrono::milliseconds(block.GetBlockValue("pacing_granularity", 0U)))
 {
 	const unsigned port = block.GetBlockValue("port", 1704U);
 	ServerSocketAddGeneric(*this, block.GetBlockValue("bind_to_address"),
@@ -152,7 +160,7 @@ SnapcastOutput::Open(AudioFormat &audio_format)
 
 	/* initialize other attributes */
 
-	timer = new Timer(audio_format);
+	timer = new Timer(audio_format, pacing_granularity);
 
 	open = true;
 	pause = false;
@@ -171,6 +179,7 @@ SnapcastOutput::Close() noexcept
 		const std::scoped_lock<Mutex> protect(mutex);
 		open = false;
 		clients.clear_and_dispose(DeleteDisposer{});
+		burst.clear();
 	});
 
 	ClearQueue(chunks);
@@ -190,9 +199,32 @@ SnapcastOutput::OnInject() noexcept
 
 		for (auto &client : clients)
 			client.Push(chunk);
+
+		if (burst_time > std::chrono::steady_clock::duration::zero())
+			burst.emplace_back(chunk);
+	}
+
+	if (!burst.empty()) {
+		const auto min_time = GetEventLoop().SteadyNow() - burst_time;
+		while (!burst.empty() && burst.front()->time < min_time)
+			burst.pop_front();
 	}
 }
 
+void
+SnapcastOutput::PushBurst(SnapcastClient &client) noexcept
+{
+	if (burst.empty())
+		return;
+
+	/* skip chunks which Push() would drop right away */
+	const auto min_time = burst.back()->time - GetMaxChunkAge();
+
+	for (const auto &chunk : burst)
+		if (chunk->time >= min_time)
+			client.Push(chunk);
+}
+
 void
 SnapcastOutput::RemoveClient(SnapcastClient &client) noexcept
 {
@@ -205,6 +237,34 @@ SnapcastOutput::RemoveClient(SnapcastClient &client) noexcept
 		drain_cond.notify_one();
 }
 
+std::map<std::string, std::string>
+SnapcastOutput::GetAttributes() const noexcept
+{
+	std::string backlog_ms;
+	uint_least64_t dropped = 0;
+	unsigned n_clients = 0;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+
+		for (const auto &client : clients) {
+			if (!backlog_ms.empty())
+				backlog_ms.push_back(' ');
+			backlog_ms += fmt::format("{}",
+						  std::chrono::duration_cast<std::chrono::milliseconds>(client.GetBacklog()).count());
+
+			dropped += client.GetDroppedChunks();
+			++n_clients;
+		}
+	}
+
+	return {
+		{"clients", fmt::format("{}", n_clients)},
+		{"client_backlog_ms", std::move(backlog_ms)},
+		{"dropped_chunks", fmt::format("{}", dropped)},
+	};
+}
+
 std::chrono::steady_clock::duration
 SnapcastOutput::Delay() const noexcept
 {
@@ -327,20 +387,14 @@ SnapcastOutput::Play(std::span<const std::byte> src)
 		unflushed_input = 0;
 	}
 
-	while (true) {
-		std::byte buffer[32768];
-
-		const auto payload = encoder->Read(std::span{buffer});
-		if (payload.empty())
-			break;
-
+	while (auto payload = encoder->ReadBuffer(*chunk_pool)) {
 		unflushed_input = 0;
 
 		const std::scoped_lock<Mutex> protect(mutex);
 		if (chunks.empty())
 			inject_event.Schedule();
 
-		chunks.push(std::make_shared<SnapcastChunk>(now, AllocatedArray{payload}));
+		chunks.push(std::make_shared<SnapcastChunk>(now, std::move(payload)));
 	}
 
 	return src.size();
@@ -376,6 +430,7 @@ SnapcastOutput::Cancel() noexcept
 	const std::scoped_lock<Mutex> protect(mutex);
 
 	ClearQueue(chunks);
+	burst.clear();
 
 	for (auto &client : clients)
 		client.Cancel();
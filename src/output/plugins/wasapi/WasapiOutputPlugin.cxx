@@ -55,6 +55,7 @@
 #include <variant>
 
 #include <audioclient.h>
+#include <avrt.h>
 #include <initguid.h>
 #include <functiondiscoverykeys_devpkey.h>
 #include <mmdeviceapi.h>
@@ -147,6 +148,37 @@ GetFormats(const AudioFormat &audio_format) noexcept
 	return Result;
 }
 
+/**
+ * Registers the calling thread with the Multimedia Class Scheduler
+ * Service (MMCSS) for the lifetime of this object, which gives it
+ * the scheduling priority of the given task.
+ */
+class MmcssTask {
+	HANDLE handle;
+
+public:
+	MmcssTask(const wchar_t *task, AVRT_PRIORITY priority) noexcept {
+		DWORD task_index = 0;
+		handle = AvSetMmThreadCharacteristicsW(task, &task_index);
+		if (handle == nullptr) {
+			FmtWarning(wasapi_output_domain,
+				   "Failed to register with MMCSS: error {}",
+				   GetLastError());
+			return;
+		}
+
+		AvSetMmThreadPriority(handle, priority);
+	}
+
+	~MmcssTask() noexcept {
+		if (handle != nullptr)
+			AvRevertMmThreadCharacteristics(handle);
+	}
+
+	MmcssTask(const MmcssTask &) = delete;
+	MmcssTask &operator=(const MmcssTask &) = delete;
+};
+
 #ifdef ENABLE_DSD
 void
 SetDSDFallback(AudioFormat &audio_format) noexcept
@@ -323,7 +355,6 @@ class WasapiOutput final : public AudioOutput {
 	ComPtr<IAudioClient> client;
 	WAVEFORMATEXTENSIBLE device_format;
 	std::optional<WasapiOutputThread> thread;
-	std::size_t watermark;
 	std::optional<PcmExport> pcm_export;
 
 public:
@@ -423,6 +454,14 @@ try {
 	LogDebug(wasapi_output_domain, "Working thread started");
 	COM com;
 
+	/* this thread must refill the device buffer within one
+	   period; in exclusive mode, there is no mixer buffer in
+	   between to cover a missed deadline */
+	const MmcssTask mmcss(L"Pro Audio",
+			      is_exclusive
+			      ? AVRT_PRIORITY_CRITICAL
+			      : AVRT_PRIORITY_HIGH);
+
 	AtScopeExit(this) {
 		if (started) {
 			try {
@@ -495,15 +534,24 @@ try {
 			throw MakeHResultError(result, "Failed to get buffer");
 		}
 
+		/* copy straight from the ring buffer into the
+		   device buffer (in two steps if the readable area
+		   wraps around) */
+
 		const UINT32 write_size = write_in_frames * frame_size;
 		std::span w{data, write_size};
 
 		const std::size_t new_data_size = ring_buffer.ReadTo(std::as_writable_bytes(w));
-		if (new_data_size == 0)
+		if (new_data_size == 0) {
 			empty.store(true);
 
-		std::fill_n(data + new_data_size,
-			    write_size - new_data_size, 0);
+			/* let the audio engine generate silence
+			   instead of writing zeroes */
+			mode = AUDCLNT_BUFFERFLAGS_SILENT;
+		} else
+			std::fill_n(data + new_data_size,
+				    write_size - new_data_size, 0);
+
 		InterruptWaiter();
 	}
 } catch (...) {
@@ -670,7 +718,6 @@ WasapiOutput::DoOpen(AudioFormat &audio_format)
 
 	const UINT32 buffer_size_in_frames = GetBufferSizeInFrames(*client);
 
-	watermark = buffer_size_in_frames * 3 * FrameSize();
 	thread.emplace(*client, std::move(render_client), FrameSize(),
 		       buffer_size_in_frames, is_exclusive);
 
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Avx2.hxx"
+
+#ifdef PCM_HAVE_AVX2
+
+#include <immintrin.h>
+
+bool
+HaveAvx2() noexcept
+{
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+
+[[gnu::target("avx2")]]
+void
+Avx2FloatTo16(int16_t *dst, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(32768.f);
+	const __m256 max = _mm256_set1_ps(32767.f);
+	const __m256 min = _mm256_set1_ps(-32768.f);
+
+	/* 16 samples per iteration, so the result fills one 256 bit
+	   register */
+	for (std::size_t i = 0; i < n / 16; ++i, src += 16, dst += 16) {
+		__m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), factor);
+		__m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + 8), factor);
+
+		a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+		b = _mm256_max_ps(_mm256_min_ps(b, max), min);
+
+		/* _mm256_packs_epi32() works on 128 bit lanes;
+		   restore the order of the 64 bit quarters */
+		__m256i result = _mm256_packs_epi32(_mm256_cvttps_epi32(a),
+						    _mm256_cvttps_epi32(b));
+		result = _mm256_permute4x64_epi64(result, 0xd8);
+		_mm256_storeu_si256((__m256i *)dst, result);
+	}
+
+	if (n % 16 >= 8) {
+		/* one block of 8 samples is left */
+		__m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), factor);
+		a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+
+		const __m256i i = _mm256_cvttps_epi32(a);
+		const __m128i result =
+			_mm_packs_epi32(_mm256_castsi256_si128(i),
+					_mm256_extracti128_si256(i, 1));
+		_mm_storeu_si128((__m128i *)dst, result);
+	}
+}
+
+[[gnu::target("avx2")]]
+void
+Avx2FloatTo24(int32_t *dst, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(8388608.f);
+	const __m256 max = _mm256_set1_ps(8388607.f);
+	const __m256 min = _mm256_set1_ps(-8388608.f);
+
+	for (std::size_t i = 0; i < n / 8; ++i, src += 8, dst += 8) {
+		__m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), factor);
+		a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+		_mm256_storeu_si256((__m256i *)dst, _mm256_cvttps_epi32(a));
+	}
+}
+
+[[gnu::target("avx2")]]
+void
+Avx2FloatTo32(int32_t *dst, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(2147483648.f);
+
+	for (std::size_t i = 0; i < n / 8; ++i, src += 8, dst += 8) {
+		const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), factor);
+
+		/* flip 0x80000000 to 0x7fffffff on positive
+		   overflow, see Sse2FloatTo32 */
+		const __m256i overflow =
+			_mm256_castps_si256(_mm256_cmp_ps(a, factor, _CMP_GE_OQ));
+		const __m256i result =
+			_mm256_xor_si256(_mm256_cvttps_epi32(a), overflow);
+		_mm256_storeu_si256((__m256i *)dst, result);
+	}
+}
+
+/**
+ * Transpose a matrix of 8x8 32 bit integers: on input, each
+ * register contains 8 samples of one channel, and on output, each
+ * register contains one frame.
+ */
+[[gnu::target("avx2")]] [[gnu::always_inline]]
+static inline void
+Transpose8x8(__m256i r[8]) noexcept
+{
+	__m256i t[8], u[8];
+
+	for (unsigned i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+	}
+
+	for (unsigned i = 0; i < 8; i += 4) {
+		u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+
+	for (unsigned i = 0; i < 4; ++i) {
+		r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+		r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+	}
+}
+
+/**
+ * Truncate the 32 bit integers in two registers to 16 bit, and
+ * concatenate them to one register.
+ */
+[[gnu::target("avx2")]] [[gnu::always_inline]]
+static inline __m256i
+Narrow16(__m256i a, __m256i b) noexcept
+{
+	/* mask the upper half so the unsigned saturation of
+	   _mm256_packus_epi32() never kicks in */
+	const __m256i mask = _mm256_set1_epi32(0xffff);
+	const __m256i result =
+		_mm256_packus_epi32(_mm256_and_si256(a, mask),
+				    _mm256_and_si256(b, mask));
+
+	/* _mm256_packus_epi32() works on 128 bit lanes; restore
+	   the order of the 64 bit quarters */
+	return _mm256_permute4x64_epi64(result, 0xd8);
+}
+
+[[gnu::target("avx2")]] [[gnu::always_inline]]
+static inline __m128i
+Narrow16(__m256i a) noexcept
+{
+	a = _mm256_and_si256(a, _mm256_set1_epi32(0xffff));
+	return _mm_packus_epi32(_mm256_castsi256_si128(a),
+				_mm256_extracti128_si256(a, 1));
+}
+
+[[gnu::target("avx2")]]
+static std::size_t
+Avx2Interleave32Stereo(int32_t *dest, const int32_t *l, const int32_t *r,
+		       std::size_t n_frames) noexcept
+{
+	const std::size_t n = n_frames / 8 * 8;
+
+	for (std::size_t i = 0; i < n; i += 8, dest += 16) {
+		const __m256i a = _mm256_loadu_si256((const __m256i *)(l + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i *)(r + i));
+
+		/* unpack works on 128 bit lanes, so this yields
+		   frames 0,1,4,5 and 2,3,6,7 */
+		const __m256i lo = _mm256_unpacklo_epi32(a, b);
+		const __m256i hi = _mm256_unpackhi_epi32(a, b);
+
+		_mm256_storeu_si256((__m256i *)dest,
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dest + 8),
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	return n;
+}
+
+[[gnu::target("avx2")]]
+static std::size_t
+Avx2Interleave32To16Stereo(int16_t *dest,
+			   const int32_t *l, const int32_t *r,
+			   std::size_t n_frames) noexcept
+{
+	const std::size_t n = n_frames / 16 * 16;
+
+	for (std::size_t i = 0; i < n; i += 16, dest += 32) {
+		const __m256i a =
+			Narrow16(_mm256_loadu_si256((const __m256i *)(l + i)),
+				 _mm256_loadu_si256((const __m256i *)(l + i + 8)));
+		const __m256i b =
+			Narrow16(_mm256_loadu_si256((const __m256i *)(r + i)),
+				 _mm256_loadu_si256((const __m256i *)(r + i + 8)));
+
+		const __m256i lo = _mm256_unpacklo_epi16(a, b);
+		const __m256i hi = _mm256_unpackhi_epi16(a, b);
+
+		_mm256_storeu_si256((__m256i *)dest,
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dest + 16),
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	return n;
+}
+
+/**
+ * Load 8 frames of 6 or 8 channels and transpose them; the missing
+ * channels are zero.
+ */
+template<unsigned CHANNELS>
+[[gnu::target("avx2")]] [[gnu::always_inline]]
+static inline void
+LoadTransposed(__m256i r[8], const int32_t *const *src,
+	       std::size_t i) noexcept
+{
+	for (unsigned c = 0; c < CHANNELS; ++c)
+		r[c] = _mm256_loadu_si256((const __m256i *)(src[c] + i));
+	for (unsigned c = CHANNELS; c < 8; ++c)
+		r[c] = _mm256_setzero_si256();
+
+	Transpose8x8(r);
+}
+
+/**
+ * How many frames can be processed by Avx2Interleave32Multi() and
+ * Avx2Interleave32To16Multi()?  With 6 channels, each store writes
+ * two samples past the frame, which are overwritten by the next one;
+ * therefore the last block must be followed by at least one more
+ * frame, which will be written later.
+ */
+template<unsigned CHANNELS>
+static constexpr std::size_t
+MultiFrames(std::size_t n_frames) noexcept
+{
+	if constexpr (CHANNELS == 8)
+		return n_frames / 8 * 8;
+	else
+		return n_frames > 0 ? (n_frames - 1) / 8 * 8 : 0;
+}
+
+template<unsigned CHANNELS>
+[[gnu::target("avx2")]]
+static std::size_t
+Avx2Interleave32Multi(int32_t *dest, const int32_t *const *src,
+		      std::size_t n_frames) noexcept
+{
+	const std::size_t n = MultiFrames<CHANNELS>(n_frames);
+
+	for (std::size_t i = 0; i < n; i += 8, dest += 8 * CHANNELS) {
+		__m256i r[8];
+		LoadTransposed<CHANNELS>(r, src, i);
+
+		for (unsigned f = 0; f < 8; ++f)
+			_mm256_storeu_si256((__m256i *)(dest + f * CHANNELS),
+					    r[f]);
+	}
+
+	return n;
+}
+
+template<unsigned CHANNELS>
+[[gnu::target("avx2")]]
+static std::size_t
+Avx2Interleave32To16Multi(int16_t *dest, const int32_t *const *src,
+			  std::size_t n_frames) noexcept
+{
+	const std::size_t n = MultiFrames<CHANNELS>(n_frames);
+
+	for (std::size_t i = 0; i < n; i += 8, dest += 8 * CHANNELS) {
+		__m256i r[8];
+		LoadTransposed<CHANNELS>(r, src, i);
+
+		if constexpr (CHANNELS == 8) {
+			/* two frames per store */
+			for (unsigned f = 0; f < 8; f += 2)
+				_mm256_storeu_si256((__m256i *)(dest + f * CHANNELS),
+						    Narrow16(r[f], r[f + 1]));
+		} else {
+			for (unsigned f = 0; f < 8; ++f)
+				_mm_storeu_si128((__m128i *)(dest + f * CHANNELS),
+						 Narrow16(r[f]));
+		}
+	}
+
+	return n;
+}
+
+std::size_t
+Avx2Interleave32(int32_t *dest, std::span<const int32_t *const> src,
+		 std::size_t n_frames) noexcept
+{
+	switch (src.size()) {
+	case 2:
+		return Avx2Interleave32Stereo(dest, src[0], src[1], n_frames);
+
+	case 6:
+		return Avx2Interleave32Multi<6>(dest, src.data(), n_frames);
+
+	case 8:
+		return Avx2Interleave32Multi<8>(dest, src.data(), n_frames);
+
+	default:
+		return 0;
+	}
+}
+
+std::size_t
+Avx2Interleave32To16(int16_t *dest, std::span<const int32_t *const> src,
+		     std::size_t n_frames) noexcept
+{
+	switch (src.size()) {
+	case 2:
+		return Avx2Interleave32To16Stereo(dest, src[0], src[1],
+						  n_frames);
+
+	case 6:
+		return Avx2Interleave32To16Multi<6>(dest, src.data(), n_frames);
+
+	case 8:
+		return Avx2Interleave32To16Multi<8>(dest, src.data(), n_frames);
+
+	default:
+		return 0;
+	}
+}
+
+#endif
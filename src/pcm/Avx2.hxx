@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_AVX2_HXX
+#define MPD_PCM_AVX2_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+/**
+ * This macro is defined if the AVX2 kernels are available; they are
+ * compiled with a "target" attribute, and whether the CPU supports
+ * them is determined at runtime with HaveAvx2().
+ */
+#define PCM_HAVE_AVX2
+
+/**
+ * Does this CPU support AVX2?  The result is determined only once.
+ */
+[[gnu::const]]
+bool
+HaveAvx2() noexcept;
+
+/*
+ * The following functions convert n/8*8 samples (the remaining ones
+ * must be converted by the caller), with the same results as
+ * #FloatToIntegerSampleConvert.  They must only be called if
+ * HaveAvx2() returns true.
+ */
+
+void
+Avx2FloatTo16(int16_t *dst, const float *src, std::size_t n) noexcept;
+
+void
+Avx2FloatTo24(int32_t *dst, const float *src, std::size_t n) noexcept;
+
+void
+Avx2FloatTo32(int32_t *dst, const float *src, std::size_t n) noexcept;
+
+/*
+ * The following functions interleave planar 32 bit samples; only 2,
+ * 6 and 8 channels are implemented.  They return the number of
+ * frames which were interleaved (0 if the channel count is not
+ * supported), and the caller must interleave the remaining frames.
+ * They must only be called if HaveAvx2() returns true.
+ */
+
+std::size_t
+Avx2Interleave32(int32_t *dest, std::span<const int32_t *const> src,
+		 std::size_t n_frames) noexcept;
+
+/**
+ * Like Avx2Interleave32(), but truncate each sample to 16 bit, like
+ * a C cast does.
+ */
+std::size_t
+Avx2Interleave32To16(int16_t *dest, std::span<const int32_t *const> src,
+		     std::size_t n_frames) noexcept;
+
+#endif
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "Buffer.hxx"
+#include "Scratch.hxx"
 
 void *
 PcmBuffer::Get(size_t new_size) noexcept
@@ -27,5 +28,9 @@ PcmBuffer::Get(size_t new_size) noexcept
 		   assumed to be an error condition */
 		new_size = 1;
 
+	if (scratch)
+		if (void *p = PcmScratch::GetThread().Allocate(new_size))
+			return p;
+
 	return buffer.Get(new_size);
 }
@@ -32,11 +32,29 @@
 class PcmBuffer {
 	ReusableArray<uint8_t, 8192> buffer;
 
+	/**
+	 * See SetScratch().
+	 */
+	bool scratch = false;
+
 public:
 	void Clear() noexcept {
 		buffer.Clear();
 	}
 
+	/**
+	 * Declare that the data returned by Get() is always consumed
+	 * before the enclosing #PcmScratchScope ends, e.g. because
+	 * it is the input of the next conversion stage.  Inside such
+	 * a scope, Get() then allocates from the thread's
+	 * #PcmScratch instead of this object's own buffer.
+	 */
+	void SetScratch(bool _scratch) noexcept {
+		scratch = _scratch;
+		if (scratch)
+			buffer.Clear();
+	}
+
 	/**
 	 * Get the buffer, and guarantee a minimum size.  This buffer becomes
 	 * invalid with the next Get() call.
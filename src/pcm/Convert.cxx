@@ -18,38 +18,157 @@
  */
 
 #include "Convert.hxx"
+#include "Scratch.hxx"
 #include "ConfiguredResampler.hxx"
+#include "ParallelConvert.hxx"
+#include "WorkerPool.hxx"
+#include "config/Data.hxx"
+#include "config/Option.hxx"
 #include "util/SpanCast.hxx"
 
+#ifdef ENABLE_DSD
+#include "config/Parser.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/StringAPI.hxx"
+
+#include <optional>
+#endif
+
 #include <cassert>
 #include <stdexcept>
 
+/**
+ * The pool for #PcmParallelConvert; nullptr if the setting
+ * "conversion_threads" is not enabled.
+ */
+static std::shared_ptr<PcmWorkerPool> pcm_worker_pool;
+
+#ifdef ENABLE_DSD
+
+/**
+ * The configured DSD to PCM decimation ratio; 0 means it is
+ * chosen automatically to match the output sample rate.
+ */
+static unsigned dsd2pcm_decimation = 0;
+
+/**
+ * The configured DSD to PCM filter quality; if none was
+ * configured, 8:1 decimation uses the table based #MultiDsd2Pcm.
+ */
+static std::optional<Dsd2PcmQuality> dsd2pcm_quality;
+
+static unsigned
+ParseDsd2PcmDecimation(const char *s)
+{
+	if (s == nullptr || StringIsEqual(s, "auto"))
+		return 0;
+
+	const unsigned value = ParseUnsigned(s);
+	if (value < 8 || value > 128 || (value & (value - 1)) != 0)
+		throw FmtRuntimeError("Invalid DSD decimation ratio: {}",
+				      s);
+
+	return value;
+}
+
+/**
+ * Choose the DSD decimation ratio, i.e. the number of DSD bits per
+ * PCM sample.  Unless configured explicitly, this is the largest
+ * one which does not go below the destination sample rate, so the
+ * resampler has as little work as possible.
+ *
+ * @param sample_rate the DSD sample rate in bytes per second
+ */
+static unsigned
+ChooseDsd2PcmDecimation(unsigned sample_rate, unsigned dest_rate) noexcept
+{
+	if (dsd2pcm_decimation > 0)
+		return dsd2pcm_decimation;
+
+	const uint_least64_t bit_rate = uint_least64_t(sample_rate) * 8;
+
+	unsigned decimation = 8;
+	while (decimation < 128 &&
+	       bit_rate % (decimation * 2) == 0 &&
+	       bit_rate / (decimation * 2) >= dest_rate)
+		decimation *= 2;
+
+	return decimation;
+}
+
+#endif
+
 void
 pcm_convert_global_init(const ConfigData &config)
 {
 	pcm_resampler_global_init(config);
+
+#ifdef ENABLE_DSD
+	dsd2pcm_decimation = config.With(ConfigOption::DSD2PCM_DECIMATION,
+					 ParseDsd2PcmDecimation);
+
+	dsd2pcm_quality = config.With(ConfigOption::DSD2PCM_QUALITY,
+				      [](const char *s) -> std::optional<Dsd2PcmQuality> {
+		if (s == nullptr)
+			return std::nullopt;
+
+		return ParseDsd2PcmQuality(s);
+	});
+#endif
+
+	const unsigned n_threads =
+		config.GetUnsigned(ConfigOption::CONVERSION_THREADS, 0);
+	if (n_threads > 0)
+		pcm_worker_pool = std::make_shared<PcmWorkerPool>(n_threads);
+}
+
+void
+pcm_convert_global_finish() noexcept
+{
+	pcm_worker_pool.reset();
 }
 
 PcmConvert::PcmConvert(const AudioFormat _src_format,
-		       const AudioFormat dest_format)
+		       const AudioFormat dest_format,
+		       bool allow_parallel)
 	:src_format(_src_format)
 {
 	assert(src_format.IsValid());
 	assert(dest_format.IsValid());
 
 	AudioFormat format = _src_format;
-	if (format.format == SampleFormat::DSD) {
+
+	if (allow_parallel && pcm_worker_pool &&
+	    PcmParallelConvert::IsWorthwhile(src_format, dest_format)) {
+		format.sample_rate = dest_format.sample_rate;
+		format.format = dest_format.format;
+
+		parallel = std::make_unique<PcmParallelConvert>(pcm_worker_pool,
+								src_format,
+								format);
+	} else if (format.format == SampleFormat::DSD) {
 #ifdef ENABLE_DSD
 		dsd2pcm_float = dest_format.format == SampleFormat::FLOAT;
 		format.format = dsd2pcm_float
 			? SampleFormat::FLOAT
 			: SampleFormat::S24_P32;
+
+		const unsigned decimation =
+			ChooseDsd2PcmDecimation(format.sample_rate,
+						dest_format.sample_rate);
+		if (decimation != 8 || dsd2pcm_quality) {
+			dsd.Open(format.channels, format.sample_rate,
+				 decimation,
+				 dsd2pcm_quality.value_or(Dsd2PcmQuality::HIGH));
+			format.sample_rate = format.sample_rate * 8 / decimation;
+		}
 #else
 		throw std::runtime_error("DSD support is disabled");
 #endif
 	}
 
-	enable_resampler = format.sample_rate != dest_format.sample_rate;
+	enable_resampler = !parallel &&
+		format.sample_rate != dest_format.sample_rate;
 	if (enable_resampler) {
 		resampler.Open(format, dest_format.sample_rate);
 
@@ -57,7 +176,7 @@ PcmConvert::PcmConvert(const AudioFormat _src_format,
 		format.sample_rate = dest_format.sample_rate;
 	}
 
-	enable_format = format.format != dest_format.format;
+	enable_format = !parallel && format.format != dest_format.format;
 	if (enable_format) {
 		try {
 			format_converter.Open(format.format,
@@ -72,6 +191,10 @@ PcmConvert::PcmConvert(const AudioFormat _src_format,
 	format.format = dest_format.format;
 
 	enable_channels = format.channels != dest_format.channels;
+
+	/* if the channels converter follows, the output of the
+	   format converter is only needed during Convert() */
+	format_converter.SetScratch(enable_channels);
 	if (enable_channels) {
 		try {
 			channels_converter.Open(format.format, format.channels,
@@ -103,6 +226,9 @@ PcmConvert::~PcmConvert() noexcept
 void
 PcmConvert::Reset() noexcept
 {
+	if (parallel)
+		parallel->Reset();
+
 	if (enable_resampler)
 		resampler.Reset();
 
@@ -114,6 +240,17 @@ PcmConvert::Reset() noexcept
 std::span<const std::byte>
 PcmConvert::Convert(std::span<const std::byte> buffer)
 {
+	const PcmScratchScope scratch_scope;
+
+	if (parallel) {
+		buffer = parallel->Convert(buffer);
+
+		if (enable_channels)
+			buffer = channels_converter.Convert(buffer);
+
+		return buffer;
+	}
+
 #ifdef ENABLE_DSD
 	if (src_format.format == SampleFormat::DSD) {
 		auto s = FromBytesStrict<const uint8_t>(buffer);
@@ -142,6 +279,16 @@ PcmConvert::Convert(std::span<const std::byte> buffer)
 std::span<const std::byte>
 PcmConvert::Flush()
 {
+	const PcmScratchScope scratch_scope;
+
+	if (parallel) {
+		auto buffer = parallel->Flush();
+		if (buffer.data() != nullptr && enable_channels)
+			buffer = channels_converter.Convert(buffer);
+
+		return buffer;
+	}
+
 	if (enable_resampler) {
 		auto buffer = resampler.Flush();
 		if (buffer.data() != nullptr) {
@@ -31,9 +31,11 @@
 #endif
 
 #include <cstddef>
+#include <memory>
 #include <span>
 
 struct ConfigData;
+class PcmParallelConvert;
 
 /**
  * This object is statically allocated (within another struct), and
@@ -49,6 +51,13 @@ class PcmConvert {
 	PcmFormatConverter format_converter;
 	PcmChannelsConverter channels_converter;
 
+	/**
+	 * If set, then this object performs all conversions except
+	 * for #channels_converter, split into channel groups on the
+	 * #PcmWorkerPool (setting "conversion_threads").
+	 */
+	std::unique_ptr<PcmParallelConvert> parallel;
+
 	const AudioFormat src_format;
 
 	bool enable_resampler, enable_format, enable_channels;
@@ -61,8 +70,12 @@ public:
 
 	/**
 	 * Throws on error.
+	 *
+	 * @param allow_parallel may this object split the work on
+	 * the #PcmWorkerPool?
 	 */
-	PcmConvert(AudioFormat _src_format, AudioFormat _dest_format);
+	PcmConvert(AudioFormat _src_format, AudioFormat _dest_format,
+		   bool allow_parallel=true);
 
 	~PcmConvert() noexcept;
 
@@ -91,4 +104,12 @@ public:
 void
 pcm_convert_global_init(const ConfigData &config);
 
+/**
+ * Release the resources allocated by pcm_convert_global_init().
+ * The #PcmWorkerPool threads exit after the last #PcmConvert using
+ * them has been destroyed.
+ */
+void
+pcm_convert_global_finish() noexcept;
+
 #endif
@@ -74,6 +74,58 @@ PcmDither::DitherShift(ST sample) noexcept
 	return Dither<ST, MIN, MAX, SBITS - DBITS>(sample);
 }
 
+/* scoped because this file is included by other sources; see
+   Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+template<typename ST, unsigned SBITS, unsigned DBITS,
+	 typename DT, typename F>
+inline std::size_t
+PcmDither::DitherShiftVector(DT *dest, std::size_t n, F &&f) noexcept
+{
+	static_assert(sizeof(ST) * 8 > SBITS, "Source type too small");
+	static_assert(SBITS > DBITS, "Non-positive scale_bits");
+
+	using namespace PcmVector;
+
+	constexpr unsigned scale_bits = SBITS - DBITS;
+	static constexpr ST MIN = -(ST(1) << (SBITS - 1));
+	static constexpr ST MAX = (ST(1) << (SBITS - 1)) - 1;
+	constexpr ST round = ST(1) << (scale_bits - 1);
+
+	V<uint32_t> r;
+	memcpy(&r, lane_random, sizeof(r));
+
+	/* triangular noise: the difference between two successive
+	   PRNG values; the upper bits are used because the lower
+	   bits of a LCG have a short period */
+	V<int32_t> previous = __builtin_convertvector(r >> (32 - scale_bits),
+						      V<int32_t>);
+
+	std::size_t i = 0;
+	for (; i + N <= n; i += N) {
+		r = pcm_prng_vector(r);
+		const auto current = __builtin_convertvector(r >> (32 - scale_bits),
+							     V<int32_t>);
+		const auto noise = current - previous;
+		previous = current;
+
+		auto samples = f(i);
+		samples += round + __builtin_convertvector(noise, V<ST>);
+		Store(dest + i, Clamp<ST>(samples, MIN, MAX) >> scale_bits);
+	}
+
+	memcpy(lane_random, &r, sizeof(r));
+	return i;
+}
+
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
 template<typename ST, typename DT>
 inline typename DT::value_type
 PcmDither::DitherConvert(typename ST::value_type sample) noexcept
@@ -20,6 +20,8 @@
 #ifndef MPD_PCM_DITHER_HXX
 #define MPD_PCM_DITHER_HXX
 
+#include "Vector.hxx"
+
 #include <cstdint>
 
 enum class SampleFormat : uint8_t;
@@ -28,9 +30,18 @@ class PcmDither {
 	int32_t error[3];
 	int32_t random;
 
+	/**
+	 * Independent PRNG states for the vectorized kernels, one
+	 * per #PcmVector::V lane.
+	 */
+	uint32_t lane_random[PcmVector::N];
+
 public:
 	constexpr PcmDither() noexcept
-		:error{0, 0, 0}, random(0) {}
+		:error{0, 0, 0}, random(0), lane_random{} {
+		for (std::size_t i = 0; i < PcmVector::N; ++i)
+			lane_random[i] = i * 0x9e3779b9U;
+	}
 
 	/**
 	 * Shift the given sample by #SBITS-#DBITS to the right, and
@@ -44,6 +55,25 @@ public:
 	template<typename ST, unsigned SBITS, unsigned DBITS>
 	ST DitherShift(ST sample) noexcept;
 
+	/**
+	 * The vectorized version of DitherShift(): shift
+	 * #PcmVector::N samples at a time and store them in the
+	 * destination buffer.
+	 *
+	 * Unlike the scalar version, this applies plain TPDF
+	 * dither without error feedback, because noise shaping
+	 * requires processing the samples one after another.
+	 *
+	 * @param n the number of samples; only whole vectors are
+	 * processed
+	 * @param f a function which returns the (undithered) source
+	 * vector for the given sample offset
+	 * @return the number of samples which were processed
+	 */
+	template<typename ST, unsigned SBITS, unsigned DBITS,
+		 typename DT, typename F>
+	std::size_t DitherShiftVector(DT *dest, std::size_t n, F &&f) noexcept;
+
 	void Dither24To16(int16_t *dest, const int32_t *src,
 			  const int32_t *src_end) noexcept;
 
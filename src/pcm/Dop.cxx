@@ -19,10 +19,19 @@
 
 #include "Dop.hxx"
 #include "ChannelDefs.hxx"
+#include "Vector.hxx"
+#include "util/ByteOrder.hxx"
 
 #include <cassert>
 #include <functional>
 
+#include <string.h>
+
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 static constexpr uint32_t
 pcm_two_dsd_to_dop_marker1(uint8_t a, uint8_t b) noexcept
 {
@@ -35,6 +44,73 @@ pcm_two_dsd_to_dop_marker2(uint8_t a, uint8_t b) noexcept
 	return 0xfffa0000 | (a << 8) | b;
 }
 
+/**
+ * The DoP markers for #PcmVector::N consecutive source words (see
+ * DsdToDopMono() and DsdToDopStereo()); they alternate because each
+ * "quad" consists of two words.
+ */
+static constexpr PcmVector::V<uint32_t> dop_markers{
+	0xff050000, 0xfffa0000, 0xff050000, 0xfffa0000,
+	0xff050000, 0xfffa0000, 0xff050000, 0xfffa0000,
+};
+
+static_assert(PcmVector::N == 8);
+
+/**
+ * Vectorized DsdToDop() for one channel: each 16 bit word of the
+ * source becomes one DoP sample.  Only on little-endian CPUs.
+ *
+ * @return the number of quads which were converted
+ */
+static size_t
+DsdToDopMono(uint32_t *dest, const uint8_t *src,
+	     size_t num_dop_quads) noexcept
+{
+	using namespace PcmVector;
+	static constexpr size_t quads_per_step = N / 2;
+
+	size_t i = 0;
+	for (; i + quads_per_step <= num_dop_quads; i += quads_per_step,
+		     src += 4 * quads_per_step, dest += 2 * quads_per_step) {
+		const auto x = Load<uint32_t>((const uint16_t *)src);
+		Store(dest, dop_markers | ((x & 0xff) << 8) | (x >> 8));
+	}
+
+	return i;
+}
+
+/**
+ * Vectorized DsdToDop() for two channels: each 32 bit word of the
+ * source contains two bytes of each channel, which become two DoP
+ * samples.  Only on little-endian CPUs.
+ *
+ * @return the number of quads which were converted
+ */
+static size_t
+DsdToDopStereo(uint32_t *dest, const uint8_t *src,
+	       size_t num_dop_quads) noexcept
+{
+	using namespace PcmVector;
+	static constexpr size_t quads_per_step = N / 2;
+
+	size_t i = 0;
+	for (; i + quads_per_step <= num_dop_quads; i += quads_per_step,
+		     src += 8 * quads_per_step, dest += 4 * quads_per_step) {
+		const auto x = Load<uint32_t>((const uint32_t *)src);
+		const auto left = dop_markers | ((x & 0xff) << 8) |
+			((x >> 16) & 0xff);
+		const auto right = dop_markers | (x & 0xff00) | (x >> 24);
+
+		/* the left sample goes to the lower half of each 64
+		   bit word, i.e. first */
+		const auto w = __builtin_convertvector(left, V<uint64_t>) |
+			(__builtin_convertvector(right, V<uint64_t>) << 32);
+		memcpy(dest, &w, sizeof(w));
+	}
+
+	return i;
+}
+
 /**
  * @param num_dop_quads the number of "quad" bytes per channel in the
  * source buffer; each "quad" will be converted to two 24 bit samples
@@ -44,6 +120,18 @@ static void
 DsdToDop(uint32_t *dest, const uint8_t *src,
 	 size_t num_dop_quads, unsigned channels) noexcept
 {
+	if constexpr (IsLittleEndian()) {
+		size_t n = 0;
+		if (channels == 1)
+			n = DsdToDopMono(dest, src, num_dop_quads);
+		else if (channels == 2)
+			n = DsdToDopStereo(dest, src, num_dop_quads);
+
+		dest += n * 2 * channels;
+		src += n * 4 * channels;
+		num_dop_quads -= n;
+	}
+
 	for (size_t i = num_dop_quads; i > 0; --i) {
 		for (unsigned c = channels; c > 0; --c) {
 			/* each 24 bit sample has 16 DSD sample bits
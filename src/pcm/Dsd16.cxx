@@ -18,6 +18,15 @@
  */
 
 #include "Dsd16.hxx"
+#include "Vector.hxx"
+#include "util/ByteOrder.hxx"
+
+#include <string.h>
+
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
 
 /**
  * Construct a 16 bit integer from two bytes.
@@ -37,10 +46,70 @@ Dsd8To16Sample(const uint8_t *src, unsigned channels) noexcept
 	return Construct16(src[0], src[channels]);
 }
 
+/**
+ * Vectorized Dsd8To16() for one channel: swap the bytes of each 16
+ * bit word.  Only on little-endian CPUs.
+ *
+ * @return the number of frames which were converted
+ */
+static size_t
+Dsd8To16Mono(uint16_t *dest, const uint8_t *src, size_t out_frames) noexcept
+{
+	using namespace PcmVector;
+	static constexpr size_t n = 2 * N;
+
+	size_t i = 0;
+	for (; i + n <= out_frames; i += n, src += 2 * n, dest += n) {
+		const auto x = Load<uint16_t, n>((const uint16_t *)src);
+		Store(dest, (x << 8) | (x >> 8));
+	}
+
+	return i;
+}
+
+/**
+ * Vectorized Dsd8To16() for two channels: each 32 bit word of the
+ * source contains two bytes of each channel.  Only on little-endian
+ * CPUs.
+ *
+ * @return the number of frames which were converted
+ */
+static size_t
+Dsd8To16Stereo(uint16_t *dest, const uint8_t *src, size_t out_frames) noexcept
+{
+	using namespace PcmVector;
+
+	size_t i = 0;
+	for (; i + N <= out_frames; i += N, src += 4 * N, dest += 2 * N) {
+		const auto x = Load<uint32_t>((const uint32_t *)src);
+		const auto left = ((x & 0xff) << 8) | ((x >> 16) & 0xff);
+		const auto right = (x & 0xff00) | (x >> 24);
+
+		/* the left sample goes to the lower half of each 32
+		   bit word, i.e. first */
+		const auto w = left | (right << 16);
+		memcpy(dest, &w, sizeof(w));
+	}
+
+	return i;
+}
+
 static void
 Dsd8To16(uint16_t *dest, const uint8_t *src,
 	 size_t out_frames, unsigned channels) noexcept
 {
+	if constexpr (IsLittleEndian()) {
+		size_t n = 0;
+		if (channels == 1)
+			n = Dsd8To16Mono(dest, src, out_frames);
+		else if (channels == 2)
+			n = Dsd8To16Stereo(dest, src, out_frames);
+
+		dest += n * channels;
+		src += n * 2 * channels;
+		out_frames -= n;
+	}
+
 	for (size_t i = 0; i < out_frames; ++i) {
 		for (size_t c = 0; c < channels; ++c)
 			*dest++ = Dsd8To16Sample(src++, channels);
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Dsd2PcmFir.hxx"
+#include "Traits.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/StringAPI.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <string.h>
+
+Dsd2PcmQuality
+ParseDsd2PcmQuality(const char *s)
+{
+	if (StringIsEqual(s, "low"))
+		return Dsd2PcmQuality::LOW;
+	else if (StringIsEqual(s, "medium"))
+		return Dsd2PcmQuality::MEDIUM;
+	else if (StringIsEqual(s, "high"))
+		return Dsd2PcmQuality::HIGH;
+	else
+		throw FmtRuntimeError("Invalid DSD to PCM quality: {}", s);
+}
+
+static constexpr double
+GetStopbandAttenuation(Dsd2PcmQuality quality) noexcept
+{
+	switch (quality) {
+	case Dsd2PcmQuality::LOW:
+		return 80;
+
+	case Dsd2PcmQuality::MEDIUM:
+		return 120;
+
+	case Dsd2PcmQuality::HIGH:
+		break;
+	}
+
+	return 160;
+}
+
+/**
+ * The modified Bessel function of the first kind, order zero.
+ */
+static double
+BesselI0(double x) noexcept
+{
+	double sum = 1, term = 1;
+	for (unsigned k = 1; term > sum * 1e-12; ++k) {
+		const double t = x / (2 * k);
+		term *= t * t;
+		sum += term;
+	}
+
+	return sum;
+}
+
+void
+Dsd2PcmFir::Open(unsigned _channels, unsigned sample_rate,
+		 unsigned decimation, Dsd2PcmQuality quality)
+{
+	if (decimation < 8 || decimation > 128 ||
+	    (decimation & (decimation - 1)) != 0)
+		throw FmtRuntimeError("Invalid DSD decimation ratio: {}",
+				      decimation);
+
+	channels = _channels;
+	step = decimation / 8;
+
+	/* the pass band is at least the audible range; at high
+	   output rates, it is limited to leave a wide transition
+	   band, which keeps the filter short; aliases from the
+	   transition band only fall into the transition band */
+	const double bit_rate = double(sample_rate) * 8;
+	const double out_rate = bit_rate / decimation;
+	const double passband = std::min(0.45 * out_rate,
+					 std::max(20000., 0.2 * out_rate));
+	const double stopband = out_rate - passband;
+
+	/* Kaiser window design formulas */
+	const double attenuation = GetStopbandAttenuation(quality);
+	const double transition = 2 * M_PI * (stopband - passband) / bit_rate;
+	const std::size_t n_taps =
+		std::size_t(std::ceil((attenuation - 7.95) / (2.285 * transition))) + 1;
+	const double beta = 0.1102 * (attenuation - 8.7);
+
+	n_bytes = std::max((n_taps + 7) / 8, step);
+	const std::size_t n = n_bytes * 8;
+
+	/* cutoff in the middle of the transition band, i.e. at the
+	   Nyquist frequency of the output */
+	const double fc = 0.5 / decimation;
+	const double center = (n - 1) / 2.;
+	const double i0_beta = BesselI0(beta);
+
+	coefficients.ResizeDiscard(n);
+
+	double sum = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const double x = i - center;
+		const double sinc = x == 0
+			? 2 * fc
+			: std::sin(2 * M_PI * fc * x) / (M_PI * x);
+		const double r = x / center;
+		const double window = BesselI0(beta * std::sqrt(1 - r * r)) / i0_beta;
+		const double h = sinc * window;
+		coefficients[i] = float(h);
+		sum += h;
+	}
+
+	/* normalize to unity gain; bits are evaluated as 0/1, so
+	   the result is scaled by 2 and shifted by the sum */
+	float float_sum = 0;
+	for (auto &i : coefficients) {
+		i = float(double(i) * 2 / sum);
+		float_sum += i;
+	}
+
+	offset = float_sum / 2;
+
+	history.ResizeDiscard(channels * n_bytes);
+	Reset();
+}
+
+void
+Dsd2PcmFir::Reset() noexcept
+{
+	/* the same silence pattern as Dsd2Pcm::Reset(); start with
+	   a full filter, so each input step produces exactly one
+	   output sample */
+	std::fill(history.begin(), history.end(), 0x69);
+	history_size = n_bytes - step;
+}
+
+/**
+ * Apply the FIR filter to the given window of DSD bytes.
+ *
+ * Each byte is processed as two 128 bit vectors of 4 bits each,
+ * because that is the native vector width of SSE2 and NEON.
+ */
+[[gnu::pure]]
+static float
+Convolve(const uint8_t *window, const float *coefficients,
+	 std::size_t n_bytes) noexcept
+{
+	typedef float F4 __attribute__((vector_size(16)));
+	typedef int32_t I4 __attribute__((vector_size(16)));
+
+	const I4 high_mask{128, 64, 32, 16}, low_mask{8, 4, 2, 1};
+
+	/* two sets of accumulators (for even and odd bytes) hide
+	   the latency of the addition */
+	F4 acc[4]{};
+
+	auto apply = [&high_mask, &low_mask](F4 *a, uint8_t byte,
+					     const float *c) noexcept {
+		F4 c_high, c_low;
+		memcpy(&c_high, c, sizeof(c_high));
+		memcpy(&c_low, c + 4, sizeof(c_low));
+
+		/* all bits of a lane are set if the DSD bit is 1 */
+		const I4 b = I4{} + byte;
+		const I4 m_high = (b & high_mask) == high_mask;
+		const I4 m_low = (b & low_mask) == low_mask;
+
+		a[0] += (F4)((I4)c_high & m_high);
+		a[1] += (F4)((I4)c_low & m_low);
+	};
+
+	std::size_t i = 0;
+	for (; i + 2 <= n_bytes; i += 2, coefficients += 16) {
+		apply(acc, window[i], coefficients);
+		apply(acc + 2, window[i + 1], coefficients + 8);
+	}
+
+	if (i < n_bytes)
+		apply(acc, window[i], coefficients);
+
+	const F4 sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+template<typename T, typename F>
+std::size_t
+Dsd2PcmFir::Filter(std::span<const uint8_t> src, T *dest,
+		   F &&convert) noexcept
+{
+	assert(src.size() % channels == 0);
+
+	const std::size_t n_new = src.size() / channels;
+	const std::size_t total = history_size + n_new;
+	const std::size_t n_frames = total >= n_bytes
+		? (total - n_bytes) / step + 1
+		: 0;
+	const std::size_t consumed = n_frames * step;
+	const std::size_t remaining = total - consumed;
+	assert(remaining <= n_bytes);
+
+	auto *work = work_buffer.GetT<uint8_t>(total);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		uint8_t *h = history.data() + c * n_bytes;
+
+		memcpy(work, h, history_size);
+		for (std::size_t i = 0; i < n_new; ++i)
+			work[history_size + i] = src[i * channels + c];
+
+		for (std::size_t i = 0; i < n_frames; ++i)
+			dest[i * channels + c] =
+				convert(Convolve(work + i * step,
+						 coefficients.data(),
+						 n_bytes) - offset);
+
+		memcpy(h, work + consumed, remaining);
+	}
+
+	history_size = remaining;
+	return n_frames;
+}
+
+std::span<const float>
+Dsd2PcmFir::ToFloat(std::span<const uint8_t> src) noexcept
+{
+	auto *dest = buffer.GetT<float>(GetMaxFrames(src.size()) * channels);
+
+	const std::size_t n_frames = Filter(src, dest, [](float x){
+		return x;
+	});
+
+	return { dest, n_frames * channels };
+}
+
+std::span<const int32_t>
+Dsd2PcmFir::ToS24(std::span<const uint8_t> src) noexcept
+{
+	using Traits = SampleTraits<SampleFormat::S24_P32>;
+
+	auto *dest = buffer.GetT<int32_t>(GetMaxFrames(src.size()) * channels);
+
+	const std::size_t n_frames = Filter(src, dest, [](float x){
+		x = std::clamp(x, -1.f, 1.f);
+		return int32_t(std::lrint(x * Traits::MAX));
+	});
+
+	return { dest, n_frames * channels };
+}
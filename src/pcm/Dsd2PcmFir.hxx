@@ -0,0 +1,139 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_DSD2PCM_FIR_HXX
+#define MPD_PCM_DSD2PCM_FIR_HXX
+
+#include "Buffer.hxx"
+#include "util/AllocatedArray.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+enum class Dsd2PcmQuality : uint8_t {
+	/**
+	 * 80 dB stopband attenuation.
+	 */
+	LOW,
+
+	/**
+	 * 120 dB stopband attenuation.
+	 */
+	MEDIUM,
+
+	/**
+	 * 160 dB stopband attenuation, like the table based
+	 * #Dsd2Pcm filter.
+	 */
+	HIGH,
+};
+
+/**
+ * Parse a #Dsd2PcmQuality name ("low", "medium", "high").
+ *
+ * Throws on error.
+ */
+Dsd2PcmQuality
+ParseDsd2PcmQuality(const char *s);
+
+/**
+ * A DSD to PCM converter with a configurable decimation ratio.
+ * Unlike #MultiDsd2Pcm, it does not use lookup tables: the FIR
+ * filter (a Kaiser windowed sinc designed at runtime) is evaluated
+ * with vector operations, one lane per DSD bit.  This makes it
+ * possible to decimate DSD512 to 352.8 kHz directly instead of
+ * generating 2.8 MHz PCM and resampling it afterwards.
+ */
+class Dsd2PcmFir {
+	unsigned channels;
+
+	/**
+	 * The number of DSD bytes per channel consumed by one
+	 * output sample (decimation ratio divided by 8).
+	 */
+	std::size_t step;
+
+	/**
+	 * The filter length in bytes.
+	 */
+	std::size_t n_bytes;
+
+	/**
+	 * The filter coefficients; 8 per byte, in the order of the
+	 * bits within a byte (MSB first).
+	 */
+	AllocatedArray<float> coefficients;
+
+	/**
+	 * The sum of all coefficients.  The filter is evaluated
+	 * with bits being 0 or 1 instead of -1 or +1; this is
+	 * subtracted to restore the symmetry.
+	 */
+	float offset;
+
+	/**
+	 * Unconsumed input bytes of all channels; each channel has
+	 * #n_bytes space, the first #history_size of which are used.
+	 */
+	AllocatedArray<uint8_t> history;
+	std::size_t history_size;
+
+	PcmBuffer work_buffer, buffer;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param sample_rate the DSD sample rate in bytes per
+	 * second (i.e. #AudioFormat::sample_rate)
+	 * @param decimation the decimation ratio; a power of two
+	 * between 8 and 128
+	 */
+	void Open(unsigned channels, unsigned sample_rate,
+		  unsigned decimation, Dsd2PcmQuality quality);
+
+	/**
+	 * Resets the internal state for a fresh new stream.
+	 */
+	void Reset() noexcept;
+
+	std::span<const float> ToFloat(std::span<const uint8_t> src) noexcept;
+
+	std::span<const int32_t> ToS24(std::span<const uint8_t> src) noexcept;
+
+private:
+	/**
+	 * Append the new bytes to the history of each channel and
+	 * calculate as many output samples as possible.
+	 *
+	 * @param convert a function converting the float value
+	 * (-1.0 to 1.0) to the destination sample type
+	 * @return the number of output frames
+	 */
+	template<typename T, typename F>
+	std::size_t Filter(std::span<const uint8_t> src, T *dest,
+			   F &&convert) noexcept;
+
+	std::size_t GetMaxFrames(std::size_t src_size) const noexcept {
+		return (history_size + src_size / channels) / step + 1;
+	}
+};
+
+#endif
@@ -18,6 +18,15 @@
  */
 
 #include "Dsd32.hxx"
+#include "Vector.hxx"
+#include "util/ByteOrder.hxx"
+
+#include <string.h>
+
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
 
 /**
  * Construct a 32 bit integer from four bytes.
@@ -39,10 +48,73 @@ Dsd8To32Sample(const uint8_t *src, unsigned channels) noexcept
 			   src[2 * channels], src[3 * channels]);
 }
 
+/**
+ * Vectorized Dsd8To32() for one channel: swap the bytes of each 32
+ * bit word.  Only on little-endian CPUs.
+ *
+ * @return the number of frames which were converted
+ */
+static size_t
+Dsd8To32Mono(uint32_t *dest, const uint8_t *src, size_t out_frames) noexcept
+{
+	using namespace PcmVector;
+
+	size_t i = 0;
+	for (; i + N <= out_frames; i += N, src += 4 * N, dest += N) {
+		const auto x = Load<uint32_t>((const uint32_t *)src);
+		Store(dest, (x << 24) | ((x & 0xff00) << 8) |
+		      ((x >> 8) & 0xff00) | (x >> 24));
+	}
+
+	return i;
+}
+
+/**
+ * Vectorized Dsd8To32() for two channels: each 64 bit word of the
+ * source contains four bytes of each channel.  Only on
+ * little-endian CPUs.
+ *
+ * @return the number of frames which were converted
+ */
+static size_t
+Dsd8To32Stereo(uint32_t *dest, const uint8_t *src, size_t out_frames) noexcept
+{
+	using namespace PcmVector;
+
+	size_t i = 0;
+	for (; i + N <= out_frames; i += N, src += 8 * N, dest += 2 * N) {
+		const auto x = Load<uint64_t>((const uint64_t *)src);
+		const auto left = ((x & 0xff) << 24) | (x & 0xff0000) |
+			((x >> 24) & 0xff00) | ((x >> 48) & 0xff);
+		const auto right = ((x & 0xff00) << 16) |
+			((x >> 8) & 0xff0000) |
+			((x >> 32) & 0xff00) | (x >> 56);
+
+		/* the left sample goes to the lower half of each 64
+		   bit word, i.e. first */
+		const auto w = left | (right << 32);
+		memcpy(dest, &w, sizeof(w));
+	}
+
+	return i;
+}
+
 static void
 Dsd8To32(uint32_t *dest, const uint8_t *src,
 	 size_t out_frames, unsigned channels) noexcept
 {
+	if constexpr (IsLittleEndian()) {
+		size_t n = 0;
+		if (channels == 1)
+			n = Dsd8To32Mono(dest, src, out_frames);
+		else if (channels == 2)
+			n = Dsd8To32Stereo(dest, src, out_frames);
+
+		dest += n * channels;
+		src += n * 4 * channels;
+		out_frames -= n;
+	}
+
 	for (size_t i = 0; i < out_frames; ++i) {
 		for (size_t c = 0; c < channels; ++c)
 			*dest++ = Dsd8To32Sample(src++, channels);
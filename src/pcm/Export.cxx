@@ -20,7 +20,9 @@
 #include "Export.hxx"
 #include "Order.hxx"
 #include "Pack.hxx"
+#include "Scratch.hxx"
 #include "Silence.hxx"
+#include "util/ByteOrder.hxx"
 #include "util/ByteReverse.hxx"
 #include "util/SpanCast.hxx"
 
@@ -33,6 +35,17 @@ PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 {
 	assert(audio_valid_sample_format(sample_format));
 
+	if (is_open && sample_format == src_sample_format &&
+	    _channels == channels && params == open_params) {
+		/* same configuration as last time: only discard the
+		   converter state left over from the previous
+		   stream */
+		Reset();
+		return;
+	}
+
+	is_open = true;
+	open_params = params;
 	src_sample_format = sample_format;
 	channels = _channels;
 	alsa_channel_order = params.alsa_channel_order;
@@ -91,6 +104,18 @@ PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 			reverse_endian = sample_size;
 	}
 
+	/* intermediate results which are consumed by a later stage
+	   of Export() can live in the thread's PcmScratch */
+	order_buffer.SetScratch(
+#ifdef ENABLE_DSD
+				dsd_mode != DsdMode::NONE ||
+#endif
+				pack24 || shift8 || reverse_endian > 0);
+
+	/* the byte order reversal is fused into the pack24/shift8
+	   pass, so pack_buffer is always the last stage */
+	pack_buffer.SetScratch(false);
+
 	/* prepare a moment of silence for GetSilence() */
 	std::byte buffer[sizeof(silence_buffer)];
 	const size_t buffer_size = GetInputBlockSize();
@@ -264,6 +289,8 @@ PcmExport::Params::CalcInputSampleRate(unsigned sample_rate) const noexcept
 std::span<const std::byte>
 PcmExport::Export(std::span<const std::byte> data) noexcept
 {
+	const PcmScratchScope scratch_scope;
+
 	if (alsa_channel_order)
 		data = ToAlsaChannelOrder(order_buffer, data,
 					  src_sample_format, channels);
@@ -294,7 +321,11 @@ PcmExport::Export(std::span<const std::byte> data) noexcept
 		auto *dest = (uint8_t *)pack_buffer.Get(dest_size);
 		assert(dest != nullptr);
 
-		pcm_pack_24(dest, src.data(), src.data() + src.size());
+		if (reverse_endian > 0)
+			pcm_pack_24_reverse(dest, src.data(),
+					    src.data() + src.size());
+		else
+			pcm_pack_24(dest, src.data(), src.data() + src.size());
 
 		data = std::as_bytes(std::span{dest, dest_size});
 	} else if (shift8) {
@@ -303,11 +334,16 @@ PcmExport::Export(std::span<const std::byte> data) noexcept
 		auto *dest = (uint32_t *)pack_buffer.Get(data.size());
 		data = {(const std::byte *)dest, data.size()};
 
-		for (auto i : src)
-			*dest++ = i << 8;
-	}
+		if (reverse_endian > 0) {
+			assert(reverse_endian == 4);
 
-	if (reverse_endian > 0) {
+			for (auto i : src)
+				*dest++ = ByteSwap32(uint32_t(i) << 8);
+		} else {
+			for (auto i : src)
+				*dest++ = i << 8;
+		}
+	} else if (reverse_endian > 0) {
 		assert(reverse_endian >= 2);
 
 		const auto src = FromBytesStrict<const uint8_t>(data);
@@ -65,14 +65,17 @@ class PcmExport {
 #endif
 
 	/**
-	 * The buffer is used to pack samples, removing padding.
+	 * The buffer is used to pack samples, removing padding.  If
+	 * #reverse_endian is also set, the byte order is reversed in
+	 * the same pass.
 	 *
-	 * @see #pack24
+	 * @see #pack24, #shift8
 	 */
 	PcmBuffer pack_buffer;
 
 	/**
-	 * The buffer is used to reverse the byte order.
+	 * The buffer is used to reverse the byte order (unless this
+	 * is done by the #pack_buffer pass).
 	 *
 	 * @see #reverse_endian
 	 */
@@ -143,6 +146,12 @@ private:
 	 */
 	uint8_t reverse_endian;
 
+	/**
+	 * Has Open() been called?  This enables the shortcut in
+	 * Open() which reuses the previous configuration.
+	 */
+	bool is_open = false;
+
 public:
 	struct Params {
 		bool alsa_channel_order = false;
@@ -153,6 +162,8 @@ public:
 		bool pack24 = false;
 		bool reverse_endian = false;
 
+		constexpr bool operator==(const Params &) const noexcept = default;
+
 		/**
 		 * Calculate the output sample rate, given a specific input
 		 * sample rate.  Usually, both are the same; however, with
@@ -169,11 +180,22 @@ public:
 		unsigned CalcInputSampleRate(unsigned output_sample_rate) const noexcept;
 	};
 
+private:
+	/**
+	 * The #Params passed to the last Open() call.
+	 */
+	Params open_params;
+
+public:
+
 	/**
 	 * Open the object.
 	 *
 	 * There is no "close" method.  This function may be called multiple
-	 * times to reuse the object.
+	 * times to reuse the object.  If the parameters are the same as
+	 * in the previous call (e.g. the next song has the same audio
+	 * format), then the configuration is kept, and only Reset() is
+	 * called.
 	 *
 	 * This function cannot fail.
 	 *
@@ -66,6 +66,13 @@ public:
 	 */
 	void Close() noexcept;
 
+	/**
+	 * @see PcmBuffer::SetScratch()
+	 */
+	void SetScratch(bool scratch) noexcept {
+		buffer.SetScratch(scratch);
+	}
+
 	/**
 	 * Convert a block of PCM data.
 	 *
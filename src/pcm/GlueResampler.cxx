@@ -18,6 +18,7 @@
  */
 
 #include "GlueResampler.hxx"
+#include "Scratch.hxx"
 #include "ConfiguredResampler.hxx"
 #include "Resampler.hxx"
 #include "AudioFormat.hxx"
@@ -47,10 +48,15 @@ GluePcmResampler::Open(AudioFormat src_format, unsigned new_sample_rate)
 	assert(dest_format.channels == src_format.channels);
 	assert(dest_format.sample_rate == new_sample_rate);
 
-	if (requested_format.format != src_format.format)
+	if (requested_format.format != src_format.format) {
 		format_converter.Open(src_format.format,
 				      requested_format.format);
 
+		/* the converted data is consumed by the resampler
+		   right away */
+		format_converter.SetScratch(true);
+	}
+
 	src_sample_format = src_format.format;
 	requested_sample_format = requested_format.format;
 	output_sample_format = dest_format.format;
@@ -74,6 +80,8 @@ GluePcmResampler::Reset() noexcept
 std::span<const std::byte>
 GluePcmResampler::Resample(std::span<const std::byte> src)
 {
+	const PcmScratchScope scratch_scope;
+
 	if (requested_sample_format != src_sample_format)
 		src = format_converter.Convert(src);
 
@@ -18,9 +18,20 @@
  */
 
 #include "Interleave.hxx"
+#include "Avx2.hxx"
+#include "Vector.hxx"
+#include "util/ByteOrder.hxx"
+
+#include <array>
+#include <cassert>
 
 #include <string.h>
 
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 static void
 GenericPcmInterleave(uint8_t *gcc_restrict dest,
 		     std::span<const uint8_t *const> src,
@@ -35,23 +46,28 @@ GenericPcmInterleave(uint8_t *gcc_restrict dest,
 	}
 }
 
-template<typename T>
+/**
+ * @param D the destination sample type; if it is smaller than #S,
+ * samples are truncated
+ * @param S the source sample type
+ */
+template<typename D, typename S=D>
 static void
-PcmInterleaveStereo(T *gcc_restrict dest,
-		    const T *gcc_restrict src1,
-		    const T *gcc_restrict src2,
+PcmInterleaveStereo(D *gcc_restrict dest,
+		    const S *gcc_restrict src1,
+		    const S *gcc_restrict src2,
 		    size_t n_frames) noexcept
 {
 	for (size_t i = 0; i != n_frames; ++i) {
-		*dest++ = *src1++;
-		*dest++ = *src2++;
+		*dest++ = D(*src1++);
+		*dest++ = D(*src2++);
 	}
 }
 
-template<typename T>
+template<typename D, typename S=D>
 static void
-PcmInterleaveT(T *gcc_restrict dest,
-	       const std::span<const T *const> src,
+PcmInterleaveT(D *gcc_restrict dest,
+	       const std::span<const S *const> src,
 	       size_t n_frames) noexcept
 {
 	switch (src.size()) {
@@ -65,10 +81,73 @@ PcmInterleaveT(T *gcc_restrict dest,
 
 		for (const auto *const s_end = s + n_frames;
 		     s != s_end; ++s, d += src.size())
-			*d = *s;
+			*d = D(*s);
 	}
 }
 
+#ifdef PCM_HAVE_AVX2
+
+/**
+ * Interleave the frames which were not handled by the AVX2 kernel.
+ *
+ * @param done the number of frames already interleaved
+ */
+template<typename D, typename S>
+static void
+PcmInterleaveRest(D *gcc_restrict dest,
+		  const std::span<const S *const> src,
+		  size_t done, size_t n_frames) noexcept
+{
+	/* the AVX2 kernels support up to 8 channels */
+	std::array<const S *, 8> rest;
+	assert(src.size() <= rest.size());
+
+	for (size_t c = 0; c < src.size(); ++c)
+		rest[c] = src[c] + done;
+
+	PcmInterleaveT<D, S>(dest + done * src.size(),
+			     {rest.data(), src.size()},
+			     n_frames - done);
+}
+
+#endif
+
+/**
+ * Interleave two channels of 8 bit samples (i.e. DSD), 16 frames at
+ * a time: each pair of samples is combined to one 16 bit word.
+ */
+static void
+PcmInterleave8Stereo(uint8_t *gcc_restrict dest,
+		     const uint8_t *gcc_restrict src1,
+		     const uint8_t *gcc_restrict src2,
+		     size_t n_frames) noexcept
+{
+	if constexpr (IsLittleEndian()) {
+		using namespace PcmVector;
+		static constexpr std::size_t n = 2 * N;
+
+		for (; n_frames >= n; n_frames -= n,
+			     src1 += n, src2 += n, dest += 2 * n) {
+			const auto a = Load<uint16_t, n>(src1);
+			const auto b = Load<uint16_t, n>(src2);
+			Store((uint16_t *)dest, a | (b << 8));
+		}
+	}
+
+	PcmInterleaveStereo(dest, src1, src2, n_frames);
+}
+
+static void
+PcmInterleave8(uint8_t *gcc_restrict dest,
+	       const std::span<const uint8_t *const> src,
+	       size_t n_frames) noexcept
+{
+	if (src.size() == 2)
+		PcmInterleave8Stereo(dest, src[0], src[1], n_frames);
+	else
+		PcmInterleaveT(dest, src, n_frames);
+}
+
 static void
 PcmInterleave16(int16_t *gcc_restrict dest,
 		const std::span<const int16_t *const> src,
@@ -82,6 +161,34 @@ PcmInterleave32(int32_t *gcc_restrict dest,
 		const std::span<const int32_t *const> src,
 		size_t n_frames) noexcept
 {
+#ifdef PCM_HAVE_AVX2
+	if (HaveAvx2()) {
+		const size_t done = Avx2Interleave32(dest, src, n_frames);
+		if (done > 0) {
+			PcmInterleaveRest(dest, src, done, n_frames);
+			return;
+		}
+	}
+#endif
+
+	PcmInterleaveT(dest, src, n_frames);
+}
+
+void
+PcmInterleave32To16(int16_t *gcc_restrict dest,
+		    const std::span<const int32_t *const> src,
+		    size_t n_frames) noexcept
+{
+#ifdef PCM_HAVE_AVX2
+	if (HaveAvx2()) {
+		const size_t done = Avx2Interleave32To16(dest, src, n_frames);
+		if (done > 0) {
+			PcmInterleaveRest(dest, src, done, n_frames);
+			return;
+		}
+	}
+#endif
+
 	PcmInterleaveT(dest, src, n_frames);
 }
 
@@ -91,6 +198,12 @@ PcmInterleave(void *gcc_restrict dest,
 	      size_t n_frames, size_t sample_size) noexcept
 {
 	switch (sample_size) {
+	case 1:
+		PcmInterleave8((uint8_t *)dest,
+			       {(const uint8_t *const*)src.data(), src.size()},
+			       n_frames);
+		break;
+
 	case 2:
 		PcmInterleave16((int16_t *)dest,
 				{(const int16_t *const*)src.data(), src.size()},
@@ -42,6 +42,16 @@ PcmInterleave32(int32_t *gcc_restrict dest,
 		std::span<const int32_t *const> src,
 		size_t n_frames) noexcept;
 
+/**
+ * Interleave planar 32 bit samples and truncate them to 16 bit (like
+ * a C cast does).  This is useful for decoder libraries which return
+ * all samples in 32 bit integers, e.g. libFLAC.
+ */
+void
+PcmInterleave32To16(int16_t *gcc_restrict dest,
+		    std::span<const int32_t *const> src,
+		    size_t n_frames) noexcept;
+
 static inline void
 PcmInterleaveFloat(float *gcc_restrict dest,
 		   std::span<const float *const> src,
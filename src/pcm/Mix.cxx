@@ -21,13 +21,21 @@
 #include "Volume.hxx"
 #include "Clamp.hxx"
 #include "Traits.hxx"
+#include "Vector.hxx"
 #include "util/Clamp.hxx"
 #include "util/Math.hxx"
 
 #include "Dither.cxx" // including the .cxx file to get inlined templates
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
 static typename Traits::value_type
@@ -50,7 +58,19 @@ PcmAddVolume(PcmDither &dither,
 	     typename Traits::const_pointer b,
 	     size_t n, int volume1, int volume2) noexcept
 {
-	for (size_t i = 0; i != n; ++i)
+	using L = typename Traits::long_type;
+	using PcmVector::Load;
+
+	/* this overwrites "a" in place, which is fine because each
+	   vector is loaded before it is stored */
+	const size_t done = dither.DitherShiftVector<L,
+		Traits::BITS + PCM_VOLUME_BITS,
+		Traits::BITS>(a, n, [a, b, volume1, volume2](size_t i){
+			return Load<L>(a + i) * L(volume1)
+				+ Load<L>(b + i) * L(volume2);
+		});
+
+	for (size_t i = done; i != n; ++i)
 		a[i] = PcmAddVolume<F, Traits>(dither, a[i], b[i],
 					       volume1, volume2);
 }
@@ -75,6 +95,12 @@ static void
 pcm_add_vol_float(float *buffer1, const float *buffer2,
 		  unsigned num_samples, float volume1, float volume2) noexcept
 {
+	using namespace PcmVector;
+
+	for (; num_samples >= N; num_samples -= N, buffer1 += N, buffer2 += N)
+		Store(buffer1, Load<float>(buffer1) * volume1
+		      + Load<float>(buffer2) * volume2);
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -147,6 +173,13 @@ PcmAdd(typename Traits::pointer a,
        typename Traits::const_pointer b,
        size_t n) noexcept
 {
+	using namespace PcmVector;
+	using S = typename Traits::sum_type;
+
+	for (; n >= N; n -= N, a += N, b += N)
+		Store(a, Clamp<S>(Load<S>(a) + Load<S>(b),
+				  Traits::MIN, Traits::MAX));
+
 	for (size_t i = 0; i != n; ++i)
 		a[i] = PcmAdd<F, Traits>(a[i], b[i]);
 }
@@ -167,6 +200,11 @@ static void
 pcm_add_float(float *buffer1, const float *buffer2,
 	      unsigned num_samples) noexcept
 {
+	using namespace PcmVector;
+
+	for (; num_samples >= N; num_samples -= N, buffer1 += N, buffer2 += N)
+		Store(buffer1, Load<float>(buffer1) + Load<float>(buffer2));
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -211,23 +249,77 @@ pcm_add(void *buffer1, const void *buffer2, size_t size,
 	gcc_unreachable();
 }
 
+/**
+ * Convert a cross-fade portion (0.0 to 1.0) to a volume for
+ * pcm_add_vol(), using an equal-power curve.
+ */
+static int
+PortionToVolume(float portion1) noexcept
+{
+	float s = std::sin((float)M_PI_2 * portion1);
+	s *= s;
+
+	int vol1 = lround(s * PCM_VOLUME_1S);
+	return Clamp<int>(vol1, 0, PCM_VOLUME_1S);
+}
+
 bool
 pcm_mix(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	SampleFormat format, float portion1) noexcept
 {
-	float s;
-
 	/* portion1 is between 0.0 and 1.0 for crossfading, MixRamp uses -1
 	 * to signal mixing rather than fading */
 	if (portion1 < 0)
 		return pcm_add(buffer1, buffer2, size, format);
 
-	s = std::sin((float)M_PI_2 * portion1);
-	s *= s;
-
-	int vol1 = lround(s * PCM_VOLUME_1S);
-	vol1 = Clamp<int>(vol1, 0, PCM_VOLUME_1S);
+	const int vol1 = PortionToVolume(portion1);
 
 	return pcm_add_vol(dither, buffer1, buffer2, size,
 			   vol1, PCM_VOLUME_1S - vol1, format);
 }
+
+bool
+pcm_mix_ramp(PcmDither &dither, void *buffer1, const void *buffer2,
+	     size_t size, SampleFormat format, size_t frame_size,
+	     float portion1_begin, float portion1_end) noexcept
+{
+	if (portion1_begin < 0 || portion1_end < 0)
+		return pcm_add(buffer1, buffer2, size, format);
+
+	assert(frame_size > 0);
+	assert(size % frame_size == 0);
+
+	const size_t n_frames = size / frame_size;
+	if (n_frames == 0)
+		return true;
+
+	const float delta = portion1_end - portion1_begin;
+
+	auto *dest = (std::byte *)buffer1;
+	auto *src = (const std::byte *)buffer2;
+
+	/* the gain is constant within each block, evaluated at the
+	   block's center; the blocks are small enough to make the
+	   steps inaudible, and large enough to use the vectorized
+	   pcm_add_vol() */
+	for (size_t frame = 0; frame < n_frames;
+	     frame += PCM_MIX_RAMP_BLOCK_FRAMES) {
+		const size_t block_frames =
+			std::min(n_frames - frame, PCM_MIX_RAMP_BLOCK_FRAMES);
+		const size_t block_size = block_frames * frame_size;
+
+		const float center = float(frame) + float(block_frames) / 2;
+		const int vol1 =
+			PortionToVolume(portion1_begin
+					+ delta * center / float(n_frames));
+
+		if (!pcm_add_vol(dither, dest, src, block_size,
+				 vol1, PCM_VOLUME_1S - vol1, format))
+			return false;
+
+		dest += block_size;
+		src += block_size;
+	}
+
+	return true;
+}
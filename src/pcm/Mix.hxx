@@ -49,4 +49,25 @@ bool
 pcm_mix(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	SampleFormat format, float portion1) noexcept;
 
+/**
+ * The number of frames which share one gain value in
+ * pcm_mix_ramp().
+ */
+static constexpr std::size_t PCM_MIX_RAMP_BLOCK_FRAMES = 64;
+
+/**
+ * Like pcm_mix(), but the portion changes linearly from
+ * #portion1_begin (at the first frame) to #portion1_end (after the
+ * last frame), so consecutive buffers of a cross-fade join without
+ * a step in volume.  The gain is updated every
+ * #PCM_MIX_RAMP_BLOCK_FRAMES frames.
+ *
+ * @param frame_size the size of one frame in bytes
+ */
+[[nodiscard]]
+bool
+pcm_mix_ramp(PcmDither &dither, void *buffer1, const void *buffer2,
+	     size_t size, SampleFormat format, size_t frame_size,
+	     float portion1_begin, float portion1_end) noexcept;
+
 #endif
@@ -100,7 +100,7 @@ AnalyzeMixRamp(const MusicPipe &pipe, const AudioFormat &audio_format,
 	MixRampAnalyzer a;
 	do {
 		a.Process(FromBytesStrict<const ReplayGainAnalyzer::Frame>({chunk->data, chunk->length}));
-	} while ((chunk = chunk->next.get()) != nullptr);
+	} while ((chunk = pipe.GetNext(*chunk)) != nullptr);
 
 	return ToString(a.GetResult(), a.GetTime(), direction);
 }
@@ -91,4 +91,64 @@ struct NeonFloatTo16 {
 	}
 };
 
+/**
+ * Convert floating point samples to 24 bit signed integer (in 32 bit
+ * containers) using ARM NEON.
+ */
+struct NeonFloatTo24 {
+	typedef SampleTraits<SampleFormat::FLOAT> SrcTraits;
+	typedef SampleTraits<SampleFormat::S24_P32> DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	void Convert(int32_t *dst, const float *src,
+		     const size_t n) const noexcept {
+		const int32x4_t max = vdupq_n_s32(DstTraits::MAX);
+		const int32x4_t min = vdupq_n_s32(DstTraits::MIN);
+
+		for (unsigned i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE) {
+			float32x4x4_t value = vld4q_f32(src);
+
+			/* convert to fixed point with 23 fractional
+			   bits (truncating) */
+			int32x4x4_t ivalue;
+			neon_x4_b(vcvtq_n_s32_f32, ivalue, value,
+				  DstTraits::BITS - 1);
+
+			/* clamp to 24 bit */
+			neon_x4_b(vminq_s32, ivalue, ivalue, max);
+			neon_x4_b(vmaxq_s32, ivalue, ivalue, min);
+
+			vst4q_s32(dst, ivalue);
+		}
+	}
+};
+
+/**
+ * Convert floating point samples to 32 bit signed integer using ARM
+ * NEON.  vcvtq_n_s32_f32() saturates, so no explicit clamping is
+ * necessary.
+ */
+struct NeonFloatTo32 {
+	typedef SampleTraits<SampleFormat::FLOAT> SrcTraits;
+	typedef SampleTraits<SampleFormat::S32> DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	void Convert(int32_t *dst, const float *src,
+		     const size_t n) const noexcept {
+		for (unsigned i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE) {
+			float32x4x4_t value = vld4q_f32(src);
+
+			int32x4x4_t ivalue;
+			neon_x4_b(vcvtq_n_s32_f32, ivalue, value,
+				  DstTraits::BITS - 1);
+
+			vst4q_s32(dst, ivalue);
+		}
+	}
+};
+
 #endif
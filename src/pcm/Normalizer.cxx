@@ -0,0 +1,210 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Normalizer.hxx"
+#include "Traits.hxx"
+#include "Vector.hxx"
+#include "util/Compiler.h"
+#include "util/SpanCast.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+using namespace PcmVector;
+
+/**
+ * The type used for calculations.  float has enough precision for
+ * up to 24 bit; S32 needs double.
+ */
+template<SampleFormat F>
+using NormalizerLong = std::conditional_t<F == SampleFormat::S32,
+					  double, float>;
+
+/* these kernels use selections, which is why they operate on
+   native vectors */
+
+template<typename L, typename T>
+[[gnu::pure]]
+static L
+Peak(const T *src, std::size_t n) noexcept
+{
+	constexpr std::size_t W = NativeN<L>;
+	const V<L, W> zero{};
+	V<L, W> m{};
+
+	std::size_t i = 0;
+	for (; i + W <= n; i += W) {
+		const auto v = Load<L, W>(src + i);
+		const auto a = v < zero ? -v : v;
+		m = a > m ? a : m;
+	}
+
+	L result = 0;
+	for (std::size_t j = 0; j < W; ++j)
+		result = std::max(result, m[j]);
+
+	for (; i < n; ++i) {
+		const L v = src[i];
+		result = std::max(result, v < 0 ? -v : v);
+	}
+
+	return result;
+}
+
+/**
+ * Multiply each sample with a gain which ramps linearly from
+ * #start by #delta per sample.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename L=NormalizerLong<F>>
+static void
+Amplify(typename Traits::pointer p, std::size_t n,
+	L start, L delta) noexcept
+{
+	constexpr bool is_float = F == SampleFormat::FLOAT;
+	constexpr L min = Traits::MIN, max = Traits::MAX;
+	constexpr std::size_t W = NativeN<L>;
+
+	V<L, W> lanes;
+	for (std::size_t j = 0; j < W; ++j)
+		lanes[j] = L(j);
+
+	const V<L, W> step = V<L, W>{} + delta * L(W);
+	V<L, W> g = start + lanes * delta;
+
+	std::size_t i = 0;
+	for (; i + W <= n; i += W, g += step) {
+		auto v = Load<L, W>(p + i) * g;
+		if constexpr (!is_float)
+			v = Clamp<L, W>(v, min, max);
+		Store(p + i, v);
+	}
+
+	for (; i < n; ++i) {
+		L v = L(p[i]) * (start + delta * L(i));
+		if constexpr (!is_float)
+			v = std::clamp(v, min, max);
+		p[i] = typename Traits::value_type(v);
+	}
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>, typename U>
+static void
+Normalize(std::span<std::byte> data, U &&update) noexcept
+{
+	using L = NormalizerLong<F>;
+	using value_type = typename Traits::value_type;
+
+	const auto s = FromBytesStrict<value_type>(data);
+	if (s.empty())
+		return;
+
+	/* the peak is relative to full scale, which is 1.0 for
+	   floating point and 2^(BITS-1) for integer samples */
+	constexpr L scale = F == SampleFormat::FLOAT
+		? L(1)
+		: L(Traits::MAX) + L(1);
+	constexpr L ceiling = F == SampleFormat::FLOAT
+		? L(1)
+		: L(Traits::MAX) / scale;
+
+	const L peak = Peak<L>(s.data(), s.size()) / scale;
+	const auto [start, end] = update(float(peak), float(ceiling));
+
+	const L delta = (L(end) - L(start)) / L(s.size());
+	Amplify<F>(s.data(), s.size(), L(start), delta);
+}
+
+void
+PcmNormalizer::Reset() noexcept
+{
+	gain = 1;
+	peaks.fill(0);
+	position = 0;
+}
+
+float
+PcmNormalizer::Update(float peak, float ceiling) noexcept
+{
+	float history_peak = peak;
+	for (const float i : peaks)
+		history_peak = std::max(history_peak, i);
+
+	peaks[position] = peak;
+	position = (position + 1) % HISTORY;
+
+	const float desired = history_peak > 0
+		? TARGET / history_peak
+		: MAX_GAIN;
+
+	/* the envelope: move slowly towards the desired gain */
+	float new_gain = gain + (desired - gain) / float(1u << SMOOTH);
+	new_gain = std::clamp(new_gain, 1.f, MAX_GAIN);
+
+	/* the limiter: never let the block exceed the ceiling; since
+	   we know its peak in advance, the gain can be lowered before
+	   the peak arrives */
+	float start = gain;
+	if (peak > 0) {
+		const float limit = ceiling / peak;
+		new_gain = std::min(new_gain, limit);
+		start = std::min(start, limit);
+	}
+
+	gain = new_gain;
+	return start;
+}
+
+void
+PcmNormalizer::Process(std::span<std::byte> data) noexcept
+{
+	auto update = [this](float peak, float ceiling){
+		const float start = Update(peak, ceiling);
+		return std::make_pair(start, gain);
+	};
+
+	switch (format) {
+	case SampleFormat::S16:
+		Normalize<SampleFormat::S16>(data, update);
+		break;
+
+	case SampleFormat::S24_P32:
+		Normalize<SampleFormat::S24_P32>(data, update);
+		break;
+
+	case SampleFormat::S32:
+		Normalize<SampleFormat::S32>(data, update);
+		break;
+
+	case SampleFormat::FLOAT:
+		Normalize<SampleFormat::FLOAT>(data, update);
+		break;
+
+	default:
+		assert(false);
+		gcc_unreachable();
+	}
+}
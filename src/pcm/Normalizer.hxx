@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_NORMALIZER_HXX
+#define MPD_PCM_NORMALIZER_HXX
+
+#include "SampleFormat.hxx"
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+/**
+ * A simple automatic volume normalizer.  It keeps a history of block
+ * peaks and slowly moves the gain towards the value which brings the
+ * loudest peak of the history to the target level.
+ *
+ * Before a block is amplified, its own peak is known, and the gain
+ * ramp is limited so that no sample of the block exceeds full scale
+ * (i.e. the block is the lookahead window of a limiter).  Therefore
+ * the normalizer never clips and works with the native sample format
+ * instead of forcing 16 bit.
+ *
+ * Supported formats are #SampleFormat::S16, #SampleFormat::S24_P32,
+ * #SampleFormat::S32 and #SampleFormat::FLOAT.
+ */
+class PcmNormalizer {
+public:
+	/**
+	 * The number of blocks whose peaks are remembered.
+	 */
+	static constexpr std::size_t HISTORY = 400;
+
+	/**
+	 * The level (relative to full scale) the loudest peak is
+	 * brought to.
+	 */
+	static constexpr float TARGET = 0.5f;
+
+	/**
+	 * The maximum amplification factor.
+	 */
+	static constexpr float MAX_GAIN = 32;
+
+	/**
+	 * The inertia of the gain: each block moves it by 1/2^SMOOTH
+	 * towards the desired value.
+	 */
+	static constexpr unsigned SMOOTH = 8;
+
+private:
+	SampleFormat format;
+
+	/**
+	 * The gain at the end of the last block.
+	 */
+	float gain;
+
+	/**
+	 * The peak of each of the last #HISTORY blocks, relative to
+	 * full scale.
+	 */
+	std::array<float, HISTORY> peaks;
+
+	std::size_t position;
+
+public:
+	static constexpr bool IsSupported(SampleFormat f) noexcept {
+		return f == SampleFormat::S16 || f == SampleFormat::S24_P32 ||
+			f == SampleFormat::S32 || f == SampleFormat::FLOAT;
+	}
+
+	explicit PcmNormalizer(SampleFormat _format) noexcept
+		:format(_format) {
+		Reset();
+	}
+
+	SampleFormat GetFormat() const noexcept {
+		return format;
+	}
+
+	float GetGain() const noexcept {
+		return gain;
+	}
+
+	/**
+	 * Forget the history and return to unity gain.
+	 */
+	void Reset() noexcept;
+
+	/**
+	 * Normalize a block of samples in place.
+	 */
+	void Process(std::span<std::byte> data) noexcept;
+
+private:
+	/**
+	 * Register the peak of a new block and calculate the gain for
+	 * its end.
+	 *
+	 * @param peak the peak of the new block relative to full
+	 * scale
+	 * @param ceiling the largest allowed output level relative
+	 * to full scale
+	 * @return the gain at the start of the block (which may be
+	 * lower than the previous gain)
+	 */
+	float Update(float peak, float ceiling) noexcept;
+};
+
+#endif
@@ -20,6 +20,13 @@
 #include "Pack.hxx"
 #include "util/ByteOrder.hxx"
 
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PCM_PACK_SSSE3
+#include <tmmintrin.h>
+#endif
+
 static void
 pack_sample(uint8_t *dest, const int32_t *src0) noexcept
 {
@@ -33,9 +40,87 @@ pack_sample(uint8_t *dest, const int32_t *src0) noexcept
 	*dest++ = *src++;
 }
 
+static void
+pack_sample_reverse(uint8_t *dest, const int32_t *src0) noexcept
+{
+	const auto *src = (const uint8_t *)src0;
+
+	if (IsBigEndian())
+		++src;
+
+	dest[0] = src[2];
+	dest[1] = src[1];
+	dest[2] = src[0];
+}
+
+#ifdef PCM_PACK_SSSE3
+
+[[gnu::const]]
+static bool
+HaveSsse3() noexcept
+{
+	static const bool result = __builtin_cpu_supports("ssse3");
+	return result;
+}
+
+/**
+ * Pack blocks of 16 samples (64 bytes in, 48 bytes out) with SSSE3.
+ * x86 is little-endian, so the lower three bytes of each sample are
+ * copied.
+ *
+ * @param reverse reverse the byte order of each packed sample
+ * @return the number of samples which were packed
+ */
+[[gnu::target("ssse3")]]
+static std::size_t
+PackSsse3(uint8_t *dest, const int32_t *src, std::size_t n,
+	  bool reverse) noexcept
+{
+	/* drop the most significant byte of each sample and zero
+	   the top 4 bytes */
+	const __m128i shuffle = reverse
+		? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+				14, 13, 12, -1, -1, -1, -1)
+		: _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+				12, 13, 14, -1, -1, -1, -1);
+
+	const std::size_t n_blocks = n / 16;
+	for (std::size_t i = 0; i < n_blocks; ++i, src += 16, dest += 48) {
+		const __m128i *s = (const __m128i *)src;
+		const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(s), shuffle);
+		const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(s + 1), shuffle);
+		const __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(s + 2), shuffle);
+		const __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(s + 3), shuffle);
+
+		/* concatenate the four 12 byte fragments */
+		__m128i *out = (__m128i *)dest;
+		_mm_storeu_si128(out,
+				 _mm_or_si128(a, _mm_slli_si128(b, 12)));
+		_mm_storeu_si128(out + 1,
+				 _mm_or_si128(_mm_srli_si128(b, 4),
+					      _mm_slli_si128(c, 8)));
+		_mm_storeu_si128(out + 2,
+				 _mm_or_si128(_mm_srli_si128(c, 8),
+					      _mm_slli_si128(d, 4)));
+	}
+
+	return n_blocks * 16;
+}
+
+#endif
+
 void
 pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end) noexcept
 {
+#ifdef PCM_PACK_SSSE3
+	if (HaveSsse3()) {
+		const std::size_t done = PackSsse3(dest, src, src_end - src,
+						   false);
+		src += done;
+		dest += done * 3;
+	}
+#endif
+
 	/* duplicate loop to help the compiler's optimizer (constant
 	   parameter to the pack_sample() inline function) */
 
@@ -45,6 +130,25 @@ pcm_pack_24(uint8_t *dest, const int32_t *src, const int32_t *src_end) noexcept
 	}
 }
 
+void
+pcm_pack_24_reverse(uint8_t *dest,
+		    const int32_t *src, const int32_t *src_end) noexcept
+{
+#ifdef PCM_PACK_SSSE3
+	if (HaveSsse3()) {
+		const std::size_t done = PackSsse3(dest, src, src_end - src,
+						   true);
+		src += done;
+		dest += done * 3;
+	}
+#endif
+
+	while (src < src_end) {
+		pack_sample_reverse(dest, src++);
+		dest += 3;
+	}
+}
+
 /**
  * Construct a signed 24 bit integer from three bytes into a int32_t.
  */
@@ -40,6 +40,15 @@ void
 pcm_pack_24(uint8_t *dest,
 	    const int32_t *src, const int32_t *src_end) noexcept;
 
+/**
+ * Like pcm_pack_24(), but reverse the byte order of each packed
+ * sample.  This combines pcm_pack_24() and reverse_bytes() in one
+ * pass.
+ */
+void
+pcm_pack_24_reverse(uint8_t *dest,
+		    const int32_t *src, const int32_t *src_end) noexcept;
+
 /**
  * Converts packed 24 bit samples (3 bytes per sample) to padded 24
  * bit samples (4 bytes per sample).
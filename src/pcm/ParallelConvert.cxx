@@ -0,0 +1,192 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ParallelConvert.hxx"
+#include "Convert.hxx"
+#include "WorkerPool.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <stdexcept>
+
+#include <string.h>
+
+struct PcmParallelConvert::Group {
+	/**
+	 * The first channel of this group within the stream.
+	 */
+	const unsigned first_channel;
+
+	const unsigned n_channels;
+
+	PcmConvert convert;
+
+	/**
+	 * Collects this group's channels from the interleaved
+	 * source buffer.
+	 */
+	PcmBuffer buffer;
+
+	std::span<const std::byte> result;
+
+	std::exception_ptr error;
+
+	Group(unsigned _first_channel,
+	      AudioFormat src_format, AudioFormat dest_format)
+		:first_channel(_first_channel),
+		 n_channels(src_format.channels),
+		 convert(src_format, dest_format, false) {}
+
+	/**
+	 * Copy this group's channels from the interleaved source.
+	 */
+	std::span<const std::byte> Extract(std::span<const std::byte> src,
+					   unsigned channels,
+					   std::size_t sample_size) noexcept {
+		const std::size_t src_frame_size = channels * sample_size;
+		const std::size_t n_frames = src.size() / src_frame_size;
+		const std::size_t size = n_channels * sample_size;
+		const std::byte *s = src.data() + first_channel * sample_size;
+
+		auto *dest = buffer.GetT<std::byte>(n_frames * size);
+		for (std::size_t i = 0; i < n_frames; ++i)
+			memcpy(dest + i * size, s + i * src_frame_size, size);
+
+		return {dest, n_frames * size};
+	}
+};
+
+PcmParallelConvert::PcmParallelConvert(std::shared_ptr<PcmWorkerPool> _pool,
+				       const AudioFormat src_format,
+				       const AudioFormat dest_format)
+	:pool(std::move(_pool)),
+	 channels(src_format.channels),
+	 src_sample_size(src_format.GetSampleSize()),
+	 dest_sample_size(dest_format.GetSampleSize())
+{
+	assert(src_format.channels == dest_format.channels);
+
+	/* at least two channels per group; one group per thread
+	   plus one for the calling thread */
+	const unsigned n_groups = std::clamp(channels / 2, 1U,
+					     pool->GetThreadCount() + 1);
+
+	unsigned first_channel = 0;
+	for (unsigned i = 0; i < n_groups; ++i) {
+		const unsigned n = channels / n_groups +
+			(i < channels % n_groups);
+
+		AudioFormat s = src_format, d = dest_format;
+		s.channels = d.channels = n;
+		groups.emplace_back(std::make_unique<Group>(first_channel,
+							     s, d));
+		first_channel += n;
+	}
+
+	assert(first_channel == channels);
+}
+
+PcmParallelConvert::~PcmParallelConvert() noexcept = default;
+
+bool
+PcmParallelConvert::IsWorthwhile(const AudioFormat src_format,
+				 const AudioFormat dest_format) noexcept
+{
+	/* splitting stereo does not pay off */
+	if (src_format.channels < 4)
+		return false;
+
+	/* only DSD conversion and resampling are expensive enough */
+	return src_format.format == SampleFormat::DSD ||
+		src_format.sample_rate != dest_format.sample_rate;
+}
+
+void
+PcmParallelConvert::Reset() noexcept
+{
+	for (auto &group : groups)
+		group->convert.Reset();
+}
+
+template<typename F>
+std::span<const std::byte>
+PcmParallelConvert::RunGroups(F &&f)
+{
+	auto task = [this, &f](unsigned i) noexcept {
+		auto &group = *groups[i];
+
+		try {
+			group.result = f(group);
+		} catch (...) {
+			group.error = std::current_exception();
+		}
+	};
+
+	pool->Run(groups.size(), task);
+
+	for (auto &group : groups)
+		if (group->error)
+			std::rethrow_exception(std::exchange(group->error,
+							     nullptr));
+
+	/* all groups see the same input, so they must produce the
+	   same number of frames */
+	const auto &first = *groups.front();
+	const std::size_t n_frames = first.result.size() /
+		(first.n_channels * dest_sample_size);
+
+	for (const auto &group : groups)
+		if (group->result.size() != n_frames * group->n_channels * dest_sample_size)
+			throw std::runtime_error("Channel groups out of sync");
+
+	if (n_frames == 0)
+		return {};
+
+	const std::size_t frame_size = channels * dest_sample_size;
+	auto *dest = buffer.GetT<std::byte>(n_frames * frame_size);
+
+	for (const auto &group : groups) {
+		const std::size_t size = group->n_channels * dest_sample_size;
+		const std::byte *s = group->result.data();
+		std::byte *d = dest + group->first_channel * dest_sample_size;
+
+		for (std::size_t i = 0; i < n_frames; ++i)
+			memcpy(d + i * frame_size, s + i * size, size);
+	}
+
+	return {dest, n_frames * frame_size};
+}
+
+std::span<const std::byte>
+PcmParallelConvert::Convert(std::span<const std::byte> src)
+{
+	return RunGroups([this, src](Group &group){
+		return group.convert.Convert(group.Extract(src, channels,
+							   src_sample_size));
+	});
+}
+
+std::span<const std::byte>
+PcmParallelConvert::Flush()
+{
+	return RunGroups([](Group &group){
+		return group.convert.Flush();
+	});
+}
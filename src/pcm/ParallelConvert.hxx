@@ -0,0 +1,98 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_PARALLEL_CONVERT_HXX
+#define MPD_PCM_PARALLEL_CONVERT_HXX
+
+#include "Buffer.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+struct AudioFormat;
+class PcmWorkerPool;
+
+/**
+ * Splits the channels of a stream into groups and converts each
+ * group with its own #PcmConvert instance.  The groups are
+ * processed in parallel on a #PcmWorkerPool.
+ *
+ * This only handles conversions which work on each channel
+ * separately (DSD to PCM, resampling, sample format); the number
+ * of channels must not change.
+ */
+class PcmParallelConvert {
+	const std::shared_ptr<PcmWorkerPool> pool;
+
+	struct Group;
+	std::vector<std::unique_ptr<Group>> groups;
+
+	const unsigned channels;
+
+	const std::size_t src_sample_size, dest_sample_size;
+
+	PcmBuffer buffer;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param dest_format the destination format; it must have
+	 * the same number of channels as the source format
+	 */
+	PcmParallelConvert(std::shared_ptr<PcmWorkerPool> _pool,
+			   AudioFormat src_format, AudioFormat dest_format);
+
+	~PcmParallelConvert() noexcept;
+
+	PcmParallelConvert(const PcmParallelConvert &) = delete;
+	PcmParallelConvert &operator=(const PcmParallelConvert &) = delete;
+
+	/**
+	 * Would it make sense to split this conversion?
+	 */
+	[[gnu::pure]]
+	static bool IsWorthwhile(AudioFormat src_format,
+				 AudioFormat dest_format) noexcept;
+
+	void Reset() noexcept;
+
+	/**
+	 * Throws on error.
+	 */
+	std::span<const std::byte> Convert(std::span<const std::byte> src);
+
+	/**
+	 * Throws on error.
+	 */
+	std::span<const std::byte> Flush();
+
+private:
+	/**
+	 * Invoke the given function (which returns the converted
+	 * data of one group) for all groups in parallel and
+	 * interleave the results.
+	 */
+	template<typename F>
+	std::span<const std::byte> RunGroups(F &&f);
+};
+
+#endif
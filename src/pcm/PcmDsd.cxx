@@ -28,6 +28,9 @@ PcmDsd::ToFloat(unsigned channels, std::span<const uint8_t> src) noexcept
 	assert(!src.empty());
 	assert(src.size() % channels == 0);
 
+	if (use_fir)
+		return fir.ToFloat(src);
+
 	const size_t num_samples = src.size();
 	const size_t num_frames = src.size() / channels;
 
@@ -43,6 +46,9 @@ PcmDsd::ToS24(unsigned channels, std::span<const uint8_t> src) noexcept
 	assert(!src.empty());
 	assert(src.size() % channels == 0);
 
+	if (use_fir)
+		return fir.ToS24(src);
+
 	const size_t num_samples = src.size();
 	const size_t num_frames = src.size() / channels;
 
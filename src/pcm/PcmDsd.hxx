@@ -22,6 +22,7 @@
 
 #include "Buffer.hxx"
 #include "Dsd2Pcm.hxx"
+#include "Dsd2PcmFir.hxx"
 
 #include <cstdint>
 #include <span>
@@ -34,9 +35,35 @@ class PcmDsd {
 
 	MultiDsd2Pcm dsd2pcm;
 
+	Dsd2PcmFir fir;
+
+	/**
+	 * Use #fir instead of #dsd2pcm?  This is set by Open().
+	 */
+	bool use_fir = false;
+
 public:
+	/**
+	 * Use the #Dsd2PcmFir engine with the given decimation
+	 * ratio.  Without this call, the table based #MultiDsd2Pcm
+	 * with a ratio of 8 is used.
+	 *
+	 * Throws on error.
+	 *
+	 * @param sample_rate the DSD sample rate in bytes per
+	 * second
+	 */
+	void Open(unsigned channels, unsigned sample_rate,
+		  unsigned decimation, Dsd2PcmQuality quality) {
+		fir.Open(channels, sample_rate, decimation, quality);
+		use_fir = true;
+	}
+
 	void Reset() noexcept {
-		dsd2pcm.Reset();
+		if (use_fir)
+			fir.Reset();
+		else
+			dsd2pcm.Reset();
 	}
 
 	std::span<const float> ToFloat(unsigned channels,
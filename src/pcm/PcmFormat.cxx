@@ -22,6 +22,7 @@
 #include "Traits.hxx"
 #include "FloatConvert.hxx"
 #include "ShiftConvert.hxx"
+#include "Avx2.hxx"
 #include "util/SpanCast.hxx"
 #include "util/TransformN.hxx"
 
@@ -112,6 +113,51 @@ struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
 	: GlueOptimizedConvert<NeonFloatTo16,
 			       PortableFloatToInteger<SampleFormat::S16>> {};
 
+template<>
+struct FloatToInteger<SampleFormat::S24_P32, SampleTraits<SampleFormat::S24_P32>>
+	: GlueOptimizedConvert<NeonFloatTo24,
+			       PortableFloatToInteger<SampleFormat::S24_P32>> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S32, SampleTraits<SampleFormat::S32>>
+	: GlueOptimizedConvert<NeonFloatTo32,
+			       PortableFloatToInteger<SampleFormat::S32>> {};
+
+#elif defined(__SSE2__) && defined(PCM_HAVE_AVX2)
+#include "Sse2.hxx"
+
+/**
+ * Use the AVX2 kernel if the CPU supports it, and the SSE2 kernel
+ * otherwise.  Both have the same #BLOCK_SIZE.
+ */
+template<typename Sse2,
+	 void (*avx2)(typename Sse2::DstTraits::pointer, const float *,
+		      size_t) noexcept>
+struct X86FloatToInteger : Sse2 {
+	void Convert(typename Sse2::DstTraits::pointer dst, const float *src,
+		     size_t n) const noexcept {
+		if (HaveAvx2())
+			avx2(dst, src, n);
+		else
+			Sse2::Convert(dst, src, n);
+	}
+};
+
+template<>
+struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
+	: GlueOptimizedConvert<X86FloatToInteger<Sse2FloatTo16, Avx2FloatTo16>,
+			       PortableFloatToInteger<SampleFormat::S16>> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S24_P32, SampleTraits<SampleFormat::S24_P32>>
+	: GlueOptimizedConvert<X86FloatToInteger<Sse2FloatTo24, Avx2FloatTo24>,
+			       PortableFloatToInteger<SampleFormat::S24_P32>> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S32, SampleTraits<SampleFormat::S32>>
+	: GlueOptimizedConvert<X86FloatToInteger<Sse2FloatTo32, Avx2FloatTo32>,
+			       PortableFloatToInteger<SampleFormat::S32>> {};
+
 #endif
 
 template<class C>
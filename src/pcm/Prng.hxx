@@ -30,4 +30,25 @@ pcm_prng(unsigned long state) noexcept
 	return (state * 0x0019660dL + 0x3c6ef35fL) & 0xffffffffL;
 }
 
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/**
+ * The same PRNG as pcm_prng(), but for a vector of independent
+ * states (see PcmVector::V).  The element type must be a 32 bit
+ * unsigned integer, which makes the "& 0xffffffff" implicit.
+ */
+template<typename V>
+constexpr V
+pcm_prng_vector(const V &state) noexcept
+{
+	return state * 0x0019660dU + 0x3c6ef35fU;
+}
+
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
 #endif
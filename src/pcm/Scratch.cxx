@@ -0,0 +1,78 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Scratch.hxx"
+
+#include <cassert>
+
+PcmScratch &
+PcmScratch::GetThread() noexcept
+{
+	static thread_local PcmScratch instance;
+	return instance;
+}
+
+void *
+PcmScratch::Allocate(std::size_t size) noexcept
+{
+	if (depth == 0)
+		return nullptr;
+
+	if (size == 0)
+		/* never return nullptr, see PcmBuffer::Get() */
+		size = 1;
+
+	size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	if (size <= capacity - position) {
+		void *p = buffer.get() + position;
+		position += size;
+		return p;
+	}
+
+	/* doesn't fit: allocate separately for now, and grow the
+	   main buffer when the outermost scope ends */
+	overflow.emplace_front(AllocateBlock(size));
+	overflow_size += size;
+	return overflow.front().get();
+}
+
+void
+PcmScratch::Leave(std::size_t mark) noexcept
+{
+	assert(depth > 0);
+	assert(mark <= position);
+
+	position = mark;
+
+	if (--depth > 0 || overflow_size == 0)
+		return;
+
+	/* the outermost scope has ended: nothing is in use
+	   anymore; replace the overflow allocations with one larger
+	   buffer */
+
+	assert(position == 0);
+
+	overflow.clear();
+
+	capacity += overflow_size;
+	overflow_size = 0;
+	buffer.reset(AllocateBlock(capacity));
+}
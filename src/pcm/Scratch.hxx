@@ -0,0 +1,129 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SCRATCH_HXX
+#define MPD_PCM_SCRATCH_HXX
+
+#include <cstddef>
+#include <forward_list>
+#include <memory>
+#include <new>
+
+/**
+ * A per-thread bump allocator for PCM data which is only needed
+ * during one call, e.g. the intermediate results of a multi-stage
+ * conversion in PcmConvert::Convert().  All conversion stages of one
+ * thread share this memory instead of each keeping its own
+ * #PcmBuffer allocation around.
+ *
+ * Memory is only handed out while a #PcmScratchScope exists, and it
+ * is released when that scope ends.
+ */
+class PcmScratch {
+	/**
+	 * Allocations are aligned to this many bytes (one cache
+	 * line).
+	 */
+	static constexpr std::size_t ALIGNMENT = 64;
+
+	struct AlignedDelete {
+		void operator()(std::byte *p) const noexcept {
+			::operator delete[](p, std::align_val_t{ALIGNMENT});
+		}
+	};
+
+	using Block = std::unique_ptr<std::byte, AlignedDelete>;
+
+	[[gnu::malloc]]
+	static std::byte *AllocateBlock(std::size_t size) {
+		return static_cast<std::byte *>(::operator new[](size, std::align_val_t{ALIGNMENT}));
+	}
+
+	Block buffer;
+	std::size_t capacity = 0, position = 0;
+
+	/**
+	 * Allocations which did not fit into #buffer.  They are freed
+	 * when the outermost scope ends, and #buffer is enlarged to
+	 * make them fit next time.
+	 */
+	std::forward_list<Block> overflow;
+	std::size_t overflow_size = 0;
+
+	/**
+	 * The number of nested #PcmScratchScope instances.
+	 */
+	unsigned depth = 0;
+
+	PcmScratch() noexcept = default;
+
+public:
+	PcmScratch(const PcmScratch &) = delete;
+	PcmScratch &operator=(const PcmScratch &) = delete;
+
+	/**
+	 * Returns the instance of the current thread.
+	 */
+	[[gnu::const]]
+	static PcmScratch &GetThread() noexcept;
+
+	/**
+	 * Allocate memory which is valid until the current
+	 * #PcmScratchScope ends.
+	 *
+	 * @return nullptr if no #PcmScratchScope exists
+	 */
+	[[gnu::malloc]]
+	void *Allocate(std::size_t size) noexcept;
+
+private:
+	friend class PcmScratchScope;
+
+	std::size_t Enter() noexcept {
+		++depth;
+		return position;
+	}
+
+	void Leave(std::size_t mark) noexcept;
+};
+
+/**
+ * While an instance of this class exists, #PcmBuffer objects marked
+ * with PcmBuffer::SetScratch() allocate from the thread's
+ * #PcmScratch.  Everything allocated inside the scope becomes invalid
+ * when it ends, so only buffers whose contents are consumed within
+ * the scope may be marked.
+ */
+class PcmScratchScope {
+	PcmScratch &scratch;
+	const std::size_t mark;
+
+public:
+	PcmScratchScope() noexcept
+		:scratch(PcmScratch::GetThread()), mark(scratch.Enter()) {}
+
+	~PcmScratchScope() noexcept {
+		scratch.Leave(mark);
+	}
+
+	PcmScratchScope(const PcmScratchScope &) = delete;
+	PcmScratchScope &operator=(const PcmScratchScope &) = delete;
+};
+
+#endif
@@ -26,8 +26,11 @@
 
 #include <soxr.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <optional>
+#include <thread>
 
 #include <string.h>
 
@@ -47,9 +50,20 @@ static constexpr unsigned long SOXR_CUSTOM_RECIPE = -2;
 
 static soxr_io_spec_t soxr_io_custom_recipe;
 static soxr_quality_spec_t soxr_quality;
-static soxr_runtime_spec_t soxr_runtime;
 static bool soxr_use_custom_recipe;
 
+/**
+ * Optional quality presets which override #soxr_quality when
+ * upsampling or downsampling.
+ */
+static std::optional<soxr_quality_spec_t> soxr_upsample_quality,
+	soxr_downsample_quality;
+
+/**
+ * The configured number of threads; 0 means "automatic".
+ */
+static unsigned soxr_threads;
+
 
 static constexpr struct {
 	unsigned long recipe;
@@ -161,6 +175,28 @@ SoxrParseAttenuation(const char *svalue) {
 	return 1 / std::pow(10, value / 10.0);
 }
 
+/**
+ * Parse an optional named quality preset ("custom" is not allowed
+ * here).
+ */
+static std::optional<soxr_quality_spec_t>
+SoxrParseQualityOverride(const ConfigBlock &block, const char *name)
+{
+	const char *quality_string = block.GetBlockValue(name);
+	if (quality_string == nullptr)
+		return std::nullopt;
+
+	const unsigned long recipe = soxr_parse_quality(quality_string);
+	if (recipe == SOXR_INVALID_RECIPE || recipe == SOXR_CUSTOM_RECIPE)
+		throw FmtRuntimeError("invalid {} setting '{}' in line {}",
+				      name, quality_string, block.line);
+
+	FmtDebug(soxr_domain, "soxr {} '{}'",
+		 name, soxr_quality_name(recipe));
+
+	return soxr_quality_spec(recipe, 0);
+}
+
 void
 pcm_resample_soxr_global_init(const ConfigBlock &block)
 {
@@ -197,8 +233,28 @@ pcm_resample_soxr_global_init(const ConfigBlock &block)
 	FmtDebug(soxr_domain, "soxr converter '{}'",
 		 soxr_quality_name(recipe));
 
-	const unsigned n_threads = block.GetBlockValue("threads", 1);
-	soxr_runtime = soxr_runtime_spec(n_threads);
+	soxr_upsample_quality =
+		SoxrParseQualityOverride(block, "upsample_quality");
+	soxr_downsample_quality =
+		SoxrParseQualityOverride(block, "downsample_quality");
+
+	soxr_threads = block.GetBlockValue("threads", 1U);
+}
+
+/**
+ * Determine the number of threads for a new soxr instance.  libsoxr
+ * processes each channel in one thread, so more threads than
+ * channels would only compete with other resamplers (e.g. of other
+ * audio outputs) for CPU cores without any benefit.
+ */
+static unsigned
+SoxrGetThreads(unsigned channels) noexcept
+{
+	unsigned n = soxr_threads;
+	if (n == 0)
+		n = std::max(std::thread::hardware_concurrency(), 1U);
+
+	return std::min(n, channels);
 }
 
 AudioFormat
@@ -207,32 +263,49 @@ SoxrPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate)
 	assert(af.IsValid());
 	assert(audio_valid_sample_rate(new_sample_rate));
 
+	/* the quality preset may depend on the conversion
+	   direction */
+	const auto &quality_override = new_sample_rate > af.sample_rate
+		? soxr_upsample_quality
+		: soxr_downsample_quality;
+	const bool use_custom_recipe = soxr_use_custom_recipe &&
+		!quality_override;
+	const soxr_quality_spec_t &quality = quality_override
+		? *quality_override
+		: soxr_quality;
+
+	/* each instance gets its own runtime spec, sized for its
+	   channel count */
+	const unsigned n_threads = SoxrGetThreads(af.channels);
+	const soxr_runtime_spec_t runtime = soxr_runtime_spec(n_threads);
+
 	soxr_error_t e;
 	soxr_io_spec_t* p_soxr_io = nullptr;
-	if(soxr_use_custom_recipe) {
+	if(use_custom_recipe) {
 		p_soxr_io = & soxr_io_custom_recipe;
 	}
 	soxr = soxr_create(af.sample_rate, new_sample_rate,
 			   af.channels, &e,
-			   p_soxr_io, &soxr_quality, &soxr_runtime);
+			   p_soxr_io, &quality, &runtime);
 	if (soxr == nullptr)
 		throw FmtRuntimeError("soxr initialization has failed: {}",
 				      e);
 
-	FmtDebug(soxr_domain, "soxr engine '{}'", soxr_engine(soxr));
-	if (soxr_use_custom_recipe)
+	FmtDebug(soxr_domain, "soxr engine '{}', {} thread(s)",
+		 soxr_engine(soxr), n_threads);
+	if (use_custom_recipe)
 		FmtDebug(soxr_domain,
 			 "soxr precision={:0.0f}, phase_response={:0.2f}, "
 			 "passband_end={:0.2f}, stopband_begin={:0.2f} scale={:0.2f}",
-			 soxr_quality.precision, soxr_quality.phase_response,
-			 soxr_quality.passband_end, soxr_quality.stopband_begin,
+			 quality.precision, quality.phase_response,
+			 quality.passband_end, quality.stopband_begin,
 			 soxr_io_custom_recipe.scale);
 	else
 		FmtDebug(soxr_domain,
 			 "soxr precision={:0.0f}, phase_response={:0.2f}, "
 			 "passband_end={:0.2f}, stopband_begin={:0.2f}",
-			 soxr_quality.precision, soxr_quality.phase_response,
-			 soxr_quality.passband_end, soxr_quality.stopband_begin);
+			 quality.precision, quality.phase_response,
+			 quality.passband_end, quality.stopband_begin);
 
 	channels = af.channels;
 
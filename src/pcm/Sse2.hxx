@@ -0,0 +1,121 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SSE2_HXX
+#define MPD_PCM_SSE2_HXX
+
+#include "Traits.hxx"
+
+#include <emmintrin.h>
+
+/*
+ * Float to integer converters using SSE2, which is available on all
+ * x86_64 CPUs.  They produce exactly the same results as
+ * #FloatToIntegerSampleConvert: scale, clamp, truncate toward zero.
+ */
+
+/**
+ * Convert floating point samples to 16 bit signed integer using SSE2.
+ */
+struct Sse2FloatTo16 {
+	using SrcTraits = SampleTraits<SampleFormat::FLOAT>;
+	using DstTraits = SampleTraits<SampleFormat::S16>;
+
+	static constexpr size_t BLOCK_SIZE = 8;
+
+	void Convert(int16_t *dst, const float *src,
+		     const size_t n) const noexcept {
+		const __m128 factor = _mm_set1_ps(32768.f);
+		const __m128 max = _mm_set1_ps(32767.f);
+		const __m128 min = _mm_set1_ps(-32768.f);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE) {
+			__m128 a = _mm_mul_ps(_mm_loadu_ps(src), factor);
+			__m128 b = _mm_mul_ps(_mm_loadu_ps(src + 4), factor);
+
+			a = _mm_max_ps(_mm_min_ps(a, max), min);
+			b = _mm_max_ps(_mm_min_ps(b, max), min);
+
+			const __m128i result =
+				_mm_packs_epi32(_mm_cvttps_epi32(a),
+						_mm_cvttps_epi32(b));
+			_mm_storeu_si128((__m128i *)dst, result);
+		}
+	}
+};
+
+/**
+ * Convert floating point samples to 24 bit signed integer (in 32 bit
+ * containers) using SSE2.
+ */
+struct Sse2FloatTo24 {
+	using SrcTraits = SampleTraits<SampleFormat::FLOAT>;
+	using DstTraits = SampleTraits<SampleFormat::S24_P32>;
+
+	static constexpr size_t BLOCK_SIZE = 8;
+
+	void Convert(int32_t *dst, const float *src,
+		     const size_t n) const noexcept {
+		const __m128 factor = _mm_set1_ps(8388608.f);
+		const __m128 max = _mm_set1_ps(8388607.f);
+		const __m128 min = _mm_set1_ps(-8388608.f);
+
+		/* two vectors per block */
+		for (size_t i = 0; i < n / BLOCK_SIZE * 2;
+		     ++i, src += 4, dst += 4) {
+			__m128 a = _mm_mul_ps(_mm_loadu_ps(src), factor);
+			a = _mm_max_ps(_mm_min_ps(a, max), min);
+			_mm_storeu_si128((__m128i *)dst, _mm_cvttps_epi32(a));
+		}
+	}
+};
+
+/**
+ * Convert floating point samples to 32 bit signed integer using SSE2.
+ *
+ * The maximum value 2^31-1 cannot be represented as float, so
+ * clamping is done after the conversion: _mm_cvttps_epi32() returns
+ * 0x80000000 for all values out of range, and this is flipped to
+ * 0x7fffffff for positive overflows.
+ */
+struct Sse2FloatTo32 {
+	using SrcTraits = SampleTraits<SampleFormat::FLOAT>;
+	using DstTraits = SampleTraits<SampleFormat::S32>;
+
+	static constexpr size_t BLOCK_SIZE = 8;
+
+	void Convert(int32_t *dst, const float *src,
+		     const size_t n) const noexcept {
+		const __m128 factor = _mm_set1_ps(2147483648.f);
+
+		/* two vectors per block */
+		for (size_t i = 0; i < n / BLOCK_SIZE * 2;
+		     ++i, src += 4, dst += 4) {
+			const __m128 a = _mm_mul_ps(_mm_loadu_ps(src), factor);
+			const __m128i overflow =
+				_mm_castps_si128(_mm_cmpge_ps(a, factor));
+			const __m128i result =
+				_mm_xor_si128(_mm_cvttps_epi32(a), overflow);
+			_mm_storeu_si128((__m128i *)dst, result);
+		}
+	}
+};
+
+#endif
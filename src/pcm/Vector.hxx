@@ -0,0 +1,125 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_VECTOR_HXX
+#define MPD_PCM_VECTOR_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string.h>
+
+/**
+ * Helpers for writing portable SIMD kernels with the GCC/clang
+ * vector extensions.  The compiler lowers them to whatever the
+ * target provides (SSE2/AVX2 on x86, NEON on ARM) or to scalar
+ * code.
+ */
+/* all functions taking or returning vectors are inline helpers
+   which never cross a translation unit, so the ABI warning about
+   vectors wider than the baseline ISA is irrelevant.  The pragma is
+   scoped to this header; sources implementing vector kernels
+   disable the warning for the whole file, because GCC reports some
+   of these warnings only at the end of the translation unit */
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace PcmVector {
+
+/**
+ * The number of samples processed in one step.
+ */
+static constexpr std::size_t N = 8;
+
+/**
+ * The size of a native SIMD register in bytes.  Comparisons and
+ * selections on vectors wider than that are not always lowered to
+ * SIMD instructions by the compiler.
+ */
+#ifdef __AVX__
+static constexpr std::size_t NATIVE_SIZE = 32;
+#else
+static constexpr std::size_t NATIVE_SIZE = 16;
+#endif
+
+/**
+ * The number of elements of type T fitting in a native SIMD
+ * register.
+ */
+template<typename T>
+static constexpr std::size_t NativeN = NATIVE_SIZE / sizeof(T);
+
+template<typename T, std::size_t n=N>
+struct Type {
+	typedef T type __attribute__((vector_size(sizeof(T) * n)));
+};
+
+/**
+ * A vector of #N (or n) elements of type T.
+ */
+template<typename T, std::size_t n=N>
+using V = typename Type<T, n>::type;
+
+/**
+ * Load #N (or n) (possibly unaligned) values and convert them to
+ * the element type L.
+ */
+template<typename L, std::size_t n=N, typename T>
+[[gnu::always_inline]]
+static inline V<L, n>
+Load(const T *src) noexcept
+{
+	V<T, n> v;
+	memcpy(&v, src, sizeof(v));
+	return __builtin_convertvector(v, V<L, n>);
+}
+
+/**
+ * Convert the values to the element type T and store them at the
+ * (possibly unaligned) destination.
+ */
+template<typename T, typename VL>
+[[gnu::always_inline]]
+static inline void
+Store(T *dest, const VL &v) noexcept
+{
+	constexpr std::size_t n = sizeof(v) / sizeof(v[0]);
+	const auto w = __builtin_convertvector(v, V<T, n>);
+	memcpy(dest, &w, sizeof(w));
+}
+
+template<typename L, std::size_t n=N>
+[[gnu::always_inline]]
+static inline V<L, n>
+Clamp(const V<L, n> &v, L min, L max) noexcept
+{
+	const V<L, n> vmin = V<L, n>{} + min, vmax = V<L, n>{} + max;
+	const V<L, n> w = v < vmin ? vmin : v;
+	return w > vmax ? vmax : w;
+}
+
+} // namespace PcmVector
+
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
+#endif
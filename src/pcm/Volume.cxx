@@ -20,17 +20,24 @@
 #include "Volume.hxx"
 #include "Silence.hxx"
 #include "Traits.hxx"
+#include "Vector.hxx"
 #include "lib/fmt/AudioFormatFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "util/TransformN.hxx"
 
 #include "Dither.cxx" // including the .cxx file to get inlined templates
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 
 #include <string.h>
 
+/* see Vector.hxx */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 /**
  * Apply software volume, converting to a different sample type.
  */
@@ -86,6 +93,18 @@ pcm_volume_change(PcmDither &dither,
 		  size_t n,
 		  int volume) noexcept
 {
+	using L = typename Traits::long_type;
+	using PcmVector::Load;
+
+	const size_t done = dither.DitherShiftVector<L,
+		Traits::BITS + PCM_VOLUME_BITS,
+		Traits::BITS>(dest, n, [src, volume](size_t i){
+			return Load<L>(src + i) * L(volume);
+		});
+	src += done;
+	dest += done;
+	n -= done;
+
 	transform_n(src, n, dest,
 		    [&dither, volume](auto x){
 			    return pcm_volume_sample<F, Traits>(dither, x,
@@ -113,6 +132,15 @@ static void
 PcmVolumeChange16to32(int32_t *dest, const int16_t *src, size_t n,
 		      int volume) noexcept
 {
+	using namespace PcmVector;
+
+	/* 16 bit sample plus 10 volume bits; shift to 24 bits */
+	static_assert(16 + PCM_VOLUME_BITS > 24);
+
+	for (; n >= N; n -= N, src += N, dest += N)
+		Store(dest, (Load<int32_t>(src) * volume)
+		      >> (16 + PCM_VOLUME_BITS - 24));
+
 	transform_n(src, n, dest,
 		    [volume](auto x){
 			    return PcmVolumeConvert<SampleFormat::S16,
@@ -142,6 +170,11 @@ static void
 pcm_volume_change_float(float *dest, const float *src, size_t n,
 			float volume) noexcept
 {
+	using namespace PcmVector;
+
+	for (; n >= N; n -= N, src += N, dest += N)
+		Store(dest, Load<float>(src) * volume);
+
 	transform_n(src, n, dest,
 		    [volume](float x){ return x * volume; });
 }
@@ -185,31 +218,16 @@ PcmVolume::Open(SampleFormat _format, bool allow_convert)
 	return format = _format;
 }
 
-std::span<const std::byte>
-PcmVolume::Apply(std::span<const std::byte> src) noexcept
+/**
+ * Apply the volume level (and convert) from the source buffer to
+ * the destination buffer, which may be the same.
+ */
+inline void
+PcmVolume::Change(void *data, std::span<const std::byte> src) noexcept
 {
-	if (volume == PCM_VOLUME_1 && !convert)
-		return src;
-
-	size_t dest_size = src.size();
-	if (convert) {
-		assert(format == SampleFormat::S16);
-
-		/* converting to S24_P32 */
-		dest_size *= 2;
-	}
-
-	void *data = buffer.Get(dest_size);
-
-	if (volume == 0) {
-		/* optimized special case: 0% volume = memset(0) */
-		PcmSilence(std::span{(std::byte *)data, dest_size},
-			   format);
-		return { (const std::byte *)data, dest_size };
-	}
-
 	switch (format) {
 	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
 		assert(false);
 		gcc_unreachable();
 
@@ -253,11 +271,101 @@ PcmVolume::Apply(std::span<const std::byte> src) noexcept
 					src.size() / sizeof(float),
 					pcm_volume_to_float(volume));
 		break;
+	}
+}
 
-	case SampleFormat::DSD:
-		// TODO: implement this; currently, it's a no-op
+/**
+ * The number of samples which share one volume level in
+ * PcmVolume::ChangeRamp().
+ */
+static constexpr std::size_t PCM_VOLUME_RAMP_BLOCK_SAMPLES = 256;
+
+inline void
+PcmVolume::ChangeRamp(void *data, std::span<const std::byte> src) noexcept
+{
+	assert(format != SampleFormat::DSD);
+
+	const unsigned target = volume;
+	const std::size_t sample_size = sample_format_size(format);
+	const std::size_t dest_sample_size = convert ? sizeof(int32_t) : sample_size;
+	const std::size_t n_samples = src.size() / sample_size;
+
+	auto *dest = (std::byte *)data;
+
+	/* the volume is constant within each block, so the
+	   (vectorized) Change() method can do the work */
+	for (std::size_t i = 0; i < n_samples;
+	     i += PCM_VOLUME_RAMP_BLOCK_SAMPLES) {
+		const std::size_t n = std::min(n_samples - i,
+					       PCM_VOLUME_RAMP_BLOCK_SAMPLES);
+		const auto center = int_least64_t(i + n / 2);
+
+		volume = int(applied_volume)
+			+ (int_least64_t(target) - int_least64_t(applied_volume))
+			* center / int_least64_t(n_samples);
+
+		Change(dest + i * dest_sample_size,
+		       src.subspan(i * sample_size, n * sample_size));
+	}
+
+	volume = applied_volume = target;
+}
+
+std::span<const std::byte>
+PcmVolume::Apply(std::span<const std::byte> src) noexcept
+{
+	if (IsRamping() && format != SampleFormat::DSD) {
+		const std::size_t dest_size = convert
+			? src.size() * 2
+			: src.size();
+
+		void *data = buffer.Get(dest_size);
+		ChangeRamp(data, src);
+		return { (const std::byte *)data, dest_size };
+	}
+
+	applied_volume = volume;
+
+	if (volume == PCM_VOLUME_1 && !convert)
 		return src;
+
+	size_t dest_size = src.size();
+	if (convert) {
+		assert(format == SampleFormat::S16);
+
+		/* converting to S24_P32 */
+		dest_size *= 2;
+	}
+
+	void *data = buffer.Get(dest_size);
+
+	if (volume == 0) {
+		/* optimized special case: 0% volume = memset(0) */
+		PcmSilence(std::span{(std::byte *)data, dest_size},
+			   format);
+		return { (const std::byte *)data, dest_size };
 	}
 
+	if (format == SampleFormat::DSD)
+		// TODO: implement this; currently, it's a no-op
+		return src;
+
+	Change(data, src);
 	return { (const std::byte *)data, dest_size };
 }
+
+void
+PcmVolume::ApplyInPlace(std::span<std::byte> data) noexcept
+{
+	assert(CanApplyInPlace());
+
+	if (IsRamping()) {
+		ChangeRamp(data.data(), data);
+		return;
+	}
+
+	if (volume == 0)
+		PcmSilence(data, format);
+	else
+		Change(data.data(), data);
+}
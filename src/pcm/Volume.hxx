@@ -72,6 +72,18 @@ class PcmVolume {
 
 	unsigned volume;
 
+	/**
+	 * The volume at the end of the previous Apply() call; only
+	 * used if #ramp is enabled.
+	 */
+	unsigned applied_volume = PCM_VOLUME_1;
+
+	/**
+	 * Change the volume gradually during the next Apply() call
+	 * instead of at once?  See SetRamp().
+	 */
+	bool ramp = false;
+
 	PcmBuffer buffer;
 	PcmDither dither;
 
@@ -96,6 +108,16 @@ public:
 		volume = _volume;
 	}
 
+	/**
+	 * If enabled, then a volume change does not jump to the new
+	 * level; instead, the next Apply() call fades from the
+	 * previous level to the new one over its whole buffer.
+	 */
+	void SetRamp(bool _ramp) noexcept {
+		ramp = _ramp;
+		applied_volume = volume;
+	}
+
 	/**
 	 * Opens the object, prepare for Apply().
 	 *
@@ -121,8 +143,39 @@ public:
 	/**
 	 * Apply the volume level.
 	 */
-	[[gnu::pure]]
 	std::span<const std::byte> Apply(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Can ApplyInPlace() be used?  This is not possible while
+	 * converting to a different #SampleFormat, and pointless at
+	 * 100% (where Apply() does not copy) and for DSD (which is
+	 * not implemented).
+	 */
+	[[gnu::pure]]
+	bool CanApplyInPlace() const noexcept {
+		return !convert &&
+			(volume != PCM_VOLUME_1 || IsRamping()) &&
+			format != SampleFormat::DSD;
+	}
+
+	/**
+	 * Like Apply(), but modify the given buffer instead of
+	 * copying to an internal one.  May only be used if
+	 * CanApplyInPlace() returns true.
+	 */
+	void ApplyInPlace(std::span<std::byte> data) noexcept;
+
+private:
+	bool IsRamping() const noexcept {
+		return ramp && applied_volume != volume;
+	}
+
+	void Change(void *dest, std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Like Change(), but fade from #applied_volume to #volume.
+	 */
+	void ChangeRamp(void *dest, std::span<const std::byte> src) noexcept;
 };
 
 #endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "WorkerPool.hxx"
+#include "thread/Name.hxx"
+#include "thread/Profile.hxx"
+#include "thread/Util.hxx"
+#include "Log.hxx"
+
+#include <cassert>
+
+PcmWorkerPool::PcmWorkerPool(unsigned _n_threads)
+	:n_threads(_n_threads)
+{
+	assert(n_threads > 0);
+
+	try {
+		for (unsigned i = 0; i < n_threads; ++i) {
+			threads.emplace_front(BIND_THIS_METHOD(RunThread));
+			threads.front().Start();
+		}
+	} catch (...) {
+		Stop();
+		throw;
+	}
+}
+
+PcmWorkerPool::~PcmWorkerPool() noexcept
+{
+	Stop();
+
+	assert(pending.empty());
+}
+
+void
+PcmWorkerPool::Stop() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		pending_cond.notify_all();
+	}
+
+	for (auto &thread : threads)
+		if (thread.IsDefined())
+			thread.Join();
+
+	threads.clear();
+}
+
+void
+PcmWorkerPool::Run(Batch &batch) noexcept
+{
+	if (batch.n > 1) {
+		const std::scoped_lock lock{mutex};
+		pending.push_back(batch);
+		pending_cond.notify_all();
+	}
+
+	batch.Work();
+
+	/* all tasks have been claimed; wait for the pool threads
+	   which are still running one of them */
+	std::unique_lock lock{mutex};
+	if (batch.is_linked())
+		pending.erase(pending.iterator_to(batch));
+
+	finished_cond.wait(lock, [&batch]{
+		return batch.n_workers == 0;
+	});
+}
+
+void
+PcmWorkerPool::RunThread() noexcept
+{
+	SetThreadName("pcm");
+
+	/* these threads work for the output threads, so they get
+	   the same scheduling */
+	try {
+		if (!ApplyThreadProfile(ThreadProfileType::OUTPUT))
+			SetThreadRealtime();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to apply the PCM thread profile");
+	}
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		pending_cond.wait(lock, [this]{
+			return quit || !pending.empty();
+		});
+
+		if (quit)
+			break;
+
+		auto &batch = pending.front();
+		++batch.n_workers;
+
+		lock.unlock();
+		batch.Work();
+		lock.lock();
+
+		/* no task left to claim: don't let other threads
+		   pick up this batch again */
+		if (batch.is_linked())
+			pending.erase(pending.iterator_to(batch));
+
+		--batch.n_workers;
+		finished_cond.notify_all();
+	}
+}
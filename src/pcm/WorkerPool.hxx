@@ -0,0 +1,131 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_WORKER_POOL_HXX
+#define MPD_PCM_WORKER_POOL_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <atomic>
+#include <forward_list>
+
+/**
+ * A small pool of threads which helps the output threads with
+ * expensive PCM conversions.  Work is submitted as a batch of
+ * independent tasks; the submitting thread works on the batch
+ * as well, so it never waits for a task which has not been started
+ * yet.  This limits the handoff latency even if all pool threads are
+ * busy with batches from other outputs.
+ */
+class PcmWorkerPool {
+	struct Batch : SafeLinkIntrusiveListHook {
+		void (*const function)(void *ctx, unsigned i) noexcept;
+		void *const ctx;
+
+		const unsigned n;
+
+		/**
+		 * The next task index to be claimed.
+		 */
+		std::atomic_uint next{0};
+
+		/**
+		 * The number of pool threads currently working on
+		 * this batch.  Protected by #mutex.
+		 */
+		unsigned n_workers = 0;
+
+		Batch(void (*_function)(void *, unsigned) noexcept,
+		      void *_ctx, unsigned _n) noexcept
+			:function(_function), ctx(_ctx), n(_n) {}
+
+		/**
+		 * Run tasks until all of them have been claimed.
+		 */
+		void Work() noexcept {
+			unsigned i;
+			while ((i = next.fetch_add(1, std::memory_order_relaxed)) < n)
+				function(ctx, i);
+		}
+	};
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a batch was added or when #quit was set.
+	 */
+	Cond pending_cond;
+
+	/**
+	 * Signalled when a pool thread leaves a batch.
+	 */
+	Cond finished_cond;
+
+	IntrusiveList<Batch> pending;
+
+	bool quit = false;
+
+	std::forward_list<Thread> threads;
+
+	const unsigned n_threads;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit PcmWorkerPool(unsigned n_threads);
+
+	~PcmWorkerPool() noexcept;
+
+	PcmWorkerPool(const PcmWorkerPool &) = delete;
+	PcmWorkerPool &operator=(const PcmWorkerPool &) = delete;
+
+	unsigned GetThreadCount() const noexcept {
+		return n_threads;
+	}
+
+	/**
+	 * Invoke f(i) for each i in [0, n) and return after all of
+	 * them have finished.  The calls may run in parallel, in
+	 * any order.
+	 */
+	template<typename F>
+	void Run(unsigned n, F &f) noexcept {
+		Batch batch([](void *ctx, unsigned i) noexcept {
+			(*(F *)ctx)(i);
+		}, &f, n);
+
+		Run(batch);
+	}
+
+private:
+	void Run(Batch &batch) noexcept;
+
+	/**
+	 * Ask all threads to quit and wait for them.
+	 */
+	void Stop() noexcept;
+
+	void RunThread() noexcept;
+};
+
+#endif
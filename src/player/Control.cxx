@@ -48,6 +48,10 @@ PlayerControl::WaitOutputConsumed(std::unique_lock<Mutex> &lock,
 {
 	bool result = outputs.CheckPipe() < threshold;
 	if (!result && command == PlayerCommand::NONE) {
+		/* the outputs must not wait for more chunks while we
+		   wait for them */
+		outputs.WakeUp();
+
 		Wait(lock);
 		result = outputs.CheckPipe() < threshold;
 	}
@@ -114,6 +118,23 @@ PlayerControl::Kill() noexcept
 	listener.OnPlayerStateChanged();
 }
 
+void
+PlayerControl::LockSuspend() noexcept
+{
+	if (!thread.IsDefined())
+		return;
+
+	{
+		std::unique_lock<Mutex> lock(mutex);
+		if (state != PlayerState::STOP || next_song != nullptr)
+			return;
+
+		SynchronousCommand(lock, PlayerCommand::SUSPEND);
+	}
+
+	thread.Join();
+}
+
 void
 PlayerControl::PauseLocked(std::unique_lock<Mutex> &lock) noexcept
 {
@@ -161,15 +182,10 @@ PlayerControl::LockSetBorderPause(bool _border_pause) noexcept
 	border_pause = _border_pause;
 }
 
-PlayerStatus
-PlayerControl::LockGetStatus() noexcept
+inline PlayerStatus
+PlayerControl::MakeStatus() const noexcept
 {
-	PlayerStatus status;
-
-	std::unique_lock<Mutex> lock(mutex);
-	if (!occupied && thread.IsDefined())
-		SynchronousCommand(lock, PlayerCommand::REFRESH);
-
+	PlayerStatus status{};
 	status.state = state;
 
 	if (state != PlayerState::STOP) {
@@ -182,6 +198,22 @@ PlayerControl::LockGetStatus() noexcept
 	return status;
 }
 
+PlayerStatus
+PlayerControl::LockGetStatus() noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+	if (!occupied && thread.IsDefined())
+		SynchronousCommand(lock, PlayerCommand::REFRESH);
+
+	return MakeStatus();
+}
+
+void
+PlayerControl::PublishStatus() noexcept
+{
+	status_snapshot.Store(MakeStatus());
+}
+
 void
 PlayerControl::SetError(PlayerError type, std::exception_ptr &&_error) noexcept
 {
@@ -269,6 +301,7 @@ PlayerControl::SeekLocked(std::unique_lock<Mutex> &lock,
 	ClearError();
 	next_song = std::move(song);
 	seek_time = t;
+	start_time = std::chrono::steady_clock::now();
 	SynchronousCommand(lock, PlayerCommand::SEEK);
 
 	assert(next_song == nullptr);
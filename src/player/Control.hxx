@@ -26,11 +26,15 @@
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
+#include "thread/Profile.hxx"
+#include "thread/SeqLock.hxx"
 #include "CrossFade.hxx"
 #include "Chrono.hxx"
 #include "ReplayGainMode.hxx"
 #include "MusicChunkPtr.hxx"
+#include "metrics/Histogram.hxx"
 
+#include <atomic>
 #include <cstdint>
 #include <exception>
 #include <memory>
@@ -40,6 +44,7 @@ struct PlayerConfig;
 class PlayerListener;
 class PlayerOutputs;
 class InputCacheManager;
+class AnalysisStore;
 class DetachedSong;
 
 enum class PlayerState : uint8_t {
@@ -86,6 +91,13 @@ enum class PlayerCommand : uint8_t {
 	 * e.g. elapsed_time.
 	 */
 	REFRESH,
+
+	/**
+	 * Like #EXIT, but leave the outputs alone; this frees the
+	 * resources of a player which is stopped, and
+	 * PlayerControl::Play() will start a new thread.
+	 */
+	SUSPEND,
 };
 
 enum class PlayerError : uint8_t {
@@ -119,6 +131,11 @@ class PlayerControl final : public AudioOutputClient {
 
 	InputCacheManager *const input_cache;
 
+	/**
+	 * @see SetAnalysisStore()
+	 */
+	AnalysisStore *analysis_store = nullptr;
+
 	const PlayerConfig config;
 
 	/**
@@ -221,12 +238,39 @@ class PlayerControl final : public AudioOutputClient {
 	SignedSongTime total_time;
 	SongTime elapsed_time;
 
+	/**
+	 * A copy of #state, #bit_rate, #audio_format, #total_time
+	 * and #elapsed_time for GetStatus().  It is published by the
+	 * player thread with PublishStatus().
+	 */
+	SeqLock<PlayerStatus> status_snapshot;
+
 	SongTime seek_time;
 
 	CrossFadeSettings cross_fade;
 
 	FloatDuration total_play_time = FloatDuration::zero();
 
+	/**
+	 * The number of chunks in the player's #MusicPipe, sampled by
+	 * the player thread for the metrics exporter.
+	 */
+	std::atomic_uint pipe_chunks{0};
+
+	/**
+	 * When was the last SEEK command (i.e. "play", "seek", "next"
+	 * etc.) submitted?  Cleared by PlayChunk() after it has
+	 * passed the first chunk to the outputs.  Protected by
+	 * #mutex.
+	 */
+	std::chrono::steady_clock::time_point start_time{};
+
+	/**
+	 * The time from a SEEK command until the first chunk was
+	 * passed to the outputs.
+	 */
+	DurationMetric start_latency;
+
 public:
 	PlayerControl(PlayerListener &_listener,
 		      PlayerOutputs &_outputs,
@@ -236,6 +280,22 @@ public:
 
 	void Kill() noexcept;
 
+	/**
+	 * If the player is stopped, exit the player thread (see
+	 * PlayerCommand::SUSPEND) to free the decoder thread and
+	 * the #MusicBuffer.  The next Play() call starts a new
+	 * thread.
+	 */
+	void LockSuspend() noexcept;
+
+	/**
+	 * Enable song analysis for songs without ReplayGain/MixRamp
+	 * tags.  Must be called before the player thread is started.
+	 */
+	void SetAnalysisStore(AnalysisStore *_analysis_store) noexcept {
+		analysis_store = _analysis_store;
+	}
+
 	/**
 	 * Like CheckRethrowError(), but locks and unlocks the object.
 	 */
@@ -313,14 +373,36 @@ public:
 		replay_gain_mode = _mode;
 	}
 
+	/**
+	 * Is ReplayGain applied by the decoder (instead of by the
+	 * audio outputs)?
+	 */
+	bool IsReplayGainInDecoder() const noexcept {
+		return config.replay_gain.in_decoder;
+	}
+
 	/**
 	 * Like ReadTaggedSong(), but locks and unlocks the object.
 	 */
 	std::unique_ptr<DetachedSong> LockReadTaggedSong() noexcept;
 
+	/**
+	 * Obtain the current status, with an up-to-date elapsed time
+	 * (this asks the player thread to refresh it, and waits for
+	 * it).
+	 */
 	[[gnu::pure]]
 	PlayerStatus LockGetStatus() noexcept;
 
+	/**
+	 * Obtain the status most recently published by the player
+	 * thread.  This never blocks, but the elapsed time may lag
+	 * behind by one #MusicChunk.
+	 */
+	PlayerStatus GetStatus() const noexcept {
+		return status_snapshot.Load();
+	}
+
 	PlayerState GetState() const noexcept {
 		return state;
 	}
@@ -340,6 +422,18 @@ public:
 		return total_play_time;
 	}
 
+	unsigned GetPipeChunks() const noexcept {
+		return pipe_chunks.load(std::memory_order_relaxed);
+	}
+
+	unsigned GetBufferChunks() const noexcept {
+		return config.buffer_chunks;
+	}
+
+	const DurationMetric &GetStartLatency() const noexcept {
+		return start_latency;
+	}
+
 private:
 	/**
 	 * Signals the object.  The object should be locked prior to
@@ -367,6 +461,7 @@ private:
 		assert(thread.IsInside());
 
 		cond.wait(lock);
+		CountThreadWakeup(ThreadProfileType::PLAYER);
 	}
 
 	/**
@@ -403,9 +498,21 @@ private:
 		assert(command != PlayerCommand::NONE);
 
 		command = PlayerCommand::NONE;
+		PublishStatus();
 		ClientSignal();
 	}
 
+	/**
+	 * Copy the current status to #status_snapshot.
+	 *
+	 * To be called from the player thread.  Caller must lock the
+	 * mutex.
+	 */
+	void PublishStatus() noexcept;
+
+	[[gnu::pure]]
+	PlayerStatus MakeStatus() const noexcept;
+
 	void LockCommandFinished() noexcept {
 		const std::scoped_lock<Mutex> protect(mutex);
 		CommandFinished();
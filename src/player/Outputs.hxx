@@ -23,6 +23,8 @@
 #include "MusicChunkPtr.hxx"
 #include "Chrono.hxx"
 
+#include <deque>
+
 struct AudioFormat;
 struct MusicChunk;
 
@@ -96,6 +98,37 @@ public:
 	 */
 	virtual void Cancel() noexcept = 0;
 
+	/**
+	 * Keep the chunks which have been played during the given
+	 * duration, for CancelForSeek().  Zero (the default)
+	 * disables this.
+	 */
+	virtual void SetSeekHistory(SongTime duration) noexcept = 0;
+
+	/**
+	 * Let Play() wake up the outputs only after the given
+	 * duration of audio data has been added since the last
+	 * wakeup, to reduce the number of thread wakeups.  Zero (the
+	 * default) wakes them for every chunk.  The caller must call
+	 * WakeUp() before it waits for something else.
+	 */
+	virtual void SetWakeupThreshold(std::chrono::steady_clock::duration threshold) noexcept = 0;
+
+	/**
+	 * Wake up all outputs which have not yet been notified of
+	 * chunks added by Play().
+	 */
+	virtual void WakeUp() noexcept = 0;
+
+	/**
+	 * Like Cancel(), but instead of freeing the cancelled chunks,
+	 * return them, preceded by the chunks which have been played
+	 * recently (see SetSeekHistory()).  All of them belong to the
+	 * current song and have a defined time stamp; they are
+	 * ordered by time.
+	 */
+	virtual std::deque<MusicChunkPtr> CancelForSeek() noexcept = 0;
+
 	/**
 	 * Indicate that a new song will begin now.
 	 */
@@ -49,8 +49,11 @@
 #include "util/Compiler.h"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
+#include "thread/Profile.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+#include <deque>
 #include <exception>
 #include <memory>
 
@@ -73,6 +76,13 @@ class Player {
 
 	std::shared_ptr<MusicPipe> pipe;
 
+	/**
+	 * Chunks of the current song which shall be played before
+	 * the ones in #pipe.  They have been decoded already, and
+	 * were kept by SeekBuffered().
+	 */
+	std::deque<MusicChunkPtr> replay;
+
 	/**
 	 * the song currently being played
 	 */
@@ -83,7 +93,7 @@ class Player {
 	 * postponed, and sent to the output thread when the new song
 	 * really begins.
 	 */
-	std::unique_ptr<Tag> cross_fade_tag;
+	std::shared_ptr<const Tag> cross_fade_tag;
 
 	/**
 	 * Start playback as soon as this number of chunks has been
@@ -195,11 +205,36 @@ class Player {
 	 */
 	SongTime pending_seek;
 
+	/**
+	 * Information about the next song, calculated by
+	 * PrepareBorder() as soon as its decoder has finished
+	 * startup, so SongBorder() can apply it right away instead
+	 * of doing another CheckDecoderStartup() round.
+	 */
+	struct PreparedBorder {
+		/**
+		 * The decoder pipe of the next song; nullptr if
+		 * nothing has been prepared.
+		 */
+		const MusicPipe *pipe = nullptr;
+
+		SignedSongTime total_time;
+
+		AudioFormat in_audio_format, out_audio_format;
+
+		unsigned buffer_before_play;
+	} border;
+
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
 	       MusicBuffer &_buffer) noexcept
 		:pc(_pc), dc(_dc), buffer(_buffer),
-		 decoder_wakeup_threshold(buffer.GetSize() * 3 / 4)
+		 decoder_wakeup_threshold(pc.config.power_profile == PowerProfile::EFFICIENCY
+					  /* let the buffer run almost
+					     empty and then refill it in
+					     one burst */
+					  ? buffer.GetSize() / 4
+					  : buffer.GetSize() * 3 / 4)
 	{
 	}
 
@@ -227,6 +262,17 @@ private:
 			  std::shared_ptr<MusicPipe> pipe,
 			  bool initial_seek_essential) noexcept;
 
+	/**
+	 * The next song has been queued while the decoder is still
+	 * busy with the current one: if it continues the current
+	 * song in the same file (e.g. the next track of a CUE sheet),
+	 * let the decoder proceed across the boundary instead of
+	 * stopping and restarting it later.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void ContinueDecoder() noexcept;
+
 	/**
 	 * The decoder has acknowledged the "START" command (see
 	 * ActivateDecoder()).  This function checks if the decoder
@@ -240,6 +286,32 @@ private:
 	 */
 	bool CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept;
 
+	/**
+	 * Calculate #buffer_before_play for the given audio format.
+	 */
+	[[gnu::pure]]
+	unsigned CalculateBufferBeforePlay(AudioFormat audio_format) const noexcept;
+
+	/**
+	 * If the decoder has finished starting the next song,
+	 * calculate everything SongBorder() will need (see
+	 * #border).
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void PrepareBorder() noexcept;
+
+	/**
+	 * Apply the information collected by PrepareBorder() to the
+	 * song which has just been activated, replacing
+	 * CheckDecoderStartup().
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return false if nothing has been prepared for this song
+	 */
+	bool ApplyBorder() noexcept;
+
 	/**
 	 * Stop the decoder and clears (and frees) its music pipe.
 	 *
@@ -290,6 +362,22 @@ private:
 	 */
 	bool SeekDecoder(std::unique_lock<Mutex> &lock) noexcept;
 
+	/**
+	 * Try to seek within the chunks which have already been
+	 * decoded, without asking the decoder: the given ones
+	 * (returned by PlayerOutputs::CancelForSeek()), #replay and
+	 * #pipe.  The chunks before the destination are freed, the
+	 * rest is moved to #replay.  This works only if the decoder
+	 * is at the current song.
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return true on success, false if the destination has not
+	 * been decoded yet (or not anymore)
+	 */
+	bool SeekBuffered(std::deque<MusicChunkPtr> &&history,
+			  SongTime seek_time) noexcept;
+
 	void CancelPendingSeek() noexcept {
 		pending_seek = SongTime::zero();
 		pc.CancelPendingSeek();
@@ -349,11 +437,33 @@ private:
 	 */
 	bool PlayNextChunk() noexcept;
 
+	/**
+	 * Copy the elapsed time of the outputs (or our own estimate
+	 * if they don't know it) to PlayerControl::elapsed_time.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void UpdateElapsedTime() noexcept {
+		pc.elapsed_time = !pc.outputs.GetElapsedTime().IsNegative()
+			? SongTime(pc.outputs.GetElapsedTime())
+			: elapsed_time;
+	}
+
 	unsigned UnlockCheckOutputs() noexcept {
 		const ScopeUnlock unlock(pc.mutex);
 		return pc.outputs.CheckPipe();
 	}
 
+	/**
+	 * Wake up the outputs before waiting for the decoder, so
+	 * they play the chunks which are below the wakeup threshold
+	 * (see PlayerOutputs::SetWakeupThreshold()).
+	 */
+	void UnlockWakeUpOutputs() noexcept {
+		const ScopeUnlock unlock(pc.mutex);
+		pc.outputs.WakeUp();
+	}
+
 	/**
 	 * Player lock must be held before calling.
 	 *
@@ -392,12 +502,30 @@ Player::StartDecoder(std::unique_lock<Mutex> &lock,
 
 	SongTime start_time = pc.next_song->GetStartTime() + pc.seek_time;
 
+	border.pipe = nullptr;
+
 	dc.Start(lock, std::make_unique<DetachedSong>(*pc.next_song),
 		 start_time, pc.next_song->GetEndTime(),
 		 initial_seek_essential,
 		 buffer, std::move(_pipe));
 }
 
+void
+Player::ContinueDecoder() noexcept
+{
+	assert(queued);
+	assert(pc.next_song != nullptr);
+	assert(IsDecoderAtCurrentSong());
+
+	if (!dc.IsContinuation(*pc.next_song))
+		return;
+
+	dc.replay_gain_mode = pc.replay_gain_mode;
+
+	dc.Continue(std::make_unique<DetachedSong>(*pc.next_song),
+		    std::make_shared<MusicPipe>());
+}
+
 void
 Player::StopDecoder(std::unique_lock<Mutex> &lock) noexcept
 {
@@ -405,6 +533,8 @@ Player::StopDecoder(std::unique_lock<Mutex> &lock) noexcept
 
 	dc.Stop(lock);
 
+	border.pipe = nullptr;
+
 	if (dc.pipe != nullptr) {
 		/* clear and free the decoder pipe */
 
@@ -527,8 +657,8 @@ Player::MixRampScannerReady() noexcept
 		const std::size_t want_pipe_bytes =
 			dc.out_audio_format.TimeToSize(std::chrono::seconds{20});
 		const std::size_t want_pipe_chunks =
-			std::min((want_pipe_bytes + sizeof(MusicChunk::data) - 1)
-				 / sizeof(MusicChunk::data),
+			std::min((want_pipe_bytes + buffer.GetChunkSize() - 1)
+				 / buffer.GetChunkSize(),
 				 buffer.GetSize() / std::size_t{3});
 
 		if (dc.pipe->GetSize() < want_pipe_chunks) {
@@ -608,12 +738,8 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 		pc.audio_format = dc.in_audio_format;
 		play_audio_format = dc.out_audio_format;
 		decoder_starting = false;
-
-		const size_t buffer_before_play_size =
-			play_audio_format.TimeToSize(buffer_before_play_duration);
 		buffer_before_play =
-			(buffer_before_play_size + sizeof(MusicChunk::data) - 1)
-			/ sizeof(MusicChunk::data);
+			CalculateBufferBeforePlay(play_audio_format);
 
 		pc.listener.OnPlayerStateChanged();
 
@@ -654,6 +780,69 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 	}
 }
 
+unsigned
+Player::CalculateBufferBeforePlay(const AudioFormat audio_format) const noexcept
+{
+	if (pc.config.low_latency)
+		/* start playback with the first chunk */
+		return 1;
+
+	const size_t size =
+		audio_format.TimeToSize(buffer_before_play_duration);
+	return (size + buffer.GetChunkSize() - 1) / buffer.GetChunkSize();
+}
+
+inline void
+Player::PrepareBorder() noexcept
+{
+	if (!IsDecoderAtNextSong() || border.pipe == dc.pipe.get() ||
+	    dc.IsStarting() || dc.HasFailed())
+		return;
+
+	border.pipe = dc.pipe.get();
+	border.total_time = real_song_duration(*dc.song, dc.total_time);
+	border.in_audio_format = dc.in_audio_format;
+	border.out_audio_format = dc.out_audio_format;
+	border.buffer_before_play =
+		CalculateBufferBeforePlay(dc.out_audio_format);
+}
+
+inline bool
+Player::ApplyBorder() noexcept
+{
+	assert(decoder_starting);
+
+	if (border.pipe != pipe.get() || dc.HasFailed())
+		return false;
+
+	border.pipe = nullptr;
+
+	/* the outputs have consumed all chunks of the previous song
+	   already (see SongBorder()), so there is no need to wait for
+	   them like CheckDecoderStartup() does */
+
+	const bool format_changed =
+		border.out_audio_format != play_audio_format;
+
+	pc.total_time = border.total_time;
+	pc.audio_format = border.in_audio_format;
+	play_audio_format = border.out_audio_format;
+	buffer_before_play = border.buffer_before_play;
+	decoder_starting = false;
+
+	pc.listener.OnPlayerStateChanged();
+
+	/* reopening the outputs is only necessary if the format has
+	   changed (or if they have failed before) */
+	if (!paused && (format_changed || !output_open) && !OpenOutput())
+		FmtError(player_domain,
+			 "problems opening audio device "
+			 "while playing \"{}\"",
+			 dc.song->GetURI());
+
+	return true;
+}
+
 bool
 Player::SeekDecoder(std::unique_lock<Mutex> &lock, SongTime seek_time) noexcept
 {
@@ -700,13 +889,41 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock) noexcept
 
 	CancelPendingSeek();
 
+	std::deque<MusicChunkPtr> history;
+
 	{
 		const ScopeUnlock unlock(pc.mutex);
-		pc.outputs.Cancel();
+		history = pc.outputs.CancelForSeek();
 	}
 
 	pc.listener.OnPlayerStateChanged();
 
+	if (!decoder_starting && IsDecoderAtCurrentSong() &&
+	    dc.IsSeekableCurrentSong(*pc.next_song) &&
+	    SeekBuffered(std::move(history), pc.seek_time)) {
+		/* the destination has already been decoded; the
+		   decoder continues where it is */
+
+		pc.next_song.reset();
+		queued = false;
+		pc.CommandFinished();
+
+		assert(xfade_state == CrossFadeState::UNKNOWN);
+
+		{
+			/* call syncPlaylistWithQueue() in the main thread */
+			const ScopeUnlock unlock(pc.mutex);
+			pc.listener.OnPlayerSync();
+		}
+
+		return true;
+	}
+
+	/* the chunks which were decoded before the seek are
+	   obsolete */
+	history.clear();
+	replay.clear();
+
 	if (!dc.IsSeekableCurrentSong(*pc.next_song)) {
 		/* the decoder is already decoding the "next" song -
 		   stop it and start the previous song again */
@@ -772,6 +989,87 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock) noexcept
 	return true;
 }
 
+bool
+Player::SeekBuffered(std::deque<MusicChunkPtr> &&history,
+		     SongTime seek_time) noexcept
+{
+	assert(IsDecoderAtCurrentSong());
+
+	/* the chunks which have not been sent to the outputs yet
+	   follow the ones which were cancelled */
+	for (auto &chunk : replay)
+		history.emplace_back(std::move(chunk));
+	replay.clear();
+
+	/* is the destination within the chunks which were
+	   cancelled (or played recently)? */
+
+	if (!history.empty() && seek_time >= SongTime(history.front()->time)) {
+		const auto i = std::find_if(history.begin(), history.end(),
+					    [seek_time](const auto &chunk){
+						    return SongTime(chunk->time) > seek_time;
+					    });
+		if (i != history.end()) {
+			history.erase(history.begin(), std::prev(i));
+			replay = std::move(history);
+			elapsed_time = SongTime(replay.front()->time);
+			return true;
+		}
+	}
+
+	/* find the last chunk in the pipe which begins before the
+	   destination; there must be another one after it, or else
+	   the destination may not have been decoded yet */
+
+	const MusicChunk *chunk;
+	unsigned n = 0, skip = 0;
+	bool found = false;
+	for (chunk = pipe->Peek(); chunk != nullptr;
+	     chunk = pipe->GetNext(*chunk), ++n) {
+		if (chunk->length == 0)
+			/* a tag without audio data */
+			continue;
+
+		if (chunk->time.IsNegative())
+			return false;
+
+		if (SongTime(chunk->time) > seek_time)
+			break;
+
+		skip = n;
+		found = true;
+	}
+
+	if (chunk == nullptr)
+		return false;
+
+	if (!found) {
+		/* the destination is before the pipe; it may be in
+		   the last cancelled chunk */
+		if (history.empty() ||
+		    seek_time < SongTime(history.back()->time))
+			return false;
+
+		history.erase(history.begin(), std::prev(history.end()));
+		replay = std::move(history);
+		elapsed_time = SongTime(replay.front()->time);
+		return true;
+	}
+
+	/* drop the chunks before the destination, but keep their
+	   tags */
+
+	std::shared_ptr<const Tag> tag;
+	for (unsigned i = 0; i < skip; ++i)
+		tag = Tag::Merge(std::move(tag), std::move(pipe->Shift()->tag));
+
+	auto first = pipe->Shift();
+	first->tag = Tag::Merge(std::move(tag), std::move(first->tag));
+	elapsed_time = SongTime(first->time);
+	replay.emplace_back(std::move(first));
+	return true;
+}
+
 inline bool
 Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 {
@@ -782,6 +1080,7 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 	case PlayerCommand::STOP:
 	case PlayerCommand::EXIT:
 	case PlayerCommand::CLOSE_AUDIO:
+	case PlayerCommand::SUSPEND:
 		return false;
 
 	case PlayerCommand::UPDATE_AUDIO:
@@ -804,6 +1103,8 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 		if (dc.IsIdle())
 			StartDecoder(lock, std::make_shared<MusicPipe>(),
 				     false);
+		else if (IsDecoderAtCurrentSong())
+			ContinueDecoder();
 
 		break;
 
@@ -839,6 +1140,8 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 			/* the decoder is already decoding the song -
 			   stop it and reset the position */
 			StopDecoder(lock);
+		else
+			dc.CancelContinuation();
 
 		pc.next_song.reset();
 		queued = false;
@@ -851,10 +1154,7 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 			pc.outputs.CheckPipe();
 		}
 
-		pc.elapsed_time = !pc.outputs.GetElapsedTime().IsNegative()
-			? SongTime(pc.outputs.GetElapsedTime())
-			: elapsed_time;
-
+		UpdateElapsedTime();
 		pc.CommandFinished();
 		break;
 	}
@@ -902,6 +1202,7 @@ Player::CheckCrossFade() noexcept
 					dc.GetMixRampStart(),
 					dc.GetMixRampPreviousEnd(),
 					play_audio_format,
+					buffer.GetChunkSize(),
 					buffer.GetSize() -
 					buffer_before_play);
 	if (cross_fade_chunks > 0)
@@ -944,6 +1245,16 @@ PlayerControl::PlayChunk(DetachedSong &song, MusicChunkPtr chunk,
 	{
 		const std::scoped_lock<Mutex> lock(mutex);
 		bit_rate = chunk->bit_rate;
+
+		if (start_time != std::chrono::steady_clock::time_point{}) {
+			const auto latency =
+				std::chrono::steady_clock::now() - start_time;
+			start_time = {};
+			start_latency.Add(latency);
+
+			FmtDebug(player_domain, "start latency: {} ms",
+				 std::chrono::duration_cast<std::chrono::milliseconds>(latency).count());
+		}
 	}
 
 	/* send the chunk to the audio outputs */
@@ -964,7 +1275,7 @@ Player::PlayNextChunk() noexcept
 
 	/* activate cross-fading? */
 	if (xfade_state == CrossFadeState::ENABLED &&
-	    IsDecoderAtNextSong() &&
+	    replay.empty() && IsDecoderAtNextSong() &&
 	    pipe->GetSize() <= cross_fade_chunks) {
 		/* beginning of the cross fade - adjust
 		   cross_fade_chunks which might be bigger than the
@@ -997,6 +1308,8 @@ Player::PlayNextChunk() noexcept
 			if (pc.cross_fade.mixramp_delay <= FloatDuration::zero()) {
 				chunk->mix_ratio = ((float)cross_fade_position)
 					     / cross_fade_chunks;
+				chunk->mix_ratio_end = ((float)cross_fade_position - 1)
+					     / cross_fade_chunks;
 			} else {
 				chunk->mix_ratio = -1;
 			}
@@ -1032,8 +1345,14 @@ Player::PlayNextChunk() noexcept
 		}
 	}
 
-	if (chunk == nullptr)
-		chunk = pipe->Shift();
+	if (chunk == nullptr) {
+		if (!replay.empty()) {
+			/* chunks kept by SeekBuffered() come first */
+			chunk = std::move(replay.front());
+			replay.pop_front();
+		} else
+			chunk = pipe->Shift();
+	}
 
 	assert(chunk != nullptr);
 
@@ -1066,6 +1385,8 @@ Player::PlayNextChunk() noexcept
 
 	const std::scoped_lock<Mutex> lock(pc.mutex);
 
+	pc.pipe_chunks.store(pipe->GetSize(), std::memory_order_relaxed);
+
 	/* this formula should prevent that the decoder gets woken up
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
@@ -1088,6 +1409,7 @@ Player::SongBorder() noexcept
 
 		FmtNotice(player_domain, "played \"{}\"", song->GetURI());
 
+		assert(replay.empty());
 		ReplacePipe(dc.pipe);
 
 		pc.outputs.SongBorder();
@@ -1108,6 +1430,10 @@ Player::SongBorder() noexcept
 		pc.outputs.Pause();
 		pc.listener.OnPlayerStateChanged();
 	}
+
+	/* the next song's decoder has usually finished startup long
+	   ago; use what PrepareBorder() has calculated */
+	ApplyBorder();
 }
 
 inline void
@@ -1115,6 +1441,10 @@ Player::Run() noexcept
 {
 	pipe = std::make_shared<MusicPipe>();
 
+	/* this also forgets chunks of the previous playback */
+	pc.outputs.SetSeekHistory(pc.config.seek_history);
+	pc.outputs.SetWakeupThreshold(pc.config.output_wakeup_threshold);
+
 	std::unique_lock<Mutex> lock(pc.mutex);
 
 	StartDecoder(lock, pipe, true);
@@ -1125,6 +1455,12 @@ Player::Run() noexcept
 	pc.CommandFinished();
 
 	while (ProcessCommand(lock)) {
+		/* the outputs have probably finished another chunk;
+		   publish the new elapsed time for
+		   PlayerControl::GetStatus() */
+		UpdateElapsedTime();
+		pc.PublishStatus();
+
 		if (decoder_starting) {
 			/* wait until the decoder is initialized completely */
 
@@ -1162,11 +1498,12 @@ Player::Run() noexcept
 		}
 
 		CheckCrossFade();
+		PrepareBorder();
 
 		if (paused) {
 			if (pc.command == PlayerCommand::NONE)
 				pc.Wait(lock);
-		} else if (!pipe->IsEmpty()) {
+		} else if (!replay.empty() || !pipe->IsEmpty()) {
 			/* at least one music chunk is ready - send it
 			   to the audio output */
 
@@ -1183,6 +1520,7 @@ Player::Run() noexcept
 			// TODO: eliminate this kludge
 			dc.Signal();
 
+			UnlockWakeUpOutputs();
 			dc.WaitForDecoder(lock);
 		} else if (IsDecoderAtNextSong()) {
 			/* at the beginning of a new song */
@@ -1220,6 +1558,7 @@ Player::Run() noexcept
 			// TODO: eliminate this kludge
 			dc.Signal();
 
+			UnlockWakeUpOutputs();
 			dc.WaitForDecoder(lock);
 		}
 	}
@@ -1227,6 +1566,7 @@ Player::Run() noexcept
 	CancelPendingSeek();
 	StopDecoder(lock);
 
+	replay.clear();
 	pipe.reset();
 
 	cross_fade_tag.reset();
@@ -1244,6 +1584,7 @@ Player::Run() noexcept
 	}
 
 	pc.state = PlayerState::STOP;
+	pc.PublishStatus();
 }
 
 static void
@@ -1259,13 +1600,22 @@ PlayerControl::RunThread() noexcept
 try {
 	SetThreadName("player");
 
+	try {
+		ApplyThreadProfile(ThreadProfileType::PLAYER);
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to apply the player thread profile");
+	}
+
 	DecoderControl dc(mutex, cond,
-			  input_cache,
+			  input_cache, analysis_store,
 			  config.audio_format,
+			  config.float_pipeline,
 			  config.replay_gain);
 	dc.StartThread();
 
-	MusicBuffer buffer{config.buffer_chunks};
+	MusicBuffer buffer{config.buffer_chunks, config.chunk_size,
+			   config.buffer_options};
 
 	std::unique_lock<Mutex> lock(mutex);
 
@@ -1336,6 +1686,16 @@ try {
 			CommandFinished();
 			return;
 
+		case PlayerCommand::SUSPEND:
+			{
+				const ScopeUnlock unlock(mutex);
+				dc.Quit();
+				outputs.Release();
+			}
+
+			CommandFinished();
+			return;
+
 		case PlayerCommand::CANCEL:
 			next_song.reset();
 
@@ -21,6 +21,7 @@
 #include "PlaylistFile.hxx"
 #include "PlaylistStream.hxx"
 #include "SongEnumerator.hxx"
+#include "MemorySongEnumerator.hxx"
 #include "Mapper.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "storage/StorageInterface.hxx"
@@ -40,6 +41,17 @@ playlist_open_in_playlist_dir(const char *uri, Mutex &mutex)
 	if (path_fs.IsNull())
 		return nullptr;
 
+	/* plain stored playlists are served from the cache of parsed
+	   playlist files, which avoids parsing them again */
+	if (const auto contents = spl_load_plain(path_fs)) {
+		std::forward_list<DetachedSong> songs;
+		auto tail = songs.before_begin();
+		for (const auto &i : *contents)
+			tail = songs.emplace_after(tail, i);
+
+		return std::make_unique<MemorySongEnumerator>(std::move(songs));
+	}
+
 	return playlist_open_path(path_fs, mutex);
 }
 
@@ -36,23 +36,30 @@
 
 #include <memory>
 
-void
-playlist_load_into_queue(const char *uri, SongEnumerator &e,
-			 unsigned start_index, unsigned end_index,
-			 playlist &dest, PlayerControl &pc,
-			 const SongLoader &loader)
+PlaylistQueueLoader::PlaylistQueueLoader(const char *uri, SongEnumerator &_e,
+					 unsigned _start_index,
+					 unsigned _end_index) noexcept
+	:e(_e),
+	 base_uri(uri != nullptr
+		  ? PathTraitsUTF8::GetParent(uri)
+		  : "."),
+	 start_index(_start_index), end_index(_end_index)
 {
-	const unsigned max_log_msgs = 8;
+}
 
-	const auto base_uri = uri != nullptr
-		? PathTraitsUTF8::GetParent(uri)
-		: ".";
+bool
+PlaylistQueueLoader::LoadBatch(unsigned max_songs,
+			       playlist &dest, PlayerControl &pc,
+			       const SongLoader &loader)
+{
+	const unsigned max_log_msgs = 8;
 
 	std::unique_ptr<DetachedSong> song;
-	for (unsigned i = 0, failures = 0;
-	     i < end_index && (song = e.NextSong()) != nullptr;
-	     ++i) {
-		if (i < start_index) {
+	for (unsigned n = 0; n < max_songs; ++n) {
+		if (i >= end_index || (song = e.NextSong()) == nullptr)
+			return false;
+
+		if (i++ < start_index) {
 			/* skip songs before the start index */
 			continue;
 		}
@@ -70,6 +77,18 @@ playlist_load_into_queue(const char *uri, SongEnumerator &e,
 
 		dest.AppendSong(pc, std::move(*song));
 	}
+
+	return i < end_index;
+}
+
+void
+playlist_load_into_queue(const char *uri, SongEnumerator &e,
+			 unsigned start_index, unsigned end_index,
+			 playlist &dest, PlayerControl &pc,
+			 const SongLoader &loader)
+{
+	PlaylistQueueLoader l(uri, e, start_index, end_index);
+	while (l.LoadBatch(1024, dest, pc, loader)) {}
 }
 
 void
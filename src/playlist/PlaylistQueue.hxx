@@ -24,10 +24,60 @@
 #ifndef MPD_PLAYLIST_QUEUE_HXX
 #define MPD_PLAYLIST_QUEUE_HXX
 
+#include <string>
+
 class SongLoader;
 class SongEnumerator;
 struct playlist;
 class PlayerControl;
+struct LocatedUri;
+
+/**
+ * Loads the contents of a playlist into a play queue, a few songs at
+ * a time.  This allows loading huge playlists without blocking the
+ * #EventLoop for a long time.
+ */
+class PlaylistQueueLoader {
+	SongEnumerator &e;
+
+	/**
+	 * The base URI for resolving relative song URIs.
+	 */
+	const std::string base_uri;
+
+	const unsigned start_index, end_index;
+
+	/**
+	 * The index of the next song returned by the
+	 * #SongEnumerator.
+	 */
+	unsigned i = 0;
+
+	unsigned failures = 0;
+
+public:
+	/**
+	 * @param uri the URI of the playlist, used to resolve
+	 * relative song URIs
+	 * @param start_index the index of the first song
+	 * @param end_index the index of the last song (excluding)
+	 */
+	PlaylistQueueLoader(const char *uri, SongEnumerator &_e,
+			    unsigned _start_index, unsigned _end_index) noexcept;
+
+	/**
+	 * Read up to the given number of songs from the playlist and
+	 * append them to the play queue.
+	 *
+	 * Throws on error.
+	 *
+	 * @return true if there may be more songs, false if the end
+	 * of the playlist (or the range) has been reached
+	 */
+	bool LoadBatch(unsigned max_songs,
+		       playlist &dest, PlayerControl &pc,
+		       const SongLoader &loader);
+};
 
 /**
  * Loads the contents of a playlist and append it to the specified
@@ -19,22 +19,15 @@
 
 #include "AsxPlaylistPlugin.hxx"
 #include "../PlaylistPlugin.hxx"
-#include "../MemorySongEnumerator.hxx"
+#include "ExpatSongEnumerator.hxx"
 #include "tag/Builder.hxx"
 #include "tag/Table.hxx"
 #include "util/ASCII.hxx"
-#include "lib/expat/ExpatParser.hxx"
 
 /**
  * This is the state object for our XML parser.
  */
-struct AsxParser {
-	/**
-	 * The list of songs (in reverse order because that's faster
-	 * while adding).
-	 */
-	std::forward_list<DetachedSong> songs;
-
+struct AsxParser final : ExpatSongEnumerator {
 	/**
 	 * The current position in the XML file.
 	 */
@@ -58,6 +51,8 @@ struct AsxParser {
 	TagBuilder tag_builder;
 
 	std::string value;
+
+	explicit AsxParser(InputStreamPtr &&_is);
 };
 
 static constexpr struct tag_table asx_tag_elements[] = {
@@ -116,8 +111,8 @@ asx_end_element(void *user_data, const XML_Char *element_name)
 	case AsxParser::ENTRY:
 		if (StringEqualsCaseASCII(element_name, "entry")) {
 			if (!parser->location.empty())
-				parser->songs.emplace_front(std::move(parser->location),
-							    parser->tag_builder.Commit());
+				parser->Push(DetachedSong(std::move(parser->location),
+							  parser->tag_builder.Commit()));
 
 			parser->state = AsxParser::ROOT;
 		}
@@ -151,6 +146,11 @@ asx_char_data(void *user_data, const XML_Char *s, int len)
 	}
 }
 
+AsxParser::AsxParser(InputStreamPtr &&_is)
+	:ExpatSongEnumerator(std::move(_is), this,
+			     asx_start_element, asx_end_element,
+			     asx_char_data) {}
+
 /*
  * The playlist object
  *
@@ -159,17 +159,7 @@ asx_char_data(void *user_data, const XML_Char *s, int len)
 static std::unique_ptr<SongEnumerator>
 asx_open_stream(InputStreamPtr &&is)
 {
-	AsxParser parser;
-
-	{
-		ExpatParser expat(&parser);
-		expat.SetElementHandler(asx_start_element, asx_end_element);
-		expat.SetCharacterDataHandler(asx_char_data);
-		expat.Parse(*is);
-	}
-
-	parser.songs.reverse();
-	return std::make_unique<MemorySongEnumerator>(std::move(parser.songs));
+	return std::make_unique<AsxParser>(std::move(is));
 }
 
 static const char *const asx_suffixes[] = {
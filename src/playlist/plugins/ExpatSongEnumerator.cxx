@@ -0,0 +1,63 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ExpatSongEnumerator.hxx"
+#include "input/InputStream.hxx"
+
+ExpatSongEnumerator::ExpatSongEnumerator(InputStreamPtr &&_is,
+					 void *user_data,
+					 XML_StartElementHandler start,
+					 XML_EndElementHandler end,
+					 XML_CharacterDataHandler char_data)
+	:is(std::move(_is)), parser(user_data)
+{
+	parser.SetElementHandler(start, end);
+	parser.SetCharacterDataHandler(char_data);
+}
+
+ExpatSongEnumerator::~ExpatSongEnumerator() noexcept = default;
+
+inline void
+ExpatSongEnumerator::Feed()
+{
+	char buffer[4096];
+	const size_t nbytes = is->LockRead(buffer, sizeof(buffer));
+	if (nbytes == 0) {
+		finished = true;
+		parser.CompleteParse();
+		return;
+	}
+
+	parser.Parse(buffer, nbytes);
+}
+
+std::unique_ptr<DetachedSong>
+ExpatSongEnumerator::NextSong()
+{
+	while (songs.empty()) {
+		if (finished)
+			return nullptr;
+
+		Feed();
+	}
+
+	auto result = std::make_unique<DetachedSong>(std::move(songs.front()));
+	songs.pop_front();
+	return result;
+}
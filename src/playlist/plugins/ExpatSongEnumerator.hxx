@@ -0,0 +1,86 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_EXPAT_SONG_ENUMERATOR_HXX
+#define MPD_EXPAT_SONG_ENUMERATOR_HXX
+
+#include "../SongEnumerator.hxx"
+#include "input/Ptr.hxx"
+#include "song/DetachedSong.hxx"
+#include "lib/expat/ExpatParser.hxx"
+
+#include <deque>
+
+/**
+ * Base class for playlist plugins which parse XML files with expat.
+ * The input is parsed incrementally by NextSong(): only as much of
+ * the file is read as needed to obtain the next song, so large
+ * playlists (e.g. podcast feeds) do not need to be loaded into
+ * memory as a whole.
+ */
+class ExpatSongEnumerator : public SongEnumerator {
+	InputStreamPtr is;
+
+	ExpatParser parser;
+
+	/**
+	 * Songs which have been parsed already but have not yet been
+	 * returned by NextSong().
+	 */
+	std::deque<DetachedSong> songs;
+
+	/**
+	 * Has the end of the input stream been reached?
+	 */
+	bool finished = false;
+
+protected:
+	/**
+	 * @param user_data the pointer passed to the expat callbacks
+	 */
+	ExpatSongEnumerator(InputStreamPtr &&_is, void *user_data,
+			    XML_StartElementHandler start,
+			    XML_EndElementHandler end,
+			    XML_CharacterDataHandler char_data);
+
+	~ExpatSongEnumerator() noexcept override;
+
+public:
+	/**
+	 * Called by the expat callbacks for each song found in the
+	 * playlist.
+	 */
+	void Push(DetachedSong &&song) noexcept {
+		songs.emplace_back(std::move(song));
+	}
+
+	/* virtual methods from class SongEnumerator */
+	std::unique_ptr<DetachedSong> NextSong() override;
+
+private:
+	/**
+	 * Read the next portion of the input stream and pass it to
+	 * expat.
+	 *
+	 * Throws on error.
+	 */
+	void Feed();
+};
+
+#endif
@@ -19,21 +19,14 @@
 
 #include "RssPlaylistPlugin.hxx"
 #include "../PlaylistPlugin.hxx"
-#include "../MemorySongEnumerator.hxx"
+#include "ExpatSongEnumerator.hxx"
 #include "tag/Builder.hxx"
 #include "util/ASCII.hxx"
-#include "lib/expat/ExpatParser.hxx"
 
 /**
  * This is the state object for the our XML parser.
  */
-struct RssParser {
-	/**
-	 * The list of songs (in reverse order because that's faster
-	 * while adding).
-	 */
-	std::forward_list<DetachedSong> songs;
-
+struct RssParser final : ExpatSongEnumerator {
 	/**
 	 * The current position in the XML file.
 	 */
@@ -56,7 +49,8 @@ struct RssParser {
 
 	TagBuilder tag_builder;
 
-	RssParser() = default;
+
+	explicit RssParser(InputStreamPtr &&_is);
 };
 
 static void XMLCALL
@@ -102,8 +96,8 @@ rss_end_element(void *user_data, const XML_Char *element_name)
 	case RssParser::ITEM:
 		if (StringEqualsCaseASCII(element_name, "item")) {
 			if (!parser->location.empty())
-				parser->songs.emplace_front(std::move(parser->location),
-							    parser->tag_builder.Commit());
+				parser->Push(DetachedSong(std::move(parser->location),
+							  parser->tag_builder.Commit()));
 
 			parser->state = RssParser::ROOT;
 		} else
@@ -131,6 +125,11 @@ rss_char_data(void *user_data, const XML_Char *s, int len)
 	}
 }
 
+RssParser::RssParser(InputStreamPtr &&_is)
+	:ExpatSongEnumerator(std::move(_is), this,
+			     rss_start_element, rss_end_element,
+			     rss_char_data) {}
+
 /*
  * The playlist object
  *
@@ -139,17 +138,7 @@ rss_char_data(void *user_data, const XML_Char *s, int len)
 static std::unique_ptr<SongEnumerator>
 rss_open_stream(InputStreamPtr &&is)
 {
-	RssParser parser;
-
-	{
-		ExpatParser expat(&parser);
-		expat.SetElementHandler(rss_start_element, rss_end_element);
-		expat.SetCharacterDataHandler(rss_char_data);
-		expat.Parse(*is);
-	}
-
-	parser.songs.reverse();
-	return std::make_unique<MemorySongEnumerator>(std::move(parser.songs));
+	return std::make_unique<RssParser>(std::move(is));
 }
 
 static constexpr const char *rss_suffixes[] = {
@@ -19,25 +19,18 @@
 
 #include "XspfPlaylistPlugin.hxx"
 #include "../PlaylistPlugin.hxx"
-#include "../MemorySongEnumerator.hxx"
+#include "ExpatSongEnumerator.hxx"
 #include "song/DetachedSong.hxx"
 #include "input/InputStream.hxx"
 #include "tag/Builder.hxx"
 #include "tag/Table.hxx"
-#include "lib/expat/ExpatParser.hxx"
 
 #include <string.h>
 
 /**
  * This is the state object for our XML parser.
  */
-struct XspfParser {
-	/**
-	 * The list of songs (in reverse order because that's faster
-	 * while adding).
-	 */
-	std::forward_list<DetachedSong> songs;
-
+struct XspfParser final : ExpatSongEnumerator {
 	/**
 	 * The current position in the XML file.
 	 */
@@ -61,6 +54,8 @@ struct XspfParser {
 	TagBuilder tag_builder;
 
 	std::string value;
+
+	explicit XspfParser(InputStreamPtr &&_is);
 };
 
 static constexpr struct tag_table xspf_tag_elements[] = {
@@ -146,8 +141,8 @@ xspf_end_element(void *user_data, const XML_Char *element_name)
 	case XspfParser::TRACK:
 		if (strcmp(element_name, "track") == 0) {
 			if (!parser->location.empty())
-				parser->songs.emplace_front(std::move(parser->location),
-							    parser->tag_builder.Commit());
+				parser->Push(DetachedSong(std::move(parser->location),
+							  parser->tag_builder.Commit()));
 
 			parser->state = XspfParser::TRACKLIST;
 		}
@@ -190,6 +185,11 @@ xspf_char_data(void *user_data, const XML_Char *s, int len)
 	}
 }
 
+XspfParser::XspfParser(InputStreamPtr &&_is)
+	:ExpatSongEnumerator(std::move(_is), this,
+			     xspf_start_element, xspf_end_element,
+			     xspf_char_data) {}
+
 /*
  * The playlist object
  *
@@ -198,17 +198,7 @@ xspf_char_data(void *user_data, const XML_Char *s, int len)
 static std::unique_ptr<SongEnumerator>
 xspf_open_stream(InputStreamPtr &&is)
 {
-	XspfParser parser;
-
-	{
-		ExpatParser expat(&parser);
-		expat.SetElementHandler(xspf_start_element, xspf_end_element);
-		expat.SetCharacterDataHandler(xspf_char_data);
-		expat.Parse(*is);
-	}
-
-	parser.songs.reverse();
-	return std::make_unique<MemorySongEnumerator>(std::move(parser.songs));
+	return std::make_unique<XspfParser>(std::move(is));
 }
 
 static constexpr const char *xspf_suffixes[] = {
@@ -22,13 +22,34 @@
 
 #include "util/Compiler.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 
 /**
- * A table that maps id numbers to position numbers.
+ * A table that maps id numbers to objects.
+ *
+ * The id space starts small and grows on demand (up to the
+ * configured maximum size), such that it is always at least four
+ * times as large as the number of ids in use.  This keeps ids from
+ * being reused too quickly without allocating the whole table up
+ * front.
  */
+template<typename T>
 class IdTable {
-	const unsigned size;
+	static constexpr unsigned INITIAL_SIZE = 64;
+
+	/**
+	 * The maximum size of the id space.
+	 */
+	const unsigned max_size;
+
+	/**
+	 * The current size of the id space, i.e. the number of
+	 * allocated elements in #data.  All ids are smaller than
+	 * this.
+	 */
+	unsigned size = 0;
 
 	/**
 	 * How many members of "data" are initialized?
@@ -39,13 +60,22 @@ class IdTable {
 	 */
 	unsigned initialized = 1;
 
-	unsigned next;
+	unsigned next = 1;
 
-	int *const data;
+	/**
+	 * The number of ids currently in use.
+	 */
+	unsigned n_used = 0;
+
+	/**
+	 * The object for each id; nullptr for unused ids.
+	 */
+	T **data = nullptr;
 
 public:
-	IdTable(unsigned _size) noexcept
-		:size(_size), next(1), data(new int[size]) {
+	explicit IdTable(unsigned _max_size) noexcept
+		:max_size(_max_size) {
+		assert(max_size > 1);
 	}
 
 	~IdTable() noexcept {
@@ -55,16 +85,30 @@ public:
 	IdTable(const IdTable &) = delete;
 	IdTable &operator=(const IdTable &) = delete;
 
-	int IdToPosition(unsigned id) const noexcept {
+	/**
+	 * Returns the number of bytes allocated by this object.
+	 */
+	std::size_t GetMemoryUsage() const noexcept {
+		return size * sizeof(*data);
+	}
+
+	/**
+	 * Returns the object with the given id, or nullptr if the
+	 * id is not in use.
+	 */
+	T *Lookup(unsigned id) const noexcept {
 		return id < initialized
 			? data[id]
-			: -1;
+			: nullptr;
 	}
 
 	unsigned GenerateId() noexcept {
 		assert(next > 0);
 		assert(next <= initialized);
 
+		if (n_used * 4 >= size && size < max_size)
+			Grow();
+
 		while (true) {
 			unsigned id = next;
 
@@ -81,30 +125,55 @@ public:
 
 			assert(id < initialized);
 
-			if (data[id] < 0)
+			if (data[id] == nullptr)
 				return id;
 		}
 	}
 
-	unsigned Insert(unsigned position) noexcept {
+	unsigned Insert(T &value) noexcept {
 		unsigned id = GenerateId();
 		assert(id < initialized);
-		data[id] = position;
+		data[id] = &value;
+		++n_used;
 		return id;
 	}
 
-	void Move(unsigned id, unsigned position) noexcept {
+	void Move(unsigned id, T &value) noexcept {
 		assert(id < initialized);
-		assert(data[id] >= 0);
+		assert(data[id] != nullptr);
 
-		data[id] = position;
+		data[id] = &value;
 	}
 
 	void Erase(unsigned id) noexcept {
 		assert(id < initialized);
-		assert(data[id] >= 0);
+		assert(data[id] != nullptr);
+		assert(n_used > 0);
+
+		data[id] = nullptr;
+		--n_used;
+	}
+
+private:
+	void Grow() noexcept {
+		const unsigned new_size = size == 0
+			? std::min(INITIAL_SIZE, max_size)
+			: std::min(size * 2, max_size);
+
+		T **new_data = new T *[new_size];
+		if (data != nullptr) {
+			std::copy_n(data, initialized, new_data);
+			delete[] data;
+		}
+
+		data = new_data;
+
+		if (size > 0 && next == 1 && initialized == size)
+			/* we have just wrapped around; continue with
+			   the new ids instead */
+			next = initialized;
 
-		data[id] = -1;
+		size = new_size;
 	}
 };
 
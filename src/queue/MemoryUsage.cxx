@@ -0,0 +1,35 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Queue.hxx"
+#include "song/DetachedSong.hxx"
+
+std::size_t
+Queue::GetMemoryUsage() const noexcept
+{
+	std::size_t result = length * sizeof(Node) +
+		id_table.GetMemoryUsage() +
+		tag_index.GetMemoryUsage();
+
+	ForEachItem([&result](unsigned, const Item &item){
+		result += item.song->GetMemoryUsage();
+	});
+
+	return result;
+}
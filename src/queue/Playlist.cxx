@@ -49,14 +49,14 @@ playlist::TagModified(const char *real_uri, const Tag &tag) noexcept
 {
 	bool modified = false;
 
-	for (unsigned i = 0; i < queue.length; ++i) {
-		auto &song = *queue.items[i].song;
+	queue.ForEachItem([this, real_uri, &tag, &modified](unsigned i, const Queue::Item &item){
+		auto &song = *item.song;
 		if (song.IsRealURI(real_uri)) {
 			song.SetTag(tag);
 			queue.ModifyAtPosition(i);
 			modified = true;
 		}
-	}
+	});
 
 	if (modified)
 		OnModified();
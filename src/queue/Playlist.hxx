@@ -25,6 +25,8 @@
 #include "queue/Queue.hxx"
 #include "config.h"
 
+#include <span>
+
 enum TagType : uint8_t;
 struct Tag;
 struct RangeArg;
@@ -219,6 +221,17 @@ public:
 	 */
 	unsigned AppendSong(PlayerControl &pc, DetachedSong &&song);
 
+	/**
+	 * Append many songs at once.  Unlike calling AppendSong()
+	 * repeatedly, this allocates queue memory only once, shuffles
+	 * the new songs (in random mode) only once and emits only one
+	 * modification event.
+	 *
+	 * If the queue becomes full, the songs which fit are added
+	 * and then PlaylistError is thrown.
+	 */
+	void AppendSongs(PlayerControl &pc, std::span<DetachedSong> songs);
+
 	/**
 	 * Throws #std::runtime_error on error.
 	 *
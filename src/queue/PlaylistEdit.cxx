@@ -119,6 +119,44 @@ playlist::AppendSong(PlayerControl &pc, DetachedSong &&song)
 	return id;
 }
 
+void
+playlist::AppendSongs(PlayerControl &pc, std::span<DetachedSong> songs)
+{
+	if (songs.empty())
+		return;
+
+	if (queue.IsFull())
+		throw PlaylistError(PlaylistResult::TOO_LARGE,
+				    "Playlist is too large");
+
+	const DetachedSong *const queued_song = GetQueuedSong();
+
+	std::size_t n = 0;
+	for (; n < songs.size() && !queue.IsFull(); ++n)
+		queue.Append(std::move(songs[n]), 0);
+
+	if (queue.random) {
+		/* shuffle the new songs into the list of remaining
+		   songs to play */
+
+		unsigned start;
+		if (queued >= 0)
+			start = queued + 1;
+		else
+			start = current + 1;
+		if (start < queue.GetLength())
+			queue.ShuffleOrderRangeWithPriority(start,
+							    queue.GetLength());
+	}
+
+	UpdateQueuedSong(pc, queued_song);
+	OnModified();
+
+	if (n < songs.size())
+		throw PlaylistError(PlaylistResult::TOO_LARGE,
+				    "Playlist is too large");
+}
+
 unsigned
 playlist::AppendURI(PlayerControl &pc, const SongLoader &loader,
 		    const char *uri)
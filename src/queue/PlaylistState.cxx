@@ -52,16 +52,15 @@
 #define PLAYLIST_STATE_FILE_CROSSFADE		"crossfade: "
 #define PLAYLIST_STATE_FILE_MIXRAMPDB		"mixrampdb: "
 #define PLAYLIST_STATE_FILE_MIXRAMPDELAY	"mixrampdelay: "
-#define PLAYLIST_STATE_FILE_PLAYLIST_BEGIN	"playlist_begin"
-#define PLAYLIST_STATE_FILE_PLAYLIST_END	"playlist_end"
 
 #define PLAYLIST_STATE_FILE_STATE_PLAY		"play"
 #define PLAYLIST_STATE_FILE_STATE_PAUSE		"pause"
 #define PLAYLIST_STATE_FILE_STATE_STOP		"stop"
 
-void
-playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
-		    PlayerControl &pc)
+static void
+playlist_state_save_options(BufferedOutputStream &os,
+			    const struct playlist &playlist,
+			    PlayerControl &pc)
 {
 	const auto player_status = pc.LockGetStatus();
 
@@ -101,11 +100,30 @@ playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
 	       pc.GetMixRampDb());
 	os.Fmt(FMT_STRING(PLAYLIST_STATE_FILE_MIXRAMPDELAY "{}\n"),
 	       pc.GetMixRampDelay().count());
+}
+
+void
+playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
+		    PlayerControl &pc)
+{
+	playlist_state_save_options(os, playlist, pc);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN "\n");
 	queue_save(os, playlist.queue);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
 }
 
+void
+playlist_state_save_delta(BufferedOutputStream &os,
+			  const struct playlist &playlist,
+			  PlayerControl &pc, uint32_t since)
+{
+	playlist_state_save_options(os, playlist, pc);
+	os.Fmt(FMT_STRING(PLAYLIST_STATE_FILE_PLAYLIST_DELTA "{}\n"),
+	       playlist.queue.GetLength());
+	queue_save_delta(os, playlist.queue, since);
+	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
+}
+
 static void
 playlist_state_load(LineReader &file, const SongLoader &song_loader,
 		    struct playlist &playlist)
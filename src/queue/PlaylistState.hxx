@@ -25,6 +25,12 @@
 #ifndef MPD_PLAYLIST_STATE_HXX
 #define MPD_PLAYLIST_STATE_HXX
 
+#include <cstdint>
+
+#define PLAYLIST_STATE_FILE_PLAYLIST_BEGIN	"playlist_begin"
+#define PLAYLIST_STATE_FILE_PLAYLIST_DELTA	"playlist_delta: "
+#define PLAYLIST_STATE_FILE_PLAYLIST_END	"playlist_end"
+
 struct StateFileConfig;
 struct playlist;
 class PlayerControl;
@@ -36,6 +42,16 @@ void
 playlist_state_save(BufferedOutputStream &os, const playlist &playlist,
 		    PlayerControl &pc);
 
+/**
+ * Like playlist_state_save(), but instead of the whole queue, save
+ * only its length and the songs which were modified since the given
+ * queue version (see queue_save_delta()).  This is used for the
+ * state file journal.
+ */
+void
+playlist_state_save_delta(BufferedOutputStream &os, const playlist &playlist,
+			  PlayerControl &pc, uint32_t since);
+
 bool
 playlist_state_restore(const StateFileConfig &config,
 		       const char *line, LineReader &file,
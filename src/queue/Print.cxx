@@ -22,6 +22,7 @@
 #include "Selection.hxx"
 #include "song/Filter.hxx"
 #include "SongPrint.hxx"
+#include "CompactPrint.hxx"
 #include "song/DetachedSong.hxx"
 #include "song/LightSong.hxx"
 #include "tag/Sort.hxx"
@@ -44,6 +45,20 @@ static void
 queue_print_song_info(Response &r, const Queue &queue,
 		      unsigned position)
 {
+	if (r.IsCompact()) {
+		CompactSongWriter w(r);
+		w.Song(queue.Get(position));
+		w.Integer(CompactKey::POS, position);
+		w.Integer(CompactKey::ID, queue.PositionToId(position));
+
+		if (uint8_t priority = queue.GetPriorityAtPosition(position);
+		    priority != 0)
+			w.Integer(CompactKey::PRIO, priority);
+
+		w.Finish();
+		return;
+	}
+
 	song_print_info(r, queue.Get(position));
 	r.Fmt(FMT_STRING("Pos: {}\nId: {}\n"),
 	      position, queue.PositionToId(position));
@@ -82,12 +97,9 @@ queue_print_changes_info(Response &r, const Queue &queue,
 			 uint32_t version,
 			 unsigned start, unsigned end)
 {
-	assert(start <= end);
-	assert(end <= queue.GetLength());
-
-	for (unsigned i = start; i < end; i++)
-		if (queue.IsNewerAtPosition(i, version))
-			queue_print_song_info(r, queue, i);
+	queue.ForEachChange(version, start, end, [&r, &queue](unsigned i){
+		queue_print_song_info(r, queue, i);
+	});
 }
 
 void
@@ -95,13 +107,10 @@ queue_print_changes_position(Response &r, const Queue &queue,
 			     uint32_t version,
 			     unsigned start, unsigned end)
 {
-	assert(start <= end);
-	assert(end <= queue.GetLength());
-
-	for (unsigned i = start; i < end; i++)
-		if (queue.IsNewerAtPosition(i, version))
-			r.Fmt(FMT_STRING("cpos: {}\nId: {}\n"),
-			      i, queue.PositionToId(i));
+	queue.ForEachChange(version, start, end, [&r, &queue](unsigned i){
+		r.Fmt(FMT_STRING("cpos: {}\nId: {}\n"),
+		      i, queue.PositionToId(i));
+	});
 }
 
 [[gnu::pure]]
@@ -110,6 +119,9 @@ CollectQueue(const Queue &queue, const QueueSelection &selection) noexcept
 {
 	std::vector<unsigned> v;
 
+	if (selection.FindPositions(queue, v))
+		return v;
+
 	for (unsigned i = 0; i < queue.GetLength(); i++)
 		if (selection.MatchPosition(queue, i))
 			v.emplace_back(i);
@@ -185,6 +197,13 @@ PrintQueue(Response &r, const Queue &queue,
 	if (selection.window.IsEmpty())
 		return;
 
+	if (std::vector<unsigned> v; selection.FindPositions(queue, v)) {
+		for (unsigned i = window.start;
+		     i < window.end && i < v.size(); ++i)
+			queue_print_song_info(r, queue, v[i]);
+		return;
+	}
+
 	unsigned skip = window.start;
 	unsigned n = window.Count();
 
@@ -25,8 +25,6 @@
 
 Queue::Queue(unsigned _max_length) noexcept
 	:max_length(_max_length),
-	 items(new Item[max_length]),
-	 order(new unsigned[max_length]),
 	 id_table(max_length * HASH_MULT)
 {
 }
@@ -34,9 +32,6 @@ Queue::Queue(unsigned _max_length) noexcept
 Queue::~Queue() noexcept
 {
 	Clear();
-
-	delete[] items;
-	delete[] order;
 }
 
 LightSong
@@ -74,152 +69,244 @@ Queue::IncrementVersion() noexcept
 	version++;
 
 	if (version >= max) {
-		for (unsigned i = 0; i < length; i++)
-			items[i].version = 0;
+		for (Node *node = items.First(); node != nullptr;
+		     node = ItemTree::Next(*node)) {
+			node->version = 0;
+			node->range_version = 0;
+		}
 
 		version = 1;
+
+		/* the old journal records are meaningless now; the
+		   items with version 0 are covered by
+		   #zero_version_end */
+		journal_size = 0;
+		journal_min_version = version;
+		zero_version_end = std::max(zero_version_end, length);
+	}
+}
+
+uint32_t
+Queue::GetVersionAtPosition(unsigned position) const noexcept
+{
+	assert(position < length);
+
+	/* walk down from the root, taking all range versions on the
+	   way into account */
+
+	uint32_t result = 0;
+	const Node *node = items.GetRoot();
+	while (true) {
+		result = std::max(result, node->range_version);
+
+		const Node *left = ItemTree::GetLeft(*node);
+		const unsigned left_size =
+			left != nullptr ? left->position_links.size : 0;
+		if (position < left_size) {
+			node = left;
+		} else if (position == left_size) {
+			return std::max(result, node->version);
+		} else {
+			position -= left_size + 1;
+			node = ItemTree::GetRight(*node);
+		}
 	}
 }
 
 void
-Queue::ModifyAtOrder(unsigned _order) noexcept
+Queue::AddJournal(unsigned start, unsigned end) noexcept
 {
-	assert(_order < length);
+	assert(start < end);
 
-	unsigned position = order[_order];
-	ModifyAtPosition(position);
+	if (journal_size > 0) {
+		auto &last = journal[(journal_head + journal_size - 1) % JOURNAL_SIZE];
+		if (last.version == version) {
+			/* extend the current record */
+			last.start = std::min(last.start, start);
+			last.end = std::max(last.end, end);
+			return;
+		}
+	}
+
+	if (journal_size == JOURNAL_SIZE) {
+		/* the ring is full: discard the oldest record */
+		journal_min_version = journal[journal_head].version + 1;
+		journal_head = (journal_head + 1) % JOURNAL_SIZE;
+		--journal_size;
+	}
+
+	journal[(journal_head + journal_size) % JOURNAL_SIZE] =
+		{version, start, end};
+	++journal_size;
 }
 
-unsigned
-Queue::Append(DetachedSong &&song, uint8_t priority) noexcept
+bool
+Queue::GetChangedRanges(uint32_t since,
+			std::vector<PositionRange> &ranges) const noexcept
 {
-	assert(!IsFull());
+	if (since > version || since < journal_min_version)
+		return false;
 
-	const unsigned position = length++;
-	const unsigned id = id_table.Insert(position);
+	ranges.clear();
+
+	if (zero_version_end > 0)
+		ranges.emplace_back(0, std::min(zero_version_end, length));
+
+	for (unsigned i = 0; i < journal_size; ++i) {
+		const auto &record = journal[(journal_head + i) % JOURNAL_SIZE];
+		if (record.version >= since && record.start < length)
+			ranges.emplace_back(record.start,
+					    std::min(record.end, length));
+	}
+
+	std::sort(ranges.begin(), ranges.end());
+
+	if (ranges.empty())
+		return true;
 
-	auto &item = items[position];
-	item.song = new DetachedSong(std::move(song));
-	item.id = id;
-	item.version = version;
-	item.priority = priority;
+	/* merge overlapping ranges */
+	auto dest = ranges.begin();
+	for (auto i = std::next(dest); i != ranges.end(); ++i) {
+		if (i->first <= dest->second)
+			dest->second = std::max(dest->second, i->second);
+		else
+			*++dest = *i;
+	}
 
-	order[position] = position;
+	ranges.erase(std::next(dest), ranges.end());
+	return true;
+}
 
-	return id;
+void
+Queue::UpdateTagIndex(const Node &node) noexcept
+{
+	/* the old values cannot be removed because they are not
+	   known anymore; they remain in the index as stale
+	   entries */
+	const Tag &tag = node.song->GetTag();
+	tag_index.Invalidate(tag);
+	tag_index.Add(node.id, tag);
+	CheckTagIndex();
 }
 
 void
-Queue::SwapPositions(unsigned position1, unsigned position2) noexcept
+Queue::CheckTagIndex() noexcept
 {
-	unsigned id1 = items[position1].id;
-	unsigned id2 = items[position2].id;
+	if (!tag_index.IsFragmented())
+		return;
 
-	std::swap(items[position1], items[position2]);
+	tag_index.Clear();
+	ForEachItem([this](unsigned, const Item &item){
+		tag_index.Add(item.id, item.song->GetTag());
+	});
+}
 
-	items[position1].version = version;
-	items[position2].version = version;
+void
+Queue::ModifyAtPosition(unsigned position) noexcept
+{
+	assert(position < length);
 
-	id_table.Move(id1, position2);
-	id_table.Move(id2, position1);
+	Node &node = items.Select(position);
+	Modify(node, position);
+	UpdateTagIndex(node);
 }
 
 void
-Queue::MovePostion(unsigned from, unsigned to) noexcept
+Queue::ModifyAtOrder(unsigned _order) noexcept
 {
-	const Item tmp = items[from];
+	assert(_order < length);
 
-	/* move songs to one less in from->to */
+	Node &node = order.Select(_order);
+	Modify(node, ItemTree::Rank(node));
+	UpdateTagIndex(node);
+}
 
-	for (unsigned i = from; i < to; i++)
-		MoveItemTo(i + 1, i);
+void
+Queue::ModifyRange(unsigned start, unsigned end) noexcept
+{
+	assert(start <= end);
+	assert(end <= length);
 
-	/* move songs to one more in to->from */
+	if (start == end)
+		return;
 
-	for (unsigned i = from; i > to; i--)
-		MoveItemTo(i - 1, i);
+	items.ApplyRange(start, end, [this](Node &root){
+		root.range_version = version;
+	});
 
-	/* put song at _to_ */
+	AddJournal(start, end);
+}
 
-	id_table.Move(tmp.id, to);
-	items[to] = tmp;
-	items[to].version = version;
+unsigned
+Queue::Append(DetachedSong &&song, uint8_t priority) noexcept
+{
+	assert(!IsFull());
 
-	/* now deal with order */
+	auto *node = new Node();
+	node->song = new DetachedSong(std::move(song));
+	node->id = id_table.Insert(*node);
+	node->priority = priority;
 
-	if (random) {
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] > from && order[i] <= to)
-				order[i]--;
-			else if (order[i] < from &&
-				 order[i] >= to)
-				order[i]++;
-			else if (from == order[i])
-				order[i] = to;
-		}
-	}
+	const unsigned position = length++;
+	items.push_back(*node);
+	order.push_back(*node);
+	Modify(*node, position);
+
+	tag_index.Add(node->id, node->song->GetTag());
+
+	return node->id;
 }
 
 void
-Queue::MoveRange(unsigned start, unsigned end, unsigned to) noexcept
+Queue::SwapPositions(unsigned position1, unsigned position2) noexcept
 {
-	const auto tmp = std::make_unique<Item[]>(end - start);
+	/* exchange the payload and leave the tree structure alone;
+	   this keeps the order numbers attached to the positions */
 
-	// Copy the original block [start,end-1]
-	for (unsigned i = start; i < end; i++)
-		tmp[i - start] = items[i];
+	Node &node1 = items.Select(position1);
+	Node &node2 = items.Select(position2);
 
-	// If to > start, we need to move to-start items to start, starting from end
-	for (unsigned i = end; i < end + to - start; i++)
-		MoveItemTo(i, start + i - end);
+	std::swap(static_cast<Item &>(node1), static_cast<Item &>(node2));
 
-	// If to < start, we need to move start-to items to newend (= end + to - start), starting from to
-	// This is the same as moving items from start-1 to to (decreasing), with start-1 going to end-1
-	// We have to iterate in this order to avoid writing over something we haven't yet moved
-	for (int i = start - 1; i >= int(to); i--)
-		MoveItemTo(i, i + end - start);
+	Modify(node1, position1);
+	Modify(node2, position2);
 
-	// Copy the original block back in, starting at to.
-	for (unsigned i = start; i< end; i++)
-	{
-		id_table.Move(tmp[i - start].id, to + i - start);
-		items[to + i - start] = tmp[i-start];
-		items[to + i - start].version = version;
-	}
+	id_table.Move(node1.id, node1);
+	id_table.Move(node2.id, node2);
+}
 
-	if (random) {
-		// Update the positions in the queue.
-		// Note that the ranges for these cases are the same as the ranges of
-		// the loops above.
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] >= end && order[i] < to + end - start)
-				order[i] -= end - start;
-			else if (order[i] < start &&
-				 order[i] >= to)
-				order[i] += end - start;
-			else if (start <= order[i] && order[i] < end)
-				order[i] += to - start;
-		}
-	}
+void
+Queue::MovePostion(unsigned from, unsigned to) noexcept
+{
+	MoveRange(from, from + 1, to);
+}
+
+void
+Queue::MoveRange(unsigned start, unsigned end, unsigned to) noexcept
+{
+	assert(start <= end);
+	assert(end <= length);
+	assert(to + (end - start) <= length);
+
+	items.MoveRange(start, end, to);
+
+	if (!random)
+		/* order numbers equal positions, and that must
+		   remain so */
+		order.MoveRange(start, end, to);
+
+	/* all items between the old and the new location of the
+	   range have got a new position */
+	ModifyRange(std::min(start, to), std::max(end, to + (end - start)));
 }
 
 unsigned
 Queue::MoveOrder(unsigned from_order, unsigned to_order) noexcept
 {
 	assert(from_order < length);
-	assert(to_order <= length);
+	assert(to_order < length);
 
-	const unsigned from_position = OrderToPosition(from_order);
-
-	if (from_order < to_order) {
-		for (unsigned i = from_order; i < to_order; ++i)
-			order[i] = order[i + 1];
-	} else {
-		for (unsigned i = from_order; i > to_order; --i)
-			order[i] = order[i - 1];
-	}
-
-	order[to_order] = from_position;
+	order.MoveRange(from_order, from_order + 1, to_order);
 	return to_order;
 }
 
@@ -246,65 +333,68 @@ Queue::DeletePosition(unsigned position) noexcept
 {
 	assert(position < length);
 
-	delete items[position].song;
+	Node &node = items.Select(position);
 
-	const unsigned id = PositionToId(position);
-	const unsigned _order = PositionToOrder(position);
-
-	--length;
+	items.Erase(node);
+	order.Erase(node);
 
 	/* release the song id */
 
-	id_table.Erase(id);
+	id_table.Erase(node.id);
+
+	tag_index.Invalidate(node.song->GetTag());
+
+	delete node.song;
+	delete &node;
 
-	/* delete song from songs array */
+	--length;
+
+	/* all following items have moved one position ahead */
 
-	for (unsigned i = position; i < length; i++)
-		MoveItemTo(i + 1, i);
+	ModifyRange(position, length);
 
-	/* delete the entry from the order array */
+	CheckTagIndex();
+}
 
-	for (unsigned i = _order; i < length; i++)
-		order[i] = order[i + 1];
+static void
+DeleteSubtree(Queue::Node *node,
+	      IdTable<Queue::Node> &id_table) noexcept
+{
+	if (node == nullptr)
+		return;
 
-	/* readjust values in the order array */
+	DeleteSubtree(Queue::ItemTree::GetLeft(*node), id_table);
+	DeleteSubtree(Queue::ItemTree::GetRight(*node), id_table);
 
-	for (unsigned i = 0; i < length; i++)
-		if (order[i] > position)
-			--order[i];
+	id_table.Erase(node->id);
+	delete node->song;
+	delete node;
 }
 
 void
 Queue::Clear() noexcept
 {
-	for (unsigned i = 0; i < length; i++) {
-		Item *item = &items[i];
+	DeleteSubtree(items.GetRoot(), id_table);
 
-		delete item->song;
-
-		id_table.Erase(item->id);
-	}
+	items.clear();
+	order.clear();
+	tag_index.Clear();
 
 	length = 0;
+	zero_version_end = 0;
 }
 
-static void
-queue_sort_order_by_priority(Queue *queue,
-			     unsigned start, unsigned end) noexcept
+void
+Queue::RestoreOrder() noexcept
 {
-	assert(queue != nullptr);
-	assert(queue->random);
-	assert(start <= end);
-	assert(end <= queue->length);
-
-	auto cmp = [queue](unsigned a_pos, unsigned b_pos){
-		const Queue::Item &a = queue->items[a_pos];
-		const Queue::Item &b = queue->items[b_pos];
+	std::vector<Node *> nodes;
+	nodes.reserve(length);
 
-		return a.priority > b.priority;
-	};
+	for (Node *node = items.First(); node != nullptr;
+	     node = ItemTree::Next(*node))
+		nodes.push_back(node);
 
-	std::stable_sort(queue->order + start, queue->order + end, cmp);
+	order.Assign(nodes.data(), nodes.data() + nodes.size());
 }
 
 void
@@ -315,7 +405,9 @@ Queue::ShuffleOrderRange(unsigned start, unsigned end) noexcept
 	assert(end <= length);
 
 	rand.AutoCreate();
-	std::shuffle(order + start, order + end, rand);
+	order.ReorderRange(start, end, [this](std::vector<Node *> &nodes){
+		std::shuffle(nodes.begin(), nodes.end(), rand);
+	});
 }
 
 /**
@@ -332,28 +424,27 @@ Queue::ShuffleOrderRangeWithPriority(unsigned start, unsigned end) noexcept
 	if (start == end)
 		return;
 
-	/* first group the range by priority */
-	queue_sort_order_by_priority(this, start, end);
-
-	/* now shuffle each priority group */
-	unsigned group_start = start;
-	uint8_t group_priority = GetOrderPriority(start);
-
-	for (unsigned i = start + 1; i < end; ++i) {
-		const uint8_t priority = GetOrderPriority(i);
-		assert(priority <= group_priority);
-
-		if (priority != group_priority) {
-			/* start of a new group - shuffle the one that
-			   has just ended */
-			ShuffleOrderRange(group_start, i);
-			group_start = i;
-			group_priority = priority;
+	rand.AutoCreate();
+	order.ReorderRange(start, end, [this](std::vector<Node *> &nodes){
+		/* first group the range by priority */
+		std::stable_sort(nodes.begin(), nodes.end(),
+				 [](const Node *a, const Node *b){
+					 return a->priority > b->priority;
+				 });
+
+		/* now shuffle each priority group */
+		for (auto group = nodes.begin(); group != nodes.end();) {
+			const uint8_t priority = (*group)->priority;
+			const auto group_end =
+				std::find_if(group, nodes.end(),
+					     [priority](const Node *n){
+						     return n->priority != priority;
+					     });
+
+			std::shuffle(group, group_end, rand);
+			group = group_end;
 		}
-	}
-
-	/* shuffle the last group */
-	ShuffleOrderRange(group_start, end);
+	});
 }
 
 void
@@ -380,10 +471,12 @@ Queue::ShuffleOrderLastWithPriority(unsigned start, unsigned end) noexcept
 	/* skip all items at the start which have a higher priority,
 	   because the last item shall only be shuffled within its
 	   priority group */
-	const auto last_priority = items[OrderToPosition(end - 1)].priority;
-	while (items[OrderToPosition(start)].priority != last_priority) {
+	const auto last_priority = GetOrderPriority(end - 1);
+	const Node *node = &order.Select(start);
+	while (node->priority != last_priority) {
 		++start;
 		assert(start < end);
+		node = OrderTree::Next(*node);
 	}
 
 	rand.AutoCreate();
@@ -398,14 +491,32 @@ Queue::ShuffleRange(unsigned start, unsigned end) noexcept
 	assert(start <= end);
 	assert(end <= length);
 
+	if (end - start < 2)
+		return;
+
+	std::vector<Node *> nodes;
+	nodes.reserve(end - start);
+
+	for (Node *node = &items.Select(start); nodes.size() < end - start;
+	     node = ItemTree::Next(*node))
+		nodes.push_back(node);
+
 	rand.AutoCreate();
 
-	for (unsigned i = start; i < end; i++) {
-		std::uniform_int_distribution<unsigned> distribution(start,
-								     end - 1);
-		unsigned ri = distribution(rand);
-		SwapPositions(i, ri);
+	/* Fisher-Yates: exchange the payload and leave the tree
+	   structure alone, just like SwapPositions() */
+	for (std::size_t i = nodes.size() - 1; i > 0; --i) {
+		std::uniform_int_distribution<std::size_t> distribution(0, i);
+		const std::size_t j = distribution(rand);
+		if (j != i)
+			std::swap(static_cast<Item &>(*nodes[i]),
+				  static_cast<Item &>(*nodes[j]));
 	}
+
+	for (Node *node : nodes)
+		id_table.Move(node->id, *node);
+
+	ModifyRange(start, end);
 }
 
 unsigned
@@ -415,12 +526,14 @@ Queue::FindPriorityOrder(unsigned start_order, uint8_t priority,
 	assert(random);
 	assert(start_order <= length);
 
-	for (unsigned i = start_order; i < length; ++i) {
-		const unsigned position = OrderToPosition(i);
-		const Item *item = &items[position];
-		if (item->priority <= priority && i != exclude_order)
+	if (start_order == length)
+		return length;
+
+	unsigned i = start_order;
+	for (const Node *node = &order.Select(i); node != nullptr;
+	     node = OrderTree::Next(*node), ++i)
+		if (node->priority <= priority && i != exclude_order)
 			return i;
-	}
 
 	return length;
 }
@@ -431,12 +544,14 @@ Queue::CountSamePriority(unsigned start_order, uint8_t priority) const noexcept
 	assert(random);
 	assert(start_order <= length);
 
-	for (unsigned i = start_order; i < length; ++i) {
-		const unsigned position = OrderToPosition(i);
-		const Item *item = &items[position];
-		if (item->priority != priority)
+	if (start_order == length)
+		return 0;
+
+	unsigned i = start_order;
+	for (const Node *node = &order.Select(i); node != nullptr;
+	     node = OrderTree::Next(*node), ++i)
+		if (node->priority != priority)
 			return i - start_order;
-	}
 
 	return length - start_order;
 }
@@ -447,19 +562,19 @@ Queue::SetPriority(unsigned position, uint8_t priority, int after_order,
 {
 	assert(position < length);
 
-	Item *item = &items[position];
-	uint8_t old_priority = item->priority;
+	Node &node = items.Select(position);
+	uint8_t old_priority = node.priority;
 	if (old_priority == priority)
 		return false;
 
-	item->version = version;
-	item->priority = priority;
+	node.priority = priority;
+	Modify(node, position);
 
 	if (!random || !reorder)
 		/* don't reorder if not in random mode */
 		return true;
 
-	unsigned _order = PositionToOrder(position);
+	unsigned _order = OrderTree::Rank(node);
 	if (after_order >= 0) {
 		if (_order == (unsigned)after_order)
 			/* don't reorder the current song */
@@ -471,12 +586,8 @@ Queue::SetPriority(unsigned position, uint8_t priority, int after_order,
 			   increased and is now bigger than the
 			   current one's */
 
-			const unsigned after_position =
-				OrderToPosition(after_order);
-			const Item *after_item =
-				&items[after_position];
 			if (priority <= old_priority ||
-			    priority <= after_item->priority)
+			    priority <= GetOrderPriority(after_order))
 				/* priority hasn't become bigger */
 				return true;
 		}
@@ -22,13 +22,18 @@
 
 #include "util/Compiler.h"
 #include "IdTable.hxx"
+#include "RankTree.hxx"
+#include "TagIndex.hxx"
 #include "SingleMode.hxx"
 #include "ConsumeMode.hxx"
 #include "util/LazyRandomEngine.hxx"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <utility>
+#include <vector>
 
 struct LightSong;
 class DetachedSong;
@@ -42,10 +47,15 @@ class DetachedSong;
  * - the position in the queue
  * - the unique id (which stays the same, regardless of moves)
  * - the order number (which only differs from "position" in random mode)
+ *
+ * The items are stored in two order-statistics trees (one sorted by
+ * position, one by order number), which makes looking up a position
+ * or an order number O(log n), but also inserting, deleting and
+ * moving items anywhere in the queue.
  */
 struct Queue {
 	/**
-	 * reserve max_length * HASH_MULT elements in the id
+	 * allow up to max_length * HASH_MULT elements in the id
 	 * number space
 	 */
 	static constexpr unsigned HASH_MULT = 4;
@@ -60,7 +70,13 @@ struct Queue {
 		/** the unique id of this item in the queue */
 		unsigned id;
 
-		/** when was this item last changed? */
+		/**
+		 * When was this item last changed?  This may be
+		 * superseded by Node::range_version of the item
+		 * itself or one of its ancestors in #items; use
+		 * GetVersionAtPosition() to determine the effective
+		 * version.
+		 */
 		uint32_t version;
 
 		/**
@@ -71,6 +87,63 @@ struct Queue {
 		uint8_t priority;
 	};
 
+	/**
+	 * An #Item which is linked into the trees #items and
+	 * #order.
+	 */
+	struct Node : Item {
+		RankTreeLinks<Node> position_links, order_links;
+
+		/**
+		 * A version number which applies to all items in the
+		 * subtree of #items rooted at this node (including this
+		 * one) whose own version is older; 0 if there is none.
+		 * This allows marking a range of items as modified in
+		 * O(log n); it is pushed down to the children lazily
+		 * whenever the tree is restructured.
+		 */
+		uint32_t range_version = 0;
+	};
+
+	struct PositionTraits {
+		static auto &GetLinks(Node &node) noexcept {
+			return node.position_links;
+		}
+
+		static const auto &GetLinks(const Node &node) noexcept {
+			return node.position_links;
+		}
+
+		static void PushDown(Node &node) noexcept {
+			const uint32_t v = std::exchange(node.range_version, 0);
+			if (v == 0)
+				return;
+
+			node.version = std::max(node.version, v);
+
+			for (Node *child : {node.position_links.left,
+					    node.position_links.right})
+				if (child != nullptr)
+					child->range_version =
+						std::max(child->range_version, v);
+		}
+	};
+
+	struct OrderTraits {
+		static auto &GetLinks(Node &node) noexcept {
+			return node.order_links;
+		}
+
+		static const auto &GetLinks(const Node &node) noexcept {
+			return node.order_links;
+		}
+
+		static void PushDown(Node &) noexcept {}
+	};
+
+	using ItemTree = RankTree<Node, PositionTraits>;
+	using OrderTree = RankTree<Node, OrderTraits>;
+
 	/** configured maximum length of the queue */
 	const unsigned max_length;
 
@@ -80,14 +153,56 @@ struct Queue {
 	/** the current version number */
 	uint32_t version = 1;
 
+	/**
+	 * A range of positions which was modified in one version.
+	 */
+	struct JournalRecord {
+		uint32_t version;
+
+		unsigned start, end;
+	};
+
+	static constexpr unsigned JOURNAL_SIZE = 64;
+
+	/**
+	 * A ring buffer of the position ranges modified in the most
+	 * recent versions.  It allows finding changed items without
+	 * scanning the whole queue; see GetChangedRanges().
+	 */
+	std::array<JournalRecord, JOURNAL_SIZE> journal;
+
+	unsigned journal_head = 0, journal_size = 0;
+
+	/**
+	 * Modifications of all versions starting with this one are
+	 * recorded in the #journal.
+	 */
+	uint32_t journal_min_version = 1;
+
+	/**
+	 * After a version number overflow, all items below this
+	 * position may have the version 0 (which means "always
+	 * modified"); see IncrementVersion().
+	 */
+	unsigned zero_version_end = 0;
+
 	/** all songs in "position" order */
-	Item *const items;
+	ItemTree items;
+
+	/**
+	 * All songs in "order" order.  Unless in random mode, this
+	 * is the same as #items.
+	 */
+	OrderTree order;
 
-	/** map order numbers to positions */
-	unsigned *const order;
+	/** map song ids to items */
+	IdTable<Node> id_table;
 
-	/** map song ids to positions */
-	IdTable id_table;
+	/**
+	 * Maps tag values to song ids; see
+	 * QueueSelection::FindPositions().
+	 */
+	QueueTagIndex tag_index;
 
 	/** repeat playback when the end of the queue has been
 	    reached? */
@@ -117,6 +232,14 @@ struct Queue {
 		return length;
 	}
 
+	/**
+	 * Estimate the memory (in bytes) allocated by this queue,
+	 * including its songs, but not counting tag data which is
+	 * shared with other objects (e.g. with the database).
+	 */
+	[[gnu::pure]]
+	std::size_t GetMemoryUsage() const noexcept;
+
 	/**
 	 * Determine if the queue is empty, i.e. there are no songs.
 	 */
@@ -147,46 +270,46 @@ struct Queue {
 		return _order < length;
 	}
 
+	gcc_pure
 	int IdToPosition(unsigned id) const noexcept {
-		return id_table.IdToPosition(id);
+		const Node *node = id_table.Lookup(id);
+		return node != nullptr
+			? int(ItemTree::Rank(*node))
+			: -1;
 	}
 
+	gcc_pure
 	int PositionToId(unsigned position) const noexcept {
 		assert(position < length);
 
-		return items[position].id;
+		return items.Select(position).id;
 	}
 
 	gcc_pure
 	unsigned OrderToPosition(unsigned _order) const noexcept {
 		assert(_order < length);
 
-		return order[_order];
+		return ItemTree::Rank(order.Select(_order));
 	}
 
 	gcc_pure
 	unsigned PositionToOrder(unsigned position) const noexcept {
 		assert(position < length);
 
-		for (unsigned i = 0;; ++i) {
-			assert(i < length);
-
-			if (order[i] == position)
-				return i;
-		}
+		return OrderTree::Rank(items.Select(position));
 	}
 
 	gcc_pure
 	uint8_t GetPriorityAtPosition(unsigned position) const noexcept {
 		assert(position < length);
 
-		return items[position].priority;
+		return items.Select(position).priority;
 	}
 
 	const Item &GetOrderItem(unsigned i) const noexcept {
 		assert(IsValidOrder(i));
 
-		return items[OrderToPosition(i)];
+		return order.Select(i);
 	}
 
 	uint8_t GetOrderPriority(unsigned i) const noexcept {
@@ -199,7 +322,7 @@ struct Queue {
 	DetachedSong &Get(unsigned position) const noexcept {
 		assert(position < length);
 
-		return *items[position].song;
+		return *items.Select(position).song;
 	}
 
 	/**
@@ -211,7 +334,22 @@ struct Queue {
 	 * Returns the song at the specified order number.
 	 */
 	DetachedSong &GetOrder(unsigned _order) const noexcept {
-		return Get(OrderToPosition(_order));
+		return *GetOrderItem(_order).song;
+	}
+
+	/**
+	 * Invoke the given function for each item in position order,
+	 * passing the position and the #Item.  This is cheaper than
+	 * looking up each position.  The function may modify the
+	 * item (e.g. with ModifyAtPosition()), but must not add,
+	 * remove or move items.
+	 */
+	template<typename F>
+	void ForEachItem(F &&f) const {
+		unsigned position = 0;
+		for (const Node *node = items.First(); node != nullptr;
+		     node = ItemTree::Next(*node))
+			f(position++, static_cast<const Item &>(*node));
 	}
 
 	/**
@@ -222,11 +360,20 @@ struct Queue {
 			       uint32_t _version) const noexcept {
 		assert(position < length);
 
-		return _version > version ||
-			items[position].version >= _version ||
-			items[position].version == 0;
+		if (_version > version)
+			return true;
+
+		const uint32_t item_version = GetVersionAtPosition(position);
+		return item_version >= _version || item_version == 0;
 	}
 
+	/**
+	 * Determine the version of the item at the specified
+	 * position, i.e. when it was last modified.
+	 */
+	gcc_pure
+	uint32_t GetVersionAtPosition(unsigned position) const noexcept;
+
 	/**
 	 * Returns the order number following the specified one.  This takes
 	 * end of queue and "repeat" mode into account.
@@ -246,11 +393,53 @@ struct Queue {
 	 * Marks the specified song as "modified".  Call
 	 * IncrementVersion() after all modifications have been made.
 	 * number.
+	 *
+	 * This must be called after the song's tag has been
+	 * modified, to update the tag index.
 	 */
-	void ModifyAtPosition(unsigned position) noexcept {
-		assert(position < length);
+	void ModifyAtPosition(unsigned position) noexcept;
+
+	using PositionRange = std::pair<unsigned, unsigned>;
+
+	/**
+	 * Determine the ranges of positions which may contain items
+	 * newer than the specified version (i.e. all positions for
+	 * which IsNewerAtPosition() may return true), sorted and
+	 * without overlaps.
+	 *
+	 * @return false if the journal does not reach back far enough;
+	 * in that case, the caller must check all positions
+	 */
+	bool GetChangedRanges(uint32_t since,
+			      std::vector<PositionRange> &ranges) const noexcept;
+
+	/**
+	 * Invoke the given function for each position in the range
+	 * which is newer than the specified version.  The #journal
+	 * is used to skip unmodified ranges.
+	 */
+	template<typename F>
+	void ForEachChange(uint32_t since, unsigned start, unsigned end,
+			   F &&f) const {
+		assert(start <= end);
+		assert(end <= length);
+
+		std::vector<PositionRange> ranges;
+		if (!GetChangedRanges(since, ranges)) {
+			/* the journal doesn't reach back that far:
+			   check all items */
+			ranges.clear();
+			ranges.emplace_back(start, end);
+		}
 
-		items[position].version = version;
+		for (auto [range_start, range_end] : ranges) {
+			range_start = std::max(range_start, start);
+			range_end = std::min(range_end, end);
+
+			for (unsigned i = range_start; i < range_end; i++)
+				if (IsNewerAtPosition(i, since))
+					f(i);
+		}
 	}
 
 	/**
@@ -281,7 +470,7 @@ struct Queue {
 	 * Swaps two songs, addressed by their order number.
 	 */
 	void SwapOrders(unsigned order1, unsigned order2) noexcept {
-		std::swap(order[order1], order[order2]);
+		order.Swap(order1, order2);
 	}
 
 	/**
@@ -330,12 +519,10 @@ struct Queue {
 	void Clear() noexcept;
 
 	/**
-	 * Initializes the "order" array, and restores "normal" order.
+	 * Restores "normal" order, i.e. order numbers equal
+	 * positions.
 	 */
-	void RestoreOrder() noexcept {
-		for (unsigned i = 0; i < length; ++i)
-			order[i] = i;
-	}
+	void RestoreOrder() noexcept;
 
 	/**
 	 * Shuffle the order of items in the specified range, ignoring
@@ -369,6 +556,10 @@ struct Queue {
 	/**
 	 * Shuffles a (position) range in the queue.  The songs are physically
 	 * shuffled, not by using the "order" mapping.
+	 *
+	 * This walks the range once and marks it as modified with one
+	 * ModifyRange() call, so it is O(n) instead of doing
+	 * O(log n) lookups for each item.
 	 */
 	void ShuffleRange(unsigned start, unsigned end) noexcept;
 
@@ -379,14 +570,37 @@ struct Queue {
 			      uint8_t priority, int after_order) noexcept;
 
 private:
-	void MoveItemTo(unsigned from, unsigned to) noexcept {
-		unsigned from_id = items[from].id;
+	/**
+	 * Record a modification of the specified range of positions
+	 * in the #journal.
+	 */
+	void AddJournal(unsigned start, unsigned end) noexcept;
 
-		items[to] = items[from];
-		items[to].version = version;
-		id_table.Move(from_id, to);
+	/**
+	 * Marks the specified item as "modified".
+	 */
+	void Modify(Node &node, unsigned position) noexcept {
+		node.version = version;
+		AddJournal(position, position + 1);
 	}
 
+	/**
+	 * Marks all items in the specified range of positions as
+	 * "modified".
+	 */
+	void ModifyRange(unsigned start, unsigned end) noexcept;
+
+	/**
+	 * The song of the specified item may have been modified:
+	 * add its new tag values to #tag_index.
+	 */
+	void UpdateTagIndex(const Node &node) noexcept;
+
+	/**
+	 * Rebuild #tag_index if it contains too many stale entries.
+	 */
+	void CheckTagIndex() noexcept;
+
 	/**
 	 * Find the first item that has this specified priority or
 	 * higher.
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_QUEUE_RANK_TREE_HXX
+#define MPD_QUEUE_RANK_TREE_HXX
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * The links of a node in a #RankTree.  A node may be a member of
+ * several trees at the same time by embedding several instances of
+ * this struct.
+ */
+template<typename Node>
+struct RankTreeLinks {
+	Node *left = nullptr, *right = nullptr, *parent = nullptr;
+
+	/**
+	 * The number of nodes in the subtree rooted at this node,
+	 * including this one.
+	 */
+	unsigned size = 1;
+};
+
+/**
+ * An intrusive sequence container implemented as an
+ * order-statistics tree: nodes are addressed by their index (rank),
+ * and all operations including insertion, removal and moving a
+ * range of nodes to another index run in O(log n).
+ *
+ * The tree is a randomized binary search tree (Martínez and Roura)
+ * keyed by the implicit index; it is kept balanced by randomizing
+ * each join, therefore nodes do not need a priority.
+ *
+ * The #Traits class provides:
+ *
+ * - `static RankTreeLinks<Node> &GetLinks(Node &)` (and a `const`
+ *   overload)
+ *
+ * - `static void PushDown(Node &)`, which is called before the
+ *   children of a node are modified; it allows a node to carry lazy
+ *   updates which apply to its whole subtree
+ */
+template<typename Node, typename Traits>
+class RankTree {
+	using Links = RankTreeLinks<Node>;
+
+	Node *root = nullptr;
+
+	/**
+	 * State of the pseudo random number generator (xorshift32)
+	 * used by Join().
+	 */
+	uint_least32_t random_state = 0x9e3779b9;
+
+public:
+	RankTree() noexcept = default;
+
+	RankTree(const RankTree &) = delete;
+	RankTree &operator=(const RankTree &) = delete;
+
+	bool empty() const noexcept {
+		return root == nullptr;
+	}
+
+	unsigned size() const noexcept {
+		return Size(root);
+	}
+
+	Node *GetRoot() const noexcept {
+		return root;
+	}
+
+	static Node *GetLeft(const Node &node) noexcept {
+		return Traits::GetLinks(node).left;
+	}
+
+	static Node *GetRight(const Node &node) noexcept {
+		return Traits::GetLinks(node).right;
+	}
+
+	/**
+	 * Forget all nodes without touching them.
+	 */
+	void clear() noexcept {
+		root = nullptr;
+	}
+
+	/**
+	 * Returns the node with the given index.
+	 */
+	[[gnu::pure]]
+	Node &Select(unsigned i) const noexcept {
+		assert(i < size());
+
+		Node *node = root;
+		while (true) {
+			const auto &links = Traits::GetLinks(*node);
+			const unsigned left_size = Size(links.left);
+			if (i < left_size) {
+				node = links.left;
+			} else if (i == left_size) {
+				return *node;
+			} else {
+				i -= left_size + 1;
+				node = links.right;
+			}
+		}
+	}
+
+	/**
+	 * Returns the index of the given node, which must be a member
+	 * of this tree.
+	 */
+	[[gnu::pure]]
+	static unsigned Rank(const Node &node) noexcept {
+		unsigned i = Size(Traits::GetLinks(node).left);
+
+		for (const Node *n = &node, *p;
+		     (p = Traits::GetLinks(*n).parent) != nullptr; n = p)
+			if (Traits::GetLinks(*p).right == n)
+				i += Size(Traits::GetLinks(*p).left) + 1;
+
+		return i;
+	}
+
+	/**
+	 * Returns the first node (index 0) or nullptr if the tree is
+	 * empty.
+	 */
+	[[gnu::pure]]
+	Node *First() const noexcept {
+		return root != nullptr ? &Leftmost(*root) : nullptr;
+	}
+
+	/**
+	 * Returns the node following the given one, or nullptr if
+	 * this is the last one.
+	 */
+	[[gnu::pure]]
+	static Node *Next(const Node &node) noexcept {
+		const auto &links = Traits::GetLinks(node);
+		if (links.right != nullptr)
+			return &Leftmost(*links.right);
+
+		const Node *n = &node;
+		Node *p = links.parent;
+		while (p != nullptr && Traits::GetLinks(*p).right == n) {
+			n = p;
+			p = Traits::GetLinks(*p).parent;
+		}
+
+		return p;
+	}
+
+	/**
+	 * Insert a node so that it gets the given index.
+	 */
+	void Insert(unsigned i, Node &node) noexcept {
+		assert(i <= size());
+
+		ResetLinks(node);
+		auto [a, b] = Split(root, i);
+		SetRoot(Join(Join(a, &node), b));
+	}
+
+	void push_back(Node &node) noexcept {
+		ResetLinks(node);
+		SetRoot(Join(root, &node));
+	}
+
+	/**
+	 * Remove the given node from this tree.
+	 */
+	void Erase(Node &node) noexcept {
+		const unsigned i = Rank(node);
+		auto [a, bc] = Split(root, i);
+		auto [b, c] = Split(bc, 1);
+		assert(b == &node);
+		(void)b;
+		SetRoot(Join(a, c));
+	}
+
+	/**
+	 * Move the nodes [start, end) so that the first of them gets
+	 * the index "to".
+	 */
+	void MoveRange(unsigned start, unsigned end, unsigned to) noexcept {
+		assert(start <= end);
+		assert(end <= size());
+		assert(to + (end - start) <= size());
+
+		auto [a, bc] = Split(root, start);
+		auto [b, c] = Split(bc, end - start);
+		auto [d, e] = Split(Join(a, c), to);
+		SetRoot(Join(Join(d, b), e));
+	}
+
+	/**
+	 * Exchange the nodes at the two given indexes.
+	 */
+	void Swap(unsigned i, unsigned j) noexcept {
+		assert(i < size());
+		assert(j < size());
+
+		if (i == j)
+			return;
+
+		if (i > j)
+			std::swap(i, j);
+
+		auto [a, rest1] = Split(root, i);
+		auto [x, rest2] = Split(rest1, 1);
+		auto [b, rest3] = Split(rest2, j - i - 1);
+		auto [y, c] = Split(rest3, 1);
+
+		SetRoot(Join(Join(Join(Join(a, y), b), x), c));
+	}
+
+	/**
+	 * Invoke a function on the root of a temporary tree which
+	 * contains exactly the nodes [start, end); this allows
+	 * applying lazy updates to a range.
+	 */
+	template<typename F>
+	void ApplyRange(unsigned start, unsigned end, F &&f) noexcept {
+		assert(start <= end);
+		assert(end <= size());
+
+		if (start == end)
+			return;
+
+		auto [a, bc] = Split(root, start);
+		auto [b, c] = Split(bc, end - start);
+		f(*b);
+		SetRoot(Join(Join(a, b), c));
+	}
+
+	/**
+	 * Copy pointers to the nodes [start, end) to a vector, let
+	 * the given function rearrange it, and replace the range with
+	 * the new sequence.  This costs O(k + log n) for k nodes.
+	 */
+	template<typename F>
+	void ReorderRange(unsigned start, unsigned end, F &&f) {
+		assert(start <= end);
+		assert(end <= size());
+
+		auto [a, bc] = Split(root, start);
+		auto [b, c] = Split(bc, end - start);
+
+		std::vector<Node *> nodes;
+		nodes.reserve(end - start);
+		Collect(b, nodes);
+
+		f(nodes);
+		assert(nodes.size() == end - start);
+
+		SetRoot(Join(Join(a, Build(nodes.data(),
+					    nodes.data() + nodes.size())),
+			     c));
+	}
+
+	/**
+	 * Replace the contents of this tree with the given sequence
+	 * of nodes.  This costs O(n).
+	 */
+	void Assign(Node *const*begin, Node *const*end) noexcept {
+		SetRoot(Build(begin, end));
+	}
+
+private:
+	static unsigned Size(const Node *node) noexcept {
+		return node != nullptr ? Traits::GetLinks(*node).size : 0;
+	}
+
+	static Node &Leftmost(const Node &node) noexcept {
+		Node *n = const_cast<Node *>(&node);
+		while (Traits::GetLinks(*n).left != nullptr)
+			n = Traits::GetLinks(*n).left;
+		return *n;
+	}
+
+	static void ResetLinks(Node &node) noexcept {
+		Traits::GetLinks(node) = {};
+	}
+
+	static void Update(Node &node) noexcept {
+		auto &links = Traits::GetLinks(node);
+		links.size = Size(links.left) + 1 + Size(links.right);
+	}
+
+	static void SetLeft(Node &node, Node *child) noexcept {
+		Traits::GetLinks(node).left = child;
+		if (child != nullptr)
+			Traits::GetLinks(*child).parent = &node;
+	}
+
+	static void SetRight(Node &node, Node *child) noexcept {
+		Traits::GetLinks(node).right = child;
+		if (child != nullptr)
+			Traits::GetLinks(*child).parent = &node;
+	}
+
+	void SetRoot(Node *node) noexcept {
+		root = node;
+		if (root != nullptr)
+			Traits::GetLinks(*root).parent = nullptr;
+	}
+
+	uint_least32_t NextRandom() noexcept {
+		auto x = random_state;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		return random_state = x;
+	}
+
+	/**
+	 * Split the given tree into the first #n nodes and the rest.
+	 * The parent pointers of the two returned roots are
+	 * undefined.
+	 */
+	static std::pair<Node *, Node *> Split(Node *node, unsigned n) noexcept {
+		if (node == nullptr)
+			return {nullptr, nullptr};
+
+		Traits::PushDown(*node);
+
+		auto &links = Traits::GetLinks(*node);
+		const unsigned left_size = Size(links.left);
+		if (n <= left_size) {
+			auto [a, b] = Split(links.left, n);
+			SetLeft(*node, b);
+			Update(*node);
+			return {a, node};
+		} else {
+			auto [a, b] = Split(links.right, n - left_size - 1);
+			SetRight(*node, a);
+			Update(*node);
+			return {node, b};
+		}
+	}
+
+	/**
+	 * Concatenate two trees.  The root is chosen randomly with a
+	 * probability proportional to the subtree sizes, which keeps
+	 * the tree a randomized binary search tree.
+	 */
+	Node *Join(Node *a, Node *b) noexcept {
+		if (a == nullptr)
+			return b;
+		if (b == nullptr)
+			return a;
+
+		const unsigned a_size = Size(a), b_size = Size(b);
+		if (NextRandom() % (a_size + b_size) < a_size) {
+			Traits::PushDown(*a);
+			SetRight(*a, Join(Traits::GetLinks(*a).right, b));
+			Update(*a);
+			return a;
+		} else {
+			Traits::PushDown(*b);
+			SetLeft(*b, Join(a, Traits::GetLinks(*b).left));
+			Update(*b);
+			return b;
+		}
+	}
+
+	static void Collect(Node *node, std::vector<Node *> &nodes) noexcept {
+		if (node == nullptr)
+			return;
+
+		Traits::PushDown(*node);
+
+		auto &links = Traits::GetLinks(*node);
+		Collect(links.left, nodes);
+		nodes.push_back(node);
+		Collect(links.right, nodes);
+	}
+
+	/**
+	 * Build a balanced tree from the given sequence.
+	 */
+	static Node *Build(Node *const*begin, Node *const*end) noexcept {
+		if (begin == end)
+			return nullptr;
+
+		Node *const*middle = begin + (end - begin) / 2;
+		Node &node = **middle;
+		ResetLinks(node);
+		SetLeft(node, Build(begin, middle));
+		SetRight(node, Build(middle + 1, end));
+		Update(node);
+		return &node;
+	}
+};
+
+#endif
@@ -34,8 +34,6 @@
 
 #include <stdlib.h>
 
-#define PRIO_LABEL "Prio: "
-
 static void
 queue_save_database_song(BufferedOutputStream &os,
 			 int idx, const DetachedSong &song)
@@ -63,16 +61,40 @@ queue_save_song(BufferedOutputStream &os, int idx, const DetachedSong &song)
 		queue_save_full_song(os, song);
 }
 
+static void
+queue_save_item(BufferedOutputStream &os, unsigned position,
+		const Queue::Item &item)
+{
+	if (item.priority != 0)
+		os.Fmt(FMT_STRING(PRIO_LABEL "{}\n"), item.priority);
+
+	queue_save_song(os, position, *item.song);
+}
+
+static void
+queue_save_item(BufferedOutputStream &os, const Queue &queue, unsigned i)
+{
+	queue_save_item(os, i, queue.items.Select(i));
+}
+
 void
 queue_save(BufferedOutputStream &os, const Queue &queue)
 {
-	for (unsigned i = 0; i < queue.GetLength(); i++) {
-		uint8_t prio = queue.GetPriorityAtPosition(i);
-		if (prio != 0)
-			os.Fmt(FMT_STRING(PRIO_LABEL "{}\n"), prio);
+	/* walk the tree sequentially instead of looking up each
+	   position */
+	queue.ForEachItem([&os](unsigned position, const Queue::Item &item){
+		queue_save_item(os, position, item);
+	});
+}
 
-		queue_save_song(os, i, queue.Get(i));
-	}
+void
+queue_save_delta(BufferedOutputStream &os, const Queue &queue,
+		 uint32_t since)
+{
+	queue.ForEachChange(since, 0, queue.GetLength(), [&](unsigned i){
+		os.Fmt(FMT_STRING(QUEUE_POSITION_LABEL "{}\n"), i);
+		queue_save_item(os, queue, i);
+	});
 }
 
 static DetachedSong
@@ -24,6 +24,15 @@
 
 #pragma once
 
+#include <cstdint>
+
+#define PRIO_LABEL "Prio: "
+
+/**
+ * Precedes each song in a queue delta (see queue_save_delta()).
+ */
+#define QUEUE_POSITION_LABEL "pos: "
+
 struct Queue;
 class BufferedOutputStream;
 class LineReader;
@@ -32,6 +41,16 @@ class SongLoader;
 void
 queue_save(BufferedOutputStream &os, const Queue &queue);
 
+/**
+ * Save only the songs which were modified since the given queue
+ * version, each preceded by a #QUEUE_POSITION_LABEL line with its
+ * position.  Together with the new queue length, this allows
+ * updating a copy saved earlier by queue_save().
+ */
+void
+queue_save_delta(BufferedOutputStream &os, const Queue &queue,
+		 uint32_t since);
+
 /**
  * Loads one song from the state file and appends it to the queue.
  *
@@ -22,6 +22,14 @@
 #include "song/DetachedSong.hxx"
 #include "song/Filter.hxx"
 #include "song/LightSong.hxx"
+#include "song/TagSongFilter.hxx"
+#include "tag/Fallback.hxx"
+#include "lib/icu/Canonicalize.hxx"
+#include "util/AllocatedString.hxx"
+
+#include <algorithm>
+#include <limits>
+#include <string>
 
 bool
 QueueSelection::MatchPosition(const Queue &queue,
@@ -35,3 +43,136 @@ QueueSelection::MatchPosition(const Queue &queue,
 
 	return true;
 }
+
+#ifdef HAVE_ICU_CANONICALIZE
+
+/**
+ * Convert a string to the form which is compared by case-insensitive
+ * filters (see IcuCompare).
+ */
+static std::string
+FoldCase(std::string_view src) noexcept
+{
+	const auto folded = IcuCanonicalize(src, true);
+	if (folded == nullptr)
+		return std::string{src};
+
+	return std::string{folded.c_str()};
+}
+
+#endif
+
+/**
+ * Can this filter be evaluated with Queue::tag_index?
+ */
+[[gnu::pure]]
+static bool
+IsIndexable(const TagSongFilter &f) noexcept
+{
+	if (!f.IsIndexable())
+		return false;
+
+#ifdef HAVE_ICU_CANONICALIZE
+	return true;
+#else
+	/* without ICU, the case-insensitive comparison is not
+	   based on a folded string which could be looked up */
+	return !f.GetFoldCase();
+#endif
+}
+
+/**
+ * Invoke the given function for each posting list which may contain
+ * songs matching the given filter.
+ */
+template<typename F>
+static void
+ForEachPostingList(const QueueTagIndex &index, const TagSongFilter &f,
+		   F &&func)
+{
+	const bool prefix = f.GetPosition() == StringFilter::Position::PREFIX;
+
+#ifdef HAVE_ICU_CANONICALIZE
+	if (f.GetFoldCase()) {
+		const auto value = FoldCase(f.GetValue());
+
+		ApplyTagWithFallback(f.GetTagType(), [&](TagType type){
+			index.ForEachFolded(type, value, prefix,
+					    FoldCase, func);
+			return false;
+		});
+
+		return;
+	}
+#endif
+
+	/* the filter falls back to other tags if the requested one
+	   is missing, so all of them need to be considered */
+	ApplyTagWithFallback(f.GetTagType(), [&](TagType type){
+		index.ForEach(type, f.GetValue(), prefix, func);
+		return false;
+	});
+}
+
+bool
+QueueSelection::FindPositions(const Queue &queue,
+			      std::vector<unsigned> &positions) const
+{
+	if (filter == nullptr)
+		return false;
+
+	/* find the most selective indexable filter item */
+	const TagSongFilter *best = nullptr;
+	std::size_t best_size = std::numeric_limits<std::size_t>::max();
+
+	for (const auto &i : filter->GetItems()) {
+		const auto *f = dynamic_cast<const TagSongFilter *>(i.get());
+		if (f == nullptr || !IsIndexable(*f))
+			continue;
+
+		std::size_t size = 0;
+		ForEachPostingList(queue.tag_index, *f,
+				   [&size](const auto &list){
+					   size += list.size();
+				   });
+
+		if (size < best_size) {
+			best = f;
+			best_size = size;
+		}
+	}
+
+	if (best == nullptr ||
+	    /* looking up all candidates in the queue would not be
+	       cheaper than a linear scan */
+	    best_size >= queue.GetLength())
+		return false;
+
+	positions.clear();
+	positions.reserve(best_size);
+
+	ForEachPostingList(queue.tag_index, *best, [&](const auto &list){
+		for (const unsigned id : list) {
+			/* the list may contain ids which have been
+			   removed meanwhile */
+			const int position = queue.IdToPosition(id);
+			if (position >= 0)
+				positions.push_back(position);
+		}
+	});
+
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()),
+			positions.end());
+
+	/* the candidates may be stale or match only one of the
+	   filter items, so verify them */
+	positions.erase(std::remove_if(positions.begin(), positions.end(),
+				       [this, &queue](unsigned position){
+					       return !MatchPosition(queue,
+								     position);
+				       }),
+			positions.end());
+
+	return true;
+}
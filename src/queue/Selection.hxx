@@ -22,6 +22,8 @@
 #include "protocol/RangeArg.hxx"
 #include "tag/Type.h"
 
+#include <vector>
+
 struct Queue;
 class SongFilter;
 
@@ -52,4 +54,16 @@ struct QueueSelection {
 	[[gnu::pure]]
 	bool MatchPosition(const Queue &queue,
 			   unsigned position) const noexcept;
+
+	/**
+	 * Determine the positions of all songs matching the #filter
+	 * in ascending order, using Queue::tag_index to find the
+	 * candidates instead of checking every song.
+	 *
+	 * @return false if the index cannot be used for this filter
+	 * (the caller shall then check each position with
+	 * MatchPosition())
+	 */
+	bool FindPositions(const Queue &queue,
+			   std::vector<unsigned> &positions) const;
 };
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagIndex.hxx"
+#include "tag/Tag.hxx"
+
+void
+QueueTagIndex::Clear() noexcept
+{
+	for (auto &i : tags)
+		i.clear();
+
+	for (auto &i : folded)
+		i.clear();
+
+	for (auto &i : unfolded)
+		i.clear();
+
+	n_entries = n_stale = 0;
+}
+
+void
+QueueTagIndex::Add(unsigned id, const Tag &tag) noexcept
+{
+	for (const auto &item : tag) {
+		auto &map = tags[item.type];
+		auto i = map.find(item.value);
+		if (i == map.end()) {
+			i = map.emplace(item.value, PostingList{}).first;
+			unfolded[item.type].push_back(&*i);
+		}
+
+		auto &list = i->second;
+
+		/* a song may have the same value multiple times */
+		if (list.empty() || list.back() != id) {
+			list.push_back(id);
+			++n_entries;
+		}
+	}
+}
+
+void
+QueueTagIndex::Invalidate(const Tag &tag) noexcept
+{
+	n_stale += tag.num_items;
+}
+
+std::size_t
+QueueTagIndex::GetMemoryUsage() const noexcept
+{
+	std::size_t result = n_entries * sizeof(unsigned);
+
+	for (const auto &map : tags)
+		for (const auto &[value, list] : map)
+			result += sizeof(value) + value.capacity() +
+				sizeof(list) + 4 * sizeof(void *);
+
+	for (const auto &map : folded)
+		result += map.size() * (sizeof(FoldedMap::value_type) +
+					4 * sizeof(void *));
+
+	return result;
+}
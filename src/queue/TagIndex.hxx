@@ -0,0 +1,164 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_QUEUE_TAG_INDEX_HXX
+#define MPD_QUEUE_TAG_INDEX_HXX
+
+#include "tag/Type.h"
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Tag;
+
+/**
+ * An inverted index mapping tag values to the ids of the songs in
+ * the #Queue which contain them.  It allows evaluating filters
+ * which compare a tag with a literal string (e.g. "playlistfind")
+ * without matching the filter against every song in the queue.
+ *
+ * The index is keyed by song id, which (unlike the position)
+ * survives moving songs around.  Removing or modifying a song only
+ * appends to the index and leaves stale entries behind, which is
+ * why lookups yield candidates only: the caller needs to check
+ * whether the id still exists and verify the song with the filter.
+ * The stale entries are counted, and the owner is expected to
+ * rebuild the index when IsFragmented() says so.
+ */
+class QueueTagIndex {
+	/**
+	 * A list of song ids in no particular order, which may
+	 * contain duplicates and ids which have been removed or
+	 * reused meanwhile.
+	 */
+	using PostingList = std::vector<unsigned>;
+
+	using ValueMap = std::map<std::string, PostingList, std::less<>>;
+
+	std::array<ValueMap, TAG_NUM_OF_ITEM_TYPES> tags;
+
+	/**
+	 * Maps the case-folded form of each key in #tags to its
+	 * posting list.  It is only built (by ForEachFolded()) when
+	 * the first case-insensitive lookup takes place.
+	 */
+	using FoldedMap = std::multimap<std::string, const PostingList *,
+					std::less<>>;
+
+	mutable std::array<FoldedMap, TAG_NUM_OF_ITEM_TYPES> folded;
+
+	/**
+	 * Keys of #tags which have not been added to #folded yet.
+	 */
+	mutable std::array<std::vector<const ValueMap::value_type *>,
+			   TAG_NUM_OF_ITEM_TYPES> unfolded;
+
+	/**
+	 * The total number of entries in all posting lists.
+	 */
+	std::size_t n_entries = 0;
+
+	/**
+	 * The (estimated) number of stale entries.
+	 */
+	std::size_t n_stale = 0;
+
+public:
+	void Clear() noexcept;
+
+	/**
+	 * Add all tag values of a song.
+	 */
+	void Add(unsigned id, const Tag &tag) noexcept;
+
+	/**
+	 * The entries of this song's tag values have become stale,
+	 * because the song was removed or its tag has been modified.
+	 */
+	void Invalidate(const Tag &tag) noexcept;
+
+	/**
+	 * Does the index consist mostly of stale entries, and shall
+	 * it be rebuilt?
+	 */
+	[[gnu::pure]]
+	bool IsFragmented() const noexcept {
+		return n_stale >= 1024 && n_stale * 2 >= n_entries;
+	}
+
+	[[gnu::pure]]
+	std::size_t GetMemoryUsage() const noexcept;
+
+	/**
+	 * Invoke the given function for each posting list whose
+	 * tag value equals (or starts with, if #prefix is set) the
+	 * given one.
+	 */
+	template<typename F>
+	void ForEach(TagType type, std::string_view value, bool prefix,
+		     F &&f) const {
+		const auto &map = tags[type];
+
+		if (prefix) {
+			for (auto i = map.lower_bound(value);
+			     i != map.end() && i->first.starts_with(value);
+			     ++i)
+				f(i->second);
+		} else {
+			auto i = map.find(value);
+			if (i != map.end())
+				f(i->second);
+		}
+	}
+
+	/**
+	 * Like ForEach(), but compare the case-folded forms of the
+	 * tag values.
+	 *
+	 * @param fold a function which converts a tag value to the
+	 * case-folded form; it must be the same in all calls
+	 * @param value the case-folded value to look for
+	 */
+	template<typename Fold, typename F>
+	void ForEachFolded(TagType type, std::string_view value, bool prefix,
+			   Fold &&fold, F &&f) const {
+		auto &map = folded[type];
+
+		for (const auto *i : unfolded[type])
+			map.emplace(fold(i->first), &i->second);
+		unfolded[type].clear();
+
+		if (prefix) {
+			for (auto i = map.lower_bound(value);
+			     i != map.end() && i->first.starts_with(value);
+			     ++i)
+				f(*i->second);
+		} else {
+			auto r = map.equal_range(value);
+			for (auto i = r.first; i != r.second; ++i)
+				f(*i->second);
+		}
+	}
+};
+
+#endif
@@ -77,3 +77,20 @@ DetachedSong::GetDuration() const noexcept
 
 	return {b - a};
 }
+
+static std::size_t
+GetStringMemoryUsage(const std::string &s) noexcept
+{
+	/* assume the "small string optimization" if the capacity
+	   fits into the object */
+	return s.capacity() < sizeof(s) ? 0 : s.capacity() + 1;
+}
+
+std::size_t
+DetachedSong::GetMemoryUsage() const noexcept
+{
+	return sizeof(*this) +
+		GetStringMemoryUsage(uri) +
+		GetStringMemoryUsage(real_uri) +
+		tag.GetExclusiveMemoryUsage();
+}
@@ -247,6 +247,14 @@ public:
 	[[gnu::pure]]
 	SignedSongTime GetDuration() const noexcept;
 
+	/**
+	 * Estimate the memory (in bytes) used by this object
+	 * exclusively, i.e. not counting tag data which is shared
+	 * with other objects (e.g. with the database).
+	 */
+	[[gnu::pure]]
+	std::size_t GetMemoryUsage() const noexcept;
+
 	const AudioFormat &GetAudioFormat() const noexcept {
 		return audio_format;
 	}
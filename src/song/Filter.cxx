@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "Filter.hxx"
+#include "OptimizeFilter.hxx"
 #include "NotSongFilter.hxx"
 #include "UriSongFilter.hxx"
 #include "BaseSongFilter.hxx"
@@ -26,6 +27,7 @@
 #include "ModifiedSinceSongFilter.hxx"
 #include "AudioFormatSongFilter.hxx"
 #include "PrioritySongFilter.hxx"
+#include "StickerSongFilter.hxx"
 #include "pcm/AudioParser.hxx"
 #include "tag/ParseName.hxx"
 #include "time/ISO8601.hxx"
@@ -53,6 +55,7 @@ enum {
 	LOCATE_TAG_MODIFIED_SINCE,
 	LOCATE_TAG_AUDIO_FORMAT,
 	LOCATE_TAG_PRIORITY,
+	LOCATE_TAG_STICKER,
 	LOCATE_TAG_FILE_TYPE,
 	LOCATE_TAG_ANY_TYPE,
 };
@@ -83,6 +86,9 @@ locate_parse_type(const char *str) noexcept
 	if (StringEqualsCaseASCII(str, "prio"))
 		return LOCATE_TAG_PRIORITY;
 
+	if (strcmp(str, "sticker") == 0)
+		return LOCATE_TAG_STICKER;
+
 	return tag_name_parse_i(str);
 }
 
@@ -385,6 +391,41 @@ SongFilter::ParseExpression(const char *&s, bool fold_case)
 		s = StripLeft(endptr + 1);
 
 		return std::make_unique<PrioritySongFilter>(value);
+	} else if (type == LOCATE_TAG_STICKER) {
+		const auto *source = GetStickerValueSource();
+		if (source == nullptr)
+			throw std::runtime_error("Sticker database is disabled");
+
+		auto name = ExpectQuoted(s);
+
+		auto op = StickerSongFilter::Operator::STRING;
+		if (s[0] == '<' || s[0] == '>') {
+			const bool equal = s[1] == '=';
+			op = s[0] == '<'
+				? (equal
+				   ? StickerSongFilter::Operator::LESS_EQUAL
+				   : StickerSongFilter::Operator::LESS)
+				: (equal
+				   ? StickerSongFilter::Operator::GREATER_EQUAL
+				   : StickerSongFilter::Operator::GREATER);
+			s = StripLeft(s + 1 + equal);
+		}
+
+		auto string_filter = op == StickerSongFilter::Operator::STRING
+			? ParseStringFilter(s, fold_case)
+			: StringFilter{
+				ExpectQuoted(s), false,
+				StringFilter::Position::FULL,
+				false,
+			};
+
+		if (*s != ')')
+			throw std::runtime_error("')' expected");
+		s = StripLeft(s + 1);
+
+		return std::make_unique<StickerSongFilter>(*source,
+							   std::move(name), op,
+							   std::move(string_filter));
 	} else {
 		auto string_filter = ParseStringFilter(s, fold_case);
 		if (*s != ')')
@@ -423,6 +464,9 @@ SongFilter::Parse(const char *tag_string, const char *value, bool fold_case)
 		and_filter.AddItem(std::make_unique<ModifiedSinceSongFilter>(ParseTimeStamp(value)));
 		break;
 
+	case LOCATE_TAG_STICKER:
+		throw std::runtime_error("Sticker filters require the expression syntax");
+
 	case LOCATE_TAG_FILE_TYPE:
 		/* for compatibility with MPD 0.20 and older,
 		   "fold_case" also switches on "substring" */
@@ -460,6 +504,10 @@ SongFilter::Parse(std::span<const char *const> args, bool fold_case)
 	if (args.empty())
 		throw std::runtime_error("Incorrect number of filter arguments");
 
+	/* the compiled program is outdated; Optimize() must be
+	   called again */
+	program.reset();
+
 	do {
 		if (*args.front() == '(') {
 			const char *s = args.front();
@@ -487,12 +535,15 @@ void
 SongFilter::Optimize() noexcept
 {
 	OptimizeSongFilter(and_filter);
+	program = CompileSongFilter(and_filter);
 }
 
 bool
 SongFilter::Match(const LightSong &song) const noexcept
 {
-	return and_filter.Match(song);
+	return program != nullptr
+		? program->Match(song)
+		: and_filter.Match(song);
 }
 
 bool
@@ -511,6 +562,32 @@ SongFilter::HasFoldCase() const noexcept
 		});
 }
 
+[[gnu::pure]]
+static bool
+HasSticker(const ISongFilter &f) noexcept
+{
+	if (dynamic_cast<const StickerSongFilter *>(&f) != nullptr)
+		return true;
+
+	if (auto *nf = dynamic_cast<const NotSongFilter *>(&f))
+		return HasSticker(nf->GetChild());
+
+	if (auto *af = dynamic_cast<const AndSongFilter *>(&f))
+		return std::any_of(af->GetItems().begin(),
+				   af->GetItems().end(),
+				   [](const auto &item) {
+					   return HasSticker(*item);
+				   });
+
+	return false;
+}
+
+bool
+SongFilter::HasSticker() const noexcept
+{
+	return ::HasSticker(and_filter);
+}
+
 bool
 SongFilter::HasOtherThanBase() const noexcept
 {
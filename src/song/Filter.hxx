@@ -37,12 +37,25 @@
  */
 #define SORT_TAG_PRIO (TAG_NUM_OF_ITEM_TYPES + 4)
 
+/**
+ * Special value for DatabaseSelection::sort: sort by the sticker
+ * named in DatabaseSelection::sort_sticker.
+ */
+#define SORT_TAG_STICKER (TAG_NUM_OF_ITEM_TYPES + 5)
+
 enum TagType : uint8_t;
 struct LightSong;
 
 class SongFilter {
 	AndSongFilter and_filter;
 
+	/**
+	 * A copy of #and_filter translated by CompileSongFilter(),
+	 * used by Match().  It is created by Optimize(); nullptr if
+	 * Optimize() has not been called yet.
+	 */
+	ISongFilterPtr program;
+
 public:
 	SongFilter() = default;
 
@@ -90,6 +103,14 @@ public:
 	[[gnu::pure]]
 	bool HasFoldCase() const noexcept;
 
+	/**
+	 * Is there at least one "sticker" item (possibly nested)?
+	 * Its result depends on the sticker database, not only on
+	 * the song database.
+	 */
+	[[gnu::pure]]
+	bool HasSticker() const noexcept;
+
 	/**
 	 * Does this filter contain constraints other than "base"?
 	 */
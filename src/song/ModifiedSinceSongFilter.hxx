@@ -31,6 +31,10 @@ public:
 	explicit ModifiedSinceSongFilter(std::chrono::system_clock::time_point _value) noexcept
 		:value(_value) {}
 
+	auto GetValue() const noexcept {
+		return value;
+	}
+
 	ISongFilterPtr Clone() const noexcept override {
 		return std::make_unique<ModifiedSinceSongFilter>(*this);
 	}
@@ -21,7 +21,17 @@
 #include "AndSongFilter.hxx"
 #include "NotSongFilter.hxx"
 #include "TagSongFilter.hxx"
+#include "TagGroupSongFilter.hxx"
 #include "UriSongFilter.hxx"
+#include "BaseSongFilter.hxx"
+#include "ModifiedSinceSongFilter.hxx"
+#include "PrioritySongFilter.hxx"
+#include "AudioFormatSongFilter.hxx"
+#include "StickerSongFilter.hxx"
+
+#include <algorithm>
+#include <map>
+#include <vector>
 
 void
 OptimizeSongFilter(AndSongFilter &af) noexcept
@@ -70,3 +80,136 @@ OptimizeSongFilter(ISongFilterPtr f) noexcept
 
 	return f;
 }
+
+/**
+ * Estimate the relative cost of evaluating the given #TagSongFilter.
+ */
+[[gnu::pure]]
+static unsigned
+EstimateCost(const TagSongFilter &f) noexcept
+{
+	if (f.IsRegex())
+		return 20;
+
+	unsigned cost = 5;
+
+	if (f.GetFoldCase())
+		++cost;
+
+	if (f.GetPosition() != StringFilter::Position::FULL)
+		/* substring and prefix matches are more expensive
+		   and less selective */
+		++cost;
+
+	if (f.IsNegated())
+		/* negated filters rarely reject a song */
+		++cost;
+
+	return cost;
+}
+
+/**
+ * Estimate the relative cost of evaluating the given filter.  Low
+ * values are evaluated first; this combines the CPU cost with a
+ * guess about how selective the filter is.
+ */
+[[gnu::pure]]
+static unsigned
+EstimateCost(const ISongFilter &f) noexcept
+{
+	if (dynamic_cast<const ModifiedSinceSongFilter *>(&f) != nullptr ||
+	    dynamic_cast<const PrioritySongFilter *>(&f) != nullptr)
+		/* a simple integer comparison */
+		return 1;
+
+	if (dynamic_cast<const AudioFormatSongFilter *>(&f) != nullptr)
+		return 2;
+
+	if (dynamic_cast<const BaseSongFilter *>(&f) != nullptr)
+		return 3;
+
+	if (auto *uf = dynamic_cast<const UriSongFilter *>(&f))
+		return uf->GetFoldCase() ? 5 : 4;
+
+	if (auto *tf = dynamic_cast<const TagSongFilter *>(&f))
+		return EstimateCost(*tf);
+
+	if (dynamic_cast<const StickerSongFilter *>(&f) != nullptr)
+		/* requires a sticker database query */
+		return 50;
+
+	if (auto *nf = dynamic_cast<const NotSongFilter *>(&f))
+		return 10 + EstimateCost(nf->GetChild());
+
+	if (auto *af = dynamic_cast<const AndSongFilter *>(&f)) {
+		unsigned cost = 10;
+		for (const auto &i : af->GetItems())
+			cost += EstimateCost(*i);
+		return cost;
+	}
+
+	return 10;
+}
+
+ISongFilterPtr
+CompileSongFilter(const AndSongFilter &af) noexcept
+{
+	struct Step {
+		ISongFilterPtr filter;
+		unsigned cost;
+	};
+
+	std::vector<Step> steps;
+
+	/* merge all #TagSongFilter items of the same tag type into
+	   one #TagGroupSongFilter; the map value is an index into
+	   "steps" */
+	std::map<TagType, std::size_t> groups;
+
+	/* first collect the tag filters sorted by their own cost, so
+	   the cheap ones come first within each group */
+	std::vector<const TagSongFilter *> tag_filters;
+
+	for (const auto &i : af.GetItems()) {
+		if (auto *tf = dynamic_cast<const TagSongFilter *>(i.get()))
+			tag_filters.push_back(tf);
+		else
+			steps.push_back({i->Clone(), EstimateCost(*i)});
+	}
+
+	std::stable_sort(tag_filters.begin(), tag_filters.end(),
+			 [](const auto *a, const auto *b){
+				 return EstimateCost(*a) < EstimateCost(*b);
+			 });
+
+	for (const auto *tf : tag_filters) {
+		auto g = groups.find(tf->GetTagType());
+		if (g != groups.end()) {
+			auto &step = steps[g->second];
+			auto &group = static_cast<TagGroupSongFilter &>(*step.filter);
+			if (!group.IsFull()) {
+				group.AddItem(*tf);
+				step.cost += EstimateCost(*tf);
+				continue;
+			}
+		}
+
+		auto group = std::make_unique<TagGroupSongFilter>();
+		group->AddItem(*tf);
+		groups.insert_or_assign(tf->GetTagType(), steps.size());
+		steps.push_back({std::move(group), EstimateCost(*tf)});
+	}
+
+	std::stable_sort(steps.begin(), steps.end(),
+			 [](const auto &a, const auto &b){
+				 return a.cost < b.cost;
+			 });
+
+	if (steps.size() == 1)
+		return std::move(steps.front().filter);
+
+	auto result = std::make_unique<AndSongFilter>();
+	for (auto &i : steps)
+		result->AddItem(std::move(i.filter));
+	return result;
+}
@@ -30,4 +30,17 @@ OptimizeSongFilter(AndSongFilter &af) noexcept;
 ISongFilterPtr
 OptimizeSongFilter(ISongFilterPtr f) noexcept;
 
+/**
+ * Translate an (optimized) #AndSongFilter into a "program" which is
+ * faster to evaluate: cheap and selective predicates are moved to the
+ * front so Match() can short-circuit early, and #TagSongFilter items
+ * operating on the same tag type are merged so the song's tag is
+ * scanned only once for them.
+ *
+ * The result is only meant to be passed to ISongFilter::Match(); it
+ * must not be introspected like the items of a #SongFilter.
+ */
+ISongFilterPtr
+CompileSongFilter(const AndSongFilter &af) noexcept;
+
 #endif
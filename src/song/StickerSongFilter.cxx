@@ -0,0 +1,135 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StickerSongFilter.hxx"
+#include "Escape.hxx"
+#include "LightSong.hxx"
+
+#include <atomic>
+
+#include <stdlib.h>
+#include <string.h>
+
+static std::atomic<const StickerValueSource *> sticker_value_source;
+
+void
+SetStickerValueSource(const StickerValueSource *source) noexcept
+{
+	sticker_value_source.store(source);
+}
+
+const StickerValueSource *
+GetStickerValueSource() noexcept
+{
+	return sticker_value_source.load();
+}
+
+/**
+ * Parse the whole string as a number.
+ *
+ * @return false if the string is not a number
+ */
+static bool
+ParseStickerNumber(const char *s, double &value_r) noexcept
+{
+	char *endptr;
+	value_r = strtod(s, &endptr);
+	return endptr > s && *endptr == 0;
+}
+
+int
+CompareStickerValues(const char *a, const char *b) noexcept
+{
+	double na, nb;
+	if (ParseStickerNumber(a, na) && ParseStickerNumber(b, nb))
+		return na < nb ? -1 : (na > nb ? 1 : 0);
+
+	return strcmp(a, b);
+}
+
+static constexpr const char *
+GetOperatorString(StickerSongFilter::Operator op,
+		  const StringFilter &filter) noexcept
+{
+	switch (op) {
+	case StickerSongFilter::Operator::STRING:
+		break;
+
+	case StickerSongFilter::Operator::LESS:
+		return "<";
+
+	case StickerSongFilter::Operator::LESS_EQUAL:
+		return "<=";
+
+	case StickerSongFilter::Operator::GREATER:
+		return ">";
+
+	case StickerSongFilter::Operator::GREATER_EQUAL:
+		return ">=";
+	}
+
+	return filter.GetOperator();
+}
+
+std::string
+StickerSongFilter::ToExpression() const noexcept
+{
+	return std::string("(sticker \"") + EscapeFilterString(name)
+		+ "\" " + GetOperatorString(op, filter)
+		+ " \"" + EscapeFilterString(filter.GetValue()) + "\")";
+}
+
+bool
+StickerSongFilter::Match(const LightSong &song) const noexcept
+{
+	std::string value;
+	const bool found = source.GetSongSticker(song.GetURI(), name, value);
+
+	if (op == Operator::STRING) {
+		if (!found)
+			/* a missing sticker is like an empty one */
+			return filter.empty() != filter.IsNegated();
+
+		return filter.Match(value.c_str());
+	}
+
+	if (!found)
+		return false;
+
+	const int cmp = CompareStickerValues(value.c_str(),
+					     filter.GetValue().c_str());
+	switch (op) {
+	case Operator::STRING:
+		break;
+
+	case Operator::LESS:
+		return cmp < 0;
+
+	case Operator::LESS_EQUAL:
+		return cmp <= 0;
+
+	case Operator::GREATER:
+		return cmp > 0;
+
+	case Operator::GREATER_EQUAL:
+		return cmp >= 0;
+	}
+
+	return false;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_STICKER_SONG_FILTER_HXX
+#define MPD_STICKER_SONG_FILTER_HXX
+
+#include "ISongFilter.hxx"
+#include "StringFilter.hxx"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Provides sticker values to #StickerSongFilter and to sorting by
+ * sticker.  This decouples the song library from the sticker
+ * database.
+ */
+class StickerValueSource {
+public:
+	/**
+	 * Look up a sticker value of a song.  This method must be
+	 * thread-safe.
+	 *
+	 * @param value receives the value if the sticker exists
+	 * @return true if the sticker exists
+	 */
+	virtual bool GetSongSticker(std::string_view uri, std::string_view name,
+				    std::string &value) const noexcept = 0;
+};
+
+/**
+ * Install the global #StickerValueSource (or nullptr to remove it).
+ * The object must remain valid until it is removed.
+ */
+void
+SetStickerValueSource(const StickerValueSource *source) noexcept;
+
+[[gnu::pure]]
+const StickerValueSource *
+GetStickerValueSource() noexcept;
+
+/**
+ * Compare two sticker values.  If both are numbers, they are
+ * compared numerically, else as strings.
+ *
+ * @return a negative value if a<b, zero if equal, a positive value
+ * if a>b
+ */
+[[gnu::pure]]
+int
+CompareStickerValues(const char *a, const char *b) noexcept;
+
+class StickerSongFilter final : public ISongFilter {
+public:
+	enum class Operator : uint8_t {
+		/**
+		 * Match with #StringFilter.
+		 */
+		STRING,
+
+		LESS,
+		LESS_EQUAL,
+		GREATER,
+		GREATER_EQUAL,
+	};
+
+private:
+	const StickerValueSource &source;
+
+	std::string name;
+
+	Operator op;
+
+	/**
+	 * The operand; for relational operators, only its value is
+	 * used.
+	 */
+	StringFilter filter;
+
+public:
+	StickerSongFilter(const StickerValueSource &_source,
+			  std::string &&_name, Operator _op,
+			  StringFilter &&_filter) noexcept
+		:source(_source), name(std::move(_name)), op(_op),
+		 filter(std::move(_filter)) {}
+
+	ISongFilterPtr Clone() const noexcept override {
+		return std::make_unique<StickerSongFilter>(*this);
+	}
+
+	std::string ToExpression() const noexcept override;
+	bool Match(const LightSong &song) const noexcept override;
+};
+
+#endif
@@ -18,10 +18,22 @@
  */
 
 #include "StringFilter.hxx"
+#include "tag/Item.hxx"
+#include "tag/Pool.hxx"
 #include "util/StringAPI.hxx"
 
 #include <cassert>
 
+#ifdef HAVE_ICU_CANONICALIZE
+
+static AllocatedString
+FoldCase(std::string_view src) noexcept
+{
+	return IcuCanonicalize(src, true);
+}
+
+#endif
+
 bool
 StringFilter::MatchWithoutNegation(const char *s) const noexcept
 {
@@ -29,7 +41,7 @@ StringFilter::MatchWithoutNegation(const char *s) const noexcept
 
 #ifdef HAVE_PCRE
 	if (regex)
-		return regex->Match(s);
+		return regex->Test(s);
 #endif
 
 	if (fold_case) {
@@ -61,6 +73,31 @@ StringFilter::MatchWithoutNegation(const char *s) const noexcept
 	}
 }
 
+bool
+StringFilter::MatchWithoutNegation(const TagItem &item) const noexcept
+{
+#ifdef HAVE_ICU_CANONICALIZE
+	if (fold_case && !IsRegex()) {
+		const char *folded = tag_pool_get_folded(item, FoldCase);
+
+		switch (position) {
+		case Position::FULL:
+			break;
+
+		case Position::ANYWHERE:
+			return fold_case.IsInFolded(folded);
+
+		case Position::PREFIX:
+			return fold_case.StartsWithFolded(folded);
+		}
+
+		return fold_case.EqualsFolded(folded);
+	}
+#endif
+
+	return MatchWithoutNegation(item.value);
+}
+
 bool
 StringFilter::Match(const char *s) const noexcept
 {
@@ -31,6 +31,8 @@
 #include <string>
 #include <memory>
 
+struct TagItem;
+
 class StringFilter {
 public:
 	enum class Position : uint_least8_t {
@@ -97,6 +99,10 @@ public:
 		return fold_case;
 	}
 
+	Position GetPosition() const noexcept {
+		return position;
+	}
+
 	bool IsNegated() const noexcept {
 		return negated;
 	}
@@ -131,6 +137,15 @@ public:
 	 */
 	[[gnu::pure]]
 	bool MatchWithoutNegation(const char *s) const noexcept;
+
+	/**
+	 * Like MatchWithoutNegation(const char *), but for a tag
+	 * value from the tag pool.  With case folding, this uses the
+	 * folded value cached by the pool instead of folding the
+	 * value again.
+	 */
+	[[gnu::pure]]
+	bool MatchWithoutNegation(const TagItem &item) const noexcept;
 };
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagGroupSongFilter.hxx"
+#include "LightSong.hxx"
+#include "tag/Tag.hxx"
+
+#include <cassert>
+#include <cstdint>
+
+std::string
+TagGroupSongFilter::ToExpression() const noexcept
+{
+	assert(!items.empty());
+
+	auto i = items.begin();
+	const auto end = items.end();
+
+	if (std::next(i) == end)
+		return i->ToExpression();
+
+	std::string e("(");
+	e += i->ToExpression();
+
+	for (++i; i != end; ++i) {
+		e += " AND ";
+		e += i->ToExpression();
+	}
+
+	e.push_back(')');
+	return e;
+}
+
+bool
+TagGroupSongFilter::Match(const LightSong &song) const noexcept
+{
+	assert(items.size() <= MAX_ITEMS);
+
+	const Tag &tag = song.tag;
+	const std::size_t n = items.size();
+
+	/* bit mask of items which have matched a tag item */
+	uint_least64_t matched = 0;
+
+	/* the number of non-negated items which have not yet
+	   matched; if this drops to zero and there are no negated
+	   items, the rest of the tag needs not be scanned */
+	std::size_t pending = 0;
+	bool have_negated = false;
+	for (const auto &i : items) {
+		if (i.IsNegated())
+			have_negated = true;
+		else
+			++pending;
+	}
+
+	bool visited_types[TAG_NUM_OF_ITEM_TYPES]{};
+
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i) {
+		const TagType type = types[i];
+		const TagItem &item = *tag.items[i];
+		visited_types[type] = true;
+
+		for (std::size_t k = 0; k < n; ++k) {
+			const uint_least64_t bit = uint_least64_t(1) << k;
+			if ((matched & bit) != 0)
+				continue;
+
+			const auto &f = items[k];
+			if (!f.MatchItem(type, item))
+				continue;
+
+			if (f.IsNegated())
+				/* a negated item matched: no need to
+				   look any further */
+				return false;
+
+			matched |= bit;
+			if (--pending == 0 && !have_negated)
+				return true;
+		}
+	}
+
+	/* check the fallback tags for all items which did not
+	   match */
+	for (std::size_t k = 0; k < n; ++k)
+		if ((matched & (uint_least64_t(1) << k)) == 0 &&
+		    !items[k].MatchMissing(tag, visited_types))
+			return false;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_TAG_GROUP_SONG_FILTER_HXX
+#define MPD_TAG_GROUP_SONG_FILTER_HXX
+
+#include "TagSongFilter.hxx"
+
+#include <vector>
+
+/**
+ * Combine multiple #TagSongFilter instances with logical "and",
+ * evaluating all of them in one sweep through the song's tag.  This
+ * is generated by CompileSongFilter(); it is not meant to be
+ * constructed by the parser.
+ */
+class TagGroupSongFilter final : public ISongFilter {
+	std::vector<TagSongFilter> items;
+
+public:
+	/**
+	 * The maximum number of items; the matched items are tracked
+	 * in a 64 bit mask.
+	 */
+	static constexpr std::size_t MAX_ITEMS = 64;
+
+	[[gnu::pure]]
+	bool IsFull() const noexcept {
+		return items.size() >= MAX_ITEMS;
+	}
+
+	void AddItem(const TagSongFilter &item) noexcept {
+		items.push_back(item);
+	}
+
+	/* virtual methods from ISongFilter */
+	ISongFilterPtr Clone() const noexcept override {
+		return std::make_unique<TagGroupSongFilter>(*this);
+	}
+
+	std::string ToExpression() const noexcept override;
+	bool Match(const LightSong &song) const noexcept override;
+};
+
+#endif
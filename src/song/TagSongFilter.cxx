@@ -35,18 +35,17 @@ TagSongFilter::ToExpression() const noexcept
 }
 
 bool
-TagSongFilter::Match(const Tag &tag) const noexcept
+TagSongFilter::MatchItem(TagType item_type,
+			 const TagItem &item) const noexcept
 {
-	bool visited_types[TAG_NUM_OF_ITEM_TYPES]{};
-
-	for (const auto &i : tag) {
-		visited_types[i.type] = true;
-
-		if ((type == TAG_NUM_OF_ITEM_TYPES || i.type == type) &&
-		    filter.MatchWithoutNegation(i.value))
-			return !filter.IsNegated();
-	}
+	return (type == TAG_NUM_OF_ITEM_TYPES || item_type == type) &&
+		filter.MatchWithoutNegation(item);
+}
 
+bool
+TagSongFilter::MatchMissing(const Tag &tag,
+			    const bool *visited_types) const noexcept
+{
 	if (type < TAG_NUM_OF_ITEM_TYPES && !visited_types[type]) {
 		/* if the specified tag is not present, try the
 		   fallback tags */
@@ -59,9 +58,10 @@ TagSongFilter::Match(const Tag &tag) const noexcept
 				   without checking again */
 				return false;
 
-			for (const auto &item : tag) {
-				if (item.type == tag2 &&
-				    filter.MatchWithoutNegation(item.value)) {
+			const TagType *types = tag.GetTypes();
+			for (unsigned i = 0; i < tag.num_items; ++i) {
+				if (types[i] == tag2 &&
+				    filter.MatchWithoutNegation(*tag.items[i])) {
 					result = true;
 					break;
 				}
@@ -84,8 +84,36 @@ TagSongFilter::Match(const Tag &tag) const noexcept
 	return filter.IsNegated();
 }
 
+bool
+TagSongFilter::Match(const Tag &tag) const noexcept
+{
+	bool visited_types[TAG_NUM_OF_ITEM_TYPES]{};
+
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i) {
+		visited_types[types[i]] = true;
+
+		if (MatchItem(types[i], *tag.items[i]))
+			return !filter.IsNegated();
+	}
+
+	return MatchMissing(tag, visited_types);
+}
+
 bool
 TagSongFilter::Match(const LightSong &song) const noexcept
 {
 	return Match(song.tag);
 }
+
+bool
+TagSongFilter::IsIndexable() const noexcept
+{
+	return type != TAG_NUM_OF_ITEM_TYPES &&
+		!filter.IsNegated() && !filter.IsRegex() &&
+		/* an empty value matches songs which don't have
+		   this tag at all */
+		!filter.empty() &&
+		(filter.GetPosition() == StringFilter::Position::FULL ||
+		 filter.GetPosition() == StringFilter::Position::PREFIX);
+}
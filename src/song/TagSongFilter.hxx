@@ -27,6 +27,7 @@
 
 enum TagType : uint8_t;
 struct Tag;
+struct TagItem;
 struct LightSong;
 
 class TagSongFilter final : public ISongFilter {
@@ -50,6 +51,14 @@ public:
 		return filter.GetFoldCase();
 	}
 
+	bool IsRegex() const noexcept {
+		return filter.IsRegex();
+	}
+
+	StringFilter::Position GetPosition() const noexcept {
+		return filter.GetPosition();
+	}
+
 	bool IsNegated() const noexcept {
 		return filter.IsNegated();
 	}
@@ -58,6 +67,16 @@ public:
 		filter.ToggleNegated();
 	}
 
+	/**
+	 * Can this filter be evaluated with an inverted index of tag
+	 * values, i.e. does it compare a specific tag with a literal
+	 * string (as a whole or as a prefix)?  Whether case folding
+	 * is supported depends on the index and needs to be checked
+	 * by the caller.
+	 */
+	[[gnu::pure]]
+	bool IsIndexable() const noexcept;
+
 	ISongFilterPtr Clone() const noexcept override {
 		return std::make_unique<TagSongFilter>(*this);
 	}
@@ -65,6 +84,29 @@ public:
 	std::string ToExpression() const noexcept override;
 	bool Match(const LightSong &song) const noexcept override;
 
+	/**
+	 * Does the given tag item have the right type and does its
+	 * value match?  This ignores the "negated" flag.
+	 *
+	 * @param item_type the type of the item, as obtained from
+	 * Tag::GetTypes(); the item itself is only dereferenced if
+	 * the type matches
+	 */
+	[[gnu::pure]]
+	bool MatchItem(TagType item_type, const TagItem &item) const noexcept;
+
+	/**
+	 * Determine the result after MatchItem() has returned false
+	 * for all items of the tag; this checks the fallback tags and
+	 * applies the "negated" flag.
+	 *
+	 * @param visited_types an array of #TAG_NUM_OF_ITEM_TYPES
+	 * elements specifying which tag types are present in the tag
+	 */
+	[[gnu::pure]]
+	bool MatchMissing(const Tag &tag,
+			  const bool *visited_types) const noexcept;
+
 private:
 	bool Match(const Tag &tag) const noexcept;
 };
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AnalysisStore.hxx"
+#include "Database.hxx"
+#include "util/NumberParser.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <fmt/format.h>
+
+static constexpr Domain analysis_domain("analysis");
+
+static constexpr char TRACK_GAIN[] = "replaygain_track_gain";
+static constexpr char TRACK_PEAK[] = "replaygain_track_peak";
+static constexpr char MIXRAMP_START[] = "mixramp_start";
+static constexpr char MIXRAMP_END[] = "mixramp_end";
+
+StickerAnalysisStore::StickerAnalysisStore(EventLoop &_loop,
+					   StickerDatabase &_db) noexcept
+	:db(_db), inject(_loop, BIND_THIS_METHOD(OnInject)) {}
+
+StickerAnalysisStore::~StickerAnalysisStore() noexcept
+{
+	WritePending();
+}
+
+std::optional<SongAnalysis>
+StickerAnalysisStore::Load(std::string_view uri) const noexcept
+{
+	const auto &cache = db.GetSongCache();
+
+	SongAnalysis analysis;
+	bool found = false;
+	std::string value;
+
+	if (cache.GetSongSticker(uri, TRACK_GAIN, value)) {
+		char *endptr;
+		const float gain = ParseFloat(value.c_str(), &endptr);
+		if (endptr != value.c_str() && *endptr == 0) {
+			analysis.track.gain = gain;
+			analysis.track.peak = 0;
+
+			if (cache.GetSongSticker(uri, TRACK_PEAK, value))
+				analysis.track.peak = ParseFloat(value.c_str());
+
+			found = true;
+		}
+	}
+
+	if (cache.GetSongSticker(uri, MIXRAMP_START, value)) {
+		analysis.mix_ramp.SetStart(std::move(value));
+		found = true;
+	}
+
+	if (cache.GetSongSticker(uri, MIXRAMP_END, value)) {
+		analysis.mix_ramp.SetEnd(std::move(value));
+		found = true;
+	}
+
+	if (!found)
+		return std::nullopt;
+
+	return analysis;
+}
+
+void
+StickerAnalysisStore::Store(std::string_view uri,
+			    SongAnalysis &&analysis) noexcept
+{
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		pending.emplace_front(uri, std::move(analysis));
+	}
+
+	inject.Schedule();
+}
+
+static void
+StoreAnalysis(StickerDatabase &db, const char *uri,
+	      const SongAnalysis &analysis)
+{
+	if (analysis.track.IsDefined()) {
+		db.StoreValue("song", uri, TRACK_GAIN,
+			      fmt::format("{:.2f}", analysis.track.gain).c_str());
+		db.StoreValue("song", uri, TRACK_PEAK,
+			      fmt::format("{:.6f}", analysis.track.peak).c_str());
+	}
+
+	if (const char *start = analysis.mix_ramp.GetStart())
+		db.StoreValue("song", uri, MIXRAMP_START, start);
+
+	if (const char *end = analysis.mix_ramp.GetEnd())
+		db.StoreValue("song", uri, MIXRAMP_END, end);
+}
+
+void
+StickerAnalysisStore::WritePending() noexcept
+{
+	decltype(pending) items;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		items.swap(pending);
+	}
+
+	for (const auto &[uri, analysis] : items) {
+		try {
+			StoreAnalysis(db, uri.c_str(), analysis);
+			FmtDebug(analysis_domain, "Stored analysis of {}",
+				 uri);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to store song analysis");
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_STICKER_ANALYSIS_STORE_HXX
+#define MPD_STICKER_ANALYSIS_STORE_HXX
+
+#include "decoder/Analysis.hxx"
+#include "event/InjectEvent.hxx"
+#include "thread/Mutex.hxx"
+
+#include <forward_list>
+#include <string>
+#include <utility>
+
+class StickerDatabase;
+
+/**
+ * An #AnalysisStore implementation which stores the results as song
+ * stickers named "replaygain_track_gain", "replaygain_track_peak",
+ * "mixramp_start" and "mixramp_end".
+ *
+ * Lookups use the thread-safe #StickerCache; modifications are
+ * passed to the #EventLoop thread which owns the #StickerDatabase.
+ */
+class StickerAnalysisStore final : public AnalysisStore {
+	StickerDatabase &db;
+
+	InjectEvent inject;
+
+	Mutex mutex;
+
+	/**
+	 * Results waiting to be written to the database.  Protected
+	 * by #mutex.
+	 */
+	std::forward_list<std::pair<std::string, SongAnalysis>> pending;
+
+public:
+	StickerAnalysisStore(EventLoop &_loop, StickerDatabase &_db) noexcept;
+
+	/**
+	 * Writes the pending results.
+	 */
+	~StickerAnalysisStore() noexcept override;
+
+	/* virtual methods from class AnalysisStore */
+	std::optional<SongAnalysis> Load(std::string_view uri) const noexcept override;
+	void Store(std::string_view uri,
+		   SongAnalysis &&analysis) noexcept override;
+
+private:
+	void WritePending() noexcept;
+
+	/* InjectEvent callback */
+	void OnInject() noexcept {
+		WritePending();
+	}
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Cache.hxx"
+
+#include <mutex>
+
+void
+StickerCache::Set(std::string_view uri, std::string_view name,
+		  std::string_view value) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	auto n = names.find(name);
+	if (n == names.end())
+		n = names.emplace(std::string{name}, UriMap{}).first;
+
+	auto &uris = n->second;
+	if (auto i = uris.find(uri); i != uris.end())
+		i->second = value;
+	else
+		uris.emplace(std::string{uri}, std::string{value});
+}
+
+void
+StickerCache::Remove(std::string_view uri) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	for (auto n = names.begin(); n != names.end();) {
+		auto &uris = n->second;
+		if (auto i = uris.find(uri); i != uris.end())
+			uris.erase(i);
+
+		if (uris.empty())
+			n = names.erase(n);
+		else
+			++n;
+	}
+}
+
+void
+StickerCache::Remove(std::string_view uri, std::string_view name) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	auto n = names.find(name);
+	if (n == names.end())
+		return;
+
+	auto &uris = n->second;
+	if (auto i = uris.find(uri); i != uris.end())
+		uris.erase(i);
+
+	if (uris.empty())
+		names.erase(n);
+}
+
+bool
+StickerCache::GetSongSticker(std::string_view uri, std::string_view name,
+			     std::string &value) const noexcept
+{
+	const std::shared_lock lock{mutex};
+
+	auto n = names.find(name);
+	if (n == names.end())
+		return false;
+
+	auto i = n->second.find(uri);
+	if (i == n->second.end())
+		return false;
+
+	value = i->second;
+	return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_STICKER_CACHE_HXX
+#define MPD_STICKER_CACHE_HXX
+
+#include "song/StickerSongFilter.hxx"
+
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * An in-memory copy of all song stickers, which allows filtering and
+ * sorting by sticker values without querying SQLite for each song.
+ * It is filled and updated by #StickerDatabase; readers may run in
+ * any thread.
+ */
+class StickerCache final : public StickerValueSource {
+	mutable std::shared_mutex mutex;
+
+	using UriMap = std::map<std::string, std::string, std::less<>>;
+
+	/**
+	 * Sticker name to (URI to value).  The outer map is small,
+	 * because clients use only a few different sticker names.
+	 */
+	std::map<std::string, UriMap, std::less<>> names;
+
+public:
+	void Set(std::string_view uri, std::string_view name,
+		 std::string_view value) noexcept;
+
+	/**
+	 * Remove all stickers of the specified URI.
+	 */
+	void Remove(std::string_view uri) noexcept;
+
+	/**
+	 * Remove one sticker of the specified URI.
+	 */
+	void Remove(std::string_view uri, std::string_view name) noexcept;
+
+	/* virtual methods from class StickerValueSource */
+	bool GetSongSticker(std::string_view uri, std::string_view name,
+			    std::string &value) const noexcept override;
+};
+
+#endif
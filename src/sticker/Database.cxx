@@ -23,12 +23,16 @@
 #include "fs/Path.hxx"
 #include "fs/NarrowPath.hxx"
 #include "Idle.hxx"
+#include "Log.hxx"
+#include "util/StringAPI.hxx"
 #include "util/StringCompare.hxx"
 #include "util/ScopeExit.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <iterator>
 #include <array>
+#include <string>
 
 using namespace Sqlite;
 
@@ -43,9 +47,17 @@ enum sticker_sql {
 	STICKER_SQL_FIND_VALUE,
 	STICKER_SQL_FIND_LT,
 	STICKER_SQL_FIND_GT,
+	STICKER_SQL_BEGIN,
+	STICKER_SQL_COMMIT,
+	STICKER_SQL_LOAD_MANY,
 	STICKER_SQL_COUNT
 };
 
+/**
+ * The number of URIs looked up by one #STICKER_SQL_LOAD_MANY query.
+ */
+static constexpr unsigned LOAD_MANY_CHUNK = 64;
+
 static constexpr auto sticker_sql = std::array {
 	//[STICKER_SQL_GET] =
 	"SELECT value FROM sticker WHERE type=? AND uri=? AND name=?",
@@ -70,8 +82,33 @@ static constexpr auto sticker_sql = std::array {
 
 	//[STICKER_SQL_FIND_GT] =
 	"SELECT uri,value FROM sticker WHERE type=? AND uri LIKE (? || '%') AND name=? AND value>?",
+
+	//[STICKER_SQL_BEGIN] =
+	"BEGIN",
+
+	//[STICKER_SQL_COMMIT] =
+	"COMMIT",
+
+	/* STICKER_SQL_LOAD_MANY is generated by MakeLoadManySql() */
 };
 
+static_assert(sticker_sql.size() == STICKER_SQL_LOAD_MANY);
+
+/**
+ * Generate the #STICKER_SQL_LOAD_MANY query with #LOAD_MANY_CHUNK
+ * URI parameters.  Unused parameters are bound to NULL, which never
+ * matches.
+ */
+static std::string
+MakeLoadManySql() noexcept
+{
+	std::string sql = "SELECT uri,value FROM sticker WHERE type=? AND name=? AND uri IN (?";
+	for (unsigned i = 1; i < LOAD_MANY_CHUNK; ++i)
+		sql += ",?";
+	sql += ")";
+	return sql;
+}
+
 static constexpr const char sticker_sql_create[] =
 	"CREATE TABLE IF NOT EXISTS sticker("
 	"  type VARCHAR NOT NULL, "
@@ -83,13 +120,36 @@ static constexpr const char sticker_sql_create[] =
 	" sticker_value ON sticker(type, uri, name);"
 	"";
 
-StickerDatabase::StickerDatabase(Path path)
-	:db(NarrowPath(path))
+StickerDatabase::StickerDatabase(EventLoop &loop, Path path,
+				 const char *synchronous,
+				 Event::Duration _commit_delay)
+	:db(NarrowPath(path)),
+	 commit_timer(loop, BIND_THIS_METHOD(OnCommitTimer)),
+	 commit_delay(_commit_delay)
 {
 	assert(!path.IsNull());
 
 	int ret;
 
+	/* the write-ahead log allows committing without rewriting
+	   the database file; this may fail on some file systems,
+	   but SQLite then silently keeps the old journal mode */
+
+	ret = sqlite3_exec(db, "PRAGMA journal_mode=WAL",
+			   nullptr, nullptr, nullptr);
+	if (ret != SQLITE_OK)
+		throw SqliteError(db, ret,
+				  "Failed to set the sticker journal mode");
+
+	if (synchronous != nullptr) {
+		const std::string sql = std::string{"PRAGMA synchronous="} + synchronous;
+		ret = sqlite3_exec(db, sql.c_str(),
+				   nullptr, nullptr, nullptr);
+		if (ret != SQLITE_OK)
+			throw SqliteError(db, ret,
+					  "Failed to set sticker_synchronous");
+	}
+
 	/* create the table and index */
 
 	ret = sqlite3_exec(db, sticker_sql_create,
@@ -105,12 +165,38 @@ StickerDatabase::StickerDatabase(Path path)
 
 		stmt[i] = Prepare(db, sticker_sql[i]);
 	}
+
+	stmt[STICKER_SQL_LOAD_MANY] = Prepare(db, MakeLoadManySql().c_str());
+
+	LoadSongCache();
+}
+
+void
+StickerDatabase::LoadSongCache()
+{
+	sqlite3_stmt *const s =
+		Prepare(db, "SELECT uri,name,value FROM sticker WHERE type='song'");
+	AtScopeExit(s) {
+		sqlite3_finalize(s);
+	};
+
+	ExecuteForEach(s, [this, s](){
+		song_cache.Set((const char *)sqlite3_column_text(s, 0),
+			       (const char *)sqlite3_column_text(s, 1),
+			       (const char *)sqlite3_column_text(s, 2));
+	});
 }
 
 StickerDatabase::~StickerDatabase() noexcept
 {
 	assert(db != nullptr);
 
+	try {
+		Commit();
+	} catch (...) {
+		LogError(std::current_exception());
+	}
+
 	for (const auto &sticker : stmt) {
 		assert(sticker != nullptr);
 
@@ -118,6 +204,63 @@ StickerDatabase::~StickerDatabase() noexcept
 	}
 }
 
+void
+StickerDatabase::Commit()
+{
+	if (n_batched == 0)
+		return;
+
+	commit_timer.Cancel();
+	n_batched = 0;
+
+	sqlite3_stmt *const s = stmt[STICKER_SQL_COMMIT];
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+	};
+
+	ExecuteCommand(s);
+}
+
+void
+StickerDatabase::OnCommitTimer() noexcept
+{
+	try {
+		Commit();
+	} catch (...) {
+		LogError(std::current_exception(),
+			 "Failed to commit sticker database");
+	}
+}
+
+void
+StickerDatabase::BeginModification()
+{
+	if (commit_delay <= Event::Duration{} || n_batched > 0)
+		return;
+
+	sqlite3_stmt *const s = stmt[STICKER_SQL_BEGIN];
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+	};
+
+	ExecuteCommand(s);
+
+	/* count the transaction as open even if the following
+	   modification fails, so it will be committed anyway */
+	n_batched = 1;
+	commit_timer.Schedule(commit_delay);
+}
+
+void
+StickerDatabase::EndModification()
+{
+	if (n_batched == 0)
+		return;
+
+	if (++n_batched > MAX_BATCH)
+		Commit();
+}
+
 std::string
 StickerDatabase::LoadValue(const char *type, const char *uri, const char *name)
 {
@@ -228,8 +371,15 @@ StickerDatabase::StoreValue(const char *type, const char *uri,
 	if (StringIsEmpty(name))
 		return;
 
+	BeginModification();
+
 	if (!UpdateValue(type, uri, name, value))
 		InsertValue(type, uri, name, value);
+
+	EndModification();
+
+	if (StringIsEqual(type, "song"))
+		song_cache.Set(uri, name, value);
 }
 
 bool
@@ -247,9 +397,15 @@ StickerDatabase::Delete(const char *type, const char *uri)
 		sqlite3_clear_bindings(s);
 	};
 
+	BeginModification();
 	bool modified = ExecuteModified(s);
-	if (modified)
+	EndModification();
+	if (modified) {
+		if (StringIsEqual(type, "song"))
+			song_cache.Remove(uri);
+
 		idle_add(IDLE_STICKER);
+	}
 	return modified;
 }
 
@@ -269,9 +425,15 @@ StickerDatabase::DeleteValue(const char *type, const char *uri,
 		sqlite3_clear_bindings(s);
 	};
 
+	BeginModification();
 	bool modified = ExecuteModified(s);
-	if (modified)
+	EndModification();
+	if (modified) {
+		if (StringIsEqual(type, "song"))
+			song_cache.Remove(uri, name);
+
 		idle_add(IDLE_STICKER);
+	}
 	return modified;
 }
 
@@ -285,6 +447,53 @@ StickerDatabase::Load(const char *type, const char *uri)
 	return s;
 }
 
+void
+StickerDatabase::LoadValues(const char *type,
+			    std::span<const char *const> uris,
+			    const char *name,
+			    void (*func)(const char *uri, const char *value,
+					 void *user_data),
+			    void *user_data)
+{
+	assert(type != nullptr);
+	assert(name != nullptr);
+	assert(func != nullptr);
+
+	sqlite3_stmt *const s = stmt[STICKER_SQL_LOAD_MANY];
+
+	AtScopeExit(s) {
+		sqlite3_reset(s);
+		sqlite3_clear_bindings(s);
+	};
+
+	while (!uris.empty()) {
+		const auto chunk = uris.first(std::min<std::size_t>(uris.size(),
+								    LOAD_MANY_CHUNK));
+		uris = uris.subspan(chunk.size());
+
+		sqlite3_reset(s);
+		sqlite3_clear_bindings(s);
+
+		Bind(s, 1, type);
+		Bind(s, 2, name);
+
+		unsigned i = 3;
+		for (const char *uri : chunk) {
+			assert(uri != nullptr);
+			Bind(s, i++, uri);
+		}
+
+		/* the remaining parameters stay NULL after
+		   sqlite3_clear_bindings() */
+
+		ExecuteForEach(s, [s, func, user_data](){
+			func((const char*)sqlite3_column_text(s, 0),
+			     (const char*)sqlite3_column_text(s, 1),
+			     user_data);
+		});
+	}
+}
+
 sqlite3_stmt *
 StickerDatabase::BindFind(const char *type, const char *base_uri,
 			  const char *name,
@@ -43,11 +43,14 @@
 #define MPD_STICKER_DATABASE_HXX
 
 #include "Match.hxx"
+#include "Cache.hxx"
 #include "lib/sqlite/Database.hxx"
+#include "event/CoarseTimerEvent.hxx"
 
 #include <sqlite3.h>
 
 #include <map>
+#include <span>
 #include <string>
 
 class Path;
@@ -65,22 +68,79 @@ class StickerDatabase {
 		  SQL_FIND_VALUE,
 		  SQL_FIND_LT,
 		  SQL_FIND_GT,
+		  SQL_BEGIN,
+		  SQL_COMMIT,
+		  SQL_LOAD_MANY,
 
 		  SQL_COUNT
 	};
 
+	/**
+	 * The maximum number of modifications in one write
+	 * transaction.  When this is reached, the transaction is
+	 * committed immediately instead of waiting for the
+	 * #commit_timer.
+	 */
+	static constexpr unsigned MAX_BATCH = 256;
+
 	Sqlite::Database db;
 	sqlite3_stmt *stmt[SQL_COUNT];
 
+	/**
+	 * Commits the pending write transaction after #commit_delay.
+	 */
+	CoarseTimerEvent commit_timer;
+
+	/**
+	 * How long may modifications be collected in one transaction?
+	 * Zero disables batching, i.e. each modification is committed
+	 * immediately.
+	 */
+	const Event::Duration commit_delay;
+
+	/**
+	 * One plus the number of modifications in the current write
+	 * transaction.  If this is non-zero, a transaction has been
+	 * opened with "BEGIN" and #commit_timer is pending.
+	 */
+	unsigned n_batched = 0;
+
+	/**
+	 * A copy of all stickers of type "song".
+	 */
+	StickerCache song_cache;
+
 public:
 	/**
 	 * Opens the sticker database.
 	 *
 	 * Throws on error.
+	 *
+	 * @param synchronous the value of SQLite's "synchronous"
+	 * pragma, e.g. "normal"; nullptr for SQLite's default
+	 * @param _commit_delay collect modifications for this
+	 * duration in one transaction; zero disables batching
 	 */
-	StickerDatabase(Path path);
+	StickerDatabase(EventLoop &loop, Path path,
+			const char *synchronous,
+			Event::Duration _commit_delay);
 	~StickerDatabase() noexcept;
 
+	/**
+	 * Returns the in-memory copy of all "song" stickers.  It may
+	 * be used from any thread.
+	 */
+	const StickerCache &GetSongCache() const noexcept {
+		return song_cache;
+	}
+
+	/**
+	 * Commit the pending write transaction (if any) now.
+	 *
+	 * Throws #SqliteError on error.
+	 */
+	void Commit();
+
 	/**
 	 * Returns one value from an object's sticker record.  Returns an
 	 * empty string if the value doesn't exist.
@@ -126,6 +186,26 @@ public:
 	 */
 	Sticker Load(const char *type, const char *uri);
 
+	/**
+	 * Loads one sticker value of many resources at once.  The
+	 * URIs are looked up in chunks with a single query each,
+	 * instead of one query per URI.  Resources which do not have
+	 * this sticker are omitted.
+	 *
+	 * Throws #SqliteError on error.
+	 *
+	 * @param type the resource type, e.g. "song"
+	 * @param uris the URIs of the resources
+	 * @param name the name of the sticker
+	 * @param func a callback invoked for each value found; the
+	 * order is unspecified
+	 */
+	void LoadValues(const char *type, std::span<const char *const> uris,
+			const char *name,
+			void (*func)(const char *uri, const char *value,
+				     void *user_data),
+			void *user_data);
+
 	/**
 	 * Finds stickers with the specified name below the specified URI.
 	 *
@@ -143,6 +223,27 @@ public:
 		  void *user_data);
 
 private:
+	/**
+	 * Called before each modification.  Opens a new write
+	 * transaction if batching is enabled and there is none yet.
+	 */
+	void BeginModification();
+
+	/**
+	 * Called after each successful modification.  Commits the
+	 * transaction if #MAX_BATCH has been reached.
+	 */
+	void EndModification();
+
+	void OnCommitTimer() noexcept;
+
+	/**
+	 * Copy all "song" stickers into #song_cache.
+	 *
+	 * Throws #SqliteError on error.
+	 */
+	void LoadSongCache();
+
 	void ListValues(std::map<std::string, std::string> &table,
 			const char *type, const char *uri);
 
@@ -39,6 +39,18 @@ public:
 	 * Throws #std::runtime_error on error.
 	 */
 	virtual StorageFileInfo GetInfo(bool follow) = 0;
+
+	/**
+	 * Could the entry most recently returned by Read() be a
+	 * symlink?  Implementations which learn the file type from
+	 * the directory listing (e.g. d_type from readdir()) return
+	 * false for entries which are certainly not symlinks, so the
+	 * caller can skip readlink().
+	 */
+	[[gnu::pure]]
+	virtual bool MaybeSymlink() const noexcept {
+		return true;
+	}
 };
 
 class Storage {
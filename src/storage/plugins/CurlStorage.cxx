@@ -29,8 +29,8 @@
 #include "lib/curl/Request.hxx"
 #include "lib/curl/Handler.hxx"
 #include "lib/curl/Escape.hxx"
+#include "lib/curl/HttpStatusError.hxx"
 #include "lib/expat/ExpatParser.hxx"
-#include "lib/fmt/RuntimeError.hxx"
 #include "fs/Traits.hxx"
 #include "event/InjectEvent.hxx"
 #include "thread/Mutex.hxx"
@@ -43,15 +43,66 @@
 #include "util/UriExtract.hxx"
 
 #include <cassert>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
 
+/**
+ * How long is a listing obtained with "Depth: infinity" used to
+ * answer OpenDirectory() calls?
+ */
+static constexpr std::chrono::steady_clock::duration DAV_TREE_TTL =
+	std::chrono::minutes(5);
+
+/**
+ * All directory listings below one collection, obtained with a
+ * single "Depth: infinity" PROPFIND.
+ */
+struct DavTree {
+	/**
+	 * The unescaped path of the collection this tree starts at
+	 * (with trailing slash).
+	 */
+	std::string base_path;
+
+	std::chrono::steady_clock::time_point expires;
+
+	/**
+	 * Maps the path of each collection relative to #base_path
+	 * (without trailing slash; the empty string is #base_path
+	 * itself) to its entries.
+	 */
+	std::map<std::string, MemoryStorageDirectoryReader::List,
+		 std::less<>> directories;
+};
+
 class CurlStorage final : public Storage {
 	const std::string base;
 
 	CurlInit curl;
 
+	/**
+	 * Protects #tree_supported and #tree.
+	 */
+	Mutex tree_mutex;
+
+	/**
+	 * Does the WebDAV server accept "Depth: infinity"?  This is
+	 * cleared after the first refusal; from then on, each
+	 * directory is listed with its own "Depth: 1" request.
+	 */
+	bool tree_supported = true;
+
+	/**
+	 * The result of the most recent "Depth: infinity" PROPFIND.
+	 * Each listing is handed out only once (the database update
+	 * visits each directory only once), and the whole tree is
+	 * discarded when it expires.
+	 */
+	std::unique_ptr<DavTree> tree;
+
 public:
 	CurlStorage(EventLoop &_loop, const char *_base)
 		:base(_base),
@@ -65,6 +116,16 @@ public:
 	[[nodiscard]] std::string MapUTF8(std::string_view uri_utf8) const noexcept override;
 
 	[[nodiscard]] std::string_view MapToRelativeUTF8(std::string_view uri_utf8) const noexcept override;
+
+private:
+	/**
+	 * Take the listing of the given collection (unescaped path
+	 * with trailing slash) from #tree.
+	 *
+	 * @return true if #entries was filled
+	 */
+	bool TakeFromTree(std::string_view path,
+			  MemoryStorageDirectoryReader::List &entries) noexcept;
 };
 
 std::string
@@ -256,7 +317,12 @@ class PropfindOperation : BlockingHttpRequest, CommonExpatParser {
 	DavResponse response;
 
 public:
-	PropfindOperation(CurlGlobal &_curl, const char *_uri, unsigned depth)
+	/**
+	 * @param depth the value of the "Depth" request header:
+	 * "0", "1" or "infinity"
+	 */
+	PropfindOperation(CurlGlobal &_curl, const char *_uri,
+			  const char *depth)
 		:BlockingHttpRequest(_curl, _uri),
 		 CommonExpatParser(ExpatNamespaceSeparator{'|'})
 	{
@@ -268,7 +334,7 @@ public:
 		   username/password are specified */
 		request.SetOption(CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
 
-		request_headers.Append(StringFormat<40>("depth: %u", depth));
+		request_headers.Append(StringFormat<40>("depth: %s", depth));
 		request_headers.Append("content-type: text/xml");
 
 		request.SetOption(CURLOPT_HTTPHEADER, request_headers.Get());
@@ -302,8 +368,9 @@ private:
 	/* virtual methods from CurlResponseHandler */
 	void OnHeaders(unsigned status, Curl::Headers &&headers) final {
 		if (status != 207)
-			throw FmtRuntimeError("Status {} from WebDAV server; expected \"207 Multi-Status\"",
-					      status);
+			throw HttpStatusError(status,
+					      StringFormat<80>("Status %u from WebDAV server; expected \"207 Multi-Status\"",
+							       status).c_str());
 
 		if (!IsXmlContentType(headers))
 			throw std::runtime_error("Unexpected Content-Type from WebDAV server");
@@ -439,7 +506,7 @@ class HttpGetInfoOperation final : public PropfindOperation {
 
 public:
 	HttpGetInfoOperation(CurlGlobal &curl, const char *uri)
-		:PropfindOperation(curl, uri, 0),
+		:PropfindOperation(curl, uri, "0"),
 		 info(StorageFileInfo::Type::OTHER) {
 	}
 
@@ -492,7 +559,7 @@ class HttpListDirectoryOperation final : public PropfindOperation {
 
 public:
 	HttpListDirectoryOperation(CurlGlobal &curl, const char *uri)
-		:PropfindOperation(curl, uri, 1),
+		:PropfindOperation(curl, uri, "1"),
 		 base_path(CurlUnescape(GetEasy(), UriPathOrSlash(uri))) {}
 
 	std::unique_ptr<StorageDirectoryReader> Perform() {
@@ -557,6 +624,105 @@ protected:
 	}
 };
 
+/**
+ * Obtain the listings of a collection and all of its descendants
+ * with one "Depth: infinity" WebDAV PROPFIND.
+ */
+class HttpListTreeOperation final : public PropfindOperation {
+	std::unique_ptr<DavTree> tree = std::make_unique<DavTree>();
+
+public:
+	HttpListTreeOperation(CurlGlobal &curl, const char *uri)
+		:PropfindOperation(curl, uri, "infinity") {
+		tree->base_path = CurlUnescape(GetEasy(), UriPathOrSlash(uri));
+		tree->directories.try_emplace(std::string{});
+	}
+
+	std::unique_ptr<DavTree> Perform() {
+		DeferStart();
+		Wait();
+		tree->expires = std::chrono::steady_clock::now() + DAV_TREE_TTL;
+		return std::move(tree);
+	}
+
+protected:
+	/* virtual methods from PropfindOperation */
+	void OnDavResponse(DavResponse &&r) override {
+		if (r.status != 200)
+			return;
+
+		const std::string href = CurlUnescape(GetEasy(), r.href.c_str());
+		std::string_view path = uri_get_path(href);
+		if (path.data() == nullptr)
+			return;
+
+		/* kludge: ignoring case in this comparison (see
+		   HttpListDirectoryOperation::HrefToEscapedName()) */
+		path = StringAfterPrefixIgnoreCase(path, tree->base_path);
+		if (path.empty())
+			/* the collection itself, or outside of it */
+			return;
+
+		if (path.back() == '/')
+			path.remove_suffix(1);
+
+		if (path.empty() || path.front() == '/')
+			return;
+
+		std::string_view parent{}, name = path;
+		if (const auto slash = path.rfind('/'); slash != path.npos) {
+			parent = path.substr(0, slash);
+			name = path.substr(slash + 1);
+		}
+
+		auto &entries = tree->directories[std::string{parent}];
+		entries.emplace_front(name);
+
+		auto &info = entries.front().info;
+		info = StorageFileInfo(r.collection
+				       ? StorageFileInfo::Type::DIRECTORY
+				       : StorageFileInfo::Type::REGULAR);
+		info.size = r.length;
+		info.mtime = r.mtime;
+
+		if (r.collection)
+			/* make sure empty collections are known, too */
+			tree->directories.try_emplace(std::string{path});
+	}
+};
+
+bool
+CurlStorage::TakeFromTree(std::string_view path,
+			  MemoryStorageDirectoryReader::List &entries) noexcept
+{
+	if (!tree)
+		return false;
+
+	if (std::chrono::steady_clock::now() >= tree->expires) {
+		tree.reset();
+		return false;
+	}
+
+	auto relative = StringAfterPrefixIgnoreCase(path, tree->base_path);
+	if (relative.data() == nullptr)
+		return false;
+
+	if (!relative.empty() && relative.back() == '/')
+		relative.remove_suffix(1);
+
+	auto i = tree->directories.find(relative);
+	if (i == tree->directories.end())
+		return false;
+
+	entries = std::move(i->second);
+	tree->directories.erase(i);
+
+	if (tree->directories.empty())
+		tree.reset();
+
+	return true;
+}
+
 std::unique_ptr<StorageDirectoryReader>
 CurlStorage::OpenDirectory(std::string_view uri_utf8)
 {
@@ -566,6 +732,41 @@ CurlStorage::OpenDirectory(std::string_view uri_utf8)
 	if (uri.back() != '/')
 		uri.push_back('/');
 
+	const std::string path = CurlUnescape(UriPathOrSlash(uri.c_str()));
+
+	bool try_tree;
+
+	{
+		const std::scoped_lock<Mutex> lock(tree_mutex);
+		MemoryStorageDirectoryReader::List entries;
+		if (TakeFromTree(path, entries))
+			return std::make_unique<MemoryStorageDirectoryReader>(std::move(entries));
+
+		try_tree = tree_supported;
+	}
+
+	if (try_tree) {
+		try {
+			auto new_tree = HttpListTreeOperation(*curl, uri.c_str()).Perform();
+
+			const std::scoped_lock<Mutex> lock(tree_mutex);
+			tree = std::move(new_tree);
+
+			MemoryStorageDirectoryReader::List entries;
+			TakeFromTree(path, entries);
+			return std::make_unique<MemoryStorageDirectoryReader>(std::move(entries));
+		} catch (const HttpStatusError &e) {
+			if (e.GetStatus() == 404)
+				throw;
+
+			/* many servers refuse "Depth: infinity" (RFC
+			   4918 9.1 allows that, usually with "403
+			   Forbidden"); don't try again */
+			const std::scoped_lock<Mutex> lock(tree_mutex);
+			tree_supported = false;
+		}
+	}
+
 	return HttpListDirectoryOperation(*curl, uri.c_str()).Perform();
 }
 
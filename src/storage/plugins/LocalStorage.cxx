@@ -25,9 +25,92 @@
 #include "fs/AllocatedPath.hxx"
 #include "fs/DirectoryReader.hxx"
 #include "util/StringCompare.hxx"
+#include "io/uring/Features.h"
+
+#ifdef HAVE_URING
+#include "io/uring/Queue.hxx"
+#include "io/uring/StatxOperation.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "Log.hxx"
+
+#include <list>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/sysmacros.h> // for makedev()
+#endif
 
 #include <string>
 
+#ifdef HAVE_URING
+
+/**
+ * The maximum number of statx() calls submitted to the kernel at a
+ * time.
+ */
+static constexpr unsigned STATX_BATCH_SIZE = 256;
+
+/**
+ * A #Uring::Queue which does not submit each operation right away,
+ * so a whole batch can be submitted with one system call.
+ */
+class BatchUringQueue final : public Uring::Queue {
+public:
+	using Uring::Queue::Queue;
+
+	void Push(struct io_uring_sqe &sqe,
+		  Uring::Operation &operation) noexcept override {
+		AddPending(sqe, operation);
+	}
+};
+
+/**
+ * One #BatchUringQueue per thread; it is created on demand.  If
+ * io_uring is not available (old kernel, seccomp filter), this
+ * remembers the failure and the caller falls back to plain stat().
+ */
+static thread_local std::unique_ptr<BatchUringQueue> statx_queue;
+static thread_local bool statx_queue_failed = false;
+
+static BatchUringQueue *
+GetStatxQueue() noexcept
+{
+	if (!statx_queue && !statx_queue_failed) {
+		try {
+			statx_queue = std::make_unique<BatchUringQueue>(STATX_BATCH_SIZE,
+									0);
+		} catch (...) {
+			/* io_uring is optional; silently fall
+			   back to stat() */
+			statx_queue_failed = true;
+		}
+	}
+
+	return statx_queue.get();
+}
+
+static StorageFileInfo
+ToStorageFileInfo(const struct statx &st) noexcept
+{
+	StorageFileInfo info;
+
+	if (S_ISREG(st.stx_mode))
+		info.type = StorageFileInfo::Type::REGULAR;
+	else if (S_ISDIR(st.stx_mode))
+		info.type = StorageFileInfo::Type::DIRECTORY;
+	else
+		info.type = StorageFileInfo::Type::OTHER;
+
+	info.size = st.stx_size;
+	info.mtime = std::chrono::system_clock::from_time_t(st.stx_mtime.tv_sec);
+	info.device = makedev(st.stx_dev_major, st.stx_dev_minor);
+	info.inode = st.stx_ino;
+	return info;
+}
+
+#endif
+
 class LocalDirectoryReader final : public StorageDirectoryReader {
 	AllocatedPath base_fs;
 
@@ -35,6 +118,75 @@ class LocalDirectoryReader final : public StorageDirectoryReader {
 
 	std::string name_utf8;
 
+#ifdef HAVE_URING
+	/**
+	 * A directory entry whose metadata was obtained with a
+	 * batched asynchronous statx() call.
+	 */
+	struct Entry final : Uring::StatxHandler {
+		const AllocatedPath name_fs;
+		const std::string name_utf8;
+
+		/**
+		 * The file type (DT_*) from the directory listing.
+		 */
+		const unsigned char type;
+
+		Uring::StatxOperation operation;
+
+		StorageFileInfo info;
+
+		/**
+		 * An errno value, or -1 if statx() has not completed
+		 * (because io_uring has failed); in that case,
+		 * GetInfo() falls back to stat().
+		 */
+		int error = -1;
+
+		Entry(Path _name_fs, std::string &&_name_utf8,
+		      unsigned char _type) noexcept
+			:name_fs(_name_fs), name_utf8(std::move(_name_utf8)),
+			 type(_type) {}
+
+		/* virtual methods from class Uring::StatxHandler */
+		void OnStatx(const struct statx &st) noexcept override {
+			info = ToStorageFileInfo(st);
+			error = 0;
+		}
+
+		void OnStatxError(int _error) noexcept override {
+			error = _error;
+		}
+	};
+
+	/**
+	 * All entries of the directory, loaded by LoadBatch() on the
+	 * first Read() call.
+	 */
+	std::list<Entry> entries;
+
+	/**
+	 * The entry most recently returned by Read().
+	 */
+	std::list<Entry>::iterator current;
+
+	bool batch_loaded = false;
+
+	/**
+	 * Does #entries contain the directory listing?  If not,
+	 * entries are read from #reader one by one.
+	 */
+	bool batch = false;
+
+	/**
+	 * Read all directory entries and submit statx() calls for
+	 * them in batches of #STATX_BATCH_SIZE.
+	 *
+	 * @return false if io_uring is not available
+	 */
+	bool LoadBatch() noexcept;
+#endif
+
 public:
 	explicit LocalDirectoryReader(AllocatedPath &&_base_fs)
 		:base_fs(std::move(_base_fs)), reader(base_fs) {}
@@ -42,6 +194,10 @@ public:
 	/* virtual methods from class StorageDirectoryReader */
 	const char *Read() noexcept override;
 	StorageFileInfo GetInfo(bool follow) override;
+	bool MaybeSymlink() const noexcept override;
+
+private:
+	const char *ReadEntry() noexcept;
 };
 
 class LocalStorage final : public Storage {
@@ -71,9 +227,8 @@ private:
 };
 
 static StorageFileInfo
-Stat(Path path, bool follow)
+ToStorageFileInfo(const FileInfo &src) noexcept
 {
-	const FileInfo src(path, follow);
 	StorageFileInfo info;
 
 	if (src.IsRegular())
@@ -94,6 +249,12 @@ Stat(Path path, bool follow)
 	return info;
 }
 
+static StorageFileInfo
+Stat(Path path, bool follow)
+{
+	return ToStorageFileInfo(FileInfo(path, follow));
+}
+
 std::string
 LocalStorage::MapUTF8(std::string_view uri_utf8) const noexcept
 {
@@ -109,7 +270,7 @@ LocalStorage::MapFSOrThrow(std::string_view uri_utf8) const
 	if (uri_utf8.empty())
 		return base_fs;
 
-	return base_fs / AllocatedPath::FromUTF8Throw(uri_utf8);
+	return AllocatedPath::BuildUTF8Throw(base_fs, uri_utf8);
 }
 
 AllocatedPath
@@ -140,8 +301,75 @@ LocalStorage::OpenDirectory(std::string_view uri_utf8)
 	return std::make_unique<LocalDirectoryReader>(MapFSOrThrow(uri_utf8));
 }
 
+#ifdef HAVE_URING
+
+bool
+LocalDirectoryReader::LoadBatch() noexcept
+{
+	auto *queue = GetStatxQueue();
+	if (queue == nullptr)
+		return false;
+
+	UniqueFileDescriptor directory_fd;
+	if (!directory_fd.Open(base_fs.c_str(), O_PATH|O_DIRECTORY))
+		return false;
+
+	while (ReadEntry() != nullptr)
+		entries.emplace_back(reader.GetEntry(), std::move(name_utf8),
+				     reader.GetType());
+
+	try {
+		auto i = entries.begin();
+		while (i != entries.end()) {
+			for (unsigned n = 0; n < STATX_BATCH_SIZE && i != entries.end();
+			     ++n, ++i)
+				i->operation.Start(*queue, directory_fd,
+						   i->name_fs.c_str(),
+						   AT_STATX_DONT_SYNC,
+						   STATX_TYPE|STATX_MODE|STATX_SIZE|STATX_MTIME|STATX_INO,
+						   *i);
+
+			queue->Submit();
+
+			while (queue->HasPending())
+				queue->WaitDispatchOneCompletion();
+		}
+	} catch (...) {
+		/* the queue is in an undefined state; disable
+		   io_uring in this thread and fall back to stat()
+		   for all entries which have not completed */
+		LogError(std::current_exception());
+		statx_queue.reset();
+		statx_queue_failed = true;
+	}
+
+	return true;
+}
+
+#endif
+
 const char *
 LocalDirectoryReader::Read() noexcept
+{
+#ifdef HAVE_URING
+	if (!batch_loaded) {
+		batch_loaded = true;
+		batch = LoadBatch();
+		current = entries.begin();
+	} else if (batch && current != entries.end())
+		++current;
+
+	if (batch)
+		return current != entries.end()
+			? current->name_utf8.c_str()
+			: nullptr;
+#endif
+
+	return ReadEntry();
+}
+
+inline const char *
+LocalDirectoryReader::ReadEntry() noexcept
 {
 	while (reader.ReadEntry()) {
 		const Path name_fs = reader.GetEntry();
@@ -158,10 +386,71 @@ LocalDirectoryReader::Read() noexcept
 	return nullptr;
 }
 
+#ifndef _WIN32
+
+/**
+ * Is this a file type (DT_*) which is certainly not a symlink?
+ */
+static constexpr bool
+IsKnownNonSymlink(unsigned char type) noexcept
+{
+	return type != DT_UNKNOWN && type != DT_LNK;
+}
+
+#endif
+
 StorageFileInfo
 LocalDirectoryReader::GetInfo(bool follow)
 {
+#ifdef HAVE_URING
+	if (batch) {
+		assert(current != entries.end());
+
+		/* for a non-symlink, lstat() would return the same
+		   as the statx() call which follows symlinks */
+		if ((follow || IsKnownNonSymlink(current->type)) &&
+		    current->error == 0)
+			return current->info;
+
+		const auto path = base_fs / current->name_fs;
+		if (follow && current->error > 0)
+			throw FmtErrno(current->error,
+				       "Failed to access {}", path);
+
+		return Stat(path, follow);
+	}
+#endif
+
+#ifdef _WIN32
 	return Stat(base_fs / reader.GetEntry(), follow);
+#else
+	/* stat relative to the directory file descriptor, which
+	   avoids resolving the whole path again */
+	FileInfo fi;
+	if (!GetFileInfoAt(reader.GetFileDescriptor(), reader.GetEntry(),
+			   fi, follow))
+		throw FmtErrno("Failed to access {}",
+			       base_fs / reader.GetEntry());
+
+	return ToStorageFileInfo(fi);
+#endif
+}
+
+bool
+LocalDirectoryReader::MaybeSymlink() const noexcept
+{
+#ifdef _WIN32
+	return true;
+#else
+#ifdef HAVE_URING
+	if (batch) {
+		assert(current != entries.end());
+		return !IsKnownNonSymlink(current->type);
+	}
+#endif
+
+	return !IsKnownNonSymlink(reader.GetType());
+#endif
 }
 
 std::unique_ptr<Storage>
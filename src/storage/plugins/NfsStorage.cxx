@@ -25,6 +25,7 @@
 #include "lib/nfs/Blocking.hxx"
 #include "lib/nfs/Base.hxx"
 #include "lib/nfs/Lease.hxx"
+#include "lib/nfs/Callback.hxx"
 #include "lib/nfs/Connection.hxx"
 #include "lib/nfs/Glue.hxx"
 #include "fs/AllocatedPath.hxx"
@@ -42,12 +43,26 @@ extern "C" {
 #include <nfsc/libnfs-raw-nfs.h>
 }
 
+#include <algorithm>
 #include <cassert>
+#include <list>
 #include <string>
 
 #include <sys/stat.h>
 #include <fcntl.h>
 
+/**
+ * The maximum number of directory listings (READDIRPLUS) which are
+ * started in advance concurrently.
+ */
+static constexpr unsigned NFS_PREFETCH_CONCURRENCY = 8;
+
+/**
+ * The maximum number of directory listings which are kept (or
+ * queued) in advance.
+ */
+static constexpr std::size_t NFS_PREFETCH_MAX = 256;
+
 class NfsStorage final
 	: public Storage, NfsLease {
 
@@ -55,6 +70,37 @@ class NfsStorage final
 		INITIAL, CONNECTING, READY, DELAY,
 	};
 
+	/**
+	 * A directory listing which is obtained in advance, while the
+	 * caller (usually the database update) is still busy with its
+	 * parent directory.
+	 */
+	struct PrefetchedDirectory final : NfsCallback {
+		NfsStorage &storage;
+
+		/**
+		 * The libnfs path of this directory.
+		 */
+		const std::string path;
+
+		enum class State : uint8_t {
+			QUEUED, RUNNING, DONE, FAILED,
+		} state = State::QUEUED;
+
+		/**
+		 * The directory entries; only valid in State::DONE.
+		 */
+		MemoryStorageDirectoryReader::List entries;
+
+		PrefetchedDirectory(NfsStorage &_storage,
+				    std::string &&_path) noexcept
+			:storage(_storage), path(std::move(_path)) {}
+
+		/* virtual methods from NfsCallback */
+		void OnNfsCallback(unsigned status, void *data) noexcept override;
+		void OnNfsError(std::exception_ptr &&e) noexcept override;
+	};
+
 	const std::string base;
 
 	const std::string server, export_name;
@@ -64,11 +110,28 @@ class NfsStorage final
 	InjectEvent defer_connect;
 	CoarseTimerEvent reconnect_timer;
 
+	/**
+	 * Starts queued #prefetched listings in the I/O thread.
+	 */
+	InjectEvent defer_prefetch;
+
 	Mutex mutex;
 	Cond cond;
 	State state = State::INITIAL;
 	std::exception_ptr last_exception;
 
+	/**
+	 * Directory listings requested in advance, oldest first.
+	 * Protected by #mutex.
+	 */
+	std::list<PrefetchedDirectory> prefetched;
+
+	/**
+	 * The number of #prefetched items in
+	 * PrefetchedDirectory::State::RUNNING.  Protected by #mutex.
+	 */
+	unsigned n_prefetch_running = 0;
+
 public:
 	NfsStorage(EventLoop &_loop, const char *_base,
 		   std::string &&_server, std::string &&_export_name)
@@ -76,7 +139,8 @@ public:
 		 server(std::move(_server)),
 		 export_name(std::move(_export_name)),
 		 defer_connect(_loop, BIND_THIS_METHOD(OnDeferredConnect)),
-		 reconnect_timer(_loop, BIND_THIS_METHOD(OnReconnectTimer)) {
+		 reconnect_timer(_loop, BIND_THIS_METHOD(OnReconnectTimer)),
+		 defer_prefetch(_loop, BIND_THIS_METHOD(StartPrefetch)) {
 		nfs_init(_loop);
 	}
 
@@ -102,6 +166,7 @@ public:
 		assert(state == State::CONNECTING);
 
 		SetState(State::READY);
+		StartPrefetch();
 	}
 
 	void OnNfsConnectionFailed(std::exception_ptr e) noexcept final {
@@ -114,6 +179,7 @@ public:
 	void OnNfsConnectionDisconnected(std::exception_ptr e) noexcept final {
 		assert(state == State::READY);
 
+		CancelPrefetch();
 		SetState(State::DELAY, std::move(e));
 		reconnect_timer.Schedule(std::chrono::seconds(5));
 	}
@@ -196,9 +262,43 @@ private:
 		}
 	}
 
+	/**
+	 * Returns the prefetched listing of the given directory (if
+	 * any), waiting for it if it is still running.
+	 *
+	 * @return true if #entries was filled
+	 */
+	bool TakePrefetched(const std::string &path,
+			    MemoryStorageDirectoryReader::List &entries) noexcept;
+
+	/**
+	 * Queue listings of all subdirectories of the given
+	 * directory.
+	 */
+	void Prefetch(std::string_view uri_utf8,
+		      const MemoryStorageDirectoryReader::List &entries) noexcept;
+
+	/**
+	 * Start queued listings, up to #NFS_PREFETCH_CONCURRENCY.
+	 * Must be called in the I/O thread.
+	 */
+	void StartPrefetch() noexcept;
+
+	/**
+	 * Cancel all running listings and discard all #prefetched
+	 * items.  Must be called in the I/O thread.
+	 */
+	void CancelPrefetch() noexcept;
+
+	void OnPrefetchFinished(PrefetchedDirectory &item,
+				PrefetchedDirectory::State new_state) noexcept;
+
 	void Disconnect() noexcept {
 		assert(!GetEventLoop().IsAlive() || GetEventLoop().IsInside());
 
+		defer_prefetch.Cancel();
+		CancelPrefetch();
+
 		switch (state) {
 		case State::INITIAL:
 			defer_connect.Cancel();
@@ -334,6 +434,35 @@ Copy(StorageFileInfo &info, const struct nfsdirent &ent)
 	info.inode = ent.inode;
 }
 
+static void
+CollectEntries(NfsConnection &connection, struct nfsdir *dir,
+	       MemoryStorageDirectoryReader::List &entries)
+{
+	assert(entries.empty());
+
+	const struct nfsdirent *ent;
+	while ((ent = connection.ReadDirectory(dir)) != nullptr) {
+#ifdef _WIN32
+		/* assume UTF-8 when accessing NFS from Windows */
+		const auto name_fs = AllocatedPath::FromUTF8Throw(ent->name);
+		if (name_fs.IsNull())
+			continue;
+#else
+		const Path name_fs = Path::FromFS(ent->name);
+#endif
+		if (SkipNameFS(name_fs.c_str()))
+			continue;
+
+		try {
+			entries.emplace_front(name_fs.ToUTF8Throw());
+			Copy(entries.front().info, *ent);
+		} catch (...) {
+			/* ignore files whose name cannot be converted
+			   to UTF-8 */
+		}
+	}
+}
+
 class NfsListDirectoryOperation final : public BlockingNfsOperation {
 	const char *const path;
 
@@ -344,8 +473,8 @@ public:
 				  const char *_path)
 		:BlockingNfsOperation(_connection), path(_path) {}
 
-	std::unique_ptr<StorageDirectoryReader> ToReader() {
-		return std::make_unique<MemoryStorageDirectoryReader>(std::move(entries));
+	MemoryStorageDirectoryReader::List &&TakeEntries() noexcept {
+		return std::move(entries);
 	}
 
 protected:
@@ -357,40 +486,180 @@ protected:
 			  void *data) noexcept override {
 		auto *const dir = (struct nfsdir *)data;
 
-		CollectEntries(dir);
+		CollectEntries(connection, dir, entries);
 		connection.CloseDirectory(dir);
 	}
-
-private:
-	void CollectEntries(struct nfsdir *dir);
 };
 
-inline void
-NfsListDirectoryOperation::CollectEntries(struct nfsdir *dir)
+void
+NfsStorage::PrefetchedDirectory::OnNfsCallback([[maybe_unused]] unsigned status,
+					       void *data) noexcept
 {
-	assert(entries.empty());
+	auto *const dir = (struct nfsdir *)data;
 
-	const struct nfsdirent *ent;
-	while ((ent = connection.ReadDirectory(dir)) != nullptr) {
-#ifdef _WIN32
-		/* assume UTF-8 when accessing NFS from Windows */
-		const auto name_fs = AllocatedPath::FromUTF8Throw(ent->name);
-		if (name_fs.IsNull())
-			continue;
-#else
-		const Path name_fs = Path::FromFS(ent->name);
-#endif
-		if (SkipNameFS(name_fs.c_str()))
+	CollectEntries(*storage.connection, dir, entries);
+	storage.connection->CloseDirectory(dir);
+
+	storage.OnPrefetchFinished(*this, State::DONE);
+}
+
+void
+NfsStorage::PrefetchedDirectory::OnNfsError(std::exception_ptr &&) noexcept
+{
+	/* the error will be reported by the blocking fallback in
+	   OpenDirectory() */
+	storage.OnPrefetchFinished(*this, State::FAILED);
+}
+
+void
+NfsStorage::OnPrefetchFinished(PrefetchedDirectory &item,
+			       PrefetchedDirectory::State new_state) noexcept
+{
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+		assert(item.state == PrefetchedDirectory::State::RUNNING);
+		assert(n_prefetch_running > 0);
+
+		item.state = new_state;
+		--n_prefetch_running;
+		cond.notify_all();
+	}
+
+	StartPrefetch();
+}
+
+void
+NfsStorage::StartPrefetch() noexcept
+{
+	assert(GetEventLoop().IsInside());
+
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (state != State::READY)
+		return;
+
+	for (auto &i : prefetched) {
+		if (n_prefetch_running >= NFS_PREFETCH_CONCURRENCY)
+			break;
+
+		if (i.state != PrefetchedDirectory::State::QUEUED)
 			continue;
 
 		try {
-			entries.emplace_front(name_fs.ToUTF8Throw());
-			Copy(entries.front().info, *ent);
+			connection->OpenDirectory(i.path.c_str(), i);
+			i.state = PrefetchedDirectory::State::RUNNING;
+			++n_prefetch_running;
 		} catch (...) {
-			/* ignore files whose name cannot be converted
-			   to UTF-8 */
+			i.state = PrefetchedDirectory::State::FAILED;
+		}
+	}
+}
+
+void
+NfsStorage::CancelPrefetch() noexcept
+{
+	assert(!GetEventLoop().IsAlive() || GetEventLoop().IsInside());
+
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	for (auto &i : prefetched) {
+		if (i.state == PrefetchedDirectory::State::RUNNING)
+			connection->Cancel(i);
+	}
+
+	/* wake up waiters in TakePrefetched(); they will fall back
+	   to a blocking listing */
+	prefetched.clear();
+	n_prefetch_running = 0;
+	cond.notify_all();
+}
+
+bool
+NfsStorage::TakePrefetched(const std::string &path,
+			   MemoryStorageDirectoryReader::List &entries) noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+
+	const auto match = [&path](const PrefetchedDirectory &i){
+		return i.path == path;
+	};
+
+	auto i = std::find_if(prefetched.begin(), prefetched.end(), match);
+	if (i == prefetched.end())
+		return false;
+
+	if (i->state == PrefetchedDirectory::State::RUNNING) {
+		cond.wait(lock, [this, &match]{
+			auto j = std::find_if(prefetched.begin(),
+					      prefetched.end(), match);
+			return j == prefetched.end() ||
+				j->state != PrefetchedDirectory::State::RUNNING;
+		});
+
+		/* the list may have been modified while waiting */
+		i = std::find_if(prefetched.begin(), prefetched.end(), match);
+		if (i == prefetched.end())
+			return false;
+	}
+
+	const bool done = i->state == PrefetchedDirectory::State::DONE;
+	if (done)
+		entries = std::move(i->entries);
+
+	prefetched.erase(i);
+	return done;
+}
+
+void
+NfsStorage::Prefetch(std::string_view uri_utf8,
+		     const MemoryStorageDirectoryReader::List &entries) noexcept
+{
+	bool added = false;
+
+	{
+		const std::scoped_lock<Mutex> protect(mutex);
+
+		for (const auto &entry : entries) {
+			if (!entry.info.IsDirectory())
+				continue;
+
+			std::string path;
+			try {
+				path = UriToNfsPath(uri_utf8.empty()
+						    ? entry.name
+						    : PathTraitsUTF8::Build(uri_utf8,
+									    entry.name));
+			} catch (...) {
+				continue;
+			}
+
+			if (std::any_of(prefetched.begin(), prefetched.end(),
+					[&path](const PrefetchedDirectory &i){
+						return i.path == path;
+					}))
+				continue;
+
+			if (prefetched.size() >= NFS_PREFETCH_MAX) {
+				/* evict the oldest item which is not
+				   running */
+				auto i = std::find_if(prefetched.begin(),
+						      prefetched.end(),
+						      [](const PrefetchedDirectory &j){
+							      return j.state != PrefetchedDirectory::State::RUNNING;
+						      });
+				if (i == prefetched.end())
+					break;
+
+				prefetched.erase(i);
+			}
+
+			prefetched.emplace_back(*this, std::move(path));
+			added = true;
 		}
 	}
+
+	if (added)
+		defer_prefetch.Schedule();
 }
 
 std::unique_ptr<StorageDirectoryReader>
@@ -400,10 +669,16 @@ NfsStorage::OpenDirectory(std::string_view uri_utf8)
 
 	WaitConnected();
 
-	NfsListDirectoryOperation operation(*connection, path.c_str());
-	operation.Run();
+	MemoryStorageDirectoryReader::List entries;
+	if (!TakePrefetched(path, entries)) {
+		NfsListDirectoryOperation operation(*connection, path.c_str());
+		operation.Run();
+		entries = operation.TakeEntries();
+	}
+
+	Prefetch(uri_utf8, entries);
 
-	return operation.ToReader();
+	return std::make_unique<MemoryStorageDirectoryReader>(std::move(entries));
 }
 
 static std::unique_ptr<Storage>
@@ -22,9 +22,8 @@
 #include "storage/StorageInterface.hxx"
 #include "storage/FileInfo.hxx"
 #include "lib/smbclient/Init.hxx"
-#include "lib/smbclient/Context.hxx"
+#include "lib/smbclient/Pool.hxx"
 #include "fs/Traits.hxx"
-#include "thread/Mutex.hxx"
 #include "system/Error.hxx"
 #include "util/ASCII.hxx"
 #include "util/StringCompare.hxx"
@@ -32,20 +31,23 @@
 
 #include <libsmbclient.h>
 
-class SmbclientStorage;
-
 class SmbclientDirectoryReader final : public StorageDirectoryReader {
-	SmbclientStorage &storage;
+	/**
+	 * The context which owns the #handle; it is used exclusively
+	 * by this object until it is destructed.
+	 */
+	SmbclientContextPool::Lease ctx;
+
 	const std::string base;
 	SMBCFILE *const handle;
 
 	const char *name;
 
 public:
-	SmbclientDirectoryReader(SmbclientStorage &_storage,
+	SmbclientDirectoryReader(SmbclientContextPool::Lease &&_ctx,
 				 std::string &&_base,
 				 SMBCFILE *_handle) noexcept
-		:storage(_storage), base(std::move(_base)), handle(_handle) {}
+		:ctx(std::move(_ctx)), base(std::move(_base)), handle(_handle) {}
 
 	~SmbclientDirectoryReader() override;
 
@@ -55,21 +57,21 @@ public:
 };
 
 class SmbclientStorage final : public Storage {
-	friend class SmbclientDirectoryReader;
-
 	const std::string base;
 
 	/**
-	 * This mutex protects all calls into the #SmbclientContext,
-	 * which is not thread-safe.
+	 * A #SmbclientContext is not thread-safe; this pool gives
+	 * each concurrent operation its own context.
 	 */
-	Mutex mutex;
-
-	SmbclientContext ctx = SmbclientContext::New();
+	SmbclientContextPool pool;
 
 public:
 	explicit SmbclientStorage(const char *_base)
-		:base(_base) {}
+		:base(_base) {
+		/* create the first context right away to report
+		   errors early */
+		pool.Get();
+	}
 
 	/* virtual methods from class Storage */
 	StorageFileInfo GetInfo(std::string_view uri_utf8, bool follow) override;
@@ -97,15 +99,11 @@ SmbclientStorage::MapToRelativeUTF8(std::string_view uri_utf8) const noexcept
 }
 
 static StorageFileInfo
-GetInfo(SmbclientContext &ctx, Mutex &mutex, const char *path)
+GetInfo(SmbclientContext &ctx, const char *path)
 {
 	struct stat st;
-
-	{
-		const std::scoped_lock<Mutex> protect(mutex);
-		if (ctx.Stat(path, st) != 0)
-			throw MakeErrno("Failed to access file");
-	}
+	if (ctx.Stat(path, st) != 0)
+		throw MakeErrno("Failed to access file");
 
 	StorageFileInfo info;
 	if (S_ISREG(st.st_mode))
@@ -126,7 +124,8 @@ StorageFileInfo
 SmbclientStorage::GetInfo(std::string_view uri_utf8, [[maybe_unused]] bool follow)
 {
 	const std::string mapped = MapUTF8(uri_utf8);
-	return ::GetInfo(ctx, mutex, mapped.c_str());
+	auto ctx = pool.Get();
+	return ::GetInfo(*ctx, mapped.c_str());
 }
 
 std::unique_ptr<StorageDirectoryReader>
@@ -134,17 +133,12 @@ SmbclientStorage::OpenDirectory(std::string_view uri_utf8)
 {
 	std::string mapped = MapUTF8(uri_utf8);
 
-	SMBCFILE *handle;
-
-	{
-		const std::scoped_lock<Mutex> protect(mutex);
-		handle = ctx.OpenDirectory(mapped.c_str());
-	}
-
+	auto ctx = pool.Get();
+	SMBCFILE *handle = ctx->OpenDirectory(mapped.c_str());
 	if (handle == nullptr)
 		throw MakeErrno("Failed to open directory");
 
-	return std::make_unique<SmbclientDirectoryReader>(*this,
+	return std::make_unique<SmbclientDirectoryReader>(std::move(ctx),
 							  std::move(mapped),
 							  handle);
 }
@@ -158,16 +152,13 @@ SkipNameFS(PathTraitsFS::const_pointer name) noexcept
 
 SmbclientDirectoryReader::~SmbclientDirectoryReader()
 {
-	const std::scoped_lock<Mutex> lock(storage.mutex);
-	storage.ctx.CloseDirectory(handle);
+	ctx->CloseDirectory(handle);
 }
 
 const char *
 SmbclientDirectoryReader::Read() noexcept
 {
-	const std::scoped_lock<Mutex> protect(storage.mutex);
-
-	while (auto e = storage.ctx.ReadDirectory(handle)) {
+	while (auto e = ctx->ReadDirectory(handle)) {
 		name = e->name;
 		if (!SkipNameFS(name))
 			return name;
@@ -180,7 +171,7 @@ StorageFileInfo
 SmbclientDirectoryReader::GetInfo([[maybe_unused]] bool follow)
 {
 	const std::string path = PathTraitsUTF8::Build(base, name);
-	return ::GetInfo(storage.ctx, storage.mutex, path.c_str());
+	return ::GetInfo(*ctx, path.c_str());
 }
 
 static std::unique_ptr<Storage>
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "SamplingProfiler.hxx"
+#include "Symbol.hxx"
+#include "Error.hxx"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include <execinfo.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+struct SamplingProfiler::Sample {
+	pid_t tid;
+
+	unsigned depth;
+
+	void *frames[MAX_DEPTH];
+};
+
+/**
+ * Is a #SamplingProfiler instance running?
+ */
+static std::atomic_bool profiler_running{false};
+
+/**
+ * The samples array of the running #SamplingProfiler; nullptr if
+ * there is none.  The signal handler writes to it.
+ */
+static std::atomic<SamplingProfiler::Sample *> active_samples{nullptr};
+static std::size_t active_capacity;
+
+/**
+ * The index of the next sample to be written; may be larger than
+ * #active_capacity if samples were dropped.
+ */
+static std::atomic_size_t next_sample;
+
+/**
+ * The number of signal handlers currently running.  Used to wait
+ * until nobody uses #active_samples anymore.
+ */
+static std::atomic_uint handlers_running;
+
+/**
+ * The signal handler is installed once and never removed, because
+ * a SIGPROF still pending after the timer was disarmed would
+ * otherwise terminate the process.
+ */
+static bool handler_installed = false;
+
+static void
+OnSigprof(int, siginfo_t *, void *) noexcept
+{
+	const int saved_errno = errno;
+
+	++handlers_running;
+
+	if (auto *samples = active_samples.load()) {
+		const std::size_t i =
+			next_sample.fetch_add(1, std::memory_order_relaxed);
+		if (i < active_capacity) {
+			auto &sample = samples[i];
+			sample.tid = syscall(SYS_gettid);
+			sample.depth = backtrace(sample.frames,
+						 SamplingProfiler::MAX_DEPTH);
+		}
+	}
+
+	--handlers_running;
+
+	errno = saved_errno;
+}
+
+static void
+InstallSigprofHandler()
+{
+	if (handler_installed)
+		return;
+
+	struct sigaction sa{};
+	sa.sa_sigaction = OnSigprof;
+	sa.sa_flags = SA_SIGINFO|SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	if (sigaction(SIGPROF, &sa, nullptr) < 0)
+		throw MakeErrno("sigaction(SIGPROF) failed");
+
+	handler_installed = true;
+}
+
+static void
+SetProfTimer(std::chrono::microseconds interval)
+{
+	struct itimerval value{};
+	value.it_interval.tv_sec = interval.count() / 1000000;
+	value.it_interval.tv_usec = interval.count() % 1000000;
+	value.it_value = value.it_interval;
+
+	if (setitimer(ITIMER_PROF, &value, nullptr) < 0)
+		throw MakeErrno("setitimer(ITIMER_PROF) failed");
+}
+
+SamplingProfiler::SamplingProfiler(unsigned frequency,
+				   std::size_t max_samples)
+	:capacity(max_samples)
+{
+	if (frequency == 0 || max_samples == 0)
+		throw std::invalid_argument("Invalid profiler parameters");
+
+	if (profiler_running.exchange(true))
+		throw std::runtime_error("The profiler is already running");
+
+	try {
+		samples = std::make_unique<Sample[]>(max_samples);
+
+		/* the first backtrace() call loads libgcc, which
+		   must not happen inside the signal handler */
+		void *dummy[1];
+		backtrace(dummy, 1);
+
+		InstallSigprofHandler();
+
+		next_sample = 0;
+		active_capacity = max_samples;
+		active_samples = samples.get();
+
+		SetProfTimer(std::chrono::microseconds(1000000 / frequency));
+	} catch (...) {
+		active_samples = nullptr;
+		profiler_running = false;
+		throw;
+	}
+}
+
+SamplingProfiler::~SamplingProfiler() noexcept
+{
+	if (samples != nullptr)
+		Disarm();
+}
+
+void
+SamplingProfiler::Disarm() noexcept
+{
+	try {
+		SetProfTimer({});
+	} catch (...) {
+	}
+
+	active_samples = nullptr;
+
+	/* wait until all signal handlers which may still see the
+	   old #active_samples value have finished */
+	while (handlers_running.load() > 0) {}
+
+	profiler_running = false;
+}
+
+/**
+ * Returns the name of the given thread of this process.
+ */
+static std::string
+GetThreadName(pid_t tid) noexcept
+{
+	const auto path = fmt::format("/proc/self/task/{}/comm", tid);
+	const int fd = open(path.c_str(), O_RDONLY|O_CLOEXEC);
+	if (fd >= 0) {
+		char buffer[64];
+		const auto nbytes = read(fd, buffer, sizeof(buffer));
+		close(fd);
+
+		std::string_view name{buffer, nbytes > 0 ? std::size_t(nbytes) : 0};
+		if (name.ends_with('\n'))
+			name.remove_suffix(1);
+		if (!name.empty())
+			return std::string{name};
+	}
+
+	/* the thread has exited meanwhile */
+	return fmt::format("thread-{}", tid);
+}
+
+SamplingProfiler::Result
+SamplingProfiler::Stop() noexcept
+{
+	Disarm();
+
+	const std::size_t n = next_sample.load();
+	Result result{};
+	result.n_samples = std::min(n, capacity);
+	result.n_dropped = n - result.n_samples;
+
+	std::unordered_map<pid_t, std::string> thread_names;
+	std::unordered_map<const void *, std::string> symbols;
+	std::map<std::string, std::size_t> stacks;
+
+	for (std::size_t i = 0; i < result.n_samples; ++i) {
+		const auto &sample = samples[i];
+
+		auto t = thread_names.find(sample.tid);
+		if (t == thread_names.end())
+			t = thread_names.emplace(sample.tid,
+						 GetThreadName(sample.tid)).first;
+
+		std::string stack = t->second;
+
+		/* skip OnSigprof() and the signal trampoline; the
+		   third frame is the interrupted function */
+		constexpr unsigned SKIP = 2;
+
+		for (unsigned j = sample.depth; j-- > SKIP;) {
+			/* return addresses point behind the call
+			   instruction, which may belong to the next
+			   function; subtract one to look up the
+			   caller */
+			const void *address = j > SKIP
+				? (const char *)sample.frames[j] - 1
+				: sample.frames[j];
+
+			auto s = symbols.find(address);
+			if (s == symbols.end())
+				s = symbols.emplace(address,
+						    LookupSymbolName(address)).first;
+
+			stack.push_back(';');
+			stack += s->second;
+		}
+
+		++stacks[std::move(stack)];
+	}
+
+	samples.reset();
+
+	for (const auto &[stack, count] : stacks)
+		fmt::format_to(std::back_inserter(result.folded),
+			       "{} {}\n", stack, count);
+
+	return result;
+}
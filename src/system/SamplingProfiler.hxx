@@ -0,0 +1,97 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_SYSTEM_SAMPLING_PROFILER_HXX
+#define MPD_SYSTEM_SAMPLING_PROFILER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * A simple built-in CPU profiler: SIGPROF (ITIMER_PROF) interrupts
+ * whichever thread is consuming CPU time, and the signal handler
+ * records its call stack with backtrace().  Stop() aggregates the
+ * samples in the "folded stacks" format understood by
+ * flamegraph.pl and similar tools, with the thread name (see
+ * thread/Name.hxx) as the root frame.
+ *
+ * Only one instance may be running at a time (because the signal
+ * handler is process-wide).
+ */
+class SamplingProfiler {
+public:
+	/**
+	 * The maximum stack depth recorded per sample.
+	 */
+	static constexpr std::size_t MAX_DEPTH = 32;
+
+	struct Sample;
+
+private:
+	std::unique_ptr<Sample[]> samples;
+
+	const std::size_t capacity;
+
+public:
+	/**
+	 * Throws on error, e.g. if another #SamplingProfiler is
+	 * already running.
+	 *
+	 * @param frequency the number of samples per second of CPU
+	 * time
+	 * @param max_samples the maximum number of samples to be
+	 * recorded; more samples are dropped
+	 */
+	SamplingProfiler(unsigned frequency, std::size_t max_samples);
+
+	/**
+	 * Stops sampling (if Stop() was not called already) and
+	 * discards the samples.
+	 */
+	~SamplingProfiler() noexcept;
+
+	SamplingProfiler(const SamplingProfiler &) = delete;
+	SamplingProfiler &operator=(const SamplingProfiler &) = delete;
+
+	struct Result {
+		/**
+		 * One line per distinct stack: frames separated by
+		 * semicolons (root first), a space and the number of
+		 * samples.
+		 */
+		std::string folded;
+
+		std::size_t n_samples, n_dropped;
+	};
+
+	/**
+	 * Stop sampling and return the folded stacks.  This
+	 * resolves symbol names (see LookupSymbolName()), which may
+	 * take a while.
+	 */
+	Result Stop() noexcept;
+
+private:
+	void Disarm() noexcept;
+};
+
+#endif
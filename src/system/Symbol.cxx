@@ -0,0 +1,59 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Symbol.hxx"
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+#include <cstdlib>
+#include <memory>
+#endif
+
+std::string
+LookupSymbolName(const void *address) noexcept
+{
+#ifndef _WIN32
+	Dl_info info;
+	if (dladdr(address, &info) != 0) {
+		if (info.dli_sname != nullptr) {
+			int status;
+			const std::unique_ptr<char, decltype(&free)>
+				demangled(abi::__cxa_demangle(info.dli_sname,
+							      nullptr, nullptr,
+							      &status),
+					  free);
+			if (demangled != nullptr)
+				return demangled.get();
+
+			return info.dli_sname;
+		}
+
+		if (info.dli_fname != nullptr)
+			return fmt::format("{}+{:#x}", info.dli_fname,
+					   (const char *)address - (const char *)info.dli_fbase);
+	}
+#endif
+
+	return fmt::format("{}", address);
+}
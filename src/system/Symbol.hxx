@@ -0,0 +1,36 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_SYSTEM_SYMBOL_HXX
+#define MPD_SYSTEM_SYMBOL_HXX
+
+#include <string>
+
+/**
+ * Convert a code address to a human readable (demangled) symbol
+ * name.  This requires the symbol to be exported (e.g. linking with
+ * "-rdynamic"); if it is not, the address relative to the binary is
+ * returned (e.g. "/usr/bin/mpd+0x1234"), which can be resolved with
+ * addr2line.
+ */
+std::string
+LookupSymbolName(const void *address) noexcept;
+
+#endif
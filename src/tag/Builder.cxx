@@ -36,7 +36,6 @@ TagBuilder::TagBuilder(const Tag &other) noexcept
 	const std::size_t n = other.num_items;
 	if (n > 0) {
 		items.reserve(other.num_items);
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
 		for (std::size_t i = 0; i != n; ++i)
 			items.push_back(tag_pool_dup_item(other.items[i]));
 	}
@@ -45,16 +44,10 @@ TagBuilder::TagBuilder(const Tag &other) noexcept
 TagBuilder::TagBuilder(Tag &&other) noexcept
 	:duration(other.duration), has_playlist(other.has_playlist)
 {
-	/* move all TagItem pointers from the Tag object; we don't
-	   need to contact the tag pool, because all we do is move
-	   references */
-	items.reserve(other.num_items);
-	std::copy_n(other.items, other.num_items, std::back_inserter(items));
-
-	/* discard the pointers from the Tag object */
-	other.num_items = 0;
-	delete[] other.items;
-	other.items = nullptr;
+	/* move all TagItem pointers from the Tag object; unless its
+	   array is shared, we don't need to contact the tag pool,
+	   because all we do is move references */
+	other.MoveItemsTo(items);
 }
 
 TagBuilder &
@@ -70,7 +63,6 @@ TagBuilder::operator=(const TagBuilder &other) noexcept
 		items = other.items;
 
 		/* increment the tag pool refcounters */
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
 		for (auto &i : items)
 			i = tag_pool_dup_item(i);
 	}
@@ -103,13 +95,7 @@ TagBuilder::operator=(Tag &&other) noexcept
 	   need to contact the tag pool, because all we do is move
 	   references */
 	RemoveAll();
-	items.reserve(other.num_items);
-	std::copy_n(other.items, other.num_items, std::back_inserter(items));
-
-	/* discard the pointers from the Tag object */
-	other.num_items = 0;
-	delete[] other.items;
-	other.items = nullptr;
+	other.MoveItemsTo(items);
 
 	return *this;
 }
@@ -135,10 +121,11 @@ TagBuilder::Commit(Tag &tag) noexcept
 	   vector::clear() call is important to detach them from this
 	   object */
 	const unsigned n_items = items.size();
-	tag.num_items = n_items;
-	tag.items = new TagItem *[n_items];
-	std::copy_n(items.begin(), n_items, tag.items);
-	items.clear();
+	if (n_items > 0) {
+		tag.num_items = n_items;
+		tag.items = Tag::AllocateItems(items);
+		items.clear();
+	}
 
 	/* now ensure that this object is fresh (will not delete any
 	   items because we've already moved them out) */
@@ -161,12 +148,43 @@ TagBuilder::CommitNew() noexcept
 	return tag;
 }
 
+Tag
+TagBuilder::ExtractDisabled() noexcept
+{
+	if (std::all_of(items.begin(), items.end(),
+			[](const TagItem *item) { return IsTagEnabled(item->type); }))
+		return {};
+
+	TagBuilder disabled;
+
+	const auto begin = items.begin(), end = items.end();
+	items.erase(std::remove_if(begin, end,
+				   [&disabled](TagItem *item) {
+					   if (IsTagEnabled(item->type))
+						   return false;
+					   disabled.items.push_back(item);
+					   return true;
+				   }),
+		    end);
+
+	return disabled.Commit();
+}
+
 bool
 TagBuilder::HasType(TagType type) const noexcept
 {
 	return std::any_of(items.begin(), items.end(), [type](const auto &i) { return i->type == type; });
 }
 
+bool
+TagBuilder::IsEqual(const Tag &other) const noexcept
+{
+	return duration == other.duration &&
+		has_playlist == other.has_playlist &&
+		std::equal(items.begin(), items.end(),
+			   other.items, other.items + other.num_items);
+}
+
 void
 TagBuilder::Complement(const Tag &other) noexcept
 {
@@ -186,7 +204,6 @@ TagBuilder::Complement(const Tag &other) noexcept
 
 		items.reserve(items.size() + n);
 
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
 		for (std::size_t i = 0; i != n; ++i) {
 			TagItem *item = other.items[i];
 			if (!present[item->type])
@@ -198,14 +215,7 @@ TagBuilder::Complement(const Tag &other) noexcept
 void
 TagBuilder::AddItemUnchecked(TagType type, std::string_view value) noexcept
 {
-	TagItem *i;
-
-	{
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
-		i = tag_pool_get_item(type, value);
-	}
-
-	items.push_back(i);
+	items.push_back(tag_pool_get_item(type, value));
 }
 
 inline void
@@ -223,7 +233,7 @@ TagBuilder::AddItemInternal(TagType type, std::string_view value) noexcept
 void
 TagBuilder::AddItem(TagType type, std::string_view value) noexcept
 {
-	if (value.empty() || !IsTagEnabled(type))
+	if (value.empty() || (!all_types && !IsTagEnabled(type)))
 		return;
 
 	AddItemInternal(type, value);
@@ -244,16 +254,8 @@ TagBuilder::AddEmptyItem(TagType type) noexcept
 void
 TagBuilder::RemoveAll() noexcept
 {
-	if (items.empty())
-		/* don't acquire the tag_pool_lock if we're not going
-		   to call tag_pool_put_item() anyway */
-		return;
-
-	{
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
-		for (auto i : items)
-			tag_pool_put_item(i);
-	}
+	for (auto i : items)
+		tag_pool_put_item(i);
 
 	items.clear();
 }
@@ -261,14 +263,8 @@ TagBuilder::RemoveAll() noexcept
 void
 TagBuilder::RemoveType(TagType type) noexcept
 {
-	if (items.empty())
-		/* don't acquire the tag_pool_lock if we're not going
-		   to call tag_pool_put_item() anyway */
-		return;
-
 	const auto begin = items.begin(), end = items.end();
 
-	const std::scoped_lock<Mutex> protect(tag_pool_lock);
 	items.erase(std::remove_if(begin, end,
 				   [type](TagItem *item) {
 					   if (item->type != type)
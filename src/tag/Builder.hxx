@@ -49,6 +49,12 @@ class TagBuilder {
 	/** an array of tag items */
 	std::vector<TagItem *> items;
 
+	/**
+	 * Shall AddItem() accept tag types which are disabled in the
+	 * configuration (see #global_tag_mask)?
+	 */
+	bool all_types = false;
+
 public:
 	/**
 	 * Create an empty tag.
@@ -120,6 +126,22 @@ public:
 		items.reserve(n);
 	}
 
+	/**
+	 * Let AddItem() accept all tag types, even those which are
+	 * disabled by "metadata_to_use".  Use ExtractDisabled() to
+	 * separate them again.
+	 */
+	void AcceptAllTypes() noexcept {
+		all_types = true;
+	}
+
+	/**
+	 * Remove all items whose tag type is disabled (see
+	 * AcceptAllTypes()) and return them as a new #Tag, which has
+	 * neither duration nor the "has_playlist" flag.
+	 */
+	Tag ExtractDisabled() noexcept;
+
 	/**
 	 * Checks whether the tag contains one or more items with
 	 * the specified type.
@@ -127,6 +149,14 @@ public:
 	[[gnu::pure]]
 	bool HasType(TagType type) const noexcept;
 
+	/**
+	 * Would Commit() create a #Tag equal to the given one?  This
+	 * is cheap, because the tag pool deduplicates items: equal
+	 * items have equal pointers.
+	 */
+	[[gnu::pure]]
+	bool IsEqual(const Tag &other) const noexcept;
+
 	/**
 	 * Copy attributes and items from the other object that do not
 	 * exist in this object.
@@ -46,6 +46,7 @@ IcyMetaDataParser::Reset() noexcept
 	if (data_rest == 0 && meta_size > 0)
 		delete[] meta_data;
 
+	last_tag.Clear();
 	tag.reset();
 
 	data_rest = data_size;
@@ -133,8 +134,8 @@ find_end_quote(char *p, char *const end) noexcept
 	}
 }
 
-static std::unique_ptr<Tag>
-icy_parse_tag(
+static void
+icy_parse_tag(TagBuilder &tag,
 #ifdef HAVE_ICU_CONVERTER
 	      const IcuConverter *icu_converter,
 #endif
@@ -144,8 +145,6 @@ icy_parse_tag(
 	assert(end != nullptr);
 	assert(p <= end);
 
-	TagBuilder tag;
-
 	while (p != end) {
 		const char *const name = p;
 		char *eq = std::find(p, end, '=');
@@ -186,8 +185,6 @@ icy_parse_tag(
 			break;
 		p = semicolon + 1;
 	}
-
-	return tag.CommitNew();
 }
 
 size_t
@@ -234,13 +231,22 @@ IcyMetaDataParser::Meta(const void *data, size_t length) noexcept
 	if (meta_position == meta_size) {
 		/* parse */
 
-		tag = icy_parse_tag(
+		icy_parse_tag(tag_builder,
 #ifdef HAVE_ICU_CONVERTER
-				    icu_converter.get(),
+			      icu_converter.get(),
 #endif
-				    meta_data, meta_data + meta_size);
+			      meta_data, meta_data + meta_size);
 		delete[] meta_data;
 
+		if (tag_builder.IsEqual(last_tag)) {
+			/* same as last time, don't bother the
+			   consumer */
+			tag_builder.Clear();
+		} else {
+			tag = tag_builder.CommitNew();
+			last_tag = Tag{*tag};
+		}
+
 		/* change back to normal data mode */
 
 		meta_size = 0;
@@ -260,7 +266,10 @@ IcyMetaDataParser::ParseInPlace(void *data, size_t length) noexcept
 	while (length > 0) {
 		size_t chunk = Data(length);
 		if (chunk > 0) {
-			memmove(dest, src, chunk);
+			if (dest != src)
+				/* only move data after a metadata
+				   block was removed */
+				memmove(dest, src, chunk);
 			dest += chunk;
 			src += chunk;
 			length -= chunk;
@@ -21,9 +21,11 @@
 #define MPD_ICY_META_DATA_PARSER_HXX
 
 #include "lib/icu/Converter.hxx"
+#include "tag/Builder.hxx"
 #include "tag/Tag.hxx"
 #include "config.h"
 
+#include <cassert>
 #include <cstddef>
 #include <memory>
 
@@ -37,6 +39,19 @@ class IcyMetaDataParser {
 	std::unique_ptr<IcuConverter> icu_converter;
 #endif
 
+	/**
+	 * Reused for parsing each metadata block, to avoid
+	 * reallocating its item list.
+	 */
+	TagBuilder tag_builder;
+
+	/**
+	 * The tag parsed from the previous metadata block.  Many
+	 * servers repeat the same title in every block; those
+	 * duplicates are not passed to ReadTag().
+	 */
+	Tag last_tag;
+
 	std::unique_ptr<Tag> tag;
 
 public:
@@ -58,6 +73,7 @@ public:
 	void Start(size_t _data_size) noexcept {
 		data_size = data_rest = _data_size;
 		meta_size = 0;
+		last_tag.Clear();
 		tag = nullptr;
 	}
 
@@ -88,6 +104,34 @@ public:
 	 */
 	size_t Meta(const void *data, size_t length) noexcept;
 
+	/**
+	 * Returns the number of normal data bytes before the next
+	 * metadata block.  If this is zero, the caller must feed
+	 * metadata to Meta().  This allows the caller to read normal
+	 * data directly into its destination buffer, without ever
+	 * having to remove metadata from it.
+	 */
+	size_t GetDataRest() const noexcept {
+		assert(IsDefined());
+
+		return data_rest;
+	}
+
+	/**
+	 * Returns the number of metadata bytes which Meta() expects
+	 * next.  Only valid if GetDataRest() returns zero.  At the
+	 * start of a metadata block, this is 1 (the length byte),
+	 * because the block size is not yet known.
+	 */
+	size_t GetMetaRest() const noexcept {
+		assert(IsDefined());
+		assert(data_rest == 0);
+
+		return meta_size > 0
+			? meta_size - meta_position
+			: 1;
+	}
+
 	/**
 	 * Parse data and eliminate metadata.
 	 *
@@ -25,9 +25,23 @@
 #include <id3tag.h>
 
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 static constexpr size_t ID3V1_SIZE = 128;
 
+/**
+ * The size of an ID3v2 tag header, footer and (v2.3 and v2.4) frame
+ * header.
+ */
+static constexpr size_t ID3V2_HEADER_SIZE = 10;
+
+static constexpr id3_byte_t ID3V2_FLAG_UNSYNCHRONISATION = 0x80;
+static constexpr id3_byte_t ID3V2_FLAG_EXTENDED_HEADER = 0x40;
+static constexpr id3_byte_t ID3V2_FLAG_FOOTER = 0x10;
+
 [[gnu::pure]]
 static inline bool
 tag_is_id3v1(struct id3_tag *tag) noexcept
@@ -48,8 +62,169 @@ try {
 	return 0;
 }
 
+static constexpr uint_least32_t
+ParseSyncSafe(const id3_byte_t *p) noexcept
+{
+	return (uint_least32_t(p[0] & 0x7f) << 21) |
+		(uint_least32_t(p[1] & 0x7f) << 14) |
+		(uint_least32_t(p[2] & 0x7f) << 7) |
+		uint_least32_t(p[3] & 0x7f);
+}
+
+static constexpr uint_least32_t
+ParseBigEndian32(const id3_byte_t *p) noexcept
+{
+	return (uint_least32_t(p[0]) << 24) |
+		(uint_least32_t(p[1]) << 16) |
+		(uint_least32_t(p[2]) << 8) |
+		uint_least32_t(p[3]);
+}
+
+static constexpr void
+WriteSyncSafe(id3_byte_t *p, uint_least32_t value) noexcept
+{
+	p[0] = (value >> 21) & 0x7f;
+	p[1] = (value >> 14) & 0x7f;
+	p[2] = (value >> 7) & 0x7f;
+	p[3] = value & 0x7f;
+}
+
+/**
+ * Skip the given number of bytes.  Unlike InputStream::Skip(), this
+ * reads and discards the data if seeking is expensive.
+ */
+static void
+SkipBytes(InputStream &is, std::unique_lock<Mutex> &lock, size_t size)
+{
+	if (is.CheapSeeking()) {
+		is.Skip(lock, size);
+		return;
+	}
+
+	id3_byte_t buffer[4096];
+	while (size > 0) {
+		const size_t nbytes = std::min(size, sizeof(buffer));
+		is.ReadFull(lock, buffer, nbytes);
+		size -= nbytes;
+	}
+}
+
+/**
+ * Is this a frame which is needed by scan_id3_tag() (or the
+ * ReplayGain/MixRamp parsers) if pictures are not wanted?
+ */
+[[gnu::pure]]
+static bool
+IsScannedFrame(const id3_byte_t *id) noexcept
+{
+	/* all text frames, including "TXXX" (which contains
+	   ReplayGain, MixRamp and MusicBrainz tags) */
+	return id[0] == 'T' ||
+		memcmp(id, "COMM", 4) == 0 ||
+		memcmp(id, "UFID", 4) == 0 ||
+		memcmp(id, "RVA2", 4) == 0 ||
+		memcmp(id, "SEEK", 4) == 0;
+}
+
+/**
+ * Read the rest of an ID3v2.3 or ID3v2.4 tag, but copy only the
+ * frames accepted by IsScannedFrame(); all others (e.g. large
+ * "APIC" pictures) are skipped without loading them into memory.
+ * The kept frames are parsed as a new tag.
+ *
+ * @param header the tag header which has already been read
+ * @param tag_size the total size of the tag according to
+ * id3_tag_query()
+ */
 static UniqueId3Tag
-ReadId3Tag(InputStream &is, std::unique_lock<Mutex> &lock)
+ReadId3TagScannedFrames(InputStream &is, std::unique_lock<Mutex> &lock,
+			const id3_byte_t *header, size_t tag_size)
+{
+	static_assert(ID3_TAG_QUERYSIZE == ID3V2_HEADER_SIZE);
+
+	const unsigned version = header[3];
+	const size_t frames_size = ParseSyncSafe(header + 6);
+	assert(frames_size + ID3V2_HEADER_SIZE <= tag_size);
+
+	std::vector<id3_byte_t> buffer(header, header + ID3V2_HEADER_SIZE);
+
+	size_t remaining = frames_size;
+	while (remaining >= ID3V2_HEADER_SIZE) {
+		id3_byte_t frame_header[ID3V2_HEADER_SIZE];
+		is.ReadFull(lock, frame_header, sizeof(frame_header));
+		remaining -= sizeof(frame_header);
+
+		if (frame_header[0] == 0)
+			/* padding */
+			break;
+
+		const size_t frame_size = version >= 4
+			? ParseSyncSafe(frame_header + 4)
+			: ParseBigEndian32(frame_header + 4);
+		if (frame_size > remaining)
+			/* malformed; ignore the rest */
+			break;
+
+		remaining -= frame_size;
+
+		if (!IsScannedFrame(frame_header)) {
+			SkipBytes(is, lock, frame_size);
+			continue;
+		}
+
+		const size_t position = buffer.size();
+		buffer.resize(position + sizeof(frame_header) + frame_size);
+		std::copy_n(frame_header, sizeof(frame_header),
+			    buffer.data() + position);
+		is.ReadFull(lock, buffer.data() + position + sizeof(frame_header),
+			    frame_size);
+	}
+
+	/* skip the rest of the tag (padding and footer), so the
+	   stream is positioned after it, just like after reading the
+	   whole tag */
+	SkipBytes(is, lock, remaining + tag_size - ID3V2_HEADER_SIZE -
+		  frames_size);
+
+	/* the new tag consists only of the header and the copied
+	   frames */
+	WriteSyncSafe(buffer.data() + 6, buffer.size() - ID3V2_HEADER_SIZE);
+	buffer[5] &= ~ID3V2_FLAG_FOOTER;
+
+	return UniqueId3Tag(id3_tag_parse(buffer.data(), buffer.size()));
+}
+
+/**
+ * Can ReadId3TagScannedFrames() handle this tag?
+ */
+[[gnu::pure]]
+static bool
+CanSkipFrames(const id3_byte_t *header) noexcept
+{
+	if (memcmp(header, "ID3", 3) != 0)
+		/* ID3v1 or a footer */
+		return false;
+
+	const unsigned version = header[3];
+	const id3_byte_t flags = header[5];
+
+	return (version == 3 || version == 4) &&
+		/* with version 2.3, unsynchronisation applies to the
+		   whole tag including the frame headers */
+		(version == 4 ||
+		 (flags & ID3V2_FLAG_UNSYNCHRONISATION) == 0) &&
+		/* the extended header may contain a CRC over all
+		   frames */
+		(flags & ID3V2_FLAG_EXTENDED_HEADER) == 0;
+}
+
+/**
+ * @param want_pictures if false, then frames which are not needed
+ * by scan_id3_tag() (e.g. pictures) may be omitted
+ */
+static UniqueId3Tag
+ReadId3Tag(InputStream &is, std::unique_lock<Mutex> &lock,
+	   bool want_pictures)
 try {
 	id3_byte_t query_buffer[ID3_TAG_QUERYSIZE];
 	is.ReadFull(lock, query_buffer, sizeof(query_buffer));
@@ -58,6 +233,11 @@ try {
 	long tag_size = id3_tag_query(query_buffer, sizeof(query_buffer));
 	if (tag_size <= 0) return nullptr;
 
+	if (!want_pictures && size_t(tag_size) > sizeof(query_buffer) &&
+	    CanSkipFrames(query_buffer))
+		return ReadId3TagScannedFrames(is, lock, query_buffer,
+					       tag_size);
+
 	/* Found a tag.  Allocate a buffer and read it in. */
 	if (size_t(tag_size) <= sizeof(query_buffer))
 		/* we have enough data already */
@@ -80,11 +260,12 @@ try {
 }
 
 static UniqueId3Tag
-ReadId3Tag(InputStream &is, std::unique_lock<Mutex> &lock, offset_type offset)
+ReadId3Tag(InputStream &is, std::unique_lock<Mutex> &lock, offset_type offset,
+	   bool want_pictures)
 try {
 	is.Seek(lock, offset);
 
-	return ReadId3Tag(is, lock);
+	return ReadId3Tag(is, lock, want_pictures);
 } catch (...) {
 	return nullptr;
 }
@@ -111,9 +292,10 @@ try {
 }
 
 static UniqueId3Tag
-tag_id3_find_from_beginning(InputStream &is, std::unique_lock<Mutex> &lock)
+tag_id3_find_from_beginning(InputStream &is, std::unique_lock<Mutex> &lock,
+			    bool want_pictures)
 try {
-	auto tag = ReadId3Tag(is, lock);
+	auto tag = ReadId3Tag(is, lock, want_pictures);
 	if (!tag) {
 		return nullptr;
 	} else if (tag_is_id3v1(tag.get())) {
@@ -130,7 +312,8 @@ try {
 			break;
 
 		/* Get the tag specified by the SEEK frame */
-		auto seektag = ReadId3Tag(is, lock, is.GetOffset() + seek);
+		auto seektag = ReadId3Tag(is, lock, is.GetOffset() + seek,
+					  want_pictures);
 		if (!seektag || tag_is_id3v1(seektag.get()))
 			break;
 
@@ -144,7 +327,8 @@ try {
 }
 
 static UniqueId3Tag
-tag_id3_find_from_end(InputStream &is, std::unique_lock<Mutex> &lock)
+tag_id3_find_from_end(InputStream &is, std::unique_lock<Mutex> &lock,
+		      bool want_pictures)
 try {
 	if (!is.KnownSize() || !is.CheapSeeking())
 		return nullptr;
@@ -174,7 +358,7 @@ try {
 		return v1tag;
 
 	/* Get the tag which the footer belongs to */
-	auto tag = ReadId3Tag(is, lock, offset - tag_size);
+	auto tag = ReadId3Tag(is, lock, offset - tag_size, want_pictures);
 	if (!tag)
 		return v1tag;
 
@@ -207,15 +391,15 @@ try {
 }
 
 UniqueId3Tag
-tag_id3_load(InputStream &is)
+tag_id3_load(InputStream &is, bool want_pictures)
 try {
 	std::unique_lock<Mutex> lock(is.mutex);
 
-	auto tag = tag_id3_find_from_beginning(is, lock);
+	auto tag = tag_id3_find_from_beginning(is, lock, want_pictures);
 	if (tag == nullptr && is.CheapSeeking()) {
 		tag = tag_id3_riff_aiff_load(is, lock);
 		if (tag == nullptr)
-			tag = tag_id3_find_from_end(is, lock);
+			tag = tag_id3_find_from_end(is, lock, want_pictures);
 	}
 
 	return tag;
@@ -27,9 +27,12 @@ class InputStream;
 /**
  * Loads the ID3 tags from the #InputStream into a libid3tag object.
  *
+ * @param want_pictures if false, then only the frames needed by
+ * scan_id3_tag() are loaded; others (e.g. large embedded pictures)
+ * are skipped without reading them into memory
  * @return nullptr on error or if no ID3 tag was found in the file
  */
 UniqueId3Tag
-tag_id3_load(InputStream &is);
+tag_id3_load(InputStream &is, bool want_pictures=true);
 
 #endif
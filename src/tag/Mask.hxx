@@ -25,10 +25,12 @@
 #include <cstdint>
 
 class TagMask {
-	typedef uint_least32_t mask_t;
+	typedef uint_least64_t mask_t;
 	mask_t value;
 
-	explicit constexpr TagMask(uint_least32_t _value) noexcept
+	static_assert(TAG_NUM_OF_ITEM_TYPES <= sizeof(mask_t) * 8);
+
+	explicit constexpr TagMask(mask_t _value) noexcept
 		:value(_value) {}
 
 public:
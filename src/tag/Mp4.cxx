@@ -0,0 +1,569 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Mp4.hxx"
+#include "Handler.hxx"
+#include "Table.hxx"
+#include "ParseName.hxx"
+#include "Id3MusicBrainz.hxx"
+#include "input/InputStream.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "util/ByteOrder.hxx"
+#include "Chrono.hxx"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * A "moov" box larger than this is not loaded; the caller shall
+ * fall back to a full decoder.
+ */
+static constexpr std::size_t MAX_MOOV_SIZE = 32 * 1024 * 1024;
+
+/**
+ * Maps "ilst" item types to the key names used by FFmpeg
+ * (libavformat/mov.c).
+ */
+static constexpr struct {
+	const char *type;
+	const char *name;
+} mp4_item_names[] = {
+	{ "\xa9nam", "title" },
+	{ "\xa9" "ART", "artist" },
+	{ "aART", "album_artist" },
+	{ "\xa9" "alb", "album" },
+	{ "\xa9" "day", "date" },
+	{ "\xa9gen", "genre" },
+	{ "\xa9wrt", "composer" },
+	{ "\xa9" "cmt", "comment" },
+	{ "\xa9grp", "grouping" },
+	{ "\xa9lyr", "lyrics" },
+	{ "\xa9too", "encoder" },
+	{ "cprt", "copyright" },
+	{ "desc", "description" },
+	{ "soal", "sort_album" },
+	{ "soar", "sort_artist" },
+	{ "soaa", "sort_album_artist" },
+	{ "sonm", "sort_name" },
+	{ "soco", "sort_composer" },
+	{ "trkn", "track" },
+	{ "disk", "disc" },
+};
+
+/**
+ * Key names which are not recognized by tag_name_parse_i().
+ */
+static constexpr struct tag_table mp4_tags[] = {
+	{ "album_artist", TAG_ALBUM_ARTIST },
+	{ "sort_album_artist", TAG_ALBUM_ARTIST_SORT },
+	{ "sort_album", TAG_ALBUM_SORT },
+	{ "sort_artist", TAG_ARTIST_SORT },
+	{ "sort_name", TAG_TITLE_SORT },
+	{ "sort_composer", TAG_COMPOSERSORT },
+
+	/* sentinel */
+	{ nullptr, TAG_NUM_OF_ITEM_TYPES }
+};
+
+[[gnu::pure]]
+static TagType
+ParseMp4TagName(std::string_view name) noexcept
+{
+	TagType type = tag_name_parse_i(name);
+	if (type != TAG_NUM_OF_ITEM_TYPES)
+		return type;
+
+	type = tag_table_lookup_i(mp4_tags, name);
+	if (type != TAG_NUM_OF_ITEM_TYPES)
+		return type;
+
+	return tag_table_lookup_i(musicbrainz_txxx_tags, name);
+}
+
+static constexpr uint16_t
+ReadBE16(const std::byte *p) noexcept
+{
+	return *(const PackedBE16 *)(const void *)p;
+}
+
+static constexpr uint32_t
+ReadBE32(const std::byte *p) noexcept
+{
+	return *(const PackedBE32 *)(const void *)p;
+}
+
+static constexpr uint64_t
+ReadBE64(const std::byte *p) noexcept
+{
+	return *(const PackedBE64 *)(const void *)p;
+}
+
+namespace {
+
+struct Mp4Box {
+	std::string_view type;
+	std::span<const std::byte> payload;
+};
+
+/**
+ * Iterates over the boxes in a buffer.
+ */
+class Mp4BoxIterator {
+	std::span<const std::byte> src;
+
+public:
+	explicit constexpr Mp4BoxIterator(std::span<const std::byte> _src) noexcept
+		:src(_src) {}
+
+	/**
+	 * @return false at the end of the buffer or if the data is
+	 * malformed
+	 */
+	bool Next(Mp4Box &box) noexcept {
+		if (src.size() < 8)
+			return false;
+
+		uint64_t size = ReadBE32(src.data());
+		box.type = {(const char *)src.data() + 4, 4};
+
+		std::size_t header_size = 8;
+		if (size == 1) {
+			/* 64 bit size */
+			if (src.size() < 16)
+				return false;
+
+			size = ReadBE64(src.data() + 8);
+			header_size = 16;
+		} else if (size == 0)
+			/* the box extends to the end */
+			size = src.size();
+
+		if (size < header_size || size > src.size())
+			return false;
+
+		box.payload = src.subspan(header_size, size - header_size);
+		src = src.subspan(size);
+		return true;
+	}
+};
+
+/**
+ * Everything ScanMp4() has found, to be passed to the #TagHandler
+ * after the whole "moov" box has been parsed.
+ */
+struct Mp4Info {
+	uint64_t duration = 0;
+	uint32_t timescale = 0;
+
+	AudioFormat audio_format = AudioFormat::Undefined();
+
+	std::vector<std::pair<std::string_view, std::string>> pairs;
+
+	std::span<const std::byte> picture;
+	const char *picture_mime_type = nullptr;
+};
+
+} // anonymous namespace
+
+/**
+ * Find the first child box with the given type.
+ *
+ * @return the payload, or a span with nullptr data if there is no
+ * such box
+ */
+[[gnu::pure]]
+static std::span<const std::byte>
+FindBox(std::span<const std::byte> src, std::string_view type) noexcept
+{
+	Mp4BoxIterator i{src};
+	Mp4Box box;
+	while (i.Next(box))
+		if (box.type == type)
+			return box.payload;
+
+	return {};
+}
+
+/**
+ * Parse a "mvhd" or "mdhd" box.
+ */
+static bool
+ParseMediaHeader(std::span<const std::byte> p,
+		 uint32_t &timescale, uint64_t &duration) noexcept
+{
+	if (p.size() < 4)
+		return false;
+
+	if (p[0] == std::byte{1}) {
+		/* version 1: 64 bit times */
+		if (p.size() < 32)
+			return false;
+
+		timescale = ReadBE32(p.data() + 20);
+		duration = ReadBE64(p.data() + 24);
+	} else {
+		if (p.size() < 20)
+			return false;
+
+		timescale = ReadBE32(p.data() + 12);
+		duration = ReadBE32(p.data() + 16);
+		if (duration == 0xffffffff)
+			/* unknown */
+			duration = UINT64_MAX;
+	}
+
+	return timescale > 0 && duration > 0 && duration != UINT64_MAX;
+}
+
+/**
+ * Parse the first entry of a "stsd" box of a sound track.
+ *
+ * @return false if the codec is not supported
+ */
+static bool
+ParseSoundSampleDescription(std::span<const std::byte> stsd,
+			    uint32_t timescale,
+			    AudioFormat &audio_format) noexcept
+{
+	/* skip version/flags and the entry count */
+	if (stsd.size() < 8)
+		return false;
+
+	Mp4Box entry;
+	if (!Mp4BoxIterator{stsd.subspan(8)}.Next(entry))
+		return false;
+
+	const auto p = entry.payload;
+	if (p.size() < 28)
+		return false;
+
+	const unsigned version = ReadBE16(p.data() + 8);
+	if (version > 1)
+		/* QuickTime sound description version 2 stores the
+		   format in a different way */
+		return false;
+
+	unsigned channels = ReadBE16(p.data() + 16);
+	const unsigned sample_size = ReadBE16(p.data() + 18);
+	unsigned sample_rate = ReadBE32(p.data() + 24) >> 16;
+
+	SampleFormat format;
+	if (entry.type == "mp4a"sv || entry.type == "Opus"sv ||
+	    entry.type == ".mp3"sv) {
+		/* lossy codecs are decoded to floating point by
+		   FFmpeg */
+		format = SampleFormat::FLOAT;
+	} else if (entry.type == "alac"sv || entry.type == "fLaC"sv) {
+		format = sample_size <= 16
+			? SampleFormat::S16
+			: SampleFormat::S32;
+
+		/* the 16.16 sample rate field overflows with more
+		   than 65535 Hz; the "alac" child box has the real
+		   values */
+		const std::size_t children = version == 1 ? 44 : 28;
+		const auto alac = entry.type == "alac"sv &&
+			p.size() >= children
+			? FindBox(p.subspan(children), "alac"sv)
+			: std::span<const std::byte>{};
+		if (alac.size() >= 28) {
+			format = uint8_t(alac[9]) <= 16
+				? SampleFormat::S16
+				: SampleFormat::S32;
+			channels = uint8_t(alac[13]);
+			sample_rate = ReadBE32(alac.data() + 24);
+		}
+	} else
+		return false;
+
+	if (sample_rate == 0)
+		sample_rate = timescale;
+
+	audio_format = AudioFormat(sample_rate, format, channels);
+	return audio_format.IsValid();
+}
+
+/**
+ * Parse a "trak" box.  Only the first sound track is evaluated.
+ *
+ * @return false if this is a sound track which cannot be parsed
+ */
+static bool
+ScanTrack(std::span<const std::byte> trak, Mp4Info &info) noexcept
+{
+	if (info.audio_format.IsDefined())
+		/* we have already seen a sound track */
+		return true;
+
+	const auto mdia = FindBox(trak, "mdia"sv);
+	const auto hdlr = FindBox(mdia, "hdlr"sv);
+	if (hdlr.size() < 12 ||
+	    std::string_view{(const char *)hdlr.data() + 8, 4} != "soun"sv)
+		/* not a sound track */
+		return true;
+
+	uint32_t timescale;
+	uint64_t duration;
+	if (ParseMediaHeader(FindBox(mdia, "mdhd"sv), timescale, duration)) {
+		info.timescale = timescale;
+		info.duration = duration;
+	}
+
+	const auto stbl = FindBox(FindBox(mdia, "minf"sv), "stbl"sv);
+	return ParseSoundSampleDescription(FindBox(stbl, "stsd"sv),
+					   info.timescale,
+					   info.audio_format);
+}
+
+/**
+ * Returns the value of the first "data" box of an "ilst" item.
+ *
+ * @param data_type receives the well-known type of the value
+ */
+static std::span<const std::byte>
+GetItemData(std::span<const std::byte> item, uint32_t &data_type) noexcept
+{
+	const auto data = FindBox(item, "data"sv);
+	if (data.size() < 8)
+		return {};
+
+	/* the first byte is the version, followed by a 24 bit type
+	   and a 32 bit locale */
+	data_type = ReadBE32(data.data()) & 0xffffff;
+	return data.subspan(8);
+}
+
+/**
+ * Returns the string in a "mean" or "name" box.
+ */
+static std::string_view
+GetFullBoxString(std::span<const std::byte> box) noexcept
+{
+	if (box.size() < 4)
+		return {};
+
+	return {(const char *)box.data() + 4, box.size() - 4};
+}
+
+static void
+ScanIlstItem(const Mp4Box &item, Mp4Info &info, bool want_picture)
+{
+	/* well-known data types */
+	static constexpr uint32_t UTF8 = 1, JPEG = 13, PNG = 14;
+
+	uint32_t data_type;
+	const auto value = GetItemData(item.payload, data_type);
+	if (value.data() == nullptr)
+		return;
+
+	if (item.type == "covr"sv) {
+		if (want_picture && info.picture.data() == nullptr &&
+		    (data_type == JPEG || data_type == PNG)) {
+			info.picture = value;
+			info.picture_mime_type = data_type == JPEG
+				? "image/jpeg"
+				: "image/png";
+		}
+
+		return;
+	}
+
+	if (item.type == "trkn"sv || item.type == "disk"sv) {
+		/* binary: 16 bit padding, 16 bit number, 16 bit
+		   total */
+		if (value.size() < 6)
+			return;
+
+		const unsigned number = ReadBE16(value.data() + 2);
+		const unsigned total = ReadBE16(value.data() + 4);
+		if (number == 0)
+			return;
+
+		std::string s = std::to_string(number);
+		if (total > 0) {
+			s.push_back('/');
+			s += std::to_string(total);
+		}
+
+		info.pairs.emplace_back(item.type == "trkn"sv
+					? "track"sv : "disc"sv,
+					std::move(s));
+		return;
+	}
+
+	if (data_type != UTF8)
+		return;
+
+	const std::string_view s{(const char *)value.data(), value.size()};
+
+	if (item.type == "----"sv) {
+		/* freeform item, e.g. "MusicBrainz Album Id" */
+		const auto name = GetFullBoxString(FindBox(item.payload,
+							   "name"sv));
+		if (!name.empty())
+			info.pairs.emplace_back(name, s);
+		return;
+	}
+
+	for (const auto &i : mp4_item_names) {
+		if (item.type == i.type) {
+			info.pairs.emplace_back(i.name, s);
+			return;
+		}
+	}
+}
+
+static void
+ScanMeta(std::span<const std::byte> meta, Mp4Info &info, bool want_picture)
+{
+	/* the ISO "meta" box is a full box; the QuickTime variant
+	   has no version/flags */
+	if (meta.size() >= 8 &&
+	    std::string_view{(const char *)meta.data() + 4, 4} != "hdlr"sv)
+		meta = meta.subspan(4);
+
+	Mp4BoxIterator i{FindBox(meta, "ilst"sv)};
+	Mp4Box item;
+	while (i.Next(item))
+		ScanIlstItem(item, info, want_picture);
+}
+
+/**
+ * Parse the contents of the "moov" box.
+ */
+static bool
+ScanMoov(std::span<const std::byte> moov, Mp4Info &info, bool want_picture)
+{
+	uint32_t movie_timescale = 0;
+	uint64_t movie_duration = 0;
+
+	Mp4BoxIterator i{moov};
+	Mp4Box box;
+	while (i.Next(box)) {
+		if (box.type == "mvhd"sv) {
+			if (!ParseMediaHeader(box.payload, movie_timescale,
+					      movie_duration))
+				movie_timescale = 0;
+		} else if (box.type == "trak"sv) {
+			if (!ScanTrack(box.payload, info))
+				return false;
+		} else if (box.type == "udta"sv) {
+			const auto meta = FindBox(box.payload, "meta"sv);
+			if (meta.data() != nullptr)
+				ScanMeta(meta, info, want_picture);
+		} else if (box.type == "mvex"sv)
+			/* fragmented file: the sample tables are
+			   incomplete */
+			return false;
+	}
+
+	if (!info.audio_format.IsDefined())
+		return false;
+
+	if (info.duration == 0 && movie_timescale > 0) {
+		info.timescale = movie_timescale;
+		info.duration = movie_duration;
+	}
+
+	return info.duration > 0;
+}
+
+static void
+InvokeHandler(const Mp4Info &info, TagHandler &handler) noexcept
+{
+	handler.OnDuration(SongTime::FromScale<uint64_t>(info.duration,
+							 info.timescale));
+	handler.OnAudioFormat(info.audio_format);
+
+	for (const auto &[name, value] : info.pairs) {
+		if (handler.WantPair())
+			handler.OnPair(name, value);
+
+		if (handler.WantTag()) {
+			const TagType type = ParseMp4TagName(name);
+			if (type != TAG_NUM_OF_ITEM_TYPES)
+				handler.OnTag(type, value);
+		}
+	}
+
+	if (info.picture.data() != nullptr)
+		handler.OnPicture(info.picture_mime_type, info.picture);
+}
+
+bool
+ScanMp4(InputStream &is, TagHandler &handler)
+{
+	std::unique_lock lock{is.mutex};
+
+	bool first = true;
+
+	while (!is.IsEOF()) {
+		std::byte header[16];
+		is.ReadFull(lock, header, 8);
+
+		uint64_t size = ReadBE32(header);
+		const std::string_view type{(const char *)header + 4, 4};
+
+		if (first && type != "ftyp"sv)
+			return false;
+
+		first = false;
+
+		std::size_t header_size = 8;
+		if (size == 1) {
+			is.ReadFull(lock, header + 8, 8);
+			size = ReadBE64(header + 8);
+			header_size = 16;
+		} else if (size == 0)
+			/* the last box, but we haven't seen "moov"
+			   yet */
+			return false;
+
+		if (size < header_size)
+			return false;
+
+		size -= header_size;
+
+		if (type == "moov"sv) {
+			if (size > MAX_MOOV_SIZE)
+				return false;
+
+			std::vector<std::byte> moov(size);
+			is.ReadFull(lock, moov.data(), moov.size());
+			lock.unlock();
+
+			Mp4Info info;
+			if (!ScanMoov(moov, info, handler.WantPicture()))
+				return false;
+
+			InvokeHandler(info, handler);
+			return true;
+		}
+
+		/* skip "mdat" and everything else */
+		is.Skip(lock, size);
+	}
+
+	return false;
+}
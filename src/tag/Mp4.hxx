@@ -0,0 +1,45 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_TAG_MP4_HXX
+#define MPD_TAG_MP4_HXX
+
+class InputStream;
+class TagHandler;
+
+/**
+ * Scan the tags, the duration and the audio format of an MP4 file
+ * (ISO base media file format, e.g. "m4a") by parsing only its
+ * "moov" box; all other top-level boxes (including the audio data in
+ * "mdat") are skipped with InputStream::Skip().  The key names
+ * passed to TagHandler::OnPair() are the same FFmpeg uses.
+ *
+ * Nothing is passed to the #TagHandler unless the file could be
+ * parsed completely, so the caller can fall back to a full decoder
+ * if this function fails.
+ *
+ * Throws on I/O error.
+ *
+ * @return false if this is not an MP4 file or if it uses features
+ * which are not supported by this parser
+ */
+bool
+ScanMp4(InputStream &is, TagHandler &handler);
+
+#endif
@@ -19,71 +19,231 @@
 
 #include "Pool.hxx"
 #include "Item.hxx"
+#include "thread/Mutex.hxx"
+#include "util/AllocatedString.hxx"
 #include "util/Cast.hxx"
+#include "util/StringAPI.hxx"
 #include "util/VarSize.hxx"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
-#include <limits>
+#include <memory>
 
 #include <string.h>
 #include <stdlib.h>
 
-Mutex tag_pool_lock;
+/**
+ * The pool is split into this many independent shards, each with its
+ * own lock, to reduce contention between threads.
+ */
+static constexpr std::size_t NUM_SHARDS = 64;
 
-static constexpr size_t NUM_SLOTS = 16127;
+/**
+ * The initial number of buckets per shard; must be a power of two.
+ */
+static constexpr std::size_t INITIAL_BUCKETS = 256;
 
 struct TagPoolSlot {
 	TagPoolSlot *next;
-	uint8_t ref = 1;
-	TagItem item;
 
-	static constexpr unsigned MAX_REF = std::numeric_limits<decltype(ref)>::max();
+	/**
+	 * The full hash value of #item; used to pick the shard and
+	 * the bucket, and to avoid recalculating it when the shard
+	 * grows.
+	 */
+	const unsigned hash;
+
+	/**
+	 * The reference counter.  It may be incremented without
+	 * holding the shard lock, but dropping the last reference
+	 * (and reviving a slot with no references) requires it.
+	 */
+	std::atomic_uint32_t ref{1};
+
+	/**
+	 * The cached results of tag_pool_get_folded() and
+	 * tag_pool_get_sort_key(); nullptr if they have not been
+	 * calculated yet.  If a result equals the value, it points
+	 * to TagItem::value; otherwise it is allocated with new[].
+	 */
+	std::atomic<char *> folded{nullptr}, sort_key{nullptr};
+
+	TagItem item;
 
-	TagPoolSlot(TagPoolSlot *_next, TagType type,
+	TagPoolSlot(TagPoolSlot *_next, unsigned _hash, TagType type,
 		    std::string_view value) noexcept
-		:next(_next) {
+		:next(_next), hash(_hash) {
 		item.type = type;
 		*std::copy(value.begin(), value.end(), item.value) = 0;
 	}
 
-	static TagPoolSlot *Create(TagPoolSlot *_next, TagType type,
+	~TagPoolSlot() noexcept {
+		FreeTransformed(folded.load(std::memory_order_relaxed));
+		FreeTransformed(sort_key.load(std::memory_order_relaxed));
+	}
+
+	TagPoolSlot(const TagPoolSlot &) = delete;
+	TagPoolSlot &operator=(const TagPoolSlot &) = delete;
+
+	void FreeTransformed(char *p) noexcept {
+		if (p != item.value)
+			delete[] p;
+	}
+
+	const char *GetTransformed(std::atomic<char *> &cache,
+				   TagPoolTransform transform) noexcept;
+
+	static TagPoolSlot *Create(TagPoolSlot *_next, unsigned _hash,
+				   TagType type,
 				   std::string_view value) noexcept;
 };
 
 TagPoolSlot *
-TagPoolSlot::Create(TagPoolSlot *_next, TagType type,
+TagPoolSlot::Create(TagPoolSlot *_next, unsigned _hash, TagType type,
 		    std::string_view value) noexcept
 {
 	TagPoolSlot *dummy;
 	return NewVarSize<TagPoolSlot>(sizeof(dummy->item.value),
 				       value.size() + 1,
-				       _next, type,
+				       _next, _hash, type,
 				       value);
 }
 
-static TagPoolSlot *slots[NUM_SLOTS];
+namespace {
 
-static inline unsigned
-calc_hash(TagType type, std::string_view p) noexcept
+struct TagPoolShard {
+	Mutex mutex;
+
+	std::unique_ptr<TagPoolSlot *[]> buckets;
+
+	/**
+	 * The number of elements in #buckets; always a power of two.
+	 */
+	std::size_t n_buckets = 0;
+
+	std::size_t n_slots = 0;
+
+	std::size_t lookups = 0, hits = 0;
+
+	TagPoolSlot **GetBucket(unsigned hash) noexcept {
+		assert(n_buckets > 0);
+
+		/* the low bits were used to pick the shard */
+		return &buckets[(hash / NUM_SHARDS) & (n_buckets - 1)];
+	}
+
+	/**
+	 * Double the number of buckets if the average chain is
+	 * longer than one slot.
+	 */
+	void MaybeGrow() noexcept;
+
+	TagItem *Get(unsigned hash, TagType type,
+		     std::string_view value) noexcept;
+
+	void Remove(TagPoolSlot &slot) noexcept;
+};
+
+}
+
+void
+TagPoolShard::MaybeGrow() noexcept
 {
-	unsigned hash = 5381;
+	if (n_buckets == 0) {
+		n_buckets = INITIAL_BUCKETS;
+		buckets = std::make_unique<TagPoolSlot *[]>(n_buckets);
+		return;
+	}
 
-	for (auto ch : p)
-		hash = (hash << 5) + hash + ch;
+	if (n_slots <= n_buckets)
+		return;
 
-	return hash ^ type;
+	auto old_buckets = std::move(buckets);
+	const std::size_t old_n_buckets = n_buckets;
+
+	n_buckets *= 2;
+	buckets = std::make_unique<TagPoolSlot *[]>(n_buckets);
+
+	for (std::size_t i = 0; i < old_n_buckets; ++i) {
+		for (TagPoolSlot *slot = old_buckets[i]; slot != nullptr;) {
+			TagPoolSlot *next = slot->next;
+			auto **bucket = GetBucket(slot->hash);
+			slot->next = *bucket;
+			*bucket = slot;
+			slot = next;
+		}
+	}
+}
+
+inline TagItem *
+TagPoolShard::Get(unsigned hash, TagType type,
+		  std::string_view value) noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	++lookups;
+
+	if (n_buckets > 0) {
+		for (auto slot = *GetBucket(hash); slot != nullptr;
+		     slot = slot->next) {
+			if (slot->hash == hash && slot->item.type == type &&
+			    value == slot->item.value) {
+				/* this may revive a slot whose last
+				   reference is just being dropped by
+				   another thread; see Remove() */
+				slot->ref.fetch_add(1, std::memory_order_relaxed);
+				++hits;
+				return &slot->item;
+			}
+		}
+	}
+
+	++n_slots;
+	MaybeGrow();
+
+	auto **bucket = GetBucket(hash);
+	auto slot = TagPoolSlot::Create(*bucket, hash, type, value);
+	*bucket = slot;
+	return &slot->item;
+}
+
+inline void
+TagPoolShard::Remove(TagPoolSlot &slot) noexcept
+{
+	const std::scoped_lock<Mutex> protect(mutex);
+
+	if (slot.ref.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		/* revived by Get() in the meantime */
+		return;
+
+	auto **slot_p = GetBucket(slot.hash);
+	while (*slot_p != &slot) {
+		assert(*slot_p != nullptr);
+		slot_p = &(*slot_p)->next;
+	}
+
+	*slot_p = slot.next;
+	--n_slots;
+
+	DeleteVarSize(&slot);
 }
 
+static std::array<TagPoolShard, NUM_SHARDS> shards;
+
 static inline unsigned
-calc_hash(TagType type, const char *p) noexcept
+calc_hash(TagType type, std::string_view p) noexcept
 {
 	unsigned hash = 5381;
 
-	assert(p != nullptr);
+	for (auto ch : p)
+		hash = (hash << 5) + hash + ch;
 
-	while (*p != 0)
-		hash = (hash << 5) + hash + *p++;
+	/* mix the high bits into the low bits, which are used to
+	   pick the shard */
+	hash ^= hash >> 16;
 
 	return hash ^ type;
 }
@@ -94,35 +254,23 @@ tag_item_to_slot(TagItem *item) noexcept
 	return &ContainerCast(*item, &TagPoolSlot::item);
 }
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, std::string_view value) noexcept
+static constexpr const TagPoolSlot &
+tag_item_to_slot(const TagItem &item) noexcept
 {
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
+	return ContainerCast(item, &TagPoolSlot::item);
 }
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, const char *value) noexcept
+static inline TagPoolShard &
+GetShard(unsigned hash) noexcept
 {
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
+	return shards[hash % NUM_SHARDS];
 }
 
 TagItem *
 tag_pool_get_item(TagType type, std::string_view value) noexcept
 {
-	auto slot_p = tag_value_slot_p(type, value);
-	for (auto slot = *slot_p; slot != nullptr; slot = slot->next) {
-		if (slot->item.type == type &&
-		    value == slot->item.value &&
-		    slot->ref < TagPoolSlot::MAX_REF) {
-			assert(slot->ref > 0);
-			++slot->ref;
-			return &slot->item;
-		}
-	}
-
-	auto slot = TagPoolSlot::Create(*slot_p, type, value);
-	*slot_p = slot;
-	return &slot->item;
+	const unsigned hash = calc_hash(type, value);
+	return GetShard(hash).Get(hash, type, value);
 }
 
 TagItem *
@@ -130,37 +278,106 @@ tag_pool_dup_item(TagItem *item) noexcept
 {
 	TagPoolSlot *slot = tag_item_to_slot(item);
 
-	assert(slot->ref > 0);
+	/* the caller owns a reference, therefore the slot cannot
+	   disappear and the counter cannot be zero; no lock
+	   needed */
+	[[maybe_unused]] const auto old_ref =
+		slot->ref.fetch_add(1, std::memory_order_relaxed);
+	assert(old_ref > 0);
 
-	if (slot->ref < TagPoolSlot::MAX_REF) {
-		++slot->ref;
-		return item;
-	} else {
-		/* the reference counter overflows above MAX_REF;
-		   obtain a reference to a different TagPoolSlot which
-		   isn't yet "full" */
-		return tag_pool_get_item(item->type, item->value);
-	}
+	return item;
 }
 
 void
 tag_pool_put_item(TagItem *item) noexcept
 {
-	TagPoolSlot **slot_p, *slot;
+	TagPoolSlot *slot = tag_item_to_slot(item);
 
-	slot = tag_item_to_slot(item);
-	assert(slot->ref > 0);
-	--slot->ref;
+	/* fast path: drop a reference which is not the last one
+	   without locking */
+	auto ref = slot->ref.load(std::memory_order_relaxed);
+	while (ref > 1)
+		if (slot->ref.compare_exchange_weak(ref, ref - 1,
+						    std::memory_order_release,
+						    std::memory_order_relaxed))
+			return;
 
-	if (slot->ref > 0)
-		return;
+	assert(ref == 1);
 
-	for (slot_p = tag_value_slot_p(item->type, item->value);
-	     *slot_p != slot;
-	     slot_p = &(*slot_p)->next) {
-		assert(*slot_p != nullptr);
+	/* this may be the last reference; only the shard lock can
+	   decide */
+	GetShard(slot->hash).Remove(*slot);
+}
+
+inline const char *
+TagPoolSlot::GetTransformed(std::atomic<char *> &cache,
+			    TagPoolTransform transform) noexcept
+{
+	if (const char *p = cache.load(std::memory_order_acquire);
+	    p != nullptr)
+		return p;
+
+	auto result = transform(item.value);
+	char *p = StringIsEqual(result.c_str(), item.value)
+		/* no change; don't waste memory on a copy */
+		? item.value
+		: result.Steal();
+
+	/* another thread may have been faster */
+	char *expected = nullptr;
+	if (!cache.compare_exchange_strong(expected, p,
+					   std::memory_order_acq_rel,
+					   std::memory_order_acquire)) {
+		FreeTransformed(p);
+		return expected;
+	}
+
+	return p;
+}
+
+/* the caches are not part of the item's value; mutating them through
+   a const reference is fine */
+
+const char *
+tag_pool_get_folded(const TagItem &item, TagPoolTransform fold) noexcept
+{
+	auto &slot = const_cast<TagPoolSlot &>(tag_item_to_slot(item));
+	return slot.GetTransformed(slot.folded, fold);
+}
+
+const char *
+tag_pool_get_sort_key(const TagItem &item,
+		      TagPoolTransform collate_key) noexcept
+{
+	auto &slot = const_cast<TagPoolSlot &>(tag_item_to_slot(item));
+	return slot.GetTransformed(slot.sort_key, collate_key);
+}
+
+TagPoolStats
+tag_pool_get_stats(bool walk_chains) noexcept
+{
+	TagPoolStats stats{};
+
+	for (auto &shard : shards) {
+		const std::scoped_lock<Mutex> protect(shard.mutex);
+
+		stats.n_slots += shard.n_slots;
+		stats.n_buckets += shard.n_buckets;
+		stats.lookups += shard.lookups;
+		stats.hits += shard.hits;
+
+		if (!walk_chains)
+			continue;
+
+		for (std::size_t i = 0; i < shard.n_buckets; ++i) {
+			std::size_t length = 0;
+			for (const TagPoolSlot *slot = shard.buckets[i];
+			     slot != nullptr; slot = slot->next)
+				++length;
+
+			stats.max_chain = std::max(stats.max_chain, length);
+		}
 	}
 
-	*slot_p = slot->next;
-	DeleteVarSize(slot);
+	return stats;
 }
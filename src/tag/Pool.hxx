@@ -21,13 +21,18 @@
 #define MPD_TAG_POOL_HXX
 
 #include "Type.h"
-#include "thread/Mutex.hxx"
 
+#include <cstddef>
 #include <string_view>
 
-extern Mutex tag_pool_lock;
-
 struct TagItem;
+class AllocatedString;
+
+/*
+ * The tag pool deduplicates #TagItem instances.  All functions are
+ * thread-safe; the pool is split into shards with separate locks,
+ * and tag_pool_dup_item() does not lock at all.
+ */
 
 [[nodiscard]]
 TagItem *
@@ -40,4 +45,70 @@ tag_pool_dup_item(TagItem *item) noexcept;
 void
 tag_pool_put_item(TagItem *item) noexcept;
 
+/**
+ * A function which transforms a tag value to a form for fuzzy
+ * comparisons, e.g. by case folding or by generating a collation
+ * sort key.
+ */
+using TagPoolTransform = AllocatedString (*)(std::string_view src) noexcept;
+
+/**
+ * Returns the canonical form of the item's value, as calculated by
+ * the given function.  It is calculated only the first time and then
+ * cached in the pool until the item is freed, which saves the work
+ * when the same values are compared over and over (e.g. by
+ * case-insensitive searches).  There is only one cache slot per item,
+ * so all callers must pass the same function.
+ *
+ * @param item an item obtained from tag_pool_get_item(); the caller
+ * must hold a reference
+ * @return the canonical form, valid as long as the caller holds the
+ * reference
+ */
+[[nodiscard]]
+const char *
+tag_pool_get_folded(const TagItem &item, TagPoolTransform fold) noexcept;
+
+/**
+ * Like tag_pool_get_folded(), but for a collation sort key (see
+ * IcuCollateKey()), which has its own cache slot.
+ */
+[[nodiscard]]
+const char *
+tag_pool_get_sort_key(const TagItem &item,
+		      TagPoolTransform collate_key) noexcept;
+
+struct TagPoolStats {
+	/**
+	 * The number of distinct items in the pool.
+	 */
+	std::size_t n_slots;
+
+	/**
+	 * The total number of hash buckets (in all shards).
+	 */
+	std::size_t n_buckets;
+
+	/**
+	 * The length of the longest hash chain.
+	 */
+	std::size_t max_chain;
+
+	/**
+	 * The number of tag_pool_get_item() calls and how many of
+	 * them found an existing item.
+	 */
+	std::size_t lookups, hits;
+};
+
+/**
+ * Obtain statistics about the tag pool (for debugging).
+ *
+ * @param walk_chains determine TagPoolStats::max_chain; this walks
+ * all hash chains and is therefore expensive
+ */
+[[gnu::pure]]
+TagPoolStats
+tag_pool_get_stats(bool walk_chains=true) noexcept;
+
 #endif
@@ -21,7 +21,85 @@
 #include "Pool.hxx"
 #include "Builder.hxx"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <iterator>
+#include <new>
+
+namespace {
+
+/**
+ * This header precedes each #Tag::items array.
+ */
+struct alignas(TagItem *) TagItemArrayHeader {
+	std::atomic_uint ref{1};
+};
+
+}
+
+static TagItemArrayHeader &
+GetHeader(TagItem **items) noexcept
+{
+	assert(items != nullptr);
+
+	return *(reinterpret_cast<TagItemArrayHeader *>(items) - 1);
+}
+
+/**
+ * The size of an #items array allocation for the given number of
+ * items: header, #TagItem pointers and the packed types.
+ */
+static constexpr std::size_t
+CalcItemsAllocationSize(std::size_t n) noexcept
+{
+	return sizeof(TagItemArrayHeader) +
+		n * (sizeof(TagItem *) + sizeof(TagType));
+}
+
+TagItem **
+Tag::AllocateItems(std::span<TagItem *const> src) noexcept
+{
+	assert(!src.empty());
+
+	void *p = ::operator new(CalcItemsAllocationSize(src.size()));
+	auto *header = new(p) TagItemArrayHeader();
+	auto *items = reinterpret_cast<TagItem **>(header + 1);
+	std::copy(src.begin(), src.end(), items);
+
+	auto *types = reinterpret_cast<TagType *>(items + src.size());
+	std::transform(src.begin(), src.end(), types,
+		       [](const TagItem *item){ return item->type; });
+
+	return items;
+}
+
+static void
+FreeItems(TagItem **items) noexcept
+{
+	auto &header = GetHeader(items);
+	header.~TagItemArrayHeader();
+	::operator delete(&header);
+}
+
+/**
+ * Release one reference to the array.  After the last reference
+ * has been released, all tag pool references are released and the
+ * array is freed.
+ */
+static void
+ReleaseItems(TagItem **items, unsigned num_items) noexcept
+{
+	assert(num_items > 0);
+
+	if (GetHeader(items).ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		/* this was the last reference to the array */
+		for (unsigned i = 0; i < num_items; ++i)
+			tag_pool_put_item(items[i]);
+
+		FreeItems(items);
+	}
+}
 
 void
 Tag::Clear() noexcept
@@ -29,29 +107,61 @@ Tag::Clear() noexcept
 	duration = SignedSongTime::Negative();
 	has_playlist = false;
 
-	if (num_items > 0) {
-		assert(items != nullptr);
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
-		for (unsigned i = 0; i < num_items; ++i)
-			tag_pool_put_item(items[i]);
+	if (items != nullptr) {
+		ReleaseItems(items, num_items);
+		items = nullptr;
 		num_items = 0;
 	}
-
-	delete[] items;
-	items = nullptr;
 }
 
 Tag::Tag(const Tag &other) noexcept
 	:duration(other.duration), has_playlist(other.has_playlist),
-	 num_items(other.num_items)
+	 num_items(other.num_items), items(other.items)
+{
+	if (items != nullptr)
+		GetHeader(items).ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool
+Tag::IsShared() const noexcept
+{
+	return items != nullptr &&
+		GetHeader(items).ref.load(std::memory_order_acquire) > 1;
+}
+
+void
+Tag::MoveItemsTo(std::vector<TagItem *> &dest) noexcept
 {
-	if (num_items > 0) {
-		items = new TagItem *[num_items];
+	if (items == nullptr)
+		return;
 
-		const std::scoped_lock<Mutex> protect(tag_pool_lock);
-		for (unsigned i = 0; i < num_items; i++)
-			items[i] = tag_pool_dup_item(other.items[i]);
+	dest.reserve(dest.size() + num_items);
+
+	if (IsShared()) {
+		/* somebody else still uses the array: duplicate
+		   the references and release ours */
+		for (unsigned i = 0; i < num_items; ++i)
+			dest.push_back(tag_pool_dup_item(items[i]));
+
+		ReleaseItems(items, num_items);
+	} else {
+		/* we have the only reference: move all TagItem
+		   pointers without contacting the tag pool */
+		std::copy_n(items, num_items, std::back_inserter(dest));
+		FreeItems(items);
 	}
+
+	items = nullptr;
+	num_items = 0;
+}
+
+std::size_t
+Tag::GetExclusiveMemoryUsage() const noexcept
+{
+	if (items == nullptr || IsShared())
+		return 0;
+
+	return CalcItemsAllocationSize(num_items);
 }
 
 Tag
@@ -82,6 +192,19 @@ Tag::Merge(std::unique_ptr<Tag> base, std::unique_ptr<Tag> add) noexcept
 	return MergePtr(*base, *add);
 }
 
+std::shared_ptr<const Tag>
+Tag::Merge(std::shared_ptr<const Tag> base,
+	   std::shared_ptr<const Tag> add) noexcept
+{
+	if (add == nullptr)
+		return base;
+
+	if (base == nullptr)
+		return add;
+
+	return MergePtr(*base, *add);
+}
+
 std::unique_ptr<Tag>
 Tag::Merge(const Tag *base, const Tag *add) noexcept
 {
@@ -98,22 +221,30 @@ Tag::Merge(const Tag *base, const Tag *add) noexcept
 	return MergePtr(*base, *add);
 }
 
-const char *
-Tag::GetValue(TagType type) const noexcept
+const TagItem *
+Tag::FindItem(TagType type) const noexcept
 {
 	assert(type < TAG_NUM_OF_ITEM_TYPES);
 
-	for (const auto &item : *this)
-		if (item.type == type)
-			return item.value;
+	const TagType *types = GetTypes();
+	for (unsigned i = 0; i < num_items; ++i)
+		if (types[i] == type)
+			return items[i];
 
 	return nullptr;
 }
 
+const char *
+Tag::GetValue(TagType type) const noexcept
+{
+	const auto *item = FindItem(type);
+	return item != nullptr ? item->value : nullptr;
+}
+
 bool
 Tag::HasType(TagType type) const noexcept
 {
-	return GetValue(type) != nullptr;
+	return FindItem(type) != nullptr;
 }
 
 static TagType
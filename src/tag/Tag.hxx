@@ -25,8 +25,11 @@
 #include "Chrono.hxx"
 #include "util/DereferenceIterator.hxx"
 
+#include <cstddef>
 #include <memory>
+#include <span>
 #include <utility>
+#include <vector>
 
 /**
  * The meta information about a song file.  It is a MPD specific
@@ -48,7 +51,15 @@ struct Tag {
 	/** the total number of tag items in the #items array */
 	unsigned short num_items = 0;
 
-	/** an array of tag items */
+	/**
+	 * An array of tag items.  It is allocated with
+	 * AllocateItems() and is reference counted: copying a #Tag
+	 * shares the array instead of duplicating it, and it is never
+	 * modified after it has been constructed (copy-on-write).
+	 *
+	 * The same allocation contains a packed array of the item
+	 * types right after the pointers, see GetTypes().
+	 */
 	TagItem **items = nullptr;
 
 	/**
@@ -56,6 +67,10 @@ struct Tag {
 	 */
 	Tag() = default;
 
+	/**
+	 * Copy the tag.  This is cheap because the #items array is
+	 * shared with the other object.
+	 */
 	Tag(const Tag &other) noexcept;
 
 	Tag(Tag &&other) noexcept
@@ -110,6 +125,53 @@ struct Tag {
 	 */
 	void Clear() noexcept;
 
+	/**
+	 * Allocate a new (reference counted) #items array, copy the
+	 * given #TagItem pointers (without touching their reference
+	 * counters) and their types into it.  The caller is
+	 * responsible for assigning it to #items.
+	 */
+	static TagItem **AllocateItems(std::span<TagItem *const> src) noexcept;
+
+	/**
+	 * Returns the types of all items, in the same order as
+	 * #items.  This array is stored contiguously after the
+	 * #items pointers, so looking for a certain tag type does not
+	 * need to dereference the (scattered) #TagItem pointers.
+	 */
+	const TagType *GetTypes() const noexcept {
+		return reinterpret_cast<const TagType *>(items + num_items);
+	}
+
+	/**
+	 * Returns the first item of the specified tag type, or
+	 * nullptr if none is present in this tag object.
+	 */
+	[[gnu::pure]]
+	const TagItem *FindItem(TagType type) const noexcept;
+
+	/**
+	 * Is the #items array shared with other #Tag objects?
+	 */
+	[[gnu::pure]]
+	bool IsShared() const noexcept;
+
+	/**
+	 * Move all #TagItem references into the given vector and
+	 * clear the item list of this object.  If the array is shared
+	 * with other #Tag objects, the references are duplicated
+	 * instead.
+	 */
+	void MoveItemsTo(std::vector<TagItem *> &dest) noexcept;
+
+	/**
+	 * Estimate the heap memory (in bytes) used by this object
+	 * exclusively, i.e. excluding the #TagItem objects (which
+	 * live in the tag pool) and excluding a shared #items array.
+	 */
+	[[gnu::pure]]
+	std::size_t GetExclusiveMemoryUsage() const noexcept;
+
 	/**
 	 * Merges the data from two tags.  If both tags share data for the
 	 * same TagType, only data from "add" is used.
@@ -131,6 +193,14 @@ struct Tag {
 	static std::unique_ptr<Tag> Merge(std::unique_ptr<Tag> base,
 					  std::unique_ptr<Tag> add) noexcept;
 
+	/**
+	 * Merges the data from two shared tags.  Any of the two may
+	 * be nullptr; if one of them is, the other one is returned
+	 * without copying it.
+	 */
+	static std::shared_ptr<const Tag> Merge(std::shared_ptr<const Tag> base,
+						std::shared_ptr<const Tag> add) noexcept;
+
 	/**
 	 * Merges the data from two tags.  Any of the two may be nullptr.
 	 *
@@ -29,10 +29,34 @@ VisitTagType(const Tag &tag, TagType type, F &&f) noexcept
 {
 	bool found = false;
 
-	for (const auto &item : tag) {
-		if (item.type == type) {
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i) {
+		if (types[i] == type) {
 			found = true;
-			f(item.value);
+			f(tag.items[i]->value);
+		}
+	}
+
+	return found;
+}
+
+/**
+ * Like VisitTagType(), but pass the (pooled) #TagItem pointer instead
+ * of the string value.  The pointer identifies the value uniquely
+ * (per #TagType) as long as a reference is held, see
+ * tag_pool_dup_item().
+ */
+template<typename F>
+bool
+VisitTagItemType(const Tag &tag, TagType type, F &&f) noexcept
+{
+	bool found = false;
+
+	const TagType *types = tag.GetTypes();
+	for (unsigned i = 0; i < tag.num_items; ++i) {
+		if (types[i] == type) {
+			found = true;
+			f(tag.items[i]);
 		}
 	}
 
@@ -57,4 +81,18 @@ VisitTagWithFallbackOrEmpty(const Tag &tag, TagType type, F &&f) noexcept
 		f("");
 }
 
+/**
+ * Like VisitTagWithFallbackOrEmpty(), but pass #TagItem pointers;
+ * nullptr stands for the empty value.
+ */
+template<typename F>
+void
+VisitTagItemWithFallbackOrEmpty(const Tag &tag, TagType type, F &&f) noexcept
+{
+	if (!ApplyTagWithFallback(type, [&](TagType type2) {
+		return VisitTagItemType(tag, type2, f);
+	}))
+		f(nullptr);
+}
+
 #endif
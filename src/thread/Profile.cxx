@@ -0,0 +1,107 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Profile.hxx"
+#include "Util.hxx"
+#include "Slack.hxx"
+
+#include <array>
+#include <atomic>
+
+static std::array<ThreadProfile, std::size_t(ThreadProfileType::MAX)> thread_profiles;
+
+static PowerProfile power_profile = PowerProfile::DEFAULT;
+
+static std::array<std::atomic<uint_least64_t>,
+		  std::size_t(ThreadProfileType::MAX)> thread_wakeups;
+
+void
+SetThreadProfile(ThreadProfileType type, ThreadProfile &&profile) noexcept
+{
+	thread_profiles[std::size_t(type)] = std::move(profile);
+}
+
+/**
+ * Returns the built-in timer slack for the given kind of thread, or
+ * a negative value to keep the kernel default.
+ */
+[[gnu::const]]
+static std::chrono::microseconds
+GetDefaultTimerSlack(ThreadProfileType type, PowerProfile power) noexcept
+{
+	using namespace std::chrono_literals;
+
+	if (power == PowerProfile::EFFICIENCY)
+		/* with large device buffers, a few milliseconds of
+		   delay do not matter; let the kernel merge these
+		   timers with other wakeups */
+		return type == ThreadProfileType::OUTPUT ? 5ms : 20ms;
+
+	if (type == ThreadProfileType::OUTPUT)
+		return 100us;
+
+	return std::chrono::microseconds{-1};
+}
+
+bool
+ApplyThreadProfile(ThreadProfileType type)
+{
+	const auto &profile = thread_profiles[std::size_t(type)];
+
+	auto timer_slack = profile.timer_slack;
+	if (timer_slack.count() < 0)
+		timer_slack = GetDefaultTimerSlack(type, power_profile);
+	if (timer_slack.count() >= 0)
+		SetThreadTimerSlack(timer_slack);
+
+	if (!profile.cpus.empty())
+		SetThreadAffinity(profile.cpus);
+
+	if (profile.realtime_priority < 0)
+		return false;
+
+	if (profile.realtime_priority > 0)
+		SetThreadRealtime(profile.realtime_priority);
+
+	return true;
+}
+
+void
+SetPowerProfile(PowerProfile profile) noexcept
+{
+	power_profile = profile;
+}
+
+PowerProfile
+GetPowerProfile() noexcept
+{
+	return power_profile;
+}
+
+void
+CountThreadWakeup(ThreadProfileType type) noexcept
+{
+	thread_wakeups[std::size_t(type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint_least64_t
+GetThreadWakeups(ThreadProfileType type) noexcept
+{
+	return thread_wakeups[std::size_t(type)].load(std::memory_order_relaxed);
+}
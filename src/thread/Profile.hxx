@@ -0,0 +1,126 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_PROFILE_HXX
+#define MPD_THREAD_PROFILE_HXX
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * The threads which can be tuned with a #ThreadProfile.
+ */
+enum class ThreadProfileType : uint8_t {
+	DECODER,
+	PLAYER,
+	OUTPUT,
+	UPDATE,
+
+	MAX
+};
+
+/**
+ * Scheduling settings for one kind of thread, configured with a
+ * "thread" block in mpd.conf.
+ */
+struct ThreadProfile {
+	/**
+	 * The CPUs this thread may run on.  An empty list means no
+	 * restriction.
+	 */
+	std::vector<unsigned> cpus;
+
+	/**
+	 * The SCHED_FIFO priority.  0 means normal scheduling; a
+	 * negative value means the thread's built-in default
+	 * (real-time for outputs, idle for the database update).
+	 */
+	int realtime_priority = -1;
+
+	/**
+	 * The timer slack (see prctl(PR_SET_TIMERSLACK)).  A
+	 * negative value means the default of the configured
+	 * #PowerProfile.
+	 */
+	std::chrono::microseconds timer_slack{-1};
+};
+
+/**
+ * The "power_profile" setting.
+ */
+enum class PowerProfile : uint8_t {
+	/**
+	 * Optimize for low latency.
+	 */
+	DEFAULT,
+
+	/**
+	 * Optimize for few CPU wakeups: larger device buffers,
+	 * decoding in large bursts, more timer slack.  This allows
+	 * the CPU to stay in deep sleep states longer.
+	 */
+	EFFICIENCY,
+};
+
+/**
+ * Install a profile.  This must be called during startup, before
+ * the affected threads are launched.
+ */
+void
+SetThreadProfile(ThreadProfileType type, ThreadProfile &&profile) noexcept;
+
+/**
+ * Apply the configured profile to the current thread.
+ *
+ * Throws std::system_error on error.
+ *
+ * @return true if a priority has been configured; false if the
+ * caller shall apply its own default priority
+ */
+bool
+ApplyThreadProfile(ThreadProfileType type);
+
+/**
+ * Install the power profile.  This must be called during startup,
+ * before the affected threads are launched.
+ */
+void
+SetPowerProfile(PowerProfile profile) noexcept;
+
+[[gnu::pure]]
+PowerProfile
+GetPowerProfile() noexcept;
+
+/**
+ * Count one wakeup of a thread of the given kind, i.e. it has
+ * returned from waiting for work.
+ */
+void
+CountThreadWakeup(ThreadProfileType type) noexcept;
+
+/**
+ * Returns the total number of wakeups counted by
+ * CountThreadWakeup().
+ */
+[[gnu::pure]]
+uint_least64_t
+GetThreadWakeups(ThreadProfileType type) noexcept;
+
+#endif
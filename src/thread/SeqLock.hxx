@@ -0,0 +1,104 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_SEQ_LOCK_HXX
+#define MPD_THREAD_SEQ_LOCK_HXX
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * A sequence lock: publishes a small value from one writer thread
+ * to any number of readers, without ever blocking the writer.
+ * Readers retry if they have raced with the writer.
+ *
+ * The value is stored in relaxed atomic words, so there is no data
+ * race even when a reader observes a torn copy (which it then
+ * discards).
+ *
+ * Store() calls must be serialized by the caller.
+ */
+template<typename T>
+requires std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+class SeqLock {
+	using Word = uint32_t;
+
+	static constexpr std::size_t N_WORDS =
+		(sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+	using Buffer = std::array<Word, N_WORDS>;
+
+	/**
+	 * Incremented before and after each Store(); an odd value
+	 * means a Store() is in progress.
+	 */
+	std::atomic<unsigned> sequence{0};
+
+	std::array<std::atomic<Word>, N_WORDS> words{};
+
+public:
+	SeqLock() noexcept {
+		Store(T{});
+	}
+
+	explicit SeqLock(const T &value) noexcept {
+		Store(value);
+	}
+
+	SeqLock(const SeqLock &) = delete;
+	SeqLock &operator=(const SeqLock &) = delete;
+
+	void Store(const T &value) noexcept {
+		Buffer buffer{};
+		std::memcpy(buffer.data(), &value, sizeof(value));
+
+		const unsigned s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (std::size_t i = 0; i < N_WORDS; ++i)
+			words[i].store(buffer[i], std::memory_order_relaxed);
+
+		sequence.store(s + 2, std::memory_order_release);
+	}
+
+	T Load() const noexcept {
+		Buffer buffer;
+		unsigned before, after;
+
+		do {
+			before = sequence.load(std::memory_order_acquire);
+
+			for (std::size_t i = 0; i < N_WORDS; ++i)
+				buffer[i] = words[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+		} while (before != after || (before & 1) != 0);
+
+		T value;
+		std::memcpy(&value, buffer.data(), sizeof(value));
+		return value;
+	}
+};
+
+#endif
@@ -98,10 +98,16 @@ SetThreadIdlePriority() noexcept
 
 void
 SetThreadRealtime()
+{
+	SetThreadRealtime(40);
+}
+
+void
+SetThreadRealtime([[maybe_unused]] int priority)
 {
 #ifdef __linux__
 	struct sched_param sched_param;
-	sched_param.sched_priority = 40;
+	sched_param.sched_priority = priority;
 
 	int policy = SCHED_FIFO;
 #ifdef SCHED_RESET_ON_FORK
@@ -112,3 +118,17 @@ SetThreadRealtime()
 		throw MakeErrno("sched_setscheduler failed");
 #endif	// __linux__
 }
+
+void
+SetThreadAffinity([[maybe_unused]] std::span<const unsigned> cpus)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const unsigned cpu : cpus)
+		CPU_SET(cpu, &set);
+
+	if (sched_setaffinity(0, sizeof(set), &set) < 0)
+		throw MakeErrno("sched_setaffinity failed");
+#endif	// __linux__
+}
@@ -74,6 +74,14 @@ public:
 		return function != nullptr;
 	}
 
+	/**
+	 * Returns the address of the wrapper function, which
+	 * identifies the bound method (but not the instance).
+	 */
+	const void *GetFunctionAddress() const noexcept {
+		return reinterpret_cast<const void *>(function);
+	}
+
 	R operator()(Args... args) const {
 		return function(instance_, std::forward<Args>(args)...);
 	}
@@ -19,6 +19,8 @@
 
 #include "BitReverse.hxx"
 
+#include <string.h>
+
 static constexpr BitReverseTable
 GenerateBitReverseTable() noexcept
 {
@@ -29,3 +31,30 @@ GenerateBitReverseTable() noexcept
 }
 
 const BitReverseTable bit_reverse_table = GenerateBitReverseTable();
+
+/* the compiler lowers these to SSE2 on x86 and NEON on ARM */
+typedef uint8_t BitReverseVector __attribute__((vector_size(16)));
+
+[[gnu::always_inline]]
+static inline BitReverseVector
+BitReverse(BitReverseVector v) noexcept
+{
+	v = (v >> 4) | (v << 4);
+	v = ((v >> 2) & 0x33) | ((v & 0x33) << 2);
+	return ((v >> 1) & 0x55) | ((v & 0x55) << 1);
+}
+
+void
+BitReverse(uint8_t *p, std::size_t n) noexcept
+{
+	for (; n >= sizeof(BitReverseVector); n -= sizeof(BitReverseVector),
+		     p += sizeof(BitReverseVector)) {
+		BitReverseVector v;
+		memcpy(&v, p, sizeof(v));
+		v = BitReverse(v);
+		memcpy(p, &v, sizeof(v));
+	}
+
+	for (; n > 0; --n, ++p)
+		*p = bit_reverse(*p);
+}
@@ -20,6 +20,7 @@
 #ifndef MPD_BIT_REVERSE_HXX
 #define MPD_BIT_REVERSE_HXX
 
+#include <cstddef>
 #include <cstdint>
 
 /**
@@ -48,4 +49,12 @@ bit_reverse(uint8_t x) noexcept
 	return bit_reverse_table.data[x];
 }
 
+/**
+ * Reverse the bits of all bytes in the buffer (in place).  This
+ * processes 16 bytes at a time and is much faster than calling
+ * bit_reverse() for each byte.
+ */
+void
+BitReverse(uint8_t *p, std::size_t n) noexcept;
+
 #endif
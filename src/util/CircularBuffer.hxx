@@ -63,7 +63,7 @@ protected:
 	 */
 	size_type tail;
 
-	const size_type capacity;
+	size_type capacity;
 	const pointer data;
 
 public:
@@ -88,6 +88,29 @@ public:
 		return capacity;
 	}
 
+	/**
+	 * Change the capacity, i.e. use only a part of the memory
+	 * passed to the constructor, or more of it.  The caller is
+	 * responsible for not exceeding the size of that memory.
+	 *
+	 * This is only possible if the data does not wrap around and
+	 * ends before the new capacity.
+	 *
+	 * @return true on success, false if the capacity was not
+	 * modified
+	 */
+	bool SetCapacity(size_type new_capacity) {
+		assert(new_capacity > 1);
+
+		if (empty())
+			head = tail = 0;
+		else if (head > tail || tail >= new_capacity)
+			return false;
+
+		capacity = new_capacity;
+		return true;
+	}
+
 	constexpr bool empty() const {
 		return head == tail;
 	}
@@ -31,9 +31,14 @@
 #include "system/VmaName.hxx"
 
 #include <new>
+#include <stdexcept>
 
 #ifdef __linux__
+#include "system/Error.hxx"
+
+#include <linux/mempolicy.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #else
 #include <stdlib.h>
@@ -77,6 +82,29 @@ HugeAllocate(size_t size)
 	return {(std::byte *)p, size};
 }
 
+std::span<std::byte>
+HugeAllocateHugeTlb(size_t size)
+{
+#ifdef MAP_HUGETLB
+	/* the default huge page size on x86 and most other
+	   architectures */
+	constexpr size_t huge_page_size = 2 * 1024 * 1024;
+	const size_t huge_size = (size + huge_page_size - 1)
+		/ huge_page_size * huge_page_size;
+
+	/* no MAP_NORESERVE here: if the huge page pool is exhausted,
+	   we want mmap() to fail instead of SIGBUS later */
+	constexpr int flags = MAP_ANONYMOUS|MAP_PRIVATE|MAP_HUGETLB;
+	void *p = mmap(nullptr, huge_size,
+		       PROT_READ|PROT_WRITE, flags,
+		       -1, 0);
+	if (p != (void *)-1)
+		return {(std::byte *)p, huge_size};
+#endif
+
+	return HugeAllocate(size);
+}
+
 void
 HugeFree(void *p, size_t size) noexcept
 {
@@ -106,6 +134,44 @@ HugeDiscard(void *p, size_t size) noexcept
 #endif
 }
 
+void
+HugePrefault(void *p, size_t size) noexcept
+{
+	size = AlignToPageSize(size);
+
+#ifdef MADV_POPULATE_WRITE
+	if (madvise(p, size, MADV_POPULATE_WRITE) == 0)
+		return;
+#endif
+
+	/* older kernel: touch each page manually */
+	static const long page_size = sysconf(_SC_PAGESIZE);
+	const size_t step = page_size > 0 ? size_t(page_size) : 4096;
+	auto *q = static_cast<volatile std::byte *>(p);
+	for (size_t i = 0; i < size; i += step)
+		q[i] = std::byte{};
+}
+
+void
+HugeLock(void *p, size_t size)
+{
+	if (mlock(p, AlignToPageSize(size)) < 0)
+		throw MakeErrno("mlock() failed");
+}
+
+void
+HugeBindNode(void *p, size_t size, unsigned node)
+{
+	constexpr unsigned max_node = sizeof(unsigned long) * 8;
+	if (node >= max_node)
+		throw std::invalid_argument("NUMA node number too large");
+
+	const unsigned long mask = 1UL << node;
+	if (syscall(SYS_mbind, p, AlignToPageSize(size), MPOL_BIND,
+		    &mask, (unsigned long)max_node + 1, 0U) < 0)
+		throw MakeErrno("mbind() failed");
+}
+
 #elif defined(_WIN32)
 
 std::span<std::byte>
@@ -51,6 +51,17 @@
 std::span<std::byte>
 HugeAllocate(size_t size);
 
+/**
+ * Like HugeAllocate(), but attempt to use explicit huge pages
+ * (MAP_HUGETLB) first, falling back to HugeAllocate() if the kernel
+ * has no huge pages available.
+ *
+ * The returned size is rounded up to the huge page size; that exact
+ * size must be passed to HugeFree().
+ */
+std::span<std::byte>
+HugeAllocateHugeTlb(size_t size);
+
 /**
  * @param p an allocation returned by HugeAllocate()
  * @param size the allocation's size as passed to HugeAllocate()
@@ -84,6 +95,30 @@ HugeForkCow(void *p, size_t size, bool enable) noexcept;
 void
 HugeDiscard(void *p, size_t size) noexcept;
 
+/**
+ * Fault in all pages of the allocation now instead of lazily on the
+ * first access.
+ */
+void
+HugePrefault(void *p, size_t size) noexcept;
+
+/**
+ * Lock the allocation into physical memory, see mlock().
+ *
+ * Throws on error.
+ */
+void
+HugeLock(void *p, size_t size);
+
+/**
+ * Bind the allocation to the specified NUMA node.  This must be
+ * called before the pages are faulted in.
+ *
+ * Throws on error.
+ */
+void
+HugeBindNode(void *p, size_t size, unsigned node);
+
 #elif defined(_WIN32)
 #include <memoryapi.h>
 
@@ -112,6 +147,27 @@ HugeDiscard(void *p, size_t size) noexcept
 	VirtualAlloc(p, size, MEM_RESET, PAGE_NOACCESS);
 }
 
+static inline std::span<std::byte>
+HugeAllocateHugeTlb(size_t size)
+{
+	return HugeAllocate(size);
+}
+
+static inline void
+HugePrefault(void *, size_t) noexcept
+{
+}
+
+static inline void
+HugeLock(void *, size_t)
+{
+}
+
+static inline void
+HugeBindNode(void *, size_t, unsigned)
+{
+}
+
 #else
 
 /* not Linux: fall back to standard C calls */
@@ -146,6 +202,27 @@ HugeDiscard(void *, size_t) noexcept
 {
 }
 
+static inline std::span<std::byte>
+HugeAllocateHugeTlb(size_t size)
+{
+	return HugeAllocate(size);
+}
+
+static inline void
+HugePrefault(void *, size_t) noexcept
+{
+}
+
+static inline void
+HugeLock(void *, size_t)
+{
+}
+
+static inline void
+HugeBindNode(void *, size_t, unsigned)
+{
+}
+
 #endif
 
 /**
@@ -168,6 +245,15 @@ public:
 	explicit HugeArray(size_type _size)
 		:buffer(FromBytesFloor<value_type>(HugeAllocate(sizeof(value_type) * _size))) {}
 
+	/**
+	 * @param huge_tlb use HugeAllocateHugeTlb(); this is only
+	 * safe if sizeof(T) divides the huge page size
+	 */
+	HugeArray(size_type _size, bool huge_tlb)
+		:buffer(FromBytesFloor<value_type>(huge_tlb
+						   ? HugeAllocateHugeTlb(sizeof(value_type) * _size)
+						   : HugeAllocate(sizeof(value_type) * _size))) {}
+
 	constexpr HugeArray(HugeArray &&other) noexcept
 		:buffer(std::exchange(other.buffer, nullptr)) {}
 
@@ -199,6 +285,21 @@ public:
 		HugeDiscard(v.data(), v.size());
 	}
 
+	void Prefault() noexcept {
+		const auto v = std::as_writable_bytes(buffer);
+		HugePrefault(v.data(), v.size());
+	}
+
+	void Lock() {
+		const auto v = std::as_writable_bytes(buffer);
+		HugeLock(v.data(), v.size());
+	}
+
+	void BindNode(unsigned node) {
+		const auto v = std::as_writable_bytes(buffer);
+		HugeBindNode(v.data(), v.size(), node);
+	}
+
 	constexpr bool operator==(std::nullptr_t) const noexcept {
 		return buffer == nullptr;
 	}
@@ -36,6 +36,20 @@ PeakBuffer::empty() const noexcept
 		(peak_buffer == nullptr || peak_buffer->empty());
 }
 
+std::size_t
+PeakBuffer::size() const noexcept
+{
+	return (normal_buffer != nullptr ? normal_buffer->GetAvailable() : 0) +
+		(peak_buffer != nullptr ? peak_buffer->GetAvailable() : 0);
+}
+
+std::size_t
+PeakBuffer::GetAllocatedSize() const noexcept
+{
+	return (normal_buffer != nullptr ? normal_buffer->GetCapacity() : 0) +
+		(peak_buffer != nullptr ? peak_buffer->GetCapacity() : 0);
+}
+
 std::span<std::byte>
 PeakBuffer::Read() const noexcept
 {
@@ -73,6 +87,15 @@ PeakBuffer::Consume(std::size_t length) noexcept
 	}
 }
 
+void
+PeakBuffer::Shrink() noexcept
+{
+	if (normal_buffer != nullptr && normal_buffer->empty()) {
+		delete normal_buffer;
+		normal_buffer = nullptr;
+	}
+}
+
 static std::size_t
 AppendTo(DynamicFifoBuffer<std::byte> &buffer,
 	 std::span<const std::byte> src) noexcept
@@ -60,9 +60,28 @@ public:
 	[[gnu::pure]]
 	bool empty() const noexcept;
 
+	/**
+	 * Returns the number of bytes in the buffer.
+	 */
+	[[gnu::pure]]
+	std::size_t size() const noexcept;
+
+	/**
+	 * Returns the number of bytes currently allocated by this
+	 * object.
+	 */
+	[[gnu::pure]]
+	std::size_t GetAllocatedSize() const noexcept;
+
 	[[gnu::pure]]
 	std::span<std::byte> Read() const noexcept;
 
+	/**
+	 * Free the normal buffer if it is empty.  It will be
+	 * allocated again by the next Append() call.
+	 */
+	void Shrink() noexcept;
+
 	void Consume(std::size_t length) noexcept;
 
 	bool Append(std::span<const std::byte> src);
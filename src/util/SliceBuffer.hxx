@@ -58,6 +58,12 @@ class SliceBuffer {
 	 */
 	Slice *available = nullptr;
 
+	/**
+	 * If true, then memory is never given back to the kernel.
+	 * See SetKeepResident().
+	 */
+	bool keep_resident = false;
+
 public:
 	SliceBuffer(unsigned _count)
 		:buffer(_count) {
@@ -89,6 +95,44 @@ public:
 		buffer.SetName(name);
 	}
 
+	/**
+	 * Don't give memory back to the kernel when the buffer
+	 * becomes empty.  This is useful after Prefault() or Lock().
+	 */
+	void SetKeepResident(bool _keep_resident) noexcept {
+		keep_resident = _keep_resident;
+	}
+
+	void Prefault() noexcept {
+		buffer.Prefault();
+	}
+
+	/**
+	 * Throws on error.
+	 */
+	void Lock() {
+		buffer.Lock();
+	}
+
+	/**
+	 * Throws on error.
+	 */
+	void BindNode(unsigned node) {
+		buffer.BindNode(node);
+	}
+
+	/**
+	 * Returns the index of the given (allocated) object within
+	 * the buffer.  This allows callers to manage per-slice data
+	 * in a parallel array.
+	 */
+	[[gnu::pure]]
+	std::size_t IndexOf(const T *value) const noexcept {
+		const Slice *slice = reinterpret_cast<const Slice *>(value);
+		assert(slice >= &buffer.front() && slice <= &buffer.back());
+		return slice - &buffer.front();
+	}
+
 	void DiscardMemory() noexcept {
 		assert(empty());
 
@@ -140,7 +184,7 @@ public:
 
 		/* give memory back to the kernel when the last slice
 		   was freed */
-		if (n_allocated == 0) {
+		if (n_allocated == 0 && !keep_resident) {
 			DiscardMemory();
 		}
 	}
@@ -0,0 +1,407 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MakeTag.hxx"
+#include "db/plugins/simple/BinaryDatabaseSave.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/PlaylistInfo.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/StringOutputStream.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Path.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Settings.hxx"
+#include "tag/Tag.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/StringBuffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+struct DirectoryDeleter {
+	void operator()(Directory *directory) const noexcept {
+		const ScopeDatabaseLock protect;
+		delete directory;
+	}
+};
+
+using DirectoryPtr = std::unique_ptr<Directory, DirectoryDeleter>;
+
+/**
+ * A file name which is unique to this process; the file is deleted
+ * by the destructor.
+ */
+class TemporaryFile {
+	AllocatedPath path = nullptr;
+
+public:
+	TemporaryFile() {
+		char buffer[] = "/tmp/TestBinaryDatabase.XXXXXX";
+		const int fd = mkstemp(buffer);
+		if (fd < 0)
+			throw std::runtime_error("mkstemp() failed");
+
+		close(fd);
+		path = AllocatedPath::FromFS(buffer);
+	}
+
+	~TemporaryFile() noexcept {
+		unlink(path.c_str());
+	}
+
+	TemporaryFile(const TemporaryFile &) = delete;
+	TemporaryFile &operator=(const TemporaryFile &) = delete;
+
+	operator Path() const noexcept {
+		return path;
+	}
+
+	void Write(std::string_view data) const {
+		FileOutputStream fos(path);
+		fos.Write(data.data(), data.size());
+		fos.Commit();
+	}
+};
+
+static std::string
+Save(const Directory &root, TagMask stored_tags)
+{
+	std::string result;
+	StringOutputStream sos(result);
+	WithBufferedOutputStream(sos, [&](BufferedOutputStream &bos){
+		db_save_binary(bos, root, stored_tags);
+	});
+	return result;
+}
+
+static void
+AddSong(Directory &parent, const char *name, std::time_t mtime,
+	Tag &&tag)
+{
+	auto song = Song::New(name, parent);
+	song->tag = std::move(tag);
+	song->mtime = std::chrono::system_clock::from_time_t(mtime);
+	parent.AddSong(std::move(song));
+}
+
+static DirectoryPtr
+MakeTree()
+{
+	DirectoryPtr root{Directory::NewRoot()};
+
+	const ScopeDatabaseLock protect;
+
+	root->mtime = std::chrono::system_clock::from_time_t(1000);
+
+	AddSong(*root, "a.mp3", 1001,
+		MakeTag(TAG_ARTIST, "Artist", TAG_TITLE, "A"));
+
+	auto &sub = *root->CreateChild("sub");
+	sub.mtime = std::chrono::system_clock::from_time_t(2000);
+
+	AddSong(sub, "b.flac", 2001,
+		MakeTag(TAG_ARTIST, "Artist", TAG_ARTIST, "Other",
+			TAG_ALBUM, "Album", TAG_TITLE, "B"));
+
+	{
+		auto song = Song::New("c.ogg", sub);
+		song->start_time = SongTime::FromMS(1500);
+		song->end_time = SongTime::FromMS(90000);
+		song->audio_format = AudioFormat(44100, SampleFormat::S16, 2);
+
+		TagBuilder tag;
+		tag.SetDuration(SignedSongTime::FromMS(88500));
+		tag.SetHasPlaylist(true);
+		tag.AddItem(TAG_TITLE, "C");
+		tag.Commit(song->tag);
+
+		/* "Comment" is disabled by default */
+		TagBuilder hidden;
+		hidden.AddItemUnchecked(TAG_COMMENT, "hidden");
+		hidden.Commit(song->hidden_tag);
+
+		sub.AddSong(std::move(song));
+	}
+
+	sub.playlists.UpdateOrInsert(PlaylistInfo{"list.m3u",
+						  std::chrono::system_clock::from_time_t(2002)});
+
+	auto &deep = *sub.CreateChild("deep");
+	AddSong(deep, "d.wav", 3001, MakeTag(TAG_ALBUM, "Album"));
+
+	/* a container file with a virtual song which refers to its
+	   parent */
+	auto &container = *root->CreateChild("e.cue");
+	container.device = DEVICE_PLAYLIST;
+	{
+		auto song = Song::New("track0001", container);
+		song->target = "../a.mp3";
+		song->mtime = std::chrono::system_clock::time_point::min();
+		container.AddSong(std::move(song));
+	}
+
+	/* an empty directory */
+	root->CreateChild("empty");
+
+	return root;
+}
+
+static void
+DumpTag(std::string &dest, const Tag &tag)
+{
+	for (const auto &i : tag) {
+		dest += ' ';
+		dest += tag_item_names[i.type];
+		dest += '=';
+		dest += i.value;
+	}
+}
+
+/**
+ * Format the tree as a string which can be compared.
+ */
+static void
+Dump(std::string &dest, const Directory &directory)
+{
+	using std::chrono::system_clock;
+
+	dest += "directory \"";
+	dest += directory.GetPath();
+	dest += "\" device=" + std::to_string(directory.device);
+	if (!IsNegative(directory.mtime))
+		dest += " mtime=" + std::to_string(system_clock::to_time_t(directory.mtime));
+	dest += '\n';
+
+	for (const auto &song : directory.songs) {
+		dest += "song \"";
+		dest += song.filename;
+		dest += "\" target=\"";
+		dest += song.target;
+		dest += '"';
+		if (!IsNegative(song.mtime))
+			dest += " mtime=" + std::to_string(system_clock::to_time_t(song.mtime));
+		dest += " start=" + std::to_string(song.start_time.ToMS());
+		dest += " end=" + std::to_string(song.end_time.ToMS());
+		dest += " format=";
+		dest += ToString(song.audio_format).c_str();
+		dest += " duration=" + std::to_string(song.tag.duration.ToMS());
+		dest += " has_playlist=" + std::to_string(song.tag.has_playlist);
+		DumpTag(dest, song.tag);
+		dest += " hidden:";
+		DumpTag(dest, song.hidden_tag);
+		dest += '\n';
+	}
+
+	for (const auto &playlist : directory.playlists) {
+		dest += "playlist \"";
+		dest += playlist.name;
+		dest += "\" mtime=" + std::to_string(system_clock::to_time_t(playlist.mtime));
+		dest += '\n';
+	}
+
+	for (const auto &child : directory.children)
+		Dump(dest, child);
+}
+
+static std::string
+Dump(const Directory &root)
+{
+	std::string result;
+	Dump(result, root);
+	return result;
+}
+
+static bool
+Equals(TagMask a, TagMask b) noexcept
+{
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (a.Test(TagType(i)) != b.Test(TagType(i)))
+			return false;
+	return true;
+}
+
+TEST(BinaryDatabase, RoundTrip)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root, TagMask(TAG_COMMENT));
+
+	const TemporaryFile file;
+	file.Write(data);
+
+	EXPECT_TRUE(db_is_binary(file));
+
+	DirectoryPtr loaded{Directory::NewRoot()};
+	const auto stored_tags = db_load_binary(file, *loaded);
+	EXPECT_TRUE(Equals(stored_tags, global_tag_mask | TagMask(TAG_COMMENT)));
+
+	EXPECT_EQ(Dump(*loaded), Dump(*root));
+
+	/* saving the loaded tree again must produce the same file */
+	EXPECT_EQ(Save(*loaded, stored_tags), data);
+}
+
+TEST(BinaryDatabase, StoredTags)
+{
+	const auto root = MakeTree();
+
+	const TemporaryFile file;
+	file.Write(Save(*root, TagMask::None()));
+
+	DirectoryPtr loaded{Directory::NewRoot()};
+	const auto stored_tags = db_load_binary(file, *loaded);
+	EXPECT_TRUE(Equals(stored_tags, global_tag_mask));
+
+	/* the hidden "Comment" was not scanned for all songs and is
+	   therefore omitted */
+	const auto dump = Dump(*loaded);
+	EXPECT_EQ(dump.find("hidden: Comment"), std::string::npos);
+	EXPECT_NE(Dump(*root).find("hidden: Comment=hidden"),
+		  std::string::npos);
+}
+
+TEST(BinaryDatabase, IsBinary)
+{
+	const TemporaryFile file;
+	EXPECT_FALSE(db_is_binary(file));
+
+	file.Write("info_begin\nformat: 2\n"sv);
+	EXPECT_FALSE(db_is_binary(file));
+
+	file.Write("MPDBIN"sv);
+	EXPECT_FALSE(db_is_binary(file));
+
+	EXPECT_FALSE(db_is_binary(Path::FromFS("/nonexistent/TestBinaryDatabase")));
+}
+
+/**
+ * Every truncated file must be rejected.
+ */
+TEST(BinaryDatabase, Truncated)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root, TagMask::None());
+
+	const TemporaryFile file;
+
+	for (std::size_t size = 0; size < data.size(); ++size) {
+		file.Write(std::string_view{data}.substr(0, size));
+
+		DirectoryPtr loaded{Directory::NewRoot()};
+		EXPECT_THROW(db_load_binary(file, *loaded),
+			     std::runtime_error) << "size=" << size;
+	}
+}
+
+/**
+ * Overwrite a 32 bit integer in the header and expect the file to be
+ * rejected.
+ */
+static void
+ExpectCorruptHeader(const std::string &data, std::size_t offset,
+		    uint32_t value)
+{
+	std::string corrupt = data;
+	memcpy(corrupt.data() + offset, &value, sizeof(value));
+
+	const TemporaryFile file;
+	file.Write(corrupt);
+
+	DirectoryPtr loaded{Directory::NewRoot()};
+	EXPECT_THROW(db_load_binary(file, *loaded),
+		     std::runtime_error) << "offset=" << offset;
+}
+
+TEST(BinaryDatabase, Corrupt)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root, TagMask::None());
+
+	/* magic */
+	ExpectCorruptHeader(data, 0, 0);
+
+	/* format */
+	ExpectCorruptHeader(data, 8, 0);
+
+	/* byte order */
+	ExpectCorruptHeader(data, 12, 0x04030201);
+
+	/* fs_charset */
+	ExpectCorruptHeader(data, 16, 0xfffffff0);
+
+	/* n_directories */
+	ExpectCorruptHeader(data, 24, 0);
+	ExpectCorruptHeader(data, 24, 0xffffffff);
+
+	/* n_songs, n_items, n_playlists, n_tag_names */
+	for (std::size_t offset = 28; offset < 44; offset += 4)
+		ExpectCorruptHeader(data, offset, 0x10000000);
+
+	/* strings_size */
+	ExpectCorruptHeader(data, 48, 0xffffffff);
+
+	/* the string table is not null-terminated */
+	{
+		std::string corrupt = data;
+		corrupt.back() = 'x';
+
+		const TemporaryFile file;
+		file.Write(corrupt);
+
+		DirectoryPtr loaded{Directory::NewRoot()};
+		EXPECT_THROW(db_load_binary(file, *loaded),
+			     std::runtime_error);
+	}
+}
+
+/**
+ * Overwrite each byte of the file; the loader may accept some of
+ * these files (e.g. if only a string was modified), but it must
+ * neither crash nor read out of bounds.
+ */
+TEST(BinaryDatabase, CorruptBytes)
+{
+	const auto root = MakeTree();
+	const auto data = Save(*root, TagMask::None());
+
+	const TemporaryFile file;
+
+	for (std::size_t i = 0; i < data.size(); ++i) {
+		std::string corrupt = data;
+		corrupt[i] = ~corrupt[i];
+		file.Write(corrupt);
+
+		DirectoryPtr loaded{Directory::NewRoot()};
+		try {
+			db_load_binary(file, *loaded);
+		} catch (const std::runtime_error &) {
+		}
+	}
+}
@@ -0,0 +1,143 @@
+/*
+ * Unit tests for class Bzip2Index.
+ */
+
+#include "archive/plugins/Bzip2Index.hxx"
+
+#include <bzlib.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+static std::vector<std::byte>
+GenerateData(std::size_t size)
+{
+	/* a few words in random order, which compresses reasonably
+	   well */
+	static constexpr const char *words[] = {
+		"foo ", "bar ", "Music ", "Player ", "Daemon\n",
+	};
+
+	std::mt19937 gen;
+	std::uniform_int_distribution<std::size_t> dis(0, std::size(words) - 1);
+
+	std::vector<std::byte> data;
+	while (data.size() < size)
+		for (const char *p = words[dis(gen)]; *p != 0; ++p)
+			data.push_back(std::byte(*p));
+
+	data.resize(size);
+	return data;
+}
+
+static std::vector<std::byte>
+Compress(std::span<const std::byte> src, int level)
+{
+	/* libbzip2 wants a non-const source pointer */
+	const auto *src_chars = (const char *)src.data();
+	std::vector<char> source(src_chars, src_chars + src.size());
+
+	std::vector<std::byte> dest(src.size() + src.size() / 100 + 600);
+	unsigned dest_size = dest.size();
+	int result = BZ2_bzBuffToBuffCompress((char *)dest.data(), &dest_size,
+					      source.data(), source.size(),
+					      level, 0, 0);
+	EXPECT_EQ(result, BZ_OK);
+	dest.resize(dest_size);
+	return dest;
+}
+
+/**
+ * Decompress a block using the index and return its contents.
+ */
+static std::vector<std::byte>
+DecompressBlock(const Bzip2Index &index, std::size_t i,
+		std::span<const std::byte> file)
+{
+	const auto &block = index.GetBlock(i);
+	/* not const: libbzip2 wants a non-const source pointer */
+	auto stream = Bzip2MakeBlockStream(file.subspan(block.begin / 8),
+					   block.begin % 8,
+					   block.end - block.begin);
+
+	/* a bzip2 block contains up to 900 kB of (RLE encoded)
+	   data */
+	std::vector<std::byte> dest(1024 * 1024);
+	unsigned dest_size = dest.size();
+	int result = BZ2_bzBuffToBuffDecompress((char *)dest.data(),
+						&dest_size,
+						(char *)stream.data(),
+						stream.size(),
+						0, 0);
+	EXPECT_EQ(result, BZ_OK);
+	dest.resize(dest_size);
+	return dest;
+}
+
+TEST(Bzip2Index, Blocks)
+{
+	const auto data = GenerateData(1024 * 1024);
+
+	/* two concatenated streams (like pbzip2 creates) with
+	   100 kB blocks */
+	const auto half = std::span{data}.size() / 2;
+	auto file = Compress(std::span{data}.first(half), 1);
+	const auto second = Compress(std::span{data}.subspan(half), 1);
+	file.insert(file.end(), second.begin(), second.end());
+
+	Bzip2Index index;
+
+	/* scan in odd-sized chunks */
+	for (std::span<const std::byte> src{file}; !src.empty();) {
+		const std::size_t n = std::min<std::size_t>(src.size(), 1001);
+		index.Scan(src.first(n));
+		src = src.subspan(n);
+	}
+
+	index.ScanEnd();
+	EXPECT_TRUE(index.IsComplete());
+	EXPECT_FALSE(index.IsTruncated());
+	EXPECT_GE(index.GetBlockCount(), 10U);
+	EXPECT_EQ(index.GetSize(), Bzip2Index::UNKNOWN_SIZE);
+
+	std::vector<std::byte> result;
+	for (std::size_t i = 0; i < index.GetBlockCount(); ++i) {
+		EXPECT_EQ(index.FindBlock(data.size()).first, i);
+
+		const auto block = DecompressBlock(index, i, file);
+		ASSERT_FALSE(block.empty());
+		index.SetBlockSize(i, block.size());
+		result.insert(result.end(), block.begin(), block.end());
+	}
+
+	EXPECT_EQ(result, data);
+	EXPECT_EQ(index.GetSize(), data.size());
+
+	/* now each offset can be found without decompressing */
+	const auto [first, first_offset] = index.FindBlock(0);
+	EXPECT_EQ(first, 0U);
+	EXPECT_EQ(first_offset, 0U);
+
+	const auto [middle, middle_offset] = index.FindBlock(half);
+	EXPECT_GT(middle, 0U);
+	EXPECT_LE(middle_offset, half);
+
+	const auto block = DecompressBlock(index, middle, file);
+	EXPECT_GT(middle_offset + block.size(), half);
+	EXPECT_TRUE(std::equal(block.begin(), block.end(),
+			       std::next(data.begin(), middle_offset)));
+}
+
+TEST(Bzip2Index, Truncated)
+{
+	const auto data = GenerateData(300 * 1024);
+	const auto file = Compress(data, 1);
+
+	Bzip2Index index;
+	index.Scan(std::span{file}.first(file.size() / 2));
+	index.ScanEnd();
+
+	EXPECT_TRUE(index.IsTruncated());
+	EXPECT_EQ(index.GetSize(), Bzip2Index::UNKNOWN_SIZE);
+}
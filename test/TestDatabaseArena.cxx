@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "db/plugins/simple/Arena.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST(DatabaseArena, Basic)
+{
+	DatabaseArena arena;
+
+	auto stats = arena.GetStats();
+	EXPECT_EQ(stats.n_allocations, 0U);
+	EXPECT_EQ(stats.used, 0U);
+	EXPECT_EQ(stats.peak, 0U);
+
+	void *a = arena.allocate(100, 8);
+	void *b = arena.allocate(50, 16);
+	EXPECT_NE(a, b);
+	EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 16, 0U);
+
+	stats = arena.GetStats();
+	EXPECT_EQ(stats.n_allocations, 2U);
+	EXPECT_EQ(stats.used, 150U);
+	EXPECT_GE(stats.size, stats.used);
+
+	arena.deallocate(a, 100, 8);
+	stats = arena.GetStats();
+	EXPECT_EQ(stats.n_allocations, 1U);
+	EXPECT_EQ(stats.used, 50U);
+	EXPECT_EQ(stats.peak, 150U);
+
+	/* the freed block is reused */
+	void *c = arena.allocate(100, 8);
+	EXPECT_EQ(arena.GetStats().size, stats.size);
+	EXPECT_EQ(arena.GetStats().peak, 150U);
+
+	arena.deallocate(b, 50, 16);
+	arena.deallocate(c, 100, 8);
+	EXPECT_EQ(arena.GetStats().used, 0U);
+}
+
+TEST(DatabaseArena, String)
+{
+	DatabaseArena arena;
+
+	const std::pmr::string s("a string which is too long for SSO",
+				 &arena);
+	EXPECT_EQ(s.get_allocator().resource(), &arena);
+
+	const auto stats = arena.GetStats();
+	EXPECT_EQ(stats.n_allocations, 1U);
+	EXPECT_GE(stats.used, s.length());
+}
+
+/**
+ * Simulate database updates which replace or delete songs: the
+ * arena must not grow beyond the size of the first cycle.
+ */
+TEST(DatabaseArena, Reuse)
+{
+	DatabaseArena arena;
+
+	static constexpr std::size_t N = 1000;
+	std::vector<std::pmr::string> strings;
+	std::vector<void *> blocks;
+
+	const auto cycle = [&](unsigned i){
+		for (std::size_t j = 0; j < N; ++j) {
+			/* a "Song" object and its file name of
+			   varying length */
+			blocks.push_back(arena.allocate(120, 8));
+			strings.emplace_back(std::string(16 + (i + j) % 200,
+							 'x'),
+					     &arena);
+		}
+
+		/* delete half of them; the other half is replaced
+		   in the next cycle */
+		for (std::size_t j = 0; j < N / 2; ++j) {
+			arena.deallocate(blocks.back(), 120, 8);
+			blocks.pop_back();
+			strings.pop_back();
+		}
+
+		for (void *p : blocks)
+			arena.deallocate(p, 120, 8);
+		blocks.clear();
+		strings.clear();
+	};
+
+	cycle(0);
+	const auto first = arena.GetStats();
+	EXPECT_EQ(first.n_allocations, 0U);
+	EXPECT_EQ(first.used, 0U);
+	EXPECT_GT(first.peak, 0U);
+
+	for (unsigned i = 1; i < 100; ++i)
+		cycle(i);
+
+	const auto stats = arena.GetStats();
+	EXPECT_EQ(stats.n_allocations, 0U);
+	EXPECT_EQ(stats.used, 0U);
+	EXPECT_EQ(stats.peak, first.peak);
+	EXPECT_EQ(stats.size, first.size);
+}
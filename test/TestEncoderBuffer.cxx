@@ -0,0 +1,137 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "encoder/EncoderBuffer.hxx"
+#include "encoder/EncoderInterface.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+/**
+ * A fake encoder which returns the configured chunks, either by
+ * writing into the caller's buffer or by returning its own.
+ */
+class FakeEncoder final : public Encoder {
+	std::span<const std::byte> data;
+	std::size_t chunk_size;
+	bool own_buffer;
+
+public:
+	FakeEncoder(std::span<const std::byte> _data,
+		    std::size_t _chunk_size, bool _own_buffer) noexcept
+		:Encoder(false), data(_data),
+		 chunk_size(_chunk_size), own_buffer(_own_buffer) {}
+
+	void Write(std::span<const std::byte>) override {}
+
+	std::span<const std::byte> Read(std::span<std::byte> buffer) noexcept override {
+		auto r = data.first(std::min(data.size(), chunk_size));
+		if (!own_buffer) {
+			r = r.first(std::min(r.size(), buffer.size()));
+			std::copy(r.begin(), r.end(), buffer.begin());
+		}
+
+		data = data.subspan(r.size());
+		return own_buffer ? r : buffer.first(r.size());
+	}
+};
+
+static std::array<std::byte, 256>
+MakeInput() noexcept
+{
+	std::array<std::byte, 256> a;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		a[i] = std::byte(i);
+	return a;
+}
+
+} // anonymous namespace
+
+TEST(EncoderBuffer, Recycle)
+{
+	auto pool = std::make_shared<EncoderBufferPool>(64, 4);
+
+	const EncoderBuffer *first;
+
+	{
+		auto a = pool->Get();
+		ASSERT_TRUE(a);
+		EXPECT_EQ(a->capacity(), 64U);
+		EXPECT_TRUE(a->empty());
+		first = a.get();
+
+		auto b = a;
+		EXPECT_EQ(a, b);
+	}
+
+	/* the released buffer is reused */
+	auto c = pool->Get();
+	EXPECT_EQ(c.get(), first);
+	EXPECT_TRUE(c->empty());
+
+	/* buffers may outlive the pool */
+	pool.reset();
+	c.reset();
+}
+
+TEST(EncoderBuffer, New)
+{
+	static constexpr std::byte data[]{std::byte{1}, std::byte{2}};
+	const auto b = EncoderBuffer::New(data);
+	ASSERT_EQ(b->size(), 2U);
+	EXPECT_TRUE(std::equal(b->begin(), b->end(), data));
+}
+
+TEST(EncoderBuffer, ReadBuffer)
+{
+	const auto input = MakeInput();
+
+	for (const bool own_buffer : {false, true}) {
+		auto pool = std::make_shared<EncoderBufferPool>(100);
+		FakeEncoder encoder(input, 30, own_buffer);
+
+		std::size_t total = 0;
+		while (auto b = encoder.ReadBuffer(*pool)) {
+			ASSERT_FALSE(b->empty());
+			ASSERT_TRUE(std::equal(b->begin(), b->end(),
+					       input.begin() + total));
+			total += b->size();
+		}
+
+		EXPECT_EQ(total, input.size());
+	}
+}
+
+TEST(EncoderBuffer, ReadBufferLarge)
+{
+	const auto input = MakeInput();
+
+	/* the encoder returns chunks larger than a pooled buffer */
+	auto pool = std::make_shared<EncoderBufferPool>(100);
+	FakeEncoder encoder(input, 150, true);
+
+	auto b = encoder.ReadBuffer(*pool);
+	ASSERT_TRUE(b);
+	EXPECT_EQ(b->size(), 150U);
+	EXPECT_TRUE(std::equal(b->begin(), b->end(), input.begin()));
+}
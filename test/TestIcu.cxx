@@ -4,10 +4,13 @@
 
 #include "config.h"
 #include "lib/icu/Converter.hxx"
+#include "lib/icu/Collate.hxx"
 #include "util/AllocatedString.hxx"
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
 #ifdef HAVE_ICU_CONVERTER
 
 static const char *const invalid_utf8[] = {
@@ -47,3 +50,38 @@ TEST(IcuConverter, Latin1)
 }
 
 #endif
+
+static constexpr int
+Sign(int i) noexcept
+{
+	return (i > 0) - (i < 0);
+}
+
+TEST(IcuCollate, Key)
+{
+	static constexpr const char *strings[] = {
+		"", "a", "A", "b", "B", "ab", "Ab", "abc", "z",
+		"\xc3\xa4", "\xc3\x84", "ae", "10", "9", "foo bar",
+		"foo-bar", "\xe6\x97\xa5\xe6\x9c\xac",
+	};
+
+#ifdef HAVE_ICU
+	IcuCollateInit();
+#endif
+
+	for (const char *a : strings) {
+		const auto a_key = IcuCollateKey(a);
+		ASSERT_NE(a_key.c_str(), nullptr);
+
+		for (const char *b : strings) {
+			const auto b_key = IcuCollateKey(b);
+			EXPECT_EQ(Sign(strcmp(a_key.c_str(), b_key.c_str())),
+				  Sign(IcuCollate(a, b)))
+				<< "a=\"" << a << "\" b=\"" << b << "\"";
+		}
+	}
+
+#ifdef HAVE_ICU
+	IcuCollateFinish();
+#endif
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "LogQueue.hxx"
+#include "util/Domain.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr Domain test_domain("test");
+
+TEST(LogQueue, Basic)
+{
+	LogQueue queue(4);
+
+	EXPECT_FALSE(queue.Pop([](const auto &){}));
+
+	EXPECT_TRUE(queue.Push(LogLevel::INFO, test_domain, "foo", 1));
+	EXPECT_TRUE(queue.Push(LogLevel::ERROR, test_domain, "bar", 2));
+
+	std::string text;
+	EXPECT_TRUE(queue.Pop([&](const LogQueue::Message &m){
+		EXPECT_EQ(&m.GetDomain(), &test_domain);
+		EXPECT_EQ(m.level, LogLevel::INFO);
+		EXPECT_EQ(m.time, 1);
+		text = m.GetText();
+	}));
+	EXPECT_EQ(text, "foo");
+
+	EXPECT_TRUE(queue.Pop([&](const LogQueue::Message &m){
+		EXPECT_EQ(m.level, LogLevel::ERROR);
+		text = m.GetText();
+	}));
+	EXPECT_EQ(text, "bar");
+
+	EXPECT_FALSE(queue.Pop([](const auto &){}));
+}
+
+TEST(LogQueue, Full)
+{
+	LogQueue queue(2);
+
+	EXPECT_TRUE(queue.Push(LogLevel::INFO, test_domain, "a", 0));
+	EXPECT_TRUE(queue.Push(LogLevel::INFO, test_domain, "b", 0));
+	EXPECT_FALSE(queue.Push(LogLevel::INFO, test_domain, "c", 0));
+
+	EXPECT_TRUE(queue.Pop([](const auto &){}));
+	EXPECT_TRUE(queue.Push(LogLevel::INFO, test_domain, "d", 0));
+
+	std::string text;
+	while (queue.Pop([&](const LogQueue::Message &m){
+		text += m.GetText();
+	})) {}
+
+	EXPECT_EQ(text, "bd");
+}
+
+TEST(LogQueue, Truncate)
+{
+	LogQueue queue(1);
+
+	const std::string long_text(LogQueue::MAX_MESSAGE + 100, 'x');
+	EXPECT_TRUE(queue.Push(LogLevel::INFO, test_domain, long_text, 0));
+
+	EXPECT_TRUE(queue.Pop([](const LogQueue::Message &m){
+		EXPECT_EQ(m.GetText().size(), LogQueue::MAX_MESSAGE);
+	}));
+}
+
+TEST(LogQueue, Threads)
+{
+	static constexpr unsigned N_THREADS = 4, N_MESSAGES = 10000;
+
+	LogQueue queue(64);
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < N_THREADS; ++i)
+		threads.emplace_back([&queue, i](){
+			const std::string text(1, char('a' + i));
+			for (unsigned j = 0; j < N_MESSAGES; ++j)
+				while (!queue.Push(LogLevel::INFO, test_domain,
+						   text, j))
+					std::this_thread::yield();
+		});
+
+	unsigned counts[N_THREADS]{};
+	std::time_t next[N_THREADS]{};
+	unsigned total = 0;
+
+	while (total < N_THREADS * N_MESSAGES) {
+		if (!queue.Pop([&](const LogQueue::Message &m){
+			ASSERT_EQ(m.GetText().size(), 1U);
+			const unsigned i = m.GetText().front() - 'a';
+			ASSERT_LT(i, N_THREADS);
+
+			/* each thread's messages arrive in order */
+			EXPECT_EQ(m.time, next[i]);
+			next[i] = m.time + 1;
+
+			++counts[i];
+			++total;
+		}))
+			std::this_thread::yield();
+	}
+
+	for (auto &t : threads)
+		t.join();
+
+	for (unsigned i = 0; i < N_THREADS; ++i)
+		EXPECT_EQ(counts[i], N_MESSAGES);
+
+	EXPECT_FALSE(queue.Pop([](const auto &){}));
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "output/SharedPipeConsumer.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <string.h>
+
+static void
+FillChunk(MusicChunk &chunk, unsigned value) noexcept
+{
+	static constexpr AudioFormat audio_format{44100, SampleFormat::S16, 2};
+
+	auto w = chunk.Write(audio_format, SongTime::zero(), 0);
+	memcpy(w.data(), &value, sizeof(value));
+	chunk.Expand(audio_format, sizeof(value));
+}
+
+static MusicChunkPtr
+MakeChunk(MusicBuffer &buffer, unsigned value) noexcept
+{
+	auto chunk = buffer.Allocate();
+	FillChunk(*chunk, value);
+	return chunk;
+}
+
+static unsigned
+GetValue(const MusicChunk &chunk) noexcept
+{
+	unsigned value;
+	memcpy(&value, chunk.data, sizeof(value));
+	return value;
+}
+
+TEST(MusicPipe, Basic)
+{
+	MusicBuffer buffer(16);
+	MusicPipe pipe;
+
+	EXPECT_TRUE(pipe.IsEmpty());
+	EXPECT_EQ(pipe.Peek(), nullptr);
+	EXPECT_FALSE(pipe.Shift());
+
+	for (unsigned i = 0; i < 3; ++i)
+		pipe.Push(MakeChunk(buffer, i));
+
+	EXPECT_EQ(pipe.GetSize(), 3U);
+
+	const MusicChunk *first = pipe.Peek();
+	ASSERT_NE(first, nullptr);
+	EXPECT_EQ(GetValue(*first), 0U);
+
+	const MusicChunk *second = pipe.GetNext(*first);
+	ASSERT_NE(second, nullptr);
+	EXPECT_EQ(GetValue(*second), 1U);
+
+	const MusicChunk *third = pipe.GetNext(*second);
+	ASSERT_NE(third, nullptr);
+	EXPECT_EQ(GetValue(*third), 2U);
+	EXPECT_EQ(pipe.GetNext(*third), nullptr);
+
+	for (unsigned i = 0; i < 3; ++i) {
+		auto chunk = pipe.Shift();
+		ASSERT_TRUE(chunk);
+		EXPECT_EQ(GetValue(*chunk), i);
+	}
+
+	EXPECT_TRUE(pipe.IsEmpty());
+	EXPECT_EQ(pipe.Peek(), nullptr);
+	EXPECT_FALSE(pipe.Shift());
+
+	/* the pipe is usable again after it has become empty */
+	pipe.Push(MakeChunk(buffer, 42));
+	pipe.Push(MakeChunk(buffer, 43));
+	EXPECT_EQ(GetValue(*pipe.Peek()), 42U);
+	pipe.Clear();
+	EXPECT_TRUE(pipe.IsEmpty());
+#ifndef NDEBUG
+	EXPECT_TRUE(buffer.IsEmptyUnsafe());
+#endif
+}
+
+TEST(MusicPipe, Threads)
+{
+	static constexpr unsigned N = 100000;
+
+	MusicBuffer buffer(64);
+	MusicPipe pipe;
+
+	std::thread producer([&]{
+		for (unsigned i = 0; i < N;) {
+			auto chunk = buffer.Allocate();
+			if (!chunk) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			FillChunk(*chunk, i);
+			pipe.Push(std::move(chunk));
+			++i;
+		}
+	});
+
+	unsigned expected = 0;
+	while (expected < N) {
+		auto chunk = pipe.Shift();
+		if (!chunk) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		ASSERT_EQ(GetValue(*chunk), expected);
+		++expected;
+	}
+
+	producer.join();
+
+	EXPECT_TRUE(pipe.IsEmpty());
+#ifndef NDEBUG
+	EXPECT_TRUE(buffer.IsEmptyUnsafe());
+#endif
+}
+
+TEST(MusicPipe, ConsumerSkip)
+{
+	MusicBuffer buffer(16);
+	MusicPipe pipe;
+
+	for (unsigned i = 0; i < 3; ++i)
+		pipe.Push(MakeChunk(buffer, i));
+
+	SharedPipeConsumer consumer;
+	consumer.Init(pipe);
+	EXPECT_EQ(consumer.GetBacklog(), 3U);
+	EXPECT_EQ(consumer.GetBacklogSize(), 3 * sizeof(unsigned));
+
+	const auto *first = consumer.Get();
+	ASSERT_NE(first, nullptr);
+	EXPECT_EQ(GetValue(*first), 0U);
+	consumer.Consume(*first);
+	EXPECT_EQ(consumer.GetBacklogSize(), 2 * sizeof(unsigned));
+
+	/* skip the rest */
+	consumer.SkipAll();
+	EXPECT_EQ(consumer.GetBacklog(), 0U);
+	EXPECT_EQ(consumer.GetBacklogSize(), 0U);
+	EXPECT_TRUE(consumer.IsConsumed(*pipe.GetNext(*first)));
+	EXPECT_EQ(consumer.Get(), nullptr);
+
+	/* continue with new chunks */
+	pipe.Push(MakeChunk(buffer, 3));
+	const auto *next = consumer.Get();
+	ASSERT_NE(next, nullptr);
+	EXPECT_EQ(GetValue(*next), 3U);
+
+	while (pipe.Shift()) {}
+}
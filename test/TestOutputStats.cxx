@@ -0,0 +1,67 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "output/Stats.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(Log2Histogram, Buckets)
+{
+	using H = Log2Histogram<8>;
+
+	EXPECT_EQ(H::BucketOf(0), 0U);
+	EXPECT_EQ(H::BucketOf(1), 1U);
+	EXPECT_EQ(H::BucketOf(2), 2U);
+	EXPECT_EQ(H::BucketOf(3), 2U);
+	EXPECT_EQ(H::BucketOf(4), 3U);
+	EXPECT_EQ(H::BucketOf(127), 7U);
+
+	/* the last bucket is open-ended */
+	EXPECT_EQ(H::BucketOf(128), 7U);
+	EXPECT_EQ(H::BucketOf(~uint_least64_t{}), 7U);
+
+	EXPECT_EQ(H::LowerBound(0), 0U);
+	EXPECT_EQ(H::LowerBound(1), 1U);
+	EXPECT_EQ(H::LowerBound(3), 4U);
+	EXPECT_EQ(H::LowerBound(7), 64U);
+}
+
+TEST(AudioOutputStats, Play)
+{
+	using namespace std::chrono_literals;
+
+	AudioOutputStats stats;
+	stats.AddPlay(10us, 100);
+	stats.AddPlay(3ms, 200);
+	stats.AddPlay(12us, 100);
+
+	EXPECT_EQ(stats.play_calls, 3U);
+	EXPECT_EQ(stats.play_bytes, 400U);
+	EXPECT_EQ(stats.play_time, std::chrono::steady_clock::duration{3022us});
+	EXPECT_EQ(stats.max_play_time, std::chrono::steady_clock::duration{3ms});
+
+	const auto &h = stats.play_time_histogram;
+	EXPECT_EQ(h[h.BucketOf(10)], 2U);
+	EXPECT_EQ(h[h.BucketOf(3000)], 1U);
+
+	stats.AddBacklog(5);
+	stats.AddBacklog(300);
+	EXPECT_EQ(stats.backlog, 300U);
+	EXPECT_EQ(stats.backlog_histogram[stats.backlog_histogram.BucketOf(5)], 1U);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "output/Timer.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+using std::chrono::seconds;
+
+TEST(OutputTimer, NoDrift)
+{
+	/* 44.1 kHz stereo: small chunks whose durations are not
+	   whole microseconds */
+	const AudioFormat af{44100, SampleFormat::S16, 2};
+	Timer timer(af);
+
+	const Timer::Clock::time_point start{seconds{1000}};
+	timer.Start(start);
+
+	/* 3600 seconds in chunks of 7 frames */
+	const std::size_t chunk_size = 7 * af.GetFrameSize();
+	const uint_least64_t total = uint_least64_t{3600} * 44100 / 7;
+	for (uint_least64_t i = 0; i < total; ++i)
+		timer.Add(chunk_size);
+
+	EXPECT_EQ(timer.GetTargetTime(), start + seconds{3600});
+	EXPECT_EQ(timer.GetDelay(start + seconds{3600}),
+		  Timer::Clock::duration::zero());
+	EXPECT_EQ(timer.GetDelay(start + seconds{3599}),
+		  Timer::Clock::duration{seconds{1}});
+}
+
+TEST(OutputTimer, Granularity)
+{
+	const AudioFormat af{48000, SampleFormat::S16, 2};
+	Timer timer(af, std::chrono::milliseconds{20});
+
+	const Timer::Clock::time_point start{seconds{1000}};
+	timer.Start(start);
+
+	/* 10 ms of data: below the granularity */
+	timer.Add(480 * af.GetFrameSize());
+	EXPECT_EQ(timer.GetDelay(start), Timer::Clock::duration::zero());
+
+	/* 40 ms of data */
+	timer.Add(3 * 480 * af.GetFrameSize());
+	EXPECT_EQ(timer.GetDelay(start),
+		  Timer::Clock::duration{std::chrono::milliseconds{40}});
+}
@@ -0,0 +1,36 @@
+/*
+ * Unit tests for src/lib/pcre/
+ */
+
+#include "lib/pcre/RequiredLiteral.hxx"
+
+#include <gtest/gtest.h>
+
+using Pcre::FindRequiredLiteral;
+
+TEST(Pcre, RequiredLiteral)
+{
+	EXPECT_EQ(FindRequiredLiteral(""), "");
+	EXPECT_EQ(FindRequiredLiteral("foo"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("^foo$"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("foo.*barbaz"), "barbaz");
+	EXPECT_EQ(FindRequiredLiteral("fooo?bar"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("foo*bar"), "bar");
+	EXPECT_EQ(FindRequiredLiteral("foo+bar"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("ab{2,3}cd"), "cd");
+	EXPECT_EQ(FindRequiredLiteral("a\\.b"), "a.b");
+	EXPECT_EQ(FindRequiredLiteral("foo\\d+bar"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("[abc]+xyz"), "xyz");
+	EXPECT_EQ(FindRequiredLiteral("[]x]yz"), "yz");
+	EXPECT_EQ(FindRequiredLiteral("(foobar)?baz"), "baz");
+	EXPECT_EQ(FindRequiredLiteral("ab(cd(ef)gh)ij"), "ab");
+
+	/* escapes with arguments stop the parser */
+	EXPECT_EQ(FindRequiredLiteral("foo\\x41bar"), "foo");
+	EXPECT_EQ(FindRequiredLiteral("\\p{L}foo"), "");
+
+	/* unsupported syntax */
+	EXPECT_EQ(FindRequiredLiteral("foo|bar"), "");
+	EXPECT_EQ(FindRequiredLiteral("(?i)foo"), "");
+	EXPECT_EQ(FindRequiredLiteral("\\Qfoo\\E"), "");
+}
@@ -0,0 +1,128 @@
+#include "queue/Queue.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+Tag::Tag(const Tag &) noexcept {}
+void Tag::Clear() noexcept {}
+
+DetachedSong::operator LightSong() const noexcept
+{
+	return {uri.c_str(), tag};
+}
+
+/**
+ * Determine the changed positions with the journal (like
+ * queue/Print.cxx does).
+ */
+static std::vector<unsigned>
+JournalChanges(const Queue &queue, uint32_t since)
+{
+	std::vector<Queue::PositionRange> ranges;
+	if (!queue.GetChangedRanges(since, ranges))
+		ranges = {{0, queue.GetLength()}};
+
+	std::vector<unsigned> result;
+	unsigned last_end = 0;
+	for (auto [start, end] : ranges) {
+		EXPECT_LT(start, end);
+		EXPECT_LE(end, queue.GetLength());
+		EXPECT_TRUE(result.empty() || start > last_end);
+		last_end = end;
+
+		for (unsigned i = start; i < end; ++i)
+			if (queue.IsNewerAtPosition(i, since))
+				result.push_back(i);
+	}
+
+	return result;
+}
+
+static std::vector<unsigned>
+ScanChanges(const Queue &queue, uint32_t since)
+{
+	std::vector<unsigned> result;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		if (queue.IsNewerAtPosition(i, since))
+			result.push_back(i);
+	return result;
+}
+
+TEST(QueueChanges, Journal)
+{
+	Queue queue(256);
+	std::mt19937 rnd(42);
+
+	for (unsigned i = 0; i < 100; ++i)
+		queue.Append(DetachedSong(std::to_string(i)), 0);
+	queue.IncrementVersion();
+
+	std::vector<uint32_t> versions;
+
+	for (unsigned step = 0; step < 500; ++step) {
+		versions.push_back(queue.version);
+
+		const unsigned length = queue.GetLength();
+		switch (rnd() % 6) {
+		case 0:
+			if (!queue.IsFull())
+				queue.Append(DetachedSong("x"), 0);
+			break;
+
+		case 1:
+			if (length > 1)
+				queue.DeletePosition(rnd() % length);
+			break;
+
+		case 2:
+			if (length > 1)
+				queue.SwapPositions(rnd() % length,
+						    rnd() % length);
+			break;
+
+		case 3:
+			if (length > 1)
+				queue.MovePostion(rnd() % length,
+						  rnd() % length);
+			break;
+
+		case 4:
+			if (length > 0)
+				queue.ModifyAtPosition(rnd() % length);
+			break;
+
+		case 5:
+			if (length > 1) {
+				const unsigned start = rnd() % length;
+				const unsigned end =
+					start + 1 + rnd() % (length - start);
+				queue.MoveRange(start, end,
+						rnd() % (length - (end - start) + 1));
+			}
+			break;
+		}
+
+		queue.IncrementVersion();
+
+		/* compare with a few older versions, including
+		   some which have fallen out of the journal */
+		for (unsigned i = 0; i < 5 && i < versions.size(); ++i) {
+			const uint32_t since =
+				versions[rnd() % versions.size()];
+			EXPECT_EQ(JournalChanges(queue, since),
+				  ScanChanges(queue, since));
+		}
+
+		EXPECT_EQ(JournalChanges(queue, queue.version),
+			  ScanChanges(queue, queue.version));
+	}
+
+	/* the most recent version must be answered by the journal */
+	std::vector<Queue::PositionRange> ranges;
+	EXPECT_TRUE(queue.GetChangedRanges(versions.back(), ranges));
+}
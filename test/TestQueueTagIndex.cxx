@@ -0,0 +1,164 @@
+#include "MakeTag.hxx"
+#include "queue/Queue.hxx"
+#include "queue/Selection.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "lib/icu/Init.hxx"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+class QueueTagIndexTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		IcuInit();
+	}
+
+	void TearDown() override {
+		IcuFinish();
+	}
+};
+
+static Tag
+MakeRandomTag(std::mt19937 &rnd)
+{
+	const std::string artist = "Artist" + std::to_string(rnd() % 16);
+	const std::string album = "Album" + std::to_string(rnd() % 32);
+
+	if (rnd() % 8 == 0)
+		/* no "AlbumArtist", which makes the filter fall back
+		   to "Artist" */
+		return MakeTag(TAG_ARTIST, artist.c_str(),
+			       TAG_ALBUM, album.c_str());
+
+	return MakeTag(TAG_ARTIST, artist.c_str(),
+		       TAG_ALBUM_ARTIST, artist.c_str(),
+		       TAG_ALBUM, album.c_str(),
+		       TAG_ALBUM, album.c_str());
+}
+
+static SongFilter
+ParseFilter(const char *expression, bool fold_case=false)
+{
+	SongFilter filter;
+	const char *const args[] = {expression};
+	filter.Parse(args, fold_case);
+	filter.Optimize();
+	return filter;
+}
+
+/**
+ * Determine the matching positions by checking each song.
+ */
+static std::vector<unsigned>
+ScanPositions(const Queue &queue, const QueueSelection &selection)
+{
+	std::vector<unsigned> v;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		if (selection.MatchPosition(queue, i))
+			v.push_back(i);
+	return v;
+}
+
+TEST_F(QueueTagIndexTest, Model)
+{
+	Queue queue(1024);
+	std::mt19937 rnd(42);
+
+	const SongFilter filters[] = {
+		ParseFilter("(Artist == \"Artist3\")"),
+		ParseFilter("(AlbumArtist == \"Artist5\")"),
+		ParseFilter("(Album starts_with \"Album1\")"),
+		ParseFilter("((Artist == \"Artist7\") AND (Album == \"Album3\"))"),
+		ParseFilter("(Artist == \"artist3\")", true),
+		ParseFilter("(Album starts_with \"ALBUM2\")", true),
+		ParseFilter("(Artist == \"nonexistent\")"),
+	};
+
+	unsigned n_indexed = 0;
+
+	for (unsigned i = 0; i < 300; ++i)
+		queue.Append(DetachedSong("x", MakeRandomTag(rnd)), 0);
+
+	for (unsigned step = 0; step < 4000; ++step) {
+		const unsigned length = queue.GetLength();
+
+		switch (rnd() % 5) {
+		case 0:
+			if (!queue.IsFull())
+				queue.Append(DetachedSong("x",
+							  MakeRandomTag(rnd)),
+					     0);
+			break;
+
+		case 1:
+			if (length > 1)
+				queue.DeletePosition(rnd() % length);
+			break;
+
+		case 2:
+			if (length > 1)
+				queue.SwapPositions(rnd() % length,
+						    rnd() % length);
+			break;
+
+		case 3:
+			if (length > 1) {
+				const unsigned from = rnd() % length;
+				queue.MoveRange(from, from + 1,
+						rnd() % length);
+			}
+			break;
+
+		case 4:
+			if (length > 0) {
+				/* modify a tag */
+				const unsigned position = rnd() % length;
+				queue.Get(position).SetTag(MakeRandomTag(rnd));
+				queue.ModifyAtPosition(position);
+			}
+			break;
+		}
+
+		if (step % 16 != 0)
+			continue;
+
+		for (const auto &filter : filters) {
+			QueueSelection selection;
+			selection.filter = &filter;
+
+			std::vector<unsigned> v;
+			if (selection.FindPositions(queue, v)) {
+				EXPECT_EQ(v, ScanPositions(queue, selection));
+				++n_indexed;
+			}
+		}
+	}
+
+	EXPECT_GT(n_indexed, 0u);
+}
+
+TEST_F(QueueTagIndexTest, NotIndexable)
+{
+	Queue queue(64);
+	queue.Append(DetachedSong("x", MakeTag(TAG_ARTIST, "foo")), 0);
+
+	for (const char *expression : {
+			"(Artist != \"foo\")",
+			"(Artist contains \"oo\")",
+			"(Artist == \"\")",
+			"(any == \"foo\")",
+			"(file == \"x\")",
+		}) {
+		const auto filter = ParseFilter(expression);
+		QueueSelection selection;
+		selection.filter = &filter;
+
+		std::vector<unsigned> v;
+		EXPECT_FALSE(selection.FindPositions(queue, v));
+	}
+}
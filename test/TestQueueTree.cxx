@@ -0,0 +1,267 @@
+#include "queue/Queue.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+Tag::Tag(const Tag &) noexcept {}
+void Tag::Clear() noexcept {}
+
+DetachedSong::operator LightSong() const noexcept
+{
+	return {uri.c_str(), tag};
+}
+
+/**
+ * A trivial array based model of the #Queue position/order mapping,
+ * to be compared with the tree based implementation.
+ */
+struct QueueModel {
+	/** position to song id */
+	std::vector<unsigned> ids;
+
+	/** order number to position */
+	std::vector<unsigned> order;
+
+	void Append(unsigned id) {
+		order.push_back(ids.size());
+		ids.push_back(id);
+	}
+
+	void Delete(unsigned position) {
+		ids.erase(ids.begin() + position);
+		order.erase(std::find(order.begin(), order.end(), position));
+		for (auto &i : order)
+			if (i > position)
+				--i;
+	}
+
+	void MoveRange(unsigned start, unsigned end, unsigned to,
+		       bool random) {
+		std::vector<unsigned> block(ids.begin() + start,
+					    ids.begin() + end);
+		ids.erase(ids.begin() + start, ids.begin() + end);
+		ids.insert(ids.begin() + to, block.begin(), block.end());
+
+		if (!random)
+			return;
+
+		const unsigned n = end - start;
+		for (auto &i : order) {
+			if (i >= start && i < end)
+				i = i - start + to;
+			else if (to > start && i >= end && i < to + n)
+				i -= n;
+			else if (to < start && i >= to && i < start)
+				i += n;
+		}
+	}
+
+	void MoveOrder(unsigned from, unsigned to) {
+		const unsigned position = order[from];
+		order.erase(order.begin() + from);
+		order.insert(order.begin() + to, position);
+	}
+
+	void Check(const Queue &queue) const {
+		ASSERT_EQ(queue.GetLength(), ids.size());
+
+		for (unsigned i = 0; i < ids.size(); ++i) {
+			EXPECT_EQ(queue.PositionToId(i), int(ids[i]));
+			EXPECT_EQ(queue.IdToPosition(ids[i]), int(i));
+			EXPECT_EQ(queue.Get(i).GetURI(), std::to_string(ids[i]));
+		}
+
+		for (unsigned i = 0; i < order.size(); ++i) {
+			EXPECT_EQ(queue.OrderToPosition(i), order[i]);
+			EXPECT_EQ(queue.PositionToOrder(order[i]), i);
+		}
+	}
+};
+
+/**
+ * Append a song whose URI is its id, which allows checking that
+ * ids and songs stay together.
+ */
+static void
+Append(Queue &queue, QueueModel &model)
+{
+	const unsigned id = queue.Append(DetachedSong("x"), 0);
+	queue.Get(queue.IdToPosition(id)).SetURI(std::to_string(id));
+	model.Append(id);
+}
+
+TEST(QueueTree, Model)
+{
+	Queue queue(512);
+	QueueModel model;
+	std::mt19937 rnd(42);
+
+	for (unsigned i = 0; i < 100; ++i)
+		Append(queue, model);
+
+	model.Check(queue);
+
+	for (unsigned step = 0; step < 3000; ++step) {
+		const unsigned length = queue.GetLength();
+
+		switch (rnd() % 8) {
+		case 0:
+			if (!queue.IsFull())
+				Append(queue, model);
+			break;
+
+		case 1:
+			if (length > 1) {
+				const unsigned position = rnd() % length;
+				queue.DeletePosition(position);
+				model.Delete(position);
+			}
+			break;
+
+		case 2:
+			if (length > 1) {
+				const unsigned a = rnd() % length;
+				const unsigned b = rnd() % length;
+				queue.SwapPositions(a, b);
+				std::swap(model.ids[a], model.ids[b]);
+			}
+			break;
+
+		case 3:
+			if (length > 1) {
+				const unsigned start = rnd() % length;
+				const unsigned end =
+					start + 1 + rnd() % (length - start);
+				const unsigned to =
+					rnd() % (length - (end - start) + 1);
+				queue.MoveRange(start, end, to);
+				model.MoveRange(start, end, to, queue.random);
+			}
+			break;
+
+		case 4:
+			if (length > 1 && queue.random) {
+				const unsigned from = rnd() % length;
+				const unsigned to = rnd() % length;
+				queue.MoveOrder(from, to);
+				model.MoveOrder(from, to);
+			}
+			break;
+
+		case 5:
+			if (length > 1 && queue.random) {
+				const unsigned a = rnd() % length;
+				const unsigned b = rnd() % length;
+				queue.SwapOrders(a, b);
+				std::swap(model.order[a], model.order[b]);
+			}
+			break;
+
+		case 6:
+			if (rnd() % 8 == 0) {
+				/* toggle random mode */
+				queue.random = !queue.random;
+				if (queue.random) {
+					queue.ShuffleOrder();
+					for (unsigned i = 0; i < length; ++i)
+						model.order[i] = queue.OrderToPosition(i);
+
+					auto sorted = model.order;
+					std::sort(sorted.begin(), sorted.end());
+					for (unsigned i = 0; i < length; ++i)
+						ASSERT_EQ(sorted[i], i);
+				} else {
+					queue.RestoreOrder();
+					for (unsigned i = 0; i < length; ++i)
+						model.order[i] = i;
+				}
+			}
+			break;
+
+		case 7:
+			if (length > 1) {
+				const unsigned position = rnd() % length;
+				const uint8_t priority = rnd() % 4;
+				queue.SetPriority(position, priority, -1, false);
+				EXPECT_EQ(queue.GetPriorityAtPosition(position),
+					  priority);
+			}
+			break;
+		}
+
+		queue.IncrementVersion();
+		model.Check(queue);
+	}
+}
+
+TEST(QueueTree, Clear)
+{
+	Queue queue(64);
+	QueueModel model;
+
+	for (unsigned i = 0; i < 32; ++i)
+		Append(queue, model);
+
+	queue.Clear();
+	EXPECT_EQ(queue.GetLength(), 0u);
+
+	/* the ids have been released and the queue is usable
+	   again */
+	model = {};
+	for (unsigned i = 0; i < 64; ++i)
+		Append(queue, model);
+
+	model.Check(queue);
+}
+
+TEST(QueueTree, ShuffleRange)
+{
+	Queue queue(64);
+	QueueModel model;
+
+	for (unsigned i = 0; i < 40; ++i)
+		Append(queue, model);
+
+	queue.IncrementVersion();
+	const uint32_t version = queue.version;
+
+	queue.ShuffleRange(5, 30);
+
+	/* the songs stay attached to their ids */
+	for (unsigned i = 0; i < queue.GetLength(); ++i) {
+		const unsigned id = queue.PositionToId(i);
+		EXPECT_EQ(queue.IdToPosition(id), int(i));
+		EXPECT_EQ(queue.Get(i).GetURI(), std::to_string(id));
+	}
+
+	/* items outside of the range are not touched */
+	for (unsigned i = 0; i < 5; ++i)
+		EXPECT_EQ(queue.PositionToId(i), int(model.ids[i]));
+	for (unsigned i = 30; i < 40; ++i)
+		EXPECT_EQ(queue.PositionToId(i), int(model.ids[i]));
+
+	/* the range is a permutation of the old one */
+	std::vector<unsigned> shuffled;
+	for (unsigned i = 5; i < 30; ++i)
+		shuffled.push_back(queue.PositionToId(i));
+
+	std::vector<unsigned> expected(model.ids.begin() + 5,
+				       model.ids.begin() + 30);
+	EXPECT_NE(shuffled, expected);
+
+	std::sort(shuffled.begin(), shuffled.end());
+	std::sort(expected.begin(), expected.end());
+	EXPECT_EQ(shuffled, expected);
+
+	/* ... and it has been marked as modified */
+	for (unsigned i = 5; i < 30; ++i)
+		EXPECT_TRUE(queue.IsNewerAtPosition(i, version));
+	EXPECT_FALSE(queue.IsNewerAtPosition(4, version));
+	EXPECT_FALSE(queue.IsNewerAtPosition(30, version));
+}
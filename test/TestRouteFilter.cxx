@@ -0,0 +1,152 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "filter/plugins/RouteFilterPlugin.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/Filter.hxx"
+#include "filter/Prepared.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+static std::unique_ptr<Filter>
+OpenRouteFilter(const char *routes, AudioFormat &audio_format)
+{
+	ConfigBlock block;
+	block.AddBlockParam("routes", routes);
+
+	auto prepared = route_filter_plugin.init(block);
+	return prepared->Open(audio_format);
+}
+
+template<typename T, std::size_t N>
+static std::span<const T>
+ApplyFilter(Filter &filter, const std::array<T, N> &src)
+{
+	return FromBytesStrict<const T>(filter.FilterPCM(std::as_bytes(std::span{src})));
+}
+
+TEST(RouteFilter, Identity)
+{
+	AudioFormat af{44100, SampleFormat::S16, 2};
+	auto f = OpenRouteFilter("0>0, 1>1", af);
+	EXPECT_EQ(f->GetOutAudioFormat(), af);
+
+	const std::array<int16_t, 4> src{1, 2, 3, 4};
+	const auto dest = ApplyFilter(*f, src);
+	EXPECT_EQ(dest.data(), src.data());
+	EXPECT_EQ(dest.size(), src.size());
+}
+
+TEST(RouteFilter, Swap)
+{
+	AudioFormat af{44100, SampleFormat::S16, 2};
+	auto f = OpenRouteFilter("0>1, 1>0", af);
+
+	const std::array<int16_t, 6> src{1, 2, 3, 4, 5, 6};
+	const auto dest = ApplyFilter(*f, src);
+	ASSERT_EQ(dest.size(), 6U);
+	EXPECT_EQ(dest[0], 2);
+	EXPECT_EQ(dest[1], 1);
+	EXPECT_EQ(dest[2], 4);
+	EXPECT_EQ(dest[3], 3);
+	EXPECT_EQ(dest[4], 6);
+	EXPECT_EQ(dest[5], 5);
+}
+
+TEST(RouteFilter, Upmix)
+{
+	/* channel 1 has no route and source channel 5 does not
+	   exist, so both output channels are silent */
+	AudioFormat af{44100, SampleFormat::S32, 2};
+	auto f = OpenRouteFilter("0>0, 5>2, 0>3, 1>4", af);
+	EXPECT_EQ(f->GetOutAudioFormat().channels, 5U);
+
+	const std::array<int32_t, 4> src{-1, 2, -3, 4};
+	const auto dest = ApplyFilter(*f, src);
+	const std::array<int32_t, 10> expected{
+		-1, 0, 0, -1, 2,
+		-3, 0, 0, -3, 4,
+	};
+	ASSERT_EQ(dest.size(), expected.size());
+	EXPECT_TRUE(std::equal(dest.begin(), dest.end(), expected.begin()));
+}
+
+TEST(RouteFilter, DsdSilence)
+{
+	AudioFormat af{352800, SampleFormat::DSD, 1};
+	auto f = OpenRouteFilter("0>1", af);
+
+	const std::array<uint8_t, 2> src{0x12, 0x34};
+	const auto dest = ApplyFilter(*f, src);
+	ASSERT_EQ(dest.size(), 4U);
+	EXPECT_EQ(dest[0], 0x69);
+	EXPECT_EQ(dest[1], 0x12);
+	EXPECT_EQ(dest[2], 0x69);
+	EXPECT_EQ(dest[3], 0x34);
+}
+
+TEST(RouteFilter, Reverse8)
+{
+	AudioFormat af{44100, SampleFormat::S8, 8};
+	auto f = OpenRouteFilter("7>0, 6>1, 5>2, 4>3, 3>4, 2>5, 1>6, 0>7", af);
+
+	std::array<int8_t, 8 * 5> src;
+	for (std::size_t i = 0; i < src.size(); ++i)
+		src[i] = i;
+
+	const auto dest = ApplyFilter(*f, src);
+	ASSERT_EQ(dest.size(), src.size());
+	for (std::size_t i = 0; i < src.size(); ++i)
+		EXPECT_EQ(dest[i], src[(i / 8) * 8 + 7 - i % 8]);
+}
+
+TEST(RouteFilter, Gain)
+{
+	AudioFormat af{44100, SampleFormat::S16, 2};
+	auto f = OpenRouteFilter("0>0*0.5, 1>0*0.5, 1>1, 0>2*-1", af);
+
+	/* the gain matrix switches to floating point */
+	EXPECT_EQ(af.format, SampleFormat::FLOAT);
+	EXPECT_EQ(f->GetOutAudioFormat().channels, 3U);
+
+	const std::array<float, 4> src{1, 0.5, -0.25, 0.75};
+	const auto dest = ApplyFilter(*f, src);
+	ASSERT_EQ(dest.size(), 6U);
+	EXPECT_FLOAT_EQ(dest[0], 0.75);
+	EXPECT_FLOAT_EQ(dest[1], 0.5);
+	EXPECT_FLOAT_EQ(dest[2], -1);
+	EXPECT_FLOAT_EQ(dest[3], 0.25);
+	EXPECT_FLOAT_EQ(dest[4], 0.75);
+	EXPECT_FLOAT_EQ(dest[5], 0.25);
+}
+
+TEST(RouteFilter, Malformed)
+{
+	AudioFormat af{44100, SampleFormat::S16, 2};
+	EXPECT_THROW(OpenRouteFilter("0>", af), std::runtime_error);
+	EXPECT_THROW(OpenRouteFilter("0>1*", af), std::runtime_error);
+	EXPECT_THROW(OpenRouteFilter("0>9", af), std::runtime_error);
+}
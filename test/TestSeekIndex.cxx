@@ -0,0 +1,113 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "decoder/SeekIndex.hxx"
+
+#include <gtest/gtest.h>
+
+static std::span<const std::byte>
+AsBytes(const std::string &s) noexcept
+{
+	return std::as_bytes(std::span{s});
+}
+
+static const SeekIndexKey key{"/music/podcast.mp3", 123456789, 1600000000000000000};
+
+static SeekIndex
+MakeIndex() noexcept
+{
+	SeekIndex index;
+	index.step = 1;
+
+	uint64_t offset = 1234;
+	for (unsigned i = 0; i < 10000; ++i) {
+		index.offsets.push_back(offset);
+		/* variable frame sizes, some of them large */
+		offset += 417 + (i % 7) * 100 + (i % 1000 == 0) * 70000;
+	}
+
+	return index;
+}
+
+TEST(SeekIndex, RoundTrip)
+{
+	const auto index = MakeIndex();
+	const auto data = SerializeSeekIndex("mad", key, index);
+
+	/* the deltas are small; they should occupy two bytes each */
+	EXPECT_LT(data.size(), index.size() * 3);
+
+	const auto result = ParseSeekIndex(AsBytes(data), "mad", key);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result->step, index.step);
+	EXPECT_EQ(result->offsets, index.offsets);
+}
+
+TEST(SeekIndex, Empty)
+{
+	const SeekIndex index{1152, {}};
+	const auto data = SerializeSeekIndex("mpg123", key, index);
+	const auto result = ParseSeekIndex(AsBytes(data), "mpg123", key);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result->step, 1152U);
+	EXPECT_TRUE(result->empty());
+}
+
+TEST(SeekIndex, Mismatch)
+{
+	const auto index = MakeIndex();
+	const auto data = SerializeSeekIndex("mad", key, index);
+
+	/* different plugin */
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data), "mpg123", key));
+
+	/* modified file */
+	auto other = key;
+	other.mtime += 1;
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data), "mad", other));
+
+	other = key;
+	other.size += 1;
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data), "mad", other));
+
+	/* different URI with the same length */
+	other = key;
+	other.uri.back() = '4';
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data), "mad", other));
+}
+
+TEST(SeekIndex, Malformed)
+{
+	const auto index = MakeIndex();
+	const auto data = SerializeSeekIndex("mad", key, index);
+
+	/* truncated */
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data).first(data.size() - 1),
+				    "mad", key));
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data).first(10), "mad", key));
+
+	/* trailing garbage */
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data + "x"), "mad", key));
+
+	/* offsets beyond the end of the file */
+	auto small = key;
+	small.size = index.offsets.back();
+	const auto data2 = SerializeSeekIndex("mad", small, index);
+	EXPECT_FALSE(ParseSeekIndex(AsBytes(data2), "mad", small));
+}
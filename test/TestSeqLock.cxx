@@ -0,0 +1,91 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "thread/SeqLock.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * A value whose fields are all derived from one counter, so a torn
+ * copy can be detected.
+ */
+struct Value {
+	uint64_t a;
+	uint32_t b;
+	uint16_t c;
+
+	static constexpr Value Make(uint64_t i) noexcept {
+		return {i, uint32_t(~i), uint16_t(i * 3)};
+	}
+
+	constexpr bool IsConsistent() const noexcept {
+		return b == uint32_t(~a) && c == uint16_t(a * 3);
+	}
+};
+
+} // anonymous namespace
+
+TEST(SeqLock, Basic)
+{
+	SeqLock<Value> lock{Value::Make(42)};
+	EXPECT_EQ(lock.Load().a, 42U);
+	EXPECT_TRUE(lock.Load().IsConsistent());
+
+	lock.Store(Value::Make(7));
+	EXPECT_EQ(lock.Load().a, 7U);
+	EXPECT_TRUE(lock.Load().IsConsistent());
+}
+
+TEST(SeqLock, Concurrent)
+{
+	static constexpr uint64_t N = 200000;
+
+	SeqLock<Value> lock{Value::Make(0)};
+	std::atomic_bool done{false};
+	std::atomic_uint inconsistent{0};
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i < 3; ++i)
+		readers.emplace_back([&]{
+			uint64_t previous = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				const auto value = lock.Load();
+				if (!value.IsConsistent() || value.a < previous)
+					++inconsistent;
+				previous = value.a;
+			}
+		});
+
+	for (uint64_t i = 1; i <= N; ++i)
+		lock.Store(Value::Make(i));
+
+	done = true;
+	for (auto &t : readers)
+		t.join();
+
+	EXPECT_EQ(inconsistent.load(), 0U);
+	EXPECT_EQ(lock.Load().a, N);
+}
@@ -0,0 +1,60 @@
+/*
+ * Unit tests for class SidSongLengthDatabase.
+ */
+
+#include "decoder/plugins/SidSongLength.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(SidSongLength, Parse)
+{
+	SidSongLengthDatabase db;
+
+	EXPECT_FALSE(db.ParseLine("[Database]"));
+	EXPECT_FALSE(db.ParseLine("; /MUSICIANS/H/Hubbard_Rob/Commando.sid"));
+	EXPECT_FALSE(db.ParseLine(""));
+
+	/* new format (HVSC#68 and later) */
+	EXPECT_TRUE(db.ParseLine("2727236ead44a62f0c6e01f6dd4dc484=4:49.5 0:12.025 1:02"));
+
+	/* old format with attributes */
+	EXPECT_TRUE(db.ParseLine("0123456789ABCDEF0123456789abcdef=0:43(G) 12:01(M)"));
+
+	/* malformed */
+	EXPECT_FALSE(db.ParseLine("0123=1:00"));
+	EXPECT_FALSE(db.ParseLine("2727236ead44a62f0c6e01f6dd4dc485="));
+	EXPECT_FALSE(db.ParseLine("2727236ead44a62f0c6e01f6dd4dc486=1:xx"));
+	EXPECT_FALSE(db.ParseLine("x727236ead44a62f0c6e01f6dd4dc487=1:00"));
+
+	EXPECT_EQ(db.size(), 2u);
+
+	const auto *a = db.Find("2727236ead44a62f0c6e01f6dd4dc484");
+	ASSERT_NE(a, nullptr);
+	ASSERT_EQ(a->size(), 3u);
+	EXPECT_EQ((*a)[0], 289500u);
+	EXPECT_EQ((*a)[1], 12025u);
+	EXPECT_EQ((*a)[2], 62000u);
+
+	/* lookups are case-insensitive */
+	const auto *b = db.Find("0123456789abcdef0123456789ABCDEF");
+	ASSERT_NE(b, nullptr);
+	ASSERT_EQ(b->size(), 2u);
+	EXPECT_EQ((*b)[0], 43000u);
+	EXPECT_EQ((*b)[1], 721000u);
+
+	EXPECT_EQ(db.Find("00000000000000000000000000000000"), nullptr);
+	EXPECT_EQ(db.Find("invalid"), nullptr);
+}
+
+TEST(SidSongLength, Replace)
+{
+	SidSongLengthDatabase db;
+	EXPECT_TRUE(db.ParseLine("2727236ead44a62f0c6e01f6dd4dc484=1:00"));
+	EXPECT_TRUE(db.ParseLine("2727236ead44a62f0c6e01f6dd4dc484=2:00"));
+	EXPECT_EQ(db.size(), 1u);
+
+	const auto *a = db.Find("2727236ead44a62f0c6e01f6dd4dc484");
+	ASSERT_NE(a, nullptr);
+	ASSERT_EQ(a->size(), 1u);
+	EXPECT_EQ((*a)[0], 120000u);
+}
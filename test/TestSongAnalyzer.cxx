@@ -0,0 +1,120 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "decoder/Analyzer.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Generate a 1 kHz sine wave at 44.1 kHz.
+ */
+template<typename T>
+static std::vector<T>
+GenerateSine(unsigned channels, std::chrono::seconds duration,
+	     double amplitude, double scale=1)
+{
+	constexpr unsigned sample_rate = 44100;
+	const std::size_t n_frames = sample_rate * duration.count();
+
+	std::vector<T> result;
+	result.reserve(n_frames * channels);
+
+	for (std::size_t i = 0; i < n_frames; ++i) {
+		const double t = double(i) / sample_rate;
+		const T value = T(amplitude * scale *
+				  std::sin(2 * M_PI * 1000 * t));
+		for (unsigned c = 0; c < channels; ++c)
+			result.push_back(value);
+	}
+
+	return result;
+}
+
+template<typename T>
+static SongAnalysis
+Analyze(const AudioFormat audio_format, const std::vector<T> &data)
+{
+	SongAnalyzer analyzer(audio_format);
+
+	/* submit in pieces, like a decoder would */
+	std::span<const std::byte> src = std::as_bytes(std::span{data});
+	const std::size_t piece = 4096 * audio_format.GetFrameSize();
+	while (!src.empty()) {
+		const auto n = std::min(src.size(), piece);
+		analyzer.Process(src.first(n));
+		src = src.subspan(n);
+	}
+
+	return analyzer.Finish();
+}
+
+TEST(SongAnalyzer, Float)
+{
+	const AudioFormat audio_format{44100, SampleFormat::FLOAT, 2};
+	const auto a = Analyze(audio_format,
+			       GenerateSine<float>(2, std::chrono::seconds{5},
+						   0.5));
+
+	EXPECT_TRUE(a.track.IsDefined());
+	EXPECT_NEAR(a.track.peak, 0.5, 0.01);
+	EXPECT_GE(a.track.gain, -24);
+	EXPECT_LE(a.track.gain, 64);
+
+	ASSERT_NE(a.mix_ramp.GetStart(), nullptr);
+	ASSERT_NE(a.mix_ramp.GetEnd(), nullptr);
+
+	/* the sine starts immediately, so the first item is at time
+	   zero */
+	const std::string_view start = a.mix_ramp.GetStart();
+	EXPECT_NE(start.find(" 0.00;"), start.npos);
+	EXPECT_EQ(start.back(), ';');
+}
+
+TEST(SongAnalyzer, Convert)
+{
+	/* 16 bit mono needs to be converted */
+	const AudioFormat audio_format{44100, SampleFormat::S16, 1};
+	const auto a = Analyze(audio_format,
+			       GenerateSine<int16_t>(1, std::chrono::seconds{5},
+						     0.25, 32767));
+
+	EXPECT_TRUE(a.track.IsDefined());
+	EXPECT_NEAR(a.track.peak, 0.25, 0.01);
+}
+
+TEST(SongAnalyzer, Louder)
+{
+	const AudioFormat audio_format{44100, SampleFormat::FLOAT, 2};
+	const auto quiet = Analyze(audio_format,
+				   GenerateSine<float>(2, std::chrono::seconds{3},
+						       0.1));
+	const auto loud = Analyze(audio_format,
+				  GenerateSine<float>(2, std::chrono::seconds{3},
+						      0.8));
+
+	/* 18 dB louder needs 18 dB less gain */
+	EXPECT_NEAR(quiet.track.gain - loud.track.gain,
+		    20 * std::log10(8.), 0.5);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "StateJournal.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+class StringListReader final : public LineReader {
+	std::vector<std::string> lines;
+	std::size_t next = 0;
+
+public:
+	StringListReader(std::initializer_list<const char *> _lines)
+		:lines(_lines.begin(), _lines.end()) {}
+
+	char *ReadLine() override {
+		if (next >= lines.size())
+			return nullptr;
+
+		return lines[next++].data();
+	}
+};
+
+std::vector<std::string>
+ReadAll(LineReader &reader)
+{
+	std::vector<std::string> result;
+	const char *line;
+	while ((line = reader.ReadLine()) != nullptr)
+		result.emplace_back(line);
+	return result;
+}
+
+} // anonymous namespace
+
+TEST(StateJournal, NoJournal)
+{
+	StringListReader base{
+		"sw_volume: 50",
+		"state: stop",
+		"playlist_begin",
+		"0:a.mp3",
+		"Prio: 3",
+		"1:b.mp3",
+		"song_begin: http://example.com/c",
+		"Title: C",
+		"song_end",
+		"playlist_end",
+	};
+
+	MergedStateFile merged(base, nullptr);
+	EXPECT_EQ(ReadAll(merged), (std::vector<std::string>{
+		"sw_volume: 50",
+		"state: stop",
+		"playlist_begin",
+		"0:a.mp3",
+		"Prio: 3",
+		"1:b.mp3",
+		"song_begin: http://example.com/c",
+		"Title: C",
+		"song_end",
+		"playlist_end",
+	}));
+}
+
+TEST(StateJournal, Apply)
+{
+	StringListReader base{
+		"sw_volume: 50",
+		"state: stop",
+		"playlist_begin",
+		"0:a.mp3",
+		"1:b.mp3",
+		"2:c.mp3",
+		"playlist_end",
+	};
+
+	StringListReader journal{
+		/* replace "b", append "d" */
+		"journal_begin",
+		"sw_volume: 60",
+		"state: play",
+		"playlist_delta: 4",
+		"pos: 1",
+		"Prio: 7",
+		"1:x.mp3",
+		"pos: 3",
+		"song_begin: http://example.com/d",
+		"song_end",
+		"playlist_end",
+		"journal_end",
+
+		/* remove the last two */
+		"journal_begin",
+		"sw_volume: 70",
+		"state: pause",
+		"playlist_delta: 2",
+		"playlist_end",
+		"journal_end",
+
+		/* incomplete record, must be ignored */
+		"journal_begin",
+		"sw_volume: 80",
+		"state: stop",
+		"playlist_delta: 0",
+	};
+
+	MergedStateFile merged(base, &journal);
+	EXPECT_EQ(ReadAll(merged), (std::vector<std::string>{
+		"sw_volume: 70",
+		"state: pause",
+		"playlist_begin",
+		"0:a.mp3",
+		"Prio: 7",
+		"1:x.mp3",
+		"playlist_end",
+	}));
+}
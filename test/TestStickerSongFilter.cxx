@@ -0,0 +1,134 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "song/StickerSongFilter.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Tag.hxx"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+namespace {
+
+class FakeStickerSource final : public StickerValueSource {
+	std::map<std::string, std::string, std::less<>> values;
+
+public:
+	void Set(const char *uri, const char *value) {
+		values[uri] = value;
+	}
+
+	bool GetSongSticker(std::string_view uri,
+			    [[maybe_unused]] std::string_view name,
+			    std::string &value) const noexcept override {
+		auto i = values.find(uri);
+		if (i == values.end())
+			return false;
+
+		value = i->second;
+		return true;
+	}
+};
+
+} // anonymous namespace
+
+static bool
+InvokeFilter(const StickerSongFilter &f, const char *uri) noexcept
+{
+	return f.Match(LightSong(uri, Tag{}));
+}
+
+TEST(StickerSongFilter, Compare)
+{
+	EXPECT_LT(CompareStickerValues("2", "10"), 0);
+	EXPECT_GT(CompareStickerValues("10", "2"), 0);
+	EXPECT_EQ(CompareStickerValues("1.0", "1"), 0);
+	EXPECT_GT(CompareStickerValues("2", "10x"), 0);
+	EXPECT_LT(CompareStickerValues("", "0"), 0);
+}
+
+TEST(StickerSongFilter, String)
+{
+	FakeStickerSource source;
+	source.Set("a", "5");
+	source.Set("b", "3");
+
+	const StickerSongFilter f{
+		source, "rating", StickerSongFilter::Operator::STRING,
+		{"5", false, StringFilter::Position::FULL, false},
+	};
+
+	EXPECT_TRUE(InvokeFilter(f, "a"));
+	EXPECT_FALSE(InvokeFilter(f, "b"));
+	EXPECT_FALSE(InvokeFilter(f, "c"));
+
+	const StickerSongFilter n{
+		source, "rating", StickerSongFilter::Operator::STRING,
+		{"5", false, StringFilter::Position::FULL, true},
+	};
+
+	EXPECT_FALSE(InvokeFilter(n, "a"));
+	EXPECT_TRUE(InvokeFilter(n, "b"));
+	EXPECT_TRUE(InvokeFilter(n, "c"));
+}
+
+TEST(StickerSongFilter, Relational)
+{
+	FakeStickerSource source;
+	source.Set("a", "10");
+	source.Set("b", "3");
+
+	const StickerSongFilter f{
+		source, "rating", StickerSongFilter::Operator::GREATER_EQUAL,
+		{"4", false, StringFilter::Position::FULL, false},
+	};
+
+	EXPECT_TRUE(InvokeFilter(f, "a"));
+	EXPECT_FALSE(InvokeFilter(f, "b"));
+
+	/* a missing sticker never matches a relational operator */
+	EXPECT_FALSE(InvokeFilter(f, "c"));
+
+	EXPECT_EQ(f.ToExpression(), "(sticker \"rating\" >= \"4\")");
+}
+
+static bool
+ParseHasSticker(const char *expression)
+{
+	SongFilter filter;
+	filter.Parse({&expression, 1});
+	return filter.HasSticker();
+}
+
+TEST(StickerSongFilter, HasSticker)
+{
+	FakeStickerSource source;
+	SetStickerValueSource(&source);
+
+	EXPECT_TRUE(ParseHasSticker("(sticker \"rating\" == \"5\")"));
+	EXPECT_TRUE(ParseHasSticker("(!(sticker \"rating\" == \"5\"))"));
+	EXPECT_TRUE(ParseHasSticker("((artist == \"a\") AND "
+				    "(!(sticker \"rating\" == \"5\")))"));
+	EXPECT_FALSE(ParseHasSticker("((artist == \"a\") AND "
+				     "(!(title == \"b\")))"));
+
+	SetStickerValueSource(nullptr);
+}
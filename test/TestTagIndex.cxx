@@ -0,0 +1,399 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MakeTag.hxx"
+#include "db/plugins/simple/TagIndex.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/DatabasePlugin.hxx"
+#include "db/GroupCount.hxx"
+#include "db/Interface.hxx"
+#include "db/Selection.hxx"
+#include "db/Stats.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "tag/Tag.hxx"
+#include "util/RecursiveMap.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static constexpr DatabasePlugin fake_db_plugin = {
+	"fake",
+	0,
+	nullptr,
+};
+
+/**
+ * A mounted database containing a single song.
+ */
+class FakeDatabase final : public Database {
+	const Tag tag = MakeTag(TAG_ARTIST, "A", TAG_ALBUM, "Y");
+
+public:
+	FakeDatabase() noexcept:Database(fake_db_plugin) {}
+
+	const LightSong *GetSong(std::string_view) const override {
+		return nullptr;
+	}
+
+	void ReturnSong(const LightSong *) const noexcept override {}
+
+	void Visit(const DatabaseSelection &selection,
+		   VisitDirectory, VisitSong visit_song,
+		   VisitPlaylist) const override {
+		const LightSong song("mounted.mp3", tag);
+		if (visit_song && selection.Match(song))
+			visit_song(song);
+	}
+
+	RecursiveMap<std::string> CollectUniqueTags(const DatabaseSelection &,
+						    std::span<const TagType>) const override {
+		return {};
+	}
+
+	TagCountMap CountSongs(const DatabaseSelection &,
+			       TagType) const override {
+		return {};
+	}
+
+	DatabaseStats GetStats(const DatabaseSelection &) const override {
+		return {};
+	}
+
+	std::chrono::system_clock::time_point GetUpdateStamp() const noexcept override {
+		return {};
+	}
+};
+
+struct DirectoryDeleter {
+	void operator()(Directory *directory) const noexcept {
+		delete directory;
+	}
+};
+
+using DirectoryPtr = std::unique_ptr<Directory, DirectoryDeleter>;
+
+static SongFilter
+ParseFilter(const char *expression)
+{
+	SongFilter filter;
+	const char *const args[] = {expression};
+	filter.Parse(args);
+	filter.Optimize();
+	return filter;
+}
+
+/**
+ * The songs of the tree shown below; the mount point "m" is only
+ * added by the tests which need it.
+ */
+class TagIndexTest : public ::testing::Test {
+protected:
+	/* the #Directory methods assert that the caller holds the
+	   #db_mutex */
+	const ScopeDatabaseLock protect;
+
+	DirectoryPtr root{Directory::NewRoot()};
+
+	Directory &a = *root->CreateChild("a");
+	Directory &b = *a.CreateChild("b");
+	Directory &c = *root->CreateChild("c");
+
+	TagIndex index;
+
+	void SetUp() override {
+		AddSong(*root, "r1.mp3", 1,
+			MakeTag(TAG_ARTIST, "A", TAG_ALBUM, "X"));
+
+		AddSong(a, "a1.mp3", 2,
+			MakeTag(TAG_ARTIST, "A", TAG_ALBUM_ARTIST, "B",
+				TAG_ALBUM, "X"));
+		AddSong(a, "a2.mp3", 1,
+			MakeTag(TAG_ARTIST, "C", TAG_ALBUM, "Y"));
+		AddSong(a, "a3.mp3", 3,
+			MakeTag(TAG_ARTIST, "A", TAG_ALBUM, "Y"),
+			true);
+
+		AddSong(b, "b1.mp3", 4,
+			MakeTag(TAG_ARTIST, "A"));
+		AddSong(b, "b2.mp3", 2,
+			MakeTag(TAG_ARTIST, "D", TAG_ARTIST_SORT, "A"));
+
+		/* the same value twice */
+		AddSong(c, "c1.mp3", 5,
+			MakeTag(TAG_ARTIST, "Abc", TAG_ARTIST, "Abc",
+				TAG_TITLE, "T"));
+		AddSong(c, "c2.mp3", 1,
+			MakeTag(TAG_ALBUM_ARTIST, "A", TAG_TITLE, "T"));
+	}
+
+	void TearDown() override {
+		/* the index refers to songs owned by the tree */
+		index.Clear();
+	}
+
+	static void AddSong(Directory &parent, const char *name,
+			    std::time_t mtime, Tag &&tag,
+			    bool in_playlist=false) {
+		auto song = Song::New(name, parent);
+		song->tag = std::move(tag);
+		song->mtime = std::chrono::system_clock::from_time_t(mtime);
+		song->in_playlist = in_playlist;
+		parent.AddSong(std::move(song));
+	}
+
+	void Mount() {
+		root->CreateChild("m")->mounted_database =
+			std::make_unique<FakeDatabase>();
+	}
+
+	static std::vector<std::string> Walk(const Directory &directory,
+					     bool recursive,
+					     const SongFilter &filter,
+					     bool hide_playlist_targets) {
+		std::vector<std::string> result;
+		directory.Walk(recursive, &filter, hide_playlist_targets,
+			       {},
+			       [&result](const LightSong &song){
+				       result.push_back(song.GetURI());
+			       },
+			       {});
+		return result;
+	}
+
+	/**
+	 * Visit the songs like SimpleDatabase::Visit() does: with the
+	 * index if possible, and with Directory::Walk() otherwise.
+	 *
+	 * @param used_index_r set to true if the index was used
+	 */
+	std::vector<std::string> Visit(const Directory &directory,
+				       bool recursive,
+				       const SongFilter &filter,
+				       bool hide_playlist_targets,
+				       bool &used_index_r) const {
+		std::vector<std::string> result;
+		used_index_r = index.Visit(directory, recursive, filter,
+					   hide_playlist_targets,
+					   [&result](const LightSong &song){
+						   result.push_back(song.GetURI());
+					   });
+		if (!used_index_r)
+			result = Walk(directory, recursive, filter,
+				      hide_playlist_targets);
+		return result;
+	}
+
+	/**
+	 * Compare the indexed results for all directories with those
+	 * of Directory::Walk().
+	 *
+	 * @return the number of queries which used the index
+	 */
+	unsigned Compare(const char *expression) const {
+		const auto filter = ParseFilter(expression);
+
+		unsigned n_indexed = 0;
+
+		for (const Directory *directory : {root.get(), &a, &b, &c}) {
+			for (const bool recursive : {false, true}) {
+				for (const bool hide : {false, true}) {
+					bool used_index;
+					EXPECT_EQ(Visit(*directory, recursive,
+							filter, hide,
+							used_index),
+						  Walk(*directory, recursive,
+						       filter, hide))
+						<< expression << " in \""
+						<< directory->GetPath()
+						<< "\" recursive=" << recursive
+						<< " hide=" << hide;
+
+					if (used_index)
+						++n_indexed;
+				}
+			}
+		}
+
+		return n_indexed;
+	}
+};
+
+static constexpr const char *filters[] = {
+	"(Artist == \"A\")",
+	"(Artist == \"Abc\")",
+	"(Artist == \"nonexistent\")",
+	"(Title == \"T\")",
+	"(Artist starts_with \"A\")",
+	"((Artist == \"A\") AND (Album == \"Y\"))",
+	"((Artist starts_with \"A\") AND (Album == \"X\"))",
+	"(modified-since \"3\")",
+	"((Artist == \"A\") AND (modified-since \"2\"))",
+
+	/* these fall back to "Artist" for songs without the
+	   requested tag */
+	"(AlbumArtist == \"A\")",
+	"(AlbumArtist == \"B\")",
+	"(ArtistSort == \"A\")",
+	"(AlbumArtistSort == \"A\")",
+	"(AlbumArtistSort starts_with \"A\")",
+};
+
+TEST_F(TagIndexTest, Unindexed)
+{
+	/* without Build(), the index must not be used */
+	for (const char *expression : filters)
+		EXPECT_EQ(Compare(expression), 0U) << expression;
+}
+
+TEST_F(TagIndexTest, Visit)
+{
+	index.Build(*root);
+
+	/* all queries can use the index, and the results must be the
+	   same as without it */
+	for (const char *expression : filters)
+		EXPECT_EQ(Compare(expression), 4U * 2U * 2U) << expression;
+
+	/* a filter which is not indexable */
+	EXPECT_EQ(Compare("(Artist != \"A\")"), 0U);
+	EXPECT_EQ(Compare("(Artist contains \"b\")"), 0U);
+}
+
+TEST_F(TagIndexTest, WithoutTags)
+{
+	index.Build(*root, false);
+
+	/* only "modified-since" can use the index, but all results
+	   must be the same as without it */
+	for (const char *expression : filters) {
+		const bool since = std::string_view{expression}
+			.find("modified-since") != std::string_view::npos;
+		EXPECT_EQ(Compare(expression), since ? 4U * 2U * 2U : 0U)
+			<< expression;
+	}
+}
+
+TEST_F(TagIndexTest, Fallback)
+{
+	index.Build(*root);
+
+	bool used_index;
+	const auto result = Visit(*root, true,
+				  ParseFilter("(AlbumArtist == \"A\")"),
+				  false, used_index);
+	EXPECT_TRUE(used_index);
+
+	/* "a/a1.mp3" has a different "AlbumArtist" and must not fall
+	   back to "Artist" */
+	const std::vector<std::string> expected{
+		"r1.mp3",
+		"a/a3.mp3",
+		"a/b/b1.mp3",
+		"c/c2.mp3",
+	};
+	EXPECT_EQ(result, expected);
+}
+
+TEST_F(TagIndexTest, Mount)
+{
+	Mount();
+	index.Build(*root);
+
+	const auto filter = ParseFilter("(Artist == \"A\")");
+
+	/* the songs of the mounted database are not in the index,
+	   therefore it cannot be used for recursive queries on the
+	   root directory, but still for the other directories */
+	bool used_index;
+	const auto result = Visit(*root, true, filter, false, used_index);
+	EXPECT_FALSE(used_index);
+	EXPECT_NE(std::find(result.begin(), result.end(), "m/mounted.mp3"),
+		  result.end());
+
+	Visit(*root, false, filter, false, used_index);
+	EXPECT_TRUE(used_index);
+
+	Visit(a, true, filter, false, used_index);
+	EXPECT_TRUE(used_index);
+
+	for (const char *expression : filters)
+		EXPECT_EQ(Compare(expression), 4U * 2U * 2U - 2U)
+			<< expression;
+}
+
+TEST_F(TagIndexTest, Target)
+{
+	/* a CUE sheet next to "c1.mp3"; its tracks have only the
+	   tags from the CUE sheet, all others are merged from the
+	   target song by Song::Export() */
+	Directory &cue = *c.CreateChild("c1.cue");
+	cue.device = DEVICE_PLAYLIST;
+
+	for (const char *name : {"track0001", "track0002"}) {
+		auto song = Song::New(name, cue);
+		song->target = "../c1.mp3";
+		song->tag = MakeTag(TAG_TITLE, name);
+		cue.AddSong(std::move(song));
+	}
+
+	/* the target does not exist */
+	auto song = Song::New("track0003", cue);
+	song->target = "../nonexistent.mp3";
+	song->tag = MakeTag(TAG_TITLE, "track0003");
+	cue.AddSong(std::move(song));
+
+	index.Build(*root);
+
+	for (const char *expression : filters)
+		EXPECT_EQ(Compare(expression), 4U * 2U * 2U) << expression;
+
+	bool used_index;
+	auto result = Visit(*root, true, ParseFilter("(Artist == \"Abc\")"),
+			    false, used_index);
+	EXPECT_TRUE(used_index);
+
+	const std::vector<std::string> expected{
+		"c/c1.mp3",
+		"c/c1.cue/track0001",
+		"c/c1.cue/track0002",
+	};
+	EXPECT_EQ(result, expected);
+
+	/* the track's own "Title" takes precedence */
+	result = Visit(*root, true, ParseFilter("(Title == \"T\")"),
+		       false, used_index);
+	EXPECT_TRUE(used_index);
+	EXPECT_EQ(std::count(result.begin(), result.end(),
+			     "c/c1.cue/track0001"), 0);
+
+	/* the modification time is inherited from the target, too */
+	result = Visit(*root, true, ParseFilter("(modified-since \"5\")"),
+		       false, used_index);
+	EXPECT_TRUE(used_index);
+	EXPECT_EQ(result, expected);
+}
@@ -19,6 +19,7 @@
 
 #include "MakeTag.hxx"
 #include "song/TagSongFilter.hxx"
+#include "song/TagGroupSongFilter.hxx"
 #include "song/LightSong.hxx"
 #include "tag/Type.h"
 #include "lib/icu/Init.hxx"
@@ -207,3 +208,53 @@ TEST_F(TagSongFilterTest, NegatedFallback)
 	EXPECT_FALSE(InvokeFilter(f, MakeTag(TAG_ARTIST, "needle")));
 	EXPECT_TRUE(InvokeFilter(f, MakeTag(TAG_ARTIST, "needle", TAG_ALBUM_ARTIST, "foo")));
 }
+
+/**
+ * A #TagGroupSongFilter must give the same results as evaluating its
+ * items one by one.
+ */
+TEST_F(TagSongFilterTest, Group)
+{
+	const TagSongFilter a{
+		TAG_ALBUM_ARTIST,
+		{"needle", false, StringFilter::Position::ANYWHERE, false},
+	};
+
+	const TagSongFilter b{
+		TAG_ALBUM_ARTIST,
+		{"needle2", false, StringFilter::Position::FULL, true},
+	};
+
+	const TagSongFilter c{
+		TAG_ALBUM_ARTIST,
+		{"foo", false, StringFilter::Position::PREFIX, false},
+	};
+
+	TagGroupSongFilter g;
+	g.AddItem(a);
+	g.AddItem(b);
+	g.AddItem(c);
+
+	const Tag tags[] = {
+		MakeTag(),
+		MakeTag(TAG_ALBUM_ARTIST, "needle"),
+		MakeTag(TAG_ALBUM_ARTIST, "needle", TAG_ALBUM_ARTIST, "foobar"),
+		MakeTag(TAG_ALBUM_ARTIST, "foobar", TAG_ALBUM_ARTIST, "xneedle"),
+		MakeTag(TAG_ALBUM_ARTIST, "foobar", TAG_ALBUM_ARTIST, "needle",
+			TAG_ALBUM_ARTIST, "needle2"),
+		MakeTag(TAG_ARTIST, "needle", TAG_ARTIST, "foo"),
+		MakeTag(TAG_ARTIST, "needle", TAG_ALBUM_ARTIST, "foo"),
+		MakeTag(TAG_ARTIST, "needle2", TAG_ARTIST, "needle", TAG_ARTIST, "foo"),
+	};
+
+	for (const auto &tag : tags) {
+		const bool expected = InvokeFilter(a, tag) &&
+			InvokeFilter(b, tag) && InvokeFilter(c, tag);
+		EXPECT_EQ(g.Match(LightSong("dummy", tag)), expected);
+	}
+
+	EXPECT_FALSE(g.Match(LightSong("dummy", MakeTag())));
+	EXPECT_TRUE(g.Match(LightSong("dummy", MakeTag(TAG_ALBUM_ARTIST, "needle", TAG_ALBUM_ARTIST, "foobar"))));
+	EXPECT_TRUE(g.Match(LightSong("dummy", MakeTag(TAG_ARTIST, "needle", TAG_ARTIST, "foo"))));
+	EXPECT_FALSE(g.Match(LightSong("dummy", MakeTag(TAG_ARTIST, "needle2", TAG_ARTIST, "needle", TAG_ARTIST, "foo"))));
+}
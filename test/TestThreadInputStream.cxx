@@ -0,0 +1,127 @@
+/*
+ * Unit tests for class ThreadInputStream.
+ */
+
+#include "input/ThreadInputStream.hxx"
+#include "input/CondHandler.hxx"
+#include "thread/Mutex.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string_view>
+
+#include <string.h>
+
+class StringThreadInputStream final : public ThreadInputStream {
+	const std::string_view data;
+	std::size_t position = 0;
+
+public:
+	StringThreadInputStream(const char *_uri, Mutex &_mutex,
+				std::string_view _data,
+				std::size_t _buffer_size,
+				bool _seekable)
+		:ThreadInputStream("string", _uri, _mutex, _buffer_size),
+		 data(_data) {
+		seekable = _seekable;
+		size = data.size();
+	}
+
+	~StringThreadInputStream() noexcept override {
+		Stop();
+	}
+
+protected:
+	/* virtual methods from ThreadInputStream */
+	size_t ThreadRead(void *ptr, size_t read_size) override {
+		/* deliver small chunks to exercise the loop */
+		const std::size_t nbytes = std::min({read_size,
+				data.size() - position,
+				std::size_t(3)});
+		memcpy(ptr, data.data() + position, nbytes);
+		position += nbytes;
+		return nbytes;
+	}
+
+	void ThreadSeek(offset_type new_offset) override {
+		position = new_offset;
+	}
+};
+
+static void
+WaitReady(InputStream &is, std::unique_lock<Mutex> &lock)
+{
+	CondInputStreamHandler handler;
+	is.SetHandler(&handler);
+	handler.cond.wait(lock, [&is]{ return is.IsReady(); });
+	is.SetHandler(nullptr);
+}
+
+static std::string
+ReadAll(InputStream &is, std::unique_lock<Mutex> &lock)
+{
+	std::string result;
+	char buffer[16];
+
+	std::size_t nbytes;
+	while ((nbytes = is.Read(lock, buffer, sizeof(buffer))) > 0)
+		result.append(buffer, nbytes);
+
+	return result;
+}
+
+TEST(ThreadInputStream, Basic)
+{
+	Mutex mutex;
+	StringThreadInputStream is("foo://", mutex, "hello world", 4, false);
+	is.Start();
+
+	std::unique_lock<Mutex> lock(mutex);
+	WaitReady(is, lock);
+
+	EXPECT_FALSE(is.IsSeekable());
+	EXPECT_EQ(ReadAll(is, lock), "hello world");
+	EXPECT_TRUE(is.IsEOF());
+	EXPECT_EQ(is.GetOffset(), offset_type(11));
+}
+
+TEST(ThreadInputStream, Seek)
+{
+	Mutex mutex;
+	StringThreadInputStream is("foo://", mutex,
+				   "0123456789abcdefghij", 8, true);
+	is.Start();
+
+	std::unique_lock<Mutex> lock(mutex);
+	WaitReady(is, lock);
+
+	EXPECT_TRUE(is.IsSeekable());
+
+	char buffer[4];
+	is.ReadFull(lock, buffer, 2);
+	EXPECT_EQ(std::string_view(buffer, 2), "01");
+
+	/* backwards */
+	is.Seek(lock, 1);
+	EXPECT_EQ(is.GetOffset(), offset_type(1));
+	is.ReadFull(lock, buffer, 3);
+	EXPECT_EQ(std::string_view(buffer, 3), "123");
+
+	/* forward, probably within the buffer */
+	is.Seek(lock, 5);
+	EXPECT_EQ(is.GetOffset(), offset_type(5));
+	is.ReadFull(lock, buffer, 2);
+	EXPECT_EQ(std::string_view(buffer, 2), "56");
+
+	/* far beyond the buffer */
+	is.Seek(lock, 17);
+	EXPECT_EQ(ReadAll(is, lock), "hij");
+	EXPECT_TRUE(is.IsEOF());
+
+	/* after the end has been reached */
+	is.Seek(lock, 0);
+	EXPECT_FALSE(is.IsEOF());
+	EXPECT_EQ(ReadAll(is, lock), "0123456789abcdefghij");
+	EXPECT_TRUE(is.IsEOF());
+}
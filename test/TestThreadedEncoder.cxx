@@ -0,0 +1,151 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "encoder/ThreadedEncoder.hxx"
+#include "tag/Tag.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/**
+ * A fake encoder which copies its input to its output, and appends
+ * a marker for each command.  It fails on the input byte 'X'.
+ */
+class CopyEncoder final : public Encoder {
+	std::string buffer = "H";
+
+public:
+	CopyEncoder() noexcept:Encoder(true) {}
+
+	void End() override {
+		buffer += "<end>";
+	}
+
+	void Flush() override {
+		buffer += "<flush>";
+	}
+
+	void PreTag() override {
+		buffer += "<pretag>";
+	}
+
+	void SendTag(const Tag &) override {
+		buffer += "<tag>";
+	}
+
+	void Write(std::span<const std::byte> src) override {
+		for (const auto b : src) {
+			if (b == std::byte{'X'})
+				throw std::runtime_error("X");
+
+			buffer.push_back(static_cast<char>(b));
+		}
+	}
+
+	std::span<const std::byte> Read(std::span<std::byte> dest) noexcept override {
+		const std::size_t n = std::min(dest.size(), buffer.size());
+		std::copy_n(reinterpret_cast<const std::byte *>(buffer.data()),
+			    n, dest.begin());
+		buffer.erase(0, n);
+		return dest.first(n);
+	}
+};
+
+static void
+Write(Encoder &encoder, std::string_view s)
+{
+	encoder.Write(std::as_bytes(std::span{s}));
+}
+
+static std::string
+ReadAll(Encoder &encoder)
+{
+	std::string result;
+	std::byte buffer[7];
+
+	while (true) {
+		const auto r = encoder.Read(buffer);
+		if (r.empty())
+			return result;
+
+		result.append(reinterpret_cast<const char *>(r.data()),
+			      r.size());
+	}
+}
+
+} // anonymous namespace
+
+TEST(ThreadedEncoder, Header)
+{
+	ThreadedEncoder encoder(std::make_unique<CopyEncoder>());
+	EXPECT_TRUE(encoder.ImplementsTag());
+	EXPECT_EQ(ReadAll(encoder), "H");
+}
+
+TEST(ThreadedEncoder, Order)
+{
+	ThreadedEncoder encoder(std::make_unique<CopyEncoder>());
+	EXPECT_EQ(ReadAll(encoder), "H");
+
+	std::string expected;
+	for (unsigned i = 0; i < 1000; ++i) {
+		const std::string s = std::to_string(i) + ",";
+		Write(encoder, s);
+		expected += s;
+	}
+
+	encoder.Flush();
+	expected += "<flush>";
+	EXPECT_EQ(ReadAll(encoder), expected);
+
+	Write(encoder, "abc");
+	encoder.PreTag();
+	EXPECT_EQ(ReadAll(encoder), "abc<pretag>");
+
+	encoder.SendTag(Tag{});
+	EXPECT_EQ(ReadAll(encoder), "<tag>");
+
+	Write(encoder, "def");
+	encoder.End();
+	EXPECT_EQ(ReadAll(encoder), "def<end>");
+}
+
+TEST(ThreadedEncoder, Large)
+{
+	/* more than fits into the queue at once */
+	ThreadedEncoder encoder(std::make_unique<CopyEncoder>());
+
+	const std::string s(1024 * 1024, 'a');
+	Write(encoder, s);
+	encoder.Flush();
+	EXPECT_EQ(ReadAll(encoder), "H" + s + "<flush>");
+}
+
+TEST(ThreadedEncoder, Error)
+{
+	ThreadedEncoder encoder(std::make_unique<CopyEncoder>());
+
+	Write(encoder, "aXb");
+	EXPECT_THROW(encoder.Flush(), std::runtime_error);
+	EXPECT_THROW(Write(encoder, "c"), std::runtime_error);
+}
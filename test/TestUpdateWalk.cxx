@@ -0,0 +1,276 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MakeTag.hxx"
+#include "db/update/Walk.hxx"
+#include "db/update/Config.hxx"
+#include "db/update/SkipCache.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/DatabaseLock.hxx"
+#include "playlist/PlaylistRegistry.hxx"
+#include "storage/StorageInterface.hxx"
+#include "storage/plugins/LocalStorage.hxx"
+#include "storage/FileInfo.hxx"
+#include "config/Data.hxx"
+#include "config/Block.hxx"
+#include "event/Loop.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Path.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Tag.hxx"
+#include "util/StringFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <forward_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct DirectoryDeleter {
+	void operator()(Directory *directory) const noexcept {
+		const ScopeDatabaseLock protect;
+		delete directory;
+	}
+};
+
+using DirectoryPtr = std::unique_ptr<Directory, DirectoryDeleter>;
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+/**
+ * A temporary music directory; it is deleted (with all files created
+ * by CreateFile()) by the destructor.
+ */
+class TemporaryMusicDirectory {
+	AllocatedPath path = nullptr;
+
+	std::forward_list<AllocatedPath> files;
+
+public:
+	TemporaryMusicDirectory() {
+		char buffer[] = "/tmp/TestUpdateWalk.XXXXXX";
+		if (mkdtemp(buffer) == nullptr)
+			throw std::runtime_error("mkdtemp() failed");
+
+		path = AllocatedPath::FromFS(buffer);
+	}
+
+	~TemporaryMusicDirectory() noexcept {
+		for (const auto &i : files)
+			unlink(i.c_str());
+
+		rmdir(path.c_str());
+	}
+
+	TemporaryMusicDirectory(const TemporaryMusicDirectory &) = delete;
+	TemporaryMusicDirectory &operator=(const TemporaryMusicDirectory &) = delete;
+
+	Path GetPath() const noexcept {
+		return path;
+	}
+
+	AllocatedPath GetFilePath(const char *name) const noexcept {
+		return path / Path::FromFS(name);
+	}
+
+	void CreateFile(const char *name, const std::string &contents) {
+		auto file_path = GetFilePath(name);
+
+		FILE *file = fopen(file_path.c_str(), "w");
+		if (file == nullptr)
+			throw std::runtime_error("fopen() failed");
+
+		fwrite(contents.data(), 1, contents.size(), file);
+		fclose(file);
+
+		files.emplace_front(std::move(file_path));
+	}
+};
+
+/**
+ * Generate an extended M3U playlist with the specified number of
+ * (remote) entries.
+ */
+static std::string
+MakePlaylist(unsigned n)
+{
+	std::string result = "#EXTM3U\n";
+	for (unsigned i = 0; i < n; ++i) {
+		result += StringFormat<64>("http://example.com/%u.ogg", i).c_str();
+		result += '\n';
+	}
+
+	return result;
+}
+
+class UpdateWalkTest : public ::testing::Test {
+protected:
+	ConfigData config;
+
+	EventLoop event_loop;
+	NullDatabaseListener listener;
+
+	TemporaryMusicDirectory music_directory;
+	std::unique_ptr<Storage> storage;
+
+	DirectoryPtr root{Directory::NewRoot()};
+
+	void SetUp() override {
+		/* represent playlists as directories, like CUE
+		   sheets */
+		ConfigBlock block;
+		block.AddBlockParam("name", "extm3u");
+		block.AddBlockParam("as_directory", "yes");
+		config.AddBlock(ConfigBlockOption::PLAYLIST_PLUGIN,
+				std::move(block));
+
+		playlist_list_global_init(config);
+
+		storage = CreateLocalStorage(music_directory.GetPath());
+	}
+
+	void TearDown() override {
+		playlist_list_global_finish();
+	}
+
+	bool Walk(const UpdateConfig &update_config) {
+		UpdateWalk walk(update_config, event_loop, listener,
+				*storage, nullptr);
+		return walk.Walk(*root, nullptr, {}, false);
+	}
+
+	unsigned CountPlaylistSongs(std::string_view name) {
+		const ScopeDatabaseLock protect;
+		const Directory *directory = root->FindChild(name);
+		if (directory == nullptr)
+			return 0;
+
+		EXPECT_TRUE(directory->IsPlaylist());
+
+		return directory->songs.size();
+	}
+};
+
+TEST_F(UpdateWalkTest, Playlist)
+{
+	const UpdateConfig update_config(config);
+
+	/* smaller and larger than the batch size */
+	const unsigned small = update_config.batch_size / 2;
+	const unsigned large = update_config.batch_size * 2 + 1;
+	music_directory.CreateFile("small.m3u", MakePlaylist(small));
+	music_directory.CreateFile("one.m3u", MakePlaylist(1));
+	music_directory.CreateFile("large.m3u", MakePlaylist(large));
+	music_directory.CreateFile("empty.m3u", MakePlaylist(0));
+
+	EXPECT_TRUE(Walk(update_config));
+
+	EXPECT_EQ(CountPlaylistSongs("small.m3u"), small);
+	EXPECT_EQ(CountPlaylistSongs("one.m3u"), 1U);
+	EXPECT_EQ(CountPlaylistSongs("large.m3u"), large);
+
+	{
+		const ScopeDatabaseLock protect;
+		EXPECT_EQ(root->FindChild("empty.m3u"), nullptr);
+	}
+
+	/* nothing was modified; a second update must preserve
+	   everything */
+	EXPECT_FALSE(Walk(update_config));
+
+	EXPECT_EQ(CountPlaylistSongs("small.m3u"), small);
+	EXPECT_EQ(CountPlaylistSongs("one.m3u"), 1U);
+	EXPECT_EQ(CountPlaylistSongs("large.m3u"), large);
+}
+
+static Tag
+MakeHiddenTag(const char *comment) noexcept
+{
+	TagBuilder builder;
+	builder.AddItemUnchecked(TAG_COMMENT, comment);
+	return builder.Commit();
+}
+
+/**
+ * With "update_threads", an existing song is rescanned into a new
+ * #Song object by the #UpdateScanPool, and the result is merged
+ * with MoveScannedFrom(); this must update the same attributes as
+ * Song::UpdateFile().
+ */
+TEST(UpdateScanPool, MoveScanned)
+{
+	const DirectoryPtr root{Directory::NewRoot()};
+
+	auto song = Song::New("song.flac", *root);
+	song->tag = MakeTag(TAG_ARTIST, "old");
+	song->hidden_tag = MakeHiddenTag("old");
+	song->mtime = std::chrono::system_clock::from_time_t(1);
+
+	auto result = Song::New("song.flac", *root);
+	result->tag = MakeTag(TAG_ARTIST, "new");
+	result->hidden_tag = MakeHiddenTag("new");
+	result->mtime = std::chrono::system_clock::from_time_t(2);
+	result->audio_format = AudioFormat(44100, SampleFormat::S16, 2);
+
+	song->MoveScannedFrom(std::move(*result));
+
+	EXPECT_STREQ(song->tag.GetValue(TAG_ARTIST), "new");
+	EXPECT_STREQ(song->hidden_tag.GetValue(TAG_COMMENT), "new");
+	EXPECT_EQ(song->mtime, std::chrono::system_clock::from_time_t(2));
+	EXPECT_EQ(song->audio_format,
+		  AudioFormat(44100, SampleFormat::S16, 2));
+}
+
+/**
+ * A modification anywhere in the file (not only near the beginning
+ * or the end) must change the fingerprint.
+ */
+TEST(UpdateSkipCache, Fingerprint)
+{
+	TemporaryMusicDirectory music_directory;
+
+	std::string contents(1024 * 1024, 'a');
+	music_directory.CreateFile("song.flac", contents);
+
+	const auto path_fs = music_directory.GetFilePath("song.flac");
+	const StorageFileInfo info(StorageFileInfo::Type::REGULAR);
+
+	const auto a = UpdateSkipCache::Calculate(path_fs, info);
+	EXPECT_EQ(a.size, contents.size());
+	EXPECT_EQ(UpdateSkipCache::Calculate(path_fs, info), a);
+
+	contents[contents.size() / 2] = 'b';
+	music_directory.CreateFile("song.flac", contents);
+
+	const auto b = UpdateSkipCache::Calculate(path_fs, info);
+	EXPECT_EQ(b.size, a.size);
+	EXPECT_NE(b, a);
+}
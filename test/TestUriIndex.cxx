@@ -0,0 +1,171 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "db/plugins/simple/UriIndex.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+struct DirectoryDeleter {
+	void operator()(Directory *directory) const noexcept {
+		delete directory;
+	}
+};
+
+using DirectoryPtr = std::unique_ptr<Directory, DirectoryDeleter>;
+
+class UriIndexTest : public ::testing::Test {
+protected:
+	/* the #Directory methods assert that the caller holds the
+	   #db_mutex */
+	const ScopeDatabaseLock protect;
+
+	DirectoryPtr root{Directory::NewRoot()};
+
+	UriIndex index;
+
+	Directory &AddDirectory(Directory &parent, const char *name) {
+		return *parent.CreateChild(name);
+	}
+
+	const Song &AddSong(Directory &parent, const char *name) {
+		parent.AddSong(Song::New(name, parent));
+		return *parent.FindSong(name);
+	}
+
+	void TearDown() override {
+		/* the index refers to songs owned by the tree */
+		index.Clear();
+	}
+};
+
+TEST_F(UriIndexTest, Empty)
+{
+	EXPECT_EQ(index.Find("foo.mp3"), nullptr);
+
+	index.Build(*root);
+	EXPECT_EQ(index.Find("foo.mp3"), nullptr);
+	EXPECT_EQ(index.Find(""), nullptr);
+}
+
+TEST_F(UriIndexTest, Find)
+{
+	auto &a = AddDirectory(*root, "a");
+	auto &b = AddDirectory(a, "b");
+
+	const auto &x = AddSong(*root, "x.mp3");
+	const auto &y = AddSong(a, "y.ogg");
+	const auto &z = AddSong(b, "z.flac");
+
+	index.Build(*root);
+
+	EXPECT_EQ(index.Find("x.mp3"), &x);
+	EXPECT_EQ(index.Find("a/y.ogg"), &y);
+	EXPECT_EQ(index.Find("a/b/z.flac"), &z);
+}
+
+TEST_F(UriIndexTest, Miss)
+{
+	auto &a = AddDirectory(*root, "a");
+	auto &b = AddDirectory(a, "b");
+
+	AddSong(*root, "x.mp3");
+	AddSong(b, "z.flac");
+
+	index.Build(*root);
+
+	EXPECT_EQ(index.Find("y.mp3"), nullptr);
+	EXPECT_EQ(index.Find(""), nullptr);
+	EXPECT_EQ(index.Find("a"), nullptr);
+	EXPECT_EQ(index.Find("a/b"), nullptr);
+
+	/* correct file name in the wrong directory */
+	EXPECT_EQ(index.Find("a/x.mp3"), nullptr);
+	EXPECT_EQ(index.Find("z.flac"), nullptr);
+	EXPECT_EQ(index.Find("b/z.flac"), nullptr);
+	EXPECT_EQ(index.Find("a/c/z.flac"), nullptr);
+
+	/* malformed URIs */
+	EXPECT_EQ(index.Find("/x.mp3"), nullptr);
+	EXPECT_EQ(index.Find("a//b/z.flac"), nullptr);
+	EXPECT_EQ(index.Find("a/bz.flac"), nullptr);
+	EXPECT_EQ(index.Find("x.mp"), nullptr);
+}
+
+/**
+ * Songs with the same file name in different directories must not be
+ * confused, even though they may collide in the hash table.
+ */
+TEST_F(UriIndexTest, SameName)
+{
+	auto &a = AddDirectory(*root, "a");
+	auto &b = AddDirectory(a, "b");
+	auto &c = AddDirectory(*root, "c");
+
+	const auto &s_root = AddSong(*root, "song.mp3");
+	const auto &s_a = AddSong(a, "song.mp3");
+	const auto &s_b = AddSong(b, "song.mp3");
+	const auto &s_c = AddSong(c, "song.mp3");
+
+	index.Build(*root);
+
+	EXPECT_EQ(index.Find("song.mp3"), &s_root);
+	EXPECT_EQ(index.Find("a/song.mp3"), &s_a);
+	EXPECT_EQ(index.Find("a/b/song.mp3"), &s_b);
+	EXPECT_EQ(index.Find("c/song.mp3"), &s_c);
+	EXPECT_EQ(index.Find("b/song.mp3"), nullptr);
+}
+
+TEST_F(UriIndexTest, Many)
+{
+	auto &a = AddDirectory(*root, "a");
+	auto &b = AddDirectory(a, "b");
+
+	for (unsigned i = 0; i < 1000; ++i) {
+		const auto name = std::to_string(i) + ".flac";
+		AddSong(a, name.c_str());
+		AddSong(b, name.c_str());
+	}
+
+	index.Build(*root);
+
+	for (unsigned i = 0; i < 1000; ++i) {
+		const auto name = std::to_string(i) + ".flac";
+		EXPECT_EQ(index.Find("a/" + name), a.FindSong(name));
+		EXPECT_EQ(index.Find("a/b/" + name), b.FindSong(name));
+	}
+
+	EXPECT_EQ(index.Find("a/1000.flac"), nullptr);
+}
+
+TEST_F(UriIndexTest, Clear)
+{
+	AddSong(*root, "x.mp3");
+
+	index.Build(*root);
+	EXPECT_NE(index.Find("x.mp3"), nullptr);
+
+	index.Clear();
+	EXPECT_EQ(index.Find("x.mp3"), nullptr);
+}
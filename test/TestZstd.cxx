@@ -0,0 +1,124 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "lib/zstd/ZstdOutputStream.hxx"
+#include "lib/zstd/AutoZstdReader.hxx"
+#include "io/Reader.hxx"
+#include "io/StringOutputStream.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace {
+
+class StringReader final : public Reader {
+	std::string_view src;
+
+public:
+	explicit StringReader(std::string_view _src) noexcept
+		:src(_src) {}
+
+	std::size_t Read(void *data, std::size_t size) override {
+		size = std::min(size, src.size());
+		memcpy(data, src.data(), size);
+		src.remove_prefix(size);
+		return size;
+	}
+};
+
+std::string
+ReadAll(Reader &r)
+{
+	std::string result;
+
+	char buffer[1000];
+	std::size_t nbytes;
+	while ((nbytes = r.Read(buffer, sizeof(buffer))) > 0)
+		result.append(buffer, nbytes);
+
+	return result;
+}
+
+std::string
+MakeInput()
+{
+	std::string input;
+	for (unsigned i = 0; i < 100000; ++i)
+		input += "song_begin: " + std::to_string(i) + "\n";
+	return input;
+}
+
+std::string
+Compress(std::string_view src, unsigned n_threads)
+{
+	std::string result;
+	StringOutputStream sos(result);
+	ZstdOutputStream zstd(sos, ZSTD_CLEVEL_DEFAULT, n_threads);
+	zstd.Write(src.data(), src.size());
+	zstd.Finish();
+	return result;
+}
+
+} // anonymous namespace
+
+TEST(Zstd, RoundTrip)
+{
+	const auto input = MakeInput();
+	const auto compressed = Compress(input, 0);
+	EXPECT_LT(compressed.size(), input.size());
+
+	StringReader sr(compressed);
+	AutoZstdReader reader(sr);
+	EXPECT_EQ(ReadAll(reader), input);
+}
+
+TEST(Zstd, Threads)
+{
+	const auto input = MakeInput();
+
+	const auto compressed = Compress(input, 4);
+
+	StringReader sr(compressed);
+	AutoZstdReader reader(sr);
+	EXPECT_EQ(ReadAll(reader), input);
+}
+
+TEST(Zstd, Uncompressed)
+{
+	const std::string_view input = "not compressed\n";
+
+	StringReader sr(input);
+	AutoZstdReader reader(sr);
+	EXPECT_EQ(ReadAll(reader), input);
+}
+
+TEST(Zstd, Truncated)
+{
+	auto compressed = Compress(MakeInput(), 0);
+	compressed.resize(compressed.size() / 2);
+
+	StringReader sr(compressed);
+	AutoZstdReader reader(sr);
+	EXPECT_ANY_THROW(ReadAll(reader));
+}
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * This program measures how long it takes to load a database (as
+ * configured in the given mpd.conf), how much memory it occupies,
+ * and the latency of typical queries ("find", "search", "list",
+ * "lsinfo") on it.  It is meant to compare database formats and
+ * options such as "tag_index".
+ *
+ */
+
+#include "config.h"
+#include "db/DatabaseGlue.hxx"
+#include "db/Interface.hxx"
+#include "db/Selection.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/LightDirectory.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "song/LightSong.hxx"
+#include "song/Filter.hxx"
+#include "tag/Tag.hxx"
+#include "tag/Pool.hxx"
+#include "tag/Config.hxx"
+#include "config/Data.hxx"
+#include "config/Param.hxx"
+#include "config/Block.hxx"
+#include "ConfigGlue.hxx"
+#include "fs/NarrowPath.hxx"
+#include "event/Thread.hxx"
+#include "util/RecursiveMap.hxx"
+#include "util/ScopeExit.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/resource.h>
+
+using Clock = std::chrono::steady_clock;
+using FloatMilliseconds = std::chrono::duration<double, std::milli>;
+
+class GlobalInit {
+	EventThread io_thread;
+
+public:
+	GlobalInit() {
+		io_thread.Start();
+	}
+
+	EventLoop &GetEventLoop() {
+		return io_thread.GetEventLoop();
+	}
+};
+
+class NullDatabaseListener final : public DatabaseListener {
+public:
+	void OnDatabaseModified() noexcept override {}
+	void OnDatabaseSongRemoved(const char *) noexcept override {}
+};
+
+/**
+ * Results are written here to prevent the compiler from optimizing
+ * the queries away.
+ */
+static volatile std::size_t sink;
+
+/**
+ * Returns the peak resident set size of this process in kB.
+ */
+static long
+GetPeakRss() noexcept
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return -1;
+
+	return usage.ru_maxrss;
+}
+
+static DatabasePtr
+CreateDatabase(const ConfigData &config, EventLoop &event_loop,
+	       DatabaseListener &listener)
+{
+	if (const auto *block = config.GetBlock(ConfigBlockOption::DATABASE))
+		return DatabaseGlobalInit(event_loop, event_loop,
+					  listener, *block);
+
+	const auto *path = config.GetParam(ConfigOption::DB_FILE);
+	ConfigBlock block(path != nullptr ? path->line : -1);
+	if (path != nullptr)
+		block.AddBlockParam("path", path->value, path->line);
+
+	return DatabaseGlobalInit(event_loop, event_loop, listener, block);
+}
+
+/**
+ * Things found in the database which are used as query arguments.
+ */
+struct Samples {
+	std::size_t n_songs = 0, n_tag_items = 0, n_playlists = 0;
+
+	std::vector<std::string> directories, artists;
+};
+
+static Samples
+CollectSamples(const Database &db)
+{
+	Samples samples;
+
+	db.Visit(DatabaseSelection("", true),
+		 [&samples](const LightDirectory &directory){
+			 samples.directories.emplace_back(directory.GetPath());
+		 },
+		 [&samples](const LightSong &song){
+			 ++samples.n_songs;
+
+			 for (const auto &item : song.tag) {
+				 ++samples.n_tag_items;
+				 if (item.type == TAG_ARTIST)
+					 samples.artists.emplace_back(item.value);
+			 }
+		 },
+		 [&samples](const PlaylistInfo &, const LightDirectory &){
+			 ++samples.n_playlists;
+		 });
+
+	std::sort(samples.artists.begin(), samples.artists.end());
+	samples.artists.erase(std::unique(samples.artists.begin(),
+					  samples.artists.end()),
+			      samples.artists.end());
+
+	return samples;
+}
+
+static void
+PrintMemory(const Database &db, const Samples &samples,
+	    long rss_before, long rss_after)
+{
+	printf("songs:        %zu\n"
+	       "directories:  %zu\n"
+	       "playlists:    %zu\n"
+	       "tag items:    %zu\n"
+	       "artists:      %zu\n",
+	       samples.n_songs, samples.directories.size(),
+	       samples.n_playlists, samples.n_tag_items,
+	       samples.artists.size());
+
+	printf("peak RSS:     %ld kB (%ld kB before loading)\n",
+	       rss_after, rss_before);
+
+	if (const auto *simple = dynamic_cast<const SimpleDatabase *>(&db)) {
+		const auto arena = simple->GetArenaStats();
+		printf("arena:        %zu allocations, %zu of %zu bytes used\n",
+		       arena.n_allocations, arena.used, arena.size);
+	}
+
+	const auto pool = tag_pool_get_stats();
+	printf("tag pool:     %zu items, %zu buckets, longest chain %zu\n",
+	       pool.n_slots, pool.n_buckets, pool.max_chain);
+}
+
+/**
+ * Run the query the given number of times, each time with a
+ * different sample index, and print latency percentiles.
+ */
+static void
+Measure(const char *name, unsigned iterations, std::size_t n_samples,
+	const std::function<std::size_t(std::size_t)> &query)
+{
+	if (n_samples == 0) {
+		printf("%-8s (no samples)\n", name);
+		return;
+	}
+
+	std::minstd_rand random;
+	std::uniform_int_distribution<std::size_t> pick(0, n_samples - 1);
+
+	std::vector<Clock::duration> durations;
+	durations.reserve(iterations);
+
+	for (unsigned i = 0; i < iterations; ++i) {
+		const std::size_t sample = pick(random);
+
+		const auto start = Clock::now();
+		sink = query(sample);
+		durations.push_back(Clock::now() - start);
+	}
+
+	std::sort(durations.begin(), durations.end());
+
+	const auto percentile = [&durations](unsigned p){
+		const std::size_t i = (durations.size() - 1) * p / 100;
+		return FloatMilliseconds(durations[i]).count();
+	};
+
+	printf("%-8s p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms  max %9.3f ms\n",
+	       name, percentile(50), percentile(90), percentile(99),
+	       percentile(100));
+}
+
+static void
+RunQueries(const Database &db, const Samples &samples, unsigned iterations)
+{
+	const auto &artists = samples.artists;
+	const auto &directories = samples.directories;
+
+	Measure("find", iterations, artists.size(),
+		[&db, &artists](std::size_t i){
+			SongFilter filter(TAG_ARTIST, artists[i].c_str());
+			filter.Optimize();
+
+			std::size_t n = 0;
+			db.Visit(DatabaseSelection("", true, &filter),
+				 [&n](const LightSong &){ ++n; });
+			return n;
+		});
+
+	Measure("search", iterations, artists.size(),
+		[&db, &artists](std::size_t i){
+			/* a substring, as typed by a user */
+			const std::string value = artists[i].substr(0, 4);
+			SongFilter filter(TAG_ARTIST, value.c_str(), true);
+			filter.Optimize();
+
+			std::size_t n = 0;
+			db.Visit(DatabaseSelection("", true, &filter),
+				 [&n](const LightSong &){ ++n; });
+			return n;
+		});
+
+	Measure("list", iterations, 1,
+		[&db](std::size_t){
+			static constexpr TagType tag_types[] = {
+				TAG_ALBUM_ARTIST, TAG_ALBUM,
+			};
+
+			return db.CollectUniqueTags(DatabaseSelection("", true),
+						    tag_types).size();
+		});
+
+	Measure("lsinfo", iterations, directories.size(),
+		[&db, &directories](std::size_t i){
+			std::size_t n = 0;
+			db.Visit(DatabaseSelection(directories[i].c_str(), false),
+				 [&n](const LightDirectory &){ ++n; },
+				 [&n](const LightSong &){ ++n; },
+				 [&n](const PlaylistInfo &, const LightDirectory &){ ++n; });
+			return n;
+		});
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: bench_database CONFIG [ITERATIONS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const FromNarrowPath config_path = argv[1];
+	const unsigned iterations = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 100;
+
+	GlobalInit init;
+
+	const auto config = AutoLoadConfigFile(config_path);
+
+	TagLoadConfig(config);
+
+	NullDatabaseListener listener;
+
+	auto db = CreateDatabase(config, init.GetEventLoop(), listener);
+
+	const long rss_before = GetPeakRss();
+	const auto load_start = Clock::now();
+
+	db->Open();
+
+	const FloatMilliseconds load_duration = Clock::now() - load_start;
+	const long rss_after = GetPeakRss();
+
+	AtScopeExit(&db) { db->Close(); };
+
+	printf("load:         %.1f ms\n", load_duration.count());
+
+	const auto samples = CollectSamples(*db);
+	PrintMemory(*db, samples, rss_before, rss_after);
+
+	printf("\n");
+	RunQueries(*db, samples, iterations);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,642 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the performance of MPD's decoder plugins: it
+ * decodes each file of a corpus with every enabled plugin which
+ * supports its suffix and reports the realtime factor (wall clock
+ * and CPU time), the latency until the first chunk, the seek latency
+ * and the memory usage, e.g. to compare plugins which decode the same
+ * format (mad vs. mpg123 vs. ffmpeg) or to spot regressions.
+ *
+ * Decoded audio is discarded; the program does not convert or play
+ * anything.
+ *
+ */
+
+#include "ConfigGlue.hxx"
+#include "event/Thread.hxx"
+#include "decoder/DecoderList.hxx"
+#include "decoder/DecoderPlugin.hxx"
+#include "decoder/DecoderAPI.hxx" /* for class StopDecoder */
+#include "decoder/Client.hxx"
+#include "input/Init.hxx"
+#include "input/InputStream.hxx"
+#include "fs/Path.hxx"
+#include "fs/NarrowPath.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "cmdline/OptionDef.hxx"
+#include "cmdline/OptionParser.hxx"
+#include "thread/Mutex.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringBuffer.hxx"
+#include "util/UriExtract.hxx"
+#include "Log.hxx"
+#include "LogBackend.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#if __GLIBC_PREREQ(2, 33)
+#define HAVE_MALLINFO2
+#endif
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The number of C++ heap allocations; counted by the replacement
+ * operator new below.  Allocations made with malloc() by C libraries
+ * are not counted, but they do show up in GetHeapUsage().
+ */
+static std::atomic_size_t n_allocations;
+
+void *
+operator new(std::size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+	free(p);
+}
+
+/**
+ * Returns the number of bytes currently allocated from the heap, or 0
+ * if this cannot be determined on this platform.
+ */
+static std::size_t
+GetHeapUsage() noexcept
+{
+#ifdef HAVE_MALLINFO2
+	const auto mi = mallinfo2();
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static double
+GetCpuTime() noexcept
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) < 0)
+		return 0;
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+ToMilliseconds(Clock::duration d) noexcept
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+struct CommandLine {
+	std::vector<const char *> decoders;
+	std::vector<const char *> files;
+
+	FromNarrowPath config_path;
+
+	unsigned n_seeks = 4;
+	unsigned n_repeat = 1;
+
+	bool verbose = false;
+};
+
+enum Option {
+	OPTION_CONFIG,
+	OPTION_VERBOSE,
+	OPTION_DECODER,
+	OPTION_SEEKS,
+	OPTION_REPEAT,
+};
+
+static constexpr OptionDef option_defs[] = {
+	{"config", 0, true, "Load a MPD configuration file"},
+	{"verbose", 'v', false, "Verbose logging"},
+	{"decoder", 'd', true, "Benchmark only this decoder plugin (may be repeated)"},
+	{"seeks", 0, true, "Number of seeks per file (default 4, 0 disables)"},
+	{"repeat", 'r', true, "Decode each file this many times, report the fastest run"},
+};
+
+static unsigned
+ParseUnsigned(const char *s)
+{
+	char *endptr;
+	const unsigned long value = strtoul(s, &endptr, 10);
+	if (endptr == s || *endptr != 0)
+		throw std::runtime_error("Not a number");
+
+	return value;
+}
+
+static CommandLine
+ParseCommandLine(int argc, char **argv)
+{
+	CommandLine c;
+
+	OptionParser option_parser(option_defs, argc, argv);
+	while (auto o = option_parser.Next()) {
+		switch (Option(o.index)) {
+		case OPTION_CONFIG:
+			c.config_path = o.value;
+			break;
+
+		case OPTION_VERBOSE:
+			c.verbose = true;
+			break;
+
+		case OPTION_DECODER:
+			c.decoders.push_back(o.value);
+			break;
+
+		case OPTION_SEEKS:
+			c.n_seeks = ParseUnsigned(o.value);
+			break;
+
+		case OPTION_REPEAT:
+			c.n_repeat = std::max(ParseUnsigned(o.value), 1U);
+			break;
+		}
+	}
+
+	auto args = option_parser.GetRemaining();
+	if (args.empty())
+		throw std::runtime_error("Usage: bench_decoder [--verbose] [--config=FILE] [--decoder=NAME] [--seeks=N] [--repeat=N] FILE...");
+
+	c.files.assign(args.begin(), args.end());
+	return c;
+}
+
+class GlobalInit {
+	const ConfigData config;
+	EventThread io_thread;
+	const ScopeInputPluginsInit input_plugins_init;
+	const ScopeDecoderPluginsInit decoder_plugins_init;
+
+public:
+	explicit GlobalInit(Path config_path)
+		:config(AutoLoadConfigFile(config_path)),
+		 input_plugins_init(config, io_thread.GetEventLoop()),
+		 decoder_plugins_init(config)
+	{
+		io_thread.Start();
+	}
+};
+
+/**
+ * A #DecoderClient which discards the decoded data and takes
+ * measurements instead.  Optionally, it seeks to a number of
+ * positions spread over the song and measures how long it takes
+ * until audio data arrives after each seek.
+ */
+class BenchDecoderClient final : public DecoderClient {
+	/**
+	 * Sample the heap usage only every this many chunks, because
+	 * mallinfo2() is not free.
+	 */
+	static constexpr unsigned HEAP_SAMPLE_INTERVAL = 64;
+
+	const unsigned n_seeks;
+
+	std::vector<SongTime> seek_targets;
+	std::size_t next_seek = 0;
+
+	Clock::time_point seek_start;
+
+	/**
+	 * The SEEK command is being reported by GetCommand().
+	 */
+	bool seek_pending = false;
+
+	/**
+	 * The seek has finished, and we are waiting for the first
+	 * chunk after it.
+	 */
+	bool seek_waiting = false;
+
+	bool stop = false;
+
+	const std::size_t heap_baseline;
+
+	unsigned heap_sample_counter = 0;
+
+	/**
+	 * WriteAudio() lends this buffer to the plugin.
+	 */
+	std::byte write_buffer[16384];
+
+public:
+	Mutex mutex;
+
+	const Clock::time_point start_time = Clock::now();
+	Clock::time_point first_audio_time;
+
+	AudioFormat audio_format = AudioFormat::Undefined();
+	SignedSongTime duration;
+	bool initialized = false, seekable = false;
+	bool have_audio = false;
+
+	uint64_t n_frames = 0;
+
+	std::vector<Clock::duration> seek_latencies;
+	unsigned seek_errors = 0;
+
+	std::size_t peak_heap = 0;
+
+	explicit BenchDecoderClient(unsigned _n_seeks) noexcept
+		:n_seeks(_n_seeks), heap_baseline(GetHeapUsage()) {}
+
+	/**
+	 * Returns the maximum heap usage (in bytes) observed while
+	 * decoding, relative to the usage before decoding started.
+	 */
+	std::size_t GetPeakHeap() const noexcept {
+		return peak_heap > heap_baseline ? peak_heap - heap_baseline : 0;
+	}
+
+	/* virtual methods from DecoderClient */
+	void Ready(AudioFormat _audio_format,
+		   bool _seekable, SignedSongTime _duration) noexcept override {
+		assert(!initialized);
+
+		audio_format = _audio_format;
+		seekable = _seekable;
+		duration = _duration;
+		initialized = true;
+
+		SampleHeap();
+
+		if (n_seeks == 0)
+			return;
+
+		if (!seekable || !duration.IsPositive()) {
+			stop = true;
+			return;
+		}
+
+		/* alternate between forward and backward seeks */
+		for (unsigned i = 0, lo = 1, hi = n_seeks; i < n_seeks; ++i) {
+			const unsigned n = i % 2 == 0 ? lo++ : hi--;
+			seek_targets.push_back(SongTime::FromMS(uint64_t(SongTime(duration).ToMS()) * n / (n_seeks + 1)));
+		}
+	}
+
+	DecoderCommand GetCommand() noexcept override {
+		if (stop)
+			return DecoderCommand::STOP;
+
+		if (seek_pending)
+			return DecoderCommand::SEEK;
+
+		return DecoderCommand::NONE;
+	}
+
+	void CommandFinished() noexcept override {
+		assert(seek_pending);
+
+		seek_pending = false;
+		seek_waiting = true;
+		++next_seek;
+	}
+
+	SongTime GetSeekTime() noexcept override {
+		assert(seek_pending);
+
+		return seek_targets[next_seek];
+	}
+
+	uint64_t GetSeekFrame() noexcept override {
+		return GetSeekTime().ToScale<uint64_t>(audio_format.sample_rate);
+	}
+
+	void SeekError() noexcept override {
+		assert(seek_pending);
+
+		seek_pending = false;
+		++seek_errors;
+		++next_seek;
+		StartSeek();
+	}
+
+	InputStreamPtr OpenUri(const char *uri) override {
+		return InputStream::OpenReady(uri, mutex);
+	}
+
+	size_t Read(InputStream &is,
+		    void *buffer, size_t length) noexcept override {
+		try {
+			return is.LockRead(buffer, length);
+		} catch (...) {
+			return 0;
+		}
+	}
+
+	void SubmitTimestamp(FloatDuration) noexcept override {
+	}
+
+	DecoderCommand SubmitAudio(InputStream *,
+				   std::span<const std::byte> audio,
+				   uint16_t) noexcept override {
+		return OnAudio(audio.size());
+	}
+
+	std::span<std::byte> WriteAudio(InputStream *,
+					uint16_t) noexcept override {
+		if (!initialized || GetCommand() != DecoderCommand::NONE)
+			return {};
+
+		const std::size_t frame_size = audio_format.GetFrameSize();
+		return {write_buffer, sizeof(write_buffer) / frame_size * frame_size};
+	}
+
+	DecoderCommand CommitAudio(std::size_t nbytes) noexcept override {
+		return OnAudio(nbytes);
+	}
+
+	DecoderCommand SubmitTag(InputStream *, Tag &&) noexcept override {
+		return GetCommand();
+	}
+
+	void SubmitReplayGain(const ReplayGainInfo *) noexcept override {
+	}
+
+	void SubmitMixRamp(MixRampInfo &&) noexcept override {
+	}
+
+private:
+	void SampleHeap() noexcept {
+		peak_heap = std::max(peak_heap, GetHeapUsage());
+	}
+
+	void StartSeek() noexcept {
+		if (next_seek < seek_targets.size()) {
+			seek_pending = true;
+			seek_start = Clock::now();
+		} else
+			stop = true;
+	}
+
+	DecoderCommand OnAudio(std::size_t nbytes) noexcept {
+		if (nbytes == 0)
+			return GetCommand();
+
+		if (!have_audio) {
+			have_audio = true;
+			first_audio_time = Clock::now();
+		}
+
+		if (initialized)
+			n_frames += nbytes / audio_format.GetFrameSize();
+
+		if (++heap_sample_counter >= HEAP_SAMPLE_INTERVAL) {
+			heap_sample_counter = 0;
+			SampleHeap();
+		}
+
+		if (seek_waiting) {
+			seek_latencies.push_back(Clock::now() - seek_start);
+			seek_waiting = false;
+			StartSeek();
+		} else if (!seek_targets.empty() && next_seek == 0 &&
+			   !seek_pending)
+			/* start seeking after the first chunk */
+			StartSeek();
+
+		return GetCommand();
+	}
+};
+
+/**
+ * Decode the file the way MPD's decoder thread does: prefer the
+ * plugin's file_decode() method, fall back to stream_decode().
+ *
+ * Throws on error.
+ *
+ * @return false if the plugin cannot decode files
+ */
+static bool
+Decode(const DecoderPlugin &plugin, const char *uri,
+       BenchDecoderClient &client)
+{
+	try {
+		if (plugin.SupportsUri(uri))
+			plugin.UriDecode(client, uri);
+		else if (plugin.file_decode != nullptr)
+			plugin.FileDecode(client, FromNarrowPath(uri));
+		else if (plugin.stream_decode != nullptr) {
+			auto is = InputStream::OpenReady(uri, client.mutex);
+			plugin.StreamDecode(client, *is);
+		} else
+			return false;
+	} catch (StopDecoder) {
+	}
+
+	return true;
+}
+
+struct RunResult {
+	AudioFormat audio_format;
+	SignedSongTime duration;
+	bool seekable;
+
+	uint64_t n_frames;
+
+	Clock::duration wall_time, first_audio;
+	double cpu_time;
+
+	std::size_t n_allocations;
+	std::size_t peak_heap;
+};
+
+static bool
+DecodeOnce(const DecoderPlugin &plugin, const char *uri, RunResult &r)
+{
+	const std::size_t allocations_before = n_allocations.load();
+	const double cpu_before = GetCpuTime();
+
+	BenchDecoderClient client(0);
+	if (!Decode(plugin, uri, client) || !client.initialized)
+		return false;
+
+	const auto end_time = Clock::now();
+
+	r.audio_format = client.audio_format;
+	r.duration = client.duration;
+	r.seekable = client.seekable;
+	r.n_frames = client.n_frames;
+	r.wall_time = end_time - client.start_time;
+	r.first_audio = client.have_audio
+		? client.first_audio_time - client.start_time
+		: r.wall_time;
+	r.cpu_time = GetCpuTime() - cpu_before;
+	r.n_allocations = n_allocations.load() - allocations_before;
+	r.peak_heap = client.GetPeakHeap();
+	return true;
+}
+
+static void
+BenchFile(const CommandLine &c, const DecoderPlugin &plugin, const char *uri)
+{
+	RunResult best;
+	bool found = false;
+	std::size_t peak_heap = 0;
+
+	for (unsigned i = 0; i < c.n_repeat; ++i) {
+		RunResult r;
+		if (!DecodeOnce(plugin, uri, r)) {
+			printf("  %-12s unrecognized\n", plugin.name);
+			return;
+		}
+
+		peak_heap = std::max(peak_heap, r.peak_heap);
+		if (!found || r.wall_time < best.wall_time)
+			best = r;
+		found = true;
+	}
+
+	const double seconds = best.audio_format.IsValid()
+		? double(best.n_frames) / best.audio_format.sample_rate
+		: 0;
+	const double wall_s = std::chrono::duration<double>(best.wall_time).count();
+
+	printf("  %-12s %-14s %8.1fs %9.1fx %9.1fx %9.2f",
+	       plugin.name, ToString(best.audio_format).c_str(),
+	       seconds,
+	       wall_s > 0 ? seconds / wall_s : 0.,
+	       best.cpu_time > 0 ? seconds / best.cpu_time : 0.,
+	       ToMilliseconds(best.first_audio));
+
+	if (c.n_seeks > 0 && best.seekable && best.duration.IsPositive()) {
+		BenchDecoderClient client(c.n_seeks);
+		Decode(plugin, uri, client);
+
+		Clock::duration sum{}, max{};
+		for (const auto &i : client.seek_latencies) {
+			sum += i;
+			max = std::max(max, i);
+		}
+
+		if (!client.seek_latencies.empty())
+			printf(" %9.2f %9.2f",
+			       ToMilliseconds(sum / client.seek_latencies.size()),
+			       ToMilliseconds(max));
+		else
+			printf(" %9s %9s", "failed", "");
+
+		if (client.seek_errors > 0)
+			printf(" (%u errors)", client.seek_errors);
+	} else
+		printf(" %9s %9s", "-", "");
+
+	printf(" %10.0f %9zu\n",
+	       wall_s > 0 ? best.n_allocations / wall_s : 0.,
+	       peak_heap / 1024);
+}
+
+static bool
+IsSelected(const CommandLine &c, const DecoderPlugin &plugin) noexcept
+{
+	return c.decoders.empty() ||
+		std::any_of(c.decoders.begin(), c.decoders.end(),
+			    [&plugin](const char *name){
+				    return strcmp(name, plugin.name) == 0;
+			    });
+}
+
+int main(int argc, char **argv)
+try {
+	const auto c = ParseCommandLine(argc, argv);
+
+	SetLogThreshold(c.verbose ? LogLevel::DEBUG : LogLevel::WARNING);
+	const GlobalInit init(c.config_path);
+
+	for (const char *name : c.decoders)
+		if (decoder_plugin_from_name(name) == nullptr)
+			throw FmtRuntimeError("No such decoder: {}", name);
+
+	printf("  %-12s %-14s %9s %10s %10s %9s %9s %9s %10s %9s\n",
+	       "decoder", "format", "duration", "realtime", "cpu",
+	       "first/ms", "seek/ms", "max/ms", "allocs/s", "heap/KiB");
+
+	for (const char *uri : c.files) {
+		printf("%s\n", uri);
+
+		const auto suffix = uri_get_suffix(uri);
+
+		bool found = false;
+		decoder_plugins_for_each_enabled([&](const DecoderPlugin &plugin){
+			if (!IsSelected(c, plugin) ||
+			    (!plugin.SupportsUri(uri) &&
+			     !plugin.SupportsSuffix(suffix)))
+				return;
+
+			found = true;
+
+			try {
+				BenchFile(c, plugin, uri);
+			} catch (...) {
+				printf("  %-12s failed\n", plugin.name);
+				PrintException(std::current_exception());
+			}
+		});
+
+		if (!found)
+			printf("  no decoder\n");
+	}
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		printf("peak RSS: %ld KiB\n", usage.ru_maxrss);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of an encoder plugin.  It
+ * encodes a few minutes of generated audio (a sine wave with some
+ * noise, so lossless encoders have something to chew on) and prints
+ * the realtime factor, i.e. how many seconds of audio are encoded
+ * per second of wall time.
+ *
+ * Additional block settings can be passed as NAME=VALUE, e.g.:
+ *
+ *  bench_encoder flac 48000:24:8 compression=8 threads=4
+ *
+ */
+
+#include "encoder/EncoderList.hxx"
+#include "encoder/EncoderPlugin.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/AudioParser.hxx"
+#include "pcm/Traits.hxx"
+#include "config/Block.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringBuffer.hxx"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of frames passed to Encoder::Write() at a time, i.e.
+ * roughly one MPD chunk.
+ */
+static constexpr std::size_t N_FRAMES = 1024;
+
+/**
+ * The duration of audio to be encoded.
+ */
+static constexpr unsigned SECONDS = 120;
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+Generate(std::vector<std::byte> &dest, unsigned channels)
+{
+	std::mt19937 gen;
+	std::normal_distribution<double> noise(0, 0.01);
+
+	const std::size_t n = dest.size() / sizeof(typename Traits::value_type);
+	auto *p = reinterpret_cast<typename Traits::value_type *>(dest.data());
+
+	for (std::size_t i = 0; i < n; ++i) {
+		const unsigned frame = i / channels, channel = i % channels;
+		const double x = 0.5 * std::sin(frame * (0.03 + channel * 0.002))
+			+ noise(gen);
+
+		if constexpr (F == SampleFormat::FLOAT)
+			p[i] = float(x);
+		else
+			p[i] = typename Traits::value_type(x * Traits::MAX);
+	}
+}
+
+static std::vector<std::byte>
+Generate(AudioFormat audio_format)
+{
+	std::vector<std::byte> buffer(audio_format.GetFrameSize() * N_FRAMES);
+
+	switch (audio_format.format) {
+	case SampleFormat::S8:
+		Generate<SampleFormat::S8>(buffer, audio_format.channels);
+		break;
+
+	case SampleFormat::S16:
+		Generate<SampleFormat::S16>(buffer, audio_format.channels);
+		break;
+
+	case SampleFormat::S24_P32:
+		Generate<SampleFormat::S24_P32>(buffer, audio_format.channels);
+		break;
+
+	case SampleFormat::S32:
+		Generate<SampleFormat::S32>(buffer, audio_format.channels);
+		break;
+
+	case SampleFormat::FLOAT:
+		Generate<SampleFormat::FLOAT>(buffer, audio_format.channels);
+		break;
+
+	default:
+		throw std::runtime_error("Unsupported sample format");
+	}
+
+	return buffer;
+}
+
+/**
+ * Read and discard all pending output of the encoder.
+ *
+ * @return the number of bytes
+ */
+static std::size_t
+Drain(Encoder &encoder)
+{
+	std::byte buffer[32768];
+	std::size_t total = 0;
+
+	while (true) {
+		const auto r = encoder.Read(buffer);
+		if (r.empty())
+			return total;
+
+		total += r.size();
+	}
+}
+
+int main(int argc, char **argv)
+try {
+	if (argc < 2) {
+		fprintf(stderr,
+			"Usage: bench_encoder ENCODER [FORMAT [NAME=VALUE...]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *const encoder_name = argv[1];
+
+	const auto plugin = encoder_plugin_get(encoder_name);
+	if (plugin == nullptr) {
+		fprintf(stderr, "No such encoder: %s\n", encoder_name);
+		return EXIT_FAILURE;
+	}
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	if (argc > 2)
+		audio_format = ParseAudioFormat(argv[2], false);
+
+	ConfigBlock block;
+	std::string settings;
+
+	for (int i = 3; i < argc; ++i) {
+		const char *eq = strchr(argv[i], '=');
+		if (eq == nullptr) {
+			fprintf(stderr, "NAME=VALUE expected: %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+
+		block.AddBlockParam(std::string(argv[i], eq - argv[i]), eq + 1);
+
+		if (!settings.empty())
+			settings.push_back(' ');
+		settings.append(argv[i]);
+	}
+
+	/* some encoders refuse to work without a quality or
+	   bitrate setting */
+	if (block.GetBlockParam("quality") == nullptr &&
+	    block.GetBlockParam("bitrate") == nullptr &&
+	    (strcmp(encoder_name, "vorbis") == 0 ||
+	     strcmp(encoder_name, "lame") == 0 ||
+	     strcmp(encoder_name, "twolame") == 0))
+		block.AddBlockParam("quality", "5.0");
+
+	std::unique_ptr<PreparedEncoder> p_encoder(encoder_init(*plugin, block));
+
+	/* the encoder may change the audio format */
+	std::unique_ptr<Encoder> encoder(p_encoder->Open(audio_format));
+
+	const auto input = Generate(audio_format);
+	const std::size_t n_chunks =
+		std::size_t(SECONDS) * audio_format.sample_rate / N_FRAMES;
+
+	std::size_t output_size = Drain(*encoder);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (std::size_t i = 0; i < n_chunks; ++i) {
+		encoder->Write(input);
+		output_size += Drain(*encoder);
+	}
+
+	encoder->End();
+	output_size += Drain(*encoder);
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	const double audio_seconds = double(n_chunks * N_FRAMES)
+		/ audio_format.sample_rate;
+
+	const auto format_string = ToString(audio_format);
+	printf("%-8s %-16s %-24s %8.1fx realtime %8.1f kbit/s\n",
+	       encoder_name, format_string.c_str(), settings.c_str(),
+	       audio_seconds / duration.count(),
+	       output_size * 8 / audio_seconds / 1000);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
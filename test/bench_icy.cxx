@@ -0,0 +1,221 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of ICY metadata removal: the
+ * IcyInputStream (which reads audio data directly into the caller's
+ * buffer) versus parsing each buffer with
+ * IcyMetaDataParser::ParseInPlace().  Throughput is given in audio
+ * bytes (i.e. excluding metadata).
+ *
+ */
+
+#include "input/IcyInputStream.hxx"
+#include "input/InputStream.hxx"
+#include "tag/IcyMetaDataParser.hxx"
+#include "thread/Mutex.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The "icy-metaint" value, i.e. the number of audio bytes between two
+ * metadata blocks; this is what SHOUTcast servers usually announce.
+ */
+static constexpr std::size_t METAINT = 16000;
+
+static constexpr std::size_t N_BLOCKS = 256;
+
+/**
+ * The size of each Read() call, like a decoder plugin would do.
+ */
+static constexpr std::size_t READ_SIZE = 4096;
+
+/**
+ * Results are written here to prevent the compiler from optimizing
+ * the loops away.
+ */
+static volatile std::byte sink;
+
+/**
+ * Generate a stream with #N_BLOCKS audio blocks.  Most metadata
+ * blocks are empty; every 16th contains a title, like a radio
+ * station would send on a song change.
+ */
+static std::vector<std::byte>
+GenerateStream() noexcept
+{
+	static constexpr std::string_view title =
+		"StreamTitle='Artist - Title';StreamUrl='';";
+
+	std::vector<std::byte> stream;
+
+	for (std::size_t i = 0; i < N_BLOCKS; ++i) {
+		for (std::size_t j = 0; j < METAINT; ++j)
+			stream.push_back(std::byte(i + j));
+
+		if (i % 16 == 0) {
+			const std::size_t n = (title.size() + 15) / 16;
+			stream.push_back(std::byte(n));
+
+			const auto *p = (const std::byte *)title.data();
+			stream.insert(stream.end(), p, p + title.size());
+			stream.resize(stream.size() + n * 16 - title.size());
+		} else
+			stream.push_back(std::byte{0});
+	}
+
+	return stream;
+}
+
+class MemoryInputStream final : public InputStream {
+	std::span<const std::byte> data;
+
+public:
+	MemoryInputStream(Mutex &_mutex,
+			  std::span<const std::byte> _data) noexcept
+		:InputStream("memory://", _mutex), data(_data) {
+		SetReady();
+	}
+
+	/* virtual methods from InputStream */
+	bool IsEOF() const noexcept override {
+		return data.empty();
+	}
+
+	size_t Read(std::unique_lock<Mutex> &,
+		    void *ptr, size_t read_size) override {
+		const size_t nbytes = std::min(data.size(), read_size);
+		memcpy(ptr, data.data(), nbytes);
+		data = data.subspan(nbytes);
+		offset += nbytes;
+		return nbytes;
+	}
+};
+
+/**
+ * The old approach: read everything into the destination buffer and
+ * let ParseInPlace() remove the metadata.
+ */
+static std::size_t
+ReadParseInPlace(std::span<const std::byte> stream)
+{
+	Mutex mutex;
+	MemoryInputStream input(mutex, stream);
+	IcyMetaDataParser parser;
+	parser.Start(METAINT);
+
+	std::unique_lock<Mutex> lock(mutex);
+	std::byte buffer[READ_SIZE];
+	std::size_t total = 0;
+
+	while (!input.IsEOF()) {
+		std::size_t nbytes = input.Read(lock, buffer, sizeof(buffer));
+		nbytes = parser.ParseInPlace(buffer, nbytes);
+		if (nbytes > 0)
+			sink = buffer[nbytes - 1];
+		total += nbytes;
+	}
+
+	return total;
+}
+
+static std::size_t
+ReadIcyInputStream(std::span<const std::byte> stream)
+{
+	Mutex mutex;
+	auto parser = std::make_shared<IcyMetaDataParser>();
+	parser->Start(METAINT);
+
+	IcyInputStream input(std::make_unique<MemoryInputStream>(mutex,
+								 stream),
+			     parser);
+
+	std::unique_lock<Mutex> lock(mutex);
+	std::byte buffer[READ_SIZE];
+	std::size_t total = 0;
+
+	while (true) {
+		const std::size_t nbytes =
+			input.Read(lock, buffer, sizeof(buffer));
+		if (nbytes == 0)
+			break;
+
+		sink = buffer[nbytes - 1];
+		total += nbytes;
+	}
+
+	return total;
+}
+
+static void
+Measure(const char *name, unsigned iterations,
+	std::size_t (*f)(std::span<const std::byte> stream),
+	std::span<const std::byte> stream)
+{
+	/* warm up caches */
+	if (f(stream) != METAINT * N_BLOCKS)
+		throw std::runtime_error("Wrong number of audio bytes");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iterations; ++i)
+		f(stream);
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	const double bytes = double(METAINT * N_BLOCKS) * iterations;
+
+	printf("%-32s %10.2f MB/s\n", name,
+	       bytes / duration.count() / (1024 * 1024));
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 2) {
+		fprintf(stderr, "Usage: bench_icy [ITERATIONS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned iterations = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 1000;
+
+	const auto stream = GenerateStream();
+
+	Measure("ParseInPlace", iterations, ReadParseInPlace, stream);
+	Measure("IcyInputStream", iterations, ReadIcyInputStream, stream);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the cost of mapping song URIs to file system
+ * paths, i.e. what map_uri_fs(), Storage::MapFS() and LocateUri()
+ * do for "add", "lsinfo", "albumart" and when opening a song for
+ * decoding.  For each method, the time and the number of heap
+ * allocations per call are printed.
+ *
+ * Usage: bench_mapper [MUSIC_DIRECTORY [FILESYSTEM_CHARSET]]
+ */
+
+#include "config.h"
+#include "storage/StorageInterface.hxx"
+#include "storage/plugins/LocalStorage.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Charset.hxx"
+#include "fs/Path.hxx"
+#include "util/PrintException.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <string_view>
+
+#include <stdio.h>
+
+static std::size_t n_allocations;
+
+void *
+operator new(std::size_t size)
+{
+	++n_allocations;
+
+	void *p = malloc(size);
+	if (p == nullptr)
+		throw std::bad_alloc{};
+	return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+	free(p);
+}
+
+static constexpr std::array uris{
+	"Artist/Album/01 - Track.flac",
+	"Various Artists/Some Compilation (Disc 2)/13 - Another Track.mp3",
+	"Ünïcödé/Älbüm/01 - Ñame.ogg",
+	"short.wav",
+};
+
+static constexpr unsigned N_ROUNDS = 200000;
+
+/**
+ * Results are written here to prevent the compiler from optimizing
+ * the calls away.
+ */
+static volatile std::size_t sink;
+
+template<typename F>
+static void
+Run(const char *name, F &&f)
+{
+	const std::size_t allocations_before = n_allocations;
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < N_ROUNDS; ++i)
+		for (const char *uri : uris)
+			sink = sink + f(uri).c_str()[0];
+
+	const std::chrono::duration<double, std::nano> duration =
+		std::chrono::steady_clock::now() - start;
+	const double n = double(N_ROUNDS) * uris.size();
+
+	printf("%-24s %8.1f ns/call %6.2f allocations/call\n",
+	       name, duration.count() / n,
+	       double(n_allocations - allocations_before) / n);
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 3) {
+		fprintf(stderr,
+			"Usage: bench_mapper [MUSIC_DIRECTORY [FILESYSTEM_CHARSET]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const auto music_directory = AllocatedPath::FromFS(argc > 1
+							    ? argv[1]
+							    : "/var/lib/mpd/music");
+
+#ifdef HAVE_FS_CHARSET
+	if (argc > 2)
+		SetFSCharset(argv[2]);
+#endif
+
+	const auto storage = CreateLocalStorage(music_directory);
+
+	/* the old way: convert, then concatenate */
+	Run("FromUTF8+Build", [&](const char *uri){
+		return AllocatedPath::Build(music_directory,
+					    AllocatedPath::FromUTF8Throw(uri));
+	});
+
+	Run("BuildUTF8Throw", [&](const char *uri){
+		return AllocatedPath::BuildUTF8Throw(music_directory, uri);
+	});
+
+	Run("LocalStorage::MapFS", [&](const char *uri){
+		return storage->MapFS(uri);
+	});
+
+	DeinitFSCharset();
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,504 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of MPD's PCM kernels (sample
+ * format conversion, software volume, mixing, export, DSD bit reversal
+ * and interleaving, DSD to PCM conversion), e.g. to compare the vectorized kernels with the
+ * portable code or to spot regressions.
+ *
+ * All kernels process stereo data; throughput is given in input
+ * frames.  On x86, the number of (TSC) cycles per frame is printed,
+ * too.
+ *
+ */
+
+#include "config.h"
+#include "pcm/PcmFormat.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/Mix.hxx"
+#include "pcm/Export.hxx"
+#include "pcm/Buffer.hxx"
+#include "pcm/Dither.hxx"
+#include "pcm/SampleFormat.hxx"
+#include "pcm/Interleave.hxx"
+#include "util/PrintException.hxx"
+
+#ifdef ENABLE_DSD
+#include "pcm/Dsd2Pcm.hxx"
+#include "pcm/Dsd2PcmFir.hxx"
+#include "util/BitReverse.hxx"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+static constexpr unsigned CHANNELS = 2;
+
+/**
+ * The number of frames per call, i.e. roughly one MPD chunk.
+ */
+static constexpr std::size_t N_FRAMES = 1024;
+
+static constexpr std::size_t N_SAMPLES = N_FRAMES * CHANNELS;
+
+/**
+ * Results are written here to prevent the compiler from optimizing
+ * the kernels away.
+ */
+static volatile std::byte sink;
+
+static void
+Consume(std::span<const std::byte> result) noexcept
+{
+	if (!result.empty())
+		sink = result.back();
+}
+
+template<typename T>
+static void
+Consume(std::span<const T> result) noexcept
+{
+	Consume(std::as_bytes(result));
+}
+
+/**
+ * Random input data for all sample formats.
+ */
+struct Input {
+	std::vector<int8_t> s8;
+	std::vector<int16_t> s16;
+	std::vector<int32_t> s24, s32;
+	std::vector<float> f;
+	std::vector<uint8_t> dsd;
+
+	Input() noexcept
+		:s8(N_SAMPLES), s16(N_SAMPLES), s24(N_SAMPLES),
+		 s32(N_SAMPLES), f(N_SAMPLES), dsd(N_SAMPLES)
+	{
+		std::mt19937 gen;
+		std::uniform_real_distribution<float> dis(-1.0, 1.0);
+
+		for (std::size_t i = 0; i < N_SAMPLES; ++i) {
+			const float x = dis(gen);
+			f[i] = x;
+			s8[i] = int8_t(x * 127);
+			s16[i] = int16_t(x * 32767);
+			s24[i] = int32_t(x * 0x7fffff);
+			s32[i] = int32_t(double(x) * 0x7fffffff);
+			dsd[i] = uint8_t(gen());
+		}
+	}
+
+	/**
+	 * Returns the input buffer for the given sample format.
+	 */
+	std::span<const std::byte> Get(SampleFormat format) const noexcept {
+		switch (format) {
+		case SampleFormat::UNDEFINED:
+			break;
+
+		case SampleFormat::S8:
+			return std::as_bytes(std::span{s8});
+
+		case SampleFormat::S16:
+			return std::as_bytes(std::span{s16});
+
+		case SampleFormat::S24_P32:
+			return std::as_bytes(std::span{s24});
+
+		case SampleFormat::S32:
+			return std::as_bytes(std::span{s32});
+
+		case SampleFormat::FLOAT:
+			return std::as_bytes(std::span{f});
+
+		case SampleFormat::DSD:
+			return std::as_bytes(std::span{dsd});
+		}
+
+		return {};
+	}
+};
+
+class Bench {
+	const unsigned iterations;
+
+	/**
+	 * If not empty, then only benchmarks whose name contains this
+	 * string are run.
+	 */
+	const std::string_view filter;
+
+public:
+	Bench(unsigned _iterations, std::string_view _filter) noexcept
+		:iterations(_iterations), filter(_filter) {}
+
+	template<typename F>
+	void Measure(std::string_view name, F &&f) const {
+		if (!filter.empty() && name.find(filter) == name.npos)
+			return;
+
+		/* warm up caches and lazily allocated buffers */
+		f();
+
+		const auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_RDTSC
+		const auto start_cycles = __rdtsc();
+#endif
+
+		for (unsigned i = 0; i < iterations; ++i)
+			f();
+
+#ifdef HAVE_RDTSC
+		const auto cycles = __rdtsc() - start_cycles;
+#endif
+		const std::chrono::duration<double> duration =
+			std::chrono::steady_clock::now() - start;
+		const double frames = double(N_FRAMES) * iterations;
+
+		printf("%-32.*s %10.2f Mframes/s",
+		       int(name.size()), name.data(),
+		       frames / duration.count() / 1e6);
+#ifdef HAVE_RDTSC
+		printf(" %8.2f cycles/frame", double(cycles) / frames);
+#endif
+		printf("\n");
+	}
+};
+
+static const char *
+Name(const char *prefix, SampleFormat format,
+     const char *suffix="") noexcept
+{
+	static char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%s%s%s",
+		 prefix, sample_format_to_string(format), suffix);
+	return buffer;
+}
+
+static constexpr SampleFormat pcm_formats[] = {
+	SampleFormat::S8,
+	SampleFormat::S16,
+	SampleFormat::S24_P32,
+	SampleFormat::S32,
+	SampleFormat::FLOAT,
+};
+
+static void
+BenchFormat(const Bench &bench, const Input &input)
+{
+	PcmBuffer buffer;
+	PcmDither dither;
+
+	for (const auto src_format : pcm_formats) {
+		const auto src = input.Get(src_format);
+
+		if (src_format != SampleFormat::S16)
+			bench.Measure(Name("format ", src_format, "->16"), [&]{
+				Consume(pcm_convert_to_16(buffer, dither,
+							  src_format, src));
+			});
+
+		if (src_format != SampleFormat::S24_P32)
+			bench.Measure(Name("format ", src_format, "->24"), [&]{
+				Consume(pcm_convert_to_24(buffer,
+							  src_format, src));
+			});
+
+		if (src_format != SampleFormat::S32)
+			bench.Measure(Name("format ", src_format, "->32"), [&]{
+				Consume(pcm_convert_to_32(buffer,
+							  src_format, src));
+			});
+
+		if (src_format != SampleFormat::FLOAT)
+			bench.Measure(Name("format ", src_format, "->f"), [&]{
+				Consume(pcm_convert_to_float(buffer,
+							     src_format, src));
+			});
+	}
+}
+
+static void
+BenchVolume(const Bench &bench, const Input &input)
+{
+	for (const auto format : pcm_formats) {
+		PcmVolume pv;
+		pv.Open(format, false);
+		pv.SetVolume(PCM_VOLUME_1 / 2);
+
+		const auto src = input.Get(format);
+
+		bench.Measure(Name("volume ", format), [&]{
+			Consume(pv.Apply(src));
+		});
+
+		std::vector<std::byte> data(src.begin(), src.end());
+		bench.Measure(Name("volume ", format, " in-place"), [&]{
+			pv.ApplyInPlace(data);
+			Consume(std::span<const std::byte>{data});
+		});
+
+		pv.Close();
+	}
+}
+
+static void
+BenchMix(const Bench &bench, const Input &input)
+{
+	PcmDither dither;
+
+	for (const auto format : pcm_formats) {
+		const auto src = input.Get(format);
+		std::vector<std::byte> dest(src.begin(), src.end());
+
+		bench.Measure(Name("mix ", format), [&]{
+			if (!pcm_mix(dither, dest.data(), src.data(), src.size(),
+				     format, 0.3f))
+				abort();
+			Consume(std::span<const std::byte>{dest});
+		});
+
+		bench.Measure(Name("mix ", format, " add"), [&]{
+			if (!pcm_mix(dither, dest.data(), src.data(), src.size(),
+				     format, 1.0f))
+				abort();
+			Consume(std::span<const std::byte>{dest});
+		});
+	}
+}
+
+static void
+BenchExport(const Bench &bench, const char *name,
+	    std::span<const std::byte> src,
+	    SampleFormat format, PcmExport::Params params)
+{
+	PcmExport e;
+	e.Open(format, CHANNELS, params);
+
+	bench.Measure(name, [&]{
+		Consume(e.Export(src));
+	});
+}
+
+static void
+BenchExport(const Bench &bench, const Input &input)
+{
+	PcmExport::Params params;
+	params.pack24 = true;
+	BenchExport(bench, "export pack24",
+		    input.Get(SampleFormat::S24_P32),
+		    SampleFormat::S24_P32, params);
+
+	params = {};
+	params.shift8 = true;
+	BenchExport(bench, "export shift8",
+		    input.Get(SampleFormat::S24_P32),
+		    SampleFormat::S24_P32, params);
+
+	params = {};
+	params.reverse_endian = true;
+	BenchExport(bench, "export reverse_endian S16",
+		    input.Get(SampleFormat::S16),
+		    SampleFormat::S16, params);
+	BenchExport(bench, "export reverse_endian S32",
+		    input.Get(SampleFormat::S32),
+		    SampleFormat::S32, params);
+
+	params = {};
+	params.pack24 = true;
+	params.reverse_endian = true;
+	BenchExport(bench, "export pack24 reverse_endian",
+		    input.Get(SampleFormat::S24_P32),
+		    SampleFormat::S24_P32, params);
+
+#ifdef ENABLE_DSD
+	params = {};
+	params.dsd_mode = PcmExport::DsdMode::DOP;
+	BenchExport(bench, "export DoP",
+		    input.Get(SampleFormat::DSD),
+		    SampleFormat::DSD, params);
+
+	params.dsd_mode = PcmExport::DsdMode::U16;
+	BenchExport(bench, "export DSD_U16",
+		    input.Get(SampleFormat::DSD),
+		    SampleFormat::DSD, params);
+
+	params.dsd_mode = PcmExport::DsdMode::U32;
+	BenchExport(bench, "export DSD_U32",
+		    input.Get(SampleFormat::DSD),
+		    SampleFormat::DSD, params);
+#endif
+}
+
+/**
+ * Interleave planar 32 bit samples, as done by the FLAC decoder
+ * plugin.
+ */
+static void
+BenchInterleave(const Bench &bench, const Input &input)
+{
+	std::vector<int32_t> dest32(N_SAMPLES);
+	std::vector<int16_t> dest16(N_SAMPLES);
+
+	for (const unsigned channels : {2u, 6u, 8u}) {
+		const std::size_t n_frames = N_SAMPLES / channels;
+
+		const int32_t *planes[8];
+		for (unsigned c = 0; c < channels; ++c)
+			planes[c] = input.s32.data() + c * n_frames;
+
+		const std::span<const int32_t *const> src{planes, channels};
+
+		char name[64];
+		snprintf(name, sizeof(name), "interleave S32 %uch", channels);
+		bench.Measure(name, [&]{
+			PcmInterleave32(dest32.data(), src, n_frames);
+			Consume(std::span<const int32_t>{dest32});
+		});
+
+		snprintf(name, sizeof(name), "interleave S32->S16 %uch",
+			 channels);
+		bench.Measure(name, [&]{
+			PcmInterleave32To16(dest16.data(), src, n_frames);
+			Consume(std::span<const int16_t>{dest16});
+		});
+	}
+}
+
+#ifdef ENABLE_DSD
+
+/**
+ * The DSD kernels of the DSF and DSDIFF decoder plugins.
+ */
+static void
+BenchDsd(const Bench &bench, const Input &input)
+{
+	std::vector<uint8_t> buffer(input.dsd);
+	bench.Measure("dsd bit_reverse", [&]{
+		BitReverse(buffer.data(), buffer.size());
+		Consume(std::span<const uint8_t>{buffer});
+	});
+
+	/* planar input, as in DSF files */
+	const void *const planes[] = {
+		input.dsd.data(),
+		input.dsd.data() + N_FRAMES,
+	};
+
+	std::vector<uint8_t> dest(N_SAMPLES);
+	bench.Measure("dsd interleave", [&]{
+		PcmInterleave(dest.data(), planes, N_FRAMES, 1);
+		Consume(std::span<const uint8_t>{dest});
+	});
+}
+
+static void
+BenchDsd2PcmFir(const Bench &bench, std::span<const uint8_t> src,
+		unsigned decimation, Dsd2PcmQuality quality,
+		const char *quality_name)
+{
+	Dsd2PcmFir fir;
+	fir.Open(CHANNELS, 352800, decimation, quality);
+
+	char name[64];
+	snprintf(name, sizeof(name), "dsd2pcm fir/%u %s FLOAT",
+		 decimation, quality_name);
+	bench.Measure(name, [&]{
+		Consume(fir.ToFloat(src));
+	});
+
+	snprintf(name, sizeof(name), "dsd2pcm fir/%u %s S24_P32",
+		 decimation, quality_name);
+	bench.Measure(name, [&]{
+		Consume(fir.ToS24(src));
+	});
+}
+
+static void
+BenchDsd2Pcm(const Bench &bench, const Input &input)
+{
+	const std::span<const uint8_t> src{input.dsd};
+
+	MultiDsd2Pcm dsd2pcm;
+
+	std::vector<float> dest_float(N_SAMPLES);
+	bench.Measure("dsd2pcm FLOAT", [&]{
+		dsd2pcm.Translate(CHANNELS, N_FRAMES, src.data(),
+				  dest_float.data());
+		Consume(std::span<const float>{dest_float});
+	});
+
+	std::vector<int32_t> dest_s24(N_SAMPLES);
+	bench.Measure("dsd2pcm S24_P32", [&]{
+		dsd2pcm.TranslateS24(CHANNELS, N_FRAMES, src.data(),
+				     dest_s24.data());
+		Consume(std::span<const int32_t>{dest_s24});
+	});
+
+	BenchDsd2PcmFir(bench, src, 8, Dsd2PcmQuality::HIGH, "high");
+	BenchDsd2PcmFir(bench, src, 8, Dsd2PcmQuality::LOW, "low");
+	BenchDsd2PcmFir(bench, src, 32, Dsd2PcmQuality::HIGH, "high");
+}
+
+#endif
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_pcm [ITERATIONS [FILTER]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned iterations = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 10000;
+
+	const Bench bench(iterations, argc > 2 ? argv[2] : "");
+	const Input input;
+
+	BenchFormat(bench, input);
+	BenchVolume(bench, input);
+	BenchMix(bench, input);
+	BenchExport(bench, input);
+	BenchInterleave(bench, input);
+#ifdef ENABLE_DSD
+	BenchDsd(bench, input);
+	BenchDsd2Pcm(bench, input);
+#endif
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
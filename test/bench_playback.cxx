@@ -0,0 +1,531 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the cost of MPD's whole playback pipeline:
+ * decoder thread, #MusicPipe, player thread (including cross-fading
+ * and ReplayGain), the shared output pipe, the filter chains and the
+ * output threads.  It plays a corpus of files as one gapless queue
+ * through a number of "null" outputs which do not synchronize with
+ * the clock, i.e. faster than real time, and reports the CPU time
+ * and context switches per second of audio and the heap allocations
+ * per chunk.
+ *
+ * Additional outputs (and other settings) may be configured in a MPD
+ * configuration file.
+ */
+
+#include "ConfigGlue.hxx"
+#include "Chrono.hxx"
+#include "MusicChunk.hxx"
+#include "ReplayGainMode.hxx"
+#include "config/Block.hxx"
+#include "config/PlayerConfig.hxx"
+#include "config/ReplayGainConfig.hxx"
+#include "event/Thread.hxx"
+#include "decoder/DecoderList.hxx"
+#include "input/Init.hxx"
+#include "mixer/Listener.hxx"
+#include "output/MultipleOutputs.hxx"
+#include "player/Control.hxx"
+#include "player/Listener.hxx"
+#include "player/Outputs.hxx"
+#include "song/DetachedSong.hxx"
+#include "fs/Path.hxx"
+#include "fs/NarrowPath.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "cmdline/OptionDef.hxx"
+#include "cmdline/OptionParser.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Mutex.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/PrintException.hxx"
+#include "Log.hxx"
+#include "LogBackend.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The number of C++ heap allocations; counted by the replacement
+ * operator new below.
+ */
+static std::atomic_size_t n_allocations;
+
+void *
+operator new(std::size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+	free(p);
+}
+
+static double
+GetCpuTime() noexcept
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) < 0)
+		return 0;
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the number of context switches (voluntary and involuntary)
+ * of all threads of this process so far.
+ */
+static long
+GetContextSwitches() noexcept
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0;
+
+	return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+struct CommandLine {
+	std::vector<const char *> files;
+
+	FromNarrowPath config_path;
+
+	/**
+	 * The value of the "filters" setting of each "null" output.
+	 */
+	const char *filters = nullptr;
+
+	unsigned n_outputs = 1;
+
+	FloatDuration crossfade = FloatDuration::zero();
+
+	ReplayGainMode replay_gain_mode = ReplayGainMode::OFF;
+
+	bool verbose = false;
+};
+
+enum Option {
+	OPTION_CONFIG,
+	OPTION_VERBOSE,
+	OPTION_OUTPUTS,
+	OPTION_FILTERS,
+	OPTION_CROSSFADE,
+	OPTION_REPLAY_GAIN,
+};
+
+static constexpr OptionDef option_defs[] = {
+	{"config", 0, true, "Load a MPD configuration file"},
+	{"verbose", 'v', false, "Verbose logging"},
+	{"outputs", 'n', true, "Number of \"null\" outputs (default 1)"},
+	{"filters", 'f', true, "Filter chain of each \"null\" output"},
+	{"crossfade", 'x', true, "Cross-fade duration in seconds"},
+	{"replay-gain", 'r', true, "ReplayGain mode (off, track, album, auto)"},
+};
+
+static unsigned
+ParseUnsigned(const char *s)
+{
+	char *endptr;
+	const unsigned long value = strtoul(s, &endptr, 10);
+	if (endptr == s || *endptr != 0)
+		throw std::runtime_error("Not a number");
+
+	return value;
+}
+
+static CommandLine
+ParseCommandLine(int argc, char **argv)
+{
+	CommandLine c;
+
+	OptionParser option_parser(option_defs, argc, argv);
+	while (auto o = option_parser.Next()) {
+		switch (Option(o.index)) {
+		case OPTION_CONFIG:
+			c.config_path = o.value;
+			break;
+
+		case OPTION_VERBOSE:
+			c.verbose = true;
+			break;
+
+		case OPTION_OUTPUTS:
+			c.n_outputs = ParseUnsigned(o.value);
+			break;
+
+		case OPTION_FILTERS:
+			c.filters = o.value;
+			break;
+
+		case OPTION_CROSSFADE:
+			c.crossfade = std::chrono::seconds(ParseUnsigned(o.value));
+			break;
+
+		case OPTION_REPLAY_GAIN:
+			c.replay_gain_mode = FromString(o.value);
+			break;
+		}
+	}
+
+	auto args = option_parser.GetRemaining();
+	if (args.empty())
+		throw std::runtime_error("Usage: bench_playback [--verbose] [--config=FILE] [--outputs=N] [--filters=CHAIN] [--crossfade=SECONDS] [--replay-gain=MODE] FILE...");
+
+	c.files.assign(args.begin(), args.end());
+	return c;
+}
+
+/**
+ * Load the configuration file and add the "null" outputs.
+ */
+static ConfigData
+LoadConfig(const CommandLine &c)
+{
+	auto config = AutoLoadConfigFile(c.config_path);
+
+	for (unsigned i = 0; i < c.n_outputs; ++i) {
+		/* a non-negative line number, or else it would be
+		   considered a "null" (i.e. unconfigured) block */
+		ConfigBlock block{0};
+		block.AddBlockParam("type", "null");
+		block.AddBlockParam("name", "bench" + std::to_string(i));
+		block.AddBlockParam("sync", "no");
+		if (c.filters != nullptr)
+			block.AddBlockParam("filters", c.filters);
+
+		config.AddBlock(ConfigBlockOption::AUDIO_OUTPUT,
+				std::move(block));
+	}
+
+	if (config.GetBlock(ConfigBlockOption::AUDIO_OUTPUT) == nullptr)
+		throw std::runtime_error("No outputs");
+
+	return config;
+}
+
+class GlobalInit {
+	EventThread io_thread;
+	EventThread rtio_thread{true};
+	const ScopeInputPluginsInit input_plugins_init;
+	const ScopeDecoderPluginsInit decoder_plugins_init;
+
+public:
+	explicit GlobalInit(const ConfigData &config)
+		:input_plugins_init(config, io_thread.GetEventLoop()),
+		 decoder_plugins_init(config)
+	{
+		io_thread.Start();
+		rtio_thread.Start();
+	}
+
+	EventLoop &GetEventLoop() noexcept {
+		return io_thread.GetEventLoop();
+	}
+
+	EventLoop &GetRtEventLoop() noexcept {
+		return rtio_thread.GetEventLoop();
+	}
+};
+
+/**
+ * A #PlayerOutputs implementation which forwards all calls to
+ * #MultipleOutputs and counts the chunks passing through it.  Its
+ * counters are only accessed by the player thread while playing.
+ */
+class CountingOutputs final : public PlayerOutputs {
+	PlayerOutputs &next;
+
+	AudioFormat audio_format = AudioFormat::Undefined();
+
+public:
+	std::size_t n_chunks = 0;
+
+	/**
+	 * The duration of all chunks.
+	 */
+	FloatDuration duration = FloatDuration::zero();
+
+	explicit CountingOutputs(PlayerOutputs &_next) noexcept
+		:next(_next) {}
+
+	/* virtual methods from class PlayerOutputs */
+	void EnableDisable() override {
+		next.EnableDisable();
+	}
+
+	void Open(const AudioFormat _audio_format) override {
+		next.Open(_audio_format);
+		audio_format = _audio_format;
+	}
+
+	void Close() noexcept override {
+		next.Close();
+	}
+
+	void Release() noexcept override {
+		next.Release();
+	}
+
+	void Play(MusicChunkPtr chunk) override {
+		++n_chunks;
+		if (audio_format.IsValid())
+			duration += audio_format.SizeToTime<FloatDuration>(chunk->length);
+
+		next.Play(std::move(chunk));
+	}
+
+	unsigned CheckPipe() noexcept override {
+		return next.CheckPipe();
+	}
+
+	void Pause() noexcept override {
+		next.Pause();
+	}
+
+	void Drain() noexcept override {
+		next.Drain();
+	}
+
+	void Cancel() noexcept override {
+		next.Cancel();
+	}
+
+	void SetSeekHistory(SongTime _duration) noexcept override {
+		next.SetSeekHistory(_duration);
+	}
+
+	void SetWakeupThreshold(std::chrono::steady_clock::duration threshold) noexcept override {
+		next.SetWakeupThreshold(threshold);
+	}
+
+	void WakeUp() noexcept override {
+		next.WakeUp();
+	}
+
+	std::deque<MusicChunkPtr> CancelForSeek() noexcept override {
+		return next.CancelForSeek();
+	}
+
+	void SongBorder() noexcept override {
+		next.SongBorder();
+	}
+
+	SignedSongTime GetElapsedTime() const noexcept override {
+		return next.GetElapsedTime();
+	}
+};
+
+/**
+ * Plays a list of files, similar to what #Partition and #playlist do
+ * (but without a #Queue): the first file is started with
+ * PlayerControl::Play(), and each following one is enqueued as soon
+ * as the player has started the previous one.
+ */
+class BenchPlayer final : PlayerListener, MixerListener {
+	Mutex mutex;
+	Cond cond;
+
+	/**
+	 * Set by the #PlayerListener methods; protected by #mutex.
+	 */
+	bool wakeup = false;
+
+	MultipleOutputs outputs;
+
+public:
+	CountingOutputs counting_outputs{outputs};
+
+	PlayerControl pc;
+
+	BenchPlayer(const ConfigData &config, GlobalInit &init,
+		    const PlayerConfig &player_config)
+		:outputs(pc, *this),
+		 pc(*this, counting_outputs, nullptr, player_config)
+	{
+		outputs.Configure(init.GetEventLoop(), init.GetRtEventLoop(),
+				  config, player_config.replay_gain);
+	}
+
+	~BenchPlayer() noexcept {
+		pc.Kill();
+	}
+
+	void SetReplayGainMode(ReplayGainMode mode) noexcept {
+		if (mode == ReplayGainMode::AUTO)
+			mode = ReplayGainMode::ALBUM;
+
+		pc.LockSetReplayGainMode(mode);
+		outputs.SetReplayGainMode(pc.IsReplayGainInDecoder()
+					  ? ReplayGainMode::OFF
+					  : mode);
+	}
+
+	/**
+	 * Play all files and return after the last one has finished.
+	 */
+	void Run(const std::vector<const char *> &files);
+
+private:
+	void Wake() noexcept {
+		const std::scoped_lock<Mutex> lock(mutex);
+		wakeup = true;
+		cond.notify_one();
+	}
+
+	/* virtual methods from class PlayerListener */
+	void OnPlayerError() noexcept override {
+		Wake();
+	}
+
+	void OnPlayerStateChanged() noexcept override {
+		Wake();
+	}
+
+	void OnPlayerOptionsChanged() noexcept override {}
+
+	void OnPlayerSync() noexcept override {
+		Wake();
+	}
+
+	void OnPlayerTagModified() noexcept override {}
+	void OnBorderPause() noexcept override {}
+
+	/* virtual methods from class MixerListener */
+	void OnMixerVolumeChanged(Mixer &, int) noexcept override {}
+	void OnMixerChanged() noexcept override {}
+};
+
+static std::unique_ptr<DetachedSong>
+MakeSong(const char *path)
+{
+	/* the decoder thread accepts only absolute local paths */
+	char buffer[PATH_MAX];
+	if (realpath(path, buffer) == nullptr)
+		throw FmtErrno("Failed to open {}", path);
+
+	return std::make_unique<DetachedSong>(buffer);
+}
+
+void
+BenchPlayer::Run(const std::vector<const char *> &files)
+{
+	auto i = files.begin();
+	pc.Play(MakeSong(*i++));
+
+	while (true) {
+		{
+			std::unique_lock<Mutex> lock(mutex);
+			cond.wait_for(lock, std::chrono::milliseconds(100),
+				      [this]{ return wakeup; });
+			wakeup = false;
+		}
+
+		pc.LockCheckRethrowError();
+
+		const auto info = pc.LockGetSyncInfo();
+		if (info.state == PlayerState::STOP)
+			break;
+
+		if (!info.has_next_song && i != files.end())
+			pc.LockEnqueueSong(MakeSong(*i++));
+	}
+}
+
+int main(int argc, char **argv)
+try {
+	const auto c = ParseCommandLine(argc, argv);
+
+	SetLogThreshold(c.verbose ? LogLevel::DEBUG : LogLevel::WARNING);
+
+	const auto config = LoadConfig(c);
+	const PlayerConfig player_config{config};
+	GlobalInit init{config};
+
+	BenchPlayer player{config, init, player_config};
+	player.pc.SetCrossFade(c.crossfade);
+	player.SetReplayGainMode(c.replay_gain_mode);
+
+	const auto start_allocations = n_allocations.load();
+	const auto start_switches = GetContextSwitches();
+	const auto start_cpu = GetCpuTime();
+	const auto start = Clock::now();
+
+	player.Run(c.files);
+
+	const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+	const double cpu = GetCpuTime() - start_cpu;
+	const long switches = GetContextSwitches() - start_switches;
+	const std::size_t allocations = n_allocations.load() - start_allocations;
+
+	const auto &counting = player.counting_outputs;
+	const double duration = counting.duration.count();
+	const std::size_t n_chunks = counting.n_chunks;
+
+	printf("files:        %zu\n", c.files.size());
+	printf("outputs:      %u\n", c.n_outputs);
+	printf("audio:        %.1f s\n", duration);
+	printf("wall clock:   %.2f s (%.1fx realtime)\n",
+	       wall, wall > 0 ? duration / wall : 0.);
+	printf("CPU:          %.2f s (%.2f ms per second of audio)\n",
+	       cpu, duration > 0 ? cpu * 1000 / duration : 0.);
+	printf("switches:     %ld (%.1f per second of audio)\n",
+	       switches, duration > 0 ? switches / duration : 0.);
+	printf("chunks:       %zu\n", n_chunks);
+	printf("allocations:  %zu (%.2f per chunk)\n",
+	       allocations,
+	       n_chunks > 0 ? double(allocations) / n_chunks : 0.);
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		printf("peak RSS:     %ld KiB\n", usage.ru_maxrss);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * A load generator for the MPD protocol.  It opens several client
+ * connections to a running MPD, sends a mix of typical client
+ * commands on each of them for a while, and prints the throughput
+ * and the latency percentiles of each command.
+ *
+ */
+
+#include "net/Resolver.hxx"
+#include "net/AddressInfo.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/SocketError.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringCompare.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+using FloatMilliseconds = std::chrono::duration<double, std::milli>;
+
+enum class Command : uint8_t {
+	STATUS,
+	IDLE,
+	PLCHANGES,
+	SEARCH,
+	ALBUMART,
+	COUNT
+};
+
+static constexpr std::array<const char *, std::size_t(Command::COUNT)> command_names{
+	"status",
+	"idle",
+	"plchanges",
+	"search",
+	"albumart",
+};
+
+/**
+ * How often each command is picked, relative to the others.  This
+ * resembles a client which polls the status, keeps an idle
+ * connection and occasionally browses.
+ */
+static constexpr std::array<unsigned, std::size_t(Command::COUNT)> command_weights{
+	50, 20, 15, 10, 5,
+};
+
+/**
+ * A blocking MPD protocol connection.
+ */
+class Connection {
+	UniqueSocketDescriptor fd;
+
+	std::string buffer;
+
+public:
+	explicit Connection(SocketAddress address) {
+		if (!fd.Create(address.GetFamily(), SOCK_STREAM, 0))
+			throw MakeSocketError("Failed to create socket");
+
+		if (!fd.Connect(address))
+			throw MakeSocketError("Failed to connect");
+
+		const auto greeting = ReadLine();
+		if (!greeting.starts_with("OK MPD "))
+			throw std::runtime_error("Not a MPD server");
+	}
+
+	void Send(std::string_view request) {
+		while (!request.empty()) {
+			/* SocketDescriptor::Write() does not block */
+			if (fd.WaitWritable(-1) < 0)
+				throw MakeSocketError("Failed to send");
+
+			const auto nbytes = fd.Write(request.data(),
+						     request.size());
+			if (nbytes <= 0)
+				throw MakeSocketError("Failed to send");
+
+			request.remove_prefix(nbytes);
+		}
+	}
+
+	/**
+	 * Send a command and read the response up to the
+	 * terminating "OK" line, skipping binary chunks.
+	 *
+	 * @param value_name if not nullptr, the value of the first
+	 * attribute with this name is returned
+	 * @return the value of the requested attribute or an empty
+	 * string
+	 */
+	std::string Execute(std::string_view request,
+			    const char *value_name=nullptr) {
+		Send(request);
+		return ReadResponse(value_name);
+	}
+
+	std::string ReadResponse(const char *value_name=nullptr) {
+		std::string value;
+
+		while (true) {
+			const auto line = ReadLine();
+			if (line == "OK")
+				return value;
+
+			if (line.starts_with("ACK "))
+				throw std::runtime_error(line);
+
+			if (const char *binary = StringAfterPrefix(line.c_str(),
+								   "binary: ")) {
+				/* skip the chunk and its trailing
+				   newline */
+				Skip(strtoull(binary, nullptr, 10) + 1);
+				continue;
+			}
+
+			if (value_name != nullptr && value.empty()) {
+				const std::size_t name_length = strlen(value_name);
+				if (line.size() > name_length + 2 &&
+				    line.starts_with(value_name) &&
+				    line.compare(name_length, 2, ": ") == 0)
+					value = line.substr(name_length + 2);
+			}
+		}
+	}
+
+private:
+	void Fill() {
+		/* SocketDescriptor::Read() does not block */
+		if (fd.WaitReadable(-1) < 0)
+			throw MakeSocketError("Failed to receive");
+
+		char data[16384];
+		const auto nbytes = fd.Read(data, sizeof(data));
+		if (nbytes < 0)
+			throw MakeSocketError("Failed to receive");
+
+		if (nbytes == 0)
+			throw std::runtime_error("Connection closed by server");
+
+		buffer.append(data, nbytes);
+	}
+
+	std::string ReadLine() {
+		std::size_t newline;
+		while ((newline = buffer.find('\n')) == buffer.npos)
+			Fill();
+
+		std::string line = buffer.substr(0, newline);
+		buffer.erase(0, newline + 1);
+		return line;
+	}
+
+	void Skip(std::size_t length) {
+		while (buffer.size() < length)
+			Fill();
+
+		buffer.erase(0, length);
+	}
+};
+
+/**
+ * The results of one connection (or of all connections, after they
+ * have been merged).
+ */
+struct Results {
+	std::array<std::vector<Clock::duration>, std::size_t(Command::COUNT)> durations;
+
+	unsigned errors = 0;
+
+	void Merge(Results &&src) noexcept {
+		for (std::size_t i = 0; i < durations.size(); ++i)
+			durations[i].insert(durations[i].end(),
+					    src.durations[i].begin(),
+					    src.durations[i].end());
+		errors += src.errors;
+	}
+};
+
+static void
+RunConnection(SocketAddress address, Clock::time_point end,
+	      unsigned seed, Results &results) noexcept
+try {
+	Connection c(address);
+
+	/* pick a song for "albumart" and a search term */
+	const std::string song_uri =
+		c.Execute("playlistinfo 0:1\n", "file");
+	const bool have_song = !song_uri.empty();
+
+	std::minstd_rand random(seed);
+	std::discrete_distribution<unsigned> pick(command_weights.begin(),
+						  command_weights.end());
+
+	unsigned playlist_version = 0;
+
+	while (Clock::now() < end) {
+		const auto command = Command(pick(random));
+		if (command == Command::ALBUMART && !have_song)
+			continue;
+
+		const auto start = Clock::now();
+
+		try {
+			switch (command) {
+			case Command::STATUS:
+				playlist_version =
+					strtoul(c.Execute("status\n",
+							  "playlist").c_str(),
+						nullptr, 10);
+				break;
+
+			case Command::IDLE:
+				/* enter and leave idle mode; this
+				   measures the overhead of the idle
+				   machinery (both commands are sent
+				   at once to avoid a Nagle delay) */
+				c.Execute("idle\nnoidle\n");
+				break;
+
+			case Command::PLCHANGES:
+				c.Execute("plchanges " +
+					  std::to_string(playlist_version > 0
+							 ? playlist_version - 1
+							 : 0) +
+					  "\n");
+				break;
+
+			case Command::SEARCH:
+				c.Execute("search \"(any contains 'the')\" window 0:100\n");
+				break;
+
+			case Command::ALBUMART:
+				c.Execute("albumart \"" + song_uri + "\" 0\n");
+				break;
+
+			case Command::COUNT:
+				break;
+			}
+		} catch (const std::runtime_error &e) {
+			if (!StringStartsWith(e.what(), "ACK "))
+				throw;
+
+			/* protocol errors (e.g. no cover art) are
+			   counted, but the connection survives */
+			++results.errors;
+			continue;
+		}
+
+		results.durations[std::size_t(command)].push_back(Clock::now() - start);
+	}
+} catch (...) {
+	PrintException(std::current_exception());
+	++results.errors;
+}
+
+static void
+PrintResults(Results &results, std::chrono::duration<double> duration)
+{
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < results.durations.size(); ++i) {
+		auto &d = results.durations[i];
+		total += d.size();
+
+		if (d.empty())
+			continue;
+
+		std::sort(d.begin(), d.end());
+
+		const auto percentile = [&d](unsigned p){
+			const std::size_t j = (d.size() - 1) * p / 100;
+			return FloatMilliseconds(d[j]).count();
+		};
+
+		printf("%-10s %8zu  p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n",
+		       command_names[i], d.size(),
+		       percentile(50), percentile(90), percentile(99),
+		       percentile(100));
+	}
+
+	printf("\n%zu requests in %.1f s: %.0f requests/s, %u errors\n",
+	       total, duration.count(), total / duration.count(),
+	       results.errors);
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: bench_protocol HOST[:PORT]|SOCKET [CONNECTIONS] [SECONDS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *const host = argv[1];
+	const unsigned n_connections = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 16;
+	const std::chrono::seconds duration(argc > 3
+					    ? strtoul(argv[3], nullptr, 10)
+					    : 10);
+
+	AllocatedSocketAddress address;
+	if (*host == '/') {
+		address.SetLocal(host);
+	} else {
+		const auto ai = Resolve(host, 6600, 0, SOCK_STREAM);
+		address = ai.GetBest();
+	}
+
+	std::vector<Results> results(n_connections);
+	std::vector<std::thread> threads;
+	threads.reserve(n_connections);
+
+	const auto start = Clock::now();
+	const auto end = start + duration;
+
+	for (unsigned i = 0; i < n_connections; ++i)
+		threads.emplace_back(RunConnection, SocketAddress{address},
+				     end, i + 1, std::ref(results[i]));
+
+	for (auto &t : threads)
+		t.join();
+
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	Results total;
+	for (auto &i : results)
+		total.Merge(std::move(i));
+
+	PrintResults(total, elapsed);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
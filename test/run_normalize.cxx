@@ -18,12 +18,11 @@
  */
 
 /*
- * This program is a command line interface to MPD's normalize library
- * (based on AudioCompress).
+ * This program is a command line interface to MPD's normalizer.
  *
  */
 
-#include "pcm/AudioCompress/compress.h"
+#include "pcm/Normalizer.hxx"
 #include "pcm/AudioParser.hxx"
 #include "pcm/AudioFormat.hxx"
 #include "util/PrintException.hxx"
@@ -38,8 +37,7 @@
 
 int main(int argc, char **argv)
 try {
-	struct Compressor *compressor;
-	static char buffer[4096];
+	alignas(std::max_align_t) static std::byte buffer[4096];
 	ssize_t nbytes;
 
 	if (argc > 2) {
@@ -51,16 +49,19 @@ try {
 	if (argc > 1)
 		audio_format = ParseAudioFormat(argv[1], false);
 
-	compressor = Compressor_new(0);
+	if (!PcmNormalizer::IsSupported(audio_format.format))
+		throw std::runtime_error("Sample format not supported");
 
+	PcmNormalizer normalizer(audio_format.format);
+
+	const std::size_t sample_size = audio_format.GetSampleSize();
 	while ((nbytes = read(0, buffer, sizeof(buffer))) > 0) {
-		Compressor_Process_int16(compressor,
-					 (int16_t *)buffer, nbytes / 2);
+		const std::size_t size = nbytes;
+		normalizer.Process({buffer, size - size % sample_size});
 
 		[[maybe_unused]] ssize_t ignored = write(1, buffer, nbytes);
 	}
 
-	Compressor_delete(compressor);
 	return EXIT_SUCCESS;
 } catch (...) {
 	PrintException(std::current_exception());
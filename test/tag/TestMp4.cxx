@@ -0,0 +1,267 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "tag/Mp4.hxx"
+#include "tag/Handler.hxx"
+#include "input/InputStream.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+#include "Chrono.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include <string.h>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+class SeekableStringInputStream final : public InputStream {
+	const std::string data;
+
+public:
+	SeekableStringInputStream(Mutex &_mutex, std::string &&_data)
+		:InputStream("memory://", _mutex),
+		 data(std::move(_data)) {
+		size = data.size();
+		seekable = true;
+		SetReady();
+	}
+
+	/* virtual methods from InputStream */
+	void Seek(std::unique_lock<Mutex> &, offset_type new_offset) override {
+		if (new_offset > size)
+			throw std::runtime_error("Seek beyond end of file");
+
+		offset = new_offset;
+	}
+
+	bool IsEOF() const noexcept override {
+		return offset >= size;
+	}
+
+	size_t Read(std::unique_lock<Mutex> &,
+		    void *ptr, size_t read_size) override {
+		const size_t nbytes = std::min<size_t>(size - offset, read_size);
+		memcpy(ptr, data.data() + offset, nbytes);
+		offset += nbytes;
+		return nbytes;
+	}
+};
+
+class RecordingTagHandler final : public TagHandler {
+public:
+	SignedSongTime duration = SignedSongTime::Negative();
+	AudioFormat audio_format = AudioFormat::Undefined();
+	std::map<TagType, std::string> tags;
+	std::map<std::string, std::string, std::less<>> pairs;
+	std::string picture_mime_type;
+	std::size_t picture_size = 0;
+
+	RecordingTagHandler() noexcept
+		:TagHandler(WANT_DURATION|WANT_TAG|WANT_PAIR|
+			    WANT_AUDIO_FORMAT|WANT_PICTURE) {}
+
+	bool IsEmpty() const noexcept {
+		return duration.IsNegative() &&
+			!audio_format.IsDefined() &&
+			tags.empty() && pairs.empty() &&
+			picture_size == 0;
+	}
+
+	void OnDuration(SongTime _duration) noexcept override {
+		duration = _duration;
+	}
+
+	void OnTag(TagType type, std::string_view value) noexcept override {
+		tags.emplace(type, value);
+	}
+
+	void OnPair(std::string_view key,
+		    std::string_view value) noexcept override {
+		pairs.emplace(key, value);
+	}
+
+	void OnAudioFormat(AudioFormat af) noexcept override {
+		audio_format = af;
+	}
+
+	void OnPicture(const char *mime_type,
+		       std::span<const std::byte> buffer) noexcept override {
+		picture_mime_type = mime_type;
+		picture_size = buffer.size();
+	}
+};
+
+static std::string
+BE16(unsigned value)
+{
+	return {char(value >> 8), char(value)};
+}
+
+static std::string
+BE32(uint32_t value)
+{
+	return BE16(value >> 16) + BE16(value & 0xffff);
+}
+
+static std::string
+Box(std::string_view type, std::string_view payload)
+{
+	std::string result = BE32(8 + payload.size());
+	result += type;
+	result += payload;
+	return result;
+}
+
+/**
+ * A "data" box inside an "ilst" item.
+ */
+static std::string
+Data(uint32_t type, std::string_view value)
+{
+	return Box("data"sv, BE32(type) + BE32(0) + std::string{value});
+}
+
+static std::string
+MakeMoov(std::string_view handler_type, std::string_view ilst)
+{
+	/* version 0: 12 bytes of version/flags/times, timescale,
+	   duration; the rest is not evaluated */
+	const std::string mvhd = Box("mvhd"sv, BE32(0) + BE32(0) + BE32(0) +
+				     BE32(1000) + BE32(5500) +
+				     std::string(80, '\0'));
+	const std::string mdhd = Box("mdhd"sv, BE32(0) + BE32(0) + BE32(0) +
+				     BE32(44100) + BE32(44100 * 5) +
+				     BE32(0));
+	const std::string hdlr = Box("hdlr"sv, BE32(0) + BE32(0) +
+				     std::string{handler_type} +
+				     std::string(12, '\0') + '\0');
+
+	/* the sound sample entry: reserved, data reference index,
+	   version, revision, vendor, channels, sample size,
+	   compression id, packet size, 16.16 sample rate */
+	const std::string mp4a = Box("mp4a"sv, std::string(6, '\0') + BE16(1) +
+				     BE16(0) + BE16(0) + BE32(0) +
+				     BE16(2) + BE16(16) +
+				     BE16(0) + BE16(0) +
+				     BE32(44100 << 16));
+	const std::string stsd = Box("stsd"sv, BE32(0) + BE32(1) + mp4a);
+	const std::string minf = Box("minf"sv, Box("stbl"sv, stsd));
+	const std::string trak = Box("trak"sv,
+				     Box("mdia"sv, mdhd + hdlr + minf));
+
+	const std::string meta = Box("meta"sv, BE32(0) +
+				     Box("hdlr"sv, BE32(0) + BE32(0) +
+					 "mdirappl" + std::string(9, '\0')) +
+				     Box("ilst"sv, ilst));
+
+	return Box("moov"sv, mvhd + trak + Box("udta"sv, meta));
+}
+
+static std::string
+MakeIlst()
+{
+	return Box("\xa9nam"sv, Data(1, "Title"sv)) +
+		Box("\xa9" "ART"sv, Data(1, "Artist"sv)) +
+		Box("aART"sv, Data(1, "Album Artist"sv)) +
+		Box("trkn"sv, Data(0, BE16(0) + BE16(3) + BE16(12) + BE16(0))) +
+		Box("----"sv, Box("mean"sv, BE32(0) + "com.apple.iTunes") +
+		    Box("name"sv, BE32(0) + "MusicBrainz Track Id") +
+		    Data(1, "abc-123"sv)) +
+		Box("covr"sv, Data(13, "\xff\xd8\xff\xe0"sv));
+}
+
+static std::string
+MakeFile(std::string_view moov)
+{
+	return Box("ftyp"sv, "M4A " + BE32(0) + "M4A mp42isom") +
+		Box("mdat"sv, std::string(1000, 'x')) +
+		std::string{moov};
+}
+
+} // anonymous namespace
+
+TEST(Mp4, Basic)
+{
+	Mutex mutex;
+	SeekableStringInputStream is(mutex,
+				     MakeFile(MakeMoov("soun"sv, MakeIlst())));
+
+	RecordingTagHandler handler;
+	ASSERT_TRUE(ScanMp4(is, handler));
+
+	/* the track duration has precedence over the movie
+	   duration */
+	EXPECT_EQ(handler.duration, SignedSongTime::FromS(5));
+	EXPECT_EQ(handler.audio_format,
+		  AudioFormat(44100, SampleFormat::FLOAT, 2));
+
+	EXPECT_EQ(handler.tags[TAG_TITLE], "Title");
+	EXPECT_EQ(handler.tags[TAG_ARTIST], "Artist");
+	EXPECT_EQ(handler.tags[TAG_ALBUM_ARTIST], "Album Artist");
+	EXPECT_EQ(handler.tags[TAG_TRACK], "3/12");
+	EXPECT_EQ(handler.tags[TAG_MUSICBRAINZ_TRACKID], "abc-123");
+
+	EXPECT_EQ(handler.pairs["title"], "Title");
+	EXPECT_EQ(handler.pairs["MusicBrainz Track Id"], "abc-123");
+
+	EXPECT_EQ(handler.picture_mime_type, "image/jpeg");
+	EXPECT_EQ(handler.picture_size, 4U);
+}
+
+TEST(Mp4, NotMp4)
+{
+	Mutex mutex;
+	SeekableStringInputStream is(mutex, std::string(64, 'x'));
+
+	RecordingTagHandler handler;
+	EXPECT_FALSE(ScanMp4(is, handler));
+	EXPECT_TRUE(handler.IsEmpty());
+}
+
+TEST(Mp4, NoSoundTrack)
+{
+	/* a video-only file must be left to FFmpeg, and no partial
+	   results must be passed to the handler */
+	Mutex mutex;
+	SeekableStringInputStream is(mutex,
+				     MakeFile(MakeMoov("vide"sv, MakeIlst())));
+
+	RecordingTagHandler handler;
+	EXPECT_FALSE(ScanMp4(is, handler));
+	EXPECT_TRUE(handler.IsEmpty());
+}
+
+TEST(Mp4, Truncated)
+{
+	auto data = MakeFile(MakeMoov("soun"sv, MakeIlst()));
+	data.resize(data.size() - 10);
+
+	Mutex mutex;
+	SeekableStringInputStream is(mutex, std::move(data));
+
+	RecordingTagHandler handler;
+	EXPECT_ANY_THROW(ScanMp4(is, handler));
+	EXPECT_TRUE(handler.IsEmpty());
+}
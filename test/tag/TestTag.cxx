@@ -0,0 +1,170 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "tag/Tag.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Pool.hxx"
+#include "tag/Settings.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(Tag, ShareOnCopy)
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_ARTIST, "Tag.ShareOnCopy");
+	builder.AddItem(TAG_TITLE, "foo");
+
+	Tag a = builder.Commit();
+	EXPECT_FALSE(a.IsShared());
+	EXPECT_GT(a.GetExclusiveMemoryUsage(), 0U);
+
+	{
+		const Tag b(a);
+		EXPECT_EQ(a.items, b.items);
+		EXPECT_TRUE(a.IsShared());
+		EXPECT_TRUE(b.IsShared());
+		EXPECT_EQ(a.GetExclusiveMemoryUsage(), 0U);
+		EXPECT_STREQ(b.GetValue(TAG_ARTIST), "Tag.ShareOnCopy");
+	}
+
+	EXPECT_FALSE(a.IsShared());
+}
+
+TEST(Tag, CopyOnWrite)
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_ARTIST, "Tag.CopyOnWrite");
+	Tag a = builder.Commit();
+	Tag b(a);
+
+	/* modifying "b" must not affect "a" */
+	TagBuilder builder2(std::move(b));
+	builder2.AddItem(TAG_TITLE, "bar");
+	b = builder2.Commit();
+
+	EXPECT_FALSE(a.IsShared());
+	EXPECT_FALSE(b.IsShared());
+	EXPECT_NE(a.items, b.items);
+	EXPECT_EQ(a.num_items, 1U);
+	EXPECT_EQ(b.num_items, 2U);
+	EXPECT_EQ(a.GetValue(TAG_TITLE), nullptr);
+	EXPECT_STREQ(b.GetValue(TAG_TITLE), "bar");
+	EXPECT_STREQ(a.GetValue(TAG_ARTIST), "Tag.CopyOnWrite");
+	EXPECT_STREQ(b.GetValue(TAG_ARTIST), "Tag.CopyOnWrite");
+}
+
+TEST(Tag, ReleaseItems)
+{
+	const auto before = tag_pool_get_stats();
+
+	{
+		TagBuilder builder;
+		builder.AddItem(TAG_ARTIST, "Tag.ReleaseItems");
+		Tag a = builder.Commit();
+		Tag b(a);
+		Tag c(b);
+		a.Clear();
+		EXPECT_STREQ(c.GetValue(TAG_ARTIST), "Tag.ReleaseItems");
+	}
+
+	EXPECT_EQ(tag_pool_get_stats().n_slots, before.n_slots);
+}
+
+TEST(Tag, Types)
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_ARTIST, "Tag.Types");
+	builder.AddItem(TAG_TITLE, "foo");
+	builder.AddItem(TAG_ARTIST, "bar");
+	const Tag a = builder.Commit();
+
+	ASSERT_EQ(a.num_items, 3U);
+
+	const TagType *types = a.GetTypes();
+	for (unsigned i = 0; i < a.num_items; ++i)
+		EXPECT_EQ(types[i], a.items[i]->type);
+
+	EXPECT_EQ(a.FindItem(TAG_ARTIST), a.items[0]);
+	EXPECT_EQ(a.FindItem(TAG_TITLE), a.items[1]);
+	EXPECT_EQ(a.FindItem(TAG_ALBUM), nullptr);
+
+	/* a copy shares the packed types */
+	const Tag b(a);
+	EXPECT_EQ(b.GetTypes(), types);
+}
+
+TEST(Tag, MergeShared)
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_ARTIST, "Tag.MergeShared");
+	const std::shared_ptr<const Tag> a =
+		std::make_shared<const Tag>(builder.Commit());
+
+	builder.AddItem(TAG_TITLE, "foo");
+	const std::shared_ptr<const Tag> b =
+		std::make_shared<const Tag>(builder.Commit());
+
+	/* merging with nullptr passes the object through */
+	EXPECT_EQ(Tag::Merge(a, std::shared_ptr<const Tag>{}), a);
+	EXPECT_EQ(Tag::Merge(std::shared_ptr<const Tag>{}, b), b);
+
+	const auto c = Tag::Merge(a, b);
+	EXPECT_NE(c, a);
+	EXPECT_NE(c, b);
+	EXPECT_STREQ(c->GetValue(TAG_ARTIST), "Tag.MergeShared");
+	EXPECT_STREQ(c->GetValue(TAG_TITLE), "foo");
+}
+
+TEST(Tag, ExtractDisabled)
+{
+	const TagMask old_mask = global_tag_mask;
+	global_tag_mask = ~TagMask{TAG_COMMENT};
+
+	{
+		/* disabled types are discarded by default */
+		TagBuilder builder;
+		builder.AddItem(TAG_COMMENT, "Tag.ExtractDisabled");
+		EXPECT_TRUE(builder.empty());
+	}
+
+	TagBuilder builder;
+	builder.AcceptAllTypes();
+	builder.SetDuration(SignedSongTime::FromS(42));
+	builder.AddItem(TAG_ARTIST, "Tag.ExtractDisabled");
+	builder.AddItem(TAG_COMMENT, "foo");
+	builder.AddItem(TAG_TITLE, "bar");
+
+	const Tag hidden = builder.ExtractDisabled();
+	const Tag visible = builder.Commit();
+
+	global_tag_mask = old_mask;
+
+	ASSERT_EQ(hidden.num_items, 1U);
+	EXPECT_STREQ(hidden.GetValue(TAG_COMMENT), "foo");
+	EXPECT_TRUE(hidden.duration.IsNegative());
+
+	ASSERT_EQ(visible.num_items, 2U);
+	EXPECT_STREQ(visible.GetValue(TAG_ARTIST), "Tag.ExtractDisabled");
+	EXPECT_STREQ(visible.GetValue(TAG_TITLE), "bar");
+	EXPECT_EQ(visible.GetValue(TAG_COMMENT), nullptr);
+	EXPECT_EQ(visible.duration, SignedSongTime::FromS(42));
+
+	/* nothing to extract */
+	EXPECT_EQ(builder.ExtractDisabled().num_items, 0U);
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "tag/Pool.hxx"
+#include "tag/Item.hxx"
+#include "util/AllocatedString.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cctype>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TagPool, Deduplicate)
+{
+	const auto before = tag_pool_get_stats();
+
+	TagItem *a = tag_pool_get_item(TAG_ARTIST, "TagPool.Deduplicate");
+	TagItem *b = tag_pool_get_item(TAG_ARTIST, "TagPool.Deduplicate");
+	TagItem *c = tag_pool_get_item(TAG_ALBUM, "TagPool.Deduplicate");
+
+	EXPECT_EQ(a, b);
+	EXPECT_NE(a, c);
+	EXPECT_EQ(a->type, TAG_ARTIST);
+	EXPECT_STREQ(a->value, "TagPool.Deduplicate");
+
+	TagItem *d = tag_pool_dup_item(a);
+	EXPECT_EQ(a, d);
+
+	auto stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_slots, before.n_slots + 2);
+	EXPECT_EQ(stats.lookups, before.lookups + 3);
+	EXPECT_EQ(stats.hits, before.hits + 1);
+
+	tag_pool_put_item(a);
+	tag_pool_put_item(b);
+	tag_pool_put_item(c);
+	tag_pool_put_item(d);
+
+	stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_slots, before.n_slots);
+}
+
+static std::atomic_uint n_fold_calls;
+
+static AllocatedString
+ToLower(std::string_view src) noexcept
+{
+	++n_fold_calls;
+
+	std::string s{src};
+	for (auto &ch : s)
+		ch = std::tolower(ch);
+	return AllocatedString{s};
+}
+
+static AllocatedString
+Reverse(std::string_view src) noexcept
+{
+	return AllocatedString{std::string{src.rbegin(), src.rend()}};
+}
+
+TEST(TagPool, Folded)
+{
+	TagItem *a = tag_pool_get_item(TAG_ARTIST, "TagPool.Folded");
+	TagItem *b = tag_pool_get_item(TAG_ARTIST, "tagpool.folded");
+
+	const unsigned before = n_fold_calls;
+
+	const char *fa = tag_pool_get_folded(*a, ToLower);
+	EXPECT_STREQ(fa, "tagpool.folded");
+	EXPECT_EQ(n_fold_calls, before + 1);
+
+	/* the second call returns the cached value */
+	EXPECT_EQ(tag_pool_get_folded(*a, ToLower), fa);
+	EXPECT_EQ(n_fold_calls, before + 1);
+
+	/* already folded: no copy */
+	EXPECT_EQ(tag_pool_get_folded(*b, ToLower), b->value);
+	EXPECT_EQ(n_fold_calls, before + 2);
+
+	/* the sort key has its own cache slot */
+	const char *ka = tag_pool_get_sort_key(*a, Reverse);
+	EXPECT_STREQ(ka, "dedloF.looPgaT");
+	EXPECT_EQ(tag_pool_get_sort_key(*a, Reverse), ka);
+	EXPECT_EQ(tag_pool_get_folded(*a, ToLower), fa);
+	EXPECT_EQ(n_fold_calls, before + 2);
+
+	tag_pool_put_item(a);
+	tag_pool_put_item(b);
+}
+
+TEST(TagPool, Grow)
+{
+	const auto before = tag_pool_get_stats();
+
+	std::vector<TagItem *> items;
+	for (unsigned i = 0; i < 100000; ++i)
+		items.push_back(tag_pool_get_item(TAG_TITLE,
+						  std::to_string(i)));
+
+	auto stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_slots, before.n_slots + items.size());
+	EXPECT_GE(stats.n_buckets, items.size());
+
+	for (unsigned i = 0; i < items.size(); ++i)
+		EXPECT_STREQ(items[i]->value, std::to_string(i).c_str());
+
+	for (auto *item : items)
+		tag_pool_put_item(item);
+
+	stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_slots, before.n_slots);
+}
+
+TEST(TagPool, Threads)
+{
+	const auto before = tag_pool_get_stats();
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < 4; ++t) {
+		threads.emplace_back([]{
+			for (unsigned round = 0; round < 50; ++round) {
+				std::vector<TagItem *> items;
+				for (unsigned i = 0; i < 500; ++i) {
+					auto *item = tag_pool_get_item(TAG_GENRE,
+								       std::to_string(i));
+					items.push_back(item);
+					items.push_back(tag_pool_dup_item(item));
+				}
+
+				for (auto *item : items)
+					tag_pool_put_item(item);
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	const auto stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_slots, before.n_slots);
+}
@@ -18,11 +18,13 @@ icy_parse_tag(const char *p)
 {
 	char *q = strdup(p);
 	AtScopeExit(q) { free(q); };
-	return icy_parse_tag(
+	TagBuilder tag;
+	icy_parse_tag(tag,
 #ifdef HAVE_ICU_CONVERTER
-			     nullptr,
+		      nullptr,
 #endif
-			     q, q + strlen(q));
+		      q, q + strlen(q));
+	return tag.CommitNew();
 }
 
 static void
@@ -64,3 +66,82 @@ TEST(IcyMetadataParserTest, Basic)
 	TestIcyParserTitle("a='b'c';StreamTitle='foo'bar'", "foo'bar");
 	TestIcyParserTitle("StreamTitle='fo'o'b'ar';a='b'c'd'", "fo'o'b'ar");
 }
+
+TEST(IcyMetadataParserTest, DataRest)
+{
+	IcyMetaDataParser parser;
+	parser.Start(8);
+	EXPECT_EQ(parser.GetDataRest(), 8U);
+
+	EXPECT_EQ(parser.Data(5), 5U);
+	EXPECT_EQ(parser.GetDataRest(), 3U);
+	EXPECT_EQ(parser.Data(3), 3U);
+	EXPECT_EQ(parser.GetDataRest(), 0U);
+
+	/* the length byte comes first */
+	EXPECT_EQ(parser.GetMetaRest(), 1U);
+	const char length = 2;
+	EXPECT_EQ(parser.Meta(&length, 1), 1U);
+	EXPECT_EQ(parser.GetMetaRest(), 32U);
+
+	char meta[32]{};
+	strcpy(meta, "StreamTitle='foo';");
+	EXPECT_EQ(parser.Meta(meta, 10), 10U);
+	EXPECT_EQ(parser.GetMetaRest(), 22U);
+	EXPECT_EQ(parser.Meta(meta + 10, 22), 22U);
+
+	/* back to normal data */
+	EXPECT_EQ(parser.GetDataRest(), 8U);
+
+	const auto tag = parser.ReadTag();
+	ASSERT_TRUE(tag);
+	CompareTagTitle(*tag, "foo");
+
+	/* an empty metadata block */
+	EXPECT_EQ(parser.Data(8), 8U);
+	const char zero = 0;
+	EXPECT_EQ(parser.Meta(&zero, 1), 1U);
+	EXPECT_EQ(parser.GetDataRest(), 8U);
+	EXPECT_FALSE(parser.ReadTag());
+}
+
+/**
+ * Feed one data block and one 32 byte metadata block to the parser.
+ */
+static void
+FeedBlock(IcyMetaDataParser &parser, const char *meta)
+{
+	EXPECT_EQ(parser.Data(8), 8U);
+
+	char buffer[1 + 32]{};
+	buffer[0] = 2;
+	strcpy(buffer + 1, meta);
+	EXPECT_EQ(parser.Meta(buffer, sizeof(buffer)), sizeof(buffer));
+}
+
+TEST(IcyMetadataParserTest, Duplicate)
+{
+	IcyMetaDataParser parser;
+	parser.Start(8);
+
+	FeedBlock(parser, "StreamTitle='foo';");
+	auto tag = parser.ReadTag();
+	ASSERT_TRUE(tag);
+	CompareTagTitle(*tag, "foo");
+
+	/* the same title again is suppressed */
+	FeedBlock(parser, "StreamTitle='foo';");
+	EXPECT_FALSE(parser.ReadTag());
+
+	FeedBlock(parser, "StreamTitle='bar';");
+	tag = parser.ReadTag();
+	ASSERT_TRUE(tag);
+	CompareTagTitle(*tag, "bar");
+
+	/* after a reset, the title is reported again */
+	parser.Reset();
+	FeedBlock(parser, "StreamTitle='bar';");
+	tag = parser.ReadTag();
+	ASSERT_TRUE(tag);
+	CompareTagTitle(*tag, "bar");
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pcm/Dsd2PcmFir.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+static constexpr unsigned DSD64_RATE = 2822400 / 8;
+
+static std::vector<uint8_t>
+MakeConstant(std::size_t size, uint8_t value)
+{
+	return std::vector<uint8_t>(size, value);
+}
+
+/**
+ * Generate a sine wave with a second order delta-sigma modulator.
+ */
+static std::vector<uint8_t>
+MakeSine(unsigned channels, std::size_t n_frames, double frequency,
+	 double amplitude, unsigned sample_rate)
+{
+	std::vector<uint8_t> result(channels * n_frames);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		double i1 = 0, i2 = 0, y = 0;
+
+		for (std::size_t i = 0; i < n_frames * 8; ++i) {
+			const double t = double(i) / (sample_rate * 8.);
+			const double x = amplitude * std::sin(2 * M_PI * frequency * t);
+			i1 += x - y;
+			i2 += i1 - y;
+			y = i2 >= 0 ? 1 : -1;
+
+			if (y > 0)
+				result[(i / 8) * channels + c] |= 0x80 >> (i % 8);
+		}
+	}
+
+	return result;
+}
+
+TEST(Dsd2PcmFir, Silence)
+{
+	for (unsigned decimation = 8; decimation <= 128; decimation *= 2) {
+		Dsd2PcmFir fir;
+		fir.Open(2, DSD64_RATE, decimation, Dsd2PcmQuality::LOW);
+
+		const auto src = MakeConstant(2 * 4096, 0x69);
+		const auto dest = fir.ToFloat(src);
+		EXPECT_EQ(dest.size(), 2 * 4096 * 8 / decimation);
+
+		for (const auto i : dest)
+			EXPECT_NEAR(i, 0, 1e-3);
+	}
+}
+
+TEST(Dsd2PcmFir, DC)
+{
+	Dsd2PcmFir fir;
+	fir.Open(1, DSD64_RATE, 32, Dsd2PcmQuality::MEDIUM);
+
+	/* skip the transient at the beginning */
+	auto dest = fir.ToFloat(MakeConstant(16384, 0xff));
+	ASSERT_FALSE(dest.empty());
+	EXPECT_NEAR(dest.back(), 1, 1e-4);
+
+	const auto dest24 = fir.ToS24(MakeConstant(16384, 0x00));
+	ASSERT_FALSE(dest24.empty());
+	EXPECT_NEAR(dest24.back(), -8388607, 1000);
+}
+
+TEST(Dsd2PcmFir, Chunks)
+{
+	/* the number of output frames must not depend on how the
+	   input is split */
+	Dsd2PcmFir fir;
+	fir.Open(3, DSD64_RATE, 64, Dsd2PcmQuality::LOW);
+
+	const auto src = MakeConstant(3 * 1000, 0x69);
+	std::size_t n_samples = 0;
+	for (std::size_t i = 0; i < src.size(); i += 3 * 7) {
+		const std::size_t n = std::min<std::size_t>(3 * 7,
+							    src.size() - i);
+		n_samples += fir.ToFloat({src.data() + i, n}).size();
+	}
+
+	EXPECT_EQ(n_samples, 3 * 1000 / 8);
+}
+
+TEST(Dsd2PcmFir, Sine)
+{
+	constexpr unsigned channels = 2;
+	constexpr std::size_t n_frames = DSD64_RATE / 4;
+	constexpr double amplitude = 0.5;
+
+	Dsd2PcmFir fir;
+	fir.Open(channels, DSD64_RATE, 64, Dsd2PcmQuality::HIGH);
+
+	const auto src = MakeSine(channels, n_frames, 1000, amplitude,
+				  DSD64_RATE);
+	const auto dest = fir.ToFloat(src);
+	ASSERT_EQ(dest.size(), n_frames * channels / 8);
+
+	/* skip the filter delay, then compare the RMS with the one
+	   of the original sine wave */
+	for (unsigned c = 0; c < channels; ++c) {
+		double sum = 0;
+		std::size_t n = 0;
+		for (std::size_t i = dest.size() / 2 + c; i < dest.size();
+		     i += channels, ++n)
+			sum += double(dest[i]) * double(dest[i]);
+
+		EXPECT_NEAR(std::sqrt(sum / n), amplitude / std::sqrt(2.), 0.01);
+	}
+}
@@ -24,6 +24,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include <string.h>
 
 TEST(PcmTest, ExportShift8)
@@ -166,6 +168,92 @@ TEST(PcmTest, ExportReverseEndian)
 			 sizeof(expected_silence)), 0);
 }
 
+/**
+ * Pack and reverse with enough samples for the vectorized code path
+ * and a scalar tail.
+ */
+TEST(PcmTest, ExportPack24ReverseEndian)
+{
+	std::vector<int32_t> src;
+	for (int32_t i = 0; i < 37; ++i)
+		src.push_back((i * 0x10203) & 0xffffff);
+
+	std::vector<uint8_t> expected;
+	for (const int32_t i : src) {
+		const uint8_t low = i, mid = i >> 8, high = i >> 16;
+		if (IsBigEndian()) {
+			expected.push_back(low);
+			expected.push_back(mid);
+			expected.push_back(high);
+		} else {
+			expected.push_back(high);
+			expected.push_back(mid);
+			expected.push_back(low);
+		}
+	}
+
+	PcmExport::Params params;
+	params.pack24 = true;
+	params.reverse_endian = true;
+
+	PcmExport e;
+	e.Open(SampleFormat::S24_P32, 1, params);
+
+	EXPECT_EQ(e.GetOutputFrameSize(), 3u);
+
+	auto dest = e.Export(std::as_bytes(std::span{src}));
+	ASSERT_EQ(expected.size(), dest.size());
+	EXPECT_TRUE(memcmp(dest.data(), expected.data(), dest.size()) == 0);
+}
+
+TEST(PcmTest, ExportShift8ReverseEndian)
+{
+	static constexpr int32_t src[] = { 0x0, 0x1, 0x100, 0x10000, 0xffffff };
+	static constexpr uint32_t expected[] = {
+		ByteSwap32(0x0), ByteSwap32(0x100), ByteSwap32(0x10000),
+		ByteSwap32(0x1000000), ByteSwap32(0xffffff00),
+	};
+
+	PcmExport::Params params;
+	params.shift8 = true;
+	params.reverse_endian = true;
+
+	PcmExport e;
+	e.Open(SampleFormat::S24_P32, 1, params);
+
+	auto dest = e.Export(std::as_bytes(std::span{src}));
+	EXPECT_EQ(sizeof(expected), dest.size());
+	EXPECT_TRUE(memcmp(dest.data(), expected, dest.size()) == 0);
+}
+
+/**
+ * Opening the object again with the same parameters keeps the
+ * configuration; different parameters replace it.
+ */
+TEST(PcmTest, ExportReopen)
+{
+	static constexpr int32_t src[] = { 0x10203, 0x40506 };
+
+	PcmExport::Params params;
+	params.pack24 = true;
+
+	PcmExport e;
+	e.Open(SampleFormat::S24_P32, 2, params);
+	e.Open(SampleFormat::S24_P32, 2, params);
+
+	EXPECT_EQ(e.GetOutputFrameSize(), 6u);
+	EXPECT_EQ(e.Export(std::as_bytes(std::span{src})).size(), 6u);
+
+	params.pack24 = false;
+	e.Open(SampleFormat::S24_P32, 2, params);
+
+	EXPECT_EQ(e.GetOutputFrameSize(), 8u);
+	EXPECT_EQ(e.Export(std::as_bytes(std::span{src})).size(), 8u);
+
+	e.Open(SampleFormat::S16, 2, params);
+	EXPECT_EQ(e.GetOutputFrameSize(), 4u);
+}
+
 #ifdef ENABLE_DSD
 
 TEST(PcmTest, ExportDsdU16)
@@ -356,6 +444,78 @@ TEST(PcmTest, ExportDop)
 			 sizeof(expected_silence)), 0);
 }
 
+/**
+ * A straightforward implementation of the DSD export modes, for
+ * checking the optimized ones with long buffers.
+ */
+template<typename T>
+static std::vector<T>
+ReferenceExportDsd(PcmExport::DsdMode mode, std::span<const uint8_t> src,
+		   unsigned channels)
+{
+	/* how many DSD bytes per channel go into one sample? */
+	const unsigned n = mode == PcmExport::DsdMode::U32 ? 4 : 2;
+
+	std::vector<T> result;
+	for (std::size_t frame = 0; (frame + 1) * n * channels <= src.size();
+	     ++frame) {
+		const uint8_t *p = src.data() + frame * n * channels;
+
+		for (unsigned c = 0; c < channels; ++c) {
+			uint32_t value = 0;
+			for (unsigned i = 0; i < n; ++i)
+				value = (value << 8) | p[i * channels + c];
+
+			if (mode == PcmExport::DsdMode::DOP)
+				value |= frame % 2 == 0 ? 0xff050000 : 0xfffa0000;
+
+			result.push_back(T(value));
+		}
+	}
+
+	return result;
+}
+
+template<typename T>
+static void
+TestExportDsdLong(PcmExport::DsdMode mode, unsigned channels)
+{
+	/* long enough for the vectorized code paths */
+	std::vector<uint8_t> src(1024 * channels);
+	for (std::size_t i = 0; i < src.size(); ++i)
+		src[i] = uint8_t(i * 151 + (i >> 8));
+
+	const auto expected = ReferenceExportDsd<T>(mode, src, channels);
+
+	PcmExport::Params params;
+	params.dsd_mode = mode;
+
+	PcmExport e;
+	e.Open(SampleFormat::DSD, channels, params);
+
+	/* odd split to exercise the rest buffer */
+	const std::size_t split = 4 * channels + channels;
+	const auto src_bytes = std::as_bytes(std::span{src});
+
+	std::vector<std::byte> dest;
+	for (const auto part : {src_bytes.first(split), src_bytes.subspan(split)}) {
+		const auto d = e.Export(part);
+		dest.insert(dest.end(), d.begin(), d.end());
+	}
+
+	ASSERT_EQ(dest.size(), expected.size() * sizeof(T));
+	EXPECT_EQ(memcmp(dest.data(), expected.data(), dest.size()), 0);
+}
+
+TEST(PcmTest, ExportDsdLong)
+{
+	for (unsigned channels : {1, 2, 3}) {
+		TestExportDsdLong<uint16_t>(PcmExport::DsdMode::U16, channels);
+		TestExportDsdLong<uint32_t>(PcmExport::DsdMode::U32, channels);
+		TestExportDsdLong<uint32_t>(PcmExport::DsdMode::DOP, channels);
+	}
+}
+
 #endif
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
@@ -22,6 +22,7 @@
 #include "pcm/Dither.hxx"
 #include "pcm/Buffer.hxx"
 #include "pcm/SampleFormat.hxx"
+#include "pcm/FloatConvert.hxx"
 
 #include <gtest/gtest.h>
 
@@ -159,3 +160,66 @@ TEST(PcmTest, FormatFloat32)
 	for (size_t i = 4; i < N; ++i)
 		EXPECT_NEAR(src[i], d[i], error);
 }
+
+/**
+ * Verify that the (possibly vectorized) float converters produce
+ * exactly the same results as the portable per-sample code, including
+ * values out of range.
+ */
+template<SampleFormat F>
+static void
+CheckFloatToIntegerExact(std::span<const std::int32_t> (*f)(PcmBuffer &,
+							    SampleFormat,
+							    std::span<const std::byte>))
+{
+	constexpr size_t N = 509;
+	auto src = TestDataBuffer<float, N>(RandomFloat());
+
+	/* stretch the range to exercise clamping */
+	std::array<float, N> scaled;
+	for (size_t i = 0; i < N; ++i)
+		scaled[i] = src[i] * 1.5f;
+	scaled[0] = 1.f;
+	scaled[1] = -1.f;
+	scaled[2] = 0.f;
+
+	PcmBuffer buffer;
+	auto d = f(buffer, SampleFormat::FLOAT, std::as_bytes(std::span{scaled}));
+	EXPECT_EQ(N, d.size());
+
+	for (size_t i = 0; i < N; ++i)
+		EXPECT_EQ(FloatToIntegerSampleConvert<F>::Convert(scaled[i]),
+			  d[i]);
+}
+
+TEST(PcmTest, FormatFloat24Exact)
+{
+	CheckFloatToIntegerExact<SampleFormat::S24_P32>(pcm_convert_to_24);
+}
+
+TEST(PcmTest, FormatFloat32Exact)
+{
+	CheckFloatToIntegerExact<SampleFormat::S32>(pcm_convert_to_32);
+}
+
+TEST(PcmTest, FormatFloat16Exact)
+{
+	constexpr size_t N = 509;
+	auto src = TestDataBuffer<float, N>(RandomFloat());
+
+	std::array<float, N> scaled;
+	for (size_t i = 0; i < N; ++i)
+		scaled[i] = src[i] * 1.5f;
+	scaled[0] = 1.f;
+	scaled[1] = -1.f;
+
+	PcmBuffer buffer;
+	PcmDither dither;
+	auto d = pcm_convert_to_16(buffer, dither, SampleFormat::FLOAT,
+				   std::as_bytes(std::span{scaled}));
+	EXPECT_EQ(N, d.size());
+
+	for (size_t i = 0; i < N; ++i)
+		EXPECT_EQ(FloatToIntegerSampleConvert<SampleFormat::S16>::Convert(scaled[i]),
+			  d[i]);
+}
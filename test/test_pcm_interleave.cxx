@@ -63,6 +63,38 @@ TEST(PcmTest, Interleave8)
 	TestInterleaveN<uint8_t>();
 }
 
+TEST(PcmTest, Interleave8Stereo)
+{
+	/* long enough for the vectorized code path, plus a few
+	   frames for the scalar remainder */
+	static constexpr size_t n_frames = 67;
+
+	uint8_t src1[n_frames], src2[n_frames];
+	for (size_t i = 0; i < n_frames; ++i) {
+		src1[i] = uint8_t(i * 3 + 1);
+		src2[i] = uint8_t(0xff - i * 5);
+	}
+
+	const uint8_t *const src_all[] = { src1, src2 };
+	const std::span<const void *const> src{
+		(const void *const*)src_all,
+		std::size(src_all),
+	};
+
+	static constexpr uint8_t poison = 0xa5;
+	uint8_t dest[n_frames * 2 + 1];
+	std::fill_n(dest, std::size(dest), poison);
+
+	PcmInterleave(dest, src, n_frames, 1);
+
+	for (size_t i = 0; i < n_frames; ++i) {
+		EXPECT_EQ(src1[i], dest[2 * i]);
+		EXPECT_EQ(src2[i], dest[2 * i + 1]);
+	}
+
+	EXPECT_EQ(poison, dest[n_frames * 2]);
+}
+
 TEST(PcmTest, Interleave16)
 {
 	TestInterleaveN<uint16_t>();
@@ -122,3 +154,53 @@ TEST(PcmTest, Interleave64)
 {
 	TestInterleaveN<uint64_t>();
 }
+
+/**
+ * Test PcmInterleave32() and PcmInterleave32To16() with channel
+ * counts which have vectorized implementations and frame counts
+ * which leave a scalar remainder.
+ */
+TEST(PcmTest, Interleave32Vectorized)
+{
+	static constexpr size_t max_frames = 67;
+
+	for (const unsigned channels : {1u, 2u, 3u, 6u, 8u}) {
+		int32_t src_buffer[8][max_frames];
+		const int32_t *src_all[8];
+		for (unsigned c = 0; c < channels; ++c) {
+			for (size_t i = 0; i < max_frames; ++i)
+				/* use the upper 16 bits to check
+				   truncation */
+				src_buffer[c][i] = int32_t(0x12340000u * (c + 1)
+							   + i * 8 + c);
+			src_all[c] = src_buffer[c];
+		}
+
+		const std::span<const int32_t *const> src{src_all, channels};
+
+		for (const size_t n_frames : {0, 1, 8, 9, 16, 17, 24, 67}) {
+			static constexpr int32_t poison32 = 0x5a5a5a5a;
+			int32_t dest32[max_frames * 8 + 1];
+			std::fill_n(dest32, std::size(dest32), poison32);
+
+			static constexpr int16_t poison16 = 0x5a5a;
+			int16_t dest16[max_frames * 8 + 1];
+			std::fill_n(dest16, std::size(dest16), poison16);
+
+			PcmInterleave32(dest32, src, n_frames);
+			PcmInterleave32To16(dest16, src, n_frames);
+
+			for (size_t i = 0; i < n_frames; ++i) {
+				for (unsigned c = 0; c < channels; ++c) {
+					EXPECT_EQ(dest32[i * channels + c],
+						  src_buffer[c][i]);
+					EXPECT_EQ(dest16[i * channels + c],
+						  int16_t(src_buffer[c][i]));
+				}
+			}
+
+			EXPECT_EQ(dest32[n_frames * channels], poison32);
+			EXPECT_EQ(dest16[n_frames * channels], poison16);
+		}
+	}
+}
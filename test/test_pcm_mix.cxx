@@ -23,6 +23,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 template<typename T, SampleFormat format, typename G=RandomInt<T>>
 static void
 TestPcmMix(G g=G())
@@ -81,3 +83,50 @@ TEST(PcmTest, Mix32)
 {
 	TestPcmMix<int32_t, SampleFormat::S32>();
 }
+
+TEST(PcmTest, MixRamp)
+{
+	constexpr unsigned N = 509;
+	using G = RandomInt<int16_t>;
+	const auto src1 = TestDataBuffer<int16_t, N>(G{G::Engine{1}});
+	const auto src2 = TestDataBuffer<int16_t, N>(G{G::Engine{2}});
+
+	PcmDither dither;
+
+	/* a constant ramp must be equal to pcm_mix() */
+	auto result = src1;
+	bool success = pcm_mix_ramp(dither,
+				    result.begin(), src2.begin(),
+				    sizeof(result), SampleFormat::S16,
+				    sizeof(int16_t), 1.0, 1.0);
+	ASSERT_TRUE(success);
+	AssertEqualWithTolerance(result, src1, 3);
+
+	/* fade from src1 to src2: the first block is (almost) src1,
+	   the last block is (almost) src2 */
+	result = src1;
+	success = pcm_mix_ramp(dither,
+			       result.begin(), src2.begin(),
+			       sizeof(result), SampleFormat::S16,
+			       sizeof(int16_t), 1.0, 0.0);
+	ASSERT_TRUE(success);
+
+	for (unsigned i = 0; i < 8; ++i)
+		EXPECT_NEAR(result[i], src1[i], 1024);
+
+	for (unsigned i = N - 8; i < N; ++i)
+		EXPECT_NEAR(result[i], src2[i], 1024);
+
+	/* negative portions add both buffers (MixRamp) */
+	result = src1;
+	success = pcm_mix_ramp(dither,
+			       result.begin(), src2.begin(),
+			       sizeof(result), SampleFormat::S16,
+			       sizeof(int16_t), -1, -1);
+	ASSERT_TRUE(success);
+
+	for (unsigned i = 0; i < N; ++i)
+		EXPECT_EQ(result[i],
+			  std::clamp<int32_t>(int32_t(src1[i]) + src2[i],
+					      INT16_MIN, INT16_MAX));
+}
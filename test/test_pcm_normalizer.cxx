@@ -0,0 +1,160 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pcm/Normalizer.hxx"
+#include "pcm/Traits.hxx"
+#include "util/SpanCast.hxx"
+#include "test_pcm_util.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+
+template<typename T>
+static T
+PeakOf(std::span<const T> src) noexcept
+{
+	T result = 0;
+	for (const T i : src)
+		result = std::max<T>(result, i < 0 ? -i : i);
+	return result;
+}
+
+TEST(PcmTest, NormalizerSilence)
+{
+	PcmNormalizer normalizer(SampleFormat::S16);
+
+	std::array<int16_t, 1024> buffer{};
+	for (unsigned i = 0; i < 100; ++i) {
+		normalizer.Process(std::as_writable_bytes(std::span{buffer}));
+		for (const auto s : buffer)
+			EXPECT_EQ(s, 0);
+	}
+
+	EXPECT_LE(normalizer.GetGain(), PcmNormalizer::MAX_GAIN);
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+TestNormalizerQuiet(typename Traits::value_type amplitude,
+		    typename Traits::value_type max)
+{
+	using value_type = typename Traits::value_type;
+
+	PcmNormalizer normalizer(F);
+
+	/* a quiet square wave gets louder, but only up to the
+	   target level */
+	std::array<value_type, 1024> buffer;
+	for (unsigned i = 0; i < 2000; ++i) {
+		for (std::size_t j = 0; j < buffer.size(); ++j)
+			buffer[j] = j & 1 ? amplitude : -amplitude;
+
+		normalizer.Process(std::as_writable_bytes(std::span{buffer}));
+	}
+
+	const auto peak = PeakOf<value_type>(buffer);
+	EXPECT_GT(peak, amplitude * 4);
+	EXPECT_LE(double(peak),
+		  double(max) * double(PcmNormalizer::TARGET) * 1.01);
+	EXPECT_GT(normalizer.GetGain(), 4);
+	EXPECT_LE(normalizer.GetGain(), PcmNormalizer::MAX_GAIN);
+}
+
+TEST(PcmTest, NormalizerQuiet16)
+{
+	TestNormalizerQuiet<SampleFormat::S16>(500, 32767);
+}
+
+TEST(PcmTest, NormalizerQuiet24)
+{
+	TestNormalizerQuiet<SampleFormat::S24_P32>(100000, 0x7fffff);
+}
+
+TEST(PcmTest, NormalizerQuiet32)
+{
+	TestNormalizerQuiet<SampleFormat::S32>(10000000, 0x7fffffff);
+}
+
+TEST(PcmTest, NormalizerQuietFloat)
+{
+	TestNormalizerQuiet<SampleFormat::FLOAT>(0.01f, 1.f);
+}
+
+/**
+ * After a long quiet passage, a sudden loud block must not clip.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename G=RandomInt<typename Traits::value_type>>
+static void
+TestNormalizerNoClip(typename Traits::value_type quiet,
+		     typename Traits::value_type max, G g=G())
+{
+	using value_type = typename Traits::value_type;
+
+	PcmNormalizer normalizer(F);
+
+	std::array<value_type, 1024> buffer;
+	for (unsigned i = 0; i < 500; ++i) {
+		for (std::size_t j = 0; j < buffer.size(); ++j)
+			buffer[j] = j & 1 ? quiet : -quiet;
+
+		normalizer.Process(std::as_writable_bytes(std::span{buffer}));
+	}
+
+	const float gain = normalizer.GetGain();
+	EXPECT_GT(gain, 2);
+
+	for (unsigned i = 0; i < 10; ++i) {
+		auto loud = TestDataBuffer<value_type, 1024>(g);
+		std::copy(loud.begin(), loud.end(), buffer.begin());
+
+		normalizer.Process(std::as_writable_bytes(std::span{buffer}));
+
+		/* no sample was clamped */
+		for (std::size_t j = 0; j < buffer.size(); ++j) {
+			EXPECT_LE(std::fabs(double(buffer[j])),
+				  std::fabs(double(loud[j])) * double(gain) * 1.001 + 1);
+			EXPECT_LE(double(buffer[j]), double(max));
+			EXPECT_GE(double(buffer[j]), -double(max) - 1);
+		}
+	}
+
+	/* the gain was reduced because of the loud blocks */
+	EXPECT_LT(normalizer.GetGain(), gain);
+}
+
+TEST(PcmTest, NormalizerNoClip16)
+{
+	TestNormalizerNoClip<SampleFormat::S16>(1000, 32767);
+}
+
+TEST(PcmTest, NormalizerNoClip24)
+{
+	TestNormalizerNoClip<SampleFormat::S24_P32>(100000, 0x7fffff,
+						    RandomInt24());
+}
+
+TEST(PcmTest, NormalizerNoClipFloat)
+{
+	TestNormalizerNoClip<SampleFormat::FLOAT>(0.02f, 1.f, RandomFloat());
+}
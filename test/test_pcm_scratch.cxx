@@ -0,0 +1,104 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pcm/Scratch.hxx"
+#include "pcm/Buffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+TEST(PcmScratch, NoScope)
+{
+	EXPECT_EQ(PcmScratch::GetThread().Allocate(16), nullptr);
+
+	/* without a scope, a scratch PcmBuffer uses its own memory */
+	PcmBuffer buffer;
+	buffer.SetScratch(true);
+	EXPECT_NE(buffer.Get(16), nullptr);
+}
+
+TEST(PcmScratch, Scope)
+{
+	auto &scratch = PcmScratch::GetThread();
+
+	void *a, *b;
+
+	{
+		const PcmScratchScope scope;
+
+		a = scratch.Allocate(100);
+		b = scratch.Allocate(0);
+		ASSERT_NE(a, nullptr);
+		ASSERT_NE(b, nullptr);
+		EXPECT_NE(a, b);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0U);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 64, 0U);
+
+		{
+			const PcmScratchScope inner;
+			void *c = scratch.Allocate(1000);
+			ASSERT_NE(c, nullptr);
+		}
+
+		/* the inner scope has released only its own
+		   allocation */
+		void *d = scratch.Allocate(10);
+		ASSERT_NE(d, nullptr);
+		EXPECT_NE(d, a);
+		EXPECT_NE(d, b);
+	}
+
+	EXPECT_EQ(scratch.Allocate(16), nullptr);
+
+	/* the first scope did not fit into the (empty) buffer; now
+	   it has grown, and the same allocations are contiguous */
+	for (unsigned i = 0; i < 2; ++i) {
+		const PcmScratchScope scope;
+		auto *e = static_cast<std::byte *>(scratch.Allocate(100));
+		auto *f = static_cast<std::byte *>(scratch.Allocate(0));
+		auto *g = static_cast<std::byte *>(scratch.Allocate(1000));
+		ASSERT_NE(e, nullptr);
+		EXPECT_EQ(f, e + 128);
+		EXPECT_EQ(g, f + 64);
+
+		if (i == 0)
+			a = e;
+		else
+			/* memory is reused */
+			EXPECT_EQ(e, a);
+	}
+}
+
+TEST(PcmScratch, Buffer)
+{
+	PcmBuffer own, shared;
+	shared.SetScratch(true);
+
+	const PcmScratchScope scope;
+
+	void *a = shared.Get(64);
+	void *b = own.Get(64);
+	void *c = PcmScratch::GetThread().Allocate(64);
+
+	/* "shared" allocates from the scratch arena, "own" does
+	   not */
+	EXPECT_EQ(static_cast<std::byte *>(a) + 64, c);
+	EXPECT_NE(b, c);
+}
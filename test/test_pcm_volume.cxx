@@ -77,6 +77,32 @@ TEST(PcmTest, Volume16)
 	TestVolume<SampleFormat::S16>();
 }
 
+TEST(PcmTest, Volume16Clip)
+{
+	constexpr SampleFormat F = SampleFormat::S16;
+	using value_type = int16_t;
+
+	PcmVolume pv;
+	EXPECT_EQ(pv.Open(F, false), F);
+
+	constexpr size_t N = 509;
+	const auto _src = TestDataBuffer<value_type, N>(RandomInt<value_type>());
+	const std::span<const std::byte> src = _src;
+
+	pv.SetVolume(PCM_VOLUME_1 * 4);
+	const auto dest = pv.Apply(src);
+	EXPECT_EQ(src.size(), dest.size());
+
+	const auto _dest = FromBytesStrict<const value_type>(dest);
+	for (unsigned i = 0; i < N; ++i) {
+		const int expected = std::clamp(_src[i] * 4, -32768, 32767);
+		EXPECT_GE(_dest[i], expected - 4);
+		EXPECT_LE(_dest[i], expected + 4);
+	}
+
+	pv.Close();
+}
+
 TEST(PcmTest, Volume16to32)
 {
 	constexpr SampleFormat F = SampleFormat::S16;
@@ -158,3 +184,95 @@ TEST(PcmTest, VolumeFloat)
 
 	pv.Close();
 }
+
+template<SampleFormat F, class Traits=SampleTraits<F>,
+	 typename G=RandomInt<typename Traits::value_type>>
+static void
+TestVolumeInPlace(G g=G())
+{
+	using value_type = typename Traits::value_type;
+
+	PcmVolume a, b;
+	a.Open(F, false);
+	b.Open(F, false);
+
+	constexpr size_t N = 509;
+	const auto _src = TestDataBuffer<value_type, N>(g);
+	const std::span<const std::byte> src = _src;
+
+	a.SetVolume(PCM_VOLUME_1);
+	EXPECT_FALSE(a.CanApplyInPlace());
+
+	for (const unsigned volume : {0U, PCM_VOLUME_1 / 3, PCM_VOLUME_1 * 2}) {
+		a.SetVolume(volume);
+		b.SetVolume(volume);
+		EXPECT_TRUE(b.CanApplyInPlace());
+
+		value_type buffer[N];
+		std::copy_n(_src.begin(), N, buffer);
+		b.ApplyInPlace(std::as_writable_bytes(std::span{buffer}));
+
+		const auto expected = a.Apply(src);
+		ASSERT_EQ(expected.size(), sizeof(buffer));
+		EXPECT_EQ(0, memcmp(expected.data(), buffer, sizeof(buffer)));
+	}
+
+	a.Close();
+	b.Close();
+}
+
+TEST(PcmTest, VolumeInPlace)
+{
+	TestVolumeInPlace<SampleFormat::S8>();
+	TestVolumeInPlace<SampleFormat::S16>();
+	TestVolumeInPlace<SampleFormat::S24_P32>(RandomInt24());
+	TestVolumeInPlace<SampleFormat::S32>();
+	TestVolumeInPlace<SampleFormat::FLOAT>(RandomFloat());
+
+	PcmVolume pv;
+	pv.Open(SampleFormat::S16, true);
+	pv.SetVolume(PCM_VOLUME_1 / 2);
+	EXPECT_FALSE(pv.CanApplyInPlace());
+	pv.Close();
+}
+
+TEST(PcmTest, VolumeRamp)
+{
+	PcmVolume pv;
+	EXPECT_EQ(pv.Open(SampleFormat::S16, false), SampleFormat::S16);
+	pv.SetRamp(true);
+
+	constexpr size_t N = 1024;
+	int16_t src[N];
+	std::fill_n(src, N, int16_t(10000));
+
+	/* fade from 100% to 0%: starts loud, ends (almost) silent */
+	pv.SetVolume(0);
+	EXPECT_TRUE(pv.CanApplyInPlace());
+	auto dest = FromBytesStrict<const int16_t>(pv.Apply(std::as_bytes(std::span{src})));
+	ASSERT_EQ(dest.size(), N);
+	EXPECT_GT(dest.front(), 8000);
+	EXPECT_LT(dest.back(), 2000);
+	EXPECT_GT(dest[N / 4], dest[N / 2]);
+	EXPECT_GT(dest[N / 2], dest[N * 3 / 4]);
+
+	/* the ramp is finished; the next buffer is silent */
+	EXPECT_TRUE(pv.CanApplyInPlace());
+	dest = FromBytesStrict<const int16_t>(pv.Apply(std::as_bytes(std::span{src})));
+	EXPECT_TRUE(std::all_of(dest.begin(), dest.end(),
+				[](int16_t i){ return i == 0; }));
+
+	/* fade back to 100% in place */
+	pv.SetVolume(PCM_VOLUME_1);
+	EXPECT_TRUE(pv.CanApplyInPlace());
+	int16_t buffer[N];
+	std::copy_n(src, N, buffer);
+	pv.ApplyInPlace(std::as_writable_bytes(std::span{buffer}));
+	EXPECT_LT(buffer[0], 2000);
+	EXPECT_GT(buffer[N - 1], 8000);
+
+	/* at 100% without a ramp, in-place is pointless again */
+	EXPECT_FALSE(pv.CanApplyInPlace());
+
+	pv.Close();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2003-2022 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "util/BitReverse.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(BitReverse, Byte)
+{
+	EXPECT_EQ(bit_reverse(0x00), 0x00);
+	EXPECT_EQ(bit_reverse(0x01), 0x80);
+	EXPECT_EQ(bit_reverse(0x0f), 0xf0);
+	EXPECT_EQ(bit_reverse(0x12), 0x48);
+	EXPECT_EQ(bit_reverse(0xff), 0xff);
+}
+
+TEST(BitReverse, Buffer)
+{
+	/* all byte values, with odd sizes and offsets to exercise
+	   both the vector loop and the remainder */
+	uint8_t src[256 + 7];
+	for (unsigned i = 0; i < std::size(src); ++i)
+		src[i] = uint8_t(i * 37 + 11);
+
+	for (std::size_t offset = 0; offset < 4; ++offset) {
+		for (std::size_t n : {0, 1, 15, 16, 17, 33, 255}) {
+			uint8_t buffer[std::size(src)];
+			std::copy_n(src, std::size(src), buffer);
+
+			BitReverse(buffer + offset, n);
+
+			for (std::size_t i = 0; i < std::size(src); ++i) {
+				if (i >= offset && i < offset + n)
+					EXPECT_EQ(buffer[i], bit_reverse(src[i]));
+				else
+					EXPECT_EQ(buffer[i], src[i]);
+			}
+		}
+	}
+}
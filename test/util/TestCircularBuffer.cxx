@@ -148,3 +148,51 @@ TEST(CircularBuffer, Basic)
 	EXPECT_EQ(&data[3], buffer.Write().data());
 	EXPECT_EQ(size_t(5), buffer.Write().size());
 }
+
+TEST(CircularBuffer, SetCapacity)
+{
+	constexpr size_t N = 8;
+	int data[N];
+	CircularBuffer<int> buffer(data, N);
+
+	/* shrink the empty buffer */
+	/* [...X] */
+	EXPECT_TRUE(buffer.SetCapacity(4));
+	EXPECT_EQ(size_t(4), buffer.GetCapacity());
+	EXPECT_EQ(size_t(3), buffer.GetSpace());
+	EXPECT_EQ(size_t(3), buffer.Write().size());
+
+	/* [OOOX] */
+	buffer.Append(3);
+	EXPECT_TRUE(buffer.IsFull());
+
+	/* data ends at the capacity: cannot shrink */
+	EXPECT_FALSE(buffer.SetCapacity(3));
+	EXPECT_EQ(size_t(4), buffer.GetCapacity());
+
+	/* grow */
+	/* [OOO....X] */
+	EXPECT_TRUE(buffer.SetCapacity(N));
+	EXPECT_FALSE(buffer.IsFull());
+	EXPECT_EQ(size_t(3), buffer.GetSize());
+	EXPECT_EQ(size_t(4), buffer.GetSpace());
+
+	/* wrap around */
+	/* [...OOOOO] */
+	buffer.Append(4);
+	buffer.Consume(3);
+	buffer.Append(1);
+	EXPECT_EQ(size_t(5), buffer.GetSize());
+
+	/* data wraps around: cannot change the capacity */
+	EXPECT_FALSE(buffer.SetCapacity(4));
+	EXPECT_EQ(size_t(N), buffer.GetCapacity());
+
+	/* consume everything, which rewinds the empty buffer */
+	buffer.Consume(4);
+	buffer.Consume(1);
+	EXPECT_TRUE(buffer.empty());
+	EXPECT_TRUE(buffer.SetCapacity(2));
+	EXPECT_EQ(&data[0], buffer.Write().data());
+	EXPECT_EQ(size_t(1), buffer.Write().size());
+}